@@ -0,0 +1,414 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+/**
+ * Times the core code paths of Kdenlive on reproducible synthetic inputs:
+ * thumbnail extraction, the colour scope kernels, audio envelope and correlation,
+ * project xml parsing and writing, and timeline snapping.
+ *
+ * The results are written as JSON (one object per benchmark with the min, median
+ * and mean duration of its iterations) so that runs can be compared over time.
+ * Run with -platform offscreen on machines without a display.
+ */
+
+#include "doc/kthumb.h"
+#include "lib/audio/audioEnvelope.h"
+#include "lib/audio/fftCorrelation.h"
+#include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/rgbparadegenerator.h"
+#include "scopes/colorscopes/vectorscopegenerator.h"
+#include "scopes/colorscopes/waveformgenerator.h"
+#include "timeline/snapindex.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDataStream>
+#include <QDir>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <mlt++/Mlt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// Seed of the synthetic inputs, so that all runs process the same data
+#define BENCH_SEED 20161011
+// Iterations of each benchmark when not given on the command line
+#define BENCH_ITERATIONS 10
+
+/** @brief Deterministic pseudo random numbers, the same on all platforms. */
+class BenchRandom
+{
+public:
+    explicit BenchRandom(quint32 seed = BENCH_SEED) : m_state(seed) {}
+    quint32 next()
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return m_state >> 8;
+    }
+    int bounded(int max)
+    {
+        return (int) (next() % (quint32) max);
+    }
+
+private:
+    quint32 m_state;
+};
+
+struct BenchCase {
+    QString name;
+    /** @brief What one iteration processes, for example "1920x1080 frame". */
+    QString input;
+    /** @brief Runs before each iteration, not timed. */
+    std::function<void()> setup;
+    std::function<void()> run;
+};
+
+/** @brief An RGB image with gradients and noise, so that all scope bins are used. */
+static QImage syntheticImage(int width, int height)
+{
+    BenchRandom random;
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = (QRgb *) image.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int noise = random.bounded(32);
+            line[x] = qRgb((x * 255 / width + noise) & 0xff, (y * 255 / height + noise) & 0xff, ((x + y) * 127 / (width + height) + 2 * noise) & 0xff);
+        }
+    }
+    return image;
+}
+
+/** @brief A random walk envelope like the ones computed from speech and music. */
+static QVector<qint64> syntheticEnvelope(int size, quint32 seed)
+{
+    BenchRandom random(seed);
+    QVector<qint64> envelope(size);
+    qint64 value = 1000;
+    for (int i = 0; i < size; ++i) {
+        value = qMax((qint64) 0, value + random.bounded(201) - 100);
+        envelope[i] = value;
+    }
+    return envelope;
+}
+
+/** @brief Writes a mono 16 bit wav file with a sweep and noise. */
+static bool writeSyntheticWav(const QString &path, int seconds)
+{
+    const int rate = 48000;
+    const int samples = rate * seconds;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << (quint32) (36 + samples * 2);
+    out.writeRawData("WAVEfmt ", 8);
+    out << (quint32) 16 << (quint16) 1 << (quint16) 1 << (quint32) rate << (quint32) (rate * 2) << (quint16) 2 << (quint16) 16;
+    out.writeRawData("data", 4);
+    out << (quint32) (samples * 2);
+    BenchRandom random;
+    for (int i = 0; i < samples; ++i) {
+        const double t = (double) i / rate;
+        const double sweep = sin(2 * M_PI * (200 + 20 * t) * t) * (0.5 + 0.5 * sin(t));
+        out << (qint16) (sweep * 20000 + random.bounded(2000) - 1000);
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+/** @brief An MLT project with tracks of clips carrying filters, like a long edit. */
+static QString syntheticProject(int tracks, int clipsPerTrack)
+{
+    BenchRandom random;
+    QString xml;
+    QTextStream stream(&xml);
+    const int producers = 200;
+    stream << "<?xml version='1.0' encoding='utf-8'?>\n<mlt LC_NUMERIC=\"C\" version=\"6.3.0\" producer=\"main bin\">\n";
+    stream << " <profile description=\"HD 1080p 25 fps\" width=\"1920\" height=\"1080\" progressive=\"1\" sample_aspect_num=\"1\" sample_aspect_den=\"1\" display_aspect_num=\"16\" display_aspect_den=\"9\" frame_rate_num=\"25\" frame_rate_den=\"1\" colorspace=\"709\"/>\n";
+    for (int i = 0; i < producers; ++i) {
+        stream << " <producer id=\"" << i + 2 << "\" in=\"0\" out=\"14999\">\n";
+        stream << "  <property name=\"resource\">/media/footage/clip" << i << ".mp4</property>\n";
+        stream << "  <property name=\"mlt_service\">avformat-novalidate</property>\n";
+        stream << "  <property name=\"kdenlive:id\">" << i + 2 << "</property>\n";
+        stream << "  <property name=\"kdenlive:file_hash\">" << QString::number(random.next(), 16) << QString::number(random.next(), 16) << "</property>\n";
+        stream << " </producer>\n";
+    }
+    for (int t = 0; t < tracks; ++t) {
+        stream << " <playlist id=\"playlist" << t << "\">\n";
+        for (int c = 0; c < clipsPerTrack; ++c) {
+            if (random.bounded(4) == 0) {
+                stream << "  <blank length=\"" << random.bounded(100) + 1 << "\"/>\n";
+            }
+            const int in = random.bounded(10000);
+            stream << "  <entry producer=\"" << random.bounded(producers) + 2 << "\" in=\"" << in << "\" out=\"" << in + random.bounded(500) + 10 << "\">\n";
+            stream << "   <filter id=\"filter" << t * clipsPerTrack + c << "\">\n";
+            stream << "    <property name=\"mlt_service\">volume</property>\n";
+            stream << "    <property name=\"gain\">0=1;50=0.5;100=1</property>\n";
+            stream << "    <property name=\"kdenlive_id\">volume</property>\n";
+            stream << "   </filter>\n";
+            stream << "  </entry>\n";
+        }
+        stream << " </playlist>\n";
+    }
+    stream << " <tractor id=\"maintractor\" global_feed=\"1\">\n";
+    for (int t = 0; t < tracks; ++t) {
+        stream << "  <track producer=\"playlist" << t << "\"/>\n";
+    }
+    stream << " </tractor>\n</mlt>\n";
+    stream.flush();
+    return xml;
+}
+
+/** @brief Runs a benchmark and returns its timings in milliseconds. */
+static QJsonObject runCase(const BenchCase &bench, int iterations)
+{
+    // One untimed run to load plugins and fill caches that are not being measured
+    if (bench.setup) bench.setup();
+    bench.run();
+    QVector<double> times;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        if (bench.setup) bench.setup();
+        timer.start();
+        bench.run();
+        times << timer.nsecsElapsed() / 1000000.0;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (int i = 0; i < times.count(); ++i) {
+        total += times.at(i);
+    }
+    QJsonObject result;
+    result.insert(QStringLiteral("name"), bench.name);
+    result.insert(QStringLiteral("input"), bench.input);
+    result.insert(QStringLiteral("iterations"), iterations);
+    result.insert(QStringLiteral("min_ms"), times.first());
+    result.insert(QStringLiteral("median_ms"), times.at(times.count() / 2));
+    result.insert(QStringLiteral("mean_ms"), total / times.count());
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    QApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("kdenlive_bench"));
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Times Kdenlive's core code paths on synthetic inputs."));
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"), QStringLiteral("Write the JSON results to <file> instead of the standard output."), QStringLiteral("file"));
+    QCommandLineOption iterationsOption(QStringList() << QStringLiteral("i") << QStringLiteral("iterations"), QStringLiteral("Timed iterations of each benchmark."), QStringLiteral("count"), QString::number(BENCH_ITERATIONS));
+    QCommandLineOption filterOption(QStringList() << QStringLiteral("f") << QStringLiteral("filter"), QStringLiteral("Only run the benchmarks whose name matches <regexp>."), QStringLiteral("regexp"));
+    QCommandLineOption listOption(QStringList() << QStringLiteral("l") << QStringLiteral("list"), QStringLiteral("List the benchmarks and exit."));
+    parser.addOption(outputOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(filterOption);
+    parser.addOption(listOption);
+    parser.process(app);
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const QRegExp filter(parser.value(filterOption));
+
+    // Keep the envelope cache and settings of the user out of the measurements
+    QStandardPaths::setTestModeEnabled(true);
+    Mlt::Factory::init();
+    Mlt::Profile profile("atsc_1080p_25");
+    QTemporaryDir tempDir;
+
+    QList<BenchCase> cases;
+
+    // Thumbnails
+    Mlt::Producer noise(profile, "noise");
+    BenchCase thumbs;
+    thumbs.name = QStringLiteral("kthumb_getframe");
+    thumbs.input = QStringLiteral("25 frames of a 1920x1080 noise producer to 320x180");
+    thumbs.run = [&noise]() {
+        for (int i = 0; i < 25; ++i) {
+            KThumb::getFrame(&noise, i * 10, 320, 180);
+        }
+    };
+    cases << thumbs;
+
+    // Colour scopes, accelFactor 1 processes every pixel
+    const QImage frame = syntheticImage(1920, 1080);
+    const QSize scopeSize(720, 512);
+    HistogramGenerator histogram;
+    RGBParadeGenerator parade;
+    VectorscopeGenerator vectorscope;
+    WaveformGenerator waveform;
+    BenchCase histogramCase;
+    histogramCase.name = QStringLiteral("scope_histogram");
+    histogramCase.input = QStringLiteral("1920x1080 rgb image, Y R G B components");
+    histogramCase.run = [&]() {
+        histogram.calculateHistogram(scopeSize, frame, HistogramGenerator::ComponentY | HistogramGenerator::ComponentR | HistogramGenerator::ComponentG | HistogramGenerator::ComponentB, HistogramGenerator::Rec_709, false, 1);
+    };
+    cases << histogramCase;
+    BenchCase paradeCase;
+    paradeCase.name = QStringLiteral("scope_rgbparade");
+    paradeCase.input = QStringLiteral("1920x1080 rgb image");
+    paradeCase.run = [&]() {
+        parade.calculateRGBParade(scopeSize, frame, RGBParadeGenerator::PaintMode_RGB, true, true, 1);
+    };
+    cases << paradeCase;
+    BenchCase vectorscopeCase;
+    vectorscopeCase.name = QStringLiteral("scope_vectorscope");
+    vectorscopeCase.input = QStringLiteral("1920x1080 rgb image");
+    vectorscopeCase.run = [&]() {
+        vectorscope.calculateVectorscope(QSize(512, 512), frame, 1.0f, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1);
+    };
+    cases << vectorscopeCase;
+    BenchCase waveformCase;
+    waveformCase.name = QStringLiteral("scope_waveform");
+    waveformCase.input = QStringLiteral("1920x1080 rgb image");
+    waveformCase.run = [&]() {
+        waveform.calculateWaveform(scopeSize, frame, WaveformGenerator::PaintMode_Green, true, WaveformGenerator::Rec_709, 1);
+    };
+    cases << waveformCase;
+
+    // Audio alignment
+    const QVector<qint64> mainEnvelope = syntheticEnvelope(90000, BENCH_SEED);
+    const QVector<qint64> otherEnvelope = syntheticEnvelope(30000, BENCH_SEED + 1);
+    QVector<float> correlation(mainEnvelope.count() + otherEnvelope.count() + 1);
+    BenchCase correlationCase;
+    correlationCase.name = QStringLiteral("fft_correlation");
+    correlationCase.input = QStringLiteral("envelopes of 90000 and 30000 frames (one hour and 20 minutes at 25 fps)");
+    correlationCase.run = [&]() {
+        FFTCorrelation::correlate(mainEnvelope.constData(), mainEnvelope.count(), otherEnvelope.constData(), otherEnvelope.count(), correlation.data());
+    };
+    cases << correlationCase;
+
+    const QString wavFile = tempDir.path() + QStringLiteral("/sweep.wav");
+    if (writeSyntheticWav(wavFile, 120)) {
+        BenchCase envelopeCase;
+        envelopeCase.name = QStringLiteral("audio_envelope");
+        envelopeCase.input = QStringLiteral("120 seconds of 48kHz mono audio");
+        envelopeCase.setup = []() {
+            // Do not measure reading the envelope from the cache
+            QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/audioenvelopes")).removeRecursively();
+        };
+        envelopeCase.run = [&]() {
+            Mlt::Producer producer(profile, wavFile.toUtf8().constData());
+            AudioEnvelope envelope(wavFile, &producer);
+            envelope.loadEnvelope();
+        };
+        cases << envelopeCase;
+    }
+
+    // Project documents, the xml side of loading and saving
+    const QString projectXml = syntheticProject(12, 1500);
+    QDomDocument project;
+    BenchCase loadCase;
+    loadCase.name = QStringLiteral("project_xml_load");
+    loadCase.input = QStringLiteral("12 tracks of 1500 clips with a keyframed filter each");
+    loadCase.run = [&]() {
+        QDomDocument doc;
+        doc.setContent(projectXml);
+    };
+    cases << loadCase;
+    BenchCase saveCase;
+    saveCase.name = QStringLiteral("project_xml_save");
+    saveCase.input = loadCase.input;
+    saveCase.setup = [&]() {
+        if (project.isNull()) project.setContent(projectXml);
+    };
+    saveCase.run = [&]() {
+        QFile file(tempDir.path() + QStringLiteral("/project.kdenlive"));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(project.toString().toUtf8());
+        }
+    };
+    cases << saveCase;
+
+    // Timeline snapping, the lookups run for each mouse move while dragging
+    QVector<int> snapPoints;
+    BenchRandom random;
+    for (int i = 0; i < 40000; ++i) {
+        snapPoints << random.bounded(500000);
+    }
+    SnapIndex snaps;
+    snaps.setPoints(snapPoints);
+    BenchCase snapCase;
+    snapCase.name = QStringLiteral("timeline_snap_lookup");
+    snapCase.input = QStringLiteral("100000 lookups among 40000 snap points");
+    snapCase.run = [&]() {
+        BenchRandom positions(BENCH_SEED);
+        for (int i = 0; i < 100000; ++i) {
+            snaps.closestPoint(positions.bounded(500000) + 0.5, 6);
+        }
+    };
+    cases << snapCase;
+    BenchCase snapUpdateCase;
+    snapUpdateCase.name = QStringLiteral("timeline_snap_update");
+    snapUpdateCase.input = QStringLiteral("5000 moves of a clip among 40000 snap points");
+    snapUpdateCase.run = [&]() {
+        SnapIndex index(snaps);
+        BenchRandom positions(BENCH_SEED);
+        for (int i = 0; i < 5000; ++i) {
+            const int frame = snapPoints.at(i);
+            index.removePoint(frame);
+            index.addPoint(positions.bounded(500000));
+        }
+    };
+    cases << snapUpdateCase;
+
+    if (parser.isSet(listOption)) {
+        QTextStream out(stdout);
+        foreach(const BenchCase &bench, cases) {
+            out << bench.name << ": " << bench.input << endl;
+        }
+        return 0;
+    }
+
+    QJsonArray results;
+    QTextStream log(stderr);
+    foreach(const BenchCase &bench, cases) {
+        if (!filter.isEmpty() && filter.indexIn(bench.name) < 0) continue;
+        QJsonObject result = runCase(bench, iterations);
+        log << bench.name << ": " << result.value(QStringLiteral("median_ms")).toDouble() << " ms (median)" << endl;
+        results.append(result);
+    }
+    QJsonObject report;
+    report.insert(QStringLiteral("qt"), QString::fromLatin1(qVersion()));
+    report.insert(QStringLiteral("mlt"), QString::fromLatin1(mlt_version_get_string()));
+    report.insert(QStringLiteral("threads"), QThread::idealThreadCount());
+    report.insert(QStringLiteral("seed"), BENCH_SEED);
+    report.insert(QStringLiteral("results"), results);
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            log << "Cannot write to " << file.fileName() << endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,418 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "cachebuilder.h"
+#include "kdenlivesettings.h"
+#include "bin/audiolevels.h"
+#include "bin/audiopeakextractor.h"
+#include "doc/cacheindex.h"
+#include "doc/kthumb.h"
+#include "doc/proxystore.h"
+#include "doc/thumbnailcache.h"
+#include "lib/audio/audioStreamInfo.h"
+#include "mltcontroller/probecache.h"
+
+#include <mlt++/Mlt.h>
+
+#include <QDirIterator>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+// Height of the timeline thumbnails, as requested by the clips
+#define THUMBNAIL_HEIGHT 150
+// Number of frames decoded at once for the audio thumbnails
+#define AUDIO_BLOCK_FRAMES 250
+
+CacheBuilder::Context::Context() :
+    profile(NULL)
+    , thumbnails(NULL)
+    , proxies(false)
+    , proxyMinSize(0)
+{
+}
+
+CacheBuilder::Context::~Context()
+{
+    delete thumbnails;
+    delete profile;
+}
+
+CacheBuilder::CacheBuilder(int kinds, int jobs) :
+    m_kinds(kinds)
+    , m_jobs(qMax(1, jobs))
+{
+}
+
+CacheBuilder::~CacheBuilder()
+{
+}
+
+int CacheBuilder::count() const
+{
+    return m_tasks.count();
+}
+
+static QString propertyValue(const QDomElement &element, const QString &name)
+{
+    QDomNodeList props = element.elementsByTagName(QStringLiteral("property"));
+    for (int i = 0; i < props.count(); ++i) {
+        QDomElement e = props.at(i).toElement();
+        if (e.attribute(QStringLiteral("name")) == name) {
+            return e.firstChild().nodeValue();
+        }
+    }
+    return QString();
+}
+
+bool CacheBuilder::addProject(const QString &path, QString *error)
+{
+    QFile file(path);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file)) {
+        *error = QStringLiteral("Cannot read project file %1").arg(path);
+        return false;
+    }
+    file.close();
+    QDomElement mlt = doc.documentElement();
+    QDomNodeList playlists = mlt.elementsByTagName(QStringLiteral("playlist"));
+    QDomElement bin;
+    for (int i = 0; i < playlists.count(); ++i) {
+        if (playlists.at(i).toElement().attribute(QStringLiteral("id")) == QLatin1String("main bin")) {
+            bin = playlists.at(i).toElement();
+            break;
+        }
+    }
+    if (bin.isNull()) {
+        *error = QStringLiteral("%1 is not a Kdenlive project").arg(path);
+        return false;
+    }
+    QSharedPointer<Context> context(new Context);
+    const QString documentId = propertyValue(bin, QStringLiteral("kdenlive:docproperties.documentid"));
+    bool ok = false;
+    documentId.toLong(&ok);
+    const QString cacheFolder = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (ok && !documentId.isEmpty() && !cacheFolder.isEmpty()) {
+        // Same layout as KdenliveDoc::initCacheDirs
+        QDir base(cacheFolder + QStringLiteral("/") + documentId);
+        base.mkpath(QStringLiteral("audiothumbs"));
+        base.mkpath(QStringLiteral("videothumbs"));
+        context->audioFolder = QDir(base.absoluteFilePath(QStringLiteral("audiothumbs")));
+        context->thumbnails = new ThumbnailCache;
+        context->thumbnails->setDiskFolder(QDir(base.absoluteFilePath(QStringLiteral("videothumbs"))), true);
+        CacheIndex::markUsed(documentId);
+    }
+    context->proxies = propertyValue(bin, QStringLiteral("kdenlive:docproperties.enableproxy")).toInt() == 1;
+    context->proxyParams = propertyValue(bin, QStringLiteral("kdenlive:docproperties.proxyparams"));
+    context->proxyExtension = propertyValue(bin, QStringLiteral("kdenlive:docproperties.proxyextension"));
+    context->proxyMinSize = propertyValue(bin, QStringLiteral("kdenlive:docproperties.proxyminsize")).toInt();
+
+    // The project profile, stored by MLT in the document
+    QDomElement profile = mlt.firstChildElement(QStringLiteral("profile"));
+    context->profile = new Mlt::Profile();
+    if (!profile.isNull()) {
+        context->profile->set_width(profile.attribute(QStringLiteral("width")).toInt());
+        context->profile->set_height(profile.attribute(QStringLiteral("height")).toInt());
+        context->profile->set_frame_rate(profile.attribute(QStringLiteral("frame_rate_num")).toInt(), profile.attribute(QStringLiteral("frame_rate_den")).toInt());
+        context->profile->set_sample_aspect(profile.attribute(QStringLiteral("sample_aspect_num")).toInt(), profile.attribute(QStringLiteral("sample_aspect_den")).toInt());
+        context->profile->set_display_aspect(profile.attribute(QStringLiteral("display_aspect_num")).toInt(), profile.attribute(QStringLiteral("display_aspect_den")).toInt());
+        context->profile->set_progressive(profile.attribute(QStringLiteral("progressive")).toInt());
+        context->profile->set_colorspace(profile.attribute(QStringLiteral("colorspace")).toInt());
+    }
+    context->profile->set_explicit(true);
+
+    // Bin clips by id, and the producers of the document pointing to them
+    QMap <QString, int> clipTasks;
+    QMap <QString, QString> producerClips;
+    QDir root(mlt.attribute(QStringLiteral("root")));
+    QDomNodeList producers = mlt.elementsByTagName(QStringLiteral("producer"));
+    for (int i = 0; i < producers.count(); ++i) {
+        QDomElement producer = producers.at(i).toElement();
+        const QString clipId = propertyValue(producer, QStringLiteral("kdenlive:id"));
+        if (clipId.isEmpty()) {
+            continue;
+        }
+        producerClips.insert(producer.attribute(QStringLiteral("id")), clipId);
+        if (clipTasks.contains(clipId)) {
+            continue;
+        }
+        const QString service = propertyValue(producer, QStringLiteral("mlt_service"));
+        if (!service.startsWith(QLatin1String("avformat"))) {
+            // Only media files have probe results, proxies and audio
+            continue;
+        }
+        QString resource = propertyValue(producer, QStringLiteral("kdenlive:originalurl"));
+        if (resource.isEmpty()) {
+            resource = propertyValue(producer, QStringLiteral("resource"));
+        }
+        resource = root.absoluteFilePath(resource);
+        if (!QFile::exists(resource)) {
+            report(resource, QStringLiteral("missing clip"));
+            continue;
+        }
+        Task task;
+        task.path = resource;
+        task.hash = propertyValue(producer, QStringLiteral("kdenlive:file_hash"));
+        task.context = context;
+        task.proxy = propertyValue(producer, QStringLiteral("kdenlive:proxy"));
+        if (!task.proxy.isEmpty() && task.proxy != QLatin1String("-")) {
+            task.proxy = root.absoluteFilePath(task.proxy);
+        }
+        clipTasks.insert(clipId, m_tasks.count());
+        m_tasks << task;
+    }
+    // Timeline thumbnails show the first and last frame of each clip
+    QDomNodeList entries = mlt.elementsByTagName(QStringLiteral("entry"));
+    for (int i = 0; i < entries.count(); ++i) {
+        QDomElement entry = entries.at(i).toElement();
+        const QString clipId = producerClips.value(entry.attribute(QStringLiteral("producer")));
+        if (!clipTasks.contains(clipId)) {
+            continue;
+        }
+        Task &task = m_tasks[clipTasks.value(clipId)];
+        const int in = entry.attribute(QStringLiteral("in")).toInt();
+        const int out = entry.attribute(QStringLiteral("out")).toInt();
+        if (!task.thumbnailFrames.contains(in)) task.thumbnailFrames << in;
+        if (!task.thumbnailFrames.contains(out)) task.thumbnailFrames << out;
+    }
+    return true;
+}
+
+void CacheBuilder::addFolder(const QString &path, bool recursive)
+{
+    if (!m_folderContext) {
+        // Media folders follow the proxy settings of the editor
+        m_folderContext = QSharedPointer<Context>(new Context);
+        m_folderContext->profile = new Mlt::Profile();
+        m_folderContext->proxies = true;
+        m_folderContext->proxyParams = KdenliveSettings::proxyparams();
+        m_folderContext->proxyExtension = KdenliveSettings::proxyextension();
+        m_folderContext->proxyMinSize = KdenliveSettings::proxyminsize();
+    }
+    QMimeDatabase mimeDatabase;
+    QDirIterator it(path, QDir::Files, recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        const QString file = it.next();
+        if (it.fileName().startsWith(QLatin1Char('.'))) {
+            continue;
+        }
+        const QString mime = mimeDatabase.mimeTypeForFile(file).name();
+        if (!mime.startsWith(QLatin1String("video/")) && !mime.startsWith(QLatin1String("audio/"))) {
+            continue;
+        }
+        Task task;
+        task.path = file;
+        task.context = m_folderContext;
+        m_tasks << task;
+    }
+}
+
+int CacheBuilder::run()
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_jobs);
+    QList <QFuture<bool> > results;
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        results << QtConcurrent::run(&pool, this, &CacheBuilder::processTask, m_tasks.at(i));
+    }
+    int failures = 0;
+    for (int i = 0; i < results.count(); ++i) {
+        if (!results.at(i).result()) {
+            failures++;
+        }
+    }
+    CacheIndex::sync();
+    return failures;
+}
+
+bool CacheBuilder::processTask(const Task &task)
+{
+    QString hash = task.hash;
+    if (hash.isEmpty()) {
+        hash = ProxyStore::fileHash(task.path);
+        if (hash.isEmpty()) {
+            report(task.path, QStringLiteral("cannot read file"));
+            return false;
+        }
+    }
+    const QByteArray path = task.path.toUtf8();
+    Mlt::Producer *producer = NULL;
+    bool probed = false;
+    if (m_kinds & CacheProbe) {
+        // Same order as ProducerQueue, the probe results are only stored when missing
+        producer = new Mlt::Producer(*task.context->profile, "avformat-novalidate", path.constData());
+        probed = producer->is_valid() && ProbeCache::restore(hash, task.path, *producer);
+        if (!probed) {
+            delete producer;
+            producer = NULL;
+        }
+    }
+    if (producer == NULL) {
+        producer = new Mlt::Producer(*task.context->profile, 0, path.constData());
+        if (!producer->is_valid()) {
+            delete producer;
+            report(task.path, QStringLiteral("cannot open file"));
+            return false;
+        }
+        if (m_kinds & CacheProbe) {
+            ProbeCache::store(hash, task.path, *producer);
+            report(task.path, QStringLiteral("probed"));
+        }
+    }
+    bool result = true;
+    if (m_kinds & CacheProxies) {
+        result = buildProxy(task, hash, producer->get_int("meta.media.width")) && result;
+    }
+    // Audio levels and thumbnails are stored in the project cache folders
+    if ((m_kinds & CacheAudioThumbs) && task.context->thumbnails) {
+        result = buildAudioThumb(task, hash, *producer) && result;
+    }
+    if ((m_kinds & CacheThumbnails) && task.context->thumbnails && producer->get_int("video_index") > -1) {
+        buildThumbnails(task, hash, *producer);
+    }
+    delete producer;
+    return result;
+}
+
+bool CacheBuilder::buildProxy(const Task &task, const QString &hash, int width)
+{
+    const Context *context = task.context.data();
+    if (task.proxy == QLatin1String("-") || context->proxyParams.isEmpty()) {
+        return true;
+    }
+    QString dest = task.proxy;
+    if (dest.isEmpty()) {
+        if (!context->proxies || width < context->proxyMinSize) {
+            return true;
+        }
+        dest = ProxyStore::proxyPath(hash, context->proxyParams, context->proxyExtension);
+    }
+    if (QFile::exists(dest)) {
+        ProxyStore::markUsed(dest);
+        return true;
+    }
+    const QString partial = ProxyStore::partialPath(dest);
+    QString ffmpeg = KdenliveSettings::ffmpegpath();
+    if (ffmpeg.isEmpty()) {
+        ffmpeg = QStringLiteral("ffmpeg");
+    }
+    QProcess process;
+    process.start(ffmpeg, ProxyStore::encodeArguments(task.path, context->proxyParams, partial), QIODevice::ReadOnly);
+    if (!process.waitForStarted()) {
+        report(task.path, QStringLiteral("cannot start %1").arg(ffmpeg));
+        return false;
+    }
+    process.waitForFinished(-1);
+    bool ok = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0 && QFileInfo(partial).size() > 0;
+    if (ok) {
+        CacheIndex::removeFile(dest);
+        ok = QFile::rename(partial, dest);
+    }
+    QFile::remove(partial);
+    if (!ok) {
+        report(task.path, QStringLiteral("proxy encoding failed"));
+        return false;
+    }
+    CacheIndex::fileWritten(dest);
+    ProxyStore::markUsed(dest);
+    report(task.path, QStringLiteral("proxy written to %1").arg(dest));
+    return true;
+}
+
+bool CacheBuilder::buildAudioThumb(const Task &task, const QString &hash, Mlt::Producer &producer)
+{
+    const int audioIndex = producer.get_int("audio_index");
+    if (audioIndex < 0) {
+        return true;
+    }
+    AudioStreamInfo info(&producer, audioIndex);
+    // Same file name as ProjectClip::getAudioThumbPath
+    QString audioPath = task.context->audioFolder.absoluteFilePath(hash);
+    if (info.ffmpeg_audio_index() > 0) {
+        audioPath.append(QStringLiteral("_") + QString::number(info.audio_index()));
+    }
+    audioPath.append(QStringLiteral("_%1_audio.levels").arg((int) task.context->profile->fps()));
+    AudioLevels cachedLevels;
+    if (cachedLevels.load(audioPath)) {
+        return true;
+    }
+    int frequency = info.samplingRate();
+    if (frequency <= 0) frequency = 48000;
+    int channels = info.channels();
+    if (channels <= 0) channels = 2;
+    const int lengthInFrames = producer.get_length();
+    AudioPeakExtractor extractor(&producer, channels, frequency);
+    if (!extractor.isValid() || lengthInFrames <= 0) {
+        report(task.path, QStringLiteral("cannot decode audio"));
+        return false;
+    }
+    QByteArray levels(lengthInFrames * channels, 0);
+    while (extractor.position() < lengthInFrames) {
+        const int frames = qMin(AUDIO_BLOCK_FRAMES, lengthInFrames - extractor.position());
+        if (extractor.readBlock(levels.data() + extractor.position() * channels, frames) <= 0) {
+            break;
+        }
+    }
+    if (!AudioLevels(channels, levels).save(audioPath)) {
+        report(task.path, QStringLiteral("cannot write %1").arg(audioPath));
+        return false;
+    }
+    CacheIndex::fileWritten(audioPath);
+    report(task.path, QStringLiteral("audio thumbnail written"));
+    return true;
+}
+
+void CacheBuilder::buildThumbnails(const Task &task, const QString &hash, Mlt::Producer &producer)
+{
+    ThumbnailCache *cache = task.context->thumbnails;
+    const double dar = task.context->profile->dar();
+    const int width = THUMBNAIL_HEIGHT * dar + 0.5;
+    int written = 0;
+    foreach (int pos, task.thumbnailFrames) {
+        if (!cache->image(hash, pos, THUMBNAIL_HEIGHT).isNull()) {
+            continue;
+        }
+        producer.seek(pos);
+        Mlt::Frame *frame = producer.get_frame();
+        if (frame == NULL) {
+            continue;
+        }
+        frame->set("deinterlace_method", "onefield");
+        frame->set("top_field_first", -1);
+        QImage img = KThumb::getFrame(frame, width, THUMBNAIL_HEIGHT);
+        delete frame;
+        cache->insert(hash, pos, THUMBNAIL_HEIGHT, img);
+        written++;
+    }
+    if (written > 0) {
+        report(task.path, QStringLiteral("%1 thumbnails written").arg(written));
+    }
+}
+
+void CacheBuilder::report(const QString &path, const QString &message)
+{
+    QMutexLocker lock(&m_outputMutex);
+    QTextStream(stdout) << QFileInfo(path).fileName() << ": " << message << endl;
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef CACHEBUILDER_H
+#define CACHEBUILDER_H
+
+#include <QDir>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class ThumbnailCache;
+
+namespace Mlt
+{
+class Producer;
+class Profile;
+}
+
+/**
+ * @class CacheBuilder
+ * @brief Fills the caches of projects and media folders without starting the editor.
+ *
+ * Media files are processed in parallel, each one by a single thread: its probe results are stored
+ * in the probe cache, its proxy encoded in the proxy store and, for project clips, its audio levels
+ * and timeline thumbnails written to the project cache folder. The files are named and written like
+ * the editor does, so that opening the project afterwards finds everything already cached.
+ */
+class CacheBuilder
+{
+public:
+    enum CacheKind {
+        CacheProbe = 1,
+        CacheProxies = 2,
+        CacheAudioThumbs = 4,
+        CacheThumbnails = 8,
+        CacheAll = 15
+    };
+    /** @param kinds The CacheKind flags of the caches to fill
+     *  @param jobs The number of files processed at once */
+    CacheBuilder(int kinds, int jobs);
+    ~CacheBuilder();
+    /** @brief Queues the clips of a project file, returns false if it cannot be read. */
+    bool addProject(const QString &path, QString *error);
+    /** @brief Queues the media files of a folder. */
+    void addFolder(const QString &path, bool recursive);
+    /** @brief Number of queued media files. */
+    int count() const;
+    /** @brief Processes the queued files, returns the number of files that could not be cached. */
+    int run();
+
+private:
+    /** @brief Settings shared by the clips of one project, or by all the files of media folders. */
+    struct Context {
+        Context();
+        ~Context();
+        Mlt::Profile *profile;
+        /** @brief Project cache folders, not valid for media folders */
+        QDir audioFolder;
+        ThumbnailCache *thumbnails;
+        bool proxies;
+        QString proxyParams;
+        QString proxyExtension;
+        int proxyMinSize;
+    };
+    /** @brief One media file to cache. */
+    struct Task {
+        QString path;
+        /** @brief The kdenlive:file_hash of the clip, computed if empty */
+        QString hash;
+        QSharedPointer<Context> context;
+        /** @brief The kdenlive:proxy of the clip, "-" if proxies are disabled for it */
+        QString proxy;
+        /** @brief Frames shown as timeline thumbnails */
+        QList <int> thumbnailFrames;
+    };
+    int m_kinds;
+    int m_jobs;
+    QList <Task> m_tasks;
+    QSharedPointer<Context> m_folderContext;
+    QMutex m_outputMutex;
+    bool processTask(const Task &task);
+    bool buildProxy(const Task &task, const QString &hash, int width);
+    bool buildAudioThumb(const Task &task, const QString &hash, Mlt::Producer &producer);
+    void buildThumbnails(const Task &task, const QString &hash, Mlt::Producer &producer);
+    void report(const QString &path, const QString &message);
+};
+
+#endif
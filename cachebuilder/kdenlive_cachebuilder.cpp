@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "cachebuilder.h"
+
+#include <mlt++/Mlt.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    // Use the cache and configuration folders of the editor
+    app.setApplicationName(QStringLiteral("kdenlive"));
+    app.setOrganizationDomain(QStringLiteral("kde.org"));
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Fills the Kdenlive caches of projects and media folders: probe results, proxy clips, audio and timeline thumbnails."));
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"), QStringLiteral("Number of files processed at once."), QStringLiteral("count"), QString::number(QThread::idealThreadCount())));
+    parser.addOption(QCommandLineOption(QStringLiteral("no-probe"), QStringLiteral("Do not store the probe results of the clips.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("no-proxies"), QStringLiteral("Do not encode proxy clips.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("no-audio"), QStringLiteral("Do not extract audio thumbnails.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("no-thumbnails"), QStringLiteral("Do not create timeline thumbnails.")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("r") << QStringLiteral("recursive"), QStringLiteral("Also process the subfolders of media folders.")));
+    parser.addPositionalArgument(QStringLiteral("paths"), QStringLiteral("Project files (.kdenlive) or media folders."), QStringLiteral("paths..."));
+    parser.process(app);
+    const QStringList paths = parser.positionalArguments();
+    if (paths.isEmpty()) {
+        parser.showHelp(1);
+    }
+    int kinds = CacheBuilder::CacheAll;
+    if (parser.isSet(QStringLiteral("no-probe"))) kinds &= ~CacheBuilder::CacheProbe;
+    if (parser.isSet(QStringLiteral("no-proxies"))) kinds &= ~CacheBuilder::CacheProxies;
+    if (parser.isSet(QStringLiteral("no-audio"))) kinds &= ~CacheBuilder::CacheAudioThumbs;
+    if (parser.isSet(QStringLiteral("no-thumbnails"))) kinds &= ~CacheBuilder::CacheThumbnails;
+
+    Mlt::Factory::init();
+    QTextStream err(stderr);
+    CacheBuilder builder(kinds, parser.value(QStringLiteral("jobs")).toInt());
+    int errors = 0;
+    foreach (const QString &path, paths) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            builder.addFolder(info.absoluteFilePath(), parser.isSet(QStringLiteral("recursive")));
+            continue;
+        }
+        QString error;
+        if (!builder.addProject(info.absoluteFilePath(), &error)) {
+            err << error << endl;
+            errors++;
+        }
+    }
+    QTextStream(stdout) << "Processing " << builder.count() << " files" << endl;
+    errors += builder.run();
+    Mlt::Factory::close();
+    return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+import QtQuick 2.0
+
+Rectangle {
+    id: performanceHud
+    objectName: "performancehud"
+    property var lines: []
+    property bool warning: false
+    property int fontSize
+    width: hudText.contentWidth + 12
+    height: hudText.contentHeight + 8
+    color: Qt.rgba(0, 0, 0, 0.6)
+    radius: 4
+    border.color: warning ? "red" : Qt.rgba(1, 1, 1, 0.3)
+    border.width: 1
+
+    Text {
+        id: hudText
+        anchors.centerIn: parent
+        color: performanceHud.warning ? "#ff8080" : "white"
+        font.pixelSize: performanceHud.fontSize
+        text: performanceHud.lines.join("\n")
+    }
+}
@@ -17,11 +17,15 @@ Item {
     property double scaley
     property bool dropped
     property string fps
+    property string uploadtime
     property bool showMarkers
     property bool showTimecode
     property bool showFps
     property bool showSafezone
     property bool showAudiothumb
+    property bool showPerformance
+    property var performance: []
+    property bool performanceWarning
     property bool showToolbar: false
     property int displayFontSize
     onZoomChanged: {
@@ -106,6 +110,20 @@ Item {
         }
     }
 
+    PerformanceHud {
+        id: performanceHud
+        anchors {
+            right: parent.right
+            top: parent.top
+            topMargin: 10
+            rightMargin: 10
+        }
+        lines: root.performance
+        warning: root.performanceWarning
+        fontSize: root.displayFontSize
+        visible: root.showPerformance
+    }
+
     Text {
         id: timecode
         objectName: "timecode"
@@ -127,7 +145,7 @@ Item {
         color: root.dropped ? "red" : "white"
         style: Text.Outline;
         styleColor: "black"
-        text: root.fps + "fps"
+        text: root.fps + "fps" + (root.uploadtime == "" ? "" : " (" + root.uploadtime + "ms)")
         visible: root.showFps
         font.pixelSize: root.displayFontSize
         anchors {
@@ -23,6 +23,8 @@ Item {
     property var centerPoints: []
     onCenterPointsChanged: canvas.requestPaint()
     signal effectPolygonChanged()
+    // Emitted when a dragged point is released, the last change is then applied immediately
+    signal effectEditFinished()
     signal addKeyframe()
     signal seekToKeyframe()
 
@@ -149,6 +151,10 @@ Item {
             root.addKeyframe()
         }
 
+        onReleased: {
+            root.effectEditFinished()
+        }
+
         onPositionChanged: {
             if (root.iskeyframe == false) return;
             if (pressed && root.requestedKeyFrame >= 0) {
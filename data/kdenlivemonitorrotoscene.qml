@@ -29,6 +29,8 @@ Item {
     property var centerPointsTypes : []
     onCenterPointsTypesChanged: checkDefined()
     signal effectPolygonChanged()
+    // Emitted when a dragged point is released, the last change is then applied immediately
+    signal effectEditFinished()
     signal addKeyframe()
     signal seekToKeyframe()
 
@@ -207,6 +209,10 @@ Item {
             root.addKeyframe()
         }
 
+        onReleased: {
+            root.effectEditFinished()
+        }
+
         onPositionChanged: {
             if (root.iskeyframe == false) return;
             if (isDefined && pressed) {
@@ -36,7 +36,21 @@ QStringList SamplePlugin::generators(const QStringList &producers) const
 }
 
 
-QUrl SamplePlugin::generatedClip(const QString &renderer, const QString &generator, const QUrl &projectFolder, const QStringList &/*lumaNames*/, const QStringList &/*lumaFiles*/, const double fps, const int /*width*/, const int height)
+QUrl SamplePlugin::generatedClip(const QString &renderer, const QString &generator, const QUrl &projectFolder, const QStringList &/*lumaNames*/, const QStringList &/*lumaFiles*/, const double fps, const int width, const int height)
+{
+    GeneratorSettings settings;
+    if (!configureClip(generator, projectFolder, fps, width, height, settings)) {
+        return QUrl();
+    }
+    QString error;
+    QUrl result = renderClip(renderer, settings, NULL, &error);
+    if (result.isEmpty()) {
+        KMessageBox::sorry(QApplication::activeWindow(), i18n("Failed to generate clip:\n%1", error), i18n("Generator Failed"));
+    }
+    return result;
+}
+
+bool SamplePlugin::configureClip(const QString &generator, const QUrl &projectFolder, const double fps, const int width, const int height, GeneratorSettings &settings)
 {
     QString prePath;
     if (generator == i18n("Noise")) {
@@ -65,48 +79,84 @@ QUrl SamplePlugin::generatedClip(const QString &renderer, const QString &generat
 
     QString clipFile = prePath + counter + QLatin1String(".mlt");
     view.path->setUrl(QUrl(clipFile));
-    QUrl result;
-    
-    if (d->exec() == QDialog::Accepted) {
-        QProcess generatorProcess;
-
-        // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
-        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-        env.insert(QLatin1String("MLT_NO_VDPAU"), QLatin1String("1"));
-        generatorProcess.setProcessEnvironment(env);
-        QStringList args;
-        if (generator == i18n("Noise")) {
-            args << QLatin1String("noise:") << QLatin1String("in=0") << QLatin1String("out=") + QString::number((int) fps * view.duration->value());
-        }
-        else {
-            // Countdown producer
-            for (int i = 0; i < view.duration->value(); ++i) {
-                // Create the producers
-                args << QLatin1String("pango:") << QLatin1String("in=0") << QLatin1String("out=") + QString::number((int) fps * view.duration->value());
-                args << QLatin1String("text=") + QString::number(view.duration->value() - i);
-                args << QLatin1String("font=") + QString::number(view.font->value()) + QLatin1String("px");
-            }
+    bool accepted = d->exec() == QDialog::Accepted;
+    if (accepted) {
+        settings.generator = generator;
+        settings.destination = view.path->url();
+        settings.fps = fps;
+        settings.width = width;
+        settings.height = height;
+        settings.parameters.insert(QLatin1String("duration"), QString::number(view.duration->value()));
+        settings.parameters.insert(QLatin1String("font"), QString::number(view.font->value()));
+    }
+    delete d;
+    return accepted;
+}
+
+QMap <QString, QString> SamplePlugin::streamingProducer(const GeneratorSettings &settings) const
+{
+    QMap <QString, QString> producer;
+    if (settings.generator == i18n("Noise")) {
+        // Noise is a single MLT producer, no need to write a file
+        producer.insert(QLatin1String("mlt_service"), QLatin1String("noise"));
+        producer.insert(QLatin1String("in"), QLatin1String("0"));
+        producer.insert(QLatin1String("out"), QString::number((int) settings.fps * settings.parameters.value(QLatin1String("duration")).toInt()));
+    }
+    // The countdown is a playlist of pango producers and has to be rendered
+    return producer;
+}
+
+QUrl SamplePlugin::renderClip(const QString &renderer, const GeneratorSettings &settings, ClipGeneratorFeedback *feedback, QString *error)
+{
+    QProcess generatorProcess;
+
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QLatin1String("MLT_NO_VDPAU"), QLatin1String("1"));
+    generatorProcess.setProcessEnvironment(env);
+    int duration = settings.parameters.value(QLatin1String("duration")).toInt();
+    QStringList args;
+    if (settings.generator == i18n("Noise")) {
+        args << QLatin1String("noise:") << QLatin1String("in=0") << QLatin1String("out=") + QString::number((int) settings.fps * duration);
+    }
+    else {
+        // Countdown producer
+        for (int i = 0; i < duration; ++i) {
+            // Create the producers
+            args << QLatin1String("pango:") << QLatin1String("in=0") << QLatin1String("out=") + QString::number((int) settings.fps * duration);
+            args << QLatin1String("text=") + QString::number(duration - i);
+            args << QLatin1String("font=") + settings.parameters.value(QLatin1String("font")) + QLatin1String("px");
         }
+    }
 
-        args << QLatin1String("-consumer")<<QString::fromLatin1("xml:%1").arg(view.path->url().path());
-        generatorProcess.start(renderer, args);
-        if (generatorProcess.waitForFinished()) {
-            if (generatorProcess.exitStatus() == QProcess::CrashExit) {
-                //qDebug() << "/// Generator failed: ";
-                QString error = QString::fromLocal8Bit(generatorProcess.readAllStandardError());
-                KMessageBox::sorry(QApplication::activeWindow(), i18n("Failed to generate clip:\n%1", error), i18n("Generator Failed"));
-            }
-            else {
-                result = view.path->url();
-            }
-        } else {
-            //qDebug() << "/// Generator failed: ";
-            QString error = QString::fromLocal8Bit(generatorProcess.readAllStandardError());
-            KMessageBox::sorry(QApplication::activeWindow(), i18n("Failed to generate clip:\n%1", error), i18n("Generator Failed"));
+    args << QLatin1String("-progress") << QLatin1String("-consumer") << QString::fromLatin1("xml:%1").arg(settings.destination.path());
+    generatorProcess.start(renderer, args);
+    if (!generatorProcess.waitForStarted()) {
+        if (error) *error = generatorProcess.errorString();
+        return QUrl();
+    }
+    // Poll the process so that the job can follow the progress and be canceled
+    while (!generatorProcess.waitForFinished(500)) {
+        if (generatorProcess.state() != QProcess::Running) break;
+        if (feedback && feedback->isCanceled()) {
+            generatorProcess.kill();
+            generatorProcess.waitForFinished();
+            QFile::remove(settings.destination.path());
+            return QUrl();
+        }
+        QString log = QString::fromLocal8Bit(generatorProcess.readAllStandardError());
+        int ix = log.lastIndexOf(QLatin1String("percentage:"));
+        if (feedback && ix > -1) {
+            feedback->setProgress(log.mid(ix + 11).simplified().section(QLatin1Char(' '), 0, 0).toInt());
         }
     }
-    delete d;
-    return result;
+    if (generatorProcess.exitStatus() == QProcess::CrashExit || generatorProcess.exitCode() != 0) {
+        //qDebug() << "/// Generator failed: ";
+        if (error) *error = QString::fromLocal8Bit(generatorProcess.readAllStandardError());
+        return QUrl();
+    }
+    if (feedback) feedback->setProgress(100);
+    return settings.destination;
 }
 
 Q_EXPORT_PLUGIN2(kdenlive_sampleplugin, SamplePlugin)
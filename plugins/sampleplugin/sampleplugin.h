@@ -28,14 +28,17 @@
 
 #include "interfaces.h"
 
-class SamplePlugin : public QObject, public ClipGenerator
+class SamplePlugin : public QObject, public ClipGenerator, public AsyncClipGenerator
 {
     Q_OBJECT
-    Q_INTERFACES(ClipGenerator)
+    Q_INTERFACES(ClipGenerator AsyncClipGenerator)
 
 public:
     QStringList generators(const QStringList &producers = QStringList()) const;
     QUrl generatedClip(const QString &renderer, const QString &generator, const QUrl &projectFolder, const QStringList &lumaNames, const QStringList &lumaFiles, const double fps, const int width, const int height);
+    bool configureClip(const QString &generator, const QUrl &projectFolder, const double fps, const int width, const int height, GeneratorSettings &settings);
+    QMap <QString, QString> streamingProducer(const GeneratorSettings &settings) const;
+    QUrl renderClip(const QString &renderer, const GeneratorSettings &settings, ClipGeneratorFeedback *feedback, QString *error);
 };
 
 
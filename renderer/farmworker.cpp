@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "farmworker.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QSettings>
+#include <QDebug>
+
+// Delay between two scans of the farm folder (in ms)
+#define FARM_POLL_DELAY 2000
+
+FarmWorker::FarmWorker(const QString &folder, const QString &renderer, int jobs, const QString &pathMap) :
+    QObject(),
+    m_folder(folder),
+    m_prog(renderer),
+    m_maxJobs(qMax(1, jobs))
+{
+    if (!pathMap.isEmpty()) {
+        m_pathMap = readPathMap(pathMap);
+    }
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    m_timer.setInterval(FARM_POLL_DELAY);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(slotCheckQueue()));
+}
+
+FarmWorker::~FarmWorker()
+{
+    foreach(QProcess *process, m_processes) {
+        process->kill();
+        process->waitForFinished();
+    }
+    qDeleteAll(m_processes);
+}
+
+//static
+QString FarmWorker::taskFile(const QString &folder, const QString &task, const QString &state)
+{
+    return QDir(folder).absoluteFilePath(task + QLatin1Char('.') + state);
+}
+
+//static
+QString FarmWorker::taskName(const QString &jobId, int index)
+{
+    return QStringLiteral("%1.%2").arg(jobId).arg(index);
+}
+
+//static
+QString FarmWorker::abortFile(const QString &folder, const QString &jobId)
+{
+    return QDir(folder).absoluteFilePath(jobId + QStringLiteral(".abort"));
+}
+
+//static
+QList <QPair <QString, QString> > FarmWorker::readPathMap(const QString &path)
+{
+    QList <QPair <QString, QString> > map;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Cannot read path mapping file" << path;
+        return map;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+        if (line.startsWith(QLatin1Char('#')) || !line.contains(QLatin1Char('\t'))) {
+            continue;
+        }
+        map << qMakePair(line.section(QLatin1Char('\t'), 0, 0), line.section(QLatin1Char('\t'), 1));
+    }
+    return map;
+}
+
+void FarmWorker::start()
+{
+    if (!QFileInfo(m_folder).isDir()) {
+        qWarning() << "Render farm folder" << m_folder << "does not exist";
+        qApp->quit();
+        return;
+    }
+    qDebug() << "Waiting for render tasks in" << m_folder;
+    m_timer.start();
+    slotCheckQueue();
+}
+
+QString FarmWorker::mapPath(const QString &text) const
+{
+    QString result = text;
+    for (int i = 0; i < m_pathMap.count(); ++i) {
+        result.replace(m_pathMap.at(i).first, m_pathMap.at(i).second);
+    }
+    return result;
+}
+
+QString FarmWorker::localScene(const QString &scene)
+{
+    QFile source(QDir(m_folder).absoluteFilePath(scene));
+    const QString localPath = QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-farm-") + scene);
+    if (m_pathMap.isEmpty() || QFile::exists(localPath)) {
+        return m_pathMap.isEmpty() ? source.fileName() : localPath;
+    }
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    QString data = QString::fromUtf8(source.readAll());
+    source.close();
+    QFile local(localPath);
+    if (!local.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return QString();
+    }
+    local.write(mapPath(data).toUtf8());
+    local.close();
+    return localPath;
+}
+
+void FarmWorker::slotCheckQueue()
+{
+    // Stop the tasks of aborted jobs
+    QMapIterator<QString, QProcess *> i(m_processes);
+    while (i.hasNext()) {
+        i.next();
+        if (QFile::exists(abortFile(m_folder, i.key().section(QLatin1Char('.'), 0, -2)))) {
+            i.value()->kill();
+        }
+    }
+    while (m_processes.count() < m_maxJobs && startTask()) {
+    }
+}
+
+bool FarmWorker::startTask()
+{
+    QDir dir(m_folder);
+    const QStringList tasks = dir.entryList(QStringList() << QStringLiteral("*.task"), QDir::Files, QDir::Name);
+    foreach(const QString &file, tasks) {
+        const QString task = file.section(QLatin1Char('.'), 0, -2);
+        if (QFile::exists(abortFile(m_folder, task.section(QLatin1Char('.'), 0, -2)))) {
+            continue;
+        }
+        // Only one machine can succeed in renaming the task
+        if (!QFile::rename(dir.absoluteFilePath(file), taskFile(m_folder, task, QStringLiteral("claimed")))) {
+            continue;
+        }
+        QSettings settings(taskFile(m_folder, task, QStringLiteral("claimed")), QSettings::IniFormat);
+        const QString scene = localScene(settings.value(QStringLiteral("scene")).toString());
+        if (scene.isEmpty()) {
+            QFile::rename(taskFile(m_folder, task, QStringLiteral("claimed")), taskFile(m_folder, task, QStringLiteral("failed")));
+            continue;
+        }
+        const QString profile = mapPath(settings.value(QStringLiteral("profile")).toString());
+        QStringList args;
+        args << (settings.value(QStringLiteral("producerconsumer")).toBool() ? QStringLiteral("consumer:") + scene : scene);
+        args << QStringLiteral("in=") + settings.value(QStringLiteral("in")).toString();
+        args << QStringLiteral("out=") + settings.value(QStringLiteral("out")).toString();
+        foreach(const QString &arg, settings.value(QStringLiteral("preargs")).toStringList()) {
+            args << mapPath(arg);
+        }
+        if (settings.value(QStringLiteral("producerconsumer")).toBool()) {
+            args << QStringLiteral("profile=") + profile;
+        }
+        args << QStringLiteral("-profile") << profile;
+        args << QStringLiteral("-consumer") << settings.value(QStringLiteral("consumer")).toString() + QLatin1Char(':') + dir.absoluteFilePath(settings.value(QStringLiteral("output")).toString());
+        args << QStringLiteral("progress=1");
+        foreach(const QString &arg, settings.value(QStringLiteral("arguments")).toStringList()) {
+            args << mapPath(arg);
+        }
+        QProcess *process = new QProcess;
+        process->setReadChannel(QProcess::StandardError);
+        process->setProperty("task", task);
+        connect(process, SIGNAL(readyReadStandardError()), this, SLOT(receivedStderr()));
+        connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessFinished(int,QProcess::ExitStatus)));
+        m_processes.insert(task, process);
+        m_progress.insert(task, 0);
+        qDebug() << "Rendering task" << task;
+        process->start(m_prog, args);
+        return true;
+    }
+    return false;
+}
+
+void FarmWorker::receivedStderr()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    const QString task = process->property("task").toString();
+    QString result = QString::fromLocal8Bit(process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        return;
+    }
+    int pro = result.section(QLatin1Char(' '), -1).toInt();
+    if (pro <= m_progress.value(task) || pro > 100) return;
+    m_progress[task] = pro;
+    // The job that queued the task reads the progress from the shared folder
+    QFile progress(taskFile(m_folder, task, QStringLiteral("progress")));
+    if (progress.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        progress.write(QByteArray::number(pro));
+        progress.close();
+    }
+}
+
+void FarmWorker::slotProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    const QString task = process->property("task").toString();
+    const bool success = status == QProcess::NormalExit && exitCode == 0;
+    qDebug() << "Task" << task << (success ? "finished" : "failed");
+    QFile::remove(taskFile(m_folder, task, QStringLiteral("progress")));
+    QFile::rename(taskFile(m_folder, task, QStringLiteral("claimed")), taskFile(m_folder, task, success ? QStringLiteral("done") : QStringLiteral("failed")));
+    m_processes.remove(task);
+    m_progress.remove(task);
+    process->deleteLater();
+    // Remove the mapped scene once no task of this job is left
+    const QString jobId = task.section(QLatin1Char('.'), 0, -2);
+    bool jobRunning = false;
+    foreach(const QString &t, m_processes.keys()) {
+        if (t.startsWith(jobId + QLatin1Char('.'))) jobRunning = true;
+    }
+    if (!jobRunning && !m_pathMap.isEmpty()) {
+        QFile::remove(QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-farm-") + jobId + QStringLiteral(".mlt")));
+    }
+    slotCheckQueue();
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#ifndef FARMWORKER_H
+#define FARMWORKER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+#include <QMap>
+#include <QPair>
+
+/**
+ * @class FarmWorker
+ * @brief Renders the segment tasks queued in a render farm folder
+ *
+ * A segmented render in farm mode writes one task file per segment in a folder
+ * shared by all machines. Workers claim a task by renaming its file, which only
+ * succeeds for one of them, render it with their own melt and write the result
+ * and progress next to it. Media paths of the project are translated with a
+ * path mapping table, so that each machine can mount the media where it wants.
+ */
+
+class FarmWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Prepare a worker for the farm folder
+     *  @param jobs the maximum number of tasks rendered at the same time
+     *  @param pathMap file listing a local path prefix and the path to use on this machine, separated by a tab, on each line */
+    FarmWorker(const QString &folder, const QString &renderer, int jobs, const QString &pathMap = QString());
+    ~FarmWorker();
+
+    /** @brief Returns the file of a task in the given state, for example "task", "claimed", "progress", "done" or "failed" */
+    static QString taskFile(const QString &folder, const QString &task, const QString &state);
+    /** @brief Returns the name of the task file of a job's segment, without state */
+    static QString taskName(const QString &jobId, int index);
+    /** @brief Returns the file whose presence tells the workers to abort a job */
+    static QString abortFile(const QString &folder, const QString &jobId);
+    /** @brief Reads a path mapping file */
+    static QList <QPair <QString, QString> > readPathMap(const QString &path);
+
+public slots:
+    void start();
+
+private slots:
+    void slotCheckQueue();
+    void slotProcessFinished(int exitCode, QProcess::ExitStatus status);
+    void receivedStderr();
+
+private:
+    QString m_folder;
+    QString m_prog;
+    int m_maxJobs;
+    QList <QPair <QString, QString> > m_pathMap;
+    /** @brief The render processes by task name */
+    QMap <QString, QProcess *> m_processes;
+    QMap <QString, int> m_progress;
+    QTimer m_timer;
+    /** @brief Claim and start the next waiting task, returns false if there is none */
+    bool startTask();
+    /** @brief Apply the path mapping to a string */
+    QString mapPath(const QString &text) const;
+    /** @brief Writes the mapped copy of a job's scene in the temporary folder and returns its path */
+    QString localScene(const QString &scene);
+};
+
+#endif
@@ -22,8 +22,12 @@
 #include <QStringList>
 #include <QString>
 #include <QUrl>
+#include <QFile>
+#include <QTextStream>
 #include <QDebug>
 #include "renderjob.h"
+#include "segmentedrenderjob.h"
+#include "farmworker.h"
 
 int main(int argc, char **argv)
 {
@@ -31,6 +35,26 @@ int main(int argc, char **argv)
     QStringList args = app.arguments();
     QStringList preargs;
     QString locale;
+    if (args.count() >= 2 && args.at(1).startsWith(QLatin1String("-worker:"))) {
+        // Render farm worker, renders the tasks queued in the farm folder until killed
+        args.removeFirst();
+        const QString folder = args.takeFirst().section(QLatin1Char(':'), 1);
+        int jobs = 1;
+        QString pathMap;
+        QString melt = QStringLiteral("melt");
+        if (!args.isEmpty() && args.at(0).startsWith(QLatin1String("-jobs:"))) {
+            jobs = args.takeFirst().section(QLatin1Char(':'), 1).toInt();
+        }
+        if (!args.isEmpty() && args.at(0).startsWith(QLatin1String("-pathmap:"))) {
+            pathMap = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
+        if (!args.isEmpty() && args.at(0).startsWith(QLatin1String("-melt:"))) {
+            melt = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
+        FarmWorker worker(folder, melt, jobs, pathMap);
+        QMetaObject::invokeMethod(&worker, "start", Qt::QueuedConnection);
+        return app.exec();
+    }
     if (args.count() >= 7) {
         int pid = 0;
         int in = -1;
@@ -57,6 +81,54 @@ int main(int argc, char **argv)
             locale = QString(args.at(0)).section(QLatin1Char(':'), 1);
             args.removeFirst();
         }
+        bool statistics = false;
+        if (args.at(0) == QLatin1String("-stats")) {
+            statistics = true;
+            args.removeFirst();
+        }
+        QList <int> segments;
+        if (args.at(0).startsWith(QLatin1String("-segments:"))) {
+            foreach(const QString &pos, args.takeFirst().section(QLatin1Char(':'), 1).split(QLatin1Char(','), QString::SkipEmptyParts)) {
+                segments << pos.toInt();
+            }
+        }
+        int jobs = 1;
+        if (args.at(0).startsWith(QLatin1String("-jobs:"))) {
+            jobs = args.takeFirst().section(QLatin1Char(':'), 1).toInt();
+        }
+        QString ffmpeg;
+        if (args.at(0).startsWith(QLatin1String("-ffmpeg:"))) {
+            ffmpeg = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
+        QMap <int, QString> chunks;
+        if (args.at(0).startsWith(QLatin1String("-chunks:"))) {
+            // Each line holds the start frame of an already encoded segment and its file, separated by a tab
+            QFile chunkList(args.takeFirst().section(QLatin1Char(':'), 1));
+            if (chunkList.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                QTextStream stream(&chunkList);
+                stream.setCodec("UTF-8");
+                while (!stream.atEnd()) {
+                    QString line = stream.readLine();
+                    if (line.contains(QLatin1Char('\t'))) {
+                        chunks.insert(line.section(QLatin1Char('\t'), 0, 0).toInt(), line.section(QLatin1Char('\t'), 1));
+                    }
+                }
+                chunkList.close();
+                if (erase) chunkList.remove();
+            }
+        }
+        QString farm;
+        if (args.at(0).startsWith(QLatin1String("-farm:"))) {
+            farm = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
+        QString passthrough;
+        if (args.at(0).startsWith(QLatin1String("-passthrough:"))) {
+            passthrough = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
+        QString multi;
+        if (args.at(0).startsWith(QLatin1String("-multi:"))) {
+            multi = args.takeFirst().section(QLatin1Char(':'), 1);
+        }
         if (args.at(0).startsWith(QLatin1String("in=")))
             in = args.takeFirst().section(QLatin1Char('='), -1).toInt();
         if (args.at(0).startsWith(QLatin1String("out=")))
@@ -108,9 +180,31 @@ int main(int argc, char **argv)
             }
         }
 
+        if ((segments.count() > 2 || (segments.count() == 2 && (!chunks.isEmpty() || !passthrough.isEmpty()))) && !dualpass && !ffmpeg.isEmpty()) {
+            // Render the segments concurrently, then join them
+            qDebug() << "//STARTING SEGMENTED RENDERING: " << segments << ',' << jobs << ',' << src << ',' << dest << ',' << args;
+            SegmentedRenderJob *job = new SegmentedRenderJob(erase, pid, render, profile, rendermodule, player, src, dest, preargs, args, segments, jobs, ffmpeg, chunks, farm);
+            if (!passthrough.isEmpty()) {
+                job->setPassthroughZones(passthrough);
+                if (erase) QFile::remove(passthrough);
+            }
+            if (!locale.isEmpty()) qputenv("LC_NUMERIC", locale.toUtf8().constData());
+            QMetaObject::invokeMethod(job, "start", Qt::QueuedConnection);
+            app.exec();
+            delete job;
+            return 0;
+        }
+        QString multiProperties;
+        if (!multi.isEmpty() && !dualpass) {
+            // Feed all outputs from the same producer through MLT's multi consumer
+            multiProperties = RenderJob::writeMultiConsumer(multi, rendermodule, dest, args);
+            if (erase) QFile::remove(multi);
+        }
         qDebug() << "//STARTING RENDERING: " << erase << ',' << usekuiserver << ',' << render << ',' << profile << ',' << rendermodule << ',' << player << ',' << src << ',' << dest << ',' << preargs << ',' << args << ',' << in << ',' << out ;
         RenderJob *job = new RenderJob(doerase, usekuiserver, pid, render, profile, rendermodule, player, src, dest, preargs, args, in, out);
         if (!locale.isEmpty()) job->setLocale(locale);
+        if (!multiProperties.isEmpty()) job->setMultiConsumer(multiProperties);
+        if (statistics) job->enableStatistics();
         job->start();
         RenderJob *dualjob = NULL;
         if (dualpass) {
@@ -118,16 +212,25 @@ int main(int argc, char **argv)
                 args.replaceInStrings(QRegExp(QLatin1String("^vpre=.*")),QStringLiteral("vpre=%1").arg(vprelist.at(1)));
             args.replace(args.indexOf(QStringLiteral("pass=1")), QStringLiteral("pass=2"));
             dualjob = new RenderJob(erase, usekuiserver, pid, render, profile, rendermodule, player, src, dest, preargs, args, in, out);
+            if (statistics) dualjob->enableStatistics();
             QObject::connect(job, SIGNAL(renderingFinished()), dualjob, SLOT(start()));
         }
         app.exec();
         if (dualjob) delete dualjob;
     } else {
         fprintf(stderr, "Kdenlive video renderer for MLT.\nUsage: "
-                "kdenlive_render [-erase] [-kuiserver] [-locale:LOCALE] [in=pos] [out=pos] [render] [profile] [rendermodule] [player] [src] [dest] [[arg1] [arg2] ...]\n"
+                "kdenlive_render [-erase] [-kuiserver] [-locale:LOCALE] [-stats] [-segments:pos,pos,...] [-jobs:N] [-ffmpeg:PATH] [-chunks:FILE] [-farm:DIR] [-passthrough:FILE] [-multi:FILE] [in=pos] [out=pos] [render] [profile] [rendermodule] [player] [src] [dest] [[arg1] [arg2] ...]\n"
                 "  -erase: if that parameter is present, src file will be erased at the end\n"
                 "  -kuiserver: if that parameter is present, use KDE job tracker\n"
                 "  -locale:LOCALE : set a locale for rendering. For example, -locale:fr_FR.UTF-8 will use a french locale (comma as numeric separator)\n"
+                "  -stats : write the render speed and CPU usage samples to dest.stats\n"
+                "  -segments:pos,pos,... : render the video as separate segments starting at these frames, the last position is the end of the zone\n"
+                "  -jobs:N : number of segments rendered at the same time\n"
+                "  -ffmpeg:PATH : FFmpeg executable used to join the segments without re-encoding\n"
+                "  -chunks:FILE : list of already encoded segments to copy instead of rendering them, one 'frame<tab>file' per line\n"
+                "  -farm:DIR : queue the segments in this folder so that render farm workers can render them\n"
+                "  -passthrough:FILE : zones whose video is copied from the source file between keyframes, one 'start<tab>end<tab>source frame<tab>fps<tab>file' per line\n"
+                "  -multi:FILE : also encode the outputs listed in FILE from the same render, one 'dest<tab>args' per line\n"
                 "  in=pos: start rendering at frame pos\n"
                 "  out=pos: end rendering at frame pos\n"
                 "  render: path to MLT melt renderer\n"
@@ -136,7 +239,12 @@ int main(int argc, char **argv)
                 "  player: path to video player to play when rendering is over, use '-' to disable playing\n"
                 "  src: source file (usually MLT XML)\n"
                 "  dest: destination file\n"
-                "  args: space separated libavformat arguments\n");
+                "  args: space separated libavformat arguments\n"
+                "\nRender farm worker: kdenlive_render -worker:DIR [-jobs:N] [-pathmap:FILE] [-melt:PATH]\n"
+                "  -worker:DIR : render the segments queued in this shared folder until stopped\n"
+                "  -jobs:N : number of segments rendered at the same time\n"
+                "  -pathmap:FILE : replace media paths, each line holds a path prefix and its replacement on this machine separated by a tab\n"
+                "  -melt:PATH : path to MLT melt renderer, defaults to melt\n");
     }
 }
 
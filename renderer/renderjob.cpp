@@ -24,6 +24,14 @@
 #include <QFile>
 #include <QThread>
 #include <QStringList>
+#include <QTextStream>
+#include <QPair>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+// Minimum delay between two render speed samples (in ms)
+#define STATS_INTERVAL 1000
 
 // Can't believe I need to do this to sleep.
 class SleepThread : QThread
@@ -51,7 +59,9 @@ RenderJob::RenderJob(bool erase, bool usekuiserver, int pid, const QString& rend
     m_seconds(0),
     m_frame(0),
     m_pid(pid),
-    m_dualpass(false)
+    m_dualpass(false),
+    m_statsFrame(-1),
+    m_statsCpu(0)
 {
     m_renderProcess = new QProcess;
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -91,6 +101,125 @@ void RenderJob::setLocale(const QString &locale)
     qputenv("LC_NUMERIC", locale.toUtf8().constData());
 }
 
+void RenderJob::enableStatistics()
+{
+    m_statsFile.setFileName(m_dest + QStringLiteral(".stats"));
+    const bool append = m_args.contains(QStringLiteral("pass=2"));
+    if (!m_statsFile.open(QIODevice::WriteOnly | QIODevice::Text | (append ? QIODevice::Append : QIODevice::Truncate))) {
+        qWarning() << "Unable to write render statistics to " << m_statsFile.fileName();
+        return;
+    }
+    m_statsStream.setDevice(&m_statsFile);
+    if (!append) {
+        m_statsStream << "# elapsed_ms\tframe\tfps\tcpu_percent\tpass" << endl;
+    }
+}
+
+qint64 RenderJob::processCpuTime() const
+{
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/%1/stat").arg(m_renderProcess->processId()));
+    if (!stat.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    // The fields following the command name, which may contain spaces
+    const QStringList fields = QString::fromLatin1(stat.readAll()).section(QLatin1Char(')'), -1).split(QLatin1Char(' '), QString::SkipEmptyParts);
+    stat.close();
+    if (fields.count() < 13) {
+        return -1;
+    }
+    // utime and stime, in clock ticks
+    qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+    return ticks * 1000 / sysconf(_SC_CLK_TCK);
+#else
+    return -1;
+#endif
+}
+
+void RenderJob::updateStatistics(int frame)
+{
+    if (m_statsFrame < 0) {
+        m_statsTime.start();
+        m_statsFrame = frame;
+        m_statsCpu = processCpuTime();
+        return;
+    }
+    const int elapsed = m_statsTime.elapsed();
+    if (elapsed < STATS_INTERVAL || frame <= m_statsFrame) {
+        return;
+    }
+    const double fps = (frame - m_statsFrame) * 1000.0 / elapsed;
+    const qint64 cpu = processCpuTime();
+    // Share of one core used by melt, above 100 when several threads are busy
+    int cpuLoad = -1;
+    if (cpu >= 0 && m_statsCpu >= 0) {
+        cpuLoad = (cpu - m_statsCpu) * 100 / elapsed;
+    }
+    m_statsTime.restart();
+    m_statsFrame = frame;
+    m_statsCpu = cpu;
+    if (m_statsFile.isOpen()) {
+        const int pass = m_args.contains(QStringLiteral("pass=2")) ? 2 : 1;
+        m_statsStream << m_startTime.msecsTo(QTime::currentTime()) << '\t' << frame << '\t' << QString::number(fps, 'f', 2) << '\t' << cpuLoad << '\t' << pass << endl;
+    }
+    if (m_kdenliveinterface && m_kdenliveinterface->isValid()) {
+        QList<QVariant> args;
+        args << m_dest << fps << cpuLoad;
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingSpeed"), args);
+    }
+}
+
+void RenderJob::setMultiConsumer(const QString &properties)
+{
+    int ix = m_args.indexOf(QStringLiteral("-consumer"));
+    if (ix < 0 || ix + 1 >= m_args.count()) return;
+    m_multiProperties = properties;
+    // The encoding parameters of every output are in the properties file
+    m_args = m_args.mid(0, ix + 1);
+    m_args << QStringLiteral("multi:") + properties << QStringLiteral("progress=1");
+}
+
+//static
+QString RenderJob::writeMultiConsumer(const QString &outputList, const QString &rendermodule, const QString &dest, const QStringList &args)
+{
+    QList <QPair <QString, QStringList> > outputs;
+    outputs << qMakePair(dest, args);
+    QFile list(outputList);
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    QTextStream stream(&list);
+    stream.setCodec("UTF-8");
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+        if (line.contains(QLatin1Char('\t'))) {
+            outputs << qMakePair(line.section(QLatin1Char('\t'), 0, 0), line.section(QLatin1Char('\t'), 1).split(QLatin1Char(' '), QString::SkipEmptyParts));
+        }
+    }
+    list.close();
+    QFile properties(dest + QStringLiteral(".multi.properties"));
+    if (outputs.count() < 2 || !properties.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return QString();
+    }
+    QTextStream out(&properties);
+    out.setCodec("UTF-8");
+    for (int i = 0; i < outputs.count(); ++i) {
+        out << i << '=' << rendermodule << '\n';
+        out << i << ".target=" << outputs.at(i).first << '\n';
+        foreach(const QString &arg, outputs.at(i).second) {
+            QString name = arg.section(QLatin1Char('='), 0, 0);
+            QString value = arg.section(QLatin1Char('='), 1);
+            if (name.isEmpty() || name == QLatin1String("progress")) continue;
+            if (value.startsWith(QLatin1Char('\"')) && value.endsWith(QLatin1Char('\"')) && value.length() > 1) {
+                value = value.mid(1, value.length() - 2);
+            }
+            out << i << '.' << name << '=' << value << '\n';
+        }
+    }
+    properties.close();
+    return properties.fileName();
+}
+
 void RenderJob::slotAbort(const QString& url)
 {
     if (m_dest == url) slotAbort();
@@ -108,6 +237,7 @@ void RenderJob::slotAbort()
     }
     if (m_jobUiserver) m_jobUiserver->call(QStringLiteral("terminate"), QString());
     if (m_erase) QFile(m_scenelist).remove();
+    if (!m_multiProperties.isEmpty()) QFile(m_multiProperties).remove();
     QFile(m_dest).remove();
     m_logstream << "Job aborted by user" << endl;
     m_logstream.flush();
@@ -122,6 +252,7 @@ void RenderJob::receivedStderr()
         m_errorMessage.append(result + QStringLiteral("<br>"));
     } else {
         m_logstream << "melt: " << result << endl;
+        updateStatistics(result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt());
         int pro = result.section(QLatin1Char(' '), -1).toInt();
         if (pro <= m_progress || pro <= 0 || pro > 100) return;
         m_progress = pro;
@@ -196,6 +327,7 @@ void RenderJob::start()
 
     // Because of the logging, we connect to stderr in all cases.
     connect(m_renderProcess, SIGNAL(readyReadStandardError()), this, SLOT(receivedStderr()));
+    if (!m_jobUiserver) m_startTime = QTime::currentTime();
     m_renderProcess->start(m_prog, m_args);
     m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QStringLiteral(" ")) << endl;
 }
@@ -262,6 +394,7 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
         qApp->quit();
     }
     if (m_erase) QFile(m_scenelist).remove();
+    if (!m_multiProperties.isEmpty()) QFile(m_multiProperties).remove();
     if (status == QProcess::CrashExit || m_renderProcess->error() != QProcess::UnknownError || m_renderProcess->exitCode() != 0) {
         // rendering crashed
         if (m_kdenliveinterface) {
@@ -37,6 +37,13 @@ public:
     RenderJob(bool erase, bool usekuiserver, int pid, const QString& renderer, const QString& profile, const QString& rendermodule, const QString& player, const QString& scenelist, const QString& dest, const QStringList& preargs, const QStringList& args, int in = -1, int out = -1);
     ~RenderJob();
     void setLocale(const QString &locale);
+    /** @brief Render through MLT's multi consumer described in the properties file instead of a single consumer */
+    void setMultiConsumer(const QString &properties);
+    /** @brief Write the render speed samples to a tab separated file next to the destination */
+    void enableStatistics();
+    /** @brief Write the multi consumer properties for the main output and the outputs listed in the file
+     *  @return the properties file, or an empty string on error */
+    static QString writeMultiConsumer(const QString &outputList, const QString &rendermodule, const QString &dest, const QStringList &args);
 
 public slots:
     void start();
@@ -70,6 +77,18 @@ private:
     QList<QVariant> m_dbusargs;
     QTime m_startTime;
     QStringList m_args;
+    /** @brief Properties file of the multi consumer, empty for a single output */
+    QString m_multiProperties;
+    /** @brief Render speed measurement, updated about once per second */
+    QTime m_statsTime;
+    int m_statsFrame;
+    qint64 m_statsCpu;
+    QFile m_statsFile;
+    QTextStream m_statsStream;
+    /** @brief Measure the render speed and CPU usage of melt since the last sample and report them */
+    void updateStatistics(int frame);
+    /** @brief Returns the CPU time used by the melt process in ms, or -1 if unknown */
+    qint64 processCpuTime() const;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
     void initKdenliveDbusInterface();
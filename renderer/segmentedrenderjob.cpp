@@ -0,0 +1,609 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "segmentedrenderjob.h"
+#include "farmworker.h"
+
+#include <QtDBus>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDir>
+#include <QDateTime>
+#include <QSettings>
+#include <QDebug>
+
+// Share of the progress given to the audio pass, which is much faster than the video encoding
+#define AUDIO_PASS_WEIGHT 0.1
+
+// Minimum length of a zone copied from its source file (in seconds)
+#define MIN_PASSTHROUGH_LENGTH 2
+
+// Delay between two checks of the tasks rendered by farm workers (in ms)
+#define FARM_POLL_DELAY 2000
+
+SegmentedRenderJob::SegmentedRenderJob(bool erase, int pid, const QString& renderer, const QString& profile, const QString& rendermodule, const QString& player, const QString& scenelist, const QString& dest, const QStringList& preargs, const QStringList& args, const QList <int> &boundaries, int jobs, const QString &ffmpeg, const QMap <int, QString> &chunks, const QString &farm) :
+    QObject(),
+    m_scenelist(scenelist),
+    m_dest(dest),
+    m_prog(renderer),
+    m_profile(profile),
+    m_rendermodule(rendermodule),
+    m_player(player),
+    m_ffmpeg(ffmpeg),
+    m_preargs(preargs),
+    m_args(args),
+    m_boundaries(boundaries),
+    m_chunks(chunks),
+    m_farm(farm),
+    m_maxJobs(qMax(1, jobs)),
+    m_erase(erase),
+    m_pid(pid),
+    m_nextProcess(0),
+    m_reported(0),
+    m_aborted(false),
+    m_kdenliveinterface(NULL),
+    m_logfile(dest + ".txt")
+{
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    m_hasAudio = !args.contains(QStringLiteral("an=1")) && !args.contains(QStringLiteral("audio_off=1"));
+    // Farm workers write the segments in the shared folder
+    m_outputBase = m_dest;
+    if (!m_farm.isEmpty()) {
+        m_jobId = QStringLiteral("%1-%2").arg(QCoreApplication::applicationPid()).arg(QDateTime::currentMSecsSinceEpoch());
+        m_outputBase = QDir(m_farm).absoluteFilePath(m_jobId);
+        m_farmTimer.setInterval(FARM_POLL_DELAY);
+        connect(&m_farmTimer, SIGNAL(timeout()), this, SLOT(slotCheckFarm()));
+    }
+    buildOutputs();
+    // Create a log of every render process.
+    if (!m_logfile.open(QIODevice::WriteOnly|QIODevice::Text)) qWarning() << "Unable to log to " << m_logfile.fileName();
+    else m_logstream.setDevice(&m_logfile);
+}
+
+void SegmentedRenderJob::buildOutputs()
+{
+    const QString suffix = QFileInfo(m_dest).suffix();
+    m_outputs.clear();
+    for (int i = 0; i < m_boundaries.count() - 1; ++i) {
+        if (m_chunks.contains(m_boundaries.at(i))) {
+            m_outputs << m_chunks.value(m_boundaries.at(i));
+        } else {
+            m_outputs << m_outputBase + QStringLiteral(".part%1.").arg(i + 1) + suffix;
+        }
+    }
+    if (m_hasAudio) {
+        m_outputs << m_outputBase + QStringLiteral(".audio.") + suffix;
+    }
+}
+
+void SegmentedRenderJob::setPassthroughZones(const QString &zoneList)
+{
+    QFile file(zoneList);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    while (!stream.atEnd()) {
+        const QStringList fields = stream.readLine().split(QLatin1Char('\t'));
+        if (fields.count() == 5) {
+            m_passthrough << fields;
+        }
+    }
+    file.close();
+}
+
+QList <double> SegmentedRenderJob::probeKeyframes(const QString &url, double start, double end, double &startTime) const
+{
+    QList <double> keyframes;
+    QString ffprobe = QFileInfo(m_ffmpeg).absolutePath() + QStringLiteral("/ffprobe");
+#ifdef Q_OS_WIN
+    ffprobe.append(QStringLiteral(".exe"));
+#endif
+    if (!QFile::exists(ffprobe)) {
+        return keyframes;
+    }
+    // MLT counts frames from the start time of the file
+    QProcess probe;
+    probe.start(ffprobe, QStringList() << QStringLiteral("-v") << QStringLiteral("error") << QStringLiteral("-select_streams") << QStringLiteral("v:0") << QStringLiteral("-show_entries") << QStringLiteral("stream=start_time") << QStringLiteral("-of") << QStringLiteral("csv=p=0") << url);
+    if (!probe.waitForFinished(30000) || probe.exitCode() != 0) {
+        return keyframes;
+    }
+    startTime = QString::fromLatin1(probe.readAllStandardOutput()).trimmed().toDouble();
+    probe.start(ffprobe, QStringList() << QStringLiteral("-v") << QStringLiteral("error") << QStringLiteral("-select_streams") << QStringLiteral("v:0") << QStringLiteral("-skip_frame") << QStringLiteral("nokey") << QStringLiteral("-read_intervals") << QStringLiteral("%1%%2").arg(startTime + start).arg(startTime + end) << QStringLiteral("-show_entries") << QStringLiteral("frame=best_effort_timestamp_time") << QStringLiteral("-of") << QStringLiteral("csv=p=0") << url);
+    if (!probe.waitForFinished(120000) || probe.exitCode() != 0) {
+        return keyframes;
+    }
+    const QStringList lines = QString::fromLatin1(probe.readAllStandardOutput()).split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    foreach(const QString &line, lines) {
+        bool ok;
+        double time = line.trimmed().toDouble(&ok);
+        if (ok) keyframes << time - startTime;
+    }
+    return keyframes;
+}
+
+void SegmentedRenderJob::addPassthroughSegments()
+{
+    foreach(const QStringList &zone, m_passthrough) {
+        // start, end, source frame at start, fps and file of the zone
+        const int start = qMax(m_boundaries.first(), zone.at(0).toInt());
+        const int end = qMin(m_boundaries.last(), zone.at(1).toInt());
+        const double fps = zone.at(3).toDouble();
+        const int sourceIn = zone.at(2).toInt() + start - zone.at(0).toInt();
+        if (end - start < fps * MIN_PASSTHROUGH_LENGTH || fps <= 0) {
+            continue;
+        }
+        double startTime = 0;
+        const QList <double> keyframes = probeKeyframes(zone.at(4), sourceIn / fps, (sourceIn + end - start) / fps, startTime);
+        // Only whole GOPs can be copied, the partial ones at the cut points are encoded
+        int first = -1;
+        int last = -1;
+        foreach(double time, keyframes) {
+            int frame = qRound(time * fps);
+            if (frame < sourceIn || frame > sourceIn + end - start) continue;
+            if (first < 0) first = frame;
+            last = frame;
+        }
+        if (first < 0 || last - first < fps * MIN_PASSTHROUGH_LENGTH) {
+            continue;
+        }
+        const int copyStart = start + first - sourceIn;
+        const int copyEnd = start + last - sourceIn;
+        bool overlaps = false;
+        foreach(int pos, m_copies.keys()) {
+            if (pos < copyEnd && m_copies.value(pos).at(2).toInt() > copyStart) overlaps = true;
+        }
+        if (overlaps) continue;
+        // Drop the segment boundaries inside the copied range
+        for (int i = m_boundaries.count() - 2; i > 0; --i) {
+            if (m_boundaries.at(i) > copyStart && m_boundaries.at(i) < copyEnd) m_boundaries.removeAt(i);
+        }
+        if (!m_boundaries.contains(copyStart)) m_boundaries << copyStart;
+        if (!m_boundaries.contains(copyEnd)) m_boundaries << copyEnd;
+        qSort(m_boundaries);
+        // Seeking a quarter of frame after the keyframe makes sure rounding cannot select the previous one
+        m_copies.insert(copyStart, QStringList() << zone.at(4) << QString::number(startTime + (first + 0.25) / fps, 'f', 6) << QString::number(copyEnd) << QString::number(last - first));
+        m_logstream << "Copying frames " << copyStart << " to " << copyEnd - 1 << " from " << zone.at(4) << endl;
+    }
+    buildOutputs();
+}
+
+SegmentedRenderJob::~SegmentedRenderJob()
+{
+    qDeleteAll(m_processes);
+    m_logfile.close();
+}
+
+void SegmentedRenderJob::start()
+{
+    initKdenliveDbusInterface();
+    QFileInfo checkDestination(QFileInfo(m_dest).absolutePath());
+    if (!checkDestination.isWritable()) {
+        QString error = tr("Cannot write to %1, check permissions.").arg(m_dest);
+        QProcess::startDetached(QStringLiteral("kdialog"), QStringList() << QStringLiteral("--error") << error);
+        finish(-2, error);
+        return;
+    }
+    if (!m_passthrough.isEmpty()) {
+        addPassthroughSegments();
+    }
+    const int segments = m_boundaries.count() - 1;
+    bool rendering = false;
+    for (int i = 0; i < m_outputs.count(); ++i) {
+        // Video segments are rendered without audio, the audio pass covers the whole zone without video
+        bool audioPass = i == segments;
+        if (!audioPass && m_chunks.contains(m_boundaries.at(i))) {
+            // Copied from an existing chunk
+            m_processes << NULL;
+            m_progress << 100;
+            continue;
+        }
+        rendering = true;
+        if (!audioPass && m_copies.contains(m_boundaries.at(i))) {
+            // Stream copy of the source packets
+            const QStringList copy = m_copies.value(m_boundaries.at(i));
+            QStringList args;
+            args << QStringLiteral("-y") << QStringLiteral("-v") << QStringLiteral("error");
+            args << QStringLiteral("-ss") << copy.at(1) << QStringLiteral("-i") << copy.at(0);
+            args << QStringLiteral("-map") << QStringLiteral("0:v:0") << QStringLiteral("-frames:v") << copy.at(3) << QStringLiteral("-c:v") << QStringLiteral("copy") << QStringLiteral("-an");
+            args << QStringLiteral("-avoid_negative_ts") << QStringLiteral("make_zero") << m_outputs.at(i);
+            QProcess *process = new QProcess;
+            process->setProcessChannelMode(QProcess::MergedChannels);
+            process->setProperty("program", m_ffmpeg);
+            process->setProperty("arguments", args);
+            connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessFinished(int,QProcess::ExitStatus)));
+            m_processes << process;
+            m_progress << 0;
+            continue;
+        }
+        QStringList args;
+        args << m_scenelist;
+        args << QStringLiteral("in=") + QString::number(audioPass ? m_boundaries.first() : m_boundaries.at(i));
+        args << QStringLiteral("out=") + QString::number((audioPass ? m_boundaries.last() : m_boundaries.at(i + 1)) - 1);
+        args << m_preargs;
+        if (m_scenelist.startsWith(QLatin1String("consumer:"))) {
+            // Use MLT's producer_consumer, safer to pass profile in an explicit way
+            args << QStringLiteral("profile=") + m_profile;
+        }
+        args << QStringLiteral("-profile") << m_profile;
+        args << QStringLiteral("-consumer") << m_rendermodule + QLatin1Char(':') + m_outputs.at(i) << QStringLiteral("progress=1") << m_args;
+        if (audioPass) {
+            args << QStringLiteral("vn=1") << QStringLiteral("video_off=1");
+        } else {
+            args << QStringLiteral("an=1") << QStringLiteral("audio_off=1");
+        }
+        QProcess *process = new QProcess;
+        process->setReadChannel(QProcess::StandardError);
+        process->setProperty("arguments", args);
+        connect(process, SIGNAL(readyReadStandardError()), this, SLOT(receivedStderr()));
+        connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessFinished(int,QProcess::ExitStatus)));
+        m_processes << process;
+        m_progress << 0;
+    }
+    for (int i = 0; i < m_processes.count(); ++i) {
+        m_remote << false;
+    }
+    if (!rendering) {
+        // All segments are already encoded
+        concatenate();
+        return;
+    }
+    if (!m_farm.isEmpty()) {
+        if (!queueFarmTasks()) {
+            finish(-2, tr("Cannot write to %1, check permissions.").arg(m_farm));
+            return;
+        }
+        m_farmTimer.start();
+    }
+    startProcesses();
+}
+
+void SegmentedRenderJob::startProcesses()
+{
+    int running = 0;
+    for (int i = 0; i < m_nextProcess; ++i) {
+        if (m_processes.at(i) && m_processes.at(i)->state() != QProcess::NotRunning) running++;
+    }
+    while (running < m_maxJobs && m_nextProcess < m_processes.count()) {
+        QProcess *process = m_processes.at(m_nextProcess);
+        if (process == NULL) {
+            m_nextProcess++;
+            continue;
+        }
+        const QString program = process->property("program").toString();
+        if (!m_farm.isEmpty() && program.isEmpty()) {
+            const QString task = FarmWorker::taskName(m_jobId, m_nextProcess);
+            if (!QFile::rename(FarmWorker::taskFile(m_farm, task, QStringLiteral("task")), FarmWorker::taskFile(m_farm, task, QStringLiteral("claimed")))) {
+                // A farm worker is rendering this segment
+                m_remote[m_nextProcess] = true;
+                m_logstream << "Segment " << m_nextProcess << " rendered by the farm" << endl;
+                m_nextProcess++;
+                continue;
+            }
+        }
+        QStringList args = process->property("arguments").toStringList();
+        process->start(program.isEmpty() ? m_prog : program, args);
+        m_logstream << "Started render process: " << (program.isEmpty() ? m_prog : program) << ' ' << args.join(QStringLiteral(" ")) << endl;
+        m_nextProcess++;
+        running++;
+    }
+}
+
+void SegmentedRenderJob::receivedStderr()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    int ix = m_processes.indexOf(process);
+    if (ix < 0) return;
+    QString result = QString::fromLocal8Bit(process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        return;
+    }
+    m_logstream << "melt: " << result << endl;
+    updateProgress(ix, result.section(QLatin1Char(' '), -1).toInt());
+}
+
+void SegmentedRenderJob::updateProgress(int ix, int pro)
+{
+    if (pro <= m_progress.at(ix) || pro > 100) return;
+    m_progress[ix] = pro;
+    // Weight each process by the number of frames it renders
+    const int segments = m_boundaries.count() - 1;
+    const double total = m_boundaries.last() - m_boundaries.first();
+    double done = 0;
+    double weights = 0;
+    for (int i = 0; i < m_progress.count(); ++i) {
+        double weight = i < segments ? m_boundaries.at(i + 1) - m_boundaries.at(i) : total * AUDIO_PASS_WEIGHT;
+        done += weight * m_progress.at(i);
+        weights += weight;
+    }
+    // Keep the last percent for the concatenation
+    int progress = qMin(99, (int) (done / weights));
+    if (progress <= m_reported) return;
+    m_reported = progress;
+    if (m_kdenliveinterface && m_kdenliveinterface->isValid()) {
+        m_dbusargs[1] = m_reported;
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), m_dbusargs);
+    }
+}
+
+void SegmentedRenderJob::slotProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    if (m_aborted) return;
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        fail();
+        return;
+    }
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (!process->property("program").isNull()) {
+        // Stream copies do not report their progress
+        updateProgress(m_processes.indexOf(process), 100);
+    } else if (!m_farm.isEmpty()) {
+        QFile::remove(FarmWorker::taskFile(m_farm, FarmWorker::taskName(m_jobId, m_processes.indexOf(process)), QStringLiteral("claimed")));
+    }
+    // Start the next segment
+    startProcesses();
+    if (renderingFinished()) {
+        m_farmTimer.stop();
+        concatenate();
+    }
+}
+
+void SegmentedRenderJob::fail()
+{
+    // One segment failed, the other ones are useless
+    m_aborted = true;
+    foreach(QProcess *p, m_processes) {
+        if (p) p->kill();
+    }
+    QString error = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+    m_logstream << error << endl;
+    QProcess::startDetached(QStringLiteral("kdialog"), QStringList() << QStringLiteral("--error") << error);
+    finish(-2, m_errorMessage);
+}
+
+bool SegmentedRenderJob::renderingFinished() const
+{
+    if (m_nextProcess < m_processes.count()) {
+        return false;
+    }
+    for (int i = 0; i < m_remote.count(); ++i) {
+        if (m_remote.at(i)) {
+            if (m_progress.at(i) < 100) return false;
+        } else if (m_processes.at(i) && m_processes.at(i)->state() != QProcess::NotRunning) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SegmentedRenderJob::queueFarmTasks()
+{
+    QString scene = m_scenelist;
+    const bool producerConsumer = scene.startsWith(QLatin1String("consumer:"));
+    if (producerConsumer) scene.remove(0, 9);
+    const QString farmScene = m_jobId + QStringLiteral(".mlt");
+    if (!QFile::copy(scene, QDir(m_farm).absoluteFilePath(farmScene))) {
+        return false;
+    }
+    const int segments = m_boundaries.count() - 1;
+    for (int i = 0; i < m_processes.count(); ++i) {
+        if (m_processes.at(i) == NULL || !m_processes.at(i)->property("program").isNull()) continue;
+        bool audioPass = i == segments;
+        const QString task = FarmWorker::taskName(m_jobId, i);
+        // Write the task under another name so that no worker reads it before it is complete
+        const QString tmpFile = FarmWorker::taskFile(m_farm, task, QStringLiteral("tmp"));
+        {
+            QSettings settings(tmpFile, QSettings::IniFormat);
+            settings.setValue(QStringLiteral("scene"), farmScene);
+            settings.setValue(QStringLiteral("producerconsumer"), producerConsumer);
+            settings.setValue(QStringLiteral("in"), audioPass ? m_boundaries.first() : m_boundaries.at(i));
+            settings.setValue(QStringLiteral("out"), (audioPass ? m_boundaries.last() : m_boundaries.at(i + 1)) - 1);
+            settings.setValue(QStringLiteral("profile"), m_profile);
+            settings.setValue(QStringLiteral("consumer"), m_rendermodule);
+            settings.setValue(QStringLiteral("output"), QFileInfo(m_outputs.at(i)).fileName());
+            settings.setValue(QStringLiteral("preargs"), m_preargs);
+            QStringList args = m_args;
+            if (audioPass) {
+                args << QStringLiteral("vn=1") << QStringLiteral("video_off=1");
+            } else {
+                args << QStringLiteral("an=1") << QStringLiteral("audio_off=1");
+            }
+            settings.setValue(QStringLiteral("arguments"), args);
+            settings.sync();
+            if (settings.status() != QSettings::NoError) {
+                return false;
+            }
+        }
+        if (!QFile::rename(tmpFile, FarmWorker::taskFile(m_farm, task, QStringLiteral("task")))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SegmentedRenderJob::slotCheckFarm()
+{
+    if (m_aborted) return;
+    for (int i = 0; i < m_remote.count(); ++i) {
+        if (!m_remote.at(i) || m_progress.at(i) == 100) continue;
+        const QString task = FarmWorker::taskName(m_jobId, i);
+        if (QFile::exists(FarmWorker::taskFile(m_farm, task, QStringLiteral("failed")))) {
+            m_errorMessage.append(tr("A render farm worker failed to render segment %1.").arg(i + 1) + QStringLiteral("<br>"));
+            fail();
+            return;
+        }
+        if (QFile::exists(FarmWorker::taskFile(m_farm, task, QStringLiteral("done")))) {
+            updateProgress(i, 100);
+            continue;
+        }
+        QFile progress(FarmWorker::taskFile(m_farm, task, QStringLiteral("progress")));
+        if (progress.open(QIODevice::ReadOnly)) {
+            updateProgress(i, qMin(99, progress.readAll().trimmed().toInt()));
+            progress.close();
+        }
+    }
+    if (renderingFinished()) {
+        m_farmTimer.stop();
+        concatenate();
+    }
+}
+
+void SegmentedRenderJob::concatenate()
+{
+    const int segments = m_boundaries.count() - 1;
+    QFile list(m_dest + QStringLiteral(".segments.txt"));
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        finish(-2, tr("Cannot write to %1, check permissions.").arg(list.fileName()));
+        return;
+    }
+    QTextStream stream(&list);
+    for (int i = 0; i < segments; ++i) {
+        QString path = m_outputs.at(i);
+        path.replace(QLatin1Char('\''), QStringLiteral("'\\''"));
+        stream << "file '" << path << "'\n";
+    }
+    stream.flush();
+    list.close();
+    QStringList args;
+    args << QStringLiteral("-y") << QStringLiteral("-v") << QStringLiteral("error");
+    args << QStringLiteral("-f") << QStringLiteral("concat") << QStringLiteral("-safe") << QStringLiteral("0") << QStringLiteral("-i") << list.fileName();
+    if (m_hasAudio) {
+        args << QStringLiteral("-i") << m_outputs.last() << QStringLiteral("-map") << QStringLiteral("0:v") << QStringLiteral("-map") << QStringLiteral("1:a");
+    }
+    args << QStringLiteral("-c") << QStringLiteral("copy") << m_dest;
+    QProcess *process = new QProcess;
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotConcatFinished(int,QProcess::ExitStatus)));
+    m_processes << process;
+    process->start(m_ffmpeg, args);
+    m_logstream << "Started concat process: " << m_ffmpeg << ' ' << args.join(QStringLiteral(" ")) << endl;
+}
+
+void SegmentedRenderJob::slotConcatFinished(int exitCode, QProcess::ExitStatus status)
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    QFile::remove(m_dest + QStringLiteral(".segments.txt"));
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        QString error = tr("Cannot join the rendered segments of %1.").arg(m_dest);
+        QString output = QString::fromLocal8Bit(process->readAll());
+        m_logstream << error << endl << output << endl;
+        QProcess::startDetached(QStringLiteral("kdialog"), QStringList() << QStringLiteral("--error") << error);
+        finish(-2, error + QStringLiteral("<br>") + output);
+        return;
+    }
+    m_logstream << "Rendering of " << m_dest << " finished" << endl;
+    if (!m_player.isEmpty()) {
+        QStringList args = m_player.split(QLatin1Char(' '));
+        QString exec = args.takeFirst();
+        // Decode url
+        QString url = QUrl::fromEncoded(args.takeLast().toUtf8()).path();
+        args << url;
+        QProcess::startDetached(exec, args);
+    }
+    m_logfile.remove();
+    finish(-1);
+}
+
+void SegmentedRenderJob::slotAbort(const QString& url)
+{
+    if (m_dest == url) slotAbort();
+}
+
+void SegmentedRenderJob::slotAbort()
+{
+    qWarning() << "Job aborted by user...";
+    m_aborted = true;
+    foreach(QProcess *p, m_processes) {
+        if (p) p->kill();
+    }
+    QFile(m_dest).remove();
+    m_logstream << "Job aborted by user" << endl;
+    finish(-3);
+}
+
+void SegmentedRenderJob::finish(int status, const QString &error)
+{
+    if (m_kdenliveinterface) {
+        m_dbusargs[1] = status;
+        m_dbusargs.append(error);
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), m_dbusargs);
+    }
+    cleanup();
+    m_logstream.flush();
+    qApp->quit();
+}
+
+void SegmentedRenderJob::cleanup()
+{
+    if (m_erase) QFile(m_scenelist).remove();
+    if (!m_farm.isEmpty() && !m_jobId.isEmpty()) {
+        m_farmTimer.stop();
+        QDir farm(m_farm);
+        if (m_aborted) {
+            // Tell the workers to stop rendering the segments they claimed
+            QFile abort(FarmWorker::abortFile(m_farm, m_jobId));
+            if (abort.open(QIODevice::WriteOnly)) abort.close();
+        }
+        const QStringList files = farm.entryList(QStringList() << m_jobId + QStringLiteral(".*"), QDir::Files);
+        foreach(const QString &file, files) {
+            if (file != QFileInfo(FarmWorker::abortFile(m_farm, m_jobId)).fileName()) farm.remove(file);
+        }
+    }
+    for (int i = 0; i < m_outputs.count(); ++i) {
+        // Never remove the timeline preview chunks
+        if (i < m_processes.count() && m_processes.at(i)) QFile::remove(m_outputs.at(i));
+    }
+}
+
+void SegmentedRenderJob::initKdenliveDbusInterface()
+{
+    QDBusConnection connection = QDBusConnection::sessionBus();
+    QDBusConnectionInterface* ibus = connection.interface();
+    QString kdenliveId = QStringLiteral("org.kde.kdenlive-%1").arg(m_pid);
+    if (!ibus->isServiceRegistered(kdenliveId)) {
+        kdenliveId.clear();
+        const QStringList services = ibus->registeredServiceNames();
+        foreach(const QString & service, services) {
+            if (!service.startsWith(QLatin1String("org.kde.kdenlive")))
+                continue;
+            kdenliveId = service;
+            break;
+        }
+    }
+    m_dbusargs.clear();
+    if (kdenliveId.isEmpty()) return;
+    m_kdenliveinterface = new QDBusInterface(kdenliveId,
+            QStringLiteral("/kdenlive/MainWindow_1"),
+            QStringLiteral("org.kde.kdenlive.rendering"),
+            connection,
+            this);
+
+    if (m_kdenliveinterface) {
+        m_dbusargs.append(m_dest);
+        m_dbusargs.append((int) 0);
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), m_dbusargs);
+        connect(m_kdenliveinterface, SIGNAL(abortRenderJob(QString)),
+                this, SLOT(slotAbort(QString)));
+    }
+}
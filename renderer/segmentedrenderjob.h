@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#ifndef SEGMENTEDRENDERJOB_H
+#define SEGMENTEDRENDERJOB_H
+
+#include <QProcess>
+#include <QObject>
+#include <QDBusInterface>
+#include <QStringList>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+
+/**
+ * @class SegmentedRenderJob
+ * @brief Renders a zone as several video segments in concurrent melt processes
+ *
+ * The video segments are rendered without audio, the audio is rendered in one
+ * continuous pass so that there is no seam at the segment boundaries. Each
+ * segment is a separate encoder run that starts with a keyframe, so ffmpeg can
+ * then concatenate the segments and mux the audio without re-encoding.
+ *
+ * In farm mode the segments are queued as tasks in a shared folder, where the
+ * FarmWorker of other machines can pick them. This job renders the tasks that
+ * no worker claimed first, so it does not depend on any worker being online.
+ */
+
+class SegmentedRenderJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Prepare a segmented render
+     *  @param boundaries the first frame of each segment, followed by the frame after the last one
+     *  @param jobs the maximum number of melt processes running at the same time
+     *  @param chunks already encoded video files used for the segments starting at these frames instead of rendering them
+     *  @param farm folder shared with the render farm workers, empty to render everything locally */
+    SegmentedRenderJob(bool erase, int pid, const QString& renderer, const QString& profile, const QString& rendermodule, const QString& player, const QString& scenelist, const QString& dest, const QStringList& preargs, const QStringList& args, const QList <int> &boundaries, int jobs, const QString &ffmpeg, const QMap <int, QString> &chunks = QMap <int, QString>(), const QString &farm = QString());
+    ~SegmentedRenderJob();
+    /** @brief Read the zones whose video can be copied from a source file, one 'start<tab>end<tab>source frame<tab>fps<tab>file' per line */
+    void setPassthroughZones(const QString &zoneList);
+
+public slots:
+    void start();
+
+private slots:
+    void slotProcessFinished(int exitCode, QProcess::ExitStatus status);
+    void slotConcatFinished(int exitCode, QProcess::ExitStatus status);
+    /** @brief Read the state of the tasks rendered by farm workers */
+    void slotCheckFarm();
+    void receivedStderr();
+    void slotAbort();
+    void slotAbort(const QString& url);
+
+private:
+    QString m_scenelist;
+    QString m_dest;
+    QString m_prog;
+    QString m_profile;
+    QString m_rendermodule;
+    QString m_player;
+    QString m_ffmpeg;
+    QStringList m_preargs;
+    QStringList m_args;
+    QList <int> m_boundaries;
+    QMap <int, QString> m_chunks;
+    QString m_farm;
+    /** @brief Zones that may be copied from their source, see setPassthroughZones */
+    QList <QStringList> m_passthrough;
+    /** @brief Stream copies by segment start: source file, seek time, segment end and frame count */
+    QMap <int, QStringList> m_copies;
+    /** @brief Path of the segment files without the part number */
+    QString m_outputBase;
+    /** @brief Unique name of this render in the farm folder */
+    QString m_jobId;
+    /** @brief True for the segments claimed by a farm worker */
+    QList <bool> m_remote;
+    QTimer m_farmTimer;
+    int m_maxJobs;
+    bool m_erase;
+    bool m_hasAudio;
+    /** @brief The process id of the Kdenlive instance, used to get the dbus service. */
+    int m_pid;
+    /** @brief The video segment files, the audio file is last if there is one */
+    QStringList m_outputs;
+    /** @brief The render processes, in the same order as m_outputs, NULL for the segments copied from a chunk */
+    QList <QProcess *> m_processes;
+    /** @brief Progress of each render process, in percent */
+    QList <int> m_progress;
+    int m_nextProcess;
+    int m_reported;
+    bool m_aborted;
+    QString m_errorMessage;
+    QDBusInterface* m_kdenliveinterface;
+    QList<QVariant> m_dbusargs;
+    /** @brief Used to create a temporary file for logging. */
+    QFile m_logfile;
+    QTextStream m_logstream;
+    /** @brief Start waiting processes until m_maxJobs are running */
+    void startProcesses();
+    /** @brief Fill m_outputs from the segment boundaries */
+    void buildOutputs();
+    /** @brief Split the boundaries at the keyframes of the passthrough zones and prepare their stream copies */
+    void addPassthroughSegments();
+    /** @brief Returns the keyframe times of a file between start and end, relative to its start time
+     *  @param startTime is set to the start time of the file's video stream */
+    QList <double> probeKeyframes(const QString &url, double start, double end, double &startTime) const;
+    /** @brief Returns true once all segments are rendered */
+    bool renderingFinished() const;
+    /** @brief Update the progress of a segment and report the global progress */
+    void updateProgress(int ix, int progress);
+    /** @brief Stop everything after a segment failed */
+    void fail();
+    /** @brief Write the tasks and the scene of the render in the farm folder */
+    bool queueFarmTasks();
+    /** @brief Concatenate the video segments and mux the audio into the destination */
+    void concatenate();
+    void initKdenliveDbusInterface();
+    /** @brief Report the end of the job to Kdenlive, status is -1 on success, -2 on error and -3 when aborted */
+    void finish(int status, const QString &error = QString());
+    void cleanup();
+};
+
+#endif
@@ -79,7 +79,7 @@ AbstractProjectItem* AbstractProjectItem::parent() const
 void AbstractProjectItem::setRefCount(uint count)
 {
     m_usage = count;
-    bin()->emitItemUpdated(this);
+    bin()->emitItemUpdated(this, QVector<int>() << UsageCount);
 }
 
 uint AbstractProjectItem::refCount() const
@@ -90,13 +90,13 @@ uint AbstractProjectItem::refCount() const
 void AbstractProjectItem::addRef()
 {
     m_usage++;
-    bin()->emitItemUpdated(this);
+    bin()->emitItemUpdated(this, QVector<int>() << UsageCount);
 }
 
 void AbstractProjectItem::removeRef()
 {
     m_usage--;
-    bin()->emitItemUpdated(this);
+    bin()->emitItemUpdated(this, QVector<int>() << UsageCount);
 }
 
 const QString &AbstractProjectItem::clipId() const
@@ -0,0 +1,248 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "audiolevels.h"
+
+#include <QImage>
+#include <QDebug>
+
+// Header of the cached levels file: magic, version, channels, frames
+#define LEVELS_MAGIC "KALV"
+#define LEVELS_VERSION 1
+#define LEVELS_HEADER_SIZE 16
+// Maximum number of reduced levels, the last one storing the max of 4^8 = 65536 frames
+#define MAX_PYRAMID_LEVELS 8
+
+AudioLevelsData::AudioLevelsData() : QSharedData()
+    , mapped(NULL)
+    , levels(NULL)
+    , channels(0)
+    , count(0)
+    , totalFrames(0)
+{
+}
+
+AudioLevelsData::~AudioLevelsData()
+{
+    if (mapped) {
+        file.unmap(mapped);
+    }
+}
+
+void AudioLevelsData::buildPyramid()
+{
+    pyramid.clear();
+    pyramidOffsets.clear();
+    pyramidFrames.clear();
+    if (channels <= 0 || count == 0) {
+        return;
+    }
+    int frames = count / channels;
+    const quint8 *source = levels;
+    for (int level = 1; level <= MAX_PYRAMID_LEVELS && frames > 1; level++) {
+        int reduced = (frames + 3) / 4;
+        pyramidOffsets << pyramid.size();
+        pyramidFrames << reduced;
+        pyramid.resize(pyramid.size() + reduced * channels);
+        // Resize may have moved data, previous level is our source
+        if (level > 1) {
+            source = (const quint8 *) pyramid.constData() + pyramidOffsets.at(level - 2);
+        }
+        quint8 *dest = (quint8 *) pyramid.data() + pyramidOffsets.last();
+        for (int i = 0; i < reduced; i++) {
+            for (int c = 0; c < channels; c++) {
+                quint8 value = 0;
+                for (int j = i * 4; j < qMin(i * 4 + 4, frames); j++) {
+                    value = qMax(value, source[j * channels + c]);
+                }
+                dest[i * channels + c] = value;
+            }
+        }
+        frames = reduced;
+    }
+}
+
+AudioLevels::AudioLevels() :
+    d(new AudioLevelsData)
+{
+}
+
+AudioLevels::AudioLevels(int channels, const QByteArray &levels, int totalFrames) :
+    d(new AudioLevelsData)
+{
+    if (channels > 0 && !levels.isEmpty()) {
+        d->buffer = levels;
+        d->levels = (const quint8 *) d->buffer.constData();
+        d->channels = channels;
+        d->count = levels.size();
+        d->totalFrames = totalFrames;
+        d->buildPyramid();
+    }
+}
+
+bool AudioLevels::isEmpty() const
+{
+    return d->count == 0;
+}
+
+void AudioLevels::clear()
+{
+    d = new AudioLevelsData;
+}
+
+int AudioLevels::channels() const
+{
+    return d->channels;
+}
+
+int AudioLevels::count() const
+{
+    return d->count;
+}
+
+qint64 AudioLevels::byteCount() const
+{
+    return d->buffer.size() + d->pyramid.size();
+}
+
+int AudioLevels::frames() const
+{
+    return d->channels > 0 ? d->count / d->channels : 0;
+}
+
+int AudioLevels::totalFrames() const
+{
+    return qMax(frames(), d->totalFrames);
+}
+
+bool AudioLevels::isComplete() const
+{
+    return frames() >= d->totalFrames;
+}
+
+const quint8 *AudioLevels::constData() const
+{
+    return d->levels;
+}
+
+int AudioLevels::pyramidLevels() const
+{
+    return d->pyramidOffsets.count() + 1;
+}
+
+int AudioLevels::pyramidLevel(double frameWidth)
+{
+    // Use the largest block that still has at least one value per pixel
+    int level = 0;
+    double block = 4;
+    while (level < MAX_PYRAMID_LEVELS && block * frameWidth <= 1.0) {
+        level++;
+        block *= 4;
+    }
+    return level;
+}
+
+bool AudioLevels::load(const QString &path)
+{
+    QExplicitlySharedDataPointer<AudioLevelsData> data(new AudioLevelsData);
+    data->file.setFileName(path);
+    if (!data->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray header = data->file.read(LEVELS_HEADER_SIZE);
+    if (header.size() != LEVELS_HEADER_SIZE || !header.startsWith(LEVELS_MAGIC)) {
+        return false;
+    }
+    const uchar *h = (const uchar *) header.constData();
+    int version = h[4] | (h[5] << 8);
+    int channels = h[6] | (h[7] << 8);
+    qint64 frames = h[8] | (h[9] << 8) | (h[10] << 16) | ((qint64) h[11] << 24);
+    if (version != LEVELS_VERSION || channels <= 0 || frames <= 0 || data->file.size() < LEVELS_HEADER_SIZE + frames * channels) {
+        qDebug()<<"* * * Invalid audio levels file: "<<path;
+        return false;
+    }
+    data->mapped = data->file.map(LEVELS_HEADER_SIZE, frames * channels);
+    if (!data->mapped) {
+        // Mapping not supported, read the data
+        data->buffer = data->file.readAll();
+        data->levels = (const quint8 *) data->buffer.constData();
+    } else {
+        data->levels = data->mapped;
+    }
+    data->file.close();
+    data->channels = channels;
+    data->count = frames * channels;
+    data->buildPyramid();
+    d = data;
+    return true;
+}
+
+bool AudioLevels::save(const QString &path) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug()<<"* * * Cannot write audio levels file: "<<path;
+        return false;
+    }
+    quint32 frameCount = frames();
+    uchar header[LEVELS_HEADER_SIZE] = { 0 };
+    memcpy(header, LEVELS_MAGIC, 4);
+    header[4] = LEVELS_VERSION & 0xff;
+    header[5] = (LEVELS_VERSION >> 8) & 0xff;
+    header[6] = d->channels & 0xff;
+    header[7] = (d->channels >> 8) & 0xff;
+    for (int i = 0; i < 4; i++) {
+        header[8 + i] = (frameCount >> (8 * i)) & 0xff;
+    }
+    bool result = file.write((const char *) header, LEVELS_HEADER_SIZE) == LEVELS_HEADER_SIZE;
+    result = result && file.write((const char *) d->levels, frameCount * d->channels) == frameCount * d->channels;
+    file.close();
+    if (!result) {
+        file.remove();
+    }
+    return result;
+}
+
+AudioLevels AudioLevels::fromImage(const QString &path, int channels)
+{
+    QImage image(path);
+    if (image.isNull() || channels <= 0 || image.height() != channels) {
+        return AudioLevels();
+    }
+    image = image.convertToFormat(QImage::Format_ARGB32);
+    // Image stores 4 levels per pixel, pixel (x, y) holding levels starting at (x * channels + y) * 4
+    QByteArray levels;
+    levels.resize(image.width() * image.height() * 4);
+    char *out = levels.data();
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *line = (const QRgb *) image.constScanLine(y);
+        for (int x = 0; x < image.width(); x++) {
+            QRgb p = line[x];
+            char *pos = out + (x * channels + y) * 4;
+            pos[0] = qRed(p);
+            pos[1] = qGreen(p);
+            pos[2] = qBlue(p);
+            pos[3] = qAlpha(p);
+        }
+    }
+    return AudioLevels(channels, levels);
+}
@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMetaType>
+#include <QSharedData>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class AudioLevelsData
+ * @brief Shared storage of an AudioLevels object, either a memory buffer or a memory mapped file.
+ */
+class AudioLevelsData : public QSharedData
+{
+public:
+    AudioLevelsData();
+    ~AudioLevelsData();
+    QFile file;
+    uchar *mapped;
+    QByteArray buffer;
+    const quint8 *levels;
+    int channels;
+    int count;
+    /** @brief Number of frames of the clip, 0 if the levels cover the whole clip. */
+    int totalFrames;
+    /** @brief Reduced levels, each level storing the max of 4 values of the previous one. */
+    QByteArray pyramid;
+    /** @brief Offset in pyramid and number of frames of each reduced level. */
+    QVector <int> pyramidOffsets;
+    QVector <int> pyramidFrames;
+    void buildPyramid();
+};
+
+/**
+ * @class AudioLevels
+ * @brief Audio thumbnail data of a clip: one level (0-255) per channel per frame, stored as
+ * frame -> channel -> level in a plain byte array.
+ * Cached levels are memory mapped from a small binary file, so loading a project does not need
+ * to decode or allocate anything. Copies are cheap and share the same data, so levels are passed
+ * by value through queued signals without any conversion.
+ * A peak pyramid (max of 4, 16, 64... frames) is built on load so that zoomed out views
+ * can draw one value per pixel without iterating over every frame.
+ */
+class AudioLevels
+{
+public:
+    AudioLevels();
+    /** @brief Build levels from a buffer of channels * frames bytes.
+     *  @param totalFrames is the clip length when @param levels only hold the first frames of a clip being extracted */
+    AudioLevels(int channels, const QByteArray &levels, int totalFrames = 0);
+    bool isEmpty() const;
+    void clear();
+    int channels() const;
+    /** @brief Number of levels (frames * channels). */
+    int count() const;
+    int frames() const;
+    /** @brief Number of frames of the clip, larger than frames() while the levels are still being extracted. */
+    int totalFrames() const;
+    /** @brief Returns false for the partial levels of a clip being extracted. */
+    bool isComplete() const;
+    /** @brief Heap memory used by the levels and their pyramid in bytes, a memory mapped file is not counted. */
+    qint64 byteCount() const;
+    /** @brief The raw level array, frame -> channel -> level. */
+    const quint8 *constData() const;
+    /** @brief Returns level at index (frame * channels + channel), clamped to the available data. */
+    inline int at(int index) const {
+        return d->levels[qBound(0, index, d->count - 1)];
+    }
+    /** @brief Number of levels in the peak pyramid, level 0 being one value per frame. */
+    int pyramidLevels() const;
+    /** @brief Returns the max level of channel over the block of 4^level frames containing frame. */
+    inline int peak(int level, int frame, int channel) const {
+        if (level <= 0 || level > d->pyramidOffsets.count()) {
+            return at(frame * d->channels + channel);
+        }
+        int frames = d->pyramidFrames.at(level - 1);
+        int block = qBound(0, frame >> (2 * level), frames - 1);
+        return (quint8) d->pyramid.at(d->pyramidOffsets.at(level - 1) + block * d->channels + channel);
+    }
+    /** @brief Returns the pyramid level best matching a frame width in pixels. */
+    static int pyramidLevel(double frameWidth);
+    /** @brief Memory map a cached levels file, return false if the file is missing or invalid. */
+    bool load(const QString &path);
+    /** @brief Write levels to a cache file. */
+    bool save(const QString &path) const;
+    /** @brief Convert levels cached in a png image by previous versions. */
+    static AudioLevels fromImage(const QString &path, int channels);
+
+private:
+    QExplicitlySharedDataPointer<AudioLevelsData> d;
+};
+
+Q_DECLARE_METATYPE(AudioLevels)
+
+#endif
@@ -0,0 +1,131 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "audiopeakextractor.h"
+
+#include "mlt++/Mlt.h"
+
+#include <QString>
+
+// Same scale as the levels computed from the FFmpeg output
+#define LEVEL_FACTOR (800.0 / 32768)
+
+AudioPeakExtractor::AudioPeakExtractor(Mlt::Producer *source, int channels, int frequency)
+    : m_channels(channels)
+    , m_frequency(frequency)
+    , m_length(source->get_length())
+    , m_position(0)
+    , m_fps(source->get_fps())
+    , m_sums(channels)
+{
+    QString service = source->get("mlt_service");
+    if (service == QLatin1String("avformat-novalidate")) {
+        service = QStringLiteral("avformat");
+    } else if (service.startsWith(QLatin1String("xml"))) {
+        service = QStringLiteral("xml-nogl");
+    }
+    m_producer.reset(new Mlt::Producer(*source->profile(), service.toUtf8().constData(), source->get("resource")));
+    if (!m_producer->is_valid()) {
+        return;
+    }
+    // Do not decode video, read the audio stream selected for the clip
+    m_producer->set("video_index", "-1");
+    if (source->get("audio_index")) {
+        m_producer->set("audio_index", source->get_int("audio_index"));
+    }
+    m_channelsFilter.reset(new Mlt::Filter(*source->profile(), "audiochannels"));
+    m_converter.reset(new Mlt::Filter(*source->profile(), "audioconvert"));
+    m_producer->attach(*m_channelsFilter);
+    m_producer->attach(*m_converter);
+}
+
+AudioPeakExtractor::~AudioPeakExtractor()
+{
+}
+
+bool AudioPeakExtractor::isValid() const
+{
+    return m_producer && m_producer->is_valid() && m_channels > 0;
+}
+
+int AudioPeakExtractor::position() const
+{
+    return m_position;
+}
+
+/** @brief Adds the absolute values of interleaved samples to the channel @param sums.
+ *  Plain loops over contiguous samples, so that the compiler can vectorize them. */
+static void accumulate(const qint16 *pcm, int samples, int channels, qint64 *sums)
+{
+    if (channels == 1) {
+        qint64 sum = 0;
+        for (int i = 0; i < samples; ++i) {
+            sum += qAbs((int) pcm[i]);
+        }
+        sums[0] += sum;
+    } else if (channels == 2) {
+        qint64 left = 0;
+        qint64 right = 0;
+        for (int i = 0; i < samples; ++i) {
+            left += qAbs((int) pcm[2 * i]);
+            right += qAbs((int) pcm[2 * i + 1]);
+        }
+        sums[0] += left;
+        sums[1] += right;
+    } else {
+        for (int i = 0; i < samples; ++i) {
+            for (int c = 0; c < channels; ++c) {
+                sums[c] += qAbs((int) pcm[c]);
+            }
+            pcm += channels;
+        }
+    }
+}
+
+int AudioPeakExtractor::readBlock(char *levels, int frames)
+{
+    if (!isValid()) {
+        return 0;
+    }
+    frames = qMin(frames, m_length - m_position);
+    mlt_audio_format audioFormat = mlt_audio_s16;
+    for (int i = 0; i < frames; ++i, ++m_position) {
+        char *frameLevels = levels + i * m_channels;
+        QScopedPointer<Mlt::Frame> frame(m_producer->get_frame());
+        if (frame && frame->is_valid() && !frame->get_int("test_audio")) {
+            int frequency = m_frequency;
+            int channels = m_channels;
+            int samples = mlt_sample_calculator(m_fps, m_frequency, m_position);
+            const qint16 *pcm = (const qint16 *) frame->get_audio(audioFormat, frequency, channels, samples);
+            if (pcm && samples > 0 && channels == m_channels) {
+                m_sums.fill(0);
+                accumulate(pcm, samples, m_channels, m_sums.data());
+                for (int c = 0; c < m_channels; ++c) {
+                    frameLevels[c] = (char) qMin(m_sums.at(c) / samples * LEVEL_FACTOR, 255.0);
+                }
+                continue;
+            }
+        }
+        // No audio for this frame, repeat the previous levels
+        for (int c = 0; c < m_channels; ++c) {
+            frameLevels[c] = m_position > 0 ? frameLevels[c - m_channels] : 0;
+        }
+    }
+    return frames;
+}
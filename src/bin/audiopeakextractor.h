@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef AUDIOPEAKEXTRACTOR_H
+#define AUDIOPEAKEXTRACTOR_H
+
+#include <QScopedPointer>
+#include <QVector>
+
+namespace Mlt
+{
+class Producer;
+class Filter;
+}
+
+/**
+ * @class AudioPeakExtractor
+ * @brief Computes the audio thumbnail levels of a clip in process.
+ *
+ * A separate audio only producer is opened on the clip resource, so that no video is decoded.
+ * Levels are computed straight from the 16 bit PCM of each frame, as the mean absolute sample
+ * value like the FFmpeg thumbnails, without the audiolevel filter. Frames are read in blocks
+ * so that the caller can publish partial levels while the clip is decoded.
+ */
+class AudioPeakExtractor
+{
+public:
+    /** @brief Opens an audio only producer on the resource of @param source. */
+    AudioPeakExtractor(Mlt::Producer *source, int channels, int frequency);
+    ~AudioPeakExtractor();
+    bool isValid() const;
+    /** @brief Index of the next frame to decode. */
+    int position() const;
+    /** @brief Decodes up to @param frames frames and writes one level per channel per frame in @param levels,
+     *  which points at the levels of frame position() in the clip's level buffer.
+     *  Frames without audio repeat the previous levels. Returns the number of frames written. */
+    int readBlock(char *levels, int frames);
+
+private:
+    QScopedPointer<Mlt::Producer> m_producer;
+    QScopedPointer<Mlt::Filter> m_channelsFilter;
+    QScopedPointer<Mlt::Filter> m_converter;
+    int m_channels;
+    int m_frequency;
+    int m_length;
+    int m_position;
+    double m_fps;
+    /** @brief Per channel sums of absolute sample values for the current frame. */
+    QVector<qint64> m_sums;
+};
+
+#endif
@@ -38,8 +38,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ui_qtextclip_ui.h"
 #include "titler/titlewidget.h"
 #include "core.h"
+#include "doc/proxystore.h"
+#include "doc/cacheindex.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/clipcontroller.h"
+#include "mltcontroller/bincontroller.h"
+#include "mltcontroller/producerqueue.h"
 #include "mltcontroller/clippropertiescontroller.h"
 #include "project/projectcommands.h"
 #include "project/invaliddialog.h"
@@ -63,9 +67,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMenu>
 #include <QDebug>
 #include <QtConcurrent>
+#include <QThread>
 #include <QUndoCommand>
 #include <QCryptographicHash>
 
+// Maximum number of clips whose audio thumbnails are created in parallel
+#define MAX_AUDIO_THUMB_THREADS 4
+
 
 MyListView::MyListView(QWidget * parent) : QListView(parent)
 {
@@ -73,6 +81,9 @@ MyListView::MyListView(QWidget * parent) : QListView(parent)
     setMovement(QListView::Static);
     setResizeMode(QListView::Adjust);
     setUniformItemSizes(true);
+    // Lay out large bins in steps so that the visible items are painted first
+    setLayoutMode(QListView::Batched);
+    setBatchSize(200);
     setDragDropMode(QAbstractItemView::DragDrop);
     setAcceptDrops(true);
     setDragEnabled(true);
@@ -203,6 +214,8 @@ bool BinMessageWidget::event(QEvent* ev) {
 
 SmallJobLabel::SmallJobLabel(QWidget *parent) : QPushButton(parent)
     , m_action(NULL)
+    , m_jobCount(0)
+    , m_jobProgress(0)
 {
     setFixedWidth(0);
     setFlat(true);
@@ -249,12 +262,32 @@ void SmallJobLabel::slotTimeLineFinished()
     }
 }
 
+void SmallJobLabel::updateLabelText()
+{
+    if (m_jobProgress > 0) {
+        setText(i18np("%1 job (%2%)", "%1 jobs (%2%)", m_jobCount, m_jobProgress));
+    } else {
+        setText(i18np("%1 job", "%1 jobs", m_jobCount));
+    }
+    setToolTip(i18np("%1 pending job", "%1 pending jobs", m_jobCount));
+}
+
+void SmallJobLabel::slotSetJobProgress(int progress)
+{
+    if (progress == m_jobProgress) return;
+    m_jobProgress = progress;
+    if (m_jobCount > 0 && m_action && m_action->isVisible()) {
+        updateLabelText();
+        setFixedWidth(sizeHint().width());
+    }
+}
+
 void SmallJobLabel::slotSetJobCount(int jobCount)
 {
+    m_jobCount = jobCount;
     if (jobCount > 0) {
         // prepare animation
-        setText(i18np("%1 job", "%1 jobs", jobCount));
-        setToolTip(i18np("%1 pending job", "%1 pending jobs", jobCount));
+        updateLabelText();
 
         if (style()->styleHint(QStyle::SH_Widget_Animate, 0, this)) {
             setFixedWidth(sizeHint().width());
@@ -327,15 +360,22 @@ Bin::Bin(QWidget* parent) :
   , m_transcodeAction(NULL)
   , m_clipsActionsMenu(NULL)
   , m_inTimelineAction(NULL)
+  , m_clipBatch(0)
   , m_listType((BinViewType) KdenliveSettings::binMode())
   , m_iconSize(160, 90)
   , m_propertiesPanel(NULL)
+  , m_clipPanel(NULL)
   , m_blankThumb()
   , m_invalidClipDialog(NULL)
   , m_gainedFocus(false)
   , m_audioDuration(0)
   , m_processedAudio(0)
+  , m_audioThumbWorkers(0)
 {
+    m_thumbnails.setMaxCost(KdenliveSettings::binthumbmemory() * 1024);
+    MemoryTracker::self()->addConsumer(this, "Memory bin thumbnails", i18n("Bin thumbnails"));
+    // Sprite sheets are built in the background, keep the decoders free for playback
+    m_spritePool.setMaxThreadCount(1);
     m_layout = new QVBoxLayout(this);
 
     // Create toolbar for buttons
@@ -364,8 +404,6 @@ Bin::Bin(QWidget* parent) :
 
     // Connect models
     m_proxyModel->setSourceModel(m_itemModel);
-    connect(m_itemModel, SIGNAL(dataChanged(const QModelIndex&,const QModelIndex&)), m_proxyModel, SLOT(slotDataChanged(const QModelIndex&,const
-    QModelIndex&)));
     connect(m_itemModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(rowsInserted(QModelIndex,int,int)));
     connect(m_itemModel, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(rowsRemoved(QModelIndex,int,int)));
     connect(m_proxyModel, SIGNAL(selectModel(QModelIndex)), this, SLOT(selectProxyModel(QModelIndex)));
@@ -495,11 +533,8 @@ Bin::~Bin()
     m_proxyModel->selectionModel()->blockSignals(true);
     setEnabled(false);
     abortAudioThumbs();
-    if (m_propertiesPanel) {
-        foreach (QWidget * w, m_propertiesPanel->findChildren<ClipPropertiesController*>()) {
-            delete w;
-        }
-    }
+    delete m_clipPanel;
+    m_clipPanel = NULL;
     if (m_rootFolder) {
         while (!m_rootFolder->isEmpty()) {
             AbstractProjectItem *child = m_rootFolder->at(0);
@@ -521,20 +556,22 @@ QDockWidget *Bin::clipPropertiesDock()
 
 void Bin::slotAbortAudioThumb(const QString &id, long duration)
 {
-    if (!m_audioThumbsThread.isRunning()) return;
     QMutexLocker aMutex(&m_audioThumbMutex);
+    if (m_audioThumbWorkers == 0) return;
     if (m_audioThumbsList.removeAll(id) > 0)
         m_audioDuration -= duration;
 }
 
 void Bin::requestAudioThumbs(const QString &id, long duration)
 {
-    if (!m_audioThumbsList.contains(id) && m_processingAudioThumb != id) {
-        m_audioThumbMutex.lock();
+    m_audioThumbMutex.lock();
+    if (!m_audioThumbsList.contains(id) && !m_processingAudioThumbs.contains(id)) {
         m_audioThumbsList.append(id);
         m_audioDuration += duration;
         m_audioThumbMutex.unlock();
         processAudioThumbs();
+    } else {
+        m_audioThumbMutex.unlock();
     }
 }
 
@@ -544,52 +581,131 @@ void Bin::doUpdateThumbsProgress(long ms)
     emitMessage(i18n("Creating audio thumbnails"), progress, ProcessingJobMessage);
 }
 
+int Bin::audioThumbThreads()
+{
+    int threads = KdenliveSettings::audiothumbthreads();
+    if (threads <= 0) {
+        // Each worker decodes a whole clip, leave some cores for playback
+        threads = qMin(QThread::idealThreadCount() / 2, MAX_AUDIO_THUMB_THREADS);
+    }
+    return qMax(1, threads);
+}
+
 void Bin::processAudioThumbs()
 {
-    if (m_audioThumbsThread.isRunning()) return;
-    m_audioThumbsThread = QtConcurrent::run(this, &Bin::slotCreateAudioThumbs);
+    QMutexLocker aMutex(&m_audioThumbMutex);
+    const int maxWorkers = audioThumbThreads();
+    if (m_audioThumbPool.maxThreadCount() < maxWorkers) {
+        m_audioThumbPool.setMaxThreadCount(maxWorkers);
+    }
+    int pending = m_audioThumbsList.count();
+    while (m_audioThumbWorkers < maxWorkers && pending > 0) {
+        m_audioThumbWorkers++;
+        pending--;
+        QtConcurrent::run(&m_audioThumbPool, this, &Bin::slotCreateAudioThumbs);
+    }
 }
 
 void Bin::abortAudioThumbs()
 {
-    if (!m_audioThumbsThread.isRunning()) return;
-    if (!m_processingAudioThumb.isEmpty()) {
-        ProjectClip *clip = m_rootFolder->clip(m_processingAudioThumb);
+    m_audioThumbMutex.lock();
+    if (m_audioThumbWorkers == 0) {
+        m_audioThumbMutex.unlock();
+        return;
+    }
+    foreach(const QString &id, m_processingAudioThumbs) {
+        ProjectClip *clip = m_rootFolder->clip(id);
         if (clip) clip->abortAudioThumbs();
     }
-    m_audioThumbMutex.lock();
     foreach(const QString &id, m_audioThumbsList) {
         ProjectClip *clip = m_rootFolder->clip(id);
         if (clip) clip->setJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
     }
     m_audioThumbsList.clear();
     m_audioThumbMutex.unlock();
-    m_audioThumbsThread.waitForFinished();
+    m_audioThumbPool.waitForDone();
 }
 
 void Bin::slotCreateAudioThumbs()
 {
-    int max = m_audioThumbsList.count();
-    int count = 0;
-    m_processedAudio = 0;
-    while (!m_audioThumbsList.isEmpty()) {
+    forever {
         m_audioThumbMutex.lock();
-        max = qMax(max, m_audioThumbsList.count());
-        m_processingAudioThumb = m_audioThumbsList.takeFirst();
-        count++;
+        if (m_audioThumbsList.isEmpty()) {
+            m_audioThumbWorkers--;
+            bool lastWorker = m_audioThumbWorkers == 0;
+            if (lastWorker) {
+                m_processedAudio = 0;
+                m_audioDuration = 0;
+            }
+            m_audioThumbMutex.unlock();
+            if (lastWorker) {
+                emitMessage(i18n("Audio thumbnails done"), 100, OperationCompletedMessage);
+            }
+            return;
+        }
+        const QString id = m_audioThumbsList.takeFirst();
+        m_processingAudioThumbs.append(id);
         m_audioThumbMutex.unlock();
-        ProjectClip *clip = m_rootFolder->clip(m_processingAudioThumb);
+        ProjectClip *clip = m_rootFolder->clip(id);
+        long processed = 0;
         if (clip) {
             clip->slotCreateAudioThumbs();
-            m_processedAudio += clip->duration().ms();
+            processed = clip->duration().ms();
         }
+        m_audioThumbMutex.lock();
+        m_processingAudioThumbs.removeOne(id);
+        m_processedAudio += processed;
+        m_audioThumbMutex.unlock();
+    }
+}
+
+QThreadPool *Bin::spritePool()
+{
+    return &m_spritePool;
+}
+
+qint64 Bin::memoryUsage() const
+{
+    return (qint64) m_thumbnails.totalCost() * 1024;
+}
+
+qint64 Bin::memoryBudget() const
+{
+    return (qint64) m_thumbnails.maxCost() * 1024;
+}
+
+void Bin::scrubClip(QAbstractItemView *view, const QPoint &pos)
+{
+    ProjectClip *clip = NULL;
+    double ratio = -1;
+    QModelIndex idx = view ? view->indexAt(pos) : QModelIndex();
+    if (idx.isValid() && idx.column() == 0) {
+        AbstractProjectItem *item = static_cast<AbstractProjectItem*>(m_proxyModel->mapToSource(idx).internalPointer());
+        clip = qobject_cast<ProjectClip*>(item);
+        if (clip) {
+            QRect rect = view->visualRect(idx);
+            QSize icon = view->iconSize();
+            // The tree view draws the thumbnail on the left, the icon view over the whole item width
+            int thumbWidth = rect.width();
+            if (m_listType == BinTreeView && icon.height() > 0) {
+                thumbWidth = icon.width() * rect.height() / icon.height();
+            }
+            if (thumbWidth > 0 && pos.x() - rect.left() < thumbWidth) {
+                ratio = (double) (pos.x() - rect.left()) / thumbWidth;
+            }
+        }
+    }
+    const QString id = clip ? clip->clipId() : QString();
+    if (id != m_scrubClipId && !m_scrubClipId.isEmpty() && m_rootFolder) {
+        ProjectClip *previous = m_rootFolder->clip(m_scrubClipId);
+        if (previous) {
+            previous->setScrubPosition(-1);
+        }
+    }
+    m_scrubClipId = id;
+    if (clip) {
+        clip->setScrubPosition(ratio);
     }
-    m_audioThumbMutex.lock();
-    m_processingAudioThumb.clear();
-    m_processedAudio = 0;
-    m_audioDuration = 0;
-    m_audioThumbMutex.unlock();
-    emitMessage(i18n("Audio thumbnails done"), 100, OperationCompletedMessage);
 }
 
 bool Bin::eventFilter(QObject *obj, QEvent *event)
@@ -637,6 +753,14 @@ bool Bin::eventFilter(QObject *obj, QEvent *event)
             qDebug()<<" +++++++ NO VIEW-------!!";
         }
         return true;
+    } else if (event->type() == QEvent::MouseMove) {
+        QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
+        QAbstractItemView *view = qobject_cast<QAbstractItemView*>(obj->parent());
+        if (view && mouseEvent->buttons() == Qt::NoButton) {
+            scrubClip(view, mouseEvent->pos());
+        }
+    } else if (event->type() == QEvent::Leave) {
+        scrubClip(NULL, QPoint());
     } else if (event->type() == QEvent::Wheel) {
         QWheelEvent * e = static_cast<QWheelEvent*>(event);
         if (e && e->modifiers() == Qt::ControlModifier) {
@@ -985,6 +1109,7 @@ void Bin::setDocument(KdenliveDoc* project)
     delete m_itemView;
     m_itemView = NULL;
     delete m_jobManager;
+    m_thumbnails.clear();
     m_clipCounter = 1;
     m_folderCounter = 1;
     m_doc = project;
@@ -998,12 +1123,15 @@ void Bin::setDocument(KdenliveDoc* project)
     connect(m_jobManager, SIGNAL(addClip(QString, int)), this, SLOT(slotAddUrl(QString,int)));
     connect(m_proxyAction, SIGNAL(toggled(bool)), m_doc, SLOT(slotProxyCurrentItem(bool)));
     connect(m_jobManager, SIGNAL(jobCount(int)), m_infoLabel, SLOT(slotSetJobCount(int)));
+    connect(m_jobManager, SIGNAL(jobsProgress(int)), m_infoLabel, SLOT(slotSetJobProgress(int)));
+    connect(m_jobManager, SIGNAL(relinkClip(QString,QString)), this, SLOT(slotRelinkClip(QString,QString)));
     connect(m_discardCurrentClipJobs, SIGNAL(triggered()), m_jobManager, SLOT(slotDiscardClipJobs()));
     connect(m_cancelJobs, SIGNAL(triggered()), m_jobManager, SLOT(slotCancelJobs()));
     connect(m_discardPendingJobs, SIGNAL(triggered()), m_jobManager, SLOT(slotCancelPendingJobs()));
     connect(m_jobManager, SIGNAL(updateJobStatus(QString,int,int,QString,QString,QString)), this, SLOT(slotUpdateJobStatus(QString,int,int,QString,QString,QString)));
 
     connect(m_jobManager, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)), this, SLOT(slotGotFilterJobResults(QString,int,int,stringMap,stringMap)));
+    connect(m_jobManager, SIGNAL(gotAnalysisResults(QString,int,int,AnalysisResult,stringMap)), this, SLOT(slotGotAnalysisResults(QString,int,int,AnalysisResult,stringMap)));
 
     //connect(m_itemModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), m_itemView
     //connect(m_itemModel, SIGNAL(updateCurrentItem()), this, SLOT(autoSelect()));
@@ -1278,7 +1406,7 @@ void Bin::emitAboutToAddItem(AbstractProjectItem* item)
 void Bin::emitItemAdded(AbstractProjectItem* item)
 {
     m_itemModel->onItemAdded(item);
-    if (!m_proxyModel->selectionModel()->hasSelection()) {
+    if (m_clipBatch == 0 && !m_proxyModel->selectionModel()->hasSelection()) {
         QModelIndex ix = getIndexForId(item->clipId(), item->itemType() == AbstractProjectItem::FolderItem);
         int row =ix.row();
         if (row < 0) row = item->index();
@@ -1765,28 +1893,38 @@ void Bin::showClipProperties(ProjectClip *clip, bool forceRefresh)
         // the properties panel is already displaying current clip, do nothing
         return;
     }
-    // Cleanup widget for new content
-    foreach (QWidget * w, m_propertiesPanel->findChildren<ClipPropertiesController*>()) {
-            delete w;
+    if (!m_clipPanel) {
+        createClipPanel();
+    } else if (panelId != clip->clipId()) {
+        // Stop refreshing the panel from the previously displayed clip
+        ProjectClip *previous = m_rootFolder->clip(panelId);
+        if (previous) {
+            previous->disconnect(m_clipPanel);
+        }
     }
     m_propertiesPanel->setProperty("clipId", clip->clipId());
+    clip->attachProperties(m_clipPanel);
+}
+
+void Bin::createClipPanel()
+{
     QVBoxLayout *lay = static_cast<QVBoxLayout*>(m_propertiesPanel->layout());
     if (lay == 0) {
         lay = new QVBoxLayout(m_propertiesPanel);
         m_propertiesPanel->setLayout(lay);
     }
-    ClipPropertiesController *panel = clip->buildProperties(m_propertiesPanel);
-    connect(this, SIGNAL(refreshTimeCode()), panel, SLOT(slotRefreshTimeCode()));
-    connect(this, SIGNAL(refreshPanelMarkers()), panel, SLOT(slotFillMarkers()));
-    connect(panel, SIGNAL(updateClipProperties(const QString &, QMap<QString, QString>, QMap<QString, QString>)), this, SLOT(slotEditClipCommand(const QString &, QMap<QString, QString>, QMap<QString, QString>)));
-    connect(panel, SIGNAL(seekToFrame(int)), m_monitor, SLOT(slotSeek(int)));
-    connect(panel, SIGNAL(addMarkers(QString,QList<CommentedTime>)), this, SLOT(slotAddClipMarker(QString,QList<CommentedTime>)));
-    connect(panel, SIGNAL(editClip()), this, SLOT(slotEditClip()));
-    connect(panel, SIGNAL(editAnalysis(QString,QString,QString)), this, SLOT(slotAddClipExtraData(QString,QString,QString)));
+    m_clipPanel = new ClipPropertiesController(m_propertiesPanel);
+    connect(this, SIGNAL(refreshTimeCode()), m_clipPanel, SLOT(slotRefreshTimeCode()));
+    connect(this, SIGNAL(refreshPanelMarkers()), m_clipPanel, SLOT(slotFillMarkers()));
+    connect(m_clipPanel, SIGNAL(updateClipProperties(const QString &, QMap<QString, QString>, QMap<QString, QString>)), this, SLOT(slotEditClipCommand(const QString &, QMap<QString, QString>, QMap<QString, QString>)));
+    connect(m_clipPanel, SIGNAL(seekToFrame(int)), m_monitor, SLOT(slotSeek(int)));
+    connect(m_clipPanel, SIGNAL(addMarkers(QString,QList<CommentedTime>)), this, SLOT(slotAddClipMarker(QString,QList<CommentedTime>)));
+    connect(m_clipPanel, SIGNAL(editClip()), this, SLOT(slotEditClip()));
+    connect(m_clipPanel, SIGNAL(editAnalysis(QString,QString,QString)), this, SLOT(slotAddClipExtraData(QString,QString,QString)));
 
-    connect(panel, SIGNAL(loadMarkers(QString)), this, SLOT(slotLoadClipMarkers(QString)));
-    connect(panel, SIGNAL(saveMarkers(QString)), this, SLOT(slotSaveClipMarkers(QString)));
-    lay->addWidget(panel);
+    connect(m_clipPanel, SIGNAL(loadMarkers(QString)), this, SLOT(slotLoadClipMarkers(QString)));
+    connect(m_clipPanel, SIGNAL(saveMarkers(QString)), this, SLOT(slotSaveClipMarkers(QString)));
+    lay->addWidget(m_clipPanel);
 }
 
 
@@ -1809,13 +1947,40 @@ void Bin::slotThumbnailReady(const QString &id, const QImage &img, bool fromFile
 {
     ProjectClip *clip = m_rootFolder->clip(id);
     if (clip) {
-        clip->setThumbnail(img);
         // Save thumbnail for later reuse
         bool ok = false;
-        if (!fromFile) img.save(m_doc->getCacheDir(CacheThumbs, &ok).absoluteFilePath(clip->hash() + ".png"));
+        const QString cacheFile = m_doc->getCacheDir(CacheThumbs, &ok).absoluteFilePath(clip->hash() + ".png");
+        if (!ok) {
+            clip->setThumbnail(img);
+            return;
+        }
+        if (!fromFile && !img.save(cacheFile)) {
+            clip->setThumbnail(img);
+            return;
+        }
+        if (!fromFile) CacheIndex::fileWritten(cacheFile);
+        clip->setThumbnail(img, cacheFile);
     }
 }
 
+QIcon Bin::cacheThumbnail(const QString &id, const QPixmap &pix)
+{
+    if (pix.isNull()) {
+        m_thumbnails.remove(id);
+        return QIcon();
+    }
+    QIcon *icon = new QIcon(pix);
+    // Evicted thumbnails are decoded again from the cache folder when displayed
+    m_thumbnails.insert(id, icon, qMax(1, pix.width() * pix.height() * pix.depth() / 8 / 1024));
+    return QIcon(pix);
+}
+
+QIcon Bin::cachedThumbnail(const QString &id) const
+{
+    QIcon *icon = m_thumbnails.object(id);
+    return icon ? *icon : QIcon();
+}
+
 QStringList Bin::getBinFolderClipIds(const QString &id) const
 {
     QStringList ids;
@@ -1934,23 +2099,26 @@ void Bin::slotOpenCurrent()
 {
     ProjectClip *currentItem = getFirstSelectedClip();
     if (currentItem) {
+        m_jobManager->setVisibleClip(currentItem->clipId());
         emit openClip(currentItem->controller());
     }
 }
 
 void Bin::openProducer(ClipController *controller)
 {
+    m_jobManager->setVisibleClip(controller ? controller->clipId() : QString());
     emit openClip(controller);
 }
 
 void Bin::openProducer(ClipController *controller, int in, int out)
 {
+    m_jobManager->setVisibleClip(controller ? controller->clipId() : QString());
     emit openClip(controller, in, out);
 }
 
-void Bin::emitItemUpdated(AbstractProjectItem* item)
+void Bin::emitItemUpdated(AbstractProjectItem* item, const QVector<int> &roles)
 {
-    emit itemUpdated(item);
+    m_itemModel->onItemUpdated(item, roles);
 }
 
 void Bin::emitRefreshPanel(const QString &id)
@@ -2143,16 +2311,51 @@ void Bin::gotProxy(const QString &id, const QString &path)
     if (clip) {
         QDomDocument doc;
         clip->setProducerProperty(QStringLiteral("kdenlive:proxy"), path);
+        ProxyStore::markUsed(path);
+        if (switchToAlternateProducer(id, path)) return;
         QDomElement xml = clip->toXml(doc, true);
         if (!xml.isNull()) m_doc->getFileProperties(xml, id, 150, true);
     }
 }
 
+void Bin::slotRelinkClip(const QString &id, const QString &url)
+{
+    ProjectClip *clip = m_rootFolder->clip(id);
+    if (!clip) return;
+    QMap <QString, QString> newProps;
+    if (clip->getProducerProperty(QStringLiteral("kdenlive:proxy")).length() > 2) {
+        // The proxy was made from the old file, drop it
+        newProps.insert(QStringLiteral("kdenlive:originalurl"), url);
+        newProps.insert(QStringLiteral("kdenlive:proxy"), QString());
+    } else {
+        newProps.insert(QStringLiteral("resource"), url);
+    }
+    slotEditClipCommand(id, clip->currentProperties(newProps), newProps);
+}
+
 void Bin::reloadProducer(const QString &id, QDomElement xml)
 {
     m_doc->getFileProperties(xml, id, 150, true);
 }
 
+bool Bin::switchToAlternateProducer(const QString &id, const QString &resource)
+{
+    ProjectClip *clip = m_rootFolder->clip(id);
+    if (!clip || !clip->controller() || pCore->producerQueue()->isProcessing(id)) return false;
+    Mlt::Producer *producer = clip->controller()->takeAlternateProducer(resource);
+    if (producer == NULL) return false;
+    // The producer is already open, skip the producer queue
+    QDomDocument doc;
+    requestClipInfo info;
+    info.xml = clip->toXml(doc, true);
+    info.clipId = id;
+    info.imageHeight = 150;
+    info.replaceProducer = true;
+    pCore->binController()->replaceProducer(id, *producer);
+    slotProducerReady(info, NULL);
+    return true;
+}
+
 void Bin::refreshClip(const QString &id)
 {
     emit clipNeedsReload(id, false);
@@ -2209,6 +2412,11 @@ bool Bin::hasPendingJob(const QString &id, AbstractClipJob::JOBTYPE type)
     return m_jobManager->hasPendingJob(id, type);
 }
 
+QStringList Bin::pendingJobs(const QString &id)
+{
+    return m_jobManager->getPendingJobs(id);
+}
+
 void Bin::slotCreateProjectClip()
 {
     QAction* act = qobject_cast<QAction *>(sender());
@@ -2636,9 +2844,10 @@ void Bin::slotExpandUrl(ItemInfo info, QUrl url, QUndoCommand *command)
     pCore->projectManager()->currentTimeline()->importPlaylist(info, idMap, doc, command);
 }
 
-void Bin::slotItemEdited(QModelIndex ix,QModelIndex,QVector<int>)
+void Bin::slotItemEdited(QModelIndex ix,QModelIndex,QVector<int> roles)
 {
-    if (ix.isValid()) {
+    // Only user edits come with the edit role, batched item updates don't
+    if (ix.isValid() && roles.contains(Qt::EditRole)) {
         // Clip renamed
         AbstractProjectItem *item = static_cast<AbstractProjectItem*>(ix.internalPointer());
         ProjectClip *clip = qobject_cast<ProjectClip*>(item);  
@@ -2695,6 +2904,11 @@ void Bin::startClipJob(const QStringList &params)
     m_jobManager->prepareJobs(clips, m_doc->fps(), jobType, data);
 }
 
+void Bin::slotNormalizeAllClips()
+{
+    m_jobManager->prepareJobs(m_rootFolder->childClips(), m_doc->fps(), AbstractClipJob::FILTERCLIPJOB, QStringList() << QStringLiteral("loudness"));
+}
+
 void Bin::slotCancelRunningJob(const QString &id, const QMap<QString, QString> &newProps)
 {
     if (newProps.isEmpty()) return;
@@ -2861,8 +3075,13 @@ void Bin::slotGotFilterJobResults(QString id, int startPos, int track, stringMap
             ProjectClip *clip = getBinClip(id);
             if (clip) {
                 QString key = filterInfo.value(QStringLiteral("key"));
-                QStringList newValue = clip->updatedAnalysisData(key, results.value(key), filterInfo.value(QStringLiteral("offset")).toInt());
-                slotAddClipExtraData(id, newValue.at(0), newValue.at(1));
+                if (filterInfo.contains(QStringLiteral("dataname"))) {
+                    // Single value analysis, replace any previous result
+                    slotAddClipExtraData(id, "kdenlive:clipanalysis." + filterInfo.value(QStringLiteral("dataname")), results.value(key));
+                } else {
+                    QStringList newValue = clip->updatedAnalysisData(key, results.value(key), filterInfo.value(QStringLiteral("offset")).toInt());
+                    slotAddClipExtraData(id, newValue.at(0), newValue.at(1));
+                }
             }
         }
         if (startPos == -1) {
@@ -2889,6 +3108,17 @@ void Bin::slotGotFilterJobResults(QString id, int startPos, int track, stringMap
                 /*EditEffectCommand *command = new EditEffectCommand(this, clip->track(), clip->startPos(), effect, newEffect, clip->selectedEffectIndex(), true, true);
                 m_commandStack->push(command);
                 emit clipItemSelected(clip);*/
+            } else if (filterInfo.contains(QStringLiteral("normalize"))) {
+                // Add the effect with the analysis results so that the clip is normalized
+                QDomElement newEffect = MainWindow::audioEffects.getEffectByTag(filterInfo.value("finalfilter"), filterInfo.value("finalfilter")).cloneNode().toElement();
+                if (!newEffect.isNull()) {
+                    QMap<QString, QString>::const_iterator i = results.constBegin();
+                    while (i != results.constEnd()) {
+                        EffectsList::setParameter(newEffect, i.key(), i.value());
+                        ++i;
+                    }
+                    slotEffectDropped(id, newEffect);
+                }
             }
 
             //emit gotFilterJobResults(id, startPos, track, results, filterInfo);*/
@@ -2899,37 +3129,60 @@ void Bin::slotGotFilterJobResults(QString id, int startPos, int track, stringMap
             return;
         }
     }
+    if (results.isEmpty()) {
+        emit displayBinMessage(i18n("No data returned from clip analysis"), KMessageWidget::Warning);
+        return;
+    }
     // Currently, only the first value of results is used
+    AnalysisResult result;
+    result.values = results;
+    result.frames = AnalysisResult::parseFrames(results.value(filterInfo.value(QStringLiteral("key"))));
+    processAnalysisResult(id, result, filterInfo);
+}
+
+void Bin::slotGotAnalysisResults(const QString &id, int startPos, int track, const AnalysisResult &result, const stringMap &filterInfo)
+{
+    if (filterInfo.contains(QStringLiteral("finalfilter"))) {
+        // Effect parameters are strings
+        stringMap results = result.values;
+        if (!result.frames.isEmpty() || results.isEmpty()) {
+            results.insert(filterInfo.value(QStringLiteral("key")), result.framesData());
+        }
+        slotGotFilterJobResults(id, startPos, track, results, filterInfo);
+        return;
+    }
+    processAnalysisResult(id, result, filterInfo);
+}
+
+void Bin::processAnalysisResult(const QString &id, const AnalysisResult &result, const stringMap &filterInfo)
+{
     ProjectClip *clip = getBinClip(id);
     if (!clip) return;
     // Check for return value
     int markersType = -1;
     if (filterInfo.contains(QStringLiteral("addmarkers"))) markersType = filterInfo.value(QStringLiteral("addmarkers")).toInt();
-    if (results.isEmpty()) {
-        emit displayBinMessage(i18n("No data returned from clip analysis"), KMessageWidget::Warning);
-        return;
-    }
     bool dataProcessed = false;
     QString label = filterInfo.value(QStringLiteral("label"));
     QString key = filterInfo.value(QStringLiteral("key"));
     int offset = filterInfo.value(QStringLiteral("offset")).toInt();
-    QStringList value = results.value(key).split(';', QString::SkipEmptyParts);
-    //qDebug()<<"// RESULT; "<<key<<" = "<<value;
+    //qDebug()<<"// RESULT; "<<key<<" = "<<result.framesData();
     if (filterInfo.contains(QStringLiteral("resultmessage"))) {
         QString mess = filterInfo.value(QStringLiteral("resultmessage"));
-        mess.replace(QLatin1String("%count"), QString::number(value.count()));
+        mess.replace(QLatin1String("%count"), QString::number(result.frames.count()));
         emit displayBinMessage(mess, KMessageWidget::Information);
     }
     else emit displayBinMessage(i18n("Processing data analysis"), KMessageWidget::Information);
+    bool simpleList = filterInfo.contains(QStringLiteral("simplelist"));
     if (filterInfo.contains(QStringLiteral("cutscenes"))) {
         // Check if we want to cut scenes from returned data
         dataProcessed = true;
         int cutPos = 0;
         QUndoCommand *command = new QUndoCommand();
         command->setText(i18n("Auto Split Clip"));
-        foreach (const QString &pos, value) {
-            if (!pos.contains(QLatin1Char('='))) continue;
-            int newPos = pos.section(QLatin1Char('='), 0, 0).toInt();
+        QMapIterator<int, QString> i(result.frames);
+        while (i.hasNext()) {
+            i.next();
+            int newPos = i.key();
             // Don't use scenes shorter than 1 second
             if (newPos - cutPos < 24) continue;
             new AddBinClipCutCommand(this, id, cutPos + offset, newPos + offset, true, command);
@@ -2943,40 +3196,36 @@ void Bin::slotGotFilterJobResults(QString id, int startPos, int track, stringMap
         // Add markers from returned data
         dataProcessed = true;
         int cutPos = 0;
-        QUndoCommand *command = new QUndoCommand();
-        command->setText(i18n("Add Markers"));
         QList <CommentedTime> markersList;
         int index = 1;
-        bool simpleList = false;
         double sourceFps = clip->getOriginalFps();
         if (sourceFps == 0) {
             sourceFps = m_doc->fps();
         }
-        if (filterInfo.contains(QStringLiteral("simplelist"))) {
-            // simple list
-            simpleList = true;
-        }
-        foreach (const QString &pos, value) {
+        QMapIterator<int, QString> i(result.frames);
+        while (i.hasNext()) {
+            i.next();
+            int pos = i.key();
             if (simpleList) {
-                CommentedTime m(GenTime((int) (pos.toInt() * m_doc->fps() / sourceFps), m_doc->fps()), label + pos, markersType);
+                // simple list, positions are in source frames
+                CommentedTime m(GenTime((int) (pos * m_doc->fps() / sourceFps), m_doc->fps()), label + QString::number(pos), markersType);
                 markersList << m;
                 index++;
                 continue;
             }
-            if (!pos.contains(QStringLiteral("="))) continue;
-            int newPos = pos.section('=', 0, 0).toInt();
             // Don't use scenes shorter than 1 second
-            if (newPos - cutPos < 24) continue;
-            CommentedTime m(GenTime(newPos + offset, m_doc->fps()), label + QString::number(index), markersType);
+            if (pos - cutPos < 24) continue;
+            CommentedTime m(GenTime(pos + offset, m_doc->fps()), label + QString::number(index), markersType);
             markersList << m;
             index++;
-            cutPos = newPos;
+            cutPos = pos;
         }
         slotAddClipMarker(id, markersList);
     }
     if (!dataProcessed || filterInfo.contains(QStringLiteral("storedata"))) {
         // Store returned data as clip extra data
-        QStringList newValue = clip->updatedAnalysisData(key, results.value(key), offset);
+        QString data = result.frames.isEmpty() ? result.values.value(key) : result.framesData();
+        QStringList newValue = clip->updatedAnalysisData(key, data, offset);
         slotAddClipExtraData(id, newValue.at(0), newValue.at(1));
     }
 }
@@ -3166,9 +3415,10 @@ void Bin::showTitleWidget(ProjectClip *clip)
     QDomDocument doc;
     QString xmldata = clip->getProducerProperty(QStringLiteral("xmldata"));
     if (xmldata.isEmpty() && QFile::exists(path)) {
-        QFile file(path);
-        doc.setContent(&file, false);
-        file.close();
+        QSharedPointer<const TitleDocument::TemplateInfo> templateInfo = TitleDocument::templateInfo(path);
+        if (templateInfo) {
+            doc = templateInfo->xml.cloneNode(true).toDocument();
+        }
     } else {
         doc.setContent(xmldata);
     }
@@ -3403,7 +3653,10 @@ void Bin::refreshProxySettings()
         if (!toProxy.isEmpty()) m_doc->slotProxyCurrentItem(true, toProxy, false, masterCommand);
     }
     if (masterCommand->childCount() > 0) {
+        // Clips with an already open producer are switched immediately, update the timeline once for all of them
+        pCore->binController()->startReplacementBatch();
         m_doc->commandStack()->push(masterCommand);
+        pCore->binController()->endReplacementBatch();
     } else delete masterCommand;
 }
 
@@ -3422,10 +3675,9 @@ void Bin::slotSendAudioThumb(QString id)
 {
     ProjectClip *clip = m_rootFolder->clip(id);
     if (clip && clip->audioThumbCreated()) {
-        m_monitor->prepareAudioThumb(clip->audioChannels(), clip->audioFrameCache);
+        m_monitor->prepareAudioThumb(clip->audioLevels());
     } else {
-        QVariantList list;
-        m_monitor->prepareAudioThumb(0, list);
+        m_monitor->prepareAudioThumb(AudioLevels());
     }
 }
 
@@ -3499,20 +3751,6 @@ void Bin::getBinStats(uint *used, uint *unused, qint64 *usedSize, qint64 *unused
     }
 }
 
-QImage Bin::findCachedPixmap(const QString &path)
-{
-    QImage img;
-    m_doc->clipManager()->pixmapCache->findImage(path, &img);
-    return img;
-}
-
-void Bin::cachePixmap(const QString &path, QImage img)
-{
-    if (!m_doc->clipManager()->pixmapCache->contains(path)) {
-        m_doc->clipManager()->pixmapCache->insertImage(path, img);
-    }
-}
-
 QDir Bin::getCacheDir(CacheType type, bool *ok) const
 {
     return m_doc->getCacheDir(type, ok);
@@ -3526,10 +3764,45 @@ bool Bin::addClip(QDomElement elem, const QString &clipId)
         elem.setAttribute("checkProfile", 1);
     }
     createClip(elem);
-    m_doc->getFileProperties(elem, producerId, 150, true);
+    if (m_clipBatch > 0) {
+        requestClipInfo info;
+        info.xml = elem;
+        info.clipId = producerId;
+        info.imageHeight = 150;
+        info.replaceProducer = true;
+        m_batchRequests << info;
+    } else {
+        m_doc->getFileProperties(elem, producerId, 150, true);
+    }
     return true;
 }
 
+void Bin::beginClipBatch()
+{
+    if (m_clipBatch++ == 0) {
+        m_itemModel->beginInsertBatch();
+    }
+}
+
+void Bin::endClipBatch()
+{
+    if (m_clipBatch == 0 || --m_clipBatch > 0) return;
+    m_itemModel->endInsertBatch();
+    if (!m_batchRequests.isEmpty()) {
+        pCore->producerQueue()->getFileProperties(m_batchRequests);
+        m_batchRequests.clear();
+    }
+}
+
+void Bin::slotClipBatch(bool start)
+{
+    if (start) {
+        beginClipBatch();
+    } else {
+        endClipBatch();
+    }
+}
+
 void Bin::rebuildProxies()
 {
     QList <ProjectClip*> clipList = m_rootFolder->childClips();
@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "abstractprojectitem.h"
 #include "timecode.h"
+#include "utils/memorytracker.h"
 
 #include <KMessageWidget>
 
@@ -38,13 +39,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QListView>
 #include <QFuture>
 #include <QMutex>
+#include <QThreadPool>
 #include <QLineEdit>
 #include <QDir>
+#include <QCache>
 
 class KdenliveDoc;
 class QVBoxLayout;
 class QScrollArea;
 class ClipController;
+class ClipPropertiesController;
 class QDockWidget;
 class QTimeLine;
 class QToolBar;
@@ -136,9 +140,14 @@ private:
 
     QTimeLine* m_timeLine;
     QAction *m_action;
+    int m_jobCount;
+    /** @brief Average progress of the pending jobs, in percent. */
+    int m_jobProgress;
+    void updateLabelText();
 
 public slots:
     void slotSetJobCount(int jobCount);
+    void slotSetJobProgress(int progress);
 
 private slots:
     void slotTimeLineChanged(qreal value);
@@ -354,7 +363,7 @@ signals:
  * @brief The bin widget takes care of both item model and view upon project opening.
  */
 
-class Bin : public QWidget
+class Bin : public QWidget, public MemoryConsumer
 {
     Q_OBJECT
 
@@ -376,8 +385,18 @@ public:
     /** @brief Create a clip item from its xml description  */
     void createClip(QDomElement xml);
 
-    /** @brief Used to notify the Model View that an item was updated */
-    void emitItemUpdated(AbstractProjectItem* item);
+    /** @brief Used to notify the Model View that an item was updated
+     *  @param roles the changed data roles, empty if unknown */
+    void emitItemUpdated(AbstractProjectItem* item, const QVector<int> &roles = QVector<int>());
+
+    /** @brief Keep a clip thumbnail in the thumbnail memory cache, a null pixmap removes it */
+    QIcon cacheThumbnail(const QString &id, const QPixmap &pix);
+    /** @brief Returns a clip thumbnail from the memory cache, or a null icon if it was evicted */
+    QIcon cachedThumbnail(const QString &id) const;
+    /** @brief Returns the pool building the clip sprite sheets, one clip at a time */
+    QThreadPool *spritePool();
+    qint64 memoryUsage() const;
+    qint64 memoryBudget() const;
 
     /** @brief Set monitor associated with this bin (clipmonitor) */
     void setMonitor(Monitor *monitor);
@@ -406,9 +425,13 @@ public:
 
     /** @brief Check if there is a job waiting / running for this clip  */
     bool hasPendingJob(const QString &id, AbstractClipJob::JOBTYPE type);
+    /** @brief Returns the description of the jobs waiting / running for this clip  */
+    QStringList pendingJobs(const QString &id);
 
     /** @brief Reload / replace a producer */
     void reloadProducer(const QString &id, QDomElement xml);
+    /** @brief Replace the producer of clip @param id with its previous one if it was opened on @param resource, returns false if the clip must be reloaded */
+    bool switchToAlternateProducer(const QString &id, const QString &resource);
     
     /** @brief Current producer has changed, refresh monitor and timeline*/
     void refreshClip(const QString &id);
@@ -521,13 +544,14 @@ public:
     void getBinStats(uint *used, uint *unused, qint64 *usedSize, qint64 *unusedSize);
     /** @brief Returns the clip properties dockwidget. */
     QDockWidget *clipPropertiesDock();
-    /** @brief Returns a cached thumbnail. */
-    QImage findCachedPixmap(const QString &path);
-    void cachePixmap(const QString &path, QImage img);
     /** @brief Returns a document's cache dir. ok is set to false if folder does not exist */
     QDir getCacheDir(CacheType type, bool *ok) const;
     /** @brief Command adding a bin clip */
     bool addClip(QDomElement elem, const QString &clipId);
+    /** @brief Start adding many clips. The views are reset once and the clips are queued for loading in one
+     *  request when the matching endClipBatch() is called. Calls can be nested. */
+    void beginClipBatch();
+    void endClipBatch();
     void rebuildProxies();
     /** @brief Return a list of all clips hashes used in this project */
     QStringList getProxyHashList();
@@ -569,6 +593,10 @@ private slots:
     void slotShowJobLog();
     /** @brief process clip job result. */
     void slotGotFilterJobResults(QString ,int , int, stringMap, stringMap);
+    /** @brief process the typed results of a segmented analysis job. */
+    void slotGotAnalysisResults(const QString &id, int startPos, int track, const AnalysisResult &result, const stringMap &filterInfo);
+    /** @brief Point a clip to the file produced by a job (transcoding), undoable. */
+    void slotRelinkClip(const QString &id, const QString &url);
     /** @brief Reset all text and log data from info message widget. */
     void slotResetInfoMessage();
     /** @brief Show dialog prompting for removal of invalid clips. */
@@ -606,6 +634,8 @@ public slots:
     void slotRemoveInvalidClip(const QString &id, bool replace, const QString &errorMessage);
     /** @brief Create a folder when opening a document */
     void slotLoadFolders(QMap<QString,QString> foldersData);
+    /** @brief The project clips are being created (start is true) or all were created. */
+    void slotClipBatch(bool start);
     /** @brief Reload clip thumbnail - when frame for thumbnail changed */
     void slotRefreshClipThumbnail(const QString &id);
     void slotDeleteClip();
@@ -619,6 +649,8 @@ public slots:
     void slotStartCutJob(const QString &id);
     /** @brief Triggered by a clip job action, start the job */
     void slotStartClipJob(bool enable);
+    /** @brief Analyse the loudness of all clips in the bin and normalize them */
+    void slotNormalizeAllClips();
     void slotEditClipCommand(const QString &id, QMap<QString, QString>oldProps, QMap<QString, QString>newProps);
     void slotCancelRunningJob(const QString &id, const QMap<QString, QString> &newProps);
     /** @brief Start a filter job requested by a filter applied in timeline */
@@ -683,6 +715,10 @@ private:
     QAction *m_showDesc;
     /** @brief Holds an available unique id for a clip to be created */
     int m_clipCounter;
+    /** @brief Nesting level of beginClipBatch() calls */
+    int m_clipBatch;
+    /** @brief Clip loading requests delayed until the end of the clip batch */
+    QList <requestClipInfo> m_batchRequests;
     /** @brief Holds an available unique id for a folder to be created */
     int m_folderCounter;
     /** @brief Default view type (icon, tree, ...) */
@@ -694,9 +730,13 @@ private:
     QVBoxLayout *m_layout;
     QDockWidget *m_propertiesDock;
     QScrollArea *m_propertiesPanel;
+    /** @brief The clip properties widget, created once and reused for every clip. */
+    ClipPropertiesController *m_clipPanel;
     QSlider *m_slider;
     Monitor *m_monitor;
     QIcon m_blankThumb;
+    /** @brief Recently displayed clip thumbnails, the cost is in KB */
+    QCache<QString, QIcon> m_thumbnails;
     QMenu *m_menu;
     QAction *m_openAction;
     QAction *m_editAction;
@@ -719,15 +759,27 @@ private:
     bool m_gainedFocus;
     /** @brief List of Clip Ids that want an audio thumb. */
     QStringList m_audioThumbsList;
-    QString m_processingAudioThumb;
+    /** @brief Clip Ids whose audio thumb is being created. */
+    QStringList m_processingAudioThumbs;
     QMutex m_audioThumbMutex;
     /** @brief Total number of milliseconds to process for audio thumbnails */
     long m_audioDuration;
     /** @brief Total number of milliseconds already processed for audio thumbnails */
     long m_processedAudio;
-    /** @brief Indicates whether audio thumbnail creation is running. */
-    QFuture<void> m_audioThumbsThread;
+    /** @brief Runs the audio thumbnail workers, each one creating the thumbnails of one clip at a time. */
+    QThreadPool m_audioThumbPool;
+    /** @brief Number of running audio thumbnail workers, guarded by m_audioThumbMutex. */
+    int m_audioThumbWorkers;
+    /** @brief Number of audio thumbnail workers allowed. */
+    static int audioThumbThreads();
+    QThreadPool m_spritePool;
+    /** @brief Id of the clip whose sprite sheet is shown under the mouse. */
+    QString m_scrubClipId;
+    /** @brief Scrubs the clip thumbnail under @param pos of @param view, stops the previous scrub. */
+    void scrubClip(QAbstractItemView *view, const QPoint &pos);
     void showClipProperties(ProjectClip *clip, bool forceRefresh = false);
+    /** @brief Create the clip properties widget and connect it to the Bin. */
+    void createClipPanel();
     /** @brief Get the QModelIndex value for an item in the Bin. */
     QModelIndex getIndexForId(const QString &id, bool folderWanted) const;
     /** @brief Get a Clip item from its id. */
@@ -736,6 +788,8 @@ private:
     void showTitleWidget(ProjectClip *clip);
     void showSlideshowWidget(ProjectClip *clip);
     void processAudioThumbs();
+    /** @brief Add the markers, cuts or clip data requested by a bin analysis job. */
+    void processAnalysisResult(const QString &id, const AnalysisResult &result, const stringMap &filterInfo);
 
 signals:
     void itemUpdated(AbstractProjectItem*);
@@ -328,3 +328,27 @@ void AddClipCommand::redo()
     else
         m_bin->deleteClip(m_id);
 }
+
+BinBatchCommand::BinBatchCommand(Bin *bin, bool start, QUndoCommand * parent) :
+        QUndoCommand(parent),
+        m_bin(bin),
+        m_start(start)
+{
+}
+// virtual
+void BinBatchCommand::undo()
+{
+    // Child commands are undone in reverse order, so the end command opens the batch
+    if (m_start)
+        m_bin->endClipBatch();
+    else
+        m_bin->beginClipBatch();
+}
+// virtual
+void BinBatchCommand::redo()
+{
+    if (m_start)
+        m_bin->beginClipBatch();
+    else
+        m_bin->endClipBatch();
+}
@@ -209,6 +209,18 @@ private:
     bool m_doIt;
 };
 
+/** @brief Groups the clip additions / deletions of a macro so that the Bin model is only reset once. */
+class BinBatchCommand : public QUndoCommand
+{
+public:
+    BinBatchCommand(Bin *bin, bool start, QUndoCommand * parent = 0);
+    void undo();
+    void redo();
+private:
+    Bin *m_bin;
+    bool m_start;
+};
+
 
 #endif
 
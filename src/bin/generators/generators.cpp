@@ -30,18 +30,40 @@
 #include <QLabel>
 #include <QDialogButtonBox>
 #include <QFileDialog>
+#include <QtConcurrent>
 
 #include <KRecentDirs>
 #include <KMessageBox>
 #include "kxmlgui_version.h"
 
+// Number of preview frames kept while the dialog is open
+#define GENERATOR_PREVIEW_CACHE 32
+
+namespace {
+QImage renderPreview(Mlt::Profile *profile, const QString &tag, const QMap <QString, QString> &params, int width, int height)
+{
+    // Each render uses its own producer, the dialog keeps changing the parameters of m_producer
+    Mlt::Producer producer(*profile, tag.toUtf8().constData());
+    QMapIterator <QString, QString> i(params);
+    while (i.hasNext()) {
+        i.next();
+        producer.set(i.key().toUtf8().constData(), i.value().toUtf8().constData());
+    }
+    return KThumb::getFrame(&producer, 0, width, height);
+}
+}
+
 Generators::Generators(Monitor *monitor, const QString &path, QWidget *parent) :
       QDialog(parent)
     , m_producer(NULL)
+    , m_profile(NULL)
     , m_timePos(NULL)
     , m_container(NULL)
     , m_preview(NULL)
+    , m_previewCache(GENERATOR_PREVIEW_CACHE)
+    , m_previewPending(false)
 {
+    connect(&m_previewWatcher, SIGNAL(finished()), this, SLOT(slotPreviewReady()));
     QFile file(path);
     QDomDocument doc;
     doc.setContent(&file, false);
@@ -54,9 +76,11 @@ Generators::Generators(Monitor *monitor, const QString &path, QWidget *parent) :
         m_preview = new QLabel;
         m_preview->setMinimumSize(1, 1);
         lay->addWidget(m_preview);
-        m_producer = new Mlt::Producer(*monitor->profile(), generatorTag.toUtf8().constData());
-        m_pixmap = QPixmap::fromImage(KThumb::getFrame(m_producer, 0, monitor->profile()->width(), monitor->profile()->height()));
-        m_preview->setPixmap(m_pixmap.scaledToWidth(m_preview->width()));
+        m_tag = generatorTag;
+        m_profile = monitor->profile();
+        m_producer = new Mlt::Producer(*m_profile, generatorTag.toUtf8().constData());
+        m_previewSize = QSize(m_profile->width(), m_profile->height());
+        requestPreview();
         QHBoxLayout *hlay = new QHBoxLayout;
         hlay->addWidget(new QLabel(i18n("Duration")));
         m_timePos = new TimecodeDisplay(monitor->timecode(), this);
@@ -89,10 +113,56 @@ void Generators::updateProducer(QDomElement,QDomElement effect,int)
         QString paramName = pa.attribute(QStringLiteral("name"));
         QString paramValue = pa.attribute(QStringLiteral("value"));
         m_producer->set(paramName.toUtf8().constData(), paramValue.toUtf8().constData());
+        m_params.insert(paramName, paramValue);
+    }
+    requestPreview();
+}
+
+QString Generators::previewKey() const
+{
+    QString key;
+    QMapIterator <QString, QString> i(m_params);
+    while (i.hasNext()) {
+        i.next();
+        key.append(i.key() + QLatin1Char('=') + i.value() + QLatin1Char('\n'));
+    }
+    return key;
+}
+
+void Generators::requestPreview()
+{
+    const QString key = previewKey();
+    QImage *cached = m_previewCache.object(key);
+    if (cached) {
+        m_previewPending = false;
+        showPreview(*cached);
+        return;
     }
-    int w = m_pixmap.width();
-    int h = m_pixmap.height();
-    m_pixmap = QPixmap::fromImage(KThumb::getFrame(m_producer, 0, w, h));
+    if (m_previewWatcher.isRunning()) {
+        // Only the latest parameters are rendered once the running preview is done
+        m_previewPending = true;
+        return;
+    }
+    m_previewPending = false;
+    m_previewKey = key;
+    m_previewWatcher.setFuture(QtConcurrent::run(renderPreview, m_profile, m_tag, m_params, m_previewSize.width(), m_previewSize.height()));
+}
+
+void Generators::slotPreviewReady()
+{
+    const QImage image = m_previewWatcher.result();
+    m_previewCache.insert(m_previewKey, new QImage(image), 1);
+    if (m_previewPending) {
+        // Parameters changed during the render, this frame is outdated
+        requestPreview();
+    } else {
+        showPreview(image);
+    }
+}
+
+void Generators::showPreview(const QImage &image)
+{
+    m_pixmap = QPixmap::fromImage(image);
     m_preview->setPixmap(m_pixmap.scaledToWidth(m_preview->width()));
 }
 
@@ -104,6 +174,7 @@ void Generators::resizeEvent(QResizeEvent * event)
 
 Generators::~Generators()
 {
+    m_previewWatcher.waitForFinished();
     delete m_producer;
     delete m_timePos;
 }
@@ -150,6 +221,7 @@ void Generators::updateDuration(int duration)
 {
     m_producer->set("length", duration);
     m_producer->set_in_and_out(0, duration - 1);
+    m_params.insert(QStringLiteral("length"), QString::number(duration));
     updateProducer();
 }
 
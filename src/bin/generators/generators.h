@@ -25,6 +25,10 @@
 #include <QPixmap>
 #include <QMenu>
 #include <QDomElement>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QMap>
 
 /**
  * @class Generators
@@ -34,6 +38,7 @@
 
 namespace Mlt {
     class Producer;
+    class Profile;
 }
 
 class QLabel;
@@ -58,14 +63,31 @@ public:
 
 private:
     Mlt::Producer *m_producer;
+    Mlt::Profile *m_profile;
     TimecodeDisplay *m_timePos;
     ParameterContainer *m_container;
     QLabel *m_preview;
     QPixmap m_pixmap;
+    QString m_tag;
+    /** @brief Producer properties changed by the dialog, applied to the preview producers */
+    QMap <QString, QString> m_params;
+    QSize m_previewSize;
+    /** @brief Preview frames already rendered, keyed by parameter set */
+    QCache <QString, QImage> m_previewCache;
+    QFutureWatcher <QImage> m_previewWatcher;
+    /** @brief Parameter set of the running preview render */
+    QString m_previewKey;
+    /** @brief True if the parameters changed while a preview was rendering */
+    bool m_previewPending;
+    QString previewKey() const;
+    /** @brief Shows the preview of the current parameters, rendering it in the background if needed. */
+    void requestPreview();
+    void showPreview(const QImage &image);
 
 private slots:
     void updateProducer(QDomElement old = QDomElement(),QDomElement effect = QDomElement(),int ix = 0);
     void updateDuration(int duration);
+    void slotPreviewReady();
 };
 
 #endif
@@ -33,22 +33,45 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "lib/audio/audioStreamInfo.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/clippropertiescontroller.h"
+#include "mltcontroller/probecache.h"
+#include "mltcontroller/bincontroller.h"
+#include "audiopeakextractor.h"
+#include "core.h"
+#include "doc/thumbnailcache.h"
+#include "doc/proxystore.h"
+#include "doc/cacheindex.h"
+#include "doc/projectdatastore.h"
 
 #include <QDomElement>
 #include <QFile>
 #include <QDir>
 #include <QDebug>
 #include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QThread>
 #include <QtConcurrent>
 #include <KLocalizedString>
 #include <KMessageBox>
 
+// Number of frames decoded between two progress updates of the audio thumbnail
+#define AUDIO_BLOCK_FRAMES 250
+// Minimum delay in milliseconds between two partial audio thumbnail updates
+#define PARTIAL_LEVELS_INTERVAL 1000
+// Frames per row and rows of the sprite sheet used to scrub clips in the Bin
+#define SPRITE_COLUMNS 4
+#define SPRITE_ROWS 4
+#define SPRITE_FRAMES (SPRITE_COLUMNS * SPRITE_ROWS)
+// Height of the sprite sheet frames
+#define SPRITE_HEIGHT 90
 
 ProjectClip::ProjectClip(const QString &id, QIcon thumb, ClipController *controller, ProjectFolder* parent) :
     AbstractProjectItem(AbstractProjectItem::ClipItem, id, parent)
     , m_abortAudioThumb(false)
     , m_controller(controller)
     , m_thumbsProducer(NULL)
+    , m_keyframeProducer(NULL)
+    , m_abortSprite(false)
+    , m_scrubTile(-1)
 {
     m_clipStatus = StatusReady;
     m_name = m_controller->clipName();
@@ -67,7 +90,9 @@ ProjectClip::ProjectClip(const QString &id, QIcon thumb, ClipController *control
     connect(this, &ProjectClip::updateJobStatus, this, &ProjectClip::setJobStatus);
     bin()->loadSubClips(id, m_controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipzone.")));
     connect(this, &ProjectClip::updateThumbProgress, bin(), &Bin::doUpdateThumbsProgress);
+    MemoryTracker::self()->addConsumer(this, "Memory audio levels", i18n("Audio levels"));
     createAudioThumbs();
+    createSpriteSheet();
 }
 
 ProjectClip::ProjectClip(const QDomElement& description, QIcon thumb, ProjectFolder* parent) :
@@ -76,6 +101,9 @@ ProjectClip::ProjectClip(const QDomElement& description, QIcon thumb, ProjectFol
     , m_controller(NULL)
     , m_type(Unknown)
     , m_thumbsProducer(NULL)
+    , m_keyframeProducer(NULL)
+    , m_abortSprite(false)
+    , m_scrubTile(-1)
 {
     Q_ASSERT(description.hasAttribute("id"));
     m_clipStatus = StatusWaiting;
@@ -98,6 +126,7 @@ ProjectClip::ProjectClip(const QDomElement& description, QIcon thumb, ProjectFol
     connect(this, &ProjectClip::updateJobStatus, this, &ProjectClip::setJobStatus);
     setParent(parent);
     connect(this, &ProjectClip::updateThumbProgress, bin(), &Bin::doUpdateThumbsProgress);
+    MemoryTracker::self()->addConsumer(this, "Memory audio levels", i18n("Audio levels"));
 }
 
 
@@ -111,8 +140,11 @@ ProjectClip::~ProjectClip()
     m_requestedThumbs.clear();
     m_thumbMutex.unlock();
     m_thumbThread.waitForFinished();
+    m_abortSprite = true;
+    m_spriteThread.waitForFinished();
     delete m_thumbsProducer;
-    audioFrameCache.clear();
+    delete m_keyframeProducer;
+    m_audioLevels.clear();
 }
 
 void ProjectClip::abortAudioThumbs()
@@ -139,12 +171,18 @@ QString ProjectClip::getXmlProperty(const QDomElement &producer, const QString &
     return value;
 }
 
-void ProjectClip::updateAudioThumbnail(QVariantList audioLevels)
+void ProjectClip::updateAudioThumbnail(const AudioLevels &audioLevels)
 {
-    audioFrameCache = audioLevels;
-    m_controller->audioThumbCreated = true;
+    // Partial levels grow from the previous ones, only the new frames need a repaint
+    const int readyFrames = m_audioLevels.isComplete() ? 0 : m_audioLevels.frames();
+    m_audioLevels = audioLevels;
     bin()->emitRefreshAudioThumbs(m_id);
-    emit gotAudioData();
+    if (audioLevels.isComplete()) {
+        m_controller->audioThumbCreated = true;
+        emit gotAudioData();
+    } else {
+        emit audioLevelsReady(qMin(readyFrames, audioLevels.frames()), audioLevels.frames());
+    }
 }
 
 QList < CommentedTime > ProjectClip::commentedSnapMarkers() const
@@ -159,6 +197,16 @@ QStringList ProjectClip::markersText(GenTime in, GenTime out) const
     return QStringList();
 }
 
+const AudioLevels ProjectClip::audioLevels() const
+{
+    return m_audioLevels;
+}
+
+qint64 ProjectClip::memoryUsage() const
+{
+    return m_audioLevels.byteCount();
+}
+
 bool ProjectClip::audioThumbCreated() const
 {
     return (m_controller && m_controller->audioThumbCreated);
@@ -302,7 +350,26 @@ QDomElement ProjectClip::toXml(QDomDocument& document, bool includeMeta)
     }
 }
 
-void ProjectClip::setThumbnail(QImage img)
+void ProjectClip::setThumbnail(QImage img, const QString &cacheFile)
+{
+    m_thumbnailFile = cacheFile;
+    if (!cacheFile.isEmpty()) {
+        m_thumbnail = QIcon();
+        if (img.isNull()) {
+            // Decode it only once displayed
+            bin()->cacheThumbnail(m_id, QPixmap());
+        } else {
+            bin()->cacheThumbnail(m_id, decoratedThumbnail(img));
+            emit thumbUpdated(img);
+        }
+    } else {
+        m_thumbnail = QIcon(decoratedThumbnail(img));
+        emit thumbUpdated(img);
+    }
+    bin()->emitItemUpdated(this, QVector<int>() << AbstractProjectItem::DataThumbnail);
+}
+
+QPixmap ProjectClip::decoratedThumbnail(const QImage &img)
 {
     QPixmap thumb = roundedPixmap(QPixmap::fromImage(img));
     if (hasProxy() && !thumb.isNull()) {
@@ -318,14 +385,28 @@ void ProjectClip::setThumbnail(QImage img)
         p.setPen(Qt::black);
         p.drawText(r, Qt::AlignCenter, i18nc("The first letter of Proxy, used as abbreviation", "P"));
     }
-    m_thumbnail = QIcon(thumb);
-    emit thumbUpdated(img);
-    bin()->emitItemUpdated(this);
+    return thumb;
+}
+
+QIcon ProjectClip::thumbnailIcon()
+{
+    if (m_thumbnailFile.isEmpty()) {
+        return m_thumbnail;
+    }
+    QIcon icon = bin()->cachedThumbnail(m_id);
+    if (icon.isNull()) {
+        QImage img(m_thumbnailFile);
+        if (img.isNull()) {
+            return m_thumbnail;
+        }
+        icon = bin()->cacheThumbnail(m_id, decoratedThumbnail(img));
+    }
+    return icon;
 }
 
 QPixmap ProjectClip::thumbnail(int width, int height)
 {
-    return m_thumbnail.pixmap(width, height);
+    return thumbnailIcon().pixmap(width, height);
 }
 
 bool ProjectClip::setProducer(ClipController *controller, bool replaceProducer)
@@ -362,6 +443,7 @@ bool ProjectClip::setProducer(ClipController *controller, bool replaceProducer)
     // Make sure we have a hash for this clip
     hash();
     createAudioThumbs();
+    createSpriteSheet();
     return isNewProducer;
 }
 
@@ -378,6 +460,7 @@ Mlt::Producer *ProjectClip::originalProducer()
     if (!m_controller) {
         return NULL;
     }
+    pCore->binController()->touchProducer(m_id);
     return &m_controller->originalProducer();
 }
 
@@ -406,6 +489,121 @@ Mlt::Producer *ProjectClip::thumbProducer()
     return m_thumbsProducer;
 }
 
+Mlt::Producer *ProjectClip::keyframeProducer()
+{
+    QMutexLocker locker(&m_producerMutex);
+    if (!m_keyframeProducer) {
+        m_keyframeProducer = buildKeyframeProducer();
+    }
+    return m_keyframeProducer;
+}
+
+Mlt::Producer *ProjectClip::buildKeyframeProducer()
+{
+    if (!m_controller || (m_controller->clipType() != AV && m_controller->clipType() != Video)) {
+        return NULL;
+    }
+    Mlt::Producer prod = m_controller->originalProducer();
+    if (!prod.is_valid() || !QString(prod.get("mlt_service")).startsWith(QLatin1String("avformat")))
+        return NULL;
+    Clip clip(prod);
+    Mlt::Producer *keyProd = clip.softClone(ClipController::getPassPropertiesList());
+    // Applied to the decoder when it opens: a seek then returns the first keyframe
+    // at or after the position instead of decoding the whole GOP
+    keyProd->set("skip_frame", "nokey");
+    if (KdenliveSettings::gpu_accel()) {
+        Mlt::Filter scaler(*prod.profile(), "swscale");
+        Mlt::Filter converter(*prod.profile(), "avcolor_space");
+        keyProd->attach(scaler);
+        keyProd->attach(converter);
+    }
+    return keyProd;
+}
+
+void ProjectClip::createSpriteSheet()
+{
+    if ((m_type != AV && m_type != Video) || m_spriteThread.isRunning()) {
+        return;
+    }
+    m_abortSprite = false;
+    m_spriteThread = QtConcurrent::run(bin()->spritePool(), this, &ProjectClip::doCreateSpriteSheet);
+}
+
+void ProjectClip::doCreateSpriteSheet()
+{
+    const QString clipHash = hash();
+    if (!pCore->thumbnailCache()->sprite(clipHash, SPRITE_HEIGHT).isNull()) {
+        return;
+    }
+    // Own decoder, the sheet is built while the other thumbnail threads keep theirs
+    Mlt::Producer *prod = buildKeyframeProducer();
+    if (prod == NULL) {
+        return;
+    }
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+    const int frameWidth = SPRITE_HEIGHT * prod->profile()->dar() + 0.5;
+    const int length = prod->get_length();
+    QImage sheet(frameWidth * SPRITE_COLUMNS, SPRITE_HEIGHT * SPRITE_ROWS, QImage::Format_RGB32);
+    sheet.fill(Qt::black);
+    QPainter painter(&sheet);
+    bool complete = length > 0;
+    for (int i = 0; i < SPRITE_FRAMES && complete && !m_abortSprite; ++i) {
+        // Middle of each part of the clip, the producer returns the next keyframe
+        prod->seek((2 * i + 1) * length / (2 * SPRITE_FRAMES));
+        Mlt::Frame *frame = prod->get_frame();
+        if (frame && frame->is_valid()) {
+            frame->set("deinterlace_method", "onefield");
+            frame->set("top_field_first", -1 );
+            painter.drawImage((i % SPRITE_COLUMNS) * frameWidth, (i / SPRITE_COLUMNS) * SPRITE_HEIGHT, KThumb::getFrame(frame, frameWidth, SPRITE_HEIGHT));
+        } else {
+            complete = false;
+        }
+        delete frame;
+    }
+    painter.end();
+    delete prod;
+    QThread::currentThread()->setPriority(QThread::NormalPriority);
+    if (complete && !m_abortSprite) {
+        pCore->thumbnailCache()->insertSprite(clipHash, SPRITE_HEIGHT, sheet);
+        QMetaObject::invokeMethod(this, "slotSpriteReady", Qt::QueuedConnection);
+    }
+}
+
+void ProjectClip::slotSpriteReady()
+{
+    if (m_scrubTile < 0) {
+        return;
+    }
+    m_scrubSprite = pCore->thumbnailCache()->sprite(hash(), SPRITE_HEIGHT);
+    bin()->emitItemUpdated(this, QVector<int>() << AbstractProjectItem::DataThumbnail);
+}
+
+void ProjectClip::setScrubPosition(double ratio)
+{
+    const int tile = ratio < 0 ? -1 : qBound(0, (int) (ratio * SPRITE_FRAMES), SPRITE_FRAMES - 1);
+    if (tile == m_scrubTile) {
+        return;
+    }
+    if (tile < 0) {
+        m_scrubSprite = QImage();
+    } else if (m_scrubTile < 0) {
+        // The sheet is fetched once when the hover starts
+        m_scrubSprite = pCore->thumbnailCache()->sprite(hash(), SPRITE_HEIGHT);
+        if (m_scrubSprite.isNull()) {
+            createSpriteSheet();
+        }
+    }
+    m_scrubTile = tile;
+    bin()->emitItemUpdated(this, QVector<int>() << AbstractProjectItem::DataThumbnail);
+}
+
+QIcon ProjectClip::scrubIcon()
+{
+    const int width = m_scrubSprite.width() / SPRITE_COLUMNS;
+    const int height = m_scrubSprite.height() / SPRITE_ROWS;
+    return QIcon(decoratedThumbnail(m_scrubSprite.copy((m_scrubTile % SPRITE_COLUMNS) * width, (m_scrubTile / SPRITE_COLUMNS) * height, width, height)));
+}
+
 ClipController *ProjectClip::controller()
 {
     return m_controller;
@@ -547,21 +745,11 @@ const QString ProjectClip::getFileHash() const
           fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
           break;
       default:
-          QFile file(m_controller ? m_controller->clipUrl().toLocalFile() : m_temporaryUrl.toLocalFile());
-          if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-              /*
-               * 1 MB = 1 second per 450 files (or faster)
-               * 10 MB = 9 seconds per 450 files (or faster)
-               */
-            if (file.size() > 2000000) {
-                fileData = file.read(1000000);
-                if (file.seek(file.size() - 1000000))
-                    fileData.append(file.readAll());
-            } else
-                fileData = file.readAll();
-            file.close();
-            if (m_controller) m_controller->setProperty(QStringLiteral("kdenlive:file_size"), QString::number(file.size()));
-            fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+          QString path = m_controller ? m_controller->clipUrl().toLocalFile() : m_temporaryUrl.toLocalFile();
+          // The proxy store uses the same hash to share proxies between projects
+          fileHash = QByteArray::fromHex(ProxyStore::fileHash(path).toLatin1());
+          if (!fileHash.isEmpty() && m_controller) { // write size only if resource points to a file
+              m_controller->setProperty(QStringLiteral("kdenlive:file_size"), QString::number(QFileInfo(path).size()));
           }
           break;
     }
@@ -569,6 +757,8 @@ const QString ProjectClip::getFileHash() const
     QString result = fileHash.toHex();
     if (m_controller) {
 	m_controller->setProperty(QStringLiteral("kdenlive:file_hash"), result);
+	// Remember probe results so that the file doesn't need to be opened on next project load
+	ProbeCache::store(result, m_controller->clipUrl().toLocalFile(), m_controller->originalProducer());
     }
     return result;
 }
@@ -621,7 +811,7 @@ void ProjectClip::setProperties(QMap <QString, QString> properties, bool refresh
             if (bin()->hasPendingJob(m_id, AbstractClipJob::PROXYJOB)) {
                 bin()->discardJobs(m_id, AbstractClipJob::PROXYJOB);
             }
-            else {
+            else if (!bin()->switchToAlternateProducer(m_id, url().toLocalFile())) {
                 reloadProducer();
             }
         }
@@ -683,16 +873,15 @@ void ProjectClip::setJobStatus(int jobType, int status, int progress, const QStr
             bin()->emitMessage(statusMessage, 100, OperationCompletedMessage);
         }
     }
-    bin()->emitItemUpdated(this);
+    bin()->emitItemUpdated(this, QVector<int>() << AbstractProjectItem::JobType << AbstractProjectItem::JobProgress << AbstractProjectItem::JobMessage << AbstractProjectItem::ClipStatus);
 }
 
 
-ClipPropertiesController *ProjectClip::buildProperties(QWidget *parent)
+void ProjectClip::attachProperties(ClipPropertiesController *panel)
 {
-    ClipPropertiesController *panel = new ClipPropertiesController(bin()->projectTimecode(), m_controller, parent);
-    connect(this, SIGNAL(refreshPropertiesPanel()), panel, SLOT(slotReloadProperties()));
-    connect(this, SIGNAL(refreshAnalysisPanel()), panel, SLOT(slotFillAnalysisData()));
-    return panel;
+    panel->setController(bin()->projectTimecode(), m_controller);
+    connect(this, SIGNAL(refreshPropertiesPanel()), panel, SLOT(slotReloadProperties()), Qt::UniqueConnection);
+    connect(this, SIGNAL(refreshAnalysisPanel()), panel, SLOT(slotFillAnalysisData()), Qt::UniqueConnection);
 }
 
 void ProjectClip::updateParentInfo(const QString &folderid, const QString &foldername)
@@ -820,22 +1009,31 @@ QVariant ProjectClip::data(DataType type) const
       case AbstractProjectItem::IconOverlay:
             return m_controller != NULL ? (m_controller->hasEffects() ? QVariant("kdenlive-track_has_effect") : QVariant()) : QVariant();
             break;
+      case AbstractProjectItem::DataThumbnail:
+            if (m_scrubTile >= 0 && !m_scrubSprite.isNull()) {
+                return QVariant(const_cast<ProjectClip *>(this)->scrubIcon());
+            }
+            return QVariant(const_cast<ProjectClip *>(this)->thumbnailIcon());
+            break;
         default:
 	    break;
     }
     return AbstractProjectItem::data(type);
 }
 
-void ProjectClip::slotQueryIntraThumbs(QList <int> frames)
+void ProjectClip::slotQueryIntraThumbs(QList <int> frames, bool replace)
 {
     QMutexLocker lock(&m_intraThumbMutex);
+    if (replace) {
+        m_intraThumbs.clear();
+    }
     for (int i = 0; i < frames.count(); i++) {
         if (!m_intraThumbs.contains(frames.at(i))) {
             m_intraThumbs << frames.at(i);
         }
     }
     qSort(m_intraThumbs);
-    if (!m_intraThread.isRunning()) {
+    if (!m_intraThread.isRunning() && !m_intraThumbs.isEmpty()) {
         m_intraThread = QtConcurrent::run(this, &ProjectClip::doExtractIntra);
     }
 }
@@ -847,14 +1045,19 @@ void ProjectClip::doExtractIntra()
     int fullWidth = 150 * prod->profile()->dar() + 0.5;
     double dar = prod->profile()->dar();
     int max = prod->get_length();
+    const QString clipHash = hash();
     int pos;
-    while (!m_intraThumbs.isEmpty()) {
+    forever {
+        // The queue may be replaced at any time by the timeline prefetcher
         m_intraThumbMutex.lock();
+        if (m_intraThumbs.isEmpty()) {
+            m_intraThumbMutex.unlock();
+            break;
+        }
         pos = m_intraThumbs.takeFirst();
         m_intraThumbMutex.unlock();
         if (pos >= max) pos = max - 1;
-        const QString path = url().path() + '_' + QString::number(pos);
-        QImage img = bin()->findCachedPixmap(path);
+        QImage img = pCore->thumbnailCache()->image(clipHash, pos, 150);
         if (!img.isNull()) {
             // Cache already contains image
             continue;
@@ -865,7 +1068,7 @@ void ProjectClip::doExtractIntra()
         frame->set("top_field_first", -1 );
 	if (frame && frame->is_valid()) {
             img = KThumb::getFrame(frame, fullWidth, 150);
-            bin()->cachePixmap(path, img);
+            pCore->thumbnailCache()->insert(clipHash, pos, 150, img);
             emit thumbReady(pos, img);
         }
         delete frame;
@@ -891,36 +1094,56 @@ void ProjectClip::doExtractImage()
 {
     Mlt::Producer *prod = thumbProducer();
     if (prod == NULL || !prod->is_valid()) return;
+    // Keyframe previews are shown first, exact frames are decoded once no request is pending
+    Mlt::Producer *keyProd = KdenliveSettings::fastthumbs() ? keyframeProducer() : NULL;
     int frameWidth = 150 * prod->profile()->dar() + 0.5;
     bool ok = false;
     QDir thumbFolder = bin()->getCacheDir(CacheThumbs, &ok);
     int max = prod->get_length();
-    while (!m_requestedThumbs.isEmpty()) {
+    const QString clipHash = hash();
+    QList <int> refine;
+    forever {
         m_thumbMutex.lock();
-        int pos = m_requestedThumbs.takeFirst();
+        bool refining = m_requestedThumbs.isEmpty();
+        if (refining && refine.isEmpty()) {
+            m_thumbMutex.unlock();
+            break;
+        }
+        int pos = refining ? refine.takeFirst() : m_requestedThumbs.takeFirst();
         m_thumbMutex.unlock();
-        if (ok && thumbFolder.exists(hash() + '#' + QString::number(pos) + ".png")) {
-            emit thumbReady(pos, QImage(thumbFolder.absoluteFilePath(hash() + '#' + QString::number(pos) + ".png")));
+        QThread::currentThread()->setPriority(refining ? QThread::IdlePriority : QThread::NormalPriority);
+        if (ok && thumbFolder.exists(clipHash + '#' + QString::number(pos) + ".png")) {
+            if (!refining) {
+                emit thumbReady(pos, QImage(thumbFolder.absoluteFilePath(clipHash + '#' + QString::number(pos) + ".png")));
+            }
             continue;
         }
         if (pos >= max) pos = max - 1;
-        const QString path = url().path() + '_' + QString::number(pos);
-        QImage img = bin()->findCachedPixmap(path);
+        QImage img = pCore->thumbnailCache()->image(clipHash, pos, 150);
         if (!img.isNull()) {
-            emit thumbReady(pos, img);
+            if (!refining) {
+                emit thumbReady(pos, img);
+            }
             continue;
         }
-	prod->seek(pos);
-	Mlt::Frame *frame = prod->get_frame();
-        frame->set("deinterlace_method", "onefield");
-        frame->set("top_field_first", -1 );
-	if (frame && frame->is_valid()) {
+        Mlt::Producer *source = (refining || keyProd == NULL) ? prod : keyProd;
+        source->seek(pos);
+        Mlt::Frame *frame = source->get_frame();
+        if (frame && frame->is_valid()) {
+            frame->set("deinterlace_method", "onefield");
+            frame->set("top_field_first", -1 );
             img = KThumb::getFrame(frame, frameWidth, 150);
-            bin()->cachePixmap(path, img);
+            if (source == prod) {
+                // Only exact frames are cached
+                pCore->thumbnailCache()->insert(clipHash, pos, 150, img);
+            } else if (!refine.contains(pos)) {
+                refine << pos;
+            }
             emit thumbReady(pos, img);
         }
         delete frame;
     }
+    QThread::currentThread()->setPriority(QThread::NormalPriority);
 }
 
 int ProjectClip::audioChannels() const
@@ -936,7 +1159,7 @@ void ProjectClip::discardAudioThumb()
     QString audioThumbPath = getAudioThumbPath(m_controller->audioInfo());
     if (!audioThumbPath.isEmpty())
         QFile::remove(audioThumbPath);
-    audioFrameCache.clear();
+    m_audioLevels.clear();
     qDebug()<<"////////////////////  DISCARD AUIIO THUMBNS";
     m_controller->audioThumbCreated = false;
     m_abortAudioThumb = false;
@@ -957,7 +1180,7 @@ const QString ProjectClip::getAudioThumbPath(AudioStreamInfo *audioInfo)
         audioPath.append("_" + QString::number(audioInfo->audio_index()));
     }
     int roundedFps = (int) m_controller->profile()->fps();
-    audioPath.append(QString("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QString("_%1_audio.levels").arg(roundedFps));
     return audioPath;
 }
 
@@ -976,24 +1199,29 @@ void ProjectClip::slotCreateAudioThumbs()
     if (frequency <= 0) frequency = 48000;
     int channels = audioInfo->channels();
     if (channels <= 0) channels = 2;
-    QVariantList audioLevels;
-    QImage image(audioPath);
-    if (!image.isNull()) {
-        // convert cached image
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p = image.pixel(i / channels, i % channels);
-            audioLevels << qRed(p);
-            audioLevels << qGreen(p);
-            audioLevels << qBlue(p);
-            audioLevels << qAlpha(p);
+    AudioLevels cachedLevels;
+    if (!cachedLevels.load(audioPath)) {
+        // Convert audio thumbnail cached as image by previous versions
+        QString imagePath = audioPath.section(QLatin1Char('.'), 0, -2) + QStringLiteral(".png");
+        if (QFile::exists(imagePath)) {
+            AudioLevels converted = AudioLevels::fromImage(imagePath, channels);
+            if (converted.save(audioPath)) {
+                CacheIndex::fileWritten(audioPath);
+                CacheIndex::removeFile(imagePath);
+                cachedLevels.load(audioPath);
+            } else {
+                cachedLevels = converted;
+            }
         }
     }
-    if (audioLevels.size() > 0) {
+    if (!cachedLevels.isEmpty()) {
         emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
-        updateAudioThumbnail(audioLevels);
+        // Only the shared levels reference crosses to the GUI thread
+        QMetaObject::invokeMethod(this, "updateAudioThumbnail", Qt::QueuedConnection, Q_ARG(AudioLevels, cachedLevels));
         return;
     }
+    QByteArray audioLevels;
+    audioLevels.reserve(lengthInFrames * channels);
     bool jobFinished = false;
     if (KdenliveSettings::ffmpegaudiothumbnails() && m_type != Playlist) {
         QStringList args;
@@ -1064,9 +1292,8 @@ void ProjectClip::slotCreateAudioThumbs()
 
         if (!ffmpegError && audioThumbsProcess.exitStatus() != QProcess::CrashExit) {
             int dataSize = 0;
-            QList <const qint16*> rawChannels;
+            QVector <const qint16*> rawChannels;
             QList <QByteArray> sourceChannels;
-            QList<qint16> data2;
             for (int i = 0; i < channelFiles.count(); i++) {
                 channelFiles[i]->open();
                 QByteArray res = channelFiles[i]->readAll();
@@ -1089,8 +1316,10 @@ void ProjectClip::slotCreateAudioThumbs()
                 sourceChannels << res;
             }
             int progress = 0;
-            QList <long> channelsData;
-            double offset = (double) dataSize / (2.0 * lengthInFrames);
+            // Files hold 16 bit samples
+            const int sampleCount = dataSize / 2;
+            const int channelCount = rawChannels.count();
+            double offset = (double) sampleCount / lengthInFrames;
             int intraOffset = 1;
             if (offset > 1000) {
                 intraOffset = offset / 60;
@@ -1098,22 +1327,22 @@ void ProjectClip::slotCreateAudioThumbs()
                 intraOffset = offset / 10;
             }
             double factor = 800.0 / 32768;
+            // Levels are written in place, frame -> channel -> level as AudioLevels stores them
+            audioLevels.resize(lengthInFrames * channelCount);
+            char *levelData = audioLevels.data();
             for (int i = 0; i < lengthInFrames; i++) {
-                channelsData.clear();
-                for (int k = 0; k < rawChannels.count(); k++) {
-                    channelsData << 0;
-                }
-                int pos = (int) (i * offset);
-                int steps = 0;
-                for (int j = 0; j < (int) offset && (pos + j < dataSize); j += intraOffset) {
-                    steps ++;
-                    for (int k = 0; k < rawChannels.count(); k++) {
-                        channelsData[k] += abs(rawChannels[k][pos + j]);
+                const int pos = (int) (i * offset);
+                const int end = qMin(pos + (int) offset, sampleCount);
+                for (int k = 0; k < channelCount; k++) {
+                    const qint16 *samples = rawChannels.at(k);
+                    long sum = 0;
+                    int steps = 0;
+                    for (int j = pos; j < end; j += intraOffset) {
+                        sum += abs(samples[j]);
+                        steps++;
                     }
-                }
-                for (int k = 0; k < channelsData.count(); k++) {
-                    if (steps) channelsData[k] /= steps;
-                    audioLevels << channelsData[k] * factor;
+                    if (steps) sum /= steps;
+                    levelData[i * channelCount + k] = (char) qMin(sum * factor, 255.0);
                 }
                 int p = 80 + (i * 20 / lengthInFrames);
                 if (p != progress) {
@@ -1132,80 +1361,45 @@ void ProjectClip::slotCreateAudioThumbs()
         }
     }
     if (!jobFinished && !m_abortAudioThumb) {
-        // MLT audio thumbs: slower but safer
-        QString service = prod->get("mlt_service");
-        if (service == QLatin1String("avformat-novalidate"))
-        service = QStringLiteral("avformat");
-        else if (service.startsWith(QLatin1String("xml")))
-            service = QStringLiteral("xml-nogl");
-        QScopedPointer <Mlt::Producer> audioProducer(new Mlt::Producer(*prod->profile(), service.toUtf8().constData(), prod->get("resource")));
-        if (!audioProducer->is_valid()) {
+        // Decode the audio only, in process, and publish the levels while the clip is read
+        AudioPeakExtractor extractor(prod, channels, frequency);
+        if (!extractor.isValid()) {
             return;
         }
-        audioProducer->set("video_index", "-1");
-        Mlt::Filter chans(*prod->profile(), "audiochannels");
-        Mlt::Filter converter(*prod->profile(), "audioconvert");
-        Mlt::Filter levels(*prod->profile(), "audiolevel");
-        audioProducer->attach(chans);
-        audioProducer->attach(converter);
-        audioProducer->attach(levels);
-
-        int last_val = 0;
         emit updateJobStatus(AbstractClipJob::THUMBJOB, JobWaiting, 0);
-        double framesPerSecond = audioProducer->get_fps();
-        mlt_audio_format audioFormat = mlt_audio_s16;
-        QStringList keys;
-        for (int i = 0; i < channels; i++) {
-            keys << "meta.media.audio_level." + QString::number(i);
-        }
-
-        for (int z = 0;z < lengthInFrames && !m_abortAudioThumb; ++z) {
-            int val = (int)(100.0 * z / lengthInFrames);
+        // Levels are written in place in a buffer of the clip size
+        audioLevels.fill(0, lengthInFrames * channels);
+        int last_val = 0;
+        QElapsedTimer publishTimer;
+        publishTimer.start();
+        while (extractor.position() < lengthInFrames && !m_abortAudioThumb) {
+            const int pos = extractor.position();
+            if (extractor.readBlock(audioLevels.data() + pos * channels, AUDIO_BLOCK_FRAMES) == 0) {
+                break;
+            }
+            int val = (int)(100.0 * extractor.position() / lengthInFrames);
             if (last_val != val) {
                 emit updateJobStatus(AbstractClipJob::THUMBJOB, JobWorking, val);
                 last_val = val;
             }
-            QScopedPointer<Mlt::Frame> mlt_frame(audioProducer->get_frame());
-            if (mlt_frame && mlt_frame->is_valid() && !mlt_frame->get_int("test_audio")) {
-                int samples = mlt_sample_calculator(framesPerSecond, frequency, z);
-                mlt_frame->get_audio(audioFormat, frequency, channels, samples);
-                for (int channel = 0; channel < channels; ++channel) {
-                    double level = 256 * qMin(mlt_frame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                    audioLevels << level;
-                }
-            } else if (!audioLevels.isEmpty()) {
-                for (int channel = 0; channel < channels; channel++)
-                    audioLevels << audioLevels.last();
+            if (publishTimer.elapsed() > PARTIAL_LEVELS_INTERVAL && extractor.position() < lengthInFrames) {
+                publishTimer.restart();
+                // Publish the frames decoded so far
+                AudioLevels partial(channels, audioLevels.left(extractor.position() * channels), lengthInFrames);
+                QMetaObject::invokeMethod(this, "updateAudioThumbnail", Qt::QueuedConnection, Q_ARG(AudioLevels, partial));
             }
-            if (m_abortAudioThumb) break;
         }
     }
 
     emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
-    if (!m_abortAudioThumb) {
-        updateAudioThumbnail(audioLevels);
-    }
-
     if (!m_abortAudioThumb && audioLevels.size() > 0) {
-        // Put into an image for caching.
-        int count = audioLevels.size();
-        QImage image(lrint((count + 3) / 4.0 / channels), channels, QImage::Format_ARGB32);
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i ++) {
-            QRgb p; 
-            if ((4*i + 3) < count) {
-                p = qRgba(audioLevels.at(4*i).toInt(), audioLevels.at(4*i+1).toInt(), audioLevels.at(4*i+2).toInt(), audioLevels.at(4*i+3).toInt());
-            } else {
-                int last = audioLevels.last().toInt();
-                int r = (4*i+0) < count? audioLevels.at(4*i+0).toInt() : last;
-                int g = (4*i+1) < count? audioLevels.at(4*i+1).toInt() : last;
-                int b = (4*i+2) < count? audioLevels.at(4*i+2).toInt() : last;
-                int a = last;
-                p = qRgba(r, g, b, a);
-            }
-            image.setPixel(i / channels, i % channels, p);
+        AudioLevels levels(channels, audioLevels);
+        // Store in cache, then use the memory mapped version so that memory is not duplicated
+        if (levels.save(audioPath)) {
+            CacheIndex::fileWritten(audioPath);
+            levels.load(audioPath);
         }
-        image.save(audioPath);
+        QMetaObject::invokeMethod(this, "updateAudioThumbnail", Qt::QueuedConnection, Q_ARG(AudioLevels, levels));
     }
     m_abortAudioThumb = false;
 }
@@ -1244,7 +1438,7 @@ QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString
         //m_controller->resetProperty("kdenlive:clipanalysis." + name);
     }
     else {
-        QString current = m_controller->property("kdenlive:clipanalysis." + name);
+        QString current = ProjectDataStore::resolve(m_controller->property("kdenlive:clipanalysis." + name));
         if (!current.isEmpty()) {
             if (KMessageBox::questionYesNo(QApplication::activeWindow(), i18n("Clip already contains analysis data %1", name), QString(), KGuiItem(i18n("Merge")), KGuiItem(i18n("Add"))) == KMessageBox::Yes) {
                 // Merge data
@@ -1283,7 +1477,13 @@ QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString
 
 QMap <QString, QString> ProjectClip::analysisData(bool withPrefix)
 {
-    return m_controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    QMap <QString, QString> data = m_controller->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    // Large data may have been moved to the project's sidecar file
+    QMap <QString, QString>::iterator i = data.begin();
+    for (; i != data.end(); ++i) {
+        i.value() = ProjectDataStore::resolve(i.value());
+    }
+    return data;
 }
 
 const QString ProjectClip::geometryWithOffset(const QString &data, int offset)
@@ -1305,8 +1505,7 @@ const QString ProjectClip::geometryWithOffset(const QString &data, int offset)
 
 QImage ProjectClip::findCachedThumb(int pos)
 {
-    const QString path = url().path() + '_' + QString::number(pos);
-    return bin()->findCachedPixmap(path);
+    return pCore->thumbnailCache()->image(hash(), pos, 150);
 }
 
 bool ProjectClip::isSplittable() const
@@ -24,12 +24,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PROJECTCLIP_H
 
 #include "abstractprojectitem.h"
+#include "audiolevels.h"
 #include "definitions.h"
+#include "utils/memorytracker.h"
 
 
 #include <QUrl>
 #include <QMutex>
 #include <QFuture>
+#include <QImage>
 
 class ProjectFolder;
 class AudioStreamInfo;
@@ -51,7 +54,7 @@ namespace Mlt {
  * 
  */
 
-class ProjectClip : public AbstractProjectItem
+class ProjectClip : public AbstractProjectItem, public MemoryConsumer
 {
     Q_OBJECT
 
@@ -90,7 +93,8 @@ public:
 
     /** @brief Check if clip has a parent folder with id id */
     bool hasParent(const QString &id) const;
-    ClipPropertiesController *buildProperties(QWidget *parent);
+    /** @brief Display this clip in the (reused) properties panel. */
+    void attachProperties(ClipPropertiesController *panel);
     QPoint zone() const;
     
     /** @brief Returns true if we want to add an affine transition in timeline when dropping this clip. */
@@ -120,8 +124,11 @@ public:
     
     QVariant data(DataType type) const;
 
-    /** @brief Sets thumbnail for this clip. */
-    void setThumbnail(QImage);
+    /** @brief Sets thumbnail for this clip.
+     *  @param cacheFile the file where the thumbnail is saved. If set, the thumbnail is only kept in the
+     *  Bin's memory cache and decoded again from that file when needed. A null @param img then only
+     *  records the file, which is decoded when the clip is first displayed. */
+    void setThumbnail(QImage img, const QString &cacheFile = QString());
     QPixmap thumbnail(int width, int height);
 
     /** @brief Sets the MLT producer associated with this clip
@@ -137,6 +144,8 @@ public:
     /** @brief Returns this clip's producer. */
     Mlt::Producer *originalProducer();
     Mlt::Producer *thumbProducer();
+    /** @brief Returns a producer decoding only keyframes, NULL if the clip is not a video file. */
+    Mlt::Producer *keyframeProducer();
     
     ClipController *controller();
 
@@ -175,9 +184,10 @@ public:
     /** @brief Returns true if we are using a proxy for this clip. */
     bool hasProxy() const;
 
-    /** Cache for every audio Frame with 10 Bytes */
-    /** format is frame -> channel ->bytes */
-    QVariantList audioFrameCache;
+    /** @brief Audio levels of this clip, format is frame -> channel -> level. */
+    const AudioLevels audioLevels() const;
+    /** @brief Memory used by the audio levels. */
+    qint64 memoryUsage() const;
     bool audioThumbCreated() const;
 
     void updateParentInfo(const QString &folderid, const QString &foldername);
@@ -213,12 +223,18 @@ public:
     const QString getAudioThumbPath(AudioStreamInfo *audioInfo);
     /** @brief Returns a cached pixmap for a frame of this clip */
     QImage findCachedThumb(int pos);
-    void slotQueryIntraThumbs(QList <int> frames);
+    /** @brief Queues per frame thumbnails, @param replace drops the frames queued before that were not decoded yet. */
+    void slotQueryIntraThumbs(QList <int> frames, bool replace = false);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
+    /** @brief Builds the sprite sheet used to scrub the clip in the Bin in the background, unless it is cached. */
+    void createSpriteSheet();
+    /** @brief Shows the sprite sheet frame at @param ratio of the clip instead of the thumbnail, a negative ratio restores it. */
+    void setScrubPosition(double ratio);
 
 public slots:
-    void updateAudioThumbnail(QVariantList audioLevels);
+    /** @brief Sets the audio levels of the clip, which may be the partial levels of a clip still being extracted. */
+    void updateAudioThumbnail(const AudioLevels &audioLevels);
     /** @brief Extract image thumbnails for timeline. */
     void slotExtractImage(QList <int> frames);
     void slotCreateAudioThumbs();
@@ -235,27 +251,48 @@ private:
     ClipController *m_controller;
     /** @brief Generate and store file hash if not available. */
     const QString getFileHash() const;
+    /** @brief File of the thumbnail when it is managed by the Bin's thumbnail cache. */
+    QString m_thumbnailFile;
+    /** @brief Round and decorate an image for display in Bin. */
+    QPixmap decoratedThumbnail(const QImage &img);
+    /** @brief Returns the current thumbnail, decoding it from disk if it was evicted from memory. */
+    QIcon thumbnailIcon();
+    /** @brief Returns the sprite sheet frame selected by setScrubPosition. */
+    QIcon scrubIcon();
+    /** @brief Creates a producer decoding only keyframes, owned by the caller. */
+    Mlt::Producer *buildKeyframeProducer();
     /** @brief Store clip url temporarily while the clip controller has not been created. */
     QUrl m_temporaryUrl;
     ClipType m_type;
     Mlt::Producer *m_thumbsProducer;
+    Mlt::Producer *m_keyframeProducer;
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
     QMutex m_intraThumbMutex;
     QMutex m_audioMutex;
+    AudioLevels m_audioLevels;
     QFuture <void> m_thumbThread;
     QList <int> m_requestedThumbs;
     QFuture <void> m_intraThread;
     QList <int> m_intraThumbs;
+    QFuture <void> m_spriteThread;
+    bool m_abortSprite;
+    /** @brief Sprite sheet frame shown while the clip is scrubbed, -1 if it is not. */
+    int m_scrubTile;
+    QImage m_scrubSprite;
     const QString geometryWithOffset(const QString &data, int offset);
     void doExtractImage();
     void doExtractIntra();
+    void doCreateSpriteSheet();
 
 private slots:
     void updateFfmpegProgress();
+    void slotSpriteReady();
 
 signals:
     void gotAudioData();
+    /** @brief The levels of frames startFrame to endFrame were extracted, the rest of the clip is still processed. */
+    void audioLevelsReady(int startFrame, int endFrame);
     void refreshPropertiesPanel();
     void refreshAnalysisPanel();
     void refreshClipDisplay();
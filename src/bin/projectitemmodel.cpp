@@ -34,12 +34,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDebug>
 #include <QStringListModel>
 
+// Interval in ms during which item updates are gathered before notifying the views
+#define UPDATE_INTERVAL 40
+
 
 ProjectItemModel::ProjectItemModel(Bin *bin) :
     QAbstractItemModel(bin)
   , m_bin(bin)
+  , m_searchIndexReady(false)
+  , m_batchDepth(0)
 {
     connect(m_bin, SIGNAL(itemUpdated(AbstractProjectItem*)), this, SLOT(onItemUpdated(AbstractProjectItem*)));
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UPDATE_INTERVAL);
+    connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(slotFlushUpdates()));
 }
 
 ProjectItemModel::~ProjectItemModel()
@@ -91,6 +99,9 @@ bool ProjectItemModel::setData(const QModelIndex & index, const QVariant & value
 {
     AbstractProjectItem *item = static_cast<AbstractProjectItem *>(index.internalPointer());
     if (item->rename(value.toString(), index.column())) {
+        if (updateSearchEntry(item)) {
+            emit searchIndexChanged();
+        }
         emit dataChanged(index, index, QVector<int> () << role);
         return true;
     }
@@ -291,7 +302,7 @@ QMimeData* ProjectItemModel::mimeData(const QModelIndexList& indices) const
 void ProjectItemModel::onAboutToAddItem(AbstractProjectItem* item)
 {
     AbstractProjectItem *parentItem = item->parent();
-    if (parentItem == NULL) return;
+    if (parentItem == NULL || m_batchDepth > 0) return;
     QModelIndex parentIndex;
     if (parentItem != m_bin->rootFolder()) {
         parentIndex = createIndex(parentItem->index(), 0, parentItem);
@@ -301,8 +312,15 @@ void ProjectItemModel::onAboutToAddItem(AbstractProjectItem* item)
 
 void ProjectItemModel::onItemAdded(AbstractProjectItem* item)
 {
-    Q_UNUSED(item)
+    if (m_batchDepth > 0) {
+        // The search index is rebuilt at the end of the batch
+        return;
+    }
     endInsertRows();
+    if (m_searchIndexReady) {
+        indexItem(item);
+        emit searchIndexChanged();
+    }
 }
 
 void ProjectItemModel::onAboutToRemoveItem(AbstractProjectItem* item)
@@ -314,24 +332,282 @@ void ProjectItemModel::onAboutToRemoveItem(AbstractProjectItem* item)
         parentIndex = createIndex(parentItem->index(), 0, parentItem);
     }
 
-    beginRemoveRows(parentIndex, item->index(), item->index());
+    if (m_batchDepth == 0) {
+        beginRemoveRows(parentIndex, item->index(), item->index());
+    }
+    forgetItem(item);
 }
 
 void ProjectItemModel::onItemRemoved(AbstractProjectItem* item)
 {
     Q_UNUSED(item)
+    if (m_batchDepth > 0) return;
     endRemoveRows();
+    if (m_searchIndexReady) {
+        emit searchIndexChanged();
+    }
 }
 
 
-void ProjectItemModel::onItemUpdated(AbstractProjectItem* item)
+void ProjectItemModel::onItemUpdated(AbstractProjectItem* item, const QVector<int> &roles)
 {
     if (!item || item->clipStatus() == AbstractProjectItem::StatusDeleting) return;
-    AbstractProjectItem *parentItem = item->parent();
-    if (parentItem == NULL) return;
-    QModelIndex parentIndex;
-    if (parentItem != m_bin->rootFolder()) {
-        parentIndex = createIndex(parentItem->index(), 0, parentItem);
+    if (item->parent() == NULL || m_batchDepth > 0) return;
+    QHash<AbstractProjectItem *, QVector<int> >::iterator it = m_pendingUpdates.find(item);
+    if (it == m_pendingUpdates.end()) {
+        m_pendingUpdates.insert(item, roles);
+    } else if (!it.value().isEmpty()) {
+        if (roles.isEmpty()) {
+            it.value().clear();
+        } else {
+            foreach(int role, roles) {
+                if (!it.value().contains(role)) it.value().append(role);
+            }
+        }
+    }
+    if (!m_updateTimer.isActive()) {
+        m_updateTimer.start();
+    }
+}
+
+void ProjectItemModel::beginInsertBatch()
+{
+    if (m_batchDepth++ == 0) {
+        beginResetModel();
+    }
+}
+
+void ProjectItemModel::endInsertBatch()
+{
+    if (m_batchDepth == 0 || --m_batchDepth > 0) return;
+    // The reset refreshes all items
+    m_updateTimer.stop();
+    m_pendingUpdates.clear();
+    bool searchIndexReady = m_searchIndexReady;
+    if (searchIndexReady) {
+        // Rebuilt on next search
+        m_searchIndex.clear();
+        m_searchIndexReady = false;
+    }
+    endResetModel();
+    if (searchIndexReady) {
+        emit searchIndexChanged();
+    }
+}
+
+bool ProjectItemModel::isInsertBatch() const
+{
+    return m_batchDepth > 0;
+}
+
+void ProjectItemModel::slotFlushUpdates()
+{
+    // Sort pending items by parent, so that neighbour rows can be notified in one range
+    QHash<AbstractProjectItem *, QMap<int, AbstractProjectItem *> > rowsByParent;
+    bool searchChanged = false;
+    QHash<AbstractProjectItem *, QVector<int> >::const_iterator it = m_pendingUpdates.constBegin();
+    for (; it != m_pendingUpdates.constEnd(); ++it) {
+        AbstractProjectItem *item = it.key();
+        if (item->clipStatus() == AbstractProjectItem::StatusDeleting || item->parent() == NULL) continue;
+        rowsByParent[item->parent()].insert(item->index(), item);
+        if (updateSearchEntry(item)) {
+            searchChanged = true;
+        }
+    }
+    QHash<AbstractProjectItem *, QMap<int, AbstractProjectItem *> >::const_iterator p = rowsByParent.constBegin();
+    for (; p != rowsByParent.constEnd(); ++p) {
+        const int lastColumn = p.key()->supportedDataCount() - 1;
+        QMap<int, AbstractProjectItem *>::const_iterator row = p.value().constBegin();
+        while (row != p.value().constEnd()) {
+            const int first = row.key();
+            AbstractProjectItem *firstItem = row.value();
+            AbstractProjectItem *lastItem = firstItem;
+            QVector<int> roles = m_pendingUpdates.value(firstItem);
+            int last = first;
+            ++row;
+            while (row != p.value().constEnd() && row.key() == last + 1) {
+                last = row.key();
+                lastItem = row.value();
+                const QVector<int> &itemRoles = m_pendingUpdates[lastItem];
+                if (itemRoles.isEmpty()) {
+                    roles.clear();
+                } else if (!roles.isEmpty()) {
+                    foreach(int role, itemRoles) {
+                        if (!roles.contains(role)) roles.append(role);
+                    }
+                }
+                ++row;
+            }
+            emit dataChanged(createIndex(first, 0, firstItem), createIndex(last, lastColumn, lastItem), roles);
+        }
+    }
+    m_pendingUpdates.clear();
+    if (searchChanged) {
+        emit searchIndexChanged();
+    }
+}
+
+static QString normalizedSearchText(const QString &text)
+{
+    // Decompose and drop accents so that "é" can be found by typing "e"
+    const QString decomposed = text.normalized(QString::NormalizationForm_D).toLower();
+    QString result;
+    result.reserve(decomposed.length());
+    for (int i = 0; i < decomposed.length(); ++i) {
+        if (decomposed.at(i).category() != QChar::Mark_NonSpacing) {
+            result.append(decomposed.at(i));
+        }
+    }
+    return result;
+}
+
+static QString clipTypeName(ClipType type)
+{
+    switch (type) {
+        case Audio:
+            return QStringLiteral("audio");
+        case Video:
+            return QStringLiteral("video");
+        case AV:
+            return QStringLiteral("av video audio");
+        case Color:
+            return QStringLiteral("color");
+        case Image:
+            return QStringLiteral("image");
+        case Text:
+        case TextTemplate:
+            return QStringLiteral("title");
+        case SlideShow:
+            return QStringLiteral("slideshow");
+        case Playlist:
+            return QStringLiteral("playlist");
+        case WebVfx:
+            return QStringLiteral("webvfx");
+        case QText:
+            return QStringLiteral("qtext");
+        default:
+            return QString();
+    }
+}
+
+ProjectItemModel::SearchEntry ProjectItemModel::searchEntry(AbstractProjectItem *item) const
+{
+    SearchEntry entry;
+    // Same columns as the ones displayed in the tree view
+    entry.text = normalizedSearchText(item->data(AbstractProjectItem::DataName).toString() + QLatin1Char('\n') + item->data(AbstractProjectItem::DataDate).toString() + QLatin1Char('\n') + item->data(AbstractProjectItem::DataDescription).toString());
+    entry.duration = item->data(AbstractProjectItem::DataDuration).toString();
+    switch (item->itemType()) {
+        case AbstractProjectItem::FolderItem:
+            entry.type = QStringLiteral("folder");
+            break;
+        case AbstractProjectItem::SubClipItem:
+            entry.type = QStringLiteral("subclip");
+            break;
+        case AbstractProjectItem::ClipItem: {
+            ProjectClip *clip = static_cast<ProjectClip *>(item);
+            entry.type = clipTypeName(clip->clipType());
+            entry.codec = (clip->codec(false) + QLatin1Char(' ') + clip->codec(true)).toLower();
+            break;
+        }
+        default:
+            break;
+    }
+    return entry;
+}
+
+void ProjectItemModel::indexItem(AbstractProjectItem *item) const
+{
+    m_searchIndex.insert(item, searchEntry(item));
+    for (int i = 0; i < item->count(); ++i) {
+        indexItem(item->at(i));
+    }
+}
+
+void ProjectItemModel::forgetItem(AbstractProjectItem *item)
+{
+    if (!m_searchIndexReady && m_pendingUpdates.isEmpty()) return;
+    m_searchIndex.remove(item);
+    m_pendingUpdates.remove(item);
+    for (int i = 0; i < item->count(); ++i) {
+        forgetItem(item->at(i));
+    }
+}
+
+bool ProjectItemModel::updateSearchEntry(AbstractProjectItem *item)
+{
+    if (!m_searchIndexReady || !m_searchIndex.contains(item)) return false;
+    SearchEntry &entry = m_searchIndex[item];
+    const SearchEntry updated = searchEntry(item);
+    if (updated.text == entry.text && updated.type == entry.type && updated.codec == entry.codec && updated.duration == entry.duration) {
+        // Thumbnail or job progress update, nothing to search in changed
+        return false;
+    }
+    entry = updated;
+    return true;
+}
+
+bool ProjectItemModel::entryMatches(const SearchEntry &entry, const QStringList &textTerms, const QList<QPair<int, QString> > &fieldTerms)
+{
+    for (int i = 0; i < textTerms.count(); ++i) {
+        if (!entry.text.contains(textTerms.at(i))) return false;
+    }
+    for (int i = 0; i < fieldTerms.count(); ++i) {
+        const QString &value = fieldTerms.at(i).second;
+        switch (fieldTerms.at(i).first) {
+            case 0:
+                if (!entry.type.contains(value)) return false;
+                break;
+            case 1:
+                if (!entry.codec.contains(value)) return false;
+                break;
+            default:
+                if (!entry.duration.contains(value)) return false;
+                break;
+        }
+    }
+    return true;
+}
+
+QSet<AbstractProjectItem *> ProjectItemModel::matchItems(const QString &search, const QSet<AbstractProjectItem *> &candidates) const
+{
+    if (!m_searchIndexReady) {
+        ProjectFolder *root = m_bin->rootFolder();
+        for (int i = 0; root && i < root->count(); ++i) {
+            indexItem(root->at(i));
+        }
+        m_searchIndexReady = true;
+    }
+    // Split search into terms once, so that each item only costs a few substring lookups
+    QStringList textTerms;
+    QList <QPair <int, QString> > fieldTerms;
+    const QStringList terms = normalizedSearchText(search).split(QLatin1Char(' '), QString::SkipEmptyParts);
+    foreach(const QString &term, terms) {
+        int field = -1;
+        if (term.startsWith(QLatin1String("type:"))) field = 0;
+        else if (term.startsWith(QLatin1String("codec:"))) field = 1;
+        else if (term.startsWith(QLatin1String("duration:"))) field = 2;
+        if (field < 0) {
+            textTerms << term;
+        } else {
+            fieldTerms << QPair <int, QString>(field, term.section(QLatin1Char(':'), 1));
+        }
+    }
+    QSet<AbstractProjectItem *> result;
+    if (candidates.isEmpty()) {
+        QHash<AbstractProjectItem *, SearchEntry>::const_iterator it = m_searchIndex.constBegin();
+        for (; it != m_searchIndex.constEnd(); ++it) {
+            if (entryMatches(it.value(), textTerms, fieldTerms)) {
+                result.insert(it.key());
+            }
+        }
+    } else {
+        // Refining a previous search, only its matches can still match
+        foreach(AbstractProjectItem *item, candidates) {
+            QHash<AbstractProjectItem *, SearchEntry>::const_iterator it = m_searchIndex.constFind(item);
+            if (it != m_searchIndex.constEnd() && entryMatches(it.value(), textTerms, fieldTerms)) {
+                result.insert(item);
+            }
+        }
     }
-    emit dataChanged(parentIndex, parentIndex);
+    return result;
 }
@@ -26,6 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QAbstractItemModel>
 #include <QSize>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
 
 class AbstractProjectItem;
 class Bin;
@@ -73,18 +77,59 @@ public:
     void onAboutToRemoveItem(AbstractProjectItem *item);
     /** @brief Prepare some stuff after removing a new item */
     void onItemRemoved(AbstractProjectItem *item);
+    /** @brief Start adding many items: no row is inserted, the views are reset once by the matching
+     *  endInsertBatch(), which also sorts and filters the proxy once. Calls can be nested. */
+    void beginInsertBatch();
+    void endInsertBatch();
+    /** @brief Returns true if items are being added in a batch */
+    bool isInsertBatch() const;
     bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent);
     Qt::DropActions supportedDropActions() const;
+    /** @brief Returns the items matching all the terms of @param search.
+     *  Terms are matched against the name, date and description of items, or against a field
+     *  for terms like type:video, codec:h264 or duration:00:01. When @param candidates is not empty,
+     *  only these items are checked, which is used to refine a previous search. */
+    QSet<AbstractProjectItem *> matchItems(const QString &search, const QSet<AbstractProjectItem *> &candidates = QSet<AbstractProjectItem *>()) const;
 
 public slots:
-    /** @brief An item in the list was modified, notify */
-    void onItemUpdated(AbstractProjectItem* item);
+    /** @brief An item in the list was modified, notify. The change is queued and emitted with others in one batch.
+     *  @param roles the changed data roles, empty if unknown */
+    void onItemUpdated(AbstractProjectItem* item, const QVector<int> &roles = QVector<int>());
+
+private slots:
+    /** @brief Emit the queued item changes as row range dataChanged signals */
+    void slotFlushUpdates();
 
 private:
+    /** @brief Normalized search data of an item */
+    struct SearchEntry {
+        QString text;
+        QString type;
+        QString codec;
+        QString duration;
+    };
     /** @brief Reference to the project bin */
     Bin *m_bin;
+    /** @brief Search data of all items, built on first search and then kept up to date */
+    mutable QHash<AbstractProjectItem *, SearchEntry> m_searchIndex;
+    mutable bool m_searchIndexReady;
+    /** @brief Nesting level of beginInsertBatch() calls */
+    int m_batchDepth;
+    /** @brief Items waiting for their dataChanged, with the changed roles (empty means all roles) */
+    QHash<AbstractProjectItem *, QVector<int> > m_pendingUpdates;
+    QTimer m_updateTimer;
     /** @brief Return reference to column specific data */
     int mapToColumn(int column) const;
+    /** @brief Build search data for an item */
+    SearchEntry searchEntry(AbstractProjectItem *item) const;
+    /** @brief Add an item and its children to the search index */
+    void indexItem(AbstractProjectItem *item) const;
+    /** @brief Remove an item and its children from the search index and queued updates */
+    void forgetItem(AbstractProjectItem *item);
+    /** @brief Refresh search data of an item, returns true if it changed */
+    bool updateSearchEntry(AbstractProjectItem *item);
+    /** @brief Returns true if an item's search data contains all search terms */
+    static bool entryMatches(const SearchEntry &entry, const QStringList &textTerms, const QList<QPair<int, QString> > &fieldTerms);
 
 signals:
     //TODO
@@ -93,6 +138,8 @@ signals:
     void itemDropped(const QList <QUrl> &, const QModelIndex &);
     void effectDropped(QString, const QModelIndex &);
     void addClipCut(const QString &,int,int);
+    /** @brief Search data of some items changed, an active filter should be refreshed */
+    void searchIndexChanged();
 };
 
 #endif
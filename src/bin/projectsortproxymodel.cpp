@@ -21,67 +21,50 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "projectsortproxymodel.h"
 #include "abstractprojectitem.h"
+#include "projectitemmodel.h"
 
 #include <QItemSelectionModel>
 
+// Delay in ms after the last keystroke before the search is applied
+#define SEARCH_DELAY 200
 
 ProjectSortProxyModel::ProjectSortProxyModel(QObject *parent)
      : QSortFilterProxyModel(parent)
+     , m_searchDirty(false)
 {
     m_collator.setNumericMode(true);
     m_selection = new QItemSelectionModel(this);
     connect(m_selection, SIGNAL(selectionChanged(QItemSelection,QItemSelection)), this, SLOT(onCurrentRowChanged(QItemSelection,QItemSelection)));
     setDynamicSortFilter(true);
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(SEARCH_DELAY);
+    connect(&m_searchTimer, SIGNAL(timeout()), this, SLOT(slotApplySearch()));
 }
 
-// Responsible for item sorting!
-bool ProjectSortProxyModel::filterAcceptsRow(int sourceRow,
-         const QModelIndex &sourceParent) const
+void ProjectSortProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
 {
-    if (filterAcceptsRowItself(sourceRow, sourceParent)) {
-        return true;
+    if (this->sourceModel()) {
+        disconnect(this->sourceModel(), SIGNAL(searchIndexChanged()), this, SLOT(slotSearchIndexChanged()));
     }
-    //accept if any of the children is accepted on it's own merits
-    if (hasAcceptedChildren(sourceRow, sourceParent)) {
-        return true;
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    if (qobject_cast<ProjectItemModel *>(sourceModel)) {
+        connect(sourceModel, SIGNAL(searchIndexChanged()), this, SLOT(slotSearchIndexChanged()));
     }
-    return false;
 }
 
-bool ProjectSortProxyModel::filterAcceptsRowItself(int sourceRow,
+// Responsible for item sorting!
+bool ProjectSortProxyModel::filterAcceptsRow(int sourceRow,
          const QModelIndex &sourceParent) const
 {
-    int cols = sourceModel()->columnCount();
-    for (int i = 0; i < cols; i++) {
-        QModelIndex index0 = sourceModel()->index(sourceRow, i, sourceParent);
-        if (!index0.isValid()) {
-            return false;
-        }
-        if (sourceModel()->data(index0).toString().contains(m_searchString, Qt::CaseInsensitive)) return true;
-    }
-    return false;
-}
-
-bool ProjectSortProxyModel::hasAcceptedChildren(int sourceRow, const QModelIndex &source_parent) const
-{
-    QModelIndex item = sourceModel()->index(sourceRow,0,source_parent);
-    if (!item.isValid()) {
-        return false;
+    if (m_searchString.isEmpty()) {
+        return true;
     }
-
-    //check if there are children
-    int childCount = item.model()->rowCount(item);
-    if (childCount == 0)
+    // Rows are looked up in the result of the last index search, parent folders of matching items included
+    QModelIndex index0 = sourceModel()->index(sourceRow, 0, sourceParent);
+    if (!index0.isValid()) {
         return false;
-
-    for (int i = 0; i < childCount; ++i) {
-        if (filterAcceptsRowItself(i, item))
-            return true;
-        //recursive call -> NOTICE that this is depth-first searching, you're probably better off with breadth first search...
-        if (hasAcceptedChildren(i, item))
-            return true;
     }
-    return false;
+    return m_visibleItems.contains(static_cast<AbstractProjectItem *>(index0.internalPointer()));
 }
 
 bool ProjectSortProxyModel::lessThan(const QModelIndex & left, const QModelIndex & right) const
@@ -108,9 +91,64 @@ QItemSelectionModel* ProjectSortProxyModel::selectionModel()
 }
 
 void ProjectSortProxyModel::slotSetSearchString(const QString &str)
-{ 
-    m_searchString = str; 
-    invalidateFilter(); 
+{
+    m_pendingSearch = str;
+    if (str.isEmpty()) {
+        // Clearing the search should be immediate
+        m_searchTimer.stop();
+        slotApplySearch();
+        return;
+    }
+    m_searchTimer.start();
+}
+
+void ProjectSortProxyModel::slotApplySearch()
+{
+    const QString search = m_pendingSearch.simplified();
+    if (search == m_searchString && !m_searchDirty) {
+        return;
+    }
+    ProjectItemModel *model = qobject_cast<ProjectItemModel *>(sourceModel());
+    if (search.isEmpty() || !model) {
+        m_searchDirty = false;
+        m_searchString.clear();
+        m_matchedItems.clear();
+        m_visibleItems.clear();
+        invalidateFilter();
+        return;
+    }
+    if (!m_searchDirty && !m_searchString.isEmpty() && search.startsWith(m_searchString)) {
+        // Typing more characters can only narrow the previous result
+        if (!m_matchedItems.isEmpty()) {
+            m_matchedItems = model->matchItems(search, m_matchedItems);
+        }
+    } else {
+        m_matchedItems = model->matchItems(search);
+    }
+    m_searchString = search;
+    m_searchDirty = false;
+    m_visibleItems = m_matchedItems;
+    foreach(AbstractProjectItem *item, m_matchedItems) {
+        AbstractProjectItem *parentItem = item->parent();
+        while (parentItem && !m_visibleItems.contains(parentItem)) {
+            m_visibleItems.insert(parentItem);
+            parentItem = parentItem->parent();
+        }
+    }
+    invalidateFilter();
+}
+
+void ProjectSortProxyModel::slotSearchIndexChanged()
+{
+    if (m_searchString.isEmpty()) {
+        return;
+    }
+    // Force a full search once the model settles
+    if (!m_searchTimer.isActive()) {
+        m_pendingSearch = m_searchString;
+    }
+    m_searchDirty = true;
+    m_searchTimer.start();
 }
 
 void ProjectSortProxyModel::onCurrentRowChanged(const QItemSelection& current, const QItemSelection& previous)
@@ -129,8 +167,3 @@ void ProjectSortProxyModel::onCurrentRowChanged(const QItemSelection& current, c
     }
 }
 
-void ProjectSortProxyModel::slotDataChanged(const QModelIndex &ix1, const QModelIndex &ix2)
-{
-    emit dataChanged(ix1, ix2);
-}
-
@@ -24,8 +24,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QSortFilterProxyModel>
 #include <QCollator>
+#include <QSet>
+#include <QTimer>
 
 class QItemSelectionModel;
+class AbstractProjectItem;
 
 /**
  * @class ProjectSortProxyModel
@@ -39,16 +42,20 @@ class ProjectSortProxyModel : public QSortFilterProxyModel
 public:
     explicit ProjectSortProxyModel(QObject *parent = 0);
     QItemSelectionModel* selectionModel();
+    /** @brief Reimplemented to follow search index changes of the ProjectItemModel */
+    void setSourceModel(QAbstractItemModel *sourceModel);
 
 public slots:
     /** @brief Set search string that will filter the view */
     void slotSetSearchString(const QString &str);
-    /** @brief Relay datachanged signal from view's model  */
-    void slotDataChanged(const QModelIndex &ix1, const QModelIndex &ix2);
 
 private slots:
     /** @brief Called when a row change is detected by selection model */
     void onCurrentRowChanged(const QItemSelection& current, const QItemSelection& previous);
+    /** @brief Look up the pending search string in the model's search index and refilter */
+    void slotApplySearch();
+    /** @brief Items changed in the model, redo the current search from scratch */
+    void slotSearchIndexChanged();
 
 protected:
     /** @brief Decide which items should be displayed depending on the search string  */
@@ -56,12 +63,20 @@ protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
     /** @brief Reimplemented to show folders first  */
     bool lessThan(const QModelIndex & left, const QModelIndex & right) const;
-    bool filterAcceptsRowItself(int source_row, const QModelIndex &source_parent) const;
-    bool hasAcceptedChildren(int source_row, const QModelIndex &source_parent) const;
 
 private:
     QItemSelectionModel*m_selection;
+    /** @brief The search string currently applied to the view */
     QString m_searchString;
+    /** @brief The search string waiting for the typing delay to apply */
+    QString m_pendingSearch;
+    /** @brief Items directly matching the current search */
+    QSet<AbstractProjectItem *> m_matchedItems;
+    /** @brief Matching items and their parent folders, which are the rows to display */
+    QSet<AbstractProjectItem *> m_visibleItems;
+    /** @brief Set when the model changed so that the next search cannot refine the previous result */
+    bool m_searchDirty;
+    QTimer m_searchTimer;
     QCollator m_collator;
 
 signals:
@@ -59,8 +59,8 @@ ProjectSubClip::~ProjectSubClip()
 void ProjectSubClip::gotThumb(int pos, QImage img)
 {
     if (pos == m_in) {
+        // Keep listening, a keyframe preview is followed by the exact frame
         setThumbnail(img);
-        disconnect(m_masterClip, &ProjectClip::thumbReady, this, &ProjectSubClip::gotThumb);
     }
 }
 
@@ -134,7 +134,7 @@ void ProjectSubClip::setThumbnail(QImage img)
 {
     QPixmap thumb = roundedPixmap(QPixmap::fromImage(img));
     m_thumbnail = QIcon(thumb);
-    bin()->emitItemUpdated(this);
+    bin()->emitItemUpdated(this, QVector<int>() << AbstractProjectItem::DataThumbnail);
 }
 
 bool ProjectSubClip::rename(const QString &name, int column)
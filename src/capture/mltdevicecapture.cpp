@@ -19,6 +19,7 @@
 
 #include "kdenlivesettings.h"
 #include "definitions.h"
+#include "monitor/scopes/sharedframe.h"
 
 #include <mlt++/Mlt.h>
 
@@ -27,12 +28,65 @@
 #include <QTimer>
 #include <QString>
 #include <QThread>
+#include <QFileInfo>
+#include <QDir>
+#include <QtConcurrent>
 
 #include <cstdlib>
 #include <cstdarg>
 
+// Number of preview images recycled between the capture thread and the receivers
+#define PREVIEW_POOL_SIZE 3
 
+// Dropped frames per second that mean the encoder cannot keep up with the device
+#define CAPTURE_OVERLOAD_DROPS 5
 
+// Encoding parameters used when falling back to a fast intermediate codec
+#define CAPTURE_FALLBACK_PARAMS "f=avi vcodec=mjpeg qscale=3 acodec=pcm_s16le"
+
+
+/** @brief Convert one line of packed yuv422 (Y0 U Y1 V) to 24 bit rgb.
+ *  Fixed point and branch free so that the compiler can vectorize it.
+ *  @param swap If true, write the line as bgr. */
+static inline void yuv422LineToRgb(const uchar *yuv, uchar *rgb, int width, bool swap)
+{
+    const int r_ix = swap ? 2 : 0;
+    const int b_ix = swap ? 0 : 2;
+    for (int x = 0; x < width / 2; ++x) {
+        const int y0 = 298 * (yuv[0] - 16) + 128;
+        const int y1 = 298 * (yuv[2] - 16) + 128;
+        const int u = yuv[1] - 128;
+        const int v = yuv[3] - 128;
+        const int cr = 409 * v;
+        const int cg = - 100 * u - 208 * v;
+        const int cb = 516 * u;
+        int c;
+        c = (y0 + cr) >> 8; rgb[r_ix] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        c = (y0 + cg) >> 8; rgb[1] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        c = (y0 + cb) >> 8; rgb[b_ix] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        c = (y1 + cr) >> 8; rgb[3 + r_ix] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        c = (y1 + cg) >> 8; rgb[4] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        c = (y1 + cb) >> 8; rgb[3 + b_ix] = c < 0 ? 0 : (c > 255 ? 255 : c);
+        yuv += 4;
+        rgb += 6;
+    }
+}
+
+/** @brief Copy one line of 24 bit rgb, optionally swapping the red and blue channels. */
+static inline void rgbLineCopy(const uchar *src, uchar *dst, int width, bool swap)
+{
+    if (!swap) {
+        memcpy(dst, src, width * 3);
+        return;
+    }
+    for (int x = 0; x < width; ++x) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        src += 3;
+        dst += 3;
+    }
+}
 
 static void consumer_gl_frame_show(mlt_consumer, MltDeviceCapture * self, mlt_frame frame_ptr)
 {
@@ -50,7 +104,11 @@ MltDeviceCapture::MltDeviceCapture(QString profile, /*VideoSurface *surface, */Q
     m_mltProfile(NULL),
     m_showFrameEvent(NULL),
     m_droppedFrames(0),
-    m_livePreview(KdenliveSettings::enable_recording_preview())
+    m_captureXml(false),
+    m_fallbackActive(false),
+    m_livePreview(KdenliveSettings::enable_recording_preview()),
+    m_previewImages(PREVIEW_POOL_SIZE),
+    m_analysisImages(PREVIEW_POOL_SIZE)
 {
     analyseAudio = KdenliveSettings::monitor_audio();
     if (profile.isEmpty())
@@ -94,7 +152,7 @@ bool MltDeviceCapture::buildConsumer(const QString &profileName)
     // OpenGL monitor
     m_mltConsumer = new Mlt::Consumer(*m_mltProfile, "sdl_audio");
     m_mltConsumer->set("preview_off", 1);
-    m_mltConsumer->set("preview_format", mlt_image_rgb24);
+    m_mltConsumer->set("preview_format", mlt_image_yuv422);
     m_showFrameEvent = m_mltConsumer->listen("consumer-frame-show", this, (mlt_listener) consumer_gl_frame_show);
     //m_mltConsumer->set("resize", 1);
     //m_mltConsumer->set("terminate_on_pause", 1);
@@ -136,6 +194,7 @@ void MltDeviceCapture::pause()
 void MltDeviceCapture::stop()
 {
     m_droppedFramesTimer.stop();
+    m_captureTarget.clear();
     bool isPlaylist = false;
     //disconnect(this, SIGNAL(imageReady(QImage)), this, SIGNAL(frameUpdated(QImage)));
     //m_captureDisplayWidget->stop();
@@ -183,45 +242,86 @@ void MltDeviceCapture::stop()
     // For some reason, the consumer seems to be deleted by previous stuff when in playlist mode
     if (!isPlaylist && m_mltConsumer) delete m_mltConsumer;
     m_mltConsumer = NULL;
+    // The consumer thread is stopped, release the preview memory
+    m_previewImages.clear();
+    m_analysisImages.clear();
 }
 
 
 void MltDeviceCapture::emitFrameUpdated(Mlt::Frame& frame)
 {
-    /*
-    //TEST: is it better to convert the frame in a thread outside of MLT??
-    if (processingImage) return;
-    mlt_image_format format = (mlt_image_format) frame.get_int("format"); //mlt_image_rgb24;
-    int width = frame.get_int("width");
-    int height = frame.get_int("height");
-    unsigned char *buffer = (unsigned char *) frame.get_data("image");
-    if (format == mlt_image_yuv422) {
-        QtConcurrent::run(this, &MltDeviceCapture::uyvy2rgb, (unsigned char *) buffer, width, height);
-    }
-    */
-
     mlt_image_format format = mlt_image_rgb24;
     int width = 0;
     int height = 0;
-    const uchar* image = frame.get_image(format, width, height);
-    QImage qimage(width, height, QImage::Format_RGB888);
-    //QImage qimage(width, height, QImage::Format_ARGB32_Premultiplied);
-    memcpy(qimage.bits(), image, width * height * 3);
-    emit frameUpdated(qimage);
+    frame.get_image(format, width, height);
+    // The receivers share the frame buffer, it is released with the last image copy
+    emit frameUpdated(SharedFrame(frame).toImage());
 }
 
 void MltDeviceCapture::showFrame(Mlt::Frame& frame)
 {
-    mlt_image_format format = mlt_image_rgb24;
+    if (doCapture > 0) {
+        // Countdown started by captureFrame(), the overlay is hidden when it reaches 0
+        doCapture--;
+        if (doCapture == 0 && !m_capturePath.isEmpty()) saveFrame(frame);
+    }
+    bool yuvPreview = receivers(SIGNAL(showYuvFrame(SharedFrame))) > 0;
+    bool preview = receivers(SIGNAL(showImageSignal(QImage))) > 0;
+    bool analyse = sendFrameForAnalysis && frame.get_frame()->convert_image;
+    if (!preview && !analyse) {
+        // Nobody needs rgb, hand the planes to the monitor as they are
+        if (yuvPreview) emitYuvFrame(frame);
+        return;
+    }
+    mlt_image_format format = mlt_image_yuv422;
     int width = 0;
     int height = 0;
     const uchar* image = frame.get_image(format, width, height);
-    QImage qimage(width, height, QImage::Format_RGB888);
-    memcpy(qimage.scanLine(0), image, width * height * 3);
-    emit showImageSignal(qimage);
+    if (!image || width <= 0 || height <= 0) {
+        return;
+    }
+    if (preview) {
+        QImage *qimage = m_previewImages.acquire(width, height, QImage::Format_RGB888);
+        if (qimage) {
+            convertImage(image, format, *qimage, false);
+            emit showImageSignal(*qimage);
+        }
+    }
+    if (analyse) {
+        QImage *qimage = m_analysisImages.acquire(width, height, QImage::Format_RGB888);
+        if (qimage) {
+            convertImage(image, format, *qimage, true);
+            emit frameUpdated(*qimage);
+        }
+    }
+    // Last, because requesting yuv420p replaces the frame's yuv422 image
+    if (yuvPreview) emitYuvFrame(frame);
+}
+
+void MltDeviceCapture::emitYuvFrame(Mlt::Frame &frame)
+{
+    mlt_image_format format = mlt_image_yuv420p;
+    int width = 0;
+    int height = 0;
+    if (!frame.get_image(format, width, height) || format != mlt_image_yuv420p) return;
+    emit showYuvFrame(SharedFrame(frame));
+}
 
-    if (sendFrameForAnalysis && frame.get_frame()->convert_image) {
-        emit frameUpdated(qimage.rgbSwapped());
+void MltDeviceCapture::convertImage(const uchar *image, mlt_image_format format, QImage &dest, bool swap)
+{
+    const int width = dest.width();
+    const int height = dest.height();
+    if (format == mlt_image_yuv422) {
+        const int stride = width * 2;
+        for (int y = 0; y < height; ++y) {
+            yuv422LineToRgb(image + y * stride, dest.scanLine(y), width, swap);
+        }
+    } else {
+        // Producer could not give us yuv, MLT already converted to rgb
+        const int stride = width * 3;
+        for (int y = 0; y < height; ++y) {
+            rgbLineCopy(image + y * stride, dest.scanLine(y), width, swap);
+        }
     }
 }
 
@@ -283,32 +383,71 @@ void MltDeviceCapture::slotCheckDroppedFrames()
     if (m_mltProducer) {
         int dropped = m_mltProducer->get_int("dropped");
         if (dropped > m_droppedFrames) {
+            int lost = dropped - m_droppedFrames;
             m_droppedFrames = dropped;
             emit droppedFrames(m_droppedFrames);
+            if (lost >= CAPTURE_OVERLOAD_DROPS && !m_captureTarget.isEmpty() && !m_fallbackActive && KdenliveSettings::capturefallback()) {
+                // The encoder queue is full, continue in a new file with a cheaper codec
+                switchToFallbackCodec();
+            }
         }
     }
 }
 
+void MltDeviceCapture::switchToFallbackCodec()
+{
+    QFileInfo info(m_captureTarget);
+    QString path = info.absolutePath() + QDir::separator() + info.completeBaseName() + QStringLiteral("_fast.avi");
+    int i = 1;
+    while (QFile::exists(path)) {
+        path = info.absolutePath() + QDir::separator() + info.completeBaseName() + QStringLiteral("_fast%1.avi").arg(i);
+        ++i;
+    }
+    QString params = QStringLiteral(CAPTURE_FALLBACK_PARAMS);
+    if (m_captureParams.contains(QStringLiteral("an=1"))) {
+        params.replace(QStringLiteral("acodec=pcm_s16le"), QStringLiteral("an=1"));
+    }
+    // Work on copies, slotStartCapture() resets the capture state
+    const QString playlist = m_capturePlaylist;
+    const bool xml = m_captureXml;
+    qDebug()<<"// Capture encoder overloaded, switching to fast codec in "<<path;
+    if (slotStartCapture(params, path, playlist, m_livePreview, xml)) {
+        m_fallbackActive = true;
+        emit captureFileChanged(path);
+    }
+}
+
 void MltDeviceCapture::saveFrame(Mlt::Frame& frame)
 {
     mlt_image_format format = mlt_image_rgb24;
     int width = 0;
     int height = 0;
     const uchar* image = frame.get_image(format, width, height);
+    if (!image || width <= 0 || height <= 0) return;
     QImage qimage(width, height, QImage::Format_RGB888);
-    memcpy(qimage.bits(), image, width * height * 3);
+    convertImage(image, format, qimage, false);
 
     // Re-enable overlay
     Mlt::Service service(m_mltProducer->parent().get_service());
     Mlt::Tractor tractor(service);
     Mlt::Producer trackProducer(tractor.track(0));
     trackProducer.set("hide", 0);
-    
-    qimage.save(m_capturePath);
-    emit frameSaved(m_capturePath);
+
+    // Hand the frame over in memory, writing it to disk must not block the consumer thread
+    emit frameCaptured(qimage, m_capturePath);
+    QtConcurrent::run(this, &MltDeviceCapture::writeFrame, qimage, m_capturePath);
     m_capturePath.clear();
 }
 
+void MltDeviceCapture::writeFrame(const QImage &image, const QString &path)
+{
+    if (!image.save(path)) {
+        qDebug()<<"// Cannot save captured frame to "<<path;
+        return;
+    }
+    emit frameSaved(path);
+}
+
 void MltDeviceCapture::captureFrame(const QString &path)
 {
     if (m_mltProducer == NULL || !m_mltProducer->is_valid()) return;
@@ -332,6 +471,11 @@ bool MltDeviceCapture::slotStartCapture(const QString &params, const QString &pa
     m_livePreview = livePreview;
     m_frameCount = 0;
     m_droppedFrames = 0;
+    m_captureParams = params;
+    m_captureTarget = path;
+    m_capturePlaylist = playlist;
+    m_captureXml = xmlPlaylist;
+    m_fallbackActive = false;
     if (m_mltProfile) delete m_mltProfile;
     char *tmp = qstrdup(m_activeProfile.toUtf8().constData());
     m_mltProfile = new Mlt::Profile(tmp);
@@ -355,6 +499,10 @@ bool MltDeviceCapture::slotStartCapture(const QString &params, const QString &pa
     // without this line a call to mlt_properties_get_int(terminate on pause) for in mlt/src/modules/core/consumer_multi.c is returning 1
     // and going into and endless loop.
     renderProps->set("mlt_profile", m_activeProfile.toUtf8().constData());
+    // The multi consumer reads the device in its own thread and hands frames to the encoder thread
+    // through this bounded queue, so a slow disk or codec does not block the device
+    renderProps->set("buffer", qMax(1, KdenliveSettings::capturequeuesize()));
+    renderProps->set("prefill", 1);
     QStringList paramList = params.split(' ', QString::SkipEmptyParts);
     for (int i = 0; i < paramList.count(); ++i) {
         tmp = qstrdup(paramList.at(i).section('=', 0, 0).toUtf8().constData());
@@ -387,7 +535,7 @@ bool MltDeviceCapture::slotStartCapture(const QString &params, const QString &pa
             // OpenGL monitor
             previewProps->set("mlt_service", "sdl_audio");
             previewProps->set("preview_off", 1);
-            previewProps->set("preview_format", mlt_image_rgb24);
+            previewProps->set("preview_format", mlt_image_yuv422);
             previewProps->set("terminate_on_pause", 0);
             m_showFrameEvent = m_mltConsumer->listen("consumer-frame-show", this, (mlt_listener) consumer_gl_frame_show);
         //m_mltConsumer->set("resize", 1);
@@ -583,64 +731,6 @@ void MltDeviceCapture::mirror(bool activate)
     mlt_service_unlock(service.get_service());
 }
 
-void MltDeviceCapture::uyvy2rgb(unsigned char *yuv_buffer, int width, int height)
-{
-    processingImage = true;
-    QImage image(width, height, QImage::Format_RGB888);
-    unsigned char *rgb_buffer = image.bits();    
-
-    int rgb_ptr = 0, y_ptr = 0;
-    int len = width * height / 2;
-
-    for (int t = 0; t < len; ++t) { 
-        int Y = yuv_buffer[y_ptr];
-        int U = yuv_buffer[y_ptr+1];
-        int Y2 = yuv_buffer[y_ptr+2];
-        int V = yuv_buffer[y_ptr+3];
-        y_ptr += 4;
-
-        int r = ((298 * (Y - 16)               + 409 * (V - 128) + 128) >> 8);
-
-        int g = ((298 * (Y - 16) - 100 * (U - 128) - 208 * (V - 128) + 128) >> 8);
-
-        int b = ((298 * (Y - 16) + 516 * (U - 128)               + 128) >> 8);
-
-        if (r > 255) r = 255;
-        if (g > 255) g = 255;
-        if (b > 255) b = 255;
-
-        if (r < 0) r = 0;
-        if (g < 0) g = 0;
-        if (b < 0) b = 0;
-
-        rgb_buffer[rgb_ptr] = r;
-        rgb_buffer[rgb_ptr+1] = g;
-        rgb_buffer[rgb_ptr+2] = b;
-        rgb_ptr += 3;
-
-        r = ((298 * (Y2 - 16)               + 409 * (V - 128) + 128) >> 8);
-        g = ((298 * (Y2 - 16) - 100 * (U - 128) - 208 * (V - 128) + 128) >> 8);
-        b = ((298 * (Y2 - 16) + 516 * (U - 128)               + 128) >> 8);
-
-        if (r > 255) r = 255;
-        if (g > 255) g = 255;
-        if (b > 255) b = 255;
-
-        if (r < 0) r = 0;
-        if (g < 0) g = 0;
-        if (b < 0) b = 0;
-
-        rgb_buffer[rgb_ptr] = r;
-        rgb_buffer[rgb_ptr+1] = g;
-        rgb_buffer[rgb_ptr+2] = b;
-        rgb_ptr += 3;
-    }
-    //emit imageReady(image);
-    //m_captureDisplayWidget->setImage(image);
-    emit unblockPreview();
-    //processingImage = false;
-}
-
 void MltDeviceCapture::slotPreparePreview()
 {
     QTimer::singleShot(1000, this, SLOT(slotAllowPreview()));
@@ -31,11 +31,15 @@
 #include "gentime.h"
 #include "definitions.h"
 #include "monitor/abstractmonitor.h"
+#include "utils/imagepool.h"
+#include "monitor/scopes/sharedframe.h"
 
 #include <mlt/framework/mlt_types.h>
 
 #include <QTimer>
 #include <QMutex>
+#include <QVector>
+#include <QImage>
 
 namespace Mlt
 {
@@ -70,6 +74,8 @@ Q_OBJECT public:
     void emitFrameNumber(double position);
     void emitConsumerStopped();
     void showFrame(Mlt::Frame&);
+    /** @brief Emit showYuvFrame with the yuv420p planes of frame, the image is not copied. */
+    void emitYuvFrame(Mlt::Frame &frame);
     void showAudio(Mlt::Frame&);
 
     void saveFrame(Mlt::Frame& frame);
@@ -108,8 +114,22 @@ private:
     bool m_livePreview;
     /** @brief Count captured frames, used to display only one in ten images while capturing. */
     int m_frameCount;
-
-    void uyvy2rgb(unsigned char *yuv_buffer, int width, int height);
+    /** @brief Parameters of the running capture, kept to restart it with a faster codec. */
+    QString m_captureParams;
+    /** @brief File written by the running capture, empty when only previewing. */
+    QString m_captureTarget;
+    QString m_capturePlaylist;
+    bool m_captureXml;
+    /** @brief True once the capture switched to the fast intermediate codec. */
+    bool m_fallbackActive;
+
+    /** @brief Images reused for the live preview, so that no allocation happens per frame. */
+    ImagePool m_previewImages;
+    /** @brief Images reused for the frames sent to the scopes. */
+    ImagePool m_analysisImages;
+
+    /** @brief Convert the frame image (yuv422 or rgb24) into the 24 bit rgb image dest. */
+    void convertImage(const uchar *image, mlt_image_format format, QImage &dest, bool swap);
 
     QString m_capturePath;
     
@@ -121,6 +141,10 @@ private:
      *  @param profileName The MLT profile to use for the consumer 
      *  @returns true if consumer is valid */
     bool buildConsumer(const QString &profileName = QString());
+    /** @brief Restart the capture in a new file using a fast intermediate codec. */
+    void switchToFallbackCodec();
+    /** @brief Save a captured frame to disk, called in a separate thread. */
+    void writeFrame(const QImage &image, const QString &path);
 
 
 private slots:
@@ -134,10 +158,18 @@ signals:
      *
      * Used in Mac OS X. */
     void showImageSignal(const QImage&);
+    /** @brief A live frame is ready for display, in its yuv420p planes so that it can be uploaded to the GL monitor
+     *  without any rgb conversion. When connected, showImageSignal is only emitted if it also has receivers. */
+    void showYuvFrame(const SharedFrame &frame);
 
+    /** @brief A frame was grabbed by captureFrame(), it will be written to path in a separate thread. */
+    void frameCaptured(const QImage &image, const QString &path);
+    /** @brief The grabbed frame is now available on disk. */
     void frameSaved(const QString &);
     
     void droppedFrames(int);
+    /** @brief The capture continues in another file because the encoder could not keep up. */
+    void captureFileChanged(const QString &path);
     
     void unblockPreview();
     void imageReady(const QImage &);
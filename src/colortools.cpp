@@ -11,17 +11,78 @@
 #include "colortools.h"
 
 #include <math.h>
+#include <QCache>
 #include <QColor>
+#include <QMutexLocker>
+#include <QVector>
 
 //#define DEBUG_CT
 #ifdef DEBUG_CT
 #include <QDebug>
 #endif
 
+// Memory in kilobytes used by the cached color planes
+#define PLANE_CACHE_SIZE 16384
+
+namespace {
+/**
+  Scopes and color correction widgets request the same planes on every resize
+  or parameter change, and the vectorscope background is computed in a worker thread.
+  Generated planes are shared between all callers, keyed by their parameters.
+  */
+struct PlaneCache
+{
+    PlaneCache() : planes(PLANE_CACHE_SIZE) {}
+    QMutex mutex;
+    QCache<QString, QImage> planes;
+};
+
+Q_GLOBAL_STATIC(PlaneCache, planeCache)
+
+QString planeKey(const QString &mode, const QSize &size, double value, float scaling, uint flags)
+{
+    return QStringLiteral("%1 %2x%3 %4 %5 %6").arg(mode).arg(size.width()).arg(size.height()).arg(value).arg(scaling).arg(flags);
+}
+
+bool cachedPlane(const QString &key, QImage &image)
+{
+    QMutexLocker lock(&planeCache->mutex);
+    QImage *plane = planeCache->planes.object(key);
+    if (plane) {
+        image = *plane;
+        return true;
+    }
+    return false;
+}
+
+void storePlane(const QString &key, const QImage &image)
+{
+    QMutexLocker lock(&planeCache->mutex);
+    planeCache->planes.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+}
+
+inline int clampColor(double value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : (int) value);
+}
+}
+
 ColorTools::ColorTools()
 {
 }
 
+QImage ColorTools::cachedPlane(const QString &key)
+{
+    QImage image;
+    ::cachedPlane(key, image);
+    return image;
+}
+
+void ColorTools::storePlane(const QString &key, const QImage &plane)
+{
+    ::storePlane(key, plane);
+}
+
 
 
 QImage ColorTools::yuvColorWheel(const QSize &size, const unsigned char &Y, const float &scaling, const bool &modifiedVersion, const bool &circleOnly)
@@ -31,42 +92,54 @@ QImage ColorTools::yuvColorWheel(const QSize &size, const unsigned char &Y, cons
         qCritical("ERROR: Size of the color wheel must not be 0!");
         return wheel;
     }
+    const QString key = planeKey(QStringLiteral("yuv"), size, Y, scaling, (modifiedVersion ? 1 : 0) | (circleOnly ? 2 : 0));
+    if (cachedPlane(key, wheel)) {
+        emit signalYuvWheelCalculationFinished();
+        return wheel;
+    }
     if (circleOnly) {
         wheel.fill(qRgba(0,0,0,0));
     }
 
     double dr, dg, db, dv, dmax;
-    double ru, rv, rr;
+    double rv, rr;
     const int w = size.width();
     const int h = size.height();
     const float w2 = (float)w/2;
     const float h2 = (float)h/2;
 
+    // Values depending on u only are computed once, rows are then filled in a tight loop
+    QVector<double> du(w);
+    QVector<double> ru(w);
     for (int u = 0; u < w; ++u) {
         // Transform u from {0,...,w} to [-1,1]
-        double du = (double) 2*u/(w-1) - 1;
-        du = scaling*du;
+        du[u] = scaling * ((double) 2*u/(w-1) - 1);
+        ru[u] = (u - w2)*(u - w2)/(w2*w2);
+    }
 
-        for (int v = 0; v < h; ++v) {
-            dv = (double) 2*v/(h-1) - 1;
-            dv = scaling*dv;
+    for (int v = 0; v < h; ++v) {
+        dv = (double) 2*v/(h-1) - 1;
+        dv = scaling*dv;
+        rv = (v - h2)*(v - h2)/(h2*h2);
+        const double rBase = Y + 290.8*dv;
+        const double gBase = Y - 148*dv;
+        QRgb *line = reinterpret_cast<QRgb *>(wheel.scanLine(h-v-1));
 
+        for (int u = 0; u < w; ++u) {
             if (circleOnly) {
                 // Ellipsis equation: x²/a² + y²/b² = 1
                 // Here: x=ru, y=rv, a=w/2, b=h/2, 1=rr
                 // For rr > 1, the point lies outside. Don't draw it.
-                ru = u - w2;
-                rv = v - h2;
-                rr = ru*ru/(w2*w2) + rv*rv/(h2*h2);
+                rr = ru.at(u) + rv;
                 if (rr > 1) {
                     continue;
                 }
             }
 
             // Calculate the RGB values from YUV
-            dr = Y + 290.8*dv;
-            dg = Y - 100.6*du - 148*dv;
-            db = Y + 517.2*du;
+            dr = rBase;
+            dg = gBase - 100.6*du.at(u);
+            db = Y + 517.2*du.at(u);
 
             if (modifiedVersion) {
                 // Scale the RGB values down, or up, to max 255
@@ -84,17 +157,11 @@ QImage ColorTools::yuvColorWheel(const QSize &size, const unsigned char &Y, cons
             // Note that not all possible (y,u,v) values with u,v \in [-1,1]
             // have a correct RGB representation, therefore some RGB values
             // may exceed {0,...,255}.
-            if (dr < 0) dr = 0;
-            if (dg < 0) dg = 0;
-            if (db < 0) db = 0;
-            if (dr > 255) dr = 255;
-            if (dg > 255) dg = 255;
-            if (db > 255) db = 255;
-
-            wheel.setPixel(u, (h-v-1), qRgba(dr, dg, db, 255));
+            line[u] = qRgba(clampColor(dr), clampColor(dg), clampColor(db), 255);
         }
     }
 
+    storePlane(key, wheel);
     emit signalYuvWheelCalculationFinished();
     return wheel;
 }
@@ -106,37 +173,38 @@ QImage ColorTools::yuvVerticalPlane(const QSize &size, const float &angle, const
         qCritical("ERROR: Size of the color plane must not be 0!");
         return plane;
     }
+    const QString key = planeKey(QStringLiteral("yuvplane"), size, angle, scaling, 0);
+    if (cachedPlane(key, plane)) {
+        return plane;
+    }
 
-    double dr, dg, db, Y;
+    double Y;
     const int w = size.width();
     const int h = size.height();
     const double uscaling = scaling*cos(M_PI*angle/180);
     const double vscaling = scaling*sin(M_PI*angle/180);
 
+    // The UV part of each column does not depend on Y, see yuv2rgb, yuvColorWheel
+    QVector<double> rOffset(w);
+    QVector<double> gOffset(w);
+    QVector<double> bOffset(w);
     for (int uv = 0; uv < w; ++uv) {
         double du = uscaling*((double)2*uv/w - 1);//(double)?
         double dv = vscaling*((double)2*uv/w - 1);
+        rOffset[uv] = 290.8*dv;
+        gOffset[uv] = -100.6*du - 148*dv;
+        bOffset[uv] = 517.2*du;
+    }
 
-        for (int y = 0; y < h; ++y) {
-            Y = (double)255*y/h;
-
-            // See yuv2rgb, yuvColorWheel
-            dr = Y + 290.8*dv;
-            dg = Y - 100.6*du - 148*dv;
-            db = Y + 517.2*du;
-            if (dr < 0) dr = 0;
-            if (dg < 0) dg = 0;
-            if (db < 0) db = 0;
-            if (dr > 255) dr = 255;
-            if (dg > 255) dg = 255;
-            if (db > 255) db = 255;
-
-            plane.setPixel(uv, (h-y-1), qRgba(dr, dg, db, 255));
-
+    for (int y = 0; y < h; ++y) {
+        Y = (double)255*y/h;
+        QRgb *line = reinterpret_cast<QRgb *>(plane.scanLine(h-y-1));
+        for (int uv = 0; uv < w; ++uv) {
+            line[uv] = qRgba(clampColor(Y + rOffset.at(uv)), clampColor(Y + gOffset.at(uv)), clampColor(Y + bOffset.at(uv)), 255);
         }
     }
 
-
+    storePlane(key, plane);
     return plane;
 
 }
@@ -150,40 +218,49 @@ QImage ColorTools::rgbCurvePlane(const QSize &size, const ColorTools::ColorsRGB
         qCritical("ERROR: Size of the color plane must not be 0!");
         return plane;
     }
+    const QString key = planeKey(QStringLiteral("rgb%1").arg((int) color), size, background, scaling, 0);
+    if (cachedPlane(key, plane)) {
+        return plane;
+    }
 
     const int w = size.width();
     const int h = size.height();
 
     double dcol;
-    double dx, dy;
+    double dy;
 
+    QVector<double> dx(w);
+    QVector<int> dval(w);
     for (int x = 0; x < w; ++x) {
-        double dval = (double)255*x/(w-1);
+        dx[x] = (double)x/(w-1);
+        dval[x] = (double)255*x/(w-1);
+    }
 
-        for (int y = 0; y < h; ++y) {
-            dy = (double)y/(h-1);
-            dx = (double)x/(w-1);
+    for (int y = 0; y < h; ++y) {
+        dy = (double)y/(h-1);
+        QRgb *line = reinterpret_cast<QRgb *>(plane.scanLine(h-y-1));
 
+        for (int x = 0; x < w; ++x) {
             if (1-scaling < 0.0001) {
                 dcol = (double)255*dy;
             } else {
-                dcol = (double)255 * (dy - (dy-dx)*(1-scaling));
+                dcol = (double)255 * (dy - (dy-dx.at(x))*(1-scaling));
             }
 
             if (color == ColorTools::COL_R) {
-                plane.setPixel(x, (h-y-1), qRgb(dcol, dval, dval));
+                line[x] = qRgb(dcol, dval.at(x), dval.at(x));
             } else if (color == ColorTools::COL_G) {
-                plane.setPixel(x, (h-y-1), qRgb(dval, dcol, dval));
+                line[x] = qRgb(dval.at(x), dcol, dval.at(x));
             } else if (color == ColorTools::COL_B){
-                plane.setPixel(x, (h-y-1), qRgb(dval, dval, dcol));
+                line[x] = qRgb(dval.at(x), dval.at(x), dcol);
             } else if (color == ColorTools::COL_A) {
-                plane.setPixel(x, (h-y-1), qRgb(dcol / 255. * qRed(background), dcol / 255. * qGreen(background), dcol / 255. * qBlue(background)));
+                line[x] = qRgb(dcol / 255. * qRed(background), dcol / 255. * qGreen(background), dcol / 255. * qBlue(background));
             } else {
-                plane.setPixel(x, (h-y-1), qRgb(dcol, dcol, dcol));
+                line[x] = qRgb(dcol, dcol, dcol);
             }
-
         }
     }
+    storePlane(key, plane);
     return plane;
 }
 
@@ -195,56 +272,53 @@ QImage ColorTools::yPbPrColorWheel(const QSize &size, const unsigned char &Y, co
         qCritical("ERROR: Size of the color wheel must not be 0!");
         return wheel;
     }
+    const QString key = planeKey(QStringLiteral("ypbpr"), size, Y, scaling, circleOnly ? 2 : 0);
+    if (cachedPlane(key, wheel)) {
+        return wheel;
+    }
     if (circleOnly) {
         wheel.fill(qRgba(0,0,0,0));
     }
 
-    double dr, dg, db, dpR;
-    double rB, rR, rr;
+    double dpR;
+    double rR, rr;
     const int w = size.width();
     const int h = size.height();
     const float w2 = (float)w/2;
     const float h2 = (float)h/2;
 
+    // see yuvColorWheel
+    QVector<double> dpB(w);
+    QVector<double> rB(w);
     for (int b = 0; b < w; ++b) {
         // Transform pB from {0,...,w} to [-0.5,0.5]
-        double dpB = (double) b/(w-1) - .5;
-        dpB = scaling*dpB;
+        dpB[b] = scaling * ((double) b/(w-1) - .5);
+        rB[b] = (b - w2)*(b - w2)/(w2*w2);
+    }
 
-        for (int r = 0; r < h; ++r) {
-            dpR = (double) r/(h-1) - .5;
-            dpR = scaling*dpR;
+    for (int r = 0; r < h; ++r) {
+        dpR = (double) r/(h-1) - .5;
+        dpR = scaling*dpR;
+        rR = (r - h2)*(r - h2)/(h2*h2);
+        // Calculate the RGB values from YPbPr
+        const int red = clampColor(Y + 357.5*dpR);
+        const double gBase = Y - 182.1*dpR;
+        QRgb *line = reinterpret_cast<QRgb *>(wheel.scanLine(h-r-1));
 
+        for (int b = 0; b < w; ++b) {
             if (circleOnly) {
-                // see yuvColorWheel
-                rB = b - w2;
-                rR = r - h2;
-                rr = rB*rB/(w2*w2) + rR*rR/(h2*h2);
+                rr = rB.at(b) + rR;
                 if (rr > 1) {
                     continue;
                 }
             }
 
-            // Calculate the RGB values from YPbPr
-            dr = Y + 357.5*dpR;
-            dg = Y - 87.75*dpB - 182.1*dpR;
-            db = Y + 451.86*dpB;
-
-            // Avoid overflows (which would generate intersting patterns).
-            // Note that not all possible (y,u,v) values with u,v \in [-1,1]
-            // have a correct RGB representation, therefore some RGB values
-            // may exceed {0,...,255}.
-            if (dr < 0) dr = 0;
-            if (dg < 0) dg = 0;
-            if (db < 0) db = 0;
-            if (dr > 255) dr = 255;
-            if (dg > 255) dg = 255;
-            if (db > 255) db = 255;
-
-            wheel.setPixel(b, (h-r-1), qRgba(dr, dg, db, 255));
+            // Avoid overflows, see yuvColorWheel
+            line[b] = qRgba(red, clampColor(gBase - 87.75*dpB.at(b)), clampColor(Y + 451.86*dpB.at(b)), 255);
         }
     }
 
+    storePlane(key, wheel);
     return wheel;
 }
 
@@ -83,6 +83,14 @@ public:
     static QImage hsvCurvePlane(const QSize &size, const QColor &baseColor,
                                 const ComponentsHSV &xVariant, const ComponentsHSV &yVariant, const bool &shear = false, const float offsetY = 0);
 
+    /**
+      @brief Returns the plane stored under @param key in the plane cache shared with the planes above, or a null image.
+      Lets widgets drawing their own planes, e.g. in a worker thread, reuse them across instances.
+      */
+    static QImage cachedPlane(const QString &key);
+    /** @brief Stores @param plane under @param key in the shared plane cache. */
+    static void storePlane(const QString &key, const QImage &plane);
+
 signals:
     void signalYuvWheelCalculationFinished();
 };
@@ -16,6 +16,9 @@ the Free Software Foundation, either version 3 of the License, or
 #include "mltcontroller/producerqueue.h"
 #include "bin/bin.h"
 #include "library/librarywidget.h"
+#include "doc/thumbnailcache.h"
+#include "doc/cachegovernor.h"
+#include "doc/mediaindex.h"
 #include <QCoreApplication>
 #include <QDebug>
 
@@ -35,6 +38,10 @@ Core::Core(MainWindow *mainWindow) :
     , m_producerQueue(NULL)
     , m_binWidget(NULL)
     , m_library(NULL)
+    , m_thumbnailCache(new ThumbnailCache)
+    , m_proxyStore(NULL)
+    , m_cacheGovernor(NULL)
+    , m_mediaIndex(NULL)
 {
     connect(qApp, SIGNAL(aboutToQuit()), this, SLOT(deleteLater()));
 }
@@ -47,6 +54,7 @@ Core::~Core()
     delete m_projectManager;
     delete m_binController;
     delete m_monitorManager;
+    delete m_thumbnailCache;
     m_self = 0;
 }
 
@@ -62,6 +70,9 @@ void Core::initialize()
     m_binWidget = new Bin();
     m_binController = new BinController();
     m_library = new LibraryWidget(m_projectManager);
+    m_proxyStore = new ProxyStore(this);
+    m_cacheGovernor = new CacheGovernor(this);
+    m_mediaIndex = new MediaIndex(this);
     connect(m_library, SIGNAL(addProjectClips(QList <QUrl>)), m_binWidget, SLOT(droppedUrls(QList <QUrl>)));
     connect(this, &Core::updateLibraryPath, m_library, &LibraryWidget::slotUpdateLibraryPath);
     connect(m_binWidget, SIGNAL(storeFolder(QString,QString,QString,QString)), m_binController, SLOT(slotStoreFolder(QString,QString,QString,QString)));
@@ -116,6 +127,26 @@ Bin *Core::bin()
     return m_binWidget;
 }
 
+ThumbnailCache *Core::thumbnailCache()
+{
+    return m_thumbnailCache;
+}
+
+ProxyStore *Core::proxyStore()
+{
+    return m_proxyStore;
+}
+
+CacheGovernor *Core::cacheGovernor()
+{
+    return m_cacheGovernor;
+}
+
+MediaIndex *Core::mediaIndex()
+{
+    return m_mediaIndex;
+}
+
 ProducerQueue *Core::producerQueue()
 {
     return m_producerQueue;
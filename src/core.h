@@ -21,6 +21,10 @@ class BinController;
 class Bin;
 class LibraryWidget;
 class ProducerQueue;
+class ThumbnailCache;
+class ProxyStore;
+class CacheGovernor;
+class MediaIndex;
 
 #define pCore Core::self()
 
@@ -67,6 +71,14 @@ public:
     ProducerQueue *producerQueue();
     /** @brief Returns a pointer to the library. */
     LibraryWidget *library();
+    /** @brief Returns a pointer to the thumbnail cache shared by all clips. */
+    ThumbnailCache *thumbnailCache();
+    /** @brief Returns a pointer to the proxy store shared by all projects. */
+    ProxyStore *proxyStore();
+    /** @brief Returns a pointer to the governor keeping the cache data within its budgets. */
+    CacheGovernor *cacheGovernor();
+    /** @brief Returns a pointer to the index of the media files used to relink missing clips. */
+    MediaIndex *mediaIndex();
 
 private:
     explicit Core(MainWindow *mainWindow);
@@ -82,6 +94,10 @@ private:
     ProducerQueue *m_producerQueue;
     Bin *m_binWidget;
     LibraryWidget *m_library;
+    ThumbnailCache *m_thumbnailCache;
+    ProxyStore *m_proxyStore;
+    CacheGovernor *m_cacheGovernor;
+    MediaIndex *m_mediaIndex;
 
 signals:
     void coreIsReady();
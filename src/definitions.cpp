@@ -242,3 +242,39 @@ bool CommentedTime::operator==(CommentedTime op) const {
 bool CommentedTime::operator!=(CommentedTime op) const {
     return t != op.time();
 }
+
+AnalysisResult::AnalysisResult() {}
+
+bool AnalysisResult::isEmpty() const
+{
+    return frames.isEmpty() && values.isEmpty();
+}
+
+QString AnalysisResult::framesData() const
+{
+    QStringList data;
+    QMapIterator<int, QString> i(frames);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().isEmpty()) {
+            data << QString::number(i.key());
+        } else {
+            data << QString::number(i.key()) + QLatin1Char('=') + i.value();
+        }
+    }
+    return data.join(QLatin1Char(';'));
+}
+
+//static
+QMap <int, QString> AnalysisResult::parseFrames(const QString &data)
+{
+    QMap <int, QString> frames;
+    const QStringList entries = data.split(QLatin1Char(';'), QString::SkipEmptyParts);
+    foreach(const QString &entry, entries) {
+        bool ok;
+        int frame = entry.section(QLatin1Char('='), 0, 0).toInt(&ok);
+        if (!ok) continue;
+        frames.insert(frame, entry.section(QLatin1Char('='), 1));
+    }
+    return frames;
+}
@@ -207,6 +207,23 @@ struct ProfileInfo {
         double profileFps;
 };
 
+/** @brief A timeline zone showing a single unmodified clip, whose video could be copied from the source file */
+struct PassthroughZone {
+    /** First frame of the zone and frame following it, in timeline frames */
+    int start;
+    int end;
+    /** Frame of the source displayed at the zone start */
+    int sourceIn;
+    QString url;
+    /** Bin id of the clip */
+    QString clipId;
+    QString codec;
+    QString pixelFormat;
+    int width;
+    int height;
+    double fps;
+};
+
 struct requestClipInfo {
     QDomElement xml;
     QString clipId;
@@ -333,6 +350,24 @@ private:
     int type;
 };
 
+/** @brief Results of a clip analysis job, in a form that does not need to be parsed again. */
+class AnalysisResult
+{
+public:
+    AnalysisResult();
+    /** @brief Per frame results (scene cuts, tracked positions) indexed by frame, relative to the analysed zone */
+    QMap <int, QString> frames;
+    /** @brief Results describing the whole zone (loudness) indexed by filter property */
+    stringMap values;
+    bool isEmpty() const;
+    /** @brief Returns the frames in the "frame=value;..." format used by MLT's analysis filters. */
+    QString framesData() const;
+    /** @brief Parse a "frame=value;..." list, entries holding only a frame number get an empty value. */
+    static QMap <int, QString> parseFrames(const QString &data);
+};
+
+Q_DECLARE_METATYPE(AnalysisResult)
+
 QDebug operator << (QDebug qd, const ItemInfo &info);
 QDebug operator << (QDebug qd, const MltVideoProfile &profile);
 
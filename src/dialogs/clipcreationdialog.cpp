@@ -32,6 +32,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "titler/titlewidget.h"
 #include "titletemplatedialog.h"
 #include "project/dialogs/slideshowclip.h"
+#include "doc/proxystore.h"
+#include "mltcontroller/bincontroller.h"
+#include "core.h"
 
 #include <KMessageBox>
 #include <KRecentDirs>
@@ -40,6 +43,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "klocalizedstring.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QWindow>
 #include <QUndoStack>
 #include <QUndoCommand>
@@ -49,6 +53,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDialog>
 #include <QPointer>
 #include <QMimeDatabase>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QEventLoop>
 
 
 // static
@@ -322,18 +330,10 @@ void ClipCreationDialog::createTitleTemplateClip(KdenliveDoc *doc, QStringList g
         prod.setAttribute(QStringLiteral("templatetext"), dia->selectedText());
 
         int duration = 0;
-        QDomDocument titledoc;
-        QFile txtfile(textTemplate);
-        if (txtfile.open(QIODevice::ReadOnly) && titledoc.setContent(&txtfile)) {
-            if (titledoc.documentElement().hasAttribute(QStringLiteral("duration"))) {
-                duration = titledoc.documentElement().attribute(QStringLiteral("duration")).toInt();
-            } else {
-                // keep some time for backwards compatibility - 26/12/12
-                duration = titledoc.documentElement().attribute(QStringLiteral("out")).toInt();
-            }
+        QSharedPointer<const TitleDocument::TemplateInfo> templateInfo = TitleDocument::templateInfo(textTemplate);
+        if (templateInfo) {
+            duration = templateInfo->duration;
         }
-        txtfile.close();
-
         if (duration == 0) duration = doc->getFramePos(KdenliveSettings::title_duration());
         prod.setAttribute(QStringLiteral("duration"), duration - 1);
         prod.setAttribute(QStringLiteral("out"), duration - 1);
@@ -357,8 +357,67 @@ void ClipCreationDialog::addXmlProperties(QDomElement &producer, QMap <QString,
     }
 }
 
+// Same partial content hash as the one stored in kdenlive:file_hash
+static QString importHash(const QString &path)
+{
+    return ProxyStore::fileHash(path);
+}
+
+/** @brief Hash the files to import on the thread pool, showing progress for long imports.
+ *  Returns false if the user canceled. */
+static bool hashImportedFiles(const QStringList &paths, QStringList &hashes)
+{
+    QFuture<QString> future = QtConcurrent::mapped(paths, importHash);
+    QFutureWatcher<QString> watcher;
+    QProgressDialog progress(i18n("Analysing clips..."), i18n("Cancel"), 0, paths.count(), QApplication::activeWindow());
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    QEventLoop loop;
+    QObject::connect(&watcher, SIGNAL(progressValueChanged(int)), &progress, SLOT(setValue(int)));
+    QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    QObject::connect(&progress, SIGNAL(canceled()), &watcher, SLOT(cancel()));
+    watcher.setFuture(future);
+    if (!future.isFinished()) {
+        loop.exec();
+    }
+    if (future.isCanceled()) {
+        return false;
+    }
+    hashes = future.results();
+    return true;
+}
+
 void ClipCreationDialog::createClipsCommand(KdenliveDoc *doc, const QList<QUrl> &urls, QStringList groupInfo, Bin *bin, const QMap <QString, QString> &data)
 {
+    // Hash all files in parallel, so that duplicates are found before creating anything
+    // and clips don't have to compute their hash one after another once loaded
+    QStringList paths;
+    foreach(const QUrl &file, urls) {
+        paths << file.toLocalFile();
+    }
+    QStringList hashes;
+    if (!hashImportedFiles(paths, hashes)) {
+        return;
+    }
+    QList <QUrl> list;
+    QStringList listHashes;
+    QStringList duplicates;
+    const QStringList projectHashes = data.contains(QStringLiteral("bypassDuplicate")) ? QStringList() : pCore->binController()->getProjectHashes();
+    for (int i = 0; i < urls.count(); ++i) {
+        const QString &hash = hashes.at(i);
+        if (!hash.isEmpty() && (projectHashes.contains(hash) || listHashes.contains(hash))) {
+            duplicates << paths.at(i);
+            continue;
+        }
+        list << urls.at(i);
+        listHashes << hash;
+    }
+    if (!duplicates.isEmpty()) {
+        if (KMessageBox::questionYesNoList(QApplication::activeWindow(), i18np("This clip already exists in the project.", "These %1 clips already exist in the project.", duplicates.count()), duplicates, i18n("Clip already exists"), KGuiItem(i18n("Skip")), KGuiItem(i18n("Import anyway"))) == KMessageBox::No) {
+            list = urls;
+            listHashes = hashes;
+        }
+    }
     QUndoCommand *addClips = new QUndoCommand();
     
     //TODO: check files on removable volume
@@ -419,12 +478,23 @@ void ClipCreationDialog::createClipsCommand(KdenliveDoc *doc, const QList<QUrl>
         }
     }*/
 
-    foreach(const QUrl &file, urls) {
+    if (list.isEmpty()) {
+        delete addClips;
+        return;
+    }
+    // Insert all clips in the Bin with a single model reset
+    new BinBatchCommand(bin, true, addClips);
+    for (int ix = 0; ix < list.count(); ++ix) {
+        const QUrl &file = list.at(ix);
         QDomDocument xml;
         QDomElement prod = xml.createElement(QStringLiteral("producer"));
         xml.appendChild(prod);
         QMap <QString, QString> properties;
         properties.insert(QStringLiteral("resource"), file.path());
+        if (!listHashes.at(ix).isEmpty()) {
+            properties.insert(QStringLiteral("kdenlive:file_hash"), listHashes.at(ix));
+            properties.insert(QStringLiteral("kdenlive:file_size"), QString::number(QFileInfo(file.toLocalFile()).size()));
+        }
         if (!groupInfo.isEmpty()) {
             properties.insert(QStringLiteral("kdenlive:folderid"), groupInfo.at(0));
         }
@@ -486,10 +556,9 @@ void ClipCreationDialog::createClipsCommand(KdenliveDoc *doc, const QList<QUrl>
         addXmlProperties(prod, properties);
         new AddClipCommand(bin, xml.documentElement(), QString::number(id), true, addClips);
     }
-    if (addClips->childCount() > 0) {
-        addClips->setText(i18np("Add clip", "Add clips", addClips->childCount()));
-        doc->commandStack()->push(addClips);
-    }
+    new BinBatchCommand(bin, false, addClips);
+    addClips->setText(i18np("Add clip", "Add clips", list.count()));
+    doc->commandStack()->push(addClips);
 }
 
 void ClipCreationDialog::createClipsCommand(KdenliveDoc *doc, QStringList groupInfo, Bin *bin)
@@ -46,9 +46,15 @@
 #include <QScriptEngine>
 #include <QKeyEvent>
 #include <QTimer>
+#include <QAction>
 #include <QStandardPaths>
 #include <QMimeDatabase>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QTextDocument>
+#include <QtConcurrent>
 
 #include <locale>
 #ifdef Q_OS_MAC
@@ -72,16 +78,300 @@ enum {GroupRole = Qt::UserRole,
       ErrorRole
      };
 
+namespace {
+/**
+  A render profile as read from a profile file or MLT preset, before it is
+  added to the profile tree.
+  */
+struct RenderPreset
+{
+    RenderPreset() : overrides(false) {}
+    QString group;
+    QString name;
+    QString extension;
+    QString renderer;
+    QString standard;
+    QString params;
+    QString note;
+    QString url;
+    QStringList bitrates;
+    QStringList audioBitrates;
+    QStringList speeds;
+    /** File the profile can be edited in, empty for installed profiles */
+    QString editable;
+    /** Replace an earlier profile with the same group and name */
+    bool overrides;
+};
+
+/** A file providing render profiles, in the order the tree is built */
+struct PresetSource
+{
+    enum Kind { ProfileFile, EditableFile, LosslessPreset, StillPreset };
+    PresetSource(const QString &p, Kind k, const QString &n = QString()) : path(p), kind(k), name(n) {}
+    QString path;
+    Kind kind;
+    /** Preset name for MLT presets */
+    QString name;
+};
+
+/**
+  Parsing the profile XML files and MLT presets is slow with many downloaded
+  profiles, so the parsed profiles are shared between render dialogs and
+  only read again when their file was modified.
+  */
+struct PresetFile
+{
+    QDateTime modified;
+    QList <RenderPreset> presets;
+};
+
+struct PresetCache
+{
+    QMutex mutex;
+    QHash <QString, PresetFile> files;
+};
+
+Q_GLOBAL_STATIC(PresetCache, presetCache)
+
+QList <PresetSource> presetSources(const QString &mltPath)
+{
+    QList <PresetSource> sources;
+    // Our xml profiles
+    sources << PresetSource(QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("export/profiles.xml")), PresetSource::ProfileFile);
+
+    // Some of MLT's presets
+    QDir root(mltPath);
+    if (!root.cd(QStringLiteral("../presets/consumer/avformat"))) {
+        //Cannot find MLT's presets directory
+        qWarning()<<" / / / WARNING, cannot find MLT's preset folder";
+    } else {
+        if (root.cd(QStringLiteral("lossless"))) {
+            foreach(const QString &prof, root.entryList(QDir::Files, QDir::Name)) {
+                sources << PresetSource(root.absoluteFilePath(prof), PresetSource::LosslessPreset, prof);
+            }
+        }
+        if (root.cd(QStringLiteral("../stills"))) {
+            foreach(const QString &prof, root.entryList(QDir::Files, QDir::Name)) {
+                sources << PresetSource(root.absoluteFilePath(prof), PresetSource::StillPreset, prof);
+            }
+            // Add GIF as image sequence
+            root.cdUp();
+            sources << PresetSource(root.absoluteFilePath(QStringLiteral("GIF")), PresetSource::StillPreset, QStringLiteral("GIF"));
+        }
+    }
+
+    QString exportFolder = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/export/";
+    QDir directory(exportFolder);
+    QStringList filter;
+    filter << QStringLiteral("*.xml");
+    QStringList fileList = directory.entryList(filter, QDir::Files);
+    // We should parse customprofiles.xml in last position, so that user profiles
+    // can also override profiles installed by KNewStuff
+    fileList.removeAll(QStringLiteral("customprofiles.xml"));
+    foreach(const QString &filename, fileList)
+        sources << PresetSource(directory.absoluteFilePath(filename), PresetSource::EditableFile);
+    if (QFile::exists(exportFolder + "customprofiles.xml"))
+        sources << PresetSource(exportFolder + "customprofiles.xml", PresetSource::EditableFile);
+    return sources;
+}
+
+/** @brief Read the profile of an MLT preset file, returns false if it cannot be used */
+bool readMltPreset(const PresetSource &source, RenderPreset &preset)
+{
+    KConfig config(source.path, KConfig::SimpleConfig);
+    KConfigGroup group = config.group(QByteArray());
+    preset.name = source.name;
+    preset.renderer = QStringLiteral("avformat");
+    preset.extension = group.readEntry("meta.preset.extension");
+    preset.note = group.readEntry("meta.preset.note");
+    if (source.kind == PresetSource::StillPreset) {
+        if (preset.extension.isEmpty())
+            return false;
+        preset.group = i18nc("Category Name", "Images sequence");
+        preset.params = source.name == QLatin1String("GIF") ? QStringLiteral("properties=GIF") : QString("properties=stills/" + source.name);
+        return true;
+    }
+    QString vcodec = group.readEntry("vcodec");
+    QString acodec = group.readEntry("acodec");
+    if (!vcodec.isEmpty() || !acodec.isEmpty()) {
+        preset.name.append(" (");
+        if (!vcodec.isEmpty()) {
+            preset.name.append(vcodec);
+            if (!acodec.isEmpty()) {
+                preset.name.append("+" + acodec);
+            }
+        }
+        else if (!acodec.isEmpty()) preset.name.append(acodec);
+        preset.name.append(")");
+    }
+    preset.group = i18n("Lossless/HQ");
+    preset.params = QString("properties=lossless/" + source.name);
+    return true;
+}
+
+/** @brief Read the bitrate, quality and speed lists of a profile element */
+void readPresetLists(const QDomElement &profile, RenderPreset &preset)
+{
+    if (preset.params.contains("%quality"))
+        preset.bitrates = profile.attribute(QStringLiteral("qualities")).split(',', QString::SkipEmptyParts);
+    else if (preset.params.contains("%bitrate"))
+        preset.bitrates = profile.attribute(QStringLiteral("bitrates")).split(',', QString::SkipEmptyParts);
+    if (preset.params.contains("%audioquality"))
+        preset.audioBitrates = profile.attribute(QStringLiteral("audioqualities")).split(',', QString::SkipEmptyParts);
+    else if (preset.params.contains("%audiobitrate"))
+        preset.audioBitrates = profile.attribute(QStringLiteral("audiobitrates")).split(',', QString::SkipEmptyParts);
+    if (profile.hasAttribute(QStringLiteral("speeds")))
+        preset.speeds = profile.attribute(QStringLiteral("speeds")).split(';', QString::SkipEmptyParts);
+    preset.url = profile.attribute(QStringLiteral("url"));
+}
+
+QList <RenderPreset> readProfileFile(const QString &exportFile, bool editable)
+{
+    QList <RenderPreset> presets;
+    QDomDocument doc;
+    QFile file(exportFile);
+    doc.setContent(&file, false);
+    file.close();
+    QDomNodeList groups = doc.elementsByTagName(QStringLiteral("group"));
+
+    if (editable || groups.count() == 0) {
+        QDomElement profiles = doc.documentElement();
+        if (editable && profiles.attribute(QStringLiteral("version"), 0).toInt() < 1) {
+            // this is an old profile version, update it
+            QDomDocument newdoc;
+            QDomElement newprofiles = newdoc.createElement(QStringLiteral("profiles"));
+            newprofiles.setAttribute(QStringLiteral("version"), 1);
+            newdoc.appendChild(newprofiles);
+            QDomNodeList profilelist = doc.elementsByTagName(QStringLiteral("profile"));
+            for (int i = 0; i < profilelist.count(); ++i) {
+                QString category = i18nc("Category Name", "Custom");
+                QString extension;
+                QDomNode parent = profilelist.at(i).parentNode();
+                if (!parent.isNull()) {
+                    QDomElement parentNode = parent.toElement();
+                    if (parentNode.hasAttribute(QStringLiteral("name"))) category = parentNode.attribute(QStringLiteral("name"));
+                    extension = parentNode.attribute(QStringLiteral("extension"));
+                }
+                if (!profilelist.at(i).toElement().hasAttribute(QStringLiteral("category"))) {
+                  profilelist.at(i).toElement().setAttribute(QStringLiteral("category"), category);
+                }
+                if (!extension.isEmpty()) profilelist.at(i).toElement().setAttribute(QStringLiteral("extension"), extension);
+                QDomNode n = profilelist.at(i).cloneNode();
+                newprofiles.appendChild(newdoc.importNode(n, true));
+            }
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                qWarning() << "Unable to write to file" << exportFile;
+                return presets;
+            }
+            QTextStream out(&file);
+            out << newdoc.toString();
+            file.close();
+            return readProfileFile(exportFile, editable);
+        }
+
+        QDomNodeList profileList = doc.elementsByTagName(QStringLiteral("profile"));
+        QString extension;
+        for (int i = 0; i < profileList.count(); ++i) {
+            QDomElement profile = profileList.at(i).toElement();
+            RenderPreset preset;
+            preset.name = profile.attribute(QStringLiteral("name"));
+            preset.standard = profile.attribute(QStringLiteral("standard"));
+	    QTextDocument docConvert;
+	    docConvert.setHtml(profile.attribute(QStringLiteral("args")));
+            preset.params = docConvert.toPlainText().simplified();
+            QString prof_extension = profile.attribute(QStringLiteral("extension"));
+            if (!prof_extension.isEmpty()) extension = prof_extension;
+            preset.extension = extension;
+            preset.group = profile.attribute(QStringLiteral("category"), i18nc("Category Name", "Custom"));
+            preset.renderer = QStringLiteral("avformat");
+            preset.overrides = true;
+            if (editable) preset.editable = exportFile;
+            readPresetLists(profile, preset);
+            presets << preset;
+        }
+        return presets;
+    }
+
+    for (int i = 0; i < groups.count(); ++i) {
+        QDomElement documentElement = groups.item(i).toElement();
+        QString groupName = documentElement.attribute(QStringLiteral("name"), i18nc("Attribute Name", "Custom"));
+        QString extension = documentElement.attribute(QStringLiteral("extension"), QString());
+        QString renderer = documentElement.attribute(QStringLiteral("renderer"), QString());
+
+        QDomNode n = groups.item(i).firstChild();
+        while (!n.isNull()) {
+            if (n.toElement().tagName() != QLatin1String("profile")) {
+                n = n.nextSibling();
+                continue;
+            }
+            QDomElement profileElement = n.toElement();
+            RenderPreset preset;
+            preset.group = groupName;
+            preset.renderer = renderer;
+            preset.name = profileElement.attribute(QStringLiteral("name"));
+            preset.standard = profileElement.attribute(QStringLiteral("standard"));
+            preset.params = profileElement.attribute(QStringLiteral("args")).simplified();
+            QString prof_extension = profileElement.attribute(QStringLiteral("extension"));
+            if (!prof_extension.isEmpty()) extension = prof_extension;
+            preset.extension = extension;
+            readPresetLists(profileElement, preset);
+            presets << preset;
+            n = n.nextSibling();
+        }
+    }
+    return presets;
+}
+
+/** @brief Returns the profiles of source, parsing its file only if it changed since it was last read */
+QList <RenderPreset> cachedPresets(const PresetSource &source)
+{
+    const QDateTime modified = QFileInfo(source.path).lastModified();
+    {
+        QMutexLocker lock(&presetCache->mutex);
+        QHash <QString, PresetFile>::const_iterator cached = presetCache->files.constFind(source.path);
+        if (cached != presetCache->files.constEnd() && cached->modified == modified) {
+            return cached->presets;
+        }
+    }
+    PresetFile entry;
+    entry.modified = modified;
+    if (source.kind == PresetSource::LosslessPreset || source.kind == PresetSource::StillPreset) {
+        RenderPreset preset;
+        if (readMltPreset(source, preset)) {
+            entry.presets << preset;
+        }
+    } else {
+        entry.presets = readProfileFile(source.path, source.kind == PresetSource::EditableFile);
+        // An old profile file may have been rewritten
+        entry.modified = QFileInfo(source.path).lastModified();
+    }
+    QMutexLocker lock(&presetCache->mutex);
+    presetCache->files.insert(source.path, entry);
+    return entry.presets;
+}
+
+void preloadPresets(const QString &mltPath)
+{
+    foreach(const PresetSource &source, presetSources(mltPath)) {
+        cachedPresets(source);
+    }
+}
+}
+
 // Render job roles
 const int ParametersRole = Qt::UserRole + 1;
 const int TimeRole = Qt::UserRole + 2;
 const int ProgressRole = Qt::UserRole + 3;
 const int ExtraInfoRole = Qt::UserRole + 5;
+const int SpeedRole = Qt::UserRole + 6;
 
 const int DirectRenderType = QTreeWidgetItem::Type;
 const int ScriptRenderType = QTreeWidgetItem::UserType;
 
 
+// Delay before checking again if a throttled render job can be started (in ms)
+#define RENDER_THROTTLE_DELAY 5000
+
 // Running job status
 enum JOBSTATUS {
     WAITINGJOB = 0,
@@ -150,7 +440,8 @@ RenderWidget::RenderWidget(const QString &projectfolder, bool enableProxy, const
         QDialog(parent),
         m_projectFolder(projectfolder),
         m_profile(profile),
-        m_blockProcessing(false)
+        m_blockProcessing(false),
+        m_projectDuration(0)
 {
     m_view.setupUi(this);
     int size = style()->pixelMetric(QStyle::PM_SmallIconSize);
@@ -249,6 +540,16 @@ RenderWidget::RenderWidget(const QString &projectfolder, bool enableProxy, const
     connect(m_view.scripts_list, SIGNAL(itemSelectionChanged()), this, SLOT(slotCheckScript()));
     connect(m_view.running_jobs, SIGNAL(itemSelectionChanged()), this, SLOT(slotCheckJob()));
     connect(m_view.running_jobs, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(slotPlayRendering(QTreeWidgetItem*,int)));
+    m_view.running_jobs->setContextMenuPolicy(Qt::ActionsContextMenu);
+    m_moveFirstAction = new QAction(KoIconUtils::themedIcon(QStringLiteral("go-top")), i18n("Start Next"), this);
+    connect(m_moveFirstAction, SIGNAL(triggered()), this, SLOT(slotMoveJobFirst()));
+    m_view.running_jobs->addAction(m_moveFirstAction);
+    m_moveUpAction = new QAction(KoIconUtils::themedIcon(QStringLiteral("go-up")), i18n("Move Up"), this);
+    connect(m_moveUpAction, SIGNAL(triggered()), this, SLOT(slotMoveJobUp()));
+    m_view.running_jobs->addAction(m_moveUpAction);
+    m_moveDownAction = new QAction(KoIconUtils::themedIcon(QStringLiteral("go-down")), i18n("Move Down"), this);
+    connect(m_moveDownAction, SIGNAL(triggered()), this, SLOT(slotMoveJobDown()));
+    m_view.running_jobs->addAction(m_moveDownAction);
 
     connect(m_view.buttonSave, SIGNAL(clicked()), this, SLOT(slotSaveProfile()));
     connect(m_view.buttonEdit, SIGNAL(clicked()), this, SLOT(slotEditProfile()));
@@ -268,6 +569,8 @@ RenderWidget::RenderWidget(const QString &projectfolder, bool enableProxy, const
     connect(m_view.out_file, SIGNAL(urlSelected(QUrl)), this, SLOT(slotUpdateButtons(QUrl)));
 
     connect(m_view.formats, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)), this, SLOT(refreshParams()));
+    // Profiles selected in addition to the current one are encoded from the same render
+    m_view.formats->setSelectionMode(QAbstractItemView::ExtendedSelection);
     connect(m_view.formats, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(slotEditItem(QTreeWidgetItem*)));
 
     connect(m_view.render_guide, SIGNAL(clicked(bool)), this, SLOT(slotUpdateGuideBox()));
@@ -385,6 +688,191 @@ void RenderWidget::slotCheckEndGuidePosition()
         m_view.guide_end->setCurrentIndex(m_view.guide_start->currentIndex());
 }
 
+QList <int> RenderWidget::renderSegments(int in, int out) const
+{
+    QList <int> segments;
+    if (KdenliveSettings::ffmpegpath().isEmpty() || out <= in) {
+        return segments;
+    }
+    double fps = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
+    // Segments shorter than this are merged with the previous one
+    int minLength = fps * 10;
+    segments << in;
+    if (KdenliveSettings::rendersegmentguides() && !m_guides.isEmpty()) {
+        foreach(double guide, m_guides) {
+            int pos = GenTime(guide).frames(fps);
+            if (pos - segments.last() >= minLength && out + 1 - pos >= minLength) {
+                segments << pos;
+            }
+        }
+    } else {
+        int length = qMax(minLength, (int) (KdenliveSettings::rendersegmentlength() * fps));
+        for (int pos = in + length; out + 1 - pos >= minLength; pos += length) {
+            segments << pos;
+        }
+    }
+    if (segments.count() < 2) {
+        // Nothing to split
+        segments.clear();
+        return segments;
+    }
+    segments << out + 1;
+    return segments;
+}
+
+void RenderWidget::setPreviewChunks(const QMap <int, QString> &chunks, const QString &extension, const QStringList &parameters)
+{
+    m_previewChunks = chunks;
+    m_previewExtension = extension;
+    m_previewParameters = parameters;
+}
+
+void RenderWidget::setPassthroughZones(const QList <PassthroughZone> &zones)
+{
+    m_passthroughZones = zones;
+}
+
+QList <PassthroughZone> RenderWidget::matchingPassthroughZones(int in, int out, const QStringList &parameters) const
+{
+    QList <PassthroughZone> zones;
+    QString vcodec;
+    QString pixelFormat = QStringLiteral("yuv420p");
+    foreach(const QString &param, parameters) {
+        const QString name = param.section(QLatin1Char('='), 0, 0);
+        if (name == QLatin1String("vcodec")) {
+            vcodec = param.section(QLatin1Char('='), 1);
+        } else if (name == QLatin1String("pix_fmt")) {
+            pixelFormat = param.section(QLatin1Char('='), 1);
+        } else if (name == QLatin1String("s") || name == QLatin1String("vn") || name == QLatin1String("video_off")) {
+            // Scaled or audio only render
+            return zones;
+        }
+    }
+    // Decoder name of the streams produced by the encoder
+    QMap <QString, QString> decoders;
+    decoders.insert(QStringLiteral("libx264"), QStringLiteral("h264"));
+    decoders.insert(QStringLiteral("libx265"), QStringLiteral("hevc"));
+    decoders.insert(QStringLiteral("libvpx"), QStringLiteral("vp8"));
+    decoders.insert(QStringLiteral("libvpx-vp9"), QStringLiteral("vp9"));
+    decoders.insert(QStringLiteral("libtheora"), QStringLiteral("theora"));
+    decoders.insert(QStringLiteral("prores_ks"), QStringLiteral("prores"));
+    decoders.insert(QStringLiteral("prores_aw"), QStringLiteral("prores"));
+    const QString codec = decoders.value(vcodec, vcodec);
+    if (codec.isEmpty()) {
+        return zones;
+    }
+    const double fps = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
+    foreach(const PassthroughZone &zone, m_passthroughZones) {
+        if (zone.codec != codec || zone.pixelFormat != pixelFormat || zone.width != m_profile.width || zone.height != m_profile.height || qAbs(zone.fps - fps) > 0.01) {
+            continue;
+        }
+        PassthroughZone clipped = zone;
+        clipped.start = qMax(in, zone.start);
+        clipped.end = qMin(out + 1, zone.end);
+        if (clipped.end <= clipped.start) {
+            continue;
+        }
+        clipped.sourceIn = zone.sourceIn + clipped.start - zone.start;
+        zones << clipped;
+    }
+    return zones;
+}
+
+/** @brief Strip the parameters that do not change the encoded video stream */
+static QStringList videoEncodingParameters(const QStringList &parameters)
+{
+    QStringList result;
+    foreach(const QString &param, parameters) {
+        const QString name = param.section(QLatin1Char('='), 0, 0);
+        if (name.isEmpty() || name.startsWith(QLatin1String("meta.")) || name.startsWith(QLatin1String("glsl."))) {
+            continue;
+        }
+        if (name == QLatin1String("an") || name == QLatin1String("threads") || name == QLatin1String("real_time") || name == QLatin1String("progress")) {
+            continue;
+        }
+        if (name == QLatin1String("acodec") || name == QLatin1String("ab") || name == QLatin1String("aq") || name == QLatin1String("ar") || name == QLatin1String("ac") || name == QLatin1String("channels") || name == QLatin1String("frequency") || name == QLatin1String("audio_off")) {
+            continue;
+        }
+        result << param;
+    }
+    result.sort();
+    return result;
+}
+
+QMap <QString, QStringList> RenderWidget::additionalOutputs(const QString &dest, bool exportAudio) const
+{
+    QMap <QString, QStringList> outputs;
+    QTreeWidgetItem *current = m_view.formats->currentItem();
+    if (!current) {
+        return outputs;
+    }
+    QFileInfo destInfo(dest);
+    const QList <QTreeWidgetItem *> selection = m_view.formats->selectedItems();
+    foreach(QTreeWidgetItem *item, selection) {
+        if (item == current || item->parent() == NULL || !item->data(0, ErrorRole).isNull()) {
+            continue;
+        }
+        // All outputs share the consumer's producer graph, so they must use the project profile and consumer
+        QString params = item->data(0, ParamsRole).toString().simplified();
+        if (item->data(0, RenderRole).toString() != current->data(0, RenderRole).toString() || params.contains(QStringLiteral("mlt_profile=")) || params.contains(QStringLiteral("%dv_standard")) || params.contains(QStringLiteral("pass=2"))) {
+            continue;
+        }
+        const QString extension = item->data(0, ExtensionRole).toString();
+        QString name = item->text(0);
+        name.replace(QRegExp(QStringLiteral("[^\\w]+")), QStringLiteral("_"));
+        const QString outputPath = destInfo.absolutePath() + QDir::separator() + destInfo.completeBaseName() + QLatin1Char('_') + name + QLatin1Char('.') + extension;
+        if (outputPath == dest || outputs.contains(outputPath)) {
+            continue;
+        }
+        QScriptEngine sEngine;
+        sEngine.globalObject().setProperty(QStringLiteral("bitrate"), item->data(0, DefaultBitrateRole).toInt());
+        sEngine.globalObject().setProperty(QStringLiteral("quality"), item->data(0, DefaultBitrateRole).toInt());
+        sEngine.globalObject().setProperty(QStringLiteral("audiobitrate"), item->data(0, DefaultAudioBitrateRole).toInt());
+        sEngine.globalObject().setProperty(QStringLiteral("audioquality"), item->data(0, DefaultAudioBitrateRole).toInt());
+        sEngine.globalObject().setProperty(QStringLiteral("dar"), '@' + QString::number(m_profile.display_aspect_num) + '/' + QString::number(m_profile.display_aspect_den));
+        sEngine.globalObject().setProperty(QStringLiteral("passes"), 1);
+        QStringList paramsList = params.split(' ', QString::SkipEmptyParts);
+        paramsList.removeAll(QStringLiteral("pass=1"));
+        for (int i = 0; i < paramsList.count(); ++i) {
+            QString paramName = paramsList.at(i).section('=', 0, -2);
+            QString paramValue = paramsList.at(i).section('=', -1);
+            if (paramValue.startsWith('%')) {
+                paramValue = sEngine.evaluate(paramValue.remove(0, 1)).toString();
+                paramsList[i] = paramName + '=' + paramValue;
+            }
+            sEngine.globalObject().setProperty(paramName.toUtf8().constData(), paramValue);
+        }
+        if (!exportAudio) {
+            paramsList << QStringLiteral("an=1");
+        }
+        if (!params.contains(QStringLiteral("threads="))) {
+            paramsList << QStringLiteral("threads=%1").arg(KdenliveSettings::encodethreads());
+        }
+        outputs.insert(outputPath, paramsList);
+    }
+    return outputs;
+}
+
+QMap <int, QString> RenderWidget::reusableChunks(int in, int out, const QString &extension, const QStringList &parameters) const
+{
+    QMap <int, QString> chunks;
+    if (m_previewChunks.isEmpty() || extension != m_previewExtension || out <= in) {
+        return chunks;
+    }
+    if (videoEncodingParameters(parameters) != videoEncodingParameters(m_previewParameters)) {
+        return chunks;
+    }
+    int chunkSize = KdenliveSettings::timelinechunks();
+    QMapIterator<int, QString> i(m_previewChunks);
+    while (i.hasNext()) {
+        i.next();
+        if (i.key() >= in && i.key() + chunkSize - 1 <= out) {
+            chunks.insert(i.key(), i.value());
+        }
+    }
+    return chunks;
+}
+
 void RenderWidget::setGuides(QMap <double, QString> guidesData, double duration)
 {
     m_view.guide_start->clear();
@@ -397,6 +885,8 @@ void RenderWidget::setGuides(QMap <double, QString> guidesData, double duration)
         m_view.render_guide->setEnabled(false);
         m_view.create_chapter->setEnabled(false);
     }
+    m_guides = guidesData.keys();
+    m_projectDuration = duration;
     double fps = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
     QMapIterator<double, QString> i(guidesData);
     while (i.hasNext()) {
@@ -908,10 +1398,7 @@ void RenderWidget::focusFirstVisibleItem(const QString &profile)
 {
     QTreeWidgetItem *item = 0;
     if (!profile.isEmpty()) {
-        QList <QTreeWidgetItem *> items = m_view.formats->findItems(profile, Qt::MatchExactly | Qt::MatchRecursive);
-        if (!items.isEmpty()) {
-            item = items.first();
-        }
+        item = m_profileItems.value(profile);
     }
     if (!item) {
         // searched profile not found in any category, select 1st available profile
@@ -1051,6 +1538,12 @@ void RenderWidget::slotExport(bool scriptExport, int zoneIn, int zoneOut,
 #endif
             render_process_args << QStringLiteral("-locale:%1").arg(currentLocale);
         }
+        if (KdenliveSettings::renderstatistics()) {
+            render_process_args << QStringLiteral("-stats");
+        }
+
+        // Segmented render options are inserted here once the zone is known
+        const int segmentArgsIndex = render_process_args.count();
 
         QString renderArgs = m_view.advanced_params->toPlainText().simplified();
         QString std = renderArgs;
@@ -1094,7 +1587,9 @@ void RenderWidget::slotExport(bool scriptExport, int zoneIn, int zoneOut,
         }
 
         // If there is an fps change, we need to use the producer consumer AND update the in/out points
+        bool fpsChange = false;
         if (forcedfps > 0 && qAbs((int) 100 * forcedfps - ((int) 100 * m_profile.frame_rate_num / m_profile.frame_rate_den)) > 2) {
+            fpsChange = true;
             resizeProfile = true;
             double ratio = m_profile.frame_rate_num / m_profile.frame_rate_den / forcedfps;
             if (ratio > 0) {
@@ -1216,6 +1711,136 @@ void RenderWidget::slotExport(bool scriptExport, int zoneIn, int zoneOut,
             sEngine.globalObject().setProperty(paramName.toUtf8().constData(), paramValue);
         }
 
+        // Additional outputs encoded from the same timeline evaluation
+        QMap <QString, QStringList> extraOutputs;
+        if (!scriptExport && stemCount == 1 && !fpsChange && !m_view.checkTwoPass->isChecked() && !imageSequences.contains(extension)) {
+            extraOutputs = additionalOutputs(dest, exportAudio);
+        }
+        if (!extraOutputs.isEmpty()) {
+            QFile outputList(playlistPaths.at(stemIdx) + QStringLiteral(".multi"));
+            if (outputList.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                QTextStream outStream(&outputList);
+                outStream.setCodec("UTF-8");
+                QMapIterator<QString, QStringList> i(extraOutputs);
+                while (i.hasNext()) {
+                    i.next();
+                    outStream << i.key() << '\t' << i.value().join(QLatin1Char(' ')) << '\n';
+                }
+                outputList.close();
+                render_process_args.insert(segmentArgsIndex, QStringLiteral("-multi:") + outputList.fileName());
+            } else {
+                extraOutputs.clear();
+            }
+        }
+
+        if (extraOutputs.isEmpty() && !fpsChange && !m_view.checkTwoPass->isChecked() && !imageSequences.contains(extension) && !KdenliveSettings::ffmpegpath().isEmpty()) {
+            int in = 0;
+            int out = GenTime(m_projectDuration).frames((double) m_profile.frame_rate_num / m_profile.frame_rate_den) - 1;
+            if (m_view.render_zone->isChecked()) {
+                in = zoneIn;
+                out = zoneOut;
+            } else if (m_view.render_guide->isChecked()) {
+                double fps = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
+                in = GenTime(m_view.guide_start->itemData(m_view.guide_start->currentIndex()).toDouble()).frames(fps);
+                out = GenTime(m_view.guide_end->itemData(m_view.guide_end->currentIndex()).toDouble()).frames(fps);
+            }
+            QMap <int, QString> chunks;
+            if (!resizeProfile && stemCount == 1 && overlayargs.isEmpty()) {
+                chunks = reusableChunks(in, out, extension, paramsList);
+            }
+            QList <PassthroughZone> zones;
+            if (chunks.isEmpty() && !resizeProfile && stemCount == 1 && overlayargs.isEmpty()) {
+                zones = matchingPassthroughZones(in, out, paramsList);
+            }
+            QList <int> segments;
+            if (chunks.isEmpty()) {
+                if (KdenliveSettings::segmentedrender()) {
+                    segments = renderSegments(in, out);
+                }
+                if (segments.isEmpty() && !zones.isEmpty()) {
+                    // kdenlive_render splits the zone at the keyframes of the copied sources
+                    segments << in << out + 1;
+                }
+            } else {
+                // Each reused chunk is a segment of its own, the gaps between them are rendered
+                int pos = in;
+                int chunkSize = KdenliveSettings::timelinechunks();
+                QMapIterator<int, QString> i(chunks);
+                while (i.hasNext()) {
+                    i.next();
+                    if (i.key() > pos) {
+                        QList <int> gap;
+                        if (KdenliveSettings::segmentedrender()) {
+                            gap = renderSegments(pos, i.key() - 1);
+                        }
+                        if (gap.isEmpty()) {
+                            segments << pos;
+                        } else {
+                            gap.removeLast();
+                            segments << gap;
+                        }
+                    }
+                    segments << i.key();
+                    pos = i.key() + chunkSize;
+                }
+                if (pos <= out) {
+                    QList <int> gap;
+                    if (KdenliveSettings::segmentedrender()) {
+                        gap = renderSegments(pos, out);
+                    }
+                    if (gap.isEmpty()) {
+                        segments << pos;
+                    } else {
+                        gap.removeLast();
+                        segments << gap;
+                    }
+                }
+                segments << out + 1;
+            }
+            if (!segments.isEmpty()) {
+                QStringList positions;
+                foreach(int pos, segments) {
+                    positions << QString::number(pos);
+                }
+                QStringList segmentArgs;
+                segmentArgs << QStringLiteral("-segments:") + positions.join(QLatin1Char(','));
+                segmentArgs << QStringLiteral("-jobs:%1").arg(KdenliveSettings::rendersegmentjobs());
+                segmentArgs << QStringLiteral("-ffmpeg:") + KdenliveSettings::ffmpegpath();
+                if (!chunks.isEmpty()) {
+                    QFile chunkList(playlistPaths.at(stemIdx) + QStringLiteral(".chunks"));
+                    if (chunkList.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                        QTextStream outStream(&chunkList);
+                        outStream.setCodec("UTF-8");
+                        QMapIterator<int, QString> i(chunks);
+                        while (i.hasNext()) {
+                            i.next();
+                            outStream << i.key() << '\t' << i.value() << '\n';
+                        }
+                        chunkList.close();
+                        segmentArgs << QStringLiteral("-chunks:") + chunkList.fileName();
+                    }
+                }
+                if (!KdenliveSettings::renderfarmfolder().isEmpty() && QDir(KdenliveSettings::renderfarmfolder()).exists()) {
+                    segmentArgs << QStringLiteral("-farm:") + KdenliveSettings::renderfarmfolder();
+                }
+                if (!zones.isEmpty()) {
+                    QFile zoneList(playlistPaths.at(stemIdx) + QStringLiteral(".passthrough"));
+                    if (zoneList.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                        QTextStream outStream(&zoneList);
+                        outStream.setCodec("UTF-8");
+                        foreach(const PassthroughZone &zone, zones) {
+                            outStream << zone.start << '\t' << zone.end << '\t' << zone.sourceIn << '\t' << zone.fps << '\t' << zone.url << '\n';
+                        }
+                        zoneList.close();
+                        segmentArgs << QStringLiteral("-passthrough:") + zoneList.fileName();
+                    }
+                }
+                for (int i = 0; i < segmentArgs.count(); ++i) {
+                    render_process_args.insert(segmentArgsIndex + i, segmentArgs.at(i));
+                }
+            }
+        }
+
         if (resizeProfile && !KdenliveSettings::gpu_accel())
             render_process_args << "consumer:" + (scriptExport ? "$SOURCE_" + QString::number(stemIdx) : playlistPaths.at(stemIdx));
         else
@@ -1355,30 +1980,121 @@ void RenderWidget::checkRenderStatus()
 
     RenderJobItem* item = static_cast<RenderJobItem*> (m_view.running_jobs->topLevelItem(0));
 
-    // Make sure no other rendering is running
+    // Count the jobs already rendering
+    int activeJobs = 0;
     while (item) {
-        if (item->status() == RUNNINGJOB)
-            return;
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB)
+            activeJobs++;
         item = static_cast<RenderJobItem*> (m_view.running_jobs->itemBelow(item));
     }
+    int maxJobs = qMax(1, KdenliveSettings::maxrenderjobs());
     item = static_cast<RenderJobItem*> (m_view.running_jobs->topLevelItem(0));
     bool waitingJob = false;
 
-    // Find first waiting job
+    // Start waiting jobs in queue order
     while (item) {
         if (item->status() == WAITINGJOB) {
-            item->setData(1, TimeRole, QDateTime::currentDateTime());
             waitingJob = true;
-            startRendering(item);
+            if (activeJobs >= maxJobs) {
+                break;
+            }
+            if (activeJobs > 0 && !canStartAdditionalJob()) {
+                // Retry later, when the running jobs may have released some resources
+                QTimer::singleShot(RENDER_THROTTLE_DELAY, this, SLOT(checkRenderStatus()));
+                break;
+            }
+            item->setData(1, TimeRole, QDateTime::currentDateTime());
             item->setStatus(STARTINGJOB);
-            break;
+            startRendering(item);
+            if (item->status() == STARTINGJOB) {
+                activeJobs++;
+            }
         }
         item = static_cast<RenderJobItem*> (m_view.running_jobs->itemBelow(item));
     }
-    if (waitingJob == false && m_view.shutdown->isChecked())
+    if (waitingJob == false && activeJobs == 0 && m_view.shutdown->isChecked())
         emit shutdown();
 }
 
+bool RenderWidget::canStartAdditionalJob() const
+{
+    if (!KdenliveSettings::renderthrottle()) {
+        return true;
+    }
+    // Only Linux exposes the figures we need, elsewhere the concurrency limit is the only rule
+#ifdef Q_OS_LINUX
+    QFile loadFile(QStringLiteral("/proc/loadavg"));
+    if (loadFile.open(QIODevice::ReadOnly)) {
+        double load = QString::fromLatin1(loadFile.readAll()).section(QLatin1Char(' '), 0, 0).toDouble();
+        loadFile.close();
+        if (load >= QThread::idealThreadCount()) {
+            return false;
+        }
+    }
+    QFile memFile(QStringLiteral("/proc/meminfo"));
+    if (memFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream stream(&memFile);
+        QString line = stream.readLine();
+        while (!line.isNull()) {
+            if (line.startsWith(QLatin1String("MemAvailable:"))) {
+                qint64 available = line.section(QLatin1Char(':'), 1).simplified().section(QLatin1Char(' '), 0, 0).toLongLong() / 1024;
+                if (available < KdenliveSettings::renderminfreememory()) {
+                    return false;
+                }
+                break;
+            }
+            line = stream.readLine();
+        }
+        memFile.close();
+    }
+#endif
+    return true;
+}
+
+void RenderWidget::moveJob(int row)
+{
+    RenderJobItem *current = static_cast<RenderJobItem*> (m_view.running_jobs->currentItem());
+    if (!current || current->status() != WAITINGJOB || row < 0 || row >= m_view.running_jobs->topLevelItemCount()) {
+        return;
+    }
+    int ix = m_view.running_jobs->indexOfTopLevelItem(current);
+    if (ix == row) {
+        return;
+    }
+    m_view.running_jobs->takeTopLevelItem(ix);
+    m_view.running_jobs->insertTopLevelItem(row, current);
+    m_view.running_jobs->setCurrentItem(current);
+    slotCheckJob();
+}
+
+void RenderWidget::slotMoveJobUp()
+{
+    RenderJobItem *current = static_cast<RenderJobItem*> (m_view.running_jobs->currentItem());
+    if (current) {
+        moveJob(m_view.running_jobs->indexOfTopLevelItem(current) - 1);
+    }
+}
+
+void RenderWidget::slotMoveJobDown()
+{
+    RenderJobItem *current = static_cast<RenderJobItem*> (m_view.running_jobs->currentItem());
+    if (current) {
+        moveJob(m_view.running_jobs->indexOfTopLevelItem(current) + 1);
+    }
+}
+
+void RenderWidget::slotMoveJobFirst()
+{
+    // Place the job before all other waiting jobs
+    for (int i = 0; i < m_view.running_jobs->topLevelItemCount(); ++i) {
+        RenderJobItem *item = static_cast<RenderJobItem*> (m_view.running_jobs->topLevelItem(i));
+        if (item->status() == WAITINGJOB) {
+            moveJob(i);
+            break;
+        }
+    }
+}
+
 void RenderWidget::startRendering(RenderJobItem *item)
 {
     if (item->type() == DirectRenderType) {
@@ -1441,6 +2157,8 @@ void RenderWidget::refreshView()
     const QColor disabled = scheme.foreground(KColorScheme::InactiveText).color();
     const QColor disabledbg = scheme.background(KColorScheme::NegativeBackground).color();
     double project_framerate = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
+    // Many render profiles share the same MLT profile, only read each once
+    QHash <QString, MltVideoProfile> mltProfiles;
     for (int i = 0; i < m_view.formats->topLevelItemCount(); ++i) {
         QTreeWidgetItem *group = m_view.formats->topLevelItem(i);
         for (int j = 0; j < group->childCount(); ++j) {
@@ -1461,7 +2179,10 @@ void RenderWidget::refreshView()
             // Make sure the selected profile uses the same frame rate as project profile
             if (std.contains(QStringLiteral("mlt_profile="))) {
                 QString profile = std.section(QStringLiteral("mlt_profile="), 1, 1).section(' ', 0, 0);
-                MltVideoProfile p = ProfilesDialog::getVideoProfile(profile);
+                if (!mltProfiles.contains(profile)) {
+                    mltProfiles.insert(profile, ProfilesDialog::getVideoProfile(profile));
+                }
+                const MltVideoProfile &p = mltProfiles[profile];
                 if (p.frame_rate_den > 0) {
                     double profile_rate = (double) p.frame_rate_num / p.frame_rate_den;
                     if ((int) (1000.0 * profile_rate) != (int) (1000.0 * project_framerate)) {
@@ -1686,192 +2407,37 @@ void RenderWidget::reloadProfiles()
     parseProfiles();
 }
 
-void RenderWidget::parseProfiles(const QString &selectedProfile)
-{
-    m_view.formats->clear();
-
-    // Parse our xml profile
-    QString exportFile = QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("export/profiles.xml"));
-    parseFile(exportFile, false);
-
-    // Parse some MLT's profiles
-    parseMltPresets();
-
-    QString exportFolder = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/export/";
-    QDir directory(exportFolder);
-    QStringList filter;
-    filter << QStringLiteral("*.xml");
-    QStringList fileList = directory.entryList(filter, QDir::Files);
-    // We should parse customprofiles.xml in last position, so that user profiles
-    // can also override profiles installed by KNewStuff
-    fileList.removeAll(QStringLiteral("customprofiles.xml"));
-    foreach(const QString &filename, fileList)
-        parseFile(directory.absoluteFilePath(filename), true);
-    if (QFile::exists(exportFolder + "customprofiles.xml"))
-        parseFile(exportFolder + "customprofiles.xml", true);
-
-    focusFirstVisibleItem(selectedProfile);
-}
-
-void RenderWidget::parseMltPresets()
-{
-    QDir root(KdenliveSettings::mltpath());
-    if (!root.cd(QStringLiteral("../presets/consumer/avformat"))) {
-        //Cannot find MLT's presets directory
-        qWarning()<<" / / / WARNING, cannot find MLT's preset folder";
-        return;
-    }
-    if (root.cd(QStringLiteral("lossless"))) {
-        QString groupName = i18n("Lossless/HQ");
-        QList<QTreeWidgetItem *> foundGroup = m_view.formats->findItems(groupName, Qt::MatchExactly);
-        QTreeWidgetItem *groupItem;
-        if (!foundGroup.isEmpty()) {
-            groupItem = foundGroup.takeFirst();
-        } else {
-            groupItem = new QTreeWidgetItem(QStringList(groupName));
-            m_view.formats->addTopLevelItem(groupItem);
-            groupItem->setExpanded(true);
-        }
-
-        QStringList profiles = root.entryList(QDir::Files, QDir::Name);
-        foreach(const QString &prof, profiles) {
-            KConfig config(root.absoluteFilePath(prof), KConfig::SimpleConfig );
-            KConfigGroup group = config.group(QByteArray());
-            QString vcodec = group.readEntry("vcodec");
-            QString acodec = group.readEntry("acodec");
-            QString extension = group.readEntry("meta.preset.extension");
-            QString note = group.readEntry("meta.preset.note");
-            QString profileName = prof;
-            if (!vcodec.isEmpty() || !acodec.isEmpty()) {
-                profileName.append(" (");
-                if (!vcodec.isEmpty()) {
-                    profileName.append(vcodec);
-                    if (!acodec.isEmpty()) {
-                        profileName.append("+" + acodec);
-                    }
-                }
-                else if (!acodec.isEmpty()) profileName.append(acodec);
-                profileName.append(")");
-            }
-            QTreeWidgetItem *item = new QTreeWidgetItem(QStringList(profileName));
-            item->setData(0, ExtensionRole, extension);
-            item->setData(0, RenderRole, "avformat");
-            item->setData(0, ParamsRole, QString("properties=lossless/" + prof));
-            if (!note.isEmpty()) item->setToolTip(0, note);
-            groupItem->addChild(item);
-        }
-    }
-    if (root.cd(QStringLiteral("../stills"))) {
-        QString groupName =i18nc("Category Name", "Images sequence");
-        QList<QTreeWidgetItem *> foundGroup = m_view.formats->findItems(groupName, Qt::MatchExactly);
-        QTreeWidgetItem *groupItem;
-        if (!foundGroup.isEmpty()) {
-            groupItem = foundGroup.takeFirst();
-        } else {
-            groupItem = new QTreeWidgetItem(QStringList(groupName));
-            m_view.formats->addTopLevelItem(groupItem);
-            groupItem->setExpanded(true);
-        }
-        QStringList profiles = root.entryList(QDir::Files, QDir::Name);
-        foreach(const QString &prof, profiles) {
-            QTreeWidgetItem *item = loadFromMltPreset(groupName, root.absoluteFilePath(prof), prof);
-            if (!item)
-                continue;
-            item->setData(0, ParamsRole, QString("properties=stills/" + prof));
-            groupItem->addChild(item);
-        }
-        // Add GIF as image sequence
-        root.cdUp();
-        QTreeWidgetItem *item = loadFromMltPreset(groupName, root.absoluteFilePath(QStringLiteral("GIF")), QStringLiteral("GIF"));
-        if (item) {
-            item->setData(0, ParamsRole, QString("properties=GIF"));
-            groupItem->addChild(item);
-        }
-    }
-}
-
-QTreeWidgetItem *RenderWidget::loadFromMltPreset(const QString groupName, const QString path, const QString profileName)
+void RenderWidget::preloadProfiles()
 {
-    KConfig config(path, KConfig::SimpleConfig);
-    KConfigGroup group = config.group(QByteArray());
-    QString extension = group.readEntry("meta.preset.extension");
-    QString note = group.readEntry("meta.preset.note");
-    if (extension.isEmpty())
-        return NULL;
-    QTreeWidgetItem *item = new QTreeWidgetItem(QStringList(profileName));
-    item->setData(0, GroupRole, groupName);
-    item->setData(0, ExtensionRole, extension);
-    item->setData(0, RenderRole, "avformat");
-    if (!note.isEmpty()) item->setToolTip(0, note);
-    return item;
+    QtConcurrent::run(preloadPresets, KdenliveSettings::mltpath());
 }
 
-void RenderWidget::parseFile(const QString &exportFile, bool editable)
+void RenderWidget::parseProfiles(const QString &selectedProfile)
 {
-    QDomDocument doc;
-    QFile file(exportFile);
-    doc.setContent(&file, false);
-    file.close();
-    QDomElement documentElement;
-    QDomElement profileElement;
-    QString extension;
-    QDomNodeList groups = doc.elementsByTagName(QStringLiteral("group"));
-    QTreeWidgetItem *item = NULL;
+    m_view.formats->clear();
+    m_profileGroups.clear();
+    m_profileItems.clear();
+    QHash <QPair <QString, QString>, QTreeWidgetItem *> groupProfiles;
     const QStringList acodecsList = KdenliveSettings::audiocodecs();
-    bool replaceVorbisCodec = false;
-    if (acodecsList.contains(QStringLiteral("libvorbis"))) replaceVorbisCodec = true;
-    bool replaceLibfaacCodec = false;
-    if (acodecsList.contains(QStringLiteral("libfaac"))) replaceLibfaacCodec = true;
-
-    if (editable || groups.count() == 0) {
-        QDomElement profiles = doc.documentElement();
-        if (editable && profiles.attribute(QStringLiteral("version"), 0).toInt() < 1) {
-            // this is an old profile version, update it
-            QDomDocument newdoc;
-            QDomElement newprofiles = newdoc.createElement(QStringLiteral("profiles"));
-            newprofiles.setAttribute(QStringLiteral("version"), 1);
-            newdoc.appendChild(newprofiles);
-            QDomNodeList profilelist = doc.elementsByTagName(QStringLiteral("profile"));
-            for (int i = 0; i < profilelist.count(); ++i) {
-                QString category = i18nc("Category Name", "Custom");
-                QString extension;
-                QDomNode parent = profilelist.at(i).parentNode();
-                if (!parent.isNull()) {
-                    QDomElement parentNode = parent.toElement();
-                    if (parentNode.hasAttribute(QStringLiteral("name"))) category = parentNode.attribute(QStringLiteral("name"));
-                    extension = parentNode.attribute(QStringLiteral("extension"));
-                }
-                if (!profilelist.at(i).toElement().hasAttribute(QStringLiteral("category"))) {
-                  profilelist.at(i).toElement().setAttribute(QStringLiteral("category"), category);
+    bool replaceVorbisCodec = acodecsList.contains(QStringLiteral("libvorbis"));
+    bool replaceLibfaacCodec = acodecsList.contains(QStringLiteral("libfaac"));
+    const QIcon favoriteIcon = KoIconUtils::themedIcon(QStringLiteral("favorite"));
+    const QIcon downloadedIcon = QIcon::fromTheme(QStringLiteral("applications-internet"));
+
+    foreach(const PresetSource &source, presetSources(KdenliveSettings::mltpath())) {
+        foreach(const RenderPreset &preset, cachedPresets(source)) {
+            QTreeWidgetItem *groupItem = m_profileGroups.value(preset.group);
+            if (!groupItem) {
+                groupItem = new QTreeWidgetItem(QStringList(preset.group));
+                if (!preset.editable.isEmpty()) {
+                    m_view.formats->insertTopLevelItem(0, groupItem);
+                } else {
+                    m_view.formats->addTopLevelItem(groupItem);
+                    groupItem->setExpanded(true);
                 }
-                if (!extension.isEmpty()) profilelist.at(i).toElement().setAttribute(QStringLiteral("extension"), extension);
-                QDomNode n = profilelist.at(i).cloneNode();
-                newprofiles.appendChild(newdoc.importNode(n, true));
-            }
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                KMessageBox::sorry(this, i18n("Unable to write to file %1", exportFile));
-                return;
+                m_profileGroups.insert(preset.group, groupItem);
             }
-            QTextStream out(&file);
-            out << newdoc.toString();
-            file.close();
-            parseFile(exportFile, editable);
-            return;
-        }
-
-        QDomNode node = doc.elementsByTagName(QStringLiteral("profile")).at(0);
-        if (node.isNull()) {
-            return;
-        }
-        int count = 1;
-        while (!node.isNull()) {
-            QDomElement profile = node.toElement();
-            QString profileName = profile.attribute(QStringLiteral("name"));
-            QString standard = profile.attribute(QStringLiteral("standard"));
-	    QTextDocument docConvert;
-	    docConvert.setHtml(profile.attribute(QStringLiteral("args")));
-            QString params = docConvert.toPlainText().simplified();
-
+            QString params = preset.params;
             if (replaceVorbisCodec && params.contains(QStringLiteral("acodec=vorbis"))) {
                 // replace vorbis with libvorbis
                 params = params.replace(QLatin1String("=vorbis"), QLatin1String("=libvorbis"));
@@ -1881,139 +2447,45 @@ void RenderWidget::parseFile(const QString &exportFile, bool editable)
                 params = params.replace(QLatin1String("aac"), QLatin1String("libfaac"));
             }
 
-            QString prof_extension = profile.attribute(QStringLiteral("extension"));
-            if (!prof_extension.isEmpty()) extension = prof_extension;
-            QString groupName = profile.attribute(QStringLiteral("category"), i18nc("Category Name", "Custom"));
-            QList<QTreeWidgetItem *> foundGroup = m_view.formats->findItems(groupName, Qt::MatchExactly);
-            QTreeWidgetItem *groupItem;
-            if (!foundGroup.isEmpty()) {
-                groupItem = foundGroup.takeFirst();
-            } else {
-                groupItem = new QTreeWidgetItem(QStringList(groupName));
-                if (editable)
-                    m_view.formats->insertTopLevelItem(0, groupItem);
-                else {
-                    m_view.formats->addTopLevelItem(groupItem);
-                    groupItem->setExpanded(true);
-                }
-            }
-            
             // Check if item with same name already exists and replace it,
             // allowing to override default profiles
-            QTreeWidgetItem *item  = 0;
-            for (int j = 0; j < groupItem->childCount(); ++j) {
-                if (groupItem->child(j)->text(0) == profileName) {
-                    item = groupItem->child(j);
-                    break;
+            const QPair <QString, QString> key(preset.group, preset.name);
+            QTreeWidgetItem *item = preset.overrides ? groupProfiles.value(key) : NULL;
+            if (!item) {
+                item = new QTreeWidgetItem(QStringList(preset.name));
+                groupItem->addChild(item);
+                if (!groupProfiles.contains(key)) {
+                    groupProfiles.insert(key, item);
+                }
+                if (!m_profileItems.contains(preset.name)) {
+                    m_profileItems.insert(preset.name, item);
                 }
             }
-            if (!item) item = new QTreeWidgetItem(QStringList(profileName));
-            item->setData(0, GroupRole, groupName);
-            item->setData(0, ExtensionRole, extension);
-            item->setData(0, RenderRole, "avformat");
-            item->setData(0, StandardRole, standard);
+            item->setData(0, GroupRole, preset.group);
+            item->setData(0, ExtensionRole, preset.extension);
+            item->setData(0, RenderRole, preset.renderer);
+            item->setData(0, StandardRole, preset.standard);
             item->setData(0, ParamsRole, params);
-            if (params.contains("%quality"))
-                item->setData(0, BitratesRole, profile.attribute(QStringLiteral("qualities")).split(',', QString::SkipEmptyParts));
-            else if (params.contains("%bitrate"))
-                item->setData(0, BitratesRole, profile.attribute(QStringLiteral("bitrates")).split(',', QString::SkipEmptyParts));
-            if (params.contains("%audioquality"))
-                item->setData(0, AudioBitratesRole, profile.attribute(QStringLiteral("audioqualities")).split(',', QString::SkipEmptyParts));
-            else if (params.contains("%audiobitrate"))
-                item->setData(0, AudioBitratesRole, profile.attribute(QStringLiteral("audiobitrates")).split(',', QString::SkipEmptyParts));
-            if (profile.hasAttribute(QStringLiteral("speeds")))
-                item->setData(0, SpeedsRole, profile.attribute(QStringLiteral("speeds")).split(';', QString::SkipEmptyParts));
-            if (profile.hasAttribute(QStringLiteral("url")))
-                item->setData(0, ExtraRole, profile.attribute(QStringLiteral("url")));
-            if (editable) {
-                item->setData(0, EditableRole, exportFile);
-                if (exportFile.endsWith(QLatin1String("customprofiles.xml")))
-                    item->setIcon(0, KoIconUtils::themedIcon(QStringLiteral("favorite")));
-                else item->setIcon(0, QIcon::fromTheme(QStringLiteral("applications-internet")));
+            if (!preset.bitrates.isEmpty())
+                item->setData(0, BitratesRole, preset.bitrates);
+            if (!preset.audioBitrates.isEmpty())
+                item->setData(0, AudioBitratesRole, preset.audioBitrates);
+            if (!preset.speeds.isEmpty())
+                item->setData(0, SpeedsRole, preset.speeds);
+            if (!preset.url.isEmpty())
+                item->setData(0, ExtraRole, preset.url);
+            if (!preset.note.isEmpty())
+                item->setToolTip(0, preset.note);
+            if (!preset.editable.isEmpty()) {
+                item->setData(0, EditableRole, preset.editable);
+                item->setIcon(0, preset.editable.endsWith(QLatin1String("customprofiles.xml")) ? favoriteIcon : downloadedIcon);
             }
-            groupItem->addChild(item);
-            node = doc.elementsByTagName(QStringLiteral("profile")).at(count);
-            count++;
         }
-        return;
     }
 
-    int i = 0;
-    QString groupName;
-    QString profileName;
-
-    QString prof_extension;
-    QString renderer;
-    QString params;
-    QString standard;
-    QIcon icon;
-
-    while (!groups.item(i).isNull()) {
-        documentElement = groups.item(i).toElement();
-        QDomNode gname = documentElement.elementsByTagName(QStringLiteral("groupname")).at(0);
-        groupName = documentElement.attribute(QStringLiteral("name"), i18nc("Attribute Name", "Custom"));
-        extension = documentElement.attribute(QStringLiteral("extension"), QString());
-        renderer = documentElement.attribute(QStringLiteral("renderer"), QString());
-        QList<QTreeWidgetItem *> foundGroup = m_view.formats->findItems(groupName, Qt::MatchExactly);
-        QTreeWidgetItem *groupItem;
-        if (!foundGroup.isEmpty()) {
-            groupItem = foundGroup.takeFirst();
-        } else {
-            groupItem = new QTreeWidgetItem(QStringList(groupName));
-            m_view.formats->addTopLevelItem(groupItem);
-            groupItem->setExpanded(true);
-        }
-
-        QDomNode n = groups.item(i).firstChild();
-        while (!n.isNull()) {
-            if (n.toElement().tagName() != QLatin1String("profile")) {
-                n = n.nextSibling();
-                continue;
-            }
-            profileElement = n.toElement();
-            profileName = profileElement.attribute(QStringLiteral("name"));
-            standard = profileElement.attribute(QStringLiteral("standard"));
-            params = profileElement.attribute(QStringLiteral("args")).simplified();
-
-            if (replaceVorbisCodec && params.contains(QStringLiteral("acodec=vorbis"))) {
-                // replace vorbis with libvorbis
-                params = params.replace(QLatin1String("=vorbis"), QLatin1String("=libvorbis"));
-            }
-            if (replaceLibfaacCodec && params.contains(QStringLiteral("acodec=aac"))) {
-                // replace libfaac with aac
-                params = params.replace(QLatin1String("aac"), QLatin1String("libfaac"));
-            }
-
-            prof_extension = profileElement.attribute(QStringLiteral("extension"));
-            if (!prof_extension.isEmpty()) extension = prof_extension;
-            item = new QTreeWidgetItem(QStringList(profileName));
-            item->setData(0, GroupRole, groupName);
-            item->setData(0, ExtensionRole, extension);
-            item->setData(0, RenderRole, renderer);
-            item->setData(0, StandardRole, standard);
-            item->setData(0, ParamsRole, params);
-            if (params.contains("%quality"))
-                item->setData(0, BitratesRole, profileElement.attribute(QStringLiteral("qualities")).split(',', QString::SkipEmptyParts));
-            else if (params.contains("%bitrate"))
-                item->setData(0, BitratesRole, profileElement.attribute(QStringLiteral("bitrates")).split(',', QString::SkipEmptyParts));
-            if (params.contains("%audioquality"))
-                item->setData(0, AudioBitratesRole, profileElement.attribute(QStringLiteral("audioqualities")).split(',', QString::SkipEmptyParts));
-            else if (params.contains("%audiobitrate"))
-                item->setData(0, AudioBitratesRole, profileElement.attribute(QStringLiteral("audiobitrates")).split(',', QString::SkipEmptyParts));
-            if (profileElement.hasAttribute(QStringLiteral("speeds")))
-                item->setData(0, SpeedsRole, profileElement.attribute(QStringLiteral("speeds")).split(';', QString::SkipEmptyParts));
-            if (profileElement.hasAttribute(QStringLiteral("url")))
-                item->setData(0, ExtraRole, profileElement.attribute(QStringLiteral("url")));
-            groupItem->addChild(item);
-            n = n.nextSibling();
-        }
-
-        ++i;
-    }
+    focusFirstVisibleItem(selectedProfile);
 }
 
-
-
 void RenderWidget::setRenderJob(const QString &dest, int progress)
 {
     RenderJobItem *item;
@@ -2044,10 +2516,29 @@ void RenderWidget::setRenderJob(const QString &dest, int progress)
         QString est = (days > 0) ? i18np("%1 day ", "%1 days ", days) : QString();
         est.append(when.toString(QStringLiteral("hh:mm:ss")));
         QString t = i18n("Remaining time %1", est);
+        const QString speed = item->data(1, SpeedRole).toString();
+        if (!speed.isEmpty()) {
+            t.append(QStringLiteral(" - ") + speed);
+        }
         item->setData(1, Qt::UserRole, t);
     }
 }
 
+void RenderWidget::setRenderSpeed(const QString &dest, double fps, int cpu)
+{
+    QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(dest, Qt::MatchExactly, 1);
+    if (existing.isEmpty()) {
+        return;
+    }
+    RenderJobItem *item = static_cast<RenderJobItem*> (existing.at(0));
+    QString speed = i18n("%1 fps", QString::number(fps, 'f', 1));
+    if (cpu >= 0) {
+        // A render that cannot keep its threads busy is waiting on decoding or disk access
+        speed.append(QStringLiteral(", ") + i18n("CPU %1% of %2 cores", cpu, QThread::idealThreadCount()));
+    }
+    item->setData(1, SpeedRole, speed);
+}
+
 void RenderWidget::setRenderStatus(const QString &dest, int status, const QString &error)
 {
     RenderJobItem *item;
@@ -2114,8 +2605,11 @@ void RenderWidget::slotAbortCurrentJob()
 void RenderWidget::slotStartCurrentJob()
 {
     RenderJobItem *current = static_cast<RenderJobItem*> (m_view.running_jobs->currentItem());
-    if (current && current->status() == WAITINGJOB)
+    if (current && current->status() == WAITINGJOB) {
+        current->setData(1, TimeRole, QDateTime::currentDateTime());
+        current->setStatus(STARTINGJOB);
         startRendering(current);
+    }
     m_view.start_job->setEnabled(false);
 }
 
@@ -2134,6 +2628,11 @@ void RenderWidget::slotCheckJob()
         activate = true;
     }
     m_view.abort_job->setEnabled(activate);
+    bool waiting = current && current->status() == WAITINGJOB;
+    int ix = current ? m_view.running_jobs->indexOfTopLevelItem(current) : -1;
+    m_moveFirstAction->setEnabled(waiting);
+    m_moveUpAction->setEnabled(waiting && ix > 0);
+    m_moveDownAction->setEnabled(waiting && ix < m_view.running_jobs->topLevelItemCount() - 1);
     /*
     for (int i = 0; i < m_view.running_jobs->topLevelItemCount(); ++i) {
         current = static_cast<RenderJobItem*>(m_view.running_jobs->topLevelItem(i));
@@ -32,6 +32,7 @@
 
 class QDomElement;
 class QKeyEvent;
+class QAction;
 
 
 // RenderViewDelegate is used to draw the progress bars.
@@ -114,12 +115,20 @@ public:
     explicit RenderWidget(const QString &projectfolder, bool enableProxy, const MltVideoProfile &profile, QWidget * parent = 0);
     virtual ~RenderWidget();
     void setGuides(QMap <double, QString> guidesData, double duration);
+    /** @brief Set the timeline preview chunks that the next export can copy instead of rendering them */
+    void setPreviewChunks(const QMap <int, QString> &chunks, const QString &extension, const QStringList &parameters);
+    /** @brief Set the timeline zones whose video the next export can copy from the source files */
+    void setPassthroughZones(const QList <PassthroughZone> &zones);
     void focusFirstVisibleItem(const QString &profile = QString());
     void setProfile(const MltVideoProfile& profile);
     void setRenderJob(const QString &dest, int progress = 0);
     void setRenderStatus(const QString &dest, int status, const QString &error);
+    /** @brief Display the current speed of a running job */
+    void setRenderSpeed(const QString &dest, double fps, int cpu);
     void setDocumentPath(const QString &path);
     void reloadProfiles();
+    /** @brief Parse the render profiles in a background thread so that the render dialog opens quickly. */
+    static void preloadProfiles();
     void setRenderProfile(const QMap <QString, QString>& props);
     int waitingJobsCount() const;
     QString getFreeScriptName(const QUrl &projectName = QUrl(), const QString &prefix = QString());
@@ -189,6 +198,12 @@ private slots:
     void adjustQuality(int videoQuality);
     /** @brief Show updated command parameter in tooltip. */
     void adjustSpeed(int videoQuality);
+    /** @brief Check if a job needs to be started. */
+    void checkRenderStatus();
+    /** @brief Move the selected waiting job up / down in the queue, or make it the next job to start. */
+    void slotMoveJobUp();
+    void slotMoveJobDown();
+    void slotMoveJobFirst();
 
 private:
     Ui::RenderWidget_UI m_view;
@@ -198,19 +213,42 @@ private:
     RenderViewDelegate *m_jobsDelegate;
     bool m_blockProcessing;
     QString m_renderer;
+    /** @brief Guide positions in seconds, used to split segmented renders */
+    QList <double> m_guides;
+    /** @brief Project duration in seconds */
+    double m_projectDuration;
+    /** @brief Timeline preview chunk files by start frame, with their encoding parameters */
+    QMap <int, QString> m_previewChunks;
+    QString m_previewExtension;
+    QStringList m_previewParameters;
+    QList <PassthroughZone> m_passthroughZones;
     KMessageWidget *m_infoMessage;
+    QAction *m_moveFirstAction;
+    QAction *m_moveUpAction;
+    QAction *m_moveDownAction;
+    /** @brief Profile tree groups by name */
+    QHash <QString, QTreeWidgetItem *> m_profileGroups;
+    /** @brief First profile tree item of each profile name */
+    QHash <QString, QTreeWidgetItem *> m_profileItems;
 
-    void parseMltPresets();
     void parseProfiles(const QString &selectedProfile = QString());
-    void parseFile(const QString &exportFile, bool editable);
     void updateButtons();
+    /** @brief Returns true if the system has enough free resources to run one more render job. */
+    bool canStartAdditionalJob() const;
+    /** @brief Move the selected waiting job to queue position row. */
+    void moveJob(int row);
+    /** @brief Returns the segment start frames of a segmented render of the zone, followed by the zone end,
+     *  or an empty list if the zone should be rendered in one process */
+    QList <int> renderSegments(int in, int out) const;
+    /** @brief Returns the render parameters by output file of the profiles selected in addition to the current one */
+    /** @brief Returns the passthrough zones inside the render zone whose source matches the video encoding parameters */
+    QList <PassthroughZone> matchingPassthroughZones(int in, int out, const QStringList &parameters) const;
+    QMap <QString, QStringList> additionalOutputs(const QString &dest, bool exportAudio) const;
+    /** @brief Returns the preview chunks covering frames of the zone if they can be copied into a render using these parameters */
+    QMap <int, QString> reusableChunks(int in, int out, const QString &extension, const QStringList &parameters) const;
     QUrl filenameWithExtension(QUrl url, const QString &extension);
-    /** @brief Check if a job needs to be started. */
-    void checkRenderStatus();
     void startRendering(RenderJobItem *item);
     bool saveProfile(QDomElement newprofile);
-    /** @brief Create a rendering profile from MLT preset. */
-    QTreeWidgetItem *loadFromMltPreset(const QString groupName, const QString path, const QString profileName);
 
 signals:
     void abortProcess(const QString &url);
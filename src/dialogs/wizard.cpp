@@ -22,6 +22,7 @@
 #include "utils/KoIconUtils.h"
 #include "kdenlivesettings.h"
 #include "renderer.h"
+#include "mltconnection.h"
 #ifdef USE_V4L
 #include "capture/v4lcapture.h"
 #endif
@@ -317,7 +318,7 @@ void Wizard::slotUpdateCaptureParameters()
 void Wizard::checkMltComponents()
 {
     m_brokenModule = false;
-    Mlt::Repository *repository = Mlt::Factory::init();
+    Mlt::Repository *repository = MltConnection::repository();
     if (!repository) {
         m_errors.append(i18n("<li>Cannot start MLT backend, check your installation</li>"));
         m_systemCheckIsOk = false;
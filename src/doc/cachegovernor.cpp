@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "cachegovernor.h"
+#include "cacheindex.h"
+#include "proxystore.h"
+#include "kdenlivesettings.h"
+#include "core.h"
+#include "bin/bin.h"
+
+#include <QtConcurrent>
+#include <QDebug>
+
+// Interval (in ms) between two background enforcements of the cache budgets
+#define ENFORCE_INTERVAL 600000
+// Delay (in ms) after opening a project, so that its proxies are known before enforcing
+#define OPEN_DELAY 60000
+
+/** @brief Budgets in bytes, 0 for no limit */
+struct CacheBudgets {
+    qint64 total;
+    qint64 preview;
+    qint64 audio;
+    qint64 thumbs;
+    qint64 proxies;
+    QStringList keepProjects;
+    QStringList keepProxies;
+};
+
+static void enforceBudgets(const CacheBudgets &budgets)
+{
+    // Folders that were never indexed must be counted first
+    QStringList missing;
+    foreach(const QString &project, CacheIndex::projects()) {
+        if (!CacheIndex::isIndexed(project)) missing << project;
+    }
+    if (!missing.isEmpty()) {
+        CacheIndex::rebuild(missing);
+    }
+    QStringList removed;
+    if (budgets.preview > 0) {
+        removed << CacheIndex::evictCategory(CachePreview, budgets.preview, budgets.keepProjects);
+    }
+    if (budgets.audio > 0) {
+        removed << CacheIndex::evictCategory(CacheAudio, budgets.audio, budgets.keepProjects);
+    }
+    if (budgets.thumbs > 0) {
+        removed << CacheIndex::evictCategory(CacheThumbs, budgets.thumbs, budgets.keepProjects);
+    }
+    if (budgets.proxies > 0) {
+        ProxyStore::collectGarbage(budgets.proxies, budgets.keepProxies);
+    }
+    if (budgets.total > 0) {
+        removed << CacheIndex::evict(budgets.total, budgets.keepProjects);
+    }
+    if (!removed.isEmpty()) {
+        qDebug() << "// Cache budgets removed data of projects" << removed;
+    }
+}
+
+CacheGovernor::CacheGovernor(QObject *parent) : QObject(parent)
+{
+    m_timer.setInterval(ENFORCE_INTERVAL);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(enforce()));
+    m_timer.start();
+}
+
+CacheGovernor::~CacheGovernor()
+{
+    m_watcher.waitForFinished();
+}
+
+void CacheGovernor::setCurrentProject(const QString &documentId)
+{
+    m_currentProject = documentId;
+    QTimer::singleShot(OPEN_DELAY, this, SLOT(enforce()));
+}
+
+void CacheGovernor::enforce()
+{
+    if (m_watcher.isRunning()) {
+        return;
+    }
+    CacheBudgets budgets;
+    budgets.total = (qint64) KdenliveSettings::cachebudget() * 1048576;
+    budgets.preview = (qint64) KdenliveSettings::cachebudgetpreview() * 1048576;
+    budgets.audio = (qint64) KdenliveSettings::cachebudgetaudio() * 1048576;
+    budgets.thumbs = (qint64) KdenliveSettings::cachebudgetthumbs() * 1048576;
+    budgets.proxies = (qint64) KdenliveSettings::proxystorelimit() * 1048576;
+    if (budgets.total == 0 && budgets.preview == 0 && budgets.audio == 0 && budgets.thumbs == 0 && budgets.proxies == 0) {
+        return;
+    }
+    if (!m_currentProject.isEmpty()) {
+        budgets.keepProjects << m_currentProject;
+    }
+    if (pCore->bin()) {
+        budgets.keepProxies = pCore->bin()->getProxyHashList();
+    }
+    m_watcher.setFuture(QtConcurrent::run(enforceBudgets, budgets));
+}
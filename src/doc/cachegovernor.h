@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+#ifndef CACHEGOVERNOR_H
+#define CACHEGOVERNOR_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * @class CacheGovernor
+ * @brief Keeps the cache data of all projects within the configured budgets.
+ *
+ * The budgets are read from the cachebudget setting for all project caches and from the
+ * cachebudgetpreview, cachebudgetaudio and cachebudgetthumbs settings for each cache
+ * category, the shared proxies using the proxystorelimit setting. They are enforced in
+ * a background thread shortly after a project is opened and at regular intervals, evicting the
+ * least recently and least often used projects first. The caches of the open project
+ * and the proxies it uses are never removed.
+ */
+class CacheGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CacheGovernor(QObject *parent = 0);
+    virtual ~CacheGovernor();
+
+    /** @brief Sets the project whose cache must not be removed. */
+    void setCurrentProject(const QString &documentId);
+
+public slots:
+    /** @brief Starts enforcing the budgets in a background thread, unless it is already running. */
+    void enforce();
+
+private:
+    QTimer m_timer;
+    QFutureWatcher<void> m_watcher;
+    QString m_currentProject;
+};
+
+#endif
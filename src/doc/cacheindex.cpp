@@ -0,0 +1,410 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "cacheindex.h"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+
+// Number of updates after which the index file is saved
+#define INDEX_SYNC_UPDATES 64
+// Each use of a project delays the eviction of its cache by one day, up to ten days
+#define USE_BONUS 86400000
+#define MAX_USE_BONUS 10
+
+/** @brief Cache data of a project folder */
+struct CacheEntry {
+    CacheEntry() : lastUsed(0), uses(0), known(0) {
+        for (int i = 0; i <= CacheThumbs; i++) sizes[i] = 0;
+    }
+    qint64 sizes[CacheThumbs + 1];
+    qint64 lastUsed;
+    /** @brief Number of times the project was opened */
+    int uses;
+    /** @brief Bit mask of the categories whose size is known */
+    int known;
+};
+
+static QMutex indexMutex;
+static QMap <QString, CacheEntry> cacheEntries;
+static QSet <QString> dirtyEntries;
+static bool indexLoaded = false;
+static int pendingUpdates = 0;
+
+static QString categoryKey(int type)
+{
+    switch (type) {
+        case CachePreview:
+            return QStringLiteral("preview");
+        case CacheProxy:
+            return QStringLiteral("proxy");
+        case CacheAudio:
+            return QStringLiteral("audiothumbs");
+        case CacheThumbs:
+            return QStringLiteral("videothumbs");
+        default:
+            return QStringLiteral("other");
+    }
+}
+
+static int requiredCategories(const QString &project)
+{
+    if (project == QLatin1String("proxy")) {
+        return 1 << CacheProxy;
+    }
+    return (1 << CacheBase) | (1 << CachePreview) | (1 << CacheAudio) | (1 << CacheThumbs);
+}
+
+static qint64 entrySize(const CacheEntry &entry)
+{
+    qint64 total = 0;
+    for (int i = CacheBase; i <= CacheThumbs; i++) {
+        total += entry.sizes[i];
+    }
+    return total;
+}
+
+static QString indexPath()
+{
+    return CacheIndex::folder().absoluteFilePath(QStringLiteral("cacheindex.ini"));
+}
+
+// The following functions must be called with indexMutex locked
+static void loadIndex()
+{
+    if (indexLoaded) {
+        return;
+    }
+    indexLoaded = true;
+    QSettings settings(indexPath(), QSettings::IniFormat);
+    foreach(const QString &project, settings.childGroups()) {
+        settings.beginGroup(project);
+        CacheEntry entry;
+        for (int i = CacheBase; i <= CacheThumbs; i++) {
+            const QString key = categoryKey(i);
+            if (settings.contains(key)) {
+                entry.sizes[i] = settings.value(key).toLongLong();
+                entry.known |= 1 << i;
+            }
+        }
+        entry.lastUsed = settings.value(QStringLiteral("lastused")).toLongLong();
+        entry.uses = settings.value(QStringLiteral("uses")).toInt();
+        cacheEntries.insert(project, entry);
+        settings.endGroup();
+    }
+}
+
+static void saveIndex()
+{
+    QSettings settings(indexPath(), QSettings::IniFormat);
+    foreach(const QString &project, dirtyEntries) {
+        settings.remove(project);
+        if (!cacheEntries.contains(project)) continue;
+        const CacheEntry &entry = cacheEntries[project];
+        settings.beginGroup(project);
+        for (int i = CacheBase; i <= CacheThumbs; i++) {
+            if (entry.known & (1 << i)) {
+                settings.setValue(categoryKey(i), entry.sizes[i]);
+            }
+        }
+        settings.setValue(QStringLiteral("lastused"), entry.lastUsed);
+        settings.setValue(QStringLiteral("uses"), entry.uses);
+        settings.endGroup();
+    }
+    dirtyEntries.clear();
+    pendingUpdates = 0;
+}
+
+static void changed(const QString &project)
+{
+    dirtyEntries.insert(project);
+    if (++pendingUpdates >= INDEX_SYNC_UPDATES) {
+        saveIndex();
+    }
+}
+
+/** @brief Finds the project and cache category of a file in the cache folder. */
+static bool locate(const QString &path, QString &project, CacheType &type)
+{
+    const QString root = CacheIndex::folder().absolutePath() + QLatin1Char('/');
+    const QString file = QFileInfo(path).absoluteFilePath();
+    if (!file.startsWith(root)) {
+        return false;
+    }
+    const QStringList parts = file.mid(root.length()).split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if (parts.count() < 2) {
+        // Not in a project folder
+        return false;
+    }
+    project = parts.at(0);
+    type = CacheBase;
+    if (project == QLatin1String("proxy")) {
+        type = CacheProxy;
+    } else if (parts.count() > 2) {
+        for (int i = CachePreview; i <= CacheThumbs; i++) {
+            if (i != CacheProxy && parts.at(1) == categoryKey(i)) {
+                type = (CacheType) i;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static void record(const QString &project, CacheType type, qint64 delta)
+{
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    CacheEntry &entry = cacheEntries[project];
+    entry.sizes[type] = qMax((qint64) 0, entry.sizes[type] + delta);
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    changed(project);
+}
+
+//static
+QDir CacheIndex::folder()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+}
+
+//static
+void CacheIndex::fileWritten(const QString &path, qint64 previousSize)
+{
+    QString project;
+    CacheType type;
+    if (locate(path, project, type)) {
+        record(project, type, QFileInfo(path).size() - previousSize);
+    }
+}
+
+//static
+bool CacheIndex::removeFile(const QString &path)
+{
+    qint64 size = QFileInfo(path).size();
+    if (!QFile::remove(path)) {
+        return false;
+    }
+    QString project;
+    CacheType type;
+    if (locate(path, project, type)) {
+        record(project, type, -size);
+    }
+    return true;
+}
+
+//static
+void CacheIndex::folderRemoved(const QString &path)
+{
+    QString project;
+    CacheType type;
+    // Locate a file inside the folder to find its category
+    if (!locate(path + QStringLiteral("/file"), project, type)) {
+        return;
+    }
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    if (type == CacheBase) {
+        // The whole project folder
+        cacheEntries.remove(project);
+    } else {
+        CacheEntry &entry = cacheEntries[project];
+        entry.sizes[type] = 0;
+        entry.known |= 1 << type;
+    }
+    changed(project);
+}
+
+//static
+void CacheIndex::markUsed(const QString &project)
+{
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    CacheEntry &entry = cacheEntries[project];
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    entry.uses++;
+    changed(project);
+}
+
+//static
+bool CacheIndex::isIndexed(const QString &project)
+{
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    if (!cacheEntries.contains(project)) {
+        return false;
+    }
+    int required = requiredCategories(project);
+    return (cacheEntries.value(project).known & required) == required;
+}
+
+//static
+qint64 CacheIndex::size(const QString &project, CacheType type)
+{
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    return cacheEntries.value(project).sizes[type];
+}
+
+//static
+qint64 CacheIndex::projectSize(const QString &project)
+{
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    return entrySize(cacheEntries.value(project));
+}
+
+//static
+QDateTime CacheIndex::lastUsed(const QString &project)
+{
+    qint64 used;
+    {
+        QMutexLocker lock(&indexMutex);
+        loadIndex();
+        used = cacheEntries.value(project).lastUsed;
+    }
+    if (used > 0) {
+        return QDateTime::fromMSecsSinceEpoch(used);
+    }
+    return QFileInfo(folder().absoluteFilePath(project)).lastModified();
+}
+
+//static
+QStringList CacheIndex::projects()
+{
+    const QStringList folders = folder().entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    QMutexLocker lock(&indexMutex);
+    loadIndex();
+    foreach(const QString &project, cacheEntries.keys()) {
+        if (!folders.contains(project)) {
+            cacheEntries.remove(project);
+            changed(project);
+        }
+    }
+    return folders;
+}
+
+//static
+void CacheIndex::rebuild(const QStringList &projects)
+{
+    foreach(const QString &project, projects) {
+        const QString path = folder().absoluteFilePath(project);
+        CacheEntry entry;
+        QDirIterator it(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString file = it.next();
+            QString fileProject;
+            CacheType type;
+            if (locate(file, fileProject, type)) {
+                entry.sizes[type] += it.fileInfo().size();
+            }
+        }
+        entry.known = requiredCategories(project);
+        QMutexLocker lock(&indexMutex);
+        loadIndex();
+        entry.lastUsed = cacheEntries.value(project).lastUsed;
+        entry.uses = cacheEntries.value(project).uses;
+        if (entry.lastUsed == 0) {
+            entry.lastUsed = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+        }
+        cacheEntries.insert(project, entry);
+        changed(project);
+    }
+    sync();
+}
+
+//static
+QStringList CacheIndex::evictionOrder()
+{
+    const QStringList folders = projects();
+    QMultiMap <qint64, QString> byScore;
+    QMutexLocker lock(&indexMutex);
+    foreach(const QString &project, folders) {
+        // Only project folders are evicted, the shared proxies have their own limit
+        bool ok;
+        project.toLongLong(&ok);
+        if (!ok || !cacheEntries.contains(project)) continue;
+        const CacheEntry &entry = cacheEntries[project];
+        int required = requiredCategories(project);
+        if ((entry.known & required) != required) continue;
+        byScore.insert(entry.lastUsed + (qint64) qMin(entry.uses, MAX_USE_BONUS) * USE_BONUS, project);
+    }
+    return byScore.values();
+}
+
+//static
+QStringList CacheIndex::evict(qint64 budget, const QStringList &keep)
+{
+    const QStringList order = evictionOrder();
+    qint64 total = 0;
+    foreach(const QString &project, order) {
+        total += projectSize(project);
+    }
+    QStringList removed;
+    foreach(const QString &project, order) {
+        if (total <= budget) break;
+        if (keep.contains(project)) continue;
+        qint64 size = projectSize(project);
+        QDir dir(folder().absoluteFilePath(project));
+        if (!dir.removeRecursively()) continue;
+        total -= size;
+        removed << project;
+        folderRemoved(dir.absolutePath());
+    }
+    sync();
+    return removed;
+}
+
+//static
+QStringList CacheIndex::evictCategory(CacheType type, qint64 budget, const QStringList &keep)
+{
+    const QStringList order = evictionOrder();
+    qint64 total = 0;
+    foreach(const QString &project, order) {
+        total += size(project, type);
+    }
+    QStringList emptied;
+    foreach(const QString &project, order) {
+        if (total <= budget) break;
+        qint64 used = size(project, type);
+        if (used == 0 || keep.contains(project)) continue;
+        QDir dir(folder().absoluteFilePath(project) + QLatin1Char('/') + categoryKey(type));
+        if (dir.dirName() != categoryKey(type) || !dir.removeRecursively()) continue;
+        dir.mkpath(QStringLiteral("."));
+        total -= used;
+        emptied << project;
+        folderRemoved(dir.absolutePath());
+    }
+    sync();
+    return emptied;
+}
+
+//static
+void CacheIndex::sync()
+{
+    QMutexLocker lock(&indexMutex);
+    if (indexLoaded && !dirtyEntries.isEmpty()) {
+        saveIndex();
+    }
+}
@@ -0,0 +1,79 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+#ifndef CACHEINDEX_H
+#define CACHEINDEX_H
+
+#include "definitions.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QStringList>
+
+/**
+ * @class CacheIndex
+ * @brief Size and last use of the cache data of all projects.
+ *
+ * The cache writers (timeline preview, proxy jobs, audio and video thumbnails) report
+ * each file they write or delete, so that the cache management dialog does not have
+ * to scan the cache folders. Project folders that were never indexed are scanned once
+ * with rebuild(). The index is kept in memory and saved to the cacheindex.ini file of
+ * the cache folder every few updates and when a project is closed. Projects are evicted
+ * by last use, each time a project was opened delaying its eviction by a day.
+ */
+class CacheIndex
+{
+public:
+    /** @brief Returns the cache folder holding the project folders. */
+    static QDir folder();
+    /** @brief Records a file written in the cache folder.
+     *  @param previousSize Size of the file before it was overwritten */
+    static void fileWritten(const QString &path, qint64 previousSize = 0);
+    /** @brief Removes a file from the cache folder and records its size. */
+    static bool removeFile(const QString &path);
+    /** @brief Records that a project or a project cache category folder was emptied or removed. */
+    static void folderRemoved(const QString &path);
+    /** @brief Records that a project cache was just used. */
+    static void markUsed(const QString &project);
+    /** @brief Returns true if the size of all cache categories of project is known. */
+    static bool isIndexed(const QString &project);
+    /** @brief Returns the size in bytes of a cache category of project. */
+    static qint64 size(const QString &project, CacheType type);
+    /** @brief Returns the total size in bytes of a project cache folder. */
+    static qint64 projectSize(const QString &project);
+    /** @brief Returns when a project cache was last used. */
+    static QDateTime lastUsed(const QString &project);
+    /** @brief Returns the folders of the cache, forgetting the indexed projects whose folder was removed. */
+    static QStringList projects();
+    /** @brief Scans the folders of projects to index their cache data. */
+    static void rebuild(const QStringList &projects);
+    /** @brief Returns the indexed project folders, the least recently and least often used first. */
+    static QStringList evictionOrder();
+    /** @brief Removes project folders in eviction order until all projects use less than budget bytes.
+     *  @param keep Projects whose folder must not be removed
+     *  @return the removed projects */
+    static QStringList evict(qint64 budget, const QStringList &keep = QStringList());
+    /** @brief Empties a cache category of projects in eviction order until it uses less than budget bytes in all projects.
+     *  @param keep Projects whose data must not be removed
+     *  @return the projects whose category was emptied */
+    static QStringList evictCategory(CacheType type, qint64 budget, const QStringList &keep = QStringList());
+    /** @brief Saves the changes to the index file. */
+    static void sync();
+};
+
+#endif
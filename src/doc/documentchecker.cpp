@@ -20,6 +20,9 @@
 
 #include "documentchecker.h"
 #include "kthumb.h"
+#include "proxystore.h"
+#include "mediaindex.h"
+#include "core.h"
 
 #include "titler/titlewidget.h"
 #include "kdenlivesettings.h"
@@ -35,8 +38,12 @@
 #include <QTreeWidgetItem>
 #include <QFile>
 #include <QFileDialog>
-#include <QCryptographicHash>
 #include <QStandardPaths>
+#include <QDirIterator>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QtConcurrent>
 
 const int hashRole = Qt::UserRole;
 const int sizeRole = Qt::UserRole + 1;
@@ -58,6 +65,93 @@ const int LUMAPLACEHOLDER = 12;
 
 enum TITLECLIPTYPE { TITLE_IMAGE_ELEMENT = 20, TITLE_FONT_ELEMENT = 21 };
 
+// Number of scanned files between two progress updates when searching missing clips
+#define RELOCATE_EVENTS_INTERVAL 200
+
+/** @brief Files of a search folder, indexed in a single walk for all missing items */
+struct RelocationIndex {
+    /** @brief Files having the size of a missing clip */
+    QHash <qint64, QStringList> bySize;
+    /** @brief First file found for each searched file name (lower case) */
+    QHash <QString, QString> byName;
+    /** @brief First folder containing a file starting with a slideshow prefix (lower case) */
+    QHash <QString, QString> byPrefix;
+};
+
+/** @brief Walk root once, keeping only the files matching a searched size, name or slideshow prefix.
+ *  Returns false if the user canceled. */
+static bool indexSearchFolder(const QString &root, const QSet <qint64> &sizes, const QSet <QString> &names, const QStringList &prefixes, RelocationIndex &index, QProgressDialog &progress)
+{
+    QDirIterator it(root, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    int count = 0;
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (sizes.contains(info.size())) {
+            index.bySize[info.size()] << info.absoluteFilePath();
+        }
+        const QString name = info.fileName().toLower();
+        if (names.contains(name) && !index.byName.contains(name)) {
+            index.byName.insert(name, info.absoluteFilePath());
+        }
+        foreach(const QString &prefix, prefixes) {
+            if (!index.byPrefix.contains(prefix) && name.startsWith(prefix)) {
+                index.byPrefix.insert(prefix, info.absolutePath());
+            }
+        }
+        if (++count % RELOCATE_EVENTS_INTERVAL == 0) {
+            progress.setLabelText(i18np("Searching missing clips (%1 file scanned)...", "Searching missing clips (%1 files scanned)...", count));
+            qApp->processEvents();
+            if (progress.wasCanceled()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** @brief Hash the size matching candidates on the thread pool, only reading the first and last MB of each.
+ *  Fills matches with "size:hash" -> path. Returns false if the user canceled. */
+static bool hashCandidates(const QHash <qint64, QStringList> &bySize, QHash <QString, QString> &matches, QProgressDialog &progress)
+{
+    QStringList paths;
+    QStringList sizes;
+    QHashIterator <qint64, QStringList> i(bySize);
+    while (i.hasNext()) {
+        i.next();
+        foreach(const QString &path, i.value()) {
+            paths << path;
+            sizes << QString::number(i.key());
+        }
+    }
+    if (paths.isEmpty()) {
+        return true;
+    }
+    progress.setRange(0, paths.count());
+    QFuture<QString> future = QtConcurrent::mapped(paths, ProxyStore::fileHash);
+    QFutureWatcher<QString> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, SIGNAL(progressValueChanged(int)), &progress, SLOT(setValue(int)));
+    QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    QObject::connect(&progress, SIGNAL(canceled()), &watcher, SLOT(cancel()));
+    watcher.setFuture(future);
+    if (!future.isFinished()) {
+        loop.exec();
+    }
+    if (future.isCanceled()) {
+        return false;
+    }
+    const QStringList hashes = future.results();
+    for (int j = 0; j < hashes.count(); ++j) {
+        if (hashes.at(j).isEmpty()) continue;
+        const QString key = sizes.at(j) + QLatin1Char(':') + hashes.at(j);
+        if (!matches.contains(key)) {
+            matches.insert(key, paths.at(j));
+        }
+    }
+    return true;
+}
+
 DocumentChecker::DocumentChecker(QUrl url, const QDomDocument &doc):
     m_url(url), m_doc(doc), m_dialog(NULL)
 {
@@ -99,8 +193,23 @@ bool DocumentChecker::hasErrorInClips()
         if (service == QLatin1String("kdenlivetitle")) {
             //TODO: Check is clip template is missing (xmltemplate) or hash changed
 	    QString xml = EffectsList::property(e, QStringLiteral("xmldata"));
-            QStringList images = TitleWidget::extractImageList(xml);
-            QStringList fonts = TitleWidget::extractFontList(xml);
+            QStringList images;
+            QStringList fonts;
+            if (xml.isEmpty()) {
+                // Template clip, its title file is only parsed once for all the clips using it
+                QString templatePath = EffectsList::property(e, QStringLiteral("resource"));
+                if (!templatePath.isEmpty() && !templatePath.startsWith(QLatin1String("/"))) {
+                    templatePath.prepend(root);
+                }
+                QSharedPointer<const TitleDocument::TemplateInfo> templateInfo = TitleDocument::templateInfo(templatePath);
+                if (templateInfo) {
+                    images = templateInfo->images;
+                    fonts = templateInfo->fonts;
+                }
+            } else {
+                images = TitleWidget::extractImageList(xml);
+                fonts = TitleWidget::extractFontList(xml);
+            }
             checkMissingImagesAndFonts(images, fonts, e.attribute(QStringLiteral("id")), e.attribute(QStringLiteral("name")));
             continue;
         }
@@ -402,6 +511,7 @@ bool DocumentChecker::hasErrorInClips()
         // original doc was modified
         m_doc.documentElement().setAttribute(QStringLiteral("modified"), QStringLiteral("1"));
     }
+    relinkFromIndex();
     m_ui.treeWidget->resizeColumnToContents(0);
     connect(m_ui.recursiveSearch, SIGNAL(pressed()), this, SLOT(slotSearchClips()));
     connect(m_ui.usePlaceholders, SIGNAL(pressed()), this, SLOT(slotPlaceholders()));
@@ -451,17 +561,79 @@ void DocumentChecker::slotSearchClips()
     QString clipFolder = m_url.adjusted(QUrl::RemoveFilename).path();
     QString newpath = QFileDialog::getExistingDirectory(qApp->activeWindow(), i18n("Clips folder"), clipFolder);
     if (newpath.isEmpty()) return;
-    int ix = 0;
     bool fixed = false;
     m_ui.recursiveSearch->setChecked(true);
     qApp->processEvents();
-    QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
-    QDir searchDir(newpath);
-    while (child) {
+
+    // Collect what all missing items look for, so that the folder is walked only once
+    QSet <qint64> sizes;
+    QSet <QString> names;
+    QStringList prefixes;
+    auto wantFile = [&sizes, &names](QTreeWidgetItem *item) {
+        const QString size = item->data(0, sizeRole).toString();
+        const QString hash = item->data(0, hashRole).toString();
+        if (size.isEmpty() && hash.isEmpty()) {
+            names << QUrl::fromLocalFile(item->text(1)).fileName().toLower();
+        } else if (!size.isEmpty() && !hash.isEmpty()) {
+            sizes << size.toLongLong();
+        }
+    };
+    for (int ix = 0; ix < m_ui.treeWidget->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
+        int status = child->data(0, statusRole).toInt();
+        if (status == SOURCEMISSING) {
+            for (int j = 0; j < child->childCount(); ++j) {
+                wantFile(child->child(j));
+            }
+        } else if (status == CLIPMISSING) {
+            const QString fileName = QUrl::fromLocalFile(child->text(1)).fileName();
+            if ((ClipType) child->data(0, clipTypeRole).toInt() == SlideShow) {
+                // Slideshows cannot be found with hash / size
+                if (fileName.contains(QLatin1Char('%'))) {
+                    prefixes << fileName.section(QLatin1Char('%'), 0, -2).toLower();
+                }
+            } else {
+                wantFile(child);
+                names << fileName.toLower();
+            }
+        } else if (status == LUMAMISSING) {
+            names << QUrl::fromLocalFile(child->data(0, idRole).toString()).fileName().toLower();
+        } else if (child->data(0, typeRole).toInt() == TITLE_IMAGE_ELEMENT && status == CLIPPLACEHOLDER) {
+            names << QUrl::fromLocalFile(child->text(1)).fileName().toLower();
+        }
+    }
+
+    QProgressDialog progress(i18n("Searching missing clips..."), i18n("Cancel"), 0, 0, m_dialog);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    RelocationIndex index;
+    QHash <QString, QString> matches;
+    bool completed = indexSearchFolder(newpath, sizes, names, prefixes, index, progress);
+    if (completed) {
+        progress.setLabelText(i18n("Comparing clips..."));
+        completed = hashCandidates(index.bySize, matches, progress);
+    }
+    if (!completed) {
+        m_ui.recursiveSearch->setChecked(false);
+        m_ui.recursiveSearch->setEnabled(true);
+        return;
+    }
+    progress.reset();
+
+    auto findFile = [&index, &matches](QTreeWidgetItem *item) {
+        const QString size = item->data(0, sizeRole).toString();
+        const QString hash = item->data(0, hashRole).toString();
+        if (size.isEmpty() && hash.isEmpty()) {
+            return index.byName.value(QUrl::fromLocalFile(item->text(1)).fileName().toLower());
+        }
+        return matches.value(size + QLatin1Char(':') + hash);
+    };
+    for (int ix = 0; ix < m_ui.treeWidget->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
         if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
             for (int j = 0; j < child->childCount(); ++j) {
                 QTreeWidgetItem *subchild = child->child(j);
-                QString clipPath = searchFileRecursively(searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
+                QString clipPath = findFile(subchild);
                 if (!clipPath.isEmpty()) {
                     fixed = true;
                     subchild->setText(1, clipPath);
@@ -473,13 +645,19 @@ void DocumentChecker::slotSearchClips()
         else if (child->data(0, statusRole).toInt() == CLIPMISSING) {
             bool perfectMatch = true;
             ClipType type = (ClipType) child->data(0, clipTypeRole).toInt();
+            const QString fileName = QUrl::fromLocalFile(child->text(1)).fileName();
             QString clipPath;
             if (type != SlideShow) {
-                // Slideshows cannot be found with hash / size
-                clipPath = searchFileRecursively(searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
-            }
-            if (clipPath.isEmpty()) {
-                clipPath = searchPathRecursively(searchDir, QUrl::fromLocalFile(child->text(1)).fileName(), type);
+                clipPath = findFile(child);
+                if (clipPath.isEmpty()) {
+                    clipPath = index.byName.value(fileName.toLower());
+                    perfectMatch = false;
+                }
+            } else if (fileName.contains(QLatin1Char('%'))) {
+                QString folder = index.byPrefix.value(fileName.section(QLatin1Char('%'), 0, -2).toLower());
+                if (!folder.isEmpty()) {
+                    clipPath = QDir(folder).absoluteFilePath(fileName);
+                }
                 perfectMatch = false;
             }
             if (!clipPath.isEmpty()) {
@@ -489,7 +667,10 @@ void DocumentChecker::slotSearchClips()
                 child->setData(0, statusRole, CLIPOK);
             }
         } else if (child->data(0, statusRole).toInt() == LUMAMISSING) {
-            QString fileName = searchLuma(searchDir, child->data(0, idRole).toString());
+            QString fileName = searchLuma(child->data(0, idRole).toString());
+            if (fileName.isEmpty()) {
+                fileName = index.byName.value(QUrl::fromLocalFile(child->data(0, idRole).toString()).fileName().toLower());
+            }
             if (!fileName.isEmpty()) {
                 fixed = true;
                 child->setText(1, fileName);
@@ -500,7 +681,7 @@ void DocumentChecker::slotSearchClips()
         else if (child->data(0, typeRole).toInt() == TITLE_IMAGE_ELEMENT && child->data(0, statusRole).toInt() == CLIPPLACEHOLDER) {
             // Search missing title images
             QString missingFileName = QUrl::fromLocalFile(child->text(1)).fileName();
-            QString newPath = searchPathRecursively(searchDir, missingFileName);
+            QString newPath = index.byName.value(missingFileName.toLower());
             if (!newPath.isEmpty()) {
                 // File found
                 fixed = true;
@@ -509,8 +690,6 @@ void DocumentChecker::slotSearchClips()
                 child->setData(0, statusRole, CLIPOK);
             }
         }
-        ix++;
-        child = m_ui.treeWidget->topLevelItem(ix);
     }
     m_ui.recursiveSearch->setChecked(false);
     m_ui.recursiveSearch->setEnabled(true);
@@ -521,8 +700,39 @@ void DocumentChecker::slotSearchClips()
     checkStatus();
 }
 
+void DocumentChecker::relinkFromIndex()
+{
+    MediaIndex *index = pCore ? pCore->mediaIndex() : NULL;
+    if (!index) {
+        return;
+    }
+    bool fixed = false;
+    auto relink = [index, &fixed](QTreeWidgetItem *item) {
+        QString clipPath = index->locate(item->data(0, sizeRole).toString(), item->data(0, hashRole).toString());
+        if (!clipPath.isEmpty()) {
+            fixed = true;
+            item->setText(1, clipPath);
+            item->setIcon(0, KoIconUtils::themedIcon("dialog-ok"));
+            item->setData(0, statusRole, CLIPOK);
+        }
+    };
+    for (int ix = 0; ix < m_ui.treeWidget->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
+        if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
+            for (int j = 0; j < child->childCount(); ++j) {
+                relink(child->child(j));
+            }
+        } else if (child->data(0, statusRole).toInt() == CLIPMISSING && child->data(0, typeRole).toInt() != TITLE_IMAGE_ELEMENT && (ClipType) child->data(0, clipTypeRole).toInt() != SlideShow) {
+            relink(child);
+        }
+    }
+    if (fixed) {
+        // original doc was modified
+        m_doc.documentElement().setAttribute(QStringLiteral("modified"), QStringLiteral("1"));
+    }
+}
 
-QString DocumentChecker::searchLuma(const QDir &dir, const QString &file) const
+QString DocumentChecker::searchLuma(const QString &file) const
 {
     QDir searchPath(KdenliveSettings::mltpath());
     QString fname = QUrl::fromLocalFile(file).fileName();
@@ -540,81 +750,7 @@ QString DocumentChecker::searchLuma(const QDir &dir, const QString &file) const
     if (result.exists())
         return result.filePath();
     // Try in Kdenlive's standard KDE path
-    QString res = QStandardPaths::locate(QStandardPaths::DataLocation, "lumas/" + fname);
-    if (!res.isEmpty()) return res;
-    // Try in user's chosen folder 
-    return searchPathRecursively(dir, fname);
-}
-
-QString DocumentChecker::searchPathRecursively(const QDir &dir, const QString &fileName, ClipType type) const
-{
-    QString foundFileName;
-    QStringList filters;
-    if (type == SlideShow) {
-        if (fileName.contains(QLatin1Char('%'))) {
-            filters << fileName.section(QLatin1Char('%'), 0 ,-2) + QStringLiteral("*");
-        }
-        else return QString(); 
-    } else {
-        filters << fileName;
-    }
-    QDir searchDir(dir);
-    searchDir.setNameFilters(filters);
-    QStringList filesAndDirs = searchDir.entryList(QDir::Files | QDir::Readable);
-    if (!filesAndDirs.isEmpty()) {
-        // File Found
-        if (type == SlideShow) {
-            return searchDir.absoluteFilePath(fileName);
-        }
-        return searchDir.absoluteFilePath(filesAndDirs.at(0));;
-    }
-    searchDir.setNameFilters(QStringList());
-    filesAndDirs = searchDir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchPathRecursively(searchDir.absoluteFilePath(filesAndDirs.at(i)), fileName, type);
-        if (!foundFileName.isEmpty())
-            break;
-    }
-    return foundFileName;
-}
-
-QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const
-{
-    if (matchSize.isEmpty() && matchHash.isEmpty()) return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                * 1 MB = 1 second per 450 files (or faster)
-                * 10 MB = 9 seconds per 450 files (or faster)
-                */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000))
-                        fileData.append(file.readAll());
-                } else
-                    fileData = file.readAll();
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-            }
-        }
-        ////qDebug() << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash, fileName);
-        if (!foundFileName.isEmpty())
-            break;
-    }
-    return foundFileName;
+    return QStandardPaths::locate(QStandardPaths::DataLocation, "lumas/" + fname);
 }
 
 void DocumentChecker::slotEditItem(QTreeWidgetItem *item, int)
@@ -54,7 +54,8 @@ private slots:
     void slotDeleteSelected();
     QString getProperty(QDomElement effect, const QString &name);
     void setProperty(QDomElement effect, const QString &name, const QString &value);
-    QString searchLuma(const QDir &dir, const QString &file) const;
+    /** @brief Returns the path of an installed luma with the name of file, empty if there is none. */
+    QString searchLuma(const QString &file) const;
     /** @brief Check if images and fonts in this clip exists, returns a list of images that do exist so we don't check twice. */
     void checkMissingImagesAndFonts(const QStringList &images, const QStringList &fonts, const QString &id, const QString &baseClip);
     void slotCheckButtons();
@@ -64,9 +65,9 @@ private:
     QDomDocument m_doc;
     Ui::MissingClips_UI m_ui;
     QDialog *m_dialog;
-    QString searchPathRecursively(const QDir &dir, const QString &fileName, ClipType type = Unknown) const;
-    QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const;
     void checkStatus();
+    /** @brief Relinks the missing clips found in the media index, without searching. */
+    void relinkFromIndex();
     QMap <QString, QString> m_missingTitleImages;
     QMap <QString, QString> m_missingTitleFonts;
     QList <QDomElement> m_missingClips;
@@ -35,6 +35,8 @@
 #include <QString>
 #include <QDir>
 #include <QScriptEngine>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include <mlt++/Mlt.h>
 
@@ -1510,21 +1512,9 @@ bool DocumentValidator::upgrade(double version, const double currentVersion)
         int max = producers.count();
         QStringList slowmoIds;
         for (int i = 0; i < max; ++i) {
-            QDomElement prod = producers.at(i).toElement();
-            QString id = prod.attribute(QStringLiteral("id"));
-            if (id.startsWith(QLatin1String("slowmotion"))) {
-                QString service = EffectsList::property(prod, QStringLiteral("mlt_service"));
-                if (service == QLatin1String("framebuffer")) {
-                    // convert to new timewarp producer
-                    prod.setAttribute(QStringLiteral("id"), id + ":1");
-                    slowmoIds << id;
-                    EffectsList::setProperty(prod, QStringLiteral("mlt_service"), QStringLiteral("timewarp"));
-                    QString resource = EffectsList::property(prod, QStringLiteral("resource"));
-                    EffectsList::setProperty(prod, QStringLiteral("warp_resource"), resource.section(QStringLiteral("?"), 0, 0));
-                    EffectsList::setProperty(prod, QStringLiteral("warp_speed"), resource.section(QStringLiteral("?"), 1).section(QStringLiteral(":"), 0, 0));
-                    EffectsList::setProperty(prod, QStringLiteral("resource"), resource.section(QStringLiteral("?"), 1) + ":" + resource.section(QStringLiteral("?"), 0, 0));
-                    EffectsList::setProperty(prod, QStringLiteral("audio_index"), "-1");
-                }
+            QString id = upgradeSlowmotionProducer(producers.at(i).toElement());
+            if (!id.isEmpty()) {
+                slowmoIds << id;
             }
         }
         if (!slowmoIds.isEmpty()) {
@@ -1547,9 +1537,7 @@ bool DocumentValidator::upgrade(double version, const double currentVersion)
         for (int i = 0; i < max; ++i) {
             QDomElement prod = producers.at(i).toElement();
             if (prod.isNull()) continue;
-            QString id = prod.attribute(QStringLiteral("id")).section(QStringLiteral("_"), 0, 0);
-            if (id == QLatin1String("black")) {
-                EffectsList::setProperty(prod, "set.test_audio", "0");
+            if (upgradeBlackProducer(prod)) {
                 break;
             }
         }
@@ -1559,6 +1547,198 @@ bool DocumentValidator::upgrade(double version, const double currentVersion)
     return true;
 }
 
+// static
+QString DocumentValidator::upgradeSlowmotionProducer(QDomElement prod)
+{
+    QString id = prod.attribute(QStringLiteral("id"));
+    if (!id.startsWith(QLatin1String("slowmotion"))) {
+        return QString();
+    }
+    QString service = EffectsList::property(prod, QStringLiteral("mlt_service"));
+    if (service != QLatin1String("framebuffer")) {
+        return QString();
+    }
+    // convert to new timewarp producer
+    prod.setAttribute(QStringLiteral("id"), id + ":1");
+    EffectsList::setProperty(prod, QStringLiteral("mlt_service"), QStringLiteral("timewarp"));
+    QString resource = EffectsList::property(prod, QStringLiteral("resource"));
+    EffectsList::setProperty(prod, QStringLiteral("warp_resource"), resource.section(QStringLiteral("?"), 0, 0));
+    EffectsList::setProperty(prod, QStringLiteral("warp_speed"), resource.section(QStringLiteral("?"), 1).section(QStringLiteral(":"), 0, 0));
+    EffectsList::setProperty(prod, QStringLiteral("resource"), resource.section(QStringLiteral("?"), 1) + ":" + resource.section(QStringLiteral("?"), 0, 0));
+    EffectsList::setProperty(prod, QStringLiteral("audio_index"), "-1");
+    return id;
+}
+
+// static
+bool DocumentValidator::upgradeBlackProducer(QDomElement prod)
+{
+    QString id = prod.attribute(QStringLiteral("id")).section(QStringLiteral("_"), 0, 0);
+    if (id != QLatin1String("black")) {
+        return false;
+    }
+    EffectsList::setProperty(prod, "set.test_audio", "0");
+    return true;
+}
+
+/** @brief Reads the element at the reader position (and its children) into doc. */
+static QDomElement readDomElement(QXmlStreamReader &reader, QDomDocument &doc)
+{
+    QDomElement element = doc.createElement(reader.name().toString());
+    foreach(const QXmlStreamAttribute &attribute, reader.attributes()) {
+        element.setAttribute(attribute.qualifiedName().toString(), attribute.value().toString());
+    }
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isEndElement()) {
+            break;
+        } else if (reader.isStartElement()) {
+            element.appendChild(readDomElement(reader, doc));
+        } else if (reader.isCDATA()) {
+            element.appendChild(doc.createCDATASection(reader.text().toString()));
+        } else if (reader.isCharacters()) {
+            element.appendChild(doc.createTextNode(reader.text().toString()));
+        } else if (reader.isComment()) {
+            element.appendChild(doc.createComment(reader.text().toString()));
+        }
+    }
+    return element;
+}
+
+static void writeDomElement(QXmlStreamWriter &writer, const QDomElement &element)
+{
+    writer.writeStartElement(element.tagName());
+    QDomNamedNodeMap attributes = element.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        QDomAttr attribute = attributes.item(i).toAttr();
+        writer.writeAttribute(attribute.name(), attribute.value());
+    }
+    for (QDomNode node = element.firstChild(); !node.isNull(); node = node.nextSibling()) {
+        if (node.isElement()) {
+            writeDomElement(writer, node.toElement());
+        } else if (node.isCDATASection()) {
+            writer.writeCDATA(node.nodeValue());
+        } else if (node.isText()) {
+            writer.writeCharacters(node.nodeValue());
+        } else if (node.isComment()) {
+            writer.writeComment(node.nodeValue());
+        }
+    }
+    writer.writeEndElement();
+}
+
+// static
+double DocumentValidator::streamDocumentVersion(const QByteArray &source)
+{
+    // Same lookup as validate(): the version property of the first playlist
+    QXmlStreamReader reader(source);
+    int depth = 0;
+    bool inPlaylist = false;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            depth++;
+            if (depth == 2 && reader.name() == QLatin1String("kdenlivedoc")) {
+                // Documents older than 0.91
+                return -1;
+            }
+            if (depth == 2 && reader.name() == QLatin1String("playlist")) {
+                inPlaylist = true;
+            } else if (inPlaylist && depth == 3 && reader.name() == QLatin1String("property") && reader.attributes().value(QStringLiteral("name")) == QLatin1String("kdenlive:docproperties.version")) {
+                return reader.readElementText().toDouble();
+            }
+        } else if (reader.isEndElement()) {
+            if (inPlaylist && depth == 2) {
+                return -1;
+            }
+            depth--;
+        }
+    }
+    return -1;
+}
+
+// static
+bool DocumentValidator::streamUpgrade(const QByteArray &source, QByteArray *result, const double currentVersion)
+{
+    double version = streamDocumentVersion(source);
+    // Older documents are restructured as a whole or need the document locale (0.93 keyframe conversion), use the DOM upgrade
+    if (version < 0.93 || version >= currentVersion) {
+        return false;
+    }
+    qDebug() << "Streaming upgrade of a document with version " << version << " / "<<currentVersion;
+    QXmlStreamReader reader(source);
+    QByteArray upgraded;
+    QXmlStreamWriter writer(&upgraded);
+    QStringList slowmoIds;
+    bool blackProducerFound = version >= 0.95;
+    int depth = 0;
+    bool inPlaylist = false;
+    bool playlistDone = false;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            const QStringRef name = reader.name();
+            if (depth == 0 && name == QLatin1String("mlt")) {
+                // Same markers as the DOM upgrade, the document is flagged as modified
+                QXmlStreamAttributes attributes = reader.attributes();
+                writer.writeStartElement(name.toString());
+                foreach(const QXmlStreamAttribute &attribute, attributes) {
+                    if (attribute.name() != QLatin1String("upgraded") && attribute.name() != QLatin1String("modified")) {
+                        writer.writeAttribute(attribute);
+                    }
+                }
+                writer.writeAttribute(QStringLiteral("upgraded"), QStringLiteral("1"));
+                writer.writeAttribute(QStringLiteral("modified"), QStringLiteral("1"));
+                depth++;
+                continue;
+            }
+            if (name == QLatin1String("producer") || (name == QLatin1String("entry") && !slowmoIds.isEmpty())) {
+                // Elements that need an upgrade step are converted on their own small DOM tree
+                QDomDocument fragment;
+                QDomElement element = readDomElement(reader, fragment);
+                if (element.tagName() == QLatin1String("producer")) {
+                    if (version < 0.94) {
+                        QString id = upgradeSlowmotionProducer(element);
+                        if (!id.isEmpty()) {
+                            slowmoIds << id;
+                        }
+                    }
+                    if (!blackProducerFound) {
+                        blackProducerFound = upgradeBlackProducer(element);
+                    }
+                } else if (slowmoIds.contains(element.attribute(QStringLiteral("producer")))) {
+                    element.setAttribute(QStringLiteral("producer"), element.attribute(QStringLiteral("producer")) + ":1");
+                }
+                writeDomElement(writer, element);
+                continue;
+            }
+            if (depth == 1 && name == QLatin1String("playlist") && !playlistDone) {
+                inPlaylist = true;
+            } else if (inPlaylist && depth == 2 && name == QLatin1String("property") && reader.attributes().value(QStringLiteral("name")) == QLatin1String("kdenlive:docproperties.version")) {
+                // The document is now at the current version, the DOM upgrade can be skipped
+                writer.writeCurrentToken(reader);
+                reader.readElementText();
+                writer.writeCharacters(QString::number(currentVersion));
+                writer.writeEndElement();
+                continue;
+            }
+            depth++;
+        } else if (reader.isEndElement()) {
+            depth--;
+            if (inPlaylist && depth == 1) {
+                inPlaylist = false;
+                playlistDone = true;
+            }
+        }
+        writer.writeCurrentToken(reader);
+    }
+    if (reader.hasError()) {
+        qDebug() << "Streaming upgrade failed: " << reader.errorString();
+        return false;
+    }
+    *result = upgraded;
+    return true;
+}
+
 void DocumentValidator::convertKeyframeEffect(QDomElement effect, QStringList params, QMap <int, double> &values, int offset)
 {
     QLocale locale;
@@ -1944,6 +2124,95 @@ bool DocumentValidator::checkMovit()
     return true;
 }
 
+bool DocumentValidator::checkGpuEffects()
+{
+    // Convert the filters that have a Movit equivalent so that frames stay on the GPU
+    QStringList convertedFilters;
+    QStringList cpuFilters;
+    bool hasWB = MainWindow::videoEffects.hasEffect(QStringLiteral("movit.white_balance"), QStringLiteral("movit.white_balance")) > -1;
+    bool hasBlur = MainWindow::videoEffects.hasEffect(QStringLiteral("movit.blur"), QStringLiteral("movit.blur")) > -1;
+    bool hasMirror = MainWindow::videoEffects.hasEffect(QStringLiteral("movit.mirror"), QStringLiteral("movit.mirror")) > -1;
+    bool hasLGG = MainWindow::videoEffects.hasEffect(QStringLiteral("movit.lift_gamma_gain"), QStringLiteral("movit.lift_gamma_gain")) > -1;
+    bool hasOverlay = MainWindow::transitions.hasTransition(QStringLiteral("movit.overlay"));
+
+    // Parse all effects in document
+    QDomNodeList filters = m_doc.elementsByTagName(QStringLiteral("filter"));
+    int max = filters.count();
+    for (int i = 0; i < max; ++i) {
+        QDomElement filt = filters.at(i).toElement();
+        QString filterId = EffectsList::property(filt, QStringLiteral("kdenlive_id"));
+        if (filterId.isEmpty()) {
+            // Internal filter (audio level, fades handled by MLT, ...)
+            continue;
+        }
+        QString service = EffectsList::property(filt, QStringLiteral("mlt_service"));
+        if (service.startsWith(QLatin1String("movit.")) || EffectsList::property(filt, QStringLiteral("kdenlive:audio")) == QLatin1String("1")) {
+            continue;
+        }
+        QString movitId;
+        if (filterId == QLatin1String("frei0r.colgate") && hasWB) {
+            movitId = QStringLiteral("movit.white_balance");
+            EffectsList::renameProperty(filt, QStringLiteral("Neutral Color"), QStringLiteral("neutral_color"));
+            QString value = EffectsList::property(filt, QStringLiteral("Color Temperature"));
+            value = factorizeGeomValue(value, 1 / 15000.0);
+            EffectsList::setProperty(filt, QStringLiteral("Color Temperature"), value);
+            EffectsList::renameProperty(filt, QStringLiteral("Color Temperature"), QStringLiteral("color_temperature"));
+        } else if (filterId == QLatin1String("frei0r.IIRblur") && hasBlur) {
+            movitId = QStringLiteral("movit.blur");
+            QString value = EffectsList::property(filt, QStringLiteral("Amount"));
+            value = factorizeGeomValue(value, 1 / 14.0);
+            EffectsList::setProperty(filt, QStringLiteral("Amount"), value);
+            EffectsList::renameProperty(filt, QStringLiteral("Amount"), QStringLiteral("radius"));
+        } else if (filterId == QLatin1String("mirror") && hasMirror && EffectsList::property(filt, QStringLiteral("mirror")) == QLatin1String("flip")) {
+            movitId = QStringLiteral("movit.mirror");
+        } else if (filterId == QLatin1String("lift_gamma_gain") && hasLGG) {
+            // Same parameters, only the service differs
+            movitId = QStringLiteral("movit.lift_gamma_gain");
+        }
+        if (movitId.isEmpty()) {
+            // MLT converts the frame back to system memory for this filter
+            cpuFilters << filterId;
+            continue;
+        }
+        filt.setAttribute(QStringLiteral("id"), movitId);
+        EffectsList::setProperty(filt, QStringLiteral("kdenlive_id"), movitId);
+        EffectsList::setProperty(filt, QStringLiteral("tag"), movitId);
+        EffectsList::setProperty(filt, QStringLiteral("mlt_service"), movitId);
+        convertedFilters << filterId;
+    }
+
+    // Parse all transitions in document
+    QDomNodeList transitions = m_doc.elementsByTagName(QStringLiteral("transition"));
+    max = transitions.count();
+    for (int i = 0; i < max; ++i) {
+        QDomElement t = transitions.at(i).toElement();
+        QString transId = EffectsList::property(t, QStringLiteral("mlt_service"));
+        if (transId.startsWith(QLatin1String("movit.")) || transId == QLatin1String("mix")) {
+            continue;
+        }
+        if ((transId == QLatin1String("qtblend") || transId == QLatin1String("frei0r.cairoblend")) && hasOverlay) {
+            EffectsList::setProperty(t, QStringLiteral("mlt_service"), QStringLiteral("movit.overlay"));
+            convertedFilters << transId;
+            continue;
+        }
+        cpuFilters << transId;
+    }
+
+    if (convertedFilters.isEmpty() && cpuFilters.isEmpty()) {
+        return true;
+    }
+    convertedFilters.removeDuplicates();
+    cpuFilters.removeDuplicates();
+    if (!convertedFilters.isEmpty()) {
+        m_modified = true;
+        KMessageBox::informationList(QApplication::activeWindow(), i18n("The following filters/transitions were converted to GPU versions:"), convertedFilters);
+    }
+    if (!cpuFilters.isEmpty()) {
+        KMessageBox::informationList(QApplication::activeWindow(), i18n("The following filters/transitions have no GPU version and will be processed on the CPU, which slows down playback:"), cpuFilters, QString(), QStringLiteral("gpu_cpu_fallback"));
+    }
+    return true;
+}
+
 QString DocumentValidator::factorizeGeomValue(QString value, double factor)
 {
     QStringList vals = value.split(QStringLiteral(";"));
@@ -26,6 +26,7 @@
 
 #include <QUrl>
 #include <QMap>
+#include <QByteArray>
 
 class QScriptValue;
 
@@ -39,6 +40,13 @@ public:
     bool isModified() const;
     /** @brief Check if the project contains references to Movit stuff (GLSL), and try to convert if wanted. */
     bool checkMovit();
+    /** @brief Convert effects and transitions to their Movit versions when GPU acceleration is enabled,
+     *  and warn about the ones that will fall back to CPU processing. */
+    bool checkGpuEffects();
+    /** @brief Upgrade a recent document in a single streaming pass over its xml, before it is parsed.
+     *  @param result receives the upgraded xml
+     *  @return false if the document needs the DOM based upgrade (or no upgrade at all) */
+    static bool streamUpgrade(const QByteArray &source, QByteArray *result, const double currentVersion);
 
 private:
     QDomDocument m_doc;
@@ -63,6 +71,12 @@ private:
     /** @brief Kdenlive <= 0.9.10 saved title clip item position/opacity with locale which was wrong, fix. */
     void fixTitleProducerLocale(QDomElement &producer);
     void convertKeyframeEffect(QDomElement effect, QStringList params, QMap <int, double> &values, int offset);
+    /** @brief Returns the version stored in the document properties, without building a DOM. -1 if not found. */
+    static double streamDocumentVersion(const QByteArray &source);
+    /** @brief 0.94: convert a framebuffer slowmotion producer to timewarp, returns its previous id if converted. */
+    static QString upgradeSlowmotionProducer(QDomElement prod);
+    /** @brief 0.95: disable the test audio of the black producer, returns false if prod is not the black producer. */
+    static bool upgradeBlackProducer(QDomElement prod);
 };
 
 #endif
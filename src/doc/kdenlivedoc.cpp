@@ -36,12 +36,18 @@
 #include "project/notesplugin.h"
 #include "project/dialogs/noteswidget.h"
 #include "core.h"
+#include "doc/thumbnailcache.h"
+#include "doc/proxystore.h"
+#include "doc/cacheindex.h"
+#include "doc/cachegovernor.h"
+#include "doc/undocost.h"
 #include "bin/bin.h"
 #include "bin/projectclip.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/bincontroller.h"
 #include "mltcontroller/effectscontroller.h"
 #include "timeline/transitionhandler.h"
+#include "projectdatastore.h"
 
 #include <KMessageBox>
 #include <KRecentDirs>
@@ -53,6 +59,8 @@
 
 #include <QCryptographicHash>
 #include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
 #include <QDebug>
 #include <QFileDialog>
 #include <QInputDialog>
@@ -61,6 +69,9 @@
 #include <QTimer>
 #include <QUndoStack>
 #include <QTextEdit>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include <mlt++/Mlt.h>
 #include <KJobWidgets/KJobWidgets>
@@ -71,20 +82,179 @@
 #include <xlocale.h>
 #endif
 
+// Memory counted for every undo command, besides the data reported through UndoCost
+#define UNDO_COMMAND_COST 256
+
+/**
+ * @class UndoEntry
+ * @brief Wraps the commands pushed on a DocUndoStack, so that their data can be discarded.
+ *
+ * Once its command was discarded, undoing the entry does nothing and asks the stack to
+ * redo it again, so that the document keeps the changes that cannot be undone anymore.
+ */
+class UndoEntry : public QUndoCommand
+{
+public:
+    UndoEntry(DocUndoStack *stack, QUndoCommand *command) :
+        QUndoCommand(command->text())
+        , m_stack(stack)
+        , m_command(command)
+        , m_cost(0)
+    {
+    }
+    ~UndoEntry()
+    {
+        delete m_command;
+    }
+    int id() const
+    {
+        return m_command ? m_command->id() : -1;
+    }
+    bool mergeWith(const QUndoCommand *other)
+    {
+        const UndoEntry *entry = static_cast<const UndoEntry *>(other);
+        if (!m_command || !entry->m_command || !m_command->mergeWith(entry->m_command)) {
+            return false;
+        }
+        setText(m_command->text());
+        updateCost();
+        m_stack->m_merged = true;
+        return true;
+    }
+    void undo()
+    {
+        if (m_command) {
+            m_command->undo();
+        } else {
+            QMetaObject::invokeMethod(m_stack, "slotRestoreIndex", Qt::QueuedConnection);
+        }
+    }
+    void redo()
+    {
+        if (m_command) {
+            m_command->redo();
+        }
+    }
+    qint64 cost() const
+    {
+        return m_cost;
+    }
+    void updateCost()
+    {
+        qint64 cost = m_command ? DocUndoStack::commandCost(m_command) : 0;
+        m_stack->m_cost += cost - m_cost;
+        m_cost = cost;
+    }
+    void expire()
+    {
+        delete m_command;
+        m_command = NULL;
+        updateCost();
+        setText(i18n("%1 (cannot be undone)", text()));
+    }
+
+private:
+    DocUndoStack *m_stack;
+    QUndoCommand *m_command;
+    qint64 m_cost;
+};
+
 DocUndoStack::DocUndoStack(QUndoGroup *parent) : QUndoStack(parent)
+    , m_cost(0)
+    , m_expired(0)
+    , m_merged(false)
 {
+    MemoryTracker::self()->addConsumer(this, "Memory undo history", i18n("Undo history"));
 }
 
 //TODO: custom undostack everywhere do that 
 void DocUndoStack::push(QUndoCommand *cmd)
 {
-    if (index() < count()) 
+    if (index() < count()) {
         emit invalidate();
-    QUndoStack::push(cmd);
+        // The undone commands are deleted by QUndoStack::push
+        for (int i = index(); i < count(); ++i) {
+            m_cost -= static_cast<const UndoEntry *>(command(i))->cost();
+        }
+    }
+    UndoEntry *entry = new UndoEntry(this, cmd);
+    m_merged = false;
+    QUndoStack::push(entry);
+    if (!m_merged) {
+        entry->updateCost();
+    }
+    expireHistory();
+}
+
+qint64 DocUndoStack::memoryCost() const
+{
+    return m_cost;
+}
+
+qint64 DocUndoStack::memoryUsage() const
+{
+    return m_cost;
+}
+
+qint64 DocUndoStack::memoryBudget() const
+{
+    return (qint64) KdenliveSettings::undomemory() * 1048576;
+}
+
+void DocUndoStack::reduceMemory()
+{
+    // The budget may have been lowered since the last command was pushed
+    expireHistory();
+}
+
+//static
+qint64 DocUndoStack::commandCost(const QUndoCommand *cmd)
+{
+    qint64 cost = UNDO_COMMAND_COST + 2 * cmd->text().size();
+    const UndoCost *data = dynamic_cast<const UndoCost *>(cmd);
+    if (data) {
+        cost += data->memoryCost();
+    }
+    for (int i = 0; i < cmd->childCount(); ++i) {
+        cost += commandCost(cmd->child(i));
+    }
+    return cost;
+}
+
+void DocUndoStack::expireHistory()
+{
+    const qint64 budget = (qint64) KdenliveSettings::undomemory() * 1048576;
+    if (budget <= 0) {
+        return;
+    }
+    // The last done command can always be undone
+    while (m_cost > budget && m_expired < index() - 1) {
+        const_cast<UndoEntry *>(static_cast<const UndoEntry *>(command(m_expired)))->expire();
+        m_expired++;
+    }
+}
+
+void DocUndoStack::slotRestoreIndex()
+{
+    if (index() < m_expired) {
+        setIndex(m_expired);
+        emit historyExhausted();
+    }
 }
 
 const double DOCUMENTVERSION = 0.95;
 
+/** @brief Parses the project xml, run in a worker thread while a large project is opened. */
+static bool parseProjectXml(QDomDocument *document, const QByteArray &data, QString *errorMsg, int *line, int *col)
+{
+    // Recent documents are upgraded while streaming, older ones by DocumentValidator on the DOM
+    QByteArray upgraded;
+    if (DocumentValidator::streamUpgrade(data, &upgraded, DOCUMENTVERSION)) {
+        return document->setContent(upgraded, false, errorMsg, line, col);
+    }
+    return document->setContent(data, false, errorMsg, line, col);
+}
+
 KdenliveDoc::KdenliveDoc(const QUrl &url, const QUrl &projectFolder, QUndoGroup *undoGroup, const QString &profileName, const QMap <QString, QString>& properties, const QMap <QString, QString>& metadata, const QPoint &tracks, Render *render, NotesPlugin *notes, bool *openBackup, MainWindow *parent) :
     QObject(parent),
     m_autosave(NULL),
@@ -94,8 +264,10 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QUrl &projectFolder, QUndoGroup
     m_render(render),
     m_notesWidget(notes->widget()),
     m_modified(false),
-    m_projectFolder(projectFolder)
+    m_projectFolder(projectFolder),
+    m_autoSaveHash(0)
 {
+    ProjectDataStore::setProjectFile(url.toLocalFile());
     // init m_profile struct
     m_commandStack = new DocUndoStack(undoGroup);
     m_profile.frame_rate_num = 0;
@@ -114,6 +286,9 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QUrl &projectFolder, QUndoGroup
     bool success = false;
     connect(m_commandStack, SIGNAL(indexChanged(int)), this, SLOT(slotModified()));
     connect(m_commandStack, SIGNAL(invalidate()), this, SLOT(checkPreviewStack()));
+    connect(m_commandStack, SIGNAL(historyExhausted()), this, SLOT(slotUndoHistoryExhausted()));
+    connect(&m_autoSaveWatcher, SIGNAL(finished()), this, SLOT(slotAutoSaveReady()));
+    connect(&m_saveWatcher, SIGNAL(finished()), this, SLOT(slotSaveReady()));
     connect(m_render, SIGNAL(setDocumentNotes(QString)), this, SLOT(slotSetDocumentNotes(QString)));
     connect(pCore->producerQueue(), &ProducerQueue::switchProfile, this, &KdenliveDoc::switchProfile);
     //connect(m_commandStack, SIGNAL(cleanChanged(bool)), this, SLOT(setModified(bool)));
@@ -178,8 +353,15 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QUrl &projectFolder, QUndoGroup
             int line;
             int col;
             QDomImplementation::setInvalidDataPolicy(QDomImplementation::DropInvalidChars);
-            success = m_document.setContent(&file, false, &errorMsg, &line, &col);
+            const QByteArray data = file.readAll();
             file.close();
+            // Keep the interface painting while the xml is parsed
+            QFutureWatcher <bool> watcher;
+            QEventLoop loop;
+            connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+            watcher.setFuture(QtConcurrent::run(parseProjectXml, &m_document, data, &errorMsg, &line, &col));
+            loop.exec(QEventLoop::ExcludeUserInputEvents);
+            success = watcher.result();
 
             if (!success) {
                 // It is corrupted
@@ -240,6 +422,8 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, const QUrl &projectFolder, QUndoGroup
                     success = validator.validate(DOCUMENTVERSION);
                     if (success && !KdenliveSettings::gpu_accel()) {
                         success = validator.checkMovit();
+                    } else if (success) {
+                        success = validator.checkGpuEffects();
                     }
                     if (success) { // Let the validator handle error messages
                         qDebug()<<" // / processing file validate ok";
@@ -301,6 +485,8 @@ void KdenliveDoc::slotSetDocumentNotes(const QString &notes)
 
 KdenliveDoc::~KdenliveDoc()
 {
+    m_autoSaveWatcher.waitForFinished();
+    m_saveWatcher.waitForFinished();
     if (m_url.isEmpty()) {
         // Document was never saved, delete cache folder
         QString documentId = QDir::cleanPath(getDocumentProperty(QStringLiteral("documentid")));
@@ -311,9 +497,11 @@ KdenliveDoc::~KdenliveDoc()
             QDir cacheDir(kdenliveCacheDir + "/" + documentId);
             if (cacheDir.exists() && cacheDir.dirName() == documentId) {
                 cacheDir.removeRecursively();
+                CacheIndex::folderRemoved(cacheDir.absolutePath());
             }
         }
     }
+    CacheIndex::sync();
     delete m_commandStack;
     //qDebug() << "// DEL CLP MAN";
     delete m_clipManager;
@@ -568,23 +756,51 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
 void KdenliveDoc::slotAutoSave()
 {
     if (m_render && m_autosave) {
-        if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
-            // show error: could not open the autosave file
-            qDebug() << "ERROR; CANNOT CREATE AUTOSAVE FILE";
-        }
-        //qDebug() << "// AUTOSAVE FILE: " << m_autosave->fileName();
-        QDomDocument sceneList = xmlSceneList(m_render->sceneList());
-        if (sceneList.isNull()) {
-            //Make sure we don't save if scenelist is corrupted
-            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
+        // Only the MLT scene list needs the GUI thread, processing and serializing it is done in a worker
+        m_autoSaveWatcher.waitForFinished();
+        const QString scene = m_render->sceneList();
+        uint hash = qHash(scene);
+        if (hash == m_autoSaveHash && m_autosave->isOpen() && m_autosave->size() > 0) {
+            // Nothing changed since the last autosave
             return;
         }
-        m_autosave->resize(0); 
-        m_autosave->write(sceneList.toString().toUtf8());
-        m_autosave->flush();
+        m_autoSaveHash = hash;
+        m_autoSaveWatcher.setFuture(QtConcurrent::run(this, &KdenliveDoc::autoSaveData, scene));
     }
 }
 
+QByteArray KdenliveDoc::autoSaveData(const QString &scene)
+{
+    QDomDocument sceneList = xmlSceneList(scene);
+    if (sceneList.isNull()) {
+        return QByteArray();
+    }
+    return sceneList.toString().toUtf8();
+}
+
+void KdenliveDoc::slotAutoSaveReady()
+{
+    if (!m_autosave || !m_modified) {
+        // The project was saved in the meantime
+        return;
+    }
+    const QByteArray data = m_autoSaveWatcher.result();
+    if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
+        // show error: could not open the autosave file
+        qDebug() << "ERROR; CANNOT CREATE AUTOSAVE FILE";
+    }
+    //qDebug() << "// AUTOSAVE FILE: " << m_autosave->fileName();
+    if (data.isEmpty()) {
+        //Make sure we don't save if scenelist is corrupted
+        m_autoSaveHash = 0;
+        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
+        return;
+    }
+    m_autosave->resize(0);
+    m_autosave->write(data);
+    m_autosave->flush();
+}
+
 void KdenliveDoc::setZoom(int horizontal, int vertical)
 {
     m_documentProperties[QStringLiteral("zoom")] = QString::number(horizontal);
@@ -665,15 +881,6 @@ QDomDocument KdenliveDoc::xmlSceneList(const QString &scene)
     }
     //addedXml.appendChild(sceneList.importNode(customeffects.documentElement(), true));
 
-    //TODO: move metadata to previous step in saving process
-    QDomElement docmetadata = sceneList.createElement(QStringLiteral("documentmetadata"));
-    QMapIterator<QString, QString> j(m_documentMetadata);
-    while (j.hasNext()) {
-        j.next();
-        docmetadata.setAttribute(j.key(), j.value());
-    }
-    //addedXml.appendChild(docmetadata);
-
     return sceneList;
 }
 
@@ -686,32 +893,72 @@ QString KdenliveDoc::documentNotes() const
 
 bool KdenliveDoc::saveSceneList(const QString &path, const QString &scene)
 {
-    QDomDocument sceneList = xmlSceneList(scene);
-    if (sceneList.isNull()) {
-        //Make sure we don't save if scenelist is corrupted
-        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", path));
+    // Only one save at a time, so that the backup copy is made from a complete file
+    if (!waitForSave()) {
         return false;
     }
-
     // Backup current version
     backupLastSavedVersion(path);
-    QFile file(path);
+    m_savePath = path;
+    m_saveWatcher.setFuture(QtConcurrent::run(this, &KdenliveDoc::writeSceneList, path, scene));
+    return true;
+}
 
+QString KdenliveDoc::writeSceneList(const QString &path, const QString &scene)
+{
+    QDomDocument sceneList = xmlSceneList(scene);
+    if (sceneList.isNull()) {
+        //Make sure we don't save if scenelist is corrupted
+        return i18n("Cannot write to file %1, scene list is corrupted.", path);
+    }
+    if (!ProjectDataStore::extract(sceneList, path)) {
+        return i18n("Cannot write to file %1", path + QStringLiteral(".data"));
+    }
+    // Write to a temporary file renamed on commit, so that a failed save leaves the previous file intact
+    QSaveFile file(path);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         qWarning() << "//////  ERROR writing to file: " << path;
-        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
-        return false;
+        return i18n("Cannot write to file %1", path);
     }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    sceneList.save(out, 1);
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        return i18n("Cannot write to file %1", path);
+    }
+    return QString();
+}
 
-    file.write(sceneList.toString().toUtf8());
-    if (file.error() != QFile::NoError) {
-        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
-        file.close();
+bool KdenliveDoc::waitForSave()
+{
+    if (m_savePath.isEmpty()) {
+        return true;
+    }
+    m_saveWatcher.waitForFinished();
+    return processSaveResult();
+}
+
+void KdenliveDoc::slotSaveReady()
+{
+    if (!m_savePath.isEmpty()) {
+        processSaveResult();
+    }
+}
+
+bool KdenliveDoc::processSaveResult()
+{
+    const QString path = m_savePath;
+    const QString error = m_saveWatcher.result();
+    m_savePath.clear();
+    if (!error.isEmpty()) {
+        // The document was marked as saved when the save started
+        setModified(true);
+        KMessageBox::error(QApplication::activeWindow(), error);
         return false;
     }
-    file.close();
     cleanupBackupFiles();
-    QFileInfo info(file);
+    QFileInfo info(path);
     QString fileName = QUrl::fromLocalFile(path).fileName().section('.', 0, -2);
     fileName.append('-' + m_documentProperties.value(QStringLiteral("documentid")));
     fileName.append(info.lastModified().toString(QStringLiteral("-yyyy-MM-dd-hh-mm")));
@@ -877,6 +1124,7 @@ QUrl KdenliveDoc::url() const
 void KdenliveDoc::setUrl(const QUrl &url)
 {
     m_url = url;
+    ProjectDataStore::setProjectFile(url.toLocalFile());
 }
 
 void KdenliveDoc::slotModified()
@@ -996,8 +1244,8 @@ void KdenliveDoc::cacheImage(const QString &fileId, const QImage &img) const
 {
     bool ok = false;
     QDir dir = getCacheDir(CacheThumbs, &ok);
-    if (ok)
-        img.save(dir.absoluteFilePath(fileId + ".png"));
+    if (ok && img.save(dir.absoluteFilePath(fileId + ".png")))
+        CacheIndex::fileWritten(dir.absoluteFilePath(fileId + ".png"));
 }
 
 void KdenliveDoc::setDocumentProperty(const QString &name, const QString &value)
@@ -1280,12 +1528,8 @@ void KdenliveDoc::slotProxyCurrentItem(bool doProxy, QList<ProjectClip *> clipLi
     if (!ok) {
         // Error
     }
-    QString extension = QStringLiteral(".") + getDocumentProperty(QStringLiteral("proxyextension"));
+    QString extension = getDocumentProperty(QStringLiteral("proxyextension"));
     QString params = getDocumentProperty(QStringLiteral("proxyparams"));
-    if (params.contains(QStringLiteral("-s "))) {
-        QString proxySize = params.section(QStringLiteral("-s "), 1).section(QStringLiteral("x"), 0, 0);
-        extension.prepend(QStringLiteral("-") + proxySize);
-    }
 
     // Prepare updated properties
     QMap <QString, QString> newProps;
@@ -1305,7 +1549,8 @@ void KdenliveDoc::slotProxyCurrentItem(bool doProxy, QList<ProjectClip *> clipLi
 
             if (doProxy) {
                 newProps.clear();
-                QString path = dir.absoluteFilePath(item->hash() + (t == Image ? QStringLiteral(".png") : extension));
+                // Proxies are shared between projects through the proxy store
+                QString path = t == Image ? dir.absoluteFilePath(item->hash() + QStringLiteral(".png")) : ProxyStore::proxyPath(item->hash(), params, extension);
                 // insert required duration for proxy
                 newProps.insert(QStringLiteral("proxy_out"), item->getProducerProperty(QStringLiteral("out")));
                 newProps.insert(QStringLiteral("kdenlive:proxy"), path);
@@ -1332,7 +1577,9 @@ void KdenliveDoc::slotProxyCurrentItem(bool doProxy, QList<ProjectClip *> clipLi
     }
     if (!hasParent) {
         if (masterCommand->childCount() > 0) {
+            pCore->binController()->startReplacementBatch();
             m_commandStack->push(masterCommand);
+            pCore->binController()->endReplacementBatch();
         }
         else delete masterCommand;
     }
@@ -1442,6 +1689,7 @@ void KdenliveDoc::updateProjectProfile(bool reloadProducers)
     KdenliveSettings::setProject_display_ratio((double) m_profile.display_aspect_num / m_profile.display_aspect_den);
     double fps = (double) m_profile.frame_rate_num / m_profile.frame_rate_den;
     KdenliveSettings::setProject_fps(fps);
+    const QSize previousSize(m_width, m_height);
     m_width = m_profile.width;
     m_height = m_profile.height;
     double fpsChanged = m_timecode.fps() / fps;
@@ -1450,8 +1698,12 @@ void KdenliveDoc::updateProjectProfile(bool reloadProducers)
     pCore->monitorManager()->resetProfiles(m_profile, m_timecode);
     if (!reloadProducers) return;
     emit updateFps(fpsChanged);
-    if (fpsChanged) {
+    if (fpsChanged != 1.0) {
+        // Clip lengths depend on the frame rate, all producers must be rebuilt
         pCore->bin()->reloadAllProducers();
+    } else if (previousSize.width() > 0 && previousSize != QSize(m_width, m_height)) {
+        // Producers stay valid, only the pixel geometries depend on the frame size
+        emit updateFrameSize((double) m_width / previousSize.width(), (double) m_height / previousSize.height());
     }
 }
 
@@ -1633,6 +1885,11 @@ void KdenliveDoc::selectPreviewProfile()
     }
 }
 
+void KdenliveDoc::slotUndoHistoryExhausted()
+{
+    displayMessage(i18n("Older changes cannot be undone, the undo history reached its memory limit"), InformationMessage);
+}
+
 void KdenliveDoc::checkPreviewStack()
 {
     // A command was pushed in the middle of the stack, remove all cached data from last undos
@@ -1651,6 +1908,7 @@ void KdenliveDoc::initCacheDirs()
     QString documentId = QDir::cleanPath(getDocumentProperty(QStringLiteral("documentid")));
     documentId.toLong(&ok);
     if (!ok || documentId.isEmpty() || kdenliveCacheDir.isEmpty()) {
+        pCore->thumbnailCache()->setDiskFolder(QDir(), false);
         return;
     }
     QString basePath = kdenliveCacheDir + "/" + documentId;
@@ -1661,6 +1919,11 @@ void KdenliveDoc::initCacheDirs()
     dir.mkdir("videothumbs");
     QDir cacheDir(kdenliveCacheDir);
     cacheDir.mkdir("proxy");
+    pCore->thumbnailCache()->setDiskFolder(getCacheDir(CacheThumbs, &ok), ok);
+    CacheIndex::markUsed(documentId);
+    if (pCore->cacheGovernor()) {
+        pCore->cacheGovernor()->setCurrentProject(documentId);
+    }
 }
 
 QDir KdenliveDoc::getCacheDir(CacheType type, bool *ok) const
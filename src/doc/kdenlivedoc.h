@@ -32,6 +32,7 @@
 #include <QObject>
 #include <QTimer>
 #include <QUrl>
+#include <QFutureWatcher>
 
 #include <kautosavefile.h>
 #include <KDirWatch>
@@ -40,6 +41,7 @@
 #include "gentime.h"
 #include "timecode.h"
 #include "definitions.h"
+#include "utils/memorytracker.h"
 #include "timeline/guide.h"
 #include "mltcontroller/effectscontroller.h"
 
@@ -60,14 +62,39 @@ namespace Mlt {
     class Profile;
 }
 
-class DocUndoStack: public QUndoStack
+class DocUndoStack: public QUndoStack, public MemoryConsumer
 {
 Q_OBJECT
 public:
     explicit DocUndoStack(QUndoGroup *parent = 0);
     void push(QUndoCommand *cmd);
+    /** @brief Returns the approximate memory used by the commands that can still be undone or redone. */
+    qint64 memoryCost() const;
+    qint64 memoryUsage() const;
+    qint64 memoryBudget() const;
+    void reduceMemory();
+    /** @brief Returns the approximate memory used by a command and its children. */
+    static qint64 commandCost(const QUndoCommand *cmd);
+
+private:
+    /** @brief Memory used by the commands of the history */
+    qint64 m_cost;
+    /** @brief Number of commands at the bottom of the stack whose data was discarded */
+    int m_expired;
+    /** @brief Set when the last pushed command was merged with the previous one */
+    bool m_merged;
+    /** @brief Discards the data of the oldest commands until the history fits the undomemory budget. */
+    void expireHistory();
+    friend class UndoEntry;
+
+private slots:
+    /** @brief Redoes the discarded commands that were undone, they cannot be undone. */
+    void slotRestoreIndex();
+
 signals:
     void invalidate();
+    /** @brief Emitted when undoing stopped at a command whose data was discarded. */
+    void historyExhausted();
 };
 
 class KdenliveDoc: public QObject
@@ -116,8 +143,12 @@ public:
     double projectDuration() const;
     /** @brief Returns the project file xml. */
     QDomDocument xmlSceneList(const QString &scene);
-    /** @brief Saves the project file xml to a file. */
+    /** @brief Saves the project file xml to a file.
+     *  The scene is serialized and written in a worker thread, errors are reported once it finishes.
+     *  Returns false if the previous save failed. */
     bool saveSceneList(const QString &path, const QString &scene);
+    /** @brief Waits for a running save to finish, returns false if it failed. */
+    bool waitForSave();
     /** @brief Saves only the MLT xml to a file for preview rendering. */
     void saveMltPlaylist(const QString fileName);
     void cacheImage(const QString &fileId, const QImage &img) const;
@@ -200,6 +231,14 @@ private:
     QList <int> m_undoChunks;
     QMap <QString, QString> m_documentProperties;
     QMap <QString, QString> m_documentMetadata;
+    /** @brief Serializes the autosave scene in a worker thread. */
+    QFutureWatcher <QByteArray> m_autoSaveWatcher;
+    /** @brief Hash of the scene last written to the autosave file, to skip unchanged autosaves. */
+    uint m_autoSaveHash;
+    /** @brief Writes the project file in a worker thread, the result is an error message. */
+    QFutureWatcher <QString> m_saveWatcher;
+    /** @brief File being written by m_saveWatcher, empty when its result was processed. */
+    QString m_savePath;
 
     QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
     void moveProjectData(const QUrl &url);
@@ -212,6 +251,12 @@ private:
     void updateProjectFolderPlacesEntry();
     /** @brief Only keep some backup files, delete some */
     void cleanupBackupFiles();
+    /** @brief Returns the autosave file content for an MLT scene, called from a worker thread. */
+    QByteArray autoSaveData(const QString &scene);
+    /** @brief Writes the project file for an MLT scene, called from a worker thread. Returns an error message on failure. */
+    QString writeSceneList(const QString &path, const QString &scene);
+    /** @brief Handles the result of the last project file write, returns false if it failed. */
+    bool processSaveResult();
     /** @brief Load document properties from the xml file */
     void loadDocumentProperties();
     /** @brief update document properties to reflect a change in the current profile */
@@ -231,6 +276,12 @@ public slots:
     void slotAutoSave();
 
 private slots:
+    /** @brief Tells the user that older changes cannot be undone. */
+    void slotUndoHistoryExhausted();
+    /** @brief The autosave scene was serialized, write it. */
+    void slotAutoSaveReady();
+    /** @brief The project file was written. */
+    void slotSaveReady();
     void slotClipModified(const QString &path);
     void slotClipMissing(const QString &path);
     void slotProcessModifiedClips();
@@ -258,6 +309,8 @@ signals:
     void reloadEffects();
     /** @brief Fps was changed, update timeline (changed = 1 means no change) */
     void updateFps(double changed);
+    /** @brief Frame size was changed while fps was kept, producers are reused and the timeline geometries scaled */
+    void updateFrameSize(double xScale, double yScale);
     /** @brief If a command is pushed when we are in the middle of undo stack, invalidate further undo history */
     void removeInvalidUndo(int ix);
     /** @brief Update compositing info */
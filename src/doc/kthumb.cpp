@@ -26,6 +26,133 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QImage>
 #include <QPainter>
+#include <QVector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Number of image lines sampled to compute the image variance
+#define VARIANCE_LINES 64
+
+/** @brief Sums the first and third byte of a line of 32 bit pixels */
+static quint64 sumLine(const uchar *line, int width)
+{
+    quint64 sum = 0;
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_and_si128(_mm_loadu_si128((const __m128i *)(line + 4 * x)), mask);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(px, ones));
+    }
+    int values[4];
+    _mm_storeu_si128((__m128i *)values, acc);
+    sum = (quint64) values[0] + values[1] + values[2] + values[3];
+#elif defined(__ARM_NEON)
+    const uint16x8_t mask = vdupq_n_u16(0xff);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 4 <= width; x += 4) {
+        uint16x8_t px = vandq_u16(vreinterpretq_u16_u8(vld1q_u8(line + 4 * x)), mask);
+        acc = vpadalq_u16(acc, px);
+    }
+    sum = (quint64) vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for (; x < width; ++x) {
+        sum += line[4 * x] + line[4 * x + 2];
+    }
+    return sum;
+}
+
+/** @brief Sums the distance to avg of the first and third byte of a line of 32 bit pixels */
+static quint64 deviationLine(const uchar *line, int width, int avg)
+{
+    quint64 delta = 0;
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i average = _mm_set1_epi16(avg);
+    __m128i acc = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_and_si128(_mm_loadu_si128((const __m128i *)(line + 4 * x)), mask);
+        // Absolute difference of unsigned 16 bit values
+        __m128i diff = _mm_or_si128(_mm_subs_epu16(px, average), _mm_subs_epu16(average, px));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(diff, ones));
+    }
+    int values[4];
+    _mm_storeu_si128((__m128i *)values, acc);
+    delta = (quint64) values[0] + values[1] + values[2] + values[3];
+#elif defined(__ARM_NEON)
+    const uint16x8_t mask = vdupq_n_u16(0xff);
+    const uint16x8_t average = vdupq_n_u16(avg);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 4 <= width; x += 4) {
+        uint16x8_t px = vandq_u16(vreinterpretq_u16_u8(vld1q_u8(line + 4 * x)), mask);
+        acc = vpadalq_u16(acc, vabdq_u16(px, average));
+    }
+    delta = (quint64) vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for (; x < width; ++x) {
+        delta += abs(line[4 * x] - avg) + abs(line[4 * x + 2] - avg);
+    }
+    return delta;
+}
+
+/** @brief Downscales 32 bit pixels into dest, each destination pixel being the average of the source pixels it covers */
+static void boxDownscale(const uchar *source, int sourceWidth, int sourceHeight, QImage &dest)
+{
+    const int width = dest.width();
+    const int height = dest.height();
+    QVector <int> columns(width + 1);
+    for (int x = 0; x <= width; ++x) {
+        columns[x] = qMax(x * sourceWidth / width, x > 0 ? columns.at(x - 1) + 1 : 0);
+    }
+    columns[width] = sourceWidth;
+    for (int y = 0; y < height; ++y) {
+        const int top = y * sourceHeight / height;
+        const int bottom = qMax(top + 1, (y + 1) * sourceHeight / height);
+        uchar *out = dest.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int left = columns.at(x);
+            const int right = qMax(left + 1, columns.at(x + 1));
+            const int count = (right - left) * (bottom - top);
+#if defined(__SSE2__)
+            // The 4 channels of a pixel are summed at once in 32 bit lanes
+            const __m128i zero = _mm_setzero_si128();
+            __m128i acc = zero;
+            for (int sy = top; sy < bottom; ++sy) {
+                const uchar *line = source + 4 * (sy * sourceWidth + left);
+                for (int sx = 0; sx < right - left; ++sx) {
+                    __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int *)(line + 4 * sx)), zero);
+                    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(px, zero));
+                }
+            }
+            __m128i avg = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(acc), _mm_set1_ps(1.0f / count)));
+            avg = _mm_packus_epi16(_mm_packs_epi32(avg, zero), zero);
+            *(int *)(out + 4 * x) = _mm_cvtsi128_si32(avg);
+#else
+            uint acc[4] = { 0, 0, 0, 0 };
+            for (int sy = top; sy < bottom; ++sy) {
+                const uchar *line = source + 4 * (sy * sourceWidth + left);
+                for (int sx = 0; sx < 4 * (right - left); sx += 4) {
+                    acc[0] += line[sx];
+                    acc[1] += line[sx + 1];
+                    acc[2] += line[sx + 2];
+                    acc[3] += line[sx + 3];
+                }
+            }
+            for (int c = 0; c < 4; ++c) {
+                out[4 * x + c] = (acc[c] + count / 2) / count;
+            }
+#endif
+        }
+    }
+}
 
 //static
 QPixmap KThumb::getImage(const QUrl &url, int width, int height)
@@ -86,13 +213,17 @@ QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height)
     ow += ow % 2;
     const uchar* imagedata = frame->get_image(format, ow, oh);
     if (imagedata) {
+        if (ow > (2 * width) || oh > (2 * height)) {
+            // there was a scaling problem, do it manually, straight from the MLT buffer
+            QImage image(width, height, QImage::Format_RGBA8888);
+            if (!image.isNull()) {
+                boxDownscale(imagedata, ow, oh, image);
+                return image;
+            }
+        }
         QImage image(ow, oh, QImage::Format_RGBA8888);
         memcpy(image.bits(), imagedata, ow * oh * 4);
         if (!image.isNull()) {
-            if (ow > (2 * width)) {
-                // there was a scaling problem, do it manually
-                image = image.scaled(width, height);
-            }
             return image;
             /*p.fill(QColor(100, 100, 100, 70));
             QPainter painter(&p);
@@ -108,27 +239,29 @@ QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height)
 //static
 uint KThumb::imageVariance(const QImage &image )
 {
-    uint delta = 0;
-    uint avg = 0;
-    uint bytes = image.byteCount();
-    uint STEPS = bytes/2;
-    QVarLengthArray<uchar> pivot(STEPS);
-    const uchar *bits=image.bits();
-    // First pass: get pivots and taking average
-    for( uint i=0; i<STEPS ; ++i ){
-        pivot[i] = bits[2 * i];
-        avg+=pivot.at(i);
-    }
-    if (STEPS)
-        avg=avg/STEPS;
-    // Second Step: calculate delta (average?)
-    for (uint i=0; i<STEPS; ++i)
-    {
-        int curdelta=abs(int(avg - pivot.at(i)));
-        delta+=curdelta;
-    }
-    if (STEPS)
-        return delta/STEPS;
-    else
+    if (image.isNull()) {
+        return 0;
+    }
+    QImage source = image;
+    if (source.depth() != 32) {
+        source = source.convertToFormat(QImage::Format_ARGB32);
+    }
+    // The first and third byte of the pixels of evenly spaced lines are sampled
+    const int step = qMax(1, source.height() / VARIANCE_LINES);
+    const int width = source.width();
+    quint64 total = 0;
+    quint64 count = 0;
+    for (int y = 0; y < source.height(); y += step) {
+        total += sumLine(source.constScanLine(y), width);
+        count += 2 * width;
+    }
+    if (count == 0) {
         return 0;
+    }
+    const int avg = total / count;
+    quint64 delta = 0;
+    for (int y = 0; y < source.height(); y += step) {
+        delta += deviationLine(source.constScanLine(y), width, avg);
+    }
+    return delta / count;
 }
@@ -0,0 +1,275 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "mediaindex.h"
+#include "proxystore.h"
+#include "kdenlivesettings.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMimeDatabase>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtConcurrent>
+
+// Delay (in ms) between a change in an indexed folder and its rescan
+#define MEDIA_INDEX_SCAN_DELAY 5000
+// Delay (in ms) before the first scan, to not slow down the application startup
+#define MEDIA_INDEX_START_DELAY 15000
+
+MediaIndex::MediaIndex(QObject *parent) : QObject(parent)
+    , m_abortScan(0)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    m_scanTimer = new QTimer(this);
+    m_scanTimer->setSingleShot(true);
+    m_scanTimer->setInterval(MEDIA_INDEX_SCAN_DELAY);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &MediaIndex::slotFolderChanged);
+    connect(m_scanTimer, &QTimer::timeout, this, &MediaIndex::slotScanDirty);
+    connect(&m_scanWatcher, &QFutureWatcher<void>::finished, this, &MediaIndex::slotScanFinished);
+    load();
+    QTimer::singleShot(MEDIA_INDEX_START_DELAY, this, SLOT(updateRoots()));
+}
+
+MediaIndex::~MediaIndex()
+{
+    m_abortScan = 1;
+    m_scanWatcher.waitForFinished();
+}
+
+QString MediaIndex::indexFile() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/mediaindex.ini");
+}
+
+void MediaIndex::load()
+{
+    QSettings index(indexFile(), QSettings::IniFormat);
+    int count = index.beginReadArray(QStringLiteral("files"));
+    for (int i = 0; i < count; ++i) {
+        index.setArrayIndex(i);
+        Entry entry;
+        entry.size = index.value(QStringLiteral("size")).toLongLong();
+        entry.modified = index.value(QStringLiteral("modified")).toLongLong();
+        entry.hash = index.value(QStringLiteral("hash")).toString();
+        m_files.insert(index.value(QStringLiteral("path")).toString(), entry);
+    }
+    index.endArray();
+    updateLocations();
+}
+
+void MediaIndex::save() const
+{
+    QDir().mkpath(QFileInfo(indexFile()).absolutePath());
+    QSettings index(indexFile(), QSettings::IniFormat);
+    index.remove(QStringLiteral("files"));
+    index.beginWriteArray(QStringLiteral("files"), m_files.count());
+    int i = 0;
+    QHashIterator <QString, Entry> it(m_files);
+    while (it.hasNext()) {
+        it.next();
+        index.setArrayIndex(i++);
+        index.setValue(QStringLiteral("path"), it.key());
+        index.setValue(QStringLiteral("size"), it.value().size);
+        index.setValue(QStringLiteral("modified"), it.value().modified);
+        index.setValue(QStringLiteral("hash"), it.value().hash);
+    }
+    index.endArray();
+}
+
+void MediaIndex::updateLocations()
+{
+    m_locations.clear();
+    QHashIterator <QString, Entry> it(m_files);
+    while (it.hasNext()) {
+        it.next();
+        m_locations.insert(QString::number(it.value().size) + QLatin1Char(':') + it.value().hash, it.key());
+    }
+}
+
+QString MediaIndex::locate(const QString &size, const QString &hash) const
+{
+    if (size.isEmpty() || hash.isEmpty()) {
+        return QString();
+    }
+    const QString path = m_locations.value(size + QLatin1Char(':') + hash);
+    if (path.isEmpty()) {
+        return QString();
+    }
+    // The index may be older than the last changes on disk
+    QFileInfo info(path);
+    if (!info.exists() || QString::number(info.size()) != size) {
+        return QString();
+    }
+    return path;
+}
+
+void MediaIndex::updateRoots()
+{
+    QStringList roots;
+    foreach(const QString &folder, KdenliveSettings::mediaindexfolders()) {
+        QFileInfo info(folder);
+        if (info.isDir()) {
+            roots << QDir::cleanPath(info.absoluteFilePath());
+        }
+    }
+    if (roots == m_roots && !roots.isEmpty()) {
+        return;
+    }
+    m_roots = roots;
+    if (!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+    // Forget the files outside of the indexed folders
+    QMutableHashIterator <QString, Entry> it(m_files);
+    while (it.hasNext()) {
+        it.next();
+        bool inRoot = false;
+        foreach(const QString &root, m_roots) {
+            if (it.key().startsWith(root + QLatin1Char('/'))) {
+                inRoot = true;
+                break;
+            }
+        }
+        if (!inRoot) {
+            it.remove();
+        }
+    }
+    updateLocations();
+    // Nothing is watched any more, so the roots are scanned recursively
+    foreach(const QString &root, m_roots) {
+        m_dirtyFolders << root;
+    }
+    slotScanDirty();
+}
+
+void MediaIndex::slotFolderChanged(const QString &path)
+{
+    m_dirtyFolders << path;
+    m_scanTimer->start();
+}
+
+void MediaIndex::slotScanDirty()
+{
+    if (m_scanWatcher.isRunning() || m_dirtyFolders.isEmpty()) {
+        // Dirty folders are scanned when the current scan ends
+        return;
+    }
+    QStringList folders;
+    foreach(const QString &folder, m_dirtyFolders) {
+        if (QFileInfo(folder).isDir()) {
+            folders << folder;
+            continue;
+        }
+        // The folder was removed, forget its files
+        QMutableHashIterator <QString, Entry> it(m_files);
+        while (it.hasNext()) {
+            it.next();
+            if (it.key().startsWith(folder + QLatin1Char('/'))) {
+                it.remove();
+            }
+        }
+        if (m_watcher->directories().contains(folder)) {
+            m_watcher->removePath(folder);
+        }
+    }
+    m_dirtyFolders.clear();
+    if (folders.isEmpty()) {
+        updateLocations();
+        save();
+        return;
+    }
+    startScan(folders);
+}
+
+void MediaIndex::startScan(const QStringList &folders)
+{
+    m_scanned.clear();
+    m_scannedFolders.clear();
+    m_scanWatcher.setFuture(QtConcurrent::run(this, &MediaIndex::scan, folders, m_files, m_watcher->directories().toSet()));
+}
+
+void MediaIndex::scan(const QStringList &folders, const QHash <QString, Entry> &known, const QSet <QString> &knownFolders)
+{
+    QMimeDatabase db;
+    QStringList pending = folders;
+    while (!pending.isEmpty() && m_abortScan == 0) {
+        const QString folder = pending.takeLast();
+        m_scannedFolders << folder;
+        QDir dir(folder);
+        foreach(const QFileInfo &info, dir.entryInfoList(QDir::Files | QDir::Readable)) {
+            const QString mime = db.mimeTypeForFile(info, QMimeDatabase::MatchExtension).name();
+            if (!mime.startsWith(QLatin1String("video/")) && !mime.startsWith(QLatin1String("audio/")) && !mime.startsWith(QLatin1String("image/"))) {
+                continue;
+            }
+            const QString path = info.absoluteFilePath();
+            Entry entry;
+            entry.size = info.size();
+            entry.modified = info.lastModified().toMSecsSinceEpoch();
+            QHash <QString, Entry>::const_iterator previous = known.constFind(path);
+            if (previous != known.constEnd() && previous.value().size == entry.size && previous.value().modified == entry.modified) {
+                entry.hash = previous.value().hash;
+            } else {
+                entry.hash = ProxyStore::fileHash(path);
+            }
+            if (!entry.hash.isEmpty()) {
+                m_scanned.insert(path, entry);
+            }
+        }
+        // Subfolders that are already watched have their own change notifications
+        foreach(const QFileInfo &info, dir.entryInfoList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
+            if (!knownFolders.contains(info.absoluteFilePath())) {
+                pending << info.absoluteFilePath();
+            }
+        }
+    }
+}
+
+void MediaIndex::slotScanFinished()
+{
+    const QSet <QString> scannedFolders = m_scannedFolders.toSet();
+    QMutableHashIterator <QString, Entry> it(m_files);
+    while (it.hasNext()) {
+        it.next();
+        if (scannedFolders.contains(QFileInfo(it.key()).absolutePath()) && !m_scanned.contains(it.key())) {
+            it.remove();
+        }
+    }
+    QHashIterator <QString, Entry> added(m_scanned);
+    while (added.hasNext()) {
+        added.next();
+        m_files.insert(added.key(), added.value());
+    }
+    const QStringList watched = m_watcher->directories();
+    foreach(const QString &folder, m_scannedFolders) {
+        if (!watched.contains(folder)) {
+            m_watcher->addPath(folder);
+        }
+    }
+    m_scanned.clear();
+    m_scannedFolders.clear();
+    updateLocations();
+    save();
+    if (!m_dirtyFolders.isEmpty()) {
+        m_scanTimer->start();
+    }
+}
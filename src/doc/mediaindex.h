@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef MEDIAINDEX_H
+#define MEDIAINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * @class MediaIndex
+ * @brief Location of the media files found in the folders of the mediaindexfolders setting.
+ *
+ * Each indexed file is recorded with its size, modification time and the partial hash
+ * stored in the clip's kdenlive:file_hash, so that the document checker can relink
+ * moved clips without asking for a folder to search. The folders are scanned in a
+ * thread, only hashing the files that are new or changed, and watched so that later
+ * changes only rescan the folder where they happened. The index is saved to the
+ * mediaindex.ini file of the cache folder after each scan.
+ */
+class MediaIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaIndex(QObject *parent = 0);
+    virtual ~MediaIndex();
+
+    /** @brief An indexed media file. */
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        QString hash;
+    };
+
+    /** @brief Returns an existing file with that size and hash, or an empty string. */
+    QString locate(const QString &size, const QString &hash) const;
+
+public slots:
+    /** @brief Applies the indexed folders from the settings. */
+    void updateRoots();
+
+private:
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_scanTimer;
+    QStringList m_roots;
+    /** @brief Indexed files by path */
+    QHash <QString, Entry> m_files;
+    /** @brief Indexed paths by "size:hash" */
+    QHash <QString, QString> m_locations;
+    /** @brief Folders changed since the last scan */
+    QSet <QString> m_dirtyFolders;
+    QFutureWatcher <void> m_scanWatcher;
+    /** @brief Result of the running scan, written by the scan thread */
+    QHash <QString, Entry> m_scanned;
+    QStringList m_scannedFolders;
+    /** @brief Set on exit to stop the scan thread */
+    QAtomicInt m_abortScan;
+    QString indexFile() const;
+    void load();
+    void save() const;
+    /** @brief Rebuild the lookup table from m_files */
+    void updateLocations();
+    /** @brief Scans the files of folders in a thread, and the subfolders that are not watched yet. */
+    void startScan(const QStringList &folders);
+    /** @brief Thread part of the scan, hashing only the files missing from known or changed since. */
+    void scan(const QStringList &folders, const QHash <QString, Entry> &known, const QSet <QString> &knownFolders);
+
+private slots:
+    void slotFolderChanged(const QString &path);
+    void slotScanDirty();
+    void slotScanFinished();
+};
+
+#endif
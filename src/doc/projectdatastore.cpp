@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "projectdatastore.h"
+#include "kdenlivesettings.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDomDocument>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QDebug>
+
+// Prefix of property values pointing to a sidecar entry
+#define REFERENCE_PREFIX "kdenlive-data:"
+// Analysis data smaller than this many characters stays in the project file
+#define EXTRACT_THRESHOLD 16384
+// File identifier and format version of the sidecar
+#define SIDECAR_MAGIC 0x4b44534cu
+#define SIDECAR_VERSION 1
+
+namespace {
+    QMutex storeMutex;
+    // Sidecar of the current project and its index, loaded on first access
+    QString storeFile;
+    bool indexLoaded = false;
+    QMap <QString, QPair<qint64, qint32> > storeIndex;
+
+    QString sidecarPath(const QString &projectFile)
+    {
+        return projectFile + QStringLiteral(".data");
+    }
+
+    // Must be called with storeMutex locked
+    void loadIndex()
+    {
+        if (indexLoaded) return;
+        indexLoaded = true;
+        storeIndex.clear();
+        QFile file(storeFile);
+        if (storeFile.isEmpty() || !file.open(QIODevice::ReadOnly)) return;
+        QDataStream in(&file);
+        quint32 magic;
+        qint32 version;
+        qint32 count;
+        in >> magic >> version >> count;
+        if (magic != SIDECAR_MAGIC || version != SIDECAR_VERSION || count < 0) {
+            qWarning() << "Invalid project data file" << storeFile;
+            return;
+        }
+        QList <QPair<QString, qint32> > entries;
+        for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QString key;
+            qint32 size;
+            in >> key >> size;
+            entries << QPair<QString, qint32>(key, size);
+        }
+        // Data blocks follow the index in the same order
+        qint64 offset = file.pos();
+        for (int i = 0; i < entries.count(); ++i) {
+            storeIndex.insert(entries.at(i).first, QPair<qint64, qint32>(offset, entries.at(i).second));
+            offset += entries.at(i).second;
+        }
+    }
+
+    // Returns the compressed data of an entry, must be called with storeMutex locked
+    QByteArray readEntry(const QString &key)
+    {
+        loadIndex();
+        QMap <QString, QPair<qint64, qint32> >::const_iterator it = storeIndex.constFind(key);
+        if (it == storeIndex.constEnd()) return QByteArray();
+        QFile file(storeFile);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(it.value().first)) return QByteArray();
+        return file.read(it.value().second);
+    }
+}
+
+//static
+void ProjectDataStore::setProjectFile(const QString &path)
+{
+    QMutexLocker lock(&storeMutex);
+    const QString file = path.isEmpty() ? QString() : sidecarPath(path);
+    if (file == storeFile) return;
+    storeFile = file;
+    indexLoaded = false;
+    storeIndex.clear();
+}
+
+//static
+bool ProjectDataStore::isReference(const QString &value)
+{
+    return value.startsWith(QLatin1String(REFERENCE_PREFIX));
+}
+
+//static
+QString ProjectDataStore::resolve(const QString &value)
+{
+    if (!isReference(value)) return value;
+    QMutexLocker lock(&storeMutex);
+    const QByteArray data = readEntry(value.mid(strlen(REFERENCE_PREFIX)));
+    if (data.isEmpty()) {
+        qWarning() << "Missing project data" << value << "in" << storeFile;
+        return QString();
+    }
+    return QString::fromUtf8(qUncompress(data));
+}
+
+//static
+void ProjectDataStore::embed(QDomDocument &doc)
+{
+    QDomNodeList props = doc.elementsByTagName(QStringLiteral("property"));
+    for (int i = 0; i < props.count(); ++i) {
+        QDomElement prop = props.at(i).toElement();
+        const QString value = prop.text();
+        if (!isReference(value)) continue;
+        while (prop.hasChildNodes()) {
+            prop.removeChild(prop.firstChild());
+        }
+        prop.appendChild(doc.createTextNode(resolve(value)));
+    }
+}
+
+//static
+bool ProjectDataStore::extract(QDomDocument &doc, const QString &projectFile)
+{
+    QMap <QString, QByteArray> entries;
+    QDomNodeList props = doc.elementsByTagName(QStringLiteral("property"));
+    QMutexLocker lock(&storeMutex);
+    for (int i = 0; i < props.count(); ++i) {
+        QDomElement prop = props.at(i).toElement();
+        if (!prop.attribute(QStringLiteral("name")).startsWith(QLatin1String("kdenlive:clipanalysis."))) continue;
+        const QString value = prop.text();
+        if (isReference(value)) {
+            // Keep data that was not loaded since the project was opened
+            const QString key = value.mid(strlen(REFERENCE_PREFIX));
+            if (!entries.contains(key)) {
+                const QByteArray data = readEntry(key);
+                if (!data.isEmpty()) entries.insert(key, data);
+            }
+            continue;
+        }
+        if (!KdenliveSettings::analysissidecar() || value.length() < EXTRACT_THRESHOLD) continue;
+        const QByteArray utf8 = value.toUtf8();
+        const QString key = QCryptographicHash::hash(utf8, QCryptographicHash::Md5).toHex();
+        if (!entries.contains(key)) entries.insert(key, qCompress(utf8));
+        while (prop.hasChildNodes()) {
+            prop.removeChild(prop.firstChild());
+        }
+        prop.appendChild(doc.createTextNode(QStringLiteral(REFERENCE_PREFIX) + key));
+    }
+    const QString file = sidecarPath(projectFile);
+    if (entries.isEmpty()) {
+        if (QFile::exists(file)) QFile::remove(file);
+    } else {
+        QSaveFile out(file);
+        if (!out.open(QIODevice::WriteOnly)) return false;
+        QDataStream stream(&out);
+        stream << (quint32) SIDECAR_MAGIC << (qint32) SIDECAR_VERSION << (qint32) entries.count();
+        QMapIterator <QString, QByteArray> i(entries);
+        while (i.hasNext()) {
+            i.next();
+            stream << i.key() << (qint32) i.value().size();
+        }
+        i.toFront();
+        while (i.hasNext()) {
+            i.next();
+            out.write(i.value());
+        }
+        if (stream.status() != QDataStream::Ok || !out.commit()) return false;
+    }
+    if (file == storeFile) {
+        // Offsets changed, reload the index on next access
+        indexLoaded = false;
+        storeIndex.clear();
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef PROJECTDATASTORE_H
+#define PROJECTDATASTORE_H
+
+#include <QString>
+
+class QDomDocument;
+
+/**
+ * @class ProjectDataStore
+ * @brief Compressed sidecar file for bulky clip analysis data.
+ *
+ * When the analysissidecar setting is enabled, large kdenlive:clipanalysis properties
+ * are moved out of the project file on save into <project>.data, and the property only
+ * keeps a reference to its entry. Entries are zlib compressed, keyed by the md5 of their
+ * content, and only decompressed when the data is requested. All methods can be called
+ * from any thread.
+ */
+class ProjectDataStore
+{
+public:
+    /** @brief Sets the project file whose sidecar resolves references. */
+    static void setProjectFile(const QString &path);
+    /** @brief Returns true if a property value is a reference to a sidecar entry. */
+    static bool isReference(const QString &value);
+    /** @brief Returns the data of a property value, read from the sidecar if it is a reference. */
+    static QString resolve(const QString &value);
+    /** @brief Moves large analysis properties of a project document to the sidecar of @param projectFile.
+     *  References already in the document are copied from the current sidecar.
+     *  @return false if the sidecar could not be written */
+    static bool extract(QDomDocument &doc, const QString &projectFile);
+    /** @brief Replaces all references of a project document by their data, for copies without the sidecar. */
+    static void embed(QDomDocument &doc);
+};
+
+#endif
@@ -0,0 +1,293 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "proxystore.h"
+#include "kdenlivesettings.h"
+#include "cacheindex.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QMimeDatabase>
+#include <QProcess>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QDebug>
+
+// Delay (in ms) between two scans of the ingest folders
+#define INGEST_SCAN_DELAY 5000
+
+ProxyStore::ProxyStore(QObject *parent) : QObject(parent)
+    , m_ingestProcess(NULL)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    m_scanTimer = new QTimer(this);
+    m_scanTimer->setSingleShot(true);
+    m_scanTimer->setInterval(INGEST_SCAN_DELAY);
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), m_scanTimer, SLOT(start()));
+    connect(m_scanTimer, SIGNAL(timeout()), this, SLOT(scanFolders()));
+    updateWatchedFolders();
+    if (KdenliveSettings::proxystorelimit() > 0) {
+        collectGarbage((qint64) KdenliveSettings::proxystorelimit() * 1048576);
+    }
+}
+
+ProxyStore::~ProxyStore()
+{
+    if (m_ingestProcess) {
+        m_ingestProcess->disconnect(this);
+        m_ingestProcess->kill();
+        m_ingestProcess->waitForFinished();
+        delete m_ingestProcess;
+        QFile::remove(m_ingestDest);
+    }
+}
+
+//static
+QDir ProxyStore::folder()
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/proxy"));
+    if (!dir.exists()) {
+        dir.mkpath(QStringLiteral("."));
+    }
+    return dir;
+}
+
+//static
+QString ProxyStore::fileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    /*
+     * 1 MB = 1 second per 450 files (or faster)
+     * 10 MB = 9 seconds per 450 files (or faster)
+     */
+    QByteArray fileData;
+    if (file.size() > 2000000) {
+        fileData = file.read(1000000);
+        if (file.seek(file.size() - 1000000))
+            fileData.append(file.readAll());
+    } else
+        fileData = file.readAll();
+    file.close();
+    return QCryptographicHash::hash(fileData, QCryptographicHash::Md5).toHex();
+}
+
+//static
+QString ProxyStore::proxyPath(const QString &hash, const QString &params, const QString &extension)
+{
+    QString suffix = QStringLiteral(".") + extension;
+    if (params.contains(QStringLiteral("-s "))) {
+        QString proxySize = params.section(QStringLiteral("-s "), 1).section(QStringLiteral("x"), 0, 0);
+        suffix.prepend(QStringLiteral("-") + proxySize);
+    }
+    return folder().absoluteFilePath(hash + suffix);
+}
+
+//static
+void ProxyStore::markUsed(const QString &path)
+{
+    QFileInfo info(path);
+    if (info.absolutePath() != folder().absolutePath()) {
+        // Not a shared proxy
+        return;
+    }
+    QSettings usage(folder().absoluteFilePath(QStringLiteral("usage.ini")), QSettings::IniFormat);
+    usage.setValue(QStringLiteral("lastused/") + info.fileName(), QDateTime::currentDateTime().toMSecsSinceEpoch());
+}
+
+//static
+qint64 ProxyStore::size(int *count)
+{
+    QDir dir = folder();
+    QFileInfoList files = dir.entryInfoList(QDir::Files);
+    qint64 total = 0;
+    int proxies = 0;
+    foreach(const QFileInfo &info, files) {
+        if (info.fileName() == QLatin1String("usage.ini")) continue;
+        total += info.size();
+        proxies++;
+    }
+    if (count) *count = proxies;
+    return total;
+}
+
+//static
+int ProxyStore::collectGarbage(qint64 limit, const QStringList &keep)
+{
+    QDir dir = folder();
+    QSettings usage(dir.absoluteFilePath(QStringLiteral("usage.ini")), QSettings::IniFormat);
+    usage.beginGroup(QStringLiteral("lastused"));
+    QFileInfoList files = dir.entryInfoList(QDir::Files);
+    // Sort proxies by last use, files never marked use their modification time
+    QMultiMap <qint64, QFileInfo> byUse;
+    qint64 total = 0;
+    foreach(const QFileInfo &info, files) {
+        if (info.fileName() == QLatin1String("usage.ini")) continue;
+        total += info.size();
+        qint64 used = usage.value(info.fileName(), info.lastModified().toMSecsSinceEpoch()).toLongLong();
+        byUse.insert(used, info);
+    }
+    int removed = 0;
+    QMapIterator <qint64, QFileInfo> i(byUse);
+    while (total > limit && i.hasNext()) {
+        i.next();
+        const QFileInfo &info = i.value();
+        bool protect = false;
+        foreach(const QString &hash, keep) {
+            if (info.fileName().startsWith(hash)) {
+                protect = true;
+                break;
+            }
+        }
+        if (protect || !CacheIndex::removeFile(info.absoluteFilePath())) continue;
+        usage.remove(info.fileName());
+        total -= info.size();
+        removed++;
+    }
+    usage.endGroup();
+    return removed;
+}
+
+//static
+QStringList ProxyStore::encodeArguments(const QString &source, const QString &params, const QString &dest)
+{
+    QStringList parameters;
+    if (params.contains(QStringLiteral("-noautorotate"))) {
+        parameters << QStringLiteral("-noautorotate");
+    }
+    parameters << QStringLiteral("-i") << source;
+    foreach(const QString &s, params.split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+        if (s != QLatin1String("-noautorotate")) {
+            parameters << s;
+        }
+    }
+    parameters << QStringLiteral("-y") << dest;
+    return parameters;
+}
+
+//static
+QString ProxyStore::partialPath(const QString &dest)
+{
+    QFileInfo info(dest);
+    return info.absolutePath() + QStringLiteral("/.") + info.fileName();
+}
+
+void ProxyStore::updateWatchedFolders()
+{
+    if (!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+    QStringList folders = KdenliveSettings::proxywatchfolders();
+    foreach(const QString &path, folders) {
+        if (QFileInfo(path).isDir()) {
+            m_watcher->addPath(path);
+        }
+    }
+    if (!m_watcher->directories().isEmpty()) {
+        m_scanTimer->start();
+    }
+}
+
+void ProxyStore::scanFolders()
+{
+    QString params = KdenliveSettings::proxyparams();
+    QString extension = KdenliveSettings::proxyextension();
+    if (params.isEmpty() || extension.isEmpty()) {
+        return;
+    }
+    QMimeDatabase db;
+    bool waiting = false;
+    foreach(const QString &path, m_watcher->directories()) {
+        QDir dir(path);
+        QFileInfoList files = dir.entryInfoList(QDir::Files);
+        foreach(const QFileInfo &info, files) {
+            const QString file = info.absoluteFilePath();
+            if (m_queue.contains(file) || file == m_ingestSource || !db.mimeTypeForFile(info).name().startsWith(QLatin1String("video/"))) {
+                continue;
+            }
+            if (!m_pending.contains(file)) {
+                // Files may still be copied, wait until their size is stable
+                m_pending.insert(file, info.size());
+                waiting = true;
+                continue;
+            }
+            if (m_pending.value(file) != info.size()) {
+                m_pending[file] = info.size();
+                waiting = true;
+                continue;
+            }
+            if (m_pending.value(file) < 0) {
+                // Already handled
+                continue;
+            }
+            m_pending[file] = -1;
+            QString hash = fileHash(file);
+            if (!hash.isEmpty() && !QFile::exists(proxyPath(hash, params, extension))) {
+                m_queue << file;
+            }
+        }
+    }
+    if (waiting) {
+        m_scanTimer->start();
+    }
+    processQueue();
+}
+
+void ProxyStore::processQueue()
+{
+    if (m_ingestProcess || m_queue.isEmpty()) {
+        return;
+    }
+    m_ingestSource = m_queue.takeFirst();
+    QString params = KdenliveSettings::proxyparams();
+    QString dest = proxyPath(fileHash(m_ingestSource), params, KdenliveSettings::proxyextension());
+    m_ingestDest = partialPath(dest);
+    QStringList parameters = encodeArguments(m_ingestSource, params, m_ingestDest);
+    m_ingestProcess = new QProcess;
+    m_ingestProcess->setProperty("dest", dest);
+    connect(m_ingestProcess, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotIngestFinished()));
+    m_ingestProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
+}
+
+void ProxyStore::slotIngestFinished()
+{
+    QString dest = m_ingestProcess->property("dest").toString();
+    if (m_ingestProcess->exitStatus() == QProcess::NormalExit && m_ingestProcess->exitCode() == 0 && QFileInfo(m_ingestDest).size() > 0) {
+        CacheIndex::removeFile(dest);
+        if (QFile::rename(m_ingestDest, dest)) {
+            CacheIndex::fileWritten(dest);
+            markUsed(dest);
+        }
+    } else {
+        qDebug() << "// Proxy ingest failed for" << m_ingestSource;
+    }
+    QFile::remove(m_ingestDest);
+    m_ingestProcess->deleteLater();
+    m_ingestProcess = NULL;
+    m_ingestSource.clear();
+    if (KdenliveSettings::proxystorelimit() > 0) {
+        collectGarbage((qint64) KdenliveSettings::proxystorelimit() * 1048576);
+    }
+    processQueue();
+}
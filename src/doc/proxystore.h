@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+#ifndef PROXYSTORE_H
+#define PROXYSTORE_H
+
+#include <QObject>
+#include <QDir>
+#include <QMap>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QProcess;
+class QTimer;
+
+/**
+ * @class ProxyStore
+ * @brief Proxy clips shared by all projects.
+ *
+ * Proxies live in the proxy cache folder and are named after the source clip hash,
+ * so a file used in several projects is only proxied once. The store remembers when
+ * each proxy was last used and removes the least recently used ones when it grows
+ * over the proxystorelimit setting. It can also proxy new media files appearing
+ * in the folders listed in the proxywatchfolders setting, one file at a time.
+ */
+class ProxyStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProxyStore(QObject *parent = 0);
+    virtual ~ProxyStore();
+
+    /** @brief Returns the shared proxy folder. */
+    static QDir folder();
+    /** @brief Returns the hash identifying a media file, the same as the clip's kdenlive:file_hash. */
+    static QString fileHash(const QString &path);
+    /** @brief Returns the proxy file for a clip hash, encoded with params and extension (without leading dot). */
+    static QString proxyPath(const QString &hash, const QString &params, const QString &extension);
+    /** @brief Records that a proxy was just used, so that it is kept when collecting garbage. */
+    static void markUsed(const QString &path);
+    /** @brief Returns the total size in bytes and @param count the number of proxies in the store. */
+    static qint64 size(int *count = NULL);
+    /** @brief Removes the least recently used proxies until the store is smaller than limit bytes.
+     *  @param keep Hashes of the clips whose proxies must not be removed
+     *  @return the number of removed files */
+    static int collectGarbage(qint64 limit, const QStringList &keep = QStringList());
+    /** @brief Returns the FFmpeg arguments encoding source to dest with the proxy params. */
+    static QStringList encodeArguments(const QString &source, const QString &params, const QString &dest);
+    /** @brief Returns the hidden file a proxy is encoded to, so that a project never picks an incomplete proxy. */
+    static QString partialPath(const QString &dest);
+
+public slots:
+    /** @brief Applies the ingest folders from the settings. */
+    void updateWatchedFolders();
+
+private:
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_scanTimer;
+    QProcess *m_ingestProcess;
+    /** @brief New files and their size when first seen, they are proxied once the size is stable. */
+    QMap <QString, qint64> m_pending;
+    QStringList m_queue;
+    QString m_ingestSource;
+    QString m_ingestDest;
+    /** @brief Starts proxying the next queued file. */
+    void processQueue();
+
+private slots:
+    void scanFolders();
+    void slotIngestFinished();
+};
+
+#endif
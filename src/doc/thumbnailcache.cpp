@@ -0,0 +1,218 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "thumbnailcache.h"
+#include "kdenlivesettings.h"
+#include "cacheindex.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <KLocalizedString>
+
+// Quality of the JPEG files written to the disk tier
+#define DISK_QUALITY 85
+// Part of the disk budget kept after pruning, avoids pruning on every insert
+#define DISK_PRUNE_RATIO 0.9
+
+ThumbnailCache::ThumbnailCache() :
+    m_diskEnabled(false)
+    , m_diskUsage(0)
+    , m_diskBudget(0)
+    , m_memoryHits(0)
+    , m_diskHits(0)
+    , m_misses(0)
+{
+    updateBudgets();
+    MemoryTracker::self()->addConsumer(this, "Memory thumbnail cache", i18n("Thumbnail cache"));
+}
+
+qint64 ThumbnailCache::memoryUsage() const
+{
+    QMutexLocker lock(&m_mutex);
+    return (qint64) m_memory.totalCost() * 1024;
+}
+
+qint64 ThumbnailCache::memoryBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return (qint64) m_memory.maxCost() * 1024;
+}
+
+QString ThumbnailCache::key(const QString &hash, int frame, int height)
+{
+    return hash + '#' + QString::number(frame) + '_' + QString::number(height);
+}
+
+QImage ThumbnailCache::image(const QString &hash, int frame, int height)
+{
+    return lookup(key(hash, frame, height));
+}
+
+QImage ThumbnailCache::sprite(const QString &hash, int height)
+{
+    return lookup(hash + QStringLiteral("#sprite_") + QString::number(height));
+}
+
+QImage ThumbnailCache::lookup(const QString &id)
+{
+    QString path;
+    {
+        QMutexLocker lock(&m_mutex);
+        QImage *img = m_memory.object(id);
+        if (img) {
+            m_memoryHits++;
+            return *img;
+        }
+        if (!m_diskEnabled) {
+            m_misses++;
+            return QImage();
+        }
+        path = m_diskFolder.absoluteFilePath(id + ".jpg");
+    }
+    // Decode outside of the lock, other threads keep using the memory tier
+    QImage result;
+    if (QFile::exists(path)) {
+        result.load(path);
+    }
+    QMutexLocker lock(&m_mutex);
+    if (result.isNull()) {
+        m_misses++;
+    } else {
+        m_diskHits++;
+        m_memory.insert(id, new QImage(result), result.byteCount() / 1024 + 1);
+    }
+    return result;
+}
+
+QString ThumbnailCache::diskPath(const QString &hash, int frame, int height) const
+{
+    QString path;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_diskEnabled || hash.isEmpty()) {
+            return QString();
+        }
+        path = m_diskFolder.absoluteFilePath(key(hash, frame, height) + ".jpg");
+    }
+    return QFile::exists(path) ? path : QString();
+}
+
+void ThumbnailCache::insert(const QString &hash, int frame, int height, const QImage &img, bool persistent)
+{
+    if (img.isNull() || hash.isEmpty()) {
+        return;
+    }
+    store(key(hash, frame, height), img, persistent);
+}
+
+void ThumbnailCache::insertSprite(const QString &hash, int height, const QImage &img)
+{
+    if (img.isNull() || hash.isEmpty()) {
+        return;
+    }
+    store(hash + QStringLiteral("#sprite_") + QString::number(height), img, true);
+}
+
+void ThumbnailCache::store(const QString &id, const QImage &img, bool persistent)
+{
+    QString path;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_memory.insert(id, new QImage(img), img.byteCount() / 1024 + 1);
+        if (!persistent || !m_diskEnabled || m_diskBudget <= 0) {
+            return;
+        }
+        path = m_diskFolder.absoluteFilePath(id + ".jpg");
+    }
+    qint64 previous = QFileInfo(path).size();
+    if (!img.save(path, "JPG", DISK_QUALITY)) {
+        return;
+    }
+    CacheIndex::fileWritten(path, previous);
+    QMutexLocker lock(&m_mutex);
+    m_diskUsage += QFileInfo(path).size() - previous;
+    if (m_diskUsage > m_diskBudget) {
+        pruneDisk();
+    }
+}
+
+void ThumbnailCache::setDiskFolder(const QDir &dir, bool enabled)
+{
+    QMutexLocker lock(&m_mutex);
+    m_diskFolder = dir;
+    m_diskEnabled = enabled;
+    countDiskUsage();
+}
+
+void ThumbnailCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_memory.clear();
+    countDiskUsage();
+}
+
+void ThumbnailCache::updateBudgets()
+{
+    QMutexLocker lock(&m_mutex);
+    // Costs are counted in kilobytes
+    m_memory.setMaxCost(KdenliveSettings::thumbcachememory() * 1024);
+    m_diskBudget = (qint64) KdenliveSettings::thumbcachedisk() * 1024 * 1024;
+    if (m_diskEnabled && m_diskUsage > m_diskBudget) {
+        pruneDisk();
+    }
+}
+
+QString ThumbnailCache::statistics() const
+{
+    QMutexLocker lock(&m_mutex);
+    const qint64 total = m_memoryHits + m_diskHits + m_misses;
+    const int hitRate = total > 0 ? (m_memoryHits + m_diskHits) * 100 / total : 0;
+    return i18n("Thumbnail cache: %1 memory hits, %2 disk hits, %3 misses (%4% hit rate)\nMemory: %5 / %6 MB, disk: %7 / %8 MB",
+                m_memoryHits, m_diskHits, m_misses, hitRate,
+                m_memory.totalCost() / 1024, m_memory.maxCost() / 1024,
+                m_diskUsage / 1048576, m_diskBudget / 1048576);
+}
+
+void ThumbnailCache::countDiskUsage()
+{
+    m_diskUsage = 0;
+    if (!m_diskEnabled) {
+        return;
+    }
+    const QFileInfoList files = m_diskFolder.entryInfoList(QStringList() << QStringLiteral("*.jpg"), QDir::Files);
+    foreach (const QFileInfo &info, files) {
+        m_diskUsage += info.size();
+    }
+}
+
+void ThumbnailCache::pruneDisk()
+{
+    const qint64 target = m_diskBudget * DISK_PRUNE_RATIO;
+    // Oldest files first
+    const QFileInfoList files = m_diskFolder.entryInfoList(QStringList() << QStringLiteral("*.jpg"), QDir::Files, QDir::Time | QDir::Reversed);
+    foreach (const QFileInfo &info, files) {
+        if (m_diskUsage <= target) {
+            break;
+        }
+        if (CacheIndex::removeFile(info.absoluteFilePath())) {
+            m_diskUsage -= info.size();
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include "utils/memorytracker.h"
+
+#include <QCache>
+#include <QDir>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @class ThumbnailCache
+ * @brief Clip thumbnails shared by the whole application.
+ *
+ * Thumbnails are kept in a least recently used memory tier and written as
+ * JPEG files to the project thumbnail folder. Entries are keyed by clip hash,
+ * frame and height, so clips using the same file share their thumbnails.
+ * Sprite sheets, used to scrub clips in the Bin, are stored next to them.
+ * Both tiers are bounded by the thumbcachememory and thumbcachedisk settings.
+ * All methods can be called from any thread.
+ */
+class ThumbnailCache : public MemoryConsumer
+{
+public:
+    ThumbnailCache();
+    qint64 memoryUsage() const;
+    qint64 memoryBudget() const;
+
+    /** @brief Returns the thumbnail from memory or disk, a null image if it was never stored. */
+    QImage image(const QString &hash, int frame, int height);
+    /** @brief Returns the sprite sheet of a clip, a null image if it was never stored. */
+    QImage sprite(const QString &hash, int height);
+    /** @brief Stores the sprite sheet of a clip in both tiers. */
+    void insertSprite(const QString &hash, int height, const QImage &img);
+    /** @brief Returns the file of a thumbnail in the disk tier, empty if it is not on disk. */
+    QString diskPath(const QString &hash, int frame, int height) const;
+    /** @brief Stores a thumbnail, @param persistent also writes it to the disk tier. */
+    void insert(const QString &hash, int frame, int height, const QImage &img, bool persistent = true);
+    /** @brief Sets the folder of the disk tier, @param enabled false disables it. */
+    void setDiskFolder(const QDir &dir, bool enabled);
+    /** @brief Empties the memory tier and counts the disk usage again. */
+    void clear();
+    /** @brief Applies the memory and disk budgets from the settings. */
+    void updateBudgets();
+    /** @brief Returns a readable summary of the cache hits and misses. */
+    QString statistics() const;
+
+private:
+    mutable QMutex m_mutex;
+    QCache <QString, QImage> m_memory;
+    QDir m_diskFolder;
+    bool m_diskEnabled;
+    qint64 m_diskUsage;
+    qint64 m_diskBudget;
+    qint64 m_memoryHits;
+    qint64 m_diskHits;
+    qint64 m_misses;
+
+    static QString key(const QString &hash, int frame, int height);
+    /** @brief Returns the entry from memory or disk, a null image if it was never stored. */
+    QImage lookup(const QString &id);
+    /** @brief Stores an entry, @param persistent also writes it to the disk tier. */
+    void store(const QString &id, const QImage &img, bool persistent);
+    /** @brief Sums the size of the cached files, called with the mutex locked. */
+    void countDiskUsage();
+    /** @brief Removes the oldest files until the disk tier fits its budget, called with the mutex locked. */
+    void pruneDisk();
+};
+
+#endif
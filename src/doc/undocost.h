@@ -0,0 +1,40 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef UNDOCOST_H
+#define UNDOCOST_H
+
+#include <QtGlobal>
+
+/**
+ * @class UndoCost
+ * @brief Implemented by the undo commands holding large data.
+ *
+ * DocUndoStack adds the cost of a command, of its children and a fixed amount for
+ * every other command to bound the memory used by the undo history.
+ */
+class UndoCost
+{
+public:
+    virtual ~UndoCost() {}
+    /** @brief Returns the approximate memory used by the command data in bytes, without its children. */
+    virtual qint64 memoryCost() const = 0;
+};
+
+#endif
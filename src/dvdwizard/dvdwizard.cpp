@@ -38,8 +38,48 @@
 #include <QMenu>
 #include <QGridLayout>
 #include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QtConcurrent>
 #include <QDebug>
 
+// Number of menu configurations kept in the menu cache folder
+#define MAX_CACHED_MENUS 8
+
+// The destination is an open temporary file, so overwrite its content instead of replacing it
+static bool copyMenuFile(const QString &source, const QString &dest)
+{
+    QFile in(source);
+    QFile out(dest);
+    if (!in.open(QIODevice::ReadOnly) || !out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    while (!in.atEnd()) {
+        if (out.write(in.read(1 << 20)) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool saveMenuImages(const QList<QImage> &images, const QStringList &paths)
+{
+    bool result = true;
+    for (int i = 0; i < images.count(); ++i) {
+        // Write under a temporary name so that an interrupted save is never taken for a cached image
+        const QString partial = paths.at(i) + QStringLiteral(".part");
+        if (!images.at(i).save(partial, "PNG")) {
+            QFile::remove(partial);
+            result = false;
+            continue;
+        }
+        QFile::remove(paths.at(i));
+        if (!QFile::rename(partial, paths.at(i))) {
+            result = false;
+        }
+    }
+    return result;
+}
+
 
 DvdWizard::DvdWizard(MonitorManager *manager, const QString &url, QWidget *parent) :
     QWizard(parent)
@@ -49,6 +89,9 @@ DvdWizard::DvdWizard(MonitorManager *manager, const QString &url, QWidget *paren
   , m_letterboxMovie(QStringLiteral("XXXXXX.mpg"))
   , m_dvdauthor(NULL)
   , m_mkiso(NULL)
+  , m_spumux(NULL)
+  , m_spumuxPass(0)
+  , m_authorPending(false)
   , m_vobitem(NULL)
   , m_selectedImage(QStringLiteral("XXXXXX.png"))
   , m_selectedLetterImage(QStringLiteral("XXXXXX.png"))
@@ -60,6 +103,7 @@ DvdWizard::DvdWizard(MonitorManager *manager, const QString &url, QWidget *paren
   , m_burnMenu(new QMenu(parent))
   , m_previousPage(0)
 {
+    connect(&m_menuImagesWatcher, &QFutureWatcher<bool>::finished, this, &DvdWizard::slotMenuImagesReady);
     setWindowTitle(i18n("DVD Wizard"));
     //setPixmap(QWizard::WatermarkPixmap, QPixmap(QStandardPaths::locate(QStandardPaths::DataLocation, "banner.png")));
     m_pageVob = new DvdWizardVob(this);
@@ -71,6 +115,7 @@ DvdWizard::DvdWizard(MonitorManager *manager, const QString &url, QWidget *paren
     addPage(m_pageChapters);
 
     if (!url.isEmpty()) m_pageVob->setUrl(url);
+    connect(m_pageVob, SIGNAL(transcodingFinished()), this, SLOT(slotTranscodingFinished()));
     m_pageVob->setMinimumSize(m_pageChapters->size());
 
     m_pageMenu = new DvdWizardMenu(m_pageVob->dvdFormat(), this);
@@ -151,6 +196,11 @@ DvdWizard::~DvdWizard()
         m_mkiso->close();
         delete m_mkiso;
     }
+    if (m_spumux) {
+        m_spumux->blockSignals(true);
+        m_spumux->close();
+        delete m_spumux;
+    }
 }
 
 
@@ -240,53 +290,117 @@ void DvdWizard::generateDvd()
     m_status.error_log->clear();
     // initialize html content
     m_status.error_log->setText(QStringLiteral("<html></html>"));
+    m_menuMovieUrl.clear();
+    m_menuButtons.clear();
+    m_buttonsTarget.clear();
 
     if (m_pageMenu->createMenu()) {
-        m_pageMenu->createButtonImages(m_selectedImage.fileName(), m_highlightedImage.fileName(), false);
-        m_pageMenu->createBackgroundImage(m_menuImageBackground.fileName(), false);
-        images->setIcon(QIcon::fromTheme(QStringLiteral("dialog-ok")));
-        connect(&m_menuJob, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessMenuStatus(int,QProcess::ExitStatus)));
-        ////qDebug() << "/// STARTING MLT VOB CREATION: "<<m_selectedImage.fileName()<<m_menuImageBackground.fileName();
-        if (!m_pageMenu->menuMovie()) {
-            // create menu vob file
-            m_vobitem =  m_status.job_progress->item(1);
-            m_status.job_progress->setCurrentRow(1);
-            m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("system-run")));
-
-            QStringList args;
-            args << QStringLiteral("-profile") << m_pageVob->dvdProfile();
-            args.append(m_menuImageBackground.fileName());
-            args.append(QStringLiteral("in=0"));
-            args.append(QStringLiteral("out=100"));
-            args << QStringLiteral("-consumer") << "avformat:" + m_menuVideo.fileName()<<QStringLiteral("properties=DVD");
-            m_menuJob.start(KdenliveSettings::rendererpath(), args);
-        } else {
-            // Movie as menu background, do the compositing
-            m_vobitem =  m_status.job_progress->item(1);
-            m_status.job_progress->setCurrentRow(1);
-            m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("system-run")));
-
-            int menuLength = m_pageMenu->menuMovieLength();
-            if (menuLength == -1) {
-                // menu movie is invalid
-                errorMessage(i18n("Menu movie is invalid"));
-                m_status.button_start->setEnabled(true);
-                m_status.button_abort->setEnabled(false);
-                return;
-            }
-            QStringList args;
-            args.append(QStringLiteral("-profile"));
-            args.append(m_pageVob->dvdProfile());
-            args.append(m_pageMenu->menuMoviePath());
-            args << QStringLiteral("-track") << m_menuImageBackground.fileName();
-            args << "out=" + QString::number(menuLength);
-            args << QStringLiteral("-transition") << QStringLiteral("composite") << QStringLiteral("always_active=1");
-            args << QStringLiteral("-consumer") << "avformat:" + m_menuFinalVideo.fileName()<<QStringLiteral("properties=DVD");
-            m_menuJob.start(KdenliveSettings::rendererpath(), args);
-            ////qDebug()<<"// STARTING MENU JOB, image: "<<m_menuImageBackground.fileName()<<"\n-------------";
+        m_menuCacheFolder = menuCacheFolder();
+        QDir cache(m_menuCacheFolder);
+        if (cache.exists(QStringLiteral("selected.png")) && cache.exists(QStringLiteral("highlighted.png")) && cache.exists(QStringLiteral("background.png"))) {
+            // Unchanged menu, reuse the images rendered last time
+            slotMenuImagesReady();
+            return;
         }
+        // The scene can only be rendered in the GUI thread, the png encoding is done in the background
+        QImage selected;
+        QImage highlighted;
+        m_pageMenu->renderButtonImages(selected, highlighted, false);
+        QList<QImage> menuImages;
+        menuImages << selected << highlighted << m_pageMenu->renderBackgroundImage();
+        QStringList paths;
+        paths << cache.absoluteFilePath(QStringLiteral("selected.png")) << cache.absoluteFilePath(QStringLiteral("highlighted.png")) << cache.absoluteFilePath(QStringLiteral("background.png"));
+        m_menuImagesWatcher.setFuture(QtConcurrent::run(saveMenuImages, menuImages, paths));
     }
-    else processDvdauthor();
+    else startDvdauthor();
+}
+
+void DvdWizard::slotMenuImagesReady()
+{
+    QListWidgetItem *images =  m_status.job_progress->item(0);
+    QDir cache(m_menuCacheFolder);
+    if (!copyMenuFile(cache.absoluteFilePath(QStringLiteral("selected.png")), m_selectedImage.fileName())
+        || !copyMenuFile(cache.absoluteFilePath(QStringLiteral("highlighted.png")), m_highlightedImage.fileName())
+        || !copyMenuFile(cache.absoluteFilePath(QStringLiteral("background.png")), m_menuImageBackground.fileName())) {
+        // Do not leave a broken entry behind
+        cache.removeRecursively();
+        images->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
+        errorMessage(i18n("Cannot write to temporary directory %1", m_status.tmp_folder->url().path()));
+        m_status.button_start->setEnabled(true);
+        m_status.button_abort->setEnabled(false);
+        return;
+    }
+    images->setIcon(QIcon::fromTheme(QStringLiteral("dialog-ok")));
+    if (cache.exists(QStringLiteral("menu.vob"))) {
+        // The menu vob only depends on the background image and the menu movie, both unchanged
+        m_vobitem = m_status.job_progress->item(1);
+        m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-ok")));
+        processSpumux();
+        return;
+    }
+    connect(&m_menuJob, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotProcessMenuStatus(int,QProcess::ExitStatus)), Qt::UniqueConnection);
+    ////qDebug() << "/// STARTING MLT VOB CREATION: "<<m_selectedImage.fileName()<<m_menuImageBackground.fileName();
+    if (!m_pageMenu->menuMovie()) {
+        // create menu vob file
+        m_vobitem =  m_status.job_progress->item(1);
+        m_status.job_progress->setCurrentRow(1);
+        m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("system-run")));
+
+        QStringList args;
+        args << QStringLiteral("-profile") << m_pageVob->dvdProfile();
+        args.append(m_menuImageBackground.fileName());
+        args.append(QStringLiteral("in=0"));
+        args.append(QStringLiteral("out=100"));
+        args << QStringLiteral("-consumer") << "avformat:" + m_menuVideo.fileName()<<QStringLiteral("properties=DVD");
+        m_menuJob.start(KdenliveSettings::rendererpath(), args);
+    } else {
+        // Movie as menu background, do the compositing
+        m_vobitem =  m_status.job_progress->item(1);
+        m_status.job_progress->setCurrentRow(1);
+        m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("system-run")));
+
+        int menuLength = m_pageMenu->menuMovieLength();
+        if (menuLength == -1) {
+            // menu movie is invalid
+            errorMessage(i18n("Menu movie is invalid"));
+            m_status.button_start->setEnabled(true);
+            m_status.button_abort->setEnabled(false);
+            return;
+        }
+        QStringList args;
+        args.append(QStringLiteral("-profile"));
+        args.append(m_pageVob->dvdProfile());
+        args.append(m_pageMenu->menuMoviePath());
+        args << QStringLiteral("-track") << m_menuImageBackground.fileName();
+        args << "out=" + QString::number(menuLength);
+        args << QStringLiteral("-transition") << QStringLiteral("composite") << QStringLiteral("always_active=1");
+        args << QStringLiteral("-consumer") << "avformat:" + m_menuFinalVideo.fileName()<<QStringLiteral("properties=DVD");
+        m_menuJob.start(KdenliveSettings::rendererpath(), args);
+        ////qDebug()<<"// STARTING MENU JOB, image: "<<m_menuImageBackground.fileName()<<"\n-------------";
+    }
+}
+
+QString DvdWizard::menuCacheFolder() const
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/dvdmenus"));
+    const QString key = QString::fromLatin1(QCryptographicHash::hash((m_pageMenu->menuCacheKey() + m_pageVob->dvdProfile()).toUtf8(), QCryptographicHash::Md5).toHex());
+    if (!dir.exists(key)) {
+        // Only keep the most recent configurations, motion menus can be large
+        QFileInfoList entries = dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time);
+        for (int i = MAX_CACHED_MENUS - 1; i < entries.count(); ++i) {
+            QDir(entries.at(i).absoluteFilePath()).removeRecursively();
+        }
+        dir.mkpath(key);
+    }
+    return dir.absoluteFilePath(key);
+}
+
+QString DvdWizard::menuVideoFile() const
+{
+    const QString cached = QDir(m_menuCacheFolder).absoluteFilePath(QStringLiteral("menu.vob"));
+    if (QFile::exists(cached)) return cached;
+    if (m_pageMenu->menuMovie()) return m_menuFinalVideo.fileName();
+    return m_menuVideo.fileName();
 }
 
 void DvdWizard::processSpumux()
@@ -354,131 +468,161 @@ void DvdWizard::processSpumux()
     args << QStringLiteral("-s") << QStringLiteral("0") << m_menuFile.fileName();
     ////qDebug() << "SPM ARGS: " << args << m_menuVideo.fileName() << m_menuVobFile.fileName();
 
-    QProcess spumux;
-    QString menuMovieUrl;
+    if (m_spumux) {
+        m_spumux->blockSignals(true);
+        m_spumux->close();
+        delete m_spumux;
+    }
+    m_spumux = new QProcess(this);
+    m_spumuxPass = 0;
+    m_menuButtons = buttons;
+    m_buttonsTarget = buttonsTarget;
 
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert(QStringLiteral("VIDEO_FORMAT"), m_pageVob->dvdFormat() == PAL || m_pageVob->dvdFormat() == PAL_WIDE ? "PAL" : "NTSC");
-    spumux.setProcessEnvironment(env);
-    
-    if (m_pageMenu->menuMovie()) spumux.setStandardInputFile(m_menuFinalVideo.fileName());
-    else spumux.setStandardInputFile(m_menuVideo.fileName());
-    spumux.setStandardOutputFile(m_menuVobFile.fileName());
-    spumux.start(QStringLiteral("spumux"), args);
-    if (spumux.waitForFinished()) {
-        m_status.error_log->append(spumux.readAllStandardError());
-        if (spumux.exitStatus() == QProcess::CrashExit) {
-            //TODO: inform user via messagewidget after string freeze
-            QByteArray result = spumux.readAllStandardError();
-            spuitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
-            m_status.error_log->append(result);
-            m_status.error_box->setHidden(false);
-            m_status.menu_file->setPlainText(m_menuFile.readAll());
-            m_status.dvd_file->setPlainText(m_authorFile.readAll());
-            m_status.button_start->setEnabled(true);
-            //qDebug() << "/// RENDERING SPUMUX MENU crashed";
-            return;
-        }
-    } else {
-        //qDebug() << "/// RENDERING SPUMUX MENU timed out";
-        errorMessage(i18n("Rendering job timed out"));
+    m_spumux->setProcessEnvironment(env);
+    connect(m_spumux, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(slotSpumuxFinished(int,QProcess::ExitStatus)));
+    connect(m_spumux, SIGNAL(error(QProcess::ProcessError)), this, SLOT(slotSpumuxError(QProcess::ProcessError)));
+
+    m_spumux->setStandardInputFile(menuVideoFile());
+    m_spumux->setStandardOutputFile(m_menuVobFile.fileName());
+    m_spumux->start(QStringLiteral("spumux"), args);
+    m_status.button_abort->setEnabled(true);
+}
+
+void DvdWizard::processLetterboxSpumux()
+{
+    // Second step processing for 16:9 DVD, add letterbox stream
+    QDir cache(m_menuCacheFolder);
+    const QString selectedPath = cache.absoluteFilePath(QStringLiteral("selected_letterbox.png"));
+    const QString highlightedPath = cache.absoluteFilePath(QStringLiteral("highlighted_letterbox.png"));
+    if (!QFile::exists(selectedPath) || !QFile::exists(highlightedPath)) {
+        QImage selected;
+        QImage highlighted;
+        m_pageMenu->renderButtonImages(selected, highlighted, true);
+        saveMenuImages(QList<QImage>() << selected << highlighted, QStringList() << selectedPath << highlightedPath);
+    }
+    copyMenuFile(selectedPath, m_selectedLetterImage.fileName());
+    copyMenuFile(highlightedPath, m_highlightedLetterImage.fileName());
+    QMap <QString, QRect> buttons = m_pageMenu->buttonsInfo(true);
+    m_menuButtons = buttons;
+
+    QDomDocument docLetter;
+    QDomElement subLetter = docLetter.createElement(QStringLiteral("subpictures"));
+    docLetter.appendChild(subLetter);
+    QDomElement streamLetter = docLetter.createElement(QStringLiteral("stream"));
+    subLetter.appendChild(streamLetter);
+    QDomElement spuLetter = docLetter.createElement(QStringLiteral("spu"));
+    streamLetter.appendChild(spuLetter);
+    spuLetter.setAttribute(QStringLiteral("force"), QStringLiteral("yes"));
+    spuLetter.setAttribute(QStringLiteral("start"), QStringLiteral("00:00:00.00"));
+    spuLetter.setAttribute(QStringLiteral("select"), m_selectedLetterImage.fileName());
+    spuLetter.setAttribute(QStringLiteral("highlight"), m_highlightedLetterImage.fileName());
+
+    int max = buttons.count() - 1;
+    int i = 0;
+    QMapIterator<QString, QRect> it2(buttons);
+    while (it2.hasNext()) {
+        it2.next();
+        QDomElement but = docLetter.createElement(QStringLiteral("button"));
+        but.setAttribute(QStringLiteral("name"), 'b' + QString::number(i));
+        if (i < max) but.setAttribute(QStringLiteral("down"), 'b' + QString::number(i + 1));
+        else but.setAttribute(QStringLiteral("down"), QStringLiteral("b0"));
+        if (i > 0) but.setAttribute(QStringLiteral("up"), 'b' + QString::number(i - 1));
+        else but.setAttribute(QStringLiteral("up"), 'b' + QString::number(max));
+        QRect r = it2.value();
+        // We need to make sure that the y coordinate is a multiple of 2, otherwise button may not be displayed
+        m_buttonsTarget.append(it2.key());
+        int y0 = r.y();
+        if (y0 % 2 == 1) y0++;
+        int y1 = r.bottom();
+        if (y1 % 2 == 1) y1--;
+        but.setAttribute(QStringLiteral("x0"), QString::number(r.x()));
+        but.setAttribute(QStringLiteral("y0"), QString::number(y0));
+        but.setAttribute(QStringLiteral("x1"), QString::number(r.right()));
+        but.setAttribute(QStringLiteral("y1"), QString::number(y1));
+        spuLetter.appendChild(but);
+        ++i;
+    }
+
+    ////qDebug() << " SPUMUX DATA: " << doc.toString();
+
+    QFile data(m_menuFile.fileName());
+    if (data.open(QFile::WriteOnly)) {
+        data.write(docLetter.toString().toUtf8());
+    }
+    data.close();
+    m_spumuxPass = 1;
+    m_spumux->setStandardInputFile(m_menuVobFile.fileName());
+    m_spumux->setStandardOutputFile(m_letterboxMovie.fileName());
+    QStringList args;
+    args << QStringLiteral("-s") << QStringLiteral("1") << m_menuFile.fileName();
+    m_spumux->start(QStringLiteral("spumux"), args);
+    ////qDebug() << "SPM ARGS LETTERBOX: " << args << m_menuVideo.fileName() << m_letterboxMovie.fileName();
+}
+
+void DvdWizard::slotSpumuxFinished(int, QProcess::ExitStatus status)
+{
+    QListWidgetItem *spuitem =  m_status.job_progress->item(2);
+    m_status.error_log->append(m_spumux->readAllStandardError());
+    if (status == QProcess::CrashExit) {
+        //TODO: inform user via messagewidget after string freeze
+        QByteArray result = m_spumux->readAllStandardError();
         spuitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
-        m_status.error_log->append("<a name=\"result\" /><br /><strong>" + i18n("Menu job timed out"));
-        m_status.error_log->scrollToAnchor(QStringLiteral("result"));
+        m_status.error_log->append(result);
         m_status.error_box->setHidden(false);
         m_status.menu_file->setPlainText(m_menuFile.readAll());
         m_status.dvd_file->setPlainText(m_authorFile.readAll());
         m_status.button_start->setEnabled(true);
+        m_status.button_abort->setEnabled(false);
+        //qDebug() << "/// RENDERING SPUMUX MENU crashed";
         return;
     }
-    if (m_pageVob->dvdFormat() == PAL_WIDE || m_pageVob->dvdFormat() == NTSC_WIDE) {
-        // Second step processing for 16:9 DVD, add letterbox stream
-        m_pageMenu->createButtonImages(m_selectedLetterImage.fileName(), m_highlightedLetterImage.fileName(), true);
-        buttons = m_pageMenu->buttonsInfo(true);
-
-        QDomDocument docLetter;
-        QDomElement subLetter = docLetter.createElement(QStringLiteral("subpictures"));
-        docLetter.appendChild(subLetter);
-        QDomElement streamLetter = docLetter.createElement(QStringLiteral("stream"));
-        subLetter.appendChild(streamLetter);
-        QDomElement spuLetter = docLetter.createElement(QStringLiteral("spu"));
-        streamLetter.appendChild(spuLetter);
-        spuLetter.setAttribute(QStringLiteral("force"), QStringLiteral("yes"));
-        spuLetter.setAttribute(QStringLiteral("start"), QStringLiteral("00:00:00.00"));
-        spuLetter.setAttribute(QStringLiteral("select"), m_selectedLetterImage.fileName());
-        spuLetter.setAttribute(QStringLiteral("highlight"), m_highlightedLetterImage.fileName());
-
-        max = buttons.count() - 1;
-        i = 0;
-        QMapIterator<QString, QRect> it2(buttons);
-        while (it2.hasNext()) {
-            it2.next();
-            QDomElement but = docLetter.createElement(QStringLiteral("button"));
-            but.setAttribute(QStringLiteral("name"), 'b' + QString::number(i));
-            if (i < max) but.setAttribute(QStringLiteral("down"), 'b' + QString::number(i + 1));
-            else but.setAttribute(QStringLiteral("down"), QStringLiteral("b0"));
-            if (i > 0) but.setAttribute(QStringLiteral("up"), 'b' + QString::number(i - 1));
-            else but.setAttribute(QStringLiteral("up"), 'b' + QString::number(max));
-            QRect r = it2.value();
-            // We need to make sure that the y coordinate is a multiple of 2, otherwise button may not be displayed
-            buttonsTarget.append(it2.key());
-            int y0 = r.y();
-            if (y0 % 2 == 1) y0++;
-            int y1 = r.bottom();
-            if (y1 % 2 == 1) y1--;
-            but.setAttribute(QStringLiteral("x0"), QString::number(r.x()));
-            but.setAttribute(QStringLiteral("y0"), QString::number(y0));
-            but.setAttribute(QStringLiteral("x1"), QString::number(r.right()));
-            but.setAttribute(QStringLiteral("y1"), QString::number(y1));
-            spuLetter.appendChild(but);
-            ++i;
-        }
-
-        ////qDebug() << " SPUMUX DATA: " << doc.toString();
-
-        if (data.open(QFile::WriteOnly)) {
-            data.write(docLetter.toString().toUtf8());
-        }
-        data.close();
-        spumux.setStandardInputFile(m_menuVobFile.fileName());
-        spumux.setStandardOutputFile(m_letterboxMovie.fileName());
-        args.clear();
-        args << QStringLiteral("-s") << QStringLiteral("1") << m_menuFile.fileName();
-        spumux.start(QStringLiteral("spumux"), args);
-        ////qDebug() << "SPM ARGS LETTERBOX: " << args << m_menuVideo.fileName() << m_letterboxMovie.fileName();
-        if (spumux.waitForFinished()) {
-            m_status.error_log->append(spumux.readAllStandardError());
-            if (spumux.exitStatus() == QProcess::CrashExit) {
-                //TODO: inform user via messagewidget after string freeze
-                QByteArray result = spumux.readAllStandardError();
-                spuitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
-                m_status.error_log->append(result);
-                m_status.error_box->setHidden(false);
-                m_status.menu_file->setPlainText(m_menuFile.readAll());
-                m_status.dvd_file->setPlainText(m_authorFile.readAll());
-                m_status.button_start->setEnabled(true);
-                //qDebug() << "/// RENDERING SPUMUX MENU crashed";
-                return;
-            }
-        } else {
-            //qDebug() << "/// RENDERING SPUMUX MENU timed out";
-            errorMessage(i18n("Rendering job timed out"));
-            spuitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
-            m_status.error_log->append("<a name=\"result\" /><br /><strong>" + i18n("Menu job timed out"));
-            m_status.error_log->scrollToAnchor(QStringLiteral("result"));
-            m_status.error_box->setHidden(false);
-            m_status.menu_file->setPlainText(m_menuFile.readAll());
-            m_status.dvd_file->setPlainText(m_authorFile.readAll());
-            m_status.button_start->setEnabled(true);
-            return;
-        }
-        menuMovieUrl = m_letterboxMovie.fileName();
+    if (m_spumuxPass == 0 && (m_pageVob->dvdFormat() == PAL_WIDE || m_pageVob->dvdFormat() == NTSC_WIDE)) {
+        processLetterboxSpumux();
+        return;
     }
-    else menuMovieUrl = m_menuVobFile.fileName();
+    if (m_spumuxPass == 1) m_menuMovieUrl = m_letterboxMovie.fileName();
+    else m_menuMovieUrl = m_menuVobFile.fileName();
 
     spuitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-ok")));
     //qDebug() << "/// DONE: " << menuMovieUrl;
-    processDvdauthor(menuMovieUrl, buttons, buttonsTarget);
+    startDvdauthor();
+}
+
+void DvdWizard::slotSpumuxError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart) return;
+    //qDebug() << "/// RENDERING SPUMUX MENU failed to start";
+    errorMessage(i18n("Cannot start spumux"));
+    m_status.job_progress->item(2)->setIcon(QIcon::fromTheme(QStringLiteral("dialog-close")));
+    m_status.error_box->setHidden(false);
+    m_status.menu_file->setPlainText(m_menuFile.readAll());
+    m_status.dvd_file->setPlainText(m_authorFile.readAll());
+    m_status.button_start->setEnabled(true);
+    m_status.button_abort->setEnabled(false);
+}
+
+void DvdWizard::startDvdauthor()
+{
+    if (m_pageVob->isTranscoding()) {
+        // The menu is ready before the movies, dvdauthor starts when the last transcoding job is done
+        m_authorPending = true;
+        m_status.job_progress->setCurrentRow(3);
+        m_status.job_progress->item(3)->setIcon(QIcon::fromTheme(QStringLiteral("chronometer")));
+        infoMessage(i18n("Waiting for transcoding jobs to finish"));
+        m_status.button_abort->setEnabled(true);
+        return;
+    }
+    processDvdauthor(m_menuMovieUrl, m_menuButtons, m_buttonsTarget);
+}
+
+void DvdWizard::slotTranscodingFinished()
+{
+    if (!m_authorPending) return;
+    m_authorPending = false;
+    m_isoMessage->animatedHide();
+    processDvdauthor(m_menuMovieUrl, m_menuButtons, m_buttonsTarget);
 }
 
 void DvdWizard::processDvdauthor(const QString &menuMovieUrl, const QMap <QString, QRect> &buttons, const QStringList &buttonsTarget)
@@ -668,7 +812,7 @@ void DvdWizard::processDvdauthor(const QString &menuMovieUrl, const QMap <QStrin
     button(QWizard::FinishButton)->setEnabled(false);
 }
 
-void DvdWizard::slotProcessMenuStatus(int, QProcess::ExitStatus status)
+void DvdWizard::slotProcessMenuStatus(int exitCode, QProcess::ExitStatus status)
 {
     if (status == QProcess::CrashExit) {
         //qDebug() << "/// RENDERING MENU vob crashed";
@@ -682,6 +826,15 @@ void DvdWizard::slotProcessMenuStatus(int, QProcess::ExitStatus status)
         return;
     }
     if (m_vobitem) m_vobitem->setIcon(QIcon::fromTheme(QStringLiteral("dialog-ok")));
+    if (exitCode == 0) {
+        // Keep the menu vob for the next run with the same menu
+        const QString cached = QDir(m_menuCacheFolder).absoluteFilePath(QStringLiteral("menu.vob"));
+        const QString partial = cached + QStringLiteral(".part");
+        QFile::remove(partial);
+        if (QFile::copy(menuVideoFile(), partial) && !QFile::rename(partial, cached)) {
+            QFile::remove(partial);
+        }
+    }
     processSpumux();
 }
 
@@ -881,7 +1034,7 @@ void DvdWizard::slotBurn()
 void DvdWizard::slotGenerate()
 {
     // clear job icons
-    if ((m_dvdauthor && m_dvdauthor->state() != QProcess::NotRunning) || (m_mkiso && m_mkiso->state() != QProcess::NotRunning)) return;
+    if (m_authorPending || m_menuImagesWatcher.isRunning() || m_menuJob.state() != QProcess::NotRunning || (m_spumux && m_spumux->state() != QProcess::NotRunning) || (m_dvdauthor && m_dvdauthor->state() != QProcess::NotRunning) || (m_mkiso && m_mkiso->state() != QProcess::NotRunning)) return;
     for (int i = 0; i < m_status.job_progress->count(); ++i)
         m_status.job_progress->item(i)->setIcon(QIcon());
     QString warnMessage;
@@ -903,7 +1056,16 @@ void DvdWizard::slotGenerate()
 void DvdWizard::slotAbort()
 {
     // clear job icons
-    if (m_dvdauthor && m_dvdauthor->state() != QProcess::NotRunning) m_dvdauthor->terminate();
+    if (m_authorPending) {
+        // Stop waiting for the transcoding jobs
+        m_authorPending = false;
+        m_isoMessage->animatedHide();
+        m_status.job_progress->item(3)->setIcon(QIcon());
+        m_status.button_start->setEnabled(true);
+        m_status.button_abort->setEnabled(false);
+    }
+    else if (m_spumux && m_spumux->state() != QProcess::NotRunning) m_spumux->terminate();
+    else if (m_dvdauthor && m_dvdauthor->state() != QProcess::NotRunning) m_dvdauthor->terminate();
     else if (m_mkiso && m_mkiso->state() != QProcess::NotRunning) m_mkiso->terminate();
 }
 
@@ -32,6 +32,7 @@
 
 #include <QDebug>
 #include <QTemporaryFile>
+#include <QFutureWatcher>
 
 typedef QMap <QString, QRect> stringRectMap;
 
@@ -56,6 +57,14 @@ private:
     QTemporaryFile m_letterboxMovie;
     QProcess *m_dvdauthor;
     QProcess *m_mkiso;
+    QProcess *m_spumux;
+    /** @brief Spumux pass being run: 0 for the main subtitle stream, 1 for the letterbox one */
+    int m_spumuxPass;
+    /** @brief True when the menu is ready and dvdauthor waits for the transcoding jobs */
+    bool m_authorPending;
+    QString m_menuMovieUrl;
+    stringRectMap m_menuButtons;
+    QStringList m_buttonsTarget;
     QProcess m_menuJob;
     QString m_creationLog;
     QListWidgetItem *m_vobitem;
@@ -66,11 +75,22 @@ private:
     QTemporaryFile m_menuVideo;
     QTemporaryFile m_menuFinalVideo;
     QTemporaryFile m_menuImageBackground;
+    /** @brief Cache folder holding the rendered assets of the current menu configuration */
+    QString m_menuCacheFolder;
+    /** @brief Saves the rendered menu images to the cache folder in a background thread */
+    QFutureWatcher<bool> m_menuImagesWatcher;
     QMenu *m_burnMenu;
     int m_previousPage;
     void cleanup();
     void errorMessage(const QString &text);
     void infoMessage(const QString &text);
+    void processLetterboxSpumux();
+    /** @brief Returns the folder caching the assets for the current menu configuration, dropping the oldest ones */
+    QString menuCacheFolder() const;
+    /** @brief Returns the menu vob file spumux should read, reusing the cached one when available */
+    QString menuVideoFile() const;
+    /** @brief Starts dvdauthor, or defers it until the running transcoding jobs are done */
+    void startDvdauthor();
     void processDvdauthor(const QString &menuMovieUrl = QString(), const stringRectMap &buttons = stringRectMap(), const QStringList &buttonsTarget = QStringList());
 
 private slots:
@@ -87,6 +107,11 @@ private slots:
     void slotShowRenderInfo();
     void slotShowIsoInfo();
     void slotProcessMenuStatus(int, QProcess::ExitStatus status);
+    /** @brief The menu images are in the cache, copy them and render the menu vob if needed */
+    void slotMenuImagesReady();
+    void slotSpumuxFinished(int, QProcess::ExitStatus status);
+    void slotSpumuxError(QProcess::ProcessError error);
+    void slotTranscodingFinished();
 };
 
 #endif
@@ -26,6 +26,10 @@
 #include <KColorScheme>
 #include "klocalizedstring.h"
 #include <QGraphicsDropShadowEffect>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
 
 
 #include "doc/kthumb.h"
@@ -587,7 +591,7 @@ void DvdWizardMenu::updateColor(const QColor &c)
 }
 
 
-void DvdWizardMenu::createButtonImages(const QString &selected_image, const QString &highlighted_image, bool letterbox)
+void DvdWizardMenu::renderButtonImages(QImage &selected, QImage &highlighted, bool letterbox)
 {
     if (m_view.create_menu->isChecked()) {
         m_scene->clearSelection();
@@ -616,7 +620,7 @@ void DvdWizardMenu::createButtonImages(const QString &selected_image, const QStr
         p.end();
         img.setColor(0, m_view.highlighted_color->color().rgb());
         img.setColor(1, qRgba(0,0,0,0));
-        img.save(highlighted_image);
+        highlighted = img.copy();
         img.fill(Qt::transparent);
         updateUnderlineColor(m_view.selected_color->color());
 
@@ -627,7 +631,7 @@ void DvdWizardMenu::createButtonImages(const QString &selected_image, const QStr
         p.end();
         img.setColor(0, m_view.selected_color->color().rgb());
         img.setColor(1, qRgba(0,0,0,0));
-        img.save(selected_image);
+        selected = img;
         resetUnderLines();
         m_scene->addItem(m_safeRect);
         m_scene->addItem(m_color);
@@ -636,27 +640,13 @@ void DvdWizardMenu::createButtonImages(const QString &selected_image, const QStr
 }
 
 
-void DvdWizardMenu::createBackgroundImage(const QString &img1, bool letterbox)
+QImage DvdWizardMenu::renderBackgroundImage()
 {
-    Q_UNUSED(letterbox)
-
     m_scene->clearSelection();
     if (m_safeRect->scene() != 0) m_scene->removeItem(m_safeRect);
     bool showBg = false;
     QImage img(m_width, m_height, QImage::Format_ARGB32);
 
-    //TODO: Should the image be scaled when letterboxing?
-    /*
-    QRectF source(0, 0, m_width, m_height);
-    QRectF target;
-    if (!letterbox) target = QRectF(0, 0, m_finalSize.width(), m_finalSize.height());
-    else {
-    // Scale the button images to fit a letterbox image
-    double factor = (double) m_width / m_finalSize.width();
-    int letterboxHeight = m_height / factor;
-    target = QRectF(0, (m_finalSize.height() - letterboxHeight) / 2, m_finalSize.width(), letterboxHeight);
-    }*/
-
     if (menuMovie()) {
         showBg = true;
         if (m_background->scene() != 0) m_scene->removeItem(m_background);
@@ -668,14 +658,28 @@ void DvdWizardMenu::createBackgroundImage(const QString &img1, bool letterbox)
     p.setRenderHints(QPainter::Antialiasing, true);
     p.setRenderHints(QPainter::TextAntialiasing, true);
     m_scene->render(&p, QRectF(0, 0, img.width(), img.height()));
-    //m_scene->render(&p, target, source, Qt::IgnoreAspectRatio);
     p.end();
-    img.save(img1);
     m_scene->addItem(m_safeRect);
     if (showBg) {
         m_scene->addItem(m_background);
         m_scene->addItem(m_color);
     }
+    return img;
+}
+
+QString DvdWizardMenu::menuCacheKey() const
+{
+    QString data;
+    QTextStream stream(&data);
+    toXml().save(stream, 0);
+    stream << m_width << 'x' << m_height << ':' << m_finalSize.width() << 'x' << m_finalSize.height();
+    if (menuMovie() || m_view.background_list->currentIndex() == 1) {
+        // The background file may be replaced on disk under the same name
+        QFileInfo info(m_view.background_image->url().path());
+        stream << ':' << info.size() << ':' << info.lastModified().toMSecsSinceEpoch();
+    }
+    stream.flush();
+    return QString::fromLatin1(QCryptographicHash::hash(data.toUtf8(), QCryptographicHash::Md5).toHex());
 }
 
 bool DvdWizardMenu::createMenu() const
@@ -91,8 +91,12 @@ public:
     explicit DvdWizardMenu(DVDFORMAT format, QWidget * parent = 0);
     virtual ~DvdWizardMenu();
     bool createMenu() const;
-    void createBackgroundImage(const QString &img1, bool letterbox);
-    void createButtonImages(const QString &selected_image, const QString &highlighted_image, bool letterbox);
+    /** @brief Renders the menu background (color or image, buttons and their text), transparent for motion menus. */
+    QImage renderBackgroundImage();
+    /** @brief Renders the spumux selected and highlighted button masks. */
+    void renderButtonImages(QImage &selected, QImage &highlighted, bool letterbox);
+    /** @brief Returns a key identifying the rendered menu assets, changing whenever the menu layout, profile or motion background does. */
+    QString menuCacheKey() const;
     void setTargets(const QStringList &list, const QStringList &targetlist);
     QMap <QString, QRect> buttonsInfo(bool letterbox = false);
     bool loopMovie() const;
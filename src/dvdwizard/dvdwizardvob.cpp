@@ -41,6 +41,10 @@
 #include <unistd.h>
 #include <QStandardPaths>
 #include <QProgressBar>
+#include <QThread>
+
+// Maximum number of ffmpeg processes transcoding DVD sources at the same time
+#define MAX_TRANSCODE_JOBS qMax(1, QThread::idealThreadCount() / 2)
 
 DvdTreeWidget::DvdTreeWidget(QWidget *parent) :
     QTreeWidget(parent)
@@ -74,7 +78,8 @@ void DvdTreeWidget::dropEvent(QDropEvent * event ) {
 DvdWizardVob::DvdWizardVob(QWidget *parent) :
     QWizardPage(parent)
     , m_installCheck(true)
-    , m_duration(0)
+    , m_transcodeCount(0)
+    , m_transcodeDone(0)
 {
     m_view.setupUi(this);
     m_view.button_add->setIcon(QIcon::fromTheme(QStringLiteral("list-add")));
@@ -141,21 +146,13 @@ DvdWizardVob::DvdWizardVob(QWidget *parent) :
     }
     m_view.button_transcode->setHidden(true);
     slotCheckVobList();
-
-    m_transcodeProcess.setProcessChannelMode(QProcess::MergedChannels);
-    connect(&m_transcodeProcess, &QProcess::readyReadStandardOutput, this, &DvdWizardVob::slotShowTranscodeInfo);
-    connect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &DvdWizardVob::slotTranscodeFinished);
 }
 
 DvdWizardVob::~DvdWizardVob()
 {
     delete m_capacityBar;
     // Abort running transcoding
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        disconnect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &DvdWizardVob::slotTranscodeFinished);
-        m_transcodeProcess.close();
-        m_transcodeProcess.waitForFinished();
-    }
+    abortTranscoding();
 }
 
 bool DvdWizardVob::isComplete() const
@@ -163,71 +160,106 @@ bool DvdWizardVob::isComplete() const
     return m_vobList->topLevelItemCount() > 0;
 }
 
+bool DvdWizardVob::isTranscoding() const
+{
+    return !m_transcodeJobs.isEmpty() || !m_transcodeQueue.isEmpty();
+}
+
 void DvdWizardVob::slotShowTranscodeInfo()
 {
-    QString log = QString(m_transcodeProcess.readAll());
-    if (m_duration == 0) {
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (!process || !m_transcodeJobs.contains(process)) return;
+    TranscodeJobInfo &job = m_transcodeJobs[process];
+    QString log = QString(process->readAll());
+    if (job.duration == 0) {
         if (log.contains(QStringLiteral("Duration:"))) {
             QString data = log.section(QStringLiteral("Duration:"), 1, 1).section(',', 0, 0).simplified();
             QStringList numbers = data.split(':');
             if (numbers.size() < 3) return;
-            m_duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
-            //log_text->setHidden(true);
-            //job_progress->setHidden(false);
-        }
-        else {
-            //log_text->setHidden(false);
-            //job_progress->setHidden(true);
+            job.duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
         }
     }
     else if (log.contains(QStringLiteral("time="))) {
-        int progress;
+        double progress;
         QString time = log.section(QStringLiteral("time="), 1, 1).simplified().section(' ', 0, 0);
         if (time.contains(':')) {
             QStringList numbers = time.split(':');
             if (numbers.size() < 3) return;
             progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
         }
-        else progress = (int) time.toDouble();
-        m_view.convert_progress->setValue((int) (100.0 * progress / m_duration));
+        else progress = time.toDouble();
+        job.progress = qBound(0, (int) (100.0 * progress / job.duration), 100);
+        updateTranscodeProgress();
     }
-    //log_text->setPlainText(log);
 }
 
-void DvdWizardVob::slotAbortTranscode()
+void DvdWizardVob::updateTranscodeProgress()
 {
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        m_transcodeProcess.close();
-        m_transcodeProcess.waitForFinished();
+    if (m_transcodeCount == 0) return;
+    int progress = 100 * m_transcodeDone;
+    QStringList names;
+    QMapIterator<QProcess *, TranscodeJobInfo> i(m_transcodeJobs);
+    while (i.hasNext()) {
+        i.next();
+        progress += i.value().progress;
+        names << QUrl::fromLocalFile(i.value().filename).fileName();
     }
+    m_view.convert_progress->setValue(progress / m_transcodeCount);
+    if (!names.isEmpty()) {
+        m_view.convert_label->setText(i18n("Transcoding: %1", names.join(QStringLiteral(", "))));
+    }
+}
+
+void DvdWizardVob::abortTranscoding()
+{
     m_transcodeQueue.clear();
+    QList <QProcess *> processes = m_transcodeJobs.keys();
+    m_transcodeJobs.clear();
+    foreach(QProcess *process, processes) {
+        process->disconnect(this);
+        process->close();
+        process->waitForFinished();
+        delete process;
+    }
+}
+
+void DvdWizardVob::slotAbortTranscode()
+{
+    abortTranscoding();
     m_view.convert_box->hide();
     slotCheckProfiles();
+    emit transcodingFinished();
 }
 
 void DvdWizardVob::slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
-        slotTranscodedClip(m_currentTranscoding.filename, m_currentTranscoding.filename + m_currentTranscoding.params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0));
-        if (!m_transcodeQueue.isEmpty()) {
-            m_transcodeProcess.close();
-            processTranscoding();
-            return;
-        }
+    finishTranscodeJob(qobject_cast<QProcess *>(sender()), exitCode == 0 && exitStatus == QProcess::NormalExit);
+}
+
+void DvdWizardVob::finishTranscodeJob(QProcess *process, bool success)
+{
+    if (!process || !m_transcodeJobs.contains(process)) return;
+    TranscodeJobInfo job = m_transcodeJobs.take(process);
+    process->deleteLater();
+    if (success) {
+        m_transcodeDone++;
+        slotTranscodedClip(job.filename, job.filename + job.params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0));
+        processTranscoding();
+        updateTranscodeProgress();
     }
     else {
-        // Something failed
+        // Something failed, stop the other jobs too
       //TODO show log
         m_warnMessage->setMessageType(KMessageWidget::Warning);
         m_warnMessage->setText(i18n("Transcoding failed!"));
         m_warnMessage->animatedShow();
-        m_transcodeQueue.clear();
+        abortTranscoding();
     }
-    m_duration = 0;
-    m_transcodeProcess.close();
-    if (m_transcodeQueue.isEmpty()) {
+    if (!isTranscoding()) {
+        m_transcodeCount = 0;
         m_view.convert_box->setHidden(true);
         slotCheckProfiles();
+        emit transcodingFinished();
     }
 }
 
@@ -624,9 +656,9 @@ void DvdWizardVob::slotTranscodeFiles()
         finalSize = QSize(720, 576);
     }
     QString params = transConfig.readEntry(profileEasyName);
-    m_transcodeQueue.clear();
+    abortTranscoding();
     m_view.convert_progress->setValue(0);
-    m_duration = 0;
+    m_transcodeDone = 0;
     // Transcode files that do not match selected profile
     int max = m_vobList->topLevelItemCount();
     int format = m_view.dvd_profile->currentIndex();
@@ -656,50 +688,63 @@ void DvdWizardVob::slotTranscodeFiles()
             jobInfo.filename = item->text(0);
             jobInfo.params = params.section(';', 0, 0);
             jobInfo.postParams = postParams;
+            jobInfo.duration = 0;
+            jobInfo.progress = 0;
+            // Ask about existing files now, the jobs run in parallel afterwards
+            QString extension = jobInfo.params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0);
+            if (QFile::exists(jobInfo.filename + extension)) {
+                if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", jobInfo.filename + extension)) == KMessageBox::No) {
+                    // TODO inform about abortion
+                    m_transcodeQueue.clear();
+                    m_view.convert_box->setVisible(false);
+                    slotCheckProfiles();
+                    return;
+                }
+            }
             m_transcodeQueue << jobInfo;
         }
     }
+    m_transcodeCount = m_transcodeQueue.count();
     processTranscoding();
+    updateTranscodeProgress();
 }
 
 void DvdWizardVob::processTranscoding()
 {
-    if (m_transcodeQueue.isEmpty()) {
-        return;
-    }
-    m_currentTranscoding = m_transcodeQueue.takeFirst();
-    QStringList parameters;
-    QStringList postParams = m_currentTranscoding.postParams;
-    QString params = m_currentTranscoding.params;
-    QString extension = params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0);
-    parameters << QStringLiteral("-i") << m_currentTranscoding.filename;
-    if (QFile::exists(m_currentTranscoding.filename + extension)) {
-        if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", m_currentTranscoding.filename + extension)) == KMessageBox::No) {
-            // TODO inform about abortion
-            m_transcodeQueue.clear();
-            return;
-        }
-        parameters << QStringLiteral("-y");
-    }
-
-    bool replaceVfParams = false;
-    QStringList splitted = params.split(' ');
-    foreach(QString s, splitted) {
-        if (replaceVfParams) {
-            parameters << postParams.at(1);
-            replaceVfParams = false;
-        } else if (s.startsWith(QLatin1String("%1"))) {
-            parameters << s.replace(0, 2, m_currentTranscoding.filename);
-        } else if (!postParams.isEmpty() && s == QLatin1String("-vf")) {
-            replaceVfParams = true;
-            parameters << s;
-        } else {
-            parameters << s;
+    while (!m_transcodeQueue.isEmpty() && m_transcodeJobs.count() < MAX_TRANSCODE_JOBS) {
+        TranscodeJobInfo job = m_transcodeQueue.takeFirst();
+        QStringList parameters;
+        QStringList postParams = job.postParams;
+        QString params = job.params;
+        parameters << QStringLiteral("-i") << job.filename << QStringLiteral("-y");
+
+        bool replaceVfParams = false;
+        QStringList splitted = params.split(' ');
+        foreach(QString s, splitted) {
+            if (replaceVfParams) {
+                parameters << postParams.at(1);
+                replaceVfParams = false;
+            } else if (s.startsWith(QLatin1String("%1"))) {
+                parameters << s.replace(0, 2, job.filename);
+            } else if (!postParams.isEmpty() && s == QLatin1String("-vf")) {
+                replaceVfParams = true;
+                parameters << s;
+            } else {
+                parameters << s;
+            }
         }
+        QProcess *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::MergedChannels);
+        connect(process, &QProcess::readyReadStandardOutput, this, &DvdWizardVob::slotShowTranscodeInfo);
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &DvdWizardVob::slotTranscodeFinished);
+        // finished() is never emitted if ffmpeg cannot be started
+        connect(process, static_cast<void (QProcess::*)(QProcess::ProcessError)>(&QProcess::error), this, [this, process](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) finishTranscodeJob(process, false);
+        });
+        m_transcodeJobs.insert(process, job);
+        qDebug()<<" / / /STARTING TCODE JB: \n"<<KdenliveSettings::ffmpegpath()<<" = "<< parameters;
+        process->start(KdenliveSettings::ffmpegpath(), parameters);
     }
-    qDebug()<<" / / /STARTING TCODE JB: \n"<<KdenliveSettings::ffmpegpath()<<" = "<< parameters;
-    m_transcodeProcess.start(KdenliveSettings::ffmpegpath(), parameters);
-    m_view.convert_label->setText(i18n("Transcoding: %1", QUrl::fromLocalFile(m_currentTranscoding.filename).fileName()));
 }
 
 void DvdWizardVob::slotTranscodedClip(const QString &src, const QString &transcoded)
@@ -783,7 +828,7 @@ void DvdWizardVob::slotTranscodedClip(const QString &src, const QString &transco
             }
             if (producer) delete producer;
             slotCheckVobList();
-            if (m_transcodeQueue.isEmpty()) slotCheckProfiles();
+            if (!isTranscoding()) slotCheckProfiles();
             break;
         }
     }
@@ -41,6 +41,10 @@ struct TranscodeJobInfo {
     QString filename;
     QString params;
     QStringList postParams;
+    /** @brief Source duration in seconds, parsed from ffmpeg's output */
+    double duration;
+    /** @brief Transcoding progress of this job, in percent */
+    int progress;
 };
 
 class DvdTreeWidget : public QTreeWidget
@@ -123,6 +127,8 @@ public:
     void updateChapters(const QMap<QString, QString> &chaptersdata);
     static QString getDvdProfile(DVDFORMAT format);
     bool isComplete() const;
+    /** @brief Returns true while transcoding jobs are queued or running */
+    bool isTranscoding() const;
 
 private:
     Ui::DvdWizardVob_UI m_view;
@@ -131,13 +137,22 @@ private:
     QAction *m_transcodeAction;
     bool m_installCheck;
     KMessageWidget *m_warnMessage;
-    int m_duration;
-    QProcess m_transcodeProcess;
+    /** @brief Running ffmpeg processes and the job each of them is working on */
+    QMap <QProcess *, TranscodeJobInfo> m_transcodeJobs;
     QList <TranscodeJobInfo> m_transcodeQueue;
-    TranscodeJobInfo m_currentTranscoding;
+    /** @brief Number of jobs in the current transcoding batch, and how many of them are done */
+    int m_transcodeCount;
+    int m_transcodeDone;
     void showProfileError();
     void showError(const QString &error);
+    /** @brief Starts queued jobs until the parallel job limit is reached */
     void processTranscoding();
+    /** @brief Removes a finished job, reporting failures and starting the next queued ones */
+    void finishTranscodeJob(QProcess *process, bool success);
+    /** @brief Kills all running transcoding processes */
+    void abortTranscoding();
+    /** @brief Shows the aggregated progress of the current batch */
+    void updateTranscodeProgress();
 
 public slots:
     void slotAddVobFile(QUrl url = QUrl(), const QString &chapters = QString(), bool checkFormats = true);
@@ -154,6 +169,10 @@ private slots:
     void slotShowTranscodeInfo();
     void slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void slotAbortTranscode();
+
+signals:
+    /** @brief All queued transcoding jobs have finished (or were aborted) */
+    void transcodingFinished();
 };
 
 #endif
@@ -22,8 +22,14 @@
 #include <QDebug>
 #include <klocalizedstring.h>
 
+// Approximate memory used by a DOM node or attribute besides its strings
+#define DOM_NODE_COST 64
+// Lists with less effects are searched without lookup tables
+#define LOOKUP_MIN_EFFECTS 16
+
 
 EffectsList::EffectsList(bool indexRequired) : m_useIndex(indexRequired)
+    , m_lookupCount(-1)
 {
     m_baseElement = createElement(QStringLiteral("list"));
     appendChild(m_baseElement);
@@ -57,8 +63,43 @@ QDomElement EffectsList::getEffectByName(const QString & name) const
 }
 
 
+bool EffectsList::updateLookup() const
+{
+    QDomNodeList effects = m_baseElement.childNodes();
+    if (effects.count() < LOOKUP_MIN_EFFECTS) {
+        return false;
+    }
+    if (m_lookupCount == effects.count()) {
+        return true;
+    }
+    m_idLookup.clear();
+    m_tagLookup.clear();
+    // Walk backwards so that the first effect wins
+    for (int i = effects.count() - 1; i >= 0; --i) {
+        QDomElement effect = effects.at(i).toElement();
+        const QString id = effect.attribute(QStringLiteral("id"));
+        if (!id.isEmpty()) {
+            m_idLookup.insert(id, effect);
+        }
+        const QString tag = effect.attribute(QStringLiteral("tag"));
+        if (!tag.isEmpty()) {
+            m_tagLookup.insert(tag, effect);
+        }
+    }
+    m_lookupCount = effects.count();
+    return true;
+}
+
 QDomElement EffectsList::getEffectByTag(const QString & tag, const QString & id) const
 {
+    if (updateLookup()) {
+        QDomElement effect = !id.isEmpty() ? m_idLookup.value(id) : m_tagLookup.value(tag);
+        // The list may have been modified through another copy
+        if (effect.isNull() || (effect.parentNode() == m_baseElement && effect.attribute(id.isEmpty() ? QStringLiteral("tag") : QStringLiteral("id")) == (id.isEmpty() ? tag : id))) {
+            return effect;
+        }
+        m_lookupCount = -1;
+    }
     QDomNodeList effects = m_baseElement.childNodes();
     if (effects.isEmpty()) return QDomElement();
     for (int i = 0; i < effects.count(); ++i) {
@@ -85,6 +126,13 @@ QDomElement EffectsList::getEffectByTag(const QString & tag, const QString & id)
 
 QDomElement EffectsList::effectById(const QString & id) const
 {
+    if (!id.isEmpty() && updateLookup()) {
+        QDomElement effect = m_idLookup.value(id);
+        if (effect.isNull() || (effect.parentNode() == m_baseElement && effect.attribute(QStringLiteral("id")) == id)) {
+            return effect;
+        }
+        m_lookupCount = -1;
+    }
     QDomNodeList effects = m_baseElement.childNodes();
     for (int i = 0; i < effects.count(); ++i) {
         QDomElement effect =  effects.at(i).toElement();
@@ -209,12 +257,22 @@ bool EffectsList::hasKeyFrames(const QDomElement &effect)
 
 void EffectsList::clone(const EffectsList &original)
 {
-    setContent(original.toString());
-    m_baseElement = documentElement();
+    // Importing the nodes shares their strings with the original instead of parsing its xml,
+    // the original may be a copy of this list
+    QList <QDomNode> effects;
+    QDomNodeList originalEffects = original.m_baseElement.childNodes();
+    for (int i = 0; i < originalEffects.count(); ++i) {
+        effects << importNode(originalEffects.at(i), true);
+    }
+    clearList();
+    foreach (const QDomNode &effect, effects) {
+        m_baseElement.appendChild(effect);
+    }
 }
 
 void EffectsList::clearList()
 {
+    m_lookupCount = -1;
     while (!m_baseElement.firstChild().isNull())
         m_baseElement.removeChild(m_baseElement.firstChild());
 }
@@ -321,6 +379,25 @@ void EffectsList::removeProperty(QDomElement effect, const QString &name)
     }
 }
 
+// static
+qint64 EffectsList::memoryCost(const QDomNode &node)
+{
+    qint64 cost = DOM_NODE_COST + 2 * node.nodeName().size();
+    if (node.isElement()) {
+        QDomNamedNodeMap attributes = node.attributes();
+        for (int i = 0; i < attributes.count(); ++i) {
+            QDomNode attribute = attributes.item(i);
+            cost += DOM_NODE_COST + 2 * (attribute.nodeName().size() + attribute.nodeValue().size());
+        }
+    } else {
+        cost += 2 * node.nodeValue().size();
+    }
+    for (QDomNode child = node.firstChild(); !child.isNull(); child = child.nextSibling()) {
+        cost += memoryCost(child);
+    }
+    return cost;
+}
+
 // static
 void EffectsList::removeMetaProperties(QDomElement producer)
 {
@@ -338,6 +415,7 @@ QDomElement EffectsList::append(QDomElement e)
 {
     QDomElement result;
     if (!e.isNull()) {
+        m_lookupCount = -1;
         result = m_baseElement.appendChild(importNode(e, true)).toElement();
         if (m_useIndex) {
             updateIndexes(m_baseElement.childNodes(), m_baseElement.childNodes().count() - 1);
@@ -367,6 +445,7 @@ void EffectsList::removeAt(int ix)
 {
     QDomNodeList effects = m_baseElement.childNodes();
     if (ix <= 0 || ix > effects.count()) return;
+    m_lookupCount = -1;
     m_baseElement.removeChild(effects.at(ix - 1));
     if (m_useIndex) updateIndexes(effects, ix - 1);
 }
@@ -383,6 +462,7 @@ QDomElement EffectsList::insert(QDomElement effect)
     QDomNodeList effects = m_baseElement.childNodes();
     int ix = effect.attribute(QStringLiteral("kdenlive_ix")).toInt();
     QDomElement result;
+    m_lookupCount = -1;
     if (ix <= 0 || ix > effects.count()) {
         ix = effects.count();
         result = m_baseElement.appendChild(importNode(effect, true)).toElement();
@@ -429,6 +509,7 @@ void EffectsList::updateEffect(const QDomElement &effect)
     QDomNodeList effects = m_baseElement.childNodes();
     int ix = effect.attribute(QStringLiteral("kdenlive_ix")).toInt();
     QDomElement current = effectFromIndex(effects, ix);
+    m_lookupCount = -1;
     if (!current.isNull()) {
         m_baseElement.insertBefore(importNode(effect, true), current);
         m_baseElement.removeChild(current);
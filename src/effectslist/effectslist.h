@@ -27,6 +27,7 @@
 
 
 #include <QDomDocument>
+#include <QHash>
 #include <QSize>
 
 namespace Kdenlive {
@@ -92,6 +93,8 @@ public:
     static void removeProperty(QDomElement effect, const QString &name);
     /** @brief Remove all 'meta.*' properties from a producer, used when replacing proxy producers in xml for rendering. */
     static void removeMetaProperties(QDomElement producer);
+    /** @brief Returns the approximate memory used by an xml node and its children, in bytes. */
+    static qint64 memoryCost(const QDomNode &node);
     void clearList();
     /** @brief Get am effect with effect index equal to ix. */
     QDomElement effectFromIndex(const QDomNodeList &effects, int ix);
@@ -103,6 +106,13 @@ public:
 private:
     QDomElement m_baseElement;
     bool m_useIndex;
+    /** @brief Effects by id and by tag, the first one when there are duplicates */
+    mutable QHash <QString, QDomElement> m_idLookup;
+    mutable QHash <QString, QDomElement> m_tagLookup;
+    /** @brief Number of effects when the lookup tables were built, -1 if they are outdated */
+    mutable int m_lookupCount;
+    /** @brief Builds the lookup tables if needed, returns false for short lists which are not indexed. */
+    bool updateLookup() const;
 };
 
 #endif
@@ -22,12 +22,16 @@
 
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
+#include <config-kdenlive.h>
 
 #include <QDebug>
 
 #include <QFile>
 #include <QDir>
 #include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 
 #include <klocalizedstring.h>
 #include <locale>
@@ -40,6 +44,9 @@
 #include <xlocale.h>
 #endif
 
+// Bump when the layout of the cached effect catalogue changes
+#define EFFECT_CATALOGUE_VERSION 1
+
 // static
 void initEffects::refreshLumas()
 {
@@ -201,6 +208,13 @@ bool initEffects::parseEffectFiles(Mlt::Repository* repository, const QString &l
     }
     delete transitions;
 
+    // Reuse the catalogue built on a previous start if nothing it depends on has changed
+    const QByteArray catalogueKey = effectCatalogueKey(filtersList, producersList, transitionsItemList);
+    if (loadEffectCatalogue(catalogueKey)) {
+        refreshLumas();
+        return movit;
+    }
+
     // Create structure holding all transitions descriptions so that if an XML file has no description, we take it from MLT
     QMap <QString, QString> transDescriptions;
     foreach(const QString & transname, transitionsItemList) {
@@ -382,10 +396,110 @@ bool initEffects::parseEffectFiles(Mlt::Repository* repository, const QString &l
     MainWindow::videoEffects.clearList();
     foreach(const QDomElement & effect, videoEffectsMap)
         MainWindow::videoEffects.append(effect);
-    
+
+    saveEffectCatalogue(catalogueKey);
     return movit;
 }
 
+//static
+QString initEffects::effectCataloguePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/effectcatalogue");
+}
+
+//static
+QByteArray initEffects::effectCatalogueKey(const QStringList &filters, const QStringList &producers, const QStringList &transitions)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(KDENLIVE_VERSION);
+    hash.addData(mlt_version_get_string());
+    // Numeric locale changes the default values written by MLT, ui languages the translated names
+    hash.addData(setlocale(LC_NUMERIC, NULL));
+    hash.addData(KLocalizedString::languages().join(QLatin1Char(',')).toUtf8());
+    hash.addData(filters.join(QLatin1Char(',')).toUtf8());
+    hash.addData(producers.join(QLatin1Char(',')).toUtf8());
+    hash.addData(transitions.join(QLatin1Char(',')).toUtf8());
+
+    // Any added, removed or edited xml description or blacklist invalidates the catalogue
+    QStringList paths = QStandardPaths::locateAll(QStandardPaths::DataLocation, QStringLiteral("transitions"), QStandardPaths::LocateDirectory);
+    paths << QStandardPaths::locateAll(QStandardPaths::DataLocation, QStringLiteral("effects"), QStandardPaths::LocateDirectory);
+    foreach(const QString &path, paths) {
+        QDir directory(path);
+        const QFileInfoList files = directory.entryInfoList(QStringList() << QStringLiteral("*.xml"), QDir::Files, QDir::Name);
+        hash.addData(path.toUtf8());
+        foreach(const QFileInfo &info, files) {
+            hash.addData(info.fileName().toUtf8());
+            hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+            hash.addData(QByteArray::number(info.size()));
+        }
+    }
+    QStringList blacklists;
+    blacklists << QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("blacklisted_transitions.txt"));
+    blacklists << QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("blacklisted_effects.txt"));
+    foreach(const QString &path, blacklists) {
+        QFileInfo info(path);
+        hash.addData(path.toUtf8());
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return hash.result();
+}
+
+//static
+bool initEffects::loadEffectCatalogue(const QByteArray &key)
+{
+    QFile file(effectCataloguePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    qint32 version;
+    QByteArray storedKey;
+    in >> version >> storedKey;
+    if (version != EFFECT_CATALOGUE_VERSION || storedKey != key) {
+        return false;
+    }
+    QString lists[4];
+    for (int i = 0; i < 4; ++i) {
+        in >> lists[i];
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+    QDomDocument docs[4];
+    for (int i = 0; i < 4; ++i) {
+        if (!docs[i].setContent(lists[i])) {
+            return false;
+        }
+    }
+    EffectsList *targets[4] = { &MainWindow::customEffects, &MainWindow::audioEffects, &MainWindow::videoEffects, &MainWindow::transitions };
+    for (int i = 0; i < 4; ++i) {
+        targets[i]->clearList();
+        QDomElement effect = docs[i].documentElement().firstChildElement();
+        while (!effect.isNull()) {
+            targets[i]->append(effect);
+            effect = effect.nextSiblingElement();
+        }
+    }
+    return true;
+}
+
+//static
+void initEffects::saveEffectCatalogue(const QByteArray &key)
+{
+    const QString path = effectCataloguePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write effect catalogue" << path;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (qint32) EFFECT_CATALOGUE_VERSION << key;
+    out << MainWindow::customEffects.toString(-1) << MainWindow::audioEffects.toString(-1) << MainWindow::videoEffects.toString(-1) << MainWindow::transitions.toString(-1);
+}
+
 // static
 void initEffects::parseCustomEffectsFile()
 {
@@ -96,6 +96,16 @@ public:
 
 private:
     initEffects(); // disable the constructor
+
+    /** @brief Returns the path of the cached effects and transitions catalogue. */
+    static QString effectCataloguePath();
+    /** @brief Builds a key identifying the installed MLT services, description files and locale. */
+    static QByteArray effectCatalogueKey(const QStringList &filters, const QStringList &producers, const QStringList &transitions);
+    /** @brief Fills the global effects and transitions lists from the cache.
+     * @return false if there is no cache or it was built for another key */
+    static bool loadEffectCatalogue(const QByteArray &key);
+    /** @brief Writes the global effects and transitions lists to the cache. */
+    static void saveEffectCatalogue(const QByteArray &key);
 };
 
 
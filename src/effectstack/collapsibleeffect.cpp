@@ -49,6 +49,8 @@
 CollapsibleEffect::CollapsibleEffect(const QDomElement &effect, const QDomElement &original_effect, const ItemInfo &info, EffectMetaInfo *metaInfo, bool canMoveUp, bool lastEffect, QWidget * parent) :
     AbstractCollapsibleWidget(parent),
     m_paramWidget(NULL),
+    m_metaInfo(NULL),
+    m_widgetPending(false),
     m_effect(effect),
     m_itemInfo(info),
     m_original_effect(original_effect),
@@ -169,18 +171,7 @@ CollapsibleEffect::CollapsibleEffect(const QDomElement &effect, const QDomElemen
     connect(buttonDown, SIGNAL(clicked()), this, SLOT(slotEffectDown()));
     connect(buttonDel, SIGNAL(clicked()), this, SLOT(slotDeleteEffect()));
 
-    Q_FOREACH( QSpinBox * sp, findChildren<QSpinBox*>() ) {
-        sp->installEventFilter( this );
-        sp->setFocusPolicy( Qt::StrongFocus );
-    }
-    Q_FOREACH( KComboBox * cb, findChildren<KComboBox*>() ) {
-        cb->installEventFilter( this );
-        cb->setFocusPolicy( Qt::StrongFocus );
-    }
-    Q_FOREACH( QProgressBar * cb, findChildren<QProgressBar*>() ) {
-        cb->installEventFilter( this );
-        cb->setFocusPolicy( Qt::StrongFocus );
-    }
+    filterWheelEvents(this);
     m_animation = new QTimeLine(200, this); //duration matches to match kmessagewidget
     connect(m_animation, &QTimeLine::valueChanged, this, &CollapsibleEffect::setWidgetHeight);
     connect(m_animation, &QTimeLine::stateChanged, this, [this](QTimeLine::State state) {
@@ -294,6 +285,9 @@ QDomElement CollapsibleEffect::effectForSave() const
     if (m_paramWidget) {
         int in = m_paramWidget->range().x();
         EffectsController::offsetKeyframes(in, effect);
+    } else if (m_widgetPending) {
+        int in = m_widgetInfo.cropStart.frames(KdenliveSettings::project_fps());
+        EffectsController::offsetKeyframes(in, effect);
     }
     return effect;
 }
@@ -312,6 +306,10 @@ void CollapsibleEffect::setActive(bool activate)
 {
     decoframe->setProperty("active", activate);
     decoframe->setStyleSheet(decoframe->styleSheet());
+    if (activate) {
+        // The active effect drives the monitor scene and keyframes, it needs its parameters
+        ensureParameterWidget();
+    }
     if (m_paramWidget) {
         m_paramWidget->connectMonitor(activate);
     }
@@ -420,6 +418,9 @@ void CollapsibleEffect::slotResetEffect()
 void CollapsibleEffect::slotSwitch()
 {
     bool expand = !widgetFrame->isVisible();
+    if (expand) {
+        ensureParameterWidget();
+    }
     widgetFrame->setVisible(true);
     slotShow(expand);
     m_animation->setDirection(expand ? QTimeLine::Forward : QTimeLine::Backward);
@@ -505,6 +506,9 @@ void CollapsibleEffect::updateWidget(const ItemInfo &info, const QDomElement &ef
     m_paramWidget = NULL;
     m_effect = effect;
     setupWidget(info, metaInfo);
+    if (isActive()) {
+        ensureParameterWidget();
+    }
 }
 
 void CollapsibleEffect::updateFrameInfo()
@@ -527,6 +531,7 @@ void CollapsibleEffect::setupWidget(const ItemInfo &info, EffectMetaInfo *metaIn
         delete m_paramWidget;
         m_paramWidget = NULL;
     }
+    m_widgetPending = false;
     if (m_effect.attribute(QStringLiteral("tag")) == QLatin1String("region")) {
         m_regionEffect = true;
         QDomNodeList effects =  m_effect.elementsByTagName(QStringLiteral("effect"));
@@ -550,22 +555,66 @@ void CollapsibleEffect::setupWidget(const ItemInfo &info, EffectMetaInfo *metaIn
         }
     }
     else {
-        m_paramWidget = new ParameterContainer(m_effect, info, metaInfo, widgetFrame);
-        connect(m_paramWidget, SIGNAL(disableCurrentFilter(bool)), this, SLOT(slotDisableEffect(bool)));
-        connect(m_paramWidget, &ParameterContainer::importKeyframes, this, &CollapsibleEffect::importKeyframes);
         if (m_effect.firstChildElement(QStringLiteral("parameter")).isNull()) {
             // Effect has no parameter, don't allow expand
             collapseButton->setEnabled(false);
             collapseButton->setVisible(false);
             widgetFrame->setVisible(false);
+        } else if (m_info.isCollapsed) {
+            // Only build the parameter widgets once the effect is expanded or activated
+            widgetFrame->setVisible(false);
+            collapseButton->setArrowType(Qt::RightArrow);
+            m_widgetInfo = info;
+            m_metaInfo = metaInfo;
+            m_widgetPending = true;
+            return;
         }
+        m_paramWidget = new ParameterContainer(m_effect, info, metaInfo, widgetFrame);
+        connect(m_paramWidget, SIGNAL(disableCurrentFilter(bool)), this, SLOT(slotDisableEffect(bool)));
+        connect(m_paramWidget, &ParameterContainer::importKeyframes, this, &CollapsibleEffect::importKeyframes);
     }
     if (collapseButton->isEnabled() && m_info.isCollapsed) {
         widgetFrame->setVisible(false);
         collapseButton->setArrowType(Qt::RightArrow);
 
     }
+    connectParameterWidget();
+}
+
+void CollapsibleEffect::ensureParameterWidget()
+{
+    if (!m_widgetPending) {
+        return;
+    }
+    m_widgetPending = false;
+    m_paramWidget = new ParameterContainer(m_effect, m_widgetInfo, m_metaInfo, widgetFrame);
+    connect(m_paramWidget, SIGNAL(disableCurrentFilter(bool)), this, SLOT(slotDisableEffect(bool)));
+    connect(m_paramWidget, &ParameterContainer::importKeyframes, this, &CollapsibleEffect::importKeyframes);
+    connectParameterWidget();
+    filterWheelEvents(m_paramWidget);
+    m_paramWidget->connectMonitor(isActive());
+}
+
+void CollapsibleEffect::filterWheelEvents(QWidget *parent)
+{
+    Q_FOREACH( QSpinBox * sp, parent->findChildren<QSpinBox*>() ) {
+        sp->installEventFilter( this );
+        sp->setFocusPolicy( Qt::StrongFocus );
+    }
+    Q_FOREACH( KComboBox * cb, parent->findChildren<KComboBox*>() ) {
+        cb->installEventFilter( this );
+        cb->setFocusPolicy( Qt::StrongFocus );
+    }
+    Q_FOREACH( QProgressBar * cb, parent->findChildren<QProgressBar*>() ) {
+        cb->installEventFilter( this );
+        cb->setFocusPolicy( Qt::StrongFocus );
+    }
+}
+
+void CollapsibleEffect::connectParameterWidget()
+{
     connect (m_paramWidget, SIGNAL(parameterChanged(QDomElement,QDomElement,int)), this, SIGNAL(parameterChanged(QDomElement,QDomElement,int)));
+    connect (m_paramWidget, SIGNAL(parameterPreview(QDomElement,int)), this, SIGNAL(parameterPreview(QDomElement,int)));
 
     connect(m_paramWidget, SIGNAL(startFilterJob(QMap<QString,QString>&,QMap<QString,QString>&,QMap<QString,QString>&)), this, SIGNAL(startFilterJob(QMap<QString,QString>&,QMap<QString,QString>&,QMap<QString,QString>&)));
 
@@ -590,7 +639,7 @@ bool CollapsibleEffect::isGroup() const
 
 void CollapsibleEffect::updateTimecodeFormat()
 {
-    m_paramWidget->updateTimecodeFormat();
+    if (m_paramWidget) m_paramWidget->updateTimecodeFormat();
     if (!m_subParamWidgets.isEmpty()) {
         // we have a group
         for (int i = 0; i < m_subParamWidgets.count(); ++i)
@@ -615,7 +664,7 @@ void CollapsibleEffect::dragEnterEvent(QDragEnterEvent *event)
         frame->setProperty("target", true);
         frame->setStyleSheet(frame->styleSheet());
         event->acceptProposedAction();
-    } else if (m_paramWidget->doesAcceptDrops() && event->mimeData()->hasFormat(QStringLiteral("kdenlive/geometry")) && event->source()->objectName() != QStringLiteral("ParameterContainer")) {
+    } else if (m_paramWidget && m_paramWidget->doesAcceptDrops() && event->mimeData()->hasFormat(QStringLiteral("kdenlive/geometry")) && event->source()->objectName() != QStringLiteral("ParameterContainer")) {
         event->setDropAction(Qt::CopyAction);
         event->setAccepted(true);
     }
@@ -732,11 +781,17 @@ MonitorSceneType CollapsibleEffect::needsMonitorEffectScene() const
 
 void CollapsibleEffect::setRange(int inPoint , int outPoint)
 {
-    m_paramWidget->setRange(inPoint, outPoint);
+    if (m_paramWidget) {
+        m_paramWidget->setRange(inPoint, outPoint);
+    } else if (m_widgetPending) {
+        m_widgetInfo.cropStart = GenTime(inPoint, KdenliveSettings::project_fps());
+        m_widgetInfo.cropDuration = GenTime(outPoint - inPoint + 1, KdenliveSettings::project_fps());
+    }
 }
 
 void CollapsibleEffect::setKeyframes(const QString &tag, const QString &data)
 {
+    ensureParameterWidget();
     m_paramWidget->setKeyframes(tag, data);
 }
 
@@ -48,6 +48,8 @@ public:
     QLabel *title;
 	
     void setupWidget(const ItemInfo &info, EffectMetaInfo *metaInfo);
+    /** @brief Builds the parameter widgets if they were deferred while the effect was collapsed. */
+    void ensureParameterWidget();
     void updateTimecodeFormat();
     void setActive(bool activate);
     /** @brief Install event filter so that scrolling with mouse wheel does not change parameter value. */
@@ -114,6 +116,11 @@ private slots:
 
 private:
     ParameterContainer *m_paramWidget;
+    /** @brief Clip info and meta info kept to build the parameter widgets on first expand. */
+    ItemInfo m_widgetInfo;
+    EffectMetaInfo *m_metaInfo;
+    /** @brief True if the parameter widgets have not been built yet. */
+    bool m_widgetPending;
     QList <CollapsibleEffect *> m_subParamWidgets;
     QDomElement m_effect;
     ItemInfo m_itemInfo;
@@ -133,6 +140,10 @@ private:
     QPixmap m_iconPix;
     /** @brief Check if collapsed state changed and inform MLT. */
     void updateCollapsedState();
+    /** @brief Forward the parameter widget signals. */
+    void connectParameterWidget();
+    /** @brief Install event filter on the spin and combo boxes of a widget. */
+    void filterWheelEvents(QWidget *parent);
 
 protected:
     virtual void mouseDoubleClickEvent ( QMouseEvent * event );
@@ -143,6 +154,8 @@ protected:
 
 signals:
     void parameterChanged(const QDomElement &, const QDomElement&, int);
+    /** @brief Parameters are being dragged, update the filter without undo entry. */
+    void parameterPreview(const QDomElement &, int);
     void syncEffectsPos(int);
     void effectStateChanged(bool, int ix, MonitorSceneType effectNeedsMonitorScene);
     void deleteEffect(const QDomElement &);
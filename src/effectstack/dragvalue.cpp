@@ -151,6 +151,11 @@ bool DragValue::hasEditFocus() const
     return (fWidget && fWidget->parentWidget() == this);
 }
 
+bool DragValue::isDragging() const
+{
+    return m_label->isDragging();
+}
+
 int DragValue::spinSize()
 {
     if (m_intEdit)
@@ -449,6 +454,8 @@ void CustomLabel::mouseReleaseEvent(QMouseEvent* e)
         return;
     }
     if (m_dragMode) {
+        // Drag is over, the final value can be committed
+        m_dragMode = false;
         setNewValue(value(), true);
         m_dragLastPosition = m_dragStartPosition;
         e->accept();
@@ -497,6 +504,11 @@ void CustomLabel::setNewValue(double value, bool update)
     emit valueChanged(qRound(value), update);
 }
 
+bool CustomLabel::isDragging() const
+{
+    return m_dragMode;
+}
+
 void CustomLabel::setStep(double step)
 {
     m_step = step;
@@ -37,6 +37,8 @@ public:
     explicit CustomLabel(const QString &label, bool showSlider = true, int range = 1000, QWidget *parent = 0);
     void setProgressValue(double value);
     void setStep(double step);
+    /** @brief Returns true while the user drags the value with the mouse. */
+    bool isDragging() const;
     
 protected:
     //virtual void mouseDoubleClickEvent(QMouseEvent * event);
@@ -113,6 +115,8 @@ public:
     void setSpinSize(int width);
     /** @brief Returns true if widget is currently being edited */
     bool hasEditFocus() const;
+    /** @brief Returns true while the value is dragged, valueChanged is then emitted for each mouse move. */
+    bool isDragging() const;
 
 public slots:
     /** @brief Sets the value (forced to be in the valid range) and emits valueChanged. */
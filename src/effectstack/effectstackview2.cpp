@@ -372,6 +372,7 @@ void EffectStackView2::setupListView()
         CollapsibleEffect *currentEffect = new CollapsibleEffect(d, m_currentEffectList.at(i), info, &m_effectMetaInfo, canMoveUp, i == effectsCount - 1, view);
         isSelected = currentEffect->effectIndex() == activeEffectIndex();
         if (isSelected) {
+            currentEffect->ensureParameterWidget();
             m_monitorSceneWanted = currentEffect->needsMonitorEffectScene();
             selectedCollapsibleEffect = currentEffect;
             // show monitor scene if necessary
@@ -435,6 +436,7 @@ void EffectStackView2::connectEffect(CollapsibleEffect *currentEffect)
     // Check drag & drop
     currentEffect->installEventFilter( this );
     connect(currentEffect, SIGNAL(parameterChanged(QDomElement,QDomElement,int)), this , SLOT(slotUpdateEffectParams(QDomElement,QDomElement,int)));
+    connect(currentEffect, SIGNAL(parameterPreview(QDomElement,int)), this , SLOT(slotPreviewEffectParams(QDomElement,int)));
     connect(currentEffect, SIGNAL(startFilterJob(QMap<QString,QString>&, QMap<QString,QString>&,QMap <QString, QString>&)), this , SLOT(slotStartFilterJob(QMap<QString,QString>&, QMap<QString,QString>&,QMap <QString, QString>&)));
     connect(currentEffect, SIGNAL(deleteEffect(QDomElement)), this , SLOT(slotDeleteEffect(QDomElement)));
     connect(currentEffect, SIGNAL(reloadEffects()), this , SIGNAL(reloadEffects()));
@@ -762,6 +764,18 @@ void EffectStackView2::slotUpdateEffectParams(const QDomElement &old, const QDom
     QTimer::singleShot(200, this, SLOT(slotCheckWheelEventFilter()));
 }
 
+void EffectStackView2::slotPreviewEffectParams(const QDomElement &e, int ix)
+{
+    Q_UNUSED(ix)
+    // Master clip effects are only updated when the edit is finished
+    if (m_status == TIMELINE_TRACK) {
+        emit previewEffect(NULL, m_trackindex, e);
+    }
+    else if (m_status == TIMELINE_CLIP && m_clipref) {
+        emit previewEffect(m_clipref, -1, e);
+    }
+}
+
 void EffectStackView2::slotSetCurrentEffect(int ix)
 {
     if (m_status == TIMELINE_CLIP) {
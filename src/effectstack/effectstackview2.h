@@ -197,6 +197,8 @@ private slots:
     void slotCheckMonitorPosition(int renderPos);
 
     void slotUpdateEffectParams(const QDomElement &old, const QDomElement& e, int ix);
+    /** @brief Relay parameters being dragged to the timeline filter. */
+    void slotPreviewEffectParams(const QDomElement &e, int ix);
 
     /** @brief Move an effect in the stack.
      * @param indexes The list of effect index in the stack
@@ -262,6 +264,8 @@ signals:
     void addMasterEffect(const QString &id, const QDomElement&);
     /**  Parameters for an effect changed, update the filter in timeline */
     void updateEffect(ClipItem*, int, const QDomElement&, const QDomElement &, int,bool);
+    /**  Parameters for an effect are being dragged, update the filter in timeline without undo entry */
+    void previewEffect(ClipItem*, int, const QDomElement&);
     /**  Parameters for an effect changed, update the filter in timeline */
     void updateMasterEffect(QString, const QDomElement&, const QDomElement &, int);
     /** An effect in stack was moved, we need to regenerate
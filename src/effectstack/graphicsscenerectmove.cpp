@@ -56,6 +56,12 @@ void MyQGraphicsEffect::setOffset(int xOffset, int yOffset, int blur)
     updateBoundingRect();
 }
 
+QRectF MyQGraphicsEffect::boundingRectFor(const QRectF &rect) const
+{
+    QRectF shadow = rect.translated(m_xOffset, m_yOffset).adjusted(-2 * m_blur, -2 * m_blur, 2 * m_blur, 2 * m_blur);
+    return rect.united(shadow);
+}
+
 void MyQGraphicsEffect::draw(QPainter *painter)
 {
     painter->fillRect(boundingRect(), Qt::transparent);
@@ -67,6 +73,8 @@ void MyQGraphicsEffect::draw(QPainter *painter)
 MyTextItem::MyTextItem(const QString &txt, QGraphicsItem *parent) :
     QGraphicsTextItem(txt, parent)
     , m_alignment(Qt::AlignLeft)
+    , m_shadowBlur(0)
+    , m_maskBlur(-1)
 {
     setCacheMode(QGraphicsItem::ItemCoordinateCache);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
@@ -87,6 +95,7 @@ Qt::Alignment MyTextItem::alignment() const
 void MyTextItem::updateShadow(bool enabled, int blur, int xoffset, int yoffset, QColor color)
 {
     m_shadowOffset = QPoint(xoffset, yoffset);
+    if (blur != m_shadowBlur) m_shadowMask = QImage();
     m_shadowBlur = blur;
     m_shadowColor = color;
     m_shadowEffect->setEnabled(enabled);
@@ -124,9 +133,24 @@ void MyTextItem::setAlignment(Qt::Alignment alignment)
     setTextCursor(cursor);
 }
 
+QString MyTextItem::pathKey() const
+{
+    QRectF rect = baseBoundingRect();
+    return QStringLiteral("%1|%2|%3|%4|%5x%6|%7").arg(font().toString()).arg((int) m_alignment).arg(data(TitleDocument::LineSpacing).toInt())
+            .arg(data(TitleDocument::Gradient).toString()).arg(rect.width()).arg(rect.height()).arg(toPlainText());
+}
+
 void MyTextItem::updateGeometry(int, int, int)
 {
     updateGeometry();
+    const QString key = pathKey();
+    if (key == m_pathKey) {
+        // Only colors or char formats changed, cached geometry is still valid
+        update();
+        return;
+    }
+    m_pathKey = key;
+    m_shadowMask = QImage();
     // update gradient if necessary
     QString gradientData = data(TitleDocument::Gradient).toString();
     if (!gradientData.isEmpty()) {
@@ -219,19 +243,29 @@ void MyTextItem::updateShadow()
         m_shadowEffect->setShadow(QImage());
         return;
     }
-    QRectF bounding = boundingRect();
-    QPainterPath path = m_path;
-    // Calculate position of text in parent item
-    path.translate(QPointF(2 * m_shadowBlur, 2 * m_shadowBlur));
-    QRectF fullSize = bounding.united(path.boundingRect());
-    QImage shadow(fullSize.width() + qAbs(m_shadowOffset.x()) + 4 * m_shadowBlur, fullSize.height() + qAbs(m_shadowOffset.y()) + 4 * m_shadowBlur, QImage::Format_ARGB32_Premultiplied);
-    shadow.fill(Qt::transparent);
+    if (m_shadowMask.isNull() || m_maskBlur != m_shadowBlur) {
+        // Geometry or blur changed, render and blur the shadow shape once
+        QRectF bounding = baseBoundingRect();
+        QPainterPath path = m_path;
+        // Calculate position of text in parent item
+        path.translate(QPointF(2 * m_shadowBlur, 2 * m_shadowBlur));
+        QRectF fullSize = bounding.united(path.boundingRect());
+        m_shadowMask = QImage(fullSize.width() + 4 * m_shadowBlur, fullSize.height() + 4 * m_shadowBlur, QImage::Format_ARGB32_Premultiplied);
+        m_shadowMask.fill(Qt::transparent);
+        QPainter painter(&m_shadowMask);
+        painter.fillPath(path, QBrush(Qt::black));
+        painter.end();
+        if (m_shadowBlur > 0) {
+            blurShadow(m_shadowMask, m_shadowBlur);
+        }
+        m_maskBlur = m_shadowBlur;
+    }
+    // Colorize the cached mask
+    QImage shadow = m_shadowMask.copy();
     QPainter painter(&shadow);
-    painter.fillPath(path, QBrush(m_shadowColor));
+    painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    painter.fillRect(shadow.rect(), m_shadowColor);
     painter.end();
-    if (m_shadowBlur > 0) {
-        blurShadow(shadow, m_shadowBlur);
-    }
     m_shadowEffect->setShadow(shadow);
 }
 
@@ -35,6 +35,8 @@ public:
     explicit MyQGraphicsEffect(QObject *parent = Q_NULLPTR);
     void setOffset(int xOffset, int yOffset, int blur);
     void setShadow(QImage image);
+    /** @brief Include the blurred and offset shadow, so that partial scene updates repaint all of it. */
+    QRectF boundingRectFor(const QRectF &rect) const;
 protected:
     void draw(QPainter *painter);
 private:
@@ -70,9 +72,16 @@ private:
     int m_shadowBlur;
     QColor m_shadowColor;
     QPainterPath m_path;
+    /** @brief Text, font and layout m_path was built for, the path is only rebuilt when it changes. */
+    QString m_pathKey;
+    /** @brief Blurred shadow alpha, reused when only the shadow color or offset change. */
+    QImage m_shadowMask;
+    int m_maskBlur;
     MyQGraphicsEffect *m_shadowEffect;
     void updateShadow();
     void blurShadow(QImage &image, int radius);
+    /** @brief Returns the description of everything the text geometry depends on. */
+    QString pathKey() const;
 
 public slots:
     void updateGeometry(int, int, int);
@@ -143,6 +143,32 @@ class Fontval: public QWidget, public Ui::Fontval_UI
 {
 };
 
+static PARAMTYPE parameterType(const QString &type)
+{
+    if (type == QLatin1String("double") || type == QLatin1String("constant")) return PARAM_DOUBLE;
+    if (type == QLatin1String("list")) return PARAM_LIST;
+    if (type == QLatin1String("bool")) return PARAM_BOOL;
+    if (type == QLatin1String("switch")) return PARAM_SWITCH;
+    if (type == QLatin1String("animated")) return PARAM_ANIMATED;
+    if (type == QLatin1String("animatedrect")) return PARAM_ANIMATEDRECT;
+    if (type == QLatin1String("geometry")) return PARAM_GEOMETRY;
+    if (type == QLatin1String("addedgeometry")) return PARAM_ADDEDGEOMETRY;
+    if (type == QLatin1String("keyframe")) return PARAM_KEYFRAME;
+    if (type == QLatin1String("simplekeyframe")) return PARAM_SIMPLEKEYFRAME;
+    if (type == QLatin1String("color")) return PARAM_COLOR;
+    if (type == QLatin1String("position")) return PARAM_POSITION;
+    if (type == QLatin1String("curve")) return PARAM_CURVE;
+    if (type == QLatin1String("bezier_spline")) return PARAM_BEZIER;
+    if (type == QLatin1String("roto-spline")) return PARAM_ROTO;
+    if (type == QLatin1String("wipe")) return PARAM_WIPE;
+    if (type == QLatin1String("url")) return PARAM_URL;
+    if (type == QLatin1String("keywords")) return PARAM_KEYWORDS;
+    if (type == QLatin1String("fontfamily")) return PARAM_FONT;
+    if (type == QLatin1String("filterjob")) return PARAM_FILTERJOB;
+    if (type == QLatin1String("fixed")) return PARAM_FIXED;
+    return PARAM_UNKNOWN;
+}
+
 
 ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo &info, EffectMetaInfo *metaInfo, QWidget * parent) :
         m_info(info),
@@ -153,10 +179,14 @@ ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo
         m_effect(effect),
         m_acceptDrops(false),
         m_monitorEffectScene(MonitorSceneDefault),
-        m_conditionParameter(false)
+        m_conditionParameter(false),
+        m_version(0)
 {
     QLocale locale;
     locale.setNumberOptions(QLocale::OmitGroupSeparator);
+    m_previewTimer.setSingleShot(true);
+    m_previewTimer.setInterval(qMax(1, qRound(1000 / KdenliveSettings::project_fps())));
+    connect(&m_previewTimer, SIGNAL(timeout()), this, SLOT(slotPreviewParameters()));
     setObjectName(QStringLiteral("ParameterContainer"));
 
     m_in = info.cropStart.frames(KdenliveSettings::project_fps());
@@ -252,6 +282,7 @@ ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo
             m_vbox->addWidget(doubleparam);
             m_valueItems[paramName] = doubleparam;
             connect(doubleparam, SIGNAL(valueChanged(double)), this, SLOT(slotCollectAllParameters()));
+            connect(doubleparam, SIGNAL(valueChanging(double)), this, SLOT(slotParameterChanging()));
             connect(this, SIGNAL(showComments(bool)), doubleparam, SLOT(slotShowComment(bool)));
         } else if (type == QLatin1String("list")) {
             Listval *lsval = new Listval;
@@ -532,7 +563,7 @@ ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo
 
             QString depends = pa.attribute(QStringLiteral("depends"));
             if (!depends.isEmpty())
-                meetDependency(paramName, type, EffectsList::parameter(e, depends));
+                meetDependency(curve, PARAM_CURVE, EffectsList::parameter(e, depends));
         } else if (type == QLatin1String("bezier_spline")) {
             BezierSplineWidget *widget = new BezierSplineWidget(value, parent);
             stretch = false;
@@ -541,7 +572,7 @@ ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo
             connect(widget, SIGNAL(modified()), this, SLOT(slotCollectAllParameters()));
             QString depends = pa.attribute(QStringLiteral("depends"));
             if (!depends.isEmpty())
-                meetDependency(paramName, type, EffectsList::parameter(e, depends));
+                meetDependency(widget, PARAM_BEZIER, EffectsList::parameter(e, depends));
         } else if (type == QLatin1String("roto-spline")) {
             m_monitorEffectScene = MonitorSceneRoto;
             RotoWidget *roto = new RotoWidget(value.toLatin1(), m_metaInfo->monitor, info, m_metaInfo->monitor->timecode(), parent);
@@ -724,6 +755,71 @@ ParameterContainer::ParameterContainer(const QDomElement &effect, const ItemInfo
     for (int i = 0; i < allWidgets.count(); ++i) {
         allWidgets.at(i)->setSpinSize(minSize);
     }
+    compileParameters();
+}
+
+void ParameterContainer::compileParameters()
+{
+    m_params.clear();
+    m_paramIndex.clear();
+    m_previewParams.clear();
+    QDomElement versionnode = m_effect.firstChildElement(QStringLiteral("version"));
+    if (!versionnode.isNull()) {
+        QLocale locale;
+        m_version = locale.toDouble(versionnode.text());
+    }
+    QDomNodeList namenode = m_effect.elementsByTagName(QStringLiteral("parameter"));
+    m_params.reserve(namenode.count());
+    for (int i = 0; i < namenode.count() ; ++i) {
+        CompiledParameter param;
+        param.element = namenode.item(i).toElement();
+        param.type = parameterType(param.element.attribute(QStringLiteral("type")));
+        param.name = param.element.attribute(QStringLiteral("name"));
+        param.depends = param.element.attribute(QStringLiteral("depends"));
+        QDomElement na = param.element.firstChildElement(QStringLiteral("name"));
+        if (!na.isNull()) {
+            param.keyframeName = i18n(na.text().toUtf8().data());
+        }
+        // Same key as used when the widget was registered in m_valueItems
+        QString widgetKey = na.isNull() ? param.name : param.keyframeName;
+        if (param.type == PARAM_POSITION)
+            widgetKey.append("position");
+        else if (param.type == PARAM_GEOMETRY)
+            widgetKey.append("geometry");
+        else if (param.type == PARAM_KEYFRAME)
+            widgetKey.append("keyframe");
+        else if (param.element.attribute(QStringLiteral("type")) == QLatin1String("complex"))
+            widgetKey.append("complex");
+        param.widget = m_valueItems.value(widgetKey);
+        if (param.type == PARAM_DOUBLE && param.widget) {
+            m_previewParams << i;
+        }
+        if (!m_paramIndex.contains(param.name)) {
+            m_paramIndex.insert(param.name, i);
+        }
+        m_params.append(param);
+    }
+}
+
+QString ParameterContainer::parameterValue(const QString &name) const
+{
+    int ix = m_paramIndex.value(name, -1);
+    if (ix < 0) {
+        return EffectsList::parameter(m_effect, name);
+    }
+    return m_params.at(ix).element.attribute(QStringLiteral("value"));
+}
+
+void ParameterContainer::setParameterValue(const QString &name, const QString &value)
+{
+    int ix = m_paramIndex.value(name, -1);
+    if (ix < 0) {
+        // Not part of the effect description, the parameter might have to be created
+        EffectsList::setParameter(m_effect, name, value);
+        return;
+    }
+    QDomElement pa = m_params.at(ix).element;
+    pa.setAttribute(QStringLiteral("value"), value);
 }
 
 ParameterContainer::~ParameterContainer()
@@ -734,7 +830,7 @@ ParameterContainer::~ParameterContainer()
 
 void ParameterContainer::copyData(const QString &name)
 {
-    QString value = EffectsList::parameter(m_effect, name);
+    QString value = parameterValue(name);
     if (value.isEmpty())
         return;
     QClipboard *clipboard = QApplication::clipboard();
@@ -743,7 +839,7 @@ void ParameterContainer::copyData(const QString &name)
 
 void ParameterContainer::makeDrag(const QString &name)
 {
-    QString value = EffectsList::parameter(m_effect, name);
+    QString value = parameterValue(name);
     if (value.isEmpty())
         return;
     value.prepend(name + QStringLiteral("="));
@@ -836,19 +932,19 @@ void ParameterContainer::toggleSync(bool enable)
     emit parameterChanged(oldparam, m_effect, m_effect.attribute(QStringLiteral("kdenlive_ix")).toInt());
 }
 
-void ParameterContainer::meetDependency(const QString& name, const QString &type, const QString &value)
+void ParameterContainer::meetDependency(QWidget *widget, PARAMTYPE type, const QString &value)
 {
-    if (type == QLatin1String("curve")) {
-        KisCurveWidget *curve = static_cast<KisCurveWidget*>(m_valueItems[name]);
+    if (type == PARAM_CURVE) {
+        KisCurveWidget *curve = static_cast<KisCurveWidget*>(widget);
         if (curve) {
             const int color = value.toInt();
             curve->setPixmap(QPixmap::fromImage(ColorTools::rgbCurvePlane(curve->size(), (ColorTools::ColorsRGB)(color == 3 ? 4 : color), 0.8)));
         }
-    } else if (type == QLatin1String("bezier_spline")) {
-        BezierSplineWidget *widget = static_cast<BezierSplineWidget*>(m_valueItems[name]);
-        if (widget) {
+    } else if (type == PARAM_BEZIER) {
+        BezierSplineWidget *bezier = static_cast<BezierSplineWidget*>(widget);
+        if (bezier) {
             QLocale locale;
-            widget->setMode((BezierSplineWidget::CurveModes)((int)(locale.toDouble(value) * 10 + 0.5)));
+            bezier->setMode((BezierSplineWidget::CurveModes)((int)(locale.toDouble(value) * 10 + 0.5)));
         }
     }
 }
@@ -903,30 +999,51 @@ void ParameterContainer::updateTimecodeFormat()
     if (m_animationWidget) 
         m_animationWidget->updateTimecodeFormat();
 
-    QDomNodeList namenode = m_effect.elementsByTagName(QStringLiteral("parameter"));
-    for (int i = 0; i < namenode.count() ; ++i) {
-        QDomNode pa = namenode.item(i);
-        QDomElement na = pa.firstChildElement(QStringLiteral("name"));
-        QString type = pa.attributes().namedItem(QStringLiteral("type")).nodeValue();
-        QString paramName = na.isNull() ? pa.attributes().namedItem(QStringLiteral("name")).nodeValue() : i18n(na.text().toUtf8().data());
-
-        if (type == QLatin1String("geometry")) {
+    for (int i = 0; i < m_params.count() ; ++i) {
+        const CompiledParameter &param = m_params.at(i);
+        if (param.type == PARAM_GEOMETRY) {
             if (m_geometryWidget) m_geometryWidget->updateTimecodeFormat();
             break;
-        } else if (type == QLatin1String("position")) {
-            PositionEdit *posi = static_cast<PositionEdit*>(m_valueItems[paramName+"position"]);
-            posi->updateTimecodeFormat();
+        } else if (param.type == PARAM_POSITION) {
+            PositionEdit *posi = static_cast<PositionEdit*>(param.widget);
+            if (posi) posi->updateTimecodeFormat();
             break;
-        } else if (type == QLatin1String("roto-spline")) {
-            RotoWidget *widget = static_cast<RotoWidget *>(m_valueItems[paramName]);
-            widget->updateTimecodeFormat();
+        } else if (param.type == PARAM_ROTO) {
+            RotoWidget *widget = static_cast<RotoWidget *>(param.widget);
+            if (widget) widget->updateTimecodeFormat();
         }
     }
 }
 
+void ParameterContainer::slotParameterChanging()
+{
+    if (!m_previewTimer.isActive()) {
+        m_previewTimer.start();
+    }
+}
+
+void ParameterContainer::slotPreviewParameters()
+{
+    if (m_effect.isNull()) return;
+    QLocale locale;
+    locale.setNumberOptions(QLocale::OmitGroupSeparator);
+    QDomElement preview = m_effect.cloneNode().toElement();
+    // The clone has the same parameter order as m_effect, so compiled indexes apply to it
+    QDomNodeList namenode = preview.elementsByTagName(QStringLiteral("parameter"));
+    for (int i = 0; i < m_previewParams.count() ; ++i) {
+        int ix = m_previewParams.at(i);
+        if (ix >= namenode.count()) break;
+        DoubleParameterWidget *doubleparam = static_cast<DoubleParameterWidget*>(m_params.at(ix).widget);
+        namenode.item(ix).toElement().setAttribute(QStringLiteral("value"), locale.toString(doubleparam->getValue()));
+    }
+    emit parameterPreview(preview, preview.attribute(QStringLiteral("kdenlive_ix")).toInt());
+}
+
 void ParameterContainer::slotCollectAllParameters()
 {
     if ((m_valueItems.isEmpty() && !m_animationWidget && !m_geometryWidget) || m_effect.isNull()) return;
+    // Final value, drop pending preview
+    m_previewTimer.stop();
     QLocale locale;
     locale.setNumberOptions(QLocale::OmitGroupSeparator);
     const QDomElement oldparam = m_effect.cloneNode().toElement();
@@ -945,14 +1062,12 @@ void ParameterContainer::slotCollectAllParameters()
         return;
     }
 
-    QDomNodeList namenode = m_effect.elementsByTagName(QStringLiteral("parameter"));
-
     // special case, m_animationWidget can hold several parameters
     if (m_animationWidget) {
         QMap <QString, QString> values = m_animationWidget->getAnimation();
-        for (int i = 0; i < namenode.count() ; ++i) {
-            QDomElement pa = namenode.item(i).toElement();
-            QString paramName = pa.attribute(QStringLiteral("name"));
+        for (int i = 0; i < m_params.count() ; ++i) {
+            QDomElement pa = m_params.at(i).element;
+            const QString &paramName = m_params.at(i).name;
             if (values.count() > 1) {
                 pa.setAttribute(QStringLiteral("intimeline"), m_animationWidget->isActive(paramName) ? "1" : "0");
             }
@@ -962,34 +1077,25 @@ void ParameterContainer::slotCollectAllParameters()
         }
     }
 
-    for (int i = 0; i < namenode.count() ; ++i) {
-        QDomElement pa = namenode.item(i).toElement();
-        QDomElement na = pa.firstChildElement(QStringLiteral("name"));
-        QString type = pa.attribute(QStringLiteral("type"));
-        QString paramName = na.isNull() ? pa.attribute(QStringLiteral("name")) : i18n(na.text().toUtf8().data());
-        if (type == QLatin1String("complex"))
-            paramName.append("complex");
-        else if (type == QLatin1String("position"))
-            paramName.append("position");
-        else if (type == QLatin1String("geometry"))
-            paramName.append("geometry");
-        else if (type == QLatin1String("keyframe"))
-            paramName.append("keyframe");
-        else if (type == QLatin1String("animated"))
+    for (int i = 0; i < m_params.count() ; ++i) {
+        const CompiledParameter &param = m_params.at(i);
+        const PARAMTYPE type = param.type;
+        QDomElement pa = param.element;
+        if (type == PARAM_ANIMATED)
             continue;
-        if (type != QLatin1String("animatedrect") && type != QLatin1String("simplekeyframe") && type != QLatin1String("fixed") && type != QLatin1String("addedgeometry") && !m_valueItems.contains(paramName)) {
-            qDebug() << "// Param: " << paramName << " NOT FOUND";
+        if (type != PARAM_ANIMATEDRECT && type != PARAM_SIMPLEKEYFRAME && type != PARAM_FIXED && type != PARAM_ADDEDGEOMETRY && !param.widget) {
+            qDebug() << "// Param: " << param.name << " NOT FOUND";
             continue;
         }
 
         QString setValue;
-        if (type == QLatin1String("double") || type == QLatin1String("constant")) {
-            DoubleParameterWidget *doubleparam = static_cast<DoubleParameterWidget*>(m_valueItems.value(paramName));
+        if (type == PARAM_DOUBLE) {
+            DoubleParameterWidget *doubleparam = static_cast<DoubleParameterWidget*>(param.widget);
             if (doubleparam) {
                 setValue = locale.toString(doubleparam->getValue());
             }
-        } else if (type == QLatin1String("list")) {
-            Listval* val = static_cast<Listval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_LIST) {
+            Listval* val = static_cast<Listval*>(param.widget);
             if (val) {
                 KComboBox *box = val->list;
                 setValue = box->itemData(box->currentIndex()).toString();
@@ -997,28 +1103,28 @@ void ParameterContainer::slotCollectAllParameters()
                 pa.setAttribute(QStringLiteral("value"), setValue);
                 setValue.clear();
             }
-        } else if (type == QLatin1String("bool")) {
-            Boolval* val = static_cast<Boolval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_BOOL) {
+            Boolval* val = static_cast<Boolval*>(param.widget);
             if (val) {
                 QCheckBox *box = val->checkBox;
                 setValue = box->checkState() == Qt::Checked ? "1" : "0" ;
             }
-        } else if (type == QLatin1String("switch")) {
-            Boolval* val = static_cast<Boolval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_SWITCH) {
+            Boolval* val = static_cast<Boolval*>(param.widget);
             if (val) {
                 QCheckBox *box = val->checkBox;
                 setValue = box->checkState() == Qt::Checked ? pa.attribute("max") : pa.attribute("min") ;
             }
-        } else if (type == QLatin1String("color")) {
-            ChooseColorWidget *choosecolor = static_cast<ChooseColorWidget*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_COLOR) {
+            ChooseColorWidget *choosecolor = static_cast<ChooseColorWidget*>(param.widget);
             if (choosecolor) setValue = choosecolor->getColor();
             if (pa.hasAttribute(QStringLiteral("paramprefix"))) setValue.prepend(pa.attribute(QStringLiteral("paramprefix")));
-        } else if (type == QLatin1String("geometry")) {
-            if (m_geometryWidget) namenode.item(i).toElement().setAttribute(QStringLiteral("value"), m_geometryWidget->getValue());
-        } else if (type == QLatin1String("addedgeometry")) {
-            if (m_geometryWidget) namenode.item(i).toElement().setAttribute(QStringLiteral("value"), m_geometryWidget->getExtraValue(namenode.item(i).toElement().attribute(QStringLiteral("name"))));
-        } else if (type == QLatin1String("position")) {
-            PositionEdit *pedit = static_cast<PositionEdit*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_GEOMETRY) {
+            if (m_geometryWidget) pa.setAttribute(QStringLiteral("value"), m_geometryWidget->getValue());
+        } else if (type == PARAM_ADDEDGEOMETRY) {
+            if (m_geometryWidget) pa.setAttribute(QStringLiteral("value"), m_geometryWidget->getExtraValue(param.name));
+        } else if (type == PARAM_POSITION) {
+            PositionEdit *pedit = static_cast<PositionEdit*>(param.widget);
             int pos = 0; if (pedit) pos = pedit->getPosition();
             setValue = QString::number(pos);
             if (m_effect.attribute(QStringLiteral("id")) == QLatin1String("fadein") || m_effect.attribute(QStringLiteral("id")) == QLatin1String("fade_from_black")) {
@@ -1027,8 +1133,8 @@ void ParameterContainer::slotCollectAllParameters()
                     pos = m_out;
                     pedit->setPosition(pos);
                 }*/
-                EffectsList::setParameter(m_effect, QStringLiteral("in"), QString::number(m_in));
-                EffectsList::setParameter(m_effect, QStringLiteral("out"), QString::number(m_in + pos));
+                setParameterValue(QStringLiteral("in"), QString::number(m_in));
+                setParameterValue(QStringLiteral("out"), QString::number(m_in + pos));
                 setValue.clear();
             } else if (m_effect.attribute(QStringLiteral("id")) == QLatin1String("fadeout") || m_effect.attribute(QStringLiteral("id")) == QLatin1String("fade_to_black")) {
                 // Make sure duration is not longer than clip
@@ -1036,12 +1142,12 @@ void ParameterContainer::slotCollectAllParameters()
                     pos = m_out;
                     pedit->setPosition(pos);
                 }*/
-                EffectsList::setParameter(m_effect, QStringLiteral("in"), QString::number(m_out - pos));
-                EffectsList::setParameter(m_effect, QStringLiteral("out"), QString::number(m_out));
+                setParameterValue(QStringLiteral("in"), QString::number(m_out - pos));
+                setParameterValue(QStringLiteral("out"), QString::number(m_out));
                 setValue.clear();
             }
-        } else if (type == QLatin1String("curve")) {
-            KisCurveWidget *curve = static_cast<KisCurveWidget*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_CURVE) {
+            KisCurveWidget *curve = static_cast<KisCurveWidget*>(param.widget);
             if (curve) {
                 QList<QPointF> points = curve->curve().points();
                 QString number = pa.attribute(QStringLiteral("number"));
@@ -1049,39 +1155,32 @@ void ParameterContainer::slotCollectAllParameters()
                 QString outName = pa.attribute(QStringLiteral("outpoints"));
                 int off = pa.attribute(QStringLiteral("min")).toInt();
                 int end = pa.attribute(QStringLiteral("max")).toInt();
-                double version = 0;
-                QDomElement namenode = m_effect.firstChildElement(QStringLiteral("version"));
-                if (!namenode.isNull()) {
-                    version = locale.toDouble(namenode.text());
-                }
-                if (version > 0.2) {
-                    EffectsList::setParameter(m_effect, number, locale.toString(points.count() / 10.));
+                if (m_version > 0.2) {
+                    setParameterValue(number, locale.toString(points.count() / 10.));
                 } else {
-                    EffectsList::setParameter(m_effect, number, QString::number(points.count()));
+                    setParameterValue(number, QString::number(points.count()));
                 }
                 for (int j = 0; (j < points.count() && j + off <= end); ++j) {
                     QString in = inName;
                     in.replace(QLatin1String("%i"), QString::number(j + off));
                     QString out = outName;
                     out.replace(QLatin1String("%i"), QString::number(j + off));
-                    EffectsList::setParameter(m_effect, in, locale.toString(points.at(j).x()));
-                    EffectsList::setParameter(m_effect, out, locale.toString(points.at(j).y()));
+                    setParameterValue(in, locale.toString(points.at(j).x()));
+                    setParameterValue(out, locale.toString(points.at(j).y()));
                 }
             }
-            QString depends = pa.attribute(QStringLiteral("depends"));
-            if (!depends.isEmpty())
-                meetDependency(paramName, type, EffectsList::parameter(m_effect, depends));
-        } else if (type == QLatin1String("bezier_spline")) {
-            BezierSplineWidget *widget = static_cast<BezierSplineWidget*>(m_valueItems.value(paramName));
+            if (!param.depends.isEmpty())
+                meetDependency(param.widget, type, parameterValue(param.depends));
+        } else if (type == PARAM_BEZIER) {
+            BezierSplineWidget *widget = static_cast<BezierSplineWidget*>(param.widget);
             if (widget) setValue = widget->spline();
-            QString depends = pa.attribute(QStringLiteral("depends"));
-            if (!depends.isEmpty())
-                meetDependency(paramName, type, EffectsList::parameter(m_effect, depends));
-        } else if (type == QLatin1String("roto-spline")) {
-            RotoWidget *widget = static_cast<RotoWidget *>(m_valueItems.value(paramName));
+            if (!param.depends.isEmpty())
+                meetDependency(param.widget, type, parameterValue(param.depends));
+        } else if (type == PARAM_ROTO) {
+            RotoWidget *widget = static_cast<RotoWidget *>(param.widget);
             if (widget) setValue = widget->getSpline();
-        } else if (type == QLatin1String("wipe")) {
-            Wipeval *wp = static_cast<Wipeval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_WIPE) {
+            Wipeval *wp = static_cast<Wipeval*>(param.widget);
             if (wp) {
                 wipeInfo info;
                 if (wp->start_left->isChecked())
@@ -1114,21 +1213,20 @@ void ParameterContainer::slotCollectAllParameters()
 
                 setValue = getWipeString(info);
             }
-        } else if ((type == QLatin1String("simplekeyframe") || type == QLatin1String("keyframe")) && m_keyframeEditor) {
-            QString realName = i18n(na.toElement().text().toUtf8().data());
-            QString val = m_keyframeEditor->getValue(realName);
+        } else if ((type == PARAM_SIMPLEKEYFRAME || type == PARAM_KEYFRAME) && m_keyframeEditor) {
+            QString val = m_keyframeEditor->getValue(param.keyframeName);
             pa.setAttribute(m_keyframeEditor->getTag(), val);
 
-            if (m_keyframeEditor->isVisibleParam(realName)) {
+            if (m_keyframeEditor->isVisibleParam(param.keyframeName)) {
                 pa.setAttribute(QStringLiteral("intimeline"), QStringLiteral("1"));
 	    }
             else if (pa.hasAttribute(QStringLiteral("intimeline")))
                 pa.setAttribute(QStringLiteral("intimeline"), QStringLiteral("0"));
-        } else if (type == QLatin1String("url")) {
-            KUrlRequester *req = static_cast<Urlval*>(m_valueItems.value(paramName))->urlwidget;
+        } else if (type == PARAM_URL) {
+            KUrlRequester *req = static_cast<Urlval*>(param.widget)->urlwidget;
             if (req) setValue = req->url().path();
-        } else if (type == QLatin1String("keywords")) {
-            Keywordval* val = static_cast<Keywordval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_KEYWORDS) {
+            Keywordval* val = static_cast<Keywordval*>(param.widget);
             if (val) {
                 QLineEdit *line = val->lineeditwidget;
                 KComboBox *combo = val->comboboxwidget;
@@ -1139,8 +1237,8 @@ void ParameterContainer::slotCollectAllParameters()
                 }
                 setValue = line->text();
             }
-        } else if (type == QLatin1String("fontfamily")) {
-            Fontval* val = static_cast<Fontval*>(m_valueItems.value(paramName));
+        } else if (type == PARAM_FONT) {
+            Fontval* val = static_cast<Fontval*>(param.widget);
             if (val) {
                 QFontComboBox* fontfamily = val->fontfamilywidget;
                 setValue = fontfamily->currentFont().family();
@@ -1232,11 +1330,9 @@ void ParameterContainer::slotStartFilterJobAction()
             return;
         }
     }
-    QDomNodeList namenode = m_effect.elementsByTagName(QStringLiteral("parameter"));
-    for (int i = 0; i < namenode.count() ; ++i) {
-        QDomElement pa = namenode.item(i).toElement();
-        QString type = pa.attribute(QStringLiteral("type"));
-        if (type == QLatin1String("filterjob")) {
+    for (int i = 0; i < m_params.count() ; ++i) {
+        if (m_params.at(i).type == PARAM_FILTERJOB) {
+            QDomElement pa = m_params.at(i).element;
             QMap <QString, QString> filterParams;
             QMap <QString, QString> consumerParams;
             filterParams.insert(QStringLiteral("filter"), pa.attribute(QStringLiteral("filtertag")));
@@ -1314,13 +1410,10 @@ MonitorSceneType ParameterContainer::needsMonitorEffectScene() const
 void ParameterContainer::setKeyframes(const QString &tag, const QString &data)
 {
     const QDomElement oldparam = m_effect.cloneNode().toElement();
-    QDomNodeList namenode = m_effect.elementsByTagName(QStringLiteral("parameter"));
-    for (int i = 0; i < namenode.count() ; ++i) {
-        QDomElement pa = namenode.item(i).toElement();
-        if (pa.attribute(QStringLiteral("name")) == tag) {
-            pa.setAttribute(QStringLiteral("value"), data);
-            break;
-        }
+    int ix = m_paramIndex.value(tag, -1);
+    if (ix >= 0) {
+        QDomElement pa = m_params.at(ix).element;
+        pa.setAttribute(QStringLiteral("value"), data);
     }
     if (m_geometryWidget) {
         // Reload keyframes
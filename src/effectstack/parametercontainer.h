@@ -23,6 +23,9 @@
 #include "keyframeedit.h"
 
 #include <QLabel>
+#include <QTimer>
+#include <QHash>
+#include <QVector>
 
 class GeometryWidget;
 class AnimationWidget;
@@ -56,6 +59,48 @@ struct wipeInfo {
     int endTransparency;
 };
 
+/** @brief Parameter types handled by the container, see effects/README */
+enum PARAMTYPE {
+        PARAM_UNKNOWN = 0,
+        PARAM_DOUBLE,
+        PARAM_LIST,
+        PARAM_BOOL,
+        PARAM_SWITCH,
+        PARAM_ANIMATED,
+        PARAM_ANIMATEDRECT,
+        PARAM_GEOMETRY,
+        PARAM_ADDEDGEOMETRY,
+        PARAM_KEYFRAME,
+        PARAM_SIMPLEKEYFRAME,
+        PARAM_COLOR,
+        PARAM_POSITION,
+        PARAM_CURVE,
+        PARAM_BEZIER,
+        PARAM_ROTO,
+        PARAM_WIPE,
+        PARAM_URL,
+        PARAM_KEYWORDS,
+        PARAM_FONT,
+        PARAM_FILTERJOB,
+        PARAM_FIXED
+};
+
+/** @brief A parameter of the effect, resolved once when the container is built
+ *  so that collecting values does not walk and parse the effect xml again. */
+struct CompiledParameter {
+    PARAMTYPE type;
+    /** @brief The parameter element in the effect xml */
+    QDomElement element;
+    /** @brief The MLT name of the parameter */
+    QString name;
+    /** @brief The translated name used by the keyframe editor */
+    QString keyframeName;
+    /** @brief Name of the parameter this one depends on, if any */
+    QString depends;
+    /** @brief The widget editing this parameter, NULL if there is none */
+    QWidget *widget;
+};
+
 class DraggableLabel : public QLabel
 {
     Q_OBJECT
@@ -112,6 +157,10 @@ public:
 
 private slots:
     void slotCollectAllParameters();
+    /** @brief A parameter is being dragged, schedule a preview update. */
+    void slotParameterChanging();
+    /** @brief Sends the dragged parameter values for preview, without changing the effect. */
+    void slotPreviewParameters();
     void slotStartFilterJobAction();
     void toggleSync(bool enable);
     /** @brief Copy parameter value to clipboard. */
@@ -119,11 +168,17 @@ private slots:
     void makeDrag(const QString &name);
 
 private:
-        /** @brief Updates parameter @param name according to new value of dependency.
-    * @param name Name of the parameter which will be updated
+        /** @brief Updates parameter widget @param widget according to new value of dependency.
+    * @param widget Widget of the parameter which will be updated
     * @param type Type of the parameter which will be updated
     * @param value Value of the dependency parameter */
-    void meetDependency(const QString& name, const QString &type, const QString &value);
+    void meetDependency(QWidget *widget, PARAMTYPE type, const QString &value);
+    /** @brief Builds the parameter index from the effect xml, once all widgets are created. */
+    void compileParameters();
+    /** @brief Returns the value of parameter @param name, like EffectsList::parameter but without walking the xml. */
+    QString parameterValue(const QString &name) const;
+    /** @brief Sets the value of parameter @param name, like EffectsList::setParameter but without walking the xml. */
+    void setParameterValue(const QString &name, const QString &value);
     wipeInfo getWipeInfo(QString value);
     QString getWipeString(wipeInfo info);
     /** @brief Delete all child widgets */
@@ -133,6 +188,14 @@ private:
     ItemInfo m_info;
     QList<QWidget*> m_uiItems;
     QMap<QString, QWidget*> m_valueItems;
+    /** @brief The effect parameters, in xml order */
+    QVector<CompiledParameter> m_params;
+    /** @brief Index of the first parameter with a given MLT name in m_params */
+    QHash<QString, int> m_paramIndex;
+    /** @brief Indexes in m_params of the double parameters sent during a drag preview */
+    QVector<int> m_previewParams;
+    /** @brief Value of the effect's version element, used by curve parameters */
+    double m_version;
     QList<QWidget*> m_conditionalWidgets;
     KeyframeEdit *m_keyframeEditor;
     GeometryWidget *m_geometryWidget;
@@ -143,9 +206,13 @@ private:
     bool m_acceptDrops;
     MonitorSceneType m_monitorEffectScene;
     bool m_conditionParameter;
+    /** @brief Limits preview updates during a drag to one per frame */
+    QTimer m_previewTimer;
 
 signals:
     void parameterChanged(const QDomElement &, const QDomElement&, int);
+    /** @brief Parameters are being edited, apply them to the filter without undo entry. */
+    void parameterPreview(const QDomElement &, int);
     void syncEffectsPos(int);
     void displayMessage(const QString&, int);
     void disableCurrentFilter(bool);
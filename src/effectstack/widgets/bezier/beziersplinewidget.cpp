@@ -23,16 +23,26 @@
 #include "utils/KoIconUtils.h"
 
 #include <QVBoxLayout>
+#include <QtConcurrent>
 
 #include <QIcon>
 #include <QLabel>
 #include <klocalizedstring.h>
 
+/** @brief Draws the editor background for @param mode, ModeHue shows the hue shift plane. */
+static QImage renderPlane(int mode, const QSize &size, QRgb background)
+{
+    if (mode == BezierSplineWidget::ModeHue) {
+        return ColorTools::hsvCurvePlane(size, QColor::fromHsv(200, 200, 200), ColorTools::COM_H, ColorTools::COM_H);
+    }
+    return ColorTools::rgbCurvePlane(size, static_cast<ColorTools::ColorsRGB>(mode), 1, background);
+}
 
 BezierSplineWidget::BezierSplineWidget(const QString& spline, QWidget* parent) :
         QWidget(parent),
         m_mode(ModeRGB),
-        m_showPixmap(false)
+        m_showPixmap(false),
+        m_planeOutdated(false)
 {
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->addWidget(&m_edit);
@@ -47,6 +57,7 @@ BezierSplineWidget::BezierSplineWidget(const QString& spline, QWidget* parent) :
     m_ui.buttonShowPixmap->setIcon(QIcon(QPixmap::fromImage(ColorTools::rgbCurvePlane(QSize(16, 16), ColorTools::COL_Luma, 0.8))));
     m_ui.buttonResetSpline->setIcon(KoIconUtils::themedIcon(QStringLiteral("view-refresh")));
     m_ui.buttonShowAllHandles->setIcon(KoIconUtils::themedIcon(QStringLiteral("draw-bezier-curves")));
+    connect(&m_planeWatcher, &QFutureWatcher<QImage>::finished, this, &BezierSplineWidget::slotPlaneReady);
     m_ui.widgetPoint->setEnabled(false);
 
     m_pX = new DragValue(i18n("In"), 0, 3, 0, 1, -1, QString(), false, this);
@@ -123,12 +134,32 @@ void BezierSplineWidget::slotShowPixmap(bool show)
 {
     m_showPixmap = show;
     KdenliveSettings::setBezier_showpixmap(show);
-    if (show && (int)m_mode < 6)
-        m_edit.setPixmap(QPixmap::fromImage(ColorTools::rgbCurvePlane(m_edit.size(), static_cast<ColorTools::ColorsRGB>(m_mode), 1, palette().background().color().rgb())));
-    else if (show && m_mode == ModeHue)
-        m_edit.setPixmap(QPixmap::fromImage(ColorTools::hsvCurvePlane(m_edit.size(), QColor::fromHsv(200, 200, 200), ColorTools::COM_H, ColorTools::COM_H)));
-    else
+    if (show && ((int)m_mode < 6 || m_mode == ModeHue)) {
+        requestPlane();
+    } else {
+        // A running request is dropped when it is done
+        m_planeOutdated = m_planeWatcher.isRunning();
         m_edit.setPixmap(QPixmap());
+    }
+}
+
+void BezierSplineWidget::requestPlane()
+{
+    if (m_planeWatcher.isRunning()) {
+        m_planeOutdated = true;
+        return;
+    }
+    m_planeOutdated = false;
+    m_planeWatcher.setFuture(QtConcurrent::run(renderPlane, (int) m_mode, m_edit.size(), palette().background().color().rgb()));
+}
+
+void BezierSplineWidget::slotPlaneReady()
+{
+    if (!m_planeOutdated) {
+        m_edit.setPixmap(QPixmap::fromImage(m_planeWatcher.result()));
+    } else if (m_showPixmap && ((int)m_mode < 6 || m_mode == ModeHue)) {
+        requestPlane();
+    }
 }
 
 void BezierSplineWidget::slotUpdatePointEntries(const BPoint &p)
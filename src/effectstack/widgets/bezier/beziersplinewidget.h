@@ -24,6 +24,7 @@
 #include "ui_bezierspline_ui.h"
 
 #include <QWidget>
+#include <QFutureWatcher>
 
 class DragValue;
 
@@ -72,6 +73,8 @@ private slots:
     void slotSetHandlesLinked(bool linked);
 
     void slotShowAllHandles(bool show);
+    /** @brief The background plane was rendered, shows it unless a newer one was requested meanwhile. */
+    void slotPlaneReady();
 
 private:
     Ui::BezierSpline_UI m_ui;
@@ -84,6 +87,13 @@ private:
     BezierSplineEditor m_edit;
     CurveModes m_mode;
     bool m_showPixmap;
+    /** Renders the background plane in a worker thread, the editor keeps showing the previous one meanwhile */
+    QFutureWatcher<QImage> m_planeWatcher;
+    /** The mode or visibility changed while m_planeWatcher was running */
+    bool m_planeOutdated;
+
+    /** @brief Requests the background plane for the current mode. */
+    void requestPlane();
 
 signals:
     void modified();
@@ -19,7 +19,63 @@
  */
 
 #include "colorwheel.h"
+#include "colortools.h"
 #include <qmath.h>
+#include <QtConcurrent>
+
+/** @brief Draws the hue/saturation wheel of diameter @param r and the value slider of width @param sliderWidth.
+    Neither depends on the selected colour, so the image only has to be drawn again when the size changes. */
+static QImage renderWheel(const QSize &size, int r, int margin, int sliderWidth)
+{
+    const QString key = QStringLiteral("colorwheel %1x%2 %3 %4 %5").arg(size.width()).arg(size.height()).arg(r).arg(margin).arg(sliderWidth);
+    QImage image = ColorTools::cachedPlane(key);
+    if (!image.isNull()) {
+        return image;
+    }
+    image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(0); // transparent
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QConicalGradient conicalGradient;
+    conicalGradient.setColorAt(        0.0, Qt::red);
+    conicalGradient.setColorAt( 60.0/360.0, Qt::yellow);
+    conicalGradient.setColorAt(135.0/360.0, Qt::green);
+    conicalGradient.setColorAt(180.0/360.0, Qt::cyan);
+    conicalGradient.setColorAt(240.0/360.0, Qt::blue);
+    conicalGradient.setColorAt(315.0/360.0, Qt::magenta);
+    conicalGradient.setColorAt(        1.0, Qt::red);
+
+    QRadialGradient radialGradient(0.0, 0.0, r/2);
+    radialGradient.setColorAt(0.0, Qt::white);
+    radialGradient.setColorAt(1.0, Qt::transparent);
+
+    painter.translate(r / 2, r / 2 );
+    painter.rotate(-105);
+
+    QBrush hueBrush(conicalGradient);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(hueBrush);
+    painter.drawEllipse(QPoint(0, 0), r/2-margin, r/2-margin);
+
+    QBrush saturationBrush(radialGradient);
+    painter.setBrush(saturationBrush);
+    painter.drawEllipse(QPoint(0, 0), r/2-margin, r/2-margin);
+
+    // Value slider
+    painter.resetTransform();
+    const int h = r - margin * 2;
+    QLinearGradient gradient(0, 0, sliderWidth, h);
+    gradient.setColorAt(0.0, Qt::white);
+    gradient.setColorAt(1.0, Qt::black);
+    painter.setBrush(QBrush(gradient));
+    painter.translate(r, margin);
+    painter.drawRect(0, 0, sliderWidth, h);
+    painter.end();
+
+    ColorTools::storePlane(key, image);
+    return image;
+}
 
 ColorWheel::ColorWheel(QString id, QString name, QColor color, QWidget *parent)
     : QWidget(parent)
@@ -30,6 +86,7 @@ ColorWheel::ColorWheel(QString id, QString name, QColor color, QWidget *parent)
     , m_isInWheel(false)
     , m_isInSquare(false)
     , m_name(name)
+    , m_imageOutdated(false)
 {
     QFontInfo info(font());
     m_unitSize = info.pixelSize();
@@ -39,6 +96,7 @@ ColorWheel::ColorWheel(QString id, QString name, QColor color, QWidget *parent)
     setMinimumSize(100, 100);
     setMaximumSize(m_initialSize);
     setCursor(Qt::CrossCursor);
+    connect(&m_imageWatcher, &QFutureWatcher<QImage>::finished, this, &ColorWheel::slotImageReady);
 }
 
 QColor ColorWheel::color()
@@ -56,9 +114,15 @@ int ColorWheel::wheelSize() const
     return qMin(width() - m_sliderWidth, height() - m_unitSize);
 }
 
+int ColorWheel::sliderBarWidth() const
+{
+    qreal scale = qreal(wheelSize() + m_sliderWidth) / maximumWidth();
+    return m_sliderWidth * scale;
+}
+
 QColor ColorWheel::colorForPoint(const QPoint &point)
 {
-    if (! m_image.valid(point)) return QColor();
+    if (! rect().contains(point)) return QColor();
     if (m_isInWheel) {
         qreal w = wheelSize();
         qreal xf = qreal(point.x()) / w;
@@ -153,11 +217,34 @@ void ColorWheel::mouseReleaseEvent(QMouseEvent *event)
 
 void ColorWheel::resizeEvent(QResizeEvent *event)
 {
-    m_image = QImage(event->size(), QImage::Format_ARGB32_Premultiplied);
-    m_image.fill(palette().background().color().rgb());
+    Q_UNUSED(event)
+    updateWheel();
+    update();
+}
 
-    drawWheel();
-    drawSlider();
+void ColorWheel::updateWheel()
+{
+    int r = wheelSize();
+    m_wheelRegion = QRegion(r/2, r/2, r-2*m_margin, r-2*m_margin, QRegion::Ellipse);
+    m_wheelRegion.translate(-(r-2*m_margin)/2, -(r-2*m_margin)/2);
+    m_sliderRegion = QRegion(r, m_margin, sliderBarWidth(), r - m_margin * 2);
+
+    if (m_imageWatcher.isRunning()) {
+        // Only the newest size is rendered once the running request is done
+        m_imageOutdated = true;
+        return;
+    }
+    m_imageOutdated = false;
+    m_imageWatcher.setFuture(QtConcurrent::run(renderWheel, size(), r, m_margin, sliderBarWidth()));
+}
+
+void ColorWheel::slotImageReady()
+{
+    // An outdated image is still closer to the current size than the previous one
+    m_image = m_imageWatcher.result();
+    if (m_imageOutdated) {
+        updateWheel();
+    }
     update();
 }
 
@@ -181,7 +268,16 @@ void ColorWheel::paintEvent(QPaintEvent *event)
 //    QStyleOption opt;
 //    opt.init(this);
     painter.setRenderHint(QPainter::Antialiasing);
-    painter.drawImage(0, 0, m_image);
+    if (m_image.size() == size()) {
+        painter.drawImage(0, 0, m_image);
+    } else if (!m_image.isNull()) {
+        // Placeholder until the image for the new size is ready
+        const int r = wheelSize();
+        const int previous = qMin(m_image.width() - m_sliderWidth, m_image.height() - m_unitSize);
+        if (previous > 0) {
+            painter.drawImage(QRectF(0, 0, m_image.width() * r / previous, m_image.height() * r / previous), m_image);
+        }
+    }
     //painter.drawRect(0, 0, width(), height());
     painter.drawText(m_margin, wheelSize() + m_unitSize - m_margin, m_name + " " + getParamValues());
     drawWheelDot(painter);
@@ -189,61 +285,6 @@ void ColorWheel::paintEvent(QPaintEvent *event)
 //    style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
 }
 
-void ColorWheel::drawWheel()
-{
-    int r = wheelSize();
-    QPainter painter(&m_image);
-    painter.setRenderHint(QPainter::Antialiasing);
-    m_image.fill(0); // transparent
-
-    QConicalGradient conicalGradient;
-    conicalGradient.setColorAt(        0.0, Qt::red);
-    conicalGradient.setColorAt( 60.0/360.0, Qt::yellow);
-    conicalGradient.setColorAt(135.0/360.0, Qt::green);
-    conicalGradient.setColorAt(180.0/360.0, Qt::cyan);
-    conicalGradient.setColorAt(240.0/360.0, Qt::blue);
-    conicalGradient.setColorAt(315.0/360.0, Qt::magenta);
-    conicalGradient.setColorAt(        1.0, Qt::red);
-
-    QRadialGradient radialGradient(0.0, 0.0, r/2);
-    radialGradient.setColorAt(0.0, Qt::white);
-    radialGradient.setColorAt(1.0, Qt::transparent);
-
-    painter.translate(r / 2, r / 2 );
-    painter.rotate(-105);
-
-    QBrush hueBrush(conicalGradient);
-    painter.setPen(Qt::NoPen);
-    painter.setBrush(hueBrush);
-    painter.drawEllipse(QPoint(0, 0), r/2-m_margin, r/2-m_margin);
-
-    QBrush saturationBrush(radialGradient);
-    painter.setBrush(saturationBrush);
-    painter.drawEllipse(QPoint(0, 0), r/2-m_margin, r/2-m_margin);
-
-    m_wheelRegion = QRegion(r/2, r/2, r-2*m_margin, r-2*m_margin, QRegion::Ellipse);
-    m_wheelRegion.translate(-(r-2*m_margin)/2, -(r-2*m_margin)/2);
-}
-
-void ColorWheel::drawSlider()
-{
-    QPainter painter(&m_image);
-    painter.setRenderHint(QPainter::Antialiasing);
-    int ws = wheelSize();
-    qreal scale = qreal(ws + m_sliderWidth) / maximumWidth();
-    int w = m_sliderWidth * scale;
-    int h = ws - m_margin * 2;
-    QLinearGradient gradient(0, 0, w, h);
-    gradient.setColorAt(0.0, Qt::white);
-    gradient.setColorAt(1.0, Qt::black);
-    QBrush brush(gradient);
-    painter.setPen(Qt::NoPen);
-    painter.setBrush(brush);
-    painter.translate(ws, m_margin);
-    painter.drawRect(0, 0, w, h);
-    m_sliderRegion = QRegion(ws, m_margin, w, h);
-}
-
 void ColorWheel::drawWheelDot(QPainter& painter)
 {
     int r = wheelSize() / 2;
@@ -263,8 +304,7 @@ void ColorWheel::drawSliderBar(QPainter &painter)
 {
     qreal value = 1.0 - m_color.valueF();
     int ws = wheelSize();
-    qreal scale = qreal(ws + m_sliderWidth) / maximumWidth();
-    int w = m_sliderWidth * scale;
+    int w = sliderBarWidth();
     int h = ws - m_margin * 2;
     QPen pen(Qt::white);
     pen.setWidth(2);
@@ -277,9 +317,8 @@ void ColorWheel::drawSliderBar(QPainter &painter)
 
 void ColorWheel::changeColor(const QColor &color)
 {
+    // Only the dot and the slider bar follow the colour, they are painted on top of m_image
     m_color = color;
-    drawWheel();
-    drawSlider();
     update();
     emit colorChange(m_color);
 }
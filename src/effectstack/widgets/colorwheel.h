@@ -22,6 +22,7 @@
 #include <QWidget>
 #include <QPainter>
 #include <QResizeEvent>
+#include <QFutureWatcher>
 
 class ColorWheel : public QWidget
 {
@@ -62,14 +63,22 @@ private:
     bool m_isInSquare;
     int m_unitSize;
     QString m_name;
+    /** @brief Renders m_image in a worker thread, the last image is shown scaled meanwhile. */
+    QFutureWatcher<QImage> m_imageWatcher;
+    /** @brief The size changed while m_imageWatcher was running, its result is outdated. */
+    bool m_imageOutdated;
 
     int wheelSize() const;
+    int sliderBarWidth() const;
     QColor colorForPoint(const QPoint &point);
-    void drawWheel();
+    /** @brief Updates the wheel and slider regions and requests their image for the current size. */
+    void updateWheel();
     void drawWheelDot(QPainter &painter);
     void drawSliderBar(QPainter &painter);
-    void drawSlider();
     QString getParamValues();
+
+private slots:
+    void slotImageReady();
 };
 
 #endif // COLORWHEEL_H
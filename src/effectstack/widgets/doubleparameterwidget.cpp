@@ -90,7 +90,11 @@ void DoubleParameterWidget::slotSetValue(double value, bool final)
     if (m_radio && !m_radio->isChecked())
         m_radio->setChecked(true);
     if (final) {
-        emit valueChanged(value);
+        if (m_dragVal->isDragging()) {
+            emit valueChanging(value);
+        } else {
+            emit valueChanged(value);
+        }
     }
 }
 
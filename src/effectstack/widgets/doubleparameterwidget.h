@@ -86,6 +86,8 @@ private:
     
 signals:
     void valueChanged(double);
+    /** @brief The value is being dragged, valueChanged will be emitted on release. */
+    void valueChanging(double);
     /** @brief User wants to see this parameter in timeline (old way). */
     void setInTimeline(int);
     /** @brief User wants to see this parameter in timeline. */
@@ -31,18 +31,19 @@
 #include <QCheckBox>
 #include <QSpinBox>
 #include <QPainter>
+#include <QtConcurrent>
 
 #include "klocalizedstring.h"
 
 #include "keyframeimport.h"
 #include "effectstack/positionedit.h"
-#include "timeline/keyframeview.h"
 
 KeyframeImport::KeyframeImport(ItemInfo srcInfo, ItemInfo dstInfo, QMap<QString, QString> data, const Timecode &tc, QDomElement xml, ProfileInfo profile, QWidget *parent) :
     QDialog(parent)
     , m_xml(xml)
     , m_profile(profile)
     , m_supportsAnim(false)
+    , m_simplifyPending(false)
 {
     QVBoxLayout *lay = new QVBoxLayout(this);
     QHBoxLayout *l1 = new QHBoxLayout;
@@ -75,9 +76,11 @@ KeyframeImport::KeyframeImport(ItemInfo srcInfo, ItemInfo dstInfo, QMap<QString,
     else
         reference = dstInfo;
     m_inPoint = new PositionEdit(i18n("In"), reference.cropStart.frames(tc.fps()), reference.cropStart.frames(tc.fps()), (reference.cropStart + reference.cropDuration).frames(tc.fps()), tc, this);
+    connect(m_inPoint, SIGNAL(parameterChanged(int)), this, SLOT(updateSimplification()));
     connect(m_inPoint, SIGNAL(parameterChanged(int)), this, SLOT(updateDisplay()));
     lay->addWidget(m_inPoint);
     m_outPoint = new PositionEdit(i18n("Out"), (reference.cropStart + reference.cropDuration).frames(tc.fps()), reference.cropStart.frames(tc.fps()), (reference.cropStart + reference.cropDuration).frames(tc.fps()), tc, this);
+    connect(m_outPoint, SIGNAL(parameterChanged(int)), this, SLOT(updateSimplification()));
     connect(m_outPoint, SIGNAL(parameterChanged(int)), this, SLOT(updateDisplay()));
     lay->addWidget(m_outPoint);
 
@@ -123,6 +126,7 @@ KeyframeImport::KeyframeImport(ItemInfo srcInfo, ItemInfo dstInfo, QMap<QString,
         m_sourceCombo->setItemData(ix, QString::number(3), Qt::UserRole);
         ix++;
     }
+    connect(m_sourceCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(updateSimplification()));
     connect(m_sourceCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(updateRange()));
     m_alignCombo = new QComboBox(this);
     m_alignCombo->addItems(QStringList() << i18n("Align top left") << i18n("Align center") << i18n("Align bottom right"));
@@ -195,6 +199,34 @@ KeyframeImport::KeyframeImport(ItemInfo srcInfo, ItemInfo dstInfo, QMap<QString,
     connect(m_limitKeyframes, &QCheckBox::toggled, m_limitNumber, &QSpinBox::setEnabled);
     connect(m_limitKeyframes, SIGNAL(toggled(bool)), this, SLOT(updateDisplay()));
     connect(m_limitNumber, SIGNAL(valueChanged(int)), this, SLOT(updateDisplay()));
+
+    // Tracking data simplification
+    l1 = new QHBoxLayout;
+    m_simplify = new QCheckBox(i18n("Simplify curves"), this);
+    m_simplify->setToolTip(i18n("Remove keyframes that can be interpolated from their neighbours within the tolerance"));
+    m_tolerance = new QDoubleSpinBox(this);
+    m_tolerance->setRange(0.1, 100);
+    m_tolerance->setSingleStep(0.5);
+    m_tolerance->setValue(1);
+    m_tolerance->setSuffix(i18n(" px"));
+    m_tolerance->setEnabled(false);
+    m_simplifyLabel = new QLabel(this);
+    l1->addWidget(m_simplify);
+    l1->addWidget(m_tolerance);
+    l1->addWidget(m_simplifyLabel);
+    l1->addStretch(10);
+    lay->addLayout(l1);
+    connect(m_simplify, &QCheckBox::toggled, m_tolerance, &QDoubleSpinBox::setEnabled);
+    // Simplification and keyframe limit are exclusive
+    connect(m_simplify, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked) m_limitKeyframes->setChecked(false);
+    });
+    connect(m_limitKeyframes, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked) m_simplify->setChecked(false);
+    });
+    connect(m_simplify, SIGNAL(toggled(bool)), this, SLOT(updateSimplification()));
+    connect(m_tolerance, SIGNAL(valueChanged(double)), this, SLOT(updateSimplification()));
+    connect(&m_simplifyWatcher, SIGNAL(finished()), this, SLOT(slotSimplificationReady()));
     connect(m_dataCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(updateDataDisplay()));
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
     connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -206,6 +238,7 @@ KeyframeImport::KeyframeImport(ItemInfo srcInfo, ItemInfo dstInfo, QMap<QString,
 
 KeyframeImport::~KeyframeImport()
 {
+    m_simplifyWatcher.waitForFinished();
 }
 
 void KeyframeImport::resizeEvent(QResizeEvent *ev)
@@ -243,6 +276,57 @@ void KeyframeImport::updateDataDisplay()
         m_inPoint->blockSignals(false);
         m_outPoint->blockSignals(false);
     }
+    updateSimplification();
+}
+
+int KeyframeImport::sourceChannels() const
+{
+    switch (m_sourceCombo->currentData().toInt()) {
+        case 0:
+            return KeyframeView::ChannelX;
+        case 1:
+            return KeyframeView::ChannelY;
+        case 2:
+            return KeyframeView::ChannelWidth;
+        case 3:
+            return KeyframeView::ChannelHeight;
+        case 11:
+            return KeyframeView::ChannelX | KeyframeView::ChannelY;
+        default:
+            return KeyframeView::ChannelX | KeyframeView::ChannelY | KeyframeView::ChannelWidth | KeyframeView::ChannelHeight;
+    }
+}
+
+void KeyframeImport::updateSimplification()
+{
+    if (!m_simplify->isChecked()) {
+        m_keptFrames.clear();
+        m_simplifyPending = false;
+        m_simplifyLabel->clear();
+        updateDisplay();
+        return;
+    }
+    if (m_simplifyWatcher.isRunning()) {
+        // Restart with the new settings when the current run is finished
+        m_simplifyPending = true;
+        return;
+    }
+    m_simplifyPending = false;
+    m_simplifyLabel->setText(i18n("Simplifying..."));
+    KeyframeSamples samples = m_keyframeView->sampleKeyframes(m_inPoint->getPosition(), m_outPoint->getPosition());
+    m_simplifyWatcher.setFuture(QtConcurrent::run(&KeyframeView::simplifyKeyframes, samples, sourceChannels(), m_tolerance->value()));
+}
+
+void KeyframeImport::slotSimplificationReady()
+{
+    if (m_simplifyPending || !m_simplify->isChecked()) {
+        updateSimplification();
+        return;
+    }
+    KeyframeSimplification result = m_simplifyWatcher.result();
+    m_keptFrames = result.frames;
+    m_simplifyLabel->setText(i18n("%1 of %2 keyframes, maximum error %3 px", result.frames.count(), result.sourceCount, QString::number(result.error, 'f', 2)));
+    updateDisplay();
 }
 
 void KeyframeImport::updateRange()
@@ -383,13 +467,23 @@ void KeyframeImport::updateDisplay()
             }
         }
     }
-    m_keyframeView->drawKeyFrameChannels(pix.rect(), m_inPoint->getPosition(), m_outPoint->getPosition(), painter, maximas, m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, palette().text().color());
+    m_keyframeView->drawKeyFrameChannels(pix.rect(), m_inPoint->getPosition(), m_outPoint->getPosition(), painter, maximas, m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, palette().text().color(), m_simplify->isChecked() ? m_keptFrames : QVector <int>());
     painter->end();
     m_previewLabel->setPixmap(pix);
 }
 
 QString KeyframeImport::selectedData() const
 {
+    QVector <int> keptFrames;
+    if (m_simplify->isChecked()) {
+        if (m_simplifyPending || m_simplifyWatcher.isRunning()) {
+            // Settings changed since last preview, simplify now
+            KeyframeSamples samples = m_keyframeView->sampleKeyframes(m_inPoint->getPosition(), m_outPoint->getPosition());
+            keptFrames = KeyframeView::simplifyKeyframes(samples, sourceChannels(), m_tolerance->value()).frames;
+        } else {
+            keptFrames = m_keptFrames;
+        }
+    }
     // return serialized keyframes
     if (m_simpleTargets.contains(m_targetCombo->currentText())) {
         // Exporting a 1 dimension animation
@@ -404,7 +498,7 @@ QString KeyframeImport::selectedData() const
             // Height maximas
             maximas = QPoint(qMin(m_maximas.at(ix).x(), 0), qMax(m_maximas.at(ix).y(), m_profile.profileSize.height()));
         }
-        return m_keyframeView->getSingleAnimation(ix, m_inPoint->getPosition(), m_outPoint->getPosition(), m_offsetPoint->getPosition(), m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, maximas, m_destMin.value(), m_destMax.value());
+        return m_keyframeView->getSingleAnimation(ix, m_inPoint->getPosition(), m_outPoint->getPosition(), m_offsetPoint->getPosition(), m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, maximas, m_destMin.value(), m_destMax.value(), keptFrames);
     }
     // Geometry target
     int pos = m_sourceCombo->currentData().toInt();
@@ -420,7 +514,7 @@ QString KeyframeImport::selectedData() const
         default:
             break;
     }
-    return m_keyframeView->getOffsetAnimation(m_inPoint->getPosition(), m_outPoint->getPosition(), m_offsetPoint->getPosition(), m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, m_profile, m_supportsAnim, pos == 11, rectOffset);
+    return m_keyframeView->getOffsetAnimation(m_inPoint->getPosition(), m_outPoint->getPosition(), m_offsetPoint->getPosition(), m_limitKeyframes->isChecked() ? m_limitNumber->value() : 0, m_profile, m_supportsAnim, pos == 11, rectOffset, keptFrames);
 }
 
 QString KeyframeImport::selectedTarget() const
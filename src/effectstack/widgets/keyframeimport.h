@@ -25,14 +25,15 @@
 #include <QDialog>
 #include <QPixmap>
 #include <QLabel>
+#include <QFutureWatcher>
 
 #include "definitions.h"
 #include "timecode.h"
+#include "timeline/keyframeview.h"
 
 class PositionEdit;
 class QCheckBox;
 class QSpinBox;
-class KeyframeView;
 
 class KeyframeImport : public QDialog
 {
@@ -56,6 +57,15 @@ private:
     QCheckBox *m_limitRange;
     QCheckBox *m_limitKeyframes;
     QSpinBox *m_limitNumber;
+    QCheckBox *m_simplify;
+    QDoubleSpinBox *m_tolerance;
+    QLabel *m_simplifyLabel;
+    /** @brief Simplifies the tracking curves in a thread */
+    QFutureWatcher <KeyframeSimplification> m_simplifyWatcher;
+    /** @brief True if the settings changed while a simplification was running */
+    bool m_simplifyPending;
+    /** @brief Source frames kept by the last simplification */
+    QVector <int> m_keptFrames;
     QComboBox *m_sourceCombo;
     QComboBox *m_targetCombo;
     QComboBox *m_alignCombo;
@@ -67,6 +77,8 @@ private:
     QMap <QString, QString> m_geometryTargets;
     /** @brief Contains the 1 dimensional target parameter names / tag **/
     QMap <QString, QString> m_simpleTargets;
+    /** @brief Returns the KeyframeView channels used by the selected source */
+    int sourceChannels() const;
 
 protected:
     void resizeEvent(QResizeEvent *ev);
@@ -76,6 +88,9 @@ private slots:
     void updateDisplay();
     void updateRange();
     void updateDestinationRange();
+    /** @brief Starts simplifying the selected curves with current tolerance */
+    void updateSimplification();
+    void slotSimplificationReady();
 };
 
 #endif
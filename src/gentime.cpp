@@ -19,19 +19,18 @@
 
 double GenTime::s_delta = 0.00001;
 
-GenTime::GenTime()
+GenTime::GenTime() :
+    m_time(0.0),
+    m_frame(0),
+    m_fps(0)
 {
-    m_time = 0.0;
 }
 
-GenTime::GenTime(double seconds)
+GenTime::GenTime(double seconds) :
+    m_time(seconds),
+    m_frame(0),
+    m_fps(0)
 {
-    m_time = seconds;
-}
-
-GenTime::GenTime(int frames, double framesPerSecond)
-{
-    m_time = (double) frames / framesPerSecond;
 }
 
 double GenTime::seconds() const
@@ -44,11 +43,6 @@ double GenTime::ms() const
     return m_time * 1000;
 }
 
-double GenTime::frames(double framesPerSecond) const
-{
-    return floor(m_time * framesPerSecond + 0.5);
-}
-
 QString GenTime::toString() const
 {
     return QStringLiteral("%1 s").arg(m_time, 0, 'f', 2);
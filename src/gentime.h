@@ -24,6 +24,9 @@
 /**
  * @class GenTime
  * @brief Encapsulates a time, which can be set in various forms and outputted in various forms.
+ * A time created from a frame number also keeps the exact frames / fps rational, so that timeline
+ * code converting it back to frames, adding or comparing times of the same frame rate only uses
+ * integers and never suffers from floating point rounding. Other times are stored in seconds.
  * @author Jason Wood
  */
 
@@ -37,7 +40,11 @@ public:
     explicit GenTime(double seconds);
 
     /** @brief Creates a GenTime object, by passing number of frames and how many frames per second. */
-    GenTime(int frames, double framesPerSecond);
+    GenTime(int frames, double framesPerSecond) :
+        m_time((double) frames / framesPerSecond),
+        m_frame(frames),
+        m_fps(framesPerSecond)
+    {}
 
     /** @brief Gets the time, in seconds. */
     double seconds() const;
@@ -47,7 +54,12 @@ public:
 
     /** @brief Gets the time in frames.
     * @param framesPerSecond Number of frames per second */
-    double frames(double framesPerSecond) const;
+    double frames(double framesPerSecond) const {
+        if (framesPerSecond == m_fps) {
+            return m_frame;
+        }
+        return floor(m_time * framesPerSecond + 0.5);
+    }
 
     QString toString() const;
 
@@ -58,28 +70,33 @@ public:
 
     /// Unary minus
     GenTime operator -() {
-        return GenTime(-m_time);
+        return hasFrameBase() ? GenTime(-m_frame, m_fps) : GenTime(-m_time);
     }
     
     /// Addition
     GenTime & operator+=(GenTime op) {
-        m_time += op.m_time;
+        *this = *this + op;
         return *this;
     }
 
     /// Subtraction
     GenTime & operator-=(GenTime op) {
-        m_time -= op.m_time;
+        *this = *this - op;
         return *this;
     }
 
     /** @brief Adds two GenTimes. */
     GenTime operator+(GenTime op) const {
+        if (sameFrameBase(op)) return GenTime(m_frame + op.m_frame, m_fps);
+        if (op.isNull()) return *this;
+        if (isNull()) return op;
         return GenTime(m_time + op.m_time);
     }
 
     /** @brief Subtracts one genTime from another. */
     GenTime operator-(GenTime op) const {
+        if (sameFrameBase(op)) return GenTime(m_frame - op.m_frame, m_fps);
+        if (op.isNull()) return *this;
         return GenTime(m_time - op.m_time);
     }
 
@@ -94,26 +111,32 @@ public:
     }
 
     bool operator<(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame < op.m_frame;
         return m_time + s_delta < op.m_time;
     }
 
     bool operator>(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame > op.m_frame;
         return m_time > op.m_time + s_delta;
     }
 
     bool operator>=(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame >= op.m_frame;
         return m_time + s_delta >= op.m_time;
     }
 
     bool operator<=(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame <= op.m_frame;
         return m_time <= op.m_time + s_delta;
     }
 
     bool operator==(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame == op.m_frame;
         return fabs(m_time - op.m_time) < s_delta;
     }
 
     bool operator!=(GenTime op) const {
+        if (sameFrameBase(op)) return m_frame != op.m_frame;
         return fabs(m_time - op.m_time) >= s_delta;
     }
 
@@ -121,8 +144,23 @@ private:
     /** Holds the time in seconds for this object. */
     double m_time;
 
+    /** Exact time as m_frame / m_fps for times created from frames, m_fps is 0 otherwise. */
+    int m_frame;
+    double m_fps;
+
     /** A delta value that is used to get around floating point rounding issues. */
     static double s_delta;
+
+    bool hasFrameBase() const {
+        return m_fps > 0;
+    }
+    bool sameFrameBase(const GenTime &op) const {
+        return m_fps > 0 && m_fps == op.m_fps;
+    }
+    /** @brief True for a time of 0 seconds which has no frame rate, neutral in additions of exact times. */
+    bool isNull() const {
+        return m_fps == 0 && m_time == 0;
+    }
 };
 
 #endif
@@ -21,6 +21,8 @@
 #define INTERFACES_H
 
 #include <QStringList>
+#include <QMap>
+#include <QUrl>
 
 class ClipGenerator
 {
@@ -31,8 +33,58 @@ public:
     virtual QUrl generatedClip(const QString &renderer, const QString &generator, const QUrl &projectFolder, const QStringList &lumaNames, const QStringList &lumaFiles, const double fps, const int width, const int height) = 0;
 };
 
+/** @brief Lets an asynchronous generator report its progress and check for cancellation. */
+class ClipGeneratorFeedback
+{
+public:
+    virtual ~ClipGeneratorFeedback() {}
+
+    /** @brief Report the generation progress, in percent. */
+    virtual void setProgress(int progress) = 0;
+    /** @brief Returns true if the user canceled the generation. */
+    virtual bool isCanceled() const = 0;
+};
+
+/** @brief The clip settings chosen by the user, passed from configureClip to the generation. */
+struct GeneratorSettings
+{
+    QString generator;
+    /** @brief Where the clip is rendered if it cannot be streamed. */
+    QUrl destination;
+    double fps;
+    int width;
+    int height;
+    /** @brief Generator specific parameters. */
+    QMap <QString, QString> parameters;
+};
+
+/**
+ * @class AsyncClipGenerator
+ * @brief Clip generator that does not block the user interface.
+ *
+ * Only configureClip is called in the GUI thread. The clip is then either used directly
+ * as a streaming producer or rendered by renderClip in a job thread.
+ */
+class AsyncClipGenerator
+{
+public:
+    virtual ~AsyncClipGenerator() {}
+
+    virtual QStringList generators(const QStringList&  producers = QStringList()) const = 0;
+    /** @brief Ask the user for the clip settings. Returns false if the user canceled. */
+    virtual bool configureClip(const QString &generator, const QUrl &projectFolder, const double fps, const int width, const int height, GeneratorSettings &settings) = 0;
+    /** @brief Returns the MLT service and properties of a producer generating the clip on the fly, an empty map if it has to be rendered. */
+    virtual QMap <QString, QString> streamingProducer(const GeneratorSettings &settings) const = 0;
+    /** @brief Render the clip to the settings destination, returns an empty url on failure or cancellation.
+     *  @param feedback receives the progress, checked for cancellation
+     *  @param error set to the failure reason */
+    virtual QUrl renderClip(const QString &renderer, const GeneratorSettings &settings, ClipGeneratorFeedback *feedback, QString *error) = 0;
+};
+
 Q_DECLARE_INTERFACE(ClipGenerator,
                     "com.kdenlive.ClipGenerator.ClipGeneratorInterface/1.0")
+Q_DECLARE_INTERFACE(AsyncClipGenerator,
+                    "com.kdenlive.ClipGenerator.AsyncClipGeneratorInterface/1.0")
 
 #endif
 
@@ -30,16 +30,24 @@
 //const double SPEEDS[] = {0.0, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0};
 const double SPEEDS[] = {0.0, 1.0, 2.0, 4.0, 5.0, 8.0, 16.0, 60.0};
 const size_t SPEEDS_SIZE = sizeof(SPEEDS) / sizeof(double);
+// Interval (in ms) during which jog events are collapsed into one seek
+#define JOG_COALESCE_INTERVAL 40
+// Number of jog steps in one interval above which the wheel is considered spinning fast
+#define JOG_FAST_STEPS 3
 
 JogShuttleAction::JogShuttleAction (const JogShuttle* jogShuttle, const QStringList& actionMap, QObject * parent)
-        : QObject(parent), m_jogShuttle(jogShuttle), m_actionMap(actionMap)
+        : QObject(parent), m_jogShuttle(jogShuttle), m_actionMap(actionMap), m_jogSteps(0)
 {
     // Add action map 0 used for stopping the monitor when the shuttle is in neutral position.
     if (m_actionMap.size() == 0)
       m_actionMap.append(QStringLiteral("monitor_pause"));
 
-    connect(m_jogShuttle, SIGNAL(jogBack()), pCore->monitorManager(), SLOT(slotRewindOneFrame()));
-    connect(m_jogShuttle, SIGNAL(jogForward()), pCore->monitorManager(), SLOT(slotForwardOneFrame()));
+    m_jogTimer.setSingleShot(true);
+    m_jogTimer.setInterval(JOG_COALESCE_INTERVAL);
+    connect(&m_jogTimer, SIGNAL(timeout()), SLOT(slotFlushJog()));
+    connect(m_jogShuttle, SIGNAL(jogBack()), SLOT(slotJogBack()));
+    connect(m_jogShuttle, SIGNAL(jogForward()), SLOT(slotJogForward()));
+    connect(this, SIGNAL(jog(int,bool)), pCore->monitorManager(), SLOT(slotJog(int,bool)));
     connect(m_jogShuttle, SIGNAL(shuttlePos(int)), SLOT(slotShuttlePos(int)));
     connect(m_jogShuttle, SIGNAL(button(int)), SLOT(slotButton(int)));
 
@@ -51,6 +59,41 @@ JogShuttleAction::~JogShuttleAction()
 {
 }
 
+void JogShuttleAction::slotJogBack()
+{
+    addJogStep(-1);
+}
+
+void JogShuttleAction::slotJogForward()
+{
+    addJogStep(1);
+}
+
+void JogShuttleAction::addJogStep(int step)
+{
+    if (!m_jogTimer.isActive()) {
+        // First event of a burst, seek immediately so that single steps stay responsive
+        m_jogTimer.start();
+        emit jog(step, false);
+        return;
+    }
+    if ((m_jogSteps > 0 && step < 0) || (m_jogSteps < 0 && step > 0)) {
+        // The wheel changed direction, do not merge opposite steps
+        slotFlushJog();
+    }
+    m_jogSteps += step;
+}
+
+void JogShuttleAction::slotFlushJog()
+{
+    if (m_jogSteps == 0) return;
+    int steps = m_jogSteps;
+    m_jogSteps = 0;
+    // Keep collapsing while the burst goes on
+    m_jogTimer.start();
+    emit jog(steps, abs(steps) >= JOG_FAST_STEPS);
+}
+
 void JogShuttleAction::slotShuttlePos(int shuttle_pos)
 {
     size_t magnitude = abs(shuttle_pos);
@@ -23,6 +23,7 @@
 #include "jogshuttle.h"
 #include <QObject>
 #include <QStringList>
+#include <QTimer>
 
 class JogShuttleAction: public QObject
 {
@@ -35,12 +36,24 @@ private:
     const JogShuttle* m_jogShuttle;
     // this is indexed by button ID, having QString() for any non-used ones.
     QStringList m_actionMap;
+    /** @brief Jog steps received since the last seek, negative when rewinding. */
+    int m_jogSteps;
+    /** @brief Collapses the jog events of a burst into one seek. */
+    QTimer m_jogTimer;
+    void addJogStep(int step);
 
 public slots:
     void slotShuttlePos(int);
     void slotButton(int);
 
+private slots:
+    void slotJogBack();
+    void slotJogForward();
+    void slotFlushJog();
+
 signals:
+    /** @brief Seek diff frames, fast is true when the steps come from a fast spin. */
+    void jog(int diff, bool fast);
     void rewind(double);
     void forward(double);
     void action(const QString&);
@@ -23,176 +23,82 @@
 
 #include <QDebug>
 
-#include <QApplication>
-#include <QEvent>
+#include <QSocketNotifier>
 #include <QDir>
 
-#include <string.h>
-#include <errno.h>
-#include <sys/select.h>
-// according to earlier standards
-#include <sys/time.h>
-#include <sys/types.h>
-#include <unistd.h>
 
-
-// init media event type constants
-const QEvent::Type MediaCtrlEvent::Key = (QEvent::Type)QEvent::registerEventType();
-const QEvent::Type MediaCtrlEvent::Jog = (QEvent::Type)QEvent::registerEventType();
-const QEvent::Type MediaCtrlEvent::Shuttle = (QEvent::Type)QEvent::registerEventType();
-
-
-ShuttleThread::ShuttleThread(const QString &device, QObject *parent) :
-        m_device(device),
-        m_parent(parent),
-        m_isRunning(false)
-{
-}
-
-ShuttleThread::~ShuttleThread()
-{
-}
-
-QString ShuttleThread::device()
+JogShuttle::JogShuttle(const QString &device, QObject *parent) :
+        QObject(parent),
+        m_notifier(NULL)
 {
-    return m_device;
+    m_device.fd = -1;
+    initDevice(device);
 }
 
-void ShuttleThread::stop()
+JogShuttle::~JogShuttle()
 {
-    m_isRunning = false;
+    stopDevice();
 }
 
-void ShuttleThread::run()
+void JogShuttle::initDevice(const QString &device)
 {
-	media_ctrl mc;
-    media_ctrl_open_dev(&mc, m_device.toUtf8().data());
-    if (mc.fd < 0) {
+    stopDevice();
+    media_ctrl_open_dev(&m_device, device.toUtf8().data());
+    if (m_device.fd < 0) {
         return;
     }
-	fd_set readset;
-	struct timeval timeout;
-	// enter thread loop
-    m_isRunning = true;
-	while (m_isRunning) {
-		// reset the read set
-		FD_ZERO(&readset);
-		FD_SET(mc.fd, &readset);
-		// reinit the timeout structure
-		timeout.tv_sec  = 0;
-		timeout.tv_usec = 400000;
-		// do select in blocked mode and wake up after timeout
-		// for stop_me evaluation
-		int result = select(mc.fd + 1, &readset, NULL, NULL, &timeout);
-		// see if there was an error or timeout else process event
-		if (result < 0 && errno == EINTR) {
-			// EINTR event caught. This is not a problem - continue processing
-			continue;
-		} else if (result < 0) {
-			// stop thread
-		    m_isRunning = false;
-		} else if (result > 0) {
-			// we have input
-			if (FD_ISSET(mc.fd, &readset)) {
-			    media_ctrl_event mev;
-			    mev.type = MEDIA_CTRL_EVENT_NONE;
-                // read input
-				media_ctrl_read_event(&mc, &mev);
-                // process event
-                handleEvent(mev);
-			}
-		} else if (result == 0) {
-		    // on timeout
-		}
-	}
-	// close the handle and return thread
-    media_ctrl_close(&mc);
-}
-
-void ShuttleThread::handleEvent(const media_ctrl_event& ev)
-{
-    if (ev.type == MEDIA_CTRL_EVENT_KEY)
-        key(ev);
-    else if (ev.type == MEDIA_CTRL_EVENT_JOG)
-        jog(ev);
-    else if (ev.type == MEDIA_CTRL_EVENT_SHUTTLE)
-        shuttle(ev);
+    m_notifier = new QSocketNotifier(m_device.fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &JogShuttle::slotReadDevice);
 }
 
-void ShuttleThread::key(const media_ctrl_event& ev)
+void JogShuttle::stopDevice()
 {
-    if (ev.value == KEY_PRESS) {
-        QApplication::postEvent(m_parent,
-            new MediaCtrlEvent(MediaCtrlEvent::Key, ev.index + 1));
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        delete m_notifier;
+        m_notifier = NULL;
+    }
+    if (m_device.fd >= 0) {
+        media_ctrl_close(&m_device);
+        m_device.fd = -1;
     }
 }
 
-void ShuttleThread::shuttle(const media_ctrl_event& ev)
+void JogShuttle::slotReadDevice()
 {
-    int value = ev.value / 2;
-
-    if (value > MaxShuttleRange || value < -MaxShuttleRange) {
-        //qDebug() << "Jog shuttle value is out of range: " << MaxShuttleRange;
+    media_ctrl_event mev;
+    mev.type = MEDIA_CTRL_EVENT_NONE;
+    media_ctrl_read_event(&m_device, &mev);
+    if (m_device.fd < 0) {
+        // Read failed (device unplugged), the descriptor was closed
+        qWarning() << "Jog shuttle device stopped responding";
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = NULL;
         return;
     }
-    QApplication::postEvent(m_parent,
-        new MediaCtrlEvent(MediaCtrlEvent::Shuttle, value));
-}
-
-void ShuttleThread::jog(const media_ctrl_event& ev)
-{
-    QApplication::postEvent(m_parent,
-        new MediaCtrlEvent(MediaCtrlEvent::Jog, ev.value));
-}
-
-JogShuttle::JogShuttle(const QString &device, QObject *parent) :
-        QObject(parent),
-        m_shuttleProcess(device, this)
-{
-    m_shuttleProcess.start();
+    handleEvent(mev);
 }
 
-JogShuttle::~JogShuttle()
+void JogShuttle::handleEvent(const media_ctrl_event& ev)
 {
-	stopDevice();
-}
-
-void JogShuttle::stopDevice()
-{
-    if (m_shuttleProcess.isRunning()) {
-    	// tell thread to stop
-        m_shuttleProcess.stop();
-        m_shuttleProcess.quit();
-        // give the thread some time (ms) to shutdown
-        m_shuttleProcess.wait(600);
-
-        // if still running - do it in the hardcore way
-        if (m_shuttleProcess.isRunning()) {
-        	m_shuttleProcess.terminate();
-            qWarning() << "Needed to force jogshuttle process termination";
+    if (ev.type == MEDIA_CTRL_EVENT_KEY) {
+        if (ev.value == KEY_PRESS) {
+            emit button(ev.index + 1);
         }
-    }
-}
-
-void JogShuttle::customEvent(QEvent* e)
-{
-    QEvent::Type type = e->type();
-
-    if (type == MediaCtrlEvent::Key) {
-        MediaCtrlEvent* mev = static_cast<MediaCtrlEvent*>(e);
-        emit button(mev->value());
-    } else if (type == MediaCtrlEvent::Jog) {
-        MediaCtrlEvent* mev = static_cast<MediaCtrlEvent*>(e);
-        int value = mev->value();
-
-        if (value < 0) {
+    } else if (ev.type == MEDIA_CTRL_EVENT_JOG) {
+        if (ev.value < 0) {
             emit jogBack();
-        } else if (value > 0) {
+        } else if (ev.value > 0) {
             emit jogForward();
         }
-    } else if (type == MediaCtrlEvent::Shuttle) {
-        MediaCtrlEvent* mev = static_cast<MediaCtrlEvent*>(e);
-        emit shuttlePos(mev->value());
+    } else if (ev.type == MEDIA_CTRL_EVENT_SHUTTLE) {
+        int value = ev.value / 2;
+        if (value > MaxShuttleRange || value < -MaxShuttleRange) {
+            //qDebug() << "Jog shuttle value is out of range: " << MaxShuttleRange;
+            return;
+        }
+        emit shuttlePos(value);
     }
 }
 
@@ -21,58 +21,12 @@
 #ifndef SHUTTLE_H
 #define SHUTTLE_H
 
-#include <QThread>
 #include <QObject>
-#include <QEvent>
 #include <QMap>
 
 #include <media_ctrl/mediactrl.h>
 
-class MediaCtrlEvent : public QEvent
-{
-public:
-    MediaCtrlEvent(QEvent::Type type, int value) :
-        QEvent(type),
-        m_value(value)
-    {
-    }
-
-    int value() { return m_value; }
-
-    static const QEvent::Type Key;
-    static const QEvent::Type Jog;
-    static const QEvent::Type Shuttle;
-
-private:
-    int m_value;
-};
-
-
-class ShuttleThread : public QThread
-{
-
-public:
-    ShuttleThread(const QString &device, QObject *parent);
-    ~ShuttleThread();
-    virtual void run();
-    QString device();
-    void stop();
-
-private:
-    enum {
-        MaxShuttleRange = 7
-    };
-
-    void handleEvent(const media_ctrl_event& ev);
-    void jog(const media_ctrl_event& ev);
-    void shuttle(const media_ctrl_event& ev);
-    void key(const media_ctrl_event& ev);
-
-    QString m_device;
-    QObject *m_parent;
-    volatile bool m_isRunning;
-};
-
+class QSocketNotifier;
 
 typedef QMap<QString, QString> DeviceMap;
 typedef QMap<QString, QString>::iterator DeviceMapIter;
@@ -89,11 +43,20 @@ public:
     static DeviceMap enumerateDevices(const QString& devPath);
     static int keysCount(const QString& devPath);
 
-protected:
-    virtual void customEvent(QEvent * e);
-
 private:
-    ShuttleThread m_shuttleProcess;
+    enum {
+        MaxShuttleRange = 7
+    };
+
+    /** @brief The opened device, events are read from its descriptor in the GUI thread */
+    media_ctrl m_device;
+    /** @brief Wakes us up only when the device has input, so there is no polling thread */
+    QSocketNotifier *m_notifier;
+
+    void handleEvent(const media_ctrl_event& ev);
+
+private slots:
+    void slotReadDevice();
 
 signals:
     void jogBack();
@@ -10,23 +10,47 @@ the Free Software Foundation, either version 3 of the License, or
 
 #include "audioCorrelation.h"
 #include "fftCorrelation.h"
+#include "utils/tracer.h"
 
 #include "klocalizedstring.h"
 #include <QDebug>
 #include <QTime>
+#include <QtConcurrent>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
+// Envelopes are summed by this factor for the coarse correlation pass
+#define COARSE_FACTOR 8
+// Shorter envelopes are correlated at frame resolution directly
+#define COARSE_MIN_FRAMES 2000
+// Number of coarse peaks refined at frame resolution
+#define COARSE_CANDIDATES 3
+// Below this confidence an alignment is reported as unreliable
+#define LOW_CONFIDENCE 0.1
+// Frames of audio decoded to refine an alignment found on audio thumbnail levels
+#define REFINE_FRAMES 250
+// Frames searched on each side of the alignment found on audio thumbnail levels
+#define REFINE_MARGIN 12
+
 
 AudioCorrelation::AudioCorrelation(AudioEnvelope *mainTrackEnvelope) :
-    m_mainTrackEnvelope(mainTrackEnvelope)
+    m_mainTrackEnvelope(mainTrackEnvelope),
+    m_mainTrackReady(false)
 {
     m_mainTrackEnvelope->normalizeEnvelope();
     connect(m_mainTrackEnvelope, SIGNAL(envelopeReady(AudioEnvelope*)), this, SLOT(slotAnnounceEnvelope()));
+    connect(&m_batchWatcher, SIGNAL(finished()), this, SLOT(slotBatchFinished()));
 }
 
 AudioCorrelation::~AudioCorrelation()
 {
+    if (!m_batchRunning.isEmpty()) {
+        m_batchWatcher.waitForFinished();
+        qDeleteAll(m_batchWatcher.result());
+        qDeleteAll(m_batchRunning);
+    }
+    qDeleteAll(m_batchPending);
     delete m_mainTrackEnvelope;
     foreach (AudioEnvelope *envelope, m_children) {
         delete envelope;
@@ -40,7 +64,9 @@ AudioCorrelation::~AudioCorrelation()
 
 void AudioCorrelation::slotAnnounceEnvelope()
 {
+    m_mainTrackReady = true;
     emit displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage);
+    startBatch();
 }
 
 void AudioCorrelation::addChild(AudioEnvelope *envelope)
@@ -83,6 +109,270 @@ void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
     emit gotAudioAlignData(envelope->track(), envelope->startPos(), shift);
 }
 
+void AudioCorrelation::addChildren(const QList<AudioEnvelope*> &envelopes)
+{
+    foreach (AudioEnvelope *envelope, envelopes) {
+        m_batchPending.append(envelope);
+        m_batchLoading.insert(envelope);
+        connect(envelope, SIGNAL(envelopeReady(AudioEnvelope*)), this, SLOT(slotBatchEnvelopeReady(AudioEnvelope*)));
+    }
+    // Start all extractions before waiting on any of them, they run concurrently
+    foreach (AudioEnvelope *envelope, envelopes) {
+        envelope->normalizeEnvelope();
+    }
+}
+
+void AudioCorrelation::slotBatchEnvelopeReady(AudioEnvelope *envelope)
+{
+    m_batchLoading.remove(envelope);
+    startBatch();
+}
+
+void AudioCorrelation::startBatch()
+{
+    if (!m_mainTrackReady || !m_batchLoading.isEmpty() || m_batchPending.isEmpty() || m_batchWatcher.isRunning()) {
+        return;
+    }
+    m_batchRunning = m_batchPending;
+    m_batchPending.clear();
+    m_batchWatcher.setFuture(QtConcurrent::run(&AudioCorrelation::correlateBatch, m_mainTrackEnvelope, m_batchRunning));
+}
+
+//static
+QList<AudioCorrelationInfo*> AudioCorrelation::correlateBatch(AudioEnvelope *mainTrackEnvelope, const QList<AudioEnvelope*> &envelopes)
+{
+    TRACE_ZONE("audio", "AudioCorrelation::correlateBatch");
+    QTime t;
+    t.start();
+    const int sizeMain = mainTrackEnvelope->envelopeSize();
+    const qint64 *envMain = mainTrackEnvelope->envelope();
+
+    // One spectrum of the main track, large enough for every envelope of the batch
+    int largestSize = sizeMain;
+    QList<AudioCorrelationInfo*> infos;
+    foreach (AudioEnvelope *envelope, envelopes) {
+        largestSize = qMax(largestSize, envelope->envelopeSize());
+        infos << new AudioCorrelationInfo(sizeMain, envelope->envelopeSize());
+    }
+    const QVector<kiss_fft_cpx> mainSpectrum = FFTCorrelation::spectrum(envMain, sizeMain, FFTCorrelation::paddedSize(largestSize));
+    // Long envelopes are searched coarse to fine, on a decimated copy of the main track
+    const QVector<qint64> coarseMain = decimate(envMain, sizeMain);
+    const QVector<kiss_fft_cpx> coarseSpectrum = FFTCorrelation::spectrum(coarseMain.constData(), coarseMain.size(),
+                                                                         FFTCorrelation::paddedSize(largestSize / COARSE_FACTOR));
+
+    QList<int> indexes;
+    for (int i = 0; i < envelopes.count(); ++i) {
+        indexes << i;
+    }
+    QtConcurrent::blockingMap(indexes, [&](int i) {
+        AudioEnvelope *envelope = envelopes.at(i);
+        AudioCorrelationInfo *info = infos.at(i);
+        const int sizeSub = envelope->envelopeSize();
+        if (sizeSub >= COARSE_MIN_FRAMES && sizeMain >= COARSE_MIN_FRAMES) {
+            correlateCoarseToFine(envMain, sizeMain, coarseSpectrum, coarseMain.size(),
+                                  envelope->envelope(), sizeSub, info);
+        } else if (sizeSub > 200) {
+            FFTCorrelation::correlate(mainSpectrum, sizeMain,
+                                      envelope->envelope(), sizeSub,
+                                      info->correlationVector());
+        } else {
+            qint64 max = 0;
+            correlate(envMain, sizeMain,
+                      envelope->envelope(), sizeSub,
+                      info->correlationVector(),
+                      &max);
+            info->setMax(max);
+        }
+        if (envelope->isApproximate() || mainTrackEnvelope->isApproximate()) {
+            refineOnRawAudio(mainTrackEnvelope, envelope, info);
+        }
+    });
+    qDebug() << "Batch of" << envelopes.count() << "correlations computed in" << t.elapsed() << "ms.";
+    return infos;
+}
+
+void AudioCorrelation::slotBatchFinished()
+{
+    const QList<AudioCorrelationInfo*> infos = m_batchWatcher.result();
+    const QList<AudioEnvelope*> envelopes = m_batchRunning;
+    m_batchRunning.clear();
+    m_children.append(envelopes);
+    m_correlations.append(infos);
+    Q_ASSERT(m_correlations.size() == m_children.size());
+
+    for (int i = 0; i < envelopes.count(); ++i) {
+        AudioEnvelope *envelope = envelopes.at(i);
+        const double confidence = infos.at(i)->confidence();
+        if (confidence >= 0 && confidence < LOW_CONFIDENCE) {
+            emit displayMessage(i18n("Audio alignment of the clip on track %1 may be unreliable.", envelope->track()), InformationMessage);
+        }
+        emit gotAudioAlignData(envelope->track(), envelope->startPos(), getShift(m_children.indexOf(envelope)));
+    }
+    startBatch();
+}
+
+//static
+QVector<qint64> AudioCorrelation::decimate(const qint64 *envelope, int size)
+{
+    QVector<qint64> result(size / COARSE_FACTOR);
+    for (int i = 0; i < result.size(); ++i) {
+        qint64 sum = 0;
+        const qint64 *block = envelope + i * COARSE_FACTOR;
+        for (int k = 0; k < COARSE_FACTOR; ++k) {
+            sum += block[k];
+        }
+        result[i] = sum;
+    }
+    return result;
+}
+
+//static
+double AudioCorrelation::correlationAt(const qint64 *envMain, int sizeMain,
+                                      const qint64 *envSub, int sizeSub,
+                                      int shift)
+{
+    // Same overlap as in correlate()
+    const qint64 *left;
+    const qint64 *right;
+    int size;
+    if (shift <= 0) {
+        left = envSub-shift;
+        right = envMain;
+        size = std::min(sizeSub+shift, sizeMain);
+    } else {
+        left = envSub;
+        right = envMain+shift;
+        size = std::min(sizeSub, sizeMain-shift);
+    }
+    // Accumulate in floating point, products of long envelopes overflow qint64
+    double sum = 0;
+    for (int i = 0; i < size; ++i) {
+        sum += double(left[i]) * double(right[i]);
+    }
+    return sum;
+}
+
+//static
+void AudioCorrelation::correlateCoarseToFine(const qint64 *envMain, int sizeMain,
+                                             const QVector<kiss_fft_cpx> &coarseSpectrum, int coarseMainSize,
+                                             const qint64 *envSub, int sizeSub,
+                                             AudioCorrelationInfo *info)
+{
+    const QVector<qint64> coarseSub = decimate(envSub, sizeSub);
+    const int coarseSubSize = coarseSub.size();
+    QVector<qint64> coarse(coarseMainSize + coarseSubSize + 1);
+    FFTCorrelation::correlate(coarseSpectrum, coarseMainSize, coarseSub.constData(), coarseSubSize, coarse.data());
+
+    // Pick the strongest coarse peaks, keeping them apart so one wide peak is not counted twice
+    QList<int> candidates;
+    QVector<qint64> search = coarse;
+    for (int c = 0; c < COARSE_CANDIDATES; ++c) {
+        int best = std::max_element(search.constBegin(), search.constEnd()) - search.constBegin();
+        if (search.at(best) <= 0) {
+            break;
+        }
+        candidates << best;
+        const int from = qMax(0, best - 2);
+        const int to = qMin(search.size() - 1, best + 2);
+        for (int i = from; i <= to; ++i) {
+            search[i] = 0;
+        }
+    }
+
+    // Confidence is how much the best coarse peak stands out from the next one
+    double confidence = 0;
+    if (!candidates.isEmpty()) {
+        const qint64 first = coarse.at(candidates.first());
+        const qint64 second = candidates.size() > 1 ? coarse.at(candidates.at(1)) : 0;
+        confidence = 1.0 - double(second) / first;
+    }
+    info->setConfidence(confidence);
+
+    // Refine around each candidate at frame resolution, in the full size vector.
+    // Values are scaled like the normalized envelopes of the FFT correlation,
+    // with some fixed point precision kept.
+    qint64 mainMax = 1;
+    qint64 subMax = 1;
+    for (int i = 0; i < sizeMain; ++i) {
+        mainMax = qMax(mainMax, qAbs(envMain[i]));
+    }
+    for (int i = 0; i < sizeSub; ++i) {
+        subMax = qMax(subMax, qAbs(envSub[i]));
+    }
+    const double scale = 65536.0 / (double(mainMax) * double(subMax));
+    qint64 *correlation = info->correlationVector();
+    std::fill(correlation, correlation + info->size(), 0);
+    qint64 max = 0;
+    foreach (int candidate, candidates) {
+        const int center = (candidate - coarseSubSize) * COARSE_FACTOR;
+        const int from = qMax(-sizeSub, center - 2 * COARSE_FACTOR);
+        const int to = qMin(sizeMain, center + 2 * COARSE_FACTOR);
+        for (int shift = from; shift <= to; ++shift) {
+            const qint64 value = correlationAt(envMain, sizeMain, envSub, sizeSub, shift) * scale;
+            correlation[sizeSub+shift] = qMax(value, qint64(0));
+            max = qMax(max, value);
+        }
+    }
+    info->setMax(max);
+}
+
+//static
+void AudioCorrelation::refineOnRawAudio(AudioEnvelope *mainTrackEnvelope, AudioEnvelope *envelope,
+                                        AudioCorrelationInfo *info)
+{
+    const int sizeMain = mainTrackEnvelope->envelopeSize();
+    const int sizeSub = envelope->envelopeSize();
+    const int shift = info->maxIndex() - sizeSub;
+
+    // Decode the start of the overlapping part, with a margin on the main track
+    const int subStart = qMax(0, -shift);
+    const int mainStart = qMax(0, shift);
+    const int length = qMin(REFINE_FRAMES, qMin(sizeSub - subStart, sizeMain - mainStart));
+    if (length <= 0) {
+        return;
+    }
+    const int windowStart = qMax(0, mainStart - REFINE_MARGIN);
+    const int windowEnd = qMin(sizeMain, mainStart + length + REFINE_MARGIN);
+    const QVector<qint64> subPart = envelope->rawEnvelope(subStart, length);
+    const QVector<qint64> mainPart = mainTrackEnvelope->rawEnvelope(windowStart, windowEnd - windowStart);
+    if (subPart.isEmpty() || mainPart.isEmpty()) {
+        return;
+    }
+
+    qint64 mainMax = 1;
+    qint64 subMax = 1;
+    foreach (qint64 value, mainPart) {
+        mainMax = qMax(mainMax, qAbs(value));
+    }
+    foreach (qint64 value, subPart) {
+        subMax = qMax(subMax, qAbs(value));
+    }
+    const double scale = 65536.0 / (double(mainMax) * double(subMax));
+    QVector<qint64> refined(2 * REFINE_MARGIN + 1, 0);
+    qint64 max = 0;
+    for (int delta = -REFINE_MARGIN; delta <= REFINE_MARGIN; ++delta) {
+        if (shift + delta < -sizeSub || shift + delta > sizeMain) {
+            continue;
+        }
+        const qint64 value = correlationAt(mainPart.constData(), mainPart.size(), subPart.constData(), subPart.size(),
+                                           mainStart + delta - windowStart) * scale;
+        refined[delta + REFINE_MARGIN] = qMax(value, qint64(0));
+        max = qMax(max, value);
+    }
+    if (max <= 0) {
+        // Silent part, keep the alignment of the levels
+        return;
+    }
+    qint64 *correlation = info->correlationVector();
+    std::fill(correlation, correlation + info->size(), 0);
+    for (int delta = -REFINE_MARGIN; delta <= REFINE_MARGIN; ++delta) {
+        if (shift + delta >= -sizeSub && shift + delta <= sizeMain) {
+            correlation[sizeSub + shift + delta] = refined.at(delta + REFINE_MARGIN);
+        }
+    }
+    info->setMax(max);
+}
+
 int AudioCorrelation::getShift(int childIndex) const
 {
     Q_ASSERT(childIndex >= 0);
@@ -14,7 +14,10 @@
 #include "audioCorrelationInfo.h"
 #include "audioEnvelope.h"
 #include "definitions.h"
+#include "fftCorrelation.h"
 #include <QList>
+#include <QSet>
+#include <QFutureWatcher>
 
 
 /**
@@ -37,6 +40,15 @@ public:
       */
     void addChild(AudioEnvelope *envelope);
 
+    /**
+      Aligns several envelopes in one operation: once all of them are
+      loaded, the spectrum of the main track is computed once and the
+      correlations run in parallel. gotAudioAlignData is then emitted
+      for every envelope.
+      This object will take ownership of the passed envelopes.
+      */
+    void addChildren(const QList<AudioEnvelope*> &envelopes);
+
     const AudioCorrelationInfo *info(int childIndex) const;
     int getShift(int childIndex) const;
 
@@ -50,13 +62,50 @@ public:
                           qint64 *out_max = NULL);
 private:
     AudioEnvelope *m_mainTrackEnvelope;
+    bool m_mainTrackReady;
 
     QList<AudioEnvelope*> m_children;
     QList<AudioCorrelationInfo*> m_correlations;
 
+    /** @brief Batch envelopes waiting to be correlated, and those of them still loading. */
+    QList<AudioEnvelope*> m_batchPending;
+    QSet<AudioEnvelope*> m_batchLoading;
+    /** @brief Envelopes of the batch currently being correlated. */
+    QList<AudioEnvelope*> m_batchRunning;
+    QFutureWatcher<QList<AudioCorrelationInfo*> > m_batchWatcher;
+
+    /** @brief Starts correlating the pending batch if all its data is ready. */
+    void startBatch();
+    static QList<AudioCorrelationInfo*> correlateBatch(AudioEnvelope *mainTrackEnvelope, const QList<AudioEnvelope*> &envelopes);
+
+    /** @brief Sums blocks of the envelope for the coarse correlation pass. */
+    static QVector<qint64> decimate(const qint64 *envelope, int size);
+    /** @brief Correlation of both envelopes for one shift, as computed by correlate(). */
+    static double correlationAt(const qint64 *envMain, int sizeMain,
+                                const qint64 *envSub, int sizeSub,
+                                int shift);
+    /**
+      Correlates the decimated envelopes to find candidate offsets, then
+      refines around them at frame level. Only the refined entries of
+      the correlation vector are filled; the confidence is set on \c info.
+      */
+    static void correlateCoarseToFine(const qint64 *envMain, int sizeMain,
+                                      const QVector<kiss_fft_cpx> &coarseSpectrum, int coarseMainSize,
+                                      const qint64 *envSub, int sizeSub,
+                                      AudioCorrelationInfo *info);
+    /**
+      Refines an alignment found on audio thumbnail levels by correlating
+      decoded audio of a short overlapping part, a few frames around the
+      shift found. Only the refined entries of the correlation vector are filled.
+      */
+    static void refineOnRawAudio(AudioEnvelope *mainTrackEnvelope, AudioEnvelope *envelope,
+                                 AudioCorrelationInfo *info);
+
 private slots:    
     void slotProcessChild(AudioEnvelope *envelope);
     void slotAnnounceEnvelope();
+    void slotBatchEnvelopeReady(AudioEnvelope *envelope);
+    void slotBatchFinished();
     
 signals:
     void gotAudioAlignData(int, int, int);
@@ -14,7 +14,8 @@
 AudioCorrelationInfo::AudioCorrelationInfo(int mainSize, int subSize) :
     m_mainSize(mainSize),
     m_subSize(subSize),
-    m_max(-1)
+    m_max(-1),
+    m_confidence(-1)
 {
     m_correlationVector = new qint64[m_mainSize+m_subSize+1];
 }
@@ -66,6 +67,16 @@ int AudioCorrelationInfo::maxIndex() const
     return index;
 }
 
+double AudioCorrelationInfo::confidence() const
+{
+    return m_confidence;
+}
+
+void AudioCorrelationInfo::setConfidence(double confidence)
+{
+    m_confidence = confidence;
+}
+
 qint64* AudioCorrelationInfo::correlationVector()
 {
     return m_correlationVector;
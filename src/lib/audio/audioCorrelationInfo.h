@@ -42,6 +42,13 @@ public:
       */
     int maxIndex() const;
 
+    /**
+      Returns how clearly the best match stands out, between 0 and 1,
+      or -1 if the correlation did not estimate it.
+      */
+    double confidence() const;
+    void setConfidence(double confidence);
+
     QImage toImage(int height = 400) const;
 
 private:
@@ -50,6 +57,7 @@ private:
 
     qint64 *m_correlationVector;
     qint64 m_max;
+    double m_confidence;
 
 };
 
@@ -11,14 +11,26 @@
 #include "audioEnvelope.h"
 
 #include "audioStreamInfo.h"
+#include "utils/tracer.h"
 #include <QDebug>
 #include <QImage>
 #include <QTime>
 #include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
 #include <cmath>
 
+// Bump when the content of cached envelopes changes
+#define ENVELOPE_CACHE_VERSION 1
+
 AudioEnvelope::AudioEnvelope(const QString &url, Mlt::Producer *producer, int offset, int length, int track, int startPos) :
     m_envelope(NULL),
+    m_producer(NULL),
     m_offset(offset),
     m_length(length),
     m_track(track),
@@ -28,18 +40,25 @@ AudioEnvelope::AudioEnvelope(const QString &url, Mlt::Producer *producer, int of
     m_envelopeMean(0),
     m_envelopeStdDev(0),
     m_envelopeStdDevCalculated(false),
-    m_envelopeIsNormalized(false)
+    m_envelopeIsNormalized(false),
+    m_approximate(false)
 {
-    // make a copy of the producer to avoid audio playback issues
     QString path = QString::fromUtf8(producer->get("resource"));
     if (path == QLatin1String("<playlist>") || path == QLatin1String("<tractor>") || path ==QLatin1String( "<producer>"))
 	path = url;
-    m_producer = new Mlt::Producer(*(producer->profile()), path.toUtf8().constData());
+    m_path = path;
+    m_profile = producer->profile();
+    m_fps = producer->get_fps();
     connect(&m_watcher, SIGNAL(finished()), this, SLOT(slotProcessEnveloppe()));
-    if (!m_producer || !m_producer->is_valid()) {
-	qDebug()<<"// Cannot create envelope for producer: "<<path;
+    // The stream headers were read when the clip was opened, so the media is only
+    // opened again if the envelope has to be calculated
+    Mlt::Producer parent(producer->parent());
+    if (parent.get_int("meta.media.nb_streams") > 0) {
+        m_info = new AudioInfo(&parent);
+    } else {
+        openProducer();
+        m_info = new AudioInfo(m_producer);
     }
-    m_info = new AudioInfo(m_producer);
 
     Q_ASSERT(m_offset >= 0);
     if (m_length > 0) {
@@ -74,12 +93,11 @@ int AudioEnvelope::envelopeSize() const
 void AudioEnvelope::loadEnvelope()
 {
     Q_ASSERT(m_envelope == NULL);
+    TRACE_ZONE("audio", "AudioEnvelope::loadEnvelope");
 
     qDebug() << "Loading envelope ...";
 
     int samplingRate = m_info->info(0)->samplingRate();
-    mlt_audio_format format_s16 = mlt_audio_s16;
-    int channels = 1;
 
     m_envelope = new qint64[m_envelopeSize];
     m_envelopeMax = 0;
@@ -87,40 +105,193 @@ void AudioEnvelope::loadEnvelope()
 
     QTime t;
     t.start();
-    int count = 0;
-    m_producer->seek(m_offset);
-    m_producer->set_speed(1.0); // This is necessary, otherwise we don't get any new frames in the 2nd run.
+    const QString cacheFile = cachePath(samplingRate);
+    if (loadCache(cacheFile)) {
+        qDebug() << "Envelope (" << m_envelopeSize << " frames) read from cache in " << t.elapsed() << " ms.";
+        return;
+    }
+    if (loadLevels()) {
+        qDebug() << "Envelope (" << m_envelopeSize << " frames) built from audio thumbnail in " << t.elapsed() << " ms.";
+        return;
+    }
+    QMutexLocker lock(&m_decodeMutex);
+    openProducer();
+    decodeEnvelope(m_envelope, m_offset, m_envelopeSize, samplingRate);
     for (int i = 0; i < m_envelopeSize; ++i) {
+        m_envelopeMean += m_envelope[i];
+        if (m_envelope[i] > m_envelopeMax) {
+            m_envelopeMax = m_envelope[i];
+        }
+    }
+    m_envelopeMean /= m_envelopeSize;
+    qDebug() << "Calculating the envelope (" << m_envelopeSize << " frames) took "
+              << t.elapsed() << " ms.";
+    saveCache(cacheFile);
+}
+
+void AudioEnvelope::decodeEnvelope(qint64 *dest, int start, int count, int samplingRate)
+{
+    mlt_audio_format format_s16 = mlt_audio_s16;
+    int channels = 1;
+    m_producer->seek(start);
+    m_producer->set_speed(1.0); // This is necessary, otherwise we don't get any new frames in the 2nd run.
+    for (int i = 0; i < count; ++i) {
         Mlt::Frame *frame = m_producer->get_frame(i);
         qint64 position = mlt_frame_get_position(frame->get_frame());
         int samples = mlt_sample_calculator(m_producer->get_fps(), samplingRate, position);
 
         qint16 *data = static_cast<qint16*>(frame->get_audio(format_s16, samplingRate, channels, samples));
 
+        // Branch free absolute value, so that the compiler can vectorize the loop
         qint64 sum = 0;
-        for (int k = 0; k < samples; ++k) {
-            sum += abs(data[k]);
+        if (data) {
+            for (int k = 0; k < samples; ++k) {
+                const int value = data[k];
+                const int mask = value >> 31;
+                sum += (value ^ mask) - mask;
+            }
         }
-        m_envelope[i] = sum;
+        dest[i] = sum;
+        delete frame;
+    }
+}
+
+void AudioEnvelope::setLevels(const AudioLevels &levels)
+{
+    m_levels = levels;
+}
 
+bool AudioEnvelope::isApproximate() const
+{
+    return m_approximate;
+}
+
+bool AudioEnvelope::loadLevels()
+{
+    if (m_levels.isEmpty() || !m_levels.isComplete() || m_levels.frames() < m_offset + m_envelopeSize) {
+        return false;
+    }
+    // Sum of the channel peaks of each frame, which follows the shape of the decoded envelope
+    const int channels = m_levels.channels();
+    const quint8 *levels = m_levels.constData() + m_offset * channels;
+    for (int i = 0; i < m_envelopeSize; ++i) {
+        qint64 sum = 0;
+        for (int c = 0; c < channels; ++c) {
+            sum += levels[i * channels + c];
+        }
+        m_envelope[i] = sum;
         m_envelopeMean += sum;
         if (sum > m_envelopeMax) {
             m_envelopeMax = sum;
         }
+    }
+    m_envelopeMean /= m_envelopeSize;
+    m_approximate = true;
+    return true;
+}
 
-//        qDebug() << position << '|' << m_producer->get_playtime()
-//                  << '-' << m_producer->get_in() << '+' << m_producer->get_out() << ' ';
+QVector<qint64> AudioEnvelope::rawEnvelope(int start, int length)
+{
+    QMutexLocker lock(&m_decodeMutex);
+    if (length <= 0 || start < 0 || start + length > m_envelopeSize) {
+        return QVector<qint64>();
+    }
+    openProducer();
+    if (!m_producer->is_valid()) {
+        return QVector<qint64>();
+    }
+    QVector<qint64> result(length);
+    decodeEnvelope(result.data(), m_offset + start, length, m_info->info(0)->samplingRate());
+    qint64 mean = 0;
+    for (int i = 0; i < length; ++i) {
+        mean += result.at(i);
+    }
+    mean /= length;
+    for (int i = 0; i < length; ++i) {
+        result[i] -= mean;
+    }
+    return result;
+}
 
-        delete frame;
+QString AudioEnvelope::cachePath(int samplingRate) const
+{
+    QFileInfo info(m_path);
+    if (!info.isFile()) {
+        return QString();
+    }
+    // Same media, range and sampling give the same envelope
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(m_offset));
+    hash.addData(QByteArray::number(m_envelopeSize));
+    hash.addData(QByteArray::number(m_fps));
+    hash.addData(QByteArray::number(samplingRate));
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/audioenvelopes/") + QString::fromLatin1(hash.result().toHex());
+}
 
-        count++;
-        if (m_length > 0 && count > m_length) {
-            break;
+bool AudioEnvelope::loadCache(const QString &path)
+{
+    if (path.isEmpty()) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    qint32 version;
+    qint32 size;
+    in >> version >> size;
+    if (version != ENVELOPE_CACHE_VERSION || size != m_envelopeSize) {
+        return false;
+    }
+    const int bytes = m_envelopeSize * sizeof(qint64);
+    if (in.readRawData(reinterpret_cast<char *>(m_envelope), bytes) != bytes) {
+        return false;
+    }
+    m_envelopeMax = 0;
+    m_envelopeMean = 0;
+    for (int i = 0; i < m_envelopeSize; ++i) {
+        m_envelopeMean += m_envelope[i];
+        if (m_envelope[i] > m_envelopeMax) {
+            m_envelopeMax = m_envelope[i];
         }
     }
     m_envelopeMean /= m_envelopeSize;
-    qDebug() << "Calculating the envelope (" << m_envelopeSize << " frames) took "
-              << t.elapsed() << " ms.";
+    return true;
+}
+
+void AudioEnvelope::saveCache(const QString &path) const
+{
+    if (path.isEmpty()) {
+        return;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write envelope cache" << path;
+        return;
+    }
+    QDataStream out(&file);
+    out << (qint32) ENVELOPE_CACHE_VERSION << (qint32) m_envelopeSize;
+    out.writeRawData(reinterpret_cast<const char *>(m_envelope), m_envelopeSize * sizeof(qint64));
+}
+
+void AudioEnvelope::openProducer()
+{
+    if (m_producer) {
+        return;
+    }
+    // make a copy of the producer to avoid audio playback issues
+    m_producer = new Mlt::Producer(*m_profile, m_path.toUtf8().constData());
+    if (!m_producer->is_valid()) {
+	qDebug()<<"// Cannot create envelope for producer: "<<m_path;
+    } else {
+        // Only audio is needed, do not decode the video stream
+        m_producer->set("video_index", -1);
+    }
 }
 
 int AudioEnvelope::track() const
@@ -12,10 +12,13 @@
 #define AUDIOENVELOPE_H
 
 #include "audioInfo.h"
+#include "bin/audiolevels.h"
 #include <mlt++/Mlt.h>
 
 #include <QFutureWatcher>
+#include <QMutex>
 #include <QObject>
+#include <QVector>
 
 class QImage;
 
@@ -41,6 +44,15 @@ public:
     void loadEnvelope();
     void normalizeEnvelope(bool clampTo0 = false);
 
+    /// Builds the envelope from the audio thumbnail levels of the clip instead of decoding
+    /// its audio, unless a decoded envelope is cached. Must be called before loading.
+    void setLevels(const AudioLevels &levels);
+    /// True if the envelope was built from the audio thumbnail levels.
+    bool isApproximate() const;
+    /// Decodes length frames of audio from start (relative to the envelope start)
+    /// and returns their envelope with its mean removed.
+    QVector<qint64> rawEnvelope(int start, int length);
+
     QImage drawEnvelope();
 
     void dumpInfo() const;
@@ -50,10 +62,18 @@ public:
 
 private:
     qint64 *m_envelope;
+    /** @brief Audio only producer, opened when the envelope is not cached. */
     Mlt::Producer *m_producer;
+    Mlt::Profile *m_profile;
+    double m_fps;
+    /** @brief Media file of the producer, used to key the envelope cache. */
+    QString m_path;
     AudioInfo *m_info;
     QFutureWatcher<void> m_watcher;
     QFuture<void> m_future;
+    AudioLevels m_levels;
+    /** @brief Serializes the use of m_producer, raw parts can be requested from several threads. */
+    QMutex m_decodeMutex;
 
     int m_offset;
     int m_length;
@@ -67,6 +87,19 @@ private:
 
     bool m_envelopeStdDevCalculated;
     bool m_envelopeIsNormalized;
+    bool m_approximate;
+
+    /** @brief Returns the cache file for this envelope, empty if the media is not a file. */
+    QString cachePath(int samplingRate) const;
+    /** @brief Reads the raw envelope from the cache, returns false if it is not available. */
+    bool loadCache(const QString &path);
+    void saveCache(const QString &path) const;
+    /** @brief Fills the envelope from the audio levels, returns false if they do not cover it. */
+    bool loadLevels();
+    /** @brief Decodes count frames from the producer position start into dest. */
+    void decodeEnvelope(qint64 *dest, int start, int count, int samplingRate);
+    /** @brief Opens the media without decoding its video stream. */
+    void openProducer();
     
 private slots:
     void slotProcessEnveloppe();
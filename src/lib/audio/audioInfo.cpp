@@ -14,9 +14,9 @@
 #include <QString>
 #include <cstdlib>
 
-AudioInfo::AudioInfo(Mlt::Producer *producer)
+AudioInfo::AudioInfo(Mlt::Properties *producer)
 {
-    // Since we already receive an MLT producer, we do not need to initialize MLT:
+    // Since we already receive MLT properties, we do not need to initialize MLT:
     // Mlt::Factory::init(NULL);
 
     // Get the number of streams and add the information of each of them if it is an audio stream.
@@ -18,7 +18,8 @@ class AudioStreamInfo;
 class AudioInfo
 {
 public:
-    explicit AudioInfo(Mlt::Producer *producer);
+    /** @brief Lists the audio streams described in the meta.media properties of a probed producer */
+    explicit AudioInfo(Mlt::Properties *producer);
     ~AudioInfo();
 
     int size() const;
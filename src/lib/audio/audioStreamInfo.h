@@ -16,11 +16,13 @@ the Free Software Foundation, either version 3 of the License, or
 
 /**
   Provides easy access to properties of an audio stream.
+  The stream headers are read from the meta.media properties of a probed producer,
+  or from any properties holding them like a producer restored from the probe cache.
   */
 class AudioStreamInfo
 {
 public:
-    AudioStreamInfo(Mlt::Producer *producer, int audioStreamIndex);
+    AudioStreamInfo(Mlt::Properties *producer, int audioStreamIndex);
     ~AudioStreamInfo();
 
     int samplingRate() const;
@@ -17,20 +17,143 @@ extern "C"
 
 #include <QDebug>
 #include <QTime>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
 #include <algorithm>
 
-void FFTCorrelation::correlate(const qint64 *left, const int leftSize,
-                               const qint64 *right, const int rightSize,
+namespace {
+/**
+  Keeps the kiss_fft configurations of the padded sizes already used,
+  so that aligning several takes does not allocate and plan again.
+  kiss_fftr uses scratch memory in its configuration, so a configuration
+  is handed out to one caller at a time and several are kept per size
+  when correlations run in parallel.
+  */
+class FFTPlanCache
+{
+public:
+    ~FFTPlanCache()
+    {
+        foreach (kiss_fftr_cfg cfg, m_forward) {
+            kiss_fftr_free(cfg);
+        }
+        foreach (kiss_fftr_cfg cfg, m_inverse) {
+            kiss_fftr_free(cfg);
+        }
+    }
+
+    kiss_fftr_cfg acquire(int size, bool inverse)
+    {
+        QMutexLocker lock(&m_mutex);
+        QMultiHash<int, kiss_fftr_cfg> &plans = inverse ? m_inverse : m_forward;
+        QMultiHash<int, kiss_fftr_cfg>::iterator it = plans.find(size);
+        if (it != plans.end()) {
+            kiss_fftr_cfg cfg = it.value();
+            plans.erase(it);
+            return cfg;
+        }
+        return kiss_fftr_alloc(size, inverse, NULL, NULL);
+    }
+
+    void release(int size, bool inverse, kiss_fftr_cfg cfg)
+    {
+        QMutexLocker lock(&m_mutex);
+        (inverse ? m_inverse : m_forward).insert(size, cfg);
+    }
+
+private:
+    QMutex m_mutex;
+    QMultiHash<int, kiss_fftr_cfg> m_forward;
+    QMultiHash<int, kiss_fftr_cfg> m_inverse;
+};
+
+Q_GLOBAL_STATIC(FFTPlanCache, fftPlans)
+
+qint64 absMax(const qint64 *data, const int size)
+{
+    qint64 max = 1;
+    for (int i = 0; i < size; ++i) {
+        const qint64 value = data[i] < 0 ? -data[i] : data[i];
+        if (value > max) {
+            max = value;
+        }
+    }
+    return max;
+}
+}
+
+int FFTCorrelation::paddedSize(const int largestSize)
+{
+    // To avoid issues with repetition (we are dealing with cosine waves
+    // in the fourier domain) we need to pad the vectors to at least twice their size,
+    // otherwise convolution would convolve with the repeated pattern as well.
+    // The vectors must have the same size (same frequency resolution!) and should
+    // be a power of 2 (for FFT).
+    int size = 64;
+    while (size/2 < largestSize) {
+        size = size << 1;
+    }
+    return size;
+}
+
+const QVector<kiss_fft_cpx> FFTCorrelation::spectrum(const qint64 *data, const int dataSize, const int fftSize, const bool reversed)
+{
+    QVector<float> padded(fftSize, 0);
+    float *values = padded.data();
+
+    // The qint64 values are normalized to floats by dividing by the max value.
+    // Plain multiplications without branches, so the compiler can vectorize these loops.
+    const float factor = 1.0f / absMax(data, dataSize);
+    if (reversed) {
+        for (int i = 0; i < dataSize; ++i) {
+            values[dataSize-1 - i] = float(data[i]) * factor;
+        }
+    } else {
+        for (int i = 0; i < dataSize; ++i) {
+            values[i] = float(data[i]) * factor;
+        }
+    }
+
+    QVector<kiss_fft_cpx> result(fftSize/2 + 1);
+    kiss_fftr_cfg cfg = fftPlans->acquire(fftSize, false);
+    kiss_fftr(cfg, padded.constData(), result.data());
+    fftPlans->release(fftSize, false, cfg);
+    return result;
+}
+
+void FFTCorrelation::correlate(const QVector<kiss_fft_cpx> &mainSpectrum, const int mainSize,
+                               const qint64 *sub, const int subSize,
                                qint64 *out_correlated)
 {
-    float correlatedFloat[leftSize+rightSize+1];
-    correlate(left, leftSize, right, rightSize, correlatedFloat);
+    // A real FFT of size n gives n/2+1 complex values
+    const int bins = mainSpectrum.size();
+    const int fftSize = (bins - 1) * 2;
+    Q_ASSERT(fftSize >= 2 * qMax(mainSize, subSize));
+
+    // One side needs to be reverted, since multiplication in frequency domain (fourier space)
+    // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
+    QVector<kiss_fft_cpx> correlatedFFT = spectrum(sub, subSize, fftSize, true);
+    for (int i = 0; i < bins; ++i) {
+        const kiss_fft_cpx m = mainSpectrum.at(i);
+        const kiss_fft_cpx c = correlatedFFT.at(i);
+        correlatedFFT[i].r = m.r*c.r - m.i*c.i;
+        correlatedFFT[i].i = m.r*c.i + m.i*c.r;
+    }
 
+    QVector<float> convolved(fftSize);
+    kiss_fftr_cfg cfg = fftPlans->acquire(fftSize, true);
+    kiss_fftri(cfg, correlatedFFT.constData(), convolved.data());
+    fftPlans->release(fftSize, true, cfg);
+
+    // Insert one element at the beginning to obtain the same result
+    // that we also get with the nested for loop correlation.
     // The correlation vector will have entries up to N (number of entries
     // of the vector), so converting to integers will not lose that much
     // of precision.
-    for (int i = 0; i < leftSize+rightSize+1; ++i) {
-        out_correlated[i] = correlatedFloat[i];
+    out_correlated[0] = 0;
+    for (int i = 0; i < mainSize+subSize; ++i) {
+        out_correlated[i+1] = convolved.at(i);
     }
 }
 
@@ -41,38 +164,30 @@ void FFTCorrelation::correlate(const qint64 *left, const int leftSize,
     QTime t;
     t.start();
 
-    float leftF[leftSize];
-    float rightF[rightSize];
+    QVector<float> leftF(leftSize);
+    QVector<float> rightF(rightSize);
+    float *leftData = leftF.data();
+    float *rightData = rightF.data();
 
     // First the qint64 values need to be normalized to floats
     // Dividing by the max value is maybe not the best solution, but the
     // maximum value after correlation should not be larger than the longest
     // vector since each value should be at most 1
-    qint64 maxLeft = 1;
-    qint64 maxRight = 1;
-    for (int i = 0; i < leftSize; ++i) {
-        if (labs(left[i]) > maxLeft) {
-            maxLeft = labs(left[i]);
-        }
-    }
-    for (int i = 0; i < rightSize; ++i) {
-        if (labs(right[i]) > maxRight) {
-            maxRight = labs(right[i]);
-        }
-    }
-
+    const float leftFactor = 1.0f / absMax(left, leftSize);
+    const float rightFactor = 1.0f / absMax(right, rightSize);
 
     // One side needs to be reverted, since multiplication in frequency domain (fourier space)
     // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
+    // Plain multiplications without branches, so the compiler can vectorize these loops.
     for (int i = 0; i < leftSize; ++i) {
-        leftF[i] = double(left[i])/maxLeft;
+        leftData[i] = float(left[i]) * leftFactor;
     }
     for (int i = 0; i < rightSize; ++i) {
-        rightF[rightSize-1 - i] = double(right[i])/maxRight;
+        rightData[rightSize-1 - i] = float(right[i]) * rightFactor;
     }
 
     // Now we can convolve to get the correlation
-    convolve(leftF, leftSize, rightF, rightSize, out_correlated);
+    convolve(leftData, leftSize, rightData, rightSize, out_correlated);
 
     qDebug() << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
 }
@@ -85,47 +200,34 @@ void FFTCorrelation::convolve(const float *left, const int leftSize,
     time.start();
 
 
-    // To avoid issues with repetition (we are dealing with cosine waves
-    // in the fourier domain) we need to pad the vectors to at least twice their size,
-    // otherwise convolution would convolve with the repeated pattern as well
-    int largestSize = leftSize;
-    if (rightSize > largestSize) {
-        largestSize = rightSize;
-    }
+    const int size = paddedSize(qMax(leftSize, rightSize));
 
-    // The vectors must have the same size (same frequency resolution!) and should
-    // be a power of 2 (for FFT).
-    int size = 64;
-    while (size/2 < largestSize) {
-        size = size << 1;
-    }
-
-    kiss_fftr_cfg fftConfig = kiss_fftr_alloc(size, false, NULL,NULL);
-    kiss_fftr_cfg ifftConfig = kiss_fftr_alloc(size, true, NULL,NULL);
-    kiss_fft_cpx leftFFT[size/2];
-    kiss_fft_cpx rightFFT[size/2];
-    kiss_fft_cpx correlatedFFT[size/2];
+    // A real FFT of size n gives n/2+1 complex values
+    const int bins = size/2 + 1;
+    QVector<kiss_fft_cpx> leftFFT(bins);
+    QVector<kiss_fft_cpx> rightFFT(bins);
+    QVector<kiss_fft_cpx> correlatedFFT(bins);
 
 
     // Fill in the data into our new vectors with padding
-    float * leftData = new float[size];
-    float * rightData = new float[size];
-    float * convolved = new float[size];
+    QVector<float> leftData(size, 0);
+    QVector<float> rightData(size, 0);
+    QVector<float> convolved(size);
 
-    std::fill(leftData, leftData+size, 0);
-    std::fill(rightData, rightData+size, 0);
+    std::copy(left, left+leftSize, leftData.begin());
+    std::copy(right, right+rightSize, rightData.begin());
 
-    std::copy(left, left+leftSize, leftData);
-    std::copy(right, right+rightSize, rightData);
+    kiss_fftr_cfg fftConfig = fftPlans->acquire(size, false);
+    kiss_fftr_cfg ifftConfig = fftPlans->acquire(size, true);
 
     // Fourier transformation of the vectors
-    kiss_fftr(fftConfig, leftData, leftFFT);
-    kiss_fftr(fftConfig, rightData, rightFFT);
+    kiss_fftr(fftConfig, leftData.constData(), leftFFT.data());
+    kiss_fftr(fftConfig, rightData.constData(), rightFFT.data());
 
     // Convolution in spacial domain is a multiplication in fourier domain. O(n).
-    for (int i = 0; i < size/2; ++i) {
-        correlatedFFT[i].r = leftFFT[i].r*rightFFT[i].r - leftFFT[i].i*rightFFT[i].i;
-        correlatedFFT[i].i = leftFFT[i].r*rightFFT[i].i + leftFFT[i].i*rightFFT[i].r;
+    for (int i = 0; i < bins; ++i) {
+        correlatedFFT[i].r = leftFFT.at(i).r*rightFFT.at(i).r - leftFFT.at(i).i*rightFFT.at(i).i;
+        correlatedFFT[i].i = leftFFT.at(i).r*rightFFT.at(i).i + leftFFT.at(i).i*rightFFT.at(i).r;
     }
 
     // Inverse fourier tranformation to get the convolved data.
@@ -134,16 +236,11 @@ void FFTCorrelation::convolve(const float *left, const int leftSize,
     *out_convolved = 0;
     int out_size = leftSize+rightSize+1;
 
-    kiss_fftri(ifftConfig, correlatedFFT, convolved);
-    std::copy(convolved, convolved+out_size-1, out_convolved+1);
-
-    // Finally some cleanup.
-    kiss_fftr_free(fftConfig);
-    kiss_fftr_free(ifftConfig);
+    kiss_fftri(ifftConfig, correlatedFFT.constData(), convolved.data());
+    std::copy(convolved.constBegin(), convolved.constBegin()+out_size-1, out_convolved+1);
 
-    delete[] leftData;
-    delete[] rightData;
-    delete[] convolved;
+    fftPlans->release(size, false, fftConfig);
+    fftPlans->release(size, true, ifftConfig);
 
     qDebug() << "FFT convolution computed. Time taken: " << time.elapsed() << " ms";
 }
@@ -12,6 +12,9 @@ the Free Software Foundation, either version 3 of the License, or
 #define FFTCORRELATION_H
 
 #include <QtGlobal>
+#include <QVector>
+#include "../external/kiss_fft/tools/kiss_fftr.h"
+
 /**
   This class provides methods to calculate convolution
   and correlation of two vectors by means of FFT, which
@@ -34,7 +37,9 @@ public:
     /**
       Computes the correlation between \c left and \c right.
       \c out_correlated must be a pre-allocated vector of size
-      \c leftSize + \c rightSize.
+      \c leftSize + \c rightSize + 1.
+      Working buffers are allocated on the heap and FFT configurations
+      are reused between calls, so long envelopes can be correlated.
       */
     static void correlate(const qint64 *left, const int leftSize,
                           const qint64 *right, const int rightSize,
@@ -43,6 +48,30 @@ public:
     static void correlate(const qint64 *left, const int leftSize,
                           const qint64 *right, const int rightSize,
                           qint64 *out_correlated);
+
+    /**
+      Returns the FFT size used to correlate vectors of at most \c largestSize entries.
+      */
+    static int paddedSize(const int largestSize);
+
+    /**
+      Normalizes \c data, pads it to \c fftSize and returns its spectrum.
+      With \c reversed the vector is mirrored first, which turns the
+      convolution into a correlation.
+      */
+    static const QVector<kiss_fft_cpx> spectrum(const qint64 *data, const int dataSize, const int fftSize, const bool reversed = false);
+
+    /**
+      Computes the correlation between a main vector, given by its spectrum,
+      and \c sub. This way the main spectrum is computed once when aligning
+      several vectors to it. The spectrum size must come from paddedSize()
+      for the largest of both vectors. Safe to call from several threads.
+      \c out_correlated must be a pre-allocated vector of size
+      \c mainSize + \c subSize + 1.
+      */
+    static void correlate(const QVector<kiss_fft_cpx> &mainSpectrum, const int mainSize,
+                          const qint64 *sub, const int subSize,
+                          qint64 *out_correlated);
 };
 
 #endif // FFTCORRELATION_H
@@ -11,9 +11,12 @@
 #include "fftTools.h"
 
 #include <math.h>
+#include <algorithm>
 #include <iostream>
 
 #include <QString>
+#include <QMutex>
+#include <QList>
 
 // Uncomment for debugging, like writing a GNU Octave .m file to /tmp
 //#define DEBUG_FFTTOOLS
@@ -24,6 +27,43 @@
 #include <fstream>
 #endif
 
+// Number of spectra kept for the scopes sharing the same audio frame
+#define SHARED_SPECTRA 4
+
+namespace {
+/**
+  The audio scopes receive implicitly shared copies of the same frame.
+  Keeping the frame alive in the cache guarantees that its data pointer
+  identifies it, so scopes with identical settings reuse one FFT.
+  */
+struct SharedSpectrum
+{
+    audioShortVector frame;
+    uint channel;
+    uint numChannels;
+    FFTTools::WindowType windowType;
+    uint windowSize;
+    float param;
+    QVector<float> spectrum;
+
+    bool matches(const audioShortVector &otherFrame, uint otherChannel, uint otherNumChannels,
+                 FFTTools::WindowType otherType, uint otherSize, float otherParam) const
+    {
+        return frame.constData() == otherFrame.constData() && frame.size() == otherFrame.size()
+                && channel == otherChannel && numChannels == otherNumChannels
+                && windowType == otherType && windowSize == otherSize && param == otherParam;
+    }
+};
+
+struct SharedSpectra
+{
+    QMutex mutex;
+    QList<SharedSpectrum> entries;
+};
+
+Q_GLOBAL_STATIC(SharedSpectra, sharedSpectra)
+}
+
 FFTTools::FFTTools() :
         m_fftCfgs(),
         m_windowFunctions()
@@ -123,6 +163,17 @@ void FFTTools::fftNormalized(const audioShortVector audioFrame, const uint chann
 	if (windowSize & 1 || windowSize < 2)
 	    return;
 
+    // Another scope may already have transformed this frame with the same settings
+    {
+        QMutexLocker lock(&sharedSpectra->mutex);
+        foreach (const SharedSpectrum &entry, sharedSpectra->entries) {
+            if (entry.matches(audioFrame, channel, numChannels, windowType, windowSize, param)) {
+                std::copy(entry.spectrum.constBegin(), entry.spectrum.constEnd(), freqSpectrum);
+                return;
+            }
+        }
+    }
+
     const QString cfgSig = cfgSignature(windowSize);
     const QString winSig = windowSignature(windowType, windowSize, param);
 
@@ -143,47 +194,37 @@ void FFTTools::fftNormalized(const audioShortVector audioFrame, const uint chann
         m_fftCfgs.insert(cfgSig, myCfg);
     }
 
-    // Get the window function from the cache
-    // (except for a rectangular window; nothing to to there.
+    // Get the window function from the cache. The rectangular window is
+    // cached as well, a table of ones keeps the sample loop free of branches.
     QVector<float> window;
-    float windowScaleFactor = 1;
-    if (windowType != FFTTools::Window_Rect) {
-
-        if (m_windowFunctions.contains(winSig)) {
+    if (m_windowFunctions.contains(winSig)) {
 #ifdef DEBUG_FFTTOOLS
-            qDebug() << "Re-using window function with signature " << winSig;
+        qDebug() << "Re-using window function with signature " << winSig;
 #endif
-            window = m_windowFunctions.value(winSig);
-        } else {
+        window = m_windowFunctions.value(winSig);
+    } else {
 #ifdef DEBUG_FFTTOOLS
-            qDebug() << "Building new window function with signature " << winSig;
+        qDebug() << "Building new window function with signature " << winSig;
 #endif
-            window = FFTTools::window(windowType, windowSize, 0);
-            m_windowFunctions.insert(winSig, window);
-        }
-        windowScaleFactor = 1.0/window[windowSize];
+        window = FFTTools::window(windowType, windowSize, 0);
+        m_windowFunctions.insert(winSig, window);
     }
+    const float windowScaleFactor = 1.0/window[windowSize];
+    const float *windowData = window.constData();
 
 
-    // Prepare frequency space vector. The resulting FFT vector is only half as long.
-    kiss_fft_cpx freqData[windowSize/2];
+    // Prepare frequency space vector. The resulting FFT vector holds windowSize/2+1 values.
+    kiss_fft_cpx freqData[windowSize/2 + 1];
     float data[windowSize];
 
     // Copy the first channel's audio into a vector for the FFT display;
     // Fill the data vector indices that cannot be covered with sample data with 0
-    if (numSamples < windowSize) {
-        std::fill(&data[numSamples], &data[windowSize-1], 0);
-    }
+    const uint copied = qMin(numSamples, windowSize);
+    std::fill(&data[copied], &data[windowSize], 0);
     // Normalize signals to [0,1] to get correct dB values later on
-    for (uint i = 0; i < numSamples && i < windowSize; ++i) {
-        // Performance note: Benchmarking has shown that using the if/else inside the loop
-        // does not do noticeable worse than keeping it outside (perhaps the branch predictor
-        // is good enough), so it remains in there for better readability.
-        if (windowType != FFTTools::Window_Rect) {
-            data[i] = (float) audioFrame.data()[i*numChannels + channel] / 32767.0f * window[i];
-        } else {
-            data[i] = (float) audioFrame.data()[i*numChannels + channel] / 32767.0f;
-        }
+    const qint16 *samples = audioFrame.constData() + channel;
+    for (uint i = 0; i < copied; ++i) {
+        data[i] = (float) samples[i*numChannels] / 32767.0f * windowData[i];
     }
 
     // Calculate the Fast Fourier Transform for the input data
@@ -192,10 +233,27 @@ void FFTTools::fftNormalized(const audioShortVector audioFrame, const uint chann
 
     // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
     // with N = FFT size (after FFT, 1/2 window size)
+    // Computed as 10 * log(r² + i²) - 20 * log(N) to avoid the square root.
+    const float scale2 = windowScaleFactor * windowScaleFactor;
+    const float offset = 20 * log10f((float)windowSize/2.0f);
     for (uint i = 0; i < windowSize/2; ++i) {
-        // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-        // with N = FFT size (after FFT, 1/2 window size)
-        freqSpectrum[i] = 20*log(pow(pow(fabs(freqData[i].r * windowScaleFactor),2) + pow(fabs(freqData[i].i * windowScaleFactor),2), .5)/((float)windowSize/2.0f))/log(10);;
+        const float magnitude2 = (freqData[i].r * freqData[i].r + freqData[i].i * freqData[i].i) * scale2;
+        freqSpectrum[i] = 10 * log10f(magnitude2) - offset;
+    }
+
+    SharedSpectrum entry;
+    entry.frame = audioFrame;
+    entry.channel = channel;
+    entry.numChannels = numChannels;
+    entry.windowType = windowType;
+    entry.windowSize = windowSize;
+    entry.param = param;
+    entry.spectrum = QVector<float>(windowSize/2);
+    std::copy(freqSpectrum, freqSpectrum + windowSize/2, entry.spectrum.begin());
+    QMutexLocker lock(&sharedSpectra->mutex);
+    sharedSpectra->entries.prepend(entry);
+    while (sharedSpectra->entries.size() > SHARED_SPECTRA) {
+        sharedSpectra->entries.removeLast();
     }
 
 
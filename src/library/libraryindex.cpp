@@ -0,0 +1,177 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "libraryindex.h"
+#include "doc/kthumb.h"
+#include "timecode.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include <mlt++/Mlt.h>
+
+// Height of the library thumbnails, width follows the clip aspect ratio
+#define THUMBNAIL_HEIGHT 45
+
+LibraryIndex::LibraryIndex(QObject *parent) : QObject(parent)
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/library"));
+    if (!dir.exists()) {
+        dir.mkpath(QStringLiteral("."));
+    }
+    m_folder = dir.absolutePath();
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(slotAnalysed()));
+    load();
+}
+
+LibraryIndex::~LibraryIndex()
+{
+    m_queue.clear();
+    m_watcher.waitForFinished();
+}
+
+QString LibraryIndex::key(const QString &path) const
+{
+    return QString(QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+void LibraryIndex::load()
+{
+    QSettings index(m_folder + QStringLiteral("/index.ini"), QSettings::IniFormat);
+    const QStringList keys = index.childGroups();
+    foreach(const QString &fileKey, keys) {
+        index.beginGroup(fileKey);
+        Entry entry;
+        entry.path = index.value(QStringLiteral("path")).toString();
+        entry.modified = index.value(QStringLiteral("modified")).toLongLong();
+        entry.frames = index.value(QStringLiteral("frames")).toInt();
+        entry.fps = index.value(QStringLiteral("fps")).toDouble();
+        index.endGroup();
+        if (!entry.path.isEmpty()) {
+            m_entries.insert(entry.path, entry);
+        }
+    }
+}
+
+void LibraryIndex::store(const Entry &entry)
+{
+    const QString fileKey = key(entry.path);
+    QSettings index(m_folder + QStringLiteral("/index.ini"), QSettings::IniFormat);
+    index.beginGroup(fileKey);
+    index.setValue(QStringLiteral("path"), entry.path);
+    index.setValue(QStringLiteral("modified"), entry.modified);
+    index.setValue(QStringLiteral("frames"), entry.frames);
+    index.setValue(QStringLiteral("fps"), entry.fps);
+    index.endGroup();
+    const QString thumbPath = m_folder + QStringLiteral("/") + fileKey + QStringLiteral(".png");
+    if (entry.thumbnail.isNull()) {
+        QFile::remove(thumbPath);
+    } else {
+        entry.thumbnail.save(thumbPath);
+    }
+    // Thumbnails are only loaded on lookup, they are not kept in memory
+    Entry cached = entry;
+    cached.thumbnail = QImage();
+    m_entries.insert(entry.path, cached);
+}
+
+bool LibraryIndex::lookup(const QString &path, qint64 modified, Entry *entry) const
+{
+    QHash <QString, Entry>::const_iterator it = m_entries.constFind(path);
+    if (it == m_entries.constEnd() || it.value().modified != modified) {
+        return false;
+    }
+    *entry = it.value();
+    entry->thumbnail = QImage(m_folder + QStringLiteral("/") + key(path) + QStringLiteral(".png"));
+    return true;
+}
+
+void LibraryIndex::request(const QStringList &paths, const QList <qint64> &modified)
+{
+    for (int i = 0; i < paths.count(); ++i) {
+        if (!m_queuedTimes.contains(paths.at(i))) {
+            m_queue << paths.at(i);
+        }
+        m_queuedTimes.insert(paths.at(i), modified.at(i));
+    }
+    if (!m_watcher.isRunning()) {
+        processNext();
+    }
+}
+
+void LibraryIndex::clearQueue()
+{
+    m_queue.clear();
+    m_queuedTimes.clear();
+}
+
+void LibraryIndex::processNext()
+{
+    if (m_queue.isEmpty()) {
+        return;
+    }
+    const QString path = m_queue.takeFirst();
+    const qint64 modified = m_queuedTimes.take(path);
+    m_watcher.setFuture(QtConcurrent::run(&LibraryIndex::analyse, path, modified));
+}
+
+void LibraryIndex::slotAnalysed()
+{
+    const Entry entry = m_watcher.result();
+    store(entry);
+    emit indexed(entry);
+    processNext();
+}
+
+//static
+LibraryIndex::Entry LibraryIndex::analyse(const QString &path, qint64 modified)
+{
+    Entry entry;
+    entry.path = path;
+    entry.modified = modified;
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, path.toUtf8().constData());
+    if (!producer.is_valid()) {
+        return entry;
+    }
+    entry.frames = producer.get_playtime();
+    entry.fps = profile.fps();
+    if (producer.get_int("video_index") < 0 && producer.get("video_index") != NULL) {
+        // Audio only file
+        return entry;
+    }
+    int width = THUMBNAIL_HEIGHT * profile.dar() + 0.5;
+    width += width % 2;
+    // Thumbnail from the middle of the clip, the first frame is often black
+    entry.thumbnail = KThumb::getFrame(&producer, entry.frames / 2, width, THUMBNAIL_HEIGHT);
+    return entry;
+}
+
+//static
+QString LibraryIndex::durationText(const Entry &entry)
+{
+    if (entry.frames <= 0 || entry.fps <= 0) {
+        return QString();
+    }
+    return Timecode::getStringTimecode(entry.frames, entry.fps);
+}
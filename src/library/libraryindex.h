@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QStringList>
+#include <QFutureWatcher>
+
+/**
+ * @class LibraryIndex
+ * @brief Persistent index of the library clips, with their thumbnail and duration.
+ *
+ * Entries are stored in the cache folder and matched against the file modification time,
+ * so a library is only analysed once, even when it lives on a slow network share.
+ * Missing or outdated entries are built in a worker thread, one file at a time, and
+ * reported through indexed() so that the library tree can be filled incrementally.
+ */
+class LibraryIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Result of the analysis of a library file. */
+    struct Entry
+    {
+        Entry() : modified(0), frames(0), fps(0) {}
+        QString path;
+        qint64 modified;
+        int frames;
+        double fps;
+        QImage thumbnail;
+    };
+
+    explicit LibraryIndex(QObject *parent = 0);
+    virtual ~LibraryIndex();
+    /** @brief Returns true and fills entry if path is indexed for this modification time. */
+    bool lookup(const QString &path, qint64 modified, Entry *entry) const;
+    /** @brief Queue files for background indexing, files already queued are skipped. */
+    void request(const QStringList &paths, const QList <qint64> &modified);
+    /** @brief Drop the queued files, for example when the library folder changes. */
+    void clearQueue();
+    /** @brief Returns the duration of an entry formatted for display, empty if unknown. */
+    static QString durationText(const Entry &entry);
+
+private:
+    QHash <QString, Entry> m_entries;
+    QStringList m_queue;
+    QHash <QString, qint64> m_queuedTimes;
+    QFutureWatcher <Entry> m_watcher;
+    /** @brief Index file and thumbnail folder. */
+    QString m_folder;
+    void load();
+    void store(const Entry &entry);
+    QString key(const QString &path) const;
+    void processNext();
+    static Entry analyse(const QString &path, qint64 modified);
+
+private slots:
+    void slotAnalysed();
+
+signals:
+    /** @brief A file was indexed, the thumbnail is null if it could not be loaded. */
+    void indexed(const LibraryIndex::Entry &entry);
+};
+
+#endif
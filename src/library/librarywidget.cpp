@@ -167,7 +167,6 @@ void LibraryTree::dropEvent(QDropEvent *event)
 
 LibraryWidget::LibraryWidget(ProjectManager *manager, QWidget *parent) : QWidget(parent)
   , m_manager(manager)
-  , m_previewJob(NULL)
 {
     QVBoxLayout *lay = new QVBoxLayout(this);
     m_libraryTree = new LibraryTree(this);
@@ -218,6 +217,9 @@ LibraryWidget::LibraryWidget(ProjectManager *manager, QWidget *parent) : QWidget
     connect(m_libraryTree, &LibraryTree::moveData, this, &LibraryWidget::slotMoveData);
     connect(m_libraryTree, &LibraryTree::importSequence, this, &LibraryWidget::slotSaveSequence);
 
+    m_index = new LibraryIndex(this);
+    connect(m_index, &LibraryIndex::indexed, this, &LibraryWidget::slotIndexed);
+
     m_coreLister = new KCoreDirLister(this);
     m_coreLister->setDelayedMimeTypes(false);
     connect(m_coreLister, SIGNAL(itemsAdded(const QUrl &, const KFileItemList &)), this, SLOT(slotItemsAdded (const QUrl &, const KFileItemList &)));
@@ -461,7 +463,9 @@ void LibraryWidget::slotUpdateLibraryPath()
 {
     // Library path changed, reload library with updated path
     m_libraryTree->blockSignals(true);
+    m_index->clearQueue();
     m_folders.clear();
+    m_clips.clear();
     m_libraryTree->clear();
     QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + QStringLiteral("/library");
     if (KdenliveSettings::librarytodefaultfolder() || KdenliveSettings::libraryfolder().isEmpty()) {
@@ -500,63 +504,58 @@ void LibraryWidget::slotUpdateLibraryPath()
     m_libraryTree->blockSignals(false);
 }
 
-void LibraryWidget::slotGotPreview(const KFileItem &item, const QPixmap &pix)
+void LibraryWidget::setItemInfo(QTreeWidgetItem *item, const LibraryIndex::Entry &entry)
 {
-    const QString path = item.url().path();
+    if (!entry.thumbnail.isNull()) {
+        item->setData(0, Qt::DecorationRole, QIcon(QPixmap::fromImage(entry.thumbnail)));
+    }
+    const QString duration = LibraryIndex::durationText(entry);
+    const QString time = item->data(0, Qt::UserRole + 3).toString();
+    item->setData(0, Qt::UserRole + 1, duration.isEmpty() ? time : duration + QStringLiteral(" - ") + time);
+}
+
+void LibraryWidget::slotIndexed(const LibraryIndex::Entry &entry)
+{
+    QTreeWidgetItem *item = m_clips.value(entry.path);
+    if (!item) {
+        // Removed while it was analysed
+        return;
+    }
     m_libraryTree->blockSignals(true);
-    m_libraryTree->slotUpdateThumb(path, pix);
+    setItemInfo(item, entry);
     m_libraryTree->blockSignals(false);
 }
 
+void LibraryWidget::forgetItems(const QString &path)
+{
+    const QString folderPath = path + QLatin1Char('/');
+    QHash <QString, QTreeWidgetItem *>::iterator it = m_folders.begin();
+    while (it != m_folders.end()) {
+        if (it.key() == path || it.key().startsWith(folderPath)) it = m_folders.erase(it);
+        else ++it;
+    }
+    it = m_clips.begin();
+    while (it != m_clips.end()) {
+        if (it.key().startsWith(folderPath)) it = m_clips.erase(it);
+        else ++it;
+    }
+}
+
 void LibraryWidget::slotItemsDeleted(const KFileItemList &list)
 {
     m_libraryTree->blockSignals(true);
     QMutexLocker lock(&m_treeMutex);
     foreach(const KFileItem &fitem, list) {
-        QUrl fileUrl = fitem.url();
-        QString path;
-        if (fitem.isDir()) {
-            path = fileUrl.path();
-        } else {
-            path = fileUrl.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).path();
-        }
-        QTreeWidgetItem *matchingFolder = NULL;
-        if (path != m_directory.path()) {
-            foreach(QTreeWidgetItem *folder, m_folders) {
-                if (folder->data(0, Qt::UserRole).toString() == path) {
-                    // Found parent folder
-                    matchingFolder = folder;
-                    break;
-                }
-            }
-        }
+        const QString path = fitem.url().path();
         if (fitem.isDir()) {
+            QTreeWidgetItem *matchingFolder = m_folders.value(path);
             if (matchingFolder) {
-                m_folders.removeAll(matchingFolder);
                 // warning, we also need to remove all subfolders since they will be recreated
-                QList <QTreeWidgetItem *> subList;
-                foreach(QTreeWidgetItem *folder, m_folders) {
-                    if (folder->data(0, Qt::UserRole).toString().startsWith(path)) {
-                        subList << folder;
-                    }
-                }
-                foreach(QTreeWidgetItem *sub, subList) {
-                    m_folders.removeAll(sub);
-                }
+                forgetItems(path);
                 delete matchingFolder;
             }
         } else {
-            if (matchingFolder == NULL) {
-                matchingFolder = m_libraryTree->invisibleRootItem();
-            }
-            for(int i = 0; i < matchingFolder->childCount(); i++) {
-                QTreeWidgetItem *item = matchingFolder->child(i);
-                if (item->data(0, Qt::UserRole).toString() == fileUrl.path()) {
-                    // Found deleted item
-                    delete item;
-                    break;
-                }
-            }
+            delete m_clips.take(path);
         }
     }
     m_libraryTree->blockSignals(false);
@@ -567,6 +566,8 @@ void LibraryWidget::slotItemsAdded(const QUrl &url, const KFileItemList &list)
 {
     m_libraryTree->blockSignals(true);
     QMutexLocker lock(&m_treeMutex);
+    QStringList pending;
+    QList <qint64> pendingTimes;
     foreach(const KFileItem &fitem, list) {
         QUrl fileUrl = fitem.url();
         QString name = fileUrl.fileName();
@@ -574,39 +575,44 @@ void LibraryWidget::slotItemsAdded(const QUrl &url, const KFileItemList &list)
         QTreeWidgetItem *parent = NULL;
         if (url != QUrl::fromLocalFile(m_directory.path())) {
             // not a top level item
-            QString directory = fileUrl.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).path();
-            foreach(QTreeWidgetItem *folder, m_folders) {
-                if (folder->data(0, Qt::UserRole).toString() == directory) {
-                    // Found parent folder
-                    parent = folder;
-                    break;
-                }
-            }
+            parent = m_folders.value(fileUrl.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).path());
         }
         if (parent) {
             treeItem = new QTreeWidgetItem(parent, QStringList() << name);
         } else {
             treeItem = new QTreeWidgetItem(m_libraryTree, QStringList() << name);
         }
-        treeItem->setData(0, Qt::UserRole, fileUrl.path());
+        const QString path = fileUrl.path();
+        treeItem->setData(0, Qt::UserRole, path);
         treeItem->setData(0, Qt::UserRole + 1, fitem.timeString());
+        treeItem->setData(0, Qt::UserRole + 3, fitem.timeString());
+        treeItem->setData(0, Qt::DecorationRole, KoIconUtils::themedIcon(fitem.iconName()));
+        treeItem->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled | Qt::ItemIsEditable);
         if (fitem.isDir()) {
             treeItem->setData(0, Qt::UserRole + 2, (int) LibraryItem::Folder);
-            m_folders << treeItem;
+            m_folders.insert(path, treeItem);
             m_coreLister->openUrl(fileUrl, KCoreDirLister::Keep);
+            continue;
         }
-        else if (name.endsWith(".mlt") || name.endsWith(".kdenlive")) {
+        if (name.endsWith(".mlt") || name.endsWith(".kdenlive")) {
             treeItem->setData(0, Qt::UserRole + 2, (int) LibraryItem::PlayList);
         } else {
             treeItem->setData(0, Qt::UserRole + 2, (int) LibraryItem::Clip);
         }
-        treeItem->setData(0, Qt::DecorationRole, KoIconUtils::themedIcon(fitem.iconName()));
-        treeItem->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled | Qt::ItemIsEditable);
+        m_clips.insert(path, treeItem);
+        // Use the indexed thumbnail and duration, analyse new or modified files in the background
+        const qint64 modified = fitem.time(KFileItem::ModificationTime).toMSecsSinceEpoch();
+        LibraryIndex::Entry entry;
+        if (m_index->lookup(path, modified, &entry)) {
+            setItemInfo(treeItem, entry);
+        } else {
+            pending << path;
+            pendingTimes << modified;
+        }
+    }
+    if (!pending.isEmpty()) {
+        m_index->request(pending, pendingTimes);
     }
-    QStringList plugins = KIO::PreviewJob::availablePlugins();
-    m_previewJob = KIO::filePreview(list, QSize(80, 80), &plugins);
-    m_previewJob->setIgnoreMaximumSize();
-    connect(m_previewJob, SIGNAL(gotPreview(const KFileItem &, const QPixmap &)), this, SLOT(slotGotPreview(const KFileItem &, const QPixmap &)));
     m_libraryTree->blockSignals(false);
 }
 
@@ -614,6 +620,7 @@ void LibraryWidget::slotClearAll()
 {
     m_libraryTree->blockSignals(true);
     m_folders.clear();
+    m_clips.clear();
     m_libraryTree->clear();
     m_libraryTree->blockSignals(false);
 }
@@ -29,6 +29,7 @@
 #define LIBRARYWIDGET_H
 
 #include "definitions.h"
+#include "libraryindex.h"
 
 #include <QTreeWidget>
 #include <QDir>
@@ -40,7 +41,6 @@
 
 #include <KMessageWidget>
 #include <KIOCore/KFileItem>
-#include <KIO/PreviewJob>
 #include <KIO/ListJob>
 #include <KIOCore/KCoreDirLister>
 
@@ -182,7 +182,8 @@ private slots:
     void slotItemEdited(QTreeWidgetItem *item, int column);
     void slotDownloadFinished(KJob *);
     void slotDownloadProgress(KJob *, unsigned long);
-    void slotGotPreview(const KFileItem &item, const QPixmap &pix);
+    /** @brief The background index analysed a library file, update its thumbnail and duration. */
+    void slotIndexed(const LibraryIndex::Entry &entry);
     void slotItemsAdded (const QUrl &url, const KFileItemList &list);
     void slotItemsDeleted(const KFileItemList &list);
     void slotClearAll();
@@ -196,12 +197,17 @@ private:
     QTimer m_timer;
     KMessageWidget *m_infoWidget;
     ProjectManager *m_manager;
-    QList <QTreeWidgetItem *> m_folders;
-    KIO::PreviewJob *m_previewJob;
+    /** @brief Folder and clip items, indexed by path */
+    QHash <QString, QTreeWidgetItem *> m_folders;
+    QHash <QString, QTreeWidgetItem *> m_clips;
+    LibraryIndex *m_index;
     KCoreDirLister *m_coreLister;
     QMutex m_treeMutex;
     QDir m_directory;
     void showMessage(const QString &text, KMessageWidget::MessageType type = KMessageWidget::Warning);
+    void setItemInfo(QTreeWidgetItem *item, const LibraryIndex::Entry &entry);
+    /** @brief Remove all items below path from the path indexes */
+    void forgetItems(const QString &path);
 
 signals:
     void addProjectClips(QList <QUrl>);
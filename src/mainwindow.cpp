@@ -36,6 +36,10 @@
 #include "monitor/recmonitor.h"
 #include "monitor/monitormanager.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/thumbnailcache.h"
+#include "doc/proxystore.h"
+#include "doc/mediaindex.h"
+#include "utils/tracer.h"
 #include "timeline/timeline.h"
 #include "timeline/track.h"
 #include "timeline/customtrackview.h"
@@ -68,6 +72,7 @@
 
 #include "utils/KoIconUtils.h"
 #include "project/dialogs/temporarydata.h"
+#include "project/dialogs/memoryusage.h"
 #ifdef USE_JOGSHUTTLE
 #include "jogshuttle/jogmanager.h"
 #endif
@@ -164,11 +169,21 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     qRegisterMetaType<MessageType> ("MessageType");
     qRegisterMetaType<stringMap> ("stringMap");
     qRegisterMetaType<audioByteArray> ("audioByteArray");
+    qRegisterMetaType<AudioLevels> ("AudioLevels");
     qRegisterMetaType< QVector <int> > ();
     qRegisterMetaType<QDomElement> ("QDomElement");
     qRegisterMetaType<requestClipInfo> ("requestClipInfo");
     qRegisterMetaType<MltVideoProfile> ("MltVideoProfile");
+    qRegisterMetaType<AnalysisResult> ("AnalysisResult");
+    // Created early in the main thread so that startup can be traced
+    Tracer::self();
+    TraceStages startup("startup");
+    startup.next("core");
     Core::build(this);
+    // Load the MLT modules while the interface is being built
+    MltConnection::preloadRepository();
+
+    startup.next("styles");
 
     // Widget themes for non KDE users
     KActionMenu *stylesAction= new KActionMenu(i18n("Style"), this);
@@ -219,6 +234,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     else ThemeManager::instance()->slotChangePalette();
     //QIcon::setThemeSearchPaths(QStringList() <<QStringLiteral(":/icons/"));
 
+    startup.next("subsystems");
     new RenderingAdaptor(this);
     pCore->initialize();
     MltConnection::locateMeltAndProfilesPath(MltPath);
@@ -240,6 +256,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     QTabBar *bar = m_timelineArea->findChild<QTabBar *>();
     bar->setHidden(true);
 
+    startup.next("effects");
     m_gpuAllowed = initEffects::parseEffectFiles(pCore->binController()->mltRepository());
     //initEffects::parseCustomEffectsFile();
 
@@ -247,6 +264,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     connect(m_shortcutRemoveFocus, SIGNAL(activated()), this, SLOT(slotRemoveFocus()));
 
     /// Add Widgets
+    startup.next("monitors");
     setDockOptions(dockOptions() | QMainWindow::AllowNestedDocks | QMainWindow::AllowTabbedDocks);
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
     setDockOptions(dockOptions() | QMainWindow::GroupedDragging);
@@ -309,6 +327,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     pCore->monitorManager()->initMonitors(m_clipMonitor, m_projectMonitor, m_recMonitor);
     connect(m_clipMonitor, SIGNAL(addMasterEffect(QString,QDomElement)), pCore->bin(), SLOT(slotEffectDropped(QString,QDomElement)));
 
+    startup.next("docks");
     // Audio spectrum scope
     m_audioSpectrum = new AudioGraphSpectrum(pCore->monitorManager());
     QDockWidget * spectrumDock = addDock(i18n("Audio Spectrum"), QStringLiteral("audiospectrum"), m_audioSpectrum);
@@ -395,6 +414,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     // Monitor Record action
     addAction(QStringLiteral("switch_monitor_rec"), m_clipMonitor->recAction());
 
+    startup.next("effect menus");
     // Build effects menu
     m_effectsMenu = new QMenu(i18n("Add Effect"), this);
     m_effectActions = new KActionCategory(i18n("Effects"), actionCollection());
@@ -404,7 +424,10 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     m_transitionActions = new KActionCategory(i18n("Transitions"), actionCollection());
     m_transitionList->reloadEffectList(m_transitionsMenu, m_transitionActions);
 
+    // Scope docks must exist before setupGUI() restores the dock layout
+    startup.next("scopes");
     ScopeManager *scmanager = new ScopeManager(this);
+    startup.next("actions");
 
     new LayoutManagement(this);
     new HideTitleBars(this);
@@ -476,6 +499,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     previewButtonAction->setDefaultWidget(timelinePreview);
     addAction(QStringLiteral("timeline_preview_button"), previewButtonAction);
 
+    startup.next("gui");
     setupGUI();
     if (firstRun) {
         QScreen *current = QApplication::primaryScreen();
@@ -581,6 +605,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     tlMenu->addSeparator();
     tlMenu->addAction(actionCollection()->action(QStringLiteral("disable_preview")));
     tlMenu->addAction(actionCollection()->action(QStringLiteral("manage_cache")));
+    tlMenu->addAction(actionCollection()->action(QStringLiteral("memory_usage")));
     timelinePreview->defineDefaultAction(prevRender, stopPrevRender);
     timelinePreview->setAutoRaise(true);
 
@@ -608,6 +633,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     m_timelineToolBar->addAction(m_zoomIn);*/
 
     // Populate encoding profiles
+    startup.next("encoding profiles");
     KConfig conf(QStringLiteral("encodingprofiles.rc"), KConfig::CascadeConfig, QStandardPaths::DataLocation);
     if (KdenliveSettings::proxyparams().isEmpty() || KdenliveSettings::proxyextension().isEmpty()) {
         KConfigGroup group(&conf, "proxy");
@@ -653,17 +679,28 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
             KdenliveSettings::setDecklink_extension(data.section(';', 1, 1));
         }
     }
+    startup.next("project manager");
     pCore->projectManager()->init(Url, clipsToLoad);
     QTimer::singleShot(0, pCore->projectManager(), SLOT(slotLoadOnOpen()));
     QTimer::singleShot(0, this, SIGNAL(GUISetupDone()));
     connect(this, SIGNAL(reloadTheme()), this, SLOT(slotReloadTheme()), Qt::UniqueConnection);
 
+    // Subsystems that are not needed to display the window are started
+    // from the event loop, once the window and project are on screen
+    QTimer::singleShot(0, scmanager, SLOT(slotCheckActiveScopes()));
+    QTimer::singleShot(0, this, SLOT(slotDeferredStartup()));
+    startup.finish();
+    //TODO: remove for release
+    m_messageLabel->setMessage("This is a beta version. Always backup your data", MltError);
+}
+
+void MainWindow::slotDeferredStartup()
+{
+    TRACE_ZONE("startup", "deferred");
 #ifdef USE_JOGSHUTTLE
     new JogManager(this);
 #endif
-    scmanager->slotCheckActiveScopes();
-    //TODO: remove for release
-    m_messageLabel->setMessage("This is a beta version. Always backup your data", MltError);
+    RenderWidget::preloadProfiles();
 }
 
 void MainWindow::slotThemeChanged(const QString &theme)
@@ -889,6 +926,7 @@ void MainWindow::slotConnectMonitors()
 {
     //connect(m_projectList, SIGNAL(deleteProjectClips(QStringList,QMap<QString,QString>)), this, SLOT(slotDeleteProjectClips(QStringList,QMap<QString,QString>)));
     connect(m_projectMonitor->render, SIGNAL(gotFileProperties(requestClipInfo,ClipController *)), pCore->bin(), SLOT(slotProducerReady(requestClipInfo,ClipController *)), Qt::DirectConnection);
+    connect(m_projectMonitor->render, SIGNAL(binClipsBatch(bool)), pCore->bin(), SLOT(slotClipBatch(bool)), Qt::DirectConnection);
 
     connect(m_clipMonitor, SIGNAL(refreshClipThumbnail(QString)), pCore->bin(), SLOT(slotRefreshClipThumbnail(QString)));
     connect(m_projectMonitor, SIGNAL(requestFrameForAnalysis(bool)), this, SLOT(slotMonitorRequestRenderFrame(bool)));
@@ -1273,6 +1311,11 @@ void MainWindow::setupActions()
     overlayAudioInfo->setCheckable(true);
     overlayAudioInfo->setData(0x10);
 
+    QAction *overlayPerformanceInfo =  new QAction(KoIconUtils::themedIcon(QStringLiteral("help-hint")), i18n("Monitor Overlay Performance"), this);
+    addAction(QStringLiteral("monitor_overlay_performance"), overlayPerformanceInfo);
+    overlayPerformanceInfo->setCheckable(true);
+    overlayPerformanceInfo->setData(0x40);
+
     QAction *dropFrames = new QAction(QIcon(), i18n("Real Time (drop frames)"), this);
     dropFrames->setCheckable(true);
     dropFrames->setChecked(KdenliveSettings::monitor_dropframes());
@@ -1300,6 +1343,15 @@ void MainWindow::setupActions()
     resizeEnd->setShortcut(Qt::Key_2);
     connect(resizeEnd, SIGNAL(triggered(bool)), this, SLOT(slotResizeItemEnd()));
 
+    // Multicam angle switches, the angles are the screens of the project monitor multitrack view
+    for (int i = 0; i < 4; ++i) {
+        QAction *angle = new QAction(QIcon(), i18n("Switch to Angle %1", i + 1), this);
+        angle->setData(i);
+        angle->setShortcut(Qt::ALT + Qt::Key_1 + i);
+        addAction(QStringLiteral("multicam_angle_%1").arg(i + 1), angle);
+        connect(angle, SIGNAL(triggered(bool)), this, SLOT(slotSwitchAngle()));
+    }
+
     addAction(QStringLiteral("monitor_seek_snap_backward"), i18n("Go to Previous Snap Point"), this, SLOT(slotSnapRewind()),
               KoIconUtils::themedIcon(QStringLiteral("media-seek-backward")), Qt::ALT + Qt::Key_Left);
     addAction(QStringLiteral("seek_clip_start"), i18n("Go to Clip Start"), this, SLOT(slotClipStart()), KoIconUtils::themedIcon(QStringLiteral("media-seek-backward")), Qt::Key_Home);
@@ -1406,6 +1458,11 @@ void MainWindow::setupActions()
     connect(configTracks, &QAction::triggered, this, &MainWindow::slotConfigTrack);
     timelineActions->addAction(QStringLiteral("config_tracks"), configTracks);
 
+    QAction *freezeTrack = new QAction(QIcon(), i18n("Freeze Track"), this);
+    freezeTrack->setToolTip(i18n("Play current track from a render of its clips and effects"));
+    connect(freezeTrack, &QAction::triggered, this, &MainWindow::slotFreezeTrack);
+    timelineActions->addAction(QStringLiteral("freeze_track"), freezeTrack);
+
     QAction *selectTrack = new QAction(QIcon(), i18n("Select All in Current Track"), this);
     connect(selectTrack, &QAction::triggered, this, &MainWindow::slotSelectTrack);
     timelineActions->addAction(QStringLiteral("select_track"), selectTrack);
@@ -1424,6 +1481,15 @@ void MainWindow::setupActions()
 
     // Cached data management
     addAction(QStringLiteral("manage_cache"), i18n("Manage Cached Data"), this, SLOT(slotManageCache()), KoIconUtils::themedIcon(QStringLiteral("network-server-database")));
+    addAction(QStringLiteral("memory_usage"), i18n("Memory Usage"), this, SLOT(slotShowMemoryUsage()));
+
+    // Performance tracing
+    QAction *recordTrace = new QAction(i18n("Record Performance Trace"), this);
+    recordTrace->setCheckable(true);
+    recordTrace->setChecked(Tracer::isRecording());
+    connect(recordTrace, &QAction::toggled, this, &MainWindow::slotRecordTrace);
+    addAction(QStringLiteral("record_trace"), recordTrace);
+    addAction(QStringLiteral("export_trace"), i18n("Export Performance Trace..."), this, SLOT(slotExportTrace()));
 
     QAction *disablePreview = new QAction(i18n("Disable Timeline Preview"), this);
     disablePreview->setCheckable(true);
@@ -1766,6 +1832,12 @@ void MainWindow::setRenderingFinished(const QString &url, int status, const QStr
         m_renderWidget->setRenderStatus(url, status, error);
 }
 
+void MainWindow::setRenderingSpeed(const QString &url, double fps, int cpu)
+{
+    if (m_renderWidget)
+        m_renderWidget->setRenderSpeed(url, fps, cpu);
+}
+
 void MainWindow::addProjectClip(const QString &url)
 {
     if (pCore->projectManager()->current()) {
@@ -1789,6 +1861,55 @@ void MainWindow::addTimelineClip(const QString &url)
     }
 }
 
+void MainWindow::addProjectClips(const QStringList &urls)
+{
+    if (!pCore->projectManager()->current()) return;
+    QList <QUrl> newUrls;
+    foreach(const QString &url, urls) {
+        const QUrl clipUrl = QUrl::fromLocalFile(url);
+        if (newUrls.contains(clipUrl) || !pCore->binController()->getBinIdsByResource(clipUrl).isEmpty()) {
+            // Clip is already in project bin
+            continue;
+        }
+        newUrls << clipUrl;
+    }
+    if (!newUrls.isEmpty()) {
+        ClipCreationDialog::createClipsCommand(pCore->projectManager()->current(), newUrls, QStringList(), pCore->bin());
+    }
+}
+
+void MainWindow::addTimelineClips(const QStringList &urls)
+{
+    foreach(const QString &url, urls) {
+        addTimelineClip(url);
+    }
+}
+
+void MainWindow::createProxies(const QStringList &urls)
+{
+    KdenliveDoc *project = pCore->projectManager()->current();
+    if (!project) return;
+    QList <ProjectClip *> clips;
+    foreach(const QString &url, urls) {
+        const QStringList ids = pCore->binController()->getBinIdsByResource(QUrl::fromLocalFile(url));
+        ProjectClip *clip = ids.isEmpty() ? NULL : pCore->bin()->getBinClip(ids.first());
+        if (clip && !clips.contains(clip)) {
+            clips << clip;
+        }
+    }
+    if (!clips.isEmpty()) {
+        project->slotProxyCurrentItem(true, clips);
+    }
+}
+
+QStringList MainWindow::clipJobs(const QString &url)
+{
+    if (!pCore->projectManager()->current()) return QStringList();
+    const QStringList ids = pCore->binController()->getBinIdsByResource(QUrl::fromLocalFile(url));
+    if (ids.isEmpty()) return QStringList();
+    return pCore->bin()->pendingJobs(ids.first());
+}
+
 void MainWindow::addEffect(const QString &effectName)
 {
     QStringList effectInfo;
@@ -1865,7 +1986,7 @@ void MainWindow::connectDocument()
 
     connect(trackView->projectView(), SIGNAL(importKeyframes(GraphicsRectItem,QString,QString)), this, SLOT(slotProcessImportKeyframes(GraphicsRectItem,QString,QString)));
     connect(trackView->projectView(), &CustomTrackView::updateTrimMode, this, &MainWindow::setTrimMode);
-    connect(m_projectMonitor, &Monitor::multitrackView, trackView, &Timeline::slotMultitrackView);
+    connect(m_projectMonitor, &Monitor::multitrackView, trackView, &Timeline::slotMultitrackViewToggled);
     connect(m_projectMonitor, SIGNAL(renderPosition(int)), trackView, SLOT(moveCursorPos(int)));
     connect(m_projectMonitor, SIGNAL(zoneUpdated(QPoint)), trackView, SLOT(slotSetZone(QPoint)));
     connect(m_projectMonitor, SIGNAL(zoneUpdated(QPoint)), project, SLOT(setModified()));
@@ -1908,6 +2029,7 @@ void MainWindow::connectDocument()
 
     // Effect stack signals
     connect(m_effectStack, SIGNAL(updateEffect(ClipItem*,int,QDomElement,QDomElement,int,bool)), trackView->projectView(), SLOT(slotUpdateClipEffect(ClipItem*,int,QDomElement,QDomElement,int,bool)));
+    connect(m_effectStack, SIGNAL(previewEffect(ClipItem*,int,QDomElement)), trackView->projectView(), SLOT(slotPreviewClipEffect(ClipItem*,int,QDomElement)));
     connect(m_effectStack, SIGNAL(updateClipRegion(ClipItem*,int,QString)), trackView->projectView(), SLOT(slotUpdateClipRegion(ClipItem*,int,QString)));
     connect(m_effectStack, SIGNAL(removeEffect(ClipItem*,int,QDomElement)), trackView->projectView(), SLOT(slotDeleteEffect(ClipItem*,int,QDomElement)));
     connect(m_effectStack, SIGNAL(removeEffectGroup(ClipItem*,int,QDomDocument)), trackView->projectView(), SLOT(slotDeleteEffectGroup(ClipItem*,int,QDomDocument)));
@@ -1926,6 +2048,7 @@ void MainWindow::connectDocument()
 
     connect(trackView->projectView(), SIGNAL(activateDocumentMonitor()), m_projectMonitor, SLOT(slotActivateMonitor()));
     connect(project, &KdenliveDoc::updateFps, trackView, &Timeline::updateProfile, Qt::DirectConnection);
+    connect(project, &KdenliveDoc::updateFrameSize, trackView, &Timeline::updateFrameSize, Qt::DirectConnection);
     connect(trackView, SIGNAL(zoneMoved(int,int)), this, SLOT(slotZoneMoved(int,int)));
     trackView->projectView()->setContextMenu(m_timelineContextMenu, m_timelineContextClipMenu, m_timelineContextTransitionMenu, m_clipTypeGroup, static_cast<QMenu*>(factory()->container(QStringLiteral("marker_menu"), this)));
     if (m_renderWidget) {
@@ -2073,8 +2196,12 @@ void MainWindow::updateConfiguration()
     if (pCore->projectManager()->currentTimeline()) {
         pCore->projectManager()->currentTimeline()->refresh();
 	    pCore->projectManager()->currentTimeline()->projectView()->checkAutoScroll();
+        pCore->projectManager()->currentTimeline()->projectView()->checkViewport();
         pCore->projectManager()->currentTimeline()->checkTrackHeight();
     }
+    pCore->thumbnailCache()->updateBudgets();
+    pCore->proxyStore()->updateWatchedFolders();
+    pCore->mediaIndex()->updateRoots();
     m_buttonAudioThumbs->setChecked(KdenliveSettings::audiothumbnails());
     m_buttonVideoThumbs->setChecked(KdenliveSettings::videothumbnails());
     m_buttonShowMarkers->setChecked(KdenliveSettings::showmarkers());
@@ -2371,6 +2498,15 @@ void MainWindow::slotConfigTrack()
         m_effectStack->transitionConfig()->updateProjectFormat();
 }
 
+void MainWindow::slotFreezeTrack()
+{
+    Timeline *timeline = pCore->projectManager()->currentTimeline();
+    if (timeline) {
+        int ix = timeline->projectView()->selectedTrack();
+        timeline->freezeTrack(ix, !timeline->isTrackFrozen(ix));
+    }
+}
+
 void MainWindow::slotSelectTrack()
 {
     pCore->monitorManager()->activateMonitor(Kdenlive::ProjectMonitor);
@@ -2925,6 +3061,13 @@ void MainWindow::slotResizeItemStart()
         pCore->projectManager()->currentTimeline()->projectView()->setInPoint();
 }
 
+void MainWindow::slotSwitchAngle()
+{
+    QAction *action = qobject_cast<QAction *>(sender());
+    if (action && pCore->projectManager()->currentTimeline())
+        pCore->projectManager()->currentTimeline()->switchAngle(action->data().toInt());
+}
+
 void MainWindow::slotResizeItemEnd()
 {
     if (pCore->projectManager()->currentTimeline())
@@ -3106,6 +3249,21 @@ void MainWindow::buildDynamicActions()
         }
         delete filter;
     }
+    filter = Mlt::Factory::filter(profile, (char*)"loudness");
+    if (filter) {
+        if (filter->is_valid()) {
+            QAction *action = new QAction(i18n("Normalize loudness"), m_extraFactory->actionCollection());
+            QStringList loudnessJob;
+            loudnessJob << QString::number((int) AbstractClipJob::FILTERCLIPJOB) << QStringLiteral("loudness");
+            action->setData(loudnessJob);
+            ts->addAction(action->text(), action);
+            connect(action, SIGNAL(triggered(bool)), pCore->bin(), SLOT(slotStartClipJob(bool)));
+            action = new QAction(i18n("Normalize loudness of all clips"), m_extraFactory->actionCollection());
+            ts->addAction(action->text(), action);
+            connect(action, SIGNAL(triggered(bool)), pCore->bin(), SLOT(slotNormalizeAllClips()));
+        }
+        delete filter;
+    }
     if (KdenliveSettings::producerslist().contains(QStringLiteral("timewarp"))) {
 	QAction *action = new QAction(i18n("Duplicate clip with speed change"), m_extraFactory->actionCollection());
         QStringList stabJob;
@@ -3469,6 +3627,18 @@ void MainWindow::slotPrepareRendering(bool scriptExport, bool zoneOnly, const QS
         }
         file.close();
     }
+    QMap <int, QString> previewChunks;
+    QString previewExtension;
+    QStringList previewParameters;
+    if (KdenliveSettings::renderusepreview() && !stemExport && !scriptExport) {
+        previewChunks = pCore->projectManager()->currentTimeline()->renderedPreviewChunks(previewExtension, previewParameters);
+    }
+    m_renderWidget->setPreviewChunks(previewChunks, previewExtension, previewParameters);
+    QList <PassthroughZone> passthroughZones;
+    if (KdenliveSettings::smartrender() && !stemExport && !scriptExport) {
+        passthroughZones = pCore->projectManager()->currentTimeline()->passthroughZones();
+    }
+    m_renderWidget->setPassthroughZones(passthroughZones);
     m_renderWidget->slotExport(scriptExport,
             pCore->projectManager()->currentTimeline()->inPoint(),
             pCore->projectManager()->currentTimeline()->outPoint(),
@@ -3812,6 +3982,33 @@ void MainWindow::showTimelineToolbarMenu(const QPoint &pos)
     menu.exec(m_timelineToolBar->mapToGlobal(pos));
 }
 
+void MainWindow::slotRecordTrace(bool record)
+{
+    if (record) {
+        // Start a fresh recording
+        Tracer::self()->clear();
+    }
+    Tracer::self()->setRecording(record);
+}
+
+void MainWindow::slotExportTrace()
+{
+    if (Tracer::self()->eventCount() == 0) {
+        KMessageBox::information(this, i18n("No performance events were recorded. Enable Record Performance Trace and reproduce the slow operation first."));
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(this, i18n("Export Performance Trace"), QDir::homePath() + QStringLiteral("/kdenlive-trace.json"), i18n("Chrome Trace (*.json)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!path.endsWith(QLatin1String(".json"))) {
+        path.append(QStringLiteral(".json"));
+    }
+    if (!Tracer::self()->exportTrace(path)) {
+        KMessageBox::sorry(this, i18n("Cannot write to file %1", path));
+    }
+}
+
 void MainWindow::slotManageCache()
 {
     QDialog d(this);
@@ -3828,6 +4025,20 @@ void MainWindow::slotManageCache()
     d.exec();
 }
 
+void MainWindow::slotShowMemoryUsage()
+{
+    QDialog d(this);
+    d.setWindowTitle(i18n("Memory Usage"));
+    QVBoxLayout *lay = new QVBoxLayout;
+    MemoryUsage usage(this);
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttonBox, &QDialogButtonBox::rejected, &d, &QDialog::reject);
+    lay->addWidget(&usage);
+    lay->addWidget(buttonBox);
+    d.setLayout(lay);
+    d.exec();
+}
+
 void MainWindow::slotUpdateCompositing(QAction *compose)
 {
     if (pCore->projectManager()->currentTimeline()) {
@@ -253,8 +253,18 @@ public slots:
     void slotReloadEffects();
     Q_SCRIPTABLE void setRenderingProgress(const QString &url, int progress);
     Q_SCRIPTABLE void setRenderingFinished(const QString &url, int status, const QString &error);
+    /** @brief Receive the render speed in frames per second and the CPU usage of a render job, cpu is -1 if unknown */
+    Q_SCRIPTABLE void setRenderingSpeed(const QString &url, double fps, int cpu);
     Q_SCRIPTABLE void addProjectClip(const QString &url);
     Q_SCRIPTABLE void addTimelineClip(const QString &url);
+    /** @brief Add several files to the project bin in a single undo command */
+    Q_SCRIPTABLE void addProjectClips(const QStringList &urls);
+    /** @brief Insert several bin clips in the timeline, in the order of urls */
+    Q_SCRIPTABLE void addTimelineClips(const QStringList &urls);
+    /** @brief Queue proxy creation for the bin clips of several files */
+    Q_SCRIPTABLE void createProxies(const QStringList &urls);
+    /** @brief Returns the jobs waiting / running for the bin clip of url */
+    Q_SCRIPTABLE QStringList clipJobs(const QString &url);
     Q_SCRIPTABLE void addEffect(const QString &effectName);
     Q_SCRIPTABLE void scriptRender(const QString &url);
     Q_NOREPLY void exitApp();
@@ -371,12 +381,16 @@ private slots:
     void slotPaste();
     void slotPasteEffects();
     void slotResizeItemStart();
+    /** @brief Record a multicam angle switch, the angle is the triggering action's data. */
+    void slotSwitchAngle();
     void slotResizeItemEnd();
     void configureNotifications();
     void slotInsertTrack();
     void slotDeleteTrack();
     /** @brief Shows the configure tracks dialog and updates transitions afterwards. */
     void slotConfigTrack();
+    /** @brief Freeze or unfreeze active track. */
+    void slotFreezeTrack();
     /** @brief Select all clips in active track. */
     void slotSelectTrack();
     /** @brief Select all clips in timeline. */
@@ -446,6 +460,8 @@ private slots:
 
     void slotThemeChanged(const QString &);
     void slotReloadTheme();
+    /** @brief Start the subsystems that can wait until the window is shown. */
+    void slotDeferredStartup();
     /** @brief Close Kdenlive and try to restart it */
     void slotRestart();
     void triggerKey(QKeyEvent* ev);
@@ -466,6 +482,12 @@ private slots:
     void showTimelineToolbarMenu(const QPoint &pos);
     /** @brief Open Cached Data management dialog. */
     void slotManageCache();
+    /** @brief Open the dialog showing the memory used by each subsystem. */
+    void slotShowMemoryUsage();
+    /** @brief Start or stop recording a performance trace. */
+    void slotRecordTrace(bool record);
+    /** @brief Save the recorded performance trace in the Chrome trace format. */
+    void slotExportTrace();
     void showMenuBar(bool show);
     /** @brief Change forced icon theme setting (asks for app restart). */
     void forceIconSet(bool force);
@@ -17,10 +17,37 @@ the Free Software Foundation, either version 3 of the License, or
 #include <KUrlRequesterDialog>
 #include <klocalizedstring.h>
 
+#include <mlt++/Mlt.h>
+
 #include <QFile>
 #include <QStandardPaths>
+#include <QMutex>
+#include <QtConcurrent>
 #include <QDebug>
 
+#include <locale.h>
+
+/** @brief The MLT repository and its initialization, that may run in a thread */
+struct RepositoryLoader {
+    QMutex mutex;
+    bool started;
+    Mlt::Repository *repository;
+    QFuture <Mlt::Repository *> future;
+    /** @brief Numeric locale when loading started, Mlt::Factory::init() may reset it */
+    QByteArray numericLocale;
+    RepositoryLoader() : started(false), repository(NULL) {}
+};
+Q_GLOBAL_STATIC(RepositoryLoader, repositoryLoader)
+
+static Mlt::Repository *initRepository(bool allowVdpau)
+{
+    // Disable VDPAU that crashes in multithread environment, unless it was requested.
+    if (!allowVdpau) {
+        setenv("MLT_NO_VDPAU", "1", 1);
+    }
+    return Mlt::Factory::init();
+}
+
 
 MltConnection::MltConnection(QObject* parent) :
     QObject(parent)
@@ -108,4 +135,33 @@ void MltConnection::locateMeltAndProfilesPath(const QString& mltPath)
     }
 }
 
+//static
+void MltConnection::preloadRepository()
+{
+    RepositoryLoader *loader = repositoryLoader();
+    QMutexLocker lock(&loader->mutex);
+    if (loader->started) {
+        return;
+    }
+    loader->started = true;
+    loader->numericLocale = setlocale(LC_NUMERIC, NULL);
+    loader->future = QtConcurrent::run(initRepository, KdenliveSettings::hwdecoding() == QLatin1String("vdpau"));
+}
 
+//static
+Mlt::Repository *MltConnection::repository()
+{
+    RepositoryLoader *loader = repositoryLoader();
+    QMutexLocker lock(&loader->mutex);
+    if (loader->repository) {
+        return loader->repository;
+    }
+    if (!loader->started) {
+        loader->started = true;
+        loader->repository = initRepository(KdenliveSettings::hwdecoding() == QLatin1String("vdpau"));
+        return loader->repository;
+    }
+    loader->repository = loader->future.result();
+    setlocale(LC_NUMERIC, loader->numericLocale.constData());
+    return loader->repository;
+}
@@ -13,6 +13,9 @@ the Free Software Foundation, either version 3 of the License, or
 
 #include <QObject>
 
+namespace Mlt {
+class Repository;
+}
 
 /**
  * @class MltConnection
@@ -35,6 +38,13 @@ public:
      * mltPath, MLT_PREFIX, searching for the binary `melt`, or asking to the
      * user. It doesn't fill any list of profiles, while its name suggests so. */
     static void locateMeltAndProfilesPath(const QString &mltPath = QString());
+
+    /** @brief Starts loading the MLT modules in a thread, so that they are ready when the repository is first needed. */
+    static void preloadRepository();
+    /** @brief Returns the MLT repository, shared by the whole application.
+     *
+     * MLT is initialized only once, by the first call or by preloadRepository(). */
+    static Mlt::Repository *repository();
 };
 
 #endif
@@ -21,23 +21,32 @@
 #include "bincontroller.h"
 #include "clipcontroller.h"
 #include "kdenlivesettings.h"
+#include "mltconnection.h"
 
 #include <QFileInfo>
+#include <QDateTime>
+#include <QScopedPointer>
+#include <QDebug>
 
 static const char* kPlaylistTrackId = "main bin";
 
+// Time in ms after which an unused bin producer can be released in lazy mode
+#define PRODUCER_IDLE_TIMEOUT 120000
+
 BinController::BinController(QString profileName) :
   QObject()
+  , m_batchReplacement(false)
+  , m_hwDecodingSupport(-1)
 {
     m_binPlaylist = NULL;
-    // Disable VDPAU that crashes in multithread environment.
-    //TODO: make configurable
-    setenv("MLT_NO_VDPAU", "1", 1);
-    m_repository = Mlt::Factory::init();
+    m_repository = MltConnection::repository();
     if (profileName.isEmpty()) {
         profileName = KdenliveSettings::current_profile();
     }
     //resetProfile(profileName);
+    m_releaseTimer.setInterval(PRODUCER_IDLE_TIMEOUT / 4);
+    connect(&m_releaseTimer, &QTimer::timeout, this, &BinController::slotReleaseIdleProducers);
+    m_releaseTimer.start();
 }
 
 BinController::~BinController()
@@ -67,6 +76,10 @@ void BinController::destroyBin()
 
     qDeleteAll(m_clipList);
     m_clipList.clear();
+    QMutexLocker lock(&m_usageMutex);
+    m_openProducers.clear();
+    m_lastUse.clear();
+    m_idleRefCount.clear();
 }
 
 void BinController::setDocumentRoot(const QString &root)
@@ -255,6 +268,8 @@ void BinController::replaceProducer(const QString &id, Mlt::Producer &producer)
     pasteEffects(id, producer);
     ctrl->updateProducer(id, &producer);
     replaceBinPlaylistClip(id, producer);
+    setIdle(id, producer);
+    touchProducer(id);
     emit prepareTimelineReplacement(id);
     producer.set("id", id.toUtf8().constData());
     // Remove video only producer
@@ -262,10 +277,34 @@ void BinController::replaceProducer(const QString &id, Mlt::Producer &producer)
     if (m_extraClipList.contains(videoId)) {
         m_extraClipList.remove(videoId);
     }
+    // Remove audio only producer
+    m_extraClipList.remove(id + "_audio");
     removeBinPlaylistClip("#" + id);
+    QMutexLocker lock(&m_batchMutex);
+    if (m_batchReplacement) {
+        if (!m_batchedReplacements.contains(id)) m_batchedReplacements << id;
+        return;
+    }
+    lock.unlock();
     emit replaceTimelineProducer(id);
 }
 
+void BinController::startReplacementBatch()
+{
+    QMutexLocker lock(&m_batchMutex);
+    m_batchReplacement = true;
+}
+
+void BinController::endReplacementBatch()
+{
+    QMutexLocker lock(&m_batchMutex);
+    m_batchReplacement = false;
+    QStringList ids = m_batchedReplacements;
+    m_batchedReplacements.clear();
+    lock.unlock();
+    if (!ids.isEmpty()) emit replaceTimelineProducers(ids);
+}
+
 void BinController::addClipToBin(const QString &id, ClipController *controller) // Mlt::Producer &producer)
 {
     /** Test: we can use filters on clips in the bin this way
@@ -285,6 +324,8 @@ void BinController::addClipToBin(const QString &id, ClipController *controller)
         //removeBinClip(id);
     }
     else m_clipList.insert(id, controller);
+    setIdle(id, controller->originalProducer());
+    touchProducer(id);
 }
 
 void BinController::replaceBinPlaylistClip(const QString &id, Mlt::Producer &producer)
@@ -331,6 +372,10 @@ bool BinController::removeBinClip(const QString &id)
     removeBinPlaylistClip(id);
     ClipController *controller = m_clipList.take(id);
     delete controller;
+    QMutexLocker lock(&m_usageMutex);
+    m_openProducers.removeAll(id);
+    m_lastUse.remove(id);
+    m_idleRefCount.remove(id);
     return true;
 }
 
@@ -347,12 +392,84 @@ Mlt::Producer *BinController::getBinProducer(const QString &id)
     // TODO: framebuffer speed clips
     if (!m_clipList.contains(id)) return NULL;
     ClipController *controller = m_clipList.value(id);
-    if (controller) 
+    if (controller) {
+        touchProducer(id);
         return &controller->originalProducer();
+    }
     else
         return NULL;
 }
 
+void BinController::touchProducer(const QString &id)
+{
+    QMutexLocker lock(&m_usageMutex);
+    m_openProducers.removeAll(id);
+    m_openProducers.append(id);
+    m_lastUse.insert(id, QDateTime::currentMSecsSinceEpoch());
+}
+
+void BinController::setIdle(const QString &id, Mlt::Producer &producer)
+{
+    QMutexLocker lock(&m_usageMutex);
+    m_idleRefCount.insert(id, producer.parent().ref_count());
+}
+
+bool BinController::releaseProducer(const QString &id)
+{
+    // m_usageMutex must be locked
+    ClipController *controller = m_clipList.value(id);
+    if (!controller || !controller->isValid()) return false;
+    Mlt::Producer &original = controller->originalProducer();
+    QString service = original.get("mlt_service");
+    if (!service.startsWith(QLatin1String("avformat"))) {
+        // Only avformat producers can be reopened on demand
+        return false;
+    }
+    if (original.parent().ref_count() > m_idleRefCount.value(id, 0)) {
+        // Producer is used in a monitor, the timeline or a job
+        return false;
+    }
+    // The avformat-novalidate producer does not open the file until a frame is requested
+    Mlt::Producer *producer = new Mlt::Producer(*profile(), "avformat-novalidate", original.get("resource"));
+    if (!producer->is_valid()) {
+        delete producer;
+        return false;
+    }
+    for (int i = 0; i < original.count(); ++i) {
+        QString name = original.get_name(i);
+        if (name.startsWith(QLatin1Char('_')) || name == QLatin1String("mlt_service") || name == QLatin1String("mlt_type") || name == QLatin1String("resource")) continue;
+        producer->set(original.get_name(i), original.get(i));
+    }
+    pasteEffects(id, *producer);
+    controller->updateProducer(id, producer);
+    replaceBinPlaylistClip(id, *producer);
+    m_idleRefCount.insert(id, producer->parent().ref_count());
+    return true;
+}
+
+void BinController::slotReleaseIdleProducers()
+{
+    if (!KdenliveSettings::lazyproducers() || !m_binPlaylist) return;
+    QMutexLocker lock(&m_usageMutex);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int maxOpen = qMax(0, KdenliveSettings::maxopenproducers());
+    int i = 0;
+    // Keep the most recently used producers, release the older ones once they are idle
+    while (m_openProducers.count() - i > maxOpen) {
+        const QString id = m_openProducers.at(i);
+        if (now - m_lastUse.value(id) < PRODUCER_IDLE_TIMEOUT) {
+            // All following producers were used more recently
+            break;
+        }
+        if (releaseProducer(id)) {
+            m_openProducers.removeAt(i);
+            m_lastUse.remove(id);
+        } else {
+            ++i;
+        }
+    }
+}
+
 Mlt::Producer *BinController::getBinVideoProducer(const QString &id)
 {
     QString videoId = id + "_video";
@@ -369,6 +486,85 @@ Mlt::Producer *BinController::getBinVideoProducer(const QString &id)
     return m_extraClipList.value(videoId);
 }
 
+Mlt::Producer *BinController::getBinAudioProducer(const QString &id)
+{
+    QString originalId = id.section(QStringLiteral("_"), 0, 0);
+    QString audioId = originalId + "_audio";
+    if (!m_extraClipList.contains(audioId)) {
+        Mlt::Producer *original = getBinProducer(originalId);
+        if (!original || !QString(original->get("mlt_service")).startsWith(QLatin1String("avformat"))) {
+            return original;
+        }
+        // create clone
+        Mlt::Producer *audioOnly = cloneProducer(*original);
+        audioOnly->set("video_index", -1);
+        audioOnly->set("id", audioId.toUtf8().constData());
+        m_extraClipList.insert(audioId, audioOnly);
+        return audioOnly;
+    }
+    return m_extraClipList.value(audioId);
+}
+
+void BinController::setupHardwareDecoding(Mlt::Producer &producer)
+{
+    const QString method = KdenliveSettings::hwdecoding();
+    if (method.isEmpty() || method == QLatin1String("vdpau") || !QString(producer.get("mlt_service")).startsWith(QLatin1String("avformat"))) {
+        // The VDPAU decoder of older MLT versions is enabled globally by the environment
+        return;
+    }
+    int vindex = producer.get_int("video_index");
+    if (vindex < 0) return;
+    QString property = QStringLiteral("meta.media.%1.codec.name").arg(vindex);
+    const QString codec = producer.get(property.toUtf8().constData());
+    if (codec.isEmpty() || !KdenliveSettings::hwdecodingcodecs().split(QLatin1Char(','), QString::SkipEmptyParts).contains(codec)) {
+        return;
+    }
+    QMutexLocker lock(&m_hwDecodingMutex);
+    if (m_hwDecodingSupport == -1) {
+        // Only recent MLT versions can pass a hardware decoder to FFmpeg
+        m_hwDecodingSupport = 0;
+        QScopedPointer<Mlt::Properties> metadata(m_repository->metadata(producer_type, "avformat"));
+        if (metadata && metadata->is_valid()) {
+            Mlt::Properties params((mlt_properties) metadata->get_data("parameters"));
+            for (int i = 0; i < params.count(); ++i) {
+                Mlt::Properties param((mlt_properties) params.get_data(i));
+                if (QString(param.get("identifier")) == QLatin1String("hwaccel")) {
+                    m_hwDecodingSupport = 1;
+                    break;
+                }
+            }
+        }
+        if (m_hwDecodingSupport == 0) {
+            qDebug()<<"// MLT cannot use hardware decoding, using software decoding";
+        }
+    }
+    if (m_hwDecodingSupport == 0) return;
+    if (!m_hwCodecs.contains(codec)) {
+        m_hwCodecs.insert(codec, probeHardwareDecoding(producer, method));
+    }
+    if (m_hwCodecs.value(codec)) {
+        producer.set("hwaccel", method.toUtf8().constData());
+    }
+}
+
+bool BinController::probeHardwareDecoding(Mlt::Producer &producer, const QString &method)
+{
+    // m_hwDecodingMutex must be locked
+    Mlt::Producer test(*producer.profile(), "avformat", producer.get("resource"));
+    if (!test.is_valid()) return false;
+    test.set("video_index", producer.get_int("video_index"));
+    test.set("audio_index", -1);
+    test.set("hwaccel", method.toUtf8().constData());
+    QScopedPointer<Mlt::Frame> frame(test.get_frame());
+    if (!frame || !frame->is_valid()) return false;
+    mlt_image_format format = mlt_image_yuv422;
+    int width = 0;
+    int height = 0;
+    const uchar *image = frame->get_image(format, width, height);
+    // A frame that could not be decoded is replaced by a test image
+    return image != NULL && width > 0 && height > 0 && !frame->get_int("test_image");
+}
+
 double BinController::fps() const
 {
     return m_binPlaylist->profile()->fps();
@@ -491,9 +687,9 @@ void BinController::checkThumbnails(const QDir thumbFolder)
         }
         bool foundFile = false;
         if (!ctrl->getClipHash().isEmpty()) {
-            QImage img(thumbFolder.absoluteFilePath(ctrl->getClipHash() + ".png"));
-            if (!img.isNull()) {
-                emit loadThumb(ctrl->clipId(), img, true);
+            // Only check the file, the Bin decodes it when the clip is displayed
+            if (thumbFolder.exists(ctrl->getClipHash() + ".png")) {
+                emit loadThumb(ctrl->clipId(), QImage(), true);
                 foundFile = true;
             }
         }
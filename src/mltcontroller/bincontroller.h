@@ -25,6 +25,9 @@
 #include <QString>
 #include <QStringList>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
 #include "definitions.h"
 
 class ClipController;
@@ -114,7 +117,15 @@ public:
     
     /** @brief returns a video only (no audio) version of this producer  */
     Mlt::Producer *getBinVideoProducer(const QString &id);
+
+    /** @brief returns an audio only version of this producer, that does not demux or decode the video stream
+     *  Producers where video_index is meaningless return the master producer */
+    Mlt::Producer *getBinAudioProducer(const QString &id);
     
+    /** @brief Enable the configured hardware decoding on an avformat producer if its video codec supports it
+     *  The first clip of each codec is used to check that frames can be decoded, otherwise software decoding is kept */
+    void setupHardwareDecoding(Mlt::Producer &producer);
+
     /** @brief Returns the clip data as rendered by MLT's XML consumer, used to duplicate a clip
      * @param producer The clip's original producer
      */
@@ -135,6 +146,10 @@ public:
     /** @brief Get the list of ids whose clip have the resource indicated by @param url */
     const QStringList getBinIdsByResource(const QUrl &url) const;
     void replaceProducer(const QString &id, Mlt::Producer &producer);
+    /** @brief Collect the timeline replacements of the following replaceProducer calls until endReplacementBatch() */
+    void startReplacementBatch();
+    /** @brief Replace the producers collected since startReplacementBatch() in the timeline, in one pass */
+    void endReplacementBatch();
     void storeMarker(const QString &markerId, const QString &markerHash);
     QMap<double,QString> takeGuidesData();
 
@@ -171,6 +186,9 @@ public:
     /** @brief Returns a list of all clips hashes. */
     QStringList getProjectHashes();
 
+    /** @brief Mark a clip producer as recently used, so that it is not released when lazy producers are enabled. */
+    void touchProducer(const QString &id);
+
 public slots:
     /** @brief Stored a Bin Folder id / name to MLT's bin playlist. Using an empry folderName deletes the property */
     void slotStoreFolder(const QString &folderId, const QString &parentId, const QString &oldParentId, const QString &folderName);
@@ -202,6 +220,42 @@ private:
 
     /** @brief Duplicate effects from stored producer */    
     void pasteEffects(const QString &id, Mlt::Producer &producer);
+
+    /** @brief Protects the producer usage data, producers are requested from several threads */
+    QMutex m_usageMutex;
+    /** @brief Ids of the clips whose producer may be open, least recently used first */
+    QStringList m_openProducers;
+    /** @brief Time of the last producer request for each clip, in ms since epoch */
+    QHash <QString, qint64> m_lastUse;
+    /** @brief Reference count of each producer when only the bin holds it */
+    QHash <QString, int> m_idleRefCount;
+    QTimer m_releaseTimer;
+
+    /** @brief Protects the batched timeline replacements, producers are replaced from several threads */
+    QMutex m_batchMutex;
+    /** @brief True while timeline replacements are collected in m_batchedReplacements */
+    bool m_batchReplacement;
+    /** @brief Ids of the clips whose timeline producers must be replaced at the end of the batch */
+    QStringList m_batchedReplacements;
+
+    /** @brief Protects the hardware decoding capabilities, probed from the producer threads */
+    QMutex m_hwDecodingMutex;
+    /** @brief Whether the avformat producer accepts a hwaccel property, -1 until checked */
+    int m_hwDecodingSupport;
+    /** @brief Result of the hardware decoding probe for each video codec */
+    QHash <QString, bool> m_hwCodecs;
+    /** @brief Check that the first frame of a clip can be decoded with hardware decoding */
+    bool probeHardwareDecoding(Mlt::Producer &producer, const QString &method);
+
+    /** @brief Remember the reference count of a producer that is only used by the bin */
+    void setIdle(const QString &id, Mlt::Producer &producer);
+    /** @brief Replace the producer of a clip with an unopened copy, to free its demuxer and decoders
+     *  @return false if the producer is in use (monitor, timeline) or cannot be released */
+    bool releaseProducer(const QString &id);
+
+private slots:
+    /** @brief Release the producers that were not used recently, when lazy producers are enabled. */
+    void slotReleaseIdleProducers();
     
 signals:
     void loadFolders(QMap<QString,QString>);
@@ -210,6 +264,8 @@ signals:
     void requestAudioThumb(const QString&);
     void abortAudioThumbs();
     void replaceTimelineProducer(const QString &id);
+    /** @brief Replace the timeline producers of several clips at once */
+    void replaceTimelineProducers(const QStringList &ids);
     void setDocumentNotes(const QString &);
     void updateTimelineProducer(const QString &);
     /** @brief We want to replace a clip with another, but before we need to change clip producer id so that there is no interference*/
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "lib/audio/audioStreamInfo.h"
 #include "timeline/timeline.h"
 #include "timeline/effectmanager.h"
+#include "kdenlivesettings.h"
 
 #include <QUrl>
 #include <QDebug>
@@ -37,6 +38,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ClipController::ClipController(BinController *bincontroller, Mlt::Producer& producer) : QObject()
     , selectedEffectIndex(1)
     , audioThumbCreated(false)
+    , m_alternateProducer(NULL)
     , m_properties(new Mlt::Properties(producer.get_properties()))
     , m_usesProxy(false)
     , m_audioInfo(NULL)
@@ -73,6 +75,7 @@ ClipController::ClipController(BinController *bincontroller) : QObject()
     , selectedEffectIndex(1)
     , audioThumbCreated(false)
     , m_masterProducer(NULL)
+    , m_alternateProducer(NULL)
     , m_properties(NULL)
     , m_usesProxy(false)
     , m_audioInfo(NULL)
@@ -89,6 +92,7 @@ ClipController::~ClipController()
 {
   delete m_properties;
   delete m_masterProducer;
+  delete m_alternateProducer;
   delete m_audioInfo;
 }
 
@@ -210,6 +214,7 @@ Mlt::Producer &ClipController::originalProducer()
 
 Mlt::Producer *ClipController::masterProducer()
 {
+    m_binController->touchProducer(clipId());
     return new Mlt::Producer(*m_masterProducer);
 }
 
@@ -252,6 +257,7 @@ void ClipController::updateProducer(const QString &id, Mlt::Producer* producer)
     Q_UNUSED(id)
 
     Mlt::Properties passProperties;
+    bool usedProxy = m_usesProxy;
     // Keep track of necessary properties
     QString proxy = producer->get("kdenlive:proxy");
     if (proxy.length() > 2) {
@@ -261,7 +267,12 @@ void ClipController::updateProducer(const QString &id, Mlt::Producer* producer)
     else m_usesProxy = false;
     passProperties.pass_list(*m_properties, getPassPropertiesList(m_usesProxy));
     delete m_properties;
-    delete m_masterProducer;
+    if (usedProxy != m_usesProxy && m_masterProducer != producer && KdenliveSettings::keepalternateproducer() && m_masterProducer && m_masterProducer->is_valid()) {
+        // Switching between proxy and original, keep the previous producer to switch back
+        delete m_alternateProducer;
+        m_alternateProducer = m_masterProducer;
+    }
+    else if (m_masterProducer != producer) delete m_masterProducer;
     m_masterProducer = producer;
     m_properties = new Mlt::Properties(producer->get_properties());
     // Pass properties from previous producer
@@ -278,6 +289,33 @@ void ClipController::updateProducer(const QString &id, Mlt::Producer* producer)
 }
 
 
+Mlt::Producer *ClipController::takeAlternateProducer(const QString &resource)
+{
+    if (m_alternateProducer == NULL || resource.isEmpty() || resource != QString::fromUtf8(m_alternateProducer->get("resource"))) {
+        return NULL;
+    }
+    Mlt::Producer *producer = m_alternateProducer;
+    m_alternateProducer = NULL;
+    // Bin effects are pasted again from the current producer
+    Mlt::Service service(producer->parent());
+    int ix = 0;
+    while (ix < service.filter_count()) {
+        QScopedPointer<Mlt::Filter> effect(service.filter(ix));
+        if (effect && effect->is_valid() && !QString(effect->get("kdenlive_id")).isEmpty()) {
+            service.detach(*effect);
+        }
+        else ix++;
+    }
+    // Kdenlive properties (proxy path, clip name, markers...) may have changed since the switch
+    for (int i = 0; i < m_masterProducer->count(); ++i) {
+        QString name = m_masterProducer->get_name(i);
+        if (name.startsWith(QLatin1String("kdenlive:"))) {
+            producer->set(m_masterProducer->get_name(i), m_masterProducer->get(i));
+        }
+    }
+    return producer;
+}
+
 Mlt::Producer *ClipController::getTrackProducer(const QString trackName, PlaylistState::ClipState clipState, double speed)
 {
     //TODO
@@ -70,6 +70,9 @@ public:
 
     /** @brief Replaces the master producer and (TODO) the track producers with an updated producer, for example a proxy */
     void updateProducer(const QString &id, Mlt::Producer *producer);
+    /** @brief Returns the previous producer if it was opened on @param resource, ready to be passed to updateProducer. Caller takes ownership.
+     *  When switching between proxy and original, the replaced producer is kept so that switching back does not reload the clip. */
+    Mlt::Producer *takeAlternateProducer(const QString &resource);
 
     void getProducerXML(QDomDocument& document, bool includeMeta = false);
 
@@ -200,6 +203,8 @@ public:
 
 private:
     Mlt::Producer *m_masterProducer;
+    /** @brief The original producer when using a proxy, or the proxy producer when not */
+    Mlt::Producer *m_alternateProducer;
     Mlt::Properties *m_properties;
     bool m_usesProxy;
     AudioStreamInfo *m_audioInfo;
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "effectstack/widgets/choosecolorwidget.h"
 #include "dialogs/profilesdialog.h"
 #include "utils/KoIconUtils.h"
+#include "doc/projectdatastore.h"
 
 #include <KLocalizedString>
 
@@ -56,6 +57,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileDialog>
 #include <QMimeData>
 #include <QTextEdit>
+#include <QtConcurrent>
 
 AnalysisTree::AnalysisTree(QWidget *parent) : QTreeWidget(parent)
 {
@@ -84,9 +86,9 @@ QMimeData * AnalysisTree::mimeData(const QList<QTreeWidgetItem *> list) const
 class ExtractionResult : public KFileMetaData::ExtractionResult
 {
    public:
-     ExtractionResult( const QString& filename, const QString& mimetype, QTreeWidget *tree)
+     ExtractionResult( const QString& filename, const QString& mimetype, QList <QStringList> *rows)
          : KFileMetaData::ExtractionResult( filename, mimetype, KFileMetaData::ExtractionResult::ExtractMetaData ),
-           m_tree( tree ) {}
+           m_rows( rows ) {}
 
      void append(const QString& /*text*/) override {}
 
@@ -125,39 +127,136 @@ class ExtractionResult : public KFileMetaData::ExtractionResult
          if (decode) {
             KFileMetaData::PropertyInfo info(property);
             if (info.valueType() == QVariant::DateTime) {
-                new QTreeWidgetItem(m_tree, QStringList() << info.displayName() << value.toDateTime().toString(Qt::DefaultLocaleShortDate));
+                m_rows->append(QStringList() << info.displayName() << value.toDateTime().toString(Qt::DefaultLocaleShortDate));
             } else if (info.valueType() == QVariant::Int) {
                 int val = value.toInt();
                 if (property == KFileMetaData::Property::BitRate) {
                     // Adjust unit for bitrate
-                    new QTreeWidgetItem(m_tree, QStringList() << info.displayName() << QString::number(val/1000) + QStringLiteral(" ") + i18nc("Kilobytes per seconds", "kb/s"));
+                    m_rows->append(QStringList() << info.displayName() << QString::number(val/1000) + QStringLiteral(" ") + i18nc("Kilobytes per seconds", "kb/s"));
                 }
                 else {
-                    new QTreeWidgetItem(m_tree, QStringList() << info.displayName() << QString::number(val));
+                    m_rows->append(QStringList() << info.displayName() << QString::number(val));
                 }
             } else if (info.valueType() == QVariant::Double) {
-              new QTreeWidgetItem(m_tree, QStringList() << info.displayName() << QString::number(value.toDouble()));
+              m_rows->append(QStringList() << info.displayName() << QString::number(value.toDouble()));
             }
-            else new QTreeWidgetItem(m_tree, QStringList() << info.displayName() << value.toString());
+            else m_rows->append(QStringList() << info.displayName() << value.toString());
          }
      }
 private:
-    QTreeWidget *m_tree;
+    QList <QStringList> *m_rows;
 };
+
+/** @brief Reads the file metadata through KDE's metadata system, run in a worker thread. */
+static PropertyRows readFileMetaData(const QString &clipId, const QString &path)
+{
+    PropertyRows result;
+    result.clipId = clipId;
+    KFileMetaData::ExtractorCollection metaDataCollection;
+    QMimeDatabase mimeDatabase;
+    QMimeType mimeType = mimeDatabase.mimeTypeForFile(path);
+    foreach(KFileMetaData::Extractor* plugin, metaDataCollection.fetchExtractors(mimeType.name())) {
+        ExtractionResult extractionResult(path, mimeType.name(), &result.rows);
+        plugin->extract(&extractionResult);
+    }
+    return result;
+}
 #endif
 
-ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *controller, QWidget *parent) : QWidget(parent)
-    , m_controller(controller)
-    , m_tc(tc)
-    , m_id(controller->clipId())
-    , m_type(controller->clipType())
-    , m_properties(controller->properties())
+/** @brief What the metadata page reads from the clip files, filled in the main thread. */
+struct MetaRequest {
+    QString clipId;
+    QString path;
+    ClipType type;
+    QString codec;
+    bool readExif;
+    bool readMagicLantern;
+};
+
+/** @brief Runs exiftool and reads the Magic Lantern log of a clip, run in a worker thread. */
+static PropertyRows readMetaData(const MetaRequest &request)
+{
+    PropertyRows result;
+    result.clipId = request.clipId;
+    result.storeExif = false;
+    result.storeMagicLantern = false;
+    if (request.readExif) {
+        //Check for Canon THM file
+        QString url = request.path.section('.', 0, -2) + ".THM";
+        if (QFile::exists(url)) {
+            // Read the exif metadata embedded in the THM file
+            QProcess p;
+            QStringList args;
+            args << QStringLiteral("-g") << QStringLiteral("-args") << url;
+            p.start(QStringLiteral("exiftool"), args);
+            p.waitForFinished();
+            QString res = p.readAllStandardOutput();
+            result.storeExif = true;
+            QStringList list = res.split('\n');
+            foreach(const QString &tagline, list) {
+                if (tagline.startsWith(QLatin1String("-File")) || tagline.startsWith(QLatin1String("-ExifTool"))) continue;
+                QString tag = tagline.section(':', 1).simplified();
+                if (tag.startsWith(QLatin1String("ImageWidth")) || tag.startsWith(QLatin1String("ImageHeight"))) continue;
+                if (!tag.section('=', 0, 0).isEmpty() && !tag.section('=', 1).simplified().isEmpty()) {
+                    result.exif << (QStringList() << tag.section('=', 0, 0) << tag.section('=', 1).simplified());
+                }
+            }
+        } else if (request.type == Image || request.codec == QLatin1String("h264")) {
+            QProcess p;
+            QStringList args;
+            args << QStringLiteral("-g") << QStringLiteral("-args") << request.path;
+            p.start(QStringLiteral("exiftool"), args);
+            p.waitForFinished();
+            QString res = p.readAllStandardOutput();
+            // Do not store image exif metadata in project file, would be too much noise
+            result.storeExif = request.type != Image;
+            QStringList list = res.split('\n');
+            foreach(const QString &tagline, list) {
+                if (request.type != Image && !tagline.startsWith(QLatin1String("-H264"))) continue;
+                QString tag = tagline.section(':', 1);
+                if (tag.startsWith(QLatin1String("ImageWidth")) || tag.startsWith(QLatin1String("ImageHeight"))) continue;
+                result.exif << (QStringList() << tag.section('=', 0, 0) << tag.section('=', 1).simplified());
+            }
+        }
+    }
+    if (request.readMagicLantern) {
+        QFile file(request.path.section('.', 0, -2) + ".LOG");
+        if (file.exists() && file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            result.storeMagicLantern = true;
+            while (!file.atEnd()) {
+                QString line = file.readLine().simplified();
+                if (line.startsWith('#') || line.isEmpty() || !line.contains(':')) continue;
+                if (line.startsWith(QLatin1String("CSV data"))) break;
+                result.magicLantern << (QStringList() << line.section(':', 0, 0).simplified() << line.section(':', 1).simplified());
+            }
+        }
+    }
+    return result;
+}
+
+/** @brief Reads the analysis data stored in the project sidecar, run in a worker thread. */
+static PropertyRows resolveAnalysis(const QString &clipId, const QList <QStringList> &analysis)
+{
+    PropertyRows result;
+    result.clipId = clipId;
+    foreach(const QStringList &row, analysis) {
+        result.rows << (QStringList() << row.at(0) << ProjectDataStore::resolve(row.at(1)));
+    }
+    return result;
+}
+
+ClipPropertiesController::ClipPropertiesController(QWidget *parent) : QWidget(parent)
+    , m_controller(NULL)
+    , m_type(Unknown)
+    , m_properties(NULL)
+    , m_forceContent(NULL)
     , m_textEdit(NULL)
+    , m_filledPages(0)
 {
     setFont(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont));
     QVBoxLayout *lay = new QVBoxLayout;
     lay->setContentsMargins(0,0,0,0);
-    m_clipLabel = new QLabel(controller->clipName());
+    m_clipLabel = new QLabel(this);
     lay->addWidget(m_clipLabel);
     m_tabWidget = new QTabWidget(this);
     lay->addWidget(m_tabWidget);
@@ -179,7 +278,6 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     m_propertiesTree->sortByColumn(0, Qt::AscendingOrder);
     m_propertiesTree->setHeaderHidden(true);
     propsBox->addWidget(m_propertiesTree);
-    fillProperties();
     m_propertiesPage->setLayout(propsBox);
 
     // Clip markers
@@ -198,20 +296,17 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     bar->addAction(KoIconUtils::themedIcon(QStringLiteral("document-save-as")), i18n("Export markers"), this, SLOT(slotSaveMarkers()));
     bar->addAction(KoIconUtils::themedIcon(QStringLiteral("document-open")), i18n("Import markers"), this, SLOT(slotLoadMarkers()));
     mBox->addWidget(bar);
-
-    slotFillMarkers();
     m_markersPage->setLayout(mBox);
     connect(m_markerTree, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(slotSeekToMarker()));
 
     // metadata
     QVBoxLayout *m2Box = new QVBoxLayout;
-    QTreeWidget *metaTree = new QTreeWidget;
-    metaTree->setRootIsDecorated(true);
-    metaTree->setColumnCount(2);
-    metaTree->setAlternatingRowColors(true);
-    metaTree->setHeaderHidden(true);
-    m2Box->addWidget(metaTree);
-    slotFillMeta(metaTree);
+    m_metaTree = new QTreeWidget;
+    m_metaTree->setRootIsDecorated(true);
+    m_metaTree->setColumnCount(2);
+    m_metaTree->setAlternatingRowColors(true);
+    m_metaTree->setHeaderHidden(true);
+    m2Box->addWidget(m_metaTree);
     m_metaPage->setLayout(m2Box );
 
     // Clip analysis
@@ -224,11 +319,90 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     bar2->addAction(KoIconUtils::themedIcon(QStringLiteral("document-save-as")), i18n("Export analysis"), this, SLOT(slotSaveAnalysis()));
     bar2->addAction(KoIconUtils::themedIcon(QStringLiteral("document-open")), i18n("Import analysis"), this, SLOT(slotLoadAnalysis()));
     aBox->addWidget(bar2);
-
-    slotFillAnalysisData();
     m_analysisPage->setLayout(aBox );
 
-    // Force properties
+    // Force properties, the widgets depend on the clip type
+    QVBoxLayout *forceBox = new QVBoxLayout;
+    forceBox->setContentsMargins(0, 0, 0, 0);
+    m_forcePage->setLayout(forceBox);
+
+    m_tabWidget->addTab(m_propertiesPage, QString());
+    m_tabWidget->addTab(m_forcePage, QString());
+    m_tabWidget->addTab(m_markersPage, QString());
+    m_tabWidget->addTab(m_metaPage, QString());
+    m_tabWidget->addTab(m_analysisPage, QString());
+    m_tabWidget->setTabIcon(0, KoIconUtils::themedIcon(QStringLiteral("edit-find")));
+    m_tabWidget->setTabToolTip(0, i18n("Properties"));
+    m_tabWidget->setTabIcon(1, KoIconUtils::themedIcon(QStringLiteral("document-edit")));
+    m_tabWidget->setTabToolTip(1, i18n("Force properties"));
+    m_tabWidget->setTabIcon(2, KoIconUtils::themedIcon(QStringLiteral("bookmark-new")));
+    m_tabWidget->setTabToolTip(2, i18n("Markers"));
+    m_tabWidget->setTabIcon(3, KoIconUtils::themedIcon(QStringLiteral("view-grid")));
+    m_tabWidget->setTabToolTip(3, i18n("Metadata"));
+    m_tabWidget->setTabIcon(4, KoIconUtils::themedIcon(QStringLiteral("visibility")));
+    m_tabWidget->setTabToolTip(4, i18n("Analysis"));
+    m_tabWidget->setCurrentIndex(KdenliveSettings::properties_panel_page());
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, &ClipPropertiesController::updateTab);
+    connect(&m_fileMetaWatcher, &QFutureWatcher<PropertyRows>::finished, this, &ClipPropertiesController::slotGotFileMetaData);
+    connect(&m_metaWatcher, &QFutureWatcher<PropertyRows>::finished, this, &ClipPropertiesController::slotGotMetaData);
+    connect(&m_analysisWatcher, &QFutureWatcher<PropertyRows>::finished, this, &ClipPropertiesController::slotGotAnalysisData);
+}
+
+void ClipPropertiesController::setController(const Timecode &tc, ClipController *controller)
+{
+    m_tc = tc;
+    m_controller = controller;
+    m_id = controller->clipId();
+    m_type = controller->clipType();
+    delete m_properties;
+    m_properties = new Mlt::Properties(controller->properties());
+    m_originalProperties.clear();
+    m_clipLabel->setText(controller->clipName());
+    m_propertiesTree->clear();
+    m_markerTree->clear();
+    m_metaTree->clear();
+    m_analysisTree->clear();
+    delete m_forceContent;
+    m_forceContent = NULL;
+    m_textEdit = NULL;
+    findStreams();
+    m_tabWidget->setTabEnabled(PropertiesPage, m_type != Color);
+    // Only the displayed page is filled, the others when they are first shown
+    m_filledPages = 0;
+    fillPage(m_tabWidget->currentIndex());
+}
+
+void ClipPropertiesController::fillPage(int ix)
+{
+    if (!m_controller || ix < 0 || (m_filledPages & (1 << ix))) {
+        return;
+    }
+    m_filledPages |= 1 << ix;
+    switch (ix) {
+        case PropertiesPage:
+            fillProperties();
+            break;
+        case ForcePage:
+            fillForcePage();
+            break;
+        case MarkersPage:
+            slotFillMarkers();
+            break;
+        case MetaPage:
+            slotFillMeta();
+            break;
+        case AnalysisPage:
+            slotFillAnalysisData();
+            break;
+        default:
+            break;
+    }
+}
+
+void ClipPropertiesController::fillForcePage()
+{
+    m_forceContent = new QWidget(m_forcePage);
+
     QVBoxLayout *vbox = new QVBoxLayout;
     if (m_type == Text || m_type == SlideShow || m_type == TextTemplate) {
         QPushButton *editButton = new QPushButton(i18n("Edit Clip"), this);
@@ -237,19 +411,19 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     }
     if (m_type == Color || m_type == Image || m_type == AV || m_type == Video || m_type == TextTemplate) {
         // Edit duration widget
-        m_originalProperties.insert(QStringLiteral("out"), m_properties.get("out"));
-        int kdenlive_length = m_properties.get_int("kdenlive:duration");
+        m_originalProperties.insert(QStringLiteral("out"), m_properties->get("out"));
+        int kdenlive_length = m_properties->get_int("kdenlive:duration");
         if (kdenlive_length > 0)
             m_originalProperties.insert(QStringLiteral("kdenlive:duration"), QString::number(kdenlive_length));
-        m_originalProperties.insert(QStringLiteral("length"), m_properties.get("length"));
+        m_originalProperties.insert(QStringLiteral("length"), m_properties->get("length"));
         QHBoxLayout *hlay = new QHBoxLayout;
         QCheckBox *box = new QCheckBox(i18n("Duration"), this);
         box->setObjectName(QStringLiteral("force_duration"));
         hlay->addWidget(box);
-        TimecodeDisplay *timePos = new TimecodeDisplay(tc, this);
+        TimecodeDisplay *timePos = new TimecodeDisplay(m_tc, this);
         timePos->setObjectName(QStringLiteral("force_duration_value"));
-        timePos->setValue(kdenlive_length > 0 ? kdenlive_length : m_properties.get_int("length"));
-        int original_length = m_properties.get_int("kdenlive:original_length");
+        timePos->setValue(kdenlive_length > 0 ? kdenlive_length : m_properties->get_int("length"));
+        int original_length = m_properties->get_int("kdenlive:original_length");
         if (original_length > 0) {
             box->setChecked(true);
         }
@@ -264,7 +438,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     }
     if (m_type == TextTemplate) {
         // Edit text widget
-        QString currentText = m_properties.get("templatetext");
+        QString currentText = m_properties->get("templatetext");
         m_originalProperties.insert(QStringLiteral("templatetext"), currentText);
         m_textEdit = new QTextEdit(this);
         m_textEdit->setAcceptRichText(false);
@@ -276,15 +450,15 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         connect(button, &QPushButton::clicked, this, &ClipPropertiesController::slotTextChanged);
     } else if (m_type == Color) {
         // Edit color widget
-        m_originalProperties.insert(QStringLiteral("resource"), m_properties.get("resource"));
-        mlt_color color = m_properties.get_color("resource");
+        m_originalProperties.insert(QStringLiteral("resource"), m_properties->get("resource"));
+        mlt_color color = m_properties->get_color("resource");
         ChooseColorWidget *choosecolor = new ChooseColorWidget(i18n("Color"), QColor::fromRgb(color.r, color.g, color.b).name(), false, this);
         vbox->addWidget(choosecolor);
         //connect(choosecolor, SIGNAL(displayMessage(QString,int)), this, SIGNAL(displayMessage(QString,int)));
         connect(choosecolor, SIGNAL(modified(QColor)), this, SLOT(slotColorModified(QColor)));
         connect(this, SIGNAL(modified(QColor)), choosecolor, SLOT(slotColorModified(QColor)));
     } else if (m_type == Image) {
-        int transparency = m_properties.get_int("kdenlive:transparency");
+        int transparency = m_properties->get_int("kdenlive:transparency");
         m_originalProperties.insert(QStringLiteral("kdenlive:transparency"), QString::number(transparency));
         QHBoxLayout *hlay = new QHBoxLayout;
         QCheckBox *box = new QCheckBox(i18n("Transparent"), this);
@@ -296,8 +470,8 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
     }
     if (m_type == AV || m_type == Video || m_type == Image) {
         // Aspect ratio
-        int force_ar_num = m_properties.get_int("force_aspect_num");
-        int force_ar_den  = m_properties.get_int("force_aspect_den");
+        int force_ar_num = m_properties->get_int("force_aspect_num");
+        int force_ar_den  = m_properties->get_int("force_aspect_den");
         m_originalProperties.insert(QStringLiteral("force_aspect_den"), (force_ar_den == 0) ? QString() : QString::number(force_ar_den));
         m_originalProperties.insert(QStringLiteral("force_aspect_num"), (force_ar_num == 0) ? QString() : QString::number(force_ar_num));
         QHBoxLayout *hlay = new QHBoxLayout;
@@ -317,8 +491,8 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         hlay->addWidget(spin2);
         if (force_ar_num == 0) {
             // use current ratio
-            int num = m_properties.get_int("meta.media.sample_aspect_num");
-            int den = m_properties.get_int("meta.media.sample_aspect_den");
+            int num = m_properties->get_int("meta.media.sample_aspect_num");
+            int den = m_properties->get_int("meta.media.sample_aspect_den");
             if (den == 0) {
                 num = 1;
                 den = 1;
@@ -346,7 +520,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         QLocale locale;
 
         // Fps
-        QString force_fps = m_properties.get("force_fps");
+        QString force_fps = m_properties->get("force_fps");
         m_originalProperties.insert(QStringLiteral("force_fps"), force_fps.isEmpty() ? QStringLiteral("-") : force_fps);
         QHBoxLayout *hlay = new QHBoxLayout;
         QCheckBox *box = new QCheckBox(i18n("Frame rate"), this);
@@ -357,7 +531,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         connect(spin, SIGNAL(valueChanged(double)), this, SLOT(slotValueChanged(double)));
         spin->setObjectName(QStringLiteral("force_fps_value"));
         if (force_fps.isEmpty()) {
-            spin->setValue(controller->originalFps());
+            spin->setValue(m_controller->originalFps());
         }
         else {
             spin->setValue(locale.toDouble(force_fps));
@@ -370,7 +544,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         // Scanning
-        QString force_prog = m_properties.get("force_progressive");
+        QString force_prog = m_properties->get("force_progressive");
         m_originalProperties.insert(QStringLiteral("force_progressive"), force_prog.isEmpty() ? QStringLiteral("-") : force_prog);
         hlay = new QHBoxLayout;
         box = new QCheckBox(i18n("Scanning"), this);
@@ -392,7 +566,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         // Field order
-        QString force_tff = m_properties.get("force_tff");
+        QString force_tff = m_properties->get("force_tff");
         m_originalProperties.insert(QStringLiteral("force_tff"), force_tff.isEmpty() ? QStringLiteral("-") : force_tff);
         hlay = new QHBoxLayout;
         box = new QCheckBox(i18n("Field order"), this);
@@ -414,7 +588,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         //Autorotate
-        QString autorotate = m_properties.get("autorotate");
+        QString autorotate = m_properties->get("autorotate");
         m_originalProperties.insert(QStringLiteral("autorotate"), autorotate);
         hlay = new QHBoxLayout;
         box = new QCheckBox(i18n("Disable autorotate"), this);
@@ -425,7 +599,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         //Decoding threads
-        QString threads = m_properties.get("threads");
+        QString threads = m_properties->get("threads");
         m_originalProperties.insert(QStringLiteral("threads"), threads);
         hlay = new QHBoxLayout;
         hlay->addWidget(new QLabel(i18n("Threads")));
@@ -441,7 +615,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         //Video index
-        QString vix = m_properties.get("video_index");
+        QString vix = m_properties->get("video_index");
         m_originalProperties.insert(QStringLiteral("video_index"), vix);
         hlay = new QHBoxLayout;
         hlay->addWidget(new QLabel(i18n("Video index")));
@@ -457,7 +631,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         //Audio index
-        QString aix = m_properties.get("audio_index");
+        QString aix = m_properties->get("audio_index");
         m_originalProperties.insert(QStringLiteral("audio_index"), aix);
         hlay = new QHBoxLayout;
         hlay->addWidget(new QLabel(i18n("Audio index")));
@@ -482,9 +656,9 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         combo->addItem(ProfilesDialog::getColorspaceDescription(601), 601);
         combo->addItem(ProfilesDialog::getColorspaceDescription(709), 709);
         combo->addItem(ProfilesDialog::getColorspaceDescription(240), 240);
-        int force_colorspace = m_properties.get_int("force_colorspace");
+        int force_colorspace = m_properties->get_int("force_colorspace");
         m_originalProperties.insert(QStringLiteral("force_colorspace"), force_colorspace == 0 ? QStringLiteral("-") : QString::number(force_colorspace));
-        int colorspace = controller->videoCodecProperty(QStringLiteral("colorspace")).toInt();
+        int colorspace = m_controller->videoCodecProperty(QStringLiteral("colorspace")).toInt();
         if (force_colorspace > 0) {
             box->setChecked(true);
             combo->setEnabled(true);
@@ -501,7 +675,7 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         vbox->addLayout(hlay);
 
         //Full luma
-        QString force_luma = m_properties.get("set.force_full_luma");
+        QString force_luma = m_properties->get("set.force_full_luma");
         m_originalProperties.insert(QStringLiteral("set.force_full_luma"), force_luma);
         hlay = new QHBoxLayout;
         box = new QCheckBox(i18n("Full luma range"), this);
@@ -511,35 +685,23 @@ ClipPropertiesController::ClipPropertiesController(Timecode tc, ClipController *
         hlay->addWidget(box);
         vbox->addLayout(hlay);
     }
-    m_forcePage->setLayout(vbox);
+    m_forceContent->setLayout(vbox);
     vbox->addStretch(10);
-    m_tabWidget->addTab(m_propertiesPage, QString());
-    m_tabWidget->addTab(m_forcePage, QString());
-    m_tabWidget->addTab(m_markersPage, QString());
-    m_tabWidget->addTab(m_metaPage, QString());
-    m_tabWidget->addTab(m_analysisPage, QString());
-    m_tabWidget->setTabIcon(0, KoIconUtils::themedIcon(QStringLiteral("edit-find")));
-    m_tabWidget->setTabToolTip(0, i18n("Properties"));
-    m_tabWidget->setTabIcon(1, KoIconUtils::themedIcon(QStringLiteral("document-edit")));
-    m_tabWidget->setTabToolTip(1, i18n("Force properties"));
-    m_tabWidget->setTabIcon(2, KoIconUtils::themedIcon(QStringLiteral("bookmark-new")));
-    m_tabWidget->setTabToolTip(2, i18n("Markers"));
-    m_tabWidget->setTabIcon(3, KoIconUtils::themedIcon(QStringLiteral("view-grid")));
-    m_tabWidget->setTabToolTip(3, i18n("Metadata"));
-    m_tabWidget->setTabIcon(4, KoIconUtils::themedIcon(QStringLiteral("visibility")));
-    m_tabWidget->setTabToolTip(4, i18n("Analysis"));
-    m_tabWidget->setCurrentIndex(KdenliveSettings::properties_panel_page());
-    if (m_type == Color) m_tabWidget->setTabEnabled(0, false);
-    connect(m_tabWidget, &QTabWidget::currentChanged, this, &ClipPropertiesController::updateTab);
+    m_forcePage->layout()->addWidget(m_forceContent);
 }
 
 ClipPropertiesController::~ClipPropertiesController()
 {
+    m_fileMetaWatcher.waitForFinished();
+    m_metaWatcher.waitForFinished();
+    m_analysisWatcher.waitForFinished();
+    delete m_properties;
 }
 
 void ClipPropertiesController::updateTab(int ix)
 {
     KdenliveSettings::setProperties_panel_page(ix);
+    fillPage(ix);
 }
 
 void ClipPropertiesController::slotRefreshTimeCode()
@@ -549,19 +711,24 @@ void ClipPropertiesController::slotRefreshTimeCode()
 
 void ClipPropertiesController::slotReloadProperties()
 {
+    if (!m_controller) {
+        return;
+    }
     mlt_color color;
-    m_clipLabel->setText(m_properties.get("kdenlive:clipname"));
+    m_clipLabel->setText(m_properties->get("kdenlive:clipname"));
     switch (m_type) {
         case Color:
-            m_originalProperties.insert(QStringLiteral("resource"), m_properties.get("resource"));
-            m_originalProperties.insert(QStringLiteral("out"), m_properties.get("out"));
-            m_originalProperties.insert(QStringLiteral("length"), m_properties.get("length"));
-            emit modified(m_properties.get_int("length"));
-            color = m_properties.get_color("resource");
+            m_originalProperties.insert(QStringLiteral("resource"), m_properties->get("resource"));
+            m_originalProperties.insert(QStringLiteral("out"), m_properties->get("out"));
+            m_originalProperties.insert(QStringLiteral("length"), m_properties->get("length"));
+            emit modified(m_properties->get_int("length"));
+            color = m_properties->get_color("resource");
             emit modified(QColor::fromRgb(color.r, color.g, color.b));
             break;
         case TextTemplate:
-            m_textEdit->setPlainText(m_properties.get("templatetext"));
+            if (m_textEdit) {
+                m_textEdit->setPlainText(m_properties->get("templatetext"));
+            }
             break;
         default:
             break;
@@ -579,12 +746,12 @@ void ClipPropertiesController::slotColorModified(QColor newcolor)
 void ClipPropertiesController::slotDurationChanged(int duration)
 {
     QMap <QString, QString> properties;
-    int original_length = m_properties.get_int("kdenlive:original_length");
+    int original_length = m_properties->get_int("kdenlive:original_length");
     // kdenlive_length is the default duration for image / title clips
-    int kdenlive_length = m_properties.get_int("kdenlive:duration");
-    int current_length = m_properties.get_int("length");
+    int kdenlive_length = m_properties->get_int("kdenlive:duration");
+    int current_length = m_properties->get_int("length");
     if (original_length == 0) {
-        m_properties.set("kdenlive:original_length", kdenlive_length > 0 ? kdenlive_length : current_length);
+        m_properties->set("kdenlive:original_length", kdenlive_length > 0 ? kdenlive_length : current_length);
     }
     if (kdenlive_length > 0) {
         // special case, image/title clips store default duration in kdenlive:duration property
@@ -615,9 +782,9 @@ void ClipPropertiesController::slotEnableForce(int state)
         if (param == QLatin1String("force_duration")) {
             // special case, reset original duration
             TimecodeDisplay *timePos = findChild<TimecodeDisplay *>(param + "_value");
-            timePos->setValue(m_properties.get_int("kdenlive:original_length"));
-            slotDurationChanged(m_properties.get_int("kdenlive:original_length"));
-            m_properties.set("kdenlive:original_length", (char *) NULL);
+            timePos->setValue(m_properties->get_int("kdenlive:original_length"));
+            slotDurationChanged(m_properties->get_int("kdenlive:original_length"));
+            m_properties->set("kdenlive:original_length", (char *) NULL);
             return;
         }
         else if (param == QLatin1String("kdenlive:transparency")) {
@@ -637,10 +804,10 @@ void ClipPropertiesController::slotEnableForce(int state)
     } else {
         // A force property was set
         if (param == QLatin1String("force_duration")) {
-            int original_length = m_properties.get_int("kdenlive:original_length");
+            int original_length = m_properties->get_int("kdenlive:original_length");
             if (original_length == 0) {
-                int kdenlive_duration = m_properties.get_int("kdenlive:duration");
-                m_properties.set("kdenlive:original_length", kdenlive_duration > 0 ? kdenlive_duration : m_properties.get_int("length"));
+                int kdenlive_duration = m_properties->get_int("kdenlive:duration");
+                m_properties->set("kdenlive:original_length", kdenlive_duration > 0 ? kdenlive_duration : m_properties->get_int("length"));
             }
         }
         else if (param == QLatin1String("force_fps")) {
@@ -734,24 +901,40 @@ void ClipPropertiesController::slotComboValueChanged()
     m_originalProperties = properties;
 }
 
-void ClipPropertiesController::fillProperties()
+void ClipPropertiesController::findStreams()
 {
     m_clipProperties.clear();
+    if (m_type != AV && m_type != Video && m_type != Audio) {
+        return;
+    }
+    int video_max = 0;
+    int audio_max = 0;
+
+    // Find maximum stream index values
+    for (int ix = 0; ix < m_controller->int_property(QStringLiteral("meta.media.nb_streams")); ++ix) {
+        char property[200];
+        snprintf(property, sizeof(property), "meta.media.%d.stream.type", ix);
+        QString type = m_controller->property(property);
+        if (type == QLatin1String("video"))
+            video_max = ix;
+        else if (type == QLatin1String("audio"))
+            audio_max = ix;
+    }
+    m_clipProperties.insert(QStringLiteral("default_video"), QString::number(m_controller->int_property(QStringLiteral("video_index"))));
+    m_clipProperties.insert(QStringLiteral("video_max"), QString::number(video_max));
+    m_clipProperties.insert(QStringLiteral("default_audio"), QString::number(m_controller->int_property(QStringLiteral("audio_index"))));
+    m_clipProperties.insert(QStringLiteral("audio_max"), QString::number(audio_max));
+}
+
+void ClipPropertiesController::fillProperties()
+{
     QList <QStringList> propertyMap;
 
     m_propertiesTree->setSortingEnabled(false);
 
 #ifdef KF5_USE_FILEMETADATA
-    // Read File Metadata through KDE's metadata system
-    KFileMetaData::ExtractorCollection metaDataCollection;
-    QMimeDatabase mimeDatabase;
-    QMimeType mimeType;
-
-    mimeType = mimeDatabase.mimeTypeForFile( m_controller->clipUrl().toLocalFile() );
-    foreach(KFileMetaData::Extractor* plugin, metaDataCollection.fetchExtractors(mimeType.name())) {
-        ExtractionResult extractionResult(m_controller->clipUrl().toLocalFile(), mimeType.name(), m_propertiesTree);
-        plugin->extract(&extractionResult);
-    }
+    // Read File Metadata through KDE's metadata system, the extractors can be slow on large files
+    m_fileMetaWatcher.setFuture(QtConcurrent::run(readFileMetaData, m_id, m_controller->clipUrl().toLocalFile()));
 #endif
 
     // Get MLT's metadata
@@ -762,25 +945,7 @@ void ClipPropertiesController::fillProperties()
     }
     if (m_type == AV || m_type == Video || m_type == Audio) {
         int vindex = m_controller->int_property(QStringLiteral("video_index"));
-        int video_max = 0;
         int default_audio = m_controller->int_property(QStringLiteral("audio_index"));
-        int audio_max = 0;
-
-        // Find maximum stream index values
-        for (int ix = 0; ix < m_controller->int_property(QStringLiteral("meta.media.nb_streams")); ++ix) {
-            char property[200];
-            snprintf(property, sizeof(property), "meta.media.%d.stream.type", ix);
-            QString type = m_controller->property(property);
-            if (type == QLatin1String("video"))
-                video_max = ix;
-            else if (type == QLatin1String("audio"))
-                audio_max = ix;
-        }
-        m_clipProperties.insert(QStringLiteral("default_video"), QString::number(vindex));
-        m_clipProperties.insert(QStringLiteral("video_max"), QString::number(video_max));
-        m_clipProperties.insert(QStringLiteral("default_audio"), QString::number(default_audio));
-        m_clipProperties.insert(QStringLiteral("audio_max"), QString::number(audio_max));
-
         if (vindex > -1) {
             // We have a video stream
             char property[200];
@@ -862,6 +1027,18 @@ void ClipPropertiesController::fillProperties()
     m_propertiesTree->resizeColumnToContents(0);
 }
 
+void ClipPropertiesController::slotGotFileMetaData()
+{
+    PropertyRows result = m_fileMetaWatcher.result();
+    if (result.clipId != m_id) {
+        return;
+    }
+    foreach(const QStringList &row, result.rows) {
+        new QTreeWidgetItem(m_propertiesTree, row);
+    }
+    m_propertiesTree->resizeColumnToContents(0);
+}
+
 void ClipPropertiesController::slotFillMarkers()
 {
     m_markerTree->clear();
@@ -935,19 +1112,25 @@ void ClipPropertiesController::slotLoadMarkers()
     emit loadMarkers(m_id);
 }
 
-void ClipPropertiesController::slotFillMeta(QTreeWidget *tree)
+void ClipPropertiesController::slotFillMeta()
 {
-    tree->clear();
+    m_metaTree->clear();
     if (m_type != AV && m_type != Video && m_type != Image) {
         // Currently, we only use exiftool on video files
         return;
     }
+    MetaRequest request;
+    request.clipId = m_id;
+    request.path = m_controller->clipUrl().path();
+    request.type = m_type;
+    request.readExif = false;
+    request.readMagicLantern = false;
     int exifUsed = m_controller->int_property(QStringLiteral("kdenlive:exiftool"));
     if (exifUsed == 1) {
           Mlt::Properties subProperties;
-          subProperties.pass_values(m_properties, "kdenlive:meta.exiftool.");
+          subProperties.pass_values(*m_properties, "kdenlive:meta.exiftool.");
           if (subProperties.count() > 0) {
-              QTreeWidgetItem *exif = new QTreeWidgetItem(tree, QStringList() << i18n("Exif") << QString());
+              QTreeWidgetItem *exif = new QTreeWidgetItem(m_metaTree, QStringList() << i18n("Exif") << QString());
               exif->setExpanded(true);
               for (int i = 0; i < subProperties.count(); i++) {
                   new QTreeWidgetItem(exif, QStringList() << subProperties.get_name(i) << subProperties.get(i));
@@ -955,119 +1138,106 @@ void ClipPropertiesController::slotFillMeta(QTreeWidget *tree)
           }
     }
     else if (KdenliveSettings::use_exiftool()) {
-        QString url = m_controller->clipUrl().path();
-        //Check for Canon THM file
-        url = url.section('.', 0, -2) + ".THM";
-        if (QFile::exists(url)) {
-            // Read the exif metadata embedded in the THM file
-            QProcess p;
-            QStringList args;
-            args << QStringLiteral("-g") << QStringLiteral("-args") << url;
-            p.start(QStringLiteral("exiftool"), args);
-            p.waitForFinished();
-            QString res = p.readAllStandardOutput();
-            m_controller->setProperty(QStringLiteral("kdenlive:exiftool"), 1);
-            QTreeWidgetItem *exif = NULL;
-            QStringList list = res.split('\n');
-            foreach(const QString &tagline, list) {
-                if (tagline.startsWith(QLatin1String("-File")) || tagline.startsWith(QLatin1String("-ExifTool"))) continue;
-                QString tag = tagline.section(':', 1).simplified();
-                if (tag.startsWith(QLatin1String("ImageWidth")) || tag.startsWith(QLatin1String("ImageHeight"))) continue;
-                if (!tag.section('=', 0, 0).isEmpty() && !tag.section('=', 1).simplified().isEmpty()) {
-                    if (!exif) {
-                        exif = new QTreeWidgetItem(tree, QStringList() << i18n("Exif") << QString());
-                        exif->setExpanded(true);
-                    }
-                    m_controller->setProperty("kdenlive:meta.exiftool." + tag.section('=', 0, 0), tag.section('=', 1).simplified());
-                    new QTreeWidgetItem(exif, QStringList() << tag.section('=', 0, 0) << tag.section('=', 1).simplified());
-                }
-            }
-        } else {
-            if (m_type == Image || m_controller->codec(false) == QLatin1String("h264")) {
-                QProcess p;
-                QStringList args;
-                args << QStringLiteral("-g") << QStringLiteral("-args") << m_controller->clipUrl().path();
-                p.start(QStringLiteral("exiftool"), args);
-                p.waitForFinished();
-                QString res = p.readAllStandardOutput();
-                if (m_type != Image) {
-                    m_controller->setProperty(QStringLiteral("kdenlive:exiftool"), 1);
-                }
-                QTreeWidgetItem *exif = NULL;
-                QStringList list = res.split('\n');
-                foreach(const QString &tagline, list) {
-                    if (m_type != Image && !tagline.startsWith(QLatin1String("-H264"))) continue;
-                    QString tag = tagline.section(':', 1);
-                    if (tag.startsWith(QLatin1String("ImageWidth")) || tag.startsWith(QLatin1String("ImageHeight"))) continue;
-                    if (!exif) {
-                        exif = new QTreeWidgetItem(tree, QStringList() << i18n("Exif") << QString());
-                        exif->setExpanded(true);
-                    }
-                    if (m_type != Image) {
-                        // Do not store image exif metadata in project file, would be too much noise
-                        m_controller->setProperty("kdenlive:meta.exiftool." + tag.section('=', 0, 0), tag.section('=', 1).simplified());
-                    }
-                    new QTreeWidgetItem(exif, QStringList() << tag.section('=', 0, 0) << tag.section('=', 1).simplified());
-                }
-            }
-        }
+        request.readExif = true;
+        request.codec = m_controller->codec(false);
     }
     int magic = m_controller->int_property(QStringLiteral("kdenlive:magiclantern"));
     if (magic == 1) {
         Mlt::Properties subProperties;
-        subProperties.pass_values(m_properties, "kdenlive:meta.magiclantern.");
-        QTreeWidgetItem *magicL = NULL;
+        subProperties.pass_values(*m_properties, "kdenlive:meta.magiclantern.");
+        QList <QStringList> rows;
         for (int i = 0; i < subProperties.count(); i++) {
-            if (!magicL) {
-                magicL = new QTreeWidgetItem(tree, QStringList() << i18n("Magic Lantern") << QString());
-                QIcon icon(QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("meta_magiclantern.png")));
-                magicL->setIcon(0, icon);
-                magicL->setExpanded(true);
-            }
-            new QTreeWidgetItem(magicL, QStringList() << subProperties.get_name(i) << subProperties.get(i));
+            rows << (QStringList() << subProperties.get_name(i) << subProperties.get(i));
         }
+        addMagicLanternItems(rows);
     }
     else if (m_type != Image && KdenliveSettings::use_magicLantern()) {
-        QString url = m_controller->clipUrl().path();
-        url = url.section('.', 0, -2) + ".LOG";
-        if (QFile::exists(url)) {
-            QFile file(url);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                m_controller->setProperty(QStringLiteral("kdenlive:magiclantern"), 1);
-                QTreeWidgetItem *magicL = NULL;
-                while (!file.atEnd()) {
-                    QString line = file.readLine().simplified();
-                    if (line.startsWith('#') || line.isEmpty() || !line.contains(':')) continue;
-                    if (line.startsWith(QLatin1String("CSV data"))) break;
-                    m_controller->setProperty("kdenlive:meta.magiclantern." + line.section(':', 0, 0).simplified(), line.section(':', 1).simplified());
-                    if (!magicL) {
-                        magicL = new QTreeWidgetItem(tree, QStringList() << i18n("Magic Lantern") << QString());
-                        QIcon icon(QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("meta_magiclantern.png")));
-                        magicL->setIcon(0, icon);
-                        magicL->setExpanded(true);
-                    }
-                    new QTreeWidgetItem(magicL, QStringList() << line.section(':', 0, 0).simplified() << line.section(':', 1).simplified());
-                }
+        request.readMagicLantern = true;
+    }
+    if (request.readExif || request.readMagicLantern) {
+        // exiftool and the log files are read in a thread, results are stored by slotGotMetaData
+        m_metaWatcher.setFuture(QtConcurrent::run(readMetaData, request));
+    }
+    m_metaTree->resizeColumnToContents(0);
+}
+
+void ClipPropertiesController::addMagicLanternItems(const QList <QStringList> &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    QTreeWidgetItem *magicL = new QTreeWidgetItem(m_metaTree, QStringList() << i18n("Magic Lantern") << QString());
+    QIcon icon(QStandardPaths::locate(QStandardPaths::DataLocation, QStringLiteral("meta_magiclantern.png")));
+    magicL->setIcon(0, icon);
+    magicL->setExpanded(true);
+    foreach(const QStringList &row, rows) {
+        new QTreeWidgetItem(magicL, row);
+    }
+}
+
+void ClipPropertiesController::slotGotMetaData()
+{
+    PropertyRows result = m_metaWatcher.result();
+    if (result.clipId != m_id || !m_controller) {
+        return;
+    }
+    if (result.storeExif) {
+        m_controller->setProperty(QStringLiteral("kdenlive:exiftool"), 1);
+    }
+    if (!result.exif.isEmpty()) {
+        // Keep the Exif entries above the Magic Lantern ones
+        QTreeWidgetItem *exif = new QTreeWidgetItem(QStringList() << i18n("Exif") << QString());
+        m_metaTree->insertTopLevelItem(0, exif);
+        exif->setExpanded(true);
+        foreach(const QStringList &row, result.exif) {
+            if (result.storeExif) {
+                m_controller->setProperty("kdenlive:meta.exiftool." + row.at(0), row.at(1));
             }
+            new QTreeWidgetItem(exif, row);
         }
-
-        //if (!meta.isEmpty())
-        //clip->setMetadata(meta, "Magic Lantern");
-        //clip->setProperty("magiclantern", "1");
     }
-    tree->resizeColumnToContents(0);
+    if (result.storeMagicLantern) {
+        m_controller->setProperty(QStringLiteral("kdenlive:magiclantern"), 1);
+        foreach(const QStringList &row, result.magicLantern) {
+            m_controller->setProperty("kdenlive:meta.magiclantern." + row.at(0), row.at(1));
+        }
+        addMagicLanternItems(result.magicLantern);
+    }
+    m_metaTree->resizeColumnToContents(0);
 }
 
 void ClipPropertiesController::slotFillAnalysisData()
 {
     m_analysisTree->clear();
+    if (!m_controller) {
+        return;
+    }
     Mlt::Properties subProperties;
-    subProperties.pass_values(m_properties, "kdenlive:clipanalysis.");
-    if (subProperties.count() > 0) {
-        for (int i = 0; i < subProperties.count(); i++) {
+    subProperties.pass_values(*m_properties, "kdenlive:clipanalysis.");
+    QList <QStringList> references;
+    for (int i = 0; i < subProperties.count(); i++) {
+        if (ProjectDataStore::isReference(subProperties.get(i))) {
+            references << (QStringList() << subProperties.get_name(i) << subProperties.get(i));
+        } else {
             new QTreeWidgetItem(m_analysisTree, QStringList() << subProperties.get_name(i) << subProperties.get(i));
         }
     }
+    if (!references.isEmpty()) {
+        // Large analysis tables live in the project data store, load them in a thread
+        m_analysisWatcher.setFuture(QtConcurrent::run(resolveAnalysis, m_id, references));
+    }
+    m_analysisTree->resizeColumnToContents(0);
+}
+
+void ClipPropertiesController::slotGotAnalysisData()
+{
+    PropertyRows result = m_analysisWatcher.result();
+    if (result.clipId != m_id) {
+        return;
+    }
+    foreach(const QStringList &row, result.rows) {
+        new QTreeWidgetItem(m_analysisTree, row);
+    }
     m_analysisTree->resizeColumnToContents(0);
 }
 
@@ -29,12 +29,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QString>
 #include <QObject>
 #include <QUrl>
+#include <QTreeWidget>
+#include <QFutureWatcher>
 
 class ClipController;
 class QMimeData;
 class QTextEdit;
 class QLabel;
 
+/** @brief Rows of (name, value) gathered for a clip in a worker thread. */
+struct PropertyRows {
+    QString clipId;
+    QList <QStringList> rows;
+    QList <QStringList> exif;
+    QList <QStringList> magicLantern;
+    /** @brief True if the exiftool results should be saved in the clip properties. */
+    bool storeExif;
+    /** @brief True if a Magic Lantern log was found for the clip. */
+    bool storeMagicLantern;
+};
+
 class AnalysisTree : public QTreeWidget
 {
 public:
@@ -56,19 +70,22 @@ class ClipPropertiesController : public QWidget
   Q_OBJECT
 public:
     /**
-     * @brief Constructor.
-     * @param id The clip's id
-     * @param properties The clip's properties
+     * @brief Constructor, the panel is then reused for every displayed clip through setController.
      * @param parent The widget where our infos will be displayed
      */
-    explicit ClipPropertiesController(Timecode tc, ClipController *controller, QWidget *parent);
+    explicit ClipPropertiesController(QWidget *parent);
     virtual ~ClipPropertiesController();
+    /** @brief Display the properties of a clip. Only the current tab is filled, the other ones when they are shown.
+     * @param tc The project timecode
+     * @param controller The clip's controller
+     */
+    void setController(const Timecode &tc, ClipController *controller);
 
 public slots:
     void slotReloadProperties();
     void slotRefreshTimeCode();
     void slotFillMarkers();
-    void slotFillMeta(QTreeWidget *tree);
+    void slotFillMeta();
     void slotFillAnalysisData();
 
 private slots:
@@ -90,15 +107,25 @@ private slots:
     void slotValueChanged(int value);
     void slotTextChanged();
     void updateTab(int ix);
+    void slotGotFileMetaData();
+    void slotGotMetaData();
+    void slotGotAnalysisData();
 
 private:
+    enum PanelPage {
+        PropertiesPage = 0,
+        ForcePage,
+        MarkersPage,
+        MetaPage,
+        AnalysisPage
+    };
     ClipController *m_controller;
     QTabWidget *m_tabWidget;
     QLabel *m_clipLabel;
     Timecode m_tc;
     QString m_id;
     ClipType m_type;
-    Mlt::Properties m_properties;
+    Mlt::Properties *m_properties;
     QMap <QString, QString> m_originalProperties;
     QMap <QString, QString> m_clipProperties;
     QTreeWidget *m_propertiesTree;
@@ -108,9 +135,22 @@ private:
     QWidget *m_metaPage;
     QWidget *m_analysisPage;
     QTreeWidget *m_markerTree;
+    QTreeWidget *m_metaTree;
     AnalysisTree *m_analysisTree;
+    /** @brief The force page widgets, rebuilt for each clip type. */
+    QWidget *m_forceContent;
     QTextEdit *m_textEdit;
+    /** @brief Bitmask of the tabs already filled for the current clip. */
+    int m_filledPages;
+    QFutureWatcher <PropertyRows> m_fileMetaWatcher;
+    QFutureWatcher <PropertyRows> m_metaWatcher;
+    QFutureWatcher <PropertyRows> m_analysisWatcher;
     void fillProperties();
+    /** @brief Find the maximum stream indexes, used by the force page. */
+    void findStreams();
+    void fillPage(int ix);
+    void fillForcePage();
+    void addMagicLanternItems(const QList <QStringList> &rows);
 
 signals:
     void updateClipProperties(const QString &,QMap <QString, QString>, QMap <QString, QString>);
@@ -109,6 +109,8 @@ EffectsParameterList EffectsController::getEffectArgs(const ProfileInfo &info, c
     parameters.addParam(QStringLiteral("id"), effect.attribute(QStringLiteral("id")));
     if (effect.hasAttribute(QStringLiteral("src"))) parameters.addParam(QStringLiteral("src"), effect.attribute(QStringLiteral("src")));
     if (effect.hasAttribute(QStringLiteral("disable"))) parameters.addParam(QStringLiteral("disable"), effect.attribute(QStringLiteral("disable")));
+    // Lets the timeline preview ignore audio effects
+    if (effect.attribute(QStringLiteral("type")) == QLatin1String("audio")) parameters.addParam(QStringLiteral("kdenlive:audio"), QStringLiteral("1"));
     /*if (effect.hasAttribute(QStringLiteral("in"))) parameters.addParam(QStringLiteral("in"), effect.attribute(QStringLiteral("in")));
     if (effect.hasAttribute(QStringLiteral("out"))) parameters.addParam(QStringLiteral("out"), effect.attribute(QStringLiteral("out")));*/
     if (effect.attribute(QStringLiteral("id")) == QLatin1String("region")) {
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "probecache.h"
+
+#include <mlt++/Mlt.h>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// Identifies a probe cache file, followed by the format version
+#define PROBE_CACHE_MAGIC 0x4b505242
+#define PROBE_CACHE_VERSION 1
+
+// Properties set by the avformat producer when opening a file, besides the meta.media. and meta.attr. ones
+static const char *probedProperties[] = { "length", "seekable", "audio_index", "video_index", "creation_time", NULL };
+
+static bool isProbedProperty(const QString &name)
+{
+    if (name.startsWith(QLatin1String("meta.media.")) || name.startsWith(QLatin1String("meta.attr."))) {
+        return true;
+    }
+    for (int i = 0; probedProperties[i]; ++i) {
+        if (name == QLatin1String(probedProperties[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString ProbeCache::cacheFile(const QString &hash)
+{
+    QString kdenliveCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (kdenliveCacheDir.isEmpty() || hash.isEmpty()) {
+        return QString();
+    }
+    QDir dir(kdenliveCacheDir + QStringLiteral("/probe"));
+    if (!dir.exists() && !dir.mkpath(QStringLiteral("."))) {
+        return QString();
+    }
+    return dir.absoluteFilePath(hash + QStringLiteral(".probe"));
+}
+
+bool ProbeCache::restore(const QString &hash, const QString &path, Mlt::Properties &properties)
+{
+    QString fileName = cacheFile(hash);
+    QFileInfo info(path);
+    if (fileName.isEmpty() || !info.exists()) {
+        return false;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    quint32 magic;
+    quint16 version;
+    qint64 size;
+    qint64 modified;
+    QMap <QString, QString> values;
+    stream >> magic >> version >> size >> modified >> values;
+    if (stream.status() != QDataStream::Ok || magic != PROBE_CACHE_MAGIC || version != PROBE_CACHE_VERSION) {
+        return false;
+    }
+    if (size != info.size() || modified != info.lastModified().toMSecsSinceEpoch() || !values.contains(QStringLiteral("meta.media.nb_streams"))) {
+        // File changed since it was probed
+        return false;
+    }
+    QMapIterator <QString, QString> i(values);
+    while (i.hasNext()) {
+        i.next();
+        properties.set(i.key().toUtf8().constData(), i.value().toUtf8().constData());
+    }
+    if (values.contains(QStringLiteral("length"))) {
+        properties.set("out", values.value(QStringLiteral("length")).toInt() - 1);
+    }
+    return true;
+}
+
+void ProbeCache::store(const QString &hash, const QString &path, Mlt::Properties &properties)
+{
+    QString service = properties.get("mlt_service");
+    if (!service.startsWith(QLatin1String("avformat")) || !properties.get("meta.media.nb_streams")) {
+        // Not an avformat producer or file was never opened
+        return;
+    }
+    QString fileName = cacheFile(hash);
+    QFileInfo info(path);
+    if (fileName.isEmpty() || !info.exists()) {
+        return;
+    }
+    QMap <QString, QString> values;
+    for (int i = 0; i < properties.count(); ++i) {
+        QString name = properties.get_name(i);
+        if (isProbedProperty(name) && properties.get(i)) {
+            values.insert(name, QString::fromUtf8(properties.get(i)));
+        }
+    }
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << (quint32) PROBE_CACHE_MAGIC << (quint16) PROBE_CACHE_VERSION << (qint64) info.size() << (qint64) info.lastModified().toMSecsSinceEpoch() << values;
+    file.commit();
+}
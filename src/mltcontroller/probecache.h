@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <QString>
+
+namespace Mlt
+{
+class Properties;
+}
+
+/**
+ * @class ProbeCache
+ * @brief Stores the avformat probe results of clips on disk, so that a project can be reopened without opening every file's demuxer.
+ *
+ * Entries are stored in the cache folder, one file per clip hash. An entry is only used if the clip file still has the size and
+ * modification time it had when probed.
+ */
+class ProbeCache
+{
+public:
+    /** @brief Fill properties with the cached probe results for a clip.
+     *  @param hash The clip hash (kdenlive:file_hash)
+     *  @param path The clip file, used to check if the entry is still valid
+     *  @return true if a valid entry was found */
+    static bool restore(const QString &hash, const QString &path, Mlt::Properties &properties);
+    /** @brief Save the probe results of an avformat producer, does nothing if the producer was not probed. */
+    static void store(const QString &hash, const QString &path, Mlt::Properties &properties);
+
+private:
+    static QString cacheFile(const QString &hash);
+};
+
+#endif
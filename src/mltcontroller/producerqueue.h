@@ -26,7 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "definitions.h"
 
 #include <QMutex>
-#include <QFuture>
+#include <QWaitCondition>
+#include <QThreadPool>
 
 class ClipController;
 class BinController;
@@ -52,7 +53,7 @@ public:
     explicit ProducerQueue(BinController *controller);
     ~ProducerQueue();
 
-    /** @brief Force processing of clip with selected id. */
+    /** @brief Move clip with selected id to the front of the queue and wait until it is loaded. */
     void forceProcessing(const QString &id);
     /** @brief Are we currently processing clip with selected id. */
     bool isProcessing(const QString &id);
@@ -64,11 +65,32 @@ private:
     QList <requestClipInfo> m_requestList;
     /** @brief The ids of the clips that are currently being loaded for info query */
     QStringList m_processingClipId;
-    QFuture <void> m_infoThread;
+    /** @brief The ids of the clips in the order their result must be published to the bin */
+    QStringList m_publishOrder;
+    /** @brief Forced clips, published as soon as they are ready */
+    QStringList m_priorityClips;
+    QWaitCondition m_turnCondition;
+    QWaitCondition m_doneCondition;
+    /** @brief Serializes the bin controller updates done by the workers */
+    QMutex m_publishMutex;
+    QThreadPool m_workerPool;
+    int m_activeWorkers;
     BinController *m_binController;
     ClipType getTypeForService(const QString &id, const QString &path) const;
+    /** @brief Returns true if the clip xml describes a file opened by the avformat producer. */
+    bool isAvformatClip(const QDomElement &xml, ClipType type) const;
     /** @brief Pass xml values to an MLT producer at build time */
     void processProducerProperties(Mlt::Producer *prod, QDomElement xml);
+    /** @brief Number of clips loaded in parallel. */
+    static int producerThreads();
+    /** @brief Start workers for the queued requests, up to maxWorkers (m_infoMutex must be locked). */
+    void startWorkers(int maxWorkers);
+    /** @brief Block until all earlier requests were published, unless the clip was forced. */
+    void waitForTurn(const QString &id);
+    /** @brief Build the thumbnail of an existing producer. */
+    void processThumbnail(const requestClipInfo &info);
+    /** @brief Build the producer and clip controller for a request and publish it. */
+    void processClip(requestClipInfo info, const QLocale &locale);
 
 public slots:
       /** @brief Requests the file properties for the specified URL (will be put in a queue list)
@@ -77,12 +99,14 @@ public slots:
     @param imageHeight The height (in pixels) of the returned thumbnail (height of a treewidgetitem in projectlist)
     @param replaceProducer If true, the MLT producer will be recreated */
     void getFileProperties(const QDomElement &xml, const QString &clipId, int imageHeight, bool replaceProducer = true);
+    /** @brief Queue the file properties requests of many clips at once, the workers are started once. */
+    void getFileProperties(const QList <requestClipInfo> &requests);
 
     /** @brief Processing of this clip is over, producer was set on clip, remove from list. */
     void slotProcessingDone(const QString &id);
 
 private slots:
-    /** @brief Process the clip info requests (in a separate thread). */
+    /** @brief Process the clip info requests (one worker of the pool). */
     void processFileProperties();
     /** @brief A clip with multiple video streams was found, ask what to do. */
     void slotMultiStreamProducerFound(const QString &path, QList<int> audio_list, QList<int> video_list, stringMap data);
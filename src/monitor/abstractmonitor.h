@@ -21,6 +21,8 @@
 #define ABSTRACTMONITOR_H
 
 #include "definitions.h"
+#include "scopes/sharedframe.h"
+#include "scopes/colorscopes/scopecounts.h"
 
 #include <stdint.h>
 
@@ -68,6 +70,9 @@ private:
 signals:
     /** @brief The renderer refreshed the current frame. */
     void frameUpdated(const QImage &);
+    /** @brief The renderer refreshed the current frame, YUV planes shared with the monitor.
+     *  The scope counts are only filled if they were computed on the GPU. */
+    void yuvFrameUpdated(const SharedFrame &, const ScopeCounts &);
 
     /** @brief This signal contains the audio of the current frame. */
     void audioSamplesSignal(const audioShortVector&,int,int,int);
@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "audioscrubber.h"
+#include "kdenlivesettings.h"
+
+#include <mlt++/Mlt.h>
+
+#include <QtConcurrent>
+#include <QSysInfo>
+#ifdef QT5_USE_MULTIMEDIA
+#include <QAudioOutput>
+#include <QAudioDeviceInfo>
+#endif
+
+#include <cmath>
+
+// Sample rate and channels of the decoded cache and of the output
+#define SCRUB_FREQUENCY 48000
+#define SCRUB_CHANNELS 2
+// Duration of a grain in ms, about one frame
+#define SCRUB_GRAIN 40
+// Number of samples crossfaded between two grains
+#define SCRUB_FADE 256
+// Scrub speeds, relative to normal playback, are kept between these bounds
+#define SCRUB_MIN_SPEED 0.25
+#define SCRUB_MAX_SPEED 4.0
+// After this delay in ms without scrubbing, the next step is played at normal speed
+#define SCRUB_IDLE_DELAY 250
+
+namespace {
+struct ScrubRequest
+{
+    Mlt::Profile *profile;
+    QString xml;
+    double fps;
+    int start;
+    int count;
+    int revision;
+};
+
+ScrubCache decodeAudio(const ScrubRequest &request, QAtomicInt *revision)
+{
+    ScrubCache cache;
+    cache.start = request.start;
+    cache.revision = request.revision;
+    // Our own copy of the producer, the monitor consumer may be using the original one
+    Mlt::Producer producer(*request.profile, "xml-string", request.xml.toUtf8().constData());
+    if (!producer.is_valid()) return cache;
+    const int count = qMin(request.count, producer.get_length() - request.start);
+    cache.atEnd = count < request.count;
+    cache.offsets.reserve(count + 1);
+    cache.offsets << 0;
+    for (int i = 0; i < count; ++i) {
+        if (revision->load() != request.revision) {
+            // The source changed, this decode is useless
+            cache.revision = -1;
+            break;
+        }
+        const int position = request.start + i;
+        int samples = mlt_sample_calculator(request.fps, SCRUB_FREQUENCY, position);
+        const int expected = samples;
+        producer.seek(position);
+        Mlt::Frame *frame = producer.get_frame();
+        const qint16 *data = NULL;
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = SCRUB_FREQUENCY;
+        int channels = SCRUB_CHANNELS;
+        if (frame && frame->is_valid() && frame->get_int("test_audio") == 0) {
+            data = (const qint16 *) frame->get_audio(format, frequency, channels, samples);
+        }
+        const int offset = cache.samples.count();
+        if (data && samples > 0 && channels == SCRUB_CHANNELS && frequency == SCRUB_FREQUENCY) {
+            cache.samples.resize(offset + samples * SCRUB_CHANNELS);
+            memcpy(cache.samples.data() + offset, data, samples * SCRUB_CHANNELS * sizeof(qint16));
+        } else {
+            // No audio in this frame, keep the timing with silence
+            cache.samples.resize(offset + expected * SCRUB_CHANNELS);
+            memset(cache.samples.data() + offset, 0, expected * SCRUB_CHANNELS * sizeof(qint16));
+        }
+        delete frame;
+        cache.offsets << cache.samples.count() / SCRUB_CHANNELS;
+    }
+    return cache;
+}
+}
+
+AudioScrubber::AudioScrubber(QObject *parent) :
+    QObject(parent)
+    , m_profile(NULL)
+    , m_fps(25)
+    , m_revision(0)
+    , m_pendingPosition(-1)
+    , m_lastPosition(0)
+    , m_output(NULL)
+    , m_device(NULL)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(SCRUB_GRAIN);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(slotFlush()));
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(slotDecodeFinished()));
+}
+
+AudioScrubber::~AudioScrubber()
+{
+    // Stop the running decode before the profile goes away
+    m_revision.ref();
+    m_watcher.waitForFinished();
+#ifdef QT5_USE_MULTIMEDIA
+    if (m_output) m_output->stop();
+#endif
+}
+
+//static
+bool AudioScrubber::isAvailable()
+{
+#ifdef QT5_USE_MULTIMEDIA
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool AudioScrubber::needsSource() const
+{
+    return m_xml.isEmpty();
+}
+
+void AudioScrubber::setSource(Mlt::Profile *profile, const QString &xml)
+{
+    m_profile = profile;
+    m_fps = profile->fps();
+    m_xml = xml;
+    m_revision.ref();
+    m_cache = ScrubCache();
+    m_pendingPosition = -1;
+}
+
+void AudioScrubber::invalidate()
+{
+    m_xml.clear();
+    m_revision.ref();
+    m_cache = ScrubCache();
+    m_pendingPosition = -1;
+}
+
+void AudioScrubber::prepare(int position)
+{
+    if (m_xml.isEmpty() || !m_profile) return;
+    if (m_cache.revision == m_revision.load()) {
+        // Decode again only once the position gets close to the cache edges
+        const int margin = KdenliveSettings::scrubaudiocache() * m_fps / 2;
+        const int end = m_cache.start + m_cache.frames();
+        if ((m_cache.start == 0 || position - margin >= m_cache.start) && (m_cache.atEnd || position + margin < end)) {
+            return;
+        }
+    }
+    if (m_watcher.isRunning()) {
+        m_pendingPosition = position;
+        return;
+    }
+    startDecode(position);
+}
+
+void AudioScrubber::startDecode(int position)
+{
+    const int span = KdenliveSettings::scrubaudiocache() * m_fps;
+    ScrubRequest request;
+    request.profile = m_profile;
+    request.xml = m_xml;
+    request.fps = m_fps;
+    request.start = qMax(0, position - span);
+    request.count = position + span - request.start;
+    request.revision = m_revision.load();
+    m_watcher.setFuture(QtConcurrent::run(decodeAudio, request, &m_revision));
+}
+
+void AudioScrubber::slotDecodeFinished()
+{
+    const ScrubCache cache = m_watcher.result();
+    if (cache.revision == m_revision.load()) {
+        m_cache = cache;
+    }
+    if (m_pendingPosition >= 0) {
+        const int position = m_pendingPosition;
+        m_pendingPosition = -1;
+        prepare(position);
+    }
+}
+
+bool AudioScrubber::scrub(int position)
+{
+    qint64 elapsed = -1;
+    if (m_scrubTime.isValid()) {
+        elapsed = m_scrubTime.restart();
+    } else {
+        m_scrubTime.start();
+    }
+    const int diff = position - m_lastPosition;
+    m_lastPosition = position;
+    const int index = position - m_cache.start;
+    if (m_cache.revision != m_revision.load() || index < 0 || index >= m_cache.frames()) {
+        return false;
+    }
+    if (!openOutput()) {
+        return false;
+    }
+    // Play at the speed the cursor moves, in its direction
+    double speed;
+    if (elapsed <= 0 || elapsed > SCRUB_IDLE_DELAY || diff == 0) {
+        speed = diff < 0 ? -1 : 1;
+    } else {
+        speed = diff * 1000.0 / (elapsed * m_fps);
+    }
+    speed = qBound(-SCRUB_MAX_SPEED, speed, SCRUB_MAX_SPEED);
+    if (qAbs(speed) < SCRUB_MIN_SPEED) {
+        speed = speed < 0 ? -SCRUB_MIN_SPEED : SCRUB_MIN_SPEED;
+    }
+
+    // Resample the grain from the cache, with extra samples for the crossfade with the next one
+    const int length = SCRUB_FREQUENCY * SCRUB_GRAIN / 1000;
+    const int available = m_cache.offsets.last();
+    const double origin = m_cache.offsets.at(index);
+    const qint16 *samples = m_cache.samples.constData();
+    QVector <qint16> grain((length + SCRUB_FADE) * SCRUB_CHANNELS);
+    for (int i = 0; i < length + SCRUB_FADE; ++i) {
+        const double pos = origin + i * speed;
+        const int sample = (int) floor(pos);
+        qint16 *out = grain.data() + i * SCRUB_CHANNELS;
+        if (sample < 0 || sample + 1 >= available) {
+            // Past the cache edges the grain is silent
+            for (int c = 0; c < SCRUB_CHANNELS; ++c) out[c] = 0;
+            continue;
+        }
+        const double frac = pos - sample;
+        const qint16 *a = samples + sample * SCRUB_CHANNELS;
+        const qint16 *b = a + SCRUB_CHANNELS;
+        for (int c = 0; c < SCRUB_CHANNELS; ++c) {
+            out[c] = a[c] + (b[c] - a[c]) * frac;
+        }
+    }
+    // Crossfade with the end of the previous grain
+    for (int i = 0; i < SCRUB_FADE; ++i) {
+        const double fade = (double) i / SCRUB_FADE;
+        for (int c = 0; c < SCRUB_CHANNELS; ++c) {
+            const int ix = i * SCRUB_CHANNELS + c;
+            const double previous = m_tail.isEmpty() ? 0 : m_tail.at(ix);
+            grain[ix] = previous * (1 - fade) + grain.at(ix) * fade;
+        }
+    }
+    m_tail = grain.mid(length * SCRUB_CHANNELS);
+    grain.resize(length * SCRUB_CHANNELS);
+    writeSamples(grain);
+    m_flushTimer.start();
+    return true;
+}
+
+void AudioScrubber::slotFlush()
+{
+    // No scrub step followed the last grain, fade its end out
+    for (int i = 0; i < SCRUB_FADE && i * SCRUB_CHANNELS < m_tail.count(); ++i) {
+        const double fade = 1 - (double) i / SCRUB_FADE;
+        for (int c = 0; c < SCRUB_CHANNELS; ++c) {
+            m_tail[i * SCRUB_CHANNELS + c] *= fade;
+        }
+    }
+    writeSamples(m_tail);
+    m_tail.clear();
+}
+
+bool AudioScrubber::openOutput()
+{
+#ifdef QT5_USE_MULTIMEDIA
+    if (m_output) {
+        return m_device != NULL;
+    }
+    QAudioFormat format;
+    format.setSampleRate(SCRUB_FREQUENCY);
+    format.setChannelCount(SCRUB_CHANNELS);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder((QAudioFormat::Endian) QSysInfo::ByteOrder);
+    format.setCodec(QStringLiteral("audio/pcm"));
+    QAudioDeviceInfo info = QAudioDeviceInfo::defaultOutputDevice();
+    m_output = new QAudioOutput(info, format, this);
+    if (!info.isFormatSupported(format)) {
+        return false;
+    }
+    // A few grains only, a longer buffer would delay the scrub audio
+    m_output->setBufferSize(4 * SCRUB_FREQUENCY * SCRUB_GRAIN / 1000 * SCRUB_CHANNELS * sizeof(qint16));
+    m_output->setVolume(KdenliveSettings::volume() / 100.0);
+    m_device = m_output->start();
+    return m_device != NULL;
+#else
+    return false;
+#endif
+}
+
+void AudioScrubber::writeSamples(const QVector <qint16> &samples)
+{
+#ifdef QT5_USE_MULTIMEDIA
+    if (!m_device || samples.isEmpty()) return;
+    const int bytes = samples.count() * sizeof(qint16);
+    if (m_output->bytesFree() < bytes) {
+        // The output is late, drop this grain rather than adding latency
+        return;
+    }
+    m_device->write((const char *) samples.constData(), bytes);
+#else
+    Q_UNUSED(samples)
+#endif
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef AUDIOSCRUBBER_H
+#define AUDIOSCRUBBER_H
+
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QFutureWatcher>
+
+class QAudioOutput;
+class QIODevice;
+
+namespace Mlt
+{
+class Profile;
+}
+
+/** @brief Decoded audio of consecutive frames, sample accurate. */
+struct ScrubCache
+{
+    int start;
+    int revision;
+    /** @brief True if the cache reaches the end of the producer */
+    bool atEnd;
+    /** @brief Offset of each frame, in samples per channel, with one extra entry for the end */
+    QVector <int> offsets;
+    /** @brief Interleaved samples of the frames */
+    QVector <qint16> samples;
+    ScrubCache() : start(0), revision(-1), atEnd(false) {}
+    int frames() const { return qMax(0, offsets.count() - 1); }
+};
+
+/**
+ * @class AudioScrubber
+ * @brief Plays the audio heard while scrubbing a monitor from a decoded cache of the mixed producer.
+ *
+ * The audio around the settled position is decoded in a background thread from a copy of the
+ * monitor's producer. Each scrub step then plays a short grain read from the cache at the scrub
+ * speed and direction, crossfaded with the previous grain, without asking the consumer to decode.
+ * Audio output requires Qt Multimedia, see isAvailable().
+ */
+class AudioScrubber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioScrubber(QObject *parent = 0);
+    ~AudioScrubber();
+    /** @brief True if the build can output the scrub audio. */
+    static bool isAvailable();
+    /** @brief True if the cache content is obsolete and setSource() must be called before prepare(). */
+    bool needsSource() const;
+    /** @brief Sets the MLT xml of the producer that is decoded, and the profile to use for it. */
+    void setSource(Mlt::Profile *profile, const QString &xml);
+    /** @brief The producer changed, drops the cache. */
+    void invalidate();
+    /** @brief Decodes the audio around position in the background, unless it is already cached. */
+    void prepare(int position);
+    /** @brief Plays a grain of audio at position.
+     *  @return false if position is not cached, the consumer should then play the scrub audio */
+    bool scrub(int position);
+
+private:
+    Mlt::Profile *m_profile;
+    double m_fps;
+    QString m_xml;
+    /** @brief Incremented each time the source changes, so that obsolete decodes stop early */
+    QAtomicInt m_revision;
+    ScrubCache m_cache;
+    QFutureWatcher <ScrubCache> m_watcher;
+    /** @brief Position to decode once the running decode is finished, -1 if none */
+    int m_pendingPosition;
+    int m_lastPosition;
+    QElapsedTimer m_scrubTime;
+    /** @brief Fades out the last grain if no scrub step follows it */
+    QTimer m_flushTimer;
+    /** @brief End of the last grain, mixed with the start of the next one */
+    QVector <qint16> m_tail;
+    QAudioOutput *m_output;
+    QIODevice *m_device;
+    /** @brief Creates the audio output on first use, returns false if it cannot be opened. */
+    bool openOutput();
+    void startDecode(int position);
+    void writeSamples(const QVector <qint16> &samples);
+
+private slots:
+    void slotDecodeFinished();
+    void slotFlush();
+};
+
+#endif
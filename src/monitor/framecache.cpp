@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "framecache.h"
+#include "kdenlivesettings.h"
+
+FrameCache::FrameCache() :
+    m_size(0)
+    , m_revision(0)
+{
+}
+
+//static
+qint64 FrameCache::frameSize(const SharedFrame &frame)
+{
+    return (qint64) frame.get_image_width() * frame.get_image_height() * 3 / 2;
+}
+
+SharedFrame FrameCache::frame(int position)
+{
+    if (!m_frames.contains(position)) {
+        return SharedFrame();
+    }
+    m_usage.removeOne(position);
+    m_usage.append(position);
+    return m_frames.value(position);
+}
+
+bool FrameCache::contains(int position) const
+{
+    return m_frames.contains(position);
+}
+
+void FrameCache::insert(const SharedFrame &frame, int revision, int position)
+{
+    qint64 budget = (qint64) KdenliveSettings::framecachememory() * 1048576;
+    if (revision != m_revision || budget <= 0 || !frame.is_valid() || frame.get_image_format() != mlt_image_yuv420p) {
+        return;
+    }
+    if (position < 0) {
+        position = frame.get_position();
+    }
+    if (m_frames.contains(position)) {
+        m_size -= frameSize(m_frames.value(position));
+        m_usage.removeOne(position);
+    }
+    m_frames.insert(position, frame);
+    m_usage.append(position);
+    m_size += frameSize(frame);
+    while (m_size > budget && !m_usage.isEmpty()) {
+        int oldest = m_usage.takeFirst();
+        m_size -= frameSize(m_frames.take(oldest));
+    }
+}
+
+void FrameCache::invalidate()
+{
+    m_frames.clear();
+    m_usage.clear();
+    m_size = 0;
+    m_revision++;
+}
+
+int FrameCache::revision() const
+{
+    return m_revision;
+}
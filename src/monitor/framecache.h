@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "scopes/sharedframe.h"
+
+#include <QMap>
+#include <QList>
+
+/**
+ * @class FrameCache
+ * @brief Least recently used cache of the decoded frames displayed by a monitor.
+ *
+ * Frames are keyed by producer revision and position. The revision changes each time
+ * the cache is invalidated, so that frames decoded before a timeline change are never
+ * inserted. The cache is bounded by the framecachememory setting and must only be
+ * used from the GUI thread.
+ */
+class FrameCache
+{
+public:
+    FrameCache();
+
+    /** @brief Returns the cached frame at position, an invalid frame if there is none. */
+    SharedFrame frame(int position);
+    bool contains(int position) const;
+    /** @brief Stores a YUV 4:2:0 frame decoded for revision, ignored if the cache was invalidated since.
+     *  @param position the position of the frame in this monitor, -1 to use the frame position */
+    void insert(const SharedFrame &frame, int revision, int position = -1);
+    /** @brief Removes all frames and starts a new revision. */
+    void invalidate();
+    int revision() const;
+
+private:
+    QMap <int, SharedFrame> m_frames;
+    /** @brief Cached positions, the least recently used first. */
+    QList <int> m_usage;
+    qint64 m_size;
+    int m_revision;
+    static qint64 frameSize(const SharedFrame &frame);
+};
+
+#endif
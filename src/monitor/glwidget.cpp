@@ -22,16 +22,21 @@
 
 #include <QtWidgets>
 #include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLBuffer>
+#include <QElapsedTimer>
 #include <QUrl>
 #include <QtQml>
 #include <QQuickItem>
 
 #include <mlt++/Mlt.h>
 #include "glwidget.h"
+#include "gpuscopeengine.h"
 #include "core.h"
+#include "monitormanager.h"
 #include "qml/qmlaudiothumb.h"
 #include "kdenlivesettings.h"
 #include "mltcontroller/bincontroller.h"
+#include "utils/tracer.h"
 
 #ifndef GL_UNPACK_ROW_LENGTH
 # ifdef GL_UNPACK_ROW_LENGTH_EXT
@@ -61,6 +66,7 @@ using namespace Mlt;
 GLWidget::GLWidget(int id, QObject *parent)
     : QQuickView((QWindow*) parent)
     , sendFrameForAnalysis(false)
+    , sendYuvFrameForAnalysis(false)
     , m_id(id)
     , m_shader(0)
     , m_glslManager(0)
@@ -86,10 +92,21 @@ GLWidget::GLWidget(int id, QObject *parent)
     , m_shareContext(0)
     , m_audioWaveDisplayed(false)
     , m_fbo(NULL)
+    , m_scopeEngine(NULL)
+    , m_gpuScopes(0)
+    , m_audioCursor(0)
+    , m_previewScale(1)
+    , m_cacheRevision(0)
+    , m_prefetchPosition(-1)
+    , m_paintTime(0)
+    , m_displayedFrames(0)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
 {
     m_texture[0] = m_texture[1] = m_texture[2] = 0;
     qRegisterMetaType<Mlt::Frame>("Mlt::Frame");
     qRegisterMetaType<SharedFrame>("SharedFrame");
+    qRegisterMetaType<ScopeCounts>("ScopeCounts");
 
     qmlRegisterType<QmlAudioThumb>("AudioThumb", 1, 0, "QmlAudioThumb");
     setPersistentOpenGLContext(true);
@@ -111,6 +128,7 @@ GLWidget::GLWidget(int id, QObject *parent)
     }
     connect(this, SIGNAL(sceneGraphInitialized()), SLOT(initializeGL()), Qt::DirectConnection);
     connect(this, SIGNAL(beforeRendering()), SLOT(paintGL()), Qt::DirectConnection);
+    connect(this, SIGNAL(framePrefetched(const SharedFrame&)), this, SLOT(slotFramePrefetched(const SharedFrame&)), Qt::QueuedConnection);
 }
 
 GLWidget::~GLWidget()
@@ -133,6 +151,7 @@ GLWidget::~GLWidget()
     }
     delete m_shareContext;
     delete m_shader;
+    delete m_scopeEngine;
     delete m_monitorProfile;
 }
 
@@ -203,6 +222,8 @@ void GLWidget::initializeGL()
     openglContext()->makeCurrent(this);
     //openglContext()->blockSignals(false);
     connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), this, SIGNAL(frameDisplayed(const SharedFrame&)), Qt::QueuedConnection);
+    connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), this, SLOT(slotAnalyseFrame(const SharedFrame&)), Qt::QueuedConnection);
+    connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), this, SLOT(slotCacheFrame(const SharedFrame&)), Qt::QueuedConnection);
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 5, 0))
     if (KdenliveSettings::gpu_accel() || openglContext()->supportsThreadedOpenGL())
         connect(m_frameRenderer, SIGNAL(textureReady(GLuint,GLuint,GLuint)), SLOT(updateTexture(GLuint,GLuint,GLuint)), Qt::DirectConnection);
@@ -212,7 +233,7 @@ void GLWidget::initializeGL()
     connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), SLOT(onFrameDisplayed(const SharedFrame&)), Qt::QueuedConnection);
 #endif
 
-    connect(m_frameRenderer, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), this, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), Qt::QueuedConnection);
+    connect(m_frameRenderer, &FrameRenderer::audioAvailable, this, &GLWidget::slotAudioAvailable, Qt::QueuedConnection);
     connect(this, &GLWidget::textureUpdated, this, &GLWidget::update, Qt::QueuedConnection);
     m_initSem.release();
     m_isInitialized = true;
@@ -325,21 +346,24 @@ void GLWidget::createShader()
     m_texCoordLocation = m_shader->attributeLocation("texCoord");
 }
 
-static void uploadTextures(QOpenGLContext* context, const SharedFrame& frame, GLuint texture[])
-{
-    int width = frame.get_image_width();
-    int height = frame.get_image_height();
-    const uint8_t* image = frame.get_image();
-    QOpenGLFunctions* f = context->functions();
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
 
-    // Upload each plane of YUV to a texture.
-    if (texture[0])
-        f->glDeleteTextures(3, texture);
-    check_error(f);
-    f->glGenTextures(3, texture);
-    check_error(f);
+#ifndef Q_OS_WIN
+typedef GLsync (*FenceSync_fp) (GLenum condition, GLbitfield flags);
+typedef void (*DeleteSync_fp) (GLsync sync);
+static FenceSync_fp FenceSync = 0;
+static DeleteSync_fp DeleteSync = 0;
+static ClientWaitSync_fp UploadClientWaitSync = 0;
+#endif
 
-    f->glBindTexture  (GL_TEXTURE_2D, texture[0]);
+static void allocateTexture(QOpenGLFunctions* f, GLuint texture, int width, int height)
+{
+    f->glBindTexture  (GL_TEXTURE_2D, texture);
     check_error(f);
     f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     check_error(f);
@@ -350,36 +374,199 @@ static void uploadTextures(QOpenGLContext* context, const SharedFrame& frame, GL
     f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     check_error(f);
     f->glTexImage2D   (GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
-                    GL_LUMINANCE, GL_UNSIGNED_BYTE, image);
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
     check_error(f);
+}
 
-    f->glBindTexture  (GL_TEXTURE_2D, texture[1]);
-    check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+TextureUploader::TextureUploader()
+    : m_current(0)
+    , m_initialized(false)
+    , m_usePbo(false)
+    , m_gl32(0)
+    , m_uploadTime(0)
+{
+    for (int i = 0; i < UPLOAD_BUFFERS; ++i) {
+        m_buffers[i] = NULL;
+        m_fences[i] = NULL;
+    }
+}
+
+TextureUploader::~TextureUploader()
+{
+    // GL objects must be deleted with release() while the context is current
+    for (int i = 0; i < UPLOAD_BUFFERS; ++i) {
+        delete m_buffers[i];
+    }
+}
+
+void TextureUploader::init(QOpenGLContext *context)
+{
+    m_initialized = true;
+    if (context->isOpenGLES()) {
+        // Pixel unpack buffers are only part of OpenGL ES 3
+        return;
+    }
+#ifdef Q_OS_WIN
+    // On Windows, use QOpenGLFunctions_3_2_Core instead of getProcAddress.
+    m_gl32 = context->versionFunctions<QOpenGLFunctions_3_2_Core>();
+    if (m_gl32 && !m_gl32->initializeOpenGLFunctions()) {
+        m_gl32 = 0;
+    }
+    bool hasSync = m_gl32 != 0;
+#else
+    if (!FenceSync && context->hasExtension("GL_ARB_sync")) {
+        FenceSync = (FenceSync_fp) context->getProcAddress("glFenceSync");
+        DeleteSync = (DeleteSync_fp) context->getProcAddress("glDeleteSync");
+        UploadClientWaitSync = (ClientWaitSync_fp) context->getProcAddress("glClientWaitSync");
+    }
+    bool hasSync = FenceSync && DeleteSync && UploadClientWaitSync;
+#endif
+    if (!hasSync) {
+        // Without fences we cannot know when a buffer can be reused
+        return;
+    }
+    for (int i = 0; i < UPLOAD_BUFFERS; ++i) {
+        m_buffers[i] = new QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer);
+        m_buffers[i]->setUsagePattern(QOpenGLBuffer::StreamDraw);
+        if (!m_buffers[i]->create()) {
+            release(context);
+            return;
+        }
+    }
+    m_usePbo = true;
+}
+
+void TextureUploader::release(QOpenGLContext *context)
+{
+    Q_UNUSED(context)
+    for (int i = 0; i < UPLOAD_BUFFERS; ++i) {
+        if (m_fences[i]) {
+            deleteSync(m_fences[i]);
+            m_fences[i] = NULL;
+        }
+        delete m_buffers[i];
+        m_buffers[i] = NULL;
+    }
+    m_usePbo = false;
+    m_initialized = false;
+    m_textureSizes.clear();
+}
+
+void *TextureUploader::fenceSync()
+{
+#ifdef Q_OS_WIN
+    return m_gl32 ? m_gl32->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : NULL;
+#else
+    return FenceSync ? FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : NULL;
+#endif
+}
+
+void TextureUploader::waitSync(void *sync)
+{
+#ifdef Q_OS_WIN
+    if (m_gl32) m_gl32->glClientWaitSync((GLsync) sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+#else
+    if (UploadClientWaitSync) UploadClientWaitSync((GLsync) sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+#endif
+}
+
+void TextureUploader::deleteSync(void *sync)
+{
+#ifdef Q_OS_WIN
+    if (m_gl32) m_gl32->glDeleteSync((GLsync) sync);
+#else
+    if (DeleteSync) DeleteSync((GLsync) sync);
+#endif
+}
+
+int TextureUploader::uploadTime() const
+{
+    return m_uploadTime.load();
+}
+
+void TextureUploader::upload(QOpenGLContext* context, const SharedFrame& frame, GLuint texture[])
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_initialized) {
+        init(context);
+    }
+    int width = frame.get_image_width();
+    int height = frame.get_image_height();
+    const uint8_t* image = frame.get_image();
+    QOpenGLFunctions* f = context->functions();
+    const QSize size(width, height);
+
+    // Only allocate texture storage when the frame size changes
+    if (!texture[0] || m_textureSizes.value(texture[0]) != size) {
+        if (texture[0]) {
+            m_textureSizes.remove(texture[0]);
+            f->glDeleteTextures(3, texture);
+        }
+        check_error(f);
+        f->glGenTextures(3, texture);
+        check_error(f);
+        allocateTexture(f, texture[0], width, height);
+        allocateTexture(f, texture[1], width / 2, height / 2);
+        allocateTexture(f, texture[2], width / 2, height / 2);
+        m_textureSizes.insert(texture[0], size);
+    }
+
+    const int ySize = width * height;
+    const int uvSize = width / 2 * height / 2;
+    const uint8_t* source = image;
+    QOpenGLBuffer *buffer = NULL;
+    if (m_usePbo) {
+        // Reuse the oldest buffer of the ring once the GPU is done with it
+        m_current = (m_current + 1) % UPLOAD_BUFFERS;
+        if (m_fences[m_current]) {
+            waitSync(m_fences[m_current]);
+            deleteSync(m_fences[m_current]);
+            m_fences[m_current] = NULL;
+        }
+        buffer = m_buffers[m_current];
+        buffer->bind();
+        const int frameSize = ySize + 2 * uvSize;
+        // Orphan the previous storage so that the driver does not need to wait for it
+        buffer->allocate(frameSize);
+        void *mapped = buffer->map(QOpenGLBuffer::WriteOnly);
+        if (mapped) {
+            memcpy(mapped, image, frameSize);
+            buffer->unmap();
+            // Texture data is now read from the bound buffer, at the plane offsets
+            source = NULL;
+        } else {
+            buffer->release();
+            buffer = NULL;
+        }
+    }
+
+    f->glBindTexture  (GL_TEXTURE_2D, texture[0]);
     check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, source);
     check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    f->glBindTexture  (GL_TEXTURE_2D, texture[1]);
     check_error(f);
-    f->glTexImage2D   (GL_TEXTURE_2D, 0, GL_LUMINANCE, width/2, height/2, 0,
-                    GL_LUMINANCE, GL_UNSIGNED_BYTE, image + width * height);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width/2, height/2,
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, source + ySize);
     check_error(f);
 
     f->glBindTexture  (GL_TEXTURE_2D, texture[2]);
     check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    check_error(f);
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    check_error(f);
-    f->glTexImage2D   (GL_TEXTURE_2D, 0, GL_LUMINANCE, width/2, height/2, 0,
-                    GL_LUMINANCE, GL_UNSIGNED_BYTE, image + width * height + width/2 * height/2);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width/2, height/2,
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, source + ySize + uvSize);
     check_error(f);
+
+    if (buffer) {
+        buffer->release();
+        m_fences[m_current] = fenceSync();
+    }
+    // Keep a moving average so that the displayed value is stable
+    int elapsed = timer.nsecsElapsed() / 1000;
+    int previous = m_uploadTime.load();
+    m_uploadTime.store(previous == 0 ? elapsed : (previous * 7 + elapsed) / 8);
 }
 
 void GLWidget::clear()
@@ -395,6 +582,9 @@ void GLWidget::releaseAnalyse()
 
 void GLWidget::paintGL()
 {
+    TRACE_ZONE("gui", "GLWidget::paintGL");
+    QElapsedTimer paintTimer;
+    paintTimer.start();
     QOpenGLFunctions* f = openglContext()->functions();
     int width = this->width() * devicePixelRatio();
     int height = this->height() * devicePixelRatio();
@@ -416,7 +606,7 @@ void GLWidget::paintGL()
             m_mutex.unlock();
             return;
         }
-        uploadTextures(openglContext(), m_sharedFrame, m_texture);
+        m_uploader.upload(openglContext(), m_sharedFrame, m_texture);
         m_mutex.unlock();
     }
 #endif
@@ -487,7 +677,8 @@ void GLWidget::paintGL()
     f->glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
     check_error(f);
 
-    if (sendFrameForAnalysis && m_analyseSem.tryAcquire(1)) {
+    // Movit frames only exist as a texture, so they are rendered to RGB for the scopes too
+    if ((sendFrameForAnalysis || (sendYuvFrameForAnalysis && m_glslManager)) && m_analyseSem.tryAcquire(1)) {
         // Render RGB frame for analysis
         int fullWidth = m_monitorProfile->width();
         int fullHeight = m_monitorProfile->height();
@@ -523,6 +714,25 @@ void GLWidget::paintGL()
     }
     f->glActiveTexture(GL_TEXTURE0);
     check_error(f);
+
+    m_mutex.lock();
+    SharedFrame analyseFrame = m_analyseFrame;
+    m_analyseFrame = SharedFrame();
+    m_mutex.unlock();
+    if (analyseFrame.is_valid()) {
+        // Count the frame pixels for the scopes from the textures we just displayed
+        if (!m_scopeEngine) {
+            m_scopeEngine = new GpuScopeEngine;
+        }
+        ScopeCounts counts;
+        if (m_scopeEngine->init(openglContext())) {
+            counts = m_scopeEngine->analyse(openglContext(), m_texture, analyseFrame.get_image_width(), analyseFrame.get_image_height(),
+                                            m_gpuScopes.load(), analyseFrame.get_int("colorspace") == 709);
+        }
+        emit analyseYuvFrame(analyseFrame, counts);
+    }
+    const int elapsed = paintTimer.nsecsElapsed() / 1000;
+    m_paintTime = m_paintTime == 0 ? elapsed : (m_paintTime * 7 + elapsed) / 8;
 }
 
 void GLWidget::slotZoomScene(double value)
@@ -726,6 +936,7 @@ int GLWidget::setProducer(Mlt::Producer* producer)
 {
     int error = 0;//Controller::setProducer(producer, isMulti);
     m_producer = producer;
+    invalidateFrameCache();
     if (m_producer) {
         error = reconfigure();
         if (!error) {
@@ -769,6 +980,144 @@ void GLWidget::resetDrops()
     if (m_consumer) m_consumer->set("drop_count", 0);
 }
 
+void GLWidget::setPreviewScale(int scale)
+{
+    if (!m_consumer || scale < 1 || scale == m_previewScale) return;
+    m_previewScale = scale;
+    // The consumer requests images at its own size, the display scales them to the monitor rect
+    int width = m_monitorProfile->width() / scale;
+    int height = m_monitorProfile->height() / scale;
+    m_consumer->set("width", width - width % 2);
+    m_consumer->set("height", height - height % 2);
+}
+
+int GLWidget::previewScale() const
+{
+    return m_previewScale;
+}
+
+bool GLWidget::showCachedFrame(int position)
+{
+    // Movit frames only exist as textures, they cannot be cached
+    if (m_glslManager || !m_frameRenderer) {
+        return false;
+    }
+    SharedFrame frame = m_frameCache.frame(position);
+    if (!frame.is_valid()) {
+        // The other monitor may have decoded the same source frame
+        frame = pCore->monitorManager()->sharedFrame((Kdenlive::MonitorId) m_id, position);
+        if (!frame.is_valid() || frame.get_image_width() != m_monitorProfile->width() || frame.get_image_height() != m_monitorProfile->height()) {
+            m_cacheMisses++;
+            return false;
+        }
+        m_frameCache.insert(frame, m_frameCache.revision(), position);
+    }
+    m_cacheHits++;
+    if (!m_frameRenderer->semaphore()->tryAcquire(1, 0)) {
+        // The renderer is still busy with another frame
+        return false;
+    }
+    Mlt::Frame displayFrame = frame.clone(false, true);
+    mlt_frame_set_position(displayFrame.get_frame(), position);
+    displayFrame.set("kdenlive:cache_revision", m_cacheRevision.load());
+    QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, displayFrame));
+    return true;
+}
+
+bool GLWidget::showExternalFrame(const SharedFrame &frame)
+{
+    if (m_glslManager || !m_frameRenderer || !frame.is_valid() || frame.get_image_format() != mlt_image_yuv420p) {
+        return false;
+    }
+    if (!m_frameRenderer->semaphore()->tryAcquire(1, 0)) {
+        return false;
+    }
+    // The renderer keeps its own copy of the planes, the capture device can reuse its frame
+    Mlt::Frame displayFrame = frame.clone(false, true);
+    QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, displayFrame));
+    return true;
+}
+
+SharedFrame GLWidget::cachedFrame(int position)
+{
+    return m_frameCache.frame(position);
+}
+
+int GLWidget::frameCacheRevision() const
+{
+    return m_frameCache.revision();
+}
+
+bool GLWidget::isFrameCached(int position) const
+{
+    return m_frameCache.contains(position);
+}
+
+void GLWidget::setPrefetchPosition(int position)
+{
+    m_prefetchPosition.store(position);
+}
+
+void GLWidget::invalidateFrameCache()
+{
+    m_frameCache.invalidate();
+    m_cacheRevision.store(m_frameCache.revision());
+}
+
+void GLWidget::slotCacheFrame(const SharedFrame &frame)
+{
+    // Frames scaled down by the adaptive preview are not kept
+    if (!m_glslManager && !m_frameCache.contains(frame.get_position()) && frame.get_image_width() == m_monitorProfile->width() && frame.get_image_height() == m_monitorProfile->height()) {
+        m_frameCache.insert(frame, frame.get_int("kdenlive:cache_revision"));
+    }
+}
+
+void GLWidget::slotFramePrefetched(const SharedFrame &frame)
+{
+    slotCacheFrame(frame);
+    emit frameCached(frame.get_position());
+}
+
+int GLWidget::renderTime() const
+{
+    return m_frameRenderer ? m_frameRenderer->renderTime() : 0;
+}
+
+int GLWidget::paintTime() const
+{
+    return m_paintTime;
+}
+
+int GLWidget::displayedFrames() const
+{
+    return m_displayedFrames;
+}
+
+int GLWidget::cacheHits() const
+{
+    return m_cacheHits;
+}
+
+int GLWidget::cacheMisses() const
+{
+    return m_cacheMisses;
+}
+
+void GLWidget::resetPerformanceStats()
+{
+    m_displayedFrames = 0;
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+}
+
+int GLWidget::uploadTime() const
+{
+    if (m_frameRenderer && m_frameRenderer->context()) {
+        return m_frameRenderer->uploadTime();
+    }
+    return m_uploader.uploadTime();
+}
+
 void GLWidget::createAudioOverlay(bool isAudio)
 {
     if (!m_consumer) return;
@@ -951,6 +1300,7 @@ int GLWidget::reconfigure(Mlt::Profile *profile)
             setProperty("mlt_service", serviceName);
         }
         m_consumer = new Mlt::FilteredConsumer(*m_monitorProfile, serviceName.toLatin1().constData());
+        m_previewScale = 1;
         delete m_threadStartEvent;
         m_threadStartEvent = 0;
         delete m_threadStopEvent;
@@ -1113,9 +1463,42 @@ void GLWidget::onFrameDisplayed(const SharedFrame &frame)
     m_mutex.lock();
     m_sharedFrame = frame;
     m_mutex.unlock();
+    m_displayedFrames++;
     update();
 }
 
+void GLWidget::slotAudioAvailable()
+{
+    if (!m_frameRenderer->readAudio(&m_audioCursor, &m_audioBlock)) {
+        return;
+    }
+    // Data format: [ c00 c10 c01 c11 c02 c12 c03 c13 ... ], one shared vector for all audio scopes
+    audioShortVector sampleVector(m_audioBlock.samples * m_audioBlock.channels);
+    memcpy(sampleVector.data(), m_audioBlock.data, sampleVector.size() * sizeof(qint16));
+    emit audioSamplesSignal(sampleVector, m_audioBlock.freq, m_audioBlock.channels, m_audioBlock.samples);
+}
+
+void GLWidget::slotAnalyseFrame(const SharedFrame &frame)
+{
+    // The scopes read the YUV planes of the displayed frame, no conversion or copy is needed
+    if (sendYuvFrameForAnalysis && frame.get_image_format() == mlt_image_yuv420p && m_analyseSem.tryAcquire(1)) {
+        if (m_gpuScopes.load() != 0) {
+            // Counts are computed from the textures on the next paint
+            m_mutex.lock();
+            m_analyseFrame = frame;
+            m_mutex.unlock();
+            update();
+        } else {
+            emit analyseYuvFrame(frame, ScopeCounts());
+        }
+    }
+}
+
+void GLWidget::setGpuScopes(int kinds)
+{
+    m_gpuScopes.store(kinds);
+}
+
 void GLWidget::mouseReleaseEvent(QMouseEvent * event)
 {
     QQuickView::mouseReleaseEvent(event);
@@ -1164,6 +1547,10 @@ void GLWidget::setOffsetY(int y)
 int GLWidget::realTime() const
 {
     if (m_glslManager) return 1;
+    if (KdenliveSettings::parallelplayback()) {
+        // Each consumer thread fetches and composites all tracks of its frame
+        return qMax(KdenliveSettings::mltthreads(), QThread::idealThreadCount());
+    }
     return KdenliveSettings::mltthreads();
 }
 
@@ -1192,6 +1579,17 @@ void GLWidget::on_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
     Mlt::Frame frame(frame_ptr);
     if (frame.get_int("rendered")) {
         GLWidget* widget = static_cast<GLWidget*>(self);
+        frame.set("kdenlive:cache_revision", widget->m_cacheRevision.load());
+        if (frame.get_position() == widget->m_prefetchPosition.load()) {
+            // Frame rendered ahead of the cursor, only keep it in the cache
+            widget->m_prefetchPosition.store(-1);
+            int width = 0;
+            int height = 0;
+            mlt_image_format format = mlt_image_yuv420p;
+            frame.get_image(format, width, height);
+            emit widget->framePrefetched(SharedFrame(frame));
+            return;
+        }
         int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
         if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
@@ -1259,6 +1657,9 @@ void RenderThread::run()
 FrameRenderer::FrameRenderer(QOpenGLContext* shareContext, QSurface *surface)
      : QThread(0)
      , m_semaphore(3)
+     , m_audioRing(8)
+     , m_audioNotified(0)
+     , m_renderTime(0)
      , m_context(0)
      , m_surface(surface)
      , m_gl32(0)
@@ -1289,10 +1690,14 @@ FrameRenderer::~FrameRenderer()
 
 void FrameRenderer::showFrame(Mlt::Frame frame)
 {
+    TRACE_ZONE("renderer", "FrameRenderer::showFrame");
     int width = 0;
     int height = 0;
     mlt_image_format format = mlt_image_yuv420p;
+    QElapsedTimer timer;
+    timer.start();
     frame.get_image(format, width, height);
+    updateRenderTime(timer.nsecsElapsed());
     // Save this frame for future use and to keep a reference to the GL Texture.
     m_displayFrame = SharedFrame(frame);
 
@@ -1300,9 +1705,10 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
         m_context->makeCurrent(m_surface);
         // Upload each plane of YUV to a texture.
         QOpenGLFunctions* f = m_context->functions();
-        uploadTextures(m_context, m_displayFrame, m_renderTexture);
+        m_uploader.upload(m_context, m_displayFrame, m_renderTexture);
         f->glBindTexture(GL_TEXTURE_2D, 0);
         check_error(f);
+        // The display thread uses the textures from another context, make sure the copy is complete
         f->glFinish();
 
         for (int i = 0; i < 3; ++i)
@@ -1310,21 +1716,67 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
         emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
         m_context->doneCurrent();
     }
+    if (sendAudioForAnalysis) {
+        pushAudio(frame);
+    }
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
     m_semaphore.release();
 }
 
+void FrameRenderer::updateRenderTime(qint64 elapsed)
+{
+    // Keep a moving average so that the displayed value is stable
+    const int micro = elapsed / 1000;
+    const int previous = m_renderTime.load();
+    m_renderTime.store(previous == 0 ? micro : (previous * 7 + micro) / 8);
+}
+
+void FrameRenderer::pushAudio(Mlt::Frame &frame)
+{
+    if (!frame.is_valid() || frame.get_int("test_audio") != 0) {
+        return;
+    }
+    mlt_audio_format audio_format = mlt_audio_s16;
+    //FIXME: should not be hardcoded..
+    int freq = 48000;
+    int num_channels = 2;
+    int samples = 0;
+    qint16* data = (qint16*)frame.get_audio(audio_format, freq, num_channels, samples);
+    if (!data || samples <= 0 || num_channels <= 0) {
+        return;
+    }
+    m_audioBlock.freq = freq;
+    m_audioBlock.channels = num_channels;
+    m_audioBlock.samples = qMin(samples, (int) AudioSampleBlock::MaxValues / num_channels);
+    memcpy(m_audioBlock.data, data, m_audioBlock.samples * num_channels * sizeof(qint16));
+    m_audioRing.push(m_audioBlock);
+    // Only one notification waits in the event loop, the reader always takes the newest block
+    if (m_audioNotified.testAndSetOrdered(0, 1)) {
+        emit audioAvailable();
+    }
+}
+
+bool FrameRenderer::readAudio(int *cursor, AudioSampleBlock *block)
+{
+    m_audioNotified.storeRelease(0);
+    return m_audioRing.readLatest(cursor, block);
+}
+
 void FrameRenderer::showGLFrame(Mlt::Frame frame)
 {
+    TRACE_ZONE("renderer", "FrameRenderer::showGLFrame");
     if (m_context && m_context->isValid()) {
         int width = 0;
         int height = 0;
 
         frame.set("movit.convert.use_texture", 1);
         mlt_image_format format = mlt_image_glsl_texture;
+        QElapsedTimer timer;
+        timer.start();
         const GLuint* textureId = (GLuint*) frame.get_image(format, width, height);
+        updateRenderTime(timer.nsecsElapsed());
         m_context->makeCurrent(m_surface);
         GLsync sync = (GLsync) frame.get_data("movit.convert.fence");
         if (sync) {
@@ -1354,6 +1806,9 @@ void FrameRenderer::showGLFrame(Mlt::Frame frame)
         m_frame = SharedFrame(frame);
         qSwap(m_frame, m_displayFrame);
     }
+    if (sendAudioForAnalysis) {
+        pushAudio(frame);
+    }
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
@@ -1362,13 +1817,17 @@ void FrameRenderer::showGLFrame(Mlt::Frame frame)
 
 void FrameRenderer::showGLNoSyncFrame(Mlt::Frame frame)
 {
+    TRACE_ZONE("renderer", "FrameRenderer::showGLNoSyncFrame");
     if (m_context && m_context->isValid()) {
         int width = 0;
         int height = 0;
 
         frame.set("movit.convert.use_texture", 1);
         mlt_image_format format = mlt_image_glsl_texture;
+        QElapsedTimer timer;
+        timer.start();
         const GLuint* textureId = (GLuint*) frame.get_image(format, width, height);
+        updateRenderTime(timer.nsecsElapsed());
         m_context->makeCurrent(m_surface);
         m_context->functions()->glFinish();
 
@@ -1380,6 +1839,9 @@ void FrameRenderer::showGLNoSyncFrame(Mlt::Frame frame)
         qSwap(m_frame, m_displayFrame);
     }
 
+    if (sendAudioForAnalysis) {
+        pushAudio(frame);
+    }
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
@@ -1396,6 +1858,7 @@ void FrameRenderer::cleanup()
 {
     if (m_renderTexture[0] && m_renderTexture[1] && m_renderTexture[2]) {
         m_context->makeCurrent(m_surface);
+        m_uploader.release(m_context);
         m_context->functions()->glDeleteTextures(3, m_renderTexture);
         if (m_displayTexture[0] && m_displayTexture[1] && m_displayTexture[2])
             m_context->functions()->glDeleteTextures(3, m_displayTexture);
@@ -1405,49 +1868,13 @@ void FrameRenderer::cleanup()
     }
 }
 
-void GLWidget::setAudioThumb(int channels, QVariantList audioCache)
+void GLWidget::setAudioThumb(const AudioLevels &audioLevels)
 {
     if (rootObject()) {
         QmlAudioThumb *audioThumbDisplay = rootObject()->findChild<QmlAudioThumb *>("audiothumb");
         if (audioThumbDisplay) {
-            QImage img(width(), height() / 6, QImage::Format_ARGB32_Premultiplied);
-            img.fill(Qt::transparent);
-            if (!audioCache.isEmpty() && channels > 0) {
-                int audioLevelCount = audioCache.count() - 1;
-                // simplified audio
-                QPainter painter(&img);
-                QRectF mappedRect(0, 0, img.width(), img.height());
-                int channelHeight = mappedRect.height();
-                double value;
-                double scale = (double) width() / (audioLevelCount / channels);
-                if (scale < 1) {
-                    painter.setPen(QColor(80, 80, 150, 200));
-                    for (int i = 0; i < img.width(); i++) {
-                        int framePos = i / scale;
-                        value = audioCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
-                        for (int channel = 1; channel < channels; channel ++) {
-                            value = qMax(value, audioCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
-                        }
-                        painter.drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
-                    }
-                } else {
-                    QPainterPath positiveChannelPath;
-                    positiveChannelPath.moveTo(0, mappedRect.bottom());
-                    for (int i = 0; i < audioLevelCount / channels; i++) {
-                        value = audioCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
-                        for (int channel = 1; channel < channels; channel ++) {
-                            value = qMax(value, audioCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
-                        }
-                        positiveChannelPath.lineTo(i * scale, mappedRect.bottom() - (value * channelHeight));
-                    }
-                    positiveChannelPath.lineTo(mappedRect.right(), mappedRect.bottom());
-                    painter.setPen(Qt::NoPen);
-                    painter.setBrush(QBrush(QColor(80, 80, 150, 200)));
-                    painter.drawPath(positiveChannelPath);
-                }
-                painter.end();
-            }
-            audioThumbDisplay->setImage(img);
+            // The item builds its own geometry from the shared levels, nothing is painted here
+            audioThumbDisplay->setAudioLevels(audioLevels);
         }
     }
 }
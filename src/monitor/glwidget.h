@@ -29,8 +29,15 @@
 #include <QMutex>
 #include <QThread>
 #include <QRect>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSize>
 
 #include "scopes/sharedframe.h"
+#include "framecache.h"
+#include "scopes/dataring.h"
+#include "scopes/colorscopes/scopecounts.h"
+#include "bin/audiolevels.h"
 #include "definitions.h"
 
 class QOpenGLFunctions_3_2_Core;
@@ -43,6 +50,48 @@ class Filter;
 
 class RenderThread;
 class FrameRenderer;
+class GpuScopeEngine;
+class QOpenGLBuffer;
+
+/** @brief Number of pixel buffer objects used to stream frames to textures */
+#define UPLOAD_BUFFERS 3
+
+/**
+ * @class TextureUploader
+ * @brief Uploads the Y, U and V planes of frames to textures through a ring of pixel buffer objects.
+ *
+ * Texture storage is only allocated when the frame size changes, each frame is then copied with glTexSubImage2D.
+ * A fence protects each buffer of the ring so that it is only reused once the GPU finished reading it.
+ * Falls back to direct uploads if the context cannot map buffers.
+ */
+class TextureUploader
+{
+public:
+    TextureUploader();
+    ~TextureUploader();
+    /** @brief Upload a yuv420p frame, creating the 3 textures if needed. The context must be current. */
+    void upload(QOpenGLContext *context, const SharedFrame &frame, GLuint texture[]);
+    /** @brief Delete the buffers and fences, the context must be current. */
+    void release(QOpenGLContext *context);
+    /** @brief Average duration of the recent uploads, in microseconds. */
+    int uploadTime() const;
+
+private:
+    QOpenGLBuffer *m_buffers[UPLOAD_BUFFERS];
+    /** @brief The GLsync objects of the buffers, stored untyped since GLsync is not available in every GL header */
+    void *m_fences[UPLOAD_BUFFERS];
+    int m_current;
+    bool m_initialized;
+    bool m_usePbo;
+    QOpenGLFunctions_3_2_Core *m_gl32;
+    /** @brief Size of the storage allocated for each Y texture */
+    QHash <GLuint, QSize> m_textureSizes;
+    QAtomicInt m_uploadTime;
+    void init(QOpenGLContext *context);
+    void *fenceSync();
+    void waitSync(void *sync);
+    void deleteSync(void *sync);
+};
 
 
 typedef void* ( *thread_function_t )( void* );
@@ -85,6 +134,10 @@ public:
     QRect displayRect() const;
     /** @brief set to true if we want to emit a QImage of the frame for analysis */
     bool sendFrameForAnalysis;
+    /** @brief set to true if we want to emit the displayed YUV frame for the scopes */
+    bool sendYuvFrameForAnalysis;
+    /** @brief Sets the ScopeCounts::Kind OR-ed flags to compute on the GPU for the scopes, 0 to let them analyse the frame. */
+    void setGpuScopes(int kinds);
     void updateGamma();
     Mlt::Profile *profile();
     void resetProfile(MltVideoProfile profile);
@@ -92,9 +145,37 @@ public:
     void lockMonitor();
     void releaseMonitor();
     int realTime() const;
-    void setAudioThumb(int channels = 0, QVariantList audioCache = QList<QVariant>());
+    void setAudioThumb(const AudioLevels &audioLevels = AudioLevels());
     int droppedFrames() const;
     void resetDrops();
+    /** @brief Average time spent uploading a frame to the GPU, in microseconds. */
+    int uploadTime() const;
+    /** @brief Process frames at 1/scale of the profile resolution, 1 for full resolution. */
+    void setPreviewScale(int scale);
+    int previewScale() const;
+    /** @brief Displays the decoded frame at position from the frame cache, returns false if it is not cached. */
+    bool showCachedFrame(int position);
+    /** @brief Displays a yuv420p frame that does not come from the monitor consumer, like a live capture preview.
+     *  Returns false and drops the frame if the renderer is still busy, so the producer never waits on the display. */
+    bool showExternalFrame(const SharedFrame &frame);
+    bool isFrameCached(int position) const;
+    /** @brief Returns the cached frame at position, an invalid frame if it is not cached. */
+    SharedFrame cachedFrame(int position);
+    int frameCacheRevision() const;
+    /** @brief The next frame rendered at position is only stored in the frame cache, -1 to display all frames. */
+    void setPrefetchPosition(int position);
+    /** @brief Drops the cached frames, to call when the producer changes. */
+    void invalidateFrameCache();
+    /** @brief Average time spent getting the image of a displayed frame from MLT, in microseconds. */
+    int renderTime() const;
+    /** @brief Average time spent drawing the monitor, in microseconds. */
+    int paintTime() const;
+    /** @brief Number of frames displayed since the last resetPerformanceStats() call. */
+    int displayedFrames() const;
+    /** @brief Frame cache lookups since the last resetPerformanceStats() call. */
+    int cacheHits() const;
+    int cacheMisses() const;
+    void resetPerformanceStats();
 
 protected:
     void mouseReleaseEvent(QMouseEvent * event);
@@ -112,6 +193,10 @@ public slots:
 
 signals:
     void frameDisplayed(const SharedFrame& frame);
+    /** @brief A frame requested with setPrefetchPosition was stored in the frame cache. */
+    void frameCached(int position);
+    /** @brief Emitted from the consumer thread with a frame rendered ahead of the cursor. */
+    void framePrefetched(const SharedFrame &frame);
     void textureUpdated();
     void dragStarted();
     void seekTo(int x);
@@ -127,6 +212,9 @@ signals:
     void mouseSeek(int eventDelta, int modifiers);
     void startDrag();
     void analyseFrame(QImage);
+    /** @brief The displayed frame, shared with the scopes without conversion.
+     *  @param counts the scope counts computed on the GPU, empty if none was requested */
+    void analyseYuvFrame(const SharedFrame &frame, const ScopeCounts &counts);
     void audioSamplesSignal(const audioShortVector&,int,int,int);
     void showContextMenu(const QPoint);
     void lockMonitor(bool);
@@ -162,6 +250,8 @@ private:
     bool m_openGLSync;
     SharedFrame m_sharedFrame;
     QMutex m_mutex;
+    /** @brief Uploads frames when the GUI thread's context is used for rendering */
+    TextureUploader m_uploader;
     QPoint m_offset;
     QOffscreenSurface m_offscreenSurface;
     QOpenGLContext* m_shareContext;
@@ -173,6 +263,22 @@ private:
     void removeAudioOverlay();
     void adjustAudioOverlay(bool isAudio);
     QOpenGLFramebufferObject *m_fbo;
+    GpuScopeEngine *m_scopeEngine;
+    QAtomicInt m_gpuScopes;
+    /** @brief Frame waiting for its scope counts to be computed in paintGL, protected by m_mutex */
+    SharedFrame m_analyseFrame;
+    /** @brief Position of the GUI thread in the frame renderer audio ring */
+    int m_audioCursor;
+    AudioSampleBlock m_audioBlock;
+    int m_previewScale;
+    FrameCache m_frameCache;
+    /** @brief Revision of the frame cache, read from the consumer thread */
+    QAtomicInt m_cacheRevision;
+    QAtomicInt m_prefetchPosition;
+    int m_paintTime;
+    int m_displayedFrames;
+    int m_cacheHits;
+    int m_cacheMisses;
     void refreshSceneLayout();
 
 private slots:
@@ -180,6 +286,12 @@ private slots:
     void updateTexture(GLuint yName, GLuint uName, GLuint vName);
     void paintGL();
     void onFrameDisplayed(const SharedFrame &frame);
+    /** @brief Keeps a displayed frame in the frame cache. */
+    void slotCacheFrame(const SharedFrame &frame);
+    void slotFramePrefetched(const SharedFrame &frame);
+    void slotAnalyseFrame(const SharedFrame &frame);
+    /** @brief Reads the newest audio block of the frame renderer and sends it to the scopes. */
+    void slotAudioAvailable();
 
 protected:
     void resizeEvent(QResizeEvent* event);
@@ -206,6 +318,17 @@ private:
     QSurface* m_surface;
 };
 
+/** @brief One frame of interleaved 16 bit audio, as stored in the FrameRenderer ring. */
+struct AudioSampleBlock
+{
+    /** @brief 8 channels of a 23.976 fps frame at 48kHz fit */
+    enum { MaxValues = 16384 };
+    int freq;
+    int channels;
+    int samples;
+    qint16 data[MaxValues];
+};
+
 class FrameRenderer : public QThread
 {
     Q_OBJECT
@@ -215,9 +338,15 @@ public:
     QSemaphore* semaphore() { return &m_semaphore; }
     QOpenGLContext* context() const { return m_context; }
     void clearFrame();
+    /** @brief Average time spent uploading a frame to the GPU, in microseconds. */
+    int uploadTime() const { return m_uploader.uploadTime(); }
+    /** @brief Average time spent waiting for the image of a frame, in microseconds. */
+    int renderTime() const { return m_renderTime.load(); }
     Q_INVOKABLE void showFrame(Mlt::Frame frame);
     Q_INVOKABLE void showGLFrame(Mlt::Frame frame);
     Q_INVOKABLE void showGLNoSyncFrame(Mlt::Frame frame);
+    /** @brief Copies the newest audio block not read through this cursor, returns false if there is none. */
+    bool readAudio(int *cursor, AudioSampleBlock *block);
 
 public slots:
     void cleanup();
@@ -225,14 +354,25 @@ public slots:
 signals:
     void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0);
     void frameDisplayed(const SharedFrame& frame);
-    void audioSamplesSignal(const audioShortVector&,int,int,int);
+    /** @brief New samples are in the ring; not emitted again until readAudio() was called. */
+    void audioAvailable();
 
 private:
     QSemaphore m_semaphore;
+    /** @brief Audio of the last displayed frames, read by the GUI thread at its own pace */
+    DataRing<AudioSampleBlock> m_audioRing;
+    AudioSampleBlock m_audioBlock;
+    /** @brief Set while an audioAvailable notification is waiting to be processed */
+    QAtomicInt m_audioNotified;
+    void pushAudio(Mlt::Frame &frame);
+    QAtomicInt m_renderTime;
+    /** @brief Adds the duration of a get_image call to the average render time. */
+    void updateRenderTime(qint64 elapsed);
     SharedFrame m_frame;
     SharedFrame m_displayFrame;
     QOpenGLContext* m_context;
     QSurface* m_surface;
+    TextureUploader m_uploader;
 
 public:
     GLuint m_renderTexture[3];
@@ -0,0 +1,282 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "gpuscopeengine.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QVector2D>
+#include <QDebug>
+
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_R32F
+#define GL_R32F 0x822E
+#endif
+
+// Number of frame rows drawn per call, the index buffer holds one index per pixel of these rows
+#define INDEX_ROWS 64
+
+enum TargetSlot { WaveformTarget = 0, ParadeTarget, HistogramTarget };
+
+static const char *vertexShader =
+    "#version 130\n"
+    "in float index;\n"
+    "uniform sampler2D Ytex;\n"
+    "uniform sampler2D Utex;\n"
+    "uniform sampler2D Vtex;\n"
+    "uniform int frameWidth;\n"
+    "uniform int firstRow;\n"
+    "uniform int channel;\n"
+    "uniform int histogram;\n"
+    "uniform int rec709;\n"
+    "uniform float rowBase;\n"
+    "uniform vec2 target;\n"
+    "void main() {\n"
+    "    int i = int(index);\n"
+    "    ivec2 pos = ivec2(i % frameWidth, firstRow + i / frameWidth);\n"
+    "    float luma = texelFetch(Ytex, pos, 0).r * 255.0 - 16.0;\n"
+    "    float value;\n"
+    "    if (channel == 0) {\n"
+    "        value = luma * 255.0 / 219.0;\n"
+    "    } else {\n"
+    "        float cb = texelFetch(Utex, pos / 2, 0).r * 255.0 - 128.0;\n"
+    "        float cr = texelFetch(Vtex, pos / 2, 0).r * 255.0 - 128.0;\n"
+    "        float c = luma * 1.164;\n"
+    "        vec3 rgb = rec709 == 1\n"
+    "            ? vec3(c + 1.793 * cr, c - 0.213 * cb - 0.533 * cr, c + 2.112 * cb)\n"
+    "            : vec3(c + 1.596 * cr, c - 0.391 * cb - 0.813 * cr, c + 2.018 * cb);\n"
+    "        value = rgb[channel - 1];\n"
+    "    }\n"
+    "    float level = clamp(floor(value + 0.5), 0.0, 255.0);\n"
+    "    vec2 bin = histogram == 1\n"
+    "        ? vec2(level, rowBase)\n"
+    "        : vec2(floor(float(pos.x) * target.x / float(frameWidth)), rowBase + level);\n"
+    "    gl_Position = vec4((bin + 0.5) / target * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShader =
+    "#version 130\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragColor = vec4(1.0);\n"
+    "}\n";
+
+GpuScopeEngine::GpuScopeEngine()
+    : m_initialized(false)
+    , m_valid(false)
+    , m_program(NULL)
+    , m_indexBuffer(NULL)
+    , m_indexWidth(0)
+{
+    for (int i = 0; i < 3; ++i) {
+        m_targets[i] = NULL;
+    }
+}
+
+GpuScopeEngine::~GpuScopeEngine()
+{
+    for (int i = 0; i < 3; ++i) {
+        delete m_targets[i];
+    }
+    delete m_indexBuffer;
+    delete m_program;
+}
+
+bool GpuScopeEngine::init(QOpenGLContext *context)
+{
+    if (m_initialized) {
+        return m_valid;
+    }
+    m_initialized = true;
+    if (context->isOpenGLES() || context->format().majorVersion() < 3) {
+        qDebug() << "GPU scopes need desktop OpenGL 3.0, using the CPU scopes";
+        return false;
+    }
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader);
+    m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader);
+    m_program->bindAttributeLocation("index", 0);
+    if (!m_program->link()) {
+        qDebug() << "GPU scopes shader failed to link: " << m_program->log();
+        delete m_program;
+        m_program = NULL;
+        return false;
+    }
+    m_indexBuffer = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    m_indexBuffer->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    if (!m_indexBuffer->create()) {
+        delete m_indexBuffer;
+        m_indexBuffer = NULL;
+        return false;
+    }
+    m_valid = true;
+    return true;
+}
+
+QOpenGLFramebufferObject *GpuScopeEngine::target(int slot, int width, int height)
+{
+    QOpenGLFramebufferObject *fbo = m_targets[slot];
+    if (!fbo || fbo->size() != QSize(width, height)) {
+        delete fbo;
+        QOpenGLFramebufferObjectFormat fmt;
+        fmt.setInternalTextureFormat(GL_R32F);
+        fbo = new QOpenGLFramebufferObject(width, height, fmt);
+        m_targets[slot] = fbo;
+    }
+    return fbo;
+}
+
+void GpuScopeEngine::draw(QOpenGLFunctions *f, int width, int height, const QSize &target, int channel, bool histogram, int rowBase)
+{
+    m_program->setUniformValue("channel", channel);
+    m_program->setUniformValue("histogram", histogram ? 1 : 0);
+    m_program->setUniformValue("rowBase", (GLfloat) rowBase);
+    m_program->setUniformValue("target", QVector2D(target.width(), target.height()));
+    for (int row = 0; row < height; row += INDEX_ROWS) {
+        m_program->setUniformValue("firstRow", row);
+        f->glDrawArrays(GL_POINTS, 0, width * qMin(INDEX_ROWS, height - row));
+    }
+}
+
+void GpuScopeEngine::readCounts(QOpenGLFunctions *f, const QSize &target, QVector<uint> &counts)
+{
+    const int size = target.width() * target.height();
+    m_readback.resize(size);
+    f->glReadPixels(0, 0, target.width(), target.height(), GL_RED, GL_FLOAT, m_readback.data());
+    counts.resize(size);
+    const float *values = m_readback.constData();
+    uint *result = counts.data();
+    for (int i = 0; i < size; ++i) {
+        // Float counts are exact up to 2^24 samples per bin
+        result[i] = (uint) (values[i] + 0.5f);
+    }
+}
+
+ScopeCounts GpuScopeEngine::analyse(QOpenGLContext *context, const GLuint texture[], int width, int height, int kinds, bool rec709)
+{
+    ScopeCounts counts;
+    if (!m_valid || width < 2 || height < 2 || kinds == 0) {
+        return counts;
+    }
+    QOpenGLFunctions *f = context->functions();
+    GLint viewport[4];
+    f->glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (m_indexWidth != width) {
+        // Rebuild the index buffer for the new frame width
+        QVector<GLfloat> indexes(width * INDEX_ROWS);
+        for (int i = 0; i < indexes.size(); ++i) {
+            indexes[i] = i;
+        }
+        m_indexBuffer->bind();
+        m_indexBuffer->allocate(indexes.constData(), indexes.size() * sizeof(GLfloat));
+        m_indexBuffer->release();
+        m_indexWidth = width;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        f->glActiveTexture(GL_TEXTURE0 + i);
+        f->glBindTexture(GL_TEXTURE_2D, texture[i]);
+    }
+    f->glActiveTexture(GL_TEXTURE0);
+    m_program->bind();
+    m_program->setUniformValue("Ytex", 0);
+    m_program->setUniformValue("Utex", 1);
+    m_program->setUniformValue("Vtex", 2);
+    m_program->setUniformValue("frameWidth", width);
+    m_program->setUniformValue("rec709", rec709 ? 1 : 0);
+    m_indexBuffer->bind();
+    m_program->enableAttributeArray(0);
+    m_program->setAttributeBuffer(0, GL_FLOAT, 0, 1);
+
+    f->glDisable(GL_DEPTH_TEST);
+    f->glDisable(GL_SCISSOR_TEST);
+    f->glEnable(GL_BLEND);
+    f->glBlendEquation(GL_FUNC_ADD);
+    f->glBlendFunc(GL_ONE, GL_ONE);
+    f->glClearColor(0, 0, 0, 0);
+
+    const int columns = qMin(width, MAX_SCOPE_COLUMNS);
+    struct Pass {
+        ScopeCounts::Kind kind;
+        TargetSlot slot;
+        QSize size;
+        QVector<uint> *counts;
+    } passes[] = {
+        { ScopeCounts::Waveform, WaveformTarget, QSize(columns, SCOPE_LEVELS), &counts.waveform },
+        { ScopeCounts::Parade, ParadeTarget, QSize(columns, 3 * SCOPE_LEVELS), &counts.parade },
+        { ScopeCounts::Histogram, HistogramTarget, QSize(SCOPE_LEVELS, 4), &counts.histogram }
+    };
+    bool failed = false;
+    for (uint i = 0; i < sizeof(passes) / sizeof(Pass) && !failed; ++i) {
+        const Pass &pass = passes[i];
+        if ((kinds & pass.kind) == 0) {
+            continue;
+        }
+        QOpenGLFramebufferObject *fbo = target(pass.slot, pass.size.width(), pass.size.height());
+        if (!fbo->isValid() || !fbo->bind()) {
+            // Float render targets are not supported, disable the engine
+            failed = true;
+            break;
+        }
+        f->glViewport(0, 0, pass.size.width(), pass.size.height());
+        f->glClear(GL_COLOR_BUFFER_BIT);
+        switch (pass.kind) {
+        case ScopeCounts::Waveform:
+            draw(f, width, height, pass.size, 0, false, 0);
+            break;
+        case ScopeCounts::Parade:
+            for (int c = 1; c <= 3; ++c) {
+                draw(f, width, height, pass.size, c, false, (c - 1) * SCOPE_LEVELS);
+            }
+            break;
+        default:
+            for (int c = 0; c <= 3; ++c) {
+                draw(f, width, height, pass.size, c, true, c);
+            }
+            break;
+        }
+        readCounts(f, pass.size, *pass.counts);
+        fbo->release();
+    }
+
+    m_program->disableAttributeArray(0);
+    m_indexBuffer->release();
+    m_program->release();
+    f->glDisable(GL_BLEND);
+    for (int i = 2; i >= 0; --i) {
+        f->glActiveTexture(GL_TEXTURE0 + i);
+        f->glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    QOpenGLFramebufferObject::bindDefault();
+    f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (failed) {
+        qDebug() << "GPU scopes cannot render to float targets, using the CPU scopes";
+        m_valid = false;
+        return ScopeCounts();
+    }
+    counts.columns = columns;
+    counts.pixelCount = width * height;
+    return counts;
+}
@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef GPUSCOPEENGINE_H
+#define GPUSCOPEENGINE_H
+
+#include "scopes/colorscopes/scopecounts.h"
+
+#include <QOpenGLFunctions>
+
+class QOpenGLBuffer;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+class QOpenGLShaderProgram;
+
+/**
+ * @class GpuScopeEngine
+ * @brief Accumulates the colour scope counts of the monitor textures on the GPU.
+ *
+ * Every pixel of the Y, U and V textures is drawn as a point at its (column, level) bin
+ * of a float render target with additive blending, so the target holds the counts.
+ * The counts are then read back into a ScopeCounts for the scopes to paint.
+ * Needs desktop OpenGL 3.0 for texelFetch and float render targets.
+ */
+class GpuScopeEngine
+{
+public:
+    GpuScopeEngine();
+    ~GpuScopeEngine();
+
+    /** @brief Sets up the shader and returns true if the context can run the engine.
+     *  Must be called with the context current. */
+    bool init(QOpenGLContext *context);
+
+    /** @brief Counts the pixels of a YUV 4:2:0 frame held in @param texture.
+     *  @param kinds OR-ed ScopeCounts::Kind to compute
+     *  @param rec709 true if the frame uses the Rec. 709 matrix
+     *  Must be called with the context current, the bound framebuffer and viewport are restored. */
+    ScopeCounts analyse(QOpenGLContext *context, const GLuint texture[], int width, int height, int kinds, bool rec709);
+
+private:
+    bool m_initialized;
+    bool m_valid;
+    QOpenGLShaderProgram *m_program;
+    QOpenGLBuffer *m_indexBuffer;
+    int m_indexWidth;
+    QOpenGLFramebufferObject *m_targets[3];
+    QVector<float> m_readback;
+
+    /** @brief Returns a render target of the given size for target @param slot, reusing the previous one if possible. */
+    QOpenGLFramebufferObject *target(int slot, int width, int height);
+    /** @brief Draws every frame pixel once into the bound target.
+     *  @param channel 0 for luma, 1 to 3 for red, green and blue
+     *  @param histogram true to bin by level only, otherwise by (column, level)
+     *  @param rowBase first row of the target that receives this channel */
+    void draw(QOpenGLFunctions *f, int width, int height, const QSize &target, int channel, bool histogram, int rowBase);
+    /** @brief Reads the counts of the bound target into @param counts */
+    void readCounts(QOpenGLFunctions *f, const QSize &target, QVector<uint> &counts);
+};
+
+#endif // GPUSCOPEENGINE_H
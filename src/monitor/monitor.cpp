@@ -36,8 +36,11 @@
 #include "timeline/transitionhandler.h"
 #include "core.h"
 #include "bin/bin.h"
+#include "bin/projectclip.h"
+#include "doc/thumbnailcache.h"
 #include "project/projectmanager.h"
 #include "doc/kdenlivedoc.h"
+#include "timeline/timeline.h"
 #include "mainwindow.h"
 
 #include "klocalizedstring.h"
@@ -64,6 +67,12 @@
 #include <QWidgetAction>
 
 #define SEEK_INACTIVE (-1)
+// Proportion of the frames of one second that can be dropped before lowering the preview resolution
+#define ADAPTIVE_DROP_RATIO 0.1
+// Lowest preview resolution used by adaptive scaling, as a divider of the profile size
+#define ADAPTIVE_MAX_SCALE 4
+// Refresh interval of the performance overlay, in ms
+#define PERFORMANCE_HUD_INTERVAL 1000
 
 
 
@@ -148,6 +157,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     , m_editMarker(NULL)
     , m_forceSizeFactor(0)
     , m_lastMonitorSceneType(MonitorSceneDefault)
+    , m_lastDropCount(0)
 {
     QVBoxLayout *layout = new QVBoxLayout;
     layout->setContentsMargins(0, 0, 0, 0);
@@ -170,6 +180,8 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     m_qmlManager = new QmlManager(m_glMonitor);
     connect(m_qmlManager, &QmlManager::effectChanged, this, &Monitor::effectChanged);
     connect(m_qmlManager, &QmlManager::effectPointsChanged, this, &Monitor::effectPointsChanged);
+    m_performanceTimer.setInterval(PERFORMANCE_HUD_INTERVAL);
+    connect(&m_performanceTimer, &QTimer::timeout, this, &Monitor::slotUpdatePerformanceHud);
 
     QuickMonitorEventEater *monitorEventEater = new QuickMonitorEventEater(this);
     m_glWidget->installEventFilter(monitorEventEater);
@@ -299,6 +311,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     connect(render, SIGNAL(rendererStopped(int)), this, SLOT(rendererStopped(int)));
     connect(render, &AbstractRender::scopesClear, m_glMonitor, &GLWidget::releaseAnalyse, Qt::DirectConnection);
     connect(m_glMonitor, SIGNAL(analyseFrame(QImage)), render, SIGNAL(frameUpdated(QImage)));
+    connect(m_glMonitor, SIGNAL(analyseYuvFrame(SharedFrame,ScopeCounts)), render, SIGNAL(yuvFrameUpdated(SharedFrame,ScopeCounts)));
     connect(m_glMonitor, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), render, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)));
 
     if (id != Kdenlive::ClipMonitor) {
@@ -572,10 +585,38 @@ void Monitor::updateMarkers()
         }
 	m_ruler->setMarkers(markers);
         m_markerMenu->setEnabled(!m_markerMenu->isEmpty());
+        requestMarkerThumbs(markers);
         checkOverlay();
     }
 }
 
+void Monitor::requestMarkerThumbs(const QList <CommentedTime> &markers)
+{
+    disconnect(m_markerThumbConnection);
+    if (m_id != Kdenlive::ClipMonitor || markers.isEmpty() || !m_controller) return;
+    ProjectClip *clip = pCore->bin()->getBinClip(m_controller->clipId());
+    if (!clip) return;
+    // Menu entries show no icon until their thumbnail is ready
+    QList <int> frames;
+    for (int i = 0; i < markers.count(); ++i) {
+        frames << (int) markers.at(i).time().frames(m_monitorManager->timecode().fps());
+    }
+    m_markerThumbConnection = connect(clip, &ProjectClip::thumbReady, this, &Monitor::slotMarkerThumbReady);
+    // All frames are extracted in ascending order by the clip's thumbnail thread, cached ones are returned directly
+    clip->slotExtractImage(frames);
+}
+
+void Monitor::slotMarkerThumbReady(int pos, const QImage &img)
+{
+    if (img.isNull()) return;
+    QList <QAction *> actions = m_markerMenu->actions();
+    for (int i = 0; i < actions.count(); ++i) {
+        if (actions.at(i)->data().toInt() == pos) {
+            actions.at(i)->setIcon(QIcon(QPixmap::fromImage(img)));
+        }
+    }
+}
+
 void Monitor::setGuides(QMap <double, QString> guides)
 {
     m_markerMenu->clear();
@@ -1176,6 +1217,13 @@ void Monitor::slotForwardOneFrame(int diff)
     m_ruler->update();
 }
 
+void Monitor::slotJog(int diff, bool fast)
+{
+    slotActivateMonitor();
+    render->jogSeek(diff, fast);
+    m_ruler->update();
+}
+
 void Monitor::seekCursor(int pos)
 {
     if (m_ruler->slotNewValue(pos)) {
@@ -1364,6 +1412,16 @@ void Monitor::slotOpenClip(ClipController *controller, int in, int out)
     checkOverlay();
 }
 
+SharedFrame Monitor::cachedFrame(int position)
+{
+    return m_glMonitor->cachedFrame(position);
+}
+
+int Monitor::frameCacheRevision() const
+{
+    return m_glMonitor->frameCacheRevision();
+}
+
 const QString Monitor::activeClipId()
 {
     if (m_controller) {
@@ -1391,6 +1449,7 @@ void Monitor::setCustomProfile(const QString &profile, const Timecode &tc)
     slotActivateMonitor();
     render->prepareProfileReset(tc.fps());
     if (m_multitrackView) m_multitrackView->setChecked(false);
+    render->setGridPreview(false);
     m_glMonitor->resetProfile(ProfilesDialog::getVideoProfile(profile));
 }
 
@@ -1610,7 +1669,12 @@ void Monitor::slotSetVolume(int volume)
 
 void Monitor::sendFrameForAnalysis(bool analyse)
 {
-    m_glMonitor->sendFrameForAnalysis = analyse;
+    m_glMonitor->sendYuvFrameForAnalysis = analyse;
+}
+
+void Monitor::setGpuScopes(int kinds)
+{
+    m_glMonitor->setGpuScopes(kinds);
 }
 
 void Monitor::updateAudioForAnalysis()
@@ -1637,12 +1701,19 @@ void Monitor::checkDrops(int dropped)
         if (m_droppedTimer.hasExpired(1000)) {
             m_droppedTimer.invalidate();
             double fps = m_monitorManager->timecode().fps();
+            // Average texture upload time, in microseconds
+            int uploadTime = m_glMonitor->uploadTime();
+            m_qmlManager->setProperty(QStringLiteral("uploadtime"), uploadTime > 0 ? QString::number(uploadTime / 1000.0, 'f', 1) : QString());
             if (dropped == 0) {
                 // No dropped frames since last check
                 m_qmlManager->setProperty(QStringLiteral("dropped"), false);
                 m_qmlManager->setProperty(QStringLiteral("fps"), QString::number(fps, 'g', 2));
             } else {
                 m_glMonitor->resetDrops();
+                if (m_id == Kdenlive::ProjectMonitor && KdenliveSettings::adaptivepreview() && dropped > fps * ADAPTIVE_DROP_RATIO && m_glMonitor->previewScale() < ADAPTIVE_MAX_SCALE && render->isPlaying()) {
+                    // Playback cannot keep up with the frame rate, process smaller frames until next pause
+                    m_glMonitor->setPreviewScale(m_glMonitor->previewScale() * 2);
+                }
                 fps -= dropped;
                 m_qmlManager->setProperty(QStringLiteral("dropped"), true);
                 m_qmlManager->setProperty(QStringLiteral("fps"), QString::number(fps, 'g', 2));
@@ -1671,11 +1742,8 @@ void Monitor::reloadProducer(const QString &id)
 QString Monitor::getMarkerThumb(GenTime pos)
 {
     if (!m_controller) return QString();
-    if (!m_controller->getClipHash().isEmpty()) {
-	QString url = m_monitorManager->getCacheFolder(CacheThumbs).absoluteFilePath(m_controller->getClipHash() + '#' + QString::number((int) pos.frames(m_monitorManager->timecode().fps())) + ".png");
-        if (QFile::exists(url)) return url;
-    }
-    return QString();
+    // Marker thumbnails are extracted by requestMarkerThumbs() into the shared cache, at the bin thumbnail height
+    return pCore->thumbnailCache()->diskPath(m_controller->getClipHash(), (int) pos.frames(m_monitorManager->timecode().fps()), 150);
 }
 
 const QString Monitor::projectFolder() const
@@ -2004,9 +2072,9 @@ void Monitor::slotEditInlineMarker()
     }
 }
 
-void Monitor::prepareAudioThumb(int channels, QVariantList &audioCache)
+void Monitor::prepareAudioThumb(const AudioLevels &audioLevels)
 {
-    m_glMonitor->setAudioThumb(channels, audioCache);
+    m_glMonitor->setAudioThumb(audioLevels);
 }
 
 void Monitor::slotUpdateQmlTimecode(const QString &tc)
@@ -2058,6 +2126,68 @@ void Monitor::updateQmlDisplay(int currentOverlay)
     }
     m_glMonitor->rootObject()->setProperty("showSafezone", currentOverlay & 0x08);
     m_glMonitor->rootObject()->setProperty("showAudiothumb", currentOverlay & 0x10);
+    bool showPerformance = currentOverlay & 0x40;
+    m_glMonitor->rootObject()->setProperty("showPerformance", showPerformance);
+    if (!showPerformance) {
+        m_performanceTimer.stop();
+    } else if (!m_performanceTimer.isActive()) {
+        m_glMonitor->resetPerformanceStats();
+        m_lastDropCount = m_glMonitor->droppedFrames();
+        m_performanceClock.start();
+        m_performanceTimer.start();
+    }
+}
+
+void Monitor::slotUpdatePerformanceHud()
+{
+    if (!m_glMonitor->rootObject() || !m_performanceClock.isValid()) return;
+    const qint64 elapsed = m_performanceClock.restart();
+    if (elapsed <= 0) return;
+    const double targetFps = m_monitorManager->timecode().fps();
+    const double fps = m_glMonitor->displayedFrames() * 1000.0 / elapsed;
+    // checkDrops resets the consumer counter while the fps overlay is shown
+    const int drops = m_glMonitor->droppedFrames();
+    const int newDrops = drops >= m_lastDropCount ? drops - m_lastDropCount : drops;
+    m_lastDropCount = drops;
+    const int hits = m_glMonitor->cacheHits();
+    const int lookups = hits + m_glMonitor->cacheMisses();
+    m_glMonitor->resetPerformanceStats();
+
+    QStringList lines;
+    lines << i18n("Playback: %1 / %2 fps", QString::number(fps, 'f', 1), QString::number(targetFps, 'f', 2));
+    lines << i18n("Dropped frames: %1", newDrops);
+    lines << i18n("Render: %1 ms, upload: %2 ms, display: %3 ms", QString::number(m_glMonitor->renderTime() / 1000.0, 'f', 1),
+                  QString::number(m_glMonitor->uploadTime() / 1000.0, 'f', 1), QString::number(m_glMonitor->paintTime() / 1000.0, 'f', 1));
+    lines << (lookups > 0 ? i18n("Frame cache hits: %1%", hits * 100 / lookups) : i18n("Frame cache hits: -"));
+    KdenliveDoc *doc = pCore->projectManager()->current();
+    if (m_id == Kdenlive::ClipMonitor) {
+        if (m_controller) {
+            const QString proxy = m_controller->property(QStringLiteral("kdenlive:proxy"));
+            lines << (!proxy.isEmpty() && proxy != QLatin1String("-") ? i18n("Source: proxy clip") : i18n("Source: original clip"));
+        }
+    } else {
+        Timeline *timeline = pCore->projectManager()->currentTimeline();
+        Timeline::PreviewChunkState state = timeline ? timeline->previewChunkState(render->seekFramePosition()) : Timeline::NoPreviewChunk;
+        switch (state) {
+            case Timeline::RenderedPreviewChunk:
+                lines << i18n("Source: timeline preview");
+                break;
+            case Timeline::DraftPreviewChunk:
+                lines << i18n("Source: timeline preview draft");
+                break;
+            case Timeline::PendingPreviewChunk:
+                lines << i18n("Source: timeline, preview pending");
+                break;
+            default:
+                lines << i18n("Source: timeline");
+                break;
+        }
+        if (doc) {
+            lines << (doc->useProxy() ? i18n("Proxy clips: enabled") : i18n("Proxy clips: disabled"));
+        }
+    }
+    m_qmlManager->setProperty(QStringLiteral("performance"), lines);
+    m_qmlManager->setProperty(QStringLiteral("performanceWarning"), render->isPlaying() && (newDrops > 0 || fps < targetFps * 0.9));
 }
 
 void Monitor::clearDisplay()
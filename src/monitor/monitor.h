@@ -27,6 +27,7 @@
 #include "timecodedisplay.h"
 #include "scopes/sharedframe.h"
 #include "effectslist/effectslist.h"
+#include "bin/audiolevels.h"
 
 #include <QLabel>
 #include <QDomElement>
@@ -35,6 +36,7 @@
 #include <QIcon>
 #include <QProcess>
 #include <QElapsedTimer>
+#include <QTimer>
 
 class SmallRuler;
 class ClipController;
@@ -94,6 +96,9 @@ public:
     void setupMenu(QMenu *goMenu, QMenu *overlayMenu, QAction *playZone, QAction *loopZone, QMenu *markerMenu = NULL, QAction *loopClip = NULL);
     const QString sceneList();
     const QString activeClipId();
+    /** @brief Returns the decoded frame at position if it is in the monitor's frame cache. */
+    SharedFrame cachedFrame(int position);
+    int frameCacheRevision() const;
     GenTime position();
     /** @brief Check current position to show relevant infos in qml view (markers, zone in/out, etc). */
     void checkOverlay(int pos = -1);
@@ -132,6 +137,8 @@ public:
     QVariantList effectRoto() const;
     void setEffectKeyframe(bool enable);
     void sendFrameForAnalysis(bool analyse);
+    /** @brief Sets the scope counts (ScopeCounts::Kind flags) to compute on the GPU. */
+    void setGpuScopes(int kinds);
     void updateAudioForAnalysis();
     void switchMonitorInfo(int code);
     void switchDropFrames(bool drop);
@@ -144,7 +151,7 @@ public:
     QAction *recAction();
     void refreshIcons();
     /** @brief Send audio thumb data to qml for on monitor display */
-    void prepareAudioThumb(int channels, QVariantList &audioCache);
+    void prepareAudioThumb(const AudioLevels &audioLevels);
     void refreshMonitorIfActive();
     void connectAudioSpectrum(bool activate);
     /** @brief Set a property on the Qml scene **/
@@ -210,6 +217,10 @@ private:
     QMenu *m_configMenu;
     QMenu *m_playMenu;
     QMenu *m_markerMenu;
+    /** @brief Connection to the clip extracting the marker thumbnails. */
+    QMetaObject::Connection m_markerThumbConnection;
+    /** @brief Ask the bin clip to extract the thumbnails of all markers in one batch. */
+    void requestMarkerThumbs(const QList <CommentedTime> &markers);
     QPoint m_DragStartPosition;
     /** Selected clip/transition in timeline. Used for looping it. */
     AbstractClipItem *m_selectedClip;
@@ -227,6 +238,10 @@ private:
     MonitorAudioLevel *m_audioMeterWidget;
     QElapsedTimer m_droppedTimer;
     double m_displayedFps;
+    /** @brief Refreshes the performance overlay while it is shown */
+    QTimer m_performanceTimer;
+    QElapsedTimer m_performanceClock;
+    int m_lastDropCount;
     void adjustScrollBars(float horizontal, float vertical);
     void loadQmlScene(MonitorSceneType type);
     void updateQmlDisplay(int currentOverlay);
@@ -247,6 +262,8 @@ private slots:
     void slotSeek();
     void setClipZone(const QPoint &pos);
     void slotGoToMarker(QAction *action);
+    /** @brief A thumbnail was extracted, show it in the marker menu if it belongs to a marker. */
+    void slotMarkerThumbReady(int pos, const QImage &img);
     void slotSetVolume(int volume);
     void slotEditMarker();
     void slotExtractCurrentZone();
@@ -270,6 +287,8 @@ private slots:
     void slotUpdateQmlTimecode(const QString &tc);
     /** @brief There was an error initializing Movit */
     void gpuError();
+    /** @brief Display the playback statistics of the last interval in the performance overlay */
+    void slotUpdatePerformanceHud();
 
 public slots:
     void slotOpenDvdFile(const QString &);
@@ -292,6 +311,8 @@ public slots:
     void slotRewind(double speed = 0);
     void slotRewindOneFrame(int diff = 1);
     void slotForwardOneFrame(int diff = 1);
+    /** @brief Seek diff frames for a burst of jog wheel events, see Render::jogSeek. */
+    void slotJog(int diff, bool fast);
     void saveSceneList(const QString &path, const QDomElement &info = QDomElement());
     void slotStart();
     void slotEnd();
@@ -26,6 +26,8 @@
 #include "doc/kdenlivedoc.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/bincontroller.h"
+#include "project/projectmanager.h"
+#include "timeline/timeline.h"
 
 #include <mlt++/Mlt.h>
 
@@ -41,7 +43,8 @@ MonitorManager::MonitorManager(QObject *parent) :
         m_document(NULL),
         m_clipMonitor(NULL),
         m_projectMonitor(NULL),
-        m_activeMonitor(NULL)
+        m_activeMonitor(NULL),
+        m_zonesRevision(-1)
 {
     setupActions();
 }
@@ -225,6 +228,12 @@ void MonitorManager::slotForwardOneFrame()
     else if (m_activeMonitor == m_projectMonitor) m_projectMonitor->slotForwardOneFrame();
 }
 
+void MonitorManager::slotJog(int diff, bool fast)
+{
+    if (m_activeMonitor == m_clipMonitor) m_clipMonitor->slotJog(diff, fast);
+    else if (m_activeMonitor == m_projectMonitor) m_projectMonitor->slotJog(diff, fast);
+}
+
 void MonitorManager::slotRewindOneSecond()
 {
     if (m_activeMonitor == m_clipMonitor) m_clipMonitor->slotRewindOneFrame(m_timecode.fps());
@@ -531,3 +540,36 @@ QDir MonitorManager::getCacheFolder(CacheType type)
         return m_document->getCacheDir(type, &ok);
     return QDir();
 }
+
+SharedFrame MonitorManager::sharedFrame(Kdenlive::MonitorId id, int position)
+{
+    if (!m_clipMonitor || !m_projectMonitor || !KdenliveSettings::sharemonitorframes()) {
+        return SharedFrame();
+    }
+    const QString clipId = m_clipMonitor->activeClipId();
+    Timeline *timeline = pCore->projectManager()->currentTimeline();
+    if (clipId.isEmpty() || !timeline) {
+        return SharedFrame();
+    }
+    // The project monitor cache revision changes with every timeline refresh
+    int revision = m_projectMonitor->frameCacheRevision();
+    if (revision != m_zonesRevision) {
+        m_sharedZones = timeline->passthroughZones(true);
+        m_zonesRevision = revision;
+    }
+    foreach(const PassthroughZone &zone, m_sharedZones) {
+        if (zone.clipId != clipId) {
+            continue;
+        }
+        if (id == Kdenlive::ProjectMonitor && position >= zone.start && position < zone.end) {
+            return m_clipMonitor->cachedFrame(zone.sourceIn + position - zone.start);
+        }
+        if (id == Kdenlive::ClipMonitor && position >= zone.sourceIn && position < zone.sourceIn + zone.end - zone.start) {
+            SharedFrame frame = m_projectMonitor->cachedFrame(zone.start + position - zone.sourceIn);
+            if (frame.is_valid()) {
+                return frame;
+            }
+        }
+    }
+    return SharedFrame();
+}
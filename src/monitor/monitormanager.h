@@ -70,6 +70,9 @@ public:
     void refreshIcons();
     void resetDisplay();
     QDir getCacheFolder(CacheType type);
+    /** @brief Returns the frame decoded by the other monitor if it shows the same source frame than monitor id at position.
+     *  Only unmodified timeline clips are matched, an invalid frame is returned otherwise. */
+    SharedFrame sharedFrame(Kdenlive::MonitorId id, int position);
 
 public slots:
 
@@ -85,6 +88,8 @@ public slots:
     void slotForward(double speed = 0);
     void slotRewindOneFrame();
     void slotForwardOneFrame();
+    /** @brief Seek the active monitor diff frames for a burst of jog wheel events. */
+    void slotJog(int diff, bool fast);
     void slotRewindOneSecond();
     void slotForwardOneSecond();
     void slotStart();
@@ -124,6 +129,9 @@ private:
     AbstractMonitor *m_activeMonitor;
     QList <AbstractMonitor *>m_monitorsList;
     KDualAction *m_muteAction;
+    /** @brief Timeline zones showing an unmodified clip, for the project monitor frame cache revision m_zonesRevision */
+    QList <PassthroughZone> m_sharedZones;
+    int m_zonesRevision;
 
 signals:
     /** @brief When the monitor changed, update the visible color scopes */
@@ -30,7 +30,13 @@ QmlManager::QmlManager(QQuickView *view) :
     QObject(view)
     , m_view(view)
     , m_sceneType(MonitorSceneNone)
+    , m_rectPending(false)
+    , m_polygonPending(false)
+    , m_rotoPending(false)
+    , m_frameReady(true)
 {
+    // Dragging an item only repaints the overlay, the effect is composited at most once per displayed frame
+    connect(m_view, SIGNAL(frameSwapped()), this, SLOT(slotFrameSwapped()), Qt::QueuedConnection);
 }
 
 
@@ -60,6 +66,11 @@ void QmlManager::setScene(Kdenlive::MonitorId id, MonitorSceneType type, QSize p
         return;
     }
     m_sceneType = type;
+    // Changes of the previous scene are only meaningful to the previous effect
+    m_rectPending = false;
+    m_polygonPending = false;
+    m_rotoPending = false;
+    m_frameReady = true;
     QQuickItem *root;
     switch (type) {
         case MonitorSceneGeometry:
@@ -77,6 +88,7 @@ void QmlManager::setScene(Kdenlive::MonitorId id, MonitorSceneType type, QSize p
             m_view->setSource(QUrl(QStringLiteral("qrc:/qml/kdenlivemonitorcornerscene.qml")));
             root = m_view->rootObject();
             QObject::connect(root, SIGNAL(effectPolygonChanged()), this, SLOT(effectPolygonChanged()), Qt::UniqueConnection);
+            QObject::connect(root, SIGNAL(effectEditFinished()), this, SLOT(effectEditFinished()), Qt::UniqueConnection);
             root->setProperty("profile", QPoint(profile.width(), profile.height()));
             root->setProperty("framesize", QRect(0, 0, profile.width(), profile.height()));
             root->setProperty("scalex", (double) displayRect.width() / profile.width() * zoom);
@@ -89,6 +101,7 @@ void QmlManager::setScene(Kdenlive::MonitorId id, MonitorSceneType type, QSize p
             m_view->setSource(QUrl(QStringLiteral("qrc:/qml/kdenlivemonitorrotoscene.qml")));
             root = m_view->rootObject();
             QObject::connect(root, SIGNAL(effectPolygonChanged()), this, SLOT(effectRotoChanged()), Qt::UniqueConnection);
+            QObject::connect(root, SIGNAL(effectEditFinished()), this, SLOT(effectEditFinished()), Qt::UniqueConnection);
             root->setProperty("profile", QPoint(profile.width(), profile.height()));
             root->setProperty("framesize", QRect(0, 0, profile.width(), profile.height()));
             root->setProperty("scalex", (double) displayRect.width() / profile.width() * zoom);
@@ -118,29 +131,64 @@ void QmlManager::setScene(Kdenlive::MonitorId id, MonitorSceneType type, QSize p
 
 void QmlManager::effectRectChanged()
 {
-    if (!m_view->rootObject()) return;
-    const QRect rect = m_view->rootObject()->property("framesize").toRect();
-    emit effectChanged(rect);
+    m_rectPending = true;
+    sendPendingChanges();
 }
 
 void QmlManager::effectPolygonChanged()
 {
-    if (!m_view->rootObject()) return;
-    QVariantList points = m_view->rootObject()->property("centerPoints").toList();
-    emit effectPointsChanged(points);
+    m_polygonPending = true;
+    sendPendingChanges();
 }
 
 void QmlManager::effectRotoChanged()
 {
-    if (!m_view->rootObject()) return;
-    QVariantList points = m_view->rootObject()->property("centerPoints").toList();
-    QVariantList controlPoints = m_view->rootObject()->property("centerPointsTypes").toList();
-    // rotoscoping effect needs a list of 
-    QVariantList mix;
-    for (int i = 0; i < points.count(); i++) {
-        mix << controlPoints.at(2 * i);
-        mix << points.at(i);
-        mix << controlPoints.at(2 * i + 1);
+    m_rotoPending = true;
+    sendPendingChanges();
+}
+
+void QmlManager::slotFrameSwapped()
+{
+    m_frameReady = true;
+    sendPendingChanges();
+}
+
+void QmlManager::effectEditFinished()
+{
+    sendPendingChanges(true);
+}
+
+void QmlManager::sendPendingChanges(bool force)
+{
+    if (!m_rectPending && !m_polygonPending && !m_rotoPending) return;
+    if (!force && !m_frameReady) return;
+    QQuickItem *root = m_view->rootObject();
+    if (!root) {
+        m_rectPending = m_polygonPending = m_rotoPending = false;
+        return;
+    }
+    m_frameReady = false;
+    if (m_rectPending) {
+        m_rectPending = false;
+        const QRect rect = root->property("framesize").toRect();
+        emit effectChanged(rect);
+    }
+    if (m_polygonPending) {
+        m_polygonPending = false;
+        QVariantList points = root->property("centerPoints").toList();
+        emit effectPointsChanged(points);
+    }
+    if (m_rotoPending) {
+        m_rotoPending = false;
+        QVariantList points = root->property("centerPoints").toList();
+        QVariantList controlPoints = root->property("centerPointsTypes").toList();
+        // rotoscoping effect needs a list of 
+        QVariantList mix;
+        for (int i = 0; i < points.count(); i++) {
+            mix << controlPoints.at(2 * i);
+            mix << points.at(i);
+            mix << controlPoints.at(2 * i + 1);
+        }
+        emit effectPointsChanged(mix);
     }
-    emit effectPointsChanged(mix);
 }
@@ -51,11 +51,23 @@ public:
 private:
     QQuickView *m_view;
     MonitorSceneType m_sceneType;
+    /** @brief Changes made while dragging, sent to the effect once the monitor displayed a frame */
+    bool m_rectPending;
+    bool m_polygonPending;
+    bool m_rotoPending;
+    /** @brief False once a change was sent to the effect, until the monitor swapped a frame */
+    bool m_frameReady;
+    /** @brief Send the pending changes if the previous one was displayed, or if force is true */
+    void sendPendingChanges(bool force = false);
 
 private slots:
     void effectRectChanged();
     void effectPolygonChanged();
     void effectRotoChanged();
+    /** @brief The monitor displayed a frame, changes can be sent to the effect again. */
+    void slotFrameSwapped();
+    /** @brief The user released the dragged item, send the last changes right away. */
+    void effectEditFinished();
 
 signals:
     void effectChanged(const QRect);
@@ -38,6 +38,42 @@
 #include <QIcon>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QLabel>
+#include <QRegularExpression>
+#include <QCoreApplication>
+
+// Height in pixels of the low resolution screen grab preview
+#define GRAB_PREVIEW_HEIGHT 64
+// Frame rate of the preview branch, kept low so that it does not slow down the recording
+#define GRAB_PREVIEW_FPS 2
+// Interval in ms between two checks of the preview image
+#define GRAB_PREVIEW_INTERVAL 500
+
+namespace {
+/** @brief Returns true if the configured FFmpeg binary provides the encoder @param name. */
+bool ffmpegHasEncoder(const QString &name)
+{
+    static QString checkedPath;
+    static QStringList encoders;
+    const QString ffmpeg = KdenliveSettings::ffmpegpath();
+    if (ffmpeg != checkedPath) {
+        checkedPath = ffmpeg;
+        encoders.clear();
+        QProcess probe;
+        probe.start(ffmpeg, QStringList() << QStringLiteral("-hide_banner") << QStringLiteral("-encoders"));
+        if (probe.waitForFinished(5000)) {
+            const QStringList lines = QString::fromUtf8(probe.readAllStandardOutput()).split('\n', QString::SkipEmptyParts);
+            foreach(const QString &line, lines) {
+                // Encoder lines look like " V..... h264_vaapi  H.264/AVC (VAAPI)"
+                const QString codec = line.simplified().section(' ', 1, 1);
+                if (!codec.isEmpty()) encoders << codec;
+            }
+        }
+    }
+    return encoders.contains(name);
+}
+}
 
 RecManager::RecManager(Monitor *parent) :
     QObject(parent)
@@ -45,6 +81,7 @@ RecManager::RecManager(Monitor *parent) :
     , m_captureProcess(NULL)
     , m_recToolbar(new QToolBar(parent))
     , m_screenCombo(NULL)
+    , m_recOffset(-1)
 {
     m_playAction = m_recToolbar->addAction(KoIconUtils::themedIcon(QStringLiteral("media-playback-start")), i18n("Preview"));
     m_playAction->setCheckable(true);
@@ -64,6 +101,14 @@ RecManager::RecManager(Monitor *parent) :
     m_recAudio->setChecked(KdenliveSettings::v4l_captureaudio());
     m_recVideo->setChecked(KdenliveSettings::v4l_capturevideo());
 
+    // Screen grab feedback, filled from the FFmpeg progress output
+    m_previewLabel = new QLabel(parent);
+    m_recToolbar->addWidget(m_previewLabel);
+    m_recInfo = new QLabel(parent);
+    m_recToolbar->addWidget(m_recInfo);
+    m_previewTimer.setInterval(GRAB_PREVIEW_INTERVAL);
+    connect(&m_previewTimer, &QTimer::timeout, this, &RecManager::slotUpdatePreview);
+
     // Check number of monitors for FFmpeg screen capture
     int screens = QApplication::desktop()->screenCount();
     if (screens > 1) {
@@ -270,20 +315,70 @@ void RecManager::slotRecord(bool record)
     captureArgs << QStringLiteral("-i") << captureSize;
     if (!KdenliveSettings::grab_parameters().simplified().isEmpty())
     captureArgs << KdenliveSettings::grab_parameters().simplified().split(' ');
+    // Hardware encoder options come last so that they override the profile codec
+    captureArgs << hardwareEncoderArgs();
     captureArgs << path;
 
+    m_previewFile.clear();
+    if (KdenliveSettings::grab_preview()) {
+        // Second output: a small, low frame rate image that FFmpeg keeps overwriting.
+        // We poll it, so the full resolution stream never waits on the display.
+        m_previewFile = QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-grab-%1.jpg").arg(QCoreApplication::applicationPid()));
+        QFile::remove(m_previewFile);
+        captureArgs << QStringLiteral("-an") << QStringLiteral("-vf") << QStringLiteral("fps=%1,scale=-2:%2").arg(GRAB_PREVIEW_FPS).arg(GRAB_PREVIEW_HEIGHT);
+        captureArgs << QStringLiteral("-q:v") << QStringLiteral("5") << QStringLiteral("-f") << QStringLiteral("image2") << QStringLiteral("-update") << QStringLiteral("1") << m_previewFile;
+    }
+
+    m_recOffset = -1;
+    m_recInfo->clear();
+    m_recTime.start();
     m_captureProcess->start(KdenliveSettings::ffmpegpath(), captureArgs);
     if (!m_captureProcess->waitForStarted()) {
         // Problem launching capture app
         emit warningMessage(i18n("Failed to start the capture application:\n%1", KdenliveSettings::ffmpegpath()));
         //delete m_captureProcess;
+    } else if (!m_previewFile.isEmpty()) {
+        m_previewModified = QDateTime();
+        m_previewTimer.start();
     }
 }
 
 
+QStringList RecManager::hardwareEncoderArgs()
+{
+    QStringList args;
+    switch (KdenliveSettings::grab_hwencoder()) {
+        case 1:
+            if (!ffmpegHasEncoder(QStringLiteral("h264_vaapi"))) {
+                emit warningMessage(i18n("FFmpeg does not support VAAPI encoding, using software encoder"));
+                break;
+            }
+            args << QStringLiteral("-vaapi_device") << KdenliveSettings::grab_vaapi_device();
+            args << QStringLiteral("-vf") << QStringLiteral("format=nv12,hwupload");
+            args << QStringLiteral("-c:v") << QStringLiteral("h264_vaapi");
+            break;
+        case 2:
+            if (!ffmpegHasEncoder(QStringLiteral("h264_nvenc"))) {
+                emit warningMessage(i18n("FFmpeg does not support NVENC encoding, using software encoder"));
+                break;
+            }
+            args << QStringLiteral("-c:v") << QStringLiteral("h264_nvenc");
+            break;
+        default:
+            break;
+    }
+    return args;
+}
+
 void RecManager::slotProcessStatus(QProcess::ProcessState status)
 {
     if (status == QProcess::NotRunning) {
+        m_previewTimer.stop();
+        m_previewLabel->clear();
+        if (!m_previewFile.isEmpty()) {
+            QFile::remove(m_previewFile);
+            m_previewFile.clear();
+        }
         m_recAction->setEnabled(true);
         m_recAction->setChecked(false);
         m_device_selector->setEnabled(true);
@@ -312,6 +407,34 @@ void RecManager::slotReadProcessInfo()
 {
     QString data = m_captureProcess->readAllStandardError().simplified();
     m_recError.append(data + '\n');
+    // Progress lines look like "frame= 120 fps= 25 q=... time=00:00:04.80 bitrate=... dup=0 drop=3 speed=1x"
+    static const QRegularExpression progress(QStringLiteral("frame=\\s*\\d+.*?time=\\s*(\\d+):(\\d+):(\\d+)\\.(\\d+).*?drop=\\s*(\\d+)"));
+    QRegularExpressionMatchIterator it = progress.globalMatch(data);
+    QRegularExpressionMatch match;
+    while (it.hasNext()) {
+        match = it.next();
+    }
+    if (!match.hasMatch()) return;
+    qint64 streamTime = ((match.captured(1).toLongLong() * 60 + match.captured(2).toLongLong()) * 60 + match.captured(3).toLongLong()) * 1000;
+    streamTime += (QStringLiteral("0.") + match.captured(4)).toDouble() * 1000;
+    const qint64 elapsed = m_recTime.elapsed();
+    if (m_recOffset < 0) {
+        // First frame reported, this is our reference for the encoding lag
+        m_recOffset = elapsed - streamTime;
+    }
+    const qint64 lag = qMax((qint64) 0, elapsed - m_recOffset - streamTime);
+    m_recInfo->setText(i18n("Dropped: %1 Lag: %2 ms", match.captured(5).toInt(), lag));
+}
+
+void RecManager::slotUpdatePreview()
+{
+    QFileInfo info(m_previewFile);
+    if (!info.exists() || info.lastModified() == m_previewModified) return;
+    QImage preview;
+    // FFmpeg may be rewriting the file, just retry on next timeout
+    if (!preview.load(m_previewFile)) return;
+    m_previewModified = info.lastModified();
+    m_previewLabel->setPixmap(QPixmap::fromImage(preview));
 }
 
 
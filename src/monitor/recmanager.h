@@ -32,12 +32,16 @@
 
 #include <QUrl>
 #include <QProcess>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDateTime>
 
 class Monitor;
 class QAction;
 class QToolBar;
 class QComboBox;
 class QCheckBox;
+class QLabel;
 
 namespace Mlt {
     class Producer;
@@ -79,7 +83,21 @@ private:
     QComboBox *m_device_selector;
     QCheckBox *m_recVideo;
     QCheckBox *m_recAudio;
+    /** @brief Displays the dropped frames count and encoding lag of the screen grab. */
+    QLabel *m_recInfo;
+    /** @brief Displays the low resolution preview written by FFmpeg. */
+    QLabel *m_previewLabel;
+    QTimer m_previewTimer;
+    QString m_previewFile;
+    QDateTime m_previewModified;
+    /** @brief Wall clock time since the capture process was started. */
+    QElapsedTimer m_recTime;
+    /** @brief Wall clock time at which FFmpeg reported its first frame. */
+    qint64 m_recOffset;
     Mlt::Producer *createV4lProducer();
+    /** @brief Returns the FFmpeg arguments selecting the configured hardware encoder,
+     *  empty if software encoding is used or the encoder is not supported by FFmpeg. */
+    QStringList hardwareEncoderArgs();
 
 private slots:
     void slotRecord(bool record);
@@ -89,6 +107,7 @@ private slots:
     void showRecConfig();
     void slotVideoDeviceChanged(int ix = -1);
     void slotShowLog();
+    void slotUpdatePreview();
 
 signals:
     void addClipToProject(QUrl);
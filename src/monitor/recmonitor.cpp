@@ -40,6 +40,7 @@
 #include <QMouseEvent>
 #include <QMenu>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 #include <QPainter>
 #include <QDesktopWidget>
@@ -427,6 +428,12 @@ void RecMonitor::slotStopCapture()
             emit addProjectClip(m_captureFile);
             m_captureFile.clear();
         }
+        if (m_addCapturedClip->isChecked()) {
+            foreach(const QUrl &url, m_extraCaptureFiles) {
+                if (QFile::exists(url.path())) emit addProjectClip(url);
+            }
+        }
+        m_extraCaptureFiles.clear();
         break;
     default:
         break;
@@ -602,6 +609,7 @@ void RecMonitor::slotRecord()
             ++i;
         }
         m_captureFile = QUrl(path);
+        m_extraCaptureFiles.clear();
 
         m_captureArgs.clear();
         m_displayArgs.clear();
@@ -1015,6 +1023,12 @@ void RecMonitor::slotDroppedFrames(int dropped)
     slotSetInfoMessage(i18n("%1 dropped frames", dropped));
 }
 
+void RecMonitor::slotCaptureFileChanged(const QString &path)
+{
+    m_extraCaptureFiles << QUrl::fromLocalFile(path);
+    slotSetInfoMessage(i18n("Encoder too slow, capturing to %1", QFileInfo(path).fileName()));
+}
+
 void RecMonitor::buildMltDevice(const QString &path)
 {
     //TODO
@@ -1024,6 +1038,7 @@ void RecMonitor::buildMltDevice(const QString &path)
         //TODO
         /*m_captureDevice = new MltDeviceCapture(path, videoSurface, this);
         connect(m_captureDevice, &MltDeviceCapture::droppedFrames, this, &RecMonitor::slotDroppedFrames);
+        connect(m_captureDevice, &MltDeviceCapture::captureFileChanged, this, &RecMonitor::slotCaptureFileChanged);
         m_captureDevice->sendFrameForAnalysis = m_analyse;
         */
         m_monitorManager->updateScopeSource();
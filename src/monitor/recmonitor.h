@@ -84,6 +84,8 @@ private:
     QTimer m_spaceTimer;
 
     QUrl m_captureFile;
+    /** @brief Files written after the capture switched to a faster codec. */
+    QList <QUrl> m_extraCaptureFiles;
     QIcon m_playIcon;
     QIcon m_pauseIcon;
 
@@ -140,6 +142,8 @@ private slots:
     void slotUpdateFreeSpace();
     void slotSetInfoMessage(const QString &message);
     void slotDroppedFrames(int dropped);
+    /** @brief The capture device continues recording in another file. */
+    void slotCaptureFileChanged(const QString &path);
     /** @brief Change setting for preview while recording. */
     void slotChangeRecordingPreview(bool enable);
     /** @brief Show last jog error log. */
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef DATARING_H
+#define DATARING_H
+
+#include <QAtomicInt>
+
+/*!
+  \class DataRing
+  \brief The DataRing passes the latest items from one producer thread to
+  any number of readers without locking.
+
+  \threadsafe
+
+  Unlike DataQueue, items are never removed: the producer overwrites the
+  oldest slot, and every reader keeps its own cursor and asks for the
+  newest item it has not seen yet. A reader that falls behind skips
+  items instead of slowing down the producer.
+
+  T is copied in and out of the slots while the producer may be writing,
+  a per slot sequence detects torn reads. T must therefore be a plain
+  data type without pointers to shared data.
+*/
+
+template <class T>
+class DataRing
+{
+public:
+    /*!
+      Constructs a DataRing holding at most \a size items.
+    */
+    explicit DataRing(int size);
+
+    //! Destructs a DataRing.
+    ~DataRing();
+
+    /*!
+      Stores an item, overwriting the oldest one when the ring is full.
+      Must only be called from one thread.
+    */
+    void push(const T &item);
+
+    /*!
+      Copies the newest item into \a item if it was pushed after the one
+      \a cursor points to, then moves \a cursor to it.
+      Returns false if there is no new item.
+    */
+    bool readLatest(int *cursor, T *item) const;
+
+private:
+    struct Slot {
+        QAtomicInt sequence;
+        T item;
+    };
+    Slot *m_slots;
+    int m_size;
+    QAtomicInt m_written;
+};
+
+template <class T>
+DataRing<T>::DataRing(int size)
+  : m_slots(new Slot[size])
+  , m_size(size)
+  , m_written(0)
+{
+}
+
+template <class T>
+DataRing<T>::~DataRing()
+{
+    delete[] m_slots;
+}
+
+template <class T>
+void DataRing<T>::push(const T &item)
+{
+    const int index = m_written.load();
+    Slot &slot = m_slots[index % m_size];
+    // Odd sequence while the slot is written, the ordered store keeps the copy after it
+    slot.sequence.fetchAndStoreOrdered(2 * index + 1);
+    slot.item = item;
+    slot.sequence.storeRelease(2 * index + 2);
+    m_written.storeRelease(index + 1);
+}
+
+template <class T>
+bool DataRing<T>::readLatest(int *cursor, T *item) const
+{
+    // Retry a few times if the producer overwrote the slot while reading it
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        const int written = m_written.loadAcquire();
+        if (written == *cursor) {
+            return false;
+        }
+        const int index = written - 1;
+        Slot &slot = m_slots[index % m_size];
+        const int before = slot.sequence.loadAcquire();
+        if (before != 2 * index + 2) {
+            continue;
+        }
+        *item = slot.item;
+        if (slot.sequence.fetchAndAddOrdered(0) == before) {
+            *cursor = written;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // DATARING_H
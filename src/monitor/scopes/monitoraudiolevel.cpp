@@ -41,6 +41,23 @@ static inline double levelToDB(double dB)
     return 100 * (1.0 - log10(dB) * log_factor);
 }
 
+/** @brief Highest absolute sample of the first count channels, normalized to [0, 1]. */
+static void channelPeaks(const int16_t *data, int channels, int count, int samples, double *peaks)
+{
+    for (int c = 0; c < count; c++) {
+        // Branch free absolute value and maximum over one channel, vectorizable
+        int peak = 0;
+        const int16_t *sample = data + c;
+        for (int i = 0; i < samples; i++) {
+            const int value = sample[i * channels];
+            const int mask = value >> 31;
+            const int magnitude = (value ^ mask) - mask;
+            peak = peak > magnitude ? peak : magnitude;
+        }
+        peaks[c] = qMin(1.0, peak / 32767.0);
+    }
+}
+
 MonitorAudioLevel::MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget *parent) : ScopeWidget(parent)
   , audioChannels(2)
   , m_height(height)
@@ -68,7 +85,18 @@ void MonitorAudioLevel::refreshScope(const QSize& /*size*/, bool /*full*/)
     SharedFrame sFrame;
     while (m_queue.count() > 0) {
         sFrame = m_queue.pop();
-        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
+        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0 && sFrame.get_audio_format() == mlt_audio_s16
+                && sFrame.get_audio() && sFrame.get_audio_channels() >= audioChannels) {
+            // Measure the consumer's audio in place, no frame clone or filter needed
+            double peaks[8];
+            const int channels = qMin(audioChannels, 8);
+            channelPeaks(sFrame.get_audio(), sFrame.get_audio_channels(), channels, sFrame.get_audio_samples(), peaks);
+            QVector<int> levels;
+            for (int i = 0; i < channels; i++) {
+                levels << (peaks[i] == 0.0 ? -100 : (int) levelToDB(peaks[i]));
+            }
+            QMetaObject::invokeMethod(this, "setAudioValues", Qt::QueuedConnection, Q_ARG(const QVector<int>&, levels));
+        } else if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
             mlt_audio_format format = mlt_audio_s16;
             int channels = sFrame.get_audio_channels();
             int frequency = sFrame.get_audio_frequency();
@@ -17,6 +17,11 @@
  */
 #include "sharedframe.h"
 
+static void releaseImageFrame(void *info)
+{
+    delete static_cast<SharedFrame *>(info);
+}
+
 class FrameData : public QSharedData
 {
 public:
@@ -179,6 +184,33 @@ const uint8_t* SharedFrame::get_image() const
     return (uint8_t*)d->f.get_image(format, width, height, 0);
 }
 
+QImage SharedFrame::toImage() const
+{
+    if (!is_valid()) {
+        return QImage();
+    }
+    QImage::Format imageFormat;
+    int bytesPerLine = get_image_width();
+    switch (get_image_format()) {
+    case mlt_image_rgb24:
+        imageFormat = QImage::Format_RGB888;
+        bytesPerLine *= 3;
+        break;
+    case mlt_image_rgb24a:
+        imageFormat = QImage::Format_RGBA8888;
+        bytesPerLine *= 4;
+        break;
+    default:
+        return QImage();
+    }
+    const uint8_t* image = get_image();
+    if (!image) {
+        return QImage();
+    }
+    // The const data constructor makes Qt copy the image before any modification
+    return QImage(image, get_image_width(), get_image_height(), bytesPerLine, imageFormat, releaseImageFrame, new SharedFrame(*this));
+}
+
 mlt_audio_format SharedFrame::get_audio_format() const
 {
     return (mlt_audio_format)d->f.get_int( "audio_format" );
@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QExplicitlySharedDataPointer>
+#include <QImage>
 #include <mlt++/MltFrame.h>
 #include <stdint.h>
 
@@ -65,6 +66,12 @@ public:
     int get_image_width() const;
     int get_image_height() const;
     const uint8_t* get_image() const;
+    /*!
+      Returns a read-only QImage over the frame image, without copying it. The
+      image keeps a reference to the frame until it is destroyed. Only RGB and
+      RGBA frames can be viewed, a null image is returned for other formats.
+    */
+    QImage toImage() const;
     mlt_audio_format get_audio_format() const;
     int get_audio_channels() const;
     int get_audio_frequency() const;
@@ -33,6 +33,7 @@
 #include "dialogs/slideshowclip.h"
 #include "core.h"
 #include "bin/bin.h"
+#include "doc/thumbnailcache.h"
 
 #include <mlt++/Mlt.h>
 
@@ -65,9 +66,6 @@ ClipManager::ClipManager(KdenliveDoc *doc) :
     m_closing(false),
     m_abortAudioThumb(false)
 {
-    KImageCache::deleteCache(QStringLiteral("kdenlive-thumbs"));
-    pixmapCache = new KImageCache(QStringLiteral("kdenlive-thumbs"), 10000000);
-    pixmapCache->setEvictionPolicy(KSharedDataCache::EvictOldest);
 }
 
 ClipManager::~ClipManager()
@@ -81,8 +79,6 @@ ClipManager::~ClipManager()
     m_requestedThumbs.clear();
     m_audioThumbsQueue.clear();
     m_thumbsMutex.unlock();
-
-    delete pixmapCache;
 }
 
 void ClipManager::clear()
@@ -99,12 +95,12 @@ void ClipManager::clear()
     m_abortAudioThumb = false;
     m_folderList.clear();
     m_modifiedClips.clear();
-    pixmapCache->clear();
+    pCore->thumbnailCache()->clear();
 }
 
 void ClipManager::clearCache()
 {
-    pixmapCache->clear();
+    pCore->thumbnailCache()->clear();
 }
 
 void ClipManager::slotRequestThumbs(const QString &id, const QList <int>& frames)
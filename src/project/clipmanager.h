@@ -29,7 +29,6 @@
 
 #include <QUrl>
 #include <KIO/CopyJob>
-#include <kimagecache.h>
 
 
 #include "gentime.h"
@@ -86,7 +85,6 @@ Q_OBJECT public:
     /** @brief remove a clip id from the queue list. */
     void stopThumbs(const QString &id);
     void projectTreeThumbReady(const QString &id, int frame, const QImage &img, int type);
-    KImageCache* pixmapCache;
 
 public slots:
     /** @brief Request creation of a clip thumbnail for specified frames. */
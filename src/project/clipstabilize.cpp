@@ -42,6 +42,8 @@ ClipStabilize::ClipStabilize(const QStringList &urls, const QString &filterName,
     setWindowTitle(i18n("Stabilize Clip"));
     auto_add->setText(i18np("Add clip to project", "Add clips to project", urls.count()));
     auto_add->setChecked(KdenliveSettings::add_new_clip());
+    split_analysis->setChecked(KdenliveSettings::stabilizesplit());
+    split_analysis->setVisible(m_filtername == QLatin1String("vidstab"));
 
     QString stylesheet = EffectStackView2::getStyleSheet();
     setStyleSheet(stylesheet);
@@ -126,6 +128,7 @@ ClipStabilize::~ClipStabilize()
         m_stabilizeProcess.close();
     }*/
     KdenliveSettings::setAdd_new_clip(auto_add->isChecked());
+    if (!split_analysis->isHidden()) KdenliveSettings::setStabilizesplit(split_analysis->isChecked());
 }
 
 QMap <QString, QString> ClipStabilize::producerParams()
@@ -196,6 +199,11 @@ void ClipStabilize::slotUpdateParams()
     }
 }
 
+bool ClipStabilize::splitAnalysis() const
+{
+    return !split_analysis->isHidden() && split_analysis->isChecked();
+}
+
 bool ClipStabilize::autoAddClip() const
 {
     return auto_add->isChecked();
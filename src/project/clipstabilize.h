@@ -46,6 +46,8 @@ public:
     QString destination() const;
     /** @brief Return the job description. */
     QString desc() const;
+    /** @brief Should the analysis be split in segments processed in parallel. */
+    bool splitAnalysis() const;
 
 
 private slots:
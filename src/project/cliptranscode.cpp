@@ -20,16 +20,18 @@
 
 #include "cliptranscode.h"
 #include "kdenlivesettings.h"
+#include "project/jobs/cutclipjob.h"
 
 #include <QDebug>
 #include <QFontDatabase>
 #include <QStandardPaths>
+#include <QThread>
 
 #include <KMessageBox>
 #include <klocalizedstring.h>
 
 ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, const QStringList &postParams, const QString &description, const QStringList &folderInfo, bool automaticMode, QWidget * parent) :
-    QDialog(parent), m_urls(urls), m_folderInfo(folderInfo), m_duration(0), m_automaticMode(automaticMode), m_postParams(postParams)
+    QDialog(parent), m_jobCount(0), m_jobsDone(0), m_failed(false), m_urls(urls), m_folderInfo(folderInfo), m_automaticMode(automaticMode), m_postParams(postParams)
 {
     setFont(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont));
     setupUi(this);
@@ -93,10 +95,6 @@ ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, con
 
     connect(button_start, SIGNAL(clicked()), this, SLOT(slotStartTransCode()));
 
-    m_transcodeProcess.setProcessChannelMode(QProcess::MergedChannels);
-    connect(&m_transcodeProcess, &QProcess::readyReadStandardOutput, this, &ClipTranscode::slotShowTranscodeInfo);
-    connect(&m_transcodeProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &ClipTranscode::slotTranscodeFinished);
-    
     ffmpeg_params->setMaximumHeight(QFontMetrics(font()).lineSpacing() * 5);
 
     adjustSize();
@@ -105,148 +103,237 @@ ClipTranscode::ClipTranscode(const QStringList &urls, const QString &params, con
 ClipTranscode::~ClipTranscode()
 {
     KdenliveSettings::setAdd_new_clip(auto_add->isChecked());
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
-        m_transcodeProcess.close();
+    m_queue.clear();
+    QMapIterator<QProcess *, TranscodeJob> i(m_jobs);
+    while (i.hasNext()) {
+        i.next();
+        QProcess *process = i.key();
+        process->disconnect(this);
+        process->close();
+        process->waitForFinished();
+        QFile::remove(CutClipJob::partialFile(i.value().destination));
+        delete process;
     }
     delete m_infoMessage;
 }
 
 void ClipTranscode::slotStartTransCode()
 {
-    if (m_transcodeProcess.state() != QProcess::NotRunning) {
+    if (!m_jobs.isEmpty()) {
         return;
     }
-    m_duration = 0;
-    m_destination.clear();
+    m_queue.clear();
+    m_jobsDone = 0;
+    m_failed = false;
     m_infoMessage->animatedHide();
-    QStringList parameters;
-    QString destination;
     QString params = ffmpeg_params->toPlainText().simplified();
+    QString extension = params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0);
+    QStringList sources;
     if (!m_urls.isEmpty() && urls_list->count() > 0) {
         // We are processing multiple clips
-        source_url->setUrl(QUrl::fromLocalFile(m_urls.takeFirst()));
-        destination = dest_url->url().path() + QDir::separator() + source_url->url().fileName();
-        QList<QListWidgetItem *> matching = urls_list->findItems(source_url->url().path(), Qt::MatchExactly);
-        if (matching.count() > 0) {
-            matching.at(0)->setFlags(Qt::ItemIsSelectable);
-            urls_list->setCurrentItem(matching.at(0));
-        }
+        sources = m_urls;
+        m_urls.clear();
     } else {
-        destination = dest_url->url().path().section('.', 0, -2);
+        sources << source_url->url().path();
     }
-    QString extension = params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0);
-    QString s_url = source_url->url().path();
-    parameters << QStringLiteral("-i") << s_url;
-    if (QFile::exists(destination + extension)) {
-        if (KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", destination + extension)) == KMessageBox::No) {
-            // Abort operation
-            if (m_automaticMode) {
-                // inform caller that we aborted
-                emit transcodedClip(source_url->url(), QUrl());
-                close();
+    foreach(const QString &source, sources) {
+        TranscodeJob job;
+        job.source = source;
+        job.duration = 0;
+        job.progress = 0;
+        if (urls_list->count() > 0) {
+            job.destination = dest_url->url().path() + QDir::separator() + QUrl::fromLocalFile(source).fileName() + extension;
+        } else {
+            job.destination = dest_url->url().path().section('.', 0, -2) + extension;
+        }
+        if (QFile::exists(job.destination)) {
+            // Jobs only create their destination once done, so an existing file is complete
+            int answer;
+            if (sources.count() > 1) {
+                answer = KMessageBox::questionYesNoCancel(this, i18n("File %1 already exists.\nDo you want to overwrite it?", job.destination), QString(), KGuiItem(i18n("Overwrite")), KGuiItem(i18n("Skip")));
+            } else {
+                answer = KMessageBox::questionYesNo(this, i18n("File %1 already exists.\nDo you want to overwrite it?", job.destination));
+            }
+            if (answer == KMessageBox::No && sources.count() > 1) {
+                // Resume an interrupted batch: keep the existing file
+                m_jobsDone++;
+                if (auto_add->isChecked() || m_automaticMode) {
+                    if (m_automaticMode) emit transcodedClip(QUrl::fromLocalFile(source), QUrl::fromLocalFile(job.destination));
+                    else emit addClip(QUrl::fromLocalFile(job.destination), m_folderInfo);
+                }
+                continue;
+            }
+            if (answer != KMessageBox::Yes) {
+                // Abort operation
+                m_queue.clear();
+                if (m_automaticMode) {
+                    // inform caller that we aborted
+                    emit transcodedClip(QUrl::fromLocalFile(source), QUrl());
+                    close();
+                }
+                batchFinished();
+                return;
             }
-            return;
         }
-        parameters << QStringLiteral("-y");
-    }
-
-    bool replaceVfParams = false;
-    QStringList splitted = params.split(' ');
-    foreach(QString s, splitted) {
-        if (replaceVfParams) {
-            parameters << m_postParams.at(1);
-            replaceVfParams = false;
-        } else if (s.startsWith(QLatin1String("%1"))) {
-            parameters << s.replace(0, 2, destination);
-        } else if (!m_postParams.isEmpty() && s == QLatin1String("-vf")) {
-            replaceVfParams = true;
-            parameters << s;
-        } else {
-            parameters << s;
+        job.parameters << QStringLiteral("-i") << source;
+        bool replaceVfParams = false;
+        QStringList splitted = params.split(' ');
+        foreach(const QString &s, splitted) {
+            if (replaceVfParams) {
+                job.parameters << m_postParams.at(1);
+                replaceVfParams = false;
+            } else if (s.startsWith(QLatin1String("%1"))) {
+                // FFmpeg writes to a partial file, renamed when complete
+                job.parameters << QStringLiteral("-y") << CutClipJob::partialFile(job.destination);
+            } else if (!m_postParams.isEmpty() && s == QLatin1String("-vf")) {
+                replaceVfParams = true;
+                job.parameters << s;
+            } else {
+                job.parameters << s;
+            }
         }
+        m_queue << job;
+    }
+    m_jobCount = m_jobsDone + m_queue.count();
+    if (m_queue.isEmpty()) {
+        batchFinished();
+        return;
     }
     buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Abort"));
-    m_destination = destination + extension;
-    m_transcodeProcess.start(KdenliveSettings::ffmpegpath(), parameters);
     source_url->setEnabled(false);
     dest_url->setEnabled(false);
     button_start->setEnabled(false);
+    log_text->setHidden(true);
+    job_progress->setHidden(false);
+    job_progress->setValue(0);
+    startJobs();
+}
 
+void ClipTranscode::startJobs()
+{
+    int maxJobs = qMax(1, KdenliveSettings::proxythreads());
+    while (!m_queue.isEmpty() && m_jobs.count() < maxJobs) {
+        TranscodeJob job = m_queue.takeFirst();
+        QStringList parameters = job.parameters;
+        if (!parameters.contains(QStringLiteral("-threads"))) {
+            // Share the cores between the parallel jobs, the option must come before the output file
+            parameters.insert(parameters.count() - 1, QStringLiteral("-threads"));
+            parameters.insert(parameters.count() - 1, QString::number(qMax(1, QThread::idealThreadCount() / maxJobs)));
+        }
+        QProcess *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::MergedChannels);
+        connect(process, &QProcess::readyReadStandardOutput, this, &ClipTranscode::slotShowTranscodeInfo);
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &ClipTranscode::slotTranscodeFinished);
+        m_jobs.insert(process, job);
+        QList<QListWidgetItem *> matching = urls_list->findItems(job.source, Qt::MatchExactly);
+        if (matching.count() > 0) {
+            matching.at(0)->setFlags(Qt::ItemIsSelectable);
+            urls_list->setCurrentItem(matching.at(0));
+        }
+        process->start(KdenliveSettings::ffmpegpath(), parameters);
+    }
 }
 
 void ClipTranscode::slotShowTranscodeInfo()
 {
-    QString log = QString(m_transcodeProcess.readAll());
-    if (m_duration == 0) {
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (!process || !m_jobs.contains(process)) return;
+    TranscodeJob &job = m_jobs[process];
+    QString log = QString(process->readAll());
+    job.log = log;
+    if (job.duration == 0) {
         if (log.contains(QStringLiteral("Duration:"))) {
             QString data = log.section(QStringLiteral("Duration:"), 1, 1).section(',', 0, 0).simplified();
             QStringList numbers = data.split(':');
             if (numbers.size() < 3) return;
-            m_duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
-            log_text->setHidden(true);
-            job_progress->setHidden(false);
-        }
-        else {
-            log_text->setHidden(false);
-            job_progress->setHidden(true);
+            job.duration = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
         }
     }
     else if (log.contains(QStringLiteral("time="))) {
-        int progress;
+        double progress;
         QString time = log.section(QStringLiteral("time="), 1, 1).simplified().section(' ', 0, 0);
         if (time.contains(':')) {
             QStringList numbers = time.split(':');
             if (numbers.size() < 3) return;
             progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
         }
-        else progress = (int) time.toDouble();
-        job_progress->setValue((int) (100.0 * progress / m_duration));
+        else progress = time.toDouble();
+        job.progress = qBound(0, (int) (100.0 * progress / job.duration), 100);
+        updateProgress();
     }
-    log_text->setPlainText(log);
+    if (m_jobs.count() == 1) log_text->setPlainText(log);
+}
+
+void ClipTranscode::updateProgress()
+{
+    if (m_jobCount == 0) return;
+    int progress = 100 * m_jobsDone;
+    QMapIterator<QProcess *, TranscodeJob> i(m_jobs);
+    while (i.hasNext()) {
+        i.next();
+        progress += i.value().progress;
+    }
+    job_progress->setValue(progress / m_jobCount);
 }
 
 void ClipTranscode::slotTranscodeFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Close"));
-    button_start->setEnabled(true);
-    source_url->setEnabled(true);
-    dest_url->setEnabled(true);
-    m_duration = 0;
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (!process || !m_jobs.contains(process)) return;
+    TranscodeJob job = m_jobs.take(process);
+    process->deleteLater();
+    m_jobsDone++;
 
-    if (QFileInfo(m_destination).size() <= 0) {
+    QString partial = CutClipJob::partialFile(job.destination);
+    if (QFileInfo(partial).size() <= 0) {
         // Destination file does not exist, transcoding failed
         exitCode = 1;
     }
     if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
-        log_text->setHtml(log_text->toPlainText() + "<br /><b>" + i18n("Transcoding finished."));
+        QFile::remove(job.destination);
+        if (!QFile::rename(partial, job.destination)) exitCode = 1;
+    }
+    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
         if (auto_add->isChecked() || m_automaticMode) {
-            QUrl url;
-            if (urls_list->count() > 0) {
-                QString params = ffmpeg_params->toPlainText().simplified();
-                QString extension = params.section(QStringLiteral("%1"), 1, 1).section(' ', 0, 0);
-                url = QUrl::fromLocalFile(dest_url->url().path() + QDir::separator() + source_url->url().fileName() + extension);
-            } else url = dest_url->url();
-            if (m_automaticMode) emit transcodedClip(source_url->url(), url);
+            QUrl url = QUrl::fromLocalFile(job.destination);
+            if (m_automaticMode) emit transcodedClip(QUrl::fromLocalFile(job.source), url);
             else emit addClip(url, m_folderInfo);
         }
-        if (urls_list->count() > 0 && m_urls.count() > 0) {
-            m_transcodeProcess.close();
-            slotStartTransCode();
-            return;
-        } else if (auto_close->isChecked()) accept();
-        else {
-            m_infoMessage->setMessageType(KMessageWidget::Positive);
-            m_infoMessage->setText(i18n("Transcoding finished."));
-            m_infoMessage->animatedShow();
-        }
     } else {
+        QFile::remove(partial);
+        m_failed = true;
+        log_text->setPlainText(job.log);
+    }
+    updateProgress();
+    startJobs();
+    if (m_jobs.isEmpty()) {
+        batchFinished();
+    }
+}
+
+void ClipTranscode::batchFinished()
+{
+    buttonBox->button(QDialogButtonBox::Abort)->setText(i18n("Close"));
+    button_start->setEnabled(true);
+    source_url->setEnabled(true);
+    dest_url->setEnabled(true);
+    if (m_failed) {
         m_infoMessage->setMessageType(KMessageWidget::Warning);
         m_infoMessage->setText(i18n("Transcoding failed!"));
         m_infoMessage->animatedShow();
         log_text->setVisible(true);
+    } else if (m_jobCount > 0 && m_jobsDone == m_jobCount) {
+        log_text->setHtml(log_text->toPlainText() + "<br /><b>" + i18n("Transcoding finished."));
+        if (auto_close->isChecked()) {
+            accept();
+            return;
+        }
+        m_infoMessage->setMessageType(KMessageWidget::Positive);
+        m_infoMessage->setText(i18n("Transcoding finished."));
+        m_infoMessage->animatedShow();
     }
-    m_transcodeProcess.close();
-    
+    m_jobCount = 0;
+
     //Refill url list in case user wants to transcode to another format
     if (urls_list->count() > 0) {
         m_urls.clear();
@@ -47,15 +47,33 @@ private slots:
     void slotUpdateParams(int ix = -1);
 
 private:
-    QProcess m_transcodeProcess;
+    struct TranscodeJob {
+        QString source;
+        /** @brief The path for destination transcoded file. */
+        QString destination;
+        QStringList parameters;
+        /** @brief Source duration in seconds, parsed from FFmpeg's output. */
+        double duration;
+        int progress;
+        QString log;
+    };
+    /** @brief The running FFmpeg processes, up to the job thread setting run in parallel. */
+    QMap <QProcess *, TranscodeJob> m_jobs;
+    QList <TranscodeJob> m_queue;
+    /** @brief Number of files in the current batch, and how many were processed. */
+    int m_jobCount;
+    int m_jobsDone;
+    bool m_failed;
     QStringList m_urls;
     QStringList m_folderInfo;
-    int m_duration;
     bool m_automaticMode;
-    /** @brief The path for destination transcoded file. */
-    QString m_destination;
     QStringList m_postParams;
     KMessageWidget *m_infoMessage;
+    /** @brief Starts queued jobs until the parallel job limit is reached. */
+    void startJobs();
+    void updateProgress();
+    /** @brief Called when the whole batch is processed. */
+    void batchFinished();
     
 signals:
     void addClip(const QUrl &url, const QStringList &folderInfo = QStringList());
@@ -21,7 +21,12 @@
 #include "archivewidget.h"
 #include "projectsettings.h"
 #include "titler/titlewidget.h"
+#include "project/projectresources.h"
 #include "mltcontroller/clipcontroller.h"
+#include "doc/projectdatastore.h"
+#include "doc/proxystore.h"
+#include "mltcontroller/bincontroller.h"
+#include "kdenlivesettings.h"
 
 #include <klocalizedstring.h>
 #include <KDiskFreeSpaceInfo>
@@ -31,11 +36,118 @@
 #include <QDebug>
 #include <KIO/MkdirJob>
 #include <KJobWidgets>
-#include <kio/directorysizejob.h>
 #include <KMessageWidget>
 
 #include <QTreeWidget>
 #include <QtConcurrent>
+#include <QProcess>
+#include <QEventLoop>
+#include <QTemporaryDir>
+
+// Size of the blocks read from a file while the previous block is compressed
+#define ARCHIVE_BLOCK 4194304
+
+static QString archiveHash(const QString &path)
+{
+    return ProxyStore::fileHash(path);
+}
+
+static QByteArray readArchiveBlock(QIODevice *device)
+{
+    return device->read(ARCHIVE_BLOCK);
+}
+
+static void listArchiveFiles(const KArchiveDirectory *dir, const QString &prefix, QList <const KArchiveFile *> &files, QStringList &paths)
+{
+    foreach(const QString &name, dir->entries()) {
+        const KArchiveEntry *entry = dir->entry(name);
+        const QString path = prefix + name;
+        if (entry->isDirectory()) {
+            listArchiveFiles(static_cast<const KArchiveDirectory *>(entry), path + QLatin1Char('/'), files, paths);
+        } else if (entry->isFile()) {
+            files << static_cast<const KArchiveFile *>(entry);
+            paths << path;
+        }
+    }
+}
+
+// Seconds searched before a trim start for the previous keyframe
+#define KEYFRAME_SEARCH 30
+
+/** @brief A file copied without the parts that are not used in timeline */
+struct TrimJob {
+    QString source;
+    QString destination;
+    double start;
+    double end;
+    /** @brief Path of the file inside a compressed archive */
+    QString archivePath;
+    bool audioOnly;
+    /** @brief Start of the copied file, the last keyframe before start */
+    double keyframe;
+    bool success;
+};
+
+static QString producerFile(const QDomElement &producer, const QString &root)
+{
+    QString src = EffectsList::property(producer, QStringLiteral("resource"));
+    if (EffectsList::property(producer, QStringLiteral("mlt_service")) == QLatin1String("timewarp")) {
+        // Resource is speed:path
+        src = src.section(':', 1);
+    }
+    if (!src.isEmpty() && !src.startsWith('/')) src.prepend(root);
+    return src;
+}
+
+static double previousKeyframe(const QString &source, double position)
+{
+    // Stream copy can only start on a keyframe, find the one before position
+    QProcess probe;
+    QStringList args;
+    args << QStringLiteral("-v") << QStringLiteral("error") << QStringLiteral("-select_streams") << QStringLiteral("v:0");
+    args << QStringLiteral("-show_entries") << QStringLiteral("packet=pts_time,flags") << QStringLiteral("-of") << QStringLiteral("csv=p=0");
+    args << QStringLiteral("-read_intervals") << QStringLiteral("%1%%2").arg(qMax(0.0, position - KEYFRAME_SEARCH)).arg(position + 1);
+    args << source;
+    probe.start(KdenliveSettings::ffprobepath(), args);
+    if (!probe.waitForFinished(-1) || probe.exitCode() != 0) {
+        return -1;
+    }
+    double keyframe = 0;
+    const QStringList packets = QString::fromUtf8(probe.readAllStandardOutput()).split('\n', QString::SkipEmptyParts);
+    foreach(const QString &packet, packets) {
+        if (!packet.section(',', 1, 1).startsWith('K')) continue;
+        bool ok;
+        double time = packet.section(',', 0, 0).toDouble(&ok);
+        if (ok && time <= position && time > keyframe) {
+            keyframe = time;
+        }
+    }
+    return keyframe;
+}
+
+static TrimJob runTrimJob(const TrimJob &input)
+{
+    TrimJob job = input;
+    job.success = false;
+    job.keyframe = job.audioOnly ? job.start : previousKeyframe(job.source, job.start);
+    if (job.keyframe < 0) {
+        return job;
+    }
+    QProcess ffmpeg;
+    QStringList args;
+    args << QStringLiteral("-y") << QStringLiteral("-v") << QStringLiteral("error");
+    args << QStringLiteral("-ss") << QString::number(job.keyframe, 'f', 6) << QStringLiteral("-i") << job.source;
+    args << QStringLiteral("-t") << QString::number(job.end - job.keyframe, 'f', 6);
+    args << QStringLiteral("-map") << QStringLiteral("0") << QStringLiteral("-c") << QStringLiteral("copy");
+    args << QStringLiteral("-avoid_negative_ts") << QStringLiteral("make_zero") << job.destination;
+    ffmpeg.start(KdenliveSettings::ffmpegpath(), args);
+    job.success = ffmpeg.waitForFinished(-1) && ffmpeg.exitStatus() == QProcess::NormalExit && ffmpeg.exitCode() == 0 && QFileInfo(job.destination).size() > 0;
+    if (!job.success) {
+        qWarning() << "//////  ERROR trimming file: " << job.source << ffmpeg.readAllStandardError();
+        QFile::remove(job.destination);
+    }
+    return job;
+}
 
 ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc, const QList <ClipController*> &list, const QStringList &luma_list, QWidget * parent) :
         QDialog(parent)
@@ -43,10 +155,11 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc
         , m_copyJob(NULL)
         , m_name(projectName.section('.', 0, -2))
         , m_doc(doc)
+        , m_fps(25)
+        , m_trimDir(NULL)
 	, m_temp(NULL)
         , m_abortArchive(false)
         , m_extractMode(false)
-	, m_progressTimer(NULL)
         , m_extractArchive(NULL)
         , m_missingClips(0)
 {
@@ -58,6 +171,12 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc
     connect(this, SIGNAL(archivingFinished(bool)), this, SLOT(slotArchivingFinished(bool)));
     connect(this, SIGNAL(archiveProgress(int)), this, SLOT(slotArchivingProgress(int)));
     connect(proxy_only, SIGNAL(stateChanged(int)), this, SLOT(slotProxyOnly(int)));
+    consolidate_handles->setValue(KdenliveSettings::archivehandles());
+    consolidate_handles->setEnabled(false);
+    connect(consolidate_ranges, SIGNAL(toggled(bool)), consolidate_handles, SLOT(setEnabled(bool)));
+    if (KdenliveSettings::ffmpegpath().isEmpty() || KdenliveSettings::ffprobepath().isEmpty()) {
+        consolidate_ranges->setEnabled(false);
+    }
 
     // Setup categories
     QTreeWidgetItem *videos = new QTreeWidgetItem(files_list, QStringList() << i18n("Video clips"));
@@ -123,16 +242,14 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QDomDocument &doc
             slideUrls.insert(id, slideUrl.path());
         }
         else if (t == Image) imageUrls.insert(id, clip->clipUrl().path());
-        else if (t == QText) allFonts << clip->property(QStringLiteral("family"));
+        else if (t == QText) allFonts << ProjectResources::clipResources(clip).fonts;
         else if (t == Text) {
-            QStringList imagefiles = TitleWidget::extractImageList(clip->property(QStringLiteral("xmldata")));
-            QStringList fonts = TitleWidget::extractFontList(clip->property(QStringLiteral("xmldata")));
-            extraImageUrls << imagefiles;
-            allFonts << fonts;
+            ProjectResources::ClipResources resources = ProjectResources::clipResources(clip);
+            extraImageUrls << resources.files;
+            allFonts << resources.fonts;
         } else if (t == Playlist) {
             playlistUrls.insert(id, clip->clipUrl().path());
-            QStringList files = ProjectSettings::extractPlaylistUrls(clip->clipUrl().path());
-            otherUrls << files;
+            otherUrls << ProjectResources::clipResources(clip).files;
         }
         else if (!clip->clipUrl().isEmpty()) {
             if (t == Audio) audioUrls.insert(id, clip->clipUrl().path());
@@ -208,6 +325,8 @@ ArchiveWidget::ArchiveWidget(const QUrl &url, QWidget * parent):
     QDialog(parent),
     m_requestedSize(0),
     m_copyJob(NULL),
+    m_fps(25),
+    m_trimDir(NULL),
     m_temp(NULL),
     m_abortArchive(false),
     m_extractMode(true),
@@ -219,15 +338,14 @@ ArchiveWidget::ArchiveWidget(const QUrl &url, QWidget * parent):
     //setAttribute(Qt::WA_DeleteOnClose);
 
     setupUi(this);
-    m_progressTimer = new QTimer;
-    m_progressTimer->setInterval(800);
-    m_progressTimer->setSingleShot(false);
-    connect(m_progressTimer, SIGNAL(timeout()), this, SLOT(slotExtractProgress()));
-    connect(this, SIGNAL(extractingFinished()), this, SLOT(slotExtractingFinished()));
+    connect(this, SIGNAL(archiveProgress(int)), this, SLOT(slotArchivingProgress(int)));
+    connect(this, SIGNAL(extractingFinished(bool)), this, SLOT(slotExtractingFinished(bool)));
     connect(this, SIGNAL(showMessage(QString,QString)), this, SLOT(slotDisplayMessage(QString,QString)));
     
     compressed_archive->setHidden(true);
     proxy_only->setHidden(true);
+    consolidate_ranges->setHidden(true);
+    consolidate_handles->setHidden(true);
     project_files->setHidden(true);
     files_list->setHidden(true);
     label->setText(i18n("Extract to"));
@@ -244,7 +362,7 @@ ArchiveWidget::ArchiveWidget(const QUrl &url, QWidget * parent):
 ArchiveWidget::~ArchiveWidget()
 {
     delete m_extractArchive;
-    delete m_progressTimer;
+    delete m_trimDir;
 }
 
 void ArchiveWidget::slotDisplayMessage(const QString &icon, const QString &text)
@@ -514,12 +632,20 @@ bool ArchiveWidget::slotStartArchiving(bool firstPass)
         m_abortArchive = false;
         m_duplicateFiles.clear();
         m_replacementList.clear();
+        m_contentAliases.clear();
+        m_usedRanges.clear();
         m_foldersList.clear();
         m_filesList.clear();
         slotDisplayMessage(QStringLiteral("system-run"), i18n("Archiving..."));
         repaint();
+        findDuplicateContent();
+        if (consolidate_ranges->isEnabled() && consolidate_ranges->isChecked()) {
+            findUsedRanges();
+        }
         archive_url->setEnabled(false);
         proxy_only->setEnabled(false);
+        consolidate_ranges->setEnabled(false);
+        consolidate_handles->setEnabled(false);
         compressed_archive->setEnabled(false);
     }
     QList <QUrl> files;
@@ -574,6 +700,14 @@ bool ArchiveWidget::slotStartArchiving(bool firstPass)
                     }
                     break;
                 }
+                else if (m_contentAliases.contains(QUrl(item->text(0)))) {
+                    // Same content as another archived file, the project will use that one
+                    continue;
+                }
+                else if (m_usedRanges.contains(QUrl(item->text(0)).path())) {
+                    // Only the used range is copied once the other files are archived
+                    continue;
+                }
                 else if (item->data(0, Qt::UserRole).isNull()) {
                     files << QUrl(item->text(0));
                 }
@@ -665,6 +799,8 @@ void ArchiveWidget::slotArchivingFinished(KJob *job, bool finished)
         buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
         archive_url->setEnabled(true);
         proxy_only->setEnabled(true);
+        consolidate_ranges->setEnabled(!KdenliveSettings::ffmpegpath().isEmpty() && !KdenliveSettings::ffprobepath().isEmpty());
+        consolidate_handles->setEnabled(consolidate_ranges->isEnabled() && consolidate_ranges->isChecked());
         compressed_archive->setEnabled(true);
         for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
             files_list->topLevelItem(i)->setDisabled(false);
@@ -708,6 +844,15 @@ bool ArchiveWidget::processProjectFile()
             }
         }
     }
+    // Duplicated files point to the archived copy of their content
+    QMapIterator<QUrl, QUrl> alias(m_contentAliases);
+    while (alias.hasNext()) {
+        alias.next();
+        if (m_replacementList.contains(alias.value())) {
+            m_replacementList.insert(alias.key(), m_replacementList.value(alias.value()));
+        }
+    }
+    trimUsedRanges();
     
     QDomElement mlt = m_doc.documentElement();
     QString root = mlt.attribute(QStringLiteral("root")) + '/';
@@ -769,6 +914,8 @@ bool ArchiveWidget::processProjectFile()
         }
     }
 
+    // The archive does not contain the project's sidecar file
+    ProjectDataStore::embed(m_doc);
     QString playList = m_doc.toString();
     if (isArchive) {
         QString startString(QStringLiteral("\""));
@@ -822,17 +969,28 @@ void ArchiveWidget::createArchive()
     }
 
     // Add files
-    int ix = 0;
+    qint64 total = 0;
+    qint64 done = 0;
+    foreach(const QString &path, m_filesList.keys()) {
+        total += QFileInfo(path).size();
+    }
+    bool result = true;
     QMapIterator<QString, QString> i(m_filesList);
-    while (i.hasNext()) {
+    while (i.hasNext() && result) {
         i.next();
-        archive.addLocalFile(i.key(), i.value());
-        emit archiveProgress((int) 100 * ix / m_filesList.count());
-        ix++;
+        result = writeArchiveFile(archive, i.key(), i.value(), user, group, done, total);
+    }
+    if (!result) {
+        archive.close();
+        QFile::remove(archive.fileName());
+        delete m_temp;
+        m_temp = 0;
+        emit archivingFinished(false);
+        return;
     }
 
     // Add project file
-    bool result = false;
+    result = false;
     if (m_temp) {
         archive.addLocalFile(m_temp->fileName(), m_name + ".kdenlive");
         result = archive.close();
@@ -842,6 +1000,264 @@ void ArchiveWidget::createArchive()
     emit archivingFinished(result);
 }
 
+bool ArchiveWidget::writeArchiveFile(KArchive &archive, const QString &source, const QString &dest, const QString &user, const QString &group, qint64 &done, qint64 total)
+{
+    QFile file(source);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "//////  ERROR reading file: " << source;
+        return false;
+    }
+    QFileInfo info(source);
+    if (!archive.prepareWriting(dest, user, group, info.size(), 0100644, info.lastRead(), info.lastModified(), info.created())) {
+        return false;
+    }
+    qint64 written = 0;
+    QFuture<QByteArray> next = QtConcurrent::run(readArchiveBlock, &file);
+    while (!m_abortArchive) {
+        QByteArray data = next.result();
+        if (data.isEmpty()) {
+            break;
+        }
+        next = QtConcurrent::run(readArchiveBlock, &file);
+        if (!archive.writeData(data.constData(), data.size())) {
+            next.waitForFinished();
+            return false;
+        }
+        written += data.size();
+        done += data.size();
+        emit archiveProgress(total > 0 ? (int) (100 * done / total) : 0);
+    }
+    next.waitForFinished();
+    if (m_abortArchive || written != info.size()) {
+        return false;
+    }
+    return archive.finishWriting(written);
+}
+
+void ArchiveWidget::findDuplicateContent()
+{
+    // Only files with the same size can have the same content
+    QMap <qint64, QStringList> sizes;
+    for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(i);
+        if (parentItem->isDisabled() || parentItem->data(0, Qt::UserRole).toString() == QLatin1String("slideshows")) {
+            continue;
+        }
+        for (int j = 0; j < parentItem->childCount(); ++j) {
+            QTreeWidgetItem *item = parentItem->child(j);
+            if (item->isDisabled()) continue;
+            const QString path = QUrl(item->text(0)).path();
+            QStringList &sameSize = sizes[QFileInfo(path).size()];
+            if (!sameSize.contains(path)) {
+                sameSize << path;
+            }
+        }
+    }
+    QStringList candidates;
+    QMapIterator<qint64, QStringList> i(sizes);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().count() > 1) {
+            candidates << i.value();
+        }
+    }
+    if (candidates.isEmpty()) {
+        return;
+    }
+    const QStringList hashes = QtConcurrent::blockingMapped(candidates, archiveHash);
+    QMap <QString, QString> firstFiles;
+    for (int j = 0; j < candidates.count(); ++j) {
+        const QString hash = QString::number(QFileInfo(candidates.at(j)).size()) + QLatin1Char('-') + hashes.at(j);
+        if (hashes.at(j).isEmpty()) {
+            continue;
+        }
+        if (firstFiles.contains(hash)) {
+            m_contentAliases.insert(QUrl(candidates.at(j)), QUrl(firstFiles.value(hash)));
+        } else {
+            firstFiles.insert(hash, candidates.at(j));
+        }
+    }
+}
+
+void ArchiveWidget::findUsedRanges()
+{
+    KdenliveSettings::setArchivehandles(consolidate_handles->value());
+    QDomElement mlt = m_doc.documentElement();
+    QString root = mlt.attribute(QStringLiteral("root")) + '/';
+    QDomElement profile = mlt.firstChildElement(QStringLiteral("profile"));
+    if (profile.attribute(QStringLiteral("frame_rate_den")).toInt() > 0) {
+        m_fps = profile.attribute(QStringLiteral("frame_rate_num")).toDouble() / profile.attribute(QStringLiteral("frame_rate_den")).toInt();
+    }
+
+    // Files that must be archived whole: proxied, speed changed or archived once for several clips
+    QStringList excluded;
+    QMapIterator<QUrl, QUrl> alias(m_contentAliases);
+    while (alias.hasNext()) {
+        alias.next();
+        excluded << alias.key().path() << alias.value().path();
+    }
+    QMap <QString, QString> files;
+    QDomNodeList prods = mlt.elementsByTagName(QStringLiteral("producer"));
+    for (int i = 0; i < prods.count(); ++i) {
+        QDomElement e = prods.item(i).toElement();
+        QString src = producerFile(e, root);
+        if (src.isEmpty()) continue;
+        QString proxy = EffectsList::property(e, QStringLiteral("kdenlive:proxy"));
+        QString original = EffectsList::property(e, QStringLiteral("kdenlive:originalurl"));
+        if (!original.isEmpty()) {
+            if (!original.startsWith('/')) original.prepend(root);
+            if (original != src) excluded << original;
+        }
+        if (EffectsList::property(e, QStringLiteral("mlt_service")) == QLatin1String("timewarp") || (!proxy.isEmpty() && proxy != QLatin1String("-"))) {
+            excluded << src;
+            continue;
+        }
+        files.insert(e.attribute(QStringLiteral("id")), src);
+    }
+
+    // Collect the frames used by timeline clips
+    QMap <QString, QPoint> ranges;
+    QDomNodeList playlists = mlt.elementsByTagName(QStringLiteral("playlist"));
+    for (int i = 0; i < playlists.count(); ++i) {
+        QDomElement playlist = playlists.item(i).toElement();
+        if (playlist.attribute(QStringLiteral("id")) == BinController::binPlaylistId()) continue;
+        QDomNodeList entries = playlist.elementsByTagName(QStringLiteral("entry"));
+        for (int j = 0; j < entries.count(); ++j) {
+            QDomElement entry = entries.item(j).toElement();
+            QString src = files.value(entry.attribute(QStringLiteral("producer")));
+            if (src.isEmpty()) continue;
+            bool okIn;
+            bool okOut;
+            int in = entry.attribute(QStringLiteral("in")).toInt(&okIn);
+            int out = entry.attribute(QStringLiteral("out")).toInt(&okOut);
+            if (!okIn || !okOut) {
+                // Time string positions, we cannot safely shift them
+                excluded << src;
+                continue;
+            }
+            if (ranges.contains(src)) {
+                QPoint &range = ranges[src];
+                range.setX(qMin(range.x(), in));
+                range.setY(qMax(range.y(), out));
+            }
+            else ranges.insert(src, QPoint(in, out));
+        }
+    }
+
+    int handles = qRound(consolidate_handles->value() * m_fps);
+    for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(i);
+        QString category = parentItem->data(0, Qt::UserRole).toString();
+        if (parentItem->isDisabled() || (category != QLatin1String("videos") && category != QLatin1String("sounds"))) {
+            continue;
+        }
+        for (int j = 0; j < parentItem->childCount(); ++j) {
+            QTreeWidgetItem *item = parentItem->child(j);
+            const QString path = QUrl(item->text(0)).path();
+            if (item->isDisabled() || item->data(0, Qt::UserRole + 3).isNull() || excluded.contains(path) || !ranges.contains(path)) {
+                continue;
+            }
+            QPoint range = ranges.value(path);
+            m_usedRanges.insert(path, QPoint(qMax(0, range.x() - handles), range.y() + handles));
+        }
+    }
+}
+
+void ArchiveWidget::trimUsedRanges()
+{
+    if (m_usedRanges.isEmpty()) {
+        return;
+    }
+    bool isArchive = compressed_archive->isChecked();
+    if (isArchive) {
+        delete m_trimDir;
+        m_trimDir = new QTemporaryDir;
+    }
+    QList <TrimJob> jobs;
+    for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(i);
+        QString category = parentItem->data(0, Qt::UserRole).toString();
+        if (category != QLatin1String("videos") && category != QLatin1String("sounds")) {
+            continue;
+        }
+        for (int j = 0; j < parentItem->childCount(); ++j) {
+            QTreeWidgetItem *item = parentItem->child(j);
+            TrimJob job;
+            job.source = QUrl(item->text(0)).path();
+            if (!m_usedRanges.contains(job.source)) continue;
+            QUrl dest = m_replacementList.value(QUrl(item->text(0)));
+            job.archivePath = category + '/' + dest.fileName();
+            if (isArchive) {
+                QDir(m_trimDir->path()).mkpath(category);
+                job.destination = m_trimDir->path() + '/' + job.archivePath;
+            }
+            else {
+                QDir().mkpath(dest.adjusted(QUrl::RemoveFilename).path());
+                job.destination = dest.path();
+            }
+            job.start = m_usedRanges.value(job.source).x() / m_fps;
+            job.end = (m_usedRanges.value(job.source).y() + 1) / m_fps;
+            job.audioOnly = category == QLatin1String("sounds");
+            job.keyframe = 0;
+            job.success = false;
+            jobs << job;
+        }
+    }
+
+    slotDisplayMessage(QStringLiteral("system-run"), i18n("Copying used clip ranges..."));
+    progressBar->setValue(0);
+    QFutureWatcher<TrimJob> watcher;
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    int count = jobs.count();
+    connect(&watcher, &QFutureWatcher<TrimJob>::progressValueChanged, progressBar, [this, count](int done) {
+        progressBar->setValue(100 * done / count);
+    });
+    watcher.setFuture(QtConcurrent::mapped(jobs, runTrimJob));
+    loop.exec();
+
+    QDomElement mlt = m_doc.documentElement();
+    QString root = mlt.attribute(QStringLiteral("root")) + '/';
+    QDomNodeList prods = mlt.elementsByTagName(QStringLiteral("producer"));
+    QDomNodeList entries = mlt.elementsByTagName(QStringLiteral("entry"));
+    const QList <TrimJob> results = watcher.future().results();
+    foreach(const TrimJob &job, results) {
+        if (!job.success) {
+            // Archive the whole file instead
+            if (isArchive) m_filesList.insert(job.source, job.archivePath);
+            else QFile::copy(job.source, job.destination);
+            continue;
+        }
+        if (isArchive) m_filesList.insert(job.destination, job.archivePath);
+        // The copied file starts on a keyframe, shift the clips by the removed frames
+        int offset = qRound(job.keyframe * m_fps);
+        int length = m_usedRanges.value(job.source).y() - offset + 1;
+        QStringList ids;
+        for (int i = 0; i < prods.count(); ++i) {
+            QDomElement e = prods.item(i).toElement();
+            if (producerFile(e, root) != job.source) continue;
+            ids << e.attribute(QStringLiteral("id"));
+            if (e.hasAttribute(QStringLiteral("in"))) e.setAttribute(QStringLiteral("in"), 0);
+            if (e.hasAttribute(QStringLiteral("out"))) e.setAttribute(QStringLiteral("out"), length - 1);
+            if (!EffectsList::property(e, QStringLiteral("length")).isEmpty()) {
+                EffectsList::setProperty(e, QStringLiteral("length"), QString::number(length));
+            }
+        }
+        for (int i = 0; i < entries.count(); ++i) {
+            QDomElement entry = entries.item(i).toElement();
+            if (!ids.contains(entry.attribute(QStringLiteral("producer")))) continue;
+            entry.setAttribute(QStringLiteral("in"), qBound(0, entry.attribute(QStringLiteral("in")).toInt() - offset, length - 1));
+            entry.setAttribute(QStringLiteral("out"), qBound(0, entry.attribute(QStringLiteral("out")).toInt() - offset, length - 1));
+            QDomNodeList filters = entry.elementsByTagName(QStringLiteral("filter"));
+            for (int j = 0; j < filters.count(); ++j) {
+                QDomElement filter = filters.item(j).toElement();
+                if (filter.hasAttribute(QStringLiteral("in"))) filter.setAttribute(QStringLiteral("in"), qMax(0, filter.attribute(QStringLiteral("in")).toInt() - offset));
+                if (filter.hasAttribute(QStringLiteral("out"))) filter.setAttribute(QStringLiteral("out"), qMax(0, filter.attribute(QStringLiteral("out")).toInt() - offset));
+            }
+        }
+    }
+}
+
 void ArchiveWidget::slotArchivingFinished(bool result)
 {
     if (result) {
@@ -855,6 +1271,8 @@ void ArchiveWidget::slotArchivingFinished(bool result)
     buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
     archive_url->setEnabled(true);
     proxy_only->setEnabled(true);
+    consolidate_ranges->setEnabled(!KdenliveSettings::ffmpegpath().isEmpty() && !KdenliveSettings::ffprobepath().isEmpty());
+    consolidate_handles->setEnabled(consolidate_ranges->isEnabled() && consolidate_ranges->isChecked());
     compressed_archive->setEnabled(true);
     for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
         files_list->topLevelItem(i)->setDisabled(false);
@@ -871,11 +1289,11 @@ void ArchiveWidget::slotArchivingProgress(int p)
 void ArchiveWidget::slotStartExtracting()
 {
     if (m_archiveThread.isRunning()) {
-        //TODO: abort extracting
+        // Extracting in progress, abort
+        m_abortArchive = true;
         return;
     }
-    QFileInfo f(m_extractUrl.path());
-    m_requestedSize = f.size();
+    m_abortArchive = false;
     KIO::MkdirJob *job = KIO::mkdir(archive_url->url());
     KJobWidgets::setWindow(job, QApplication::activeWindow());
     if (!job->exec()) {
@@ -884,29 +1302,87 @@ void ArchiveWidget::slotStartExtracting()
     slotDisplayMessage(QStringLiteral("system-run"), i18n("Extracting..."));
     buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Abort"));
     m_archiveThread = QtConcurrent::run(this, &ArchiveWidget::doExtracting);
-    m_progressTimer->start();
-}
-
-void ArchiveWidget::slotExtractProgress()
-{
-    KIO::DirectorySizeJob *job = KIO::directorySize(archive_url->url());
-    connect(job, SIGNAL(result(KJob*)), this, SLOT(slotGotProgress(KJob*)));
 }
 
-void ArchiveWidget::slotGotProgress(KJob* job)
+void ArchiveWidget::doExtracting()
 {
-    if (!job->error()) {
-        KIO::DirectorySizeJob *j = static_cast <KIO::DirectorySizeJob *>(job);
-        progressBar->setValue((int) 100 * j->totalSize() / m_requestedSize);
+    const QString folder = archive_url->url().path() + QDir::separator();
+    QList <const KArchiveFile *> files;
+    QStringList paths;
+    listArchiveFiles(m_extractArchive->directory(), QString(), files, paths);
+    // Extract the project file first, a broken archive is detected before copying the media
+    int projectIndex = paths.indexOf(m_projectName);
+    if (projectIndex > 0) {
+        files.move(projectIndex, 0);
+        paths.move(projectIndex, 0);
+    }
+    qint64 total = 0;
+    foreach(const KArchiveFile *entry, files) {
+        total += entry->size();
+    }
+    qint64 done = 0;
+    bool result = true;
+    for (int i = 0; i < files.count(); ++i) {
+        if (m_abortArchive || !extractArchiveFile(files.at(i), folder + paths.at(i), paths.at(i) == m_projectName, done, total)) {
+            result = false;
+            break;
+        }
     }
-    job->deleteLater();
+    m_extractArchive->close();
+    emit extractingFinished(result);
 }
 
-void ArchiveWidget::doExtracting()
+bool ArchiveWidget::extractArchiveFile(const KArchiveFile *entry, const QString &dest, bool isProject, qint64 &done, qint64 total)
 {
-    m_extractArchive->directory()->copyTo(archive_url->url().path() + QDir::separator());
-    m_extractArchive->close();
-    emit extractingFinished();    
+    QDir().mkpath(QFileInfo(dest).absolutePath());
+    QFile file(dest);
+    if (isProject) {
+        // The project file is small, replace the archive placeholder while writing it
+        QString playList = QString::fromUtf8(entry->data());
+        if (playList.isEmpty()) {
+            return false;
+        }
+        playList.replace(QLatin1String("$CURRENTPATH"), archive_url->url().adjusted(QUrl::StripTrailingSlash).path());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            qWarning() << "//////  ERROR writing to file: " << dest;
+            return false;
+        }
+        file.write(playList.toUtf8());
+        file.close();
+        done += entry->size();
+        emit archiveProgress(total > 0 ? (int) (100 * done / total) : 0);
+        return file.error() == QFile::NoError;
+    }
+    QIODevice *device = entry->createDevice();
+    if (!device) {
+        return false;
+    }
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "//////  ERROR writing to file: " << dest;
+        delete device;
+        return false;
+    }
+    qint64 written = 0;
+    bool success = true;
+    QFuture<QByteArray> next = QtConcurrent::run(readArchiveBlock, device);
+    while (!m_abortArchive) {
+        QByteArray data = next.result();
+        if (data.isEmpty()) {
+            break;
+        }
+        next = QtConcurrent::run(readArchiveBlock, device);
+        if (file.write(data) != data.size()) {
+            success = false;
+            break;
+        }
+        written += data.size();
+        done += data.size();
+        emit archiveProgress(total > 0 ? (int) (100 * done / total) : 0);
+    }
+    next.waitForFinished();
+    delete device;
+    file.close();
+    return success && !m_abortArchive && written == entry->size();
 }
 
 QString ArchiveWidget::extractedProjectFile() const
@@ -914,38 +1390,12 @@ QString ArchiveWidget::extractedProjectFile() const
     return archive_url->url().path() + QDir::separator() + m_projectName;
 }
 
-void ArchiveWidget::slotExtractingFinished()
+void ArchiveWidget::slotExtractingFinished(bool result)
 {
-    m_progressTimer->stop();
-    // Process project file
-    QFile file(extractedProjectFile());
-    bool error = false;
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        error = true;
-    }
-    else {
-        QString playList = QString::fromUtf8(file.readAll());
-        file.close();
-        if (playList.isEmpty()) {
-            error = true;
-        }
-        else {
-            playList.replace(QLatin1String("$CURRENTPATH"), archive_url->url().adjusted(QUrl::StripTrailingSlash).path());
-            if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                qWarning() << "//////  ERROR writing to file: ";
-                error = true;
-            }
-            else {
-                file.write(playList.toUtf8());
-                if (file.error() != QFile::NoError) {
-                    error = true;
-                }
-                file.close();
-            }
+    if (!result) {
+        if (!m_abortArchive) {
+            KMessageBox::sorry(QApplication::activeWindow(), i18n("Cannot open project file %1", extractedProjectFile()), i18n("Cannot open file"));
         }
-    }
-    if (error) {
-        KMessageBox::sorry(QApplication::activeWindow(), i18n("Cannot open project file %1", extractedProjectFile()), i18n("Cannot open file"));
         reject();
     }
     else accept();
@@ -35,6 +35,8 @@
 
 class KJob;
 class KArchive;
+class KArchiveFile;
+class QTemporaryDir;
 class ClipController;
 
 /**
@@ -69,9 +71,7 @@ private slots:
     void slotArchivingFinished(bool result);
     void slotStartExtracting();
     void doExtracting();
-    void slotExtractingFinished();
-    void slotExtractProgress();
-    void slotGotProgress(KJob*);
+    void slotExtractingFinished(bool result);
     void openArchiveForExtraction();
     void slotDisplayMessage(const QString &icon, const QString &text);
     void slotJobResult(bool success, const QString &text);
@@ -85,6 +85,14 @@ private:
     KIO::CopyJob *m_copyJob;
     QMap <QUrl, QUrl> m_duplicateFiles;
     QMap <QUrl, QUrl> m_replacementList;
+    /** @brief Files having the same content as an archived file, pointing to that file */
+    QMap <QUrl, QUrl> m_contentAliases;
+    /** @brief Source files archived trimmed to their used range, with the first and last used frame (handles included) */
+    QMap <QString, QPoint> m_usedRanges;
+    /** @brief Project frame rate, used to convert frames into seek times */
+    double m_fps;
+    /** @brief Folder holding the trimmed files until they are added to a compressed archive */
+    QTemporaryDir *m_trimDir;
     QString m_name;
     QDomDocument m_doc;
     QTemporaryFile *m_temp;
@@ -95,7 +103,6 @@ private:
     bool m_extractMode;
     QUrl m_extractUrl;
     QString m_projectName;
-    QTimer *m_progressTimer;
     KArchive *m_extractArchive;
     int m_missingClips;
     KMessageWidget *m_infoMessage;
@@ -106,11 +113,21 @@ private:
     void generateItems(QTreeWidgetItem *parentItem, const QMap<QString, QString> &items);
     /** @brief Replace urls in project file. */
     bool processProjectFile();
+    /** @brief Find files with identical content, so that they are only archived once. */
+    void findDuplicateContent();
+    /** @brief Find the frame range used in timeline for each video and audio file. */
+    void findUsedRanges();
+    /** @brief Copy the used ranges of the files found by findUsedRanges() and adjust the clip positions in project. */
+    void trimUsedRanges();
+    /** @brief Stream a file into the archive, reading ahead while data is compressed. */
+    bool writeArchiveFile(KArchive &archive, const QString &source, const QString &dest, const QString &user, const QString &group, qint64 &done, qint64 total);
+    /** @brief Stream a file out of the archive, writing a block while the next one is read. The project file paths are rewritten on the fly. */
+    bool extractArchiveFile(const KArchiveFile *entry, const QString &dest, bool isProject, qint64 &done, qint64 total);
 
 signals:
     void archivingFinished(bool);
     void archiveProgress(int);
-    void extractingFinished();
+    void extractingFinished(bool);
     void showMessage(const QString &, const QString &);
 };
 
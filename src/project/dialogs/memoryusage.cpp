@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "memoryusage.h"
+#include "utils/memorytracker.h"
+
+#include <KLocalizedString>
+#include <KIO/Global>
+
+#include <QVBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+
+// Interval between two refreshes of the displayed usage, in ms
+#define REFRESH_INTERVAL 1000
+
+MemoryUsage::MemoryUsage(QWidget *parent) : QWidget(parent)
+{
+    QVBoxLayout *lay = new QVBoxLayout;
+    m_resident = new QLabel(this);
+    lay->addWidget(m_resident);
+    m_list = new QTreeWidget(this);
+    m_list->setRootIsDecorated(false);
+    m_list->setColumnCount(3);
+    m_list->setHeaderLabels(QStringList() << i18n("Subsystem") << i18n("Usage") << i18n("Budget"));
+    m_list->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_list->header()->setStretchLastSection(false);
+    lay->addWidget(m_list);
+    setLayout(lay);
+    m_refreshTimer.setInterval(REFRESH_INTERVAL);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &MemoryUsage::refresh);
+    m_refreshTimer.start();
+    refresh();
+}
+
+void MemoryUsage::refresh()
+{
+    m_list->clear();
+    qint64 accounted = 0;
+    foreach (const MemoryTracker::Usage &item, MemoryTracker::self()->usage()) {
+        QTreeWidgetItem *row = new QTreeWidgetItem(m_list, QStringList() << item.label << KIO::convertSize(item.usage) << (item.budget > 0 ? KIO::convertSize(item.budget) : i18n("No limit")));
+        if (item.budget > 0 && item.usage > item.budget) {
+            row->setForeground(1, palette().brush(QPalette::Link));
+        }
+        accounted += item.usage;
+    }
+    const qint64 resident = MemoryTracker::residentMemory();
+    if (resident < 0) {
+        m_resident->setText(i18n("Memory used by the listed subsystems: %1", KIO::convertSize(accounted)));
+        return;
+    }
+    m_resident->setText(i18n("Memory used by Kdenlive: %1", KIO::convertSize(resident)));
+    // Producers, decoded frames, monitor and scope images are not registered
+    new QTreeWidgetItem(m_list, QStringList() << i18n("Other (producers, frames, images)") << KIO::convertSize(qMax((qint64) 0, resident - accounted)) << QString());
+}
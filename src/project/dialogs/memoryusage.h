@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <QTimer>
+#include <QWidget>
+
+class QLabel;
+class QTreeWidget;
+
+/**
+ * @class MemoryUsage
+ * @brief Shows the memory used by each subsystem registered in MemoryTracker and their budgets.
+ */
+class MemoryUsage : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryUsage(QWidget *parent = 0);
+
+private:
+    QTreeWidget *m_list;
+    QLabel *m_resident;
+    QTimer m_refreshTimer;
+
+private slots:
+    void refresh();
+};
+
+#endif
@@ -33,6 +33,7 @@
 #include "project/dialogs/temporarydata.h"
 #include "project/dialogs/profilewidget.h"
 #include "bin/bin.h"
+#include "project/projectresources.h"
 
 #include <KMessageBox>
 #include <QDebug>
@@ -314,9 +315,9 @@ void ProjectSettings::slotUpdateFiles(bool cacheOnly)
             // ignore color clips in list, there is no real file
             continue;
         }
+        ProjectResources::ClipResources resources = ProjectResources::clipResources(clip);
         if (clip->clipType() == SlideShow) {
-            QStringList subfiles = extractSlideshowUrls(clip->clipUrl());
-            foreach(const QString & file, subfiles) {
+            foreach(const QString & file, resources.files) {
                 count++;
                 new QTreeWidgetItem(slideshows, QStringList() << file);
             }
@@ -346,16 +347,13 @@ void ProjectSettings::slotUpdateFiles(bool cacheOnly)
             count++;
         }
         if (clip->clipType() == Text) {
-            QStringList imagefiles = TitleWidget::extractImageList(clip->property(QStringLiteral("xmldata")));
-            QStringList fonts = TitleWidget::extractFontList(clip->property(QStringLiteral("xmldata")));
-            foreach(const QString & file, imagefiles) {
+            foreach(const QString & file, resources.files) {
                 count++;
                 new QTreeWidgetItem(images, QStringList() << file);
             }
-            allFonts << fonts;
+            allFonts << resources.fonts;
         } else if (clip->clipType() == Playlist) {
-            QStringList files = extractPlaylistUrls(clip->clipUrl().path());
-            foreach(const QString & file, files) {
+            foreach(const QString & file, resources.files) {
                 count++;
                 new QTreeWidgetItem(others, QStringList() << file);
             }
@@ -23,9 +23,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "temporarydata.h"
 #include "doc/kdenlivedoc.h"
 #include "utils/KoIconUtils.h"
+#include "doc/thumbnailcache.h"
+#include "doc/proxystore.h"
+#include "doc/cacheindex.h"
+#include "kdenlivesettings.h"
+#include "core.h"
 
 #include <KLocalizedString>
-#include <KIO/DirectorySizeJob>
+#include <KIO/Global>
 #include <KMessageBox>
 
 #include <QVBoxLayout>
@@ -41,6 +46,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDesktopServices>
 #include <QTreeWidget>
 #include <QPushButton>
+#include <QSpinBox>
+#include <QtConcurrent>
 
 static QList <QColor> chartColors;
 
@@ -88,6 +95,7 @@ TemporaryData::TemporaryData(KdenliveDoc *doc, bool currentProjectOnly, QWidget
     , m_doc(doc)
     , m_globalPage(NULL)
     , m_globalDelete(NULL)
+    , m_budget(NULL)
 {
     chartColors << QColor(Qt::darkRed) << QColor(Qt::darkBlue)  << QColor(Qt::darkGreen) << QColor(Qt::darkMagenta);
     mCurrentSizes << 0 << 0 << 0 << 0;
@@ -205,6 +213,7 @@ TemporaryData::TemporaryData(KdenliveDoc *doc, bool currentProjectOnly, QWidget
         lay->addWidget(tab);
     }
     setLayout(lay);
+    connect(&m_indexWatcher, &QFutureWatcher<void>::finished, this, &TemporaryData::updateDataInfo);
     updateDataInfo();
 }
 
@@ -217,10 +226,30 @@ void TemporaryData::updateDataInfo()
         m_currentPage->setEnabled(false);
         return;
     }
+    // Folders missing in the cache index are scanned once
+    const QString documentId = preview.dirName();
+    QStringList missing;
+    if (!CacheIndex::isIndexed(documentId)) {
+        missing << documentId;
+    }
+    if (m_globalPage) {
+        foreach(const QString &folder, CacheIndex::projects()) {
+            if (!missing.contains(folder) && !CacheIndex::isIndexed(folder)) {
+                missing << folder;
+            }
+        }
+    }
+    if (!missing.isEmpty()) {
+        if (!m_indexWatcher.isRunning()) {
+            m_currentSize->setText(i18n("Counting..."));
+            m_indexWatcher.setFuture(QtConcurrent::run(CacheIndex::rebuild, missing));
+        }
+        return;
+    }
+
     preview = m_doc->getCacheDir(CachePreview, &ok);
     if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotPreviewSize);
+        gotPreviewSize(CacheIndex::size(documentId, CachePreview));
     }
 
     preview = m_doc->getCacheDir(CacheProxy, &ok);
@@ -236,25 +265,18 @@ void TemporaryData::updateDataInfo()
 
     preview = m_doc->getCacheDir(CacheAudio, &ok);
     if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotAudioSize);
+        gotAudioSize(CacheIndex::size(documentId, CacheAudio));
     }
     preview = m_doc->getCacheDir(CacheThumbs, &ok);
     if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotThumbSize);
+        gotThumbSize(CacheIndex::size(documentId, CacheThumbs));
     }
     if (m_globalPage)
         updateGlobalInfo();
 }
 
-void TemporaryData::gotPreviewSize(KJob *job)
+void TemporaryData::gotPreviewSize(qint64 total)
 {
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *> (job);
-    qulonglong total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
     QLayoutItem *button = m_grid->itemAtPosition(0, 4);
     if (button && button->widget()) {
         button->widget()->setEnabled(total > 0);
@@ -277,13 +299,8 @@ void TemporaryData::gotProxySize(qint64 total)
     updateTotal();
 }
 
-void TemporaryData::gotAudioSize(KJob *job)
+void TemporaryData::gotAudioSize(qint64 total)
 {
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *> (job);
-    qulonglong total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
     QLayoutItem *button = m_grid->itemAtPosition(2, 4);
     if (button && button->widget()) {
         button->widget()->setEnabled(total > 0);
@@ -294,13 +311,8 @@ void TemporaryData::gotAudioSize(KJob *job)
     updateTotal();
 }
 
-void TemporaryData::gotThumbSize(KJob *job)
+void TemporaryData::gotThumbSize(qint64 total)
 {
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *> (job);
-    qulonglong total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
     QLayoutItem *button = m_grid->itemAtPosition(3, 4);
     if (button && button->widget()) {
         button->widget()->setEnabled(total > 0);
@@ -308,6 +320,7 @@ void TemporaryData::gotThumbSize(KJob *job)
     m_totalCurrent += total;
     mCurrentSizes[3] = total;
     m_thumbSize->setText(KIO::convertSize(total));
+    m_thumbSize->setToolTip(pCore->thumbnailCache()->statistics());
     updateTotal();
 }
 
@@ -341,6 +354,7 @@ void TemporaryData::deletePreview()
     }
     if (dir.dirName() == QLatin1String("preview")) {
         dir.removeRecursively();
+        CacheIndex::folderRemoved(dir.absolutePath());
         dir.mkpath(".");
         emit disablePreview();
         updateDataInfo();
@@ -360,7 +374,7 @@ void TemporaryData::deleteProxy()
             return;
     }
     foreach(const QString &file, files) {
-        dir.remove(file);
+        CacheIndex::removeFile(dir.absoluteFilePath(file));
     }
     emit disableProxies();
     updateDataInfo();
@@ -378,6 +392,7 @@ void TemporaryData::deleteAudio()
     }
     if (dir.dirName() == QLatin1String("audiothumbs")) {
         dir.removeRecursively();
+        CacheIndex::folderRemoved(dir.absolutePath());
         dir.mkpath(".");
         updateDataInfo();
     }
@@ -395,7 +410,9 @@ void TemporaryData::deleteThumbs()
     }
     if (dir.dirName() == QLatin1String("videothumbs")) {
         dir.removeRecursively();
+        CacheIndex::folderRemoved(dir.absolutePath());
         dir.mkpath(".");
+        pCore->thumbnailCache()->clear();
         updateDataInfo();
     }
 }
@@ -414,6 +431,7 @@ void TemporaryData::deleteCurrentCacheData()
         emit disablePreview();
         emit disableProxies();
         dir.removeRecursively();
+        CacheIndex::folderRemoved(dir.absolutePath());
         m_doc->initCacheDirs();
         updateDataInfo();
     }
@@ -436,7 +454,7 @@ void TemporaryData::buildGlobalCacheDialog(int minHeight)
     lay->addWidget(m_globalPie, 0, 0, 1, 1);
     m_listWidget = new QTreeWidget(this);
     m_listWidget->setColumnCount(3);
-    m_listWidget->setHeaderLabels(QStringList() << i18n("Folder") << i18n("Size") << i18n("Date"));
+    m_listWidget->setHeaderLabels(QStringList() << i18n("Folder") << i18n("Size") << i18n("Last Used"));
     m_listWidget->setRootIsDecorated(false);
     m_listWidget->setAlternatingRowColors(true);
     m_listWidget->setSortingEnabled(true);
@@ -472,6 +490,31 @@ void TemporaryData::buildGlobalCacheDialog(int minHeight)
     connect(m_globalDelete, &QPushButton::clicked, this, &TemporaryData::deleteSelected);
     lay->addWidget(m_globalDelete, 2, 4, 1, 1);
 
+    // Proxy clips shared by all projects
+    lab = new QLabel(i18n("Shared Proxy Clips"), this);
+    lay->addWidget(lab, 3, 2, 1, 1);
+    m_storeSize = new QLabel(this);
+    lay->addWidget(m_storeSize, 3, 3, 1, 1);
+    m_storeCleanup = new QPushButton(i18n("Remove least recently used"), this);
+    m_storeCleanup->setToolTip(i18n("Remove the oldest proxy clips not used by the current project, until the store fits in half of its size limit"));
+    connect(m_storeCleanup, &QPushButton::clicked, this, &TemporaryData::cleanupProxyStore);
+    lay->addWidget(m_storeCleanup, 3, 4, 1, 1);
+
+    // Size limit of the cache data of all projects
+    lab = new QLabel(i18n("Cache Size Limit"), this);
+    lay->addWidget(lab, 4, 2, 1, 1);
+    m_budget = new QSpinBox(this);
+    m_budget->setRange(0, 100000000);
+    m_budget->setSingleStep(1024);
+    m_budget->setSuffix(i18n(" MB"));
+    m_budget->setSpecialValueText(i18n("No limit"));
+    m_budget->setValue(KdenliveSettings::cachebudget());
+    lay->addWidget(m_budget, 4, 3, 1, 1);
+    QPushButton *evict = new QPushButton(i18n("Apply limit"), this);
+    evict->setToolTip(i18n("Remove the cache of the least recently used projects until all projects fit in the limit. The limit is also applied when opening a project"));
+    connect(evict, &QPushButton::clicked, this, &TemporaryData::evictProjects);
+    lay->addWidget(evict, 4, 4, 1, 1);
+
     lay->setColumnStretch(4, 10);
     lay->setRowStretch(0, 10);
     connect(m_listWidget, &QTreeWidget::itemSelectionChanged, this, &TemporaryData::refreshGlobalPie);
@@ -489,33 +532,30 @@ void TemporaryData::updateGlobalInfo()
         return;
     }
     m_globalDir = preview;
-    m_globalDirectories.clear();
-    m_processingDirectory.clear();
-    m_globalDirectories = m_globalDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    processglobalDirectories();
+    int count = 0;
+    qint64 storeSize = ProxyStore::size(&count);
+    if (KdenliveSettings::proxystorelimit() > 0) {
+        m_storeSize->setText(i18np("%2 in %1 clip (limit %3)", "%2 in %1 clips (limit %3)", count, KIO::convertSize(storeSize), KIO::convertSize((qint64) KdenliveSettings::proxystorelimit() * 1048576)));
+    } else {
+        m_storeSize->setText(i18np("%2 in %1 clip", "%2 in %1 clips", count, KIO::convertSize(storeSize)));
+    }
+    m_storeCleanup->setEnabled(count > 0);
+    foreach(const QString &folder, CacheIndex::projects()) {
+        addFolderItem(folder);
+    }
+    m_globalSize->setText(KIO::convertSize(m_totalGlobal));
+    m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
     m_listWidget->blockSignals(false);
+    refreshGlobalPie();
 }
 
-void TemporaryData::processglobalDirectories()
-{
-    if (m_globalDirectories.isEmpty())
-        return;
-    m_processingDirectory = m_globalDirectories.takeFirst();
-    KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(m_globalDir.absoluteFilePath(m_processingDirectory)));
-    connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotFolderSize);
-}
-
-void TemporaryData::gotFolderSize(KJob *job)
+void TemporaryData::addFolderItem(const QString &folder)
 {
-    KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *> (job);
-    qulonglong total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
+    qulonglong total = CacheIndex::projectSize(folder);
     m_totalGlobal += total;
     TreeWidgetItem *item = new TreeWidgetItem(m_listWidget);
     // Check last save path for this cache folder
-    QDir dir(m_globalDir.absoluteFilePath(m_processingDirectory));
+    QDir dir(m_globalDir.absoluteFilePath(folder));
     QStringList filters;
     filters << QStringLiteral("*.kdenlive");
     QStringList str = dir.entryList(filters, QDir::Files | QDir::Hidden, QDir::Time);
@@ -523,33 +563,27 @@ void TemporaryData::gotFolderSize(KJob *job)
         QString path = QUrl::fromPercentEncoding(str.at(0).toUtf8());
         // Remove leading dot
         path.remove(0, 1);
-        item->setText(0, m_processingDirectory + QString(" (%1)").arg(QUrl::fromLocalFile(path).fileName()));
+        item->setText(0, folder + QString(" (%1)").arg(QUrl::fromLocalFile(path).fileName()));
         if (QFile::exists(path)) {
             item->setIcon(0, KoIconUtils::themedIcon("kdenlive"));
         } else {
             item->setIcon(0, KoIconUtils::themedIcon("dialog-close"));
         }
     } else {
-        item->setText(0, m_processingDirectory);
-        if (m_processingDirectory == QLatin1String("proxy")) {
+        item->setText(0, folder);
+        if (folder == QLatin1String("proxy")) {
             item->setIcon(0, KoIconUtils::themedIcon("kdenlive-show-video"));
         }
     }
-    item->setData(0, Qt::UserRole, m_processingDirectory);
+    item->setData(0, Qt::UserRole, folder);
     item->setText(1, KIO::convertSize(total));
-    QDateTime date = QFileInfo(dir.absolutePath()).lastModified();
+    QDateTime date = CacheIndex::lastUsed(folder);
     item->setText(2, date.toString(Qt::SystemLocaleShortDate));
     item->setData(1, Qt::UserRole, total);
     item->setData(2, Qt::UserRole, date);
     m_listWidget->addTopLevelItem(item);
     m_listWidget->resizeColumnToContents(0);
     m_listWidget->resizeColumnToContents(1);
-    if (m_globalDirectories.isEmpty()) {
-        m_globalSize->setText(KIO::convertSize(m_totalGlobal));
-        m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
-    } else {
-        processglobalDirectories();
-    }
 }
 
 void TemporaryData::refreshGlobalPie()
@@ -590,6 +624,7 @@ void TemporaryData::deleteSelected()
         }
         QDir toRemove(m_globalDir.absoluteFilePath(folder));
         toRemove.removeRecursively();
+        CacheIndex::folderRemoved(toRemove.absolutePath());
         if (folder == QLatin1String("proxy")) {
             // We deleted proxy folder, recreate it
             toRemove.mkpath(QStringLiteral("."));
@@ -597,3 +632,31 @@ void TemporaryData::deleteSelected()
     }
     updateGlobalInfo();
 }
+
+void TemporaryData::cleanupProxyStore()
+{
+    qint64 limit = (qint64) KdenliveSettings::proxystorelimit() * 1048576;
+    if (limit == 0) {
+        limit = ProxyStore::size();
+    }
+    // Proxies of the current project are always kept
+    int removed = ProxyStore::collectGarbage(limit / 2, m_doc->getProxyHashList());
+    if (removed == 0) {
+        KMessageBox::information(this, i18n("All shared proxy clips are used by the current project."));
+    }
+    updateDataInfo();
+}
+
+void TemporaryData::evictProjects()
+{
+    KdenliveSettings::setCachebudget(m_budget->value());
+    if (m_budget->value() == 0) {
+        return;
+    }
+    // The current project cache is always kept
+    const QStringList removed = CacheIndex::evict((qint64) m_budget->value() * 1048576, QStringList() << m_doc->getDocumentProperty(QStringLiteral("documentid")));
+    if (removed.isEmpty()) {
+        KMessageBox::information(this, i18n("No project cache was removed."));
+    }
+    updateGlobalInfo();
+}
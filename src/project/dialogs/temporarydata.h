@@ -26,14 +26,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QWidget>
 #include <QDir>
+#include <QFutureWatcher>
 
 class KdenliveDoc;
-class KJob;
 class QPaintEvent;
 class QLabel;
 class QGridLayout;
 class QTreeWidget;
 class QPushButton;
+class QSpinBox;
 
 /**
  * @class ChartWidget
@@ -109,23 +110,26 @@ private:
     qulonglong m_totalGlobal;
     QList <qulonglong> mCurrentSizes;
     QList <qulonglong> mGlobalSizes;
-    QStringList m_globalDirectories;
-    QString m_processingDirectory;
     QDir m_globalDir;
     QStringList m_proxies;
     QPushButton *m_globalDelete;
+    QLabel *m_storeSize;
+    QPushButton *m_storeCleanup;
+    QSpinBox *m_budget;
+    /** @brief Scans the cache folders missing in the cache index. */
+    QFutureWatcher<void> m_indexWatcher;
     void updateDataInfo();
     void updateGlobalInfo();
     void updateTotal();
     void buildGlobalCacheDialog(int minHeight);
-    void processglobalDirectories();
+    /** @brief Adds a cache folder to the list of all projects. */
+    void addFolderItem(const QString &folder);
 
 private slots:
-    void gotPreviewSize(KJob *job);
+    void gotPreviewSize(qint64 total);
     void gotProxySize(qint64 total);
-    void gotAudioSize(KJob *job);
-    void gotThumbSize(KJob *job);
-    void gotFolderSize(KJob *job);
+    void gotAudioSize(qint64 total);
+    void gotThumbSize(qint64 total);
     void refreshGlobalPie();
     void deletePreview();
     void deleteProxy();
@@ -134,6 +138,10 @@ private slots:
     void deleteCurrentCacheData();
     void openCacheFolder();
     void deleteSelected();
+    /** @brief Remove the least recently used proxies of the shared proxy store. */
+    void cleanupProxyStore();
+    /** @brief Remove the cache of the least recently used projects until the cache fits in the size limit. */
+    void evictProjects();
 
 signals:
     void disableProxies();
@@ -33,6 +33,7 @@ AbstractClipJob::AbstractClipJob(JOBTYPE type, ClipType cType, const QString &id
         m_jobStatus(NoJob),
         m_clipId(id),
         m_addClipToProject(-100),
+        m_threadBudget(0),
         m_jobProcess(NULL)
 {
 }
@@ -52,6 +53,16 @@ void AbstractClipJob::setAddClipToProject(int add)
     m_addClipToProject = add;
 }
 
+void AbstractClipJob::setThreadBudget(int threads)
+{
+    m_threadBudget = threads;
+}
+
+int AbstractClipJob::threadBudget() const
+{
+    return m_threadBudget;
+}
+
 void AbstractClipJob::setStatus(ClipJobStatus status)
 {
     m_jobStatus = status;
@@ -86,6 +97,12 @@ const QString AbstractClipJob::destination() const
     return QString();
 }
 
+QStringList AbstractClipJob::destinations() const
+{
+    const QString dest = destination();
+    return dest.isEmpty() ? QStringList() : QStringList(dest);
+}
+
 stringMap AbstractClipJob::cancelProperties()
 {
     return QMap <QString, QString>();
@@ -105,6 +122,16 @@ bool AbstractClipJob::isExclusive()
     return true;
 }
 
+AbstractClipJob::JOBRESOURCE AbstractClipJob::resource() const
+{
+    return CPURESOURCE;
+}
+
+AbstractClipJob::JOBPRIORITY AbstractClipJob::priority() const
+{
+    return NORMALPRIORITY;
+}
+
 
 
 
@@ -47,6 +47,17 @@ public:
         THUMBJOB = 5,
         ANALYSECLIPJOB = 6
     };
+    /** @brief The resource a job mostly uses, the job manager limits the number of jobs running on each one. */
+    enum JOBRESOURCE {
+        CPURESOURCE = 0,
+        DISKRESOURCE = 1,
+        GPURESOURCE = 2
+    };
+    enum JOBPRIORITY {
+        LOWPRIORITY = 0,
+        NORMALPRIORITY = 1,
+        HIGHPRIORITY = 2
+    };
     AbstractClipJob(JOBTYPE type, ClipType cType, const QString &id);
     virtual ~ AbstractClipJob();
     ClipType clipType;
@@ -59,14 +70,23 @@ public:
     ClipJobStatus status();
     virtual void setStatus(ClipJobStatus status);
     virtual const QString destination() const;
+    /** @brief Returns all the files created by the job, by default the destination */
+    virtual QStringList destinations() const;
     virtual void startJob();
     virtual stringMap cancelProperties();
     virtual void processLogInfo();
     virtual const QString statusMessage();
     /** @brief Returns true if only one instance of this job can be run on a clip. */
     virtual bool isExclusive();
+    /** @brief Returns the resource limiting this job, CPU by default. */
+    virtual JOBRESOURCE resource() const;
+    /** @brief Returns the scheduling priority of this job, batch jobs should use a low priority. */
+    virtual JOBPRIORITY priority() const;
     int addClipToProject() const;
     void setAddClipToProject(int add);
+    /** @brief Sets the number of threads the job's process may use, 0 for no limit. */
+    void setThreadBudget(int threads);
+    int threadBudget() const;
     
 protected:
     ClipJobStatus m_jobStatus;
@@ -74,6 +94,7 @@ protected:
     QString m_errorMessage;
     QString m_logDetails;
     int m_addClipToProject;
+    int m_threadBudget;
     QProcess *m_jobProcess;
     
 signals:
@@ -21,6 +21,7 @@
 #include "cutclipjob.h"
 #include "kdenlivesettings.h"
 #include "bin/projectclip.h"
+#include "bin/projectsubclip.h"
 #include "doc/kdenlivedoc.h"
 
 #include "ui_cutjobdialog_ui.h"
@@ -59,7 +60,18 @@ CutClipJob::CutClipJob(ClipType cType, const QString &id, const QStringList &par
         m_end = parameters.at(4);
         m_jobDuration = parameters.at(5).toInt();
         m_addClipToProject = parameters.at(6).toInt();
-        if (parameters.count() == 8) m_cutExtraParams = parameters.at(7).simplified();
+        if (parameters.count() > 7) m_cutExtraParams = parameters.at(7).simplified();
+        CutZone zone;
+        zone.start = m_start;
+        zone.duration = m_end;
+        zone.dest = m_dest;
+        m_zones << zone;
+        for (int i = 8; i + 2 < parameters.count(); i += 3) {
+            zone.dest = parameters.at(i);
+            zone.start = parameters.at(i + 1);
+            zone.duration = parameters.at(i + 2);
+            m_zones << zone;
+        }
     }
     else {
         m_jobDuration = parameters.at(3).toInt();
@@ -78,16 +90,23 @@ void CutClipJob::startJob()
             exec = KdenliveSettings::ffprobepath();
         } else {
             parameters << QStringLiteral("-i") << m_src;
-            if (!m_start.isEmpty())
-                parameters << QStringLiteral("-ss") << m_start <<QStringLiteral("-t") << m_end;
-            if (!m_cutExtraParams.isEmpty()) {
-                foreach(const QString &s, m_cutExtraParams.split(QLatin1Char(' ')))
-                    parameters << s;
-            }
+            // Each zone is a separate output of the same FFmpeg process, so the source is only read once
+            foreach(const CutZone &zone, m_zones) {
+                if (!zone.start.isEmpty())
+                    parameters << QStringLiteral("-ss") << zone.start <<QStringLiteral("-t") << zone.duration;
+                if (!m_cutExtraParams.isEmpty()) {
+                    foreach(const QString &s, m_cutExtraParams.split(QLatin1Char(' ')))
+                        parameters << s;
+                }
+                if (m_threadBudget > 0 && !m_cutExtraParams.contains(QLatin1String("-threads"))) {
+                    // Share the cores with the other jobs running in parallel
+                    parameters << QStringLiteral("-threads") << QString::number(m_threadBudget);
+                }
 
-            // Make sure we don't block when proxy file already exists
-            parameters << QStringLiteral("-y");
-            parameters << m_dest;
+                // Make sure we don't block when proxy file already exists
+                parameters << QStringLiteral("-y");
+                parameters << partialFile(zone.dest);
+            }
             exec = KdenliveSettings::ffmpegpath();
         }
         m_jobProcess = new QProcess;
@@ -106,7 +125,9 @@ void CutClipJob::startJob()
             if (m_jobStatus == JobAborted) {
                 m_jobProcess->close();
                 m_jobProcess->waitForFinished();
-                if (!m_dest.isEmpty()) QFile::remove(m_dest);
+                foreach(const QString &dest, destinations()) {
+                    QFile::remove(partialFile(dest));
+                }
             }
             m_jobProcess->waitForFinished(400);
         }
@@ -119,18 +140,30 @@ void CutClipJob::startJob()
                     processAnalyseLog();
                     setStatus(JobDone);
                 } else {
-                    if (QFileInfo(m_dest).size() == 0) {
-                        // File was not created
-                        processLogInfo();
-                        m_errorMessage.append(i18n("Failed to create file."));
-                        setStatus(JobCrashed);
-                    } else {
-                        setStatus(JobDone);
+                    processLogInfo();
+                    ClipJobStatus status = JobDone;
+                    foreach(const QString &dest, destinations()) {
+                        QString partial = partialFile(dest);
+                        if (QFileInfo(partial).size() == 0) {
+                            // File was not created
+                            QFile::remove(partial);
+                            m_errorMessage.append(i18n("Failed to create file."));
+                            status = JobCrashed;
+                        } else {
+                            QFile::remove(dest);
+                            if (!QFile::rename(partial, dest)) {
+                                m_errorMessage.append(i18n("Cannot write to path: %1", dest));
+                                status = JobCrashed;
+                            }
+                        }
                     }
+                    setStatus(status);
                 }
             } else if (result == QProcess::CrashExit) {
                 // Proxy process crashed
-                if (!m_dest.isEmpty()) QFile::remove(m_dest);
+                foreach(const QString &dest, destinations()) {
+                    QFile::remove(partialFile(dest));
+                }
                 setStatus(JobCrashed);
             }
         }
@@ -188,6 +221,18 @@ const QString CutClipJob::destination() const
     return m_dest;
 }
 
+QStringList CutClipJob::destinations() const
+{
+    if (m_zones.isEmpty()) {
+        return AbstractClipJob::destinations();
+    }
+    QStringList result;
+    foreach(const CutZone &zone, m_zones) {
+        result << zone.dest;
+    }
+    return result;
+}
+
 stringMap CutClipJob::cancelProperties()
 {
     QMap <QString, QString> props;
@@ -219,6 +264,23 @@ bool CutClipJob::isExclusive()
     return false;
 }
 
+AbstractClipJob::JOBRESOURCE CutClipJob::resource() const
+{
+    if (jobType == AbstractClipJob::CUTJOB && m_cutExtraParams.contains(QLatin1String("-vcodec copy")) && m_cutExtraParams.contains(QLatin1String("-acodec copy"))) {
+        // Stream copy, mostly reading and writing the file
+        return DISKRESOURCE;
+    }
+    return CPURESOURCE;
+}
+
+// static
+const QString CutClipJob::partialFile(const QString &dest)
+{
+    // Keep the extension, FFmpeg guesses the output format from it
+    QFileInfo info(dest);
+    return info.absolutePath() + QStringLiteral("/.") + info.completeBaseName() + QStringLiteral(".part.") + info.suffix();
+}
+
 // static 
 QList <ProjectClip *> CutClipJob::filterClips(QList <ProjectClip *>clips, const QStringList &params)
 {
@@ -269,12 +331,21 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareCutClipJob(double fp
     Ui::CutJobDialog_UI ui;
     ui.setupUi(d);
     ui.extra_params->setVisible(false);
+    ui.replace_clip->setVisible(false);
     ui.add_clip->setChecked(KdenliveSettings::add_new_clip());
     ui.file_url->setMode(KFile::File);
     ui.extra_params->setMaximumHeight(QFontMetrics(QApplication::font()).lineSpacing() * 5);
     ui.file_url->setUrl(QUrl(dest));
     ui.button_more->setIcon(QIcon::fromTheme(QStringLiteral("configure")));
     ui.extra_params->setPlainText(QStringLiteral("-acodec copy -vcodec copy"));
+    // Zones defined in the bin can be extracted in the same pass
+    QList <QPoint> subZones;
+    for (int i = 0; i < clip->count(); ++i) {
+        QPoint subZone = static_cast<ProjectSubClip *>(clip->at(i))->zone();
+        if (subZone != zone) subZones << subZone;
+    }
+    ui.all_zones->setVisible(!subZones.isEmpty());
+    ui.all_zones->setText(i18np("Also extract the clip zone", "Also extract the %1 clip zones", subZones.count()));
     QString mess = i18n("Extracting %1 out of %2", Timecode::getStringTimecode(duration, fps, true), Timecode::getStringTimecode(max, fps, true));
     ui.info_label->setText(mess);
     if (d->exec() != QDialog::Accepted) {
@@ -303,14 +374,33 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareCutClipJob(double fp
     }
     QString extraParams = ui.extra_params->toPlainText().simplified();
     KdenliveSettings::setAdd_new_clip(ui.add_clip->isChecked());
+    if (!ui.all_zones->isChecked()) {
+        subZones.clear();
+    }
     delete d;
 
+    QStringList zoneParams;
+    QStringList existing;
+    const QString zoneBase = QFileInfo(dest).absolutePath() + QLatin1Char('/') + QFileInfo(source).completeBaseName() + QLatin1Char('_');
+    foreach(const QPoint &subZone, subZones) {
+        QString zoneDest = zoneBase + QString::number(subZone.x()) + QLatin1Char('.') + ext;
+        if (zoneDest == source || zoneDest == dest) continue;
+        if (QFileInfo(zoneDest).size() > 0) existing << zoneDest;
+        int zoneDuration = subZone.y() - subZone.x() - 1;
+        zoneParams << zoneDest << QString::number(GenTime(subZone.x(), originalFps).ms() / 1000) << QString::number(GenTime(zoneDuration, originalFps).ms() / 1000);
+        duration += zoneDuration;
+    }
+    if (!existing.isEmpty() && KMessageBox::questionYesNoList(QApplication::activeWindow(), i18n("Overwrite existing files?"), existing) != KMessageBox::Yes) {
+        return jobs;
+    }
+
     QStringList jobParams;
     jobParams << QString::number((int) AbstractClipJob::CUTJOB);
     jobParams << dest << source << timeIn << timeOut << QString::number(duration);
     // parent folder, or -100 if we don't want to add clip to project
     jobParams << (KdenliveSettings::add_new_clip() ? clip->parent()->clipId() : QString::number(-100));
-    if (!extraParams.isEmpty()) jobParams << extraParams;
+    if (!extraParams.isEmpty() || !zoneParams.isEmpty()) jobParams << extraParams;
+    jobParams << zoneParams;
     CutClipJob *job = new CutClipJob(clip->clipType(), clip->clipId(), jobParams);
     jobs.insert(clip, job);
     return jobs;
@@ -337,13 +427,27 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareTranscodeJob(double
         if (QFile::exists(newFile)) existingFiles << newFile;
     }
     if (!existingFiles.isEmpty()) {
-        if (KMessageBox::warningContinueCancelList(QApplication::activeWindow(), i18n("The transcoding job will overwrite the following files:"), existingFiles) ==  KMessageBox::Cancel) return jobs;
+        // Jobs only create their destination once done, so existing files are complete and an interrupted batch can be resumed by skipping them
+        int answer = KMessageBox::warningYesNoCancelList(QApplication::activeWindow(), i18n("The following files were already transcoded:"), existingFiles, i18n("Transcoding"), KGuiItem(i18n("Overwrite")), KGuiItem(i18n("Skip Existing Files")));
+        if (answer == KMessageBox::Cancel) return jobs;
+        if (answer == KMessageBox::No) {
+            for (int i = 0; i < clips.count(); i++) {
+                if (existingFiles.contains(destinations.at(i))) {
+                    clips.removeAt(i);
+                    sources.removeAt(i);
+                    destinations.removeAt(i);
+                    --i;
+                }
+            }
+            if (clips.isEmpty()) return jobs;
+        }
     }
 
     QPointer<QDialog> d = new QDialog(QApplication::activeWindow());
     Ui::CutJobDialog_UI ui;
     ui.setupUi(d);
     d->setWindowTitle(i18n("Transcoding"));
+    ui.all_zones->setVisible(false);
     ui.extra_params->setMaximumHeight(QFontMetrics(qApp->font()).lineSpacing() * 5);
     if (clips.count() == 1) {
         ui.file_url->setUrl(QUrl(destinations.first()));
@@ -357,6 +461,9 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareTranscodeJob(double
     ui.button_more->setIcon(QIcon::fromTheme(QStringLiteral("configure")));
     connect(ui.button_more, SIGNAL(toggled(bool)), ui.extra_params, SLOT(setVisible(bool)));
     ui.add_clip->setChecked(KdenliveSettings::add_new_clip());
+    ui.replace_clip->setChecked(KdenliveSettings::transcodereplace());
+    ui.add_clip->setEnabled(!ui.replace_clip->isChecked());
+    connect(ui.replace_clip, SIGNAL(toggled(bool)), ui.add_clip, SLOT(setDisabled(bool)));
     ui.extra_params->setPlainText(params.simplified().section(' ', 0, -2));
     QString mess = desc;
     mess.append(' ' + i18np("(%1 clip)", "(%1 clips)", clips.count()));
@@ -367,6 +474,7 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareTranscodeJob(double
     }
     params = ui.extra_params->toPlainText().simplified();
     KdenliveSettings::setAdd_new_clip(ui.add_clip->isChecked());
+    KdenliveSettings::setTranscodereplace(ui.replace_clip->isChecked());
     for (int i = 0; i < clips.count(); i++) {
         ProjectClip *item = clips.at(i);
         QString src = sources.at(i);
@@ -380,9 +488,10 @@ QHash <ProjectClip *, AbstractClipJob *> CutClipJob::prepareTranscodeJob(double
         jobParams << dest << src << QString() << QString();
         jobParams << QString::number((int) item->duration().frames(fps));
         // parent folder, or -100 if we don't want to add clip to project
-        jobParams << (KdenliveSettings::add_new_clip() ? item->parent()->clipId() : QString::number(-100));
+        jobParams << (KdenliveSettings::add_new_clip() && !KdenliveSettings::transcodereplace() ? item->parent()->clipId() : QString::number(-100));
         jobParams << params;
         CutClipJob *job = new CutClipJob(item->clipType(), item->clipId(), jobParams);
+        job->replaceClip = KdenliveSettings::transcodereplace();
         jobs.insert(item, job);
     }
     delete d;
@@ -43,25 +43,38 @@ public:
      *  @param cType the Clip Type (AV, PLAYLIST, AUDIO, ...) as defined in definitions.h. Some jobs will act differently depending on clip type
      *  @param id the id of the clip that requested this clip job
      *  @param parameters StringList that should contain: destination file << source file << in point (optional) << out point (optional)
+     *  A cut job can extract more zones in the same pass, each given as destination file << in point << duration after the extra parameters
      * */
     CutClipJob(ClipType cType, const QString &id, const QStringList &parameters);
     virtual ~ CutClipJob();
     const QString destination() const;
+    QStringList destinations() const;
     void startJob();
     stringMap cancelProperties();
     const QString statusMessage();
     bool isExclusive();
+    JOBRESOURCE resource() const;
     static QHash <ProjectClip *, AbstractClipJob *> prepareTranscodeJob(double fps, QList <ProjectClip *> ids,  QStringList parameters);
     static QHash <ProjectClip *, AbstractClipJob *> prepareCutClipJob(double fps, double originalFps, ProjectClip *clip);
     static QHash <ProjectClip *, AbstractClipJob *> prepareAnalyseJob(double fps, QList <ProjectClip*> clips, QStringList parameters);
     static QList <ProjectClip *> filterClips(QList <ProjectClip *>clips, const QStringList &params);
+    /** @brief Returns the file FFmpeg writes to until the job is done, so that an interrupted job never leaves a destination that looks complete. */
+    static const QString partialFile(const QString &dest);
 
 private:
+    /** @brief A part of the source written to its own file */
+    struct CutZone {
+        QString start;
+        QString duration;
+        QString dest;
+    };
     QString m_dest;
     QString m_src;
     QString m_start;
     QString m_end;
     QString m_cutExtraParams;
+    /** @brief All zones extracted by a cut job, the first one being m_start / m_end to m_dest */
+    QList <CutZone> m_zones;
     int m_jobDuration;
 
     void processLogInfo();
@@ -20,6 +20,9 @@
 
 #include "filterjob.h"
 #include "meltjob.h"
+#include "segmentedjob.h"
+#include "scenecutjob.h"
+#include "stabilizejob.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
 #include "bin/projectclip.h"
@@ -128,7 +131,7 @@ QHash <ProjectClip *, AbstractClipJob *> FilterJob::prepareJob(QList <ProjectCli
         QMap <QString, QString> consumerParams = QMap <QString, QString> ();
 
         // Producer params
-        // None
+        // None, fast detection tunes the decoder below
 
         // Filter params, use a smaller region of the image to speed up operation
         // In fact, it's faster to rescale whole image than using part of it (bounding=\"25%x25%:15%x15\")
@@ -170,6 +173,10 @@ QHash <ProjectClip *, AbstractClipJob *> FilterJob::prepareJob(QList <ProjectCli
             // We want to cut scenes
             extraParams.insert(QStringLiteral("cutscenes"), QStringLiteral("1"));
         }
+        bool fastDetection = ui.fast_detection->isChecked();
+        if (fastDetection) {
+            producerParams = SceneCutJob::decoderParams(ui.keyframes_only->isChecked());
+        }
         delete d;
 
         for (int i = 0; i < clips.count(); i++) {
@@ -191,11 +198,58 @@ QHash <ProjectClip *, AbstractClipJob *> FilterJob::prepareJob(QList <ProjectCli
 
             // Destination
             // Since this job is only doing analysis, we have a null consumer and no destination
-            MeltJob *job = new MeltJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+            // Shot changes only depend on neighbour frames, the clip can be analysed in segments
+            MeltJob *job;
+            if (fastDetection) {
+                job = new SceneCutJob(clip->clipType(), clip->clipId(), producerParams, extraParams);
+            } else {
+                job = new SegmentedJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+            }
             job->description = i18n("Auto split");
             jobs.insert(clip, job);
         }
         return jobs;
+    } else if (filterName == QLatin1String("loudness")) {
+        // EBU R128 loudness analysis, the results are stored in the clip and applied through a loudness effect
+        QMap <QString, QString> producerParams = QMap <QString, QString> ();
+        QMap <QString, QString> filterParams = QMap <QString, QString> ();
+        QMap <QString, QString> consumerParams = QMap <QString, QString> ();
+
+        // Producer params, only the audio stream is needed
+        producerParams.insert(QStringLiteral("video_index"), QStringLiteral("-1"));
+        producerParams.insert(QStringLiteral("in"), QStringLiteral("0"));
+        producerParams.insert(QStringLiteral("out"), QStringLiteral("-1"));
+
+        // Filter params
+        filterParams.insert(QStringLiteral("filter"), filterName);
+
+        // Consumer, no image is ever requested and frames are pulled as fast as possible
+        consumerParams.insert(QStringLiteral("consumer"), QStringLiteral("null"));
+        consumerParams.insert(QStringLiteral("video_off"), QStringLiteral("1"));
+        consumerParams.insert(QStringLiteral("all"), QStringLiteral("1"));
+        consumerParams.insert(QStringLiteral("terminate_on_pause"), QStringLiteral("1"));
+        consumerParams.insert(QStringLiteral("real_time"), QStringLiteral("-1"));
+
+        // Extra
+        QMap <QString, QString> extraParams;
+        extraParams.insert(QStringLiteral("key"), QStringLiteral("results"));
+        extraParams.insert(QStringLiteral("finalfilter"), filterName);
+        extraParams.insert(QStringLiteral("storedata"), QStringLiteral("1"));
+        extraParams.insert(QStringLiteral("dataname"), QStringLiteral("loudness"));
+        extraParams.insert(QStringLiteral("normalize"), QStringLiteral("1"));
+
+        for (int i = 0; i < clips.count(); i++) {
+            ProjectClip *clip = clips.at(i);
+            if (clip->clipType() == Video) {
+                // No audio to analyse
+                continue;
+            }
+            producerParams.insert(QStringLiteral("producer"), sources.at(i));
+            MeltJob *job = new MeltJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+            job->description = i18n("Loudness analysis");
+            jobs.insert(clip, job);
+        }
+        return jobs;
     } else if (filterName == QLatin1String("vidstab") || filterName == QLatin1String("videostab2") || filterName == QLatin1String("videostab")) {
         // vidstab
         int out = 100000;
@@ -243,7 +297,12 @@ QHash <ProjectClip *, AbstractClipJob *> FilterJob::prepareJob(QList <ProjectCli
                 consumerParams.insert(QStringLiteral("real_time"), QStringLiteral("-1"));
                 // Append a 'filename' parameter for saving vidstab data
                 filterParams.insert(QStringLiteral("filename"), trffile.path());
-                MeltJob *job = new MeltJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+                MeltJob *job;
+                if (d->splitAnalysis() && StabilizeJob::canSplit(filterParams)) {
+                    job = new StabilizeJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+                } else {
+                    job = new MeltJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
+                }
                 job->setAddClipToProject(d->autoAddClip() ?  clip->parent()->clipId().toInt() : -100);
                 job->description = d->desc();
                 jobs.insert(clip, job);
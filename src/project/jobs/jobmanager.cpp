@@ -28,14 +28,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bin/projectclip.h"
 #include "project/clipstabilize.h"
 #include "meltjob.h"
+#include "segmentedjob.h"
 #include "filterjob.h"
 #include "bin/bin.h"
+#include "utils/tracer.h"
 #include "mlt++/Mlt.h"
 
 #include <QProcess>
 #include <QDialog>
 #include <QDebug>
 #include <QtConcurrent>
+#include <QThread>
 
 #include <KMessageWidget>
 #include <klocalizedstring.h>
@@ -46,6 +49,11 @@ JobManager::JobManager(Bin *bin): QObject()
   , m_bin(bin)
   , m_abortAllJobs(false)
 {
+    for (int i = 0; i < JOB_RESOURCES; ++i) {
+        m_workers[i] = 0;
+    }
+    // Job workers wait for their segments, they must never take the segment threads
+    m_segmentPool.setMaxThreadCount(QThread::idealThreadCount());
     connect(this, SIGNAL(processLog(QString,int,int,QString)), this, SLOT(slotProcessLog(QString,int,int,QString)));
     connect(this, SIGNAL(checkJobProcess()), this, SLOT(slotCheckJobProcess()));
 }
@@ -60,12 +68,40 @@ JobManager::~JobManager()
     m_jobThreads.clearFutures();
     if (!m_jobList.isEmpty()) qDeleteAll(m_jobList);
     m_jobList.clear();
+    for (int i = 0; i < JOB_RESOURCES; ++i) {
+        for (int j = 0; j < JOB_PRIORITIES; ++j) {
+            m_queues[i][j].clear();
+        }
+    }
 }
 
 void JobManager::slotProcessLog(const QString &id, int progress, int type, const QString &message)
 {
     ProjectClip *item = m_bin->getBinClip(id);
     item->setJobStatus((AbstractClipJob::JOBTYPE) type, JobWorking, progress, message);
+    QMutexLocker lock(&m_jobMutex);
+    for (int i = 0; i < m_jobList.count(); ++i) {
+        AbstractClipJob *job = m_jobList.at(i);
+        if (job->clipId() == id && job->jobType == type && job->status() == JobWorking) {
+            m_jobProgress.insert(job, qBound(0, progress, 100));
+            break;
+        }
+    }
+    updateJobProgress();
+}
+
+void JobManager::updateJobProgress()
+{
+    int count = 0;
+    int progress = 0;
+    for (int i = 0; i < m_jobList.count(); ++i) {
+        AbstractClipJob *job = m_jobList.at(i);
+        if (job->status() == JobWaiting || job->status() == JobWorking) {
+            count++;
+            progress += m_jobProgress.value(job, 0);
+        }
+    }
+    emit jobsProgress(count > 0 ? progress / count : 0);
 }
 
 QStringList JobManager::getPendingJobs(const QString &id)
@@ -128,13 +164,101 @@ void JobManager::slotCheckJobProcess()
         } else {
             // remove finished jobs
             AbstractClipJob *job = m_jobList.takeAt(i);
+            m_jobProgress.remove(job);
+            for (int j = 0; j < JOB_PRIORITIES; ++j) {
+                // Aborted jobs may still be queued
+                m_queues[job->resource()][j].removeOne(job);
+            }
             job->deleteLater();
             --i;
         }
     }
+    // Start a thread for each resource that has waiting jobs and is below its limit
+    for (int i = 0; i < JOB_RESOURCES; ++i) {
+        int waiting = 0;
+        for (int j = 0; j < JOB_PRIORITIES; ++j) {
+            waiting += m_queues[i][j].count();
+        }
+        int limit = resourceLimit(i);
+        while (waiting > 0 && m_workers[i] < limit) {
+            m_workers[i]++;
+            waiting--;
+            m_jobThreads.addFuture(QtConcurrent::run(this, &JobManager::processJobs, i));
+        }
+    }
     m_jobMutex.unlock();
     emit jobCount(count);
-    if (m_jobThreads.futures().isEmpty() || m_jobThreads.futures().count() < KdenliveSettings::proxythreads()) m_jobThreads.addFuture(QtConcurrent::run(this, &JobManager::slotProcessJobs));
+}
+
+int JobManager::resourceLimit(int resource)
+{
+    int limit;
+    switch (resource) {
+        case AbstractClipJob::DISKRESOURCE:
+            limit = KdenliveSettings::diskjobthreads();
+            break;
+        case AbstractClipJob::GPURESOURCE:
+            limit = KdenliveSettings::gpujobthreads();
+            break;
+        default:
+            limit = KdenliveSettings::proxythreads();
+            break;
+    }
+    return qMax(1, limit);
+}
+
+int JobManager::threadBudget(int resource)
+{
+    return qMax(1, QThread::idealThreadCount() / resourceLimit(resource));
+}
+
+void JobManager::enqueueJob(AbstractClipJob *job)
+{
+    int priority = job->clipId() == m_visibleClipId ? AbstractClipJob::HIGHPRIORITY : job->priority();
+    m_queues[job->resource()][priority].append(job);
+}
+
+AbstractClipJob *JobManager::dequeueJob(int resource)
+{
+    for (int i = JOB_PRIORITIES - 1; i >= 0; --i) {
+        QList <AbstractClipJob *> &queue = m_queues[resource][i];
+        while (!queue.isEmpty()) {
+            // Discarded jobs stay in the queue until they are reached
+            AbstractClipJob *job = queue.takeFirst();
+            if (job->status() == JobWaiting) {
+                return job;
+            }
+        }
+    }
+    return NULL;
+}
+
+void JobManager::setVisibleClip(const QString &id)
+{
+    QMutexLocker lock(&m_jobMutex);
+    if (id == m_visibleClipId) return;
+    m_visibleClipId = id;
+    // Move the waiting jobs of the clip to the high priority queues, and previous clip's jobs back
+    for (int i = 0; i < JOB_RESOURCES; ++i) {
+        QList <AbstractClipJob *> &high = m_queues[i][AbstractClipJob::HIGHPRIORITY];
+        for (int j = 0; j < high.count(); ++j) {
+            AbstractClipJob *job = high.at(j);
+            if (job->clipId() != id && job->priority() != AbstractClipJob::HIGHPRIORITY) {
+                high.removeAt(j);
+                --j;
+                m_queues[i][job->priority()].append(job);
+            }
+        }
+        for (int j = 0; j < AbstractClipJob::HIGHPRIORITY; ++j) {
+            QList <AbstractClipJob *> &queue = m_queues[i][j];
+            for (int k = 0; k < queue.count(); ++k) {
+                if (queue.at(k)->clipId() == id) {
+                    high.append(queue.takeAt(k));
+                    --k;
+                }
+            }
+        }
+    }
 }
 
 void JobManager::updateJobCount()
@@ -145,21 +269,19 @@ void JobManager::updateJobCount()
             count ++;
     }
     // Set jobs count
+    Tracer::setCounter("Clip jobs", count);
     emit jobCount(count);
+    updateJobProgress();
 }
 
-void JobManager::slotProcessJobs()
+void JobManager::processJobs(int resource)
 {
     bool firstPass = true;
-    while (!m_jobList.isEmpty() && !m_abortAllJobs) {
-        AbstractClipJob *job = NULL;
+    while (!m_abortAllJobs) {
         m_jobMutex.lock();
-        for (int i = 0; i < m_jobList.count(); ++i) {
-            if (m_jobList.at(i)->status() == JobWaiting) {
-                job = m_jobList.at(i);
-                job->setStatus(JobWorking);
-                break;
-            }
+        AbstractClipJob *job = dequeueJob(resource);
+        if (job) {
+            job->setStatus(JobWorking);
         }
         if (!firstPass) {
             updateJobCount();
@@ -208,20 +330,39 @@ void JobManager::slotProcessJobs()
         if (job->jobType == AbstractClipJob::MLTJOB || job->jobType == AbstractClipJob::ANALYSECLIPJOB) {
             connect(job, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)), this, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)));
         }
-        job->startJob();
+        SegmentedJob *segmentedJob = qobject_cast<SegmentedJob *>(job);
+        if (segmentedJob) {
+            // The budget gives the number of segments, so that parallel jobs share the cores
+            segmentedJob->setSegmentPool(&m_segmentPool);
+            connect(segmentedJob, SIGNAL(gotAnalysisResults(QString,int,int,AnalysisResult,stringMap)), this, SIGNAL(gotAnalysisResults(QString,int,int,AnalysisResult,stringMap)));
+        }
+        job->setThreadBudget(threadBudget(resource));
+        {
+            TRACE_ZONE("jobs", "AbstractClipJob::startJob");
+            job->startJob();
+        }
         if (job->status() == JobDone) {
             emit updateJobStatus(job->clipId(), job->jobType, JobDone);
             //TODO: replace with more generic clip replacement framework
             if (job->jobType == AbstractClipJob::PROXYJOB) {
                 m_bin->gotProxy(job->clipId(), destination);
             }
+            else if (job->replaceClip) {
+                // Relinked in the main thread through an undoable clip edit
+                emit relinkClip(job->clipId(), destination);
+            }
             else if (job->addClipToProject() > -100) {
-                emit addClip(destination, job->addClipToProject());
+                foreach(const QString &dest, job->destinations()) {
+                    emit addClip(dest, job->addClipToProject());
+                }
             }
         } else if (job->status() == JobCrashed || job->status() == JobAborted) {
             emit updateJobStatus(job->clipId(), job->jobType, job->status(), job->errorMessage(), QString(), job->logDetails());
         }
     }
+    m_jobMutex.lock();
+    m_workers[resource]--;
+    m_jobMutex.unlock();
     // Thread finished, cleanup & update count
     QTimer::singleShot(200, this, SIGNAL(checkJobProcess()));
 }
@@ -286,7 +427,10 @@ void JobManager::launchJob(ProjectClip *clip, AbstractClipJob *job, bool runQueu
         return;
     }
 
+    m_jobMutex.lock();
     m_jobList.append(job);
+    enqueueJob(job);
+    m_jobMutex.unlock();
     clip->setJobStatus(job->jobType, JobWaiting, 0, job->statusMessage());
     if (runQueue) {
         slotCheckJobProcess();
@@ -349,6 +493,12 @@ void JobManager::slotCancelJobs()
     */
     if (!m_jobList.isEmpty()) qDeleteAll(m_jobList);
     m_jobList.clear();
+    m_jobProgress.clear();
+    for (int i = 0; i < JOB_RESOURCES; ++i) {
+        for (int j = 0; j < JOB_PRIORITIES; ++j) {
+            m_queues[i][j].clear();
+        }
+    }
     m_abortAllJobs = false;
     emit jobCount(0);
 }
@@ -28,6 +28,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QObject>
 #include <QMutex>
 #include <QFutureSynchronizer>
+#include <QThreadPool>
+
+#define JOB_RESOURCES 3
+#define JOB_PRIORITIES 3
 
 class AbstractClipJob;
 class Bin;
@@ -93,9 +97,12 @@ public:
     /** @brief Get the list of job names for current clip. */
     QStringList getPendingJobs(const QString &id);
 
+    /** @brief Run the jobs of the clip the user is looking at before the other ones.
+     *  @param id the clip id, empty if no clip is displayed */
+    void setVisibleClip(const QString &id);
+
 private slots:
     void slotCheckJobProcess();
-    void slotProcessJobs();
     void slotProcessLog(const QString &id, int progress, int type, const QString &message);
 
 public slots:
@@ -113,21 +120,49 @@ private:
     QMutex m_jobMutex;
     /** @brief Holds a list of active jobs. */
     QList <AbstractClipJob *> m_jobList;
+    /** @brief The waiting jobs, one FIFO per resource and priority. */
+    QList <AbstractClipJob *> m_queues[JOB_RESOURCES][JOB_PRIORITIES];
+    /** @brief Number of threads processing the jobs of each resource. */
+    int m_workers[JOB_RESOURCES];
+    /** @brief Last reported progress of the running jobs, used to show the overall progress. */
+    QHash <AbstractClipJob *, int> m_jobProgress;
+    /** @brief Id of the clip whose jobs are processed first. */
+    QString m_visibleClipId;
     /** @brief Holds the threads running a job. */
     QFutureSynchronizer<void> m_jobThreads;
+    /** @brief Runs the segments of the segmented analysis jobs, one thread per core. */
+    QThreadPool m_segmentPool;
     /** @brief Set to true to trigger abortion of all jobs. */
     bool m_abortAllJobs;
     /** @brief Create a proxy for a clip. */
     void createProxy(const QString &id);
     /** @brief Update job count in info widget. */
     void updateJobCount();
+    /** @brief Add a waiting job to the queue of its resource (m_jobMutex must be locked). */
+    void enqueueJob(AbstractClipJob *job);
+    /** @brief Take the next waiting job for a resource, highest priority first (m_jobMutex must be locked). */
+    AbstractClipJob *dequeueJob(int resource);
+    /** @brief Maximum number of jobs running at the same time on a resource. */
+    static int resourceLimit(int resource);
+    /** @brief Number of threads each job of a resource may use so that parallel jobs share the cores. */
+    static int threadBudget(int resource);
+    /** @brief Emit the average progress of the active jobs (m_jobMutex must be locked). */
+    void updateJobProgress();
+    /** @brief Process the waiting jobs of a resource until its queues are empty (in a separate thread). */
+    void processJobs(int resource);
 
 signals:
     void addClip(const QString, int folderId);
     void processLog(const QString&, int , int, const QString & = QString());
     void updateJobStatus(const QString&, int, int, const QString &label = QString(), const QString &actionName = QString(), const QString &details = QString());
     void gotFilterJobResults(QString,int,int,stringMap,stringMap);
+    /** @brief A segmented analysis job sent its merged results. */
+    void gotAnalysisResults(const QString &id, int startPos, int track, const AnalysisResult &result, const stringMap &extra);
     void jobCount(int);
+    /** @brief Average progress (in percent) of the waiting and running jobs. */
+    void jobsProgress(int);
+    /** @brief A job produced a replacement for the clip's source file. */
+    void relinkClip(const QString &id, const QString &url);
     void checkJobProcess();
 };
 
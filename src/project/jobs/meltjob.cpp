@@ -85,7 +85,8 @@ void MeltJob::startJob()
     if (m_extra.contains(QStringLiteral("clipStartPos"))) startPos = m_extra.value(QStringLiteral("clipStartPos")).toInt();
     if (m_extra.contains(QStringLiteral("clipTrack"))) track = m_extra.value(QStringLiteral("clipTrack")).toInt();
 
-    if (!m_extra.contains(QStringLiteral("finalfilter")))
+    // Bin analysis results are not applied to an effect
+    if (!m_extra.contains(QStringLiteral("finalfilter")) && !m_extra.contains(QStringLiteral("projecttreefilter")))
         m_extra.insert(QStringLiteral("finalfilter"), filterName);
 
     if (out != -1 && out <= in) {
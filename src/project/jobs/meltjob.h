@@ -71,7 +71,7 @@ public:
     /** @brief Here we will send the current progress info to anyone interested. */
     void emitFrameNumber(int pos);
     
-private:
+protected:
     Mlt::Consumer *m_consumer;
     Mlt::Producer *m_producer;
     Mlt::Profile *m_profile;
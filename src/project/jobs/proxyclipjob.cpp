@@ -21,18 +21,63 @@
 #include "proxyclipjob.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/cacheindex.h"
 #include "bin/projectclip.h"
 #include "bin/bin.h"
+#include "effectslist/effectslist.h"
 #include <QProcess>
 #include <QTemporaryFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QDir>
+#include <QDomDocument>
+#include <QImageReader>
+#include <QtConcurrent>
 
 #include <QDebug>
 #include <klocalizedstring.h>
 
+// Duration (in seconds) of the parts written by resumable proxy jobs
+#define PROXY_SEGMENT_DURATION 10
+
+/** @brief Decode one slideshow picture at (at most) the proxy size, used in parallel by QtConcurrent. */
+struct ScaleSlideshowImage
+{
+    typedef void result_type;
+    QSize box;
+    QString destFolder;
+    QString format;
+    void operator()(const QString &path) const
+    {
+        QImageReader reader(path);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+        reader.setAutoTransform(true);
+        bool rotated = reader.transformation() & QImageIOHandler::TransformationRotate90;
+#else
+        bool rotated = false;
+#endif
+        QSize size = reader.size();
+        QSize target = rotated ? box.transposed() : box;
+        if (size.isValid() && (size.width() > target.width() || size.height() > target.height())) {
+            // Let the decoder downscale, much faster than decoding the full picture (JPEG uses DCT scaling)
+            reader.setScaledSize(size.scaled(target, Qt::KeepAspectRatio));
+        }
+        QImage img = reader.read();
+        if (img.isNull()) return;
+        const QString dest = destFolder + QFileInfo(path).completeBaseName() + QLatin1Char('.') + format;
+        // Favor decoding speed: high quality jpeg or fast png compression
+        img.save(dest, format.toLatin1().constData(), format == QLatin1String("jpg") ? 95 : 100);
+    }
+};
+
 ProxyJob::ProxyJob(ClipType cType, const QString &id, const QStringList& parameters, QTemporaryFile *playlist)
     : AbstractClipJob(PROXYJOB, cType, id),
       m_jobDuration(0),
-      m_isFfmpegJob(true)
+      m_isFfmpegJob(true),
+      m_usedInTimeline(false),
+      m_resumeOffset(0),
+      m_segmented(false),
+      m_imageCache(NULL)
 {
     m_jobStatus = JobWaiting;
     description = i18n("proxy");
@@ -46,6 +91,136 @@ ProxyJob::ProxyJob(ClipType cType, const QString &id, const QStringList& paramet
     replaceClip = true;
 }
 
+AbstractClipJob::JOBRESOURCE ProxyJob::resource() const
+{
+    // Hardware encoders are limited by the GPU, not the CPU
+    if (m_proxyParams.contains(QLatin1String("vaapi")) || m_proxyParams.contains(QLatin1String("nvenc")) || m_proxyParams.contains(QLatin1String("_qsv"))) {
+        return GPURESOURCE;
+    }
+    return CPURESOURCE;
+}
+
+AbstractClipJob::JOBPRIORITY ProxyJob::priority() const
+{
+    // Proxies are usually created in batches, so don't let them delay other jobs,
+    // except for the clips that are already used in the timeline
+    return m_usedInTimeline ? NORMALPRIORITY : LOWPRIORITY;
+}
+
+void ProxyJob::setUsedInTimeline(bool used)
+{
+    m_usedInTimeline = used;
+}
+
+//static
+int ProxyJob::encoderThreads()
+{
+    // Share the available cores between the concurrent proxy jobs instead
+    // of letting each encoder start one thread per core
+    return qMax(1, QThread::idealThreadCount() / qMax(1, KdenliveSettings::proxythreads()));
+}
+
+QStringList ProxyJob::completedSegments()
+{
+    // The .resume file keeps the encoding parameters and the parts written by
+    // previous passes, the .segments file is the list written by the last ffmpeg pass
+    QStringList parts;
+    m_resumeOffset = 0;
+    QFile resumeFile(m_dest + QStringLiteral(".resume"));
+    double passOffset = 0;
+    bool valid = false;
+    if (resumeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&resumeFile);
+        while (!in.atEnd()) {
+            QString line = in.readLine();
+            if (line.startsWith(QLatin1String("params\t"))) {
+                valid = line.section(QLatin1Char('\t'), 1) == m_src + QLatin1Char(' ') + m_proxyParams;
+            } else if (line.startsWith(QLatin1String("offset\t"))) {
+                passOffset = line.section(QLatin1Char('\t'), 1).toDouble();
+            } else if (line.startsWith(QLatin1String("part\t"))) {
+                parts << line.section(QLatin1Char('\t'), 1, 1);
+                m_resumeOffset = line.section(QLatin1Char('\t'), 2, 2).toDouble();
+            }
+        }
+        resumeFile.close();
+    }
+    if (!valid) {
+        // Parameters changed or nothing to resume, start from scratch
+        removeSegments();
+        return QStringList();
+    }
+    QFile listFile(m_dest + QStringLiteral(".segments"));
+    if (listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // ffmpeg only lists a part once it is complete
+        QTextStream in(&listFile);
+        while (!in.atEnd()) {
+            QStringList data = in.readLine().split(QLatin1Char(','));
+            if (data.count() < 3) continue;
+            parts << QFileInfo(data.at(0)).fileName();
+            m_resumeOffset = passOffset + data.at(2).toDouble();
+        }
+        listFile.close();
+        listFile.remove();
+    }
+    QDir dir = QFileInfo(m_dest).absoluteDir();
+    for (int i = 0; i < parts.count(); i++) {
+        if (!dir.exists(parts.at(i))) {
+            // A part was deleted, cannot resume
+            removeSegments();
+            m_resumeOffset = 0;
+            return QStringList();
+        }
+    }
+    return parts;
+}
+
+void ProxyJob::removeSegments()
+{
+    QFileInfo info(m_dest);
+    QDir dir = info.absoluteDir();
+    QStringList filters;
+    filters << info.fileName() + QStringLiteral(".part*");
+    foreach(const QString &part, dir.entryList(filters, QDir::Files)) {
+        dir.remove(part);
+    }
+    QFile::remove(m_dest + QStringLiteral(".resume"));
+    QFile::remove(m_dest + QStringLiteral(".segments"));
+    QFile::remove(m_dest + QStringLiteral(".concat"));
+}
+
+bool ProxyJob::joinSegments()
+{
+    QStringList parts = completedSegments();
+    if (parts.isEmpty()) {
+        return false;
+    }
+    QDir dir = QFileInfo(m_dest).absoluteDir();
+    QFile concatFile(m_dest + QStringLiteral(".concat"));
+    if (!concatFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&concatFile);
+    foreach(const QString &part, parts) {
+        QString path = dir.absoluteFilePath(part);
+        path.replace(QLatin1Char('\''), QLatin1String("'\\''"));
+        out << "file '" << path << "'\n";
+    }
+    concatFile.close();
+    QStringList parameters;
+    parameters << QStringLiteral("-f") << QStringLiteral("concat") << QStringLiteral("-safe") << QStringLiteral("0") << QStringLiteral("-i") << concatFile.fileName() << QStringLiteral("-c") << QStringLiteral("copy") << QStringLiteral("-y") << m_dest;
+    QProcess concat;
+    concat.setProcessChannelMode(QProcess::MergedChannels);
+    concat.start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
+    concat.waitForFinished(-1);
+    m_logDetails.append(QString::fromUtf8(concat.readAll()));
+    if (concat.exitStatus() != QProcess::NormalExit || concat.exitCode() != 0 || QFileInfo(m_dest).size() == 0) {
+        QFile::remove(m_dest);
+        return false;
+    }
+    removeSegments();
+    return true;
+}
+
 void ProxyJob::startJob()
 {
     // Special case: playlist clips (.mlt or .kdenlive project files)
@@ -53,6 +228,19 @@ void ProxyJob::startJob()
     if (clipType == Playlist || clipType == SlideShow) {
         // change FFmpeg params to MLT format
         m_isFfmpegJob = false;
+        if (clipType == SlideShow && !prepareSlideshowImages()) {
+            delete m_playlist;
+            m_playlist = NULL;
+            delete m_imageCache;
+            m_imageCache = NULL;
+            if (m_jobStatus == JobAborted) {
+                emit cancelRunningJob(m_clipId, cancelProperties());
+            } else {
+                m_errorMessage.append(i18n("Cannot read slideshow pictures."));
+                setStatus(JobCrashed);
+            }
+            return;
+        }
         QStringList mltParameters;
         mltParameters << m_src;
         mltParameters << QStringLiteral("-consumer") << QStringLiteral("avformat:") + m_dest;
@@ -86,6 +274,9 @@ void ProxyJob::startJob()
         }
 
         mltParameters.append(QStringLiteral("real_time=-%1").arg(KdenliveSettings::mltthreads()));
+        if (!m_proxyParams.contains(QLatin1String("-threads"))) {
+            mltParameters << QStringLiteral("threads=%1").arg(encoderThreads());
+        }
 
         //TODO: currently, when rendering an xml file through melt, the display ration is lost, so we enforce it manualy
         mltParameters << QStringLiteral("aspect=") + QLocale().toString(display_ratio);
@@ -148,26 +339,69 @@ void ProxyJob::startJob()
         } else {
             proxy.save(m_dest);
         }
+        CacheIndex::fileWritten(m_dest);
         setStatus(JobDone);
         return;
     } else {
         m_isFfmpegJob = true;
+        // Video proxies can be written in parts, so that an interrupted job resumes where it stopped
+        m_segmented = KdenliveSettings::resumableproxies() && (clipType == AV || clipType == Video);
+        QStringList parts;
+        if (m_segmented) {
+            parts = completedSegments();
+        }
         QStringList parameters;
         if (m_proxyParams.contains(QStringLiteral("-noautorotate"))) {
             // The noautorotate flag must be passed before input source
             parameters << QStringLiteral("-noautorotate");
         }
+        if (m_resumeOffset > 0) {
+            parameters << QStringLiteral("-ss") << QString::number(m_resumeOffset, 'f', 3);
+        }
         parameters << QStringLiteral("-i") << m_src;
         QString params = m_proxyParams;
-        foreach(const QString &s, params.split(QLatin1Char(' '))) {
-            if (s != QLatin1String("-noautorotate")) {
-                parameters << s;
+        QStringList paramList = params.split(QLatin1Char(' '), QString::SkipEmptyParts);
+        for (int i = 0; i < paramList.count(); i++) {
+            const QString &s = paramList.at(i);
+            if (s == QLatin1String("-noautorotate")) {
+                continue;
             }
+            if (m_segmented && s == QLatin1String("-f") && i + 1 < paramList.count()) {
+                // The container format applies to the parts
+                parameters << QStringLiteral("-segment_format") << paramList.at(i + 1);
+                i++;
+                continue;
+            }
+            parameters << s;
+        }
+        if (!m_proxyParams.contains(QLatin1String("-threads"))) {
+            parameters << QStringLiteral("-threads") << QString::number(encoderThreads());
         }
 
         // Make sure we don't block when proxy file already exists
         parameters << QStringLiteral("-y");
-        parameters << m_dest;
+        if (m_segmented) {
+            QFile resumeFile(m_dest + QStringLiteral(".resume"));
+            if (resumeFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                QTextStream out(&resumeFile);
+                out << "params\t" << m_src << ' ' << m_proxyParams << '\n';
+                QString lastEnd;
+                for (int i = 0; i < parts.count(); i++) {
+                    // Only the end of the last part is needed to resume
+                    lastEnd = i == parts.count() - 1 ? QString::number(m_resumeOffset, 'f', 3) : QStringLiteral("0");
+                    out << "part\t" << parts.at(i) << '\t' << lastEnd << '\n';
+                }
+                out << "offset\t" << QString::number(m_resumeOffset, 'f', 3) << '\n';
+                resumeFile.close();
+            }
+            QString extension = QFileInfo(m_dest).suffix();
+            parameters << QStringLiteral("-f") << QStringLiteral("segment") << QStringLiteral("-segment_time") << QString::number(PROXY_SEGMENT_DURATION);
+            parameters << QStringLiteral("-reset_timestamps") << QStringLiteral("1") << QStringLiteral("-segment_start_number") << QString::number(parts.count());
+            parameters << QStringLiteral("-segment_list") << m_dest + QStringLiteral(".segments") << QStringLiteral("-segment_list_type") << QStringLiteral("csv");
+            parameters << m_dest + QStringLiteral(".part%05d.") + extension;
+        } else {
+            parameters << m_dest;
+        }
         m_jobProcess = new QProcess;
         m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
         m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
@@ -179,26 +413,39 @@ void ProxyJob::startJob()
             emit cancelRunningJob(m_clipId, cancelProperties());
             m_jobProcess->close();
             m_jobProcess->waitForFinished();
-            QFile::remove(m_dest);
+            // Keep the completed parts of a resumable proxy for next time
+            if (!m_segmented) QFile::remove(m_dest);
         }
         m_jobProcess->waitForFinished(400);
     }
-    // remove temporary playlist if it exists
+    // remove temporary playlist and scaled slideshow pictures if they exist
     delete m_playlist;
+    m_playlist = NULL;
+    delete m_imageCache;
+    m_imageCache = NULL;
     if (m_jobStatus != JobAborted) {
         int result = m_jobProcess->exitStatus();
         if (result == QProcess::NormalExit) {
+            if (m_segmented && m_jobProcess->exitCode() == 0) {
+                processLogInfo();
+                if (!joinSegments()) {
+                    m_errorMessage.append(i18n("Failed to join proxy clip segments."));
+                }
+            }
             if (QFileInfo(m_dest).size() == 0) {
                 // File was not created
                 processLogInfo();
                 m_errorMessage.append(i18n("Failed to create proxy clip."));
                 setStatus(JobCrashed);
             }
-            else setStatus(JobDone);
+            else {
+                CacheIndex::fileWritten(m_dest);
+                setStatus(JobDone);
+            }
         }
         else if (result == QProcess::CrashExit) {
             // Proxy process crashed
-            QFile::remove(m_dest);
+            if (!m_segmented) QFile::remove(m_dest);
             setStatus(JobCrashed);
         }
     }
@@ -206,6 +453,94 @@ void ProxyJob::startJob()
     return;
 }
 
+bool ProxyJob::prepareSlideshowImages()
+{
+    if (!m_playlist) return false;
+    QFile file(m_src);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file)) {
+        return false;
+    }
+    file.close();
+    QDomElement prod = doc.documentElement().firstChildElement(QStringLiteral("producer"));
+    if (prod.isNull() && doc.documentElement().tagName() == QLatin1String("producer")) {
+        prod = doc.documentElement();
+    }
+    QString resource = EffectsList::property(prod, QStringLiteral("resource"));
+    QFileInfo info(resource);
+    if (!info.absoluteDir().exists()) return false;
+    QString folder = info.absolutePath() + QDir::separator();
+    QString name = info.fileName();
+    QString beginSuffix;
+    if (name.contains(QLatin1String("?begin:"))) {
+        beginSuffix = name.section(QLatin1Char('?'), 1);
+        name = name.section(QLatin1Char('?'), 0, 0);
+    }
+    QString sourceExtension = name.section(QLatin1Char('.'), -1).toLower();
+    QString format = (sourceExtension == QLatin1String("jpg") || sourceExtension == QLatin1String("jpeg")) ? QStringLiteral("jpg") : QStringLiteral("png");
+    QStringList files;
+    QString pattern;
+    if (name.startsWith(QLatin1String(".all."))) {
+        // Mime type slideshow, all pictures of the folder with this extension
+        QDir dir(folder);
+        dir.setNameFilters(QStringList() << QStringLiteral("*.") + name.section(QLatin1Char('.'), -1));
+        foreach(const QString &f, dir.entryList(QDir::Files)) {
+            files << folder + f;
+        }
+        pattern = QStringLiteral(".all.") + format;
+    } else {
+        // Numbered sequence like image_%04d.png
+        QString start = name.section(QStringLiteral("%0"), 0, 0);
+        QString end = name.section(QStringLiteral("%0"), 1);
+        int precision = end.section(QLatin1Char('d'), 0, 0).toInt();
+        QString ext = end.section(QLatin1Char('d'), 1);
+        if (precision <= 0) return false;
+        int i = beginSuffix.section(QLatin1Char(':'), 1).toInt();
+        int gap = 0;
+        for (; gap < 100; ++i) {
+            QString path = folder + start + QString::number(i).rightJustified(precision, '0', false) + ext;
+            if (QFile::exists(path)) {
+                files << path;
+                gap = 0;
+            } else {
+                gap++;
+            }
+        }
+        pattern = start + QStringLiteral("%0") + QString::number(precision) + QLatin1Char('d') + QLatin1Char('.') + format;
+        if (!beginSuffix.isEmpty()) pattern.append(QLatin1Char('?') + beginSuffix);
+    }
+    if (files.isEmpty()) return false;
+
+    // Keep the scaled pictures next to the proxy, they can be large
+    m_imageCache = new QTemporaryDir(m_dest + QStringLiteral(".images-XXXXXX"));
+    if (!m_imageCache->isValid()) return false;
+    ScaleSlideshowImage scaler;
+    scaler.box = QSize(m_renderWidth, m_renderHeight);
+    scaler.destFolder = m_imageCache->path() + QDir::separator();
+    scaler.format = format;
+    QFuture<void> future = QtConcurrent::map(files, scaler);
+    while (!future.isFinished()) {
+        if (m_jobStatus == JobAborted) {
+            future.cancel();
+            future.waitForFinished();
+            return false;
+        }
+        if (future.progressMaximum() > 0) {
+            emit jobProgress(m_clipId, 100 * future.progressValue() / future.progressMaximum(), jobType);
+        }
+        QThread::msleep(200);
+    }
+
+    // Render the proxy from the scaled pictures
+    EffectsList::setProperty(prod, QStringLiteral("resource"), scaler.destFolder + pattern);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(doc.toString().toUtf8());
+    file.close();
+    return true;
+}
+
 void ProxyJob::processLogInfo()
 {
     if (!m_jobProcess || m_jobStatus == JobAborted) return;
@@ -232,6 +567,8 @@ void ProxyJob::processLogInfo()
                 progress = numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
             }
             else progress = (int) time.toDouble();
+            // When resuming, ffmpeg only reports the time encoded in this pass
+            progress += (int) m_resumeOffset;
             emit jobProgress(m_clipId, (int) (100.0 * progress / m_jobDuration), jobType);
         }
     }
@@ -336,6 +673,7 @@ QHash <ProjectClip *, AbstractClipJob *> ProxyJob::prepareJob(Bin *bin, QList <P
         }
         parameters << path << sourcePath << item->getProducerProperty(QStringLiteral("_exif_orientation")) << params << QString::number(renderSize.width()) << QString::number(renderSize.height());
         ProxyJob *job = new ProxyJob(item->clipType(), id, parameters, playlist);
+        job->setUsedInTimeline(item->refCount() > 0);
         jobs.insert(item, job);
     }
     return jobs;
@@ -24,6 +24,7 @@
 #include "abstractclipjob.h"
 
 class QTemporaryFile;
+class QTemporaryDir;
 class Bin;
 class ProjectClip;
 
@@ -39,6 +40,10 @@ public:
     stringMap cancelProperties();
     const QString statusMessage();
     void processLogInfo();
+    JOBRESOURCE resource() const;
+    JOBPRIORITY priority() const;
+    /** @brief Mark the job as processing a clip used in the timeline, so that it is scheduled first. */
+    void setUsedInTimeline(bool used);
     static QList <ProjectClip *> filterClips(QList <ProjectClip *>clips);
     static QHash <ProjectClip *, AbstractClipJob *> prepareJob(Bin *bin, QList <ProjectClip *>clips);
 
@@ -52,6 +57,23 @@ private:
     int m_jobDuration;
     bool m_isFfmpegJob;
     QTemporaryFile *m_playlist;
+    bool m_usedInTimeline;
+    /** @brief Offset (in seconds) of the current ffmpeg pass when resuming a segmented proxy. */
+    double m_resumeOffset;
+    /** @brief True if the proxy is written as a list of segments that can be resumed. */
+    bool m_segmented;
+    /** @brief Number of encoder threads each proxy process may use. */
+    static int encoderThreads();
+    /** @brief Collect the segments written by previous passes, returns the list of completed part files. */
+    QStringList completedSegments();
+    /** @brief Join the completed segments into the final proxy file. */
+    bool joinSegments();
+    void removeSegments();
+    /** @brief Folder holding the slideshow pictures scaled to the proxy size. */
+    QTemporaryDir *m_imageCache;
+    /** @brief Decode all slideshow pictures in parallel at proxy size, and point the temporary playlist to them.
+     *  @returns false if the pictures could not be prepared */
+    bool prepareSlideshowImages();
 };
 
 #endif
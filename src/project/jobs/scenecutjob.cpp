@@ -0,0 +1,200 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "scenecutjob.h"
+#include "kdenlivesettings.h"
+
+#include <QDebug>
+#include <QVector>
+#include <klocalizedstring.h>
+#include <cstring>
+
+#include <mlt++/Mlt.h>
+
+// Width of the compared images, in pixels
+#define SCENECUT_WIDTH 128
+// Luma values are grouped by 4 in the histogram
+#define SCENECUT_BIN_SHIFT 2
+#define SCENECUT_BINS (256 >> SCENECUT_BIN_SHIFT)
+// Histogram change (0 - 1) above which a frame may start a new shot
+#define SCENECUT_HISTOGRAM_THRESHOLD 0.3
+// Mean luma difference below which no cut is reported, so that slow fades are ignored
+#define SCENECUT_MIN_DIFFERENCE 12.0
+// How many times the recent mean luma difference a cut must exceed, so that fast motion is ignored
+#define SCENECUT_MOTION_FACTOR 3.0
+// Distance between two analysed frames when only keyframes are decoded
+#define SCENECUT_KEYFRAME_STEP 12
+
+/** @brief Copy the luma samples of a packed yuv422 (Y0 U Y1 V) image. */
+static inline void extractLuma(const uchar *yuv, uchar *luma, int pixels)
+{
+    for (int i = 0; i < pixels; ++i) {
+        luma[i] = yuv[2 * i];
+    }
+}
+
+/** @brief Sum of absolute differences of two images.
+ *  Branch free so that the compiler can vectorize it. */
+static inline int lumaDifference(const uchar *a, const uchar *b, int pixels)
+{
+    int sum = 0;
+    for (int i = 0; i < pixels; ++i) {
+        const int value = a[i] - b[i];
+        const int mask = value >> 31;
+        sum += (value ^ mask) - mask;
+    }
+    return sum;
+}
+
+/** @brief Build the luma histogram of an image.
+ *  Four partial histograms are filled in turn so that consecutive samples falling in the same bin do not wait for each other. */
+static void lumaHistogram(const uchar *luma, int pixels, int *histogram)
+{
+    int parts[4][SCENECUT_BINS];
+    memset(parts, 0, sizeof(parts));
+    int i = 0;
+    for (; i + 3 < pixels; i += 4) {
+        parts[0][luma[i] >> SCENECUT_BIN_SHIFT]++;
+        parts[1][luma[i + 1] >> SCENECUT_BIN_SHIFT]++;
+        parts[2][luma[i + 2] >> SCENECUT_BIN_SHIFT]++;
+        parts[3][luma[i + 3] >> SCENECUT_BIN_SHIFT]++;
+    }
+    for (; i < pixels; ++i) {
+        parts[0][luma[i] >> SCENECUT_BIN_SHIFT]++;
+    }
+    for (int j = 0; j < SCENECUT_BINS; ++j) {
+        histogram[j] = parts[0][j] + parts[1][j] + parts[2][j] + parts[3][j];
+    }
+}
+
+/** @brief Sum of absolute differences of two histograms, branch free. */
+static inline int histogramDifference(const int *a, const int *b)
+{
+    int sum = 0;
+    for (int i = 0; i < SCENECUT_BINS; ++i) {
+        const int value = a[i] - b[i];
+        const int mask = value >> 31;
+        sum += (value ^ mask) - mask;
+    }
+    return sum;
+}
+
+SceneCutJob::SceneCutJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const stringMap &extraParams)
+    : SegmentedJob(cType, id, producerParams, QMap <QString, QString>(), QMap <QString, QString>(), extraParams)
+    , m_keyframesOnly(producerParams.value(QStringLiteral("skip_frame")) == QLatin1String("nokey"))
+{
+}
+
+SceneCutJob::~SceneCutJob()
+{
+}
+
+//static
+QMap <QString, QString> SceneCutJob::decoderParams(bool keyframesOnly)
+{
+    QMap <QString, QString> params;
+    // These are applied to the decoder when it opens, the images are scaled down anyway
+    params.insert(QStringLiteral("skip_loop_filter"), QStringLiteral("all"));
+    if (keyframesOnly) {
+        params.insert(QStringLiteral("skip_frame"), QStringLiteral("nokey"));
+    }
+    return params;
+}
+
+int SceneCutJob::segmentOverlap() const
+{
+    // Compare the first kept frame with at least one previous frame
+    return m_keyframesOnly ? SCENECUT_KEYFRAME_STEP : SegmentedJob::segmentOverlap();
+}
+
+void SceneCutJob::startSinglePass(int length)
+{
+    // No MLT filter to fall back to, run a single segment
+    if (length > 0) {
+        m_segments = partition(length, 1);
+    }
+    processSegments();
+}
+
+bool SceneCutJob::analyseSegment(Segment &segment)
+{
+    int in = m_producerParams.value(QStringLiteral("in")).toInt();
+    Mlt::Profile profile(KdenliveSettings::current_profile().toUtf8().constData());
+    Mlt::Producer *producer = createProducer(profile);
+    if (!producer) return false;
+    const int width = SCENECUT_WIDTH;
+    const int height = qMax(2, (int) (width / profile.dar() + 0.5) / 2 * 2);
+    const int pixels = width * height;
+    QVector <uchar> previous(pixels);
+    QVector <uchar> current(pixels);
+    QVector <int> previousHistogram(SCENECUT_BINS);
+    QVector <int> histogram(SCENECUT_BINS);
+    bool hasPrevious = false;
+    double averageDifference = -1;
+    const int step = m_keyframesOnly ? SCENECUT_KEYFRAME_STEP : 1;
+    producer->seek(in + segment.in);
+    // A seek on each analysed position returns the following keyframe
+    producer->set_speed(m_keyframesOnly ? 0 : 1.0);
+    for (int pos = segment.in; pos <= segment.out && m_jobStatus != JobAborted; pos += step) {
+        if (m_keyframesOnly) producer->seek(in + pos);
+        Mlt::Frame *frame = producer->get_frame();
+        if (frame == NULL || !frame->is_valid()) {
+            delete frame;
+            delete producer;
+            return false;
+        }
+        // We just want to compare small images, use the fastest methods
+        frame->set("rescale.interp", "nearest");
+        frame->set("deinterlace_method", "onefield");
+        frame->set("top_field_first", -1);
+        mlt_image_format format = mlt_image_yuv422;
+        int w = width;
+        int h = height;
+        const uchar *image = frame->get_image(format, w, h);
+        bool valid = image && format == mlt_image_yuv422 && w == width && h == height;
+        if (valid) {
+            extractLuma(image, current.data(), pixels);
+        }
+        delete frame;
+        emitFrameAnalysed(qMin(step, segment.out - pos + 1));
+        if (!valid) {
+            hasPrevious = false;
+            continue;
+        }
+        lumaHistogram(current.constData(), pixels, histogram.data());
+        if (hasPrevious) {
+            double difference = (double) lumaDifference(previous.constData(), current.constData(), pixels) / pixels;
+            double change = histogramDifference(previousHistogram.constData(), histogram.constData()) / (2.0 * pixels);
+            bool cut = change > SCENECUT_HISTOGRAM_THRESHOLD && difference > SCENECUT_MIN_DIFFERENCE && (averageDifference < 0 || difference > SCENECUT_MOTION_FACTOR * averageDifference);
+            if (cut) {
+                if (pos >= segment.keep) {
+                    segment.result.frames.insert(pos, QString::number(qRound(change * 100)));
+                }
+            } else {
+                // Cuts are not part of the shot's motion
+                averageDifference = averageDifference < 0 ? difference : 0.9 * averageDifference + 0.1 * difference;
+            }
+        }
+        previous.swap(current);
+        previousHistogram.swap(histogram);
+        hasPrevious = true;
+    }
+    delete producer;
+    return m_jobStatus != JobAborted;
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SCENECUTJOB
+#define SCENECUTJOB
+
+#include "segmentedjob.h"
+
+/**
+ * @class SceneCutJob
+ * @brief Finds shot changes by comparing small luma images of consecutive frames.
+ *
+ * Unlike the motion_est filter, the frames are never processed at full resolution: the
+ * decoder skips its loop filter, images are scaled down to a thumbnail and each frame is
+ * compared to the previous one with a luma histogram and the mean absolute difference.
+ * A cut is found where both change abruptly compared to the recent motion. With keyframes
+ * only, the decoder skips all other frames, which is much faster on long GOP recordings whose
+ * encoder placed a keyframe at each scene change, at the cost of keyframe precision.
+ */
+
+class SceneCutJob : public SegmentedJob
+{
+    Q_OBJECT
+
+public:
+    SceneCutJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const stringMap &extraParams = stringMap());
+    virtual ~SceneCutJob();
+    /** @brief Returns the producer parameters needed for a fast analysis.
+     *  @param keyframesOnly if true, only decode the keyframes */
+    static QMap <QString, QString> decoderParams(bool keyframesOnly);
+
+protected:
+    int segmentOverlap() const;
+    bool analyseSegment(Segment &segment);
+    void startSinglePass(int length);
+
+private:
+    bool m_keyframesOnly;
+};
+
+#endif
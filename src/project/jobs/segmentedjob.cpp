@@ -0,0 +1,325 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "segmentedjob.h"
+#include "kdenlivesettings.h"
+#include "utils/tracer.h"
+
+#include <QDebug>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <klocalizedstring.h>
+
+#include <mlt++/Mlt.h>
+
+// Segments shorter than this (in frames) are not worth a separate analysis
+#define SEGMENT_MIN_LENGTH 250
+// Frames analysed before each segment's start so that the filter compares its first kept frame with previous ones
+#define SEGMENT_OVERLAP 5
+
+static void segment_frame_render(mlt_consumer, SegmentedJob * self, mlt_frame)
+{
+    self->emitFrameAnalysed();
+}
+
+SegmentedJob::SegmentedJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const QMap <QString, QString> &filterParams, const QMap <QString, QString> &consumerParams, const stringMap &extraParams)
+    : MeltJob(cType, id, producerParams, filterParams, consumerParams, extraParams)
+    , m_segmentPool(NULL)
+    , m_analysedFrames(0)
+    , m_totalFrames(0)
+{
+}
+
+SegmentedJob::~SegmentedJob()
+{
+}
+
+void SegmentedJob::setSegmentPool(QThreadPool *pool)
+{
+    m_segmentPool = pool;
+}
+
+void SegmentedJob::setStatus(ClipJobStatus status)
+{
+    MeltJob::setStatus(status);
+    if (status == JobAborted) {
+        QMutexLocker lock(&m_consumerMutex);
+        foreach(Mlt::Consumer *consumer, m_segmentConsumers) {
+            consumer->stop();
+        }
+    }
+}
+
+void SegmentedJob::emitFrameAnalysed(int count)
+{
+    int frames = m_analysedFrames.fetchAndAddRelaxed(count) + count;
+    // Segments report from several threads, do not flood the GUI
+    if (m_totalFrames > 0 && frames / 25 != (frames - count) / 25 && m_jobStatus == JobWorking) {
+        emit jobProgress(m_clipId, (int) (100.0 * frames / m_totalFrames), jobType);
+    }
+}
+
+int SegmentedJob::minimumSegmentLength() const
+{
+    return SEGMENT_MIN_LENGTH;
+}
+
+int SegmentedJob::segmentOverlap() const
+{
+    return SEGMENT_OVERLAP;
+}
+
+QVector <SegmentedJob::Segment> SegmentedJob::partition(int length, int count) const
+{
+    QVector <Segment> segments;
+    int segmentLength = length / count;
+    int overlap = segmentOverlap();
+    for (int i = 0; i < count; ++i) {
+        Segment segment;
+        segment.index = i;
+        segment.keep = i * segmentLength;
+        segment.in = qMax(0, segment.keep - overlap);
+        segment.out = i == count - 1 ? length - 1 : (i + 1) * segmentLength - 1;
+        segments << segment;
+    }
+    return segments;
+}
+
+void SegmentedJob::prepareSegmentFilter(Mlt::Filter &, const Segment &)
+{
+}
+
+bool SegmentedJob::collectSegment(Mlt::Filter &filter, Segment &segment)
+{
+    QString key = m_extra.value(QStringLiteral("key"));
+    if (key.isEmpty()) return true;
+    // Frames are numbered from the segment start, an unset list means nothing was found
+    QMap <int, QString> frames = AnalysisResult::parseFrames(QString::fromLatin1(filter.get(key.toUtf8().constData())));
+    QMapIterator<int, QString> i(frames);
+    while (i.hasNext()) {
+        i.next();
+        int frame = segment.in + i.key();
+        if (frame >= segment.keep) {
+            segment.result.frames.insert(frame, i.value());
+        }
+    }
+    return true;
+}
+
+bool SegmentedJob::mergeSegments()
+{
+    if (!m_extra.contains(QStringLiteral("key"))) return true;
+    AnalysisResult result;
+    foreach(const Segment &segment, m_segments) {
+        QMapIterator<int, QString> i(segment.result.frames);
+        while (i.hasNext()) {
+            i.next();
+            result.frames.insert(i.key(), i.value());
+        }
+    }
+    int startPos = m_extra.value(QStringLiteral("clipStartPos"), QStringLiteral("-1")).toInt();
+    int track = m_extra.value(QStringLiteral("clipTrack"), QStringLiteral("-1")).toInt();
+    emit gotAnalysisResults(m_clipId, startPos, track, result, m_extra);
+    return true;
+}
+
+Mlt::Producer *SegmentedJob::createProducer(Mlt::Profile &profile)
+{
+    // The profile is the project's, producer_profile only keeps its frame rate
+    if (m_extra.contains(QStringLiteral("producer_profile"))) {
+        int fps_num = profile.frame_rate_num();
+        int fps_den = profile.frame_rate_den();
+        profile.set_explicit(false);
+        Mlt::Producer *producer = new Mlt::Producer(profile, m_url.toUtf8().constData());
+        if (producer->is_valid()) {
+            profile.from_producer(*producer);
+            profile.set_explicit(true);
+        }
+        delete producer;
+        profile.set_frame_rate(fps_num, fps_den);
+    }
+    if (m_extra.contains(QStringLiteral("resize_profile"))) {
+        profile.set_height(m_extra.value(QStringLiteral("resize_profile")).toInt());
+        profile.set_width(profile.height() * profile.sar());
+    }
+    Mlt::Producer *producer = new Mlt::Producer(profile, m_url.toUtf8().constData());
+    if (!producer->is_valid()) {
+        delete producer;
+        return NULL;
+    }
+    QMapIterator<QString, QString> i(m_producerParams);
+    while (i.hasNext()) {
+        i.next();
+        if (i.key() != QLatin1String("producer") && i.key() != QLatin1String("in") && i.key() != QLatin1String("out")) {
+            producer->set(i.key().toUtf8().constData(), i.value().toUtf8().constData());
+        }
+    }
+    return producer;
+}
+
+void SegmentedJob::startJob()
+{
+    if (m_url.isEmpty()) {
+        m_errorMessage.append(i18n("No producer for this clip."));
+        setStatus(JobCrashed);
+        return;
+    }
+    // safety check, make sure we don't overwrite a source clip
+    if (!m_dest.isEmpty() && !m_dest.endsWith(QStringLiteral(".mlt"))) {
+        m_errorMessage.append(i18n("Invalid destination: %1.", m_consumerParams.value(QStringLiteral("consumer"))));
+        setStatus(JobCrashed);
+        return;
+    }
+    int in = m_producerParams.value(QStringLiteral("in")).toInt();
+    int out = m_producerParams.value(QStringLiteral("out")).toInt();
+    int length = 0;
+    if (out == -1 || out > in) {
+        Mlt::Profile profile(KdenliveSettings::current_profile().toUtf8().constData());
+        Mlt::Producer *producer = createProducer(profile);
+        if (producer) {
+            if (out < 0) out = producer->get_length() - 1;
+            delete producer;
+            length = qMax(0, out - in + 1);
+        }
+    }
+    int count = m_segmentPool ? qMin(qMax(1, m_threadBudget), length / qMax(1, minimumSegmentLength())) : 0;
+    if (count > 1) {
+        m_segments = partition(length, count);
+    }
+    if (m_segments.count() < 2) {
+        // Short zone or nothing to split, analyse in one pass
+        m_segments.clear();
+        startSinglePass(length);
+        return;
+    }
+    processSegments();
+}
+
+void SegmentedJob::startSinglePass(int)
+{
+    MeltJob::startJob();
+}
+
+void SegmentedJob::processSegments()
+{
+    if (m_segments.isEmpty()) {
+        m_errorMessage.append(i18n("Invalid clip"));
+        setStatus(JobCrashed);
+        return;
+    }
+    int in = m_producerParams.value(QStringLiteral("in")).toInt();
+    if (in > 0 && !m_extra.contains(QStringLiteral("offset"))) m_extra.insert(QStringLiteral("offset"), QString::number(in));
+
+    m_totalFrames = 0;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        m_totalFrames += m_segments.at(i).out - m_segments.at(i).in + 1;
+    }
+    // The first segment runs in this thread, the others in the segment pool
+    QList <QFuture<bool> > futures;
+    for (int i = 1; i < m_segments.count(); ++i) {
+        futures << QtConcurrent::run(m_segmentPool, this, &SegmentedJob::runSegment, i);
+    }
+    bool result = runSegment(0);
+    for (int i = 0; i < futures.count(); ++i) {
+        futures[i].waitForFinished();
+        result = result && futures.at(i).result();
+    }
+
+    if (m_jobStatus == JobAborted) {
+        // Nothing to do
+    } else if (!result) {
+        QString filterName = m_filterParams.value(QStringLiteral("filter"));
+        m_errorMessage.append(filterName.isEmpty() ? i18n("Clip analysis failed") : i18n("Filter %1 crashed", filterName));
+        setStatus(JobCrashed);
+    } else if (!mergeSegments()) {
+        setStatus(JobCrashed);
+    } else {
+        m_jobStatus = JobDone;
+    }
+}
+
+bool SegmentedJob::runSegment(int index)
+{
+    if (m_jobStatus == JobAborted) return false;
+    // Each thread only touches its own segment, the vector is not resized while they run
+    TRACE_ZONE("jobs", "SegmentedJob::analyseSegment");
+    return analyseSegment(m_segments[index]);
+}
+
+bool SegmentedJob::analyseSegment(Segment &segment)
+{
+    int in = m_producerParams.value(QStringLiteral("in")).toInt();
+    Mlt::Profile profile(KdenliveSettings::current_profile().toUtf8().constData());
+    Mlt::Producer *producer = createProducer(profile);
+    if (!producer) return false;
+    Mlt::Producer *cut = producer->cut(in + segment.in, in + segment.out);
+    delete producer;
+    Mlt::Filter filter(profile, m_filterParams.value(QStringLiteral("filter")).toUtf8().constData());
+    if (!filter.is_valid()) {
+        delete cut;
+        return false;
+    }
+    QMapIterator<QString, QString> k(m_filterParams);
+    while (k.hasNext()) {
+        k.next();
+        if (k.key() != QLatin1String("filter")) {
+            filter.set(k.key().toUtf8().constData(), k.value().toUtf8().constData());
+        }
+    }
+    prepareSegmentFilter(filter, segment);
+
+    Mlt::Consumer *consumer = new Mlt::Consumer(profile, "null");
+    consumer->set("all", 1);
+    consumer->set("real_time", -1);
+    if (m_consumerParams.value(QStringLiteral("consumer")) == QLatin1String("null")) {
+        // Analysis jobs tune their consumer for speed, other consumers only apply to the final pass
+        QMapIterator<QString, QString> j(m_consumerParams);
+        while (j.hasNext()) {
+            j.next();
+            if (j.key() != QLatin1String("consumer")) {
+                consumer->set(j.key().toUtf8().constData(), j.value().toUtf8().constData());
+            }
+        }
+    }
+    consumer->set("terminate_on_pause", 1);
+    Mlt::Tractor tractor(profile);
+    Mlt::Playlist playlist;
+    playlist.append(*cut);
+    tractor.set_track(playlist, 0);
+    consumer->connect(tractor);
+    cut->attach(filter);
+    Mlt::Event *event = consumer->listen("consumer-frame-render", this, (mlt_listener) segment_frame_render);
+    m_consumerMutex.lock();
+    bool aborted = m_jobStatus == JobAborted;
+    if (!aborted) {
+        m_segmentConsumers << consumer;
+    }
+    m_consumerMutex.unlock();
+    if (!aborted) {
+        consumer->run();
+        m_consumerMutex.lock();
+        m_segmentConsumers.removeAll(consumer);
+        m_consumerMutex.unlock();
+    }
+    delete event;
+    delete consumer;
+    bool result = !aborted && m_jobStatus != JobAborted && collectSegment(filter, segment);
+    delete cut;
+    return result;
+}
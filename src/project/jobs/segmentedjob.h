@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SEGMENTEDJOB
+#define SEGMENTEDJOB
+
+#include "meltjob.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+
+class QThreadPool;
+
+namespace Mlt {
+class Producer;
+}
+
+/**
+ * @class SegmentedJob
+ * @brief An MLT analysis job that cuts the clip zone in segments analysed in parallel.
+ *
+ * Most analysis filters only look at a few consecutive frames, so their results over a clip
+ * are the union of their results over parts of it. This job partitions the zone, runs one
+ * filter instance per segment in the JobManager's segment pool and merges the results, which
+ * are sent as an AnalysisResult instead of filter strings. Subclasses declare how to partition
+ * and merge by reimplementing the protected virtual methods. Short zones, or jobs started
+ * without a segment pool, are processed in one pass like a MeltJob.
+ */
+
+class SegmentedJob : public MeltJob
+{
+    Q_OBJECT
+
+public:
+    SegmentedJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const QMap <QString, QString> &filterParams, const QMap <QString, QString> &consumerParams, const stringMap &extraParams = stringMap());
+    virtual ~SegmentedJob();
+    void startJob();
+    void setStatus(ClipJobStatus status);
+    /** @brief Sets the thread pool running the segments, shared by all segmented jobs. */
+    void setSegmentPool(QThreadPool *pool);
+    /** @brief Called for the frames analysed by any of the segments. */
+    void emitFrameAnalysed(int count = 1);
+
+protected:
+    struct Segment {
+        /** @brief First and last analysed frames, relative to the zone start. */
+        int in;
+        int out;
+        /** @brief First frame whose results are kept, the frames before it only warm up the filter. */
+        int keep;
+        int index;
+        /** @brief Results of this segment, relative to the zone start. */
+        AnalysisResult result;
+    };
+    QVector <Segment> m_segments;
+    /** @brief Segments shorter than this (in frames) are not worth a separate analysis. */
+    virtual int minimumSegmentLength() const;
+    /** @brief Number of frames analysed before each segment's first kept frame. */
+    virtual int segmentOverlap() const;
+    /** @brief Cut a zone of length frames in (at most) count segments. */
+    virtual QVector <Segment> partition(int length, int count) const;
+    /** @brief Adjust the filter of a segment before it runs, for example to give it its own output file. */
+    virtual void prepareSegmentFilter(Mlt::Filter &filter, const Segment &segment);
+    /** @brief Analyse one segment (in a separate thread), the default runs the job's filter over it. */
+    virtual bool analyseSegment(Segment &segment);
+    /** @brief Process a zone too short to be split, the default runs the job as a MeltJob.
+     *  @param length the zone length in frames, 0 if the clip could not be opened */
+    virtual void startSinglePass(int length);
+    /** @brief Analyse the segments in parallel, merge them and set the job status. */
+    void processSegments();
+    /** @brief Read the results of an analysed segment from its filter, returns false if the analysis failed. */
+    virtual bool collectSegment(Mlt::Filter &filter, Segment &segment);
+    /** @brief Combine the results of all segments and send them, returns false on failure. */
+    virtual bool mergeSegments();
+    /** @brief Create the clip's producer and set up the project based profile like MeltJob does. */
+    Mlt::Producer *createProducer(Mlt::Profile &profile);
+
+private:
+    QThreadPool *m_segmentPool;
+    /** @brief The consumers of the running segments, stopped when the job is aborted. */
+    QList <Mlt::Consumer *> m_segmentConsumers;
+    QMutex m_consumerMutex;
+    QAtomicInt m_analysedFrames;
+    int m_totalFrames;
+    bool runSegment(int index);
+
+signals:
+    /** @brief Sent with the merged results of all segments. */
+    void gotAnalysisResults(const QString &id, int startPos, int track, const AnalysisResult &result, const stringMap &extra);
+};
+
+#endif
@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "stabilizejob.h"
+#include "kdenlivesettings.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <klocalizedstring.h>
+
+#include <mlt++/Mlt.h>
+
+StabilizeJob::StabilizeJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const QMap <QString, QString> &filterParams, const QMap <QString, QString> &consumerParams, const stringMap &extraParams)
+    : SegmentedJob(cType, id, producerParams, filterParams, consumerParams, extraParams)
+{
+}
+
+StabilizeJob::~StabilizeJob()
+{
+}
+
+//static
+bool StabilizeJob::canSplit(const QMap <QString, QString> &filterParams)
+{
+    // Tripod mode compares all frames with one reference frame
+    return filterParams.value(QStringLiteral("filter")) == QLatin1String("vidstab") && filterParams.value(QStringLiteral("tripod")).toInt() == 0 && !filterParams.value(QStringLiteral("filename")).isEmpty();
+}
+
+void StabilizeJob::startJob()
+{
+    // safety check, make sure we don't overwrite a source clip
+    if (!m_dest.endsWith(QStringLiteral(".mlt"))) {
+        m_errorMessage.append(i18n("Invalid destination: %1.", m_consumerParams.value(QStringLiteral("consumer"))));
+        setStatus(JobCrashed);
+        return;
+    }
+    SegmentedJob::startJob();
+    foreach(const Segment &segment, m_segments) {
+        QFile::remove(segmentFile(segment));
+    }
+}
+
+QString StabilizeJob::segmentFile(const Segment &segment) const
+{
+    return m_filterParams.value(QStringLiteral("filename")) + QStringLiteral(".%1").arg(segment.index);
+}
+
+void StabilizeJob::prepareSegmentFilter(Mlt::Filter &filter, const Segment &segment)
+{
+    filter.set("filename", segmentFile(segment).toUtf8().constData());
+}
+
+bool StabilizeJob::collectSegment(Mlt::Filter &filter, Segment &segment)
+{
+    // The filter sets "results" once the whole segment was analysed
+    return filter.get("results") != NULL && QFileInfo(segmentFile(segment)).size() > 0;
+}
+
+bool StabilizeJob::mergeSegments()
+{
+    QString trfFile = m_filterParams.value(QStringLiteral("filename"));
+    return mergeTransforms(trfFile) && writePlaylist(trfFile);
+}
+
+bool StabilizeJob::mergeTransforms(const QString &trfFile)
+{
+    QFile dest(trfFile);
+    if (!dest.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_errorMessage.append(i18n("Cannot write to path: %1", trfFile));
+        return false;
+    }
+    QTextStream output(&dest);
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        int end = i + 1 < m_segments.count() ? m_segments.at(i + 1).keep : segment.out + 1;
+        QFile source(segmentFile(segment));
+        if (!source.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            m_errorMessage.append(i18n("Cannot read file %1", source.fileName()));
+            return false;
+        }
+        QTextStream input(&source);
+        while (!input.atEnd()) {
+            QString line = input.readLine();
+            if (!line.startsWith(QLatin1String("Frame "))) {
+                // Keep the header (version and detection settings) of the first file only
+                if (i == 0) output << line << '\n';
+                continue;
+            }
+            // Frames are numbered from 1 in each segment file
+            int frame = segment.in + line.section(QLatin1Char(' '), 1, 1).toInt() - 1;
+            if (frame < segment.keep || frame >= end) continue;
+            output << QStringLiteral("Frame ") << frame + 1 << ' ' << line.section(QLatin1Char(' '), 2) << '\n';
+        }
+    }
+    return true;
+}
+
+bool StabilizeJob::writePlaylist(const QString &trfFile)
+{
+    int in = m_producerParams.value(QStringLiteral("in")).toInt();
+    int out = m_producerParams.value(QStringLiteral("out")).toInt();
+    m_profile = new Mlt::Profile(KdenliveSettings::current_profile().toUtf8().constData());
+    Mlt::Producer *producer = createProducer(*m_profile);
+    if (!producer) return false;
+    if (out < 0) out = producer->get_length() - 1;
+    m_producer = producer->cut(in, out);
+    delete producer;
+    m_filter = new Mlt::Filter(*m_profile, m_filterParams.value(QStringLiteral("filter")).toUtf8().constData());
+    QMapIterator<QString, QString> k(m_filterParams);
+    while (k.hasNext()) {
+        k.next();
+        if (k.key() != QLatin1String("filter")) {
+            m_filter->set(k.key().toUtf8().constData(), k.value().toUtf8().constData());
+        }
+    }
+    // With the results set, the filter applies the transforms instead of analysing
+    m_filter->set("results", trfFile.toUtf8().constData());
+
+    QString consumerName = m_consumerParams.value(QStringLiteral("consumer"));
+    m_consumer = new Mlt::Consumer(*m_profile, consumerName.section(QLatin1Char(':'), 0, 0).toUtf8().constData(), m_dest.toUtf8().constData());
+    if (!m_consumer->is_valid()) {
+        m_errorMessage.append(i18n("Cannot create consumer %1.", consumerName));
+        return false;
+    }
+    QMapIterator<QString, QString> j(m_consumerParams);
+    while (j.hasNext()) {
+        j.next();
+        // No frame needs to be rendered to save the playlist
+        if (j.key() != QLatin1String("consumer") && j.key() != QLatin1String("all") && j.key() != QLatin1String("real_time")) {
+            m_consumer->set(j.key().toUtf8().constData(), j.value().toUtf8().constData());
+        }
+    }
+    m_consumer->set("terminate_on_pause", 1);
+    Mlt::Tractor tractor(*m_profile);
+    Mlt::Playlist playlist;
+    playlist.append(*m_producer);
+    tractor.set_track(playlist, 0);
+    m_producer->attach(*m_filter);
+    m_consumer->connect(tractor);
+    m_consumer->run();
+    return QFileInfo(m_dest).size() > 0;
+}
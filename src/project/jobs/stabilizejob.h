@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef STABILIZEJOB
+#define STABILIZEJOB
+
+#include "segmentedjob.h"
+
+/**
+ * @class StabilizeJob
+ * @brief A vid.stab job that splits the detection pass into segments analysed in parallel.
+ *
+ * Vid.stab's motion detection runs single threaded over the whole clip. This job gives each
+ * segment its own transform file, merges the per segment files into one and writes the
+ * stabilized playlist, whose transform pass then happens during normal playback. Tripod mode
+ * compares every frame to a single reference frame and cannot be split, see canSplit().
+ */
+
+class StabilizeJob : public SegmentedJob
+{
+    Q_OBJECT
+
+public:
+    StabilizeJob(ClipType cType, const QString &id, const QMap <QString, QString> &producerParams, const QMap <QString, QString> &filterParams, const QMap <QString, QString> &consumerParams, const stringMap &extraParams = stringMap());
+    virtual ~StabilizeJob();
+    void startJob();
+    /** @brief Returns true if a stabilization with these filter parameters can be analysed in segments. */
+    static bool canSplit(const QMap <QString, QString> &filterParams);
+
+protected:
+    void prepareSegmentFilter(Mlt::Filter &filter, const Segment &segment);
+    bool collectSegment(Mlt::Filter &filter, Segment &segment);
+    bool mergeSegments();
+
+private:
+    /** @brief The transform file written by the detection of a segment. */
+    QString segmentFile(const Segment &segment) const;
+    /** @brief Concatenate the segment transform files, renumbering their frames. */
+    bool mergeTransforms(const QString &trfFile);
+    /** @brief Write the final playlist with the stabilize filter reading the merged transforms. */
+    bool writePlaylist(const QString &trfFile);
+};
+
+#endif
@@ -25,6 +25,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "effectstack/effectstackview2.h"
 #include "project/dialogs/backupwidget.h"
 #include "project/notesplugin.h"
+#include "project/projectresources.h"
 #include "utils/KoIconUtils.h"
 
 #include <KActionCollection>
@@ -219,6 +220,10 @@ void ProjectManager::newFile(bool showProjectSettings, bool force)
 
 bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
 {
+    // Make sure the last save reached the disk before closing, a failed save marks the document as modified
+    if (m_project) {
+        m_project->waitForSave();
+    }
     if (m_project && m_project->isModified() && saveChanges) {
         QString message;
         if (m_project->url().fileName().isEmpty()) {
@@ -230,7 +235,7 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
         switch (KMessageBox::warningYesNoCancel(pCore->window(), message)) {
         case KMessageBox::Yes :
             // save document here. If saving fails, return false;
-            if (saveFile() == false) {
+            if (saveFile() == false || m_project->waitForSave() == false) {
                 return false;
             }
             break;
@@ -254,6 +259,7 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
             m_trackView = NULL;
             delete m_project;
             m_project = NULL;
+            ProjectResources::clear();
         }
 	pCore->monitorManager()->setDocument(m_project);
     }
@@ -506,7 +512,8 @@ void ProjectManager::doOpenFile(const QUrl &url, KAutoSaveFile *stale)
     pCore->monitorManager()->resetDisplay();
     m_progressDialog = new QProgressDialog(pCore->window());
     m_progressDialog->setWindowTitle(i18n("Loading project"));
-    m_progressDialog->setCancelButton(0);
+    // Modal so that progress updates keep the interface painting and the loading can be cancelled
+    m_progressDialog->setWindowModality(Qt::WindowModal);
     m_progressDialog->setLabelText(i18n("Loading playlist"));
     m_progressDialog->setMaximum(0);
     m_progressDialog->show();
@@ -539,6 +546,10 @@ void ProjectManager::doOpenFile(const QUrl &url, KAutoSaveFile *stale)
     connect(m_trackView, &Timeline::startLoadingBin, m_progressDialog, &QProgressDialog::setMaximum, Qt::DirectConnection);
     connect(m_trackView, &Timeline::resetUsageCount, pCore->bin(), &Bin::resetUsageCount, Qt::DirectConnection);
     connect(m_trackView, &Timeline::loadingBin, m_progressDialog, &QProgressDialog::setValue, Qt::DirectConnection);
+    connect(m_progressDialog, &QProgressDialog::canceled, m_trackView, &Timeline::cancelLoading, Qt::DirectConnection);
+    if (m_progressDialog->wasCanceled()) {
+        m_trackView->cancelLoading();
+    }
 
     // Set default target tracks to upper audio / lower video tracks
     m_project = doc;
@@ -567,6 +578,15 @@ void ProjectManager::doOpenFile(const QUrl &url, KAutoSaveFile *stale)
         newFile(false, true);
         return;
     }
+    if (m_trackView->loadingCancelled()) {
+        // Loading was stopped by the user, start with an empty project instead
+        delete m_progressDialog;
+        m_progressDialog = NULL;
+        pCore->window()->slotGotProgressInfo(QString(), -1);
+        m_project->setModified(false);
+        newFile(false, true);
+        return;
+    }
     m_trackView->setDuration(m_trackView->duration());
 
     pCore->window()->slotGotProgressInfo(QString(), -1);
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "projectresources.h"
+#include "mltcontroller/clipcontroller.h"
+#include "project/dialogs/projectsettings.h"
+#include "titler/titlewidget.h"
+#include "titler/titledocument.h"
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QUrl>
+
+// Number of clips kept in the index
+#define PROJECT_RESOURCES_CACHE 4096
+
+namespace {
+struct ResourceIndex
+{
+    ResourceIndex() : clips(PROJECT_RESOURCES_CACHE) {}
+    QCache<QString, ProjectResources::ClipResources> clips;
+};
+
+Q_GLOBAL_STATIC(ResourceIndex, resourceIndex)
+
+QString modifiedStamp(const QString &path)
+{
+    return QString::number(QFileInfo(path).lastModified().toMSecsSinceEpoch());
+}
+}
+
+//static
+ProjectResources::ClipResources ProjectResources::clipResources(ClipController *clip)
+{
+    ClipResources result;
+    QString key;
+    QString xml;
+    const QUrl url = clip->clipUrl();
+    switch (clip->clipType()) {
+    case SlideShow:
+        // The images found depend on the content of the folder
+        key = QStringLiteral("slideshow:") + url.path() + ':' + modifiedStamp(url.adjusted(QUrl::RemoveFilename).path());
+        break;
+    case Playlist:
+        key = QStringLiteral("playlist:") + url.path() + ':' + modifiedStamp(url.path());
+        break;
+    case Text:
+        xml = clip->property(QStringLiteral("xmldata"));
+        key = QStringLiteral("title:") + QString::fromLatin1(QCryptographicHash::hash(xml.toUtf8(), QCryptographicHash::Md5).toHex());
+        break;
+    case TextTemplate:
+        // All the clips of a template share its resources
+        key = QStringLiteral("template:") + url.path() + ':' + modifiedStamp(url.path());
+        break;
+    case QText:
+        result.fonts << clip->property(QStringLiteral("family"));
+        return result;
+    default:
+        return result;
+    }
+    ClipResources *cached = resourceIndex->clips.object(key);
+    if (cached) {
+        return *cached;
+    }
+    switch (clip->clipType()) {
+    case SlideShow:
+        result.files = ProjectSettings::extractSlideshowUrls(url);
+        break;
+    case Playlist:
+        result.files = ProjectSettings::extractPlaylistUrls(url.path());
+        break;
+    case TextTemplate: {
+        QSharedPointer<const TitleDocument::TemplateInfo> templateInfo = TitleDocument::templateInfo(url.path());
+        if (templateInfo) {
+            result.files = templateInfo->images;
+            result.fonts = templateInfo->fonts;
+        }
+        break;
+    }
+    default:
+        result.files = TitleWidget::extractImageList(xml);
+        result.fonts = TitleWidget::extractFontList(xml);
+        break;
+    }
+    resourceIndex->clips.insert(key, new ClipResources(result));
+    return result;
+}
+
+//static
+void ProjectResources::clear()
+{
+    resourceIndex->clips.clear();
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+#ifndef PROJECTRESOURCES_H
+#define PROJECTRESOURCES_H
+
+#include <QStringList>
+
+class ClipController;
+
+/**
+ * @class ProjectResources
+ * @brief Index of the files and fonts referenced by project clips.
+ *
+ * Project settings and the archive dialog list the files used inside clips: slideshow
+ * images, playlist content, title images and fonts. Extracting them parses titles and
+ * playlists and lists slideshow folders, so the results are shared by both dialogs and
+ * kept between uses. Entries are keyed by the title data or by the modification time of
+ * the referenced file, so a clip edited in the bin or a playlist changed on disk is
+ * simply extracted again, while unchanged clips are answered from the index.
+ */
+class ProjectResources
+{
+public:
+    struct ClipResources
+    {
+        /** @brief Files referenced by the clip besides its own url */
+        QStringList files;
+        QStringList fonts;
+    };
+
+    /** @brief Returns the files and fonts used inside @param clip */
+    static ClipResources clipResources(ClipController *clip);
+    /** @brief Forget all indexed clips */
+    static void clear();
+};
+
+#endif
@@ -20,20 +20,84 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "qmlaudiothumb.h"
-#include <QPainter>
+
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+
+#include <cmath>
 
 QmlAudioThumb::QmlAudioThumb(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+    : QQuickItem(parent)
+    , m_geometryDirty(true)
 {
+    setFlag(ItemHasContents, true);
 }
 
-void QmlAudioThumb::setImage(QImage &img)
+void QmlAudioThumb::setAudioLevels(const AudioLevels &levels)
 {
-    m_img = img;
+    m_levels = levels;
+    m_geometryDirty = true;
     update();
 }
 
-void QmlAudioThumb::paint(QPainter *painter)
+void QmlAudioThumb::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        m_geometryDirty = true;
+        update();
+    }
+}
+
+QSGNode *QmlAudioThumb::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
-    painter->drawImage(boundingRect().adjusted(1, 1, -1, -1), m_img);
+    QSGGeometryNode *node = static_cast<QSGGeometryNode *>(oldNode);
+    int channels = m_levels.channels();
+    if (m_levels.isEmpty() || channels <= 0 || width() < 1 || height() < 1) {
+        delete node;
+        return NULL;
+    }
+    if (!node) {
+        node = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        geometry->setDrawingMode(GL_TRIANGLE_STRIP);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        QSGFlatColorMaterial *material = new QSGFlatColorMaterial;
+        material->setColor(QColor(80, 80, 150, 200));
+        node->setMaterial(material);
+        node->setFlag(QSGNode::OwnsMaterial);
+        m_geometryDirty = true;
+    }
+    if (!m_geometryDirty) {
+        return node;
+    }
+    m_geometryDirty = false;
+    // While the levels are extracted, only the first frames of the clip are drawn
+    const int readyFrames = m_levels.frames();
+    const double bottom = height();
+    const double scale = width() / qMax(1, m_levels.totalFrames() - 1);
+    // One value per pixel when zoomed out, read from the peak pyramid, one value per frame otherwise
+    const int peakLevel = scale < 1 ? AudioLevels::pyramidLevel(scale) : 0;
+    const int samples = scale < 1 ? qMin((int) width(), (int) ceil(readyFrames * scale)) : readyFrames;
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(2 * samples + 2);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+    double x = 0;
+    for (int i = 0; i < samples; i++) {
+        int framePos = scale < 1 ? (int) (i / scale) : i;
+        x = scale < 1 ? i : i * scale;
+        int value = m_levels.peak(peakLevel, framePos, 0);
+        for (int channel = 1; channel < channels; channel++) {
+            value = qMax(value, m_levels.peak(peakLevel, framePos, channel));
+        }
+        vertices[2 * i].set(x, bottom);
+        vertices[2 * i + 1].set(x, bottom - value * bottom / 256);
+    }
+    // Close the strip on the last drawn column, or the item edge when all levels are known
+    x = m_levels.isComplete() ? width() : x;
+    vertices[2 * samples].set(x, bottom);
+    vertices[2 * samples + 1].set(x, bottom);
+    node->markDirty(QSGNode::DirtyGeometry);
+    return node;
 }
@@ -23,20 +23,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define QMLAUDIOTHUMBS_H
 
 
-#include <QQuickPaintedItem>
-#include <QImage>
+#include "bin/audiolevels.h"
 
-class QPainter;
+#include <QQuickItem>
 
-class QmlAudioThumb : public QQuickPaintedItem
+class QSGNode;
+
+/**
+ * @class QmlAudioThumb
+ * @brief Draws the audio levels of the clip monitor as a scene graph geometry node.
+ * The vertex data, one peak per pixel, is only rebuilt when the levels or the item size change,
+ * other frames are composited on the GPU without any painting.
+ */
+class QmlAudioThumb : public QQuickItem
 {
     Q_OBJECT
 public:
     explicit QmlAudioThumb(QQuickItem *parent = 0);
-    void setImage(QImage &img);
-    void paint(QPainter *painter);
+    /** @brief Set the levels to display, shared with the bin clip. */
+    void setAudioLevels(const AudioLevels &levels);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) Q_DECL_OVERRIDE;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) Q_DECL_OVERRIDE;
+
 private:
-    QImage m_img;
+    AudioLevels m_levels;
+    /** @brief True when the vertex data has to be rebuilt on next paint node update. */
+    bool m_geometryDirty;
 };
 
 #endif
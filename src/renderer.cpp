@@ -33,6 +33,7 @@
 #include "bin/projectclip.h"
 #include "timeline/clip.h"
 #include "monitor/glwidget.h"
+#include "monitor/audioscrubber.h"
 #include "mltcontroller/clipcontroller.h"
 #include "timeline/transitionhandler.h"
 #include <mlt++/Mlt.h>
@@ -56,6 +57,20 @@
 #include <QVBoxLayout>
 
 #define SEEK_INACTIVE (-1)
+// Number of frames decoded ahead of the cursor in the scrub direction
+#define FRAME_READ_AHEAD 5
+// Delay (in ms) the cursor must stay still before decoding the following frames
+#define IDLE_PREFETCH_DELAY 300
+// Delay (in ms) without jog events after which a fast spin is considered finished
+#define JOG_SETTLE_DELAY 150
+// Preview scale used for the frames passed during a fast jog spin
+#define JOG_PREVIEW_SCALE 2
+// Preview scale used during playback of the multitrack split view
+#define GRID_PREVIEW_SCALE 2
+// Number of files kept open to extract frames
+#define FRAME_PRODUCER_CACHE 4
+// Delay (in ms) after the last frame extraction before the files are closed
+#define FRAME_PRODUCER_TIMEOUT 10000
 
 Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, GLWidget *qmlView, QWidget *parent) :
     AbstractRender(rendererName, parent),
@@ -74,7 +89,14 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
     m_isLoopMode(false),
     m_blackClip(NULL),
     m_isActive(false),
-    m_isRefreshing(false)
+    m_isRefreshing(false),
+    m_prefetchPending(-1),
+    m_prefetchOrigin(0),
+    m_prefetchActive(false),
+    m_lastSettledPosition(0),
+    m_jogReduced(false),
+    m_gridPreview(false),
+    m_audioScrubber(NULL)
 {
     qRegisterMetaType<stringMap> ("stringMap");
     analyseAudio = KdenliveSettings::monitor_audio();
@@ -88,16 +110,30 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
         m_mltProducer = m_blackClip->cut(0, 1);
         m_qmlView->setProducer(m_mltProducer);
         m_mltConsumer = qmlView->consumer();
+        connect(m_qmlView, SIGNAL(frameCached(int)), this, SLOT(slotFrameCached(int)));
+        if (KdenliveSettings::scrubaudiocache() > 0 && AudioScrubber::isAvailable()) {
+            m_audioScrubber = new AudioScrubber(this);
+        }
     }
     /*m_mltConsumer->connect(*m_mltProducer);
     m_mltProducer->set_speed(0.0);*/
     m_refreshTimer.setSingleShot(true);
     m_refreshTimer.setInterval(50);
     connect(&m_refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(IDLE_PREFETCH_DELAY);
+    connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(slotIdlePrefetch()));
+    m_jogTimer.setSingleShot(true);
+    m_jogTimer.setInterval(JOG_SETTLE_DELAY);
+    connect(&m_jogTimer, SIGNAL(timeout()), this, SLOT(slotJogSettled()));
+    m_frameProducerTimer.setSingleShot(true);
+    m_frameProducerTimer.setInterval(FRAME_PRODUCER_TIMEOUT);
+    connect(&m_frameProducerTimer, SIGNAL(timeout()), this, SLOT(releaseFrameProducers()));
     connect(this, SIGNAL(checkSeeking()), this, SLOT(slotCheckSeeking()));
     if (m_name == Kdenlive::ProjectMonitor) {
         connect(m_binController, SIGNAL(prepareTimelineReplacement(QString)), this, SIGNAL(prepareTimelineReplacement(QString)), Qt::DirectConnection);
         connect(m_binController, SIGNAL(replaceTimelineProducer(QString)), this, SIGNAL(replaceTimelineProducer(QString)), Qt::DirectConnection);
+        connect(m_binController, SIGNAL(replaceTimelineProducers(QStringList)), this, SIGNAL(replaceTimelineProducers(QStringList)), Qt::DirectConnection);
 	connect(m_binController, SIGNAL(updateTimelineProducer(QString)), this, SIGNAL(updateTimelineProducer(QString)));
         connect(m_binController, SIGNAL(setDocumentNotes(QString)), this, SIGNAL(setDocumentNotes(QString)));
     }
@@ -110,6 +146,10 @@ Render::~Render()
 
 void Render::closeMlt()
 {
+    releaseFrameProducers();
+    // Waits for the running audio decode, which uses the profile
+    delete m_audioScrubber;
+    m_audioScrubber = NULL;
     delete m_showFrameEvent;
     delete m_pauseEvent;
     delete m_mltConsumer;
@@ -126,6 +166,8 @@ void Render::slotSwitchFullscreen()
 void Render::prepareProfileReset(double fps)
 {
     m_refreshTimer.stop();
+    releaseFrameProducers();
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     m_fps = fps;
 }
 
@@ -161,7 +203,22 @@ void Render::seek(int time)
 {
     resetZoneMode();
     time = qBound(0, time, m_mltProducer->get_length() - 1);
+    abortPrefetch();
+    if (m_audioScrubber && m_mltProducer->get_speed() == 0) {
+        // Cached scrub audio is immediate, the consumer only decodes it when the cache misses
+        m_mltConsumer->set("scrub_audio", m_audioScrubber->scrub(time) ? 0 : 1);
+    }
+    if (time == m_prefetchPending) {
+        // The frame being decoded ahead must be displayed
+        m_qmlView->setPrefetchPosition(-1);
+        m_prefetchPending = -1;
+    }
     if (requestedSeekPosition == SEEK_INACTIVE) {
+        if (m_mltProducer->get_speed() == 0 && !externalConsumer && m_qmlView && m_qmlView->showCachedFrame(time)) {
+            // Frame already decoded, no need to ask the consumer
+            m_mltProducer->seek(time);
+            return;
+        }
         requestedSeekPosition = time;
         if (m_mltProducer->get_speed() != 0) {
             m_mltConsumer->purge();
@@ -202,14 +259,9 @@ QImage Render::extractFrame(int frame_position, const QString &path, int width,
         height = renderHeight();
     } else if (width % 2 == 1) width++;
     if (!path.isEmpty()) {
-        Mlt::Producer *producer = new Mlt::Producer(*m_qmlView->profile(), path.toUtf8().constData());
+        Mlt::Producer *producer = frameProducer(path);
         if (producer) {
-            if (producer->is_valid()) {
-                QImage img = KThumb::getFrame(producer, frame_position, width, height);
-                delete producer;
-                return img;
-            }
-            else delete producer;
+            return KThumb::getFrame(producer, frame_position, width, height);
         }
     }
 
@@ -239,6 +291,69 @@ QImage Render::extractFrame(int frame_position, const QString &path, int width,
     return img;
 }
 
+QList <QImage> Render::extractFrames(const QList <int> &positions, const QString &path, int width, int height)
+{
+    if (width == -1) {
+        width = frameRenderWidth();
+        height = renderHeight();
+    } else if (width % 2 == 1) width++;
+    QList <QImage> images;
+    Mlt::Producer *producer = frameProducer(path);
+    if (!producer) {
+        QImage pix(width, height, QImage::Format_RGB32);
+        pix.fill(Qt::black);
+        for (int i = 0; i < positions.count(); ++i) {
+            images << pix;
+        }
+        return images;
+    }
+    // Decode in ascending order so that the demuxer mostly reads forward
+    QList <int> sorted = positions;
+    qSort(sorted);
+    QMap <int, QImage> frames;
+    foreach(int position, sorted) {
+        if (!frames.contains(position)) {
+            frames.insert(position, KThumb::getFrame(producer, position, width, height));
+        }
+    }
+    foreach(int position, positions) {
+        images << frames.value(position);
+    }
+    return images;
+}
+
+Mlt::Producer *Render::frameProducer(const QString &path)
+{
+    if (!m_qmlView || path.isEmpty()) return NULL;
+    Mlt::Profile *profile = m_qmlView->profile();
+    const QString key = QStringLiteral("%1x%2:%3/%4:").arg(profile->width()).arg(profile->height()).arg(profile->frame_rate_num()).arg(profile->frame_rate_den()) + path;
+    m_frameProducerTimer.start();
+    for (int i = 0; i < m_frameProducers.count(); ++i) {
+        if (m_frameProducers.at(i).first == key) {
+            m_frameProducers.move(i, 0);
+            return m_frameProducers.first().second;
+        }
+    }
+    Mlt::Producer *producer = new Mlt::Producer(*profile, path.toUtf8().constData());
+    if (!producer->is_valid()) {
+        delete producer;
+        return NULL;
+    }
+    m_frameProducers.prepend(qMakePair(key, producer));
+    while (m_frameProducers.count() > FRAME_PRODUCER_CACHE) {
+        delete m_frameProducers.takeLast().second;
+    }
+    return producer;
+}
+
+void Render::releaseFrameProducers()
+{
+    m_frameProducerTimer.stop();
+    while (!m_frameProducers.isEmpty()) {
+        delete m_frameProducers.takeFirst().second;
+    }
+}
+
 int Render::getLength()
 {
 
@@ -315,6 +430,7 @@ void Render::loadUrl(const QString &url)
 
 bool Render::updateProducer(Mlt::Producer *producer)
 {
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     if (m_mltProducer) {
         if (strcmp(m_mltProducer->get("resource"), "<tractor>") == 0) {
             // We need to make some cleanup
@@ -346,6 +462,7 @@ bool Render::updateProducer(Mlt::Producer *producer)
 bool Render::setProducer(Mlt::Producer *producer, int position, bool isActive)
 {
     m_refreshTimer.stop();
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     requestedSeekPosition = SEEK_INACTIVE;
     QMutexLocker locker(&m_mutex);
     QString currentId;
@@ -428,6 +545,7 @@ int Render::setSceneList(QString playlist, int position)
 {
     requestedSeekPosition = SEEK_INACTIVE;
     m_refreshTimer.stop();
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     QMutexLocker locker(&m_mutex);
     //if (m_winid == -1) return -1;
     int error = 0;
@@ -516,6 +634,7 @@ int Render::setSceneList(QString playlist, int position)
 
     // Fill bin
     QStringList ids = m_binController->getClipIds();
+    emit binClipsBatch(true);
     foreach(const QString &id, ids) {
         if (id == QLatin1String("black"))
             continue;
@@ -526,6 +645,7 @@ int Render::setSceneList(QString playlist, int position)
         info.replaceProducer = true;
         emit gotFileProperties(info, m_binController->getController(id));
     }
+    emit binClipsBatch(false);
 
     ////qDebug()<<"// SETSCN LST, POS: "<<position;
     if (position != 0) emit rendererPosition(position);
@@ -670,6 +790,7 @@ void Render::start()
 
 void Render::stop()
 {
+    abortPrefetch();
     requestedSeekPosition = SEEK_INACTIVE;
     m_refreshTimer.stop();
     QMutexLocker locker(&m_mutex);
@@ -725,6 +846,7 @@ void Render::switchPlay(bool play, double speed)
     requestedSeekPosition = SEEK_INACTIVE;
     if (!m_mltProducer || !m_mltConsumer || !m_isActive)
         return;
+    abortPrefetch();
     if (m_isZoneMode) resetZoneMode();
     if (play) {
         double currentSpeed = m_mltProducer->get_speed();
@@ -739,6 +861,7 @@ void Render::switchPlay(bool play, double speed)
             }
         }
         if (currentSpeed == 0) {
+            if (m_gridPreview) m_qmlView->setPreviewScale(GRID_PREVIEW_SCALE);
             m_mltConsumer->start();
             m_isRefreshing = true;
             m_mltConsumer->set("refresh", 1);
@@ -754,6 +877,8 @@ void Render::switchPlay(bool play, double speed)
         m_mltConsumer->set("buffer", 0);
         m_mltConsumer->set("prefill", 0);
         m_mltConsumer->set("real_time", -1);
+        // Adaptive preview scaling only applies during playback
+        m_qmlView->setPreviewScale(1);
         m_mltProducer->seek(m_mltConsumer->position() + 1);
     }
 }
@@ -764,6 +889,7 @@ void Render::play(double speed)
     if (!m_mltProducer || !m_isActive) return;
     double current_speed = m_mltProducer->get_speed();
     if (current_speed == speed) return;
+    abortPrefetch();
     if (m_isZoneMode) resetZoneMode();
     if (speed != 0 && m_mltConsumer->get_int("real_time") != m_qmlView->realTime()) {
         m_mltConsumer->set("real_time", m_qmlView->realTime());
@@ -775,9 +901,12 @@ void Render::play(double speed)
         }
     }
     if (current_speed == 0) {
+        if (m_gridPreview) m_qmlView->setPreviewScale(GRID_PREVIEW_SCALE);
         m_mltConsumer->start();
         m_isRefreshing = true;
         m_mltConsumer->set("refresh", 1);
+    } else if (speed == 0) {
+        m_qmlView->setPreviewScale(1);
     }
     m_mltProducer->set_speed(speed);
 }
@@ -787,6 +916,7 @@ void Render::play(const GenTime & startTime)
     requestedSeekPosition = SEEK_INACTIVE;
     if (!m_mltProducer || !m_mltConsumer || !m_isActive)
         return;
+    abortPrefetch();
     m_mltProducer->seek((int)(startTime.frames(m_fps)));
     m_mltProducer->set_speed(1.0);
     m_isRefreshing = true;
@@ -809,6 +939,7 @@ bool Render::playZone(const GenTime & startTime, const GenTime & stopTime)
     requestedSeekPosition = SEEK_INACTIVE;
     if (!m_mltProducer || !m_mltConsumer || !m_isActive)
         return false;
+    abortPrefetch();
     m_mltProducer->seek((int)(startTime.frames(m_fps)));
     m_mltProducer->set_speed(0);
     m_mltConsumer->purge();
@@ -853,8 +984,53 @@ void Render::seekToFrameDiff(int diff)
     }
 }
 
+void Render::setGridPreview(bool enable)
+{
+    m_gridPreview = enable;
+    if (m_mltProducer && playSpeed() != 0) {
+        m_qmlView->setPreviewScale(enable ? GRID_PREVIEW_SCALE : 1);
+    }
+}
+
+void Render::jogSeek(int diff, bool fast)
+{
+    if (byPassSeek) {
+        emit renderSeek(diff);
+        return;
+    }
+    if (!m_mltProducer || !m_isActive)
+        return;
+    int target = (requestedSeekPosition == SEEK_INACTIVE ? seekFramePosition() : requestedSeekPosition) + diff;
+    target = qBound(0, target, m_mltProducer->get_length() - 1);
+    if (fast && m_qmlView && playSpeed() == 0 && !m_qmlView->isFrameCached(target)) {
+        // Frames passed during a fast spin are only glanced at, decode them at reduced
+        // resolution. Reduced frames never enter the frame cache.
+        m_qmlView->setPreviewScale(JOG_PREVIEW_SCALE);
+        m_jogReduced = true;
+    }
+    if (m_jogReduced) {
+        m_jogTimer.start();
+    }
+    seek(target);
+}
+
+void Render::slotJogSettled()
+{
+    if (!m_jogReduced) return;
+    m_jogReduced = false;
+    if (!m_mltProducer || !m_qmlView || playSpeed() != 0) {
+        // Playback manages its own preview scale
+        return;
+    }
+    m_qmlView->setPreviewScale(1);
+    seek(requestedSeekPosition == SEEK_INACTIVE ? seekFramePosition() : requestedSeekPosition);
+}
+
 void Render::doRefresh()
 {
+    // Also drop the frames of an inactive monitor, they would be shown or shared later
+    if (m_qmlView) m_qmlView->invalidateFrameCache();
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     if (m_mltProducer && (playSpeed() == 0) && m_isActive) {
         if (m_isRefreshing) m_refreshTimer.start();
         else refresh();
@@ -864,8 +1040,12 @@ void Render::doRefresh()
 void Render::refresh()
 {
     m_refreshTimer.stop();
+    // The producer changed, previously decoded frames are obsolete
+    if (m_qmlView) m_qmlView->invalidateFrameCache();
+    if (m_audioScrubber) m_audioScrubber->invalidate();
     if (!m_mltProducer || !m_isActive)
         return;
+    abortPrefetch();
     QMutexLocker locker(&m_mutex);
     if (m_mltConsumer) {
         m_isRefreshing = true;
@@ -923,6 +1103,8 @@ GenTime Render::seekPosition() const
 
 int Render::seekFramePosition() const
 {
+    if (m_prefetchActive)
+        return m_prefetchOrigin;
     if (m_mltProducer && m_mltProducer->get_speed() == 0)
         return (int) m_mltProducer->position();
     if (m_mltConsumer) return (int) m_mltConsumer->position();
@@ -950,6 +1132,7 @@ void Render::emitFrameUpdated(Mlt::Frame& frame)
 int Render::getCurrentSeekPosition() const
 {
     if (requestedSeekPosition != SEEK_INACTIVE) return requestedSeekPosition;
+    if (m_prefetchActive) return m_prefetchOrigin;
     return (int) m_mltConsumer->position();
 }
 
@@ -969,8 +1152,15 @@ bool Render::checkFrameNumber(int pos)
     } else {
         m_isRefreshing = false;
         if (m_mltProducer->get_speed() == 0) {
-            m_mltConsumer->stop();
-            m_mltConsumer->purge();
+            if (m_audioScrubber) {
+                // The cursor settled, decode the audio around it for the next scrub
+                if (m_audioScrubber->needsSource()) m_audioScrubber->setSource(m_qmlView->profile(), sceneList());
+                m_audioScrubber->prepare(pos);
+            }
+            if (!startPrefetch(pos)) {
+                m_mltConsumer->stop();
+                m_mltConsumer->purge();
+            }
         } else if (m_isZoneMode) {
             if (pos >= m_mltProducer->get_int("out") - 1) {
                 if (m_isLoopMode) {
@@ -987,6 +1177,95 @@ bool Render::checkFrameNumber(int pos)
     return true;
 }
 
+bool Render::startPrefetch(int position)
+{
+    int direction = position < m_lastSettledPosition ? -1 : 1;
+    m_lastSettledPosition = position;
+    if (!m_qmlView || externalConsumer || m_qmlView->glslManager() || KdenliveSettings::framecachememory() <= 0) {
+        return false;
+    }
+    m_prefetchQueue.clear();
+    m_idleQueue.clear();
+    int length = m_mltProducer->get_length();
+    for (int i = 1; i <= FRAME_READ_AHEAD; ++i) {
+        int pos = position + direction * i;
+        if (pos < 0 || pos >= length) break;
+        if (!m_qmlView->isFrameCached(pos)) m_prefetchQueue << pos;
+    }
+    // While paused, the frames that playback will need first are decoded too
+    int idleFrames = KdenliveSettings::idleprefetchframes();
+    for (int pos = position + 1; pos <= position + idleFrames && pos < length; ++pos) {
+        if (!m_prefetchQueue.contains(pos) && !m_qmlView->isFrameCached(pos)) m_idleQueue << pos;
+    }
+    if (m_prefetchQueue.isEmpty() && m_idleQueue.isEmpty()) {
+        return false;
+    }
+    m_prefetchActive = true;
+    m_prefetchOrigin = position;
+    // Frames decoded ahead must stay silent
+    m_mltConsumer->set("scrub_audio", 0);
+    prefetchNext();
+    return true;
+}
+
+void Render::prefetchNext()
+{
+    while (!m_prefetchQueue.isEmpty() && m_qmlView->isFrameCached(m_prefetchQueue.first())) {
+        m_prefetchQueue.removeFirst();
+    }
+    if (m_prefetchQueue.isEmpty()) {
+        if (!m_idleQueue.isEmpty()) {
+            // Wait until the cursor stays still before decoding further
+            m_mltProducer->seek(m_prefetchOrigin);
+            m_mltConsumer->stop();
+            m_mltConsumer->purge();
+            m_idleTimer.start();
+            return;
+        }
+        abortPrefetch();
+        m_mltConsumer->stop();
+        m_mltConsumer->purge();
+        return;
+    }
+    m_prefetchPending = m_prefetchQueue.takeFirst();
+    m_qmlView->setPrefetchPosition(m_prefetchPending);
+    m_mltProducer->seek(m_prefetchPending);
+    if (m_mltConsumer->is_stopped()) {
+        m_mltConsumer->start();
+    }
+    m_mltConsumer->set("refresh", 1);
+}
+
+void Render::abortPrefetch()
+{
+    if (!m_prefetchActive) return;
+    m_prefetchActive = false;
+    m_idleTimer.stop();
+    m_prefetchQueue.clear();
+    m_idleQueue.clear();
+    if (m_mltProducer) m_mltProducer->seek(m_prefetchOrigin);
+    if (m_mltConsumer) m_mltConsumer->set("scrub_audio", 1);
+}
+
+void Render::slotFrameCached(int position)
+{
+    if (position != m_prefetchPending) return;
+    m_prefetchPending = -1;
+    if (m_prefetchActive && requestedSeekPosition == SEEK_INACTIVE && m_mltProducer && m_mltProducer->get_speed() == 0) {
+        prefetchNext();
+    }
+}
+
+void Render::slotIdlePrefetch()
+{
+    if (!m_prefetchActive || requestedSeekPosition != SEEK_INACTIVE || !m_mltProducer || m_mltProducer->get_speed() != 0) {
+        return;
+    }
+    m_prefetchQueue = m_idleQueue;
+    m_idleQueue.clear();
+    prefetchNext();
+}
+
 void Render::slotCheckSeeking()
 {
     if (requestedSeekPosition != SEEK_INACTIVE) {
@@ -1378,13 +1657,11 @@ void Render::fillSlowMotionProducers()
             if (nprod) {
                 QString id = nprod->parent().get("id");
                 if (id.startsWith(QLatin1String("slowmotion:")) && !nprod->is_blank()) {
-                    // this is a slowmotion producer, add it to the list
-                    QString url = QString::fromUtf8(nprod->get("resource"));
-                    int strobe = nprod->get_int("strobe");
-                    if (strobe > 1) url.append("&strobe=" + QString::number(strobe));
-                    if (!m_slowmotionProducers.contains(url)) {
-                        m_slowmotionProducers.insert(url, nprod);
-                    }
+                    // this is a slowmotion producer, add it to the list, keyed like Track::SlowmoInfo::poolKey()
+                    QString key = id.section(QLatin1Char(':'), 1);
+                    if (!m_slowmotionProducers.contains(key)) {
+                        m_slowmotionProducers.insert(key, nprod);
+                    } else delete nprod;
                 } else delete nprod;
             }
         }
@@ -1561,6 +1838,11 @@ Mlt::Producer *Render::getBinVideoProducer(const QString &id)
     return m_binController->getBinVideoProducer(id);
 }
 
+Mlt::Producer *Render::getBinAudioProducer(const QString &id)
+{
+    return m_binController->getBinAudioProducer(id);
+}
+
 void Render::loadExtraProducer(const QString &id, Mlt::Producer *prod)
 {
     m_binController->loadExtraProducer(id, prod);
@@ -1583,29 +1865,42 @@ void Render::setVolume(double volume)
     }
 }
 
-bool Render::storeSlowmotionProducer(const QString &url, Mlt::Producer *prod, bool replace)
+bool Render::storeSlowmotionProducer(const QString &key, Mlt::Producer *prod, bool replace)
 {
-    if (!m_slowmotionProducers.contains(url)) {
-        m_slowmotionProducers.insert(url, prod);
+    if (!m_slowmotionProducers.contains(key)) {
+        m_slowmotionProducers.insert(key, prod);
         return true;
     }
     else if (replace) {
-        Mlt::Producer *old = m_slowmotionProducers.take(url);
-        delete old;
-        m_slowmotionProducers.insert(url, prod);
+        Mlt::Producer *old = m_slowmotionProducers.take(key);
+        if (old != prod) delete old;
+        m_slowmotionProducers.insert(key, prod);
         return true;
     }
     return false;
 }
 
-Mlt::Producer *Render::getSlowmotionProducer(const QString &url)
+Mlt::Producer *Render::getSlowmotionProducer(const QString &key)
 {
-    if (m_slowmotionProducers.contains(url)) {
-        return m_slowmotionProducers.value(url);
+    if (m_slowmotionProducers.contains(key)) {
+        return m_slowmotionProducers.value(key);
     }
     return NULL;
 }
 
+void Render::releaseSlowmotionProducers()
+{
+    QMutableMapIterator<QString, Mlt::Producer *> i(m_slowmotionProducers);
+    while (i.hasNext()) {
+        i.next();
+        // Timeline cuts hold a reference on their parent, the pool holds the last one
+        if (i.value()->ref_count() <= 1) {
+            delete i.value();
+            i.remove();
+        }
+    }
+}
+
 void Render::updateSlowMotionProducers(const QString &id, QMap <QString, QString> passProperties)
 {
     QMapIterator<QString, Mlt::Producer *> i(m_slowmotionProducers);
@@ -57,6 +57,7 @@ class KComboBox;
 class BinController;
 class ClipController;
 class GLWidget;
+class AudioScrubber;
 
 namespace Mlt
 {
@@ -115,6 +116,11 @@ class Render: public AbstractRender
     /** @brief Seeks the renderer clip to the given time. */
     void seek(const GenTime &time);
     void seekToFrameDiff(int diff);
+    /** @brief Seek diff frames from the last requested position for a jog wheel burst.
+     *  @param fast true when the wheel spins fast, uncached frames are then decoded at reduced resolution */
+    void jogSeek(int diff, bool fast);
+    /** @brief Play at reduced resolution while the monitor shows the tracks in a grid, each one only fills a quarter of the frame. */
+    void setGridPreview(bool enable);
 
     /** @brief Sets the current MLT producer playlist.
      * @param list The xml describing the playlist
@@ -150,6 +156,9 @@ class Render: public AbstractRender
     int volume() const;
 
     QImage extractFrame(int frame_position, const QString &path = QString(), int width = -1, int height = -1);
+    /** @brief Extracts several frames of the file at path, opening it only once.
+     *  @return the images, in the order of positions */
+    QList <QImage> extractFrames(const QList <int> &positions, const QString &path, int width = -1, int height = -1);
 
     /** @brief Plays the scene starting from a specific time.
      * @param startTime time to start playing the scene from */
@@ -191,7 +200,10 @@ class Render: public AbstractRender
      * Playlist manipulation.
      */
     void mltCheckLength(Mlt::Tractor *tractor);
-    Mlt::Producer *getSlowmotionProducer(const QString &url);
+    /** @brief Returns the slowmotion producer stored under @param key, see Track::SlowmoInfo::poolKey(). */
+    Mlt::Producer *getSlowmotionProducer(const QString &key);
+    /** @brief Delete the stored slowmotion producers that are not used in the timeline anymore. */
+    void releaseSlowmotionProducers();
     void mltInsertSpace(QMap <int, int> trackClipStartList, QMap <int, int> trackTransitionStartList, int track, const GenTime &duration, const GenTime &timeOffset);
     int mltGetSpaceLength(const GenTime &pos, int track, bool fromBlankStart);
     bool mltResizeClipCrop(ItemInfo info, GenTime newCropStart);
@@ -245,6 +257,8 @@ class Render: public AbstractRender
     Mlt::Producer *getBinProducer(const QString &id);
     /** @brief Get a clip's video only producer */
     Mlt::Producer *getBinVideoProducer(const QString &id);
+    /** @brief Get a clip's audio only producer */
+    Mlt::Producer *getBinAudioProducer(const QString &id);
     /** @brief Load extra producers (video only, slowmotion) from timeline */
     void loadExtraProducer(const QString &id, Mlt::Producer *prod);
     /** @brief Get a property from the bin's playlist */
@@ -304,14 +318,53 @@ private:
     void checkMaxThreads();
     /** @brief Clone serialisable properties only */
     void cloneProperties(Mlt::Properties &dest, Mlt::Properties &source);
+    /** @brief Frames waiting to be decoded ahead of the cursor while paused */
+    QList <int> m_prefetchQueue;
+    /** @brief Frames after the cursor decoded once the monitor stayed paused for a while */
+    QList <int> m_idleQueue;
+    QTimer m_idleTimer;
+    /** @brief Position requested from the consumer for the frame cache, -1 if none */
+    int m_prefetchPending;
+    /** @brief Displayed position, restored once the frames ahead are decoded */
+    int m_prefetchOrigin;
+    bool m_prefetchActive;
+    /** @brief Last position where the cursor stopped, used to find the scrub direction */
+    int m_lastSettledPosition;
+    /** @brief Started by a fast jog spin, restores the full resolution once the wheel stops */
+    QTimer m_jogTimer;
+    /** @brief True while the displayed frames are decoded at reduced resolution for a fast jog spin */
+    bool m_jogReduced;
+    /** @brief True while the multitrack view is displayed */
+    bool m_gridPreview;
+    /** @brief Plays the scrub audio from decoded samples, NULL if unavailable or disabled */
+    AudioScrubber *m_audioScrubber;
+    /** @brief Decode the frames following position in the scrub direction into the monitor's frame cache.
+     *  @return false if there is nothing to decode */
+    bool startPrefetch(int position);
+    void prefetchNext();
+    /** @brief Stops decoding ahead and seeks back to the displayed position. */
+    void abortPrefetch();
     /** @brief Get a track producer from a clip's id */
     Mlt::Producer *getProducerForTrack(Mlt::Playlist &trackPlaylist, const QString &clipId);
+    /** @brief Producers recently opened to extract frames from a file, most recent first, keyed by profile and path */
+    QList <QPair <QString, Mlt::Producer *> > m_frameProducers;
+    /** @brief Releases the frame producers once no frame was extracted for a while */
+    QTimer m_frameProducerTimer;
+    /** @brief Returns a producer for path in the current profile, reusing a recently opened one. NULL if the file cannot be opened. */
+    Mlt::Producer *frameProducer(const QString &path);
 
 private slots:
 
     /** @brief Refreshes the monitor display. */
     void refresh();
     void slotCheckSeeking();
+    /** @brief A frame decoded ahead of the cursor is in the cache, decode the next one. */
+    void slotFrameCached(int position);
+    /** @brief The monitor stayed paused, decode the frames following the cursor. */
+    void slotIdlePrefetch();
+    /** @brief The jog wheel stopped, display the final position at full resolution. */
+    void slotJogSettled();
+    void releaseFrameProducers();
 
 signals:
     /** @brief The renderer stopped, either playing or rendering. */
@@ -331,11 +384,15 @@ signals:
 
     /** @brief A clip has changed, we must reload timeline producers. */
     void replaceTimelineProducer(const QString&);
+    /** @brief Several clips have changed, we must reload their timeline producers in one pass. */
+    void replaceTimelineProducers(const QStringList&);
     void updateTimelineProducer(const QString&);
     /** @brief Load project notes. */
     void setDocumentNotes(const QString&);
     /** @brief The renderer received a reply to a getFileProperties request. */
     void gotFileProperties(requestClipInfo,ClipController *);
+    /** @brief Emitted before (start = true) and after the project clips are passed to the Bin. */
+    void binClipsBatch(bool start);
 
     /** @brief A frame's image has to be shown.
      *
@@ -373,8 +430,8 @@ public slots:
 
     /** @brief Renderer moved to a new frame, check seeking */
     bool checkFrameNumber(int pos);
-    /** @brief Keep a reference to slowmo producer. Returns false is producer is already stored */
-    bool storeSlowmotionProducer(const QString &url, Mlt::Producer *prod, bool replace = false);
+    /** @brief Keep a reference to slowmo producer, shared by all tracks. Returns false is producer is already stored */
+    bool storeSlowmotionProducer(const QString &key, Mlt::Producer *prod, bool replace = false);
     void seek(int time);
 };
 
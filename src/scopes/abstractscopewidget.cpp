@@ -12,6 +12,7 @@
 
 #include "renderer.h"
 #include "monitor/monitor.h"
+#include "utils/tracer.h"
 
 #include <QtConcurrent>
 #include <QColor>
@@ -158,7 +159,7 @@ void AbstractScopeWidget::prodHUDThread()
 
             m_newHUDFrames.fetchAndStoreRelaxed(0);
             m_newHUDUpdates.fetchAndStoreRelaxed(0);
-            m_threadHUD = QtConcurrent::run(this, &AbstractScopeWidget::renderHUD, m_accelFactorHUD);
+            m_threadHUD = QtConcurrent::run(this, &AbstractScopeWidget::tracedRenderHUD, m_accelFactorHUD);
 #ifdef DEBUG_ASW
             qDebug() << "HUD thread started in " << m_widgetName;
 #endif
@@ -172,6 +173,24 @@ void AbstractScopeWidget::prodHUDThread()
     }
 }
 
+QImage AbstractScopeWidget::tracedRenderHUD(uint accelerationFactor)
+{
+    TRACE_ZONE("scopes", "AbstractScopeWidget::renderHUD");
+    return renderHUD(accelerationFactor);
+}
+
+QImage AbstractScopeWidget::tracedRenderScope(uint accelerationFactor)
+{
+    TRACE_ZONE("scopes", "AbstractScopeWidget::renderScope");
+    return renderScope(accelerationFactor);
+}
+
+QImage AbstractScopeWidget::tracedRenderBackground(uint accelerationFactor)
+{
+    TRACE_ZONE("scopes", "AbstractScopeWidget::renderBackground");
+    return renderBackground(accelerationFactor);
+}
+
 void AbstractScopeWidget::prodScopeThread()
 {
     // Only start a new thread if the scope is actually visible
@@ -194,7 +213,7 @@ void AbstractScopeWidget::prodScopeThread()
 
             // See http://doc.qt.nokia.com/latest/qtconcurrentrun.html#run about
             // running member functions in a thread
-            m_threadScope = QtConcurrent::run(this, &AbstractScopeWidget::renderScope, m_accelFactorScope);
+            m_threadScope = QtConcurrent::run(this, &AbstractScopeWidget::tracedRenderScope, m_accelFactorScope);
             m_requestForcedUpdate = false;
 
 #ifdef DEBUG_ASW
@@ -220,7 +239,7 @@ void AbstractScopeWidget::prodBackgroundThread()
 
             m_newBackgroundFrames.fetchAndStoreRelaxed(0);
             m_newBackgroundUpdates.fetchAndStoreRelaxed(0);
-            m_threadBackground = QtConcurrent::run(this, &AbstractScopeWidget::renderBackground, m_accelFactorBackground);
+            m_threadBackground = QtConcurrent::run(this, &AbstractScopeWidget::tracedRenderBackground, m_accelFactorBackground);
 
 #ifdef DEBUG_ASW
             qDebug() << "Background thread started in " << m_widgetName;
@@ -527,6 +546,11 @@ void AbstractScopeWidget::slotRenderZoneUpdated()
     }
 }
 
+void AbstractScopeWidget::requestFullQuality()
+{
+    m_accelFactorScope = 1;
+}
+
 void AbstractScopeWidget::slotResetRealtimeFactor(bool realtimeChecked)
 {
     if (!realtimeChecked) {
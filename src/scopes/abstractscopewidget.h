@@ -86,6 +86,10 @@ public:
 
     bool needsSingleFrame();
 
+    /** Runs the next scope calculation without acceleration, e.g. for the frame playback was paused on.
+        The realtime logic adapts the factor again afterwards. */
+    void requestFullQuality();
+
     ///// Unimplemented /////
 
     virtual QString widgetName() const = 0;
@@ -263,6 +267,11 @@ private:
     QSemaphore m_semaphoreScope;
     QSemaphore m_semaphoreBackground;
 
+    /** @brief Thread entry points, wrapping the render functions in a trace zone. */
+    QImage tracedRenderHUD(uint accelerationFactor);
+    QImage tracedRenderScope(uint accelerationFactor);
+    QImage tracedRenderBackground(uint accelerationFactor);
+
     QFuture<QImage> m_threadHUD;
     QFuture<QImage> m_threadScope;
     QFuture<QImage> m_threadBackground;
@@ -10,8 +10,12 @@
 
 #include "abstractgfxscopewidget.h"
 #include "renderer.h"
+#include "kdenlivesettings.h"
 #include "monitor/monitormanager.h"
 
+#include "klocalizedstring.h"
+
+#include <QMenu>
 #include <QMouseEvent>
 
 // Uncomment for debugging.
@@ -22,7 +26,49 @@
 
 AbstractGfxScopeWidget::AbstractGfxScopeWidget(bool trackMouse, QWidget *parent) :
         AbstractScopeWidget(trackMouse, parent)
+        , m_rgbImages(2)
+        , m_aGpuAnalysis(NULL)
+        , m_countsKind(0)
+{
+}
+
+void AbstractGfxScopeWidget::setScopeCountsKind(ScopeCounts::Kind kind)
+{
+    m_countsKind = kind;
+}
+
+void AbstractGfxScopeWidget::enableGpuAnalysis(ScopeCounts::Kind kind)
+{
+    setScopeCountsKind(kind);
+    m_aGpuAnalysis = new QAction(i18n("Analyse on GPU"), this);
+    m_aGpuAnalysis->setCheckable(true);
+    m_aGpuAnalysis->setChecked(KdenliveSettings::gpuscopes());
+    m_menu->addSeparator();
+    m_menu->addAction(m_aGpuAnalysis);
+    // The setting is shared by all scopes, refresh it before showing the menu
+    connect(m_menu, &QMenu::aboutToShow, this, [this]() {
+        m_aGpuAnalysis->setChecked(KdenliveSettings::gpuscopes());
+    });
+    connect(m_aGpuAnalysis, &QAction::toggled, this, &AbstractGfxScopeWidget::slotGpuAnalysisToggled);
+}
+
+int AbstractGfxScopeWidget::scopeCountsKind() const
+{
+    return m_countsKind;
+}
+
+int AbstractGfxScopeWidget::gpuScopeKind() const
+{
+    return (m_aGpuAnalysis != NULL && KdenliveSettings::gpuscopes()) ? m_countsKind : 0;
+}
+
+void AbstractGfxScopeWidget::slotGpuAnalysisToggled(bool enabled)
 {
+    if (enabled == KdenliveSettings::gpuscopes()) {
+        return;
+    }
+    KdenliveSettings::setGpuscopes(enabled);
+    emit signalGpuAnalysisToggled();
 }
 
 AbstractGfxScopeWidget::~AbstractGfxScopeWidget() { }
@@ -30,9 +76,51 @@ AbstractGfxScopeWidget::~AbstractGfxScopeWidget() { }
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
     QMutexLocker lock(&m_mutex);
+    if (m_scopeFrame.is_valid()) {
+        if (m_countsKind != 0 && m_scopeCounts.contains((ScopeCounts::Kind) m_countsKind)) {
+            return renderGfxScope(accelerationFactor, m_scopeCounts);
+        }
+        if (m_scopeFrame.get_image_format() == mlt_image_yuv420p) {
+            return renderGfxScope(accelerationFactor, m_scopeFrame);
+        }
+        return AbstractGfxScopeWidget::renderGfxScope(accelerationFactor, m_scopeFrame);
+    }
     return renderGfxScope(accelerationFactor, m_scopeImage);
 }
 
+QImage AbstractGfxScopeWidget::renderGfxScope(uint accelerationFactor, const SharedFrame &frame)
+{
+    // Work on a copy, the shared frame must not be modified
+    Mlt::Frame clone = frame.clone(false, true);
+    mlt_image_format format = mlt_image_rgb24a;
+    int width = frame.get_image_width();
+    int height = frame.get_image_height();
+    const uchar *image = clone.get_image(format, width, height);
+    if (!image) {
+        return QImage();
+    }
+    QImage *rgb = m_rgbImages.acquire(width, height, QImage::Format_RGB32);
+    if (!rgb) {
+        // A scope kept the previous image
+        return renderGfxScope(accelerationFactor, QImage(image, width, height, QImage::Format_RGBA8888).convertToFormat(QImage::Format_RGB32));
+    }
+    // Convert into the recycled image instead of allocating one per frame
+    for (int y = 0; y < height; ++y) {
+        const uchar *src = image + y * width * 4;
+        QRgb *dest = reinterpret_cast<QRgb *>(rgb->scanLine(y));
+        for (int x = 0; x < width; ++x, src += 4) {
+            dest[x] = qRgb(src[0], src[1], src[2]);
+        }
+    }
+    return renderGfxScope(accelerationFactor, *rgb);
+}
+
+QImage AbstractGfxScopeWidget::renderGfxScope(uint accelerationFactor, const ScopeCounts &)
+{
+    // Scopes that paint from counts override this
+    return renderGfxScope(accelerationFactor, m_scopeFrame);
+}
+
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 {
     AbstractScopeWidget::mouseReleaseEvent(event);
@@ -47,6 +135,18 @@ void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
 {
     QMutexLocker lock(&m_mutex);
     m_scopeImage = frame;
+    m_scopeFrame = SharedFrame();
+    m_scopeCounts = ScopeCounts();
+    AbstractScopeWidget::slotRenderZoneUpdated();
+}
+
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const SharedFrame &frame, const ScopeCounts &counts)
+{
+    QMutexLocker lock(&m_mutex);
+    // Only a reference is kept, the image data stays owned by the monitor frame
+    m_scopeFrame = frame;
+    m_scopeCounts = counts;
+    m_scopeImage = QImage();
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
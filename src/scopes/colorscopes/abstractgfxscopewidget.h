@@ -16,6 +16,9 @@
 #include <QWidget>
 
 #include "../abstractscopewidget.h"
+#include "monitor/scopes/sharedframe.h"
+#include "utils/imagepool.h"
+#include "scopecounts.h"
 
 
 
@@ -30,6 +33,11 @@ public:
     explicit AbstractGfxScopeWidget(bool trackMouse = false, QWidget *parent = 0);
     virtual ~AbstractGfxScopeWidget(); // Must be virtual because of inheritance, to avoid memory leaks
 
+    /** @brief The ScopeCounts::Kind this scope paints from, 0 if it always reads the frame itself. */
+    int scopeCountsKind() const;
+    /** @brief The ScopeCounts::Kind this scope wants computed on the GPU, 0 if none or if GPU analysis is disabled. */
+    int gpuScopeKind() const;
+
 protected:
     ///// Variables /////
 
@@ -37,6 +45,17 @@ protected:
         when calculation has finished, to allow multi-threading.
         accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible. */
     virtual QImage renderGfxScope(uint accelerationFactor, const QImage &) = 0;
+    /** @brief Scope renderer for the YUV 4:2:0 frame shown by the monitor, read without conversion.
+        The default implementation converts the frame to RGB and calls renderGfxScope(uint, const QImage &). */
+    virtual QImage renderGfxScope(uint accelerationFactor, const SharedFrame &);
+    /** @brief Scope renderer for the counts computed once per frame, on the GPU by the monitor
+        or by the ScopeManager's analysis pass. Only called for scopes that set a counts kind. */
+    virtual QImage renderGfxScope(uint accelerationFactor, const ScopeCounts &);
+
+    /** @brief Lets the scope paint from the ScopeCounts of @param kind instead of walking the frame. */
+    void setScopeCountsKind(ScopeCounts::Kind kind);
+    /** @brief Adds the GPU analysis switch to the menu, for scopes that can paint from ScopeCounts of @param kind */
+    void enableGpuAnalysis(ScopeCounts::Kind kind);
 
     virtual QImage renderScope(uint accelerationFactor);
 
@@ -44,19 +63,34 @@ protected:
 
 private:
     QImage m_scopeImage;
+    /** @brief Frame shared with the monitor, takes precedence over m_scopeImage when valid. */
+    SharedFrame m_scopeFrame;
+    ScopeCounts m_scopeCounts;
+    /** @brief Images receiving the RGB conversion of m_scopeFrame */
+    ImagePool m_rgbImages;
     QMutex m_mutex;
+    QAction *m_aGpuAnalysis;
+    int m_countsKind;
 
 public slots:
     /** @brief Must be called when the active monitor has shown a new frame.
       This slot must be connected in the implementing class, it is *not*
       done in this abstract class. */
     void slotRenderZoneUpdated(const QImage &);
+    /** @brief Same as slotRenderZoneUpdated(const QImage &), for a frame shared with the monitor.
+        @param counts the scope counts computed for this frame, if any */
+    void slotRenderZoneUpdated(const SharedFrame &, const ScopeCounts &counts = ScopeCounts());
 
 protected slots:
     virtual void slotAutoRefreshToggled(bool autoRefresh);
 
+private slots:
+    void slotGpuAnalysisToggled(bool enabled);
+
 signals:
     void signalFrameRequest(const QString &widgetName);
+    /** @brief GPU analysis was switched on or off, the monitor needs to know which counts to compute. */
+    void signalGpuAnalysisToggled();
 
 };
 
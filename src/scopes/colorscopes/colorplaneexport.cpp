@@ -10,6 +10,7 @@
 
 #include "colorplaneexport.h"
 #include <KMessageBox>
+#include <QtConcurrent>
 #include "klocalizedstring.h"
 //#define DEBUG_CTE
 #ifdef DEBUG_CTE
@@ -19,12 +20,11 @@
 const QString EXTENSION_PNG = QStringLiteral(".png");
 
 ColorPlaneExport::ColorPlaneExport(QWidget *parent) :
-    QDialog(parent)
+    QDialog(parent),
+    m_exportPending(false)
 {
     setupUi(this);
 
-    m_colorTools = new ColorTools();
-
     tResX->setText(QStringLiteral("800"));
     tResY->setText(QStringLiteral("800"));
 
@@ -46,6 +46,7 @@ ColorPlaneExport::ColorPlaneExport(QWidget *parent) :
     sliderScaling->setSliderPosition(50);
 
     connect(buttonBox, SIGNAL(accepted()), this, SLOT(slotExportPlane()));
+    connect(&m_exportWatcher, &QFutureWatcher<bool>::finished, this, &ColorPlaneExport::slotExportFinished);
     connect(tResX, SIGNAL(textChanged(QString)), this, SLOT(slotValidate()));
     connect(tResY, SIGNAL(textChanged(QString)), this, SLOT(slotValidate()));
     connect(kurlrequester, SIGNAL(textChanged(QString)), this, SLOT(slotValidate()));
@@ -61,7 +62,8 @@ ColorPlaneExport::ColorPlaneExport(QWidget *parent) :
 
 ColorPlaneExport::~ColorPlaneExport()
 {
-    delete m_colorTools;
+    // The worker only uses its copy of the request, but the file should be complete
+    m_exportWatcher.waitForFinished();
 }
 
 
@@ -166,37 +168,72 @@ void ColorPlaneExport::slotExportPlane()
             kurlrequester->setUrl(QUrl(kurlrequester->text() + ".png"));
         }
     }
+    ExportRequest request;
+    request.mode = cbColorspace->itemData(cbColorspace->currentIndex()).toInt();
+    request.size = QSize(QVariant(tResX->text()).toInt(), QVariant(tResY->text()).toInt());
+    request.color = sliderColor->value();
+    request.scalingValue = sliderScaling->value();
+    request.scaling = m_scaling;
+    request.variant = cbVariant->itemData(cbVariant->currentIndex()).toInt();
+    request.path = kurlrequester->text();
+    // Large planes take a while, they are rendered in the background
+    if (m_exportWatcher.isRunning()) {
+        m_pendingExport = request;
+        m_exportPending = true;
+    } else {
+        startExport(request);
+    }
+}
+
+void ColorPlaneExport::startExport(const ExportRequest &request)
+{
+    m_runningExport = request;
+    m_exportWatcher.setFuture(QtConcurrent::run(&ColorPlaneExport::exportPlane, request));
+}
+
+bool ColorPlaneExport::exportPlane(const ExportRequest &request)
+{
     QImage img;
     QColor col;
-    QSize size(QVariant(tResX->text()).toInt(), QVariant(tResY->text()).toInt());
-    switch (cbColorspace->itemData(cbColorspace->currentIndex()).toInt()) {
+    const QSize &size = request.size;
+    switch (request.mode) {
     case CPE_YUV:
-        img = m_colorTools->yuvColorWheel(size, sliderColor->value(), m_scaling, false, false);
+        img = ColorTools().yuvColorWheel(size, request.color, request.scaling, false, false);
         break;
     case CPE_YUV_Y:
-        img = m_colorTools->yuvVerticalPlane(size, sliderColor->value(), m_scaling);
+        img = ColorTools().yuvVerticalPlane(size, request.color, request.scaling);
         break;
     case CPE_YUV_MOD:
-        img = m_colorTools->yuvColorWheel(size, sliderColor->value(), m_scaling, true, false);
+        img = ColorTools().yuvColorWheel(size, request.color, request.scaling, true, false);
         break;
     case CPE_RGB_CURVE:
-        img = m_colorTools->rgbCurvePlane(size, (ColorTools::ColorsRGB) (cbVariant->itemData(cbVariant->currentIndex()).toInt()),
-                                          (double)sliderScaling->value()/255);
+        img = ColorTools::rgbCurvePlane(size, (ColorTools::ColorsRGB) request.variant, (double)request.scalingValue/255);
         break;
     case CPE_YPbPr:
-        img = m_colorTools->yPbPrColorWheel(size, sliderColor->value(), m_scaling, false);
+        img = ColorTools().yPbPrColorWheel(size, request.color, request.scaling, false);
         break;
     case CPE_HSV_HUESHIFT:
-        img = m_colorTools->hsvHueShiftPlane(size, sliderColor->value(), sliderScaling->value(), -180, 180);
+        img = ColorTools::hsvHueShiftPlane(size, request.color, request.scalingValue, -180, 180);
         break;
     case CPE_HSV_SATURATION:
-        col.setHsv(0, 0, sliderColor->value());
-        img = m_colorTools->hsvCurvePlane(size, col, ColorTools::COM_H, ColorTools::COM_S);
+        col.setHsv(0, 0, request.color);
+        img = ColorTools::hsvCurvePlane(size, col, ColorTools::COM_H, ColorTools::COM_S);
         break;
     default:
         Q_ASSERT(false);
     }
-    img.save(kurlrequester->text());
+    return img.save(request.path);
+}
+
+void ColorPlaneExport::slotExportFinished()
+{
+    if (!m_exportWatcher.result()) {
+        KMessageBox::sorry(parentWidget(), i18n("Cannot write to file %1", m_runningExport.path));
+    }
+    if (m_exportPending) {
+        m_exportPending = false;
+        startExport(m_pendingExport);
+    }
 }
 
 void ColorPlaneExport::slotColormodeChanged()
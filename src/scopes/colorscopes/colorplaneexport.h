@@ -17,6 +17,7 @@
 #define COLORPLANEEXPORT_H
 
 #include <QDialog>
+#include <QFutureWatcher>
 #include "ui_colorplaneexport_ui.h"
 #include "colortools.h"
 
@@ -30,9 +31,29 @@ public:
 
     enum COLOR_EXPORT_MODE { CPE_YUV, CPE_YUV_Y, CPE_YUV_MOD, CPE_RGB_CURVE, CPE_YPbPr, CPE_HSV_HUESHIFT, CPE_HSV_SATURATION };
 
+    /** @brief Parameters of an export, read from the dialog in the GUI thread */
+    struct ExportRequest {
+        int mode;
+        QSize size;
+        int color;
+        int scalingValue;
+        float scaling;
+        int variant;
+        QString path;
+    };
+
 private:
-    ColorTools *m_colorTools;
     float m_scaling;
+    /** Renders and saves the plane in a worker thread, the dialog can be closed meanwhile */
+    QFutureWatcher<bool> m_exportWatcher;
+    ExportRequest m_pendingExport;
+    /** An export was requested while another one was running, only the newest one is kept */
+    bool m_exportPending;
+    ExportRequest m_runningExport;
+
+    /** @brief Renders the plane of @param request and saves it, runs in a worker thread. */
+    static bool exportPlane(const ExportRequest &request);
+    void startExport(const ExportRequest &request);
     void enableSliderScaling(bool enable);
     void enableSliderColor(bool enable);
     void enableCbVariant(bool enable);
@@ -42,6 +63,7 @@ private slots:
     void slotExportPlane();
     void slotColormodeChanged();
     void slotUpdateDisplays();
+    void slotExportFinished();
 };
 
 #endif // COLORPLANEEXPORT_H
@@ -49,6 +49,8 @@ Histogram::Histogram(QWidget *parent) :
     connect(m_aRec601, &QAction::toggled, this, &Histogram::forceUpdateScope);
     connect(m_aRec709, &QAction::toggled, this, &Histogram::forceUpdateScope);
 
+    enableGpuAnalysis(ScopeCounts::Histogram);
+
     init();
     m_histogramGenerator = new HistogramGenerator();
 }
@@ -113,7 +115,8 @@ QImage Histogram::renderHUD(uint)
     emit signalHUDRenderingFinished(0, 1);
     return QImage();
 }
-QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+template <class Frame>
+QImage Histogram::renderHistogram(uint accelFactor, const Frame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
@@ -125,12 +128,28 @@ QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
 
     HistogramGenerator::Rec rec = m_aRec601->isChecked() ? HistogramGenerator::Rec_601 : HistogramGenerator::Rec_709;
 
-    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), qimage, componentFlags,
+    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), frame, componentFlags,
                                                                 rec, m_aUnscaled->isChecked(), accelFactor);
 
     emit signalScopeRenderingFinished(start.elapsed(), accelFactor);
     return histogram;
 }
+
+QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+{
+    return renderHistogram(accelFactor, qimage);
+}
+
+QImage Histogram::renderGfxScope(uint accelFactor, const SharedFrame &frame)
+{
+    return renderHistogram(accelFactor, frame);
+}
+
+QImage Histogram::renderGfxScope(uint accelFactor, const ScopeCounts &counts)
+{
+    return renderHistogram(accelFactor, counts);
+}
+
 QImage Histogram::renderBackground(uint)
 {
     emit signalBackgroundRenderingFinished(0, 1);
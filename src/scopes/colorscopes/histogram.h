@@ -44,6 +44,10 @@ private:
     bool isBackgroundDependingOnInput() const;
     QImage renderHUD(uint accelerationFactor);
     QImage renderGfxScope(uint accelerationFactor, const QImage &);
+    QImage renderGfxScope(uint accelerationFactor, const SharedFrame &);
+    QImage renderGfxScope(uint accelerationFactor, const ScopeCounts &);
+    /** @brief Renders the scope from either an image or a frame shared with the monitor. */
+    template <class Frame> QImage renderHistogram(uint accelerationFactor, const Frame &frame);
     QImage renderBackground(uint accelerationFactor);
     Ui::Histogram_UI *ui;
 
@@ -9,13 +9,156 @@
  ***************************************************************************/
 
 #include "histogramgenerator.h"
+#include "yuvplanes.h"
+#include "scopecounts.h"
+#include "scopekernels.h"
 
 #include <algorithm>
 #include <math.h>
 #include <QImage>
 #include <QPainter>
+#include <QVector>
 #include "klocalizedstring.h"
 
+// Fractional bits of the luma lookup tables
+#define LUMA_SHIFT 16
+
+/** @brief Luma contribution of each R, G and B value with LUMA_SHIFT fractional bits, (r[R] + g[G] + b[B]) >> LUMA_SHIFT is the luma. */
+struct LumaTable {
+    int r[256];
+    int g[256];
+    int b[256];
+    LumaTable(double wr, double wg, double wb)
+    {
+        // The small bias keeps white at 255 despite the rounding of the weights
+        for (int i = 0; i < 256; ++i) {
+            r[i] = qRound(wr * i * (1 << LUMA_SHIFT)) + (1 << (LUMA_SHIFT - 8));
+            g[i] = qRound(wg * i * (1 << LUMA_SHIFT));
+            b[i] = qRound(wb * i * (1 << LUMA_SHIFT));
+        }
+    }
+};
+
+static const LumaTable &lumaTable(HistogramGenerator::Rec rec)
+{
+    static const LumaTable rec601(.299, .587, .114);
+    static const LumaTable rec709(.2125, .7154, .0721);
+    return rec == HistogramGenerator::Rec_601 ? rec601 : rec709;
+}
+
+/** @brief Rows of a frame accumulated by one thread, either from an RGB image or from the YUV planes. */
+struct HistogramStripe {
+    const QImage *image;
+    const YuvPlanes *planes;
+    int first;
+    int last;
+    int step;
+    int accelFactor;
+    bool drawY;
+    bool needRgb;
+    const LumaTable *luma;
+    const int *lumaLevel;
+};
+
+/** @brief Y, R, G and B counts. The sum is only derived from R, G and B before drawing, see finishSum(). */
+struct HistogramBins {
+    int r[256];
+    int g[256];
+    int b[256];
+    int y[256];
+    int s[766];
+    HistogramBins()
+    {
+        // Initialize the values to zero
+        std::fill(r, r+256, 0);
+        std::fill(g, g+256, 0);
+        std::fill(b, b+256, 0);
+        std::fill(y, y+256, 0);
+        std::fill(s, s+766, 0);
+    }
+    void add(const HistogramBins &other)
+    {
+        for (int i = 0; i < 256; ++i) {
+            r[i] += other.r[i];
+            g[i] += other.g[i];
+            b[i] += other.b[i];
+            y[i] += other.y[i];
+        }
+    }
+    void finishSum()
+    {
+        for (int i = 0; i < 256; ++i) {
+            s[i] = r[i] + g[i] + b[i];
+        }
+    }
+};
+
+/** @brief Counts one pixel in all selected components. */
+static inline void addPixel(HistogramBins &bins, QRgb col, const LumaTable *luma)
+{
+    const int red = qRed(col);
+    const int green = qGreen(col);
+    const int blue = qBlue(col);
+    bins.r[red]++;
+    bins.g[green]++;
+    bins.b[blue]++;
+    if (luma) {
+        bins.y[qMin(255, (luma->r[red] + luma->g[green] + luma->b[blue]) >> LUMA_SHIFT)]++;
+    }
+}
+
+static HistogramBins accumulateImageStripe(const HistogramStripe &stripe)
+{
+    // Consecutive pixels often have the same values, counting them in two sets of bins
+    // avoids waiting for the previous increment of the same counter.
+    HistogramBins bins;
+    HistogramBins odd;
+    const int width = stripe.image->width();
+    const int step = stripe.accelFactor;
+    for (int Y = stripe.first; Y < stripe.last; Y += stripe.step) {
+        const QRgb *line = (const QRgb *) stripe.image->constScanLine(Y);
+        int X = 0;
+        for (; X + step < width; X += 2 * step) {
+            addPixel(bins, line[X], stripe.luma);
+            addPixel(odd, line[X + step], stripe.luma);
+        }
+        if (X < width) {
+            addPixel(bins, line[X], stripe.luma);
+        }
+    }
+    bins.add(odd);
+    return bins;
+}
+
+static HistogramBins accumulatePlaneStripe(const HistogramStripe &stripe)
+{
+    HistogramBins bins;
+    const YuvPlanes &planes = *stripe.planes;
+    const int width = planes.chromaWidth() * 2;
+    for (int Y = stripe.first; Y < stripe.last; Y += stripe.step) {
+        const uint8_t *luma = planes.lumaLine(Y);
+        const uint8_t *cb = planes.cbLine(Y);
+        const uint8_t *cr = planes.crLine(Y);
+        for (int X = 0; X < width; X += stripe.accelFactor) {
+            if (stripe.drawY) {
+                bins.y[stripe.lumaLevel[luma[X]]]++;
+            }
+            if (stripe.needRgb) {
+                QRgb col = planes.rgb(luma[X], cb[X / 2], cr[X / 2]);
+                bins.r[qRed(col)]++;
+                bins.g[qGreen(col)]++;
+                bins.b[qBlue(col)]++;
+            }
+        }
+    }
+    return bins;
+}
+
+static void mergeBins(HistogramBins &bins, const HistogramBins &stripe)
+{
+    bins.add(stripe);
+}
+
 HistogramGenerator::HistogramGenerator()
 {
 }
@@ -28,48 +171,78 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     }
 
     bool drawY = (components & HistogramGenerator::ComponentY) != 0;
-    bool drawR = (components & HistogramGenerator::ComponentR) != 0;
-    bool drawG = (components & HistogramGenerator::ComponentG) != 0;
-    bool drawB = (components & HistogramGenerator::ComponentB) != 0;
-    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
-
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r+256, 0);
-    std::fill(g, g+256, 0);
-    std::fill(b, b+256, 0);
-    std::fill(y, y+256, 0);
-    std::fill(s, s+766, 0);
 
     const uint iw = image.bytesPerLine();
     const uint ih = image.height();
-    const uint ww = paradeSize.width();
-    const uint wh = paradeSize.height();
     const uint byteCount = iw*ih;
 
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == HistogramGenerator::Rec_601) {
-                    y[(int)floor(.299*qRed(col) + .587*qGreen(col) + .114*qBlue(col))]++;
-                } else {
-                    y[(int)floor(.2125*qRed(col) + .7154*qGreen(col) + .0721*qBlue(col))]++;
-                }
-            }
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
-            }
-        }
+    // Read the stats from the input image, the stripes read 32 bit pixels
+    const QImage source = image.depth() == 32 ? image : image.convertToFormat(QImage::Format_RGB32);
+    const HistogramStripe prototype = { &source, NULL, 0, 0, 1, (int) accelFactor, drawY, true, drawY ? &lumaTable(rec) : NULL, NULL };
+    HistogramBins bins = ScopeKernels::accumulateStripes(prototype, source.height(), 1, accumulateImageStripe, mergeBins);
+    bins.finishSum();
+
+    return drawHistogram(paradeSize, components, bins.y, bins.s, bins.r, bins.g, bins.b, byteCount, unscaled);
+}
+
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const SharedFrame &frame, const int &components,
+                                              HistogramGenerator::Rec, bool unscaled, uint accelFactor) const
+{
+    const YuvPlanes planes(frame);
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || !planes.isValid()) {
+        return QImage();
+    }
+
+    bool drawY = (components & HistogramGenerator::ComponentY) != 0;
+    // RGB values are only computed if a colour component is shown
+    bool needRgb = (components & (HistogramGenerator::ComponentR | HistogramGenerator::ComponentG
+                                  | HistogramGenerator::ComponentB | HistogramGenerator::ComponentSum)) != 0;
+
+    // Luma is read from the Y plane, which already uses the source colour matrix
+    int lumaLevel[256];
+    for (int i = 0; i < 256; ++i) {
+        lumaLevel[i] = YuvPlanes::fullRangeLuma(i);
     }
+    const HistogramStripe prototype = { NULL, &planes, 0, 0, 1, (int) accelFactor, drawY, needRgb, NULL, lumaLevel };
+    HistogramBins bins = ScopeKernels::accumulateStripes(prototype, planes.height, 1, accumulatePlaneStripe, mergeBins);
+    bins.finishSum();
+
+    // Same scaling as for a 32 bit image of the frame size
+    return drawHistogram(paradeSize, components, bins.y, bins.s, bins.r, bins.g, bins.b, 4 * planes.width * planes.height, unscaled);
+}
+
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const ScopeCounts &counts, const int &components,
+                                              HistogramGenerator::Rec, bool unscaled, uint) const
+{
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || !counts.contains(ScopeCounts::Histogram)) {
+        return QImage();
+    }
+
+    // The counts hold one row of SCOPE_LEVELS bins for Y, R, G and B
+    int r[256], g[256], b[256], y[256], s[766];
+    std::fill(s, s+766, 0);
+    const uint *source = counts.histogram.constData();
+    for (int i = 0; i < 256; ++i) {
+        y[i] = source[i];
+        r[i] = source[SCOPE_LEVELS + i];
+        g[i] = source[2 * SCOPE_LEVELS + i];
+        b[i] = source[3 * SCOPE_LEVELS + i];
+        s[i] = r[i] + g[i] + b[i];
+    }
+
+    return drawHistogram(paradeSize, components, y, s, r, g, b, 4 * counts.pixelCount, unscaled);
+}
+
+QImage HistogramGenerator::drawHistogram(const QSize &paradeSize, const int &components, const int *y, const int *s,
+                                         const int *r, const int *g, const int *b, uint byteCount, bool unscaled) const
+{
+    bool drawY = (components & HistogramGenerator::ComponentY) != 0;
+    bool drawR = (components & HistogramGenerator::ComponentR) != 0;
+    bool drawG = (components & HistogramGenerator::ComponentG) != 0;
+    bool drawB = (components & HistogramGenerator::ComponentB) != 0;
+    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
+    const uint ww = paradeSize.width();
+    const uint wh = paradeSize.height();
 
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
@@ -131,16 +304,23 @@ QImage HistogramGenerator::drawComponent(const int *y, const QSize &size, const
 
     const int partH = size.height();
 
+    // First row of the bar at each position, with an inverted y axis
+    QVector<int> top(max);
     for (uint x = 0; x < max; ++x) {
         // Calculate the height of the curve at position x
         int partY = scaling*y[x];
-
-        // Invert the y axis
         if (partY > partH-1) { partY = partH-1; }
-        partY = partH-1 - partY;
+        top[x] = partH-1 - partY;
+    }
 
-        for (int k = partH-1; k >= partY; --k) {
-            component.setPixel(x, k, color.rgba());
+    // Write the bars scanline by scanline
+    const QRgb barColor = color.rgba();
+    for (int k = 0; k < partH; ++k) {
+        QRgb *line = (QRgb *) component.scanLine(k);
+        for (uint x = 0; x < max; ++x) {
+            if (k >= top.at(x)) {
+                line[x] = barColor;
+            }
         }
     }
     if (unscaled && size.width() >= component.width()) {
@@ -18,6 +18,8 @@ class QImage;
 class QPainter;
 class QRect;
 class QSize;
+class ScopeCounts;
+class SharedFrame;
 
 class HistogramGenerator : public QObject
 {
@@ -35,6 +37,13 @@ public:
         unscaled = true leaves the width at 256 if the widget is wider (to avoid scaling). */
     QImage calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, const HistogramGenerator::Rec rec,
                               bool unscaled, uint accelFactor = 1) const;
+    /** Calculates the histogram from the planes of a YUV 4:2:0 monitor frame, without converting it to an image.
+        The luma plane already carries the source colour matrix, so rec is ignored. */
+    QImage calculateHistogram(const QSize &paradeSize, const SharedFrame &frame, const int &components, const HistogramGenerator::Rec rec,
+                              bool unscaled, uint accelFactor = 1) const;
+    /** Paints the histogram from the counts computed by the monitor on the GPU. */
+    QImage calculateHistogram(const QSize &paradeSize, const ScopeCounts &counts, const int &components, const HistogramGenerator::Rec rec,
+                              bool unscaled, uint accelFactor = 1) const;
 
     QImage drawComponent(const int *y, const QSize &size, const float &scaling, const QColor &color, bool unscaled, uint max) const;
 
@@ -43,6 +52,11 @@ public:
 
     enum Components { ComponentY = 1<<0, ComponentR = 1<<1, ComponentG = 1<<2, ComponentB = 1<<3, ComponentSum = 1<<4 };
 
+private:
+    /** Paints the components counted over byteCount bytes of image data. */
+    QImage drawHistogram(const QSize &paradeSize, const int &components, const int *y, const int *s,
+                         const int *r, const int *g, const int *b, uint byteCount, bool unscaled) const;
+
 };
 
 #endif // HISTOGRAMGENERATOR_H
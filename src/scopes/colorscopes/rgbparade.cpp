@@ -42,6 +42,8 @@ RGBParade::RGBParade(QWidget *parent) :
     connect(ui->paintMode, SIGNAL(currentIndexChanged(int)), this, SLOT(forceUpdateScope()));
     connect(this, &RGBParade::signalMousePositionChanged, this, &RGBParade::forceUpdateHUD);
 
+    enableGpuAnalysis(ScopeCounts::Parade);
+
     m_rgbParadeGenerator = new RGBParadeGenerator();
     init();
 }
@@ -124,18 +126,34 @@ QImage RGBParade::renderHUD(uint)
     return hud;
 }
 
-QImage RGBParade::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+template <class Frame>
+QImage RGBParade::renderParade(uint accelerationFactor, const Frame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
 
     int paintmode = ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
-    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), qimage, (RGBParadeGenerator::PaintMode) paintmode,
+    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), frame, (RGBParadeGenerator::PaintMode) paintmode,
                                                     m_aAxis->isChecked(), m_aGradRef->isChecked(), accelerationFactor);
     emit signalScopeRenderingFinished(start.elapsed(), accelerationFactor);
     return parade;
 }
 
+QImage RGBParade::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+{
+    return renderParade(accelerationFactor, qimage);
+}
+
+QImage RGBParade::renderGfxScope(uint accelerationFactor, const SharedFrame &frame)
+{
+    return renderParade(accelerationFactor, frame);
+}
+
+QImage RGBParade::renderGfxScope(uint accelerationFactor, const ScopeCounts &counts)
+{
+    return renderParade(accelerationFactor, counts);
+}
+
 QImage RGBParade::renderBackground(uint)
 {
     return QImage();
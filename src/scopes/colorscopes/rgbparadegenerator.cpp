@@ -9,9 +9,13 @@
  ***************************************************************************/
 
 #include "rgbparadegenerator.h"
+#include "yuvplanes.h"
+#include "scopecounts.h"
+#include "scopekernels.h"
 #include "klocalizedstring.h"
 #include <QColor>
 #include <QPainter>
+#include <QVector>
 
 #define CHOP255(a) ((255) < (a) ? (255) : (a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -28,8 +32,167 @@ struct StructRGB {
     uint r;
     uint g;
     uint b;
+    StructRGB() : r(0), g(0), b(0) {}
 };
 
+/** @brief Paints the parade from the accumulated values, partW columns of 256 levels. */
+static QImage paintParade(const QSize &paradeSize, const StructRGB *paradeVals, const uchar *minRGB, const uchar *maxRGB, float gain,
+                          const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef)
+{
+    QImage parade(paradeSize, QImage::Format_ARGB32);
+    parade.fill(Qt::transparent);
+
+    QPainter davinci(&parade);
+
+    const uint ww = paradeSize.width();
+    const uint wh = paradeSize.height();
+    const uchar offset = 10;
+    const uint partW = (ww - 2*offset - RGBParadeGenerator::distRight) / 3;
+    const uint partH = wh - RGBParadeGenerator::distBottom;
+
+    QImage unscaled(ww-RGBParadeGenerator::distRight, 256, QImage::Format_ARGB32);
+    unscaled.fill(qRgba(0, 0, 0, 0));
+
+    const uint offset1 = partW + offset;
+    const uint offset2 = 2*partW + 2*offset;
+    switch(paintMode) {
+    case RGBParadeGenerator::PaintMode_RGB:
+        for (uint i = 0; i < partW; ++i) {
+            for (uint j = 0; j < 256; ++j) {
+                const StructRGB &val = paradeVals[i * 256 + j];
+                unscaled.setPixel(i,         j, qRgba(255,10,10, CHOP255(gain*val.r)));
+                unscaled.setPixel(i+offset1, j, qRgba(10,255,10, CHOP255(gain*val.g)));
+                unscaled.setPixel(i+offset2, j, qRgba(10,10,255, CHOP255(gain*val.b)));
+            }
+        }
+        break;
+    default:
+        for (uint i = 0; i < partW; ++i) {
+            for (uint j = 0; j < 256; ++j) {
+                const StructRGB &val = paradeVals[i * 256 + j];
+                unscaled.setPixel(i,         j, qRgba(255,255,255, CHOP255(gain*val.r)));
+                unscaled.setPixel(i+offset1, j, qRgba(255,255,255, CHOP255(gain*val.g)));
+                unscaled.setPixel(i+offset2, j, qRgba(255,255,255, CHOP255(gain*val.b)));
+            }
+        }
+        break;
+    }
+
+    // Scale the image to the target height. Scaling is not accomplished before because
+    // there are only 255 different values which would lead to gaps if the height is not exactly 255.
+    // Don't use bilinear transformation because the fast transformation meets the goal better.
+    davinci.drawImage(0, 0, unscaled.mirrored(false, true).scaled(unscaled.width(), partH, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+
+    if (drawAxis) {
+        QRgb opx;
+        for (uint i = 0; i <= 10; ++i) {
+            double dy = (float)i/10 * (partH-1);
+            for (uint x = 0; x < ww-RGBParadeGenerator::distRight; ++x) {
+                opx = parade.pixel(x, dy);
+                parade.setPixel(x,dy, qRgba(CHOP255(150+qRed(opx)), 255,
+                                          CHOP255(200+qBlue(opx)), CHOP255(32+qAlpha(opx))));
+            }
+        }
+    }
+
+    if (drawGradientRef) {
+        davinci.setPen(RGBParadeGenerator::colLight);
+        davinci.drawLine(0                 ,partH,   partW,           0);
+        davinci.drawLine(  partW +   offset,partH, 2*partW +   offset,0);
+        davinci.drawLine(2*partW + 2*offset,partH, 3*partW + 2*offset,0);
+    }
+
+
+    const int d = 50;
+
+    // Show numerical minimum
+    for (int c = 0; c < 3; ++c) {
+        davinci.setPen(minRGB[c] == 0 ? RGBParadeGenerator::colHighlight : RGBParadeGenerator::colSoft);
+        davinci.drawText(c*(partW + offset),    wh, i18n("min: "));
+    }
+
+    // Show numerical maximum
+    for (int c = 0; c < 3; ++c) {
+        davinci.setPen(maxRGB[c] == 255 ? RGBParadeGenerator::colHighlight : RGBParadeGenerator::colSoft);
+        davinci.drawText(c*(partW + offset),    wh-20, i18n("max: "));
+    }
+
+    davinci.setPen(RGBParadeGenerator::colLight);
+    for (int c = 0; c < 3; ++c) {
+        davinci.drawText(c*(partW + offset) + d,   wh, QString::number(minRGB[c], 'f', 0));
+        davinci.drawText(c*(partW + offset) + d,   wh-20, QString::number(maxRGB[c], 'f', 0));
+    }
+
+    return parade;
+}
+
+/** @brief Adds one pixel to a parade column and updates the statistics. */
+static inline void addPixel(StructRGB *column, uchar r, uchar g, uchar b, uchar *minRGB, uchar *maxRGB)
+{
+    column[r].r++;
+    column[g].g++;
+    column[b].b++;
+
+    if (r < minRGB[0]) { minRGB[0] = r; }
+    if (g < minRGB[1]) { minRGB[1] = g; }
+    if (b < minRGB[2]) { minRGB[2] = b; }
+    if (r > maxRGB[0]) { maxRGB[0] = r; }
+    if (g > maxRGB[1]) { maxRGB[1] = g; }
+    if (b > maxRGB[2]) { maxRGB[2] = b; }
+}
+
+/** @brief Rows of an RGB image accumulated by one thread. */
+struct ParadeStripe {
+    const QImage *image;
+    int first;
+    int last;
+    int step;
+    const int *column;
+    int partW;
+};
+
+/** @brief Parade columns and statistics of a stripe. */
+struct ParadeBins {
+    QVector<StructRGB> vals;
+    uchar minRGB[3];
+    uchar maxRGB[3];
+};
+
+static ParadeBins accumulateStripe(const ParadeStripe &stripe)
+{
+    ParadeBins bins;
+    bins.vals = QVector<StructRGB>(stripe.partW * 256);
+    for (int c = 0; c < 3; ++c) {
+        bins.minRGB[c] = 255;
+        bins.maxRGB[c] = 0;
+    }
+    StructRGB *vals = bins.vals.data();
+    const int width = stripe.image->width();
+    for (int y = stripe.first; y < stripe.last; y += stripe.step) {
+        const QRgb *line = (const QRgb *) stripe.image->constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const QRgb col = line[x];
+            addPixel(vals + stripe.column[x], qRed(col), qGreen(col), qBlue(col), bins.minRGB, bins.maxRGB);
+        }
+    }
+    return bins;
+}
+
+static void mergeBins(ParadeBins &bins, const ParadeBins &stripe)
+{
+    StructRGB *vals = bins.vals.data();
+    const StructRGB *stripeVals = stripe.vals.constData();
+    for (int j = 0; j < bins.vals.count(); ++j) {
+        vals[j].r += stripeVals[j].r;
+        vals[j].g += stripeVals[j].g;
+        vals[j].b += stripeVals[j].b;
+    }
+    for (int c = 0; c < 3; ++c) {
+        bins.minRGB[c] = qMin(bins.minRGB[c], stripe.minRGB[c]);
+        bins.maxRGB[c] = qMax(bins.maxRGB[c], stripe.maxRGB[c]);
+    }
+}
+
 RGBParadeGenerator::RGBParadeGenerator()
 {
 }
@@ -44,152 +207,137 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
         return QImage();
 
     } else {
-        QImage parade(paradeSize, QImage::Format_ARGB32);
-        parade.fill(Qt::transparent);
-
-        QPainter davinci(&parade);
+        // The stripes read 32 bit pixels
+        const QImage source = image.depth() == 32 ? image : image.convertToFormat(QImage::Format_RGB32);
 
         const uint ww = paradeSize.width();
-        const uint wh = paradeSize.height();
-        const uint iw = image.bytesPerLine();
-        const uint ih = image.height();
-        const uint byteCount = iw*ih;   // Note that 1 px = 4 B
+        const int width = source.width();
+        const int height = source.height();
 
         const uchar offset = 10;
         const uint partW = (ww - 2*offset - distRight) / 3;
-        const uint partH = wh - distBottom;
-
-        // Statistics
-        uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0, r, g, b;
-
 
         // Number of input pixels that will fall on one scope pixel.
         // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-        const float pixelDepth = (float)((byteCount>>2) / accelFactor)/(partW*255);
+        const float pixelDepth = (float)(width * height / accelFactor)/(partW*255);
         const float gain = 255/(8*pixelDepth);
 //        qDebug() << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
-        QImage unscaled(ww-distRight, 256, QImage::Format_ARGB32);
-        unscaled.fill(qRgba(0, 0, 0, 0));
-
-        const float wPrediv = (float)(partW-1)/(iw-1);
-
-        StructRGB paradeVals[partW][256];
-        for (uint i = 0; i < partW; ++i) {
-            for (uint j = 0; j < 256; ++j) {
-                paradeVals[i][j].r = 0;
-                paradeVals[i][j].g = 0;
-                paradeVals[i][j].b = 0;
-            }
+        // Precompute the parade column of each image column
+        QVector<int> column(width);
+        const float wPrediv = width > 1 ? (float)(partW-1)/(width-1) : 0;
+        for (int x = 0; x < width; ++x) {
+            column[x] = 256 * (int)(x * wPrediv);
         }
 
-        const uchar *bits = image.bits();
-        const uint stepsize = image.depth() / 8 *accelFactor;
-
-        for (uint i = 0, x = 0; i < byteCount; i += stepsize) {
-            QRgb *col = (QRgb *)bits;
-            r = qRed(*col);
-            g = qGreen(*col);
-            b = qBlue(*col);
+        // Every accelFactor-th row is sampled, stripes of rows are accumulated in parallel
+        const ParadeStripe prototype = { &source, 0, 0, (int) accelFactor, column.constData(), (int) partW };
+        ParadeBins bins = ScopeKernels::accumulateStripes(prototype, height, accelFactor, accumulateStripe, mergeBins);
+        StructRGB *vals = bins.vals.data();
 
-            double dx = x*wPrediv;
+        return paintParade(paradeSize, vals, bins.minRGB, bins.maxRGB, gain, paintMode, drawAxis, drawGradientRef);
+    }
+}
 
-            paradeVals[(int)dx][r].r++;
-            paradeVals[(int)dx][g].g++;
-            paradeVals[(int)dx][b].b++;
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const SharedFrame &frame,
+                                              const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
+                                              bool drawGradientRef, uint accelFactor)
+{
+    Q_ASSERT(accelFactor >= 1);
 
+    const YuvPlanes planes(frame);
+    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || !planes.isValid()) {
+        return QImage();
+    }
 
-            if (r < minR) { minR = r; }
-            if (g < minG) { minG = g; }
-            if (b < minB) { minB = b; }
-            if (r > maxR) { maxR = r; }
-            if (g > maxG) { maxG = g; }
-            if (b > maxB) { maxB = b; }
+    const uint ww = paradeSize.width();
+    const uchar offset = 10;
+    const uint partW = (ww - 2*offset - distRight) / 3;
+    const int width = planes.chromaWidth() * 2;
 
-            bits += stepsize;
-            x += stepsize;
-            x %= iw; // Modulo image width, to represent the current x position in the image
-        }
+    uchar minRGB[3] = { 255, 255, 255 };
+    uchar maxRGB[3] = { 0, 0, 0 };
 
+    const float pixelDepth = (float)(width * planes.height / accelFactor)/(partW*255);
+    const float gain = 255/(8*pixelDepth);
 
-        const uint offset1 = partW + offset;
-        const uint offset2 = 2*partW + 2*offset;
-        switch(paintMode) {
-        case PaintMode_RGB:
-            for (uint i = 0; i < partW; ++i) {
-                for (uint j = 0; j < 256; ++j) {
-                    unscaled.setPixel(i,         j, qRgba(255,10,10, CHOP255(gain*paradeVals[i][j].r)));
-                    unscaled.setPixel(i+offset1, j, qRgba(10,255,10, CHOP255(gain*paradeVals[i][j].g)));
-                    unscaled.setPixel(i+offset2, j, qRgba(10,10,255, CHOP255(gain*paradeVals[i][j].b)));
-                }
-            }
-            break;
-        default:
-            for (uint i = 0; i < partW; ++i) {
-                for (uint j = 0; j < 256; ++j) {
-                    unscaled.setPixel(i,         j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].r)));
-                    unscaled.setPixel(i+offset1, j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].g)));
-                    unscaled.setPixel(i+offset2, j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].b)));
-                }
-            }
-            break;
-        }
+    // Precompute the parade column of each image column
+    QVector<int> column(width);
+    const float wPrediv = (float)(partW-1)/(width-1);
+    for (int x = 0; x < width; ++x) {
+        column[x] = 256 * (int)(x * wPrediv);
+    }
 
-        // Scale the image to the target height. Scaling is not accomplished before because
-        // there are only 255 different values which would lead to gaps if the height is not exactly 255.
-        // Don't use bilinear transformation because the fast transformation meets the goal better.
-        davinci.drawImage(0, 0, unscaled.mirrored(false, true).scaled(unscaled.width(), partH, Qt::IgnoreAspectRatio, Qt::FastTransformation));
-
-        if (drawAxis) {
-            QRgb opx;
-            for (uint i = 0; i <= 10; ++i) {
-                double dy = (float)i/10 * (partH-1);
-                for (uint x = 0; x < ww-distRight; ++x) {
-                    opx = parade.pixel(x, dy);
-                    parade.setPixel(x,dy, qRgba(CHOP255(150+qRed(opx)), 255,
-                                              CHOP255(200+qBlue(opx)), CHOP255(32+qAlpha(opx))));
-                }
-            }
+    QVector<StructRGB> paradeVals(partW * 256);
+    StructRGB *vals = paradeVals.data();
+
+    // Samples are taken every accelFactor pixels in reading order, as in the RGB path
+    for (int y = 0, x = 0; y < planes.height; ) {
+        const uint8_t *luma = planes.lumaLine(y);
+        const uint8_t *cb = planes.cbLine(y);
+        const uint8_t *cr = planes.crLine(y);
+        for (; x < width; x += accelFactor) {
+            const QRgb col = planes.rgb(luma[x], cb[x / 2], cr[x / 2]);
+            addPixel(vals + column.at(x), qRed(col), qGreen(col), qBlue(col), minRGB, maxRGB);
         }
-        
-        if (drawGradientRef) {
-            davinci.setPen(colLight);
-            davinci.drawLine(0                 ,partH,   partW,           0);
-            davinci.drawLine(  partW +   offset,partH, 2*partW +   offset,0);
-            davinci.drawLine(2*partW + 2*offset,partH, 3*partW + 2*offset,0);
-        }
-
+        y += x / width;
+        x %= width;
+    }
 
-        const int d = 50;
+    return paintParade(paradeSize, vals, minRGB, maxRGB, gain, paintMode, drawAxis, drawGradientRef);
+}
 
-        // Show numerical minimum
-        if (minR == 0) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(0,                     wh, i18n("min: "));
-        if (minG == 0) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(partW + offset,        wh, i18n("min: "));
-        if (minB == 0) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(2*partW + 2*offset,    wh, i18n("min: "));
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const ScopeCounts &counts,
+                                              const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
+                                              bool drawGradientRef, uint)
+{
+    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || !counts.contains(ScopeCounts::Parade) || counts.columns < 2) {
+        return QImage();
+    }
 
-        // Show numerical maximum
-        if (maxR == 255) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(0,                     wh-20, i18n("max: "));
-        if (maxG == 255) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(partW + offset,        wh-20, i18n("max: "));
-        if (maxB == 255) { davinci.setPen(colHighlight); } else { davinci.setPen(colSoft); }
-        davinci.drawText(2*partW + 2*offset,    wh-20, i18n("max: "));
+    const uint ww = paradeSize.width();
+    const uchar offset = 10;
+    const uint partW = (ww - 2*offset - distRight) / 3;
+    const int columns = counts.columns;
 
-        davinci.setPen(colLight);
-        davinci.drawText(d,                        wh, QString::number(minR, 'f', 0));
-        davinci.drawText(partW + offset + d,       wh, QString::number(minG, 'f', 0));
-        davinci.drawText(2*partW + 2*offset + d,   wh, QString::number(minB, 'f', 0));
+    uchar minRGB[3] = { 255, 255, 255 };
+    uchar maxRGB[3] = { 0, 0, 0 };
 
-        davinci.drawText(d,                        wh-20, QString::number(maxR, 'f', 0));
-        davinci.drawText(partW + offset + d,       wh-20, QString::number(maxG, 'f', 0));
-        davinci.drawText(2*partW + 2*offset + d,   wh-20, QString::number(maxB, 'f', 0));
+    const float pixelDepth = (float)counts.pixelCount/(partW*255);
+    const float gain = 255/(8*pixelDepth);
 
+    QVector<int> column(columns);
+    const float wPrediv = (float)(partW-1)/(columns-1);
+    for (int x = 0; x < columns; ++x) {
+        column[x] = 256 * (int)(x * wPrediv);
+    }
 
-        return parade;
+    QVector<StructRGB> paradeVals(partW * 256);
+    StructRGB *vals = paradeVals.data();
+
+    // The counts hold the R, G and B blocks of SCOPE_LEVELS rows one after the other
+    const uint *source = counts.parade.constData();
+    const int channelSize = SCOPE_LEVELS * columns;
+    for (int level = 0; level < SCOPE_LEVELS; ++level) {
+        const uint *red = source + level * columns;
+        const uint *green = red + channelSize;
+        const uint *blue = green + channelSize;
+        for (int x = 0; x < columns; ++x) {
+            StructRGB &val = vals[column.at(x) + level];
+            val.r += red[x];
+            val.g += green[x];
+            val.b += blue[x];
+            const uint channel[3] = { red[x], green[x], blue[x] };
+            for (int c = 0; c < 3; ++c) {
+                if (channel[c] > 0) {
+                    minRGB[c] = qMin(minRGB[c], (uchar) level);
+                    maxRGB[c] = qMax(maxRGB[c], (uchar) level);
+                }
+            }
+        }
     }
+
+    return paintParade(paradeSize, vals, minRGB, maxRGB, gain, paintMode, drawAxis, drawGradientRef);
 }
 
 #undef CHOP255
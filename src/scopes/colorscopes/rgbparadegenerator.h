@@ -16,6 +16,8 @@
 class QColor;
 class QImage;
 class QSize;
+class ScopeCounts;
+class SharedFrame;
 class RGBParadeGenerator : public QObject
 {
     Q_OBJECT
@@ -25,6 +27,12 @@ public:
     RGBParadeGenerator();
     QImage calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode,
                               bool drawAxis, bool drawGradientRef, uint accelFactor = 1);
+    /** @brief Calculates the parade from the planes of a YUV 4:2:0 monitor frame, converting each sample on the fly. */
+    QImage calculateRGBParade(const QSize &paradeSize, const SharedFrame &frame, const RGBParadeGenerator::PaintMode paintMode,
+                              bool drawAxis, bool drawGradientRef, uint accelFactor = 1);
+    /** @brief Paints the parade from the colour counts computed by the monitor on the GPU. */
+    QImage calculateRGBParade(const QSize &paradeSize, const ScopeCounts &counts, const RGBParadeGenerator::PaintMode paintMode,
+                              bool drawAxis, bool drawGradientRef, uint accelFactor = 1);
 
     static const QColor colHighlight;
     static const QColor colLight;
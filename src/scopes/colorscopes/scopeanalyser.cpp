@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "scopeanalyser.h"
+#include "yuvplanes.h"
+#include "utils/tracer.h"
+
+ScopeCounts ScopeAnalyser::analyse(const SharedFrame &frame, const ScopeCounts &counts, int kinds)
+{
+    TRACE_ZONE("scopes", "ScopeAnalyser::analyse");
+    ScopeCounts result = counts;
+    const YuvPlanes planes(frame);
+    kinds &= ~counts.kinds();
+    if (kinds == 0 || !planes.isValid()) {
+        return result;
+    }
+
+    const int width = planes.chromaWidth() * 2;
+    const int height = planes.height;
+    const bool waveform = (kinds & ScopeCounts::Waveform) != 0;
+    const bool parade = (kinds & ScopeCounts::Parade) != 0;
+    const bool histogram = (kinds & ScopeCounts::Histogram) != 0;
+    const bool chroma = (kinds & ScopeCounts::Vectorscope) != 0;
+    const bool needRgb = parade || histogram;
+
+    if (result.columns == 0) {
+        result.columns = qMin(width, MAX_SCOPE_COLUMNS);
+        result.pixelCount = width * height;
+    }
+    const int columns = result.columns;
+    if (waveform) {
+        result.waveform = QVector<uint>(columns * SCOPE_LEVELS, 0);
+    }
+    if (parade) {
+        result.parade = QVector<uint>(3 * columns * SCOPE_LEVELS, 0);
+    }
+    if (histogram) {
+        result.histogram = QVector<uint>(4 * SCOPE_LEVELS, 0);
+    }
+    if (chroma) {
+        result.chroma = QVector<uint>(SCOPE_LEVELS * SCOPE_LEVELS, 0);
+    }
+    uint *waveBins = result.waveform.data();
+    uint *redBins = result.parade.data();
+    uint *greenBins = redBins + columns * SCOPE_LEVELS;
+    uint *blueBins = greenBins + columns * SCOPE_LEVELS;
+    uint *lumaHist = result.histogram.data();
+    uint *redHist = lumaHist + SCOPE_LEVELS;
+    uint *greenHist = redHist + SCOPE_LEVELS;
+    uint *blueHist = greenHist + SCOPE_LEVELS;
+    uint *chromaBins = result.chroma.data();
+
+    // Luma is read from the Y plane, studio range values are expanded as in the scope generators
+    int lumaLevel[256];
+    for (int i = 0; i < 256; ++i) {
+        lumaLevel[i] = YuvPlanes::fullRangeLuma(i);
+    }
+    QVector<int> column(width);
+    for (int x = 0; x < width; ++x) {
+        column[x] = x * columns / width;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *luma = planes.lumaLine(y);
+        const uint8_t *cb = planes.cbLine(y);
+        const uint8_t *cr = planes.crLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int level = lumaLevel[luma[x]];
+            const int c = column.at(x);
+            if (waveform) {
+                waveBins[level * columns + c]++;
+            }
+            if (needRgb) {
+                const QRgb rgb = planes.rgb(luma[x], cb[x / 2], cr[x / 2]);
+                if (parade) {
+                    redBins[qRed(rgb) * columns + c]++;
+                    greenBins[qGreen(rgb) * columns + c]++;
+                    blueBins[qBlue(rgb) * columns + c]++;
+                }
+                if (histogram) {
+                    lumaHist[level]++;
+                    redHist[qRed(rgb)]++;
+                    greenHist[qGreen(rgb)]++;
+                    blueHist[qBlue(rgb)]++;
+                }
+            }
+        }
+        // Each chroma sample covers 2x2 pixels, it is counted once on the even line
+        if (chroma && (y & 1) == 0) {
+            for (int x = 0; x < width / 2; ++x) {
+                chromaBins[cr[x] * SCOPE_LEVELS + cb[x]]++;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SCOPEANALYSER_H
+#define SCOPEANALYSER_H
+
+#include "scopecounts.h"
+
+class SharedFrame;
+
+/**
+ * @class ScopeAnalyser
+ * @brief Computes the counts of all the visible colour scopes in one pass over a frame.
+ *
+ * Each pixel of the YUV 4:2:0 frame is read once, its luma level and RGB values are
+ * computed once and added to every requested count. The scopes then only paint.
+ */
+class ScopeAnalyser
+{
+public:
+    /** @brief Returns @param counts completed with the ScopeCounts::Kind flags of @param kinds it does not hold yet.
+        Counts already computed by the monitor on the GPU are kept as they are.
+        If @param frame is not a YUV 4:2:0 frame, @param counts is returned unchanged. */
+    static ScopeCounts analyse(const SharedFrame &frame, const ScopeCounts &counts, int kinds);
+};
+
+#endif // SCOPEANALYSER_H
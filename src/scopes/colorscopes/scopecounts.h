@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SCOPECOUNTS_H
+#define SCOPECOUNTS_H
+
+#include <QMetaType>
+#include <QVector>
+
+/** Number of luma and colour levels counted per column. */
+#define SCOPE_LEVELS 256
+/** Maximum number of count columns of the waveform and parade. */
+#define MAX_SCOPE_COLUMNS 1024
+
+/**
+ * @class ScopeCounts
+ * @brief Sample counts of a frame, accumulated once for all the colour scopes.
+ *
+ * The counts are computed on the GPU by the monitor, or in a single pass over the frame
+ * by ScopeAnalyser for the kinds the GPU did not provide.
+ * The waveform and RGB parade counts hold one row of @ref columns bins per level,
+ * the parade stores the R, G and B blocks one after the other. The histogram holds
+ * SCOPE_LEVELS bins for Y, R, G and B. The chroma counts hold one row of SCOPE_LEVELS
+ * Cb bins per Cr level. Scopes fold these counts into their own size,
+ * so that they never walk the frame themselves. A Kind is empty if it was not requested.
+ */
+class ScopeCounts
+{
+public:
+    enum Kind { Waveform = 1 << 0, Parade = 1 << 1, Histogram = 1 << 2, Vectorscope = 1 << 3 };
+
+    ScopeCounts() :
+        columns(0)
+        , pixelCount(0)
+    {}
+
+    bool contains(Kind kind) const
+    {
+        switch (kind) {
+        case Waveform:
+            return !waveform.isEmpty();
+        case Parade:
+            return !parade.isEmpty();
+        case Histogram:
+            return !histogram.isEmpty();
+        default:
+            return !chroma.isEmpty();
+        }
+    }
+
+    /** @brief The Kind flags of all the counts that are filled. */
+    int kinds() const
+    {
+        return (contains(Waveform) ? Waveform : 0) | (contains(Parade) ? Parade : 0)
+               | (contains(Histogram) ? Histogram : 0) | (contains(Vectorscope) ? Vectorscope : 0);
+    }
+
+    /** @brief Number of count columns of the waveform and parade, each covers width / columns image columns. */
+    int columns;
+    /** @brief Number of frame pixels that were counted. */
+    int pixelCount;
+    QVector<uint> waveform;
+    QVector<uint> parade;
+    QVector<uint> histogram;
+    QVector<uint> chroma;
+};
+
+Q_DECLARE_METATYPE(ScopeCounts)
+
+#endif // SCOPECOUNTS_H
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "scopekernels.h"
+
+#include <QThread>
+#include <QtMath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Minimum number of sampled rows per stripe, smaller stripes cost more to merge than they save
+#define MIN_STRIPE_ROWS 32
+// Upper bound for the fractional bits of the fixed point weights
+#define MAX_WEIGHT_SHIFT 16
+
+void ScopeKernels::lumaLine(const QRgb *line, int width, const int *weights, uchar *luma)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i wr = _mm_set1_epi32(weights[0]);
+    const __m128i wg = _mm_set1_epi32(weights[1]);
+    const __m128i wb = _mm_set1_epi32(weights[2]);
+    int values[4];
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(line + x));
+        __m128i b = _mm_and_si128(px, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+        // Products fit in the low 16 bits of each 32 bit lane
+        __m128i y = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)), _mm_mullo_epi16(b, wb));
+        _mm_storeu_si128((__m128i *)values, _mm_srli_epi32(y, 8));
+        luma[x] = values[0];
+        luma[x + 1] = values[1];
+        luma[x + 2] = values[2];
+        luma[x + 3] = values[3];
+    }
+#elif defined(__ARM_NEON)
+    const uint8x8_t wr = vdup_n_u8(weights[0]);
+    const uint8x8_t wg = vdup_n_u8(weights[1]);
+    const uint8x8_t wb = vdup_n_u8(weights[2]);
+    for (; x + 8 <= width; x += 8) {
+        // QRgb is stored as B, G, R, A bytes on little endian
+        uint8x8x4_t px = vld4_u8((const uint8_t *)(line + x));
+        uint16x8_t y = vmull_u8(px.val[2], wr);
+        y = vmlal_u8(y, px.val[1], wg);
+        y = vmlal_u8(y, px.val[0], wb);
+        vst1_u8(luma + x, vshrn_n_u16(y, 8));
+    }
+#endif
+    for (; x < width; ++x) {
+        const QRgb col = line[x];
+        luma[x] = (weights[0] * qRed(col) + weights[1] * qGreen(col) + weights[2] * qBlue(col)) >> 8;
+    }
+}
+
+void ScopeKernels::weightedLine(const QRgb *line, int width, const int *weights, int offset, int shift, int *result)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    // Each 32 bit lane is split in the 16 bit pairs (B, R) and (G, A) which are multiplied and added with one madd
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i wbr = _mm_set_epi16(weights[0], weights[2], weights[0], weights[2], weights[0], weights[2], weights[0], weights[2]);
+    const __m128i wga = _mm_set_epi16(0, weights[1], 0, weights[1], 0, weights[1], 0, weights[1]);
+    const __m128i off = _mm_set1_epi32(offset);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(line + x));
+        __m128i br = _mm_and_si128(px, mask);
+        __m128i ga = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(br, wbr), _mm_madd_epi16(ga, wga)), off);
+        _mm_storeu_si128((__m128i *)(result + x), _mm_sra_epi32(sum, count));
+    }
+#elif defined(__ARM_NEON)
+    const int32x4_t off = vdupq_n_s32(offset);
+    const int32x4_t count = vdupq_n_s32(-shift);
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t *)(line + x));
+        int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(px.val[2]));
+        int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(px.val[1]));
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(px.val[0]));
+        int32x4_t low = vmlal_n_s16(off, vget_low_s16(r), weights[0]);
+        low = vmlal_n_s16(low, vget_low_s16(g), weights[1]);
+        low = vmlal_n_s16(low, vget_low_s16(b), weights[2]);
+        int32x4_t high = vmlal_n_s16(off, vget_high_s16(r), weights[0]);
+        high = vmlal_n_s16(high, vget_high_s16(g), weights[1]);
+        high = vmlal_n_s16(high, vget_high_s16(b), weights[2]);
+        // A negative count shifts right, arithmetically for signed lanes
+        vst1q_s32(result + x, vshlq_s32(low, count));
+        vst1q_s32(result + x + 4, vshlq_s32(high, count));
+    }
+#endif
+    for (; x < width; ++x) {
+        const QRgb col = line[x];
+        result[x] = (offset + weights[0] * qRed(col) + weights[1] * qGreen(col) + weights[2] * qBlue(col)) >> shift;
+    }
+}
+
+int ScopeKernels::fixedPointShift(const double *weights, int count)
+{
+    double largest = 0;
+    for (int i = 0; i < count; ++i) {
+        largest = qMax(largest, qAbs(weights[i]));
+    }
+    int shift = MAX_WEIGHT_SHIFT;
+    while (shift > 0 && largest * (1 << shift) > 32767) {
+        --shift;
+    }
+    return shift;
+}
+
+QVector<QPair<int, int> > ScopeKernels::rowStripes(int rows, int step)
+{
+    QVector<QPair<int, int> > stripes;
+    const int sampled = (rows + step - 1) / step;
+    const int count = qBound(1, sampled / MIN_STRIPE_ROWS, qMax(1, QThread::idealThreadCount()));
+    // Sampled rows per stripe, rounded up so that the last stripe is the only shorter one
+    const int perStripe = (sampled + count - 1) / count;
+    for (int first = 0; first < rows; first += perStripe * step) {
+        stripes << qMakePair(first, qMin(rows, first + perStripe * step));
+    }
+    return stripes;
+}
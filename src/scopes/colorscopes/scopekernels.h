@@ -0,0 +1,79 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SCOPEKERNELS_H
+#define SCOPEKERNELS_H
+
+#include <QList>
+#include <QPair>
+#include <QRgb>
+#include <QVector>
+#include <QtConcurrent>
+
+/** @brief Line kernels and row striping shared by the colour scope generators.
+    The line kernels use SSE2 or NEON when the compiler targets them, with a scalar fallback. */
+namespace ScopeKernels
+{
+/** @brief Computes the 8 bit luma of a line of 32 bit pixels (QRgb).
+    The R, G and B weights are scaled to 256. */
+void lumaLine(const QRgb *line, int width, const int *weights, uchar *luma);
+
+/** @brief Computes (offset + weights[0]*r + weights[1]*g + weights[2]*b) >> shift for a line of 32 bit pixels.
+    The weights must fit in 16 bits, use fixedPointShift() to scale them. */
+void weightedLine(const QRgb *line, int width, const int *weights, int offset, int shift, int *result);
+
+/** @brief Returns the number of fractional bits to use so that the largest of the @param count weights still fits in 16 bits. */
+int fixedPointShift(const double *weights, int count);
+
+/** @brief Splits the rows [0, rows) in stripes that can be accumulated in parallel.
+    Each stripe is a [first, last) pair, first is a multiple of @param step. */
+QVector<QPair<int, int> > rowStripes(int rows, int step);
+
+/** @brief Accumulates the rows [0, rows) of a frame in stripes on the global thread pool.
+    Each stripe is a copy of @param prototype with its first and last members set to the stripe rows.
+    @param accumulate fills the bins of one stripe, which then are merged in row order with @param merge
+    @return the merged bins */
+template <typename Stripe, typename Bins>
+Bins accumulateStripes(const Stripe &prototype, int rows, int step, Bins (*accumulate)(const Stripe &),
+                       void (*merge)(Bins &, const Bins &))
+{
+    const QVector<QPair<int, int> > ranges = rowStripes(rows, step);
+    QVector<Stripe> stripes;
+    for (int i = 0; i < ranges.count(); ++i) {
+        Stripe stripe = prototype;
+        stripe.first = ranges.at(i).first;
+        stripe.last = ranges.at(i).second;
+        stripes << stripe;
+    }
+    if (stripes.count() == 1) {
+        // Small frames are not worth a round trip through the thread pool
+        return accumulate(stripes.first());
+    }
+    QFuture<Bins> future = QtConcurrent::mapped(stripes, accumulate);
+    future.waitForFinished();
+    QList<Bins> results = future.results();
+    Bins bins = results.takeFirst();
+    foreach (const Bins &stripeBins, results) {
+        merge(bins, stripeBins);
+    }
+    return bins;
+}
+}
+
+#endif
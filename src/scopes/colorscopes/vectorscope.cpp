@@ -112,6 +112,7 @@ Vectorscope::Vectorscope(QWidget *parent) :
     // To make the 1.0x text show
     slotGainChanged(ui->sliderGain->value());
 
+    setScopeCountsKind(ScopeCounts::Vectorscope);
     init();
 }
 
@@ -257,7 +258,8 @@ QImage Vectorscope::renderHUD(uint)
     return hud;
 }
 
-QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+template <class Frame>
+QImage Vectorscope::renderVectorscope(uint accelerationFactor, const Frame &frame)
 {
     QTime start = QTime::currentTime();
     QImage scope;
@@ -270,7 +272,7 @@ QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage
                                                       VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
         VectorscopeGenerator::PaintMode paintMode = (VectorscopeGenerator::PaintMode) ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
         scope = m_vectorscopeGenerator->calculateVectorscope(m_scopeRect.size(),
-                                                             qimage,
+                                                             frame,
                                                              m_gain, paintMode, colorSpace,
                                                              m_aAxisEnabled->isChecked(), accelerationFactor);
 
@@ -281,6 +283,25 @@ QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage
     return scope;
 }
 
+QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+{
+    return renderVectorscope(accelerationFactor, qimage);
+}
+
+QImage Vectorscope::renderGfxScope(uint accelerationFactor, const SharedFrame &frame)
+{
+    return renderVectorscope(accelerationFactor, frame);
+}
+
+QImage Vectorscope::renderGfxScope(uint accelerationFactor, const ScopeCounts &counts)
+{
+    if (ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt() == VectorscopeGenerator::PaintMode_Original) {
+        // The pixel colours are not counted, read them from the frame
+        return AbstractGfxScopeWidget::renderGfxScope(accelerationFactor, counts);
+    }
+    return renderVectorscope(accelerationFactor, counts);
+}
+
 QImage Vectorscope::renderBackground(uint)
 {
     QTime start = QTime::currentTime();
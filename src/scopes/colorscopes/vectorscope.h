@@ -41,6 +41,10 @@ protected:
     QRect scopeRect();
     QImage renderHUD(uint accelerationFactor);
     QImage renderGfxScope(uint accelerationFactor, const QImage &);
+    QImage renderGfxScope(uint accelerationFactor, const SharedFrame &);
+    QImage renderGfxScope(uint accelerationFactor, const ScopeCounts &);
+    /** @brief Renders the scope from either an image or a frame shared with the monitor. */
+    template <class Frame> QImage renderVectorscope(uint accelerationFactor, const Frame &frame);
     QImage renderBackground(uint accelerationFactor);
     bool isHUDDependingOnInput() const;
     bool isScopeDependingOnInput() const;
@@ -70,6 +70,9 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "yuvplanes.h"
+#include "scopecounts.h"
+#include "scopekernels.h"
 #include <math.h>
 #include <QImage>
 
@@ -115,6 +118,184 @@ QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF
                    (targetSize.height()-1) * (1 - (point.y()+1)/2) );
 }
 
+/** @brief Scales of studio range Cb and Cr (16-240) to the U and V coordinates of @param colorSpace.
+    Studio range chroma gives Pb and Pr on [-0.5,0.5]; U and V are scaled from them. */
+static void chromaScales(const VectorscopeGenerator::ColorSpace &colorSpace, double &pbScale, double &prScale)
+{
+    switch (colorSpace) {
+    case VectorscopeGenerator::ColorSpace_YUV:
+        pbScale = 0.872021 / 224;
+        prScale = 1.229907 / 224;
+        break;
+    case VectorscopeGenerator::ColorSpace_YPbPr:
+    default:
+        pbScale = 1. / 224;
+        prScale = 1. / 224;
+        break;
+    }
+}
+
+/** @brief Draws the pixel of colour @param original at @param pt using the chosen draw mode. */
+static void plotPoint(QImage &scope, const QPoint &pt, double u, double v, QRgb original,
+                      const VectorscopeGenerator::PaintMode &paintMode,
+                      const VectorscopeGenerator::ColorSpace &colorSpace, double avgPxPerPx)
+{
+    double dy, dr, dg, db, dmax;
+    QRgb px;
+
+    // Draw the pixel using the chosen draw mode.
+    switch (paintMode) {
+    case VectorscopeGenerator::PaintMode_YUV:
+        // see yuvColorWheel
+        dy = 128; // Default Y value. Lower = darker.
+
+        // Calculate the RGB values from YUV/YPbPr
+        switch (colorSpace) {
+        case VectorscopeGenerator::ColorSpace_YUV:
+            dr = dy + 290.8*v;
+            dg = dy - 100.6*u - 148*v;
+            db = dy + 517.2*u;
+            break;
+        case VectorscopeGenerator::ColorSpace_YPbPr:
+        default:
+            dr = dy + 357.5*v;
+            dg = dy - 87.75*u - 182*v;
+            db = dy + 451.9*u;
+            break;
+        }
+
+
+        if (dr < 0) dr = 0;
+        if (dg < 0) dg = 0;
+        if (db < 0) db = 0;
+        if (dr > 255) dr = 255;
+        if (dg > 255) dg = 255;
+        if (db > 255) db = 255;
+
+        scope.setPixel(pt, qRgba(dr, dg, db, 255));
+        break;
+
+    case VectorscopeGenerator::PaintMode_Chroma:
+        dy = 200; // Default Y value. Lower = darker.
+
+        // Calculate the RGB values from YUV/YPbPr
+        switch (colorSpace) {
+        case VectorscopeGenerator::ColorSpace_YUV:
+            dr = dy + 290.8*v;
+            dg = dy - 100.6*u - 148*v;
+            db = dy + 517.2*u;
+            break;
+        case VectorscopeGenerator::ColorSpace_YPbPr:
+        default:
+            dr = dy + 357.5*v;
+            dg = dy - 87.75*u - 182*v;
+            db = dy + 451.9*u;
+            break;
+        }
+
+        // Scale the RGB values back to max 255
+        dmax = dr;
+        if (dg > dmax) dmax = dg;
+        if (db > dmax) dmax = db;
+        dmax = 255/dmax;
+
+        dr *= dmax;
+        dg *= dmax;
+        db *= dmax;
+
+        scope.setPixel(pt, qRgba(dr, dg, db, 255));
+        break;
+    case VectorscopeGenerator::PaintMode_Original:
+        scope.setPixel(pt, original);
+        break;
+    case VectorscopeGenerator::PaintMode_Green:
+        px = scope.pixel(pt);
+        scope.setPixel(pt, qRgba(qRed(px)+(255-qRed(px))/(3*avgPxPerPx), qGreen(px)+20*(255-qGreen(px))/(avgPxPerPx),
+                                 qBlue(px)+(255-qBlue(px))/(avgPxPerPx), qAlpha(px)+(255-qAlpha(px))/(avgPxPerPx)));
+        break;
+    case VectorscopeGenerator::PaintMode_Green2:
+        px = scope.pixel(pt);
+        scope.setPixel(pt, qRgba(qRed(px)+ceil((255-(float)qRed(px))/(4*avgPxPerPx)), 255,
+                                 qBlue(px)+ceil((255-(float)qBlue(px))/(avgPxPerPx)), qAlpha(px)+ceil((255-(float)qAlpha(px))/(avgPxPerPx))));
+        break;
+    case VectorscopeGenerator::PaintMode_Black:
+        px = scope.pixel(pt);
+        scope.setPixel(pt, qRgba(0,0,0, qAlpha(px)+(255-qAlpha(px))/20));
+        break;
+    }
+}
+
+/** @brief Rows of an RGB image accumulated by one thread, and the fixed point mapping of r, g, b to scope pixels. */
+struct VectorscopeStripe {
+    const QImage *image;
+    int first;
+    int last;
+    int step;
+    const int *xWeights;
+    const int *yWeights;
+    int xOffset;
+    int yOffset;
+    int shift;
+    int size;
+    bool keepColour;
+};
+
+/** @brief Scope pixel counts of a stripe, and the last colour per pixel for PaintMode_Original. */
+struct VectorscopeBins {
+    QVector<uint> counts;
+    QVector<QRgb> colours;
+};
+
+static VectorscopeBins accumulateStripe(const VectorscopeStripe &stripe)
+{
+    VectorscopeBins bins;
+    const int cw = stripe.size;
+    bins.counts = QVector<uint>(cw * cw, 0);
+    if (stripe.keepColour) {
+        bins.colours = QVector<QRgb>(cw * cw, 0);
+    }
+    uint *counts = bins.counts.data();
+    QRgb *colours = stripe.keepColour ? bins.colours.data() : NULL;
+    const int width = stripe.image->width();
+    QVector<int> xs(width);
+    QVector<int> ys(width);
+    for (int y = stripe.first; y < stripe.last; y += stripe.step) {
+        const QRgb *line = (const QRgb *) stripe.image->constScanLine(y);
+        ScopeKernels::weightedLine(line, width, stripe.xWeights, stripe.xOffset, stripe.shift, xs.data());
+        ScopeKernels::weightedLine(line, width, stripe.yWeights, stripe.yOffset, stripe.shift, ys.data());
+        for (int x = 0; x < width; ++x) {
+            // Points outside of the scope because of the gain are not plotted
+            const uint px = xs.at(x);
+            const uint py = ys.at(x);
+            if (px >= (uint) cw || py >= (uint) cw) {
+                continue;
+            }
+            counts[py * cw + px]++;
+            if (colours) {
+                colours[py * cw + px] = line[x];
+            }
+        }
+    }
+    return bins;
+}
+
+/** @brief Adds the bins of a later stripe, the last colour of a pixel wins as when plotting one by one. */
+static void mergeBins(VectorscopeBins &bins, const VectorscopeBins &stripe)
+{
+    uint *counts = bins.counts.data();
+    QRgb *colours = bins.colours.isEmpty() ? NULL : bins.colours.data();
+    const uint *stripeCounts = stripe.counts.constData();
+    const QRgb *stripeColours = stripe.colours.constData();
+    for (int j = 0; j < bins.counts.count(); ++j) {
+        if (stripeCounts[j] > 0) {
+            counts[j] += stripeCounts[j];
+            if (colours) {
+                colours[j] = stripeColours[j];
+            }
+        }
+    }
+}
+
 QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
                                                   const VectorscopeGenerator::PaintMode &paintMode,
                                                   const VectorscopeGenerator::ColorSpace &colorSpace,
@@ -130,134 +311,149 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
     scope.fill(qRgba(0,0,0,0));
 
-    const uchar *bits = image.bits();
-
-    double dy, dr, dg, db, dmax;
-    double /*y,*/ u, v;
-    QPoint pt;
-    QRgb px;
+    // The kernels read 32 bit pixels
+    const QImage source = image.depth() == 32 ? image : image.convertToFormat(QImage::Format_RGB32);
+
+    // Rows of RGB to U and V, see the matrices above
+    static const double yuvRows[2][3] = { { -0.0005781, -0.001135, 0.001713 }, { 0.002411, -0.002019, -0.0003921 } };
+    static const double ypbprRows[2][3] = { { -0.0006671, -0.001299, 0.0019608 }, { 0.001961, -0.001642, -0.0003189 } };
+    const double (*rows)[3] = colorSpace == ColorSpace_YUV ? yuvRows : ypbprRows;
+
+    // mapToCircle() folded into the conversion: x = halfW * (1 + SCALING*gain*u) and y = halfH * (1 - SCALING*gain*v)
+    const double halfW = (vectorscopeSize.width() - 1) / 2.;
+    const double halfH = (vectorscopeSize.height() - 1) / 2.;
+    double weights[6];
+    for (int i = 0; i < 3; ++i) {
+        weights[i] = halfW * SCALING * gain * rows[0][i];
+        weights[i + 3] = -halfH * SCALING * gain * rows[1][i];
+    }
+    const int shift = ScopeKernels::fixedPointShift(weights, 6);
+    int xWeights[3];
+    int yWeights[3];
+    for (int i = 0; i < 3; ++i) {
+        xWeights[i] = qRound(weights[i] * (1 << shift));
+        yWeights[i] = qRound(weights[i + 3] * (1 << shift));
+    }
 
-    const int stepsize = image.depth() / 8 * accelFactor;
+    const VectorscopeStripe prototype = { &source, 0, 0, (int) accelFactor, xWeights, yWeights,
+                                          (int) (halfW * (1 << shift)), (int) (halfH * (1 << shift)), shift, cw,
+                                          paintMode == PaintMode_Original };
+    const VectorscopeBins bins = ScopeKernels::accumulateStripes(prototype, source.height(), accelFactor, accumulateStripe, mergeBins);
+    const uint *counts = bins.counts.constData();
+    const QRgb *colours = bins.colours.isEmpty() ? NULL : bins.colours.constData();
 
     // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see: http://doc.trolltech.org/4.6/qimage.html#bytesPerLine
     double avgPxPerPx = (double) image.depth() / 8 *(image.bytesPerLine()*image.height())/scope.size().width()/scope.size().height()/accelFactor;
 
-    for (int i = 0; i < (image.bytesPerLine()*image.height()); i+= stepsize) {
-        QRgb *col = (QRgb *) bits;
+    // The density modes blend once per sample, further samples of a bin would not change the pixel
+    const bool density = paintMode == PaintMode_Green || paintMode == PaintMode_Green2 || paintMode == PaintMode_Black;
+    const double uvScale = SCALING * gain;
+    for (int py = 0; py < cw; ++py) {
+        const double v = (1 - py / qMax(halfH, 0.5)) / uvScale;
+        for (int px = 0; px < cw; ++px) {
+            const uint count = counts[py * cw + px];
+            if (count == 0) {
+                continue;
+            }
+            const double u = (px / qMax(halfW, 0.5) - 1) / uvScale;
+            const uint repeat = density ? qMin(count, (uint) 255) : 1;
+            for (uint i = 0; i < repeat; ++i) {
+                plotPoint(scope, QPoint(px, py), u, v, colours ? colours[py * cw + px] : 0, paintMode, colorSpace, avgPxPerPx);
+            }
+        }
+    }
+    return scope;
+}
 
-        int r = qRed(*col);
-        int g = qGreen(*col);
-        int b = qBlue(*col);
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const SharedFrame &frame, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode,
+                                                  const VectorscopeGenerator::ColorSpace &colorSpace,
+                                                  bool, uint accelFactor) const
+{
+    const YuvPlanes planes(frame);
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || !planes.isValid()) {
+        // Invalid size
+        return QImage();
+    }
 
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-//             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double) -0.0005781* r -0.001135 * g +0.001713 * b;
-            v = (double)  0.002411 * r -0.002019 * g -0.0003921* b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-//             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double) -0.0006671* r -0.001299 * g +0.0019608* b;
-            v = (double)  0.001961 * r -0.001642 * g -0.0003189* b;
-            break;
-        }
+    const int cw = (vectorscopeSize.width() < vectorscopeSize.height()) ? vectorscopeSize.width() : vectorscopeSize.height();
+    QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
+    scope.fill(qRgba(0,0,0,0));
 
+    // Cb and Cr are read from the chroma planes, so only one point is plotted per 2x2 pixels.
+    double pbScale, prScale;
+    chromaScales(colorSpace, pbScale, prScale);
 
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING*gain*u, SCALING*gain*v));
+    const int chromaWidth = planes.chromaWidth();
+    const int chromaHeight = planes.chromaHeight();
+    const uint sampleCount = chromaWidth * chromaHeight;
+    double avgPxPerPx = (double) 16 * sampleCount/scope.size().width()/scope.size().height()/accelFactor;
 
+    QPoint pt;
+    for (uint i = 0; i < sampleCount; i += accelFactor) {
+        const int cy = i / chromaWidth;
+        const int cx = i % chromaWidth;
+        const int cb = planes.cbLine(2 * cy)[cx];
+        const int cr = planes.crLine(2 * cy)[cx];
+        const double u = pbScale * (cb - 128);
+        const double v = prScale * (cr - 128);
+
+        pt = mapToCircle(vectorscopeSize, QPointF(SCALING*gain*u, SCALING*gain*v));
         if (pt.x() >= scope.width() || pt.x() < 0
             || pt.y() >= scope.height() || pt.y() < 0) {
             // Point lies outside (because of scaling), don't plot it
-
-        } else {
-
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8*v;
-                    dg = dy - 100.6*u - 148*v;
-                    db = dy + 517.2*u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5*v;
-                    dg = dy - 87.75*u - 182*v;
-                    db = dy + 451.9*u;
-                    break;
-                }
-
-
-                if (dr < 0) dr = 0;
-                if (dg < 0) dg = 0;
-                if (db < 0) db = 0;
-                if (dr > 255) dr = 255;
-                if (dg > 255) dg = 255;
-                if (db > 255) db = 255;
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
-
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8*v;
-                    dg = dy - 100.6*u - 148*v;
-                    db = dy + 517.2*u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5*v;
-                    dg = dy - 87.75*u - 182*v;
-                    db = dy + 451.9*u;
-                    break;
-                }
-
-                // Scale the RGB values back to max 255
-                dmax = dr;
-                if (dg > dmax) dmax = dg;
-                if (db > dmax) dmax = db;
-                dmax = 255/dmax;
-
-                dr *= dmax;
-                dg *= dmax;
-                db *= dmax;
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, *col);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px)+(255-qRed(px))/(3*avgPxPerPx), qGreen(px)+20*(255-qGreen(px))/(avgPxPerPx),
-                                         qBlue(px)+(255-qBlue(px))/(avgPxPerPx), qAlpha(px)+(255-qAlpha(px))/(avgPxPerPx)));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px)+ceil((255-(float)qRed(px))/(4*avgPxPerPx)), 255,
-                                         qBlue(px)+ceil((255-(float)qBlue(px))/(avgPxPerPx)), qAlpha(px)+ceil((255-(float)qAlpha(px))/(avgPxPerPx))));
-                break;
-            case PaintMode_Black:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0,0,0, qAlpha(px)+(255-qAlpha(px))/20));
-                break;
-            }
+            continue;
         }
-
-        bits += stepsize;
+        // The original colour is only needed in this mode
+        const QRgb original = paintMode == PaintMode_Original ? planes.rgb(planes.lumaLine(2 * cy)[2 * cx], cb, cr) : 0;
+        plotPoint(scope, pt, u, v, original, paintMode, colorSpace, avgPxPerPx);
     }
     return scope;
 }
 
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const ScopeCounts &counts, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode,
+                                                  const VectorscopeGenerator::ColorSpace &colorSpace,
+                                                  bool, uint) const
+{
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || !counts.contains(ScopeCounts::Vectorscope)) {
+        // Invalid size
+        return QImage();
+    }
 
+    const int cw = (vectorscopeSize.width() < vectorscopeSize.height()) ? vectorscopeSize.width() : vectorscopeSize.height();
+    QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
+    scope.fill(qRgba(0,0,0,0));
+
+    double pbScale, prScale;
+    chromaScales(colorSpace, pbScale, prScale);
+
+    // One chroma sample was counted per 2x2 pixels, as in the frame path
+    double avgPxPerPx = (double) 16 * (counts.pixelCount / 4)/scope.size().width()/scope.size().height();
+
+    // The density modes blend once per sample, further samples of a bin would not change the pixel
+    const bool density = paintMode == PaintMode_Green || paintMode == PaintMode_Green2 || paintMode == PaintMode_Black;
+    const uint *bins = counts.chroma.constData();
+    QPoint pt;
+    for (int cr = 0; cr < SCOPE_LEVELS; ++cr) {
+        const double v = prScale * (cr - 128);
+        for (int cb = 0; cb < SCOPE_LEVELS; ++cb) {
+            const uint count = *bins++;
+            if (count == 0) {
+                continue;
+            }
+            const double u = pbScale * (cb - 128);
+            pt = mapToCircle(vectorscopeSize, QPointF(SCALING*gain*u, SCALING*gain*v));
+            if (pt.x() >= scope.width() || pt.x() < 0
+                || pt.y() >= scope.height() || pt.y() < 0) {
+                // Point lies outside (because of scaling), don't plot it
+                continue;
+            }
+            const uint repeat = density ? qMin(count, (uint) 255) : 1;
+            for (uint i = 0; i < repeat; ++i) {
+                plotPoint(scope, pt, u, v, 0, paintMode, colorSpace, avgPxPerPx);
+            }
+        }
+    }
+    return scope;
+}
@@ -18,6 +18,8 @@ class QImage;
 class QPoint;
 class QPointF;
 class QSize;
+class ScopeCounts;
+class SharedFrame;
 
 class VectorscopeGenerator : public QObject
 {
@@ -31,6 +33,17 @@ public:
                                 const VectorscopeGenerator::PaintMode &paintMode,
                                 const VectorscopeGenerator::ColorSpace &colorSpace,
                                 bool, uint accelFactor = 1) const;
+    /** @brief Calculates the vectorscope from the chroma planes of a YUV 4:2:0 monitor frame, without converting it. */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, const SharedFrame &frame, const float &gain,
+                                const VectorscopeGenerator::PaintMode &paintMode,
+                                const VectorscopeGenerator::ColorSpace &colorSpace,
+                                bool, uint accelFactor = 1) const;
+    /** @brief Paints the vectorscope from the chroma counts of a frame.
+        The original colour is not known from the counts, PaintMode_Original needs the frame. */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, const ScopeCounts &counts, const float &gain,
+                                const VectorscopeGenerator::PaintMode &paintMode,
+                                const VectorscopeGenerator::ColorSpace &colorSpace,
+                                bool, uint accelFactor = 1) const;
 
     QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
     static const float scaling;
@@ -51,6 +51,8 @@ Waveform::Waveform(QWidget *parent) :
     connect(m_aRec601, &QAction::toggled, this, &Waveform::forceUpdateScope);
     connect(m_aRec709, &QAction::toggled, this, &Waveform::forceUpdateScope);
 
+    enableGpuAnalysis(ScopeCounts::Waveform);
+
     init();
     m_waveformGenerator = new WaveformGenerator();
 }
@@ -166,20 +168,36 @@ QImage Waveform::renderHUD(uint)
     return hud;
 }
 
-QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+template <class Frame>
+QImage Waveform::renderWaveform(uint accelFactor, const Frame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
 
     const int paintmode = ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
     WaveformGenerator::Rec rec = m_aRec601->isChecked() ? WaveformGenerator::Rec_601 : WaveformGenerator::Rec_709;
-    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0,m_paddingBottom), qimage,
+    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0,m_paddingBottom), frame,
                                                          (WaveformGenerator::PaintMode) paintmode, true, rec, accelFactor);
 
     emit signalScopeRenderingFinished(start.elapsed(), 1);
     return wave;
 }
 
+QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+{
+    return renderWaveform(accelFactor, qimage);
+}
+
+QImage Waveform::renderGfxScope(uint accelFactor, const SharedFrame &frame)
+{
+    return renderWaveform(accelFactor, frame);
+}
+
+QImage Waveform::renderGfxScope(uint accelFactor, const ScopeCounts &counts)
+{
+    return renderWaveform(accelFactor, counts);
+}
+
 QImage Waveform::renderBackground(uint)
 {
     emit signalBackgroundRenderingFinished(0, 1);
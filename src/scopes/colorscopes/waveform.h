@@ -53,6 +53,10 @@ private:
     QRect scopeRect();
     QImage renderHUD(uint);
     QImage renderGfxScope(uint, const QImage &);
+    QImage renderGfxScope(uint, const SharedFrame &);
+    QImage renderGfxScope(uint, const ScopeCounts &);
+    /** @brief Renders the scope from either an image or a frame shared with the monitor. */
+    template <class Frame> QImage renderWaveform(uint accelerationFactor, const Frame &frame);
     QImage renderBackground(uint);
     bool isHUDDependingOnInput() const;
     bool isScopeDependingOnInput() const;
@@ -9,6 +9,9 @@
  ***************************************************************************/
 
 #include "waveformgenerator.h"
+#include "yuvplanes.h"
+#include "scopecounts.h"
+#include "scopekernels.h"
 
 #include <cmath>
 
@@ -16,8 +19,68 @@
 #include <QPainter>
 #include <QSize>
 #include <QTime>
+#include <QVector>
 
 #define CHOP255(a) ((255) < (a) ? (255) : (a))
+// Clamps to [0,255], log() returns negative values for small counts
+#define CLAMP255(a) ((a) < 0 ? 0 : CHOP255(a))
+// Upper bound for the number of entries of the paint lookup table
+#define MAX_LUT_SIZE 65536
+
+// Luma weights scaled to 256, R + G + B weights sum up to 256 so that white maps to 255
+static const int rec601Weights[3] = { 77, 150, 29 };
+static const int rec709Weights[3] = { 54, 183, 19 };
+
+/** @brief Rows of a frame accumulated by one thread, either from an RGB image or from the luma plane. */
+struct WaveformStripe {
+    const QImage *image;
+    const YuvPlanes *planes;
+    int first;
+    int last;
+    int step;
+    const uint *rowOffset;
+    const uint *column;
+    const int *weights;
+    int binCount;
+};
+
+static QVector<uint> accumulateImageStripe(const WaveformStripe &stripe)
+{
+    QVector<uint> waveValues(stripe.binCount, 0);
+    uint *values = waveValues.data();
+    const int width = stripe.image->width();
+    QVector <uchar> luma(width);
+    for (int y = stripe.first; y < stripe.last; y += stripe.step) {
+        ScopeKernels::lumaLine((const QRgb *) stripe.image->constScanLine(y), width, stripe.weights, luma.data());
+        for (int x = 0; x < width; ++x) {
+            values[stripe.rowOffset[luma.at(x)] + stripe.column[x]]++;
+        }
+    }
+    return waveValues;
+}
+
+static QVector<uint> accumulatePlaneStripe(const WaveformStripe &stripe)
+{
+    QVector<uint> waveValues(stripe.binCount, 0);
+    uint *values = waveValues.data();
+    const int width = stripe.planes->width;
+    for (int y = stripe.first; y < stripe.last; y += stripe.step) {
+        const uint8_t *luma = stripe.planes->lumaLine(y);
+        for (int x = 0; x < width; ++x) {
+            values[stripe.rowOffset[luma[x]] + stripe.column[x]]++;
+        }
+    }
+    return waveValues;
+}
+
+static void mergeValues(QVector<uint> &waveValues, const QVector<uint> &stripe)
+{
+    uint *values = waveValues.data();
+    const uint *stripeValues = stripe.constData();
+    for (int i = 0; i < waveValues.count(); ++i) {
+        values[i] += stripeValues[i];
+    }
+}
 
 WaveformGenerator::WaveformGenerator()
 {
@@ -42,21 +105,15 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
 
     } else {
 
-        // Fill with transparent color
-        wave.fill(qRgba(0,0,0,0));
+        // The kernel reads 32 bit pixels
+        const QImage source = image.depth() == 32 ? image : image.convertToFormat(QImage::Format_RGB32);
 
         const uint ww = waveformSize.width();
         const uint wh = waveformSize.height();
-        const uint iw = image.bytesPerLine();
-        const uint ih = image.height();
+        const uint iw = source.bytesPerLine();
+        const uint ih = source.height();
         const uint byteCount = iw*ih;
-
-        uint waveValues[waveformSize.width()][waveformSize.height()];
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                waveValues[i][j] = 0;
-            }
-        }
+        const int pixelWidth = source.width();
 
         // Number of input pixels that will fall on one scope pixel.
         // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
@@ -70,90 +127,172 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
         const float hPrediv = (float)(wh-1)/255;
         const float wPrediv = (float)(ww-1)/(iw-1);
 
-        const uchar *bits = image.bits();
-	const int bpp = image.depth() / 8;
+        // Precompute the scope row of each luma value and the scope column of each image column
+        uint rowOffset[256];
+        for (int y = 0; y < 256; ++y) {
+            rowOffset[y] = (uint)(y * hPrediv) * ww;
+        }
+        QVector <uint> column(pixelWidth);
+        for (int x = 0; x < pixelWidth; ++x) {
+            column[x] = qMin((uint)(4 * x * wPrediv), ww - 1);
+        }
 
-        for (uint i = 0, x = 0; i < byteCount; i += bpp) {
+        // Counts stored row by row (one row per luma level), to write the scope by scanlines
+        const int *weights = rec == WaveformGenerator::Rec_601 ? rec601Weights : rec709Weights;
+        const WaveformStripe prototype = { &source, NULL, 0, 0, (int) accelFactor, rowOffset, column.constData(), weights, (int) (ww * wh) };
+        const QVector<uint> waveValues = ScopeKernels::accumulateStripes(prototype, ih, accelFactor, accumulateImageStripe, mergeValues);
 
-            Q_ASSERT(bits < image.bits() + byteCount);
+        paintWaveform(wave, waveValues, gain, paintMode, drawAxis);
+    }
 
-            double dY, dx, dy;
-            QRgb *col = (QRgb *)bits;
+    //uint diff = time.elapsed();
+    //emit signalCalculationFinished(wave, diff);
 
-            if (rec == WaveformGenerator::Rec_601) {
-                // CIE 601 Luminance
-                dY = .299*qRed(*col) + .587*qGreen(*col) + .114*qBlue(*col);
-            } else {
-                // CIE 709 Luminance
-                dY = .2125*qRed(*col) + .7154*qGreen(*col) + .0721*qBlue(*col);
-            }
-            // dY is on [0,255] now.
-
-            dy = dY*hPrediv;
-            dx = x*wPrediv;
-            waveValues[(int)dx][(int)dy]++;
-
-            bits += bpp;
-            x += bpp;
-            if (x > iw) {
-                x -= iw;
-                if (accelFactor > 1) {
-                    bits += bpp*iw*(accelFactor-1);
-                    i += bpp*iw*(accelFactor-1);
-                }
-            }
+    return wave;
+}
+
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const SharedFrame &frame, WaveformGenerator::PaintMode paintMode,
+                                            bool drawAxis, WaveformGenerator::Rec, uint accelFactor)
+{
+    Q_ASSERT(accelFactor >= 1);
+
+    const YuvPlanes planes(frame);
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || !planes.isValid()) {
+        return QImage();
+    }
+
+    QImage wave(waveformSize, QImage::Format_ARGB32);
+    const uint ww = waveformSize.width();
+    const uint wh = waveformSize.height();
+    const int iw = planes.width;
+    const int ih = planes.height;
+
+    const float pixelDepth = (float)(iw * ih / accelFactor)/(ww*wh);
+    const float gain = 255/(8*pixelDepth);
+
+    // The luma plane is read as is, it was already encoded with the source colour matrix.
+    // Studio range values are expanded so that the scale matches the RGB path.
+    const float hPrediv = (float)(wh-1)/255;
+    const float wPrediv = (float)(ww-1)/(iw-1);
+    uint rowOffset[256];
+    for (int y = 0; y < 256; ++y) {
+        rowOffset[y] = (uint)(YuvPlanes::fullRangeLuma(y) * hPrediv) * ww;
+    }
+    QVector <uint> column(iw);
+    for (int x = 0; x < iw; ++x) {
+        column[x] = qMin((uint)(x * wPrediv), ww - 1);
+    }
+
+    const WaveformStripe prototype = { NULL, &planes, 0, 0, (int) accelFactor, rowOffset, column.constData(), NULL, (int) (ww * wh) };
+    const QVector<uint> waveValues = ScopeKernels::accumulateStripes(prototype, ih, accelFactor, accumulatePlaneStripe, mergeValues);
+
+    paintWaveform(wave, waveValues, gain, paintMode, drawAxis);
+    return wave;
+}
+
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const ScopeCounts &counts, WaveformGenerator::PaintMode paintMode,
+                                            bool drawAxis, WaveformGenerator::Rec, uint)
+{
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || !counts.contains(ScopeCounts::Waveform) || counts.columns < 2) {
+        return QImage();
+    }
+
+    QImage wave(waveformSize, QImage::Format_ARGB32);
+    const uint ww = waveformSize.width();
+    const uint wh = waveformSize.height();
+    const int columns = counts.columns;
+
+    QVector <uint> waveValues(ww * wh, 0);
+
+    const float pixelDepth = (float)counts.pixelCount/(ww*wh);
+    const float gain = 255/(8*pixelDepth);
+
+    // Fold the count columns into the scope size
+    const float hPrediv = (float)(wh-1)/255;
+    const float wPrediv = (float)(ww-1)/(columns-1);
+    QVector <uint> column(columns);
+    for (int x = 0; x < columns; ++x) {
+        column[x] = qMin((uint)(x * wPrediv), ww - 1);
+    }
+    const uint *source = counts.waveform.constData();
+    uint *values = waveValues.data();
+    for (int y = 0; y < SCOPE_LEVELS; ++y) {
+        uint *row = values + (uint)(y * hPrediv) * ww;
+        for (int x = 0; x < columns; ++x) {
+            row[column.at(x)] += *source++;
         }
+    }
+
+    paintWaveform(wave, waveValues, gain, paintMode, drawAxis);
+    return wave;
+}
 
+void WaveformGenerator::paintWaveform(QImage &wave, const QVector<uint> &waveValues, float gain,
+                                      WaveformGenerator::PaintMode paintMode, bool drawAxis) const
+{
+    const uint ww = wave.width();
+    const uint wh = wave.height();
+    const uint *values = waveValues.constData();
+
+    // Precompute the color of each count, counts above the table size are saturated
+    QVector <QRgb> lut;
+    double saturation;
+    switch (paintMode) {
+    case PaintMode_Green:
+        // The red channel saturates last
+        saturation = exp(255. / 52) / (0.1 * gain);
+        break;
+    case PaintMode_Yellow:
+        saturation = 255 / gain;
+        break;
+    default:
+        saturation = 255 / (2 * gain);
+        break;
+    }
+    const int lutSize = (int) qBound(2., saturation + 2, (double) MAX_LUT_SIZE);
+    lut.resize(lutSize);
+    for (int v = 0; v < lutSize; ++v) {
         switch (paintMode) {
         case PaintMode_Green:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(CHOP255(52*log(0.1*gain*waveValues[i][j])),
-                                                                      CHOP255(52*log(gain*waveValues[i][j])),
-                                                                      CHOP255(52*log(.25*gain*waveValues[i][j])),
-                                                                      CHOP255(64*log(gain*waveValues[i][j]))));
-                }
-            }
+            // Logarithmic scale. Needs fine tuning by hand, but looks great.
+            lut[v] = v == 0 ? qRgba(0,0,0,0) : qRgba(CLAMP255(52*log(0.1*gain*v)),
+                                                     CLAMP255(52*log(gain*v)),
+                                                     CLAMP255(52*log(.25*gain*v)),
+                                                     CLAMP255(64*log(gain*v)));
             break;
         case PaintMode_Yellow:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(255,242,0,   CHOP255(gain*waveValues[i][j])));
-                }
-            }
+            lut[v] = qRgba(255,242,0, CHOP255(gain*v));
             break;
         default:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(255,255,255, CHOP255(2*gain*waveValues[i][j])));
-                }
-            }
+            lut[v] = qRgba(255,255,255, CHOP255(2*gain*v));
             break;
         }
+    }
 
-        if (drawAxis) {
-            QPainter davinci(&wave);
-            QRgb opx;
-            davinci.setPen(qRgba(150,255,200,32));
-            davinci.setCompositionMode(QPainter::CompositionMode_Overlay);
-            for (uint i = 0; i <= 10; ++i) {
-                float dy = (float)i/10 * (wh-1);
-                for (uint x = 0; x < ww; ++x) {
-                    opx = wave.pixel(x, dy);
-                    wave.setPixel(x,dy, qRgba(CHOP255(150+qRed(opx)), 255,
-                                              CHOP255(200+qBlue(opx)), CHOP255(32+qAlpha(opx))));
-                }
-            }
+    const uint lutMax = lutSize - 1;
+    for (uint j = 0; j < wh; ++j) {
+        QRgb *line = (QRgb *) wave.scanLine(wh - j - 1);
+        const uint *row = values + j * ww;
+        for (uint i = 0; i < ww; ++i) {
+            line[i] = lut.at(qMin(row[i], lutMax));
         }
-
     }
 
-    //uint diff = time.elapsed();
-    //emit signalCalculationFinished(wave, diff);
-
-    return wave;
+    if (drawAxis) {
+        QPainter davinci(&wave);
+        QRgb opx;
+        davinci.setPen(qRgba(150,255,200,32));
+        davinci.setCompositionMode(QPainter::CompositionMode_Overlay);
+        for (uint i = 0; i <= 10; ++i) {
+            float dy = (float)i/10 * (wh-1);
+            for (uint x = 0; x < ww; ++x) {
+                opx = wave.pixel(x, dy);
+                wave.setPixel(x,dy, qRgba(CHOP255(150+qRed(opx)), 255,
+                                          CHOP255(200+qBlue(opx)), CHOP255(32+qAlpha(opx))));
+            }
+        }
+    }
 }
-#undef CHOP255
-
 
+#undef CHOP255
+#undef CLAMP255
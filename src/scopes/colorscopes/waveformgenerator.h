@@ -12,8 +12,11 @@
 #define WAVEFORMGENERATOR_H
 
 #include <QObject>
+#include <QVector>
 class QImage;
 class QSize;
+class ScopeCounts;
+class SharedFrame;
 
 class WaveformGenerator : public QObject
 {
@@ -28,6 +31,18 @@ public:
 
     QImage calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode,
                              bool drawAxis, const WaveformGenerator::Rec rec, uint accelFactor = 1);
+    /** @brief Calculates the waveform from the luma plane of a YUV 4:2:0 monitor frame, without converting it.
+        The luma plane already carries the source colour matrix, so @param rec is ignored. */
+    QImage calculateWaveform(const QSize &waveformSize, const SharedFrame &frame, WaveformGenerator::PaintMode paintMode,
+                             bool drawAxis, const WaveformGenerator::Rec rec, uint accelFactor = 1);
+    /** @brief Paints the waveform from the luma counts computed by the monitor on the GPU. */
+    QImage calculateWaveform(const QSize &waveformSize, const ScopeCounts &counts, WaveformGenerator::PaintMode paintMode,
+                             bool drawAxis, const WaveformGenerator::Rec rec, uint accelFactor = 1);
+
+private:
+    /** @brief Paints the accumulated luma counts (one row per level) into @param wave */
+    void paintWaveform(QImage &wave, const QVector<uint> &waveValues, float gain,
+                       WaveformGenerator::PaintMode paintMode, bool drawAxis) const;
 
 //signals:
     //void signalCalculationFinished(QImage image, const uint &ms);
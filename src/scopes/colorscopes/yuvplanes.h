@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef YUVPLANES_H
+#define YUVPLANES_H
+
+#include "monitor/scopes/sharedframe.h"
+
+#include <QRgb>
+
+/**
+ * @class YuvPlanes
+ * @brief Read only access to the planes of a YUV 4:2:0 frame shared by the monitor.
+ *
+ * The colour scopes read the monitor frame in place; the SharedFrame reference keeps
+ * the image data alive while a scope is rendering. Chroma is subsampled 2x2.
+ */
+class YuvPlanes
+{
+public:
+    explicit YuvPlanes(const SharedFrame &frame) :
+        width(frame.get_image_width())
+        , height(frame.get_image_height())
+        , rec709(frame.get_int("colorspace") == 709)
+        , m_frame(frame)
+    {
+        const uint8_t *image = frame.get_image_format() == mlt_image_yuv420p ? frame.get_image() : NULL;
+        m_y = image;
+        m_u = image ? image + width * height : NULL;
+        m_v = image ? m_u + (width / 2) * (height / 2) : NULL;
+    }
+
+    /** @brief Returns true if the frame holds a YUV 4:2:0 image that can be analysed. */
+    bool isValid() const { return m_y != NULL && width > 1 && height > 1; }
+    /** @brief Number of chroma samples per line. */
+    int chromaWidth() const { return width / 2; }
+    /** @brief Number of chroma lines. */
+    int chromaHeight() const { return height / 2; }
+
+    const uint8_t *lumaLine(int row) const { return m_y + row * width; }
+    /** @brief The Cb line covering luma line @param row */
+    const uint8_t *cbLine(int row) const { return m_u + (row / 2) * chromaWidth(); }
+    /** @brief The Cr line covering luma line @param row */
+    const uint8_t *crLine(int row) const { return m_v + (row / 2) * chromaWidth(); }
+
+    /** @brief Expands a studio range luma value (16-235) to 0-255. */
+    static inline int fullRangeLuma(int y)
+    {
+        return qBound(0, (298 * (y - 16) + 128) >> 8, 255);
+    }
+
+    /** @brief Converts a studio range Y'CbCr sample to full range RGB, using the frame's colour matrix. */
+    inline QRgb rgb(int y, int cb, int cr) const
+    {
+        const int c = 298 * (y - 16) + 128;
+        const int d = cb - 128;
+        const int e = cr - 128;
+        int r, g, b;
+        if (rec709) {
+            r = (c + 459 * e) >> 8;
+            g = (c - 55 * d - 136 * e) >> 8;
+            b = (c + 541 * d) >> 8;
+        } else {
+            r = (c + 409 * e) >> 8;
+            g = (c - 100 * d - 208 * e) >> 8;
+            b = (c + 516 * d) >> 8;
+        }
+        return qRgb(qBound(0, r, 255), qBound(0, g, 255), qBound(0, b, 255));
+    }
+
+    const int width;
+    const int height;
+    const bool rec709;
+
+private:
+    SharedFrame m_frame;
+    const uint8_t *m_y;
+    const uint8_t *m_u;
+    const uint8_t *m_v;
+};
+
+#endif // YUVPLANES_H
@@ -18,12 +18,14 @@
 #include "colorscopes/waveform.h"
 #include "colorscopes/rgbparade.h"
 #include "colorscopes/histogram.h"
+#include "colorscopes/scopeanalyser.h"
 #include "audioscopes/audiosignal.h"
 #include "audioscopes/audiospectrum.h"
 #include "audioscopes/spectrogram.h"
 
 
 #include <QDockWidget>
+#include <QtConcurrent>
 #include "klocalizedstring.h"
 
 //#define DEBUG_SM
@@ -36,11 +38,13 @@ ScopeManager::ScopeManager(QObject *parent) :
     m_lastConnectedRenderer(NULL)
 {
     m_signalMapper = new QSignalMapper(this);
+    m_scheduler = new ScopeScheduler(this);
 
     connect(pCore->monitorManager(), SIGNAL(checkColorScopes()), SLOT(slotUpdateActiveRenderer()));
     connect(pCore->monitorManager(), SIGNAL(clearScopes()), SLOT(slotClearColorScopes()));
     connect(pCore->monitorManager(), SIGNAL(checkScopes()), SLOT(slotCheckActiveScopes()));
     connect(m_signalMapper, SIGNAL(mapped(QString)), SLOT(slotRequestFrame(QString)));
+    connect(&m_analysis, &QFutureWatcher<ScopeCounts>::finished, this, &ScopeManager::slotAnalysisFinished);
 
     slotUpdateActiveRenderer();
 
@@ -100,10 +104,12 @@ bool ScopeManager::addScope(AbstractGfxScopeWidget *colorScope, QDockWidget *col
         GfxScopeData gsd;
         gsd.scope = colorScope;
         m_colorScopes.append(gsd);
+        m_scheduler->addScope(colorScope);
 
         connect(colorScope, SIGNAL(requestAutoRefresh(bool)), this, SLOT(slotCheckActiveScopes()));
         connect(colorScope, SIGNAL(signalFrameRequest(QString)), this, SLOT(slotRequestFrame(QString)));
         connect(colorScope, SIGNAL(signalScopeRenderingFinished(uint, uint)), this, SLOT(slotScopeReady()));
+        connect(colorScope, SIGNAL(signalGpuAnalysisToggled()), this, SLOT(slotCheckActiveScopes()));
         if (colorScopeWidget != NULL) {
             connect(colorScopeWidget, SIGNAL(visibilityChanged(bool)), this, SLOT(slotCheckActiveScopes()));
             connect(colorScopeWidget, SIGNAL(visibilityChanged(bool)), m_signalMapper, SLOT(map()));
@@ -137,14 +143,11 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
 #ifdef DEBUG_SM
     qDebug() << "ScopeManager: Starting to distribute frame.";
 #endif
+    m_scheduler->schedule(image, autoRefreshingScopes());
     for (int i = 0; i < m_colorScopes.size(); ++i) {
-        if (!m_colorScopes[i].scope->visibleRegion().isEmpty()) {
-            if (m_colorScopes[i].scope->autoRefreshEnabled()) {
-                m_colorScopes[i].scope->slotRenderZoneUpdated(image);
-#ifdef DEBUG_SM
-                qDebug() << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
-#endif
-            } else if (m_colorScopes[i].singleFrameRequested) {
+        // Auto refreshing scopes are served by the scheduler
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty() && !m_colorScopes[i].scope->autoRefreshEnabled()) {
+            if (m_colorScopes[i].singleFrameRequested) {
                 // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
                 // Force the scope to update.
                 m_colorScopes[i].singleFrameRequested = false;
@@ -159,6 +162,84 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
     //checkActiveColourScopes();
 }
 
+const ScopeScheduler *ScopeManager::scheduler() const
+{
+    return m_scheduler;
+}
+
+QList<AbstractGfxScopeWidget *> ScopeManager::autoRefreshingScopes() const
+{
+    QList<AbstractGfxScopeWidget *> scopes;
+    for (int i = 0; i < m_colorScopes.size(); ++i) {
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty() && m_colorScopes[i].scope->autoRefreshEnabled()) {
+            scopes << m_colorScopes[i].scope;
+        }
+    }
+    return scopes;
+}
+
+int ScopeManager::countsRequestedByScopes() const
+{
+    int kinds = 0;
+    for (int i = 0; i < m_colorScopes.size(); ++i) {
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty()
+            && (m_colorScopes[i].scope->autoRefreshEnabled() || m_colorScopes[i].singleFrameRequested)) {
+            kinds |= m_colorScopes[i].scope->scopeCountsKind();
+        }
+    }
+    return kinds;
+}
+
+void ScopeManager::slotDistributeYuvFrame(const SharedFrame &frame, const ScopeCounts &counts)
+{
+    const int missing = countsRequestedByScopes() & ~counts.kinds();
+    if (missing == 0) {
+        distributeYuvFrame(frame, counts);
+        return;
+    }
+    if (m_analysis.isRunning()) {
+        m_pendingFrame = frame;
+        m_pendingCounts = counts;
+        return;
+    }
+    // Walk the frame once for all the scopes instead of once per scope
+    m_analysedFrame = frame;
+    m_analysis.setFuture(QtConcurrent::run(&ScopeAnalyser::analyse, frame, counts, missing));
+}
+
+void ScopeManager::slotAnalysisFinished()
+{
+    const SharedFrame frame = m_analysedFrame;
+    m_analysedFrame = SharedFrame();
+    distributeYuvFrame(frame, m_analysis.result());
+    if (m_pendingFrame.is_valid()) {
+        const SharedFrame pending = m_pendingFrame;
+        const ScopeCounts pendingCounts = m_pendingCounts;
+        m_pendingFrame = SharedFrame();
+        m_pendingCounts = ScopeCounts();
+        slotDistributeYuvFrame(pending, pendingCounts);
+    }
+}
+
+void ScopeManager::distributeYuvFrame(const SharedFrame &frame, const ScopeCounts &counts)
+{
+#ifdef DEBUG_SM
+    qDebug() << "ScopeManager: Starting to distribute shared frame.";
+#endif
+    // All scopes hold a reference to the same frame, its image is neither converted nor copied
+    m_scheduler->schedule(frame, counts, autoRefreshingScopes());
+    for (int i = 0; i < m_colorScopes.size(); ++i) {
+        // Auto refreshing scopes are served by the scheduler
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty() && !m_colorScopes[i].scope->autoRefreshEnabled()) {
+            if (m_colorScopes[i].singleFrameRequested) {
+                m_colorScopes[i].singleFrameRequested = false;
+                m_colorScopes[i].scope->slotRenderZoneUpdated(frame, counts);
+                m_colorScopes[i].scope->forceUpdateScope();
+            }
+        }
+    }
+}
+
 void ScopeManager::slotScopeReady()
 {
     if (m_lastConnectedRenderer)
@@ -193,6 +274,7 @@ void ScopeManager::slotRequestFrame(const QString &widgetName)
 void ScopeManager::slotClearColorScopes()
 {
     m_lastConnectedRenderer = NULL;
+    m_scheduler->clear();
 }
 
 
@@ -214,6 +296,8 @@ void ScopeManager::slotUpdateActiveRenderer()
     if (m_lastConnectedRenderer != NULL) {
         connect(m_lastConnectedRenderer, SIGNAL(frameUpdated(QImage)),
                 this, SLOT(slotDistributeFrame(QImage)), Qt::UniqueConnection);
+        connect(m_lastConnectedRenderer, SIGNAL(yuvFrameUpdated(SharedFrame,ScopeCounts)),
+                this, SLOT(slotDistributeYuvFrame(SharedFrame,ScopeCounts)), Qt::UniqueConnection);
         connect(m_lastConnectedRenderer, &AbstractRender::audioSamplesSignal,
                 this, &ScopeManager::slotDistributeAudio, Qt::UniqueConnection);
 
@@ -288,6 +372,13 @@ void ScopeManager::checkActiveAudioScopes()
 void ScopeManager::checkActiveColourScopes()
 {
     bool imageStillRequested = imagesAcceptedByScopes();
+    // Counts that visible scopes want computed on the GPU
+    int gpuKinds = 0;
+    for (int i = 0; i < m_colorScopes.size(); ++i) {
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty() && m_colorScopes[i].scope->autoRefreshEnabled()) {
+            gpuKinds |= m_colorScopes[i].scope->gpuScopeKind();
+        }
+    }
 
 #ifdef DEBUG_SM
     qDebug() << "ScopeManager: New frames still requested? " << imageStillRequested;
@@ -298,10 +389,14 @@ void ScopeManager::checkActiveColourScopes()
     monitor = static_cast<Monitor*>( pCore->monitorManager()->monitor(Kdenlive::ProjectMonitor) );
     if (monitor != NULL) {
 	monitor->sendFrameForAnalysis(imageStillRequested);
+	monitor->setGpuScopes(gpuKinds);
     }
 
     monitor = static_cast<Monitor*>( pCore->monitorManager()->monitor(Kdenlive::ClipMonitor) );
-    if (monitor != NULL) { monitor->sendFrameForAnalysis(imageStillRequested); }
+    if (monitor != NULL) {
+        monitor->sendFrameForAnalysis(imageStillRequested);
+        monitor->setGpuScopes(gpuKinds);
+    }
 
     RecMonitor *recMonitor = static_cast<RecMonitor*>( pCore->monitorManager()->monitor(Kdenlive::RecordMonitor) );
     if (recMonitor != NULL) { recMonitor->analyseFrames(imageStillRequested); }
@@ -13,8 +13,10 @@
 
 #include "audioscopes/abstractaudioscopewidget.h"
 #include "colorscopes/abstractgfxscopewidget.h"
+#include "scopescheduler.h"
 
 #include <QtCore/QList>
+#include <QFutureWatcher>
 
 class QDockWidget;
 class AbstractRender;
@@ -63,6 +65,9 @@ public:
       */
     bool addScope(AbstractGfxScopeWidget *colorScope, QDockWidget *colorScopeWidget = NULL);
 
+    /** @brief The scheduler of the colour scope calculations, e.g. to read the latency of a scope. */
+    const ScopeScheduler *scheduler() const;
+
 private:
     QList<AudioScopeData> m_audioScopes;
     QList<GfxScopeData> m_colorScopes;
@@ -70,6 +75,15 @@ private:
     AbstractRender *m_lastConnectedRenderer;
 
     QSignalMapper *m_signalMapper;
+    /** Decides when the auto refreshing colour scopes get a new frame */
+    ScopeScheduler *m_scheduler;
+
+    /** Runs the single pass analysis of m_analysedFrame for all the scopes. */
+    QFutureWatcher<ScopeCounts> m_analysis;
+    SharedFrame m_analysedFrame;
+    /** Newest frame received while an analysis was running, older ones are dropped. */
+    SharedFrame m_pendingFrame;
+    ScopeCounts m_pendingCounts;
 
     /**
       Checks whether there is any scope accepting audio data, or if all of them are hidden
@@ -81,6 +95,18 @@ private:
       \see audioAcceptedByScopes()
       */
     bool imagesAcceptedByScopes() const;
+    /**
+      Returns the ScopeCounts::Kind flags of the scopes that will receive the next frame.
+      */
+    int countsRequestedByScopes() const;
+    /**
+      Returns the visible colour scopes with auto refresh, which are served by the scheduler.
+      */
+    QList<AbstractGfxScopeWidget *> autoRefreshingScopes() const;
+    /**
+      Hands @param frame and its @param counts to the scopes that accept it.
+      */
+    void distributeYuvFrame(const SharedFrame &frame, const ScopeCounts &counts);
 
     /**
       Creates all the scopes in audioscopes/ and colorscopes/.
@@ -124,6 +150,12 @@ private slots:
     void checkActiveColourScopes();
 
     void slotDistributeFrame(const QImage &image);
+    /** @brief Distributes a frame shared with the monitor, the scopes read its YUV planes in place
+        or paint from the @param counts computed on the GPU.
+        Counts the GPU did not provide are computed for all scopes in one pass before distribution. */
+    void slotDistributeYuvFrame(const SharedFrame &frame, const ScopeCounts &counts);
+    /** @brief The single pass analysis is done, distributes its frame and starts the pending one. */
+    void slotAnalysisFinished();
     void slotDistributeAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
     /**
       Allows a scope to explicitly request a new frame, even if the scope's autoRefresh is disabled.
@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "scopescheduler.h"
+#include "colorscopes/abstractgfxscopewidget.h"
+
+// Frame interval assumed until frames were measured, in ms
+#define DEFAULT_FRAME_INTERVAL 40
+// Playback is considered paused if no frame arrived for this many frame intervals
+#define PAUSE_INTERVALS 3
+// Lower bound of the pause detection delay, in ms
+#define MIN_PAUSE_DELAY 100
+// A scope that did not report back after this time is considered idle again, in ms
+#define BUSY_TIMEOUT 2000
+// Weight of a new measurement in the moving averages
+#define AVERAGE_WEIGHT 0.2
+
+ScopeScheduler::ScopeScheduler(QObject *parent) :
+    QObject(parent),
+    m_serial(0),
+    m_frameTime(-1),
+    m_frameInterval(DEFAULT_FRAME_INTERVAL)
+{
+    m_clock.start();
+    m_pauseTimer.setSingleShot(true);
+    connect(&m_pauseTimer, &QTimer::timeout, this, &ScopeScheduler::slotPaused);
+}
+
+void ScopeScheduler::addScope(AbstractGfxScopeWidget *scope)
+{
+    if (m_states.contains(scope)) {
+        return;
+    }
+    m_states.insert(scope, ScopeState());
+    connect(scope, SIGNAL(signalScopeRenderingFinished(uint,uint)), this, SLOT(slotScopeFinished(uint,uint)));
+}
+
+void ScopeScheduler::schedule(const SharedFrame &frame, const ScopeCounts &counts, const QList<AbstractGfxScopeWidget *> &scopes)
+{
+    m_frame = frame;
+    m_counts = counts;
+    m_image = QImage();
+    frameArrived(scopes);
+}
+
+void ScopeScheduler::schedule(const QImage &image, const QList<AbstractGfxScopeWidget *> &scopes)
+{
+    m_frame = SharedFrame();
+    m_counts = ScopeCounts();
+    m_image = image;
+    frameArrived(scopes);
+}
+
+void ScopeScheduler::clear()
+{
+    m_pauseTimer.stop();
+    m_frame = SharedFrame();
+    m_counts = ScopeCounts();
+    m_image = QImage();
+    m_scopes.clear();
+    m_frameTime = -1;
+}
+
+int ScopeScheduler::frameInterval() const
+{
+    return qRound(m_frameInterval);
+}
+
+ScopeScheduler::Metrics ScopeScheduler::metrics(const AbstractGfxScopeWidget *scope) const
+{
+    return m_states.value(scope).metrics;
+}
+
+bool ScopeScheduler::isBusy(const ScopeState &state) const
+{
+    return state.busy && m_clock.elapsed() - state.dispatchTime < BUSY_TIMEOUT;
+}
+
+void ScopeScheduler::frameArrived(const QList<AbstractGfxScopeWidget *> &scopes)
+{
+    const qint64 now = m_clock.elapsed();
+    // Long gaps are pauses or seeks, they would distort the cadence
+    if (m_frameTime >= 0 && now - m_frameTime < PAUSE_INTERVALS * m_frameInterval + MIN_PAUSE_DELAY) {
+        m_frameInterval += AVERAGE_WEIGHT * ((now - m_frameTime) - m_frameInterval);
+    }
+    m_frameTime = now;
+    ++m_serial;
+    m_scopes = scopes;
+    m_pauseTimer.start(qMax(MIN_PAUSE_DELAY, (int) (PAUSE_INTERVALS * m_frameInterval)));
+
+    // Scopes that waited longest come first, busy ones drop this frame
+    QList<AbstractGfxScopeWidget *> candidates;
+    foreach (AbstractGfxScopeWidget *scope, scopes) {
+        ScopeState &state = m_states[scope];
+        if (isBusy(state)) {
+            state.metrics.droppedFrames++;
+            continue;
+        }
+        int i = 0;
+        while (i < candidates.count() && m_states.value(candidates.at(i)).deliveredSerial <= state.deliveredSerial) {
+            ++i;
+        }
+        candidates.insert(i, scope);
+    }
+
+    // The scopes run side by side on the thread pool, but their stripes already share the cores.
+    // At least one scope is refreshed on every frame.
+    qint64 planned = 0;
+    foreach (AbstractGfxScopeWidget *scope, candidates) {
+        ScopeState &state = m_states[scope];
+        if (planned > 0 && planned + state.calculationTime > m_frameInterval) {
+            state.metrics.droppedFrames++;
+            continue;
+        }
+        planned += state.calculationTime;
+        dispatch(scope, false);
+    }
+}
+
+void ScopeScheduler::dispatch(AbstractGfxScopeWidget *scope, bool fullQuality)
+{
+    ScopeState &state = m_states[scope];
+    state.busy = true;
+    state.fullQualityPending = false;
+    state.deliveredSerial = m_serial;
+    state.dispatchTime = m_clock.elapsed();
+    state.frameTime = m_frameTime;
+    state.metrics.deliveredFrames++;
+    if (fullQuality) {
+        scope->requestFullQuality();
+    }
+    if (m_frame.is_valid()) {
+        scope->slotRenderZoneUpdated(m_frame, m_counts);
+    } else {
+        scope->slotRenderZoneUpdated(m_image);
+    }
+}
+
+void ScopeScheduler::slotScopeFinished(uint, uint accelerationFactor)
+{
+    AbstractGfxScopeWidget *scope = qobject_cast<AbstractGfxScopeWidget *>(sender());
+    if (!scope || !m_states.contains(scope)) {
+        return;
+    }
+    ScopeState &state = m_states[scope];
+    if (!state.busy) {
+        // A calculation the scheduler did not start, e.g. after a resize
+        return;
+    }
+    state.busy = false;
+    state.renderedSerial = state.deliveredSerial;
+    state.lastAccel = accelerationFactor;
+    // The budget is planned with the calculation time, the latency also includes the wait for the frame
+    const qint64 now = m_clock.elapsed();
+    state.metrics.latency = now - state.frameTime;
+    if (state.metrics.deliveredFrames == 1) {
+        state.calculationTime = now - state.dispatchTime;
+        state.metrics.averageLatency = state.metrics.latency;
+    } else {
+        state.calculationTime += AVERAGE_WEIGHT * ((now - state.dispatchTime) - state.calculationTime);
+        state.metrics.averageLatency += qRound(AVERAGE_WEIGHT * (state.metrics.latency - state.metrics.averageLatency));
+    }
+    emit metricsUpdated(scope->widgetName());
+
+    const bool upToDate = state.renderedSerial == m_serial && state.lastAccel <= 1;
+    if (state.fullQualityPending && !upToDate && m_scopes.contains(scope)) {
+        dispatch(scope, true);
+    }
+    state.fullQualityPending = false;
+}
+
+void ScopeScheduler::slotPaused()
+{
+    if (!m_frame.is_valid() && m_image.isNull()) {
+        return;
+    }
+    foreach (AbstractGfxScopeWidget *scope, m_scopes) {
+        ScopeState &state = m_states[scope];
+        if (state.renderedSerial == m_serial && state.lastAccel <= 1) {
+            // Already shows the paused frame at full quality
+            continue;
+        }
+        if (isBusy(state)) {
+            state.fullQualityPending = true;
+        } else {
+            dispatch(scope, true);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SCOPESCHEDULER_H
+#define SCOPESCHEDULER_H
+
+#include "colorscopes/scopecounts.h"
+#include "monitor/scopes/sharedframe.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class AbstractGfxScopeWidget;
+
+/**
+  \brief Decides when the colour scopes recalculate, following the cadence of the monitor frames.
+
+  Only the newest frame is kept. A scope that is still busy with an older frame does not queue the
+  new one, the frame is counted as dropped for it and the scope gets the next one instead.
+  The scopes share a time budget of one frame interval, estimated from their latency; the scopes that
+  did not fit are served first on the next frame.
+  When no new frame arrives for a while playback is considered paused, and all scopes are refreshed
+  with the paused frame at full quality.
+  */
+class ScopeScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Latency of a scope, from the arrival of a frame to the end of its calculation. */
+    struct Metrics {
+        /** Latency of the last calculation, in ms */
+        int latency;
+        /** Moving average of the latency, in ms */
+        int averageLatency;
+        /** Frames handed to the scope */
+        int deliveredFrames;
+        /** Frames the scope skipped because it was busy or out of budget */
+        int droppedFrames;
+        Metrics() : latency(0), averageLatency(0), deliveredFrames(0), droppedFrames(0) {}
+    };
+
+    explicit ScopeScheduler(QObject *parent = 0);
+
+    /** @brief Starts tracking the calculations of @param scope */
+    void addScope(AbstractGfxScopeWidget *scope);
+
+    /** @brief A new monitor frame is displayed, distributes it among @param scopes within the frame budget. */
+    void schedule(const SharedFrame &frame, const ScopeCounts &counts, const QList<AbstractGfxScopeWidget *> &scopes);
+    /** @see schedule(const SharedFrame &, const ScopeCounts &, const QList<AbstractGfxScopeWidget *> &) */
+    void schedule(const QImage &image, const QList<AbstractGfxScopeWidget *> &scopes);
+    /** @brief Forgets the current frame, e.g. when the monitor was closed. */
+    void clear();
+
+    /** @brief The measured interval between two displayed frames, in ms. */
+    int frameInterval() const;
+    Metrics metrics(const AbstractGfxScopeWidget *scope) const;
+
+signals:
+    /** @brief The metrics of @param widgetName were updated after a calculation. */
+    void metricsUpdated(const QString &widgetName);
+
+private:
+    struct ScopeState {
+        bool busy;
+        /** The scope has to redo the paused frame at full quality once it is done */
+        bool fullQualityPending;
+        qint64 renderedSerial;
+        qint64 deliveredSerial;
+        qint64 dispatchTime;
+        qint64 frameTime;
+        uint lastAccel;
+        /** Moving average of the calculation time, used to plan the frame budget */
+        double calculationTime;
+        Metrics metrics;
+        ScopeState() : busy(false), fullQualityPending(false), renderedSerial(-1), deliveredSerial(-1),
+            dispatchTime(0), frameTime(0), lastAccel(1), calculationTime(0) {}
+    };
+
+    QHash<const AbstractGfxScopeWidget *, ScopeState> m_states;
+    QList<AbstractGfxScopeWidget *> m_scopes;
+
+    /** Newest frame, either shared with the monitor or an RGB image */
+    SharedFrame m_frame;
+    ScopeCounts m_counts;
+    QImage m_image;
+    qint64 m_serial;
+    qint64 m_frameTime;
+
+    QElapsedTimer m_clock;
+    /** Moving average of the time between two frames */
+    double m_frameInterval;
+    QTimer m_pauseTimer;
+
+    void frameArrived(const QList<AbstractGfxScopeWidget *> &scopes);
+    /** @brief Hands the current frame to @param scope, without acceleration if @param fullQuality is set */
+    void dispatch(AbstractGfxScopeWidget *scope, bool fullQuality);
+    bool isBusy(const ScopeState &state) const;
+
+private slots:
+    void slotScopeFinished(uint mseconds, uint accelerationFactor);
+    /** @brief No frame since a while, refreshes the scopes with the paused frame at full quality. */
+    void slotPaused();
+};
+
+#endif
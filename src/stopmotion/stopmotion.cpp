@@ -43,6 +43,9 @@
 #include <QtConcurrent>
 #include <QStandardPaths>
 
+// Height of the thumbnails in the frame strip
+#define THUMB_HEIGHT 90
+
 MyLabel::MyLabel(QWidget* parent) :
     QLabel(parent)
 {
@@ -314,6 +317,7 @@ StopmotionWidget::StopmotionWidget(MonitorManager *manager, const QUrl &projectF
     m_captureDevice->sendFrameForAnalysis = KdenliveSettings::analyse_stopmotion();
     m_monitor->setRender(m_captureDevice);
     connect(m_captureDevice, SIGNAL(frameSaved(QString)), this, SLOT(slotNewThumb(QString)));
+    connect(m_captureDevice, SIGNAL(frameCaptured(QImage,QString)), this, SLOT(slotFrameCaptured(QImage,QString)));
     */
 
     live_button->setChecked(false);
@@ -393,7 +397,10 @@ void StopmotionWidget::slotShowThumbs(bool show)
         frame_list->clear();
         sequenceNameChanged(sequence_name->currentText());
     } else {
+        m_thumbsMutex.lock();
         m_filesList.clear();
+        m_capturedFrames.clear();
+        m_thumbsMutex.unlock();
         frame_list->clear();
     }
     frame_list->setHidden(!show);
@@ -491,6 +498,7 @@ void StopmotionWidget::slotLive(bool isOn)
             m_captureDevice->sendFrameForAnalysis = KdenliveSettings::analyse_stopmotion();
             m_monitor->setRender(m_captureDevice);
             connect(m_captureDevice, SIGNAL(frameSaved(QString)), this, SLOT(slotNewThumb(QString)));
+            connect(m_captureDevice, SIGNAL(frameCaptured(QImage,QString)), this, SLOT(slotFrameCaptured(QImage,QString)));
         }
 
         m_manager->activateMonitor(Kdenlive::StopMotionMonitor);
@@ -602,16 +610,23 @@ void StopmotionWidget::sequenceNameChanged(const QString& name)
 {
     // Get rid of frames from previous sequence
     disconnect(this, SIGNAL(doCreateThumbs(QImage,int)), this, SLOT(slotCreateThumbs(QImage,int)));
+    m_thumbsMutex.lock();
     m_filesList.clear();
+    m_capturedFrames.clear();
+    m_thumbsMutex.unlock();
     m_future.waitForFinished();
     frame_list->clear();
     if (name.isEmpty()) {
         button_addsequence->setEnabled(false);
     } else {
         // Check if we are editing an existing sequence
-        QString pattern = SlideshowClip::selectedPath(QUrl::fromLocalFile(getPathForFrame(0, sequence_name->currentText())), false, QString(), &m_filesList);
-        m_sequenceFrame = m_filesList.isEmpty() ? 0 : SlideshowClip::getFrameNumberFromPath(QUrl::fromLocalFile(m_filesList.last())) + 1;
-        if (!m_filesList.isEmpty()) {
+        QStringList files;
+        QString pattern = SlideshowClip::selectedPath(QUrl::fromLocalFile(getPathForFrame(0, sequence_name->currentText())), false, QString(), &files);
+        m_thumbsMutex.lock();
+        m_filesList = files;
+        m_thumbsMutex.unlock();
+        m_sequenceFrame = files.isEmpty() ? 0 : SlideshowClip::getFrameNumberFromPath(QUrl::fromLocalFile(files.last())) + 1;
+        if (!files.isEmpty()) {
             m_sequenceName = sequence_name->currentText();
             connect(this, SIGNAL(doCreateThumbs(QImage,int)), this, SLOT(slotCreateThumbs(QImage,int)));
             m_future = QtConcurrent::run(this, &StopmotionWidget::slotPrepareThumbs);
@@ -669,21 +684,43 @@ void StopmotionWidget::slotPreNotify()
 
 
 void StopmotionWidget::slotNewThumb(const QString &path)
+{
+    Q_UNUSED(path)
+    // The overlay producer reads the frame from disk
+    if (m_showOverlay->isChecked()) reloadOverlay();
+}
+
+void StopmotionWidget::slotFrameCaptured(const QImage &image, const QString &path)
 {
     if (!KdenliveSettings::showstopmotionthumbs()) return;
+    m_thumbsMutex.lock();
+    m_capturedFrames.insert(path, image);
     m_filesList.append(path);
-    if (m_showOverlay->isChecked()) reloadOverlay();
+    m_thumbsMutex.unlock();
     if (!m_future.isRunning()) m_future = QtConcurrent::run(this, &StopmotionWidget::slotPrepareThumbs);
-
 }
 
 void StopmotionWidget::slotPrepareThumbs()
 {
-    if (m_filesList.isEmpty())
+    m_thumbsMutex.lock();
+    if (m_filesList.isEmpty()) {
+        m_thumbsMutex.unlock();
         return;
+    }
     QString path = m_filesList.takeFirst();
-    emit doCreateThumbs(QImage(path), SlideshowClip::getFrameNumberFromPath(QUrl::fromLocalFile(path)));
-
+    QImage thumb = m_thumbCache.value(path);
+    QImage img = m_capturedFrames.take(path);
+    m_thumbsMutex.unlock();
+    if (thumb.isNull()) {
+        // Frames captured in this session are still in memory, only older ones are read from disk
+        if (img.isNull()) img = QImage(path);
+        if (!img.isNull()) {
+            thumb = img.scaledToHeight(THUMB_HEIGHT);
+            QMutexLocker lock(&m_thumbsMutex);
+            m_thumbCache.insert(path, thumb);
+        }
+    }
+    emit doCreateThumbs(thumb, SlideshowClip::getFrameNumberFromPath(QUrl::fromLocalFile(path)));
 }
 
 void StopmotionWidget::slotCreateThumbs(const QImage &img, int ix)
@@ -692,10 +729,11 @@ void StopmotionWidget::slotCreateThumbs(const QImage &img, int ix)
         m_future = QtConcurrent::run(this, &StopmotionWidget::slotPrepareThumbs);
         return;
     }
-    int height = 90;
+    int height = THUMB_HEIGHT;
     int width = height * img.width() / img.height();
     frame_list->setIconSize(QSize(width, height));
-    QPixmap pix = QPixmap::fromImage(img).scaled(width, height);
+    QPixmap pix = QPixmap::fromImage(img);
+    if (pix.height() != height) pix = pix.scaled(width, height);
     QString nb = QString::number(ix);
     QPainter p(&pix);
     QFontInfo finfo(font());
@@ -824,6 +862,9 @@ void StopmotionWidget::slotRemoveFrame()
 
     QFile f(path);
     if (f.remove()) {
+        m_thumbsMutex.lock();
+        m_thumbCache.remove(path);
+        m_thumbsMutex.unlock();
         QListWidgetItem* item = frame_list->takeItem(frame_list->currentRow());
         int ix = item->data(Qt::UserRole).toInt();
         if (ix == m_sequenceFrame - 1) {
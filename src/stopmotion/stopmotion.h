@@ -25,6 +25,8 @@
 #include <QLabel>
 #include <QFuture>
 #include <QTimer>
+#include <QMutex>
+#include <QHash>
 #include "monitor/abstractmonitor.h"
 
 class MltDeviceCapture;
@@ -126,6 +128,15 @@ private:
     /** @brief The list of files in the sequence to create thumbnails. */
     QStringList m_filesList;
 
+    /** @brief Frames captured in this session, not yet turned into thumbnails (path, full image). */
+    QHash <QString, QImage> m_capturedFrames;
+
+    /** @brief Thumbnails already created, so that the frame strip never reloads files from disk. */
+    QHash <QString, QImage> m_thumbCache;
+
+    /** @brief Protects m_filesList, m_capturedFrames and m_thumbCache, used by the thumbnail thread. */
+    QMutex m_thumbsMutex;
+
     /** @brief Holds the state of the threaded thumbnail generation. */
     QFuture<void> m_future;
 
@@ -219,9 +230,12 @@ private slots:
     /** @brief Show the config dialog */
     void slotConfigure();
 
-    /** @brief Prepare to crete thumb for newly captured frame. */
+    /** @brief A captured frame was written to disk. */
     void slotNewThumb(const QString &path);
 
+    /** @brief Prepare to create thumb for newly captured frame, directly from the in-memory image. */
+    void slotFrameCaptured(const QImage &image, const QString &path);
+
     /** @brief Set the effect to be applied to overlay frame. */
     void slotUpdateOverlayEffect(QAction* act);
 
@@ -86,6 +86,51 @@ return frameNumber;
 #include <QDebug>
 #include <KLocalizedString>
 
+namespace {
+/** @brief Writes value with at least 2 digits, returns the position following the last digit. */
+char *writeDigits(char *out, int value)
+{
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    if (count < 2) digits[count++] = '0';
+    while (count > 0) *out++ = digits[--count];
+    return out;
+}
+
+/** @brief Formats a timecode in a fixed buffer, without the intermediate strings of QString::arg or rightJustified.
+ *  @param last is not written if negative */
+QString formatTimecode(bool negative, int hours, int minutes, int seconds, char separator, int last)
+{
+    char buffer[48];
+    char *out = buffer;
+    if (negative) *out++ = '-';
+    out = writeDigits(out, hours);
+    *out++ = ':';
+    out = writeDigits(out, minutes);
+    *out++ = ':';
+    out = writeDigits(out, seconds);
+    if (last >= 0) {
+        *out++ = separator;
+        out = writeDigits(out, last);
+    }
+    return QString::fromLatin1(buffer, out - buffer);
+}
+
+/** @brief Reads the 2 digits at pos, returns -1 if they are not both digits. */
+inline int readDigits(const QString &text, int pos)
+{
+    if (pos < 0 || pos + 1 >= text.length()) return -1;
+    const ushort high = text.at(pos).unicode() - '0';
+    const ushort low = text.at(pos + 1).unicode() - '0';
+    if (high > 9 || low > 9) return -1;
+    return high * 10 + low;
+}
+}
+
 Timecode::Timecode(Formats format, double framesPerSecond)
 {
     setFormat(framesPerSecond, format);
@@ -104,6 +149,11 @@ void Timecode::setFormat(double framesPerSecond, Formats format)
     if (m_dropFrameTimecode) {
         m_dropFrames = round(m_realFps * .066666); //Number of frames to drop on the minute marks is the nearest integer to 6% of the framerate
         m_framesPer10Minutes = round(m_realFps * 600); //Number of frames per ten minutes
+        m_framesPerDroppedMinute = round(m_realFps * 60) - m_dropFrames; //Number of frames in a minute starting with dropped frames
+    } else {
+        m_dropFrames = 0;
+        m_framesPer10Minutes = 0;
+        m_framesPerDroppedMinute = 0;
     }
 }
 
@@ -136,6 +186,24 @@ int Timecode::getFrameCount(const QString &duration) const
     }
     int hours, minutes, seconds, frames;
     int offset = 0;
+    if (duration.length() == 11 || (duration.length() == 12 && duration.at(0) == '-')) {
+        // Fixed layout [-]hh:mm:ss:ff, read the digits directly
+        offset = duration.length() - 11;
+        hours = readDigits(duration, offset);
+        minutes = readDigits(duration, 3 + offset);
+        seconds = readDigits(duration, 6 + offset);
+        frames = readDigits(duration, 9 + offset);
+        if (hours >= 0 && minutes >= 0 && seconds >= 0 && frames >= 0) {
+            if (m_dropFrameTimecode) {
+                // See below, using integer math
+                int totalMinutes = (60 * hours) + minutes;
+                return ((m_displayedFramesPerSecond * 3600 * hours) + (m_displayedFramesPerSecond * 60 * minutes) + (m_displayedFramesPerSecond * seconds) + frames) - (m_dropFrames * (totalMinutes - totalMinutes / 10));
+            }
+            // Non drop frame timecodes always have an integer fps
+            return (hours * 3600 + minutes * 60 + seconds) * m_displayedFramesPerSecond + frames;
+        }
+        offset = 0;
+    }
     if (duration.at(0) == '-') {
         offset = 1;
         hours = duration.midRef(1, 2).toInt();
@@ -215,19 +283,7 @@ QString Timecode::getStringTimecode(int frames, const double &fps, bool showFram
     seconds = seconds % 60;
     int hours = minutes / 60;
     minutes = minutes % 60;
-    QString text;
-    if (negative)
-        text.append('-');
-    text.append(QString::number(hours).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(minutes).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(seconds).rightJustified(2, '0', false));
-    if (showFrames) {
-        text.append('.');
-        text.append(QString::number(frms).rightJustified(2, '0', false));
-    }
-    return text;
+    return formatTimecode(negative, hours, minutes, seconds, '.', showFrames ? frms : -1);
 }
 
 const QString Timecode::getTimecodeHH_MM_SS_FF(const GenTime & time) const
@@ -258,18 +314,7 @@ const QString Timecode::getTimecodeHH_MM_SS_FF(int frames) const
     int hours = minutes / 60;
     minutes = minutes % 60;
 
-    QString text;
-    if (negative)
-        text.append('-');
-    text.append(QString::number(hours).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(minutes).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(seconds).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(frames).rightJustified(2, '0', false));
-
-    return text;
+    return formatTimecode(negative, hours, minutes, seconds, ':', frames);
 }
 
 const QString Timecode::getTimecodeHH_MM_SS_HH(const GenTime & time) const
@@ -289,21 +334,7 @@ const QString Timecode::getTimecodeHH_MM_SS_HH(const GenTime & time) const
     int hours = minutes / 60;
     minutes = minutes % 60;
 
-    QString text;
-    if (negative)
-        text.append('-');
-    text.append(QString::number(hours).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(minutes).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(seconds).rightJustified(2, '0', false));
-    if (m_dropFrameTimecode)
-        text.append(',');
-    else
-        text.append(':');
-    text.append(QString::number(hundredths).rightJustified(2, '0', false));
-
-    return text;
+    return formatTimecode(negative, hours, minutes, seconds, m_dropFrameTimecode ? ',' : ':', hundredths);
 }
 
 const QString Timecode::getTimecodeFrames(const GenTime & time) const
@@ -336,30 +367,22 @@ const QString Timecode::getTimecodeDropFrame(int framenumber) const
         framenumber = qAbs(framenumber);
     }
 
-    int d = floor(framenumber / m_framesPer10Minutes);
+    // Integer divisions, all operands are positive
+    int d = framenumber / m_framesPer10Minutes;
     int m = framenumber % m_framesPer10Minutes;
 
     if (m > m_dropFrames) {
-        framenumber += (m_dropFrames * 9 * d) + m_dropFrames * (floor((m - m_dropFrames) / (round(m_realFps * 60) - m_dropFrames)));
+        framenumber += (m_dropFrames * 9 * d) + m_dropFrames * ((m - m_dropFrames) / m_framesPerDroppedMinute);
     } else {
         framenumber += m_dropFrames * 9 * d;
     }
 
     int frames = framenumber % m_displayedFramesPerSecond;
-    int seconds = (int) floor(framenumber / m_displayedFramesPerSecond) % 60;
-    int minutes = (int) floor(floor(framenumber / m_displayedFramesPerSecond) / 60) % 60;
-    int hours = floor(floor(floor(framenumber / m_displayedFramesPerSecond) / 60) / 60);
-
-    QString text;
-    if (negative)
-        text.append('-');
-    text.append(QString::number(hours).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(minutes).rightJustified(2, '0', false));
-    text.append(':');
-    text.append(QString::number(seconds).rightJustified(2, '0', false));
-    text.append(',');
-    text.append(QString::number(frames).rightJustified(2, '0', false));
-
-    return text;
+    int seconds = framenumber / m_displayedFramesPerSecond;
+    int minutes = seconds / 60;
+    seconds = seconds % 60;
+    int hours = minutes / 60;
+    minutes = minutes % 60;
+
+    return formatTimecode(negative, hours, minutes, seconds, ',', frames);
 }
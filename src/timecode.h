@@ -60,8 +60,10 @@ private:
     bool m_dropFrameTimecode;
     int m_displayedFramesPerSecond;
     double m_realFps;
-    double m_dropFrames;
+    /** @brief Drop frame constants, computed once per fps so that conversions only use integers. */
+    int m_dropFrames;
     int m_framesPer10Minutes;
+    int m_framesPerDroppedMinute;
 
     const QString getTimecodeHH_MM_SS_FF(const GenTime & time) const;
     const QString getTimecodeHH_MM_SS_FF(int frames) const;
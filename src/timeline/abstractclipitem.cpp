@@ -33,6 +33,7 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QParallelAnimationGroup>
 #include <QPropertyAnimation>
+#include <QRegExp>
 
 AbstractClipItem::AbstractClipItem(const ItemInfo &info, const QRectF& rect, double fps) :
         QObject()
@@ -56,6 +57,9 @@ AbstractClipItem::AbstractClipItem(const ItemInfo &info, const QRectF& rect, dou
 
 AbstractClipItem::~AbstractClipItem()
 {
+    if (projectScene()) {
+        projectScene()->itemIndex()->removeItem(this);
+    }
 }
 
 void AbstractClipItem::doUpdate(const QRectF &r)
@@ -285,6 +289,46 @@ CustomTrackScene* AbstractClipItem::projectScene()
     return NULL;
 }
 
+void AbstractClipItem::updateIndex()
+{
+    CustomTrackScene *scene = projectScene();
+    if (scene == NULL) return;
+    const QRectF r = mapRectToScene(rect());
+    scene->itemIndex()->updateItem(this, trackForPos(r.center().y()), r.left(), r.right());
+}
+
+bool AbstractClipItem::isLightweight(const QTransform &transform) const
+{
+    return transform.mapRect(rect()).width() < KdenliveSettings::lodclipwidth();
+}
+
+QColor AbstractClipItem::lightweightColor() const
+{
+    return brush().color();
+}
+
+void AbstractClipItem::setRect(const QRectF &rect)
+{
+    QGraphicsRectItem::setRect(rect);
+    updateIndex();
+}
+
+void AbstractClipItem::setRect(qreal x, qreal y, qreal w, qreal h)
+{
+    setRect(QRectF(x, y, w, h));
+}
+
+QVariant AbstractClipItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemSceneChange) {
+        // About to leave the current scene
+        if (projectScene()) projectScene()->itemIndex()->removeItem(this);
+    } else if (change == ItemPositionHasChanged || change == ItemSceneHasChanged || change == ItemParentHasChanged) {
+        updateIndex();
+    }
+    return QGraphicsItem::itemChange(change, value);
+}
+
 void AbstractClipItem::setItemLocked(bool locked)
 {
     if (locked)
@@ -624,3 +668,45 @@ QString AbstractClipItem::resizeAnimations(QDomElement effect, int previousDurat
     }
     return keyframes;
 }
+
+static QString scaleRectValue(const QString &value, double xScale, double yScale)
+{
+    QStringList keyframes = value.split(QLatin1Char(';'));
+    QRegExp number(QStringLiteral("-?\\d+(\\.\\d+)?"));
+    for (int i = 0; i < keyframes.count(); ++i) {
+        QString frame = keyframes.at(i);
+        if (frame.contains(QLatin1Char('%'))) continue;
+        // Skip the keyframe position, the rect is "x/y:wxh[:opacity]" or "x y w h [opacity]"
+        int pos = frame.indexOf(QLatin1Char('=')) + 1;
+        for (int j = 0; j < 4; ++j) {
+            pos = number.indexIn(frame, pos);
+            if (pos < 0) break;
+            const QString text = number.cap(0);
+            double scaled = text.toDouble() * (j % 2 == 0 ? xScale : yScale);
+            const QString result = text.contains(QLatin1Char('.')) ? QString::number(scaled) : QString::number(qRound(scaled));
+            frame.replace(pos, text.length(), result);
+            pos += result.length();
+        }
+        keyframes[i] = frame;
+    }
+    return keyframes.join(QLatin1Char(';'));
+}
+
+//static
+bool AbstractClipItem::scaleGeometries(QDomElement effect, double xScale, double yScale)
+{
+    bool modified = false;
+    QDomNodeList params = effect.elementsByTagName(QStringLiteral("parameter"));
+    for (int i = 0; i < params.count(); ++i) {
+        QDomElement e = params.item(i).toElement();
+        const QString type = e.attribute(QStringLiteral("type"));
+        if (type != QLatin1String("geometry") && type != QLatin1String("animatedrect")) continue;
+        const QString value = e.attribute(QStringLiteral("value"));
+        const QString scaled = scaleRectValue(value, xScale, yScale);
+        if (scaled != value) {
+            e.setAttribute(QStringLiteral("value"), scaled);
+            modified = true;
+        }
+    }
+    return modified;
+}
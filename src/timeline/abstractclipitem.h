@@ -49,6 +49,16 @@ public:
     virtual ~ AbstractClipItem();
     ItemInfo info() const;
     CustomTrackScene* projectScene();
+    /** @brief Registers the current scene span of the item in the scene's track index. */
+    void updateIndex();
+    /** @brief Sets the item rectangle and updates the track index. */
+    void setRect(const QRectF &rect);
+    void setRect(qreal x, qreal y, qreal w, qreal h);
+    /** @brief Returns true if the item is too narrow at this view transform to be drawn in detail.
+     *  Such items skip their own paint and are drawn as plain rectangles by the view background. */
+    bool isLightweight(const QTransform &transform) const;
+    /** @brief The colour used to draw the item as a plain rectangle. */
+    virtual QColor lightweightColor() const;
     void updateRectGeometry();
     void updateItem(int track);
     void setItemLocked(bool locked);
@@ -119,11 +129,19 @@ protected:
     void mousePressEvent(QGraphicsSceneMouseEvent * event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent * event);
     void mouseMoveEvent(QGraphicsSceneMouseEvent * event);
+    /** @brief Keeps the track index up to date, subclasses must call it for unhandled changes. */
+    virtual QVariant itemChange(GraphicsItemChange change, const QVariant &value);
     int trackForPos(int position);
     int posForTrack(int track);
     bool resizeGeometries(QDomElement effect, int width, int height, int previousDuration, int start, int duration, int cropstart);
     QString resizeAnimations(QDomElement effect, int previousDuration, int start, int duration, int cropstart);
 
+public:
+    /** @brief Scales the pixel values of the geometry / animated rect parameters of an effect or transition.
+     *  Relative (percent) values are left untouched.
+     *  @return true if a parameter was modified */
+    static bool scaleGeometries(QDomElement effect, double xScale, double yScale);
+
 signals:
     void selectItem(AbstractClipItem*);
 };
@@ -37,6 +37,7 @@
 AbstractGroupItem::AbstractGroupItem(double /* fps */) :
     QObject(),
     QGraphicsItemGroup()
+    , m_membersValid(false)
 {
     setZValue(1);
     setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
@@ -53,14 +54,9 @@ int AbstractGroupItem::track() const
 {
     //return (int)(scenePos().y() / KdenliveSettings::trackheight());
     int topTrack = -1;
-    QList<QGraphicsItem *> children = childItems();
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() == GroupWidget) {
-            children.append(children.at(i)->childItems());
-            continue;
-        }
-        AbstractClipItem *item = static_cast <AbstractClipItem *>(children.at(i));
-        if (item && (topTrack == -1 || topTrack < item->track())) {
+    updateMembers();
+    foreach(AbstractClipItem *item, m_members) {
+        if (topTrack == -1 || topTrack < item->track()) {
             topTrack = item->track();
         }
     }
@@ -84,6 +80,43 @@ bool AbstractGroupItem::isItemLocked() const
     return !(flags() & (QGraphicsItem::ItemIsSelectable));
 }
 
+void AbstractGroupItem::invalidateMembers()
+{
+    m_membersValid = false;
+    if (parentItem() && parentItem()->type() == GroupWidget) {
+        static_cast <AbstractGroupItem *>(parentItem())->invalidateMembers();
+    }
+}
+
+void AbstractGroupItem::updateMembers() const
+{
+    if (m_membersValid) return;
+    m_members.clear();
+    m_memberSet.clear();
+    QList <QGraphicsItem *> children = childItems();
+    while (!children.isEmpty()) {
+        QGraphicsItem *child = children.takeFirst();
+        if (child->type() == GroupWidget) {
+            m_memberSet.insert(child);
+            children << child->childItems();
+        } else if (child->type() == AVWidget || child->type() == TransitionWidget) {
+            m_memberSet.insert(child);
+            m_members << static_cast <AbstractClipItem *>(child);
+        }
+    }
+    m_membersValid = true;
+}
+
+void AbstractGroupItem::removeMembers(QList<QGraphicsItem*> &items) const
+{
+    updateMembers();
+    for (int i = items.count() - 1; i >= 0; --i) {
+        if (items.at(i) == this || m_memberSet.contains(items.at(i))) {
+            items.removeAt(i);
+        }
+    }
+}
+
 CustomTrackScene* AbstractGroupItem::projectScene()
 {
     if (scene()) return static_cast <CustomTrackScene*>(scene());
@@ -108,21 +141,12 @@ QPainterPath AbstractGroupItem::transitionGroupShape(const QPointF &offset) cons
 QPainterPath AbstractGroupItem::groupShape(GraphicsRectItem type, const QPointF &offset) const
 {
     QPainterPath path;
-    QList<QGraphicsItem *> children = childItems();
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() == (int)type) {
-            QRectF r(children.at(i)->sceneBoundingRect());
+    updateMembers();
+    foreach(AbstractClipItem *item, m_members) {
+        if (item->type() == (int)type) {
+            QRectF r(item->sceneBoundingRect());
             r.translate(offset);
             path.addRect(r);
-        } else if (children.at(i)->type() == GroupWidget) {
-            QList<QGraphicsItem *> subchildren = children.at(i)->childItems();
-            for (int j = 0; j < subchildren.count(); ++j) {
-                if (subchildren.at(j)->type() == (int)type) {
-                    QRectF r(subchildren.at(j)->sceneBoundingRect());
-                    r.translate(offset);
-                    path.addRect(r);
-                }
-            }
         }
     }
     return path;
@@ -131,23 +155,13 @@ QPainterPath AbstractGroupItem::groupShape(GraphicsRectItem type, const QPointF
 QPainterPath AbstractGroupItem::spacerGroupShape(GraphicsRectItem type, const QPointF &offset) const
 {
     QPainterPath path;
-    QList<QGraphicsItem *> children = childItems();
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() == (int)type) {
-            QRectF r(children.at(i)->sceneBoundingRect());
+    updateMembers();
+    foreach(AbstractClipItem *item, m_members) {
+        if (item->type() == (int)type) {
+            QRectF r(item->sceneBoundingRect());
             r.translate(offset);
             r.setRight(scene()->width());
             path.addRect(r);
-        } else if (children.at(i)->type() == GroupWidget) {
-            QList<QGraphicsItem *> subchildren = children.at(i)->childItems();
-            for (int j = 0; j < subchildren.count(); ++j) {
-                if (subchildren.at(j)->type() == (int)type) {
-                    QRectF r(subchildren.at(j)->sceneBoundingRect());
-                    r.translate(offset);
-                    r.setRight(scene()->width());
-                    path.addRect(r);
-                }
-            }
         }
     }
     return path;
@@ -311,16 +325,7 @@ QVariant AbstractGroupItem::itemChange(GraphicsItemChange change, const QVariant
         if (projectScene()->editMode() == TimelineMode::NormalEdit) {
             shape = clipGroupShape(newPos - pos());
             collidingItems = scene->items(shape, Qt::IntersectsItemShape);
-            collidingItems.removeAll(this);
-            for (int i = 0; i < children.count(); ++i) {
-                if (children.at(i)->type() == GroupWidget) {
-                    QList<QGraphicsItem *> subchildren = children.at(i)->childItems();
-                    for (int j = 0; j < subchildren.count(); ++j) {
-                        collidingItems.removeAll(subchildren.at(j));
-                    }
-                }
-                collidingItems.removeAll(children.at(i));
-            }
+            removeMembers(collidingItems);
         }
         if (!collidingItems.isEmpty()) {
             bool forwardMove = xpos > start.x();
@@ -350,16 +355,7 @@ QVariant AbstractGroupItem::itemChange(GraphicsItemChange change, const QVariant
             }
             // If there is still a collision after our position adjust, restore original pos
             collidingItems = scene->items(clipGroupShape(newPos - pos()), Qt::IntersectsItemShape);
-            collidingItems.removeAll(this);
-            for (int i = 0; i < children.count(); ++i) {
-		if (children.at(i)->type() == GroupWidget) {
-		    QList<QGraphicsItem *> subchildren = children.at(i)->childItems();
-                    for (int j = 0; j < subchildren.count(); ++j) {
-			collidingItems.removeAll(subchildren.at(j));
-                    }
-                }
-                collidingItems.removeAll(children.at(i));
-            }
+            removeMembers(collidingItems);
             for (int i = 0; i < collidingItems.count(); ++i)
                 if (collidingItems.at(i)->type() == AVWidget) return pos();
         }
@@ -367,16 +363,7 @@ QVariant AbstractGroupItem::itemChange(GraphicsItemChange change, const QVariant
         if (projectScene()->editMode() == TimelineMode::NormalEdit) {
             shape = transitionGroupShape(newPos - pos());
             collidingItems = scene->items(shape, Qt::IntersectsItemShape);
-            collidingItems.removeAll(this);
-            for (int i = 0; i < children.count(); ++i) {
-                if (children.at(i)->type() == GroupWidget) {
-                    QList<QGraphicsItem *> subchildren = children.at(i)->childItems();
-                    for (int j = 0; j < subchildren.count(); ++j) {
-                        collidingItems.removeAll(subchildren.at(j));
-                    }
-                }
-                collidingItems.removeAll(children.at(i));
-            }
+            removeMembers(collidingItems);
         }
         if (collidingItems.isEmpty()) return newPos;
         else {
@@ -406,15 +393,22 @@ QVariant AbstractGroupItem::itemChange(GraphicsItemChange change, const QVariant
                 }
                 // If there is still a collision after our position adjust, restore original pos
                 collidingItems = scene->items(transitionGroupShape(newPos - pos()), Qt::IntersectsItemShape);
-                for (int i = 0; i < children.count(); ++i) {
-                    collidingItems.removeAll(children.at(i));
-                }
+                removeMembers(collidingItems);
                 for (int i = 0; i < collidingItems.count(); ++i)
                     if (collidingItems.at(i)->type() == TransitionWidget) return pos();
             }
         }
         return newPos;
     }
+    if (change == ItemPositionHasChanged) {
+        // Grouped items are not notified when their group moves
+        updateMembers();
+        foreach(AbstractClipItem *item, m_members) {
+            item->updateIndex();
+        }
+    } else if (change == ItemChildAddedChange || change == ItemChildRemovedChange) {
+        invalidateMembers();
+    }
     return QGraphicsItemGroup::itemChange(change, value);
 }
 
@@ -516,39 +510,25 @@ void AbstractGroupItem::resizeEnd(int diff)
 
 GenTime AbstractGroupItem::duration() const
 {
-    QList <QGraphicsItem *> children = childItems();
     GenTime start = GenTime(-1.0);
     GenTime end = GenTime();
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() != GroupWidget) {
-            AbstractClipItem *item = static_cast <AbstractClipItem *>(children.at(i));
-            if (item) {
-                if (start < GenTime() || item->startPos() < start)
-                    start = item->startPos();
-                if (item->endPos() > end)
-                    end = item->endPos();
-            }
-        } else {
-            children << children.at(i)->childItems();
-        }
+    updateMembers();
+    foreach(AbstractClipItem *item, m_members) {
+        if (start < GenTime() || item->startPos() < start)
+            start = item->startPos();
+        if (item->endPos() > end)
+            end = item->endPos();
     }
     return end - start;
 }
 
 GenTime AbstractGroupItem::startPos() const
 {
-    QList <QGraphicsItem *> children = childItems();
     GenTime start = GenTime(-1.0);
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() != GroupWidget) {
-            AbstractClipItem *item = static_cast <AbstractClipItem *>(children.at(i));
-            if (item) {
-                if (start < GenTime() || item->startPos() < start)
-                    start = item->startPos();
-            }
-        } else {
-            children << children.at(i)->childItems();
-        }
+    updateMembers();
+    foreach(AbstractClipItem *item, m_members) {
+        if (start < GenTime() || item->startPos() < start)
+            start = item->startPos();
     }
     return start;
 }
@@ -567,16 +547,6 @@ QGraphicsItem *AbstractGroupItem::otherClip(QGraphicsItem *item)
 
 QList <AbstractClipItem *> AbstractGroupItem::childClips() const
 {
-    QList <AbstractClipItem *> childClips;
-    QList <QGraphicsItem *>children = childItems();
-    for (int i = 0; i < children.count(); ++i) {
-        if (children.at(i)->type() != GroupWidget) {
-            AbstractClipItem *item = static_cast <AbstractClipItem *>(children.at(i));
-	    childClips << item;
-	} else {
-            AbstractGroupItem *grp = static_cast <AbstractGroupItem *>(children.at(i));	    
-            childClips << grp->childClips();
-        }
-    }
-    return childClips;
+    updateMembers();
+    return m_members;
 }
@@ -25,6 +25,7 @@
 
 #include <QGraphicsItemGroup>
 #include <QGraphicsSceneMouseEvent>
+#include <QSet>
 
 class CustomTrackScene;
 class AbstractClipItem;
@@ -45,6 +46,7 @@ public:
     QPainterPath transitionGroupShape(const QPointF &offset) const;
     void setItemLocked(bool locked);
     bool isItemLocked() const;
+    /** @brief Returns the clips and transitions of the group and of its subgroups. */
     QList <AbstractClipItem *> childClips() const;
     //    ItemInfo info() const;
 
@@ -74,8 +76,19 @@ protected:
     int posForTrack(int track);
 
 private:
+    /** @brief Clips and transitions of the group and its subgroups, rebuilt after membership changes
+     *  so that moves and collision checks do not walk the item tree */
+    mutable QList <AbstractClipItem *> m_members;
+    /** @brief Members and subgroups, for collision filtering */
+    mutable QSet <QGraphicsItem *> m_memberSet;
+    mutable bool m_membersValid;
     QPainterPath groupShape(GraphicsRectItem type, const QPointF &offset) const;
     QPainterPath spacerGroupShape(GraphicsRectItem type, const QPointF &offset) const;
+    /** @brief Marks the flattened membership of this group and of its parent groups outdated. */
+    void invalidateMembers();
+    void updateMembers() const;
+    /** @brief Removes this group and its members from items. */
+    void removeMembers(QList<QGraphicsItem*> &items) const;
 };
 
 #endif
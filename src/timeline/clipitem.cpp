@@ -37,12 +37,16 @@
 #include <QIcon>
 #include <QtConcurrent>
 #include <QPainter>
+#include <QPixmapCache>
+#include <QtMath>
 #include <QTimer>
 #include <QStyleOptionGraphicsItem>
 #include <QGraphicsScene>
 #include <QMimeData>
 
 static int FRAME_SIZE;
+// Width in pixels of the cached thumbnail and audio tiles
+#define TILE_WIDTH 256
 
 ClipItem::ClipItem(ProjectClip *clip, const ItemInfo& info, double fps, double speed, int strobe, int frame_width, bool generateThumbs) :
     AbstractClipItem(info, QRectF(), fps),
@@ -108,6 +112,7 @@ ClipItem::ClipItem(ProjectClip *clip, const ItemInfo& info, double fps, double s
         m_baseColor = QColor(141, 215, 166);
     }
     connect(m_binClip, SIGNAL(gotAudioData()), this, SLOT(slotGotAudioData()));
+    connect(m_binClip, &ProjectClip::audioLevelsReady, this, &ClipItem::slotGotAudioLevels);
     m_paintColor = m_baseColor;
 }
 
@@ -377,6 +382,14 @@ void ClipItem::refreshClip(bool checkDuration, bool forceResetThumbs)
     }
 }
 
+void ClipItem::prefetchThumbs()
+{
+    // Requested thumbnails are on their way, do not queue them twice
+    if ((m_startPix.isNull() && !m_startThumbRequested) || (m_endPix.isNull() && !m_endThumbRequested)) {
+        slotFetchThumbs();
+    }
+}
+
 void ClipItem::slotFetchThumbs()
 {
     if (scene() == NULL || m_clipType == Audio || m_clipType == Color) return;
@@ -448,7 +461,8 @@ void ClipItem::slotSetEndThumb(const QImage &img)
 void ClipItem::slotThumbReady(int frame, const QImage &img)
 {
     if (scene() == NULL) return;
-    if (m_startThumbRequested && frame == m_speedIndependantInfo.cropStart.frames(m_fps)) {
+    // Unrequested frames are accepted too, they refine a keyframe preview
+    if (frame == m_speedIndependantInfo.cropStart.frames(m_fps)) {
         QRectF r = boundingRect();
 	QPixmap pix = QPixmap::fromImage(img);
 	double width = FRAME_SIZE / projectScene()->scale().x() * projectScene()->scale().y();
@@ -458,7 +472,7 @@ void ClipItem::slotThumbReady(int frame, const QImage &img)
         if (m_clipType == Image || m_clipType == Text || m_clipType == QText || m_clipType == TextTemplate) {
             update(r.right() - width, r.top(), width, pix.height());
         }
-    } else if (m_endThumbRequested && frame == (m_speedIndependantInfo.cropStart + m_speedIndependantInfo.cropDuration).frames(m_fps) - 1) {
+    } else if (frame == (m_speedIndependantInfo.cropStart + m_speedIndependantInfo.cropDuration).frames(m_fps) - 1) {
         QRectF r = boundingRect();
 	QPixmap pix = QPixmap::fromImage(img);
         double width = FRAME_SIZE / projectScene()->scale().x() * projectScene()->scale().y();
@@ -501,6 +515,23 @@ void ClipItem::slotGotAudioData()
     } else update();
 }
 
+void ClipItem::slotGotAudioLevels(int startFrame, int endFrame)
+{
+    m_audioThumbReady = true;
+    // Only repaint the part of the clip whose levels were just extracted
+    const int cropStart = m_info.cropStart.frames(m_fps);
+    QRectF r = boundingRect();
+    r.setLeft(qMax(r.left(), (qreal) startFrame - cropStart));
+    r.setRight(qMin(r.right(), (qreal) endFrame - cropStart + 1));
+    if (r.width() <= 0) {
+        return;
+    }
+    if (m_clipType == AV && m_clipState != PlaylistState::AudioOnly) {
+        r.setTop(r.top() + r.height() / 2 - 1);
+    }
+    update(r);
+}
+
 int ClipItem::type() const
 {
     return AVWidget;
@@ -555,47 +586,32 @@ void ClipItem::animate(qreal /*value*/)
 }
 
 // virtual
-void ClipItem::paint(QPainter *painter,
-                     const QStyleOptionGraphicsItem *option,
-                     QWidget *)
+QColor ClipItem::lightweightColor() const
 {
-    QPalette palette = scene()->palette();
     QColor paintColor = m_paintColor;
-    QColor textColor;
-    QColor textBgColor;
-    QPen framePen;
     if (isSelected() || (parentItem() && parentItem()->isSelected())) {
-        textColor = palette.highlightedText().color();
-        textBgColor = palette.highlight().color();
-        framePen.setColor(textBgColor);
         paintColor.setRed(qMin(paintColor.red() * 2, 255));
     }
-    else {
-        textColor = palette.text().color();
-        textBgColor = palette.window().color();
-        textBgColor.setAlpha(200);
-        framePen.setColor(m_paintColor.darker());
-    }
-    const QRectF exposed = option->exposedRect;
-    const QTransform transformation = painter->worldTransform();
-    const QRectF mappedExposed = transformation.mapRect(exposed);
-    const QRectF mapped = transformation.mapRect(rect());
-    painter->setWorldMatrixEnabled(false);
-    QPainterPath p;
-    p.addRect(mappedExposed);
-    QPainterPath q;
-    if (KdenliveSettings::clipcornertype() == 0) {
-        q.addRoundedRect(mapped, 3, 3);
-    } else {
-        q.addRect(mapped);
-    }
-    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, false);
-    painter->setClipPath(p.intersected(q));
-    painter->setPen(Qt::NoPen);
-    painter->fillRect(mappedExposed, paintColor);
-    painter->setPen(m_paintColor.darker());
     if (m_clipState == PlaylistState::Disabled)
-        painter->setOpacity(0.3);
+        paintColor.setAlpha(80);
+    return paintColor;
+}
+
+QString ClipItem::tileKey(int tile, double scale, int height) const
+{
+    // Everything the tile content depends on, so that a cached tile never needs explicit invalidation
+    int flags = (KdenliveSettings::videothumbnails() ? 1 : 0) | (KdenliveSettings::audiothumbnails() ? 2 : 0) | (KdenliveSettings::displayallchannels() ? 4 : 0);
+    int ready = m_audioThumbReady ? m_binClip->audioLevels().frames() : -1;
+    QStringList key;
+    key << m_binClip->clipId() << QString::number(m_info.cropStart.frames(m_fps)) << QString::number(m_info.cropDuration.frames(m_fps));
+    key << QString::number(scale) << QString::number(height) << QString::number(tile);
+    key << QString::number(m_startPix.cacheKey()) << QString::number(m_endPix.cacheKey()) << QString::number(ready);
+    key << QString::number(flags) << QString::number((int) m_clipState) << QString::number(m_speed) << QString::number(m_paintColor.rgb());
+    return key.join(QLatin1Char('#'));
+}
+
+void ClipItem::paintContent(QPainter *painter, const QRectF &exposed, const QRectF &mapped, const QTransform &transformation, bool *complete)
+{
     // draw thumbnails
     if (KdenliveSettings::videothumbnails() && m_clipState != PlaylistState::AudioOnly && m_originalClipState != PlaylistState::AudioOnly) {
         QRectF thumbRect;
@@ -642,13 +658,15 @@ void ClipItem::paint(QPainter *painter,
                     painter->drawLine(xpos, xpos + QPointF(0, mapped.height()));
                 }
                 if (!missing.isEmpty()) {
+                    *complete = false;
                     m_binClip->slotQueryIntraThumbs(missing.toList());
                 }
             }
         }
     }
     // draw audio thumbnails
-    if (KdenliveSettings::audiothumbnails() && m_speed == 1.0 && m_clipState != PlaylistState::VideoOnly && m_originalClipState != PlaylistState::VideoOnly && (((m_clipType == AV || m_clipType == Playlist) && (exposed.bottom() > (rect().height() / 2) || m_originalClipState == PlaylistState::AudioOnly || m_clipState == PlaylistState::AudioOnly)) || m_clipType == Audio) && m_audioThumbReady && !m_binClip->audioFrameCache.isEmpty()) {
+    if (KdenliveSettings::audiothumbnails() && m_speed == 1.0 && m_clipState != PlaylistState::VideoOnly && m_originalClipState != PlaylistState::VideoOnly && (((m_clipType == AV || m_clipType == Playlist) && (exposed.bottom() > (rect().height() / 2) || m_originalClipState == PlaylistState::AudioOnly || m_clipState == PlaylistState::AudioOnly)) || m_clipType == Audio) && m_audioThumbReady && !m_binClip->audioLevels().isEmpty()) {
+        const AudioLevels audioLevels = m_binClip->audioLevels();
         int startpixel = qMax(0, (int) exposed.left());
         int endpixel = qMax(0, (int) (exposed.right() + 0.5) + 1);
         QRectF mappedRect = mapped;
@@ -665,7 +683,13 @@ void ClipItem::paint(QPainter *painter,
         if (scale < 1) {
             offset = (int) (1.0 / scale);
         }
-        int audioLevelCount = m_binClip->audioFrameCache.count() - 1;
+        // When zoomed out, read the peak of all frames covered by a pixel
+        int peakLevel = AudioLevels::pyramidLevel(scale);
+        // Levels of a clip still being extracted only cover its first frames
+        const int readyFrames = audioLevels.frames();
+        if (endpixel + cropLeft > readyFrames) {
+            *complete = false;
+        }
         if (!KdenliveSettings::displayallchannels()) {
             // simplified audio
             int channelHeight = mappedRect.height();
@@ -675,10 +699,10 @@ void ClipItem::paint(QPainter *painter,
                 // Pixels are smaller than a frame, draw using painterpath
                 QPainterPath positiveChannelPath;
                 positiveChannelPath.moveTo(startx, mappedRect.bottom());
-                for (; i < endpixel + cropLeft + offset; i += offset) {
-                    double value = m_binClip->audioFrameCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
+                for (; i < qMin(endpixel + cropLeft + offset, readyFrames); i += offset) {
+                    double value = (double) audioLevels.at(i * channels) / 256;
                     for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
+                        value = qMax(value, (double) audioLevels.at(i * channels + channel) / 256);
                     }
                     positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - (value * channelHeight));
                 }
@@ -692,9 +716,12 @@ void ClipItem::paint(QPainter *painter,
                 i = startx;
                 for (; i < endx; i++) {
                     int framePos = startOffset + ((i - startx) / scale);
-                    double value = m_binClip->audioFrameCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
+                    if (framePos >= readyFrames) {
+                        break;
+                    }
+                    double value = (double) audioLevels.peak(peakLevel, framePos, 0) / 256;
                     for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
+                        value = qMax(value, (double) audioLevels.peak(peakLevel, framePos, channel) / 256);
                     }
                     painter->drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
                 }
@@ -716,8 +743,8 @@ void ClipItem::paint(QPainter *painter,
                     // Draw channel median line
                     i = startOffset;
                     painter->drawLine(startx, mappedRect.bottom() - y, endx, mappedRect.bottom() - y);
-                    for (; i < endpixel + cropLeft + offset; i += offset) {
-                        value = m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
+                    for (; i < qMin(endpixel + cropLeft + offset, readyFrames); i += offset) {
+                        value = (double) audioLevels.at(i * channels + channel) / 256 * channelHeight / 2;
                         positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y - value);
                         negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y + value);
                     }
@@ -742,9 +769,12 @@ void ClipItem::paint(QPainter *painter,
                 painter->setPen(QColor(80, 80, 150, 200));
                 for (; i < endx; i++) {
                     int framePos = startOffset + ((i - startx) / scale);
+                    if (framePos >= readyFrames) {
+                        break;
+                    }
                     for (int channel = 0; channel < channels; channel ++) {
                         int y = channelHeight * channel + channelHeight / 2;
-                        value = m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
+                        value = (double) audioLevels.peak(peakLevel, framePos, channel) / 256 * channelHeight / 2;
                         painter->drawLine(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
                     }
                 }
@@ -752,6 +782,79 @@ void ClipItem::paint(QPainter *painter,
         }
         painter->setPen(QPen());
     }
+}
+
+void ClipItem::paint(QPainter *painter,
+                     const QStyleOptionGraphicsItem *option,
+                     QWidget *)
+{
+    // Narrow clips are drawn in one pass by CustomTrackView::drawBackground
+    if (isLightweight(painter->worldTransform()))
+        return;
+    QPalette palette = scene()->palette();
+    QColor paintColor = m_paintColor;
+    QColor textColor;
+    QColor textBgColor;
+    QPen framePen;
+    if (isSelected() || (parentItem() && parentItem()->isSelected())) {
+        textColor = palette.highlightedText().color();
+        textBgColor = palette.highlight().color();
+        framePen.setColor(textBgColor);
+        paintColor.setRed(qMin(paintColor.red() * 2, 255));
+    }
+    else {
+        textColor = palette.text().color();
+        textBgColor = palette.window().color();
+        textBgColor.setAlpha(200);
+        framePen.setColor(m_paintColor.darker());
+    }
+    const QRectF exposed = option->exposedRect;
+    const QTransform transformation = painter->worldTransform();
+    const QRectF mappedExposed = transformation.mapRect(exposed);
+    const QRectF mapped = transformation.mapRect(rect());
+    painter->setWorldMatrixEnabled(false);
+    QPainterPath p;
+    p.addRect(mappedExposed);
+    QPainterPath q;
+    if (KdenliveSettings::clipcornertype() == 0) {
+        q.addRoundedRect(mapped, 3, 3);
+    } else {
+        q.addRect(mapped);
+    }
+    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, false);
+    painter->setClipPath(p.intersected(q));
+    painter->setPen(Qt::NoPen);
+    painter->fillRect(mappedExposed, paintColor);
+    painter->setPen(m_paintColor.darker());
+    if (m_clipState == PlaylistState::Disabled)
+        painter->setOpacity(0.3);
+    // draw thumbnails and audio from cached tiles
+    if (mappedExposed.width() > 0 && mapped.height() > 0) {
+        const qreal left = qFloor(mapped.left());
+        const int firstTile = (int) ((mappedExposed.left() - left) / TILE_WIDTH);
+        const int lastTile = (int) ((mappedExposed.right() - left) / TILE_WIDTH);
+        const QTransform inverted = transformation.inverted();
+        for (int tile = firstTile; tile <= lastTile; ++tile) {
+            QRectF tileRect(left + tile * TILE_WIDTH, qFloor(mapped.top()), TILE_WIDTH, qCeil(mapped.height()));
+            const QString key = tileKey(tile, transformation.m11(), tileRect.height());
+            QPixmap pix;
+            if (!QPixmapCache::find(key, &pix)) {
+                pix = QPixmap(TILE_WIDTH, tileRect.height());
+                pix.fill(Qt::transparent);
+                QPainter tilePainter(&pix);
+                tilePainter.translate(-tileRect.topLeft());
+                tilePainter.setPen(m_paintColor.darker());
+                bool complete = true;
+                paintContent(&tilePainter, inverted.mapRect(tileRect), mapped, transformation, &complete);
+                tilePainter.end();
+                // Tiles waiting for thumbnails or audio levels will be painted again
+                if (complete) {
+                    QPixmapCache::insert(key, pix);
+                }
+            }
+            painter->drawPixmap(tileRect.topLeft(), pix);
+        }
+    }
     if (m_clipState == PlaylistState::Disabled)
         painter->setOpacity(1);
     if (m_isMainSelectedClip) {
@@ -1265,7 +1368,7 @@ QVariant ClipItem::itemChange(GraphicsItemChange change, const QVariant &value)
         if (parent) m_paintColor = m_baseColor.lighter(135);
         else m_paintColor = m_baseColor;
     }
-    return QGraphicsItem::itemChange(change, value);
+    return AbstractClipItem::itemChange(change, value);
 }
 
 int ClipItem::effectsCounter()
@@ -1938,6 +2041,7 @@ bool ClipItem::isSplittable() const
 
 void ClipItem::updateState(const QString &id, int aIndex, int vIndex, PlaylistState::ClipState originalState)
 {
+    m_producerKey = makeProducerKey(id, aIndex, vIndex);
     bool disabled = false;
     if (m_clipType == AV || m_clipType == Playlist) {
         disabled = (aIndex == -1 && vIndex == -1);
@@ -1965,6 +2069,17 @@ void ClipItem::updateState(const QString &id, int aIndex, int vIndex, PlaylistSt
     }
 }
 
+const QString &ClipItem::producerKey() const
+{
+    return m_producerKey;
+}
+
+//static
+QString ClipItem::makeProducerKey(const QString &id, int aIndex, int vIndex)
+{
+    return id + QLatin1Char(':') + QString::number(aIndex) + QLatin1Char(':') + QString::number(vIndex);
+}
+
 void ClipItem::slotUpdateThumb(QImage img)
 {
     m_startPix = QPixmap::fromImage(img);
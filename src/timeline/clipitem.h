@@ -53,12 +53,15 @@ public:
                        const QStyleOptionGraphicsItem *option,
                        QWidget *);
     virtual int type() const;
+    QColor lightweightColor() const;
     void resizeStart(int posx, bool size = true, bool emitChange = true);
     void resizeEnd(int posx, bool emitChange = true);
     OperationType operationMode(const QPointF &pos, Qt::KeyboardModifiers modifiers);
     void updateKeyframes(QDomElement effect);
     static int itemHeight();
     ClipType clipType() const;
+    /** @brief Requests the start and end thumbnails if they are missing and not requested yet. */
+    void prefetchThumbs();
     const QString &getBinId() const;
     const QString getBinHash() const;
     ProjectClip *binClip() const;
@@ -166,6 +169,10 @@ public:
     QPixmap endThumb() const;
     void setState(PlaylistState::ClipState state);
     void updateState(const QString &id, int aIndex, int vIndex, PlaylistState::ClipState originalState);
+    /** @brief Returns the key of the MLT producer and streams this item was loaded from, see updateState(). */
+    const QString &producerKey() const;
+    /** @brief Builds the producer key for an MLT producer id and its audio / video stream indexes. */
+    static QString makeProducerKey(const QString &id, int aIndex, int vIndex);
 
     bool updateNormalKeyframes(QDomElement parameter, ItemInfo oldInfo);
 
@@ -215,6 +222,7 @@ private:
     int m_endFade;
     PlaylistState::ClipState m_clipState;
     PlaylistState::ClipState m_originalClipState;
+    QString m_producerKey;
     QColor m_baseColor;
     QColor m_paintColor;
 
@@ -238,10 +246,18 @@ private:
     bool m_audioThumbReady;
     double m_framePixelWidth;
 
+    /** @brief Returns the pixmap cache key of a thumbnail / audio tile of this clip. */
+    QString tileKey(int tile, double scale, int height) const;
+    /** @brief Paints thumbnails and audio thumbnails of the exposed part of the clip, in device coordinates.
+     *  @param complete set to false if some content is not available yet */
+    void paintContent(QPainter *painter, const QRectF &exposed, const QRectF &mapped, const QTransform &transformation, bool *complete);
+
 private slots:
     void slotGetStartThumb();
     void slotGetEndThumb();
     void slotGotAudioData();
+    /** @brief Repaints the frames of the clip whose audio levels were extracted. */
+    void slotGotAudioLevels(int startFrame, int endFrame);
     void animate(qreal value);
     void slotSetStartThumb(const QImage &img);
     void slotSetEndThumb(const QImage &img);
@@ -53,6 +53,12 @@ static int mediumMarkDistance;
 static int bigMarkDistance;
 
 #define SEEK_INACTIVE (-1)
+// Maximum number of time labels kept between two paint events
+#define MAX_CACHED_LABELS 500
+// Width in pixels of the cached ruler tiles
+#define RULER_TILE_WIDTH 512
+// Maximum number of cached ruler tiles
+#define MAX_RULER_TILES 16
 
 #include "definitions.h"
 
@@ -68,7 +74,9 @@ CustomRuler::CustomRuler(const Timecode &tc, const QList<QAction *> &rulerAction
         m_headPosition(SEEK_INACTIVE),
         m_clickedGuide(-1),
         m_rate(-1),
-        m_mouseMove(NO_MOVE)
+        m_mouseMove(NO_MOVE),
+        m_frameLabels(false),
+        m_previewStripOffset(0)
 {
     setFont(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont));
     QFontMetricsF fontMetrics(font());
@@ -106,12 +114,157 @@ CustomRuler::CustomRuler(const Timecode &tc, const QList<QAction *> &rulerAction
 void CustomRuler::updateProjectFps(const Timecode &t)
 {
     m_timecode = t;
+    m_labels.clear();
+    clearTiles();
     mediumMarkDistance = FRAME_SIZE * m_timecode.fps();
     bigMarkDistance = FRAME_SIZE * m_timecode.fps() * 60;
     setPixelPerMark(m_rate);
     update();
 }
 
+const QString &CustomRuler::timeLabel(int frame)
+{
+    if (m_frameLabels != KdenliveSettings::frametimecode() || m_labels.count() > MAX_CACHED_LABELS) {
+        m_frameLabels = KdenliveSettings::frametimecode();
+        m_labels.clear();
+    }
+    QHash <int, QString>::iterator it = m_labels.find(frame);
+    if (it == m_labels.end()) {
+        it = m_labels.insert(frame, m_frameLabels ? QString::number(frame) : m_timecode.getTimecodeFromFrames(frame));
+    }
+    return it.value();
+}
+
+void CustomRuler::clearTiles()
+{
+    m_tiles.clear();
+    m_previewStrip = QPixmap();
+}
+
+void CustomRuler::invalidatePreviewStrip()
+{
+    m_previewStrip = QPixmap();
+}
+
+void CustomRuler::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::PaletteChange || event->type() == QEvent::FontChange) {
+        clearTiles();
+    }
+    QWidget::changeEvent(event);
+}
+
+const QPixmap &CustomRuler::tile(int index)
+{
+    QHash <int, QPixmap>::const_iterator it = m_tiles.constFind(index);
+    if (it != m_tiles.constEnd()) {
+        return it.value();
+    }
+    if (m_tiles.count() >= MAX_RULER_TILES) {
+        m_tiles.clear();
+    }
+    const int ratio = devicePixelRatio();
+    QPixmap pix(RULER_TILE_WIDTH * ratio, (MAX_HEIGHT + 1) * ratio);
+    pix.setDevicePixelRatio(ratio);
+    pix.fill(Qt::transparent);
+    QPainter p(&pix);
+    p.setFont(font());
+    drawMarks(p, index * RULER_TILE_WIDTH, RULER_TILE_WIDTH);
+    p.end();
+    return m_tiles.insert(index, pix).value();
+}
+
+void CustomRuler::drawMarks(QPainter &p, int origin, int width)
+{
+    double f, fend;
+    const int offsetmax = ((origin + width - 1) / FRAME_SIZE + 1) * FRAME_SIZE;
+    int offsetmin;
+
+    p.setPen(palette().text().color());
+    // draw time labels, starting with the one that may overlap from the previous tile
+    offsetmin = origin / m_textSpacing;
+    offsetmin = offsetmin * m_textSpacing - m_textSpacing;
+    for (f = offsetmin; f < offsetmax; f += m_textSpacing) {
+        if (f < 0) continue;
+        p.drawText(f - origin + 2, LABEL_SIZE, timeLabel((int)(f / m_factor + 0.5)));
+    }
+    p.setPen(palette().dark().color());
+    offsetmin = origin / littleMarkDistance;
+    offsetmin = offsetmin * littleMarkDistance;
+    // draw the little marks
+    fend = m_scale * littleMarkDistance;
+    if (fend > 5) {
+        QLineF l(offsetmin - origin, LITTLE_MARK_X, offsetmin - origin, MAX_HEIGHT);
+        for (f = offsetmin; f < offsetmax; f += fend) {
+            l.translate(fend, 0);
+            p.drawLine(l);
+        }
+    }
+
+    offsetmin = origin / mediumMarkDistance;
+    offsetmin = offsetmin * mediumMarkDistance;
+    // draw medium marks
+    fend = m_scale * mediumMarkDistance;
+    if (fend > 5) {
+        QLineF l(offsetmin - origin - fend, MIDDLE_MARK_X, offsetmin - origin - fend, MAX_HEIGHT);
+        for (f = offsetmin - fend; f < offsetmax + fend; f += fend) {
+            l.translate(fend, 0);
+            p.drawLine(l);
+        }
+    }
+
+    offsetmin = origin / bigMarkDistance;
+    offsetmin = offsetmin * bigMarkDistance;
+    // draw big marks
+    fend = m_scale * bigMarkDistance;
+    if (fend > 5) {
+        QLineF l(offsetmin - origin, LABEL_SIZE, offsetmin - origin, MAX_HEIGHT);
+        for (f = offsetmin; f < offsetmax; f += fend) {
+            l.translate(fend, 0);
+            p.drawLine(l);
+        }
+    }
+}
+
+void CustomRuler::drawPreviewStrip()
+{
+    const int ratio = devicePixelRatio();
+    m_previewStrip = QPixmap(width() * ratio, (PREVIEW_SIZE + 1) * ratio);
+    m_previewStrip.setDevicePixelRatio(ratio);
+    m_previewStripOffset = m_offset;
+    const QRect paintRect(0, MAX_HEIGHT, width(), PREVIEW_SIZE + 1);
+    QPainter p(&m_previewStrip);
+    p.translate(0, -MAX_HEIGHT);
+    p.setPen(palette().dark().color());
+    p.drawLine(paintRect.left(), MAX_HEIGHT, paintRect.right(), MAX_HEIGHT);
+    p.fillRect(paintRect.left(), MAX_HEIGHT + 1, paintRect.width(), PREVIEW_SIZE - 1, palette().mid().color());
+    QColor preview(Qt::green);
+    preview.setAlpha(120);
+    double chunkWidth = KdenliveSettings::timelinechunks() * m_factor;
+    foreach(int frame, m_renderingPreviews) {
+        double xPos = frame * m_factor  - m_offset;
+        if (xPos + chunkWidth < paintRect.x() || xPos > paintRect.right())
+            continue;
+        QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth, PREVIEW_SIZE - 1);
+        p.fillRect(rec, preview);
+    }
+    preview = QColor(200, 0, 0);
+    preview.setAlpha(120);
+    QColor draft(230, 160, 0);
+    draft.setAlpha(120);
+    foreach(int frame, m_dirtyRenderingPreviews) {
+        double xPos = frame * m_factor  - m_offset;
+        if (xPos + chunkWidth < paintRect.x() || xPos > paintRect.right())
+            continue;
+        QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth, PREVIEW_SIZE - 1);
+        p.fillRect(rec, m_draftRenderingPreviews.contains(frame) ? draft : preview);
+    }
+    preview = palette().dark().color();
+    preview.setAlpha(70);
+    p.fillRect(paintRect.left(), MAX_HEIGHT + 1, paintRect.width(), 2, preview);
+    p.drawLine(paintRect.left(), MAX_HEIGHT + PREVIEW_SIZE, paintRect.right(), MAX_HEIGHT + PREVIEW_SIZE);
+}
+
 void CustomRuler::updateFrameSize()
 {
     FRAME_SIZE = m_view->getFrameWidth();
@@ -318,6 +471,7 @@ void CustomRuler::setPixelPerMark(int rate, bool force)
     if (rate < 0 || (rate == m_rate && !force)) return;
     int scale = comboScale[rate];
     m_rate = rate;
+    clearTiles();
     m_factor = 1.0 / (double) scale * FRAME_SIZE;
     m_scale = 1.0 / (double) scale;
     double fend = m_scale * littleMarkDistance;
@@ -410,60 +564,16 @@ void CustomRuler::paintEvent(QPaintEvent *e)
     int zoneHeight = LABEL_SIZE * 0.8;
     p.fillRect(zoneStart - m_offset, MAX_HEIGHT - zoneHeight + 1, zoneEnd - zoneStart, zoneHeight - 1, m_zoneBG);
 
-    double f, fend;
-    const int offsetmax = ((paintRect.right() + m_offset) / FRAME_SIZE + 1) * FRAME_SIZE;
-    int offsetmin;
-
-    p.setPen(palette().text().color());
-    // draw time labels
-    if (paintRect.y() < LABEL_SIZE) {
-        offsetmin = (paintRect.left() + m_offset) / m_textSpacing;
-        offsetmin = offsetmin * m_textSpacing;
-        for (f = offsetmin; f < offsetmax; f += m_textSpacing) {
-            QString lab;
-            if (KdenliveSettings::frametimecode())
-                lab = QString::number((int)(f / m_factor + 0.5));
-            else
-                lab = m_timecode.getTimecodeFromFrames((int)(f / m_factor + 0.5));
-            p.drawText(f - m_offset + 2, LABEL_SIZE, lab);
-        }
+    // Marks and labels only depend on the scale, they are painted from the cached tiles
+    if (m_frameLabels != KdenliveSettings::frametimecode()) {
+        clearTiles();
     }
-    p.setPen(palette().dark().color());
-    offsetmin = (paintRect.left() + m_offset) / littleMarkDistance;
-    offsetmin = offsetmin * littleMarkDistance;
-    // draw the little marks
-    fend = m_scale * littleMarkDistance;
-    if (fend > 5) {
-        QLineF l(offsetmin - m_offset, LITTLE_MARK_X, offsetmin - m_offset, MAX_HEIGHT);
-        for (f = offsetmin; f < offsetmax; f += fend) {
-            l.translate(fend, 0);
-            p.drawLine(l);
-        }
-    }
-
-    offsetmin = (paintRect.left() + m_offset) / mediumMarkDistance;
-    offsetmin = offsetmin * mediumMarkDistance;
-    // draw medium marks
-    fend = m_scale * mediumMarkDistance;
-    if (fend > 5) {
-        QLineF l(offsetmin - m_offset - fend, MIDDLE_MARK_X, offsetmin - m_offset - fend, MAX_HEIGHT);
-        for (f = offsetmin - fend; f < offsetmax + fend; f += fend) {
-            l.translate(fend, 0);
-            p.drawLine(l);
-        }
-    }
-
-    offsetmin = (paintRect.left() + m_offset) / bigMarkDistance;
-    offsetmin = offsetmin * bigMarkDistance;
-    // draw big marks
-    fend = m_scale * bigMarkDistance;
-    if (fend > 5) {
-        QLineF l(offsetmin - m_offset, LABEL_SIZE, offsetmin - m_offset, MAX_HEIGHT);
-        for (f = offsetmin; f < offsetmax; f += fend) {
-            l.translate(fend, 0);
-            p.drawLine(l);
-        }
+    const int firstTile = (paintRect.left() + m_offset) / RULER_TILE_WIDTH;
+    const int lastTile = (paintRect.right() + m_offset) / RULER_TILE_WIDTH;
+    for (int i = firstTile; i <= lastTile; ++i) {
+        p.drawPixmap(i * RULER_TILE_WIDTH - m_offset, 0, tile(i));
     }
+    p.setPen(palette().dark().color());
     // draw zone handles
     if (zoneStart > 0) {
         QPolygon pa(4);
@@ -483,34 +593,12 @@ void CustomRuler::paintEvent(QPaintEvent *e)
         p.drawPolyline(pa);
     }
 
-    // draw Rendering preview zones
+    // draw Rendering preview zones, only rendered again when the chunks change
     if (!m_hidePreview) {
-        p.setPen(palette().dark().color());
-        p.drawLine(paintRect.left(), MAX_HEIGHT, paintRect.right(), MAX_HEIGHT);
-        p.fillRect(paintRect.left(), MAX_HEIGHT + 1, paintRect.width(), PREVIEW_SIZE - 1, palette().mid().color());
-        QColor preview(Qt::green);
-        preview.setAlpha(120);
-        double chunkWidth = KdenliveSettings::timelinechunks() * m_factor;
-        foreach(int frame, m_renderingPreviews) {
-            double xPos = frame * m_factor  - m_offset;
-            if (xPos + chunkWidth < paintRect.x() || xPos > paintRect.right())
-                continue;
-            QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth, PREVIEW_SIZE - 1);
-            p.fillRect(rec, preview);
-        }
-        preview = QColor(200, 0, 0);
-        preview.setAlpha(120);
-        foreach(int frame, m_dirtyRenderingPreviews) {
-            double xPos = frame * m_factor  - m_offset;
-            if (xPos + chunkWidth < paintRect.x() || xPos > paintRect.right())
-                continue;
-            QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth, PREVIEW_SIZE - 1);
-            p.fillRect(rec, preview);
+        if (m_previewStrip.isNull() || m_previewStripOffset != m_offset || m_previewStrip.width() != width() * devicePixelRatio()) {
+            drawPreviewStrip();
         }
-        preview = palette().dark().color();
-        preview.setAlpha(70);
-        p.fillRect(paintRect.left(), MAX_HEIGHT + 1, paintRect.width(), 2, preview);
-        p.drawLine(paintRect.left(), MAX_HEIGHT + PREVIEW_SIZE, paintRect.right(), MAX_HEIGHT + PREVIEW_SIZE);
+        p.drawPixmap(0, MAX_HEIGHT, m_previewStrip);
     }
 
     if (m_headPosition == m_view->cursorPos()) {
@@ -554,6 +642,7 @@ bool CustomRuler::updatePreview(int frame, bool rendered, bool refresh)
     if (rendered) {
         m_renderingPreviews << frame;
         m_dirtyRenderingPreviews.removeAll(frame);
+        m_draftRenderingPreviews.removeAll(frame);
     } else {
         if (m_renderingPreviews.removeAll(frame) > 0) {
             m_dirtyRenderingPreviews << frame;
@@ -562,6 +651,7 @@ bool CustomRuler::updatePreview(int frame, bool rendered, bool refresh)
     }
     std::sort(m_renderingPreviews.begin(), m_renderingPreviews.end());
     std::sort(m_dirtyRenderingPreviews.begin(), m_dirtyRenderingPreviews.end());
+    invalidatePreviewStrip();
     if (refresh && !m_hidePreview)
         update(frame * m_factor - offset(), MAX_HEIGHT, KdenliveSettings::timelinechunks() * m_factor + 1, PREVIEW_SIZE);
     return result;
@@ -584,6 +674,7 @@ void CustomRuler::hidePreview(bool hide)
 
 void CustomRuler::updatePreviewDisplay(int start, int end)
 {
+    invalidatePreviewStrip();
     if (!m_hidePreview)
         update(start * m_factor - offset(), MAX_HEIGHT, (end - start) * KdenliveSettings::timelinechunks() * m_factor + 1, PREVIEW_SIZE);
 }
@@ -614,6 +705,25 @@ const QList <int> CustomRuler::getDirtyChunks() const
     return m_dirtyRenderingPreviews;
 }
 
+const QList <int> CustomRuler::getDraftChunks() const
+{
+    return m_draftRenderingPreviews;
+}
+
+void CustomRuler::setDraftChunk(int frame, bool draft)
+{
+    if (draft) {
+        if (!m_dirtyRenderingPreviews.contains(frame) || m_draftRenderingPreviews.contains(frame))
+            return;
+        m_draftRenderingPreviews << frame;
+    } else if (m_draftRenderingPreviews.removeAll(frame) == 0) {
+        return;
+    }
+    invalidatePreviewStrip();
+    if (!m_hidePreview)
+        update(frame * m_factor - offset(), MAX_HEIGHT, KdenliveSettings::timelinechunks() * m_factor + 1, PREVIEW_SIZE);
+}
+
 bool CustomRuler::hasPreviewRange() const
 {
     return (!m_dirtyRenderingPreviews.isEmpty() || !m_renderingPreviews.isEmpty());
@@ -623,6 +733,8 @@ void CustomRuler::clearChunks()
 {
     m_renderingPreviews.clear();
     m_dirtyRenderingPreviews.clear();
+    m_draftRenderingPreviews.clear();
+    invalidatePreviewStrip();
     update();
 }
 
@@ -650,10 +762,12 @@ QList <int> CustomRuler::addChunks(QList <int> chunks, bool add)
                 toProcess << frame;
             }
             m_dirtyRenderingPreviews.removeAll(frame);
+            m_draftRenderingPreviews.removeAll(frame);
         }
     }
     std::sort(m_renderingPreviews.begin(), m_renderingPreviews.end());
     std::sort(m_dirtyRenderingPreviews.begin(), m_dirtyRenderingPreviews.end());
+    invalidatePreviewStrip();
     if (!m_hidePreview)
         update(chunks.first() * m_factor - offset(), MAX_HEIGHT, (chunks.last() - chunks.first()) * KdenliveSettings::timelinechunks() * m_factor + 1, PREVIEW_SIZE);
     return toProcess;
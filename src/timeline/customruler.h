@@ -28,6 +28,8 @@
 
 #include <QWidget>
 #include <QPair>
+#include <QHash>
+#include <QPixmap>
 
 #include "timeline/customtrackview.h"
 #include "timecode.h"
@@ -58,6 +60,10 @@ public:
     const QList <int> getProcessedChunks() const;
     /** @brief Returns a list of dirty timeline preview chunks (that need to be generated) */
     const QList <int> getDirtyChunks() const;
+    /** @brief Returns the dirty chunks that are played from a draft render until their final render is done */
+    const QList <int> getDraftChunks() const;
+    /** @brief Mark a dirty chunk as played from a draft render, or not */
+    void setDraftChunk(int frame, bool draft);
     void clearChunks();
     QList <int> addChunks(QList <int> chunks, bool add);
     /** @brief Returns true if a timeline preview zone has already be defined */
@@ -69,6 +75,7 @@ public:
 
 protected:
     void paintEvent(QPaintEvent * /*e*/);
+    void changeEvent(QEvent *event);
     void wheelEvent(QWheelEvent * e);
     void mousePressEvent(QMouseEvent * event);
     void mouseReleaseEvent(QMouseEvent * event);
@@ -101,6 +108,29 @@ private:
     QMenu *m_goMenu;
     QList <int> m_renderingPreviews;
     QList <int> m_dirtyRenderingPreviews;
+    QList <int> m_draftRenderingPreviews;
+    /** @brief Recently painted time labels, indexed by frame */
+    QHash <int, QString> m_labels;
+    /** @brief True if the cached labels are frame numbers instead of timecodes */
+    bool m_frameLabels;
+    /** @brief Returns the time label of frame, from the cache when possible */
+    const QString &timeLabel(int frame);
+    /** @brief Rendered marks and labels, indexed by tile number from the timeline start */
+    QHash <int, QPixmap> m_tiles;
+    /** @brief Rendered timeline preview chunks for the visible width */
+    QPixmap m_previewStrip;
+    /** @brief Ruler offset of m_previewStrip */
+    int m_previewStripOffset;
+    /** @brief Returns the marks and labels of a tile, rendering it if it is not cached */
+    const QPixmap &tile(int index);
+    /** @brief Draws the marks and labels between origin and origin + width, in timeline pixels */
+    void drawMarks(QPainter &p, int origin, int width);
+    /** @brief Renders m_previewStrip for the current offset */
+    void drawPreviewStrip();
+    /** @brief Drops the rendered tiles, to call when the scale, fps or style changes */
+    void clearTiles();
+    /** @brief The preview chunks changed, m_previewStrip has to be rendered again */
+    void invalidatePreviewStrip();
 
 public slots:
     void slotMoveRuler(int newPos);
@@ -40,41 +40,41 @@ double CustomTrackScene::getSnapPointForPos(double pos, bool doSnap)
         double maximumOffset;
         if (m_scale.x() > 3) maximumOffset = 10 / m_scale.x();
         else maximumOffset = 6 / m_scale.x();
-        for (int i = 0; i < m_snapPoints.size(); ++i) {
-            if (qAbs((int)(pos - m_snapPoints.at(i).frames(m_timeline->fps()))) < maximumOffset) {
-                return m_snapPoints.at(i).frames(m_timeline->fps());
+        int snap = m_snapPoints.closestPoint(pos, maximumOffset);
+        double distance = snap < 0 ? maximumOffset : qAbs(pos - snap);
+        // pos + offset snapping to a point means pos snaps to point - offset
+        for (int i = 0; i < m_snapOffsets.count(); ++i) {
+            const int offset = m_snapOffsets.at(i);
+            const int point = m_snapPoints.closestPoint(pos + offset, distance);
+            if (point >= offset) {
+                snap = point - offset;
+                distance = qAbs(pos + offset - point);
             }
-            if (m_snapPoints.at(i).frames(m_timeline->fps()) > pos)
-                break;
+        }
+        if (snap >= 0) {
+            return snap;
         }
     }
-    return GenTime(pos, m_timeline->fps()).frames(m_timeline->fps());
+    // Positions are frames, no need to go through seconds
+    return (int) pos;
 }
 
-void CustomTrackScene::setSnapList(const QList <GenTime>& snaps)
+void CustomTrackScene::setSnapList(const SnapIndex &snaps, const QList <int> &offsets)
 {
     m_snapPoints = snaps;
+    m_snapOffsets = offsets;
 }
 
 GenTime CustomTrackScene::previousSnapPoint(const GenTime &pos) const
 {
-    for (int i = 0; i < m_snapPoints.size(); ++i) {
-        if (m_snapPoints.at(i) >= pos) {
-            if (i == 0) return GenTime();
-            return m_snapPoints.at(i - 1);
-        }
-    }
-    return GenTime();
+    return GenTime(m_snapPoints.previousPoint(pos.frames(m_timeline->fps())), m_timeline->fps());
 }
 
 GenTime CustomTrackScene::nextSnapPoint(const GenTime &pos) const
 {
-    foreach (const GenTime &seekPoint, m_snapPoints) {
-        if (seekPoint > pos) {
-            return seekPoint;
-        }
-    }
-    return pos;
+    const int frame = pos.frames(m_timeline->fps());
+    const int next = m_snapPoints.nextPoint(frame);
+    return next == frame ? pos : GenTime(next, m_timeline->fps());
 }
 
 void CustomTrackScene::setScale(double scale, double vscale)
@@ -109,4 +109,9 @@ TimelineMode::EditMode CustomTrackScene::editMode() const
     return m_editMode;
 }
 
+TrackItemIndex *CustomTrackScene::itemIndex()
+{
+    return &m_itemIndex;
+}
+
 
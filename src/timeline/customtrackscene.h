@@ -31,6 +31,8 @@
 
 #include "gentime.h"
 #include "definitions.h"
+#include "snapindex.h"
+#include "trackitemindex.h"
 
 class Timeline;
 class MltVideoProfile;
@@ -44,7 +46,8 @@ class CustomTrackScene : public QGraphicsScene
 public:
     explicit CustomTrackScene(Timeline *timeline, QObject *parent = 0);
     ~CustomTrackScene();
-    void setSnapList(const QList <GenTime>& snaps);
+    /** @brief Sets the snap points, @param offsets distances from the dragged position that should snap too (frames). */
+    void setSnapList(const SnapIndex &snaps, const QList <int> &offsets = QList <int>());
     GenTime previousSnapPoint(const GenTime &pos) const;
     GenTime nextSnapPoint(const GenTime &pos) const;
     double getSnapPointForPos(double pos, bool doSnap = true);
@@ -54,13 +57,17 @@ public:
     MltVideoProfile profile() const;
     void setEditMode(TimelineMode::EditMode mode);
     TimelineMode::EditMode editMode() const;
+    /** @brief Returns the per track index of clips and transitions. */
+    TrackItemIndex *itemIndex();
     bool isZooming;
 
 private:
     Timeline *m_timeline;
     QPointF m_scale;
     TimelineMode::EditMode m_editMode;
-    QList <GenTime> m_snapPoints;
+    SnapIndex m_snapPoints;
+    QList <int> m_snapOffsets;
+    TrackItemIndex m_itemIndex;
 };
 
 #endif
@@ -34,10 +34,13 @@
 #include "mltcontroller/effectscontroller.h"
 #include "definitions.h"
 #include "kdenlivesettings.h"
+#include "doc/cacheindex.h"
 #include "renderer.h"
 #include "bin/projectclip.h"
 #include "mainwindow.h"
 #include "transitionhandler.h"
+#include "thumbprefetcher.h"
+#include "titler/titlewidget.h"
 #include "project/clipmanager.h"
 #include "utils/KoIconUtils.h"
 #include "effectslist/initeffects.h"
@@ -65,11 +68,13 @@
 #include <QIcon>
 #include <QMouseEvent>
 #include <QGraphicsItem>
+#include <QRubberBand>
 #include <QScrollBar>
 #include <QApplication>
 #include <QMimeData>
 
 #include <QGraphicsDropShadowEffect>
+#include <QOpenGLWidget>
 
 #define SEEK_INACTIVE (-1)
 //#define DEBUG
@@ -96,6 +101,7 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
   , m_visualTip(NULL)
   , m_keyProperties(NULL)
   , m_currentToolManager(NULL)
+  , m_thumbPrefetcher(NULL)
   , m_autoScroll(KdenliveSettings::autoscroll())
   , m_timelineContextMenu(NULL)
   , m_timelineContextClipMenu(NULL)
@@ -110,6 +116,8 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
   , m_deleteGuide(NULL)
   , m_clipTypeGroup(NULL)
   , m_clipDrag(false)
+  , m_snapIndexValid(false)
+  , m_rubberBand(NULL)
   , m_findIndex(0)
   , m_tool(SelectTool)
   , m_copiedItems()
@@ -121,6 +129,7 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
 {
     if (doc) {
         m_commandStack = doc->commandStack();
+        connect(m_commandStack, &QUndoStack::indexChanged, this, &CustomTrackView::invalidateSnapIndex);
     } else {
         m_commandStack = NULL;
     }
@@ -131,7 +140,7 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
     setLineWidth(0);
     //setCacheMode(QGraphicsView::CacheBackground);
     setAutoFillBackground(false);
-    setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    checkViewport();
     setContentsMargins(0, 0, 0, 0);
     KColorScheme scheme(palette().currentColorGroup(), KColorScheme::Window, KSharedConfig::openConfig(KdenliveSettings::colortheme()));
     m_selectedTrackColor = scheme.background(KColorScheme::ActiveBackground ).color();
@@ -154,6 +163,8 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
     verticalScrollBar()->setTracking(true);
     // repaint guides when using vertical scroll
     connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(slotRefreshGuides()));
+    // request thumbnails ahead of horizontal scrolling
+    m_thumbPrefetcher = new ThumbPrefetcher(this);
 
     m_cursorLine = projectscene->addLine(0, 0, 0, m_tracksHeight);
     m_cursorLine->setZValue(1000);
@@ -166,6 +177,7 @@ CustomTrackView::CustomTrackView(KdenliveDoc *doc, Timeline *timeline, CustomTra
 
     connect(m_document->renderer(), SIGNAL(prepareTimelineReplacement(QString)), this, SLOT(slotPrepareTimelineReplacement(QString)), Qt::DirectConnection);
     connect(m_document->renderer(), SIGNAL(replaceTimelineProducer(QString)), this, SLOT(slotReplaceTimelineProducer(QString)), Qt::DirectConnection);
+    connect(m_document->renderer(), SIGNAL(replaceTimelineProducers(QStringList)), this, SLOT(slotReplaceTimelineProducers(QStringList)), Qt::DirectConnection);
     connect(m_document->renderer(), SIGNAL(updateTimelineProducer(QString)), this, SLOT(slotUpdateTimelineProducer(QString)));
     connect(m_document->renderer(), SIGNAL(rendererPosition(int)), this, SLOT(setCursorPos(int)));
     scale(1, 1);
@@ -308,6 +320,24 @@ void CustomTrackView::checkAutoScroll()
     m_autoScroll = KdenliveSettings::autoscroll();
 }
 
+void CustomTrackView::checkViewport()
+{
+    const bool useOpenGL = KdenliveSettings::opengltimeline();
+    if (useOpenGL != (qobject_cast<QOpenGLWidget *>(viewport()) != NULL)) {
+        // The rubber band is a child of the viewport that is about to be replaced
+        delete m_rubberBand;
+        m_rubberBand = NULL;
+        // Clip tiles are cached QPixmaps, so the GL paint engine uploads each
+        // of them once and then draws waveforms and filmstrips from textures
+        setViewport(useOpenGL ? new QOpenGLWidget : new QWidget);
+        viewport()->setMouseTracking(true);
+        viewport()->setAcceptDrops(true);
+        viewport()->setAutoFillBackground(false);
+    }
+    // A GL viewport redraws its whole framebuffer, partial updates only add overhead
+    setViewportUpdateMode(useOpenGL ? QGraphicsView::FullViewportUpdate : QGraphicsView::MinimalViewportUpdate);
+}
+
 int CustomTrackView::getFrameWidth() const
 {
     return (int) (m_tracksHeight * m_document->dar() + 0.5);
@@ -350,6 +380,38 @@ void CustomTrackView::updateSceneFrameWidth(double fpsChanged)
     }
 }
 
+void CustomTrackView::scaleGeometries(double xScale, double yScale)
+{
+    QList<QGraphicsItem *> itemList = items();
+    for (int i = 0; i < itemList.count(); ++i) {
+        if (itemList.at(i)->type() == AVWidget) {
+            ClipItem *clip = static_cast<ClipItem*>(itemList.at(i));
+            for (int ix = 0; ix < clip->effectsCount(); ++ix) {
+                QDomElement effect = clip->effect(ix);
+                if (AbstractClipItem::scaleGeometries(effect, xScale, yScale))
+                    updateEffect(clip->track(), clip->startPos(), effect, false, false, false);
+            }
+        } else if (itemList.at(i)->type() == TransitionWidget) {
+            Transition *tr = static_cast<Transition*>(itemList.at(i));
+            QDomElement xml = tr->toXML().cloneNode().toElement();
+            if (AbstractClipItem::scaleGeometries(xml, xScale, yScale)) {
+                m_timeline->transitionHandler->updateTransition(xml.attribute(QStringLiteral("tag")), xml.attribute(QStringLiteral("tag")), xml.attribute(QStringLiteral("transition_btrack")).toInt(), xml.attribute(QStringLiteral("transition_atrack")).toInt(), tr->startPos(), tr->endPos(), xml);
+                tr->setTransitionParameters(xml);
+            }
+        }
+    }
+    for (int i = 1; i < m_timeline->tracksCount(); ++i) {
+        const EffectsList effects = m_timeline->getTrackEffects(i);
+        for (int ix = 0; ix < effects.count(); ++ix) {
+            QDomElement effect = effects.at(ix).cloneNode().toElement();
+            if (AbstractClipItem::scaleGeometries(effect, xScale, yScale))
+                updateEffect(i, GenTime(-1), effect, false, false, false);
+        }
+    }
+    // Rendered preview chunks have the old frame size
+    monitorRefresh(true);
+}
+
 bool CustomTrackView::checkTrackHeight(bool force)
 {
     if (!force && m_tracksHeight == KdenliveSettings::trackheight() && sceneRect().height() == m_tracksHeight * m_timeline->visibleTracksCount()) return false;
@@ -606,7 +668,12 @@ void CustomTrackView::mouseMoveEvent(QMouseEvent * event)
     }
     if (event->buttons() & Qt::MidButton) return;
     if (m_moveOpMode == RubberSelection) {
-	QGraphicsView::mouseMoveEvent(event);
+        if (scene()->mouseGrabberItem()) {
+            // An item accepted the click, let it handle the drag
+            QGraphicsView::mouseMoveEvent(event);
+        } else {
+            updateRectangleSelection(event->pos());
+        }
         return;
     }
 
@@ -679,9 +746,68 @@ void CustomTrackView::createRectangleSelection(Qt::KeyboardModifiers modifiers)
         }
         scene()->clearSelection();
     }
+    // The selection is updated from the track index instead of the view's scene queries
+    m_rubberOrigin = mapToScene(m_clickEvent);
+    m_rubberSelection.clear();
+    m_rubberTargets.clear();
+    m_rubberInitial = QSet <QGraphicsItem *>::fromList(scene()->selectedItems());
     m_moveOpMode = RubberSelection;
 }
 
+void CustomTrackView::updateRectangleSelection(const QPoint &pos)
+{
+    if (!m_rubberBand) {
+        m_rubberBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+    }
+    m_rubberBand->setGeometry(QRect(mapFromScene(m_rubberOrigin), pos).normalized());
+    m_rubberBand->show();
+
+    const QRectF rect = QRectF(m_rubberOrigin, mapToScene(pos)).normalized();
+    QSet <QGraphicsItem *> hits;
+    // Tracks are numbered from the bottom, transitions may be indexed on a neighbour track
+    const int firstTrack = qMax(1, getTrackFromPos(rect.bottom()) - 1);
+    const int lastTrack = qMin(m_timeline->tracksCount() - 1, getTrackFromPos(rect.top()) + 1);
+    for (int track = firstTrack; track <= lastTrack; ++track) {
+        QList <AbstractClipItem *> candidates = m_scene->itemIndex()->itemsIn(track, AVWidget, rect.left(), rect.right());
+        candidates << m_scene->itemIndex()->itemsIn(track, TransitionWidget, rect.left(), rect.right());
+        foreach(AbstractClipItem *item, candidates) {
+            if (!item->sceneBoundingRect().intersects(rect)) continue;
+            QGraphicsItem *target = m_rubberTargets.value(item);
+            if (!target) {
+                // Selecting a grouped clip selects its group
+                target = item;
+                while (target->parentItem() && target->parentItem()->type() == GroupWidget) {
+                    target = target->parentItem();
+                }
+                m_rubberTargets.insert(item, target);
+            }
+            hits.insert(target);
+        }
+    }
+    // Only the items entering or leaving the rectangle change state
+    foreach(QGraphicsItem *item, m_rubberSelection) {
+        if (!hits.contains(item) && !m_rubberInitial.contains(item)) {
+            item->setSelected(false);
+        }
+    }
+    foreach(QGraphicsItem *item, hits) {
+        if (!m_rubberSelection.contains(item)) {
+            item->setSelected(true);
+        }
+    }
+    m_rubberSelection = hits;
+}
+
+void CustomTrackView::finishRectangleSelection()
+{
+    if (m_rubberBand) {
+        m_rubberBand->hide();
+    }
+    m_rubberSelection.clear();
+    m_rubberInitial.clear();
+    m_rubberTargets.clear();
+}
+
 QList<QGraphicsItem *> CustomTrackView::selectAllItemsToTheRight(int x)
 {
     QRectF r = m_scene->sceneRect();
@@ -1886,22 +2012,11 @@ void CustomTrackView::dragEnterEvent(QDragEnterEvent * event)
 
 bool CustomTrackView::itemCollision(AbstractClipItem *item, const ItemInfo &newPos)
 {
-    QRectF shape = QRectF(newPos.startPos.frames(m_document->fps()), getPositionFromTrack(newPos.track) + 1, (newPos.endPos - newPos.startPos).frames(m_document->fps()) - 0.02, m_tracksHeight - 1);
-    QList<QGraphicsItem*> collindingItems = scene()->items(shape, Qt::IntersectsItemShape);
+    const double start = newPos.startPos.frames(m_document->fps());
+    const double end = start + (newPos.endPos - newPos.startPos).frames(m_document->fps()) - 0.02;
+    QList<AbstractClipItem*> collindingItems = m_scene->itemIndex()->itemsIn(newPos.track, item->type(), start, end);
     collindingItems.removeAll(item);
-    if (collindingItems.isEmpty()) {
-        return false;
-    } else {
-        for (int i = 0; i < collindingItems.count(); ++i) {
-            QGraphicsItem *collision = collindingItems.at(i);
-            if (collision->type() == item->type()) {
-                // Collision
-                //qDebug() << "// COLLISIION DETECTED";
-                return true;
-            }
-        }
-        return false;
-    }
+    return !collindingItems.isEmpty();
 }
 
 void CustomTrackView::slotRefreshEffects(ClipItem *clip)
@@ -2016,6 +2131,8 @@ void CustomTrackView::slotAddGroupEffect(QDomElement effect, AbstractGroupItem *
     if (!namenode.isNull()) effectName = i18n(namenode.text().toUtf8().data());
     else effectName = i18n("effect");
     effectCommand->setText(i18n("Add %1", effectName));
+    // Attach all filters under one timeline lock, with a single monitor refresh and preview invalidation
+    new EditBatchCommand(m_timeline, true, effectCommand);
     for (int i = 0; i < itemList.count(); ++i) {
         if (itemList.at(i)->type() == GroupWidget) {
             itemList << itemList.at(i)->childItems();
@@ -2044,7 +2161,8 @@ void CustomTrackView::slotAddGroupEffect(QDomElement effect, AbstractGroupItem *
             }
         }
     }
-    if (effectCommand->childCount() > 0) {
+    new EditBatchCommand(m_timeline, false, effectCommand);
+    if (effectCommand->childCount() > 2) {
         m_commandStack->push(effectCommand);
     } else delete effectCommand;
     if (dropTarget) {
@@ -2187,6 +2305,8 @@ void CustomTrackView::slotAddEffect(QDomElement effect, const GenTime &pos, int
         }
     }
 
+    // Attach all filters under one timeline lock, with a single monitor refresh and preview invalidation
+    new EditBatchCommand(m_timeline, true, effectCommand);
     for (int i = 0; i < itemList.count(); ++i) {
         if (itemList.at(i)->type() == AVWidget) {
             ClipItem *item = static_cast <ClipItem *>(itemList.at(i));
@@ -2210,7 +2330,8 @@ void CustomTrackView::slotAddEffect(QDomElement effect, const GenTime &pos, int
             else processEffect(item, effect, offset, effectCommand);
         }
     }
-    if (effectCommand->childCount() > 0) {
+    new EditBatchCommand(m_timeline, false, effectCommand);
+    if (effectCommand->childCount() > 2) {
         m_commandStack->push(effectCommand);
     } else delete effectCommand;
 }
@@ -2548,6 +2669,27 @@ void CustomTrackView::slotUpdateClipEffect(ClipItem *clip, int track, QDomElemen
     m_commandStack->push(command);
 }
 
+void CustomTrackView::slotPreviewClipEffect(ClipItem *clip, int track, QDomElement effect)
+{
+    // Speed and keyframe effects need to be rebuilt, they are only updated when the drag ends
+    if (effect.attribute(QStringLiteral("id")) == QLatin1String("speed")) {
+        return;
+    }
+    EffectsParameterList effectParams = EffectsController::getEffectArgs(m_document->getProfileInfo(), effect);
+    if (effectParams.hasParam(QStringLiteral("keyframes"))) {
+        return;
+    }
+    bool refresh = effect.attribute(QStringLiteral("type")) != QLatin1String("audio");
+    if (clip) {
+        if (m_timeline->track(clip->track())->editEffect(clip->startPos().seconds(), effectParams, false) && refresh && clip->hasVisibleVideo()) {
+            // Timeline preview is invalidated once, when the edit is committed
+            monitorRefresh(clip->info(), false);
+        }
+    } else if (m_timeline->track(track)->editTrackEffect(effectParams, false) && refresh) {
+        monitorRefresh(false);
+    }
+}
+
 void CustomTrackView::slotUpdateClipRegion(ClipItem *clip, int ix, QString region)
 {
     QDomElement effect = clip->getEffectAtIndex(ix);
@@ -3219,6 +3361,7 @@ void CustomTrackView::extractZone(QPoint z, bool closeGap, QList <ItemInfo> excl
         masterCommand = new QUndoCommand();
         masterCommand->setText(i18n("Remove Zone"));
     }
+    new EditBatchCommand(m_timeline, true, masterCommand);
 
     if (closeGap) {
         // We are going to move clips that are after zone, so break locked groups first.
@@ -3368,12 +3511,93 @@ void CustomTrackView::extractZone(QPoint z, bool closeGap, QList <ItemInfo> excl
     // Add refresh command for redo
     firstRefresh->updateRange(range);
     new RefreshMonitorCommand(this, range, true, false, masterCommand);
+    new EditBatchCommand(m_timeline, false, masterCommand);
     if (!hasMasterCommand) {
         m_commandStack->push(masterCommand);
     }
     return;
 }
 
+void CustomTrackView::applyAngleSwitches(const QMap <int, int> &switches, const QList <int> &tracks)
+{
+    if (switches.isEmpty()) {
+        return;
+    }
+    double fps = m_document->fps();
+    // Zones removed from each angle track, the switches are sorted by position
+    QMap <int, QList <QPoint> > zones;
+    QList <int> positions = switches.keys();
+    for (int i = 0; i < positions.count(); ++i) {
+        int start = positions.at(i);
+        int end = i + 1 < positions.count() ? positions.at(i + 1) : m_projectDuration;
+        if (end <= start) continue;
+        foreach(int track, tracks) {
+            if (track == switches.value(start) || m_timeline->getTrackInfo(track).isLocked) continue;
+            QList <QPoint> &trackZones = zones[track];
+            if (!trackZones.isEmpty() && trackZones.last().y() == start) {
+                // Track stays unselected, merge with the previous segment
+                trackZones.last().setY(end);
+            } else {
+                trackZones << QPoint(start, end);
+            }
+        }
+    }
+    QUndoCommand *command = new QUndoCommand();
+    command->setText(i18n("Multicam edit"));
+    new EditBatchCommand(m_timeline, true, command);
+    QList <ItemInfo> range;
+    RefreshMonitorCommand *firstRefresh = new RefreshMonitorCommand(this, ItemInfo(), false, true, command);
+    QMapIterator <int, QList <QPoint> > i(zones);
+    while (i.hasNext()) {
+        i.next();
+        int track = i.key();
+        const QList <QPoint> &trackZones = i.value();
+        QRectF rect(trackZones.first().x(), getPositionFromTrack(track) + m_tracksHeight / 2, trackZones.last().y() - trackZones.first().x() - 1, 2);
+        QList<QGraphicsItem *> selection = m_scene->items(rect);
+        for (int j = 0; j < selection.count(); ++j) {
+            if (!selection.at(j)->isEnabled() || selection.at(j)->type() != AVWidget) continue;
+            ClipItem *clip = static_cast<ClipItem *>(selection.at(j));
+            if (clip->track() != track) continue;
+            // The commands are only executed when pushed, so follow the remaining part of the clip after each cut
+            ItemInfo current = clip->info();
+            foreach(const QPoint &zone, trackZones) {
+                GenTime inPoint(zone.x(), fps);
+                GenTime outPoint(zone.y(), fps);
+                if (outPoint <= current.startPos || inPoint >= current.endPos) continue;
+                if (inPoint > current.startPos) {
+                    new RazorClipCommand(this, current, clip->effectList(), inPoint, true, command);
+                    current.cropStart += inPoint - current.startPos;
+                    current.startPos = inPoint;
+                    current.cropDuration = current.endPos - current.startPos;
+                }
+                ItemInfo removed = current;
+                if (outPoint < current.endPos) {
+                    new RazorClipCommand(this, current, clip->effectList(), outPoint, true, command);
+                    removed.endPos = outPoint;
+                    removed.cropDuration = removed.endPos - removed.startPos;
+                    current.cropStart += outPoint - current.startPos;
+                    current.startPos = outPoint;
+                    current.cropDuration = current.endPos - current.startPos;
+                }
+                if (clip->hasVisibleVideo()) {
+                    range << removed;
+                }
+                new AddTimelineClipCommand(this, clip->getBinId(), removed, clip->effectList(), clip->clipState(), true, true, false, command);
+                if (removed.endPos == current.endPos) break;
+            }
+        }
+    }
+    if (command->childCount() == 2) {
+        // Nothing to cut
+        delete command;
+        return;
+    }
+    firstRefresh->updateRange(range);
+    new RefreshMonitorCommand(this, range, true, false, command);
+    new EditBatchCommand(m_timeline, false, command);
+    m_commandStack->push(command);
+}
+
 void CustomTrackView::adjustTimelineTransitions(TimelineMode::EditMode mode, Transition *item, QUndoCommand *command)
 {
     if (mode == TimelineMode::OverwriteEdit) {
@@ -3447,6 +3671,7 @@ int CustomTrackView::duration() const
 
 void CustomTrackView::addTrack(const TrackInfo &type, int ix)
 {
+    m_timeline->releaseFrozenTracks();
     clearSelection();
     emit transitionItemSelected(NULL);
     QList <TransitionInfo> transitionInfos;
@@ -3502,6 +3727,8 @@ void CustomTrackView::reloadTimeline()
     for (int i = 0; i < m_guides.count(); ++i) {
         selection.removeAll(m_guides.at(i));
     }
+    // Removing items one by one from the index is slow, getTracks() restores it
+    m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
     qDeleteAll<>(selection);
     m_timeline->getTracks();
     m_timeline->getTransitions();
@@ -3520,6 +3747,7 @@ void CustomTrackView::reloadTimeline()
 
 void CustomTrackView::removeTrack(int ix)
 {
+    m_timeline->releaseFrozenTracks();
     // Clear effect stack
     clearSelection();
     emit transitionItemSelected(NULL);
@@ -3694,7 +3922,22 @@ void CustomTrackView::lockTrack(int ix, bool lock, bool requestUpdate)
 QList<QGraphicsItem *> CustomTrackView::checkForGroups(const QRectF &rect, bool *ok)
 {
     // Check there is no group going over several tracks there, or that would result in timeline corruption
-    QList<QGraphicsItem *> selection = scene()->items(rect);
+    QList<QGraphicsItem *> selection;
+    const int firstTrack = qMax(1, getTrackFromPos(rect.bottom()) - 1);
+    const int lastTrack = qMin(m_timeline->tracksCount() - 1, getTrackFromPos(rect.top()) + 1);
+    for (int track = firstTrack; track <= lastTrack; ++track) {
+        QList <AbstractClipItem *> candidates = m_scene->itemIndex()->itemsIn(track, AVWidget, rect.left(), rect.right());
+        candidates << m_scene->itemIndex()->itemsIn(track, TransitionWidget, rect.left(), rect.right());
+        foreach(AbstractClipItem *item, candidates) {
+            if (!item->sceneBoundingRect().intersects(rect) || selection.contains(item)) continue;
+            selection << item;
+            // Report the groups met by the rectangle, as the scene query did
+            QGraphicsItem *parent = item->parentItem();
+            if (parent && parent->type() == GroupWidget && !selection.contains(parent)) {
+                selection << parent;
+            }
+        }
+    }
     *ok = true;
     int maxHeight = m_tracksHeight * 1.5;
     for (int i = 0; i < selection.count(); ++i) {
@@ -3862,6 +4105,7 @@ void CustomTrackView::insertTimelineSpace(GenTime startPos, GenTime duration, in
 void CustomTrackView::insertSpace(QList<ItemInfo> clipsToMove, QList<ItemInfo> transToMove, int track, const GenTime &duration, const GenTime &offset)
 {
     int diff = duration.frames(m_document->fps());
+    m_timeline->beginEdits();
     resetSelectionGroup();
     m_selectionMutex.lock();
     m_selectionGroup = new AbstractGroupItem(m_document->fps());
@@ -3941,34 +4185,30 @@ void CustomTrackView::insertSpace(QList<ItemInfo> clipsToMove, QList<ItemInfo> t
         rebuildGroup(grp);
     }
     m_document->renderer()->mltInsertSpace(trackClipStartList, trackTransitionStartList, track, duration, offset);
+    m_timeline->endEdits();
 }
 
 void CustomTrackView::deleteClip(const QString &clipId, QUndoCommand *deleteCommand)
 {
     resetSelectionGroup();
-    QList<QGraphicsItem *> itemList = items();
+    const QList <ClipItem *> clipItems = m_scene->itemIndex()->clipItems(clipId);
     int count = 0;
     QList <ItemInfo> range;
     RefreshMonitorCommand *firstRefresh = new RefreshMonitorCommand(this, ItemInfo(), false, true, deleteCommand);
-    for (int i = 0; i < itemList.count(); ++i) {
-        if (itemList.at(i)->type() == AVWidget) {
-            ClipItem *item = static_cast<ClipItem*>(itemList.at(i));
-            if (item->getBinId() == clipId) {
-                count++;
-                if (item->hasVisibleVideo())
-                    range << item->info();
-                if (item->parentItem()) {
-                    // Clip is in a group, destroy the group
-                    new GroupClipsCommand(this, QList<ItemInfo>() << item->info(), QList<ItemInfo>(), false, true, deleteCommand);
-                }
-                new AddTimelineClipCommand(this, item->getBinId(), item->info(), item->effectList(), item->clipState(), true, true, false, deleteCommand);
-                // Check if it is a title clip with automatic transition, than remove it
-                if (item->clipType() == Text) {
-                    Transition *tr = getTransitionItemAtStart(item->startPos(), item->track());
-                    if (tr && tr->endPos() == item->endPos()) {
-                        new AddTransitionCommand(this, tr->info(), tr->transitionEndTrack(), tr->toXML(), true, true, deleteCommand);
-                    }
-                }
+    foreach(ClipItem *item, clipItems) {
+        count++;
+        if (item->hasVisibleVideo())
+            range << item->info();
+        if (item->parentItem()) {
+            // Clip is in a group, destroy the group
+            new GroupClipsCommand(this, QList<ItemInfo>() << item->info(), QList<ItemInfo>(), false, true, deleteCommand);
+        }
+        new AddTimelineClipCommand(this, item->getBinId(), item->info(), item->effectList(), item->clipState(), true, true, false, deleteCommand);
+        // Check if it is a title clip with automatic transition, than remove it
+        if (item->clipType() == Text) {
+            Transition *tr = getTransitionItemAtStart(item->startPos(), item->track());
+            if (tr && tr->endPos() == item->endPos()) {
+                new AddTransitionCommand(this, tr->info(), tr->transitionEndTrack(), tr->toXML(), true, true, deleteCommand);
             }
         }
     }
@@ -4136,6 +4376,9 @@ void CustomTrackView::mouseReleaseEvent(QMouseEvent * event)
     if (event->modifiers() & Qt::ControlModifier)  {
 	event->ignore();
     }
+    if (m_moveOpMode == RubberSelection) {
+        finishRectangleSelection();
+    }
 
     QGraphicsView::mouseReleaseEvent(event);
     setDragMode(QGraphicsView::NoDrag);
@@ -4373,6 +4616,7 @@ void CustomTrackView::razorGroup(AbstractGroupItem* group, GenTime cutPos)
             return;
         }
         // Process the cut
+        new EditBatchCommand(m_timeline, true, command);
         for (int i = 0; i < clipsToCut.count(); ++i) {
             ClipItem *clip = static_cast<ClipItem *>(clipsToCut.at(i));
             new RazorClipCommand(this, clip->info(), clip->effectList(), cutPos, true, command);
@@ -4387,6 +4631,7 @@ void CustomTrackView::razorGroup(AbstractGroupItem* group, GenTime cutPos)
         }
         new GroupClipsCommand(this, clips1, transitions1, true, true, command);
         new GroupClipsCommand(this, clips2, transitions2, true, true, command);
+        new EditBatchCommand(m_timeline, false, command);
         m_commandStack->push(command);
     }
 }
@@ -4593,7 +4838,7 @@ void CustomTrackView::addClip(const QString &clipId, ItemInfo info, EffectsList
         slowInfo.speed = speed;
         slowInfo.strobe = strobe;
         slowInfo.state = state;
-        Mlt::Producer *copy = m_document->renderer()->getSlowmotionProducer(slowInfo.toString(locale) + url);
+        Mlt::Producer *copy = m_document->renderer()->getSlowmotionProducer(slowInfo.poolKey(clipId, locale));
         if (copy == NULL) {
             url.prepend(locale.toString(speed) + ":");
             Mlt::Properties passProperties;
@@ -4611,6 +4856,9 @@ void CustomTrackView::addClip(const QString &clipId, ItemInfo info, EffectsList
     else if (item->clipState() == PlaylistState::VideoOnly) {
         prod = m_document->renderer()->getBinVideoProducer(clipId);
     }
+    else if (item->clipState() == PlaylistState::AudioOnly) {
+        prod = m_document->renderer()->getBinAudioProducer(clipId);
+    }
     else {
         prod = m_document->renderer()->getBinProducer(clipId);
     }
@@ -4628,29 +4876,22 @@ void CustomTrackView::addClip(const QString &clipId, ItemInfo info, EffectsList
 void CustomTrackView::slotUpdateClip(const QString &clipId, bool reload)
 {
     QMutexLocker locker(&m_mutex);
-    QList<QGraphicsItem *> list = scene()->items();
     QList <ClipItem *>clipList;
-    ClipItem *clip = NULL;
     //TODO: move the track replacement code in track.cpp
     Mlt::Tractor *tractor = m_document->renderer()->lockService();
-    for (int i = 0; i < list.size(); ++i) {
-        if (list.at(i)->type() == AVWidget) {
-            clip = static_cast <ClipItem *>(list.at(i));
-            if (clip->getBinId() == clipId) {
-                //TODO: get audio / video only producers
-                /*ItemInfo info = clip->info();
-                if (clip->isAudioOnly()) prod = baseClip->getTrackProducer(info.track);
-                else if (clip->isVideoOnly()) prod = baseClip->getTrackProducer(info.track);
-                else prod = baseClip->getTrackProducer(info.track);*/
-                if (reload) {
-                    /*Mlt::Producer *prod = m_document->renderer()->getTrackProducer(clipId, info.track, clip->isAudioOnly(), clip->isVideoOnly());
-                    if (!m_document->renderer()->mltUpdateClip(tractor, info, clip->xml(), prod)) {
-                        emit displayMessage(i18n("Cannot update clip (time: %1, track: %2)", info.startPos.frames(m_document->fps()), info.track), ErrorMessage);
-                    }*/
-                }
-                else clipList.append(clip);
-            }
+    foreach(ClipItem *clip, m_scene->itemIndex()->clipItems(clipId)) {
+        //TODO: get audio / video only producers
+        /*ItemInfo info = clip->info();
+        if (clip->isAudioOnly()) prod = baseClip->getTrackProducer(info.track);
+        else if (clip->isVideoOnly()) prod = baseClip->getTrackProducer(info.track);
+        else prod = baseClip->getTrackProducer(info.track);*/
+        if (reload) {
+            /*Mlt::Producer *prod = m_document->renderer()->getTrackProducer(clipId, info.track, clip->isAudioOnly(), clip->isVideoOnly());
+            if (!m_document->renderer()->mltUpdateClip(tractor, info, clip->xml(), prod)) {
+                emit displayMessage(i18n("Cannot update clip (time: %1, track: %2)", info.startPos.frames(m_document->fps()), info.track), ErrorMessage);
+            }*/
         }
+        else clipList.append(clip);
     }
     for (int i = 0; i < clipList.count(); ++i)
         clipList.at(i)->refreshClip(true, true);
@@ -4660,78 +4901,60 @@ void CustomTrackView::slotUpdateClip(const QString &clipId, bool reload)
 ClipItem *CustomTrackView::getClipItemAtEnd(GenTime pos, int track)
 {
     int framepos = (int)(pos.frames(m_document->fps()));
-    QList<QGraphicsItem *> list = scene()->items(QPointF(framepos - 1, getPositionFromTrack(track) + m_tracksHeight / 2));
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, AVWidget, framepos - 1);
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            if (test->endPos() == pos) clip = test;
-            break;
-        }
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->endPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getClipItemAtStart(GenTime pos, int track, GenTime end)
 {
-    QList<QGraphicsItem *> list = scene()->items(QPointF(pos.frames(m_document->fps()), getPositionFromTrack(track) + m_tracksHeight / 2));
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, AVWidget, pos.frames(m_document->fps()));
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) {
-            /*ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            qDebug()<<" * * *DISABLED CLIP: "<<i<<", "<<test->startPos().frames(25);*/
             continue;
         }
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            //qDebug()<<" * * *ENABLED CLIP: "<<i<<", "<<test->startPos().frames(25)<<" = "<<pos.frames(25);
-            if (test->startPos() == pos) {
-              if (end > GenTime()) {
-                  if (test->endPos() != end) {
-                      //qDebug()<<" - - - -- - -NO END MATCH: "<<test->endPos().frames(25)<<" = "<< end.frames(25);
-                      continue;
-                  }
-              }
-	      clip = test;
-	      break;
-	    }
-	}
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->startPos() == pos) {
+            if (end > GenTime() && test->endPos() != end) {
+                continue;
+            }
+            clip = test;
+            break;
+        }
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getMovedClipItem(ItemInfo info, GenTime offset, int trackOffset)
 {
-    QList<QGraphicsItem *> list = scene()->items(QPointF((info.startPos + offset).frames(m_document->fps()), getPositionFromTrack(info.track + trackOffset) + m_tracksHeight / 2));
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(info.track + trackOffset, AVWidget, (info.startPos + offset).frames(m_document->fps()));
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
-        //if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            if (test->startPos() == info.startPos) {
-		if (test->endPos() != info.endPos) {
-		    continue;
-                }
-            }
-	    clip = test;
-	    break;
-	}
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->startPos() == info.startPos && test->endPos() != info.endPos) {
+            continue;
+        }
+        clip = test;
+        break;
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getClipItemAtMiddlePoint(int pos, int track)
 {
-    const QPointF p(pos, getPositionFromTrack(track) + m_tracksHeight / 2);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, AVWidget, pos);
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            clip = static_cast <ClipItem *>(list.at(i));
-            break;
-        }
+        clip = static_cast <ClipItem *>(list.at(i));
+        break;
     }
     return clip;
 }
@@ -4749,17 +4972,14 @@ ClipItem *CustomTrackView::getUpperClipItemAt(int pos)
 
 Transition *CustomTrackView::getTransitionItemAt(int pos, int track, bool alreadyMoved)
 {
-    const QPointF p(pos, getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, TransitionWidget, pos);
     Transition *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!alreadyMoved && !list.at(i)->isEnabled()) {
             continue;
         }
-        if (list.at(i)->type() == TransitionWidget) {
-            clip = static_cast <Transition *>(list.at(i));
-            break;
-        }
+        clip = static_cast <Transition *>(list.at(i));
+        break;
     }
     return clip;
 }
@@ -4772,32 +4992,26 @@ Transition *CustomTrackView::getTransitionItemAt(GenTime pos, int track, bool al
 Transition *CustomTrackView::getTransitionItemAtEnd(GenTime pos, int track)
 {
     int framepos = (int)(pos.frames(m_document->fps()));
-    const QPointF p(framepos - 1, getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, TransitionWidget, framepos - 1);
     Transition *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == TransitionWidget) {
-            Transition *test = static_cast <Transition *>(list.at(i));
-            if (test->endPos() == pos) clip = test;
-            break;
-        }
+        Transition *test = static_cast <Transition *>(list.at(i));
+        if (test->endPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
 
 Transition *CustomTrackView::getTransitionItemAtStart(GenTime pos, int track)
 {
-    const QPointF p(pos.frames(m_document->fps()), getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    const QList<AbstractClipItem *> list = m_scene->itemIndex()->itemsAt(track, TransitionWidget, pos.frames(m_document->fps()));
     Transition *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == TransitionWidget) {
-            Transition *test = static_cast <Transition *>(list.at(i));
-            if (test->startPos() == pos) clip = test;
-            break;
-        }
+        Transition *test = static_cast <Transition *>(list.at(i));
+        if (test->startPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
@@ -4883,6 +5097,8 @@ void CustomTrackView::moveGroup(QList<ItemInfo> startClip, QList<ItemInfo> start
     m_selectionGroup = new AbstractGroupItem(m_document->fps());
     scene()->addItem(m_selectionGroup);
     QList <ItemInfo> range;
+    // Apply all playlist changes as one batch, previews and monitor are updated once at the end
+    m_timeline->beginEdits();
     m_document->renderer()->blockSignals(true);
     for (int i = 0; i < startClip.count(); ++i) {
         if (reverseMove) {
@@ -4992,6 +5208,9 @@ void CustomTrackView::moveGroup(QList<ItemInfo> startClip, QList<ItemInfo> start
                 if (clip->clipState() == PlaylistState::VideoOnly) {
                     prod = m_document->renderer()->getBinVideoProducer(clip->getBinId());
                 }
+                else if (clip->clipState() == PlaylistState::AudioOnly) {
+                    prod = m_document->renderer()->getBinAudioProducer(clip->getBinId());
+                }
                 else {
                     prod = m_document->renderer()->getBinProducer(clip->getBinId());
                 }
@@ -5025,6 +5244,7 @@ void CustomTrackView::moveGroup(QList<ItemInfo> startClip, QList<ItemInfo> start
         //TODO: calculate affected ranges and invalidate previews
         monitorRefresh(range, true);
     } else qDebug() << "///////// WARNING; NO GROUP TO MOVE";
+    m_timeline->endEdits();
 }
 
 void CustomTrackView::moveTransition(const ItemInfo &start, const ItemInfo &end, bool refresh)
@@ -5483,122 +5703,88 @@ double CustomTrackView::getSnapPointForPos(double pos)
     return m_scene->getSnapPointForPos(pos, KdenliveSettings::snaptopoints());
 }
 
-void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList <GenTime> offsetList, bool skipSelectedItems)
+QVector <int> CustomTrackView::snapPointsForItem(AbstractClipItem *item) const
 {
-    QList <GenTime> snaps;
-    if (selected && offsetList.isEmpty()) offsetList.append(selected->cropDuration());
-    QList<QGraphicsItem *> itemList = items();
-    for (int i = 0; i < itemList.count(); ++i) {
-        if (itemList.at(i) == selected) continue;
-        if (skipSelectedItems && itemList.at(i)->isSelected()) continue;
-        if (itemList.at(i)->type() == AVWidget) {
-            ClipItem *item = static_cast <ClipItem *>(itemList.at(i));
-            if (!item) continue;
-            GenTime start = item->startPos();
-            GenTime end = item->endPos();
-            if (!snaps.contains(start))
-                snaps.append(start);
-            if (!snaps.contains(end))
-                snaps.append(end);
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
-            }
-            // Add clip markers
-            QList<GenTime> markers;
-            ClipController *controller = m_document->getClipController(item->getBinId());
-            if (controller) {
-                markers = item->snapMarkers(controller->snapMarkers());
-            } else {
-                qWarning("No controller!");
-            }
-            for (int j = 0; j < markers.size(); ++j) {
-                GenTime t = markers.at(j);
-                if (!snaps.contains(t))
-                    snaps.append(t);
-                if (!offsetList.isEmpty()) {
-                    for (int k = 0; k < offsetList.size(); ++k) {
-                        GenTime offset = t - offsetList.at(k);
-                        if (offset > GenTime() && !snaps.contains(offset))
-                            snaps.append(offset);
-                    }
-                }
-            }
-        } else if (itemList.at(i)->type() == TransitionWidget) {
-            Transition *transition = static_cast <Transition*>(itemList.at(i));
-            if (!transition) continue;
-            GenTime start = transition->startPos();
-            GenTime end = transition->endPos();
-            if (!snaps.contains(start))
-                snaps.append(start);
-            if (!snaps.contains(end))
-                snaps.append(end);
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
+    QVector <int> points;
+    const double fps = m_document->fps();
+    points << item->startPos().frames(fps) << item->endPos().frames(fps);
+    if (item->type() == AVWidget) {
+        // Add clip markers
+        ClipItem *clip = static_cast <ClipItem *>(item);
+        ClipController *controller = m_document->getClipController(clip->getBinId());
+        if (controller) {
+            const QList <GenTime> markers = clip->snapMarkers(controller->snapMarkers());
+            for (int i = 0; i < markers.size(); ++i) {
+                points << markers.at(i).frames(fps);
             }
+        } else {
+            qWarning("No controller!");
         }
     }
+    return points;
+}
 
-    // add cursor position
-    GenTime pos = GenTime(m_cursorPos, m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
-    if (!offsetList.isEmpty()) {
-        for (int j = 0; j < offsetList.size(); ++j) {
-            GenTime offset = pos - offsetList.at(j);
-            if (!snaps.contains(offset))
-                snaps.append(offset);
+void CustomTrackView::invalidateSnapIndex()
+{
+    m_snapIndexValid = false;
+}
+
+void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList <GenTime> offsetList, bool skipSelectedItems)
+{
+    if (!m_snapIndexValid) {
+        // Clips, transitions and markers only change through undo commands
+        QVector <int> points;
+        QList<QGraphicsItem *> itemList = items();
+        for (int i = 0; i < itemList.count(); ++i) {
+            if (itemList.at(i)->type() == AVWidget || itemList.at(i)->type() == TransitionWidget) {
+                points << snapPointsForItem(static_cast <AbstractClipItem *>(itemList.at(i)));
+            }
+        }
+        m_snapIndex.setPoints(points);
+        m_snapIndexValid = true;
+    }
+    SnapIndex snaps = m_snapIndex;
+    // Items being dragged do not snap to themselves
+    QList<QGraphicsItem *> excluded;
+    if (selected) {
+        excluded << selected;
+    }
+    if (skipSelectedItems) {
+        excluded << m_scene->selectedItems();
+    }
+    for (int i = 0; i < excluded.count(); ++i) {
+        if (excluded.at(i)->type() == GroupWidget) {
+            // Grouped items report the selection of their group
+            excluded << excluded.at(i)->childItems();
+            continue;
+        }
+        if (excluded.at(i)->type() != AVWidget && excluded.at(i)->type() != TransitionWidget) continue;
+        if (excluded.indexOf(excluded.at(i)) < i) continue;
+        const QVector <int> points = snapPointsForItem(static_cast <AbstractClipItem *>(excluded.at(i)));
+        for (int j = 0; j < points.count(); ++j) {
+            snaps.removePoint(points.at(j));
         }
     }
 
+    // add cursor position
+    snaps.addPoint(m_cursorPos);
+
     // add guides
     for (int i = 0; i < m_guides.count(); ++i) {
-        GenTime pos = m_guides.at(i)->position();
-        if (!snaps.contains(pos))
-            snaps.append(pos);
-        if (!offsetList.isEmpty()) {
-            for (int j = 0; j < offsetList.size(); ++j) {
-                GenTime offset = pos - offsetList.at(j);
-                if (!snaps.contains(offset))
-                    snaps.append(offset);
-            }
-        }
+        snaps.addPoint(m_guides.at(i)->position().frames(m_document->fps()));
     }
 
     // add render zone
     QPoint z = m_document->zone();
-    pos = GenTime(z.x(), m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
-    pos = GenTime(z.y(), m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
+    snaps.addPoint(z.x());
+    snaps.addPoint(z.y());
 
-    qSort(snaps);
-    m_scene->setSnapList(snaps);
-    //for (int i = 0; i < m_snapPoints.size(); ++i)
-    //    //qDebug() << "SNAP POINT: " << m_snapPoints.at(i).frames(25);
+    if (selected && offsetList.isEmpty()) offsetList.append(selected->cropDuration());
+    QList <int> offsets;
+    for (int i = 0; i < offsetList.size(); ++i) {
+        offsets << offsetList.at(i).frames(m_document->fps());
+    }
+    m_scene->setSnapList(snaps, offsets);
 }
 
 void CustomTrackView::slotSeekToPreviousSnap()
@@ -5890,6 +6076,7 @@ void CustomTrackView::setScale(double scaleFactor, double verticalScale)
     centerOn(QPointF(cursorPos(), verticalPos));
     m_currentToolManager->updateTimelineItems();
     m_scene->isZooming = false;
+    m_thumbPrefetcher->slotViewportChanged();
 }
 
 void CustomTrackView::slotRefreshGuides()
@@ -5928,23 +6115,51 @@ void CustomTrackView::drawBackground(QPainter * painter, const QRectF &rect)
         painter->drawLine(QPointF(min, m_tracksHeight * (maxTrack - i) - 1), QPointF(max, m_tracksHeight * (maxTrack - i) - 1));
     }
     painter->drawLine(QPointF(min, m_tracksHeight * (maxTrack) - 1), QPointF(max, m_tracksHeight * (maxTrack) - 1));
+    drawLightweightItems(painter, rect);
 }
 
-bool CustomTrackView::findString(const QString &text)
+void CustomTrackView::drawLightweightItems(QPainter *painter, const QRectF &rect)
 {
-    QString marker;
-    for (int i = 0; i < m_searchPoints.size(); ++i) {
-        marker = m_searchPoints.at(i).comment();
-        if (marker.contains(text, Qt::CaseInsensitive)) {
-            seekCursorPos(m_searchPoints.at(i).time().frames(m_document->fps()));
-            int vert = verticalScrollBar()->value();
-            int hor = cursorPos();
-            ensureVisible(hor, vert + 10, 2, 2, 50, 0);
-            m_findIndex = i;
-            return true;
+    if (KdenliveSettings::lodclipwidth() <= 0)
+        return;
+    const QTransform transform = painter->worldTransform();
+    // Group the rectangles by colour so that each colour is drawn with one call
+    QMap <QRgb, QVector <QRectF> > batches;
+    int maxTrack = m_timeline->visibleTracksCount();
+    for (int i = 1; i <= maxTrack; ++i) {
+        const QRectF track(rect.left(), m_tracksHeight * (maxTrack - i), rect.width(), m_tracksHeight);
+        if (!track.intersects(rect))
+            continue;
+        QList <AbstractClipItem *> items = m_scene->itemIndex()->itemsIn(i, AVWidget, rect.left() - 1, rect.right() + 1);
+        items << m_scene->itemIndex()->itemsIn(i, TransitionWidget, rect.left() - 1, rect.right() + 1);
+        foreach(AbstractClipItem *item, items) {
+            if (!item->isVisible() || !item->isLightweight(transform))
+                continue;
+            batches[item->lightweightColor().rgba()] << item->mapRectToScene(item->rect());
         }
     }
-    return false;
+    if (batches.isEmpty())
+        return;
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    painter->setPen(Qt::NoPen);
+    QMap <QRgb, QVector <QRectF> >::const_iterator it;
+    for (it = batches.constBegin(); it != batches.constEnd(); ++it) {
+        painter->setBrush(QColor::fromRgba(it.key()));
+        painter->drawRects(it.value());
+    }
+    painter->restore();
+}
+
+bool CustomTrackView::findString(const QString &text)
+{
+    matchSearchString(text);
+    if (m_searchMatches.isEmpty()) {
+        return false;
+    }
+    m_findIndex = 0;
+    seekSearchMatch(m_searchMatches.first());
+    return true;
 }
 
 void CustomTrackView::selectFound(QString track, QString pos)
@@ -5959,37 +6174,96 @@ void CustomTrackView::selectFound(QString track, QString pos)
 
 bool CustomTrackView::findNextString(const QString &text)
 {
-    QString marker;
-    for (int i = m_findIndex + 1; i < m_searchPoints.size(); ++i) {
-        marker = m_searchPoints.at(i).comment();
-        if (marker.contains(text, Qt::CaseInsensitive)) {
-            seekCursorPos(m_searchPoints.at(i).time().frames(m_document->fps()));
-            int vert = verticalScrollBar()->value();
-            int hor = cursorPos();
-            ensureVisible(hor, vert + 10, 2, 2, 50, 0);
-            m_findIndex = i;
-            return true;
-        }
+    matchSearchString(text);
+    if (m_findIndex + 1 < m_searchMatches.count()) {
+        ++m_findIndex;
+        seekSearchMatch(m_searchMatches.at(m_findIndex));
+        return true;
     }
     m_findIndex = -1;
     return false;
 }
 
+void CustomTrackView::matchSearchString(const QString &text)
+{
+    const QString term = text.toCaseFolded();
+    if (term == m_searchTerm && !term.isEmpty()) {
+        return;
+    }
+    QVector <int> candidates;
+    if (!m_searchTerm.isEmpty() && term.startsWith(m_searchTerm)) {
+        // Typing another character can only narrow the previous matches
+        candidates = m_searchMatches;
+    } else {
+        candidates.reserve(m_searchTexts.count());
+        for (int i = 0; i < m_searchTexts.count(); ++i) {
+            candidates << i;
+        }
+    }
+    m_searchTerm = term;
+    // Rank texts starting with the term first, then texts with a word starting with it,
+    // then any other match. Within a rank, matches keep their timeline order.
+    QVector <int> ranked[3];
+    foreach(int i, candidates) {
+        const QString &candidate = m_searchTexts.at(i);
+        int pos = candidate.indexOf(term);
+        if (pos < 0) continue;
+        if (pos == 0) {
+            ranked[0] << i;
+            continue;
+        }
+        while (pos > 0 && candidate.at(pos - 1).isLetterOrNumber()) {
+            pos = candidate.indexOf(term, pos + 1);
+        }
+        ranked[pos == -1 ? 2 : 1] << i;
+    }
+    // Narrowed candidates come in the ranking of the shorter term, restore timeline order
+    for (int r = 0; r < 3; ++r) {
+        qSort(ranked[r]);
+    }
+    m_searchMatches = ranked[0] + ranked[1] + ranked[2];
+}
+
+void CustomTrackView::seekSearchMatch(int index)
+{
+    seekCursorPos(m_searchPoints.at(index).time().frames(m_document->fps()));
+    int vert = verticalScrollBar()->value();
+    int hor = cursorPos();
+    ensureVisible(hor, vert + 10, 2, 2, 50, 0);
+}
+
 void CustomTrackView::initSearchStrings()
 {
     m_searchPoints.clear();
+    // Clip texts are shared by all instances of a bin clip, parse them once
+    QHash <QString, QStringList> clipTexts;
     QList<QGraphicsItem *> itemList = items();
     for (int i = 0; i < itemList.count(); ++i) {
         // parse all clip names
         if (itemList.at(i)->type() == AVWidget) {
             ClipItem *item = static_cast <ClipItem *>(itemList.at(i));
             GenTime start = item->startPos();
-            CommentedTime t(start, item->clipName());
-            m_searchPoints.append(t);
-            // add all clip markers
-            ClipController *controller = m_document->getClipController(item->getBinId());
-            QList < CommentedTime > markers = controller->commentedSnapMarkers();
-            m_searchPoints += markers;
+            m_searchPoints.append(CommentedTime(start, item->clipName()));
+            const QString binId = item->getBinId();
+            if (!clipTexts.contains(binId)) {
+                QStringList texts;
+                ClipController *controller = m_document->getClipController(binId);
+                if (controller) {
+                    const QString description = controller->description();
+                    if (!description.isEmpty()) {
+                        texts << description;
+                    }
+                    if (controller->clipType() == Text) {
+                        texts << TitleWidget::extractTextList(controller->property(QStringLiteral("xmldata")));
+                    }
+                }
+                clipTexts.insert(binId, texts);
+            }
+            foreach(const QString &text, clipTexts.value(binId)) {
+                m_searchPoints.append(CommentedTime(start, text));
+            }
+            // add all clip markers at their timeline position
+            m_searchPoints += item->commentedSnapMarkers();
         }
     }
 
@@ -5998,24 +6272,29 @@ void CustomTrackView::initSearchStrings()
         m_searchPoints.append(m_guides.at(i)->info());
 
     qSort(m_searchPoints);
+    m_searchTexts.clear();
+    m_searchTexts.reserve(m_searchPoints.count());
+    for (int i = 0; i < m_searchPoints.count(); ++i) {
+        m_searchTexts << m_searchPoints.at(i).comment().toCaseFolded();
+    }
+    m_searchMatches.clear();
+    m_searchTerm.clear();
 }
 
 void CustomTrackView::clearSearchStrings()
 {
     m_searchPoints.clear();
+    m_searchTexts.clear();
+    m_searchMatches.clear();
+    m_searchTerm.clear();
     m_findIndex = 0;
 }
 
 QList<ItemInfo> CustomTrackView::findId(const QString &clipId)
 {
     QList<ItemInfo> matchingInfo;
-    QList<QGraphicsItem *> itemList = items();
-    for (int i = 0; i < itemList.count(); ++i) {
-        if (itemList.at(i)->type() == AVWidget) {
-            ClipItem *item = static_cast<ClipItem*>(itemList.at(i));
-            if (item->getBinId() == clipId)
-                matchingInfo << item->info();
-        }
+    foreach(ClipItem *item, m_scene->itemIndex()->clipItems(clipId)) {
+        matchingInfo << item->info();
     }
     return matchingInfo;
 }
@@ -6541,7 +6820,7 @@ void CustomTrackView::saveThumbnails()
                 if (item->clipType() == Image || item->clipType() == Text || item->clipType() == Audio) {
                     QString thumb = thumbsFolder.absoluteFilePath(item->getBinHash() + "#0.png");
                     if (!QFile::exists(thumb)) {
-                        item->startThumb().save(thumb);
+                        if (item->startThumb().save(thumb)) CacheIndex::fileWritten(thumb);
                     }
                 } else {
                     QString startThumb = thumbsFolder.absoluteFilePath(item->getBinHash() + '#');
@@ -6549,10 +6828,10 @@ void CustomTrackView::saveThumbnails()
                     startThumb.append(QString::number((int) item->speedIndependantCropStart().frames(m_document->fps())) + ".png");
                     endThumb.append(QString::number((int) (item->speedIndependantCropStart() + item->speedIndependantCropDuration()).frames(m_document->fps()) - 1) + ".png");
                     if (!QFile::exists(startThumb)) {
-                        item->startThumb().save(startThumb);
+                        if (item->startThumb().save(startThumb)) CacheIndex::fileWritten(startThumb);
                     }
                     if (!QFile::exists(endThumb)) {
-                        item->endThumb().save(endThumb);
+                        if (item->endThumb().save(endThumb)) CacheIndex::fileWritten(endThumb);
                     }
                 }
             }
@@ -6734,15 +7013,8 @@ void CustomTrackView::autoTransition()
 
 void CustomTrackView::clipNameChanged(const QString &id)
 {
-    QList<QGraphicsItem *> list = scene()->items();
-    ClipItem *clip = NULL;
-    for (int i = 0; i < list.size(); ++i) {
-        if (list.at(i)->type() == AVWidget) {
-            clip = static_cast <ClipItem *>(list.at(i));
-            if (clip->getBinId() == id) {
-                clip->update();
-            }
-        }
+    foreach(ClipItem *clip, m_scene->itemIndex()->clipItems(id)) {
+        clip->update();
     }
     //viewport()->update();
 }
@@ -6871,6 +7143,10 @@ void CustomTrackView::setAudioAlignReference()
                 return;
             }
             AudioEnvelope *envelope = new AudioEnvelope(clip->binClip()->url().path(), prod);
+            if (clip->speed() == 1.0 && clip->binClip()->audioThumbCreated()) {
+                // Correlate the audio thumbnail, only a short part of the audio is decoded to refine the result
+                envelope->setLevels(clip->binClip()->audioLevels());
+            }
             m_audioCorrelator = new AudioCorrelation(envelope);
             connect(m_audioCorrelator, SIGNAL(gotAudioAlignData(int,int,int)), this, SLOT(slotAlignClip(int,int,int)));
             connect(m_audioCorrelator, SIGNAL(displayMessage(QString,MessageType)), this, SIGNAL(displayMessage(QString,MessageType)));
@@ -6899,6 +7175,7 @@ void CustomTrackView::alignAudio()
     }
 
     QList<QGraphicsItem *> selection = scene()->selectedItems();
+    QList<AudioEnvelope *> envelopes;
     foreach (QGraphicsItem *item, selection) {
         if (item->type() == AVWidget) {
 
@@ -6912,6 +7189,7 @@ void CustomTrackView::alignAudio()
                 Mlt::Producer *prod = m_timeline->track(clip->track())->clipProducer(m_document->renderer()->getBinProducer(clip->getBinId()), clip->clipState());
                 if (!prod) {
                     qWarning() << "couldn't load producer for clip " << clip->getBinId() << " on track " << clip->track();
+                    qDeleteAll(envelopes);
                     return;
                 }
                 AudioEnvelope *envelope = new AudioEnvelope(clip->binClip()->url().path(), prod,
@@ -6919,10 +7197,15 @@ void CustomTrackView::alignAudio()
                         info.cropDuration.frames(m_document->fps()),
                         clip->track(),
                         info.startPos.frames(m_document->fps()));
-                m_audioCorrelator->addChild(envelope);
+                if (clip->speed() == 1.0 && clip->binClip()->audioThumbCreated()) {
+                    envelope->setLevels(clip->binClip()->audioLevels());
+                }
+                envelopes << envelope;
             }
         }
     }
+    // Align all selected clips in one pass against the reference
+    m_audioCorrelator->addChildren(envelopes);
     emit displayMessage(i18n("Processing audio, please wait."), ProcessingJobMessage);
 }
 
@@ -7179,20 +7462,20 @@ void CustomTrackView::monitorRefresh(QList <ItemInfo> range, bool invalidateRang
             m_timeline->invalidateRange(range.at(i));
     }
     if (refreshMonitor)
-        m_document->renderer()->doRefresh();
+        m_timeline->requestMonitorRefresh();
 }
 
 void CustomTrackView::monitorRefresh(ItemInfo range, bool invalidateRange)
 {
     if (range.contains(GenTime(m_cursorPos, m_document->fps())))
-        m_document->renderer()->doRefresh();
+        m_timeline->requestMonitorRefresh();
     if (invalidateRange)
         m_timeline->invalidateRange(range);
 }
 
 void CustomTrackView::monitorRefresh(bool invalidateRange)
 {
-    m_document->renderer()->doRefresh();
+    m_timeline->requestMonitorRefresh();
     if (invalidateRange)
         m_timeline->invalidateRange();
 }
@@ -7210,6 +7493,9 @@ void CustomTrackView::doChangeClipType(ItemInfo info, PlaylistState::ClipState s
     if (state == PlaylistState::VideoOnly) {
         prod = m_document->renderer()->getBinVideoProducer(clip->getBinId());
     }
+    else if (state == PlaylistState::AudioOnly) {
+        prod = m_document->renderer()->getBinAudioProducer(clip->getBinId());
+    }
     else {
         prod = m_document->renderer()->getBinProducer(clip->getBinId());
     }
@@ -7220,7 +7506,7 @@ void CustomTrackView::doChangeClipType(ItemInfo info, PlaylistState::ClipState s
         slowmoInfo.speed = speed;
         slowmoInfo.strobe = 1;
         slowmoInfo.state = state;
-        Mlt::Producer *copy = m_document->renderer()->getSlowmotionProducer(slowmoInfo.toString(locale) + url);
+        Mlt::Producer *copy = m_document->renderer()->getSlowmotionProducer(slowmoInfo.poolKey(clip->getBinId(), locale));
         if (copy == NULL) {
             // create mute slowmo producer
             url.prepend(locale.toString(speed) + ":");
@@ -7521,14 +7807,10 @@ QStringList CustomTrackView::extractTransitionsLumas()
 {
     QStringList urls;
     QList<QGraphicsItem *> itemList = items();
-    Transition *transitionitem;
-    QDomElement transitionXml;
     for (int i = 0; i < itemList.count(); ++i) {
         if (itemList.at(i)->type() == TransitionWidget) {
-            transitionitem = static_cast <Transition*>(itemList.at(i));
-            transitionXml = transitionitem->toXML();
-            // luma files in transitions are in "resource" property
-            QString luma = EffectsList::parameter(transitionXml, QStringLiteral("resource"));
+            // Read the luma without building the whole transition xml
+            QString luma = static_cast <Transition*>(itemList.at(i))->lumaFile();
             if (!luma.isEmpty()) urls << QUrl(luma).path();
         }
     }
@@ -7866,38 +8148,59 @@ void CustomTrackView::slotImportClipKeyframes(GraphicsRectItem type, ItemInfo in
 }
 
 void CustomTrackView::slotReplaceTimelineProducer(const QString &id)
+{
+    slotReplaceTimelineProducers(QStringList() << id);
+}
+
+void CustomTrackView::slotReplaceTimelineProducers(const QStringList &ids)
+{
+    // Clip durations and markers may change with the new producer
+    m_snapIndexValid = false;
+    QList <ItemInfo> toUpdate;
+    foreach (const QString &id, ids) {
+        toUpdate << replaceProducerInTracks(id);
+    }
+    m_document->renderer()->releaseSlowmotionProducers();
+    if (!toUpdate.isEmpty())
+        monitorRefresh(toUpdate, true);
+    m_timeline->refreshTractor();
+}
+
+QList <ItemInfo> CustomTrackView::replaceProducerInTracks(const QString &id)
 {
     Mlt::Producer *prod = m_document->renderer()->getBinProducer(id);
     Mlt::Producer *videoProd = m_document->renderer()->getBinVideoProducer(id);
+    // Only the playlists of tracks where the clip is used need to be scanned
+    QList <int> tracks;
+    foreach(ClipItem *item, m_scene->itemIndex()->clipItems(id)) {
+        if (!tracks.contains(item->track()) && item->track() > 0 && item->track() < m_timeline->tracksCount()) {
+            tracks << item->track();
+        }
+    }
     QList <Track::SlowmoInfo> allSlows;
-    for (int i = 1; i < m_timeline->tracksCount(); i++) {
-	allSlows << m_timeline->track(i)->getSlowmotionInfos(id);
+    foreach(int track, tracks) {
+	allSlows << m_timeline->track(track)->getSlowmotionInfos(id);
     }
     QLocale locale;
     QString url = prod->get("resource");
-    // generate all required slowmo producers
-    QStringList processedUrls;
+    Mlt::Properties passProperties;
+    Mlt::Properties original(prod->get_properties());
+    passProperties.pass_list(original, ClipController::getPassPropertiesList(false));
+    // generate all required slowmo producers, one per speed / strobe / state combination for the whole project
     QMap <QString, Mlt::Producer *> newSlowMos;
     for (int i = 0; i < allSlows.count(); i++) {
-	// find out speed and strobe values
         Track::SlowmoInfo info = allSlows.at(i);
-        QString wrapUrl = QStringLiteral("timewarp:") + locale.toString(info.speed) + ':' + url;
-	// build slowmo producer
-	if (processedUrls.contains(wrapUrl)) continue;
-        processedUrls << wrapUrl;
-	Mlt::Producer *slowProd = new Mlt::Producer(*prod->profile(), 0, wrapUrl.toUtf8().constData());
-	if (!slowProd->is_valid()) {
-                qDebug()<<"++++ FAILED TO CREATE SLOWMO PROD";
+        QString key = info.toString(locale);
+	if (newSlowMos.contains(key)) continue;
+	Mlt::Producer *slowProd = m_timeline->track(1)->buildSlowMoProducer(passProperties, locale.toString(info.speed) + ':' + url, id, info);
+	if (slowProd == NULL) {
 		continue;
         }
-        //if (strobe > 1) slowProd->set("strobe", strobe);
-        QString producerid = "slowmotion:" + id + ':' + info.toString(locale);
-        slowProd->set("id", producerid.toUtf8().constData());
-	newSlowMos.insert(info.toString(locale), slowProd);
+	newSlowMos.insert(key, slowProd);
     }
     QList <ItemInfo> toUpdate;
-    for (int i = 1; i < m_timeline->tracksCount(); i++) {
-        toUpdate << m_timeline->track(i)->replaceAll(id,  prod, videoProd, newSlowMos);
+    foreach(int track, tracks) {
+        toUpdate << m_timeline->track(track)->replaceAll(id,  prod, videoProd, newSlowMos);
     }
 
     // update slowmotion storage
@@ -7905,11 +8208,9 @@ void CustomTrackView::slotReplaceTimelineProducer(const QString &id)
     while (i.hasNext()) {
 	i.next();
 	Mlt::Producer *sprod = i.value();
-	m_document->renderer()->storeSlowmotionProducer(i.key() + url, sprod, true);
+	m_document->renderer()->storeSlowmotionProducer(id + ':' + i.key(), sprod, true);
     }
-    if (!toUpdate.isEmpty())
-        monitorRefresh(toUpdate, true);
-    m_timeline->refreshTractor();
+    return toUpdate;
 }
 
 void CustomTrackView::slotPrepareTimelineReplacement(const QString &id)
@@ -45,6 +45,8 @@ class AbstractGroupItem;
 class Transition;
 class AudioCorrelation;
 class KSelectAction;
+class ThumbPrefetcher;
+class QRubberBand;
 
 class CustomTrackView : public QGraphicsView
 {
@@ -64,6 +66,8 @@ public:
     void configTracks(const QList<TrackInfo> &trackInfos);
     int cursorPos() const;
     void checkAutoScroll();
+    /** @brief Switches between the raster and the OpenGL viewport according to the settings. */
+    void checkViewport();
     /**
       Move the clip at \c start to \c end.
 
@@ -107,6 +111,8 @@ public:
     void setContextMenu(QMenu *timeline, QMenu *clip, QMenu *transition, QActionGroup *clipTypeGroup, QMenu *markermenu);
     bool checkTrackHeight(bool force = false);
     void updateSceneFrameWidth(double fpsChanged = 1.0);
+    /** @brief The project frame size changed, scale the pixel geometries of all effects and transitions. */
+    void scaleGeometries(double xScale, double yScale);
     void setTool(ProjectTool tool);
     void cutClip(const ItemInfo &info, const GenTime &cutTime, bool cut, const EffectsList &oldStack = EffectsList(), bool execute = true);
     Transition *cutTransition(const ItemInfo &info, const GenTime &cutTime, bool cut, const QDomElement &oldStack = QDomElement(), bool execute = true);
@@ -269,7 +275,7 @@ public:
     /** @brief Insert space in timeline. track = -1 means all tracks */
     void insertTimelineSpace(GenTime startPos, GenTime duration, int track = -1, QList <ItemInfo> excludeList = QList <ItemInfo>());
     void trimMode(bool enable, int ripplePos = -1);
-        /** @brief Returns a clip from timeline
+    /** @brief Returns a clip from timeline
      *  @param pos the end time position
      *  @param track the track where the clip is in MLT coordinates */
     ClipItem *getClipItemAtEnd(GenTime pos, int track);
@@ -342,6 +348,8 @@ public slots:
     void slotChangeEffectState(ClipItem *clip, int track, QList <int> effectIndexes, bool disable);
     void slotChangeEffectPosition(ClipItem *clip, int track, QList <int> currentPos, int newPos);
     void slotUpdateClipEffect(ClipItem *clip, int track, QDomElement oldeffect, QDomElement effect, int ix, bool refreshEffectStack = true);
+    /** @brief Apply parameters being dragged to the MLT filter, the undo command is created when the drag ends. */
+    void slotPreviewClipEffect(ClipItem *clip, int track, QDomElement effect);
     void slotUpdateClipRegion(ClipItem *clip, int ix, QString region);
     void slotRefreshEffects(ClipItem *clip);
     void setDuration(int duration);
@@ -399,6 +407,8 @@ public slots:
     * @param offsetList The list of points that should also snap (for example when movin a clip, start and end points should snap
     * @param skipSelectedItems if true, the selected item start and end points will not be added to snap list */
     void updateSnapPoints(AbstractClipItem *selected, QList <GenTime> offsetList = QList <GenTime> (), bool skipSelectedItems = false);
+    /** @brief Marks the snap index as outdated, it is rebuilt on the next updateSnapPoints. */
+    void invalidateSnapIndex();
 
     void slotAddEffect(ClipItem *clip, const QDomElement &effect, int track = -1);
     void slotImportClipKeyframes(GraphicsRectItem type, ItemInfo info, QDomElement xml, QMap<QString, QString> data = QMap<QString, QString>());
@@ -412,6 +422,10 @@ public slots:
     void exportTimelineSelection(QString path = QString());
     /** Remove zone from current track */
     void extractZone(QPoint z, bool closeGap, QList <ItemInfo> excludedClips = QList <ItemInfo>(), QUndoCommand *masterCommand = NULL, int track = -1);
+    /** @brief Turn recorded multicam angle switches into a single undoable edit.
+     *  @param switches the selected track for each switch position (in frames)
+     *  @param tracks the angle tracks, the clips of the unselected ones are removed on each segment */
+    void applyAngleSwitches(const QMap <int, int> &switches, const QList <int> &tracks);
     /** @brief Select an item in timeline. */
     void slotSelectItem(AbstractClipItem *item);
     /** @brief Cycle through timeline trim modes */
@@ -420,6 +434,8 @@ public slots:
 
 protected:
     virtual void drawBackground(QPainter * painter, const QRectF & rect);
+    /** @brief Draws the items too narrow for detailed painting as batched rectangles. */
+    void drawLightweightItems(QPainter *painter, const QRectF &rect);
     //virtual void drawForeground ( QPainter * painter, const QRectF & rect );
     virtual void dragEnterEvent(QDragEnterEvent * event);
     virtual void dragMoveEvent(QDragMoveEvent * event);
@@ -460,12 +476,38 @@ private:
     QColor m_tipColor;
     QPen m_tipPen;
     QPoint m_clickEvent;
+    /** @brief Searchable timeline texts sorted by position, with their case folded text */
     QList <CommentedTime> m_searchPoints;
+    QStringList m_searchTexts;
+    /** @brief Indexes in m_searchPoints of the entries matching m_searchTerm, best ranked first */
+    QVector <int> m_searchMatches;
+    QString m_searchTerm;
+    /** @brief Fills m_searchMatches for text, narrowing the previous matches when text extends the previous term. */
+    void matchSearchString(const QString &text);
+    void seekSearchMatch(int index);
     QList <Guide *> m_guides;
+    /** @brief Sorted start, end and marker frames of all timeline items. */
+    SnapIndex m_snapIndex;
+    bool m_snapIndexValid;
+    /** @brief Returns the start, end and marker frames of a clip or transition. */
+    QVector <int> snapPointsForItem(AbstractClipItem *item) const;
+    /** @brief Rubber band of the rectangle selection and its scene origin */
+    QRubberBand *m_rubberBand;
+    QPointF m_rubberOrigin;
+    /** @brief Items currently selected by the rectangle */
+    QSet <QGraphicsItem *> m_rubberSelection;
+    /** @brief Items that were selected when the rectangle selection started */
+    QSet <QGraphicsItem *> m_rubberInitial;
+    /** @brief Item actually selected for each clip met by the rectangle: the clip or its top group */
+    QHash <QGraphicsItem *, QGraphicsItem *> m_rubberTargets;
+    /** @brief Selects the items in the rectangle from the selection start to pos, using the track index. */
+    void updateRectangleSelection(const QPoint &pos);
+    void finishRectangleSelection();
     QColor m_selectedTrackColor;
     QColor m_lockedTrackColor;
     QMap <AbstractToolManager::ToolManagerType, AbstractToolManager*> m_toolManagers;
     AbstractToolManager *m_currentToolManager;
+    ThumbPrefetcher *m_thumbPrefetcher;
 
     /** @brief Returns a clip from timeline
      *  @param pos a time value that is inside the clip
@@ -557,6 +599,8 @@ private:
     void updateTimelineSelection();
     /** @brief Break groups containing an item in a locked track. */
     void breakLockedGroups(QList<ItemInfo> clipsToMove, QList<ItemInfo> transitionsToMove, QUndoCommand *masterCommand, bool doIt = true);
+    /** @brief Point the track cuts of clip @param id to its new bin producer, returns the ranges to refresh. */
+    QList <ItemInfo> replaceProducerInTracks(const QString &id);
     void slotTrackUp();
     void slotTrackDown();
 
@@ -575,6 +619,8 @@ private slots:
     void slotGotFilterJobResults(const QString &id, int startPos, int track, stringMap filterParams, stringMap extra);
     /** @brief Replace a producer in all tracks (for example when proxying a clip). */
     void slotReplaceTimelineProducer(const QString &id);
+    /** @brief Replace the producers of several clips in all tracks, refreshing the timeline once. */
+    void slotReplaceTimelineProducers(const QStringList &ids);
     void slotPrepareTimelineReplacement(const QString &id);
     /** @brief Update a producer in all tracks (for example when an effect changed). */
     void slotUpdateTimelineProducer(const QString &id);
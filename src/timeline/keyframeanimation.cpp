@@ -0,0 +1,196 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "keyframeanimation.h"
+
+#include <algorithm>
+
+namespace {
+    bool keyBefore(const KeyframeAnimation::Key &key, int frame)
+    {
+        return key.frame < frame;
+    }
+
+    // Leading number of a value, as atof does for rect values
+    double keyNumber(const QString &value)
+    {
+        return value.section(QLatin1Char(' '), 0, 0, QString::SectionSkipEmpty).toDouble();
+    }
+
+    // Same spline as MLT for smooth keyframes
+    double catmullRom(double y0, double y1, double y2, double y3, double t)
+    {
+        double t2 = t * t;
+        double a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+        double a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+        double a2 = -0.5 * y0 + 0.5 * y2;
+        double a3 = y1;
+        return a0 * t * t2 + a1 * t2 + a2 * t + a3;
+    }
+}
+
+bool KeyframeAnimation::parse(const QString &data, int length)
+{
+    m_keys.clear();
+    const QStringList items = data.split(QLatin1Char(';'), QString::SkipEmptyParts);
+    foreach(const QString &item, items) {
+        int separator = item.indexOf(QLatin1Char('='));
+        if (separator < 0) {
+            return false;
+        }
+        Key key;
+        QString pos = item.left(separator).trimmed();
+        key.type = mlt_keyframe_linear;
+        if (pos.endsWith(QLatin1Char('|'))) {
+            key.type = mlt_keyframe_discrete;
+            pos.chop(1);
+        } else if (pos.endsWith(QLatin1Char('~'))) {
+            key.type = mlt_keyframe_smooth;
+            pos.chop(1);
+        }
+        bool ok;
+        key.frame = pos.toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+        if (key.frame < 0) {
+            key.frame += length;
+        }
+        key.value = item.mid(separator + 1);
+        setKey(key.frame, key.value, key.type);
+    }
+    return true;
+}
+
+int KeyframeAnimation::count() const
+{
+    return m_keys.count();
+}
+
+const KeyframeAnimation::Key &KeyframeAnimation::at(int ix) const
+{
+    return m_keys.at(ix);
+}
+
+int KeyframeAnimation::keyIndex(int frame) const
+{
+    QVector<Key>::const_iterator it = std::lower_bound(m_keys.constBegin(), m_keys.constEnd(), frame, keyBefore);
+    if (it == m_keys.constEnd() || it->frame != frame) {
+        return -1;
+    }
+    return it - m_keys.constBegin();
+}
+
+int KeyframeAnimation::previousKey(int frame) const
+{
+    QVector<Key>::const_iterator it = std::lower_bound(m_keys.constBegin(), m_keys.constEnd(), frame, keyBefore);
+    return (it - m_keys.constBegin()) - 1;
+}
+
+void KeyframeAnimation::setKey(int frame, const QString &value, mlt_keyframe_type type)
+{
+    QVector<Key>::iterator it = std::lower_bound(m_keys.begin(), m_keys.end(), frame, keyBefore);
+    if (it != m_keys.end() && it->frame == frame) {
+        it->value = value;
+        it->type = type;
+        return;
+    }
+    Key key;
+    key.frame = frame;
+    key.value = value;
+    key.type = type;
+    m_keys.insert(it, key);
+}
+
+mlt_keyframe_type KeyframeAnimation::typeAt(int frame) const
+{
+    if (m_keys.isEmpty()) return mlt_keyframe_linear;
+    int ix = keyIndex(frame);
+    if (ix < 0) {
+        ix = qMax(0, previousKey(frame));
+    }
+    return m_keys.at(ix).type;
+}
+
+double KeyframeAnimation::numberAt(int frame) const
+{
+    int next = previousKey(frame) + 1;
+    int previous = next - 1;
+    const Key &p1 = m_keys.at(previous);
+    const Key &p2 = m_keys.at(next);
+    double t = (double) (frame - p1.frame) / (p2.frame - p1.frame);
+    double y1 = keyNumber(p1.value);
+    double y2 = keyNumber(p2.value);
+    if (p1.type == mlt_keyframe_smooth) {
+        double y0 = previous > 0 ? keyNumber(m_keys.at(previous - 1).value) : y1;
+        double y3 = next + 1 < m_keys.count() ? keyNumber(m_keys.at(next + 1).value) : y2;
+        return catmullRom(y0, y1, y2, y3, t);
+    }
+    return y1 + (y2 - y1) * t;
+}
+
+QString KeyframeAnimation::valueAt(int frame) const
+{
+    if (m_keys.isEmpty()) return QString();
+    if (frame <= m_keys.first().frame) return m_keys.first().value;
+    if (frame >= m_keys.last().frame) return m_keys.last().value;
+    int ix = keyIndex(frame);
+    if (ix >= 0) return m_keys.at(ix).value;
+    const Key &previous = m_keys.at(previousKey(frame));
+    if (previous.type == mlt_keyframe_discrete) return previous.value;
+    return QString::number(numberAt(frame), 'g', 6);
+}
+
+QString KeyframeAnimation::serialize(int in, int out) const
+{
+    QString result;
+    if (m_keys.isEmpty()) return result;
+    // The first item may be interpolated at in, unless the animation starts later
+    int ix;
+    if (m_keys.first().frame <= in) {
+        result.append(QString::number(0));
+        mlt_keyframe_type type = typeAt(in);
+        if (type == mlt_keyframe_discrete) result.append(QLatin1Char('|'));
+        else if (type == mlt_keyframe_smooth) result.append(QLatin1Char('~'));
+        result.append(QLatin1Char('=') + valueAt(in));
+        if (in < out) result.append(QLatin1Char(';'));
+        ix = previousKey(in + 1) + 1;
+    } else {
+        ix = 0;
+    }
+    for (; ix < m_keys.count() && in < out; ++ix) {
+        const Key &key = m_keys.at(ix);
+        int frame = key.frame;
+        QString value = key.value;
+        mlt_keyframe_type type = key.type;
+        if (frame > out) {
+            // Crop at the out point
+            frame = out;
+            value = valueAt(out);
+            type = typeAt(out);
+        }
+        result.append(QString::number(frame - in));
+        if (type == mlt_keyframe_discrete) result.append(QLatin1Char('|'));
+        else if (type == mlt_keyframe_smooth) result.append(QLatin1Char('~'));
+        result.append(QLatin1Char('=') + value);
+        if (frame >= out) break;
+        result.append(QLatin1Char(';'));
+    }
+    return result;
+}
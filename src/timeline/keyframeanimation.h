@@ -0,0 +1,70 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef KEYFRAMEANIMATION_H
+#define KEYFRAMEANIMATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <mlt/framework/mlt_types.h>
+
+/**
+ * @class KeyframeAnimation
+ * @brief Parsed MLT animation string, with keys sorted by frame.
+ *
+ * Lookups and evaluation use binary search, and values are interpolated the same
+ * way as Mlt::Properties::anim_get_double. Key values are kept as written, so
+ * serializing an unchanged range returns the original values.
+ */
+class KeyframeAnimation
+{
+public:
+    struct Key {
+        int frame;
+        mlt_keyframe_type type;
+        QString value;
+    };
+
+    /** @brief Parses a serialized animation, negative positions are relative to @param length.
+     *  Returns false for syntax only handled by MLT, like time string positions. */
+    bool parse(const QString &data, int length);
+    int count() const;
+    const Key &at(int ix) const;
+    /** @brief Returns the index of the key at frame, -1 if there is none. */
+    int keyIndex(int frame) const;
+    /** @brief Returns the index of the last key before frame, -1 if there is none. */
+    int previousKey(int frame) const;
+    /** @brief Returns the value at frame, keeping the key text when no interpolation is needed. */
+    QString valueAt(int frame) const;
+    /** @brief Returns the keyframe type used at frame. */
+    mlt_keyframe_type typeAt(int frame) const;
+    /** @brief Inserts a key or replaces the key at frame. */
+    void setKey(int frame, const QString &value, mlt_keyframe_type type);
+    /** @brief Returns the keys from in to out with frames relative to in, like Mlt::Animation::serialize_cut. */
+    QString serialize(int in, int out) const;
+
+private:
+    QVector<Key> m_keys;
+    /** @brief Numeric value at frame, interpolated between the surrounding keys. */
+    double numberAt(int frame) const;
+};
+
+#endif
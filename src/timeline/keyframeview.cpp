@@ -21,12 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <QPainter>
+#include <QPainterPath>
 #include <QAction>
 #include <QApplication>
 
 #include "klocalizedstring.h"
 
 #include "keyframeview.h"
+#include "keyframeanimation.h"
 #include "mltcontroller/effectscontroller.h"
 
 KeyframeView::KeyframeView(int handleSize, QObject *parent) : QObject(parent)
@@ -42,6 +44,12 @@ KeyframeView::KeyframeView(int handleSize, QObject *parent) : QObject(parent)
     , m_handleSize(handleSize)
     , m_useOffset(false)
     , m_offset(0)
+    , m_revision(0)
+    , m_curveRevision(-1)
+    , m_curveDuration(0)
+    , m_channelRevision(-1)
+    , m_channelIn(0)
+    , m_channelOut(0)
 {
 }
 
@@ -73,6 +81,85 @@ QPointF KeyframeView::keyframePoint(QRectF br, int frame, double value, double f
                    br.bottom() - br.height() * (value * factor - min) / (max - min));
 }
 
+const KeyframeView::CurveCache &KeyframeView::cachedCurve(QRectF br, const QString &paramName, const ParameterInfo &info)
+{
+    if (m_curveRevision != m_revision || m_curveRect != br || m_curveDuration != duration) {
+        m_curves.clear();
+        m_curveRevision = m_revision;
+        m_curveRect = br;
+        m_curveDuration = duration;
+    }
+    QHash <QString, CurveCache>::const_iterator cached = m_curves.constFind(paramName);
+    if (cached != m_curves.constEnd()) {
+        return cached.value();
+    }
+    CurveCache curve;
+    const QByteArray name = paramName.toUtf8();
+    Mlt::Animation drawAnim = m_keyProperties.get_animation(name.constData());
+    if (!drawAnim.is_valid() || drawAnim.key_count() < 1) {
+        return m_curves.insert(paramName, curve).value();
+    }
+    int count = drawAnim.key_count();
+    QVector <int> frames(count);
+    QVector <QPointF> points(count);
+    for (int i = 0; i < count; ++i) {
+        frames[i] = drawAnim.key_get_frame(i);
+        double value = m_keyProperties.anim_get_double(name.constData(), frames.at(i), duration - m_offset);
+        points[i] = keyframePoint(br, frames.at(i) + m_offset, value, info.factor, info.min, info.max);
+    }
+    QPainterPath &path = curve.path;
+    QPointF start = points.first();
+    path.moveTo(br.x(), br.bottom());
+    path.lineTo(br.x(), start.y());
+    path.lineTo(start);
+    for (int i = 0; i + 1 < count; ++i) {
+        QPointF end = points.at(i + 1);
+        switch (drawAnim.key_get_type(i)) {
+            case mlt_keyframe_discrete:
+                path.lineTo(end.x(), start.y());
+                path.lineTo(end);
+                break;
+            case mlt_keyframe_linear:
+                path.lineTo(end);
+                break;
+            case mlt_keyframe_smooth:
+                // Tangents use the neighbouring keyframes, without the display offset
+                QPointF pre = points.at(qMax(i - 1, 0)) - QPointF(br.width() * m_offset / duration, 0);
+                QPointF post = points.at(qMin(i + 2, count - 1)) - QPointF(br.width() * m_offset / duration, 0);
+                QPointF c1 = (end - pre) / 6.0; // + start
+                QPointF c2 = (start - post) / 6.0; // + end
+                double mid = (end.x() - start.x()) / 2;
+                if (c1.x() >  mid) c1 = c1 * mid / c1.x(); // scale down tangent vector to not go beyond middle
+                if (c2.x() < -mid) c2 = c2 * -mid / c2.x();
+                path.cubicTo(start + c1, end + c2, end);
+                break;
+        }
+        start = end;
+    }
+    path.lineTo(br.right(), start.y());
+    path.lineTo(br.right(), br.bottom());
+    curve.frames = frames;
+    curve.points = points;
+    return m_curves.insert(paramName, curve).value();
+}
+
+const QVector <mlt_rect> &KeyframeView::cachedChannels(int width, int in, int out)
+{
+    if (m_channelRevision == m_revision && m_channelSamples.count() == width && m_channelIn == in && m_channelOut == out) {
+        return m_channelSamples;
+    }
+    m_channelRevision = m_revision;
+    m_channelIn = in;
+    m_channelOut = out;
+    m_channelSamples.resize(width);
+    double frameFactor = (double) (out - in) / width;
+    const QByteArray name = m_inTimeline.toUtf8();
+    for (int i = 0; i < width; i++) {
+        m_channelSamples[i] = m_keyProperties.anim_get_rect(name.constData(), (int) (i * frameFactor) + in);
+    }
+    return m_channelSamples;
+}
+
 void KeyframeView::drawKeyFrames(QRectF br, int length, bool active, QPainter *painter, const QTransform &transformation)
 {
     if (duration == 0 || m_keyframeType == NoKeyframe || !m_keyAnim.is_valid() || m_keyAnim.key_count() < 1)
@@ -139,55 +226,16 @@ void KeyframeView::drawKeyFrames(QRectF br, int length, bool active, QPainter *p
             // this is probably an animated rect
             continue;
         }
-        Mlt::Animation drawAnim = m_keyProperties.get_animation(paramName.toUtf8().constData());
-        if (!drawAnim.is_valid()) continue;
-        QPainterPath path;
-        int frame = drawAnim.key_get_frame(0);
-        double value = m_keyProperties.anim_get_double(paramName.toUtf8().constData(), frame, duration - m_offset);
-        QPointF start = keyframePoint(br, frame + m_offset, value, info.factor, info.min, info.max);
-        path.moveTo(br.x(), br.bottom());
-        path.lineTo(br.x(), start.y());
-        path.lineTo(start);
+        const CurveCache &curve = cachedCurve(br, paramName, info);
+        if (curve.frames.isEmpty()) continue;
         painter->setPen(paramName == m_inTimeline ? QColor(Qt::white) : Qt::NoPen);
-        for(int i = 0; i < drawAnim.key_count(); ++i) {
-            if (active && paramName == m_inTimeline) {
-                painter->setBrush((drawAnim.key_get_frame(i) == activeKeyframe) ? QColor(Qt::red) : QColor(Qt::blue));
-                painter->drawEllipse(QRectF(transformation.map(start) - h/2, transformation.map(start) + h / 2));
-            }
-            if (i + 1 < drawAnim.key_count()) {
-                frame = drawAnim.key_get_frame(i + 1);
-                value = m_keyProperties.anim_get_double(paramName.toUtf8().constData(), frame, duration - m_offset);
-                QPointF end = keyframePoint(br, frame + m_offset, value, info.factor, info.min, info.max);
-                //QPointF end = keyframePoint(br, i + 1);
-                switch (drawAnim.key_get_type(i)) {
-                    case mlt_keyframe_discrete:
-                        path.lineTo(end.x(), start.y());
-                        path.lineTo(end);
-                        break;
-                    case mlt_keyframe_linear:
-                        path.lineTo(end);
-                        break;
-                    case mlt_keyframe_smooth:
-                        frame = drawAnim.key_get_frame(qMax(i - 1, 0));
-                        value = m_keyProperties.anim_get_double(paramName.toUtf8().constData(), frame, duration - m_offset);
-                        QPointF pre = keyframePoint(br, frame, value, info.factor, info.min, info.max);
-                        frame = drawAnim.key_get_frame(qMin(i + 2, drawAnim.key_count() - 1));
-                        value = m_keyProperties.anim_get_double(paramName.toUtf8().constData(), frame, duration - m_offset);
-                        QPointF post = keyframePoint(br, frame, value, info.factor, info.min, info.max);
-                        QPointF c1 = (end - pre) / 6.0; // + start
-                        QPointF c2 = (start - post) / 6.0; // + end
-                        double mid = (end.x() - start.x()) / 2;
-                        if (c1.x() >  mid) c1 = c1 * mid / c1.x(); // scale down tangent vector to not go beyond middle
-                        if (c2.x() < -mid) c2 = c2 * -mid / c2.x();
-                        path.cubicTo(start + c1, end + c2, end);
-                        break;
-                }
-                start = end;
-            } else {
-                path.lineTo(br.right(), start.y());
+        if (active && paramName == m_inTimeline) {
+            for (int i = 0; i < curve.frames.count(); ++i) {
+                painter->setBrush((curve.frames.at(i) == activeKeyframe) ? QColor(Qt::red) : QColor(Qt::blue));
+                QPointF k = transformation.map(curve.points.at(i));
+                painter->drawEllipse(QRectF(k - h/2, k + h / 2));
             }
         }
-        path.lineTo(br.right(), br.bottom());
         if (paramName == m_inTimeline) {
             QColor col(Qt::white);
             col.setAlpha(active ? 120 : 80);
@@ -217,12 +265,12 @@ void KeyframeView::drawKeyFrames(QRectF br, int length, bool active, QPainter *p
             col.setAlpha(80);
             painter->setBrush(col);
         }
-        painter->drawPath(transformation.map(path));
+        painter->drawPath(transformation.map(curve.path));
     }
     painter->restore();
 }
 
-void KeyframeView::drawKeyFrameChannels(QRectF br, int in, int out, QPainter *painter, QList <QPoint> maximas, int limitKeyframes, QColor textColor)
+void KeyframeView::drawKeyFrameChannels(QRectF br, int in, int out, QPainter *painter, QList <QPoint> maximas, int limitKeyframes, QColor textColor, const QVector <int> &keptFrames)
 {
     double frameFactor = (double) (out - in) / br.width();
     int offset = 1;
@@ -274,40 +322,49 @@ void KeyframeView::drawKeyFrameChannels(QRectF br, int in, int out, QPainter *pa
         painter->drawText(txtRect, 0, i18n("Height") + QString(" (%1-%2)").arg(maximas.at(3).x()).arg(maximas.at(3).y()), &drawnText);
     }
 
-    // Draw curves
-    for (int i = 0; i < br.width(); i++) {
-        mlt_rect rect = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), (int) (i * frameFactor) + in);
+    // Draw curves from the per column samples, one batch of lines per channel
+    const QVector <mlt_rect> &samples = cachedChannels(qMax(0, (int) br.width()), in, out);
+    QVector <QLine> linesX;
+    QVector <QLine> linesY;
+    QVector <QLine> linesW;
+    QVector <QLine> linesH;
+    for (int i = 0; i < samples.count(); i++) {
+        const mlt_rect &rect = samples.at(i);
         if (xDist > 0) {
-            painter->setPen(cX);
             int val = (rect.x - xOffset) * maxHeight / xDist;
-            painter->drawLine(i, maxHeight - val, i, maxHeight);
+            linesX << QLine(i, maxHeight - val, i, maxHeight);
         }
         if (yDist > 0) {
-            painter->setPen(cY);
             int val = (rect.y - yOffset) * maxHeight / yDist;
-            painter->drawLine(i, maxHeight - val, i, maxHeight);
+            linesY << QLine(i, maxHeight - val, i, maxHeight);
         }
         if (wDist > 0) {
-            painter->setPen(cW);
             int val = (rect.w - wOffset) * maxHeight / wDist;
-            painter->drawLine(i, maxHeight - val, i, maxHeight);
+            linesW << QLine(i, maxHeight - val, i, maxHeight);
         }
         if (hDist > 0) {
-            painter->setPen(cH);
             int val = (rect.h - hOffset) * maxHeight / hDist;
-            painter->drawLine(i, maxHeight - val, i, maxHeight);
+            linesH << QLine(i, maxHeight - val, i, maxHeight);
         }
     }
+    painter->setPen(cX);
+    painter->drawLines(linesX);
+    painter->setPen(cY);
+    painter->drawLines(linesY);
+    painter->setPen(cW);
+    painter->drawLines(linesW);
+    painter->setPen(cH);
+    painter->drawLines(linesH);
     if (offset > 1) {
         // Overlay limited keyframes curve
         cX.setAlpha(255);
         cY.setAlpha(255);
         cW.setAlpha(255);
         cH.setAlpha(255);
-        mlt_rect rect1 = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), in);
+        mlt_rect rect1 = samples.isEmpty() ? m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), in) : samples.first();
         int prevPos = 0;
-        for (int i = offset; i < br.width(); i+= offset) {
-            mlt_rect rect2 = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), (int) (i * frameFactor) + in);
+        for (int i = offset; i < samples.count(); i+= offset) {
+            mlt_rect rect2 = samples.at(i);
             if (xDist > 0) {
                 painter->setPen(cX);
                 int val1 = (rect1.x - xOffset) * maxHeight / xDist;
@@ -335,10 +392,48 @@ void KeyframeView::drawKeyFrameChannels(QRectF br, int in, int out, QPainter *pa
             rect1 = rect2;
             prevPos =i;
         }
+    } else if (keptFrames.count() > 1) {
+        // Overlay simplified keyframes curve
+        cX.setAlpha(255);
+        cY.setAlpha(255);
+        cW.setAlpha(255);
+        cH.setAlpha(255);
+        mlt_rect rect1 = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), keptFrames.first());
+        int prevPos = (keptFrames.first() - in) / frameFactor;
+        for (int j = 1; j < keptFrames.count(); j++) {
+            int i = (keptFrames.at(j) - in) / frameFactor;
+            mlt_rect rect2 = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), keptFrames.at(j));
+            if (xDist > 0) {
+                painter->setPen(cX);
+                int val1 = (rect1.x - xOffset) * maxHeight / xDist;
+                int val2 = (rect2.x - xOffset) * maxHeight / xDist;
+                painter->drawLine(prevPos, maxHeight - val1, i, maxHeight - val2);
+            }
+            if (yDist > 0) {
+                painter->setPen(cY);
+                int val1 = (rect1.y - yOffset) * maxHeight / yDist;
+                int val2 = (rect2.y - yOffset) * maxHeight / yDist;
+                painter->drawLine(prevPos, maxHeight - val1, i, maxHeight - val2);
+            }
+            if (wDist > 0) {
+                painter->setPen(cW);
+                int val1 = (rect1.w - wOffset) * maxHeight / wDist;
+                int val2 = (rect2.w - wOffset) * maxHeight / wDist;
+                painter->drawLine(prevPos, maxHeight - val1, i, maxHeight - val2);
+            }
+            if (hDist > 0) {
+                painter->setPen(cH);
+                int val1 = (rect1.h - hOffset) * maxHeight / hDist;
+                int val2 = (rect2.h - hOffset) * maxHeight / hDist;
+                painter->drawLine(prevPos, maxHeight - val1, i, maxHeight - val2);
+            }
+            rect1 = rect2;
+            prevPos = i;
+        }
     }
 }
 
-QString KeyframeView::getSingleAnimation(int ix, int in, int out, int offset, int limitKeyframes, QPoint maximas, double min, double max)
+QString KeyframeView::getSingleAnimation(int ix, int in, int out, int offset, int limitKeyframes, QPoint maximas, double min, double max, const QVector <int> &keptFrames)
 {
     m_keyProperties.set("kdenlive_import", "");
     int newduration = out - in + offset;
@@ -390,6 +485,30 @@ QString KeyframeView::getSingleAnimation(int ix, int in, int out, int offset, in
             value = value * factor + min;
             m_keyProperties.anim_set("kdenlive_import", value, offset + i, newduration, mlt_keyframe_smooth);
         }
+    } else if (!keptFrames.isEmpty()) {
+        // Only use the keyframes kept by simplification
+        foreach (int pos, keptFrames) {
+            rect = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), pos, duration);
+            switch (ix) {
+                case 1:
+                    value = rect.y;
+                    break;
+                case 2:
+                    value = rect.w;
+                    break;
+                case 3:
+                    value = rect.h;
+                    break;
+                default:
+                    value = rect.x;
+                    break;
+            }
+            if (maximas.x() > 0) {
+                value -= maximas.x();
+            }
+            value = value * factor + min;
+            m_keyProperties.anim_set("kdenlive_import", value, offset + pos - in, newduration, mlt_keyframe_linear);
+        }
     } else {
         int next = m_keyAnim.next_key(in + 1);
         while (next < out && next > 0) {
@@ -421,7 +540,7 @@ QString KeyframeView::getSingleAnimation(int ix, int in, int out, int offset, in
     return result;
 }
 
-QString KeyframeView::getOffsetAnimation(int in, int out, int offset, int limitKeyframes, ProfileInfo profile, bool allowAnimation, bool positionOnly, QPoint rectOffset)
+QString KeyframeView::getOffsetAnimation(int in, int out, int offset, int limitKeyframes, ProfileInfo profile, bool allowAnimation, bool positionOnly, QPoint rectOffset, const QVector <int> &keptFrames)
 {
     m_keyProperties.set("kdenlive_import", "");
     int newduration = out - in + offset;
@@ -456,6 +575,21 @@ QString KeyframeView::getOffsetAnimation(int in, int out, int offset, int limitK
             }
             m_keyProperties.anim_set("kdenlive_import", rect, offset + i, newduration, kftype);
         }
+    } else if (!keptFrames.isEmpty()) {
+        // Only use the keyframes kept by simplification
+        foreach (int pos, keptFrames) {
+            rect = m_keyProperties.anim_get_rect(m_inTimeline.toUtf8().constData(), pos, duration);
+            rect.x = (int) rect.x;
+            rect.y = (int) rect.y;
+            if (positionOnly) {
+                rect.x -= rectOffset.x();
+                rect.y -= rectOffset.y();
+                rect.w = pWidth;
+                rect.h = pHeight;
+                rect.o = 100;
+            }
+            m_keyProperties.anim_set("kdenlive_import", rect, offset + pos - in, newduration, kftype);
+        }
     } else {
         int pos;
         for(int i = 0; i < m_keyAnim.key_count(); ++i) {
@@ -478,6 +612,82 @@ QString KeyframeView::getOffsetAnimation(int in, int out, int offset, int limitK
     return result;
 }
 
+KeyframeSamples KeyframeView::sampleKeyframes(int in, int out)
+{
+    KeyframeSamples samples;
+    const QByteArray name = m_inTimeline.toUtf8();
+    samples.frames << in;
+    samples.values << m_keyProperties.anim_get_rect(name.constData(), in, duration);
+    int next = m_keyAnim.next_key(in + 1);
+    while (next < out && next > samples.frames.last()) {
+        samples.frames << next;
+        samples.values << m_keyProperties.anim_get_rect(name.constData(), next, duration);
+        next = m_keyAnim.next_key(next + 1);
+    }
+    if (out > in) {
+        samples.frames << out;
+        samples.values << m_keyProperties.anim_get_rect(name.constData(), out, duration);
+    }
+    return samples;
+}
+
+// static
+KeyframeSimplification KeyframeView::simplifyKeyframes(const KeyframeSamples &samples, int channels, double tolerance)
+{
+    KeyframeSimplification result;
+    result.error = 0;
+    int count = samples.frames.count();
+    result.sourceCount = count;
+    if (count < 3) {
+        result.frames = samples.frames;
+        return result;
+    }
+    QVector <bool> keep(count, false);
+    keep[0] = true;
+    keep[count - 1] = true;
+    // Segments still to check, processed without recursion to handle very long tracking data
+    QVector <QPair <int, int> > segments;
+    segments << qMakePair(0, count - 1);
+    while (!segments.isEmpty()) {
+        QPair <int, int> segment = segments.takeLast();
+        int first = segment.first;
+        int last = segment.second;
+        if (last - first < 2) {
+            continue;
+        }
+        const mlt_rect &r1 = samples.values.at(first);
+        const mlt_rect &r2 = samples.values.at(last);
+        double length = samples.frames.at(last) - samples.frames.at(first);
+        double maxDistance = 0;
+        int farthest = first;
+        for (int i = first + 1; i < last; i++) {
+            // Deviation from the linear interpolation between both ends
+            double t = (samples.frames.at(i) - samples.frames.at(first)) / length;
+            const mlt_rect &r = samples.values.at(i);
+            double distance = 0;
+            if (channels & ChannelX) distance = qMax(distance, qAbs(r.x - (r1.x + (r2.x - r1.x) * t)));
+            if (channels & ChannelY) distance = qMax(distance, qAbs(r.y - (r1.y + (r2.y - r1.y) * t)));
+            if (channels & ChannelWidth) distance = qMax(distance, qAbs(r.w - (r1.w + (r2.w - r1.w) * t)));
+            if (channels & ChannelHeight) distance = qMax(distance, qAbs(r.h - (r1.h + (r2.h - r1.h) * t)));
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+        if (maxDistance > tolerance) {
+            keep[farthest] = true;
+            segments << qMakePair(first, farthest) << qMakePair(farthest, last);
+        } else {
+            result.error = qMax(result.error, maxDistance);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (keep.at(i)) {
+            result.frames << samples.frames.at(i);
+        }
+    }
+    return result;
+}
 
 int KeyframeView::mouseOverKeyFrames(QRectF br, QPointF pos, double scale)
 {
@@ -535,6 +745,7 @@ void KeyframeView::updateKeyFramePos(QRectF br, int frame, const double y)
     double newval = keyframeUnmap(br, y);
     mlt_keyframe_type type = m_keyAnim.keyframe_type(activeKeyframe);
     m_keyProperties.anim_set(m_inTimeline.toUtf8().constData(), newval, newpos, duration - m_offset, type);
+    m_revision++;
     if (activeKeyframe != newpos) {
         m_keyAnim.remove(activeKeyframe);
         // Move keyframe in other geometries
@@ -591,6 +802,7 @@ mlt_keyframe_type KeyframeView::type(int frame)
 
 void KeyframeView::addKeyframe(int frame, double value, mlt_keyframe_type type)
 {
+    m_revision++;
     m_keyProperties.anim_set(m_inTimeline.toUtf8().constData(), value, frame - m_offset, duration - m_offset, type);
     // Last keyframe should stick to end
     if (frame == duration - 1) {
@@ -619,6 +831,7 @@ void KeyframeView::addKeyframe(int frame, double value, mlt_keyframe_type type)
 
 void KeyframeView::addDefaultKeyframe(ProfileInfo profile, int frame, mlt_keyframe_type type)
 {
+    m_revision++;
     double value = m_keyframeDefault;
     if (m_keyAnim.key_count() == 1 && frame != m_keyAnim.key_get_frame(0)) {
 	value = m_keyProperties.anim_get_double(m_inTimeline.toUtf8().constData(), m_keyAnim.key_get_frame(0), duration - m_offset);
@@ -661,6 +874,7 @@ void KeyframeView::addDefaultKeyframe(ProfileInfo profile, int frame, mlt_keyfra
 
 void KeyframeView::removeKeyframe(int frame)
 {
+    m_revision++;
     m_keyAnim.remove(frame);
     if (frame == duration - 1 && frame == attachToEnd) {
         attachToEnd = -2;
@@ -715,6 +929,7 @@ void KeyframeView::editKeyframeType(int type)
         // This is a keyframe
         double val = m_keyProperties.anim_get_double(m_inTimeline.toUtf8().constData(), activeKeyframe, duration - m_offset);
         m_keyProperties.anim_set(m_inTimeline.toUtf8().constData(), val, activeKeyframe, duration - m_offset, (mlt_keyframe_type) type);
+        m_revision++;
     }
 }
 
@@ -765,6 +980,7 @@ QList <QPoint> KeyframeView::loadKeyframes(const QString &data)
 {
     QList <QPoint> result;
     m_keyframeType = NoKeyframe;
+    m_revision++;
     m_inTimeline = QStringLiteral("imported");
     m_keyProperties.set(m_inTimeline.toUtf8().constData(), data.toUtf8().constData());
     // We need to initialize with length so that negative keyframes are correctly interpreted
@@ -823,6 +1039,7 @@ QList <QPoint> KeyframeView::loadKeyframes(const QString &data)
 bool KeyframeView::loadKeyframes(const QLocale locale, QDomElement effect, int cropStart, int length)
 {
     m_keyframeType = NoKeyframe;
+    m_revision++;
     duration = length;
     m_inTimeline.clear();
     // reset existing properties
@@ -893,6 +1110,7 @@ void KeyframeView::setOffset(int frames)
 {
     if (m_useOffset) {
         m_offset -= frames;
+        m_revision++;
     }
 }
 
@@ -925,6 +1143,7 @@ void KeyframeView::reset()
 	return;
     }
     m_keyframeType = NoKeyframe;
+    m_revision++;
     duration = 0;
     attachToEnd = -2;
     activeKeyframe = -1;
@@ -938,6 +1157,22 @@ void KeyframeView::reset()
 //static
 QString KeyframeView::cutAnimation(const QString &animation, int start, int duration, int fullduration, bool doCut)
 {
+    KeyframeAnimation keys;
+    if (keys.parse(animation, fullduration) && keys.count() > 0) {
+        int end = start + duration;
+        if (start > 0 && keys.keyIndex(start) < 0) {
+            // insert new keyframe at start
+            keys.setKey(start, keys.valueAt(start), keys.typeAt(start));
+        }
+        if (keys.keyIndex(end) < 0) {
+            keys.setKey(end, keys.valueAt(end), keys.typeAt(end));
+        }
+        if (!doCut) {
+            return keys.serialize(0, fullduration);
+        }
+        return keys.serialize(start, end);
+    }
+    // Time string positions, let MLT handle them
     Mlt::Properties props;
     props.set("keyframes", animation.toUtf8().constData());
     props.anim_get_double("keyframes", 0, fullduration);
@@ -29,8 +29,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mlt++/MltProperties.h"
 #include "mlt++/MltAnimation.h"
 
+#include <QVector>
+#include <QHash>
+#include <QPainterPath>
+
 class QAction;
 
+/** @brief Keyframe positions and values of an imported animation */
+struct KeyframeSamples {
+    QVector <int> frames;
+    QVector <mlt_rect> values;
+};
+
+/** @brief Result of a keyframe simplification: kept frames and largest deviation of dropped keyframes */
+struct KeyframeSimplification {
+    QVector <int> frames;
+    double error;
+    int sourceCount;
+};
+
 /**
  * @class KeyframeView
  * @brief Provides functionality for displaying and managing animation keyframes in timeline.
@@ -51,6 +68,14 @@ public:
         AnimatedKeyframe
     };
 
+    /** @brief Channels of a rect animation, used as flags for keyframe simplification */
+    enum KeyframeChannel {
+        ChannelX = 1,
+        ChannelY = 2,
+        ChannelWidth = 4,
+        ChannelHeight = 8
+    };
+
     explicit KeyframeView(int handleSize, QObject *parent = 0);
     virtual ~KeyframeView();
 
@@ -88,7 +113,7 @@ public:
       */
     void drawKeyFrames(QRectF br, int length, bool active, QPainter *painter, const QTransform &transformation);
     /** @brief Draw the x, y, w, h channels of an animated geometry */
-    void drawKeyFrameChannels(QRectF br, int in, int out, QPainter *painter, QList <QPoint> maximas, int limitKeyframes, QColor textColor);
+    void drawKeyFrameChannels(QRectF br, int in, int out, QPainter *painter, QList <QPoint> maximas, int limitKeyframes, QColor textColor, const QVector <int> &keptFrames = QVector <int>());
     int mouseOverKeyFrames(QRectF br, QPointF pos, double scale);
     void showMenu(QWidget *parent, QPoint pos);
     QAction *parseKeyframeActions(QList <QAction *>actions);
@@ -99,10 +124,17 @@ public:
     bool activeParam(const QString &name) const;
     /** @brief Sets a temporary offset for drawing keyframes when resizing clip start */
     void setOffset(int frames);
-    /** @brief Returns a copy of the original anim, with a crop zone (in/out), frame offset, max number of keyframes, and value mapping */
-    QString getSingleAnimation(int ix, int in, int out, int offset, int limitKeyframes, QPoint maximas, double min, double max);
+    /** @brief Returns a copy of the original anim, with a crop zone (in/out), frame offset, max number of keyframes, and value mapping.
+     *  If keptFrames is not empty, only these source keyframes are used */
+    QString getSingleAnimation(int ix, int in, int out, int offset, int limitKeyframes, QPoint maximas, double min, double max, const QVector <int> &keptFrames = QVector <int>());
     /** @brief Returns a copy of the original anim, with a crop zone (in/out) and frame offset */
-    QString getOffsetAnimation(int in, int out, int offset, int limitKeyframes, ProfileInfo profile, bool allowAnimation, bool positionOnly, QPoint rectOffset);
+    QString getOffsetAnimation(int in, int out, int offset, int limitKeyframes, ProfileInfo profile, bool allowAnimation, bool positionOnly, QPoint rectOffset, const QVector <int> &keptFrames = QVector <int>());
+    /** @brief Returns the imported keyframes between in and out, with values at in and out */
+    KeyframeSamples sampleKeyframes(int in, int out);
+    /** @brief Drops keyframes that can be linearly interpolated from their neighbours within tolerance (Ramer-Douglas-Peucker).
+     *  @param channels the KeyframeChannel flags to check
+     *  Does not access any member, so it can run in a thread. */
+    static KeyframeSimplification simplifyKeyframes(const KeyframeSamples &samples, int channels, double tolerance);
 	
 private:
     Mlt::Properties m_keyProperties;
@@ -128,6 +160,26 @@ private:
         QString defaultValue;
     };
     QMap <QString, ParameterInfo> m_paramInfos;
+    /** @brief Keyframe positions, handle points and filled curve of a parameter, in clip coordinates */
+    struct CurveCache {
+        QVector <int> frames;
+        QVector <QPointF> points;
+        QPainterPath path;
+    };
+    /** @brief Incremented on every change of the animations, invalidates the cached curves */
+    int m_revision;
+    int m_curveRevision;
+    QRectF m_curveRect;
+    int m_curveDuration;
+    QHash <QString, CurveCache> m_curves;
+    int m_channelRevision;
+    int m_channelIn;
+    int m_channelOut;
+    QVector <mlt_rect> m_channelSamples;
+    /** @brief Returns the curve of paramName for the bounding rect br, rebuilt only when the animation or geometry changed */
+    const CurveCache &cachedCurve(QRectF br, const QString &paramName, const ParameterInfo &info);
+    /** @brief Returns the edited rect animation sampled once per pixel column between in and out */
+    const QVector <mlt_rect> &cachedChannels(int width, int in, int out);
 
 signals:
     void updateKeyframes(const QRectF &r = QRectF());
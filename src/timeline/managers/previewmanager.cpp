@@ -22,11 +22,26 @@
 #include "../customruler.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
+#include "doc/cacheindex.h"
 
+#include <mlt++/Mlt.h>
 #include <KLocalizedString>
 #include <QtConcurrent>
 #include <QStandardPaths>
 #include <QProcess>
+#include <QThread>
+#include <QCryptographicHash>
+
+// Number of outdated chunks kept on disk so that undo can reuse them
+#define MAX_UNUSED_CHUNKS 200
+// Maximum number of chunks rendered in one file, for chunks showing one clip without effects
+#define MAX_GROUPED_CHUNKS 8
+// Number of outdated frozen track renders kept on disk, they are much bigger than chunks
+#define MAX_UNUSED_FROZEN 10
+// Encoding of the frozen track renders, lossless with transparency and audio so that the track composites and mixes as before
+#define FREEZE_PARAMS "f=mov vcodec=png pix_fmt=rgba mlt_image_format=rgb24a acodec=pcm_s16le"
+// Extension of the frozen track renders, with a suffix so that they are not taken for chunks
+#define FREEZE_EXTENSION "frozen.mov"
 
 
 
@@ -37,6 +52,7 @@ PreviewManager::PreviewManager(KdenliveDoc *doc, CustomRuler *ruler, Mlt::Tracto
     , m_previewTrack(NULL)
     , m_initialized(false)
     , m_abortPreview(false)
+    , m_abortFreeze(false)
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
@@ -46,14 +62,24 @@ PreviewManager::~PreviewManager()
 {
     if (m_initialized) {
         abortRendering();
-        if (m_undoDir.dirName() == QLatin1String("undo"))
-            m_undoDir.removeRecursively();
+        if (m_freezeThread.isRunning()) {
+            m_abortFreeze = true;
+            emit abortFreeze();
+            m_freezeThread.waitForFinished();
+        }
         if ((m_doc->url().isEmpty() && m_cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).count() == 0) || m_cacheDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).count() == 0) {
-            if (m_cacheDir.dirName() == QLatin1String("preview"))
+            if (m_cacheDir.dirName() == QLatin1String("preview")) {
                 m_cacheDir.removeRecursively();
+                CacheIndex::folderRemoved(m_cacheDir.absolutePath());
+            }
         }
     }
     delete m_previewTrack;
+    // The tractor is closed with the timeline, only release our references
+    foreach(const FrozenTrack &frozen, m_frozenTracks) {
+        delete frozen.original;
+        delete frozen.playlist;
+    }
 }
 
 bool PreviewManager::initialize()
@@ -75,7 +101,7 @@ bool PreviewManager::initialize()
         m_doc->displayMessage(i18n("Cannot create folder %1", m_cacheDir.absolutePath()), ErrorMessage);
         return false;
     }
-    if (kdenliveCacheDir.isEmpty() || m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir() || (!m_cacheDir.exists("undo") && !m_cacheDir.mkdir("undo"))) {
+    if (kdenliveCacheDir.isEmpty() || m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir()) {
         m_doc->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absoluteFilePath(documentId)), ErrorMessage);
         return false;
     }
@@ -83,21 +109,28 @@ bool PreviewManager::initialize()
         m_doc->displayMessage(i18n("Invalid timeline preview parameters"), ErrorMessage);
         return false;
     }
-    m_undoDir = QDir(m_cacheDir.absoluteFilePath("undo"));
-
-    // Make sure our cache dirs are inside the temporary folder
-    if (!m_cacheDir.makeAbsolute() || !m_undoDir.makeAbsolute() || !m_cacheDir.absolutePath().startsWith(kdenliveCacheDir) || !m_undoDir.absolutePath().startsWith(kdenliveCacheDir)) {
+    // Make sure our cache dir is inside the temporary folder
+    if (!m_cacheDir.makeAbsolute() || !m_cacheDir.absolutePath().startsWith(kdenliveCacheDir)) {
         m_doc->displayMessage(i18n("Something is wrong with cache folders"), ErrorMessage);
         return false;
     }
+    // Chunks are now content addressed, previous versions kept an undo history of chunks
+    QDir legacyUndoDir = m_cacheDir;
+    if (legacyUndoDir.cd(QStringLiteral("undo")) && legacyUndoDir.dirName() == QLatin1String("undo")) {
+        legacyUndoDir.removeRecursively();
+    }
 
     connect(this, &PreviewManager::cleanupOldPreviews, this, &PreviewManager::doCleanupOldPreviews);
-    connect(m_doc, &KdenliveDoc::removeInvalidUndo, this, &PreviewManager::slotRemoveInvalidUndo, Qt::DirectConnection);
     m_previewTimer.setSingleShot(true);
     m_previewTimer.setInterval(3000);
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
     connect(this, &PreviewManager::previewRender, this, &PreviewManager::gotPreviewRender);
+    connect(this, &PreviewManager::draftRender, this, &PreviewManager::gotDraftRender);
     connect(&m_previewGatherTimer, &QTimer::timeout, this, &PreviewManager::slotProcessDirtyChunks);
+    m_freezeTimer.setSingleShot(true);
+    m_freezeTimer.setInterval(1000);
+    connect(&m_freezeTimer, &QTimer::timeout, this, &PreviewManager::startFreezeRender);
+    connect(this, &PreviewManager::frozenTrackRendered, this, &PreviewManager::gotFrozenTrack);
     m_initialized = true;
     return true;
 }
@@ -114,33 +147,318 @@ bool PreviewManager::buildPreviewTrack()
     return true;
 }
 
-void PreviewManager::loadChunks(QStringList previewChunks, QStringList dirtyChunks, QDateTime documentDate)
+void PreviewManager::loadChunks(QStringList previewChunks, QStringList dirtyChunks)
 {
+    QStringList usedFiles;
+    m_tractor->lock();
+    int offset;
     foreach (const QString frame, previewChunks) {
-        const QString fileName = m_cacheDir.absoluteFilePath(QString("%1.%2").arg(frame).arg(m_extension));
-        QFile file(fileName);
-        if (file.exists()) {
-            if (!documentDate.isNull() && QFileInfo(file).lastModified() > documentDate) {
-                // Timeline preview file was created after document, invalidate
-                file.remove();
-                dirtyChunks << frame;
-            } else {
-                gotPreviewRender(frame.toInt(), fileName, 1000);
-            }
+        const QString hash = chunkHash(frame.toInt());
+        if (!chunkFile(hash, offset).isEmpty()) {
+            m_chunkHashes.insert(frame.toInt(), hash);
         } else {
             dirtyChunks << frame;
         }
     }
-    if (!dirtyChunks.isEmpty()) {
-        QList <int> list;
-        foreach(const QString i, dirtyChunks) {
-            list << i.toInt();
+    m_tractor->unlock();
+    QMapIterator<int, QString> i(m_chunkHashes);
+    while (i.hasNext()) {
+        i.next();
+        const QString file = chunkFile(i.value(), offset);
+        usedFiles << QFileInfo(file).fileName() << chunkRefName(i.value());
+        gotPreviewRender(i.key(), file, 1000);
+    }
+    // Dirty chunks play their draft if it matches the current content
+    QList <int> list;
+    foreach(const QString i, dirtyChunks) {
+        list << i.toInt();
+    }
+    QList <int> drafts;
+    if (!list.isEmpty() && KdenliveSettings::previewdrafts()) {
+        m_tractor->lock();
+        foreach(int frame, list) {
+            const QString hash = chunkHash(frame);
+            if (m_cacheDir.exists(chunkFileName(draftHash(hash)))) {
+                m_chunkHashes.insert(frame, hash);
+                usedFiles << chunkFileName(draftHash(hash));
+                drafts << frame;
+            }
+        }
+        m_tractor->unlock();
+    }
+    // Chunks not matching the current timeline content will be removed on next cleanup
+    QStringList files = m_cacheDir.entryList(QStringList() << QStringLiteral("*.") + m_extension << QStringLiteral("*.ref"), QDir::Files, QDir::Time | QDir::Reversed);
+    foreach(const QString &file, files) {
+        if (!usedFiles.contains(file) && !file.endsWith(QStringLiteral(FREEZE_EXTENSION))) {
+            m_unusedChunks << QFileInfo(file).completeBaseName();
         }
+    }
+    if (!list.isEmpty()) {
         m_ruler->addChunks(list, true);
+        if (m_previewTrack && !drafts.isEmpty()) {
+            m_tractor->lock();
+            foreach(int frame, drafts) {
+                loadDraft(frame);
+            }
+            m_tractor->unlock();
+        }
         m_ruler->update();
     }
 }
 
+const QMap <int, QString> PreviewManager::renderedChunks()
+{
+    QMap <int, QString> chunks;
+    QMutexLocker lock(&m_previewMutex);
+    const QList <int> dirty = m_ruler->getDirtyChunks();
+    foreach(int frame, m_ruler->getProcessedChunks()) {
+        if (dirty.contains(frame) || !m_chunkHashes.contains(frame)) continue;
+        const QString fileName = chunkFileName(m_chunkHashes.value(frame));
+        if (m_cacheDir.exists(fileName)) {
+            chunks.insert(frame, m_cacheDir.absoluteFilePath(fileName));
+        }
+    }
+    return chunks;
+}
+
+const QStringList PreviewManager::consumerParams() const
+{
+    return m_consumerParams;
+}
+
+const QString PreviewManager::extension() const
+{
+    return m_extension;
+}
+
+const QString PreviewManager::chunkFileName(const QString &hash) const
+{
+    return QString("%1.%2").arg(hash).arg(m_extension);
+}
+
+const QString PreviewManager::chunkRefName(const QString &hash) const
+{
+    return QString("%1.ref").arg(hash);
+}
+
+bool PreviewManager::readChunkRef(const QString &hash, QString &group, int &offset)
+{
+    QMutexLocker lock(&m_refMutex);
+    if (!m_chunkRefs.contains(hash)) {
+        QFile ref(m_cacheDir.absoluteFilePath(chunkRefName(hash)));
+        if (!ref.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        const QStringList data = QString::fromLatin1(ref.readAll()).split(QLatin1Char(' '));
+        if (data.count() != 2) {
+            return false;
+        }
+        m_chunkRefs.insert(hash, qMakePair(data.at(0), data.at(1).toInt()));
+    }
+    group = m_chunkRefs.value(hash).first;
+    offset = m_chunkRefs.value(hash).second;
+    return true;
+}
+
+const QString PreviewManager::chunkFile(const QString &hash, int &offset)
+{
+    offset = 0;
+    const QString fileName = chunkFileName(hash);
+    if (m_cacheDir.exists(fileName)) {
+        return m_cacheDir.absoluteFilePath(fileName);
+    }
+    QString group;
+    if (readChunkRef(hash, group, offset) && m_cacheDir.exists(chunkFileName(group))) {
+        return m_cacheDir.absoluteFilePath(chunkFileName(group));
+    }
+    offset = 0;
+    return QString();
+}
+
+void PreviewManager::removeChunkFile(const QString &hash, const QStringList &used)
+{
+    CacheIndex::removeFile(m_cacheDir.absoluteFilePath(chunkFileName(hash)));
+    QString group;
+    int offset;
+    if (!readChunkRef(hash, group, offset)) {
+        return;
+    }
+    QFile::remove(m_cacheDir.absoluteFilePath(chunkRefName(hash)));
+    QMutexLocker lock(&m_refMutex);
+    m_chunkRefs.remove(hash);
+    // The group file is kept as long as another chunk in use was rendered in it
+    QMapIterator<QString, QPair <QString, int> > i(m_chunkRefs);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().first == group && used.contains(i.key())) {
+            return;
+        }
+    }
+    CacheIndex::removeFile(m_cacheDir.absoluteFilePath(chunkFileName(group)));
+}
+
+int PreviewManager::maxGroupedChunks(int cost)
+{
+    if (!KdenliveSettings::adaptivepreviewchunks()) {
+        return 1;
+    }
+    // Unmodified cuts get long chunks, heavily processed content stays in short chunks that are quick to render again
+    return qBound(1, MAX_GROUPED_CHUNKS / qMax(1, cost), MAX_GROUPED_CHUNKS);
+}
+
+int PreviewManager::effectCount(Mlt::Service &service)
+{
+    int count = 0;
+    for (int i = 0; i < service.filter_count(); i++) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        if (filter && filter->is_valid() && filter->get("kdenlive_id") && filter->get_int("disable") == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void PreviewManager::hashProperties(QCryptographicHash &hash, Mlt::Properties &properties, int offset)
+{
+    for (int i = 0; i < properties.count(); i++) {
+        QString name = properties.get_name(i);
+        if (name.startsWith(QLatin1Char('_')) || name.startsWith(QLatin1String("kdenlive")) || name.startsWith(QLatin1String("meta."))) {
+            // Internal, GUI only or probed properties
+            continue;
+        }
+        if (offset != 0 && (name == QLatin1String("in") || name == QLatin1String("out"))) {
+            // Position relative to the chunk
+            hash.addData(QString("%1=%2;").arg(name).arg(properties.get_int(i) - offset).toUtf8());
+        } else {
+            hash.addData(name.toUtf8());
+            hash.addData("=", 1);
+            hash.addData(properties.get(i));
+            hash.addData(";", 1);
+        }
+    }
+}
+
+void PreviewManager::hashFilters(QCryptographicHash &hash, Mlt::Service &service, bool audio)
+{
+    for (int i = 0; i < service.filter_count(); i++) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        if (!filter || !filter->is_valid()) {
+            continue;
+        }
+        // Audio is not part of the preview, and parameters of disabled filters do not change the result
+        if (!audio && filter->get_int("kdenlive:audio") == 1) {
+            continue;
+        }
+        hash.addData("filter:", 7);
+        if (filter->get_int("disable") == 1) {
+            hash.addData(filter->get("mlt_service"));
+            hash.addData(":disabled;", 10);
+            continue;
+        }
+        hashProperties(hash, *filter);
+    }
+}
+
+const QString PreviewManager::chunkHash(int frame, QString *layout, int *cost)
+{
+    int chunkEnd = frame + KdenliveSettings::timelinechunks() - 1;
+    if (layout) {
+        layout->clear();
+    }
+    if (cost) {
+        *cost = 0;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    Mlt::Profile *profile = m_tractor->profile();
+    hash.addData(QString("%1x%2:%3/%4:%5/%6;").arg(profile->width()).arg(profile->height()).arg(profile->frame_rate_num()).arg(profile->frame_rate_den()).arg(profile->sample_aspect_num()).arg(profile->sample_aspect_den()).toUtf8());
+    hash.addData(m_consumerParams.join(QLatin1Char(' ')).toUtf8());
+    hashFilters(hash, *m_tractor);
+    for (int i = 0; i < m_tractor->count(); i++) {
+        Mlt::Producer *track = m_tractor->track(i);
+        if (!track) {
+            continue;
+        }
+        if (strcmp(track->get("id"), "timeline_preview") == 0) {
+            delete track;
+            continue;
+        }
+        hash.addData(QString("track:%1;").arg(i).toUtf8());
+        // Audio is not part of the preview, so only video hidden tracks are skipped
+        if (track->get_int("hide") & 1) {
+            hash.addData("hidden;", 7);
+            delete track;
+            continue;
+        }
+        hashFilters(hash, *track);
+        Mlt::Playlist playlist(*track);
+        int startIx = playlist.get_clip_index_at(frame);
+        int endIx = playlist.get_clip_index_at(chunkEnd);
+        if (layout) {
+            // Chunks reading the same clips can be rendered together
+            layout->append(QString("track:%1:%2:%3;").arg(i).arg(startIx).arg(endIx));
+        }
+        if (cost) {
+            *cost += effectCount(*track);
+        }
+        for (int ix = startIx; ix <= endIx && ix < playlist.count(); ix++) {
+            if (playlist.is_blank(ix)) {
+                continue;
+            }
+            Mlt::ClipInfo *info = playlist.clip_info(ix);
+            if (!info) {
+                continue;
+            }
+            // Clip position is relative to the chunk so that moved clips keep their hash
+            hash.addData(QString("clip:%1:%2:%3;").arg(info->start - frame).arg(info->frame_in).arg(info->frame_out).toUtf8());
+            if (cost) {
+                *cost += 1;
+            }
+            if (info->producer) {
+                hashProperties(hash, *info->producer);
+                hashFilters(hash, *info->producer);
+                if (cost) {
+                    *cost += effectCount(*info->producer);
+                }
+            }
+            if (info->cut) {
+                hashFilters(hash, *info->cut);
+                if (cost) {
+                    *cost += effectCount(*info->cut);
+                }
+            }
+            Mlt::Playlist::delete_clip_info(info);
+        }
+        delete track;
+    }
+    // Transitions
+    QScopedPointer<Mlt::Field> field(m_tractor->field());
+    mlt_service nextservice = mlt_service_get_producer(field->get_service());
+    mlt_service_type mlt_type = mlt_service_identify(nextservice);
+    while (mlt_type == transition_type) {
+        Mlt::Transition transition((mlt_transition) nextservice);
+        nextservice = mlt_service_producer(nextservice);
+        int in = transition.get_in();
+        int out = transition.get_out();
+        if ((in == 0 && out == 0) || (in <= chunkEnd && out >= frame)) {
+            hash.addData(QString("transition:%1:%2;").arg(transition.get_a_track()).arg(transition.get_b_track()).toUtf8());
+            hashProperties(hash, transition, frame);
+            if (in != 0 || out != 0) {
+                // Track compositing transitions cover the whole timeline and are not counted
+                if (layout) {
+                    layout->append(QString("transition:%1:%2;").arg(in).arg(out));
+                }
+                if (cost) {
+                    *cost += 1;
+                }
+            }
+        }
+        if (nextservice == NULL)
+            break;
+        mlt_type = mlt_service_identify(nextservice);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
 void PreviewManager::deletePreviewTrack()
 {
     m_tractor->lock();
@@ -214,66 +532,36 @@ void PreviewManager::invalidatePreviews(QList <int> chunks)
         m_previewTimer.stop();
         timer = true;
     }
-    int stackIx = m_doc->commandStack()->index();
-    int stackMax = m_doc->commandStack()->count();
-    if (stackIx == stackMax && !m_undoDir.exists(QString::number(stackIx - 1))) {
-        // We just added a new command in stack, archive existing chunks
-        int ix = stackIx - 1;
-        m_undoDir.mkdir(QString::number(ix));
-        bool foundPreviews = false;
-        foreach(int i, chunks) {
-            QString current = QString("%1.%2").arg(i).arg(m_extension);
-            if (m_cacheDir.rename(current, QString("undo/%1/%2").arg(ix).arg(current))) {
-                foundPreviews = true;
-            }
-        }
-        if (!foundPreviews) {
-            // No preview files found, remove undo folder
-            m_undoDir.rmdir(QString::number(ix));
-        } else {
-            // new chunks archived, cleanup old ones
-            emit cleanupOldPreviews();
-        }
-    } else {
-        // Restore existing chunks, delete others
-        // Check if we just undo the last stack action, then backup, otherwise delete
-        bool lastUndo = false;
-        if (stackIx == stackMax - 1) {
-            if (!m_undoDir.exists(QString::number(stackMax))) {
-                lastUndo = true;
-                bool foundPreviews = false;
-                m_undoDir.mkdir(QString::number(stackMax));
-                foreach(int i, chunks) {
-                    QString current = QString("%1.%2").arg(i).arg(m_extension);
-                    if (m_cacheDir.rename(current, QString("undo/%1/%2").arg(stackMax).arg(current))) {
-                        foundPreviews = true;
-                    }
-                }
-                if (!foundPreviews) {
-                    m_undoDir.rmdir(QString::number(stackMax));
-                }
-            }
+    // Chunks are stored by content, so an undo or an edit that did not change the rendered result finds its chunk back
+    QList <int> foundChunks;
+    QList <int> foundDrafts;
+    m_tractor->lock();
+    foreach(int i, chunks) {
+        const QString hash = chunkHash(i);
+        const QString previous = m_chunkHashes.value(i);
+        if (!previous.isEmpty() && previous != hash) {
+            // Keep the outdated chunk around for a while, an undo might bring it back
+            m_unusedChunks.removeAll(previous);
+            m_unusedChunks << previous;
         }
-        bool moveFile = true;
-        QDir tmpDir = m_undoDir;
-        if (!tmpDir.cd(QString::number(stackIx))) {
-            moveFile = false;
+        m_chunkHashes.insert(i, hash);
+        m_unusedChunks.removeAll(hash);
+        int offset;
+        if (!chunkFile(hash, offset).isEmpty()) {
+            foundChunks << i;
+        } else if (KdenliveSettings::previewdrafts() && m_cacheDir.exists(chunkFileName(draftHash(hash)))) {
+            foundDrafts << i;
         }
-        QList <int> foundChunks;
-        foreach(int i, chunks) {
-            QString cacheFileName = QString("%1.%2").arg(i).arg(m_extension);
-            if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
-            }
-            if (moveFile) {
-                if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
-                    foundChunks << i;
-                }
-            }
+    }
+    if (m_previewTrack) {
+        foreach(int i, foundDrafts) {
+            loadDraft(i);
         }
-        qSort(foundChunks);
-        reloadChunks(foundChunks);
     }
+    m_tractor->unlock();
+    qSort(foundChunks);
+    reloadChunks(foundChunks);
+    emit cleanupOldPreviews();
     m_doc->setModified(true);
     if (timer)
         m_previewTimer.start();
@@ -281,27 +569,23 @@ void PreviewManager::invalidatePreviews(QList <int> chunks)
 
 void PreviewManager::doCleanupOldPreviews()
 {
-    if (m_undoDir.dirName() != QLatin1String("undo"))
-        return;
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-
-    // Use QCollator to do a natural sorting so that 10 is after 2
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(
-    dirs.begin(),
-    dirs.end(),
-    [&collator](const QString &file1, const QString &file2)
-    {
-        return collator.compare(file1, file2) < 0;
-    });
-    bool ok;
-    while (dirs.count() > 5) {
-        QDir tmp = m_undoDir;
-        QString dirName = dirs.takeFirst();
-        dirName.toInt(&ok);
-        if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
+    // To avoid filling the hard drive, only keep a limited number of unused chunks
+    QStringList used = m_chunkHashes.values();
+    int maxUnused = qMax(MAX_UNUSED_CHUNKS, used.count());
+    while (m_unusedChunks.count() > maxUnused) {
+        const QString hash = m_unusedChunks.takeFirst();
+        if (!used.contains(hash)) {
+            removeChunkFile(hash, used);
+        }
+    }
+    QStringList frozen;
+    foreach(const FrozenTrack &track, m_frozenTracks) {
+        frozen << track.hash;
+    }
+    while (m_unusedFrozen.count() > MAX_UNUSED_FROZEN) {
+        const QString hash = m_unusedFrozen.takeFirst();
+        if (!frozen.contains(hash)) {
+            CacheIndex::removeFile(m_cacheDir.absoluteFilePath(frozenFileName(hash)));
         }
     }
 }
@@ -313,8 +597,11 @@ void PreviewManager::clearPreviewRange()
         QList <int> toProcess = m_ruler->getProcessedChunks();
         m_tractor->lock();
         bool hasPreview = m_previewTrack != NULL;
+        foreach(int ix, m_ruler->getDraftChunks()) {
+            releaseDraft(ix);
+        }
         foreach(int ix, toProcess) {
-            m_cacheDir.remove(QString("%1.%2").arg(ix).arg(m_extension));
+            releaseChunk(ix);
             if (!hasPreview)
                 continue;
             int trackIx = m_previewTrack->get_clip_index_at(ix);
@@ -339,13 +626,39 @@ void PreviewManager::addPreviewRange(bool add)
     for (int i = startChunk; i <= endChunk; i++) {
         frames << i * chunkSize;
     }
+    if (!add) {
+        // Removed dirty chunks stop playing their draft
+        m_tractor->lock();
+        const QList <int> drafts = m_ruler->getDraftChunks();
+        foreach(int i, frames) {
+            if (drafts.contains(i))
+                releaseDraft(i);
+        }
+        m_tractor->unlock();
+    }
     QList <int> toProcess = m_ruler->addChunks(frames, add);
     if (toProcess.isEmpty())
         return;
     if (add) {
         if (m_previewThread.isRunning()) {
             // just add required frames to current rendering job
+            m_tractor->lock();
+            QMutexLocker lock(&m_queueMutex);
+            foreach(int i, toProcess) {
+                QString layout;
+                int cost;
+                m_chunkHashes.insert(i, chunkHash(i, &layout, &cost));
+                m_chunkLayouts.insert(i, qMakePair(layout, cost));
+            }
+            m_tractor->unlock();
             m_waitingThumbs << toProcess;
+            sortChunks(m_waitingThumbs);
+            m_totalChunks.fetchAndAddOrdered(toProcess.count());
+            if (KdenliveSettings::previewdrafts()) {
+                m_waitingDrafts << toProcess;
+                sortChunks(m_waitingDrafts);
+                m_totalChunks.fetchAndAddOrdered(toProcess.count());
+            }
         } else if (KdenliveSettings::autopreview())
             m_previewTimer.start();
     } else {
@@ -356,7 +669,7 @@ void PreviewManager::addPreviewRange(bool add)
         m_tractor->lock();
         bool hasPreview = m_previewTrack != NULL;
         foreach(int ix, toProcess) {
-            m_cacheDir.remove(QString("%1.%2").arg(ix).arg(m_extension));
+            releaseChunk(ix);
             if (!hasPreview)
                 continue;
             int trackIx = m_previewTrack->get_clip_index_at(ix);
@@ -373,6 +686,16 @@ void PreviewManager::addPreviewRange(bool add)
     }
 }
 
+void PreviewManager::releaseChunk(int frame)
+{
+    const QString hash = m_chunkHashes.take(frame);
+    if (!hash.isEmpty() && !m_chunkHashes.values().contains(hash)) {
+        // Identical chunks share the same file, only delete it when not used anymore
+        m_unusedChunks.removeAll(hash);
+        removeChunkFile(hash, m_chunkHashes.values());
+    }
+}
+
 void PreviewManager::abortRendering()
 {
     if (!m_previewThread.isRunning())
@@ -394,70 +717,290 @@ void PreviewManager::startPreviewRender()
         // Abort any rendering
         abortRendering();
         m_waitingThumbs.clear();
+        m_chunkLayouts.clear();
+        m_tractor->lock();
+        foreach(int i, chunks) {
+            QString layout;
+            int cost;
+            m_chunkHashes.insert(i, chunkHash(i, &layout, &cost));
+            m_chunkLayouts.insert(i, qMakePair(layout, cost));
+        }
+        m_tractor->unlock();
         const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
         m_doc->saveMltPlaylist(sceneList);
         m_waitingThumbs = chunks;
+        m_waitingDrafts.clear();
+        if (KdenliveSettings::previewdrafts()) {
+            // A quick draft of the whole zone first, then the final chunks closest to the playhead
+            const QList <int> drafts = m_ruler->getDraftChunks();
+            foreach(int i, chunks) {
+                if (!drafts.contains(i))
+                    m_waitingDrafts << i;
+            }
+        }
         m_previewThread = QtConcurrent::run(this, &PreviewManager::doPreviewRender, sceneList);
     }
 }
 
+int PreviewManager::renderThreads()
+{
+    int threads = KdenliveSettings::previewthreads();
+    if (threads <= 0) {
+        // Each melt process already uses several threads for encoding, so keep some cores free
+        threads = QThread::idealThreadCount() / 2;
+    }
+    return qMax(1, threads);
+}
+
+void PreviewManager::sortChunks(QList <int> &chunks) const
+{
+    // Chunks starting at the playhead are rendered first, in playback order, then the ones before playhead, closest first
+    int pos = m_tractor->position();
+    pos -= pos % KdenliveSettings::timelinechunks();
+    std::sort(chunks.begin(), chunks.end(), [pos](int a, int b) {
+        bool aAfter = a >= pos;
+        bool bAfter = b >= pos;
+        if (aAfter != bAfter)
+            return aAfter;
+        return aAfter ? a < b : a > b;
+    });
+}
+
 void PreviewManager::doPreviewRender(QString scene)
 {
-    int progress;
-    int chunkSize = KdenliveSettings::timelinechunks();
     // initialize progress bar
     emit previewRender(0, QString(), 0);
-    int ct = 0;
-    qSort(m_waitingThumbs);
-    while (!m_waitingThumbs.isEmpty()) {
-        int i = m_waitingThumbs.takeFirst();
-        ct++;
-        QString fileName = QString("%1.%2").arg(i).arg(m_extension);
-        if (m_waitingThumbs.isEmpty()) {
-            progress = 1000;
-        } else {
-            progress = (double) (ct) / (ct + m_waitingThumbs.count()) * 1000;
+    m_queueMutex.lock();
+    sortChunks(m_waitingThumbs);
+    sortChunks(m_waitingDrafts);
+    m_totalChunks.store(m_waitingThumbs.count() + m_waitingDrafts.count());
+    m_queueMutex.unlock();
+    m_doneChunks.store(0);
+    m_renderFailed.store(0);
+    int threads = renderThreads();
+    m_renderPool.setMaxThreadCount(threads);
+    QList <QFuture <void> > workers;
+    for (int i = 0; i < threads; i++) {
+        workers << QtConcurrent::run(&m_renderPool, this, &PreviewManager::processChunks, scene);
+    }
+    for (int i = 0; i < workers.count(); i++) {
+        workers[i].waitForFinished();
+    }
+    //QFile::remove(scene);
+    m_abortPreview = false;
+}
+
+void PreviewManager::processChunks(const QString &scene)
+{
+    int chunkSize = KdenliveSettings::timelinechunks();
+    Mlt::Producer *sceneProducer = NULL;
+    if (!KdenliveSettings::gpu_accel()) {
+        // Load the scene once and re-use it for all chunks rendered by this worker
+        sceneProducer = new Mlt::Producer(*m_tractor->profile(), "xml", scene.toUtf8().constData());
+        if (!sceneProducer->is_valid()) {
+            delete sceneProducer;
+            sceneProducer = NULL;
         }
-        if (m_cacheDir.exists(fileName)) {
-            // This chunk already exists
-            emit previewRender(i, m_cacheDir.absoluteFilePath(fileName), progress);
+    }
+    // Timeline changes also emit abortPreview, without setting m_abortPreview
+    bool aborted = false;
+    QMetaObject::Connection abortConnection = connect(this, &PreviewManager::abortPreview, [&aborted]() {
+        aborted = true;
+    });
+    auto renderFailed = [this, &aborted](int frame, const QString &errorMessage) {
+        if (m_abortPreview || aborted) {
+            if (m_renderFailed.testAndSetOrdered(0, 1)) {
+                emit previewRender(0, QString(), 1000);
+            }
+        } else if (m_renderFailed.testAndSetOrdered(0, 1)) {
+            // First failure, report and stop the other workers
+            emit previewRender(frame, errorMessage, -1);
+            emit abortPreview();
+        }
+    };
+    while (!m_abortPreview && !aborted && m_renderFailed.load() == 0) {
+        m_queueMutex.lock();
+        if (m_waitingThumbs.isEmpty() && m_waitingDrafts.isEmpty()) {
+            m_queueMutex.unlock();
+            break;
+        }
+        if (!m_waitingDrafts.isEmpty()) {
+            int i = m_waitingDrafts.takeFirst();
+            const QString hash = draftHash(m_chunkHashes.value(i));
+            m_queueMutex.unlock();
+            QString errorMessage;
+            if (!m_cacheDir.exists(chunkFileName(hash)) && !renderFile(sceneProducer, scene, i, chunkSize, true, hash, errorMessage)) {
+                renderFailed(i, errorMessage);
+                break;
+            }
+            int done = m_doneChunks.fetchAndAddOrdered(1) + 1;
+            emit draftRender(i, m_cacheDir.absoluteFilePath(chunkFileName(hash)), done >= m_totalChunks.load() ? 1000 : done * 1000 / m_totalChunks.load());
             continue;
         }
-        // Build rendering process
-        QStringList args;
-        args << scene;
-        args << "in=" + QString::number(i);
-        args << "out=" + QString::number(i + chunkSize - 1);
-        args << "-consumer" << "avformat:" + m_cacheDir.absoluteFilePath(fileName);
-        args << m_consumerParams;
-        QProcess previewProcess;
-        connect(this, SIGNAL(abortPreview()), &previewProcess, SLOT(kill()), Qt::DirectConnection);
-        previewProcess.start(KdenliveSettings::rendererpath(), args);
-        if (previewProcess.waitForStarted()) {
-            previewProcess.waitForFinished(-1);
-            if (previewProcess.exitStatus() != QProcess::NormalExit || previewProcess.exitCode() != 0) {
-                // Something went wrong
-                if (m_abortPreview) {
-                    emit previewRender(0, QString(), 1000);
-                } else {
-                    emit previewRender(i, previewProcess.readAllStandardError(), -1);
+        int i = m_waitingThumbs.takeFirst();
+        QList <int> group;
+        group << i;
+        QStringList hashes;
+        hashes << m_chunkHashes.value(i);
+        int offset;
+        const QPair <QString, int> layout = m_chunkLayouts.value(i);
+        if (chunkFile(hashes.first(), offset).isEmpty()) {
+            // Take the following chunks reading the same clips, as long as the content is simple enough
+            int maxChunks = maxGroupedChunks(layout.second);
+            while (group.count() < maxChunks && !layout.first.isEmpty()) {
+                int next = group.last() + chunkSize;
+                if (!m_waitingThumbs.contains(next) || m_chunkLayouts.value(next).first != layout.first || !chunkFile(m_chunkHashes.value(next), offset).isEmpty()) {
+                    break;
                 }
-                QFile::remove(m_cacheDir.absoluteFilePath(fileName));
+                m_waitingThumbs.removeAll(next);
+                group << next;
+                hashes << m_chunkHashes.value(next);
+            }
+        }
+        m_queueMutex.unlock();
+        // A group file is named after the hashes of its chunks
+        const QString hash = group.count() == 1 ? hashes.first() : QString::fromLatin1(QCryptographicHash::hash(hashes.join(QLatin1Char(',')).toLatin1(), QCryptographicHash::Md5).toHex());
+        QString fileName = chunkFileName(hash);
+        bool rendered = group.count() == 1 ? !chunkFile(hash, offset).isEmpty() : m_cacheDir.exists(fileName);
+        if (!rendered) {
+            QString errorMessage;
+            if (!renderFile(sceneProducer, scene, i, group.count() * chunkSize, false, hash, errorMessage)) {
+                renderFailed(i, errorMessage);
                 break;
-            } else {
-                emit previewRender(i, m_cacheDir.absoluteFilePath(fileName), progress);
             }
-        } else {
-            emit previewRender(i, QString(), -1);
-            break;
+        }
+        if (group.count() > 1) {
+            // Each chunk finds its position in the group file, also after reopening the project
+            QMutexLocker lock(&m_refMutex);
+            for (int j = 0; j < hashes.count(); j++) {
+                QFile ref(m_cacheDir.absoluteFilePath(chunkRefName(hashes.at(j))));
+                if (ref.open(QIODevice::WriteOnly)) {
+                    ref.write(QString("%1 %2").arg(hash).arg(j * chunkSize).toLatin1());
+                    ref.close();
+                }
+                m_chunkRefs.insert(hashes.at(j), qMakePair(hash, j * chunkSize));
+            }
+        }
+        int done = m_doneChunks.fetchAndAddOrdered(group.count()) + group.count();
+        foreach(int frame, group) {
+            emit previewRender(frame, m_cacheDir.absoluteFilePath(fileName), done >= m_totalChunks.load() ? 1000 : done * 1000 / m_totalChunks.load());
         }
     }
-    //QFile::remove(scene);
-    m_abortPreview = false;
+    disconnect(abortConnection);
+    delete sceneProducer;
+}
+
+bool PreviewManager::renderFile(Mlt::Producer *sceneProducer, const QString &scene, int frame, int length, bool draft, const QString &hash, QString &errorMessage)
+{
+    // Identical chunks may be rendered at the same time by another worker, so render to a temporary file
+    const QString fileName = chunkFileName(hash);
+    const QString partFile = m_cacheDir.absoluteFilePath(chunkFileName(QString("%1-%2").arg(hash).arg(frame)));
+    bool result = sceneProducer ? renderChunk(sceneProducer, frame, length, draft, partFile, errorMessage) : renderChunkProcess(scene, frame, length, draft, partFile, errorMessage);
+    if (result && !QFile::rename(partFile, m_cacheDir.absoluteFilePath(fileName))) {
+        QFile::remove(partFile);
+        result = m_cacheDir.exists(fileName);
+    } else if (result) {
+        CacheIndex::fileWritten(m_cacheDir.absoluteFilePath(fileName));
+    }
+    if (!result) {
+        // Something went wrong
+        QFile::remove(partFile);
+    }
+    return result;
+}
+
+bool PreviewManager::renderChunk(Mlt::Producer *scene, int frame, int length, bool draft, const QString &destination, QString &errorMessage)
+{
+    Mlt::Consumer consumer(*m_tractor->profile(), "avformat", destination.toUtf8().constData());
+    if (!consumer.is_valid()) {
+        errorMessage = i18n("Cannot create consumer %1.", QStringLiteral("avformat"));
+        return false;
+    }
+    foreach(const QString &param, m_consumerParams) {
+        if (param.contains(QLatin1Char('='))) {
+            consumer.set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+        }
+    }
+    if (draft) {
+        // Half resolution and intra only, quick to encode and to seek in
+        consumer.set("width", (m_tractor->profile()->width() / 2) & ~1);
+        consumer.set("height", (m_tractor->profile()->height() / 2) & ~1);
+        consumer.set("g", 1);
+        consumer.set("bf", 0);
+    }
+    consumer.set("terminate_on_pause", 1);
+    consumer.set("real_time", -1);
+    Mlt::Producer *cut = scene->cut(frame, frame + length - 1);
+    Mlt::Tractor tractor(*m_tractor->profile());
+    Mlt::Playlist playlist(*m_tractor->profile());
+    playlist.append(*cut);
+    tractor.set_track(playlist, 0);
+    consumer.connect(tractor);
+    bool stopped = false;
+    QMetaObject::Connection abortConnection = connect(this, &PreviewManager::abortPreview, [&consumer, &stopped]() {
+        stopped = true;
+        consumer.stop();
+    });
+    consumer.run();
+    disconnect(abortConnection);
+    delete cut;
+    if (stopped || m_abortPreview) {
+        return false;
+    }
+    QFileInfo info(destination);
+    if (!info.exists() || info.size() == 0) {
+        errorMessage = i18n("Failed to render chunk at frame %1", frame);
+        return false;
+    }
+    return true;
+}
+
+bool PreviewManager::renderChunkProcess(const QString &scene, int frame, int length, bool draft, const QString &destination, QString &errorMessage)
+{
+    // Build rendering process
+    QStringList args;
+    args << scene;
+    args << "in=" + QString::number(frame);
+    args << "out=" + QString::number(frame + length - 1);
+    args << "-consumer" << "avformat:" + destination;
+    args << m_consumerParams;
+    if (draft) {
+        args << QString("width=%1").arg((m_tractor->profile()->width() / 2) & ~1);
+        args << QString("height=%1").arg((m_tractor->profile()->height() / 2) & ~1);
+        args << "g=1" << "bf=0";
+    }
+    QProcess previewProcess;
+    connect(this, SIGNAL(abortPreview()), &previewProcess, SLOT(kill()), Qt::DirectConnection);
+    previewProcess.start(KdenliveSettings::rendererpath(), args);
+    if (!previewProcess.waitForStarted()) {
+        return false;
+    }
+    previewProcess.waitForFinished(-1);
+    if (previewProcess.exitStatus() != QProcess::NormalExit || previewProcess.exitCode() != 0) {
+        errorMessage = previewProcess.readAllStandardError();
+        return false;
+    }
+    return true;
 }
 
 void PreviewManager::slotProcessDirtyChunks()
 {
+    if (!m_verifyChunks.isEmpty()) {
+        // Chunks kept at invalidation time, make sure later edits did not change them
+        QList <int> changed;
+        m_tractor->lock();
+        foreach(int i, m_verifyChunks) {
+            if (m_chunkHashes.contains(i) && chunkHash(i) != m_chunkHashes.value(i)) {
+                changed << i;
+            }
+        }
+        m_tractor->unlock();
+        m_verifyChunks.clear();
+        if (!changed.isEmpty()) {
+            abortPreview();
+            blankChunks(changed);
+        }
+    }
     QList <int> chunks = m_ruler->getDirtyChunks();
     if (chunks.isEmpty())
         return;
@@ -467,40 +1010,56 @@ void PreviewManager::slotProcessDirtyChunks()
         m_previewTimer.start();
 }
 
-void PreviewManager::slotRemoveInvalidUndo(int ix)
+void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
-    QMutexLocker lock(&m_previewMutex);
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
-        // Make sure we delete correct folder
+    invalidatePreview(QList <QPoint>() << QPoint(startFrame, endFrame));
+}
+
+void PreviewManager::invalidatePreview(const QList <QPoint> &ranges)
+{
+    int chunkSize = KdenliveSettings::timelinechunks();
+    QList <QPoint> chunkRanges;
+    foreach(const QPoint &range, ranges) {
+        int start = range.x() / chunkSize;
+        int end = lrintf(range.y() / chunkSize);
+        start *= chunkSize;
+        end *= chunkSize;
+        if (m_ruler->isUnderPreview(start, end)) {
+            chunkRanges << QPoint(start, end);
+        }
+    }
+    if (chunkRanges.isEmpty()) {
         return;
     }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    bool ok;
-    foreach(const QString dir, dirs) {
-        if (dir.toInt(&ok) >= ix && ok == true) {
-            QDir tmp = m_undoDir;
-            if (tmp.cd(dir)) {
-                tmp.removeRecursively();
+    m_previewGatherTimer.stop();
+    // Only drop chunks whose rendered content changed, so that edits on audio, hidden tracks
+    // or disabled effects keep the preview and do not abort rendering
+    QList <int> changed;
+    m_tractor->lock();
+    foreach(const QPoint &range, chunkRanges) {
+        for (int i = range.x(); i <= range.y(); i+= chunkSize) {
+            if (m_chunkHashes.contains(i) && chunkHash(i) == m_chunkHashes.value(i)) {
+                if (!m_verifyChunks.contains(i))
+                    m_verifyChunks << i;
+                continue;
             }
+            changed << i;
         }
     }
+    m_tractor->unlock();
+    if (!changed.isEmpty()) {
+        abortPreview();
+        blankChunks(changed);
+    }
+    m_previewGatherTimer.start();
 }
 
-void PreviewManager::invalidatePreview(int startFrame, int endFrame)
+void PreviewManager::blankChunks(const QList <int> &chunks)
 {
-    int chunkSize = KdenliveSettings::timelinechunks();
-    int start = startFrame / chunkSize;
-    int end = lrintf(endFrame / chunkSize);
-    start *= chunkSize;
-    end *= chunkSize;
-    if (!m_ruler->isUnderPreview(start, end)) {
-        return;
-    }
-    m_previewGatherTimer.stop();
-    abortPreview();
     m_tractor->lock();
     bool hasPreview = m_previewTrack != NULL;
-    for (int i = start; i <=end; i+= chunkSize) {
+    foreach(int i, chunks) {
+        releaseDraft(i);
         if (m_ruler->updatePreview(i, false) && hasPreview) {
             int ix = m_previewTrack->get_clip_index_at(i);
             if (m_previewTrack->is_blank(ix))
@@ -512,22 +1071,25 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
     if (hasPreview)
         m_previewTrack->consolidate_blanks();
     m_tractor->unlock();
-    m_previewGatherTimer.start();
 }
 
 void PreviewManager::reloadChunks(QList <int> chunks)
 {
     if (m_previewTrack == NULL)
         return;
+    int chunkSize = KdenliveSettings::timelinechunks();
     m_tractor->lock();
     foreach(int ix, chunks) {
         if (m_previewTrack->is_blank_at(ix)) {
-            const QString fileName = m_cacheDir.absoluteFilePath(QString("%1.%2").arg(ix).arg(m_extension));
+            int offset;
+            const QString fileName = chunkFile(m_chunkHashes.value(ix), offset);
             Mlt::Producer prod(*m_tractor->profile(), 0, fileName.toUtf8().constData());
             if (prod.is_valid()) {
                 m_ruler->updatePreview(ix, true);
                 prod.set("mlt_service", "avformat-novalidate");
-                m_previewTrack->insert_at(ix, &prod, 1);
+                Mlt::Producer *cut = prod.cut(offset, offset + chunkSize - 1);
+                m_previewTrack->insert_at(ix, cut, 1);
+                delete cut;
             }
         }
     }
@@ -548,12 +1110,19 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
         return;
     }
     m_tractor->lock();
+    // The final chunk replaces the draft
+    releaseDraft(frame);
     if (m_previewTrack->is_blank_at(frame)) {
-        Mlt::Producer prod(*m_tractor->profile(), 0, file.toUtf8().constData());
-        if (prod.is_valid()) {
+        // Chunks rendered with others are read from their position in the group file
+        int offset;
+        const QString chunk = chunkFile(m_chunkHashes.value(frame), offset);
+        Mlt::Producer prod(*m_tractor->profile(), 0, chunk.toUtf8().constData());
+        if (!chunk.isEmpty() && prod.is_valid()) {
             m_ruler->updatePreview(frame, true, true);
             prod.set("mlt_service", "avformat-novalidate");
-            m_previewTrack->insert_at(frame, &prod, 1);
+            Mlt::Producer *cut = prod.cut(offset, offset + KdenliveSettings::timelinechunks() - 1);
+            m_previewTrack->insert_at(frame, cut, 1);
+            delete cut;
         } else {
             qDebug()<<"* * * INVALID PROD: "<<file;
         }
@@ -565,3 +1134,377 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
     m_doc->previewProgress(progress);
     m_doc->setModified(true);
 }
+
+const QString PreviewManager::frozenFileName(const QString &hash) const
+{
+    return QString("%1.%2").arg(hash).arg(QStringLiteral(FREEZE_EXTENSION));
+}
+
+const QString PreviewManager::trackHash(Mlt::Producer &track)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    Mlt::Profile *profile = m_tractor->profile();
+    hash.addData(QString("%1x%2:%3/%4:%5/%6;").arg(profile->width()).arg(profile->height()).arg(profile->frame_rate_num()).arg(profile->frame_rate_den()).arg(profile->sample_aspect_num()).arg(profile->sample_aspect_den()).toUtf8());
+    hash.addData(QByteArray(FREEZE_PARAMS));
+    // The render includes the track audio, the mute state is applied on the tractor and is not part of it
+    hashFilters(hash, track, true);
+    Mlt::Playlist playlist(track);
+    for (int ix = 0; ix < playlist.count(); ix++) {
+        if (playlist.is_blank(ix)) {
+            continue;
+        }
+        Mlt::ClipInfo *info = playlist.clip_info(ix);
+        if (!info) {
+            continue;
+        }
+        hash.addData(QString("clip:%1:%2:%3;").arg(info->start).arg(info->frame_in).arg(info->frame_out).toUtf8());
+        if (info->producer) {
+            hashProperties(hash, *info->producer);
+            hashFilters(hash, *info->producer, true);
+        }
+        if (info->cut) {
+            hashFilters(hash, *info->cut, true);
+        }
+        Mlt::Playlist::delete_clip_info(info);
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool PreviewManager::isFrozen(int ix) const
+{
+    return m_frozenTracks.contains(ix);
+}
+
+bool PreviewManager::hasFrozenTracks() const
+{
+    return !m_frozenTracks.isEmpty();
+}
+
+void PreviewManager::freezeTrack(int ix)
+{
+    if (!m_initialized || m_frozenTracks.contains(ix) || ix <= 0 || ix >= m_tractor->count())
+        return;
+    m_tractor->lock();
+    FrozenTrack frozen;
+    frozen.original = m_tractor->track(ix);
+    frozen.playlist = NULL;
+    frozen.hash = trackHash(*frozen.original);
+    m_frozenTracks.insert(ix, frozen);
+    m_unusedFrozen.removeAll(frozen.hash);
+    // A render of the same content is reused, after an undo or when reopening the project
+    bool found = m_cacheDir.exists(frozenFileName(frozen.hash)) && connectFrozenTrack(ix);
+    m_tractor->unlock();
+    if (!found)
+        m_freezeTimer.start();
+}
+
+void PreviewManager::unfreezeTrack(int ix)
+{
+    if (!m_frozenTracks.contains(ix))
+        return;
+    m_tractor->lock();
+    restoreFrozenTrack(ix);
+    m_tractor->unlock();
+    FrozenTrack frozen = m_frozenTracks.take(ix);
+    delete frozen.original;
+    // Keep the render for a while, the track might be frozen again
+    m_unusedFrozen.removeAll(frozen.hash);
+    m_unusedFrozen << frozen.hash;
+    emit cleanupOldPreviews();
+}
+
+void PreviewManager::invalidateFrozenTrack(int ix)
+{
+    if (ix == -1) {
+        foreach(int track, m_frozenTracks.keys()) {
+            invalidateFrozenTrack(track);
+        }
+        return;
+    }
+    if (!m_frozenTracks.contains(ix))
+        return;
+    m_tractor->lock();
+    FrozenTrack &frozen = m_frozenTracks[ix];
+    const QString hash = trackHash(*frozen.original);
+    if (hash == frozen.hash) {
+        // Not a change of the track content
+        m_tractor->unlock();
+        return;
+    }
+    restoreFrozenTrack(ix);
+    m_unusedFrozen.removeAll(frozen.hash);
+    m_unusedFrozen << frozen.hash;
+    frozen.hash = hash;
+    m_unusedFrozen.removeAll(hash);
+    bool found = m_cacheDir.exists(frozenFileName(hash)) && connectFrozenTrack(ix);
+    m_tractor->unlock();
+    if (!found)
+        m_freezeTimer.start();
+    emit cleanupOldPreviews();
+}
+
+void PreviewManager::updateFrozenState(int ix)
+{
+    if (!m_frozenTracks.contains(ix) || m_frozenTracks.value(ix).playlist == NULL)
+        return;
+    m_tractor->lock();
+    const FrozenTrack &frozen = m_frozenTracks.value(ix);
+    frozen.playlist->set("hide", frozen.original->get_int("hide"));
+    m_tractor->unlock();
+}
+
+bool PreviewManager::connectFrozenTrack(int ix)
+{
+    FrozenTrack &frozen = m_frozenTracks[ix];
+    Mlt::Producer render(*m_tractor->profile(), 0, m_cacheDir.absoluteFilePath(frozenFileName(frozen.hash)).toUtf8().constData());
+    if (!render.is_valid()) {
+        return false;
+    }
+    // Cut the render at the clips positions, blanks still show the tracks below
+    Mlt::Playlist original(*frozen.original);
+    Mlt::Playlist *playlist = new Mlt::Playlist(*m_tractor->profile());
+    for (int i = 0; i < original.count(); i++) {
+        int length = original.clip_length(i);
+        if (original.is_blank(i)) {
+            playlist->blank(length - 1);
+            continue;
+        }
+        int start = original.clip_start(i);
+        Mlt::Producer *cut = render.cut(start, start + length - 1);
+        playlist->append(*cut);
+        delete cut;
+    }
+    // Timeline code reads the track type, name and mute state on the tractor tracks
+    Mlt::Properties properties(frozen.original->get_properties());
+    for (int i = 0; i < properties.count(); i++) {
+        QString name = properties.get_name(i);
+        if (name.startsWith(QLatin1String("kdenlive:")) || name == QLatin1String("id") || name == QLatin1String("hide")) {
+            playlist->set(properties.get_name(i), properties.get(i));
+        }
+    }
+    delete frozen.playlist;
+    frozen.playlist = playlist;
+    m_tractor->set_track(*playlist, ix);
+    return true;
+}
+
+void PreviewManager::restoreFrozenTrack(int ix)
+{
+    FrozenTrack &frozen = m_frozenTracks[ix];
+    if (frozen.playlist == NULL)
+        return;
+    m_tractor->set_track(*frozen.original, ix);
+    delete frozen.playlist;
+    frozen.playlist = NULL;
+}
+
+void PreviewManager::disconnectFrozenTracks()
+{
+    QMapIterator<int, FrozenTrack> i(m_frozenTracks);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().playlist) {
+            m_tractor->set_track(*i.value().original, i.key());
+        }
+    }
+}
+
+void PreviewManager::reconnectFrozenTracks()
+{
+    QMapIterator<int, FrozenTrack> i(m_frozenTracks);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().playlist) {
+            m_tractor->set_track(*i.value().playlist, i.key());
+        }
+    }
+}
+
+void PreviewManager::releaseFrozenTracks()
+{
+    if (m_frozenTracks.isEmpty())
+        return;
+    m_freezeTimer.stop();
+    m_tractor->lock();
+    foreach(int ix, m_frozenTracks.keys()) {
+        restoreFrozenTrack(ix);
+        delete m_frozenTracks.value(ix).original;
+    }
+    m_frozenTracks.clear();
+    m_tractor->unlock();
+}
+
+void PreviewManager::startFreezeRender()
+{
+    if (m_freezeThread.isRunning()) {
+        // The running jobs were saved with an older scene, wait for them
+        m_freezeTimer.start();
+        return;
+    }
+    QList <QPair <int, QString> > jobs;
+    m_tractor->lock();
+    QMutableMapIterator<int, FrozenTrack> i(m_frozenTracks);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().playlist) {
+            continue;
+        }
+        i.value().hash = trackHash(*i.value().original);
+        if (!m_cacheDir.exists(frozenFileName(i.value().hash)) || !connectFrozenTrack(i.key())) {
+            jobs << qMakePair(i.key(), i.value().hash);
+        }
+    }
+    if (jobs.isEmpty()) {
+        m_tractor->unlock();
+        return;
+    }
+    // The scene must contain the original tracks
+    disconnectFrozenTracks();
+    m_tractor->unlock();
+    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("freeze.mlt"));
+    m_doc->saveMltPlaylist(sceneList);
+    m_tractor->lock();
+    reconnectFrozenTracks();
+    m_tractor->unlock();
+    m_abortFreeze = false;
+    m_freezeThread = QtConcurrent::run(this, &PreviewManager::doFreezeRender, sceneList, jobs);
+}
+
+void PreviewManager::doFreezeRender(const QString &scene, QList <QPair <int, QString> > jobs)
+{
+    Mlt::Producer sceneProducer(*m_tractor->profile(), "xml", scene.toUtf8().constData());
+    if (!sceneProducer.is_valid()) {
+        emit frozenTrackRendered(jobs.first().first, jobs.first().second, i18n("Cannot load scene %1", scene));
+        return;
+    }
+    Mlt::Service service(sceneProducer.parent().get_service());
+    if (service.type() != tractor_type) {
+        emit frozenTrackRendered(jobs.first().first, jobs.first().second, i18n("Cannot load scene %1", scene));
+        return;
+    }
+    Mlt::Tractor tractor(service);
+    for (int i = 0; i < jobs.count() && !m_abortFreeze; i++) {
+        const int ix = jobs.at(i).first;
+        const QString &hash = jobs.at(i).second;
+        const QString fileName = frozenFileName(hash);
+        QString errorMessage;
+        if (!m_cacheDir.exists(fileName)) {
+            const QString partFile = m_cacheDir.absoluteFilePath(frozenFileName(QString("%1-%2").arg(hash).arg(ix)));
+            QScopedPointer<Mlt::Producer> track(tractor.track(ix));
+            bool result = track && track->is_valid() && renderFrozenTrack(track.data(), partFile, errorMessage);
+            if (result && QFile::rename(partFile, m_cacheDir.absoluteFilePath(fileName))) {
+                CacheIndex::fileWritten(m_cacheDir.absoluteFilePath(fileName));
+            } else {
+                QFile::remove(partFile);
+                if (m_abortFreeze) {
+                    break;
+                }
+                if (errorMessage.isEmpty()) {
+                    errorMessage = i18n("Failed to render track %1", ix);
+                }
+            }
+        }
+        emit frozenTrackRendered(ix, hash, errorMessage);
+    }
+}
+
+bool PreviewManager::renderFrozenTrack(Mlt::Producer *track, const QString &destination, QString &errorMessage)
+{
+    Mlt::Consumer consumer(*m_tractor->profile(), "avformat", destination.toUtf8().constData());
+    if (!consumer.is_valid()) {
+        errorMessage = i18n("Cannot create consumer %1.", QStringLiteral("avformat"));
+        return false;
+    }
+    foreach(const QString &param, QString(FREEZE_PARAMS).split(QLatin1Char(' '))) {
+        consumer.set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+    }
+    consumer.set("terminate_on_pause", 1);
+    consumer.set("real_time", -1);
+    Mlt::Tractor tractor(*m_tractor->profile());
+    tractor.set_track(*track, 0);
+    consumer.connect(tractor);
+    QMetaObject::Connection abortConnection = connect(this, &PreviewManager::abortFreeze, [&consumer]() {
+        consumer.stop();
+    });
+    consumer.run();
+    disconnect(abortConnection);
+    if (m_abortFreeze) {
+        return false;
+    }
+    QFileInfo info(destination);
+    if (!info.exists() || info.size() == 0) {
+        errorMessage = i18n("Failed to render frozen track");
+        return false;
+    }
+    return true;
+}
+
+void PreviewManager::gotFrozenTrack(int ix, const QString &hash, const QString &errorMessage)
+{
+    if (!m_frozenTracks.contains(ix) || m_frozenTracks.value(ix).hash != hash || m_frozenTracks.value(ix).playlist) {
+        // The track changed or was unfrozen while rendering
+        return;
+    }
+    if (!errorMessage.isEmpty()) {
+        m_doc->displayMessage(i18n("Cannot freeze track: %1", errorMessage), ErrorMessage);
+        return;
+    }
+    m_tractor->lock();
+    connectFrozenTrack(ix);
+    m_tractor->unlock();
+}
+
+const QString PreviewManager::draftHash(const QString &hash)
+{
+    return hash + QStringLiteral("-draft");
+}
+
+bool PreviewManager::loadDraft(int frame)
+{
+    if (m_previewTrack == NULL || !m_previewTrack->is_blank_at(frame))
+        return false;
+    const QString file = m_cacheDir.absoluteFilePath(chunkFileName(draftHash(m_chunkHashes.value(frame))));
+    if (!QFile::exists(file))
+        return false;
+    Mlt::Producer prod(*m_tractor->profile(), 0, file.toUtf8().constData());
+    if (!prod.is_valid())
+        return false;
+    m_unusedChunks.removeAll(draftHash(m_chunkHashes.value(frame)));
+    prod.set("mlt_service", "avformat-novalidate");
+    m_previewTrack->insert_at(frame, &prod, 1);
+    m_previewTrack->consolidate_blanks();
+    m_ruler->setDraftChunk(frame, true);
+    return true;
+}
+
+void PreviewManager::releaseDraft(int frame)
+{
+    if (!m_ruler->getDraftChunks().contains(frame))
+        return;
+    m_ruler->setDraftChunk(frame, false);
+    // Drafts are small, keep them for a while in case an undo brings them back
+    const QString hash = draftHash(m_chunkHashes.value(frame));
+    m_unusedChunks.removeAll(hash);
+    m_unusedChunks << hash;
+    if (m_previewTrack == NULL)
+        return;
+    int ix = m_previewTrack->get_clip_index_at(frame);
+    if (!m_previewTrack->is_blank(ix)) {
+        Mlt::Producer *prod = m_previewTrack->replace_with_blank(ix);
+        delete prod;
+        m_previewTrack->consolidate_blanks();
+    }
+}
+
+void PreviewManager::gotDraftRender(int frame, const QString &file, int progress)
+{
+    if (m_previewTrack == NULL)
+        return;
+    m_tractor->lock();
+    // The chunk may have been invalidated or rendered meanwhile
+    if (m_ruler->getDirtyChunks().contains(frame) && QFileInfo(file).fileName() == chunkFileName(draftHash(m_chunkHashes.value(frame)))) {
+        loadDraft(frame);
+    }
+    m_tractor->unlock();
+    m_doc->previewProgress(progress);
+}
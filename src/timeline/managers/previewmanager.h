@@ -26,13 +26,21 @@
 #include <QMutex>
 #include <QTimer>
 #include <QFuture>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMap>
+#include <QPoint>
 
+class QCryptographicHash;
 class KdenliveDoc;
 class CustomRuler;
 
 namespace Mlt {
     class Tractor;
     class Playlist;
+    class Producer;
+    class Properties;
+    class Service;
 }
 
 /**
@@ -43,6 +51,14 @@ namespace Mlt {
  * This allow us to get a preview with a smooth playback of our project.
  * Only the preview zone is rendered. Once defined, a preview zone shows as a red line below
  * the timeline ruler. As chunks are rendered, the zone turns to green.
+ * Chunk files are named after a hash of everything that affects their rendering, so that
+ * unchanged content (after an undo, or an edit on a hidden track) is not rendered again.
+ * Consecutive chunks showing the same clips are rendered together in one file, a longer run
+ * for simple content. Each chunk then has a small reference file giving its position in the group file.
+ * Before the final chunks, a half resolution intra-only draft of the dirty chunks is rendered and played,
+ * so that playback is smooth quickly. The ruler shows these chunks in orange until they are upgraded.
+ * Tracks can also be frozen: the track is rendered with its effects to a file of the same cache,
+ * named after a hash of the track content, that is played instead of the track clips.
  */
 
 class PreviewManager : public QObject
@@ -54,8 +70,11 @@ public:
     virtual ~PreviewManager();
     /** @brief: initialize base variables, return false if error. */
     bool initialize();
-    /** @brief: a timeline operation caused changes to frames between startFrame and endFrame. */
+    /** @brief: a timeline operation caused changes to frames between startFrame and endFrame.
+     *  Chunks whose content hash did not change stay valid. */
     void invalidatePreview(int startFrame, int endFrame);
+    /** @brief: invalidate several frame ranges at once, aborting the preview rendering only once. */
+    void invalidatePreview(const QList <QPoint> &ranges);
     /** @brief: after a small  delay (some operations trigger several invalidatePreview calls), take care of these invalidated chunks. */
     void invalidatePreviews(QList <int> chunks);
     /** @brief: user adds current timeline zone to the preview zone. */
@@ -77,7 +96,32 @@ public:
     /** @brief: Returns directory currently used to store the preview files. */
     const QDir getCacheDir() const;
     /** @brief: Load existing ruler chunks. */
-    void loadChunks(QStringList previewChunks, QStringList dirtyChunks, QDateTime documentDate);
+    void loadChunks(QStringList previewChunks, QStringList dirtyChunks);
+    /** @brief: Returns the files of the up to date chunks, by chunk start frame. */
+    const QMap <int, QString> renderedChunks();
+    /** @brief: Returns the consumer parameters used to encode the chunks. */
+    const QStringList consumerParams() const;
+    /** @brief: Returns the file extension of the chunks. */
+    const QString extension() const;
+    /** @brief: Play track ix from a render of the track, rendering it if it is not in the cache. */
+    void freezeTrack(int ix);
+    /** @brief: Play track ix from its clips again. */
+    void unfreezeTrack(int ix);
+    /** @brief: Returns true if track ix is frozen, even if its render is not ready yet. */
+    bool isFrozen(int ix) const;
+    /** @brief: Returns true if at least one track is frozen. */
+    bool hasFrozenTracks() const;
+    /** @brief: Clips or effects of frozen track ix changed (all frozen tracks if ix is -1).
+     *  The track clips are played until a render matching the new content is available. */
+    void invalidateFrozenTrack(int ix);
+    /** @brief: The mute state of track ix changed, apply it to its render. */
+    void updateFrozenState(int ix);
+    /** @brief: Whenever we save our project, put the original tracks back so they are saved. Tractor must be locked. */
+    void disconnectFrozenTracks();
+    /** @brief: After project save, play the frozen tracks renders again. Tractor must be locked. */
+    void reconnectFrozenTracks();
+    /** @brief: Forget the frozen tracks before the track indexes change, restoring the original tracks. */
+    void releaseFrozenTracks();
 
 private:
     KdenliveDoc *m_doc;
@@ -86,8 +130,16 @@ private:
     Mlt::Playlist *m_previewTrack;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
-    /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
-    QDir m_undoDir;
+    /** @brief: Content hash of the chunks in preview zone, by chunk start frame. */
+    QMap <int, QString> m_chunkHashes;
+    /** @brief: Layout and cost of the chunks waiting for rendering, by chunk start frame. */
+    QMap <int, QPair <QString, int> > m_chunkLayouts;
+    /** @brief: Group file hash and position of the chunks rendered with others, by chunk hash. */
+    QMap <QString, QPair <QString, int> > m_chunkRefs;
+    /** @brief: Protects m_chunkRefs, used by the render workers. */
+    QMutex m_refMutex;
+    /** @brief: Hashes of chunk files that are not used anymore, oldest first. */
+    QStringList m_unusedChunks;
     QMutex m_previewMutex;
     QStringList m_consumerParams;
     QString m_extension;
@@ -98,30 +150,122 @@ private:
     bool m_initialized;
     bool m_abortPreview;
     QList <int> m_waitingThumbs;
+    /** @brief: Chunks waiting for their draft render, rendered before m_waitingThumbs. */
+    QList <int> m_waitingDrafts;
+    /** @brief: Protects m_waitingThumbs while several render workers pick chunks from it. */
+    QMutex m_queueMutex;
     QFuture <void> m_previewThread;
-    /** @brief: After an undo/redo, if we have preview history, use it. */
+    /** @brief: Thread pool running the concurrent chunk render workers. */
+    QThreadPool m_renderPool;
+    /** @brief: Number of chunks scheduled / done in current rendering job, used for progress. */
+    QAtomicInt m_totalChunks;
+    QAtomicInt m_doneChunks;
+    /** @brief: Set when one chunk failed to render, so that other workers stop. */
+    QAtomicInt m_renderFailed;
+    /** @brief: Sort chunks so that the ones at playhead position are rendered first. */
+    void sortChunks(QList <int> &chunks) const;
+    /** @brief: Number of chunks rendering processes that can run at once. */
+    static int renderThreads();
+    /** @brief: Worker: render waiting chunks until the queue is empty or rendering is aborted. */
+    void processChunks(const QString &scene);
+    /** @brief: Render length frames to the cache file of hash, through a temporary file. */
+    bool renderFile(Mlt::Producer *sceneProducer, const QString &scene, int frame, int length, bool draft, const QString &hash, QString &errorMessage);
+    /** @brief: Encode length frames from the already loaded scene with an in-process consumer. */
+    bool renderChunk(Mlt::Producer *scene, int frame, int length, bool draft, const QString &destination, QString &errorMessage);
+    /** @brief: Encode length frames with an external melt process (used with GPU acceleration). */
+    bool renderChunkProcess(const QString &scene, int frame, int length, bool draft, const QString &destination, QString &errorMessage);
+    /** @brief: Returns the hash of the draft render of a chunk. */
+    static const QString draftHash(const QString &hash);
+    /** @brief: Play the draft render of a dirty chunk if there is one. Tractor must be locked. */
+    bool loadDraft(int frame);
+    /** @brief: Stop playing the draft render of a chunk. Tractor must be locked. */
+    void releaseDraft(int frame);
+    /** @brief: After an undo/redo, reload chunks for which we have a file matching the content. */
     void reloadChunks(QList <int> chunks);
+    /** @brief: Compute the hash of producers, effects and transitions rendered in the chunk starting at frame. Tractor must be locked.
+     *  @param layout if not NULL, set to the clips and transitions in the chunk, equal for chunks that can be rendered together
+     *  @param cost if not NULL, set to the number of clips, effects and transitions in the chunk */
+    const QString chunkHash(int frame, QString *layout = NULL, int *cost = NULL);
+    /** @brief: Returns the file name of a chunk from its hash. */
+    const QString chunkFileName(const QString &hash) const;
+    /** @brief: Returns the name of the file giving the group file of a chunk rendered with others. */
+    const QString chunkRefName(const QString &hash) const;
+    /** @brief: Returns the path of the file containing the chunk, empty if it is not rendered.
+     *  @param offset set to the position of the chunk in this file */
+    const QString chunkFile(const QString &hash, int &offset);
+    /** @brief: Read the group file hash and position of a chunk rendered with others, returns false if there is none. */
+    bool readChunkRef(const QString &hash, QString &group, int &offset);
+    /** @brief: Delete the files of a chunk, and its group file if no chunk in used needs it anymore. */
+    void removeChunkFile(const QString &hash, const QStringList &used);
+    /** @brief: Number of chunks with this cost that can be rendered in one file. */
+    static int maxGroupedChunks(int cost);
+    /** @brief: Number of enabled timeline effects attached to a service. */
+    static int effectCount(Mlt::Service &service);
+    /** @brief: Add properties to the hash, in and out being made relative to offset if not 0. */
+    static void hashProperties(QCryptographicHash &hash, Mlt::Properties &properties, int offset = 0);
+    /** @brief: Add filters attached to a service to the hash, audio filters only if audio is true. */
+    static void hashFilters(QCryptographicHash &hash, Mlt::Service &service, bool audio = false);
+    /** @brief: Chunk at frame is removed from preview zone, delete its file. */
+    void releaseChunk(int frame);
+    /** @brief: Mark chunks as dirty and remove them from the preview track. */
+    void blankChunks(const QList <int> &chunks);
+    /** @brief: Chunks that were still valid when invalidated, checked again once the edits are gathered. */
+    QList <int> m_verifyChunks;
+    /** @brief: A frozen track: the original track producer, the content hash of its render
+     *  and the playlist playing the render, NULL while the render is not available. */
+    struct FrozenTrack {
+        Mlt::Producer *original;
+        Mlt::Playlist *playlist;
+        QString hash;
+    };
+    /** @brief: Frozen tracks, by track index. */
+    QMap <int, FrozenTrack> m_frozenTracks;
+    /** @brief: Hashes of frozen track renders that are not used anymore, oldest first. */
+    QStringList m_unusedFrozen;
+    QFuture <void> m_freezeThread;
+    /** @brief: Gathers the frozen tracks changes before rendering them again. */
+    QTimer m_freezeTimer;
+    bool m_abortFreeze;
+    /** @brief: Compute the hash of clips and effects (including audio) of a track. Tractor must be locked. */
+    const QString trackHash(Mlt::Producer &track);
+    /** @brief: Returns the file name of a frozen track render from its hash. */
+    const QString frozenFileName(const QString &hash) const;
+    /** @brief: Replace frozen track ix with its render, keeping the blanks of the original track. Tractor must be locked. */
+    bool connectFrozenTrack(int ix);
+    /** @brief: Put the original track back in place of the render of frozen track ix. Tractor must be locked. */
+    void restoreFrozenTrack(int ix);
+    /** @brief: Render the frozen tracks of the scene, each job being a track index and the hash of its content. */
+    void doFreezeRender(const QString &scene, QList <QPair <int, QString> > jobs);
+    /** @brief: Encode a track of the loaded scene with an in-process consumer. */
+    bool renderFrozenTrack(Mlt::Producer *track, const QString &destination, QString &errorMessage);
 
 private slots:
-    /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
+    /** @brief: To avoid filling the hard drive, remove the oldest unused chunks. */
     void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
     void doPreviewRender(QString scene);
-    /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
-    void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
+    /** @brief: Render the frozen tracks that have no up to date render. */
+    void startFreezeRender();
+    /** @brief: A frozen track render has been created, play it if the track did not change meanwhile. */
+    void gotFrozenTrack(int ix, const QString &hash, const QString &errorMessage);
 
 public slots:
     /** @brief: Prepare and start rendering. */
     void startPreviewRender();
     /** @brief: A chunk has been created, notify ruler. */
     void gotPreviewRender(int frame, const QString &file, int progress);
+    /** @brief: A chunk draft has been created, play it until the final chunk is done. */
+    void gotDraftRender(int frame, const QString &file, int progress);
 
 signals:
     void abortPreview();
     void cleanupOldPreviews();
     void previewRender(int frame, const QString &file, int progress);
+    void draftRender(int frame, const QString &file, int progress);
+    void frozenTrackRendered(int ix, const QString &hash, const QString &errorMessage);
+    void abortFreeze();
 };
 
 #endif
@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "snapindex.h"
+
+#include <algorithm>
+
+void SnapIndex::clear()
+{
+    m_points.clear();
+}
+
+void SnapIndex::addPoint(int frame)
+{
+    m_points.insert(std::upper_bound(m_points.begin(), m_points.end(), frame), frame);
+}
+
+void SnapIndex::removePoint(int frame)
+{
+    QVector<int>::iterator it = std::lower_bound(m_points.begin(), m_points.end(), frame);
+    if (it != m_points.end() && *it == frame) {
+        m_points.erase(it);
+    }
+}
+
+void SnapIndex::setPoints(const QVector<int> &frames)
+{
+    m_points = frames;
+    std::sort(m_points.begin(), m_points.end());
+}
+
+int SnapIndex::closestPoint(double pos, double maxDistance) const
+{
+    QVector<int>::const_iterator it = std::lower_bound(m_points.constBegin(), m_points.constEnd(), pos);
+    int result = -1;
+    double distance = maxDistance;
+    // Only the neighbours of the insertion point can be the closest
+    if (it != m_points.constEnd() && *it - pos < distance) {
+        result = *it;
+        distance = *it - pos;
+    }
+    if (it != m_points.constBegin() && pos - *(it - 1) < distance) {
+        result = *(it - 1);
+    }
+    return result;
+}
+
+int SnapIndex::previousPoint(int pos) const
+{
+    QVector<int>::const_iterator it = std::lower_bound(m_points.constBegin(), m_points.constEnd(), pos);
+    if (it == m_points.constBegin()) {
+        return 0;
+    }
+    return *(it - 1);
+}
+
+int SnapIndex::nextPoint(int pos) const
+{
+    QVector<int>::const_iterator it = std::upper_bound(m_points.constBegin(), m_points.constEnd(), pos);
+    if (it == m_points.constEnd()) {
+        return pos;
+    }
+    return *it;
+}
+
+int SnapIndex::count() const
+{
+    return m_points.count();
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SNAPINDEX_H
+#define SNAPINDEX_H
+
+#include <QVector>
+
+/**
+ * @class SnapIndex
+ * @brief Sorted list of timeline snap frames with binary search lookups.
+ *
+ * A frame can be added several times, for example when two clips touch, so
+ * that removing the points of one item keeps the points of the others.
+ */
+class SnapIndex
+{
+public:
+    void clear();
+    /** @brief Inserts a frame, keeping the list sorted. */
+    void addPoint(int frame);
+    /** @brief Removes one occurrence of a frame, if present. */
+    void removePoint(int frame);
+    /** @brief Replaces all frames, sorting them once. */
+    void setPoints(const QVector<int> &frames);
+    /** @brief Returns the frame closest to pos if it is nearer than maxDistance, -1 otherwise. */
+    int closestPoint(double pos, double maxDistance) const;
+    /** @brief Returns the last frame before pos, 0 if there is none. */
+    int previousPoint(int pos) const;
+    /** @brief Returns the first frame after pos, pos if there is none. */
+    int nextPoint(int pos) const;
+    int count() const;
+
+private:
+    QVector<int> m_points;
+};
+
+#endif
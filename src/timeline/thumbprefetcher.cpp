@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "thumbprefetcher.h"
+#include "customtrackview.h"
+#include "clipitem.h"
+#include "bin/projectclip.h"
+#include "kdenlivesettings.h"
+
+#include <QMap>
+#include <QScrollBar>
+
+// Delay in milliseconds used to coalesce scroll events
+#define PREFETCH_DELAY 40
+// How far ahead the viewport is predicted from the scroll velocity, in milliseconds
+#define PREFETCH_LOOKAHEAD 500
+// Part of the viewport width prefetched on each side of the predicted viewport
+#define PREFETCH_MARGIN 0.5
+
+ThumbPrefetcher::ThumbPrefetcher(CustomTrackView *view) : QObject(view)
+    , m_view(view)
+    , m_velocity(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(PREFETCH_DELAY);
+    connect(&m_timer, &QTimer::timeout, this, &ThumbPrefetcher::prefetch);
+    connect(view->horizontalScrollBar(), &QScrollBar::valueChanged, this, &ThumbPrefetcher::slotViewportChanged);
+    m_clock.start();
+}
+
+void ThumbPrefetcher::slotViewportChanged()
+{
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void ThumbPrefetcher::prefetch()
+{
+    if (!KdenliveSettings::videothumbnails() || m_view->scene() == NULL) {
+        return;
+    }
+    const QRectF visible = m_view->mapToScene(m_view->viewport()->rect()).boundingRect();
+    const qint64 elapsed = qMax((qint64) 1, m_clock.restart());
+    if (qFuzzyCompare(visible.width(), m_lastVisible.width()) && elapsed < 1000) {
+        const double velocity = (visible.left() - m_lastVisible.left()) / elapsed;
+        m_velocity = (m_velocity + velocity) / 2;
+    } else {
+        // Zoom changed or the view was idle, the previous velocity does not apply
+        m_velocity = 0;
+    }
+    m_lastVisible = visible;
+
+    QRectF predicted = visible;
+    const double ahead = m_velocity * PREFETCH_LOOKAHEAD;
+    if (ahead > 0) {
+        predicted.setRight(predicted.right() + ahead);
+    } else {
+        predicted.setLeft(predicted.left() + ahead);
+    }
+    const double margin = visible.width() * PREFETCH_MARGIN;
+    predicted.adjust(-margin, 0, margin, 0);
+
+    // Thumbnails of every frame are only painted at full zoom
+    const bool frameThumbs = m_view->matrix().m11() == m_view->getFrameWidth();
+    QMap<ProjectClip *, QList<int> > frames;
+    foreach (QGraphicsItem *item, m_view->scene()->items(predicted)) {
+        if (item->type() != AVWidget) {
+            continue;
+        }
+        ClipItem *clip = static_cast<ClipItem *>(item);
+        clip->prefetchThumbs();
+        const ClipType type = clip->clipType();
+        if (!frameThumbs || type == Color || type == Audio || type == Image || type == Text || type == QText || type == TextTemplate) {
+            continue;
+        }
+        ProjectClip *binClip = clip->binClip();
+        const ItemInfo info = clip->info();
+        const int offset = (info.startPos - info.cropStart).frames(m_view->fps());
+        const int first = qMax((int) info.cropStart.frames(m_view->fps()) + 1, (int) predicted.left() - offset);
+        const int last = qMin((int) (info.cropStart + info.cropDuration).frames(m_view->fps()) - 1, (int) predicted.right() - offset);
+        QList<int> &clipFrames = frames[binClip];
+        for (int i = first; i <= last; ++i) {
+            if (binClip->findCachedThumb(i).isNull()) {
+                clipFrames << i;
+            }
+        }
+    }
+
+    // Replace the queues of the clips in view, empty the ones of clips that left it
+    QList<QPointer<ProjectClip> > queued;
+    QMap<ProjectClip *, QList<int> >::const_iterator i = frames.constBegin();
+    for (; i != frames.constEnd(); ++i) {
+        i.key()->slotQueryIntraThumbs(i.value(), true);
+        queued << i.key();
+    }
+    foreach (const QPointer<ProjectClip> &clip, m_queuedClips) {
+        if (clip && !frames.contains(clip.data())) {
+            clip->slotQueryIntraThumbs(QList<int>(), true);
+        }
+    }
+    m_queuedClips = queued;
+}
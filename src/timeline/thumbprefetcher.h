@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef THUMBPREFETCHER_H
+#define THUMBPREFETCHER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QRectF>
+#include <QTimer>
+
+class CustomTrackView;
+class ProjectClip;
+
+/**
+ * @class ThumbPrefetcher
+ * @brief Requests the timeline thumbnails of the part of the timeline that is about to be shown.
+ *
+ * The upcoming viewport is predicted from the horizontal scroll velocity of the view, and
+ * extended by a margin on both sides. Missing thumbnails of the clips in that area are
+ * requested in one batch per bin clip, in ascending frame order so that the thumbnail
+ * producer mostly seeks forward. Per frame thumbnails of clips that scrolled out of the
+ * predicted area are dropped from the queues before they are decoded.
+ */
+class ThumbPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbPrefetcher(CustomTrackView *view);
+
+public slots:
+    /** @brief The view was scrolled or zoomed, schedule a prefetch. */
+    void slotViewportChanged();
+
+private slots:
+    void prefetch();
+
+private:
+    CustomTrackView *m_view;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    /** @brief Visible scene rect at the previous prefetch. */
+    QRectF m_lastVisible;
+    /** @brief Smoothed scroll velocity in scene units per millisecond. */
+    double m_velocity;
+    /** @brief Bin clips whose per frame thumbnail queue was filled by the prefetcher. */
+    QList<QPointer<ProjectClip> > m_queuedClips;
+};
+
+#endif
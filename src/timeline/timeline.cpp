@@ -51,6 +51,11 @@
 #include <KIO/FileCopyJob>
 #include <klocalizedstring.h>
 
+#include <algorithm>
+
+// Number of progress updates sent while loading the timeline clips
+#define LOADING_PROGRESS_STEPS 100
+
 ScrollEventEater::ScrollEventEater(QObject *parent) : QObject(parent)
 {
 }
@@ -79,8 +84,17 @@ Timeline::Timeline(KdenliveDoc *doc, const QList<QAction *> &actions, const QLis
     , m_verticalZoom(1)
     , m_timelinePreview(NULL)
     , m_usePreview(false)
+    , m_editDepth(0)
+    , m_editTractor(NULL)
+    , m_dirtyAll(false)
+    , m_refreshPending(false)
+    , m_loadingCancelled(false)
+    , m_loadingStep(1)
 {
     m_trackActions << actions;
+    m_sharingTimer.setSingleShot(true);
+    m_sharingTimer.setInterval(0);
+    connect(&m_sharingTimer, &QTimer::timeout, this, &Timeline::shareTrackProducers);
     setupUi(this);
     splitter->setStretchFactor(1, 2);
     connect(splitter, &QSplitter::splitterMoved, this, &Timeline::storeHeaderSize);
@@ -198,6 +212,8 @@ void Timeline::resizeRuler(int height)
 void Timeline::loadTimeline()
 {
     parseDocument(m_doc->toXml());
+    if (m_loadingCancelled)
+        return;
     m_trackview->slotUpdateAllThumbs();
     slotChangeZoom(m_doc->zoom().x(), m_doc->zoom().y());
     headers_area->verticalScrollBar()->setRange(0, m_trackview->verticalScrollBar()->maximum());
@@ -206,6 +222,16 @@ void Timeline::loadTimeline()
     loadPreviewRender();
 }
 
+void Timeline::cancelLoading()
+{
+    m_loadingCancelled = true;
+}
+
+bool Timeline::loadingCancelled() const
+{
+    return m_loadingCancelled;
+}
+
 QMap <QString, QString> Timeline::documentProperties()
 {
     QMap <QString, QString> props = m_doc->documentProperties();
@@ -280,6 +306,7 @@ void Timeline::setDuration(int dur)
 
 int Timeline::getTracks() {
     int duration = 1;
+    releaseFrozenTracks();
     qDeleteAll<>(m_tracks);
     m_tracks.clear();
     QVBoxLayout *headerLayout = qobject_cast< QVBoxLayout* >(headers_container->layout());
@@ -294,8 +321,12 @@ int Timeline::getTracks() {
         if (playlist_name == QLatin1String("black_track") || playlist_name == QLatin1String("timeline_preview") || playlist_name == QLatin1String("overlay_track")) continue;
         clipsCount += track->count();
     }
+    // Each progress update repaints the modal progress dialog, don't send one per clip
+    m_loadingStep = qMax(1, clipsCount / LOADING_PROGRESS_STEPS);
     emit startLoadingBin(clipsCount);
     emit resetUsageCount();
+    // Indexing every item as it is added is slower than building the index once at the end
+    m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
     checkTrackHeight(false);
     int height = KdenliveSettings::trackheight() * m_scene->scale().y() - 1;
     int headerWidth = 0;
@@ -347,6 +378,8 @@ int Timeline::getTracks() {
             connect(tk, SIGNAL(storeSlowMotion(QString,Mlt::Producer *)), m_doc->renderer(), SLOT(storeSlowmotionProducer(QString,Mlt::Producer *)));
         }
     }
+    m_scene->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+    m_sharingTimer.start();
     headers_area->setMinimumWidth(headerWidth);
     if (audioTarget > -1) {
         m_tracks.at(audioTarget)->trackHeader->switchTarget(true);
@@ -356,6 +389,7 @@ int Timeline::getTracks() {
     }
     updatePalette();
     refreshTrackActions();
+    refreezeTracks();
     return duration;
 }
 
@@ -690,6 +724,12 @@ void Timeline::lockTrack(int ix, bool lock)
         qWarning() << "Set Track effect outisde of range: "<<ix;
         return;
     }
+    if (!lock && isTrackFrozen(ix)) {
+        // Edits are not possible on the render, unlocking a track unfreezes it
+        tk->setProperty(QStringLiteral("kdenlive:frozen"), 0);
+        if (m_timelinePreview)
+            m_timelinePreview->unfreezeTrack(ix);
+    }
     tk->lockTrack(lock);
 }
 
@@ -790,6 +830,8 @@ void Timeline::doSwitchTrackVideo(int ix, bool hide)
         // unhide
         invalidateTrack(ix);
     }
+    if (m_timelinePreview)
+        m_timelinePreview->updateFrozenState(ix);
     refreshTractor();
     m_doc->renderer()->doRefresh();
 }
@@ -828,6 +870,8 @@ void Timeline::doSwitchTrackAudio(int ix, bool mute)
         newstate = 0;
     }
     tk->setState(newstate);
+    if (m_timelinePreview)
+        m_timelinePreview->updateFrozenState(ix);
     m_tractor->multitrack()->refresh();
     m_tractor->refresh();
 }
@@ -920,18 +964,73 @@ void Timeline::reloadTrack(int ix, int start, int end)
     // Remove current clips
     int startIndex = pl.get_clip_index_at(start);
     int endIndex = pl.get_clip_index_at(end);
+    double fps = m_doc->fps();
     double startY = m_trackview->getPositionFromTrack(ix) + 2;
     QRectF r(start, startY, end - start, 2);
     QList<QGraphicsItem *> selection = m_scene->items(r);
-    QList<QGraphicsItem *> toDelete;
+    QMultiMap <int, ClipItem *> currentItems;
     for (int i = 0; i < selection.count(); i++) {
         if (selection.at(i)->type() == AVWidget) {
-            toDelete << selection.at(i);
+            ClipItem *item = static_cast<ClipItem *>(selection.at(i));
+            currentItems.insert(item->startPos().frames(fps), item);
         }
     }
-    qDeleteAll(toDelete);
-    // Reload items
-    loadTrack(ix, 0, pl, startIndex, endIndex, false);
+    // Keep the items that still match their playlist entry (and their thumbnails), reload the others
+    QList <int> toLoad;
+    Mlt::ClipInfo info;
+    for (int i = startIndex; i <= endIndex && i < pl.count(); ++i) {
+        if (pl.is_blank(i)) {
+            continue;
+        }
+        pl.clip_info(i, &info);
+        ClipItem *item = currentItems.value(info.start);
+        if (item && isSameClip(item, &info)) {
+            currentItems.remove(info.start, item);
+        } else {
+            toLoad << i;
+        }
+    }
+    qDeleteAll(currentItems);
+    // Reload from the end, loadTrack may remove invalid entries from the playlist
+    for (int i = toLoad.count() - 1; i >= 0; --i) {
+        loadTrack(ix, 0, pl, toLoad.at(i), toLoad.at(i), false);
+    }
+}
+
+bool Timeline::isSameClip(ClipItem *item, Mlt::ClipInfo *info) const
+{
+    double fps = m_doc->fps();
+    ItemInfo itemInfo = item->info();
+    if (itemInfo.startPos.frames(fps) != info->start || itemInfo.cropStart.frames(fps) != info->frame_in || itemInfo.cropDuration.frames(fps) != info->frame_count) {
+        return false;
+    }
+    if (item->producerKey() != ClipItem::makeProducerKey(info->producer->get("id"), info->producer->get_int("audio_index"), info->producer->get_int("video_index"))) {
+        return false;
+    }
+    // Compare effects, keyframe effects use several consecutive filters with the same index
+    const EffectsList effects = item->effectList();
+    int effectIx = 0;
+    int lastIndex = -1;
+    for (int i = 0; i < info->cut->filter_count(); ++i) {
+        QScopedPointer<Mlt::Filter> filter(info->cut->filter(i));
+        int index = filter->get_int("kdenlive_ix");
+        if (index == lastIndex && index != 0) {
+            continue;
+        }
+        lastIndex = index;
+        // The speed effect has no filter
+        while (effectIx < effects.count() && effects.at(effectIx).attribute(QStringLiteral("id")) == QLatin1String("speed")) {
+            effectIx++;
+        }
+        if (effectIx >= effects.count() || effects.at(effectIx).attribute(QStringLiteral("id")) != QString(filter->get("kdenlive_id"))) {
+            return false;
+        }
+        effectIx++;
+    }
+    while (effectIx < effects.count() && effects.at(effectIx).attribute(QStringLiteral("id")) == QLatin1String("speed")) {
+        effectIx++;
+    }
+    return effectIx == effects.count();
 }
 
 void Timeline::reloadTrack(ItemInfo info, bool includeLastFrame)
@@ -954,8 +1053,11 @@ int Timeline::loadTrack(int ix, int offset, Mlt::Playlist &playlist, int start,
     if (end == -1)
         end = playlist.count();
     bool locked = playlist.get_int("kdenlive:locked_track") == 1;
-    for(int i = start; i <= end; ++i) {
-        emit loadingBin(offset + i + 1);
+    const int frameWidth = m_trackview->getFrameWidth();
+    const int trackOffset = KdenliveSettings::trackheight() * (visibleTracksCount() - ix) + 1;
+    for(int i = start; i <= end && !m_loadingCancelled; ++i) {
+        if ((offset + i + 1) % m_loadingStep == 0)
+            emit loadingBin(offset + i + 1);
         if (playlist.is_blank(i)) {
             continue;
         }
@@ -991,8 +1093,7 @@ int Timeline::loadTrack(int ix, int offset, Mlt::Playlist &playlist, int start,
             slowInfo.state = (PlaylistState::ClipState) idString.section(':', 4, 4).toInt();
 	    // Slowmotion producer, store it for reuse
             Mlt::Producer *parentProd = new Mlt::Producer(clip->parent());
-            QString url = parentProd->get("warp_resource");
-            if (!m_doc->renderer()->storeSlowmotionProducer(slowInfo.toString(locale) + url, parentProd)) {
+            if (!m_doc->renderer()->storeSlowmotionProducer(slowInfo.poolKey(id.section('_', 0, 0), locale), parentProd)) {
                 delete parentProd;
             }
         }
@@ -1020,9 +1121,9 @@ int Timeline::loadTrack(int ix, int offset, Mlt::Playlist &playlist, int start,
         clipinfo.cropDuration = GenTime(info->frame_count, fps);
         clipinfo.track = ix;
 	//qDebug()<<"// Loading clip: "<<clipinfo.startPos.frames(25)<<" / "<<clipinfo.endPos.frames(25)<<"\n++++++++++++++++++++++++";
-        ClipItem *item = new ClipItem(binclip, clipinfo, fps, slowInfo.speed, slowInfo.strobe, m_trackview->getFrameWidth(), true);
+        ClipItem *item = new ClipItem(binclip, clipinfo, fps, slowInfo.speed, slowInfo.strobe, frameWidth, true);
         connect(item, &AbstractClipItem::selectItem, m_trackview, &CustomTrackView::slotSelectItem);
-        item->setPos(clipinfo.startPos.frames(fps), KdenliveSettings::trackheight() * (visibleTracksCount() - clipinfo.track) + 1 + item->itemOffset());
+        item->setPos(clipinfo.startPos.frames(fps), trackOffset + item->itemOffset());
         //qDebug()<<" * * Loaded clip on tk: "<<clipinfo.track<< ", POS: "<<clipinfo.startPos.frames(fps);
         item->updateState(idString, info->producer->get_int("audio_index"), info->producer->get_int("video_index"), originalState);
         m_scene->addItem(item);
@@ -1053,8 +1154,7 @@ void Timeline::loadGuides(QMap <double, QString> guidesData)
 
 void Timeline::getEffects(Mlt::Service &service, ClipItem *clip, int track) {
     int effectNb = clip == NULL ? 0 : clip->effectsCount();
-    QLocale locale;
-    locale.setNumberOptions(QLocale::OmitGroupSeparator);
+    const ProfileInfo info = m_doc->getProfileInfo();
     for (int ix = 0; ix < service.filter_count(); ++ix) {
         QScopedPointer<Mlt::Filter> effect(service.filter(ix));
         QDomElement clipeffect = getEffectByTag(effect->get("tag"), effect->get("kdenlive_id"));
@@ -1069,10 +1169,7 @@ void Timeline::getEffects(Mlt::Service &service, ClipItem *clip, int track) {
         currenteffect.setAttribute(QStringLiteral("kdenlive_ix"), QString::number(effectNb));
         currenteffect.setAttribute(QStringLiteral("kdenlive_info"), effect->get("kdenlive_info"));
         currenteffect.setAttribute(QStringLiteral("disable"), effect->get("disable"));
-        QDomNodeList clipeffectparams = currenteffect.childNodes();
-
         QDomNodeList params = currenteffect.elementsByTagName(QStringLiteral("parameter"));
-	ProfileInfo info = m_doc->getProfileInfo();
         for (int i = 0; i < params.count(); ++i) {
             QDomElement e = params.item(i).toElement();
             if (e.attribute(QStringLiteral("type")) == QLatin1String("keyframe")) e.setAttribute(QStringLiteral("keyframes"), getKeyframes(service, ix, e));
@@ -1091,7 +1188,7 @@ void Timeline::getEffects(Mlt::Service &service, ClipItem *clip, int track) {
         }
         if (QString(effect->get("tag")) == QLatin1String("region")) getSubfilters(effect.data(), currenteffect);
         if (clip) {
-            clip->addEffect(m_doc->getProfileInfo(), currenteffect, false);
+            clip->addEffect(info, currenteffect, false);
         } else {
             addTrackEffect(track, currenteffect, false);
         }
@@ -1306,6 +1403,11 @@ void Timeline::updateProfile(double fpsChanged)
     m_trackview->updateSceneFrameWidth(fpsChanged);
 }
 
+void Timeline::updateFrameSize(double xScale, double yScale)
+{
+    m_trackview->scaleGeometries(xScale, yScale);
+}
+
 void Timeline::checkTrackHeight(bool force)
 {
     if (m_trackview->checkTrackHeight(force)) {
@@ -1542,27 +1644,27 @@ void Timeline::updateClipProperties(const QString &id, QMap <QString, QString> p
 int Timeline::changeClipSpeed(ItemInfo info, ItemInfo speedIndependantInfo, PlaylistState::ClipState state, double speed, int strobe, Mlt::Producer *originalProd, bool removeEffect)
 {
     QLocale locale;
-    QString url = QString::fromUtf8(originalProd->get("resource"));
     Track::SlowmoInfo slowInfo;
     slowInfo.speed = speed;
     slowInfo.strobe = strobe;
     slowInfo.state = state;
-    url.prepend(slowInfo.toString(locale));
-    //if (strobe > 1) url.append("&strobe=" + QString::number(strobe));
+    QString id = originalProd->get("id");
+    id = id.section(QStringLiteral("_"), 0,  0);
     Mlt::Producer *prod;
     if (removeEffect) {
         // We want to remove framebuffer producer, so pass original
         prod = originalProd;
     } else {
         // Pass slowmotion producer
-        prod = m_doc->renderer()->getSlowmotionProducer(url);
+        prod = m_doc->renderer()->getSlowmotionProducer(slowInfo.poolKey(id, locale));
     }
-    QString id = originalProd->get("id");
-    id = id.section(QStringLiteral("_"), 0,  0);
     Mlt::Properties passProperties;
     Mlt::Properties original(originalProd->get_properties());
     passProperties.pass_list(original, ClipController::getPassPropertiesList(false));
-    return track(info.track)->changeClipSpeed(info, speedIndependantInfo, state, speed, strobe, prod, id, passProperties);
+    int length = track(info.track)->changeClipSpeed(info, speedIndependantInfo, state, speed, strobe, prod, id, passProperties);
+    // The previous speed might not be used anymore
+    m_doc->renderer()->releaseSlowmotionProducers();
+    return length;
 }
 
 void Timeline::duplicateClipOnPlaylist(int tk, qreal startPos, int offset, Mlt::Producer *prod)
@@ -1636,12 +1738,39 @@ void Timeline::slotMultitrackView(bool enable)
     transitionHandler->enableMultiTrack(enable);
 }
 
+void Timeline::slotMultitrackViewToggled(bool enable)
+{
+    // Take the tracks now, they are forgotten when the view is disabled
+    QList <int> tracks = transitionHandler->multitrackTracks();
+    slotMultitrackView(enable);
+    m_doc->renderer()->setGridPreview(enable);
+    if (!enable && !m_angleSwitches.isEmpty()) {
+        // Switches are only recorded during playback, the clips are cut once
+        m_trackview->applyAngleSwitches(m_angleSwitches, tracks);
+        m_angleSwitches.clear();
+    }
+}
+
+void Timeline::switchAngle(int angle)
+{
+    QList <int> tracks = transitionHandler->multitrackTracks();
+    if (!multitrackView || angle < 0 || angle >= tracks.count()) {
+        emit displayMessage(i18n("Enable the multitrack view to switch angles"), ErrorMessage);
+        return;
+    }
+    m_angleSwitches.insert(m_trackview->cursorPos(), tracks.at(angle));
+    emit displayMessage(i18n("Angle %1 at %2", angle + 1, m_doc->timecode().getTimecodeFromFrames(m_trackview->cursorPos())), InformationMessage);
+}
+
 void Timeline::connectOverlayTrack(bool enable)
 {
-    if (!m_hasOverlayTrack && !m_usePreview) return;
+    bool hasFrozenTracks = m_timelinePreview && m_timelinePreview->hasFrozenTracks();
+    if (!m_hasOverlayTrack && !m_usePreview && !hasFrozenTracks) return;
     m_tractor->lock();
     if (enable) {
         // Re-add overlaytrack
+        if (hasFrozenTracks)
+            m_timelinePreview->reconnectFrozenTracks();
         if (m_usePreview)
             m_timelinePreview->reconnectTrack();
         if (m_hasOverlayTrack) {
@@ -1650,6 +1779,9 @@ void Timeline::connectOverlayTrack(bool enable)
             m_overlayTrack = NULL;
         }
     } else {
+        // Frozen tracks are saved and rendered from their clips
+        if (hasFrozenTracks)
+            m_timelinePreview->disconnectFrozenTracks();
         if (m_usePreview)
             m_timelinePreview->disconnectTrack();
         if (m_hasOverlayTrack) {
@@ -1682,10 +1814,9 @@ bool Timeline::createOverlay(Mlt::Filter *filter, int tk, int startPos)
     m_tractor->lock();
     int clipIndex = sourceTrack->playlist().get_clip_index_at(startPos);
     Mlt::Producer *clipProducer = sourceTrack->playlist().get_clip(clipIndex);
-    Clip clp(clipProducer->parent());
-    Mlt::Producer *cln = clp.clone();
-    Clip(*cln).deleteEffects();
-    cln->set_in_and_out(clipProducer->get_in(), clipProducer->get_out());
+    // A bare cut of the same parent has no effects and shares its decoder,
+    // so the unprocessed half comes from the image cache instead of a second decode
+    Mlt::Producer *cln = clipProducer->parent().cut(clipProducer->get_in(), clipProducer->get_out());
     Mlt::Playlist overlay(*m_tractor->profile());
     Mlt::Tractor trac(*m_tractor->profile());
     trac.set_track(*clipProducer, 0);
@@ -1854,8 +1985,20 @@ void Timeline::stopPreviewRender()
 
 void Timeline::invalidateRange(ItemInfo info)
 {
+    // Clips were edited, the tracks might be able to share more duplicates, or have to split some
+    m_sharingTimer.start();
     if (!m_timelinePreview)
         return;
+    if (m_editDepth > 0) {
+        if (info.isValid()) {
+            m_dirtyRanges << QPoint(info.startPos.frames(m_doc->fps()), info.endPos.frames(m_doc->fps()));
+            if (!m_dirtyTracks.contains(info.track))
+                m_dirtyTracks << info.track;
+        } else
+            m_dirtyAll = true;
+        return;
+    }
+    m_timelinePreview->invalidateFrozenTrack(info.isValid() ? info.track : -1);
     if (info.isValid())
         m_timelinePreview->invalidatePreview(info.startPos.frames(m_doc->fps()), info.endPos.frames(m_doc->fps()));
     else {
@@ -1863,6 +2006,131 @@ void Timeline::invalidateRange(ItemInfo info)
     }
 }
 
+static bool rangesOverlap(const QList <QPoint> &a, const QList <QPoint> &b)
+{
+    foreach(const QPoint &p, a) {
+        foreach(const QPoint &q, b) {
+            if (p.x() < q.y() && q.x() < p.y()) return true;
+        }
+    }
+    return false;
+}
+
+void Timeline::shareTrackProducers()
+{
+    if (!KdenliveSettings::sharetrackproducers()) return;
+    // Frame ranges read through duplicates, by duplicate key and track
+    QMap <QString, QMap <int, QList <QPoint> > > usage;
+    for (int i = 1; i < m_tracks.count(); i++) {
+        QMapIterator<QString, QList <QPoint> > r(m_tracks.at(i)->duplicateRanges());
+        while (r.hasNext()) {
+            r.next();
+            usage[r.key()].insert(i, r.value());
+        }
+    }
+    if (usage.isEmpty()) return;
+    Mlt::Tractor *tractor = m_doc->renderer()->lockService();
+    bool changed = false;
+    QMapIterator<QString, QMap <int, QList <QPoint> > > u(usage);
+    while (u.hasNext()) {
+        u.next();
+        const QString key = u.key();
+        // Each track uses the first duplicate that none of its reads overlap, or gets a new one
+        QList <QList <int> > duplicates;
+        QList <QList <QPoint> > busy;
+        QMapIterator<int, QList <QPoint> > t(u.value());
+        while (t.hasNext()) {
+            t.next();
+            int ix = 0;
+            while (ix < busy.count() && rangesOverlap(busy.at(ix), t.value())) {
+                ix++;
+            }
+            if (ix == busy.count()) {
+                duplicates << QList <int>();
+                busy << QList <QPoint>();
+            }
+            duplicates[ix] << t.key();
+            busy[ix] << t.value();
+        }
+        QList <mlt_service> used;
+        for (int ix = 0; ix < duplicates.count(); ix++) {
+            // The duplicate is named after its first track, so that the ids stay unique
+            int owner = duplicates.at(ix).first();
+            Mlt::Producer *prod = m_tracks.at(owner)->duplicateProducer(key);
+            if (prod == NULL) continue;
+            if (used.contains(prod->get_service())) {
+                Mlt::Producer *clone = Clip(*prod).clone();
+                delete prod;
+                prod = clone;
+            }
+            used << prod->get_service();
+            QString id = key.section(QLatin1Char('_'), 0, 0) + QLatin1Char('_') + m_tracks.at(owner)->playlist().get("id");
+            if (key.endsWith(QLatin1String("_audio"))) id.append(QStringLiteral("_audio"));
+            prod->set("id", id.toUtf8().constData());
+            foreach(int tk, duplicates.at(ix)) {
+                if (m_tracks.at(tk)->setDuplicateProducer(key, prod)) changed = true;
+            }
+            delete prod;
+        }
+    }
+    m_doc->renderer()->unlockService(tractor);
+    if (changed) refreshTractor();
+}
+
+void Timeline::beginEdits()
+{
+    if (m_editDepth++ > 0)
+        return;
+    m_dirtyRanges.clear();
+    m_dirtyTracks.clear();
+    m_dirtyAll = false;
+    m_refreshPending = false;
+    m_editTractor = m_doc->renderer()->lockService();
+}
+
+void Timeline::endEdits()
+{
+    if (m_editDepth == 0 || --m_editDepth > 0)
+        return;
+    m_doc->renderer()->unlockService(m_editTractor);
+    m_editTractor = NULL;
+    if (m_timelinePreview) {
+        if (m_dirtyAll) {
+            m_timelinePreview->invalidateFrozenTrack(-1);
+            m_timelinePreview->invalidatePreview(0, m_trackview->duration());
+        } else if (!m_dirtyRanges.isEmpty()) {
+            foreach(int ix, m_dirtyTracks) {
+                m_timelinePreview->invalidateFrozenTrack(ix);
+            }
+            // Merge overlapping ranges so that the preview is only aborted once
+            std::sort(m_dirtyRanges.begin(), m_dirtyRanges.end(), [](const QPoint &a, const QPoint &b) { return a.x() < b.x(); });
+            QList <QPoint> merged;
+            foreach(const QPoint &p, m_dirtyRanges) {
+                if (!merged.isEmpty() && p.x() <= merged.last().y())
+                    merged.last().setY(qMax(merged.last().y(), p.y()));
+                else
+                    merged << p;
+            }
+            m_timelinePreview->invalidatePreview(merged);
+        }
+    }
+    m_dirtyRanges.clear();
+    m_dirtyTracks.clear();
+    m_dirtyAll = false;
+    if (m_refreshPending) {
+        m_refreshPending = false;
+        m_doc->renderer()->doRefresh();
+    }
+}
+
+void Timeline::requestMonitorRefresh()
+{
+    if (m_editDepth > 0)
+        m_refreshPending = true;
+    else
+        m_doc->renderer()->doRefresh();
+}
+
 void Timeline::loadPreviewRender()
 {
     QString chunks = m_doc->getDocumentProperty(QStringLiteral("previewchunks"));
@@ -1871,7 +2139,6 @@ void Timeline::loadPreviewRender()
     m_disablePreview->blockSignals(true);
     m_disablePreview->setChecked(m_doc->getDocumentProperty(QStringLiteral("disablepreview")).toInt());
     m_disablePreview->blockSignals(false);
-    QDateTime documentDate = QFileInfo(m_doc->url().path()).lastModified();
     if (!chunks.isEmpty() || !dirty.isEmpty()) {
         if (!m_timelinePreview) {
             initializePreview();
@@ -1879,13 +2146,147 @@ void Timeline::loadPreviewRender()
         if (!m_timelinePreview || m_disablePreview->isChecked())
             return;
         m_timelinePreview->buildPreviewTrack();
-        m_timelinePreview->loadChunks(chunks.split(",", QString::SkipEmptyParts), dirty.split(",", QString::SkipEmptyParts), documentDate);
+        m_timelinePreview->loadChunks(chunks.split(",", QString::SkipEmptyParts), dirty.split(",", QString::SkipEmptyParts));
         m_usePreview = true;
     } else {
         m_ruler->hidePreview(true);
     }
 }
 
+QMap <int, QString> Timeline::renderedPreviewChunks(QString &extension, QStringList &parameters)
+{
+    if (!m_timelinePreview || !m_usePreview || m_disablePreview->isChecked()) {
+        return QMap <int, QString>();
+    }
+    extension = m_timelinePreview->extension();
+    parameters = m_timelinePreview->consumerParams();
+    return m_timelinePreview->renderedChunks();
+}
+
+Timeline::PreviewChunkState Timeline::previewChunkState(int frame) const
+{
+    if (!m_timelinePreview || !m_usePreview || m_disablePreview->isChecked() || KdenliveSettings::timelinechunks() <= 0) {
+        return NoPreviewChunk;
+    }
+    const int chunk = frame - frame % KdenliveSettings::timelinechunks();
+    if (m_ruler->getDraftChunks().contains(chunk)) {
+        return DraftPreviewChunk;
+    }
+    if (m_ruler->getDirtyChunks().contains(chunk)) {
+        return PendingPreviewChunk;
+    }
+    if (m_ruler->getProcessedChunks().contains(chunk)) {
+        return RenderedPreviewChunk;
+    }
+    return NoPreviewChunk;
+}
+
+QList <PassthroughZone> Timeline::passthroughZones(bool allowProxies)
+{
+    QList <PassthroughZone> zones;
+    // Frame ranges where the picture is not a plain copy of a single clip
+    QList <QPoint> busy;
+    mlt_service service = mlt_service_get_producer(m_tractor->get_service());
+    while (service) {
+        Mlt::Properties prop(MLT_SERVICE_PROPERTIES(service));
+        if (QString(prop.get("mlt_type")) != QLatin1String("transition"))
+            break;
+        // The automatic track compositing does not change a clip covering the whole frame
+        if (prop.get_int("internal_added") != 237) {
+            busy << QPoint(prop.get_int("in"), prop.get_int("out") + 1);
+        }
+        service = mlt_service_producer(service);
+    }
+    QList <PassthroughZone> candidates;
+    // Index in clips of each candidate
+    QList <int> candidateClips;
+    QList <QPoint> clips;
+    for (int i = 1; i < m_tractor->count(); ++i) {
+        QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
+        if (track->get_int("hide") & 1) {
+            continue;
+        }
+        Mlt::Playlist playlist(*track);
+        if (playlist.get_int("kdenlive:audio_track") == 1) {
+            continue;
+        }
+        bool trackEffects = false;
+        for (int j = 0; j < playlist.filter_count(); ++j) {
+            QScopedPointer<Mlt::Filter> filter(playlist.filter(j));
+            if (filter->get("kdenlive_id") && !filter->get_int("disable")) trackEffects = true;
+        }
+        for (int j = 0; j < playlist.count(); ++j) {
+            if (playlist.is_blank(j)) {
+                continue;
+            }
+            const int start = playlist.clip_start(j);
+            const int end = start + playlist.clip_length(j);
+            clips << QPoint(start, end);
+            QScopedPointer<Mlt::Producer> clip(playlist.get_clip(j));
+            if (trackEffects || clip == NULL || !clip->is_valid()) {
+                continue;
+            }
+            bool effects = false;
+            for (int k = 0; k < clip->filter_count(); ++k) {
+                QScopedPointer<Mlt::Filter> filter(clip->filter(k));
+                if (filter->get("kdenlive_id") && !filter->get_int("disable")) effects = true;
+            }
+            Mlt::Producer parent(clip->parent());
+            const QString mltService = parent.get("mlt_service");
+            // The render uses the original clips, so a proxied clip cannot be copied from the timeline producer
+            const QString proxy = parent.get("kdenlive:proxy");
+            if (effects || !mltService.startsWith(QLatin1String("avformat")) || parent.get_int("video_index") < 0 || parent.get("force_fps") || parent.get("force_aspect_ratio") || (proxy.length() > 2 && !allowProxies)) {
+                continue;
+            }
+            const int vindex = parent.get_int("video_index");
+            PassthroughZone zone;
+            zone.start = start;
+            zone.end = end;
+            zone.sourceIn = clip->get_in();
+            zone.url = QString::fromUtf8(parent.get("resource"));
+            // Track producers of audio clips are named after the bin id and track
+            zone.clipId = QString(parent.get("id")).section(QLatin1Char('_'), 0, 0);
+            zone.codec = parent.get(QStringLiteral("meta.media.%1.codec.name").arg(vindex).toUtf8().constData());
+            zone.pixelFormat = parent.get(QStringLiteral("meta.media.%1.codec.pix_fmt").arg(vindex).toUtf8().constData());
+            zone.width = parent.get_int("meta.media.width");
+            zone.height = parent.get_int("meta.media.height");
+            zone.fps = parent.get_double("meta.media.frame_rate_den") > 0 ? parent.get_double("meta.media.frame_rate_num") / parent.get_double("meta.media.frame_rate_den") : 0;
+            candidates << zone;
+            candidateClips << clips.count() - 1;
+        }
+    }
+    // Remove the frames where another clip or a transition is visible
+    for (int i = 0; i < candidates.count(); ++i) {
+        const PassthroughZone &candidate = candidates.at(i);
+        QList <QPoint> pieces;
+        pieces << QPoint(candidate.start, candidate.end);
+        QList <QPoint> others = busy;
+        for (int j = 0; j < clips.count(); ++j) {
+            if (j != candidateClips.at(i)) others << clips.at(j);
+        }
+        foreach(const QPoint &other, others) {
+            QList <QPoint> remaining;
+            foreach(const QPoint &piece, pieces) {
+                if (other.y() <= piece.x() || other.x() >= piece.y()) {
+                    remaining << piece;
+                    continue;
+                }
+                if (other.x() > piece.x()) remaining << QPoint(piece.x(), other.x());
+                if (other.y() < piece.y()) remaining << QPoint(other.y(), piece.y());
+            }
+            pieces = remaining;
+        }
+        foreach(const QPoint &piece, pieces) {
+            PassthroughZone zone = candidate;
+            zone.start = piece.x();
+            zone.end = piece.y();
+            zone.sourceIn = candidate.sourceIn + piece.x() - candidate.start;
+            zones << zone;
+        }
+    }
+    return zones;
+}
+
 void Timeline::updatePreviewSettings(const QString &profile)
 {
     if (profile.isEmpty()) return;
@@ -1906,8 +2307,66 @@ void Timeline::invalidateTrack(int ix)
         return;
     Track* tk = track(ix);
     QList <QPoint> visibleRange = tk->visibleClips();
-    foreach(const QPoint p, visibleRange) {
-        m_timelinePreview->invalidatePreview(p.x(), p.y());
+    if (m_editDepth > 0) {
+        m_dirtyRanges << visibleRange;
+        if (!m_dirtyTracks.contains(ix))
+            m_dirtyTracks << ix;
+        return;
+    }
+    m_timelinePreview->invalidateFrozenTrack(ix);
+    m_timelinePreview->invalidatePreview(visibleRange);
+}
+
+void Timeline::freezeTrack(int ix, bool freeze)
+{
+    Track *tk = track(ix);
+    if (tk == NULL || ix == 0 || freeze == isTrackFrozen(ix))
+        return;
+    if (freeze) {
+        if (!m_timelinePreview)
+            initializePreview();
+        if (!m_timelinePreview)
+            return;
+        bool locked = isTrackLocked(ix);
+        // 2 means that the track was already locked, so unfreezing keeps it locked
+        tk->setProperty(QStringLiteral("kdenlive:frozen"), locked ? 2 : 1);
+        if (!locked)
+            m_trackview->lockTrack(ix, true);
+        m_timelinePreview->freezeTrack(ix);
+    } else {
+        bool locked = tk->getIntProperty(QStringLiteral("kdenlive:frozen")) == 2;
+        tk->setProperty(QStringLiteral("kdenlive:frozen"), 0);
+        if (m_timelinePreview)
+            m_timelinePreview->unfreezeTrack(ix);
+        if (!locked)
+            m_trackview->lockTrack(ix, false);
+    }
+    m_doc->renderer()->doRefresh();
+    m_doc->setModified(true);
+}
+
+bool Timeline::isTrackFrozen(int ix)
+{
+    Track *tk = track(ix);
+    return tk && tk->getIntProperty(QStringLiteral("kdenlive:frozen")) > 0;
+}
+
+void Timeline::releaseFrozenTracks()
+{
+    if (m_timelinePreview)
+        m_timelinePreview->releaseFrozenTracks();
+}
+
+void Timeline::refreezeTracks()
+{
+    for (int i = 1; i < m_tracks.count(); i++) {
+        if (!isTrackFrozen(i))
+            continue;
+        if (!m_timelinePreview)
+            initializePreview();
+        if (!m_timelinePreview)
+            return;
+        m_timelinePreview->freezeTrack(i);
     }
 }
 
@@ -1980,7 +2439,7 @@ void Timeline::disablePreview(bool disable)
                 m_tractor->unlock();
             }
             QPair <QStringList, QStringList> chunks = m_ruler->previewChunks();
-            m_timelinePreview->loadChunks(chunks.first, chunks.second, QDateTime());
+            m_timelinePreview->loadChunks(chunks.first, chunks.second);
             m_ruler->hidePreview(false);
             m_usePreview = true;
         }
@@ -2016,7 +2475,10 @@ void Timeline::switchComposite(int mode)
             videoTracks << i;
         }
     }
-    transitionHandler->rebuildTransitions(mode, videoTracks, maxTrack);
+    if (!transitionHandler->rebuildTransitions(mode, videoTracks, maxTrack)) {
+        // Compositing already matches the tracks
+        return;
+    }
     m_doc->renderer()->doRefresh();
     m_doc->setModified();
 }
@@ -35,6 +35,7 @@
 #include <QGraphicsLineItem>
 #include <QDomElement>
 #include <QDir>
+#include <QTimer>
 
 #include <mlt++/Mlt.h>
 
@@ -66,6 +67,9 @@ public:
     explicit Timeline(KdenliveDoc *doc, const QList <QAction *>& actions, const QList<QAction *> &rulerActions, bool *ok, QWidget *parent = 0);
     virtual ~ Timeline();
 
+    /** @brief State of the timeline preview chunk containing a frame. */
+    enum PreviewChunkState { NoPreviewChunk = 0, PendingPreviewChunk, RenderedPreviewChunk, DraftPreviewChunk };
+
     /** @brief is multitrack view (split screen for tracks) enabled */
     bool multitrackView;
     int videoTarget;
@@ -184,10 +188,29 @@ public:
     void updatePreviewSettings(const QString &profile);
     /** @brief invalidate timeline preview for visible clips in a track */
     void invalidateTrack(int ix);
+    /** @brief Play a track from a cached render of its clips and effects, or from its clips again.
+     *  A frozen track is locked, it is rendered again when its clips or effects change. */
+    void freezeTrack(int ix, bool freeze);
+    /** @brief Returns true if the track is frozen. */
+    bool isTrackFrozen(int ix);
+    /** @brief Put the original tracks back before the track indexes change, they are frozen again on tracks reload. */
+    void releaseFrozenTracks();
     /** @brief Start rendering preview rendering range. */
     void startPreviewRender();
+    /** @brief Returns the up to date timeline preview chunk files by start frame, and the parameters they were encoded with. */
+    QMap <int, QString> renderedPreviewChunks(QString &extension, QStringList &parameters);
+    /** @brief Returns whether the frame is played from a rendered preview chunk or its draft, waits for one or is not in the preview zone. */
+    PreviewChunkState previewChunkState(int frame) const;
+    /** @brief Returns the zones where the only visible video is an unmodified cut of a file
+     *  @param allowProxies true to include proxied clips, which are displayed unmodified by the monitors */
+    QList <PassthroughZone> passthroughZones(bool allowProxies = false);
     /** @brief Toggle current project's compositing mode. */
     void switchComposite(int mode);
+    /** @brief Returns true if the user cancelled the timeline loading. */
+    bool loadingCancelled() const;
+    /** @brief Let the tracks reading the same clip at different times use the same duplicate producer.
+     *  Tracks whose reads overlap keep separate duplicates, MLT cannot mix a producer with itself. */
+    void shareTrackProducers();
 
 public slots:
     void slotDeleteClip(const QString &clipId, QUndoCommand *deleteCommand);
@@ -198,13 +221,29 @@ public slots:
     void slotSaveTimelinePreview(const QString &path);
     void checkDuration();
     void slotShowTrackEffects(int);
+    /** @brief Stop populating the tracks, the project is being closed. */
+    void cancelLoading();
     void updateProfile(double fpsChanged);
+    /** @brief The project frame size changed without fps change, adapt the timeline geometries. */
+    void updateFrameSize(double xScale, double yScale);
     /** @brief Enable/disable multitrack view (split monitor in 4) */
     void slotMultitrackView(bool enable);
+    /** @brief The user switched the multitrack view, the recorded angle switches are applied when it is closed */
+    void slotMultitrackViewToggled(bool enable);
+    /** @brief Record a multicam switch to the track shown in screen @param angle of the multitrack view, at the cursor position */
+    void switchAngle(int angle);
     /** @brief Stop rendering preview. */
     void stopPreviewRender();
     /** @brief Invalidate a preview rendering range. */
     void invalidateRange(ItemInfo info = ItemInfo());
+    /** @brief Start a batch of timeline edits.
+     *  The MLT service stays locked and preview invalidation / monitor refresh are
+     *  deferred until the matching endEdits(). Calls can be nested. */
+    void beginEdits();
+    /** @brief Close an edit batch, invalidating the merged dirty ranges and refreshing the monitor once. */
+    void endEdits();
+    /** @brief Refresh the monitor now, or when the current edit batch ends. */
+    void requestMonitorRefresh();
 
 private:
     Mlt::Tractor *m_tractor;
@@ -229,11 +268,35 @@ private:
     PreviewManager *m_timelinePreview;
     bool m_usePreview;
     QAction *m_disablePreview;
+    /** @brief Nesting level of beginEdits() calls */
+    int m_editDepth;
+    /** @brief The locked tractor while an edit batch is running */
+    Mlt::Tractor *m_editTractor;
+    /** @brief Preview ranges invalidated during the current edit batch */
+    QList <QPoint> m_dirtyRanges;
+    /** @brief True if the whole timeline was invalidated during the current edit batch */
+    bool m_dirtyAll;
+    /** @brief Tracks invalidated during the current edit batch, checked for frozen tracks changes */
+    QList <int> m_dirtyTracks;
+    /** @brief True if a monitor refresh was requested during the current edit batch */
+    bool m_refreshPending;
+    /** @brief True if the user cancelled the project loading */
+    bool m_loadingCancelled;
+    /** @brief Number of clips loaded between two progress updates */
+    int m_loadingStep;
+    /** @brief Groups the track edits before sharing the track duplicates again */
+    QTimer m_sharingTimer;
+    /** @brief Multicam angle switches recorded in the multitrack view: selected track for each position */
+    QMap <int, int> m_angleSwitches;
 
     void adjustTrackHeaders();
+    /** @brief Freeze the tracks saved as frozen in the project. */
+    void refreezeTracks();
 
     void parseDocument(const QDomDocument &doc);
     int loadTrack(int ix, int offset, Mlt::Playlist &playlist, int start = 0, int end = -1, bool updateReferences = true);
+    /** @brief Returns true if @param item still represents the playlist entry @param info, with the same effects. */
+    bool isSameClip(ClipItem *item, Mlt::ClipInfo *info) const;
     void getEffects(Mlt::Service &service, ClipItem *clip, int track = 0);
     void adjustDouble(QDomElement &e, const QString &value);
 
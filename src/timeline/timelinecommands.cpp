@@ -26,6 +26,103 @@
 
 #include <klocalizedstring.h>
 
+EffectDelta::EffectDelta()
+{
+}
+
+EffectDelta::EffectDelta(const QDomElement &base, const QDomElement &target)
+{
+    int index = 0;
+    if (base.isNull() || !diff(base, target, index)) {
+        m_changes.clear();
+        m_target = target.cloneNode().toElement();
+    }
+}
+
+bool EffectDelta::diff(const QDomElement &base, const QDomElement &target, int &index)
+{
+    if (base.tagName() != target.tagName()) {
+        return false;
+    }
+    const int element = index++;
+    QDomNamedNodeMap baseAttributes = base.attributes();
+    QDomNamedNodeMap targetAttributes = target.attributes();
+    for (int i = 0; i < targetAttributes.count(); ++i) {
+        QDomNode attribute = targetAttributes.item(i);
+        if (!base.hasAttribute(attribute.nodeName()) || base.attribute(attribute.nodeName()) != attribute.nodeValue()) {
+            Change change = { element, attribute.nodeName(), attribute.nodeValue(), false };
+            m_changes << change;
+        }
+    }
+    for (int i = 0; i < baseAttributes.count(); ++i) {
+        QDomNode attribute = baseAttributes.item(i);
+        if (!target.hasAttribute(attribute.nodeName())) {
+            Change change = { element, attribute.nodeName(), QString(), true };
+            m_changes << change;
+        }
+    }
+    QDomNode baseChild = base.firstChild();
+    QDomNode targetChild = target.firstChild();
+    while (!baseChild.isNull() && !targetChild.isNull()) {
+        if (baseChild.nodeType() != targetChild.nodeType()) {
+            return false;
+        }
+        if (baseChild.isElement()) {
+            if (!diff(baseChild.toElement(), targetChild.toElement(), index)) {
+                return false;
+            }
+        } else if (baseChild.nodeValue() != targetChild.nodeValue()) {
+            return false;
+        }
+        baseChild = baseChild.nextSibling();
+        targetChild = targetChild.nextSibling();
+    }
+    return baseChild.isNull() && targetChild.isNull();
+}
+
+QDomElement EffectDelta::apply(const QDomElement &base) const
+{
+    if (!m_target.isNull()) {
+        return m_target.cloneNode().toElement();
+    }
+    QDomElement result = base.cloneNode().toElement();
+    if (m_changes.isEmpty()) {
+        return result;
+    }
+    // Elements in the same depth first order as in diff(): the children of an element are inserted right after it,
+    // so that the elements up to i + 1 are in their final place once element i was expanded
+    QList <QDomElement> elements;
+    elements << result;
+    const int last = m_changes.last().element;
+    for (int i = 0; i < elements.count() && i < last; ++i) {
+        int position = i + 1;
+        for (QDomElement child = elements.at(i).firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+            elements.insert(position++, child);
+        }
+    }
+    foreach (const Change &change, m_changes) {
+        QDomElement e = elements.value(change.element);
+        if (change.removed) {
+            e.removeAttribute(change.name);
+        } else {
+            e.setAttribute(change.name, change.value);
+        }
+    }
+    return result;
+}
+
+qint64 EffectDelta::memoryCost() const
+{
+    qint64 cost = sizeof(EffectDelta);
+    if (!m_target.isNull()) {
+        cost += EffectsList::memoryCost(m_target);
+    }
+    foreach (const Change &change, m_changes) {
+        cost += sizeof(Change) + 2 * (change.name.size() + change.value.size());
+    }
+    return cost;
+}
+
 AddEffectCommand::AddEffectCommand(CustomTrackView *view, const int track, const GenTime &pos, const QDomElement &effect, bool doIt, QUndoCommand * parent) :
         QUndoCommand(parent),
         m_view(view),
@@ -61,6 +158,11 @@ void AddEffectCommand::redo()
     else
         m_view->deleteEffect(m_track, m_pos, m_effect);
 }
+// virtual
+qint64 AddEffectCommand::memoryCost() const
+{
+    return sizeof(AddEffectCommand) + EffectsList::memoryCost(m_effect);
+}
 
 AddTimelineClipCommand::AddTimelineClipCommand(CustomTrackView *view, const QString &clipId, const ItemInfo &info, const EffectsList &effects, PlaylistState::ClipState state, bool doIt, bool doRemove, bool refreshMonitor, QUndoCommand * parent) :
         QUndoCommand(parent),
@@ -95,6 +197,11 @@ void AddTimelineClipCommand::redo()
     }
     m_doIt = true;
 }
+// virtual
+qint64 AddTimelineClipCommand::memoryCost() const
+{
+    return sizeof(AddTimelineClipCommand) + EffectsList::memoryCost(m_effects);
+}
 
 AddTrackCommand::AddTrackCommand(CustomTrackView *view, int ix, const TrackInfo &info, bool addTrack, QUndoCommand * parent) :
         QUndoCommand(parent),
@@ -164,6 +271,11 @@ void AddTransitionCommand::redo()
     }
     m_doIt = true;
 }
+// virtual
+qint64 AddTransitionCommand::memoryCost() const
+{
+    return sizeof(AddTransitionCommand) + EffectsList::memoryCost(m_params);
+}
 
 ChangeClipTypeCommand::ChangeClipTypeCommand(CustomTrackView *view, ItemInfo info, PlaylistState::ClipState state, PlaylistState::ClipState originalState, QUndoCommand * parent) :
         QUndoCommand(parent),
@@ -262,12 +374,37 @@ void ConfigTracksCommand::redo()
     if (m_oldState != m_newState) m_timeline->updateTrackState(m_ix, m_newState);
 }
 
+EditBatchCommand::EditBatchCommand(Timeline *timeline, bool start, QUndoCommand * parent) :
+        QUndoCommand(parent),
+        m_timeline(timeline),
+        m_start(start)
+{
+}
+
+// Children are undone in reverse order, so the closing command opens the batch on undo
+// virtual
+void EditBatchCommand::undo()
+{
+    if (m_start)
+        m_timeline->endEdits();
+    else
+        m_timeline->beginEdits();
+}
+// virtual
+void EditBatchCommand::redo()
+{
+    if (m_start)
+        m_timeline->beginEdits();
+    else
+        m_timeline->endEdits();
+}
+
 EditEffectCommand::EditEffectCommand(CustomTrackView *view, const int track, const GenTime &pos, const QDomElement &oldeffect, const QDomElement &effect, int stackPos, bool refreshEffectStack, bool doIt, bool refreshMonitor, QUndoCommand *parent) :
     QUndoCommand(parent),
     m_view(view),
     m_track(track),
     m_oldeffect(oldeffect),
-    m_effect(effect),
+    m_effect(oldeffect, effect),
     m_pos(pos),
     m_stackPos(stackPos),
     m_doIt(doIt),
@@ -307,7 +444,8 @@ bool EditEffectCommand::mergeWith(const QUndoCommand * other)
         return false;
     if (m_pos != static_cast<const EditEffectCommand*>(other)->m_pos)
         return false;
-    m_effect = static_cast<const EditEffectCommand*>(other)->m_effect.cloneNode().toElement();
+    const EditEffectCommand *command = static_cast<const EditEffectCommand*>(other);
+    m_effect = EffectDelta(m_oldeffect, command->m_effect.apply(command->m_oldeffect));
     return true;
 }
 // virtual
@@ -319,11 +457,16 @@ void EditEffectCommand::undo()
 void EditEffectCommand::redo()
 {
     if (m_doIt) {
-        m_view->updateEffect(m_track, m_pos, m_effect, m_refreshEffectStack, m_replaceEffect, m_refreshMonitor);
+        m_view->updateEffect(m_track, m_pos, m_effect.apply(m_oldeffect), m_refreshEffectStack, m_replaceEffect, m_refreshMonitor);
     }
     m_doIt = true;
     m_refreshEffectStack = true;
 }
+// virtual
+qint64 EditEffectCommand::memoryCost() const
+{
+    return sizeof(EditEffectCommand) + EffectsList::memoryCost(m_oldeffect) + m_effect.memoryCost();
+}
 
 EditGuideCommand::EditGuideCommand(CustomTrackView *view, const GenTime &oldPos, const QString &oldcomment, const GenTime &pos, const QString &comment, bool doIt, QUndoCommand * parent) :
     QUndoCommand(parent),
@@ -364,11 +507,11 @@ EditTransitionCommand::EditTransitionCommand(CustomTrackView *view, const int tr
         QUndoCommand(parent),
         m_view(view),
         m_track(track),
+        m_effect(oldeffect, effect),
         m_oldeffect(oldeffect),
         m_pos(pos),
         m_doIt(doIt)
 {
-    m_effect = effect.cloneNode().toElement();
     QString effectName;
     QDomElement namenode = effect.firstChildElement(QStringLiteral("name"));
     if (!namenode.isNull()) effectName = i18n(namenode.text().toUtf8().data());
@@ -386,20 +529,26 @@ bool EditTransitionCommand::mergeWith(const QUndoCommand * other)
     if (other->id() != id()) return false;
     if (m_track != static_cast<const EditTransitionCommand*>(other)->m_track) return false;
     if (m_pos != static_cast<const EditTransitionCommand*>(other)->m_pos) return false;
-    m_effect = static_cast<const EditTransitionCommand*>(other)->m_effect;
+    const EditTransitionCommand *command = static_cast<const EditTransitionCommand*>(other);
+    m_effect = EffectDelta(m_oldeffect, command->m_effect.apply(command->m_oldeffect));
     return true;
 }
 // virtual
 void EditTransitionCommand::undo()
 {
-    m_view->updateTransition(m_track, m_pos, m_effect, m_oldeffect, m_doIt);
+    m_view->updateTransition(m_track, m_pos, m_effect.apply(m_oldeffect), m_oldeffect, m_doIt);
 }
 // virtual
 void EditTransitionCommand::redo()
 {
-    m_view->updateTransition(m_track, m_pos, m_oldeffect, m_effect, m_doIt);
+    m_view->updateTransition(m_track, m_pos, m_oldeffect, m_effect.apply(m_oldeffect), m_doIt);
     m_doIt = true;
 }
+// virtual
+qint64 EditTransitionCommand::memoryCost() const
+{
+    return sizeof(EditTransitionCommand) + EffectsList::memoryCost(m_oldeffect) + m_effect.memoryCost();
+}
 
 GroupClipsCommand::GroupClipsCommand(CustomTrackView *view, const QList <ItemInfo> &clipInfos, const QList <ItemInfo>& transitionInfos, bool group, bool doIt, QUndoCommand * parent) :
     QUndoCommand(parent),
@@ -426,6 +575,11 @@ void GroupClipsCommand::redo()
         m_view->doGroupClips(m_clips, m_transitions, m_group);
     m_doIt = true;
 }
+// virtual
+qint64 GroupClipsCommand::memoryCost() const
+{
+    return sizeof(GroupClipsCommand) + (m_clips.count() + m_transitions.count()) * sizeof(ItemInfo);
+}
 
 AddSpaceCommand::AddSpaceCommand(CustomTrackView *view, ItemInfo spaceInfo, QList <ItemInfo> excludeList, bool doIt, QUndoCommand * parent, bool trackonly) :
     QUndoCommand(parent),
@@ -451,6 +605,11 @@ void AddSpaceCommand::redo()
     m_doIt = true;
     m_excludeList.clear();
 }
+// virtual
+qint64 AddSpaceCommand::memoryCost() const
+{
+    return sizeof(AddSpaceCommand) + m_excludeList.count() * sizeof(ItemInfo);
+}
 
 
 InsertSpaceCommand::InsertSpaceCommand(CustomTrackView *view, const QList<ItemInfo> &clipsToMove, const QList<ItemInfo> &transToMove, int track, const GenTime &duration, bool doIt, QUndoCommand * parent) :
@@ -480,6 +639,11 @@ void InsertSpaceCommand::redo()
     }
     m_doIt = true;
 }
+// virtual
+qint64 InsertSpaceCommand::memoryCost() const
+{
+    return sizeof(InsertSpaceCommand) + (m_clipsToMove.count() + m_transToMove.count()) * sizeof(ItemInfo);
+}
 
 LockTrackCommand::LockTrackCommand(CustomTrackView *view, int ix, bool lock, QUndoCommand * parent) :
     QUndoCommand(parent),
@@ -602,6 +766,11 @@ void MoveGroupCommand::redo()
     m_doIt = true;
     m_alreadyMoved = false;
 }
+// virtual
+qint64 MoveGroupCommand::memoryCost() const
+{
+    return sizeof(MoveGroupCommand) + (m_startClip.count() + m_startTransition.count()) * sizeof(ItemInfo);
+}
 
 MoveTransitionCommand::MoveTransitionCommand(CustomTrackView *view, const ItemInfo &start, const ItemInfo &end, bool doIt, bool refresh, QUndoCommand * parent) :
     QUndoCommand(parent),
@@ -650,6 +819,11 @@ void RazorClipCommand::redo()
     }
     m_doIt = true;
 }
+// virtual
+qint64 RazorClipCommand::memoryCost() const
+{
+    return sizeof(RazorClipCommand) + EffectsList::memoryCost(m_originalStack);
+}
 
 RazorTransitionCommand::RazorTransitionCommand(CustomTrackView *view, const ItemInfo &info, const QDomElement params, const GenTime &cutTime, bool doIt, QUndoCommand * parent) :
     QUndoCommand(parent),
@@ -674,6 +848,11 @@ void RazorTransitionCommand::redo()
     }
     m_doIt = true;
 }
+// virtual
+qint64 RazorTransitionCommand::memoryCost() const
+{
+    return sizeof(RazorTransitionCommand) + EffectsList::memoryCost(m_originalParams);
+}
 
 /*
 RazorGroupCommand::RazorGroupCommand(CustomTrackView *view, QList <ItemInfo> clips1, QList <ItemInfo> transitions1, QList <ItemInfo> clipsCut, QList <ItemInfo> transitionsCut, QList <ItemInfo> clips2, QList <ItemInfo> transitions2, GenTime cutPos, QUndoCommand * parent) :
@@ -28,16 +28,48 @@
 #include <QDomElement>
 #include "definitions.h"
 #include "effectslist/effectslist.h"
+#include "doc/undocost.h"
 class GenTime;
 class CustomTrackView;
 class Timeline;
 
-class AddEffectCommand : public QUndoCommand
+/**
+ * @class EffectDelta
+ * @brief The attribute changes turning an effect or transition xml into another.
+ *
+ * Edit commands keep the previous element and only the changed parameter values of the
+ * new one, which is rebuilt when needed. If the structure of the elements differs, for
+ * example when an effect was replaced, a full copy of the new element is kept instead.
+ */
+class EffectDelta
+{
+public:
+    EffectDelta();
+    EffectDelta(const QDomElement &base, const QDomElement &target);
+    /** @brief Returns a copy of base with the changes applied. */
+    QDomElement apply(const QDomElement &base) const;
+    qint64 memoryCost() const;
+private:
+    struct Change {
+        /** @brief Index of the changed element in depth first order */
+        int element;
+        QString name;
+        QString value;
+        bool removed;
+    };
+    QList <Change> m_changes;
+    /** @brief Full copy of the target when it cannot be described by attribute changes */
+    QDomElement m_target;
+    bool diff(const QDomElement &base, const QDomElement &target, int &index);
+};
+
+class AddEffectCommand : public QUndoCommand, public UndoCost
 {
 public:
     AddEffectCommand(CustomTrackView *view, const int track, const GenTime &pos, const QDomElement &effect, bool doIt, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     int m_track;
@@ -46,7 +78,7 @@ private:
     bool m_doIt;
 };
 
-class AddTimelineClipCommand : public QUndoCommand
+class AddTimelineClipCommand : public QUndoCommand, public UndoCost
 {
 public:
     /** @brief Add clip in timeline.
@@ -64,6 +96,7 @@ public:
     AddTimelineClipCommand(CustomTrackView *view, const QString &clipId, const ItemInfo &info, const EffectsList &effects, PlaylistState::ClipState state, bool doIt, bool doRemove, bool refreshMonitor, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     QString m_clipId;
@@ -88,12 +121,13 @@ private:
     TrackInfo m_info;
 };
 
-class AddTransitionCommand : public QUndoCommand
+class AddTransitionCommand : public QUndoCommand, public UndoCost
 {
 public:
     AddTransitionCommand(CustomTrackView *view, const ItemInfo &info, int transitiontrack, const QDomElement &params, bool remove, bool doIt, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     ItemInfo m_info;
@@ -165,7 +199,20 @@ private:
     int m_newState;
 };
 
-class EditEffectCommand : public QUndoCommand
+/** @brief Brackets a group of timeline commands so that they are applied as one batch.
+ *  Add one with start=true as the first child of a command and one with start=false as the last. */
+class EditBatchCommand : public QUndoCommand
+{
+public:
+    EditBatchCommand(Timeline *timeline, bool start, QUndoCommand * parent = 0);
+    void undo();
+    void redo();
+private:
+    Timeline *m_timeline;
+    bool m_start;
+};
+
+class EditEffectCommand : public QUndoCommand, public UndoCost
 {
 public:
     EditEffectCommand(CustomTrackView *view, const int track, const GenTime &pos, const QDomElement &oldeffect, const QDomElement &effect, int stackPos, bool refreshEffectStack, bool doIt, bool refreshMonitor, QUndoCommand *parent = 0);
@@ -173,11 +220,12 @@ public:
     virtual bool mergeWith(const QUndoCommand * command);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     const int m_track;
     QDomElement m_oldeffect;
-    QDomElement m_effect;
+    EffectDelta m_effect;
     const GenTime m_pos;
     int m_stackPos;
     bool m_doIt;
@@ -201,7 +249,7 @@ private:
     bool m_doIt;
 };
 
-class EditTransitionCommand : public QUndoCommand
+class EditTransitionCommand : public QUndoCommand, public UndoCost
 {
 public:
     EditTransitionCommand(CustomTrackView *view, const int track, const GenTime &pos, const QDomElement &oldeffect, const QDomElement &effect, bool doIt, QUndoCommand * parent = NULL);
@@ -209,22 +257,24 @@ public:
     virtual bool mergeWith(const QUndoCommand * command);
     virtual void undo();
     virtual void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     const int m_track;
-    QDomElement m_effect;
+    EffectDelta m_effect;
     QDomElement m_oldeffect;
     const GenTime m_pos;
     bool m_doIt;
 };
 
-class GroupClipsCommand : public QUndoCommand
+class GroupClipsCommand : public QUndoCommand, public UndoCost
 {
 public:
     GroupClipsCommand(CustomTrackView *view, const QList <ItemInfo> &clipInfos, const QList <ItemInfo> &transitionInfos, bool group, bool doIt = true, QUndoCommand * parent = 0);
     void undo();
     void redo();
 
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     const QList <ItemInfo> m_clips;
@@ -233,12 +283,13 @@ private:
     bool m_doIt;
 };
 
-class InsertSpaceCommand : public QUndoCommand
+class InsertSpaceCommand : public QUndoCommand, public UndoCost
 {
 public:
     InsertSpaceCommand(CustomTrackView *view, const QList<ItemInfo> &clipsToMove, const QList<ItemInfo> &transToMove, int track, const GenTime &duration, bool doIt, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     QList<ItemInfo> m_clipsToMove;
@@ -248,12 +299,13 @@ private:
     bool m_doIt;
 };
 
-class AddSpaceCommand : public QUndoCommand
+class AddSpaceCommand : public QUndoCommand, public UndoCost
 {
 public:
     AddSpaceCommand(CustomTrackView *view, ItemInfo spaceInfo, QList <ItemInfo> excludeList, bool doIt, QUndoCommand * parent = 0, bool trackonly = false);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     ItemInfo m_spaceInfo;
@@ -306,12 +358,13 @@ private:
     GenTime m_pos;
 };
 
-class MoveGroupCommand : public QUndoCommand
+class MoveGroupCommand : public QUndoCommand, public UndoCost
 {
 public:
     MoveGroupCommand(CustomTrackView *view, const QList <ItemInfo> &startClip, const QList <ItemInfo> &startTransition, const GenTime &offset, const int trackOffset, bool alreadyMoved, bool doIt, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     const QList <ItemInfo> m_startClip;
@@ -336,12 +389,13 @@ private:
     bool m_refresh;
 };
 
-class RazorClipCommand : public QUndoCommand
+class RazorClipCommand : public QUndoCommand, public UndoCost
 {
 public:
     RazorClipCommand(CustomTrackView *view, const ItemInfo &info, EffectsList stack, const GenTime &cutTime, bool doIt = true, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     ItemInfo m_info;
@@ -351,12 +405,13 @@ private:
 };
 
 
-class RazorTransitionCommand : public QUndoCommand
+class RazorTransitionCommand : public QUndoCommand, public UndoCost
 {
 public:
     RazorTransitionCommand(CustomTrackView *view, const ItemInfo &info, const QDomElement params, const GenTime &cutTime, bool doIt = true, QUndoCommand * parent = 0);
     void undo();
     void redo();
+    qint64 memoryCost() const;
 private:
     CustomTrackView *m_view;
     ItemInfo m_info;
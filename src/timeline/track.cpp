@@ -305,7 +305,7 @@ void Track::replaceId(const QString &id)
         if (m_playlist.is_blank(i)) continue;
         QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
         QString current = p->parent().get("id");
-	if (current == id || current == idForTrack || current == idForAudioTrack || current == idForVideoTrack || current.startsWith("slowmotion:" + id + ":")) {
+	if (current == id || current == idForTrack || current == idForAudioTrack || current == idForVideoTrack || current.startsWith("slowmotion:" + id + ":") || duplicateKey(current).section(QLatin1Char('_'), 0, 0) == id) {
 	    current.prepend("#");
 	    p->parent().set("id", current.toUtf8().constData());
 	}
@@ -373,6 +373,12 @@ QList <ItemInfo> Track::replaceAll(const QString &id, Mlt::Producer *original, M
 	    continue;
 	}
 	current.remove(0, 1);
+        if (!idForAudioTrack.isEmpty()) {
+            // A duplicate shared with another track is replaced by our own
+            QString key = duplicateKey(current);
+            if (key == id) current = idForTrack;
+            else if (key == id + "_audio") current = idForAudioTrack;
+        }
         Mlt::Producer *cut = NULL;
 	if (current.startsWith("slowmotion:" + id + ":")) {
 	      // Slowmotion producer, just update resource
@@ -518,6 +524,10 @@ Mlt::Producer *Track::clipProducer(Mlt::Producer *parent, PlaylistState::ClipSta
         // Don't clone producer for track if it has no audio
         return new Mlt::Producer(*parent);
     }
+    if (type == AudioTrack) {
+        // Video is never shown on audio tracks, do not decode it
+        state = PlaylistState::AudioOnly;
+    }
     originalId = originalId.section(QStringLiteral("_"), 0, 0);
     QString idForTrack = originalId + QLatin1Char('_') + m_playlist.get("id");
     if (state == PlaylistState::AudioOnly) {
@@ -527,7 +537,8 @@ Mlt::Producer *Track::clipProducer(Mlt::Producer *parent, PlaylistState::ClipSta
         for (int i = 0; i < m_playlist.count(); i++) {
             if (m_playlist.is_blank(i)) continue;
             QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
-            if (QString(p->parent().get("id")) == idForTrack) {
+            // The duplicate may be shared with other tracks, see Timeline::shareTrackProducers()
+            if (duplicateKey(p->parent().get("id")) == duplicateKey(idForTrack)) {
                 return new Mlt::Producer(p->parent());
             }
         }
@@ -540,6 +551,65 @@ Mlt::Producer *Track::clipProducer(Mlt::Producer *parent, PlaylistState::ClipSta
     return prod;
 }
 
+//static
+QString Track::duplicateKey(const QString &producerId)
+{
+    // Duplicates are named binId_playlist or binId_playlist_audio, binId_video is shared by all tracks
+    if (producerId.startsWith(QLatin1Char('#')) || producerId.contains(QLatin1Char(':'))) return QString();
+    QStringList parts = producerId.split(QLatin1Char('_'));
+    if (parts.count() < 2 || parts.count() > 3 || parts.at(1) == QLatin1String("video")) return QString();
+    if (parts.count() == 3) {
+        if (parts.at(2) != QLatin1String("audio")) return QString();
+        return parts.at(0) + QLatin1String("_audio");
+    }
+    return parts.at(0);
+}
+
+QMap <QString, QList <QPoint> > Track::duplicateRanges()
+{
+    QMap <QString, QList <QPoint> > ranges;
+    for (int i = 0; i < m_playlist.count(); i++) {
+        if (m_playlist.is_blank(i)) continue;
+        QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
+        QString key = duplicateKey(p->parent().get("id"));
+        if (key.isEmpty()) continue;
+        int start = m_playlist.clip_start(i);
+        ranges[key] << QPoint(start, start + m_playlist.clip_length(i));
+    }
+    return ranges;
+}
+
+Mlt::Producer *Track::duplicateProducer(const QString &key)
+{
+    for (int i = 0; i < m_playlist.count(); i++) {
+        if (m_playlist.is_blank(i)) continue;
+        QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
+        if (duplicateKey(p->parent().get("id")) == key) {
+            return new Mlt::Producer(p->parent());
+        }
+    }
+    return NULL;
+}
+
+bool Track::setDuplicateProducer(const QString &key, Mlt::Producer *producer)
+{
+    bool changed = false;
+    m_playlist.lock();
+    for (int i = 0; i < m_playlist.count(); i++) {
+        if (m_playlist.is_blank(i)) continue;
+        QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
+        if (p->parent().get_service() == producer->get_service() || duplicateKey(p->parent().get("id")) != key) continue;
+        Mlt::Producer *cut = producer->cut(p->get_in(), p->get_out());
+        Clip(*cut).addEffects(*p);
+        m_playlist.remove(i);
+        m_playlist.insert(*cut, i);
+        delete cut;
+        changed = true;
+    }
+    m_playlist.unlock();
+    return changed;
+}
+
 bool Track::hasAudio() 
 {
     for (int i = 0; i < m_playlist.count(); i++) {
@@ -637,7 +707,7 @@ void Track::updateClipProperties(const QString &id, QMap <QString, QString> prop
         QScopedPointer<Mlt::Producer> p(m_playlist.get_clip(i));
         QString current = p->parent().get("id");
         QStringList processed;
-        if (!processed.contains(current) && (current == idForTrack || current == idForAudioTrack || current == idForVideoTrack)) {
+        if (!processed.contains(current) && (current == idForTrack || current == idForAudioTrack || current == idForVideoTrack || duplicateKey(current).section(QLatin1Char('_'), 0, 0) == id)) {
             QMapIterator<QString, QString> i(properties);
             while (i.hasNext()) {
                 i.next();
@@ -674,9 +744,7 @@ Mlt::Producer *Track::buildSlowMoProducer(Mlt::Properties passProps, const QStri
         default:
             break;
     }
-    QString slowmoId = info.toString(locale);
-    slowmoId.append(prod->get("warp_resource"));
-    emit storeSlowMotion(slowmoId, prod);
+    emit storeSlowMotion(info.poolKey(id, locale), prod);
     return prod;
 }
 
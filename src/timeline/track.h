@@ -63,6 +63,10 @@ public:
             str << locale.toString(speed) << QString::number(strobe) << QString::number((int) state);
             return str.join(":");
         }
+        /** @brief Key of the slowmotion producer for clip @param clipId in the project wide pool, see Render::storeSlowmotionProducer(). */
+        QString poolKey(const QString &clipId, QLocale locale) {
+            return clipId + QLatin1Char(':') + toString(locale);
+        }
         void readFromString(const QString &str, QLocale locale) {
             speed = locale.toDouble(str.section(":", 0, 0));
             strobe = str.section(":", 1, 1).toInt();
@@ -159,6 +163,14 @@ public:
      * @param forceCreation if true, we do not attempt to re-use existing track producer but recreate it
      * @return producer cut for this track */
     Mlt::Producer *clipProducer(Mlt::Producer *parent, PlaylistState::ClipState state, bool forceCreation = false);
+    /** @brief Returns the bin id, with an _audio suffix for audio only duplicates, of a track duplicate producer id, empty for other producers */
+    static QString duplicateKey(const QString &producerId);
+    /** @brief Returns the frame ranges of the cuts reading a track duplicate, by duplicate key */
+    QMap <QString, QList <QPoint> > duplicateRanges();
+    /** @brief Returns the duplicate read by the first cut with @param key, NULL if there is none. Delete after use! */
+    Mlt::Producer *duplicateProducer(const QString &key);
+    /** @brief Make all cuts with duplicate key @param key read @param producer, returns true if a cut was changed */
+    bool setDuplicateProducer(const QString &key, Mlt::Producer *producer);
         /** @brief Changes the speed of a clip in MLT's playlist.
      *
      * It creates a new "framebuffer" producer, which must have its "resource"
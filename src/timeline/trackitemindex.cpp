@@ -0,0 +1,138 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "trackitemindex.h"
+#include "abstractclipitem.h"
+#include "clipitem.h"
+
+int TrackItemIndex::lowerBound(const QVector <Span> &spans, double start)
+{
+    int lo = 0;
+    int hi = spans.count();
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (spans.at(mid).start < start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void TrackItemIndex::updateItem(AbstractClipItem *item, int track, double start, double end)
+{
+    removeItem(item);
+    const Key key(track, item->type());
+    Spans &entry = m_tracks[key];
+    Span span;
+    span.start = start;
+    span.end = end;
+    span.item = item;
+    entry.spans.insert(lowerBound(entry.spans, start), span);
+    entry.maxLength = qMax(entry.maxLength, end - start);
+    Location location;
+    location.key = key;
+    location.start = start;
+    if (item->type() == AVWidget) {
+        location.binId = static_cast <ClipItem *>(item)->getBinId();
+        m_binItems[location.binId].insert(item);
+    }
+    m_items.insert(item, location);
+}
+
+void TrackItemIndex::removeItem(AbstractClipItem *item)
+{
+    QHash <AbstractClipItem *, Location>::iterator found = m_items.find(item);
+    if (found == m_items.end()) {
+        return;
+    }
+    QMap <Key, Spans>::iterator entry = m_tracks.find(found.value().key);
+    if (entry != m_tracks.end()) {
+        QVector <Span> &spans = entry.value().spans;
+        for (int i = lowerBound(spans, found.value().start); i < spans.count(); ++i) {
+            if (spans.at(i).item == item) {
+                spans.remove(i);
+                break;
+            }
+        }
+    }
+    const QString &binId = found.value().binId;
+    if (!binId.isEmpty()) {
+        QHash <QString, QSet <AbstractClipItem *> >::iterator clips = m_binItems.find(binId);
+        if (clips != m_binItems.end()) {
+            clips.value().remove(item);
+            if (clips.value().isEmpty()) {
+                m_binItems.erase(clips);
+            }
+        }
+    }
+    m_items.erase(found);
+}
+
+void TrackItemIndex::clear()
+{
+    m_tracks.clear();
+    m_items.clear();
+    m_binItems.clear();
+}
+
+QList <ClipItem *> TrackItemIndex::clipItems(const QString &binId) const
+{
+    QList <ClipItem *> result;
+    foreach(AbstractClipItem *item, m_binItems.value(binId)) {
+        result << static_cast <ClipItem *>(item);
+    }
+    return result;
+}
+
+int TrackItemIndex::clipCount(const QString &binId) const
+{
+    return m_binItems.value(binId).count();
+}
+
+QList <AbstractClipItem *> TrackItemIndex::itemsAt(int track, int type, double frame) const
+{
+    QList <AbstractClipItem *> result;
+    QMap <Key, Spans>::const_iterator entry = m_tracks.constFind(Key(track, type));
+    if (entry == m_tracks.constEnd()) {
+        return result;
+    }
+    const QVector <Span> &spans = entry.value().spans;
+    // Spans starting more than the longest length before frame cannot cover it
+    for (int i = lowerBound(spans, frame - entry.value().maxLength); i < spans.count() && spans.at(i).start <= frame; ++i) {
+        if (spans.at(i).end >= frame) {
+            result << spans.at(i).item;
+        }
+    }
+    return result;
+}
+
+QList <AbstractClipItem *> TrackItemIndex::itemsIn(int track, int type, double start, double end) const
+{
+    QList <AbstractClipItem *> result;
+    QMap <Key, Spans>::const_iterator entry = m_tracks.constFind(Key(track, type));
+    if (entry == m_tracks.constEnd()) {
+        return result;
+    }
+    const QVector <Span> &spans = entry.value().spans;
+    for (int i = lowerBound(spans, start - entry.value().maxLength); i < spans.count() && spans.at(i).start < end; ++i) {
+        if (spans.at(i).end > start) {
+            result << spans.at(i).item;
+        }
+    }
+    return result;
+}
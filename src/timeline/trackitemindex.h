@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef TRACKITEMINDEX_H
+#define TRACKITEMINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class AbstractClipItem;
+class ClipItem;
+
+/**
+ * @class TrackItemIndex
+ * @brief Per track sorted spans of the timeline clips and transitions.
+ *
+ * Items register their scene span whenever their position, size or parent
+ * changes, so that point and range lookups are binary searches instead of
+ * QGraphicsScene::items() queries. Clips are also indexed by bin clip id, so
+ * that operations on one bin clip only visit its timeline instances.
+ */
+class TrackItemIndex
+{
+public:
+    /** @brief Indexes an item at its current span, replacing its previous one. */
+    void updateItem(AbstractClipItem *item, int track, double start, double end);
+    void removeItem(AbstractClipItem *item);
+    void clear();
+    /** @brief Returns the items of type (AVWidget or TransitionWidget) covering frame on track. */
+    QList <AbstractClipItem *> itemsAt(int track, int type, double frame) const;
+    /** @brief Returns the items of type on track overlapping the ]start, end[ range. */
+    QList <AbstractClipItem *> itemsIn(int track, int type, double start, double end) const;
+    /** @brief Returns the timeline instances of the bin clip binId. */
+    QList <ClipItem *> clipItems(const QString &binId) const;
+    /** @brief Returns the number of timeline instances of the bin clip binId. */
+    int clipCount(const QString &binId) const;
+
+private:
+    struct Span {
+        double start;
+        double end;
+        AbstractClipItem *item;
+    };
+    typedef QPair <int, int> Key;
+    struct Spans {
+        Spans() : maxLength(0) {}
+        /** @brief Sorted by start. */
+        QVector <Span> spans;
+        /** @brief Longest span ever indexed, bounds the backward scan of lookups. */
+        double maxLength;
+    };
+    struct Location {
+        Key key;
+        double start;
+        /** @brief Bin clip id of clips, empty for transitions. */
+        QString binId;
+    };
+    QMap <Key, Spans> m_tracks;
+    /** @brief Where each item is indexed, also used when the item is being destroyed. */
+    QHash <AbstractClipItem *, Location> m_items;
+    QHash <QString, QSet <AbstractClipItem *> > m_binItems;
+
+    /** @brief Returns the index of the first span starting at or after start. */
+    static int lowerBound(const QVector <Span> &spans, double start);
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "customtrackview.h"
 
 #include "kdenlivesettings.h"
+#include "effectslist/effectslist.h"
 #include "mainwindow.h"
 
 #include <QDebug>
@@ -173,6 +174,9 @@ void Transition::paint(QPainter *painter,
                        const QStyleOptionGraphicsItem *option,
                        QWidget */*widget*/)
 {
+    // Narrow transitions are drawn in one pass by CustomTrackView::drawBackground
+    if (isLightweight(painter->worldTransform()))
+        return;
     const QRectF exposed = painter->worldTransform().mapRect(option->exposedRect);
     const QRectF br = rect();
     QPen framePen;
@@ -323,7 +327,7 @@ QVariant Transition::itemChange(GraphicsItemChange change, const QVariant &value
         ////qDebug()<<"// ITEM NEW POS: "<<newPos.x()<<", mapped: "<<mapToScene(newPos.x(), 0).x();
         return newPos;
     }
-    return QGraphicsItem::itemChange(change, value);
+    return AbstractClipItem::itemChange(change, value);
 }
 
 
@@ -353,6 +357,12 @@ int Transition::itemOffset()
 }
 
 
+QString Transition::lumaFile() const
+{
+    // luma files in transitions are in "resource" property
+    return EffectsList::parameter(m_parameters, QStringLiteral("resource"));
+}
+
 QDomElement Transition::toXML()
 {
     m_parameters.setAttribute(QStringLiteral("type"), transitionTag());
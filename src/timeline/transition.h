@@ -49,6 +49,8 @@ public:
 
     /** @brief Returns an XML representation of this transition. */
     QDomElement toXML();
+    /** @brief Returns the luma file used by the transition, if any. */
+    QString lumaFile() const;
 
     /** @brief Returns the track number of the transition in the playlist. */
     int transitionEndTrack() const;
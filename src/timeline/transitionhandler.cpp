@@ -487,6 +487,7 @@ void TransitionHandler::enableMultiTrack(bool enable)
     QScopedPointer<Mlt::Service> service(m_tractor->field());
     QScopedPointer<Mlt::Field> field(m_tractor->field());
     field->lock();
+    m_multitrackTracks.clear();
     if (enable) {
         // disable track composition (frei0r.cairoblend)
         QScopedPointer<Mlt::Field> field(m_tractor->field());
@@ -536,6 +537,7 @@ void TransitionHandler::enableMultiTrack(bool enable)
                 transition.set("geometry", geometry.toUtf8().constData());
                 transition.set("always_active", 1);
                 field->plant_transition(transition, 0, i);
+                m_multitrackTracks << i;
                 screen++;
             }
         }
@@ -565,6 +567,11 @@ void TransitionHandler::enableMultiTrack(bool enable)
     emit refresh();
 }
 
+QList <int> TransitionHandler::multitrackTracks() const
+{
+    return m_multitrackTracks;
+}
+
 // static 
 const QString TransitionHandler::compositeTransition()
 {
@@ -579,14 +586,15 @@ const QString TransitionHandler::compositeTransition()
     return QStringLiteral("composite");
 }
 
-void TransitionHandler::rebuildTransitions(int mode, QList <int> videoTracks, int maxTrack)
+bool TransitionHandler::rebuildTransitions(int mode, QList <int> videoTracks, int maxTrack)
 {
     QStringList compositeService { QStringLiteral("qtblend"), QStringLiteral("composite"), QStringLiteral("frei0r.cairoblend"),  QStringLiteral("movit.overlay") };
-    QList <int> disabled;
     QScopedPointer<Mlt::Service> service(m_tractor->field());
     Mlt::Field *field = m_tractor->field();
     field->lock();
-    // Get the list of composite transitions
+    // Get the list of internal transitions, from bottom to top of the field
+    QList <Mlt::Transition *> mixes;
+    QList <Mlt::Transition *> composites;
     while (service && service->is_valid()) {
         if (service->type() == transition_type) {
             Mlt::Transition t((mlt_transition) service->get_service());
@@ -594,20 +602,33 @@ void TransitionHandler::rebuildTransitions(int mode, QList <int> videoTracks, in
             if (internal == 237) {
                 QString service = t.get("mlt_service");
                 if (service == QLatin1String("mix")) {
-                    field->disconnect_service(t);
+                    mixes.prepend(new Mlt::Transition(t));
                 }
                 else if (compositeService.contains(service)) {
                     if (mode < 0) {
                         mode = service == QLatin1String("composite") ? 1 : 2;
                     }
-                    field->disconnect_service(t);
+                    composites.prepend(new Mlt::Transition(t));
                 }
             }
         }
         service.reset(service->producer());
     }
-    // Rebuild audio mix
+    bool changed = false;
+
+    // Audio mix: order does not matter, only keep one mix per track
+    QList <int> mixedTracks;
+    foreach(Mlt::Transition *t, mixes) {
+        int track = t->get_b_track();
+        if (track < 1 || track >= maxTrack || t->get_a_track() != 0 || mixedTracks.contains(track)) {
+            field->disconnect_service(*t);
+            changed = true;
+        } else {
+            mixedTracks << track;
+        }
+    }
     for (int i = 1; i < maxTrack; i++) {
+        if (mixedTracks.contains(i)) continue;
         Mlt::Transition transition(*m_tractor->profile(), "mix");
         transition.set("always_active", 1);
         transition.set("combine", 1);
@@ -615,24 +636,37 @@ void TransitionHandler::rebuildTransitions(int mode, QList <int> videoTracks, in
         transition.set("b_track", i);
         transition.set("internal_added", 237);
         field->plant_transition(transition, 0, i);
+        changed = true;
     }
 
-    if (mode <= 0) {
-        // no compositing wanted, return
-        field->unlock();
-        delete field;
-        return;
-    }
-    // Re-add correct composite transitions
+    // Composite transitions must stay ordered from bottom track to top track,
+    // keep the existing ones as long as they match that order and re-add the others
     QString composite;
     QString compositeGeometry;
     if (mode == 1) {
         composite = QStringLiteral("composite");
         compositeGeometry = QString("0=0/0:%1x%2").arg(m_tractor->profile()->width()).arg(m_tractor->profile()->height());
-    } else {
+    } else if (mode > 0) {
         composite = compositeTransition();
+    } else {
+        // no compositing wanted
+        videoTracks.clear();
+    }
+    int kept = 0;
+    while (kept < composites.count() && kept < videoTracks.count()) {
+        Mlt::Transition *t = composites.at(kept);
+        if (composite != QLatin1String(t->get("mlt_service")) || t->get_a_track() != 0 || t->get_b_track() != videoTracks.at(kept)
+            || (mode == 1 && compositeGeometry != QLatin1String(t->get("geometry")))) {
+            break;
+        }
+        kept++;
+    }
+    for (int i = kept; i < composites.count(); ++i) {
+        field->disconnect_service(*composites.at(i));
+        changed = true;
     }
-    foreach(int track,  videoTracks) {
+    for (int i = kept; i < videoTracks.count(); ++i) {
+        int track = videoTracks.at(i);
         Mlt::Transition transition(*m_tractor->profile(), composite.toUtf8().constData());
         transition.set("always_active", 1);
         transition.set("a_track", 0);
@@ -646,7 +680,11 @@ void TransitionHandler::rebuildTransitions(int mode, QList <int> videoTracks, in
         }
         transition.set("internal_added", 237);
         field->plant_transition(transition, 0, track);
+        changed = true;
     }
     field->unlock();
     delete field;
+    qDeleteAll(mixes);
+    qDeleteAll(composites);
+    return changed;
 }
@@ -53,10 +53,14 @@ public:
     Mlt::Transition *getTransition(const QString &name, int b_track, int a_track = -1, bool internalTransition = false) const;
     /** @brief Enable/disable multitrack split view. */
     void enableMultiTrack(bool enable);
+    /** @brief The tracks shown in the multitrack split view, from top left to bottom right screen. */
+    QList <int> multitrackTracks() const;
     /** @brief Returns internal track transition. */
     Mlt::Transition *getTrackTransition(const QStringList names, int b_track, int a_track) const;
-    /** @brief Switch track compositing mode. */
-    void rebuildTransitions(int mode, QList <int> videoTracks, int maxTrack);
+    /** @brief Switch track compositing mode.
+     *  Only the internal transitions that differ from the wanted ones are replaced.
+     *  @return true if the field was modified */
+    bool rebuildTransitions(int mode, QList <int> videoTracks, int maxTrack);
     /** @brief Returns the matching composite transition depending on the current settings. */
     static const QString compositeTransition();
     /** @brief Initialize transition settings. */
@@ -64,6 +68,7 @@ public:
 
 private:
     Mlt::Tractor *m_tractor;
+    QList <int> m_multitrackTracks;
 
 signals:
     void refresh();
@@ -41,6 +41,10 @@
 #include <QSvgRenderer>
 #include <QFontInfo>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
 #include <QTextCursor>
 #include <locale>
 #ifdef Q_OS_MAC
@@ -63,6 +67,17 @@ QByteArray fileToByteArray(const QString& filename)
     return ret;
 }
 
+namespace {
+struct TemplateCache
+{
+    QMutex mutex;
+    /** @brief Parsed title files with the modification time they were parsed at */
+    QHash <QString, QPair<qint64, QSharedPointer<const TitleDocument::TemplateInfo> > > templates;
+};
+
+Q_GLOBAL_STATIC(TemplateCache, templateCache)
+}
+
 TitleDocument::TitleDocument()
 {
     m_scene = NULL;
@@ -111,6 +126,44 @@ int TitleDocument::base64ToUrl(QGraphicsItem* item, QDomElement& content, bool e
 
 
 //static
+//static
+QSharedPointer<const TitleDocument::TemplateInfo> TitleDocument::templateInfo(const QString &path)
+{
+    const qint64 stamp = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    QMutexLocker lock(&templateCache()->mutex);
+    QHash <QString, QPair<qint64, QSharedPointer<const TemplateInfo> > >::const_iterator it = templateCache()->templates.constFind(path);
+    if (it != templateCache()->templates.constEnd() && it.value().first == stamp) {
+        return it.value().second;
+    }
+    QDomDocument doc;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        templateCache()->templates.remove(path);
+        return QSharedPointer<const TemplateInfo>();
+    }
+    file.close();
+    TemplateInfo *info = new TemplateInfo;
+    info->xml = doc;
+    QDomElement title = doc.documentElement();
+    if (title.hasAttribute(QStringLiteral("duration"))) {
+        info->duration = title.attribute(QStringLiteral("duration")).toInt();
+    } else {
+        // keep some time for backwards compatibility - 26/12/12
+        info->duration = title.attribute(QStringLiteral("out")).toInt();
+    }
+    QDomNodeList contents = doc.elementsByTagName(QStringLiteral("content"));
+    for (int i = 0; i < contents.count(); ++i) {
+        QDomElement content = contents.at(i).toElement();
+        if (content.hasAttribute(QStringLiteral("url")))
+            info->images << content.attribute(QStringLiteral("url"));
+        if (content.hasAttribute(QStringLiteral("font")))
+            info->fonts << content.attribute(QStringLiteral("font"));
+    }
+    QSharedPointer<const TemplateInfo> result(info);
+    templateCache()->templates.insert(path, qMakePair(stamp, result));
+    return result;
+}
+
 const QString TitleDocument::extractBase64Image(const QString &titlePath, const QString &data)
 {
     QString filename = titlePath + QString(QCryptographicHash::hash(data.toLatin1(), QCryptographicHash::Md5).toHex().append(".titlepart"));
@@ -18,6 +18,8 @@
 #define TITLEDOCUMENT_H
 
 #include <QDomDocument>
+#include <QSharedPointer>
+#include <QStringList>
 #include <QUrl>
 #include <QColor>
 #include <QRectF>
@@ -53,6 +55,20 @@ public:
     /** \brief Extract embeded images in project titles folder. */
     static const QString extractBase64Image(const QString &titlePath, const QString &data);
 
+    /** \brief A title file parsed once and shared by all the template clips using it. */
+    struct TemplateInfo
+    {
+        /** \brief The parsed title, copy it with cloneNode() before modifying it */
+        QDomDocument xml;
+        /** \brief Duration stored in the title, 0 if none */
+        int duration;
+        QStringList images;
+        QStringList fonts;
+    };
+    /** \brief Returns the parsed title file, read again only when the file was modified.
+     * \returns A null pointer if the file cannot be read */
+    static QSharedPointer<const TemplateInfo> templateInfo(const QString &path);
+
     enum ItemOrigin {OriginXLeft = 0, OriginYTop = 1};
     enum AxisPosition {AxisDefault = 0, AxisInverted = 1};
 
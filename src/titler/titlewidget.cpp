@@ -423,7 +423,8 @@ TitleWidget::TitleWidget(const QUrl &url, const Timecode &tc, const QString &pro
     m_scene = new GraphicsSceneRectMove(this);
     graphicsView->setScene(m_scene);
     graphicsView->setMouseTracking(true);
-    graphicsView->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    // Only repaint the changed items, items keep their rendering in a cache
+    graphicsView->setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
     graphicsView->setDragMode(QGraphicsView::RubberBandDrag);
     graphicsView->setRubberBandSelectionMode(Qt::ContainsItemBoundingRect);
     m_titledocument.setScene(m_scene, m_frameWidth, m_frameHeight);
@@ -467,6 +468,8 @@ TitleWidget::TitleWidget(const QUrl &url, const Timecode &tc, const QString &pro
     m_frameImage->setTransform(qtrans);
     m_frameImage->setZValue(-1200);
     m_frameImage->setFlags(0);
+    // Scaled background frame is drawn under every edit, keep it rendered at view resolution
+    m_frameImage->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
     displayBackgroundFrame();
     graphicsView->scene()->addItem(m_frameImage);
 
@@ -599,6 +602,24 @@ QStringList TitleWidget::extractFontList(const QString& xml)
     }
     return result;
 }
+
+// static
+QStringList TitleWidget::extractTextList(const QString& xml)
+{
+    QStringList result;
+    if (xml.isEmpty()) return result;
+    QDomDocument doc;
+    doc.setContent(xml);
+    QDomNodeList items = doc.elementsByTagName(QStringLiteral("item"));
+    for (int i = 0; i < items.count(); ++i) {
+        QDomElement item = items.at(i).toElement();
+        if (item.attribute(QStringLiteral("type")) != QLatin1String("QGraphicsTextItem")) continue;
+        QString text = item.firstChildElement(QStringLiteral("content")).text().simplified();
+        if (!text.isEmpty())
+            result.append(text);
+    }
+    return result;
+}
 //static
 void TitleWidget::refreshTitleTemplates(const QString &projectPath)
 {
@@ -82,6 +82,10 @@ public:
      * @return list of the fonts in the title  */
     static QStringList extractFontList(const QString &xml);
 
+    /** @brief Returns the text of the text items in a title clip.
+     * @param xml XML data representing the title */
+    static QStringList extractTextList(const QString &xml);
+
     /** @brief Returns clip duration. */
     int duration() const;
 
@@ -21,6 +21,7 @@
 
 #include "abstractservice.h"
 
+#include <KJob>
 #include <QObject>
 
 
@@ -36,6 +37,21 @@ AbstractService::AbstractService(QListWidget *listWidget, QObject * parent) :
 
 AbstractService::~AbstractService()
 {
+    if (m_queryJob) m_queryJob->kill();
+    if (m_detailsJob) m_detailsJob->kill();
+}
+
+void AbstractService::startQuery(KJob *job)
+{
+    if (m_queryJob) m_queryJob->kill();
+    if (m_detailsJob) m_detailsJob->kill();
+    m_queryJob = job;
+}
+
+void AbstractService::startDetailsQuery(KJob *job)
+{
+    if (m_detailsJob) m_detailsJob->kill();
+    m_detailsJob = job;
 }
 
 void AbstractService::slotStartSearch(const QString & , int )
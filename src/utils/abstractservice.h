@@ -24,6 +24,9 @@
 
 
 #include <QListWidget>
+#include <QPointer>
+
+class KJob;
 
 const int imageRole = Qt::UserRole;
 const int urlRole = Qt::UserRole + 1;
@@ -83,6 +86,14 @@ public slots:
 
 protected:
     QListWidget *m_listWidget;
+    /** @brief Keeps track of the search query job, killing the previous one so that its results are not displayed. */
+    void startQuery(KJob *job);
+    /** @brief Keeps track of the item details job, killing the previous one. */
+    void startDetailsQuery(KJob *job);
+
+private:
+    QPointer <KJob> m_queryJob;
+    QPointer <KJob> m_detailsJob;
     
 signals:
     void searchInfo(const QString &);
@@ -72,6 +72,7 @@ void ArchiveOrg::slotStartSearch(const QString &searchText, int page)
 
   //  qDebug()<<"ArchiveOrg URL: "<< uri;
     KJob* resolveJob = KIO::storedGet( QUrl(uri), KIO::NoReload, KIO::HideProgressInfo );
+    startQuery(resolveJob);
 
 
 
@@ -175,6 +176,7 @@ OnlineItemInfo ArchiveOrg::displayItemDetails(QListWidgetItem *item)
     QString extraInfoUrl = item->data(infoUrl).toString()+"&output=json";
     if (!extraInfoUrl.isEmpty()) {
         KJob* resolveJob = KIO::storedGet( QUrl(extraInfoUrl), KIO::NoReload, KIO::HideProgressInfo );
+        startDetailsQuery(resolveJob);
         resolveJob->setProperty("id", info.itemId);
         connect(resolveJob, &KJob::result, this, &ArchiveOrg::slotParseResults);
     }
@@ -73,6 +73,7 @@ void FreeSound::slotStartSearch(const QString &searchText, int page)
     uri.append("&token="  + OAuth2_strClientSecret);
    //  qDebug()<<uri;
     KIO::StoredTransferJob* resolveJob = KIO::storedGet( QUrl(uri), KIO::NoReload, KIO::HideProgressInfo );
+    startQuery(resolveJob);
     connect(resolveJob, &KIO::StoredTransferJob::result, this, &FreeSound::slotShowResults);
 }
 
@@ -176,6 +177,7 @@ OnlineItemInfo FreeSound::displayItemDetails(QListWidgetItem *item)
 
     if (!extraInfoUrl.isEmpty()) {
         KJob* resolveJob = KIO::storedGet( QUrl(extraInfoUrl), KIO::NoReload, KIO::HideProgressInfo );
+        startDetailsQuery(resolveJob);
         // connect (obj,signal,obj, slot)
         // when the KJob resolveJob emits a result signal slotParseResults will be notified
         connect(resolveJob, &KJob::result, this, &FreeSound::slotParseResults);
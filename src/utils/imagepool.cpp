@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "imagepool.h"
+
+ImagePool::ImagePool(int size) :
+    m_images(size)
+{
+}
+
+QImage *ImagePool::acquire(int width, int height, QImage::Format format)
+{
+    QImage *unused = NULL;
+    QImage *stale = NULL;
+    for (int i = 0; i < m_images.count(); ++i) {
+        QImage &img = m_images[i];
+        const bool matches = img.width() == width && img.height() == height && img.format() == format;
+        if (img.isDetached() || img.isNull()) {
+            if (matches) {
+                return &img;
+            }
+            if (!unused) unused = &img;
+        } else if (!matches && !stale) {
+            stale = &img;
+        }
+    }
+    // Receivers keep their own reference to a replaced image, if any
+    QImage *img = unused ? unused : stale;
+    if (img) {
+        *img = QImage(width, height, format);
+    }
+    return img;
+}
+
+void ImagePool::clear()
+{
+    for (int i = 0; i < m_images.count(); ++i) {
+        m_images[i] = QImage();
+    }
+}
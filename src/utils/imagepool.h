@@ -0,0 +1,48 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef IMAGEPOOL_H
+#define IMAGEPOOL_H
+
+#include <QImage>
+#include <QVector>
+
+/**
+ * @class ImagePool
+ * @brief A few images recycled to receive converted video frames, so that no image is allocated per frame.
+ *
+ * Pooled images are handed to receivers by value. An image is back in the pool once every receiver
+ * dropped its copy, which QImage reference counting tells without any bookkeeping. The pool is not
+ * thread safe, it is meant to be used by the thread producing the frames.
+ */
+class ImagePool
+{
+public:
+    explicit ImagePool(int size);
+    /** @brief Returns an image of the requested size and format that no receiver uses anymore.
+     *  @return NULL if all images are in use, in which case the frame should be dropped */
+    QImage *acquire(int width, int height, QImage::Format format);
+    /** @brief Frees the images, for example when the frames stop. */
+    void clear();
+
+private:
+    QVector <QImage> m_images;
+};
+
+#endif
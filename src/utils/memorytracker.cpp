@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "memorytracker.h"
+#include "tracer.h"
+
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+// Interval between two checks of the memory budgets, in ms
+#define MEMORY_CHECK_INTERVAL 2000
+
+//static
+MemoryTracker *MemoryTracker::s_self = NULL;
+
+MemoryConsumer::~MemoryConsumer()
+{
+    if (MemoryTracker::s_self) {
+        MemoryTracker::s_self->removeConsumer(this);
+    }
+}
+
+MemoryTracker::MemoryTracker() : QObject()
+{
+    m_timer.setInterval(MEMORY_CHECK_INTERVAL);
+    connect(&m_timer, &QTimer::timeout, this, &MemoryTracker::slotCheck);
+    m_timer.start();
+}
+
+//static
+MemoryTracker *MemoryTracker::self()
+{
+    if (!s_self) {
+        s_self = new MemoryTracker;
+    }
+    return s_self;
+}
+
+void MemoryTracker::addConsumer(MemoryConsumer *consumer, const char *counter, const QString &label)
+{
+    Entry entry;
+    entry.consumer = consumer;
+    entry.counter = counter;
+    entry.label = label;
+    m_entries << entry;
+}
+
+void MemoryTracker::removeConsumer(MemoryConsumer *consumer)
+{
+    for (int i = m_entries.count() - 1; i >= 0; --i) {
+        if (m_entries.at(i).consumer == consumer) {
+            m_entries.removeAt(i);
+        }
+    }
+}
+
+QList<MemoryTracker::Usage> MemoryTracker::usage() const
+{
+    QList<Usage> result;
+    QList<const char *> counters;
+    foreach (const Entry &entry, m_entries) {
+        const qint64 budget = entry.consumer->memoryBudget();
+        int ix = counters.indexOf(entry.counter);
+        if (ix < 0) {
+            Usage item;
+            item.label = entry.label;
+            item.usage = 0;
+            item.budget = budget;
+            result << item;
+            counters << entry.counter;
+            ix = result.count() - 1;
+        } else if (budget <= 0) {
+            result[ix].budget = 0;
+        } else if (result.at(ix).budget > 0) {
+            result[ix].budget += budget;
+        }
+        result[ix].usage += entry.consumer->memoryUsage();
+    }
+    return result;
+}
+
+//static
+qint64 MemoryTracker::residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file(QStringLiteral("/proc/self/statm"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    // Total program size followed by the resident size, in pages
+    const QList<QByteArray> fields = file.readAll().split(' ');
+    if (fields.count() < 2) {
+        return -1;
+    }
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+void MemoryTracker::slotCheck()
+{
+    // A consumer evicting data may delete other consumers
+    QList<MemoryConsumer *> over;
+    foreach (const Entry &entry, m_entries) {
+        const qint64 budget = entry.consumer->memoryBudget();
+        if (budget > 0 && entry.consumer->memoryUsage() > budget) {
+            over << entry.consumer;
+        }
+    }
+    foreach (MemoryConsumer *consumer, over) {
+        bool registered = false;
+        foreach (const Entry &entry, m_entries) {
+            if (entry.consumer == consumer) {
+                registered = true;
+                break;
+            }
+        }
+        if (registered) {
+            consumer->reduceMemory();
+        }
+    }
+    if (!Tracer::isRecording()) {
+        return;
+    }
+    // Counters are recorded in kilobytes
+    QList<const char *> counters;
+    QList<qint64> values;
+    foreach (const Entry &entry, m_entries) {
+        int ix = counters.indexOf(entry.counter);
+        if (ix < 0) {
+            counters << entry.counter;
+            values << 0;
+            ix = counters.count() - 1;
+        }
+        values[ix] += entry.consumer->memoryUsage();
+    }
+    for (int i = 0; i < counters.count(); ++i) {
+        Tracer::setCounter(counters.at(i), values.at(i) / 1024);
+    }
+    const qint64 resident = residentMemory();
+    if (resident >= 0) {
+        Tracer::setCounter("Memory resident", resident / 1024);
+    }
+}
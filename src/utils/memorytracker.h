@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef MEMORYTRACKER_H
+#define MEMORYTRACKER_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/**
+ * @class MemoryConsumer
+ * @brief Implemented by the subsystems keeping large data in memory.
+ *
+ * A consumer registers itself with MemoryTracker and is removed when it is deleted.
+ */
+class MemoryConsumer
+{
+public:
+    virtual ~MemoryConsumer();
+    /** @brief Returns the approximate memory used by the subsystem in bytes. */
+    virtual qint64 memoryUsage() const = 0;
+    /** @brief Returns the memory the subsystem may use in bytes, 0 for no limit. */
+    virtual qint64 memoryBudget() const {
+        return 0;
+    }
+    /** @brief Evicts data until the usage fits the budget, called when the budget is exceeded. */
+    virtual void reduceMemory() {}
+};
+
+/**
+ * @class MemoryTracker
+ * @brief Sums the memory used by the registered subsystems and enforces their budgets.
+ *
+ * Consumers sharing a trace counter, for example one per clip, are reported as one subsystem.
+ * The usage is checked at regular intervals: consumers over their budget are asked to evict
+ * data and the usage of each subsystem is recorded as a counter while a trace is recorded.
+ * All methods must be called from the main thread.
+ */
+class MemoryTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Usage {
+        QString label;
+        qint64 usage;
+        /** @brief Sum of the consumer budgets, 0 if one of them has no limit */
+        qint64 budget;
+    };
+    /** @brief Returns the tracker, creating it on first use. */
+    static MemoryTracker *self();
+    /** @brief Registers a consumer.
+     *  @param counter name of its trace counter, it must be a string literal
+     *  @param label name of the subsystem shown to the user */
+    void addConsumer(MemoryConsumer *consumer, const char *counter, const QString &label);
+    void removeConsumer(MemoryConsumer *consumer);
+    /** @brief Returns the current usage of each subsystem, in registration order. */
+    QList<Usage> usage() const;
+    /** @brief Returns the resident memory of the process in bytes, -1 if it is not known. */
+    static qint64 residentMemory();
+
+private:
+    MemoryTracker();
+    struct Entry {
+        MemoryConsumer *consumer;
+        const char *counter;
+        QString label;
+    };
+    static MemoryTracker *s_self;
+    QList<Entry> m_entries;
+    QTimer m_timer;
+    friend class MemoryConsumer;
+
+private slots:
+    /** @brief Enforces the budgets and records the trace counters. */
+    void slotCheck();
+};
+
+#endif
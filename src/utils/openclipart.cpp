@@ -52,6 +52,7 @@ void OpenClipArt::slotStartSearch(const QString &searchText, int page)
         uri.append("&page=" + QString::number(page));
         
     KJob* resolveJob = KIO::storedGet( QUrl(uri), KIO::NoReload, KIO::HideProgressInfo );
+    startQuery(resolveJob);
     connect(resolveJob, &KJob::result, this, &OpenClipArt::slotShowResults);
 }
 
@@ -25,6 +25,7 @@
 #include "freesound.h"
 #include "openclipart.h"
 #include "archiveorg.h"
+#include "thumbnailfetcher.h"
 #include "kdenlivesettings.h"
 
 #include <QPushButton>
@@ -95,6 +96,8 @@ ResourceWidget::ResourceWidget(const QString & folder, QWidget * parent) :
     connect(info_browser, SIGNAL(anchorClicked(QUrl)), this, SLOT(slotOpenLink(QUrl)));
 
     m_networkAccessManager = new QNetworkAccessManager(this);
+    m_thumbFetcher = new ThumbnailFetcher(m_networkAccessManager, this);
+    connect(m_thumbFetcher, &ThumbnailFetcher::thumbReady, this, &ResourceWidget::slotThumbReady);
 
     m_autoPlay = new QAction(i18n("Auto Play"), this);
     m_autoPlay->setCheckable(true);
@@ -131,6 +134,7 @@ ResourceWidget::~ResourceWidget()
     delete m_currentService;
     delete m_tmpThumbFile;
     delete m_movie;
+    delete m_thumbFetcher;
     delete m_networkAccessManager;
     saveConfig();
 }
@@ -167,6 +171,8 @@ void ResourceWidget::slotStartSearch(int page)
 {
     this->setCursor(Qt::WaitCursor);
     info_browser->clear();
+    // Thumbnails of the previous results are not needed anymore
+    m_thumbFetcher->cancel();
     page_number->blockSignals(true);
     page_number->setValue(page);
     page_number->blockSignals(false);
@@ -188,6 +194,7 @@ void ResourceWidget::slotUpdateCurrentSound()
 
 
     GifLabel->clear();
+    m_currentThumb.clear();
     m_desc.clear();
     m_meta.clear();
     QListWidgetItem *item = search_results->currentItem();// get the item the user selected
@@ -229,22 +236,22 @@ void ResourceWidget::slotUpdateCurrentSound()
 }
 
 /**
- * @brief  Downloads thumbnail file from url and saves it to tmp directory - temporyFile
+ * @brief  Requests the thumbnail of the current item from the thumbnail fetcher
  *
- * The same temp file is recycled.
- * Loads the image into the ResourceWidget window.
+ * It is downloaded before the other pending thumbnails, then displayed by slotThumbReady.
  * Connected to signal AbstractService::GotThumb
  * */
 void ResourceWidget::slotLoadThumb(const QString &url)
 {
-    QUrl img(url);
-    if (img.isEmpty()) return;
-    m_tmpThumbFile->close();
-    if (m_tmpThumbFile->open()) {
-        KIO::FileCopyJob *copyjob = KIO::file_copy(img, QUrl::fromLocalFile(m_tmpThumbFile->fileName()), -1, KIO::HideProgressInfo | KIO::Overwrite);
-        if (copyjob->exec()) {
-            slotSetImage(m_tmpThumbFile->fileName());
-        }
+    if (url.isEmpty()) return;
+    m_currentThumb = url;
+    m_thumbFetcher->fetch(url, true);
+}
+
+void ResourceWidget::slotThumbReady(const QString &url, const QImage &image)
+{
+    if (url == m_currentThumb) {
+        GifLabel->setPixmap(QPixmap::fromImage(image));
     }
 }
 /**
@@ -566,6 +573,10 @@ void ResourceWidget::slotChangeService()
 void ResourceWidget::slotSearchFinished()
 {
     this->setCursor(Qt::ArrowCursor);
+    // Fetch the thumbnails known from the results, so that they are ready when an item is selected
+    for (int i = 0; i < search_results->count(); ++i) {
+        m_thumbFetcher->fetch(search_results->item(i)->data(imageRole).toString());
+    }
 }
 
 /**
@@ -773,7 +784,10 @@ void ResourceWidget::slotAccessTokenReceived(QString sAccessToken)
 
          QNetworkReply *reply2 = m_networkAccessManager->get(request);
          connect(reply2, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
-         connect(m_networkAccessManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(DownloadRequestFinished(QNetworkReply*)));
+         // The network manager is shared with the thumbnail downloads, only handle this reply
+         connect(reply2, &QNetworkReply::finished, this, [this, reply2]() {
+             DownloadRequestFinished(reply2);
+         });
      }
      else
      {
@@ -36,6 +36,7 @@ class QNetworkConfigurationManager;
 class QTemporaryFile;
 class QMovie;
 class OAuth2;
+class ThumbnailFetcher;
 
 /**
   \brief This is the window that appears from Project>Online Resources
@@ -72,6 +73,8 @@ private slots:
     void slotPreviousPage();
     void slotOpenLink(const QUrl &url);
     void slotLoadThumb(const QString& url);
+    /** @brief A thumbnail was downloaded, display it if it belongs to the current item */
+    void slotThumbReady(const QString &url, const QImage &image);
     /** @brief A file download is finished */
     void slotGotFile(KJob *job);
     void slotSetMetadata(const QString &metadata);
@@ -105,6 +108,9 @@ private:
     OnlineItemInfo m_currentInfo;
     QAction *m_autoPlay;
     QTemporaryFile *m_tmpThumbFile;
+    ThumbnailFetcher *m_thumbFetcher;
+    /** @brief Thumbnail url of the current item */
+    QString m_currentThumb;
     QString m_title;
     QString m_desc;
     QString m_meta;
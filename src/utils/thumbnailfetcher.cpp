@@ -0,0 +1,204 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "thumbnailfetcher.h"
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+// Number of thumbnails downloaded at the same time, the connection pool size of QNetworkAccessManager
+#define MAX_DOWNLOADS 6
+// Memory used by decoded thumbnails, in kilobytes
+#define MEMORY_CACHE 20480
+// Size of the downloaded thumbnails kept on disk
+#define DISK_CACHE 52428800
+
+/** @brief A decoded thumbnail */
+struct DecodedThumb {
+    QString url;
+    QImage image;
+    int generation;
+};
+
+static DecodedThumb decodeThumb(const QString &url, const QByteArray &downloaded, const QString &path, int generation)
+{
+    DecodedThumb result;
+    result.url = url;
+    result.generation = generation;
+    QByteArray data = downloaded;
+    QFile file(path);
+    if (data.isEmpty()) {
+        if (file.open(QIODevice::ReadOnly)) {
+            data = file.readAll();
+            file.close();
+        }
+    } else if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        file.close();
+    }
+    result.image = QImage::fromData(data);
+    if (result.image.isNull()) {
+        // Do not keep invalid data
+        QFile::remove(path);
+    }
+    return result;
+}
+
+static QString cacheName(const QString &url)
+{
+    return QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+ThumbnailFetcher::ThumbnailFetcher(QNetworkAccessManager *manager, QObject *parent) : QObject(parent)
+    , m_manager(manager)
+    , m_memory(MEMORY_CACHE)
+    , m_generation(0)
+{
+    m_diskFolder = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/onlineresources"));
+    m_diskFolder.mkpath(QStringLiteral("."));
+    pruneDisk();
+}
+
+ThumbnailFetcher::~ThumbnailFetcher()
+{
+    cancel();
+}
+
+void ThumbnailFetcher::fetch(const QString &url, bool priority)
+{
+    if (url.isEmpty()) {
+        return;
+    }
+    QImage *cached = m_memory.object(url);
+    if (cached) {
+        emit thumbReady(url, *cached);
+        return;
+    }
+    if (m_decoding.contains(url) || m_replies.values().contains(url)) {
+        // Already on its way
+        return;
+    }
+    if (m_queue.contains(url)) {
+        if (priority) {
+            m_queue.removeAll(url);
+            m_queue.prepend(url);
+        }
+        return;
+    }
+    if (m_diskFolder.exists(cacheName(url))) {
+        decode(url, QByteArray());
+        return;
+    }
+    if (priority) {
+        m_queue.prepend(url);
+    } else {
+        m_queue.append(url);
+    }
+    processQueue();
+}
+
+void ThumbnailFetcher::cancel()
+{
+    m_generation++;
+    m_queue.clear();
+    m_decoding.clear();
+    QList <QNetworkReply *> replies = m_replies.keys();
+    m_replies.clear();
+    foreach(QNetworkReply *reply, replies) {
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void ThumbnailFetcher::processQueue()
+{
+    while (m_replies.count() < MAX_DOWNLOADS && !m_queue.isEmpty()) {
+        const QString url = m_queue.takeFirst();
+        QNetworkRequest request((QUrl(url)));
+#if QT_VERSION >= 0x050600
+        request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+#endif
+        QNetworkReply *reply = m_manager->get(request);
+        m_replies.insert(reply, url);
+        connect(reply, SIGNAL(finished()), this, SLOT(slotReplyFinished()));
+    }
+}
+
+void ThumbnailFetcher::slotReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !m_replies.contains(reply)) {
+        // Canceled request
+        return;
+    }
+    const QString url = m_replies.take(reply);
+    if (reply->error() == QNetworkReply::NoError) {
+        decode(url, reply->readAll());
+    }
+    reply->deleteLater();
+    processQueue();
+}
+
+void ThumbnailFetcher::decode(const QString &url, const QByteArray &data)
+{
+    m_decoding.insert(url);
+    QFutureWatcher<DecodedThumb> *watcher = new QFutureWatcher<DecodedThumb>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(slotDecoded()));
+    watcher->setFuture(QtConcurrent::run(decodeThumb, url, data, m_diskFolder.absoluteFilePath(cacheName(url)), m_generation));
+}
+
+void ThumbnailFetcher::slotDecoded()
+{
+    QFutureWatcher<DecodedThumb> *watcher = static_cast<QFutureWatcher<DecodedThumb> *>(sender());
+    DecodedThumb result = watcher->result();
+    watcher->deleteLater();
+    if (result.generation != m_generation) {
+        return;
+    }
+    m_decoding.remove(result.url);
+    if (result.image.isNull()) {
+        return;
+    }
+    m_memory.insert(result.url, new QImage(result.image), result.image.byteCount() / 1024 + 1);
+    emit thumbReady(result.url, result.image);
+}
+
+void ThumbnailFetcher::pruneDisk()
+{
+    // Oldest files first
+    const QFileInfoList files = m_diskFolder.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    foreach(const QFileInfo &info, files) {
+        total += info.size();
+    }
+    foreach(const QFileInfo &info, files) {
+        if (total <= DISK_CACHE) {
+            break;
+        }
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef THUMBNAILFETCHER_H
+#define THUMBNAILFETCHER_H
+
+#include <QCache>
+#include <QDir>
+#include <QImage>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * @class ThumbnailFetcher
+ * @brief Downloads and decodes the thumbnails of online resources.
+ *
+ * Thumbnails are downloaded in parallel through the network access manager of the
+ * resource widget, a few at a time so that its connection pool is reused, and decoded
+ * in a worker thread. Decoded images are kept in memory and downloaded files in the
+ * onlineresources cache folder, so that browsing previous results is instant.
+ */
+class ThumbnailFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailFetcher(QNetworkAccessManager *manager, QObject *parent = 0);
+    virtual ~ThumbnailFetcher();
+    /** @brief Requests a thumbnail, thumbReady is emitted once it is available.
+     *  @param priority true to fetch it before the other pending thumbnails */
+    void fetch(const QString &url, bool priority = false);
+    /** @brief Drops all pending requests, for example when a new search is started. */
+    void cancel();
+
+private:
+    QNetworkAccessManager *m_manager;
+    QStringList m_queue;
+    QMap <QNetworkReply *, QString> m_replies;
+    /** @brief Thumbnails being decoded */
+    QSet <QString> m_decoding;
+    QCache <QString, QImage> m_memory;
+    QDir m_diskFolder;
+    /** @brief Incremented when requests are dropped, so that stale decoded images are ignored */
+    int m_generation;
+    void processQueue();
+    /** @brief Decodes data in a worker thread, reading the disk cache if data is empty. */
+    void decode(const QString &url, const QByteArray &data);
+    /** @brief Removes the oldest cached files while the disk cache is too large. */
+    void pruneDisk();
+
+private slots:
+    void slotReplyFinished();
+    void slotDecoded();
+
+signals:
+    void thumbReady(const QString &url, const QImage &image);
+};
+
+#endif
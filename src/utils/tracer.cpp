@@ -0,0 +1,228 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+
+// Maximum number of events kept per thread, older ones are overwritten
+#define TRACE_BUFFER_EVENTS 65536
+// Interval of the timer measuring the main event loop latency, in ms
+#define TRACE_HEARTBEAT_INTERVAL 20
+
+//static
+Tracer *Tracer::s_self = NULL;
+//static
+QAtomicInt Tracer::s_recording(0);
+
+Tracer::ThreadHandle::~ThreadHandle()
+{
+    QMutexLocker lock(&buffer->mutex);
+    buffer->finished = true;
+}
+
+Tracer::Tracer() : QObject()
+    , m_lastBeat(0)
+{
+    m_clock.start();
+    m_heartbeat.setInterval(TRACE_HEARTBEAT_INTERVAL);
+    connect(&m_heartbeat, &QTimer::timeout, this, &Tracer::slotHeartbeat);
+    if (qEnvironmentVariableIsSet("KDENLIVE_TRACE")) {
+        setRecording(true);
+    }
+}
+
+//static
+Tracer *Tracer::self()
+{
+    if (!s_self) {
+        s_self = new Tracer;
+    }
+    return s_self;
+}
+
+//static
+qint64 Tracer::now()
+{
+    return s_self ? s_self->m_clock.nsecsElapsed() / 1000 : 0;
+}
+
+//static
+Tracer::ThreadBuffer *Tracer::threadBuffer()
+{
+    static QThreadStorage<ThreadHandle *> handles;
+    if (!handles.hasLocalData()) {
+        QSharedPointer<ThreadBuffer> buffer(new ThreadBuffer);
+        buffer->next = 0;
+        buffer->finished = false;
+        QThread *thread = QThread::currentThread();
+        buffer->name = thread->objectName();
+        QMutexLocker lock(&s_self->m_buffersMutex);
+        buffer->id = s_self->m_buffers.count() + 1;
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            buffer->name = QStringLiteral("Main");
+        } else if (buffer->name.isEmpty()) {
+            buffer->name = QStringLiteral("Thread %1").arg(buffer->id);
+        }
+        s_self->m_buffers << buffer;
+        handles.setLocalData(new ThreadHandle(buffer));
+    }
+    return handles.localData()->buffer.data();
+}
+
+//static
+void Tracer::append(const TraceEvent &event)
+{
+    if (!s_self) {
+        return;
+    }
+    ThreadBuffer *buffer = threadBuffer();
+    // Only contended while exporting
+    QMutexLocker lock(&buffer->mutex);
+    if (buffer->events.count() < TRACE_BUFFER_EVENTS) {
+        buffer->events.append(event);
+    } else {
+        buffer->events[buffer->next] = event;
+        buffer->next = (buffer->next + 1) % TRACE_BUFFER_EVENTS;
+    }
+}
+
+//static
+void Tracer::addZone(const char *category, const char *name, qint64 start, qint64 duration)
+{
+    TraceEvent event = { category, name, start, duration, 0 };
+    append(event);
+}
+
+//static
+void Tracer::setCounter(const char *name, qint64 value)
+{
+    if (!isRecording()) {
+        return;
+    }
+    TraceEvent event = { "counter", name, now(), -1, value };
+    append(event);
+}
+
+//static
+void Tracer::setThreadName(const QString &name)
+{
+    if (!s_self) {
+        return;
+    }
+    ThreadBuffer *buffer = threadBuffer();
+    QMutexLocker lock(&buffer->mutex);
+    buffer->name = name;
+}
+
+void Tracer::setRecording(bool record)
+{
+    s_recording.store(record ? 1 : 0);
+    if (record) {
+        m_lastBeat = now();
+        m_heartbeat.start();
+    } else {
+        m_heartbeat.stop();
+    }
+}
+
+void Tracer::slotHeartbeat()
+{
+    const qint64 beat = now();
+    setCounter("Event loop delay (us)", qMax((qint64) 0, beat - m_lastBeat - TRACE_HEARTBEAT_INTERVAL * 1000));
+    m_lastBeat = beat;
+}
+
+void Tracer::clear()
+{
+    QMutexLocker lock(&m_buffersMutex);
+    QList<QSharedPointer<ThreadBuffer> >::iterator i = m_buffers.begin();
+    while (i != m_buffers.end()) {
+        QMutexLocker bufferLock(&(*i)->mutex);
+        if ((*i)->finished) {
+            bufferLock.unlock();
+            i = m_buffers.erase(i);
+            continue;
+        }
+        (*i)->events.clear();
+        (*i)->next = 0;
+        ++i;
+    }
+}
+
+int Tracer::eventCount()
+{
+    QMutexLocker lock(&m_buffersMutex);
+    int count = 0;
+    foreach (const QSharedPointer<ThreadBuffer> &buffer, m_buffers) {
+        QMutexLocker bufferLock(&buffer->mutex);
+        count += buffer->events.count();
+    }
+    return count;
+}
+
+static QString jsonString(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace(QLatin1Char('\\'), QStringLiteral("\\\\")).replace(QLatin1Char('"'), QStringLiteral("\\\""));
+    return QLatin1Char('"') + escaped + QLatin1Char('"');
+}
+
+bool Tracer::exportTrace(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    QMutexLocker lock(&m_buffersMutex);
+    foreach (const QSharedPointer<ThreadBuffer> &buffer, m_buffers) {
+        // Copy the events so that the thread is not blocked while writing the file
+        buffer->mutex.lock();
+        const QVector<TraceEvent> events = buffer->events;
+        const QString name = buffer->name;
+        const int id = buffer->id;
+        buffer->mutex.unlock();
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << id << ",\"args\":{\"name\":" << jsonString(name) << "}}";
+        foreach (const TraceEvent &event, events) {
+            out << ",\n";
+            if (event.duration < 0) {
+                out << "{\"name\":\"" << event.name << "\",\"ph\":\"C\",\"ts\":" << event.start << ",\"pid\":" << pid << ",\"tid\":" << id
+                    << ",\"args\":{\"value\":" << event.value << "}}";
+            } else {
+                out << "{\"cat\":\"" << event.category << "\",\"name\":\"" << event.name << "\",\"ph\":\"X\",\"ts\":" << event.start
+                    << ",\"dur\":" << event.duration << ",\"pid\":" << pid << ",\"tid\":" << id << "}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+    return file.error() == QFile::NoError;
+}
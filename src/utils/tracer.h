@@ -0,0 +1,185 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * @class Tracer
+ * @brief Records timed zones and counters of all threads and exports them as a Chrome trace.
+ *
+ * While recording is off a zone only costs one atomic read, so the instrumentation is always
+ * compiled in. Each thread writes to its own ring buffer, threads never wait for each other and a
+ * long recording keeps the most recent events. The exported JSON can be loaded in
+ * chrome://tracing or ui.perfetto.dev. Recording starts with the application when the
+ * KDENLIVE_TRACE environment variable is set.
+ *
+ * Categories, zone and counter names are stored as pointers and must be string literals.
+ */
+class Tracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Returns the tracer, it must first be called from the main thread. */
+    static Tracer *self();
+    static inline bool isRecording() {
+        return s_recording.load() != 0;
+    }
+    /** @brief Microseconds since the tracer was created. */
+    static qint64 now();
+    /** @brief Records a zone of the calling thread that started at @param start and lasted @param duration microseconds. */
+    static void addZone(const char *category, const char *name, qint64 start, qint64 duration);
+    /** @brief Records the value of a counter, shown as a graph in the trace. */
+    static void setCounter(const char *name, qint64 value);
+    /** @brief Sets the name of the calling thread in exported traces, defaults to its object name. */
+    static void setThreadName(const QString &name);
+
+    void setRecording(bool record);
+    /** @brief Forgets all recorded events. */
+    void clear();
+    /** @brief Writes the recorded events to @param path in the Chrome trace event format.
+     *  @return false if the file could not be written */
+    bool exportTrace(const QString &path);
+    /** @brief Number of currently stored events. */
+    int eventCount();
+
+private:
+    Tracer();
+    struct TraceEvent {
+        const char *category;
+        const char *name;
+        qint64 start;
+        /** @brief Duration of a zone, -1 for a counter */
+        qint64 duration;
+        qint64 value;
+    };
+    struct ThreadBuffer {
+        QMutex mutex;
+        QVector<TraceEvent> events;
+        int next;
+        int id;
+        QString name;
+        /** @brief The thread is gone, the buffer can be dropped once exported */
+        bool finished;
+    };
+    /** @brief Owned by the thread storage, marks the buffer finished when the thread exits. */
+    struct ThreadHandle {
+        explicit ThreadHandle(const QSharedPointer<ThreadBuffer> &b) : buffer(b) {}
+        ~ThreadHandle();
+        QSharedPointer<ThreadBuffer> buffer;
+    };
+    static Tracer *s_self;
+    static QAtomicInt s_recording;
+    QElapsedTimer m_clock;
+    QMutex m_buffersMutex;
+    QList<QSharedPointer<ThreadBuffer> > m_buffers;
+    QTimer m_heartbeat;
+    qint64 m_lastBeat;
+    static ThreadBuffer *threadBuffer();
+    static void append(const TraceEvent &event);
+
+private slots:
+    /** @brief Records how late the main event loop processes its timers. */
+    void slotHeartbeat();
+};
+
+/**
+ * @class TraceZone
+ * @brief Records the lifetime of the object as a zone when tracing is enabled.
+ */
+class TraceZone
+{
+public:
+    TraceZone(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_start(Tracer::isRecording() ? Tracer::now() : -1)
+    {
+    }
+    ~TraceZone()
+    {
+        if (m_start >= 0) {
+            Tracer::addZone(m_category, m_name, m_start, Tracer::now() - m_start);
+        }
+    }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    qint64 m_start;
+    Q_DISABLE_COPY(TraceZone)
+};
+
+/**
+ * @class TraceStages
+ * @brief Records consecutive stages of a long function as zones of one category.
+ */
+class TraceStages
+{
+public:
+    explicit TraceStages(const char *category)
+        : m_category(category)
+        , m_name(NULL)
+        , m_start(-1)
+    {
+    }
+    ~TraceStages()
+    {
+        finish();
+    }
+    /** @brief Closes the running stage and starts the one called @param name */
+    void next(const char *name)
+    {
+        finish();
+        m_name = name;
+        m_start = Tracer::isRecording() ? Tracer::now() : -1;
+    }
+    /** @brief Closes the running stage */
+    void finish()
+    {
+        if (m_name && m_start >= 0) {
+            Tracer::addZone(m_category, m_name, m_start, Tracer::now() - m_start);
+        }
+        m_name = NULL;
+    }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    qint64 m_start;
+    Q_DISABLE_COPY(TraceStages)
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+/** @brief Records the rest of the enclosing scope as a zone */
+#define TRACE_ZONE(category, name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(category, name)
+
+#endif
@@ -0,0 +1,477 @@
+/*
+This file is part of kdenlive. See www.kdenlive.org.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+
+#include <QFile>
+#include <QDebug>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStringList>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QXmlStreamWriter>
+#include <QCoreApplication>
+#include <mlt++/Mlt.h>
+#include <sys/resource.h>
+#include <iostream>
+
+// Allowed slowdown against the stored baseline before a scenario fails, in percent
+#define DEFAULT_TOLERANCE 20
+// Number of positions visited by the seek scenario
+#define SEEK_POSITIONS 200
+// Number of frames rendered by the preview scenario
+#define PREVIEW_FRAMES 100
+
+struct ProjectSettings
+{
+    int clips;
+    int binClips;
+    int videoTracks;
+    int audioTracks;
+    int keyframes;
+    int audioMinutes;
+};
+
+void printUsage(const char *path)
+{
+    std::cout << "This executable generates a large synthetic Kdenlive project and times " << std::endl
+              << "the engine side of the usual editing scenarios on it: opening, seeking " << std::endl
+              << "around, rendering a preview zone and saving." << std::endl
+              << "Only generated color and tone producers are used, no media is needed." << std::endl << std::endl
+              << path << " <project file>" << std::endl
+              << "\t-h, --help\n\t\tDisplay this help" << std::endl
+              << "\t--clips=<count>\n\t\tNumber of timeline clips (default: 2000)" << std::endl
+              << "\t--bin-clips=<count>\n\t\tNumber of bin clips used by the timeline clips (default: 200)" << std::endl
+              << "\t--video-tracks=<count>\n\t\tNumber of video tracks (default: 6)" << std::endl
+              << "\t--audio-tracks=<count>\n\t\tNumber of audio tracks (default: 4)" << std::endl
+              << "\t--keyframes=<count>\n\t\tKeyframes in the effect of every clip (default: 50)" << std::endl
+              << "\t--audio-minutes=<minutes>\n\t\tLength of each audio track clip (default: 60)" << std::endl
+              << "\t--profile=<profile>\n\t\tUse the given profile (run: melt -query profiles)" << std::endl
+              << "\t--no-timing\n\t\tOnly generate the project" << std::endl
+              << "\t--baseline=<file>\n\t\tFail if a scenario exceeds the timings stored in this file" << std::endl
+              << "\t--tolerance=<percent>\n\t\tAllowed slowdown against the baseline (default: " << DEFAULT_TOLERANCE << ")" << std::endl
+              << "\t--write-baseline=<file>\n\t\tStore the measured timings in this file" << std::endl
+                 ;
+}
+
+static void writeProperty(QXmlStreamWriter &xml, const QString &name, const QString &value)
+{
+    xml.writeStartElement(QStringLiteral("property"));
+    xml.writeAttribute(QStringLiteral("name"), name);
+    xml.writeCharacters(value);
+    xml.writeEndElement();
+}
+
+/** @brief Returns a keyframe string with @param count keyframes spread over @param length frames. */
+static QString keyframes(int length, int count, double min, double max)
+{
+    QStringList result;
+    count = qMax(2, count);
+    for (int i = 0; i < count; ++i) {
+        const int frame = (length - 1) * i / (count - 1);
+        const double value = min + (max - min) * (qrand() % 1000) / 1000.0;
+        result << QString::number(frame) + QLatin1Char('=') + QString::number(value, 'f', 3);
+    }
+    return result.join(QLatin1Char(';'));
+}
+
+static void writeFilter(QXmlStreamWriter &xml, const QString &id, const QString &level)
+{
+    xml.writeStartElement(QStringLiteral("filter"));
+    writeProperty(xml, QStringLiteral("mlt_service"), id);
+    writeProperty(xml, QStringLiteral("kdenlive_id"), id);
+    writeProperty(xml, QStringLiteral("tag"), id);
+    writeProperty(xml, QStringLiteral("level"), level);
+    xml.writeEndElement();
+}
+
+static void writeTransition(QXmlStreamWriter &xml, const QString &service, int aTrack, int bTrack)
+{
+    xml.writeStartElement(QStringLiteral("transition"));
+    xml.writeAttribute(QStringLiteral("always_active"), QStringLiteral("1"));
+    writeProperty(xml, QStringLiteral("mlt_service"), service);
+    writeProperty(xml, QStringLiteral("a_track"), QString::number(aTrack));
+    writeProperty(xml, QStringLiteral("b_track"), QString::number(bTrack));
+    if (service == QLatin1String("mix")) {
+        writeProperty(xml, QStringLiteral("combine"), QStringLiteral("1"));
+    }
+    writeProperty(xml, QStringLiteral("internal_added"), QStringLiteral("237"));
+    xml.writeEndElement();
+}
+
+/** @brief Writes the project, laid out the way KdenliveDoc::createEmptyDocument does, with the bin clips in the "main bin" playlist. */
+static bool generateProject(const QString &path, const ProjectSettings &settings, const QString &profile, double fps)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement(QStringLiteral("mlt"));
+    xml.writeAttribute(QStringLiteral("LC_NUMERIC"), QString());
+
+    // Bin clips: colors used by the video tracks, one long tone per audio track
+    QList <int> lengths;
+    for (int i = 0; i < settings.binClips; ++i) {
+        const int length = 25 + qrand() % 500;
+        lengths << length;
+        xml.writeStartElement(QStringLiteral("producer"));
+        xml.writeAttribute(QStringLiteral("id"), QString::number(i + 1));
+        xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+        xml.writeAttribute(QStringLiteral("out"), QString::number(length - 1));
+        writeProperty(xml, QStringLiteral("length"), QString::number(length));
+        writeProperty(xml, QStringLiteral("eof"), QStringLiteral("pause"));
+        writeProperty(xml, QStringLiteral("resource"), QStringLiteral("0x%1ff").arg(qrand() % 0xffffff, 6, 16, QLatin1Char('0')));
+        writeProperty(xml, QStringLiteral("mlt_service"), QStringLiteral("colour"));
+        writeProperty(xml, QStringLiteral("kdenlive:clipname"), QStringLiteral("Color %1").arg(i + 1));
+        xml.writeEndElement();
+    }
+    const int audioLength = settings.audioMinutes * 60 * fps;
+    for (int i = 0; i < settings.audioTracks; ++i) {
+        xml.writeStartElement(QStringLiteral("producer"));
+        xml.writeAttribute(QStringLiteral("id"), QString::number(settings.binClips + i + 1));
+        xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+        xml.writeAttribute(QStringLiteral("out"), QString::number(audioLength - 1));
+        writeProperty(xml, QStringLiteral("length"), QString::number(audioLength));
+        writeProperty(xml, QStringLiteral("eof"), QStringLiteral("pause"));
+        writeProperty(xml, QStringLiteral("mlt_service"), QStringLiteral("tone"));
+        writeProperty(xml, QStringLiteral("frequency"), QString::number(220 * (i + 1)));
+        writeProperty(xml, QStringLiteral("kdenlive:clipname"), QStringLiteral("Tone %1").arg(i + 1));
+        xml.writeEndElement();
+    }
+
+    xml.writeStartElement(QStringLiteral("playlist"));
+    xml.writeAttribute(QStringLiteral("id"), QStringLiteral("main bin"));
+    writeProperty(xml, QStringLiteral("kdenlive:docproperties.version"), QStringLiteral("0.95"));
+    writeProperty(xml, QStringLiteral("kdenlive:docproperties.profile"), profile);
+    writeProperty(xml, QStringLiteral("kdenlive:docproperties.documentid"), QString::number(QDateTime::currentMSecsSinceEpoch()));
+    for (int i = 0; i < settings.binClips + settings.audioTracks; ++i) {
+        xml.writeEmptyElement(QStringLiteral("entry"));
+        xml.writeAttribute(QStringLiteral("producer"), QString::number(i + 1));
+    }
+    xml.writeEndElement();
+
+    xml.writeStartElement(QStringLiteral("producer"));
+    xml.writeAttribute(QStringLiteral("id"), QStringLiteral("black"));
+    xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+    xml.writeAttribute(QStringLiteral("out"), QStringLiteral("500"));
+    writeProperty(xml, QStringLiteral("length"), QStringLiteral("15000"));
+    writeProperty(xml, QStringLiteral("eof"), QStringLiteral("pause"));
+    writeProperty(xml, QStringLiteral("resource"), QStringLiteral("black"));
+    writeProperty(xml, QStringLiteral("mlt_service"), QStringLiteral("colour"));
+    xml.writeEndElement();
+
+    // Distribute the timeline clips over the video tracks, with short blanks between them
+    QList <QList <int> > trackClips;
+    for (int i = 0; i < settings.videoTracks; ++i) {
+        trackClips << QList <int>();
+    }
+    for (int i = 0; i < settings.clips; ++i) {
+        trackClips[i % settings.videoTracks] << qrand() % settings.binClips;
+    }
+    int duration = audioLength;
+    for (int i = 0; i < settings.audioTracks; ++i) {
+        xml.writeStartElement(QStringLiteral("playlist"));
+        xml.writeAttribute(QStringLiteral("id"), QStringLiteral("playlist%1").arg(i + 1));
+        xml.writeAttribute(QStringLiteral("kdenlive:track_name"), QStringLiteral("Audio %1").arg(settings.audioTracks - i));
+        xml.writeAttribute(QStringLiteral("kdenlive:audio_track"), QStringLiteral("1"));
+        xml.writeStartElement(QStringLiteral("entry"));
+        xml.writeAttribute(QStringLiteral("producer"), QString::number(settings.binClips + i + 1));
+        xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+        xml.writeAttribute(QStringLiteral("out"), QString::number(audioLength - 1));
+        writeFilter(xml, QStringLiteral("volume"), keyframes(audioLength, settings.keyframes, -20, 0));
+        xml.writeEndElement();
+        xml.writeEndElement();
+    }
+    for (int i = 0; i < settings.videoTracks; ++i) {
+        xml.writeStartElement(QStringLiteral("playlist"));
+        xml.writeAttribute(QStringLiteral("id"), QStringLiteral("playlist%1").arg(settings.audioTracks + i + 1));
+        xml.writeAttribute(QStringLiteral("kdenlive:track_name"), QStringLiteral("Video %1").arg(i + 1));
+        int position = 0;
+        foreach(int clip, trackClips.at(i)) {
+            const int blank = qrand() % 50;
+            if (blank > 0) {
+                xml.writeEmptyElement(QStringLiteral("blank"));
+                xml.writeAttribute(QStringLiteral("length"), QString::number(blank));
+            }
+            const int length = lengths.at(clip);
+            xml.writeStartElement(QStringLiteral("entry"));
+            xml.writeAttribute(QStringLiteral("producer"), QString::number(clip + 1));
+            xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+            xml.writeAttribute(QStringLiteral("out"), QString::number(length - 1));
+            writeFilter(xml, QStringLiteral("brightness"), keyframes(length, settings.keyframes, 0.5, 1.5));
+            xml.writeEndElement();
+            position += blank + length;
+        }
+        duration = qMax(duration, position);
+        xml.writeEndElement();
+    }
+
+    xml.writeStartElement(QStringLiteral("playlist"));
+    xml.writeAttribute(QStringLiteral("id"), QStringLiteral("black_track"));
+    xml.writeEmptyElement(QStringLiteral("entry"));
+    xml.writeAttribute(QStringLiteral("producer"), QStringLiteral("black"));
+    xml.writeAttribute(QStringLiteral("in"), QStringLiteral("0"));
+    xml.writeAttribute(QStringLiteral("out"), QString::number(duration - 1));
+    xml.writeEndElement();
+
+    const int total = settings.audioTracks + settings.videoTracks;
+    xml.writeStartElement(QStringLiteral("tractor"));
+    xml.writeAttribute(QStringLiteral("id"), QStringLiteral("maintractor"));
+    xml.writeAttribute(QStringLiteral("global_feed"), QStringLiteral("1"));
+    xml.writeEmptyElement(QStringLiteral("track"));
+    xml.writeAttribute(QStringLiteral("producer"), QStringLiteral("black_track"));
+    for (int i = 0; i < total; ++i) {
+        xml.writeEmptyElement(QStringLiteral("track"));
+        xml.writeAttribute(QStringLiteral("producer"), QStringLiteral("playlist%1").arg(i + 1));
+        if (i < settings.audioTracks) {
+            xml.writeAttribute(QStringLiteral("hide"), QStringLiteral("video"));
+        }
+    }
+    for (int i = 1; i <= total; ++i) {
+        writeTransition(xml, QStringLiteral("mix"), 0, i);
+        if (i > settings.audioTracks + 1) {
+            writeTransition(xml, QStringLiteral("composite"), settings.audioTracks + 1, i);
+        }
+    }
+    xml.writeEndElement();
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+    return !xml.hasError();
+}
+
+/** @brief Returns the peak resident memory of this process in kilobytes. */
+static qint64 peakMemory()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+static QMap <QString, qint64> readBaseline(const QString &path)
+{
+    QMap <QString, qint64> values;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return values;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QStringList line = stream.readLine().simplified().split(QLatin1Char(' '));
+        if (line.count() == 2 && !line.at(0).startsWith(QLatin1Char('#'))) {
+            values.insert(line.at(0), line.at(1).toLongLong());
+        }
+    }
+    return values;
+}
+
+static bool writeBaseline(const QString &path, const QList <QPair <QString, qint64> > &results)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << "# Generated by largeProject on " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    for (int i = 0; i < results.count(); ++i) {
+        stream << results.at(i).first << ' ' << results.at(i).second << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeAt(0);
+
+    std::string profile = "atsc_1080p_25";
+    ProjectSettings settings;
+    settings.clips = 2000;
+    settings.binClips = 200;
+    settings.videoTracks = 6;
+    settings.audioTracks = 4;
+    settings.keyframes = 50;
+    settings.audioMinutes = 60;
+    bool timing = true;
+    int tolerance = DEFAULT_TOLERANCE;
+    QString baseline;
+    QString newBaseline;
+
+    // Load arguments
+    foreach (const QString &str, args) {
+        const QString value = str.section(QLatin1Char('='), 1);
+
+        if (str.startsWith(QLatin1String("--profile="))) {
+            profile = value.toStdString();
+            args.removeOne(str);
+
+        } else if (str == "-h" || str == "--help") {
+            printUsage(argv[0]);
+            return 0;
+
+        } else if (str.startsWith(QLatin1String("--clips="))) {
+            settings.clips = qMax(1, value.toInt());
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--bin-clips="))) {
+            settings.binClips = qMax(1, value.toInt());
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--video-tracks="))) {
+            settings.videoTracks = qMax(1, value.toInt());
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--audio-tracks="))) {
+            settings.audioTracks = qMax(0, value.toInt());
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--keyframes="))) {
+            settings.keyframes = qMax(2, value.toInt());
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--audio-minutes="))) {
+            settings.audioMinutes = qMax(1, value.toInt());
+            args.removeOne(str);
+
+        } else if (str == "--no-timing") {
+            timing = false;
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--baseline="))) {
+            baseline = value;
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--tolerance="))) {
+            tolerance = value.toInt();
+            args.removeOne(str);
+
+        } else if (str.startsWith(QLatin1String("--write-baseline="))) {
+            newBaseline = value;
+            args.removeOne(str);
+        }
+
+    }
+
+    if (args.isEmpty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const QString projectFile = args.takeFirst();
+    if (!args.isEmpty()) {
+        qDebug() << "Unused arguments: " << args;
+    }
+
+    // Initialize MLT
+    Mlt::Factory::init(NULL);
+    Mlt::Profile prof(profile.c_str());
+
+    // Always generate the same project for the same settings, so that timings can be compared
+    qsrand(settings.clips + settings.binClips * 7 + settings.keyframes * 13);
+    if (!generateProject(projectFile, settings, QString::fromStdString(profile), prof.fps())) {
+        std::cout << "Cannot write " << projectFile.toStdString() << std::endl;
+        return 2;
+    }
+    std::cout << "Generated " << QFileInfo(projectFile).absoluteFilePath().toStdString() << " ("
+              << settings.clips << " clips on " << settings.videoTracks << " video and "
+              << settings.audioTracks << " audio tracks, " << QFileInfo(projectFile).size() / 1024 << " kB)" << std::endl;
+    if (!timing) {
+        return 0;
+    }
+
+    QList <QPair <QString, qint64> > results;
+    QElapsedTimer timer;
+
+    // Open
+    timer.start();
+    Mlt::Producer producer(prof, "xml", projectFile.toUtf8().constData());
+    if (!producer.is_valid()) {
+        std::cout << projectFile.toStdString() << " is invalid." << std::endl;
+        return 2;
+    }
+    results << qMakePair(QStringLiteral("open_ms"), timer.elapsed());
+
+    // Seek through the whole timeline, as scrolling the monitor does
+    const int length = producer.get_playtime();
+    timer.start();
+    for (int i = 0; i < SEEK_POSITIONS; ++i) {
+        producer.seek((qint64) length * i / SEEK_POSITIONS);
+        Mlt::Frame *frame = producer.get_frame();
+        delete frame;
+    }
+    results << qMakePair(QStringLiteral("seek_ms"), timer.elapsed());
+
+    // Render a preview zone in the middle of the project, images and audio
+    timer.start();
+    producer.seek(length / 2);
+    for (int i = 0; i < PREVIEW_FRAMES; ++i) {
+        Mlt::Frame *frame = producer.get_frame();
+        mlt_image_format format = mlt_image_rgb24a;
+        int width = prof.width();
+        int height = prof.height();
+        frame->get_image(format, width, height);
+        mlt_audio_format audioFormat = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = mlt_sample_calculator(prof.fps(), frequency, length / 2 + i);
+        frame->get_audio(audioFormat, frequency, channels, samples);
+        delete frame;
+    }
+    results << qMakePair(QStringLiteral("preview_ms"), timer.elapsed());
+
+    // Save
+    const QString savedFile = projectFile + QStringLiteral(".saved.mlt");
+    timer.start();
+    Mlt::Consumer xmlConsumer(prof, ("xml:" + savedFile).toUtf8().constData());
+    xmlConsumer.set("terminate_on_pause", 1);
+    xmlConsumer.set("store", "kdenlive");
+    xmlConsumer.connect(producer);
+    xmlConsumer.run();
+    results << qMakePair(QStringLiteral("save_ms"), timer.elapsed());
+    QFile::remove(savedFile);
+
+    results << qMakePair(QStringLiteral("peak_memory_kb"), peakMemory());
+
+    bool failed = false;
+    const QMap <QString, qint64> reference = readBaseline(baseline);
+    if (!baseline.isEmpty() && reference.isEmpty()) {
+        std::cout << "Cannot read baseline " << baseline.toStdString() << std::endl;
+        failed = true;
+    }
+    for (int i = 0; i < results.count(); ++i) {
+        const QString &name = results.at(i).first;
+        const qint64 value = results.at(i).second;
+        std::cout << name.toStdString() << "\t" << value;
+        if (reference.contains(name)) {
+            const qint64 limit = reference.value(name) * (100 + tolerance) / 100;
+            // Ignore noise on scenarios that are too fast to measure
+            if (value > limit && value - reference.value(name) > 10) {
+                std::cout << "\tFAILED, baseline is " << reference.value(name);
+                failed = true;
+            } else {
+                std::cout << "\tbaseline " << reference.value(name);
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    if (!newBaseline.isEmpty()) {
+        if (!writeBaseline(newBaseline, results)) {
+            std::cout << "Cannot write baseline " << newBaseline.toStdString() << std::endl;
+            return 2;
+        }
+        std::cout << "Saved baseline as " << QFileInfo(newBaseline).absoluteFilePath().toStdString() << std::endl;
+    }
+
+    return failed ? 3 : 0;
+}
@@ -20,8 +20,13 @@
 
 #include "mltpreview.h"
 
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
+#include <QSettings>
+#include <QStandardPaths>
 #include <QVarLengthArray>
 
 
@@ -32,56 +37,100 @@
 
 #define DBG_AREA
 
+// Number of samples per side of the grid used to compute the image variance
+#define VARIANCE_GRID 32
+// Bytes read at the start and end of a file to compute its hash
+#define HASH_CHUNK 65536
+// Maximum number of frame positions kept in the cache file
+#define CACHE_ENTRIES 2000
+
 extern "C" {
 Q_DECL_EXPORT ThumbCreator *new_creator() {
     return new MltPreview;
 }
 }
 
-MltPreview::MltPreview()
+MltPreview::MltPreview() :
+    m_profile(NULL)
+    , m_cache(NULL)
 {
     Mlt::Factory::init();
+    // The profile is only used to scale the frames, one is enough for all files
+    m_profile = new Mlt::Profile();
+    QString cacheFolder = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (!cacheFolder.isEmpty()) {
+        QDir().mkpath(cacheFolder + QStringLiteral("/kdenlive"));
+        m_cache = new QSettings(cacheFolder + QStringLiteral("/kdenlive/mltpreview.ini"), QSettings::IniFormat);
+    }
 }
 
 MltPreview::~MltPreview()
 {
+    delete m_cache;
+    delete m_profile;
     Mlt::Factory::close();
 }
 
 
 bool MltPreview::create(const QString &path, int width, int height, QImage &img)
 {
-    Mlt::Profile *profile = new Mlt::Profile();
-    Mlt::Producer *producer = new Mlt::Producer(*profile, path.toUtf8().data());
+    Mlt::Producer *producer = new Mlt::Producer(*m_profile, path.toUtf8().data());
 
 
     if (producer->is_blank()) {
         delete producer;
-        delete profile;
         return false;
     }
-    int frame = 75;
-    uint variance = 10;
-    int ct = 1;
-    double ar = profile->dar();
+    double ar = m_profile->dar();
     if (ar == 0) ar = 1.0;
     int wanted_width = width;
-    int wanted_height = width / profile->dar();
+    int wanted_height = width / ar;
     if (wanted_height > height) {
 	wanted_height = height;
 	wanted_width = height * ar;
     }
 
-    //img = getFrame(producer, frame, width, height);
+    // The frame picked for a file is remembered, so that other sizes or copies of it are decoded once
+    const QString hash = fileHash(path);
+    if (m_cache && !hash.isEmpty() && m_cache->contains(hash)) {
+        img = getFrame(producer, m_cache->value(hash).toInt(), wanted_width, wanted_height);
+        if (!img.isNull()) {
+            delete producer;
+            return true;
+        }
+    }
+
+    // No audio is needed, and only key frames are decoded, skipping the loop filter:
+    // a seek then returns the first key frame after the requested position without decoding the frames in between
+    producer->set("audio_index", -1);
+    producer->set("skip_frame", "nokey");
+    producer->set("skip_loop_filter", "all");
+    int frame = 75;
+    int picked = frame;
+    uint variance = 10;
+    int ct = 1;
     while (variance <= 40 && ct < 4) {
+        picked = frame;
         img = getFrame(producer, frame, wanted_width , wanted_height);
         variance = imageVariance(img);
         frame += 100 * ct;
         ct++;
     }
+    if (img.isNull()) {
+        // Some decoders do not support key frame only decoding, use exact seeking
+        producer->set("skip_frame", "default");
+        producer->set("skip_loop_filter", "default");
+        picked = 75;
+        img = getFrame(producer, picked, wanted_width, wanted_height);
+    }
 
     delete producer;
-    delete profile;
+    if (!img.isNull() && m_cache && !hash.isEmpty()) {
+        if (m_cache->allKeys().count() >= CACHE_ENTRIES) {
+            m_cache->clear();
+        }
+        m_cache->setValue(hash, picked);
+    }
     return (img.isNull() == false);
 }
 
@@ -95,7 +144,7 @@ QImage MltPreview::getFrame(Mlt::Producer *producer, int framepos, int width, in
     producer->seek(framepos);
     Mlt::Frame *frame = producer->get_frame();
     if (frame == NULL) {
-        return mltImage;
+        return QImage();
     }
 
     mlt_image_format format = mlt_image_rgb24a;
@@ -104,28 +153,49 @@ QImage MltPreview::getFrame(Mlt::Producer *producer, int framepos, int width, in
     if (imagedata != NULL) {
         memcpy(mltImage.bits(), imagedata, width * height * 4);
         mltImage = mltImage.rgbSwapped();
+    } else {
+        mltImage = QImage();
     }
 
     delete frame;
     return mltImage;
 }
 
+QString MltPreview::fileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    // Size, start and end of the file identify it without reading it all
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(file.size()));
+    hash.addData(file.read(HASH_CHUNK));
+    if (file.size() > 2 * HASH_CHUNK && file.seek(file.size() - HASH_CHUNK)) {
+        hash.addData(file.read(HASH_CHUNK));
+    }
+    return hash.result().toHex();
+}
 
 uint MltPreview::imageVariance(const QImage &image)
 {
-    if (image.isNull()) return 0;
+    if (image.isNull() || image.width() < 1 || image.height() < 1) return 0;
     uint delta = 0;
     uint avg = 0;
-    uint bytes = image.byteCount();
-    uint STEPS = bytes / 2;
-    if (STEPS < 1) return 0;
-    QVarLengthArray<uchar> pivot(STEPS);
-    qDebug() << "Using " << STEPS << " steps\n";
-    const uchar *bits=image.bits();
+    // Sample a grid of pixels instead of the whole image
+    const int columns = qMin(VARIANCE_GRID, image.width());
+    const int rows = qMin(VARIANCE_GRID, image.height());
+    const uint STEPS = columns * rows;
+    QVarLengthArray<uchar, VARIANCE_GRID * VARIANCE_GRID> pivot(STEPS);
     // First pass: get pivots and taking average
-    for( uint i=0; i<STEPS ; i++ ){
-        pivot[i] = bits[2 * i];
-        avg+=pivot.at(i);
+    uint n = 0;
+    for (int y = 0; y < rows; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y * image.height() / rows));
+        for (int x = 0; x < columns; ++x) {
+            pivot[n] = qGray(line[x * image.width() / columns]);
+            avg += pivot.at(n);
+            n++;
+        }
     }
     avg=avg/STEPS;
     // Second Step: calculate delta (average?)
@@ -29,6 +29,8 @@
 
 #include <QObject>
 
+class QSettings;
+
 class MltPreview : public ThumbCreator
 {
 public:
@@ -38,8 +40,16 @@ public:
     virtual Flags flags() const;
 
 protected:
+    /** @brief Returns the mean deviation of the luma of a grid of pixels from their average. */
     static uint imageVariance(const QImage &image);
+    /** @brief Returns a hash of the size, start and end of a file. */
+    static QString fileHash(const QString &path);
     QImage getFrame(Mlt::Producer* producer, int framepos, int width, int height);
+
+private:
+    Mlt::Profile *m_profile;
+    /** @brief Frame picked for each file hash */
+    QSettings *m_cache;
 };
 
 #endif